@@ -18,6 +18,10 @@ int main() {
 #include <stdio.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "port/port.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/db.h"
@@ -26,6 +30,7 @@ int main() {
 #include "util/gflags_compat.h"
 #include "util/mutexlock.h"
 #include "util/random.h"
+#include "util/string_util.h"
 
 using GFLAGS_NAMESPACE::ParseCommandLineFlags;
 
@@ -47,7 +52,17 @@ DEFINE_int32(lookup_percent, 50,
 DEFINE_int32(erase_percent, 10,
              "Ratio of erase to total workload (expressed as a percentage)");
 
-DEFINE_bool(use_clock_cache, false, "");
+DEFINE_bool(skewed, false,
+            "Pick keys with an exponential bias towards small keys instead of "
+            "uniformly, so that a few hot keys take most of the lookups");
+
+DEFINE_string(cache_type, "lru",
+              "Comma separated list of the caches to run the benchmark on, "
+              "one after the other: lru, clock or lirs");
+DEFINE_bool(use_clock_cache, false, "Same as --cache_type=clock");
+DEFINE_double(lirs_irr_ratio, 0.9, "irr_ratio of the lirs cache");
+DEFINE_bool(lirs_adaptive_irr_ratio, false,
+            "Let the lirs cache adapt its irr_ratio online");
 
 namespace TERARKDB_NAMESPACE {
 
@@ -105,23 +120,41 @@ struct ThreadState {
   uint32_t tid;
   Random rnd;
   SharedState* shared;
+  uint64_t lookups;
+  uint64_t hits;
 
   ThreadState(uint32_t index, SharedState* _shared)
-      : tid(index), rnd(1000 + index), shared(_shared) {}
+      : tid(index), rnd(1000 + index), shared(_shared), lookups(0), hits(0) {}
 };
+
+int KeyBits() {
+  int bits = 0;
+  while (bits < 63 && (int64_t{1} << bits) < FLAGS_max_key) {
+    bits++;
+  }
+  return bits;
+}
 }  // namespace
 
 class CacheBench {
  public:
-  CacheBench() : num_threads_(FLAGS_threads) {
-    if (FLAGS_use_clock_cache) {
+  explicit CacheBench(const std::string& cache_type)
+      : cache_type_(cache_type), num_threads_(FLAGS_threads) {
+    if (cache_type == "clock") {
       cache_ = NewClockCache(FLAGS_cache_size, FLAGS_num_shard_bits);
+    } else if (cache_type == "lirs") {
+      cache_ = NewLIRSCache(FLAGS_cache_size, FLAGS_num_shard_bits, false,
+                            FLAGS_lirs_irr_ratio, nullptr,
+                            FLAGS_lirs_adaptive_irr_ratio);
       if (!cache_) {
-        fprintf(stderr, "Clock cache not supported.\n");
+        fprintf(stderr, "Invalid lirs cache options.\n");
         exit(1);
       }
-    } else {
+    } else if (cache_type == "lru") {
       cache_ = NewLRUCache(FLAGS_cache_size, FLAGS_num_shard_bits);
+    } else {
+      fprintf(stderr, "Unknown cache type %s.\n", cache_type.c_str());
+      exit(1);
     }
   }
 
@@ -130,7 +163,7 @@ class CacheBench {
   void PopulateCache() {
     Random rnd(1);
     for (int64_t i = 0; i < FLAGS_cache_size; i++) {
-      uint64_t rand_key = rnd.Next() % FLAGS_max_key;
+      uint64_t rand_key = NextKey(&rnd);
       // Cast uint64* to be char*, data would be copied to cache
       Slice key(reinterpret_cast<char*>(&rand_key), 8);
       // do insert
@@ -170,15 +203,35 @@ class CacheBench {
       double elapsed = static_cast<double>(end_time - start_time) * 1e-6;
       uint32_t qps = static_cast<uint32_t>(
           static_cast<double>(FLAGS_threads * FLAGS_ops_per_thread) / elapsed);
-      fprintf(stdout, "Complete in %.3f s; QPS = %u\n", elapsed, qps);
+      uint64_t lookups = 0;
+      uint64_t hits = 0;
+      for (auto thread : threads) {
+        lookups += thread->lookups;
+        hits += thread->hits;
+      }
+      fprintf(stdout, "Complete in %.3f s; QPS = %u; hit ratio = %.4f\n",
+              elapsed, qps,
+              lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups);
+    }
+    for (auto thread : threads) {
+      delete thread;
     }
     return true;
   }
 
  private:
+  std::string cache_type_;
   std::shared_ptr<Cache> cache_;
   uint32_t num_threads_;
 
+  static uint64_t NextKey(Random* rnd) {
+    static const int kKeyBits = KeyBits();
+    if (FLAGS_skewed) {
+      return rnd->Skewed(std::min(kKeyBits, 30)) % FLAGS_max_key;
+    }
+    return rnd->Next() % FLAGS_max_key;
+  }
+
   static void ThreadBody(void* v) {
     ThreadState* thread = reinterpret_cast<ThreadState*>(v);
     SharedState* shared = thread->shared;
@@ -206,22 +259,22 @@ class CacheBench {
 
   void OperateCache(ThreadState* thread) {
     for (uint64_t i = 0; i < FLAGS_ops_per_thread; i++) {
-      uint64_t rand_key = thread->rnd.Next() % FLAGS_max_key;
+      uint64_t rand_key = NextKey(&thread->rnd);
       // Cast uint64* to be char*, data would be copied to cache
       Slice key(reinterpret_cast<char*>(&rand_key), 8);
       int32_t prob_op = thread->rnd.Uniform(100);
-      if (prob_op >= 0 && prob_op < FLAGS_insert_percent) {
+      if (prob_op < FLAGS_insert_percent) {
         // do insert
         cache_->Insert(key, new char[10], 1, &deleter);
-      } else if (prob_op -=
-                 FLAGS_insert_percent && prob_op < FLAGS_lookup_percent) {
+      } else if ((prob_op -= FLAGS_insert_percent) < FLAGS_lookup_percent) {
         // do lookup
+        thread->lookups++;
         auto handle = cache_->Lookup(key);
         if (handle) {
+          thread->hits++;
           cache_->Release(handle);
         }
-      } else if (prob_op -=
-                 FLAGS_lookup_percent && prob_op < FLAGS_erase_percent) {
+      } else if ((prob_op -= FLAGS_lookup_percent) < FLAGS_erase_percent) {
         // do erase
         cache_->Erase(key);
       }
@@ -230,11 +283,13 @@ class CacheBench {
 
   void PrintEnv() const {
     printf("RocksDB version     : %d.%d\n", kMajorVersion, kMinorVersion);
+    printf("Cache type          : %s\n", cache_type_.c_str());
     printf("Number of threads   : %d\n", FLAGS_threads);
     printf("Ops per thread      : %" PRIu64 "\n", FLAGS_ops_per_thread);
     printf("Cache size          : %" PRIu64 "\n", FLAGS_cache_size);
     printf("Num shard bits      : %d\n", FLAGS_num_shard_bits);
     printf("Max key             : %" PRIu64 "\n", FLAGS_max_key);
+    printf("Skewed keys         : %d\n", FLAGS_skewed);
     printf("Populate cache      : %d\n", FLAGS_populate_cache);
     printf("Insert percentage   : %d%%\n", FLAGS_insert_percent);
     printf("Lookup percentage   : %d%%\n", FLAGS_lookup_percent);
@@ -252,15 +307,20 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
-  TERARKDB_NAMESPACE::CacheBench bench;
-  if (FLAGS_populate_cache) {
-    bench.PopulateCache();
-  }
-  if (bench.Run()) {
-    return 0;
-  } else {
-    return 1;
+  std::vector<std::string> cache_types =
+      FLAGS_use_clock_cache
+          ? std::vector<std::string>{"clock"}
+          : TERARKDB_NAMESPACE::StringSplit(FLAGS_cache_type, ',');
+  for (const auto& cache_type : cache_types) {
+    TERARKDB_NAMESPACE::CacheBench bench(cache_type);
+    if (FLAGS_populate_cache) {
+      bench.PopulateCache();
+    }
+    if (!bench.Run()) {
+      return 1;
+    }
   }
+  return 0;
 }
 
 #endif  // GFLAGS
@@ -12,6 +12,7 @@
 #include <forward_list>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -19,6 +20,7 @@
 #include "cache/lru_cache.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/coding.h"
+#include "util/random.h"
 #include "util/string_util.h"
 #include "util/testharness.h"
 
@@ -679,13 +681,163 @@ TEST_P(CacheTest, DefaultShardBits) {
   ASSERT_EQ(6, sc->GetNumShardBits());
 }
 
-#ifdef SUPPORT_CLOCK_CACHE
-shared_ptr<Cache> (*new_clock_cache_func)(size_t, int, bool) = NewClockCache;
+TEST(LIRSCacheTest, ErasedWhileReferenced) {
+  std::shared_ptr<Cache> cache = NewLIRSCache(100, 0, false);
+  int deleted = 0;
+  auto counting_deleter = [](const Slice& /*key*/, void* value) {
+    ++*reinterpret_cast<int*>(value);
+  };
+  ASSERT_OK(cache->Insert("a", &deleted, 10, counting_deleter));
+  Cache::Handle* h = cache->Lookup("a");
+  ASSERT_TRUE(h != nullptr);
+  ASSERT_EQ(10U, cache->GetPinnedUsage());
+
+  cache->Erase("a");
+  ASSERT_TRUE(cache->Lookup("a") == nullptr);
+  ASSERT_EQ(0, deleted);
+  ASSERT_EQ(10U, cache->GetUsage());
+
+  // The last reference frees the erased entry
+  ASSERT_TRUE(cache->Release(h));
+  ASSERT_EQ(1, deleted);
+  ASSERT_EQ(0U, cache->GetUsage());
+  ASSERT_EQ(0U, cache->GetPinnedUsage());
+}
+
+TEST(LIRSCacheTest, ConcurrentLookup) {
+  const int kNumKeys = 200;
+  std::shared_ptr<Cache> cache = NewLIRSCache(kNumKeys / 2, 2, false);
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t]() {
+      Random rnd(301 + t);
+      for (int i = 0; i < 10000; ++i) {
+        std::string key = EncodeKey(rnd.Skewed(8) % kNumKeys);
+        Cache::Handle* h = cache->Lookup(key);
+        if (h == nullptr) {
+          cache->Insert(key, nullptr, 1, dumbDeleter);
+        } else {
+          cache->Release(h, rnd.OneIn(100));
+        }
+        if (rnd.OneIn(50)) {
+          cache->Erase(key);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_LE(cache->GetUsage(), static_cast<size_t>(kNumKeys / 2));
+  ASSERT_EQ(0U, cache->GetPinnedUsage());
+  cache->EraseUnRefEntries();
+  ASSERT_EQ(0U, cache->GetUsage());
+}
+
+TEST(LIRSCacheTest, AdaptiveIrrRatio) {
+  // The hot keys move every 50000 lookups, a LIR share of 0.99 leaves too
+  // little room to the new hot keys while the old ones are demoted
+  auto hit_ratio = [](std::shared_ptr<Cache> cache) {
+    Random rnd(301);
+    int hits = 0;
+    const int kNumLookups = 200000;
+    for (int i = 0; i < kNumLookups; ++i) {
+      std::string key = EncodeKey(i / 50000 * 10000 + rnd.Skewed(11));
+      Cache::Handle* h = cache->Lookup(key);
+      if (h != nullptr) {
+        hits++;
+        cache->Release(h);
+      } else {
+        cache->Insert(key, nullptr, 1, dumbDeleter);
+      }
+    }
+    return static_cast<double>(hits) / kNumLookups;
+  };
+  double static_hit_ratio = hit_ratio(NewLIRSCache(1000, 0, false, 0.99));
+  double adaptive_hit_ratio =
+      hit_ratio(NewLIRSCache(1000, 0, false, 0.99, nullptr, true));
+  ASSERT_GT(adaptive_hit_ratio, static_hit_ratio + 0.05);
+}
+
+// Keeps the keys it is offered, with the values as their contents
+class TestSecondaryCache : public SecondaryCache {
+ public:
+  const char* Name() const override { return "TestSecondaryCache"; }
+
+  void Demote(const Slice& key, void* value, size_t /*charge*/,
+              void (*deleter)(const Slice& key, void* value)) override {
+    if (deleter == &dumbDeleter) {
+      entries_[key.ToString()] = EncodeKey(DecodeValue(value));
+    }
+  }
+
+  char* Promote(const Slice& key, MemoryAllocator* /*allocator*/,
+                size_t* size) override {
+    auto iter = entries_.find(key.ToString());
+    if (iter == entries_.end()) {
+      return nullptr;
+    }
+    char* data = new char[iter->second.size()];
+    memcpy(data, iter->second.data(), iter->second.size());
+    *size = iter->second.size();
+    entries_.erase(iter);
+    return data;
+  }
+
+  size_t GetUsage() const override { return entries_.size(); }
+
+ private:
+  std::map<std::string, std::string> entries_;
+};
+
+TEST(SecondaryCacheTest, DemoteEvicted) {
+  for (int lirs = 0; lirs < 2; ++lirs) {
+    auto secondary_cache = std::make_shared<TestSecondaryCache>();
+    std::shared_ptr<Cache> cache;
+    if (lirs) {
+      LIRSCacheOptions opts(10, 0, false, 0.5);
+      opts.secondary_cache = secondary_cache;
+      cache = NewLIRSCache(opts);
+    } else {
+      LRUCacheOptions opts(10, 0, false, 0.0);
+      opts.secondary_cache = secondary_cache;
+      cache = NewLRUCache(opts);
+    }
+    ASSERT_EQ(secondary_cache.get(), cache->secondary_cache());
+
+    for (int i = 0; i < 20; ++i) {
+      ASSERT_OK(
+          cache->Insert(EncodeKey(i), EncodeValue(i + 100), 1, &dumbDeleter));
+    }
+    // Erased entries and the ones of other types are not demoted
+    cache->Erase(EncodeKey(19));
+    ASSERT_OK(cache->Insert(EncodeKey(20), EncodeValue(120), 10, [](
+        const Slice& /*key*/, void* /*value*/) {}));
+
+    size_t num_evicted = 0;
+    for (int i = 0; i < 21; ++i) {
+      Cache::Handle* h = cache->Lookup(EncodeKey(i));
+      size_t size = 0;
+      char* data = secondary_cache->Promote(EncodeKey(i), nullptr, &size);
+      if (h != nullptr) {
+        ASSERT_TRUE(data == nullptr);
+        cache->Release(h);
+      } else if (i >= 19) {
+        ASSERT_TRUE(data == nullptr);
+      } else {
+        ASSERT_TRUE(data != nullptr);
+        ASSERT_EQ(i + 100, DecodeKey(Slice(data, size)));
+        delete[] data;
+        ++num_evicted;
+      }
+    }
+    ASSERT_GT(num_evicted, 0U);
+    ASSERT_EQ(0U, secondary_cache->GetUsage());
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest,
                         testing::Values(kLRU, kClock));
-#else
-INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest, testing::Values(kLRU));
-#endif  // SUPPORT_CLOCK_CACHE
 
 }  // namespace TERARKDB_NAMESPACE
 
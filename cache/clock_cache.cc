@@ -9,36 +9,16 @@
 
 #include "cache/clock_cache.h"
 
-#include "rocksdb/terark_namespace.h"
-
-#ifndef SUPPORT_CLOCK_CACHE
-
-namespace TERARKDB_NAMESPACE {
-
-std::shared_ptr<Cache> NewClockCache(size_t /*capacity*/,
-                                     int /*num_shard_bits*/,
-                                     bool /*strict_capacity_limit*/) {
-  // Clock cache not supported.
-  return nullptr;
-}
-
-}  // namespace TERARKDB_NAMESPACE
-
-#else
-
 #include <assert.h>
 
 #include <atomic>
 #include <deque>
+#include <memory>
+#include <vector>
 
-// "tbb/concurrent_hash_map.h" requires RTTI if exception is enabled.
-// Disable it so users can chooose to disable RTTI.
-#ifndef ROCKSDB_USE_RTTI
-#define TBB_USE_EXCEPTIONS 0
-#endif
 #include "cache/sharded_cache.h"
 #include "port/port.h"
-#include "tbb/concurrent_hash_map.h"
+#include "rocksdb/terark_namespace.h"
 #include "util/autovector.h"
 #include "util/mutexlock.h"
 
@@ -63,8 +43,8 @@ namespace {
 // with in concurrent environment.
 //
 // The cache also maintains a concurrent hash map for lookup. Any concurrent
-// hash map implementation should do the work. We currently use
-// tbb::concurrent_hash_map because it supports concurrent erase.
+// hash map implementation should do the work. We use HandleTable, an open
+// addressing table whose lookups are lock free, see below.
 //
 // Each cache handle has the following flags and counters, which are squeeze
 // in an atomic interger, to make sure the handle always be in a consistent
@@ -207,25 +187,140 @@ struct CacheHandle {
   }
 };
 
-// Key of hash map. We store hash value with the key for convenience.
-struct CacheKey {
-  Slice key;
-  uint32_t hash_value;
+// An open addressing hash table from keys to cache handles, probed linearly.
+// Lookup() is lock free, the other methods have to hold the shard mutex.
+//
+// A lookup may find a handle which is being erased or has been reused for
+// another key, and may miss an entry which is being moved by Remove() or
+// which was inserted while the table grew. So a found handle has to be checked
+// by the caller after it holds a reference, and a miss is fine for a cache.
+// Remove() shifts the following entries back instead of leaving tombstones.
+// The slot arrays only grow and are kept until the table is destroyed, as
+// readers may still probe an old one.
+class HandleTable {
+ public:
+  HandleTable() : array_(nullptr), elems_(0) { Grow(); }
+
+  // Probe the entries with `hash` until `try_ref` accepts one.
+  template <typename TryRef>
+  CacheHandle* Lookup(uint32_t hash, TryRef try_ref) const {
+    const Array* array = array_.load(std::memory_order_acquire);
+    for (size_t i = hash & array->mask;; i = (i + 1) & array->mask) {
+      const Slot& slot = array->slots[i];
+      CacheHandle* handle = slot.handle.load(std::memory_order_acquire);
+      if (handle == nullptr) {
+        return nullptr;
+      }
+      if (slot.hash.load(std::memory_order_relaxed) == hash &&
+          try_ref(handle)) {
+        return handle;
+      }
+    }
+  }
 
-  CacheKey() = default;
+  // Returns the handle of the same key that `handle` replaces, if any.
+  CacheHandle* Insert(CacheHandle* handle) {
+    if ((elems_ + 1) * 2 > array_.load(std::memory_order_relaxed)->size()) {
+      Grow();
+    }
+    Array* array = array_.load(std::memory_order_relaxed);
+    size_t i = FindSlot(array, handle->key, handle->hash);
+    Slot& slot = array->slots[i];
+    CacheHandle* old = slot.handle.load(std::memory_order_relaxed);
+    if (old == nullptr) {
+      slot.hash.store(handle->hash, std::memory_order_relaxed);
+      ++elems_;
+    }
+    slot.handle.store(handle, std::memory_order_release);
+    return old;
+  }
 
-  CacheKey(const Slice& k, uint32_t h) {
-    key = k;
-    hash_value = h;
+  CacheHandle* Remove(const Slice& key, uint32_t hash) {
+    Array* array = array_.load(std::memory_order_relaxed);
+    size_t hole = FindSlot(array, key, hash);
+    CacheHandle* removed = array->slots[hole].handle.load(
+        std::memory_order_relaxed);
+    if (removed == nullptr) {
+      return nullptr;
+    }
+    // Move back the entries that can't be reached across the hole any more
+    for (size_t i = (hole + 1) & array->mask;; i = (i + 1) & array->mask) {
+      Slot& slot = array->slots[i];
+      CacheHandle* handle = slot.handle.load(std::memory_order_relaxed);
+      if (handle == nullptr) {
+        break;
+      }
+      uint32_t slot_hash = slot.hash.load(std::memory_order_relaxed);
+      size_t home = slot_hash & array->mask;
+      if (((i - home) & array->mask) >= ((i - hole) & array->mask)) {
+        array->slots[hole].hash.store(slot_hash, std::memory_order_relaxed);
+        array->slots[hole].handle.store(handle, std::memory_order_release);
+        hole = i;
+      }
+    }
+    array->slots[hole].handle.store(nullptr, std::memory_order_release);
+    --elems_;
+    return removed;
   }
 
-  static bool equal(const CacheKey& a, const CacheKey& b) {
-    return a.hash_value == b.hash_value && a.key == b.key;
+  void Clear() {
+    Array* array = array_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < array->size(); ++i) {
+      array->slots[i].handle.store(nullptr, std::memory_order_release);
+    }
+    elems_ = 0;
   }
 
-  static size_t hash(const CacheKey& a) {
-    return static_cast<size_t>(a.hash_value);
+ private:
+  struct Slot {
+    std::atomic<uint32_t> hash{0};
+    std::atomic<CacheHandle*> handle{nullptr};
+  };
+  struct Array {
+    explicit Array(size_t size) : mask(size - 1), slots(new Slot[size]) {}
+    size_t size() const { return mask + 1; }
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  // Returns the slot of the key, or the empty slot ending its probe
+  // sequence.
+  static size_t FindSlot(Array* array, const Slice& key, uint32_t hash) {
+    for (size_t i = hash & array->mask;; i = (i + 1) & array->mask) {
+      const Slot& slot = array->slots[i];
+      CacheHandle* handle = slot.handle.load(std::memory_order_relaxed);
+      if (handle == nullptr ||
+          (slot.hash.load(std::memory_order_relaxed) == hash &&
+           handle->key == key)) {
+        return i;
+      }
+    }
   }
+
+  void Grow() {
+    Array* old_array = array_.load(std::memory_order_relaxed);
+    size_t size = old_array == nullptr ? 16 : old_array->size() * 2;
+    arrays_.emplace_back(new Array(size));
+    Array* array = arrays_.back().get();
+    if (old_array != nullptr) {
+      for (size_t i = 0; i < old_array->size(); ++i) {
+        CacheHandle* handle =
+            old_array->slots[i].handle.load(std::memory_order_relaxed);
+        if (handle != nullptr) {
+          Slot& slot = array->slots[FindSlot(array, handle->key,
+                                             handle->hash)];
+          slot.hash.store(handle->hash, std::memory_order_relaxed);
+          slot.handle.store(handle, std::memory_order_relaxed);
+        }
+      }
+    }
+    array_.store(array, std::memory_order_release);
+  }
+
+  std::atomic<Array*> array_;
+  // All the slot arrays, the last one is array_
+  std::vector<std::unique_ptr<Array>> arrays_;
+  size_t elems_;
 };
 
 struct CleanupContext {
@@ -239,9 +334,6 @@ struct CleanupContext {
 // A cache shard which maintains its own CLOCK cache.
 class ClockCacheShard : public CacheShard {
  public:
-  // Hash map type.
-  typedef tbb::concurrent_hash_map<CacheKey, CacheHandle*, CacheKey> HashTable;
-
   ClockCacheShard();
   ~ClockCacheShard();
 
@@ -359,8 +451,8 @@ class ClockCacheShard : public CacheShard {
   // Whether allow insert into cache if cache is full.
   std::atomic<bool> strict_capacity_limit_;
 
-  // Hash table (tbb::concurrent_hash_map) for lookup.
-  HashTable table_;
+  // Hash table for lookup.
+  HandleTable table_;
 };
 
 ClockCacheShard::ClockCacheShard()
@@ -453,6 +545,9 @@ bool ClockCacheShard::Unref(CacheHandle* handle, bool set_usage,
   if (set_usage) {
     handle->flags.fetch_or(kUsageBit, std::memory_order_relaxed);
   }
+  // The handle can be evicted and reused once the reference is dropped, so
+  // read the charge before that.
+  size_t charge = handle->charge;
   // Use acquire-release semantics as previous operations on the cache entry
   // has to be order before reference count is decreased, and potential cleanup
   // of the entry has to be order after.
@@ -460,7 +555,7 @@ bool ClockCacheShard::Unref(CacheHandle* handle, bool set_usage,
   assert(CountRefs(flags) > 0);
   if (CountRefs(flags) == 1) {
     // this is the last reference.
-    pinned_usage_.fetch_sub(handle->charge, std::memory_order_relaxed);
+    pinned_usage_.fetch_sub(charge, std::memory_order_relaxed);
     // Cleanup if it is the last reference.
     if (!InCache(flags)) {
       MutexLock l(&mutex_);
@@ -490,9 +585,9 @@ bool ClockCacheShard::TryEvict(CacheHandle* handle, CleanupContext* context) {
   uint32_t flags = kInCacheBit;
   if (handle->flags.compare_exchange_strong(flags, 0, std::memory_order_acquire,
                                             std::memory_order_relaxed)) {
-    bool erased __attribute__((__unused__)) =
-        table_.erase(CacheKey(handle->key, handle->hash));
-    assert(erased);
+    CacheHandle* erased __attribute__((__unused__)) =
+        table_.Remove(handle->key, handle->hash);
+    assert(erased == handle);
     RecycleHandle(handle, context);
     return true;
   }
@@ -572,14 +667,13 @@ CacheHandle* ClockCacheShard::Insert(
   handle->charge = charge;
   handle->deleter = deleter;
   uint32_t flags = hold_reference ? kInCacheBit + kOneRef : kInCacheBit;
-  handle->flags.store(flags, std::memory_order_relaxed);
-  HashTable::accessor accessor;
-  if (table_.find(accessor, CacheKey(key, hash))) {
-    CacheHandle* existing_handle = accessor->second;
-    table_.erase(accessor);
+  // Use release semantics, so a lookup which still holds the handle from its
+  // previous use sees the new fields once it is able to hold reference.
+  handle->flags.store(flags, std::memory_order_release);
+  CacheHandle* existing_handle = table_.Insert(handle);
+  if (existing_handle != nullptr) {
     UnsetInCache(existing_handle, context);
   }
-  table_.insert(HashTable::value_type(CacheKey(key, hash), handle));
   if (hold_reference) {
     pinned_usage_.fetch_add(charge, std::memory_order_relaxed);
   }
@@ -593,7 +687,6 @@ Status ClockCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
                                Cache::Handle** out_handle,
                                Cache::Priority /*priority*/) {
   CleanupContext context;
-  HashTable::accessor accessor;
   char* key_data = new char[key.size()];
   memcpy(key_data, key.data(), key.size());
   Slice key_copy(key_data, key.size());
@@ -612,27 +705,24 @@ Status ClockCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
 }
 
 Cache::Handle* ClockCacheShard::Lookup(const Slice& key, uint32_t hash) {
-  HashTable::const_accessor accessor;
-  if (!table_.find(accessor, CacheKey(key, hash))) {
-    return nullptr;
-  }
-  CacheHandle* handle = accessor->second;
-  accessor.release();
-  // Ref() could fail if another thread sneak in and evict/erase the cache
-  // entry before we are able to hold reference.
-  if (!Ref(reinterpret_cast<Cache::Handle*>(handle))) {
-    return nullptr;
-  }
-  // Double check the key since the handle may now representing another key
-  // if other threads sneak in, evict/erase the entry and re-used the handle
-  // for another cache entry.
-  if (hash != handle->hash || key != handle->key) {
-    CleanupContext context;
-    Unref(handle, false, &context);
-    // It is possible Unref() delete the entry, so we need to cleanup.
-    Cleanup(context);
-    return nullptr;
-  }
+  CacheHandle* handle = table_.Lookup(hash, [&](CacheHandle* candidate) {
+    // Ref() could fail if another thread sneak in and evict/erase the cache
+    // entry before we are able to hold reference.
+    if (!Ref(reinterpret_cast<Cache::Handle*>(candidate))) {
+      return false;
+    }
+    // Double check the key since the handle may now representing another key
+    // if other threads sneak in, evict/erase the entry and re-used the handle
+    // for another cache entry.
+    if (hash != candidate->hash || key != candidate->key) {
+      CleanupContext context;
+      Unref(candidate, false, &context);
+      // It is possible Unref() delete the entry, so we need to cleanup.
+      Cleanup(context);
+      return false;
+    }
+    return true;
+  });
   return reinterpret_cast<Cache::Handle*>(handle);
 }
 
@@ -656,11 +746,9 @@ void ClockCacheShard::Erase(const Slice& key, uint32_t hash) {
 bool ClockCacheShard::EraseAndConfirm(const Slice& key, uint32_t hash,
                                       CleanupContext* context) {
   MutexLock l(&mutex_);
-  HashTable::accessor accessor;
   bool erased = false;
-  if (table_.find(accessor, CacheKey(key, hash))) {
-    CacheHandle* handle = accessor->second;
-    table_.erase(accessor);
+  CacheHandle* handle = table_.Remove(key, hash);
+  if (handle != nullptr) {
     erased = UnsetInCache(handle, context);
   }
   return erased;
@@ -670,7 +758,7 @@ void ClockCacheShard::EraseUnRefEntries() {
   CleanupContext context;
   {
     MutexLock l(&mutex_);
-    table_.clear();
+    table_.Clear();
     for (auto& handle : list_) {
       UnsetInCache(&handle, &context);
     }
@@ -730,5 +818,3 @@ std::shared_ptr<Cache> NewClockCache(size_t capacity, int num_shard_bits,
 }
 
 }  // namespace TERARKDB_NAMESPACE
-
-#endif  // SUPPORT_CLOCK_CACHE
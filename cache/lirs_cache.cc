@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <string>
 
 #include "rocksdb/terark_namespace.h"
@@ -86,12 +87,22 @@ void LIRSHandleTable::Resize() {
   length_ = new_length;
 }
 
+namespace {
+// Bounds of the adaptive irr_ratio
+const double kMinIrrRatio = 0.1;
+const double kMaxIrrRatio = 0.99;
+}  // namespace
+
 LIRSCacheShard::LIRSCacheShard(size_t capacity, bool strict_capacity_limit,
-                               double irr_ratio)
+                               double irr_ratio, bool adaptive_irr_ratio)
     : capacity_(capacity),
+      stack_capacity_(0),
       usage_(0),
       stack_usage_(0),
       irr_ratio_(irr_ratio),
+      adaptive_irr_ratio_(adaptive_irr_ratio),
+      ghost_usage_(0),
+      next_ghost_id_(0),
       strict_capacity_limit_(strict_capacity_limit) {
   cache_.next_stack = cache_.prev_stack = cache_.next_queue =
       cache_.prev_queue = &cache_;
@@ -123,19 +134,6 @@ void LIRSCacheShard::AdjustToQueueTail(LIRSHandle* h) {
   h->prev_queue = &cache_;
 }
 
-void LIRSCacheShard::ShiftQueueHead() {
-  if (cache_.prev_queue == &cache_) {
-    return;
-  }
-  auto head = cache_.prev_queue;
-  RemoveFromQueue(head);
-  if (head->next_stack != nullptr) {
-    head->SetNHIR();
-  } else {
-    LIRS_Remove(head);
-  }
-}
-
 void LIRSCacheShard::PushToStack(LIRSHandle* h) {
   cache_.next_stack->prev_stack = h;
   h->next_stack = cache_.next_stack;
@@ -159,46 +157,116 @@ void LIRSCacheShard::AdjustToStackTop(LIRSHandle* h) {
   h->prev_stack = &cache_;
 }
 
-void LIRSCacheShard::AdjustStackBottom() {
+void LIRSCacheShard::DemoteStackBottom() {
   if (cache_.prev_stack == &cache_) {
     return;
   }
   auto bottom = cache_.prev_stack;
-  if (bottom->LIR()) {
-    bottom->SetHIR();
-    if (bottom->next_queue != nullptr) {
-      RemoveFromQueue(bottom);
-    }
-    PushToQueue(bottom);
-  }
+  assert(bottom->LIR());
+  bottom->SetHIR();
+  RemoveFromStack(bottom);
+  stack_usage_ -= bottom->charge;
+  PushToQueue(bottom);
+  StackPruning();
 }
 
 void LIRSCacheShard::StackPruning() {
+  // The HIR entries below the bottom LIR entry are still in the queue
   while (cache_.prev_stack != &cache_ && !cache_.prev_stack->LIR()) {
-    auto bottom = cache_.prev_stack;
-    RemoveFromStack(bottom);
-    PushToQueue(bottom);
+    assert(cache_.prev_stack->next_queue != nullptr);
+    RemoveFromStack(cache_.prev_stack);
+  }
+}
+
+void LIRSCacheShard::AddGhost(LIRSHandle* h) {
+  uint64_t id = next_ghost_id_++;
+  ghost_ids_[h->hash] = id;
+  ghost_queue_.push_back({h->hash, id, h->charge});
+  ghost_usage_ += h->charge;
+  while (ghost_usage_ > capacity_ && !ghost_queue_.empty()) {
+    const Ghost& ghost = ghost_queue_.front();
+    auto iter = ghost_ids_.find(ghost.hash);
+    if (iter != ghost_ids_.end() && iter->second == ghost.id) {
+      ghost_ids_.erase(iter);
+    }
+    ghost_usage_ -= ghost.charge;
+    ghost_queue_.pop_front();
+  }
+}
+
+bool LIRSCacheShard::HitGhost(uint32_t hash) {
+  // The ghost stays in the queue until it expires, only its hash is
+  // forgotten
+  return ghost_ids_.erase(hash) > 0;
+}
+
+void LIRSCacheShard::AdaptStackCapacity(bool grow, size_t charge) {
+  size_t min_stack_capacity = static_cast<size_t>(capacity_ * kMinIrrRatio);
+  size_t max_stack_capacity = static_cast<size_t>(capacity_ * kMaxIrrRatio);
+  if (grow) {
+    stack_capacity_ = std::min(stack_capacity_ + charge, max_stack_capacity);
+  } else {
+    stack_capacity_ =
+        stack_capacity_ > min_stack_capacity + charge
+            ? stack_capacity_ - charge
+            : min_stack_capacity;
   }
 }
 
 bool LIRSCacheShard::Unref(LIRSHandle* h) {
-  assert(h->refs > 0);
-  h->refs--;
-  return h->refs == 0;
+  uint32_t refs = h->refs.fetch_sub(1, std::memory_order_acq_rel);
+  assert(refs > 0);
+  return refs == 1;
+}
+
+void LIRSCacheShard::RecordAccess(LIRSHandle* h) {
+  auto buffer = access_buffers_.Access();
+  uint32_t i = buffer->next.fetch_add(1, std::memory_order_relaxed);
+  buffer->handles[i % kAccessBufferSize].store(h, std::memory_order_relaxed);
+}
+
+void LIRSCacheShard::DrainAccessBuffers() {
+  for (size_t core = 0; core < access_buffers_.Size(); ++core) {
+    auto buffer = access_buffers_.AccessAtCore(core);
+    uint32_t end = buffer->next.load(std::memory_order_relaxed);
+    if (end == 0) {
+      continue;
+    }
+    uint32_t begin = end > kAccessBufferSize ? end - kAccessBufferSize : 0;
+    for (uint32_t i = begin; i != end; ++i) {
+      LIRSHandle* h =
+          buffer->handles[i % kAccessBufferSize].load(std::memory_order_relaxed);
+      assert(h->InCache());
+      LIRS_Access(h);
+    }
+    buffer->next.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool LIRSCacheShard::EraseFromCache(LIRSHandle* h) {
+  assert(h->InCache());
+  table_.Remove(h->key(), h->hash);
+  LIRS_Remove(h);
+  h->SetInvalid();
+  return Unref(h);
 }
 
 void LIRSCacheShard::EraseUnRefEntries() {
   autovector<LIRSHandle*> last_reference_list;
   {
-    MutexLock l(&mutex_);
-    while (cache_.prev_queue != &cache_) {
-      LIRSHandle* old = cache_.prev_queue;
-      LIRS_Remove(old);
-      table_.Remove(old->key(), old->hash);
-      old->SetInvalid();
-      Unref(old);
-      usage_ -= old->charge;
-      last_reference_list.push_back(old);
+    WriteLock l(&mutex_);
+    DrainAccessBuffers();
+    autovector<LIRSHandle*> unref_list;
+    table_.ApplyToAllCacheEntries([&unref_list](LIRSHandle* h) {
+      if (h->refs.load(std::memory_order_relaxed) == 1) {
+        unref_list.push_back(h);
+      }
+    });
+    for (auto old : unref_list) {
+      if (EraseFromCache(old)) {
+        usage_ -= old->charge;
+        last_reference_list.push_back(old);
+      }
     }
   }
 
@@ -210,12 +278,12 @@ void LIRSCacheShard::EraseUnRefEntries() {
 void LIRSCacheShard::ApplyToAllCacheEntries(void (*callback)(void*, size_t),
                                             bool thread_safe) {
   if (thread_safe) {
-    mutex_.Lock();
+    mutex_.ReadLock();
   }
   table_.ApplyToAllCacheEntries(
       [callback](LIRSHandle* h) { callback(h->value, h->charge); });
   if (thread_safe) {
-    mutex_.Unlock();
+    mutex_.ReadUnlock();
   }
 }
 
@@ -225,96 +293,112 @@ void LIRSCacheShard::LIRS_Remove(LIRSHandle* e) {
   }
   if (e->next_stack != nullptr) {
     RemoveFromStack(e);
-    stack_usage_ -= e->charge;
+    if (e->LIR()) {
+      stack_usage_ -= e->charge;
+    }
+    StackPruning();
   }
 }
 
-void LIRSCacheShard::LIRS_Insert(LIRSHandle* e) {
-  if (stack_usage_ + e->charge <= stack_capacity_) {
-    PushToStack(e);
+void LIRSCacheShard::LIRS_Insert(LIRSHandle* e, bool lir) {
+  PushToStack(e);
+  if (lir) {
     e->SetLIR();
     stack_usage_ += e->charge;
   } else {
+    // Becomes LIR if it is accessed again before it leaves the stack
     PushToQueue(e);
     e->SetHIR();
+    StackPruning();
+  }
+}
+
+void LIRSCacheShard::LIRS_Access(LIRSHandle* h) {
+  if (adaptive_irr_ratio_ && h->LIR() && cache_.prev_stack == h) {
+    // Even the LIR entry next to be demoted is still hot, the LIR entries
+    // can give some room back to the HIR entries
+    AdaptStackCapacity(false /* grow */, h->charge);
+  }
+  if (h->LIR()) {
+    AdjustToStackTop(h);
+    StackPruning();
+  } else if (h->next_stack != nullptr) {
+    // A HIR entry accessed again while it is still in the stack has a
+    // small inter-reference recency, it becomes LIR
+    RemoveFromQueue(h);
+    h->SetLIR();
+    AdjustToStackTop(h);
+    stack_usage_ += h->charge;
+    while (stack_usage_ > stack_capacity_ && cache_.prev_stack != h) {
+      DemoteStackBottom();
+    }
+  } else {
+    PushToStack(h);
+    AdjustToQueueTail(h);
+    StackPruning();
   }
 }
 
-void LIRSCacheShard::EvictFromLIRS(size_t charge,
+void LIRSCacheShard::EvictFromLIRS(size_t charge, bool lir,
                                    autovector<LIRSHandle*>* deleted) {
-  while (usage_ - stack_usage_ + charge > capacity_ - stack_capacity_ &&
+  // Make room for a new LIR entry, or shrink the LIR entries down to an
+  // adapted stack_capacity_
+  while (stack_usage_ + (lir ? charge : 0) > stack_capacity_ &&
+         cache_.prev_stack != &cache_) {
+    DemoteStackBottom();
+  }
+  const size_t hir_charge = lir ? 0 : charge;
+  while (usage_ - stack_usage_ + hir_charge > capacity_ - stack_capacity_ &&
          cache_.prev_queue != &cache_) {
+    // A referenced entry leaves the cache as well, its last reference frees
+    // it
     LIRSHandle* old = cache_.prev_queue;
-    assert(old->refs == 1);
-    LIRS_Remove(old);
-    table_.Remove(old->key(), old->hash);
-    old->SetInvalid();
-    Unref(old);
-    usage_ -= old->charge;
-    deleted->push_back(old);
-  }
-  while (stack_usage_ + charge > stack_capacity_ &&
-         cache_.prev_stack != &cache_) {
-    LIRSHandle* old = cache_.prev_stack;
-    stack_usage_ -= old->charge;
-    RemoveFromStack(old);
-    PushToQueue(old);
+    if (adaptive_irr_ratio_) {
+      AddGhost(old);
+    }
+    if (EraseFromCache(old)) {
+      usage_ -= old->charge;
+      deleted->push_back(old);
+    }
+  }
+}
+
+void LIRSCacheShard::FreeEvicted(const autovector<LIRSHandle*>& evicted) {
+  for (auto entry : evicted) {
+    if (secondary_cache_ != nullptr) {
+      secondary_cache_->Demote(entry->key(), entry->value, entry->charge,
+                               entry->deleter);
+    }
+    entry->Free();
   }
 }
 
 void LIRSCacheShard::SetCapacity(size_t capacity) {
-  MutexLock l(&mutex_);
+  WriteLock l(&mutex_);
+  if (adaptive_irr_ratio_ && capacity_ > 0 && stack_capacity_ > 0) {
+    // Keep the ratio the shard has adapted to
+    stack_capacity_ = static_cast<size_t>(
+        capacity * (static_cast<double>(stack_capacity_) / capacity_));
+  } else {
+    stack_capacity_ = capacity * irr_ratio_;
+  }
   capacity_ = capacity;
-  stack_capacity_ = capacity_ * irr_ratio_;
 }
 
 Cache::Handle* LIRSCacheShard::Lookup(const Slice& key, uint32_t hash) {
-  MutexLock l(&mutex_);
+  ReadLock l(&mutex_);
   LIRSHandle* h = table_.Lookup(key, hash);
   if (h != nullptr) {
-    if (!h->Remote()) {
-      if (h->refs == 1) {
-        LIRS_Remove(h);
-      } else {
-        if (h->LIR()) {
-          AdjustToStackTop(h);
-        } else if (h->HIR()) {
-          if (h->next_stack != nullptr) {
-            h->SetLIR();
-            AdjustToStackTop(h);
-            RemoveFromQueue(h);
-            AdjustStackBottom();
-          } else {
-            PushToStack(h);
-            AdjustToQueueTail(h);
-          }
-        } else {
-          ShiftQueueHead();
-          if (h->next_stack != nullptr) {
-            h->SetLIR();
-            AdjustToStackTop(h);
-            AdjustStackBottom();
-          } else {
-            h->SetHIR();
-            PushToStack(h);
-            PushToQueue(h);
-          }
-        }
-        StackPruning();
-      }
-    }
-    h->refs++;
+    h->refs.fetch_add(1, std::memory_order_relaxed);
+    RecordAccess(h);
   }
   return reinterpret_cast<Cache::Handle*>(h);
 }
 
 bool LIRSCacheShard::Ref(Cache::Handle* h) {
   LIRSHandle* handle = reinterpret_cast<LIRSHandle*>(h);
-  MutexLock l(&mutex_);
-  if (handle->InCache() && handle->refs == 1) {
-    LIRS_Remove(handle);
-  }
-  handle->refs++;
+  // The caller already holds a reference, the handle can't go away
+  handle->refs.fetch_add(1, std::memory_order_relaxed);
   return true;
 }
 
@@ -323,29 +407,22 @@ bool LIRSCacheShard::Release(Cache::Handle* handle, bool force_erase) {
     return false;
   }
   LIRSHandle* e = reinterpret_cast<LIRSHandle*>(handle);
-  bool last_reference = false;
-  {
-    MutexLock l(&mutex_);
-    last_reference = Unref(e);
-    if (last_reference) {
-      usage_ -= e->charge;
-    }
-    if (e->refs == 1 && e->InCache()) {
-      // The item is still in cache, and nobody else holds a reference to it
-      if (usage_ > capacity_ || force_erase) {
-        // the cache is full
-        // take this opportunity and remove the item
-        table_.Remove(e->key(), e->hash);
-        e->SetInvalid();
-        Unref(e);
-        usage_ -= e->charge;
-        last_reference = true;
-      }
+  if (force_erase) {
+    WriteLock l(&mutex_);
+    DrainAccessBuffers();
+    if (e->InCache() && e->refs.load(std::memory_order_relaxed) == 2) {
+      // Nobody else holds a reference to it, take it out of the cache
+      bool last_reference = EraseFromCache(e);
+      assert(!last_reference);
+      (void)last_reference;
     }
   }
 
-  // free outside of mutex
+  // Entries in the cache are only freed by the writers holding the mutex,
+  // the last reference of an erased entry frees it without the mutex
+  bool last_reference = Unref(e);
   if (last_reference) {
+    usage_ -= e->charge;
     e->Free();
   }
   return last_reference;
@@ -365,16 +442,28 @@ Status LIRSCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
   e->charge = charge;
   e->key_length = key.size();
   e->hash = hash;
-  e->refs = (handle == nullptr ? 1 : 2);
+  e->refs.store(handle == nullptr ? 1 : 2, std::memory_order_relaxed);
   e->next_stack = e->prev_stack = e->next_queue = e->prev_queue = nullptr;
+  e->SetInvalid();
   memcpy(e->key_data, key.data(), key.size());
 
+  autovector<LIRSHandle*> evicted;
   autovector<LIRSHandle*> last_reference_list;
   {
-    MutexLock l(&mutex_);
-    EvictFromLIRS(charge, &last_reference_list);
+    WriteLock l(&mutex_);
+    DrainAccessBuffers();
+    bool lir = stack_usage_ + charge <= stack_capacity_;
+    if (adaptive_irr_ratio_ && HitGhost(hash)) {
+      // A HIR entry evicted not long ago is needed again. Like a
+      // non-resident HIR entry found in the stack, it has a small
+      // inter-reference recency, comes back as LIR and asks for more room
+      // for the LIR entries
+      AdaptStackCapacity(true /* grow */, charge);
+      lir = true;
+    }
+    EvictFromLIRS(charge, lir, &evicted);
     if (usage_ + charge > capacity_ && strict_capacity_limit_) {
-      e->refs = 0;
+      e->refs.store(0, std::memory_order_relaxed);
       last_reference_list.push_back(e);
       if (handle != nullptr) {
         *handle = nullptr;
@@ -384,22 +473,22 @@ Status LIRSCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
       LIRSHandle* old = table_.Insert(e);
       usage_ += e->charge;
       if (old != nullptr) {
+        LIRS_Remove(old);
         old->SetInvalid();
         if (Unref(old)) {
           usage_ -= old->charge;
-          LIRS_Remove(old);
+          last_reference_list.push_back(old);
         }
       }
-      if (handle == nullptr) {
-        LIRS_Insert(e);
-      } else {
-        e->SetRemote();
+      LIRS_Insert(e, lir);
+      if (handle != nullptr) {
         *handle = reinterpret_cast<Cache::Handle*>(e);
       }
       s = Status::OK();
     }
   }
 
+  FreeEvicted(evicted);
   for (auto entry : last_reference_list) {
     entry->Free();
   }
@@ -411,17 +500,14 @@ void LIRSCacheShard::Erase(const Slice& key, uint32_t hash) {
   LIRSHandle* e;
   bool last_reference = false;
   {
-    MutexLock l(&mutex_);
-    e = table_.Remove(key, hash);
+    WriteLock l(&mutex_);
+    DrainAccessBuffers();
+    e = table_.Lookup(key, hash);
     if (e != nullptr) {
-      last_reference = Unref(e);
+      last_reference = EraseFromCache(e);
       if (last_reference) {
         usage_ -= e->charge;
       }
-      if (last_reference && e->InCache()) {
-        LIRS_Remove(e);
-      }
-      e->SetInvalid();
     }
   }
 
@@ -432,35 +518,45 @@ void LIRSCacheShard::Erase(const Slice& key, uint32_t hash) {
   }
 }
 
-size_t LIRSCacheShard::GetUsage() const {
-  MutexLock l(&mutex_);
-  return usage_;
-}
+size_t LIRSCacheShard::GetUsage() const { return usage_; }
 
 size_t LIRSCacheShard::GetPinnedUsage() const {
-  MutexLock l(&mutex_);
-  assert(usage_ >= stack_usage_);
-  return usage_ - stack_usage_;
+  ReadLock l(&mutex_);
+  // Walks the table instead of maintaining a counter, so that releasing a
+  // handle stays lock free
+  size_t unpinned_usage = 0;
+  table_.ApplyToAllCacheEntries([&unpinned_usage](LIRSHandle* h) {
+    if (h->refs.load(std::memory_order_relaxed) == 1) {
+      unpinned_usage += h->charge;
+    }
+  });
+  size_t usage = usage_;
+  assert(usage >= unpinned_usage);
+  return usage - unpinned_usage;
 }
 
 std::string LIRSCacheShard::GetPrintableOptions() const {
   const int kBufferSize = 200;
   char buffer[kBufferSize];
   {
-    MutexLock l(&mutex_);
-    snprintf(buffer, kBufferSize, "    irr_ratio : %.3lf\n", irr_ratio_);
+    ReadLock l(&mutex_);
+    snprintf(buffer, kBufferSize,
+             "    irr_ratio : %.3lf\n"
+             "    adaptive_irr_ratio : %d\n",
+             irr_ratio_, adaptive_irr_ratio_);
   }
   return std::string(buffer);
 }
 
 void LIRSCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
-  MutexLock l(&mutex_);
+  WriteLock l(&mutex_);
   strict_capacity_limit_ = strict_capacity_limit;
 }
 
 LIRSCache::LIRSCache(size_t capacity, int num_shard_bits,
                      bool strict_capacity_limit, double irr_ratio,
-                     std::shared_ptr<MemoryAllocator> memory_allocator)
+                     std::shared_ptr<MemoryAllocator> memory_allocator,
+                     bool adaptive_irr_ratio)
     : ShardedCache(capacity, num_shard_bits, strict_capacity_limit,
                    std::move(memory_allocator)) {
   num_shards_ = 1 << num_shard_bits;
@@ -469,7 +565,8 @@ LIRSCache::LIRSCache(size_t capacity, int num_shard_bits,
   size_t size_per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
   for (int i = 0; i < num_shards_; i++) {
     new (&shards_[i])
-        LIRSCacheShard(size_per_shard, strict_capacity_limit, irr_ratio);
+        LIRSCacheShard(size_per_shard, strict_capacity_limit, irr_ratio,
+                       adaptive_irr_ratio);
   }
 }
 
@@ -519,14 +616,21 @@ void LIRSCache::DisownData() {
 }
 
 std::shared_ptr<Cache> NewLIRSCache(const LIRSCacheOptions& cache_opts) {
-  return NewLIRSCache(cache_opts.capacity, cache_opts.num_shard_bits,
-                      cache_opts.strict_capacity_limit, cache_opts.irr_ratio,
-                      cache_opts.memory_allocator);
+  auto cache = NewLIRSCache(cache_opts.capacity, cache_opts.num_shard_bits,
+                            cache_opts.strict_capacity_limit,
+                            cache_opts.irr_ratio, cache_opts.memory_allocator,
+                            cache_opts.adaptive_irr_ratio);
+  if (cache != nullptr && cache_opts.secondary_cache != nullptr) {
+    static_cast<ShardedCache*>(cache.get())
+        ->SetSecondaryCache(cache_opts.secondary_cache);
+  }
+  return cache;
 }
 
 std::shared_ptr<Cache> NewLIRSCache(
     size_t capacity, int num_shard_bits, bool strict_capacity_limit,
-    double irr_ratio, std::shared_ptr<MemoryAllocator> memory_allocator) {
+    double irr_ratio, std::shared_ptr<MemoryAllocator> memory_allocator,
+    bool adaptive_irr_ratio) {
   if (num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
@@ -539,7 +643,8 @@ std::shared_ptr<Cache> NewLIRSCache(
   }
   return std::make_shared<LIRSCache>(capacity, num_shard_bits,
                                      strict_capacity_limit, irr_ratio,
-                                     std::move(memory_allocator));
+                                     std::move(memory_allocator),
+                                     adaptive_irr_ratio);
 }
 
 }  // namespace TERARKDB_NAMESPACE
\ No newline at end of file
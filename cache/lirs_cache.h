@@ -1,14 +1,29 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <string>
+#include <unordered_map>
 
 #include "cache/sharded_cache.h"
 #include "port/port.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/autovector.h"
+#include "util/core_local.h"
 
 namespace TERARKDB_NAMESPACE {
 
+// An entry of a LIRSCacheShard is in the hash table and in the LIRS stack
+// and/or queue as long as it is in the cache, whether or not it is
+// referenced by users. The cache itself holds one reference of it. Once it is
+// erased it leaves the table and the LIRS structures, and its last reference
+// frees it.
+//
+// Lookup() only takes the shard mutex in shared mode: it bumps `refs` and
+// records the access in a per-core access buffer. The buffered accesses are
+// replayed on the LIRS structures by the next writer before it changes
+// anything else, so a buffered handle is always still in the cache. Accesses
+// that overflow a buffer overwrite the oldest ones of it.
 struct LIRSHandle {
   void* value;
   void (*deleter)(const Slice&, void* value);
@@ -19,26 +34,24 @@ struct LIRSHandle {
   LIRSHandle* prev_queue;
   size_t charge;
   size_t key_length;
-  uint32_t refs;
+  std::atomic<uint32_t> refs;
   uint32_t hash;  // Hash of key(); used for fast sharding and comparisons
 
-  enum State { kRemote = 0, kLIR, kHIR, kNHIR, kInvalid } state;
+  // kLIR: in the stack and not in the queue, counted in the stack usage.
+  // kHIR: in the queue, and in the stack if it was accessed recently.
+  // kInvalid: not in the cache any more.
+  enum State { kLIR = 0, kHIR, kInvalid } state;
 
   char key_data[1];  // Beginning of key
 
   Slice key() const { return Slice(key_data, key_length); }
 
-  bool Remote() { return state == kRemote; }
   bool LIR() { return state == kLIR; }
   bool HIR() { return state == kHIR; }
-  bool InCache() { return state == kLIR || state == kHIR || state == kNHIR; }
-  bool NHIR() { return state == kNHIR; }
-  bool Valid() { return state != kInvalid; }
+  bool InCache() { return state != kInvalid; }
 
-  void SetRemote() { state = kRemote; }
   void SetLIR() { state = kLIR; }
   void SetHIR() { state = kHIR; }
-  void SetNHIR() { state = kNHIR; }
   void SetInvalid() { state = kInvalid; }
 
   void Free() {
@@ -60,7 +73,7 @@ class LIRSHandleTable {
   LIRSHandle* Remove(const Slice& key, uint32_t hash);
 
   template <typename T>
-  void ApplyToAllCacheEntries(T func) {
+  void ApplyToAllCacheEntries(T func) const {
     for (uint32_t i = 0; i < length_; i++) {
       LIRSHandle* h = list_[i];
       while (h != nullptr) {
@@ -90,7 +103,7 @@ class LIRSHandleTable {
 class ALIGN_AS(CACHE_LINE_SIZE) LIRSCacheShard : public CacheShard {
  public:
   LIRSCacheShard(size_t capacity, bool strict_capacity_limit,
-                 double irr_ratio = 0.9);
+                 double irr_ratio = 0.9, bool adaptive_irr_ratio = false);
   virtual ~LIRSCacheShard();
 
   virtual void SetCapacity(size_t capacity) override;
@@ -122,33 +135,75 @@ class ALIGN_AS(CACHE_LINE_SIZE) LIRSCacheShard : public CacheShard {
   void PushToQueue(LIRSHandle* h);
   void RemoveFromQueue(LIRSHandle* h);
   void AdjustToQueueTail(LIRSHandle* h);
-  void ShiftQueueHead();
   void PushToStack(LIRSHandle* h);
   void RemoveFromStack(LIRSHandle* h);
   void AdjustToStackTop(LIRSHandle* h);
-  void AdjustStackBottom();
+  void DemoteStackBottom();
   void StackPruning();
   void LIRS_Remove(LIRSHandle* h);
-  void LIRS_Insert(LIRSHandle* h);
+  void LIRS_Insert(LIRSHandle* h, bool lir);
+  void LIRS_Access(LIRSHandle* h);
+  // Remove a cached entry from the table and the LIRS structures and drop
+  // the reference of the cache. Returns true if that was its last reference.
+  bool EraseFromCache(LIRSHandle* h);
   bool Unref(LIRSHandle* h);
-  void EvictFromLIRS(size_t charge, autovector<LIRSHandle*>* deleted);
+  void EvictFromLIRS(size_t charge, bool lir,
+                     autovector<LIRSHandle*>* deleted);
+  // Demote the entries evicted by EvictFromLIRS() into the secondary cache,
+  // if any, and free them. Called without holding the mutex_
+  void FreeEvicted(const autovector<LIRSHandle*>& evicted);
+
+  // With adaptive_irr_ratio_, remember the hashes of the HIR entries evicted
+  // from the queue up to a total charge of capacity_
+  void AddGhost(LIRSHandle* h);
+  bool HitGhost(uint32_t hash);
+  // Move the LIR/HIR boundary by `charge`
+  void AdaptStackCapacity(bool grow, size_t charge);
+
+  // Lock free, requires mutex_ held in shared mode
+  void RecordAccess(LIRSHandle* h);
+  // Replay the buffered accesses, requires mutex_ held exclusively
+  void DrainAccessBuffers();
+
+  static const uint32_t kAccessBufferSize = 16;
+  struct ALIGN_AS(CACHE_LINE_SIZE) AccessBuffer {
+    std::atomic<uint32_t> next{0};
+    std::atomic<LIRSHandle*> handles[kAccessBufferSize];
+  };
 
   size_t capacity_;
   size_t stack_capacity_;
-  size_t usage_;
+  // Includes the entries erased from the cache but still referenced, which
+  // can be freed without holding mutex_
+  std::atomic<size_t> usage_;
   size_t stack_usage_;
   double irr_ratio_;
+  bool adaptive_irr_ratio_;
+  struct Ghost {
+    uint32_t hash;
+    uint64_t id;
+    size_t charge;
+  };
+  // The newest ghost of every hash, ghosts leave the queue in FIFO order
+  std::unordered_map<uint32_t, uint64_t> ghost_ids_;
+  std::deque<Ghost> ghost_queue_;
+  size_t ghost_usage_;
+  uint64_t next_ghost_id_;
   LIRSHandle cache_;
   LIRSHandleTable table_;
   bool strict_capacity_limit_;
-  mutable port::Mutex mutex_;
+  CoreLocalArray<AccessBuffer> access_buffers_;
+  // Held in shared mode by Lookup() and exclusively by everything that
+  // changes the table or the LIRS structures
+  mutable port::RWMutex mutex_;
 };
 
 class LIRSCache : public ShardedCache {
  public:
   LIRSCache(size_t capacity, int num_shard_bits, bool strict_capacity_limit,
             double irr_ratio,
-            std::shared_ptr<MemoryAllocator> memory_allocator = nullptr);
+            std::shared_ptr<MemoryAllocator> memory_allocator = nullptr,
+            bool adaptive_irr_ratio = false);
   virtual ~LIRSCache();
   virtual const char* Name() const override { return "LIRSCache"; }
   virtual CacheShard* GetShard(int shard) override;
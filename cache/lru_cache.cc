@@ -259,20 +259,30 @@ void LRUCacheShardTemplate<CacheMonitor>::EvictFromLRU(
   }
 }
 
+template <class CacheMonitor>
+void LRUCacheShardTemplate<CacheMonitor>::FreeEvicted(
+    const autovector<LRUHandle*>& evicted) {
+  for (auto entry : evicted) {
+    if (secondary_cache_ != nullptr) {
+      secondary_cache_->Demote(entry->key(), entry->value, entry->charge,
+                               entry->deleter);
+    }
+    entry->Free();
+  }
+}
+
 template <class CacheMonitor>
 void LRUCacheShardTemplate<CacheMonitor>::SetCapacity(size_t capacity) {
-  autovector<LRUHandle*> last_reference_list;
+  autovector<LRUHandle*> evicted;
   {
     MutexLock l(&mutex_);
     capacity_ = capacity;
     high_pri_pool_capacity_ = capacity_ * high_pri_pool_ratio_;
-    EvictFromLRU(0, &last_reference_list);
+    EvictFromLRU(0, &evicted);
   }
   // we free the entries here outside of mutex for
   // performance reasons
-  for (auto entry : last_reference_list) {
-    entry->Free();
-  }
+  FreeEvicted(evicted);
 }
 
 template <class CacheMonitor>
@@ -326,6 +336,7 @@ bool LRUCacheShardTemplate<CacheMonitor>::Release(Cache::Handle* handle,
   }
   LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
   bool last_reference = false;
+  bool evicted = false;
   {
     MutexLock l(&mutex_);
     last_reference = Unref(e);
@@ -344,6 +355,7 @@ bool LRUCacheShardTemplate<CacheMonitor>::Release(Cache::Handle* handle,
         Unref(e);
         UsageSub(e);
         last_reference = true;
+        evicted = !force_erase;
       } else {
         // put the item on the list to be potentially freed
         LRU_Insert(e);
@@ -352,7 +364,9 @@ bool LRUCacheShardTemplate<CacheMonitor>::Release(Cache::Handle* handle,
   }
 
   // free outside of mutex
-  if (last_reference) {
+  if (evicted) {
+    FreeEvicted({e});
+  } else if (last_reference) {
     e->Free();
   }
   return last_reference;
@@ -369,6 +383,7 @@ Status LRUCacheShardTemplate<CacheMonitor>::Insert(
   LRUHandle* e = reinterpret_cast<LRUHandle*>(
       new char[sizeof(LRUHandle) - 1 + key.size()]);
   Status s;
+  autovector<LRUHandle*> evicted;
   autovector<LRUHandle*> last_reference_list;
 
   e->value = value;
@@ -390,7 +405,7 @@ Status LRUCacheShardTemplate<CacheMonitor>::Insert(
 
     // Free the space following strict LRU policy until enough space
     // is freed or the lru list is empty
-    EvictFromLRU(charge, &last_reference_list);
+    EvictFromLRU(charge, &evicted);
 
     if (usage_ - lru_usage_ + charge > capacity_ &&
         (strict_capacity_limit_ || handle == nullptr)) {
@@ -430,6 +445,7 @@ Status LRUCacheShardTemplate<CacheMonitor>::Insert(
 
   // we free the entries here outside of mutex for
   // performance reasons
+  FreeEvicted(evicted);
   for (auto entry : last_reference_list) {
     entry->Free();
   }
@@ -617,10 +633,15 @@ size_t LRUCacheBase<LRUCacheShardType>::TEST_GetLRUSize() {
 // double LRUCacheBase<LRUCacheShardType>::GetHighPriPoolRatio()
 
 std::shared_ptr<Cache> NewLRUCache(const LRUCacheOptions& cache_opts) {
-  return NewLRUCache(cache_opts.capacity, cache_opts.num_shard_bits,
-                     cache_opts.strict_capacity_limit,
-                     cache_opts.high_pri_pool_ratio,
-                     cache_opts.memory_allocator);
+  auto cache = NewLRUCache(cache_opts.capacity, cache_opts.num_shard_bits,
+                           cache_opts.strict_capacity_limit,
+                           cache_opts.high_pri_pool_ratio,
+                           cache_opts.memory_allocator);
+  if (cache != nullptr && cache_opts.secondary_cache != nullptr) {
+    static_cast<ShardedCache*>(cache.get())
+        ->SetSecondaryCache(cache_opts.secondary_cache);
+  }
+  return cache;
 }
 
 std::shared_ptr<Cache> NewLRUCache(
@@ -646,10 +667,15 @@ std::shared_ptr<Cache> NewLRUCache(
 std::shared_ptr<Cache> NewDiagnosableLRUCache(
     const LRUCacheOptions& cache_opts) {
   assert(cache_opts.is_diagnose);
-  return NewDiagnosableLRUCache(cache_opts.capacity, cache_opts.num_shard_bits,
-                                cache_opts.strict_capacity_limit,
-                                cache_opts.high_pri_pool_ratio,
-                                cache_opts.memory_allocator, cache_opts.topk);
+  auto cache = NewDiagnosableLRUCache(
+      cache_opts.capacity, cache_opts.num_shard_bits,
+      cache_opts.strict_capacity_limit, cache_opts.high_pri_pool_ratio,
+      cache_opts.memory_allocator, cache_opts.topk);
+  if (cache != nullptr && cache_opts.secondary_cache != nullptr) {
+    static_cast<ShardedCache*>(cache.get())
+        ->SetSecondaryCache(cache_opts.secondary_cache);
+  }
+  return cache;
 }
 
 std::shared_ptr<Cache> NewDiagnosableLRUCache(
@@ -677,10 +703,7 @@ template class LRUCacheBase<LRUCacheDiagnosableShard>;
 #else
 std::shared_ptr<Cache> NewDiagnosableLRUCache(
     const LRUCacheOptions& cache_opts) {
-  return NewLRUCache(cache_opts.capacity, cache_opts.num_shard_bits,
-                     cache_opts.strict_capacity_limit,
-                     cache_opts.high_pri_pool_ratio,
-                     cache_opts.memory_allocator);
+  return NewLRUCache(cache_opts);
 }
 
 std::shared_ptr<Cache> NewDiagnosableLRUCache(
@@ -252,6 +252,10 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShardTemplate : public CacheMonitor,
   // holding the mutex_
   void EvictFromLRU(size_t charge, autovector<LRUHandle*>* deleted);
 
+  // Demote the entries evicted by EvictFromLRU() into the secondary cache, if
+  // any, and free them. Called without holding the mutex_
+  void FreeEvicted(const autovector<LRUHandle*>& evicted);
+
   // Initialized before use.
   size_t capacity_;
 
@@ -129,6 +129,15 @@ void ShardedCache::EraseUnRefEntries() {
   }
 }
 
+void ShardedCache::SetSecondaryCache(
+    std::shared_ptr<SecondaryCache> secondary_cache) {
+  secondary_cache_ = std::move(secondary_cache);
+  int num_shards = 1 << num_shard_bits_;
+  for (int s = 0; s < num_shards; s++) {
+    GetShard(s)->set_secondary_cache(secondary_cache_.get());
+  }
+}
+
 std::string ShardedCache::GetPrintableOptions() const {
   std::string ret;
   ret.reserve(20000);
@@ -148,6 +157,9 @@ std::string ShardedCache::GetPrintableOptions() const {
   snprintf(buffer, kBufferSize, "    memory_allocator : %s\n",
            memory_allocator() ? memory_allocator()->Name() : "None");
   ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    secondary_cache : %s\n",
+           secondary_cache_ ? secondary_cache_->Name() : "None");
+  ret.append(buffer);
   ret.append(GetShard(0)->GetPrintableOptions());
   return ret;
 }
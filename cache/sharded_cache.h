@@ -41,6 +41,14 @@ class CacheShard {
                                       bool thread_safe) = 0;
   virtual void EraseUnRefEntries() = 0;
   virtual std::string GetPrintableOptions() const { return ""; }
+
+  void set_secondary_cache(SecondaryCache* secondary_cache) {
+    secondary_cache_ = secondary_cache;
+  }
+
+ protected:
+  // Where the entries evicted for capacity are demoted, if any
+  SecondaryCache* secondary_cache_ = nullptr;
 };
 
 // Generic cache interface which shards cache by hash of keys. 2^num_shard_bits
@@ -79,6 +87,12 @@ class ShardedCache : public Cache {
                                       bool thread_safe) override;
   virtual void EraseUnRefEntries() override;
   virtual std::string GetPrintableOptions() const override;
+  virtual SecondaryCache* secondary_cache() const override {
+    return secondary_cache_.get();
+  }
+
+  // Call before the cache is used.
+  void SetSecondaryCache(std::shared_ptr<SecondaryCache> secondary_cache);
 
   int GetNumShardBits() const { return num_shard_bits_; }
 
@@ -97,6 +111,7 @@ class ShardedCache : public Cache {
   size_t capacity_;
   bool strict_capacity_limit_;
   std::atomic<uint64_t> last_id_;
+  std::shared_ptr<SecondaryCache> secondary_cache_;
 };
 
 extern int GetDefaultCacheShardBits(size_t capacity);
@@ -0,0 +1,236 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <thread>
+
+#include "monitoring/statistics.h"
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/listener.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+// FileOperationInfo only refers to its path and time stamps
+struct FileOperation {
+  explicit FileOperation(const FileOperationInfo& info)
+      : path(info.path),
+        offset(info.offset),
+        length(info.length),
+        start_timestamp(info.start_timestamp),
+        finish_timestamp(info.finish_timestamp),
+        status(info.status) {}
+
+  FileOperationInfo info() const {
+    FileOperationInfo result(path, start_timestamp, finish_timestamp);
+    result.offset = offset;
+    result.length = length;
+    result.status = status;
+    return result;
+  }
+
+  std::string path;
+  uint64_t offset;
+  size_t length;
+  FileOperationInfo::TimePoint start_timestamp;
+  FileOperationInfo::TimePoint finish_timestamp;
+  Status status;
+};
+
+class AsyncEventListener : public EventListener {
+ public:
+  AsyncEventListener(std::shared_ptr<EventListener> listener,
+                     const AsyncEventListenerOptions& options)
+      : listener_(std::move(listener)),
+        max_queued_events_(std::max<size_t>(options.max_queued_events, 1)),
+        drop_when_full_(options.drop_when_full),
+        statistics_(options.statistics),
+        env_(Env::Default()),
+        cv_(&mutex_),
+        thread_(&AsyncEventListener::Run, this) {}
+
+  ~AsyncEventListener() override {
+    {
+      MutexLock l(&mutex_);
+      stop_ = true;
+      cv_.SignalAll();
+    }
+    // The queued events are still delivered
+    thread_.join();
+  }
+
+  void OnFlushCompleted(DB* db, const FlushJobInfo& info) override {
+    Enqueue([this, db, info] { listener_->OnFlushCompleted(db, info); });
+  }
+
+  void OnFlushBegin(DB* db, const FlushJobInfo& info) override {
+    Enqueue([this, db, info] { listener_->OnFlushBegin(db, info); });
+  }
+
+  void OnTableFileDeleted(const TableFileDeletionInfo& info) override {
+    Enqueue([this, info] { listener_->OnTableFileDeleted(info); });
+  }
+
+  void OnCompactionBegin(DB* db, const CompactionJobInfo& ci) override {
+    Enqueue([this, db, ci] { listener_->OnCompactionBegin(db, ci); });
+  }
+
+  void OnCompactionCompleted(DB* db, const CompactionJobInfo& ci) override {
+    Enqueue([this, db, ci] { listener_->OnCompactionCompleted(db, ci); });
+  }
+
+  void OnTableFileCreated(const TableFileCreationInfo& info) override {
+    Enqueue([this, info] { listener_->OnTableFileCreated(info); });
+  }
+
+  void OnTableFileCreationStarted(
+      const TableFileCreationBriefInfo& info) override {
+    Enqueue([this, info] { listener_->OnTableFileCreationStarted(info); });
+  }
+
+  void OnMemTableSealed(const MemTableInfo& info) override {
+    Enqueue([this, info] { listener_->OnMemTableSealed(info); });
+  }
+
+  void OnColumnFamilyHandleDeletionStarted(
+      ColumnFamilyHandle* handle) override {
+    listener_->OnColumnFamilyHandleDeletionStarted(handle);
+  }
+
+  void OnExternalFileIngested(DB* db,
+                              const ExternalFileIngestionInfo& info) override {
+    Enqueue([this, db, info] { listener_->OnExternalFileIngested(db, info); });
+  }
+
+  void OnBackgroundError(BackgroundErrorReason reason,
+                         Status* bg_error) override {
+    listener_->OnBackgroundError(reason, bg_error);
+  }
+
+  void OnStallConditionsChanged(const WriteStallInfo& info) override {
+    Enqueue([this, info] { listener_->OnStallConditionsChanged(info); });
+  }
+
+  void OnFileReadFinish(const FileOperationInfo& info) override {
+    FileOperation op(info);
+    Enqueue([this, op] { listener_->OnFileReadFinish(op.info()); });
+  }
+
+  void OnFileWriteFinish(const FileOperationInfo& info) override {
+    FileOperation op(info);
+    Enqueue([this, op] { listener_->OnFileWriteFinish(op.info()); });
+  }
+
+  bool ShouldBeNotifiedOnFileIO() override {
+    return listener_->ShouldBeNotifiedOnFileIO();
+  }
+
+  void OnErrorRecoveryBegin(BackgroundErrorReason reason, Status bg_error,
+                            bool* auto_recovery) override {
+    listener_->OnErrorRecoveryBegin(reason, bg_error, auto_recovery);
+  }
+
+  void OnErrorRecoveryCompleted(Status old_bg_error) override {
+    Enqueue([this, old_bg_error] {
+      listener_->OnErrorRecoveryCompleted(old_bg_error);
+    });
+  }
+
+  void OnDBClosing(DB* db) override {
+    if (std::this_thread::get_id() != thread_.get_id()) {
+      MutexLock l(&mutex_);
+      while (!queue_.empty() || notifying_) {
+        cv_.Wait();
+      }
+    }
+    listener_->OnDBClosing(db);
+  }
+
+ private:
+  struct Event {
+    std::function<void()> notify;
+    uint64_t queued_micros;
+  };
+
+  void Enqueue(std::function<void()>&& notify) {
+    uint64_t now = env_->NowMicros();
+    MutexLock l(&mutex_);
+    if (queue_.size() >= max_queued_events_) {
+      if (drop_when_full_) {
+        RecordTick(statistics_.get(), ASYNC_LISTENER_EVENTS_DROPPED);
+        return;
+      }
+      RecordTick(statistics_.get(), ASYNC_LISTENER_EVENTS_BLOCKED);
+      // Events of the listener's own callbacks can't wait for it
+      if (std::this_thread::get_id() != thread_.get_id()) {
+        while (queue_.size() >= max_queued_events_) {
+          cv_.Wait();
+        }
+      }
+    }
+    queue_.push_back(Event{std::move(notify), now});
+    cv_.SignalAll();
+  }
+
+  void Run() {
+    MutexLock l(&mutex_);
+    while (true) {
+      while (queue_.empty() && !stop_) {
+        cv_.Wait();
+      }
+      if (queue_.empty()) {
+        break;
+      }
+      Event event = std::move(queue_.front());
+      queue_.pop_front();
+      notifying_ = true;
+      // Room for a waiting event
+      cv_.SignalAll();
+      mutex_.Unlock();
+      uint64_t start = env_->NowMicros();
+      MeasureTime(statistics_.get(), ASYNC_LISTENER_QUEUE_MICROS,
+                  start - std::min(start, event.queued_micros));
+      event.notify();
+      event.notify = nullptr;
+      MeasureTime(statistics_.get(), ASYNC_LISTENER_CALLBACK_MICROS,
+                  env_->NowMicros() - start);
+      mutex_.Lock();
+      notifying_ = false;
+      cv_.SignalAll();
+    }
+  }
+
+  const std::shared_ptr<EventListener> listener_;
+  const size_t max_queued_events_;
+  const bool drop_when_full_;
+  const std::shared_ptr<Statistics> statistics_;
+  Env* env_;
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::deque<Event> queue_;
+  bool notifying_ = false;
+  bool stop_ = false;
+  // Last, it runs as soon as it's constructed
+  port::Thread thread_;
+};
+
+}  // namespace
+
+std::shared_ptr<EventListener> NewAsyncEventListener(
+    std::shared_ptr<EventListener> listener,
+    const AsyncEventListenerOptions& options) {
+  return std::make_shared<AsyncEventListener>(std::move(listener), options);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
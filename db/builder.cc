@@ -101,17 +101,18 @@ TableBuilder* NewTableBuilder(
     const CompressionOptions& compression_opts, int level,
     double compaction_load, const std::string* compression_dict,
     bool skip_filters, uint64_t creation_time, uint64_t oldest_key_time,
-    SstPurpose sst_purpose, Env* env) {
+    SstPurpose sst_purpose, Env* env, bool for_blob) {
   assert((column_family_id ==
           TablePropertiesCollectorFactory::Context::kUnknownColumnFamily) ==
          column_family_name.empty());
-  return ioptions.table_factory->NewTableBuilder(
-      TableBuilderOptions(ioptions, moptions, internal_comparator,
-                          int_tbl_prop_collector_factories, compression_type,
-                          compression_opts, compression_dict, skip_filters,
-                          column_family_name, level, compaction_load,
-                          creation_time, oldest_key_time, sst_purpose, env),
-      column_family_id, file);
+  TableBuilderOptions builder_options(
+      ioptions, moptions, internal_comparator,
+      int_tbl_prop_collector_factories, compression_type, compression_opts,
+      compression_dict, skip_filters, column_family_name, level,
+      compaction_load, creation_time, oldest_key_time, sst_purpose, env);
+  builder_options.for_blob = for_blob;
+  return ioptions.table_factory->NewTableBuilder(builder_options,
+                                                 column_family_id, file);
 }
 
 Status BuildTable(
@@ -192,6 +193,7 @@ Status BuildTable(
       file_writer.reset(new WritableFileWriter(std::move(file), fname,
                                                env_options, ioptions.statistics,
                                                ioptions.listeners));
+      file_writer->set_io_file_kind(IOFileKindOfTable(level, false));
       builder = NewTableBuilder(
           ioptions, mutable_cf_options, internal_comparator,
           int_tbl_prop_collector_factories, column_family_id,
@@ -301,6 +303,7 @@ Status BuildTable(
         separate_helper.file_writer.reset(new WritableFileWriter(
             std::move(blob_file), separate_helper.fname, env_options,
             ioptions.statistics, ioptions.listeners));
+        separate_helper.file_writer->set_io_file_kind(IOFileKind::kBlob);
         ZnsLog(kCyan, "Set separate_helper.file_writer: %s",
                separate_helper.file_writer->file_name().c_str());
         separate_helper.builder.reset(NewTableBuilder(
@@ -308,7 +311,7 @@ Status BuildTable(
             int_tbl_prop_collector_factories_for_blob, column_family_id,
             column_family_name, separate_helper.file_writer.get(), compression,
             compression_opts, -1 /* level */, 0 /* compaction_load */, nullptr,
-            true, 0, 0, kEssenceSst, env));
+            true, 0, 0, kEssenceSst, env, true /* for_blob */));
         blob_builder = separate_helper.builder.get();
       }
       if (status.ok()) {
@@ -533,13 +536,16 @@ struct PartitionTableBuilderSeparateHelper : public SeparateHelper {
     std::unique_ptr<WritableFileWriter> file_writer = nullptr;
     std::unique_ptr<TableBuilder> table_builder = nullptr;
     TableProperties tp;
-    FileMetaData* meta = nullptr;
-    TableProperties* curr_props = nullptr;
+    // Index of the current output in output_meta (and prop), the vectors
+    // grow while writing so pointers into them can not be cached
+    size_t meta_index = size_t(-1);
   };
   Writer hot_writer;
   Writer warm_writer;
-  // Writer for each partition, 32 is the maximum possible value of partition
-  Writer partition_writer[32];
+  // Writer for each hash partition. A writer is only allocated when the first
+  // key is routed to its partition, so that an empty partition never opens a
+  // blob file (and thus never holds an active zone).
+  std::vector<std::unique_ptr<Writer>> partition_writers;
 
   std::vector<FileMetaData>* output_meta = nullptr;
   std::vector<TableProperties>* prop = nullptr;
@@ -548,25 +554,26 @@ struct PartitionTableBuilderSeparateHelper : public SeparateHelper {
   // Oracle for hotness detection
   std::shared_ptr<Oracle> oracle;
 
-  // Configurable parameters controlling the SeparateHelper
-  //
-  // For simplicity we use hard-coding here to specify the partiton number.
-  // A more general implementation would require this field to be initialized
-  // from configuration structs.
-  uint32_t partition_num = 4;
+  // Configurable parameters controlling the SeparateHelper, see
+  // ColumnFamilyOptions::blob_partition_num and
+  // DBOptions::enable_hot_separation
+  uint32_t partition_num = 1;
 
   // If enabled, the keys identified as hot or warm would be written into
   // individual blobs.
   bool enable_hot_separation = true;
 
+  void SetPartitionNum(uint32_t num) {
+    partition_num = std::max<uint32_t>(1, num);
+    partition_writers.resize(partition_num);
+  }
+
   // Get the type of a specific key
   KeyType CalculateKeyType(const Slice& key) {
-    // TODO: Query the hotness set to determine its hotness
-    ParsedInternalKey ikey;
-    if (enable_hot_separation) {
-      ParseInternalKey(key, &ikey);
-      auto tmp = std::string(ikey.user_key.data(), ikey.user_key.size());
-      auto t = oracle->ProbeKeyType(tmp, 0);
+    if (enable_hot_separation && oracle != nullptr) {
+      Slice user_key = ExtractUserKey(key);
+      KeyType t;
+      oracle->ProbeKeyTypes(&user_key, 1, 0, &t);
       if (t.IsHot() || t.IsWarm()) {
         return t;
       }
@@ -577,12 +584,36 @@ struct PartitionTableBuilderSeparateHelper : public SeparateHelper {
     return KeyType::Partition(hasher(key) % partition_num);
   }
 
+  Writer* GetPartitionWriter(uint32_t partition_id) {
+    assert(partition_id < partition_writers.size());
+    auto& writer = partition_writers[partition_id];
+    if (writer == nullptr) {
+      writer.reset(new Writer());
+    }
+    return writer.get();
+  }
+
+  FileMetaData* GetMeta(Writer* writer) {
+    assert(writer->meta_index < output_meta->size());
+    return &(*output_meta)[writer->meta_index];
+  }
+
+  TableProperties* GetProps(Writer* writer) {
+    if (prop == nullptr) {
+      return &writer->tp;
+    }
+    assert(writer->meta_index < prop->size());
+    return &(*prop)[writer->meta_index];
+  }
+
   std::vector<Writer*> GetAllWriters() {
     std::vector<Writer*> ret;
     ret.emplace_back(&hot_writer);
     ret.emplace_back(&warm_writer);
-    for (uint32_t i = 0; i < partition_num; ++i) {
-      ret.emplace_back(&partition_writer[i]);
+    for (auto& writer : partition_writers) {
+      if (writer != nullptr) {
+        ret.emplace_back(writer.get());
+      }
     }
     return ret;
   }
@@ -712,6 +743,7 @@ Status BuildPartitionTable(
       file_writer.reset(new WritableFileWriter(std::move(file), fname,
                                                env_options, ioptions.statistics,
                                                ioptions.listeners));
+      file_writer->set_io_file_kind(IOFileKindOfTable(level, false));
       builder = NewTableBuilder(
           ioptions, mutable_cf_options, internal_comparator,
           int_tbl_prop_collector_factories, column_family_id,
@@ -742,13 +774,13 @@ Status BuildPartitionTable(
               writer->file_writer->writable_file()->GetPlacementFileType();
           Status status;
           TableBuilder* blob_builder = writer->table_builder.get();
-          FileMetaData* blob_meta = writer->meta;
+          FileMetaData* blob_meta = psh.GetMeta(writer);
           blob_meta->prop.num_entries = blob_builder->NumEntries();
           blob_meta->prop.num_deletions = 0;
           blob_meta->prop.purpose = kEssenceSst;
           blob_meta->prop.flags |= TablePropertyCache::kNoRangeDeletions;
           status = blob_builder->Finish(&blob_meta->prop, nullptr);
-          TableProperties& tp = *writer->curr_props;
+          TableProperties& tp = *psh.GetProps(writer);
           if (status.ok()) {
             blob_meta->fd.file_size = blob_builder->FileSize();
             tp = blob_builder->GetTableProperties();
@@ -807,7 +839,7 @@ Status BuildPartitionTable(
         writer = &psh.warm_writer;
         counter.sep_warm_count++;
       } else if (key_type.IsPartition()) {
-        writer = &psh.partition_writer[key_type.PartitionId()];
+        writer = psh.GetPartitionWriter(key_type.PartitionId());
       } else {
         // Can not be a Cold type or unknown type in flush job
         assert(false);
@@ -815,7 +847,8 @@ Status BuildPartitionTable(
       assert(writer != nullptr);
 
       TableBuilder* blob_builder = writer->table_builder.get();
-      FileMetaData* blob_meta = writer->meta;
+      FileMetaData* blob_meta =
+          blob_builder != nullptr ? psh.GetMeta(writer) : nullptr;
 
       if (blob_builder != nullptr &&
           blob_builder->FileSize() > target_blob_file_size) {
@@ -833,18 +866,14 @@ Status BuildPartitionTable(
         TEST_SYNC_POINT_CALLBACK("BuildTable:create_file", &use_direct_writes);
 #endif  // !NDEBUG
 
-        // Add a new FileMeta structure for the newly created file
+        // Add a new FileMeta and property structure for the newly created
+        // file, the two vectors are kept index aligned
+        writer->meta_index = psh.output_meta->size();
         psh.output_meta->emplace_back();
-        blob_meta = writer->meta = &(psh.output_meta->back());
-        // ZnsLog(kCyan, "[Writer %d Set Meta: %p]", key_type.PartitionId(),
-        //        blob_meta);
-
-        // Add a new property structure for the newly created file
-        if (psh.prop == nullptr) {
-          writer->curr_props = &writer->tp;
-        } else {
+        blob_meta = psh.GetMeta(writer);
+        if (psh.prop != nullptr) {
+          assert(psh.prop->size() == writer->meta_index);
           psh.prop->emplace_back();
-          writer->curr_props = &psh.prop->back();
         }
 
         // Create file for this writer
@@ -865,17 +894,23 @@ Status BuildPartitionTable(
 
         // Set necessary information
         blob_file->SetIOPriority(io_priority);
-        blob_file->SetWriteLifeTimeHint(Env::WriteLifeTimeHint::WLTH_EXTREME);
+        // Same lifetime classes as the blobs written by compaction, freshly
+        // flushed data has not survived any GC yet
+        blob_file->SetWriteLifeTimeHint(
+            key_type.IsHot()    ? Env::WLTH_SHORT
+            : key_type.IsWarm() ? Env::WLTH_MEDIUM
+                                : Env::WLTH_LONG);
 
         writer->file_writer.reset(new WritableFileWriter(
             std::move(blob_file), writer->fname, env_options,
             ioptions.statistics, ioptions.listeners));
+        writer->file_writer->set_io_file_kind(IOFileKind::kBlob);
         writer->table_builder.reset(NewTableBuilder(
             ioptions, mutable_cf_options, internal_comparator,
             int_tbl_prop_collector_factories_for_blob, column_family_id,
             column_family_name, writer->file_writer.get(), compression,
             compression_opts, -1 /* level */, 0 /* compaction_load */, nullptr,
-            true, 0, 0, kEssenceSst, env));
+            true, 0, 0, kEssenceSst, env, true /* for_blob */));
         blob_builder = writer->table_builder.get();
         ZnsLog(kCyan, "Create New Blob: %s, Type: %s",
                writer->file_writer->file_name().c_str(),
@@ -896,22 +931,17 @@ Status BuildPartitionTable(
       return status;
     };
 
-    // NOTE: We must first reserve enough space for meta_vec and
-    // table_properties_vec. Otherwise the expansions of these vectors will
-    // invalidate the pointer cached in Writer (and SeparateHelper)
-    if (meta_vec != nullptr) {
-      meta_vec->reserve(64);
-    }
-    if (table_properties_vec != nullptr) {
-      table_properties_vec->reserve(64);
-    }
-
     psh.output_meta = meta_vec;
     psh.prop = table_properties_vec;
-    psh.oracle = env->GetOracle();
+    psh.enable_hot_separation = env_options.enable_hot_separation;
+    if (psh.enable_hot_separation) {
+      psh.oracle = env->GetOracle();
+    }
 
-    // Set some related parameters for this SeparateHelper
-    psh.partition_num = env_options.partition_num;
+    // A column family may override the DB wide partition number
+    psh.SetPartitionNum(mutable_cf_options.blob_partition_num != 0
+                            ? mutable_cf_options.blob_partition_num
+                            : static_cast<uint32_t>(env_options.partition_num));
 
     BlobConfig blob_config = mutable_cf_options.get_blob_config();
     if (ioptions.table_factory->IsBuilderNeedSecondPass()) {
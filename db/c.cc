@@ -941,6 +941,59 @@ void rocksdb_multi_get_cf(
   }
 }
 
+// The values looked up by MultiGet are moved into the pinnable slices, so
+// the caller reads them in place and frees each with one call
+static void MultiGetPinnedResults(std::vector<Status>& statuses,
+                                  std::vector<std::string>& values,
+                                  rocksdb_pinnableslice_t** values_list,
+                                  char** errs) {
+  for (size_t i = 0; i < statuses.size(); i++) {
+    errs[i] = nullptr;
+    values_list[i] = nullptr;
+    if (statuses[i].ok()) {
+      rocksdb_pinnableslice_t* v = new (rocksdb_pinnableslice_t);
+      v->rep.trans_to_string()->swap(values[i]);
+      v->rep.fetch();
+      values_list[i] = v;
+    } else if (!statuses[i].IsNotFound()) {
+      errs[i] = strdup(statuses[i].ToString().c_str());
+    }
+  }
+}
+
+void rocksdb_multi_get_pinned(rocksdb_t* db,
+                              const rocksdb_readoptions_t* options,
+                              size_t num_keys, const char* const* keys_list,
+                              const size_t* keys_list_sizes,
+                              rocksdb_pinnableslice_t** values_list,
+                              char** errs) {
+  std::vector<Slice> keys(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    keys[i] = Slice(keys_list[i], keys_list_sizes[i]);
+  }
+  std::vector<std::string> values(num_keys);
+  std::vector<Status> statuses = db->rep->MultiGet(options->rep, keys, &values);
+  MultiGetPinnedResults(statuses, values, values_list, errs);
+}
+
+void rocksdb_multi_get_pinned_cf(
+    rocksdb_t* db, const rocksdb_readoptions_t* options,
+    const rocksdb_column_family_handle_t* const* column_families,
+    size_t num_keys, const char* const* keys_list,
+    const size_t* keys_list_sizes, rocksdb_pinnableslice_t** values_list,
+    char** errs) {
+  std::vector<Slice> keys(num_keys);
+  std::vector<ColumnFamilyHandle*> cfs(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    keys[i] = Slice(keys_list[i], keys_list_sizes[i]);
+    cfs[i] = column_families[i]->rep;
+  }
+  std::vector<std::string> values(num_keys);
+  std::vector<Status> statuses =
+      db->rep->MultiGet(options->rep, cfs, keys, &values);
+  MultiGetPinnedResults(statuses, values, values_list, errs);
+}
+
 rocksdb_iterator_t* rocksdb_create_iterator(
     rocksdb_t* db, const rocksdb_readoptions_t* options) {
   rocksdb_iterator_t* result = new rocksdb_iterator_t;
@@ -1224,6 +1277,34 @@ void rocksdb_iter_get_error(const rocksdb_iterator_t* iter, char** errptr) {
   SaveError(errptr, iter->rep->status());
 }
 
+size_t rocksdb_iter_next_batch(rocksdb_iterator_t* iter, char* buf,
+                               size_t buf_len, size_t max_entries,
+                               const char** keys_list, size_t* keys_list_sizes,
+                               const char** values_list,
+                               size_t* values_list_sizes) {
+  size_t count = 0;
+  size_t used = 0;
+  while (count < max_entries && iter->rep->Valid()) {
+    Slice key = iter->rep->key();
+    Slice value = iter->rep->value();
+    if (!iter->rep->status().ok() ||
+        key.size() + value.size() > buf_len - used) {
+      break;
+    }
+    memcpy(buf + used, key.data(), key.size());
+    keys_list[count] = buf + used;
+    keys_list_sizes[count] = key.size();
+    used += key.size();
+    memcpy(buf + used, value.data(), value.size());
+    values_list[count] = buf + used;
+    values_list_sizes[count] = value.size();
+    used += value.size();
+    ++count;
+    iter->rep->Next();
+  }
+  return count;
+}
+
 rocksdb_writebatch_t* rocksdb_writebatch_create() {
   return new rocksdb_writebatch_t;
 }
@@ -1288,6 +1369,37 @@ void rocksdb_writebatch_putv_cf(rocksdb_writebatch_t* b,
              SliceParts(value_slices.data(), num_values));
 }
 
+void rocksdb_writebatch_put_many(rocksdb_writebatch_t* b, size_t num_entries,
+                                 const char* const* keys_list,
+                                 const size_t* keys_list_sizes,
+                                 const char* const* values_list,
+                                 const size_t* values_list_sizes) {
+  for (size_t i = 0; i < num_entries; i++) {
+    b->rep.Put(Slice(keys_list[i], keys_list_sizes[i]),
+               Slice(values_list[i], values_list_sizes[i]));
+  }
+}
+
+void rocksdb_writebatch_put_many_cf(
+    rocksdb_writebatch_t* b, rocksdb_column_family_handle_t* column_family,
+    size_t num_entries, const char* const* keys_list,
+    const size_t* keys_list_sizes, const char* const* values_list,
+    const size_t* values_list_sizes) {
+  for (size_t i = 0; i < num_entries; i++) {
+    b->rep.Put(column_family->rep, Slice(keys_list[i], keys_list_sizes[i]),
+               Slice(values_list[i], values_list_sizes[i]));
+  }
+}
+
+void rocksdb_writebatch_delete_many(rocksdb_writebatch_t* b,
+                                    size_t num_entries,
+                                    const char* const* keys_list,
+                                    const size_t* keys_list_sizes) {
+  for (size_t i = 0; i < num_entries; i++) {
+    b->rep.Delete(Slice(keys_list[i], keys_list_sizes[i]));
+  }
+}
+
 void rocksdb_writebatch_merge(rocksdb_writebatch_t* b, const char* key,
                               size_t klen, const char* val, size_t vlen) {
   b->rep.Merge(Slice(key, klen), Slice(val, vlen));
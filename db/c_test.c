@@ -766,6 +766,28 @@ int main(int argc, char** argv) {
     rocksdb_writebatch_destroy(wb);
   }
 
+  StartPhase("writebatch_many");
+  {
+    rocksdb_writebatch_t* wb = rocksdb_writebatch_create();
+    const char* k_list[2] = { "m1", "m2" };
+    const size_t k_sizes[2] = { 2, 2 };
+    const char* v_list[2] = { "x", "yz" };
+    const size_t v_sizes[2] = { 1, 2 };
+    rocksdb_writebatch_put_many(wb, 2, k_list, k_sizes, v_list, v_sizes);
+    CheckCondition(rocksdb_writebatch_count(wb) == 2);
+    rocksdb_write(db, woptions, wb, &err);
+    CheckNoError(err);
+    CheckGet(db, roptions, "m1", "x");
+    CheckGet(db, roptions, "m2", "yz");
+    rocksdb_writebatch_clear(wb);
+    rocksdb_writebatch_delete_many(wb, 2, k_list, k_sizes);
+    rocksdb_write(db, woptions, wb, &err);
+    CheckNoError(err);
+    CheckGet(db, roptions, "m1", NULL);
+    CheckGet(db, roptions, "m2", NULL);
+    rocksdb_writebatch_destroy(wb);
+  }
+
   StartPhase("writebatch_savepoint");
   {
     rocksdb_writebatch_t* wb = rocksdb_writebatch_create();
@@ -914,6 +936,31 @@ int main(int argc, char** argv) {
     rocksdb_iter_destroy(iter);
   }
 
+  StartPhase("iter_next_batch");
+  {
+    rocksdb_iterator_t* iter = rocksdb_create_iterator(db, roptions);
+    char buf[16];
+    const char* keys[2];
+    size_t keys_sizes[2];
+    const char* vals[2];
+    size_t vals_sizes[2];
+    rocksdb_iter_seek_to_first(iter);
+    // "foo" -> "hello" does not fit after "box" -> "c"
+    CheckCondition(rocksdb_iter_next_batch(iter, buf, 6, 2, keys, keys_sizes,
+                                           vals, vals_sizes) == 1);
+    CheckEqual("box", keys[0], keys_sizes[0]);
+    CheckEqual("c", vals[0], vals_sizes[0]);
+    CheckIter(iter, "foo", "hello");
+    CheckCondition(rocksdb_iter_next_batch(iter, buf, sizeof(buf), 2, keys,
+                                           keys_sizes, vals, vals_sizes) == 1);
+    CheckEqual("foo", keys[0], keys_sizes[0]);
+    CheckEqual("hello", vals[0], vals_sizes[0]);
+    CheckCondition(!rocksdb_iter_valid(iter));
+    rocksdb_iter_get_error(iter, &err);
+    CheckNoError(err);
+    rocksdb_iter_destroy(iter);
+  }
+
   StartPhase("wbwi_iter");
   {
     rocksdb_iterator_t* base_iter = rocksdb_create_iterator(db, roptions);
@@ -972,6 +1019,26 @@ int main(int argc, char** argv) {
     }
   }
 
+  StartPhase("multiget_pinned");
+  {
+    const char* keys[3] = { "box", "foo", "notfound" };
+    const size_t keys_sizes[3] = { 3, 3, 8 };
+    rocksdb_pinnableslice_t* vals[3];
+    char* errs[3];
+    const char* expected[3] = { "c", "hello", NULL };
+    rocksdb_multi_get_pinned(db, roptions, 3, keys, keys_sizes, vals, errs);
+
+    int i;
+    for (i = 0; i < 3; i++) {
+      size_t val_len;
+      const char* val;
+      CheckEqual(NULL, errs[i], 0);
+      val = rocksdb_pinnableslice_value(vals[i], &val_len);
+      CheckEqual(expected[i], val, val_len);
+      rocksdb_pinnableslice_destroy(vals[i]);
+    }
+  }
+
   StartPhase("pin_get");
   {
     CheckPinGet(db, roptions, "box", "c");
@@ -0,0 +1,202 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/change_feed.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "db/write_batch_internal.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+
+namespace TERARKDB_NAMESPACE {
+
+ChangeFeed::ChangeFeed(size_t capacity, SequenceNumber start_sequence)
+    : capacity_(capacity), dropped_sequence_(start_sequence) {}
+
+void ChangeFeed::Publish(const SliceParts& record) {
+  assert(record.num_parts > 0 &&
+         record.parts[0].size() >= WriteBatchInternal::kHeader);
+  size_t size = 0;
+  for (int i = 0; i < record.num_parts; ++i) {
+    size += record.parts[i].size();
+  }
+  // Copy outside of the lock, the readers only share the copy
+  auto rep = std::make_shared<std::string>();
+  rep->reserve(size);
+  for (int i = 0; i < record.num_parts; ++i) {
+    rep->append(record.parts[i].data(), record.parts[i].size());
+  }
+  Record r;
+  r.sequence = DecodeFixed64(rep->data());
+  r.next_sequence = r.sequence + DecodeFixed32(rep->data() + 8);
+  r.rep = std::move(rep);
+
+  bool notify;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(records_.empty() || records_.back().next_sequence <= r.sequence);
+    r.index = first_index_ + records_.size();
+    usage_ += size;
+    records_.push_back(std::move(r));
+    while (usage_ > capacity_ && records_.size() > 1) {
+      auto& front = records_.front();
+      usage_ -= front.rep->size();
+      dropped_sequence_ = front.next_sequence;
+      records_.pop_front();
+      ++first_index_;
+    }
+    notify = num_waiters_ > 0;
+  }
+  if (notify) {
+    published_cv_.notify_all();
+  }
+}
+
+Status ChangeFeed::Seek(SequenceNumber seq, Record* record) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (seq < dropped_sequence_) {
+    return Status::Incomplete("Dropped from the change feed");
+  }
+  auto it = std::partition_point(
+      records_.begin(), records_.end(), [seq](const Record& r) {
+        return r.sequence < seq && r.next_sequence <= seq;
+      });
+  if (it == records_.end()) {
+    record->index = first_index_ + records_.size();
+    return Status::NotFound();
+  }
+  *record = *it;
+  return Status::OK();
+}
+
+Status ChangeFeed::Get(uint64_t index, Record* record) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index < first_index_) {
+    return Status::Incomplete("Dropped from the change feed");
+  }
+  if (index - first_index_ >= records_.size()) {
+    return Status::NotFound();
+  }
+  *record = records_[index - first_index_];
+  return Status::OK();
+}
+
+bool ChangeFeed::Wait(uint64_t index, uint64_t timeout_micros) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ++num_waiters_;
+  bool published = published_cv_.wait_for(
+      lock, std::chrono::microseconds(timeout_micros),
+      [&] { return first_index_ + records_.size() > index; });
+  --num_waiters_;
+  return published;
+}
+
+size_t ChangeFeed::ApproximateMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_;
+}
+
+ChangeFeedIteratorImpl::ChangeFeedIteratorImpl(ChangeFeed* feed,
+                                               SequenceNumber seq,
+                                               WalOpener open_wal)
+    : feed_(feed), open_wal_(std::move(open_wal)), next_sequence_(seq) {
+  ReadFeed();
+}
+
+void ChangeFeedIteratorImpl::Next() {
+  assert(valid_);
+  if (wal_iter_ != nullptr) {
+    ChangeFeed::Record record;
+    if (!feed_->Seek(next_sequence_, &record).IsIncomplete()) {
+      // Caught up with the feed
+      wal_iter_.reset();
+      wal_batch_ = BatchResult();
+      seek_ = true;
+      ReadFeed();
+      return;
+    }
+    wal_iter_->Next();
+    ReadWal(false /* reopen */);
+    return;
+  }
+  ReadFeed();
+}
+
+BatchResult ChangeFeedIteratorImpl::GetBatch() {
+  assert(valid_);
+  if (wal_iter_ != nullptr) {
+    return std::move(wal_batch_);
+  }
+  BatchResult result;
+  result.sequence = record_.sequence;
+  result.writeBatchPtr.reset(new WriteBatch(*record_.rep));
+  return result;
+}
+
+bool ChangeFeedIteratorImpl::WaitForUpdates(uint64_t timeout_micros) {
+  if (valid_) {
+    return true;
+  }
+  if (!status_.ok()) {
+    return false;
+  }
+  feed_->Wait(next_index_, timeout_micros);
+  ReadFeed();
+  return valid_;
+}
+
+void ChangeFeedIteratorImpl::ReadFeed() {
+  ChangeFeed::Record record;
+  Status s = seek_ ? feed_->Seek(next_sequence_, &record)
+                   : feed_->Get(next_index_, &record);
+  if (s.ok()) {
+    seek_ = false;
+    record_ = std::move(record);
+    next_index_ = record_.index + 1;
+    next_sequence_ = record_.next_sequence;
+    valid_ = true;
+  } else if (s.IsIncomplete()) {
+    ReadWal(true /* reopen */);
+  } else {
+    // Not published yet. When seeking, the feed has set the index to wait
+    // for.
+    if (seek_) {
+      next_index_ = record.index;
+    }
+    record_ = ChangeFeed::Record();
+    valid_ = false;
+  }
+}
+
+void ChangeFeedIteratorImpl::ReadWal(bool reopen) {
+  record_ = ChangeFeed::Record();
+  if (reopen) {
+    wal_iter_.reset();
+    status_ = open_wal_(next_sequence_, &wal_iter_);
+    if (!status_.ok()) {
+      wal_iter_.reset();
+      valid_ = false;
+      return;
+    }
+  }
+  valid_ = wal_iter_->Valid();
+  if (!valid_) {
+    // Failed or at the end of the WAL so far, the records past it are either
+    // in the feed or in the WAL once it is opened again
+    status_ = wal_iter_->status();
+    wal_iter_.reset();
+    seek_ = true;
+    return;
+  }
+  wal_batch_ = wal_iter_->GetBatch();
+  next_sequence_ = std::max(
+      next_sequence_,
+      wal_batch_.sequence +
+          WriteBatchInternal::Count(wal_batch_.writeBatchPtr.get()));
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,124 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/transaction_log.h"
+#include "rocksdb/types.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// ChangeFeed keeps the latest records the write group leaders wrote to the
+// WAL, see DBOptions::change_feed_buffer_size. Every record is copied once
+// when it is published and then shared by the subscribers reading it.
+//
+// The records are numbered in publish order. Once the records take more than
+// `capacity` bytes the oldest ones are dropped, a subscriber that has not read
+// them yet goes back to the WAL.
+class ChangeFeed {
+ public:
+  struct Record {
+    uint64_t index = 0;
+    // The sequence of the first entry and the one past the last entry
+    SequenceNumber sequence = 0;
+    SequenceNumber next_sequence = 0;
+    // A WriteBatch rep
+    std::shared_ptr<const std::string> rep;
+  };
+
+  // The records before `start_sequence` are only in the WAL
+  ChangeFeed(size_t capacity, SequenceNumber start_sequence);
+
+  // Publish a WAL record, the header of the first part holds the sequence.
+  // The latest record is kept even if it is larger than the capacity.
+  // REQUIRES: the records are published one at a time in sequence order
+  void Publish(const SliceParts& record);
+
+  // Find the first record with entries at or past `seq`. Returns Incomplete
+  // if it may have been dropped, or NotFound with record->index set to the
+  // index of the next record if it is not published yet.
+  Status Seek(SequenceNumber seq, Record* record) const;
+
+  // Get the record `index`, Incomplete if it was dropped and NotFound if it is
+  // not published yet
+  Status Get(uint64_t index, Record* record) const;
+
+  // Wait up to `timeout_micros` for the record `index` to be published.
+  // Returns whether it is.
+  bool Wait(uint64_t index, uint64_t timeout_micros);
+
+  size_t ApproximateMemoryUsage() const;
+
+ private:
+  const size_t capacity_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable published_cv_;
+  std::deque<Record> records_;
+  // The index of records_.front()
+  uint64_t first_index_ = 0;
+  // The sequence past the records dropped so far
+  SequenceNumber dropped_sequence_;
+  size_t usage_ = 0;
+  int num_waiters_ = 0;
+};
+
+// The iterator of DB::NewChangeFeedIterator(). It reads the records of the
+// feed, and opens a WAL iterator with `open_wal` to read the records dropped
+// before it got to them. Once the feed has the records it is at again it
+// drops the WAL iterator.
+class ChangeFeedIteratorImpl : public ChangeFeedIterator {
+ public:
+  typedef std::function<Status(SequenceNumber,
+                               std::unique_ptr<TransactionLogIterator>*)>
+      WalOpener;
+
+  // REQUIRES: `feed` outlives the iterator
+  ChangeFeedIteratorImpl(ChangeFeed* feed, SequenceNumber seq,
+                         WalOpener open_wal);
+
+  virtual bool Valid() override { return valid_; }
+  virtual void Next() override;
+  virtual Status status() override { return status_; }
+  virtual BatchResult GetBatch() override;
+  virtual bool WaitForUpdates(uint64_t timeout_micros) override;
+
+  // Whether the iterator reads the WAL now
+  bool ReadingWal() const { return wal_iter_ != nullptr; }
+
+ private:
+  // Position at the record after the last one read, from the feed if it still
+  // has it
+  void ReadFeed();
+  // Position at the current batch of wal_iter_, or go back to the feed
+  void ReadWal(bool reopen);
+
+  ChangeFeed* feed_;
+  WalOpener open_wal_;
+  // The sequence past the last record read
+  SequenceNumber next_sequence_;
+  // Until the feed has a record past next_sequence_ the records are found by
+  // sequence. Afterwards next_index_ is the record to read next.
+  bool seek_ = true;
+  uint64_t next_index_ = 0;
+  bool valid_ = false;
+  Status status_;
+  ChangeFeed::Record record_;
+  std::unique_ptr<TransactionLogIterator> wal_iter_;
+  BatchResult wal_batch_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,223 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/change_feed.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "db/write_batch_internal.h"
+#include "port/stack_trace.h"
+#include "rocksdb/db.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/string_util.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+void PublishBatch(ChangeFeed* feed, SequenceNumber seq, int count) {
+  WriteBatch batch;
+  for (int i = 0; i < count; ++i) {
+    batch.Put("key" + ToString(i), std::string(100, 'v'));
+  }
+  WriteBatchInternal::SetSequence(&batch, seq);
+  Slice rep = WriteBatchInternal::Contents(&batch);
+  feed->Publish(SliceParts(&rep, 1));
+}
+}  // namespace
+
+TEST(ChangeFeedTest, SeekAndDrop) {
+  ChangeFeed feed(800, 10);
+  ChangeFeed::Record record;
+  ASSERT_TRUE(feed.Seek(9, &record).IsIncomplete());
+  ASSERT_TRUE(feed.Seek(10, &record).IsNotFound());
+  ASSERT_EQ(0u, record.index);
+
+  PublishBatch(&feed, 10, 2);
+  // The sequences 12 and 13 were not written to the WAL
+  PublishBatch(&feed, 14, 3);
+  ASSERT_OK(feed.Seek(11, &record));
+  ASSERT_EQ(0u, record.index);
+  ASSERT_EQ(10u, record.sequence);
+  ASSERT_EQ(12u, record.next_sequence);
+  ASSERT_OK(feed.Seek(12, &record));
+  ASSERT_EQ(1u, record.index);
+  ASSERT_EQ(14u, record.sequence);
+  ASSERT_EQ(3, WriteBatch(*record.rep).Count());
+  ASSERT_TRUE(feed.Seek(17, &record).IsNotFound());
+  ASSERT_EQ(2u, record.index);
+
+  // Drops the first batch
+  PublishBatch(&feed, 17, 3);
+  ASSERT_TRUE(feed.Get(0, &record).IsIncomplete());
+  ASSERT_TRUE(feed.Seek(11, &record).IsIncomplete());
+  ASSERT_OK(feed.Get(1, &record));
+  ASSERT_OK(feed.Get(2, &record));
+  ASSERT_EQ(17u, record.sequence);
+  ASSERT_TRUE(feed.Get(3, &record).IsNotFound());
+  ASSERT_LE(feed.ApproximateMemoryUsage(), 800u);
+
+  // The latest record is kept even if it does not fit
+  PublishBatch(&feed, 20, 20);
+  ASSERT_OK(feed.Get(3, &record));
+  ASSERT_TRUE(feed.Get(2, &record).IsIncomplete());
+  ASSERT_TRUE(feed.Seek(19, &record).IsIncomplete());
+  ASSERT_OK(feed.Seek(20, &record));
+}
+
+TEST(ChangeFeedTest, Wait) {
+  ChangeFeed feed(1 << 20, 1);
+  ASSERT_FALSE(feed.Wait(0, 1000));
+  std::thread writer([&] { PublishBatch(&feed, 1, 1); });
+  ASSERT_TRUE(feed.Wait(0, 10 * 1000 * 1000));
+  writer.join();
+  ASSERT_TRUE(feed.Wait(0, 0));
+  ASSERT_FALSE(feed.Wait(1, 0));
+}
+
+#ifndef ROCKSDB_LITE
+
+class ChangeFeedDBTest : public testing::Test {
+ public:
+  ChangeFeedDBTest() : dbname_(test::PerThreadDBPath("change_feed_test")) {
+    options_.create_if_missing = true;
+    options_.WAL_ttl_seconds = 1000;
+    options_.change_feed_buffer_size = 64 << 10;
+    DestroyDB(dbname_, options_);
+  }
+
+  ~ChangeFeedDBTest() {
+    db_.reset();
+    DestroyDB(dbname_, options_);
+  }
+
+  void Open() {
+    db_.reset();
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options_, dbname_, &db));
+    db_.reset(db);
+  }
+
+  void Write(int num, int value_size) {
+    for (int i = 0; i < num; ++i) {
+      ASSERT_OK(db_->Put(WriteOptions(), "key" + ToString(i),
+                         std::string(value_size, 'v')));
+    }
+  }
+
+  // Read the batches up to the last sequence, they must be contiguous
+  void ReadAll(ChangeFeedIterator* iter, SequenceNumber* seq) {
+    for (; iter->Valid(); iter->Next()) {
+      BatchResult batch = iter->GetBatch();
+      ASSERT_EQ(*seq, batch.sequence);
+      *seq += batch.writeBatchPtr->Count();
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(db_->GetLatestSequenceNumber() + 1, *seq);
+  }
+
+  const std::string dbname_;
+  Options options_;
+  std::unique_ptr<DB> db_;
+};
+
+TEST_F(ChangeFeedDBTest, FallBackToWal) {
+  Open();
+  Write(10, 100);
+  // The writes before the open are only in the WAL
+  Open();
+  std::unique_ptr<ChangeFeedIterator> iter;
+  ASSERT_OK(db_->NewChangeFeedIterator(1, &iter));
+  auto feed_iter = static_cast<ChangeFeedIteratorImpl*>(iter.get());
+  ASSERT_TRUE(feed_iter->ReadingWal());
+  SequenceNumber seq = 1;
+  ReadAll(iter.get(), &seq);
+
+  Write(10, 100);
+  ASSERT_TRUE(iter->WaitForUpdates(0));
+  ASSERT_FALSE(feed_iter->ReadingWal());
+  ReadAll(iter.get(), &seq);
+
+  // Fall behind the feed
+  Write(1000, 1000);
+  ASSERT_TRUE(iter->WaitForUpdates(0));
+  ASSERT_TRUE(feed_iter->ReadingWal());
+  ReadAll(iter.get(), &seq);
+  ASSERT_FALSE(iter->WaitForUpdates(0));
+
+  Write(1, 100);
+  ASSERT_TRUE(iter->WaitForUpdates(0));
+  ASSERT_FALSE(feed_iter->ReadingWal());
+  ReadAll(iter.get(), &seq);
+}
+
+TEST_F(ChangeFeedDBTest, WaitForUpdates) {
+  Open();
+  Write(10, 100);
+  std::unique_ptr<ChangeFeedIterator> iter;
+  SequenceNumber seq = db_->GetLatestSequenceNumber() + 1;
+  ASSERT_OK(db_->NewChangeFeedIterator(seq, &iter));
+  ASSERT_FALSE(iter->Valid());
+  ASSERT_OK(iter->status());
+  ASSERT_FALSE(iter->WaitForUpdates(1000));
+
+  std::thread writer([&] { Write(100, 100); });
+  SequenceNumber last = seq + 100;
+  while (seq < last) {
+    ASSERT_TRUE(iter->WaitForUpdates(10 * 1000 * 1000));
+    for (; iter->Valid(); iter->Next()) {
+      BatchResult batch = iter->GetBatch();
+      ASSERT_EQ(seq, batch.sequence);
+      seq += batch.writeBatchPtr->Count();
+    }
+    ASSERT_OK(iter->status());
+  }
+  writer.join();
+  ASSERT_EQ(last, seq);
+}
+
+TEST_F(ChangeFeedDBTest, WalStreams) {
+  options_.wal_streams = 3;
+  Open();
+  Write(10, 100);
+  std::unique_ptr<ChangeFeedIterator> iter;
+  SequenceNumber seq = db_->GetLatestSequenceNumber() + 1;
+  ASSERT_OK(db_->NewChangeFeedIterator(seq, &iter));
+
+  std::thread writers[4];
+  for (auto& writer : writers) {
+    writer = std::thread([&] { Write(100, 100); });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  ASSERT_TRUE(iter->WaitForUpdates(0));
+  ReadAll(iter.get(), &seq);
+
+  // No WAL to fall back to
+  iter.reset();
+  Open();
+  ASSERT_OK(db_->NewChangeFeedIterator(1, &iter));
+  ASSERT_TRUE(iter->status().IsNotSupported());
+}
+
+TEST_F(ChangeFeedDBTest, Disabled) {
+  options_.change_feed_buffer_size = 0;
+  Open();
+  std::unique_ptr<ChangeFeedIterator> iter;
+  ASSERT_TRUE(db_->NewChangeFeedIterator(1, &iter).IsNotSupported());
+}
+
+#endif  // !ROCKSDB_LITE
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -24,6 +24,8 @@
 #include <inttypes.h>
 
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <limits>
 #include <string>
 #include <vector>
@@ -322,6 +324,24 @@ ColumnFamilyOptions SanitizeOptions(const ImmutableDBOptions& db_options,
     }
   }
 
+  if (db_options.zenfs_zone_aligned_file_size) {
+    uint64_t zone_capacity = db_options.env->GetZoneCapacity();
+    if (zone_capacity > 0) {
+      uint64_t file_size = ZoneAlignedFileSize(zone_capacity);
+      ROCKS_LOG_INFO(db_options.info_log.get(),
+                     "Zone capacity is %" PRIu64
+                     ", the SST and blob files are cut at %" PRIu64,
+                     zone_capacity, file_size);
+      result.target_file_size_base = file_size;
+      result.target_file_size_multiplier = 1;
+      result.target_blob_file_size = file_size;
+    } else {
+      ROCKS_LOG_WARN(db_options.info_log.get(),
+                     "zenfs_zone_aligned_file_size needs an Env reporting "
+                     "its zone capacity");
+    }
+  }
+
   if (result.max_compaction_bytes == 0) {
     result.max_compaction_bytes = result.target_file_size_base * 25;
   }
@@ -351,6 +371,9 @@ ColumnFamilyOptions SanitizeOptions(const ImmutableDBOptions& db_options,
   if (result.maintainer_job_ratio > 1) {
     result.maintainer_job_ratio = 1;
   }
+  if (result.lazy_compaction_read_heat_weight < 0) {
+    result.lazy_compaction_read_heat_weight = 0;
+  }
 
   return result;
 }
@@ -459,6 +482,11 @@ ColumnFamilyData::ColumnFamilyData(
 
   // if _dummy_versions is nullptr, then this is a dummy column family.
   if (_dummy_versions != nullptr) {
+    if (db_options.isolate_cf_write_stalls &&
+        column_family_set->write_controller_ != nullptr) {
+      cf_write_controller_.reset(
+          new WriteController(column_family_set->write_controller_));
+    }
     internal_stats_.reset(
         new InternalStats(ioptions_.num_levels, db_options.env, this));
     table_cache_.reset(new TableCache(ioptions_, env_options, _table_cache));
@@ -745,16 +773,39 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
   if (current_ != nullptr) {
     auto* vstorage = current_->storage_info();
     auto write_controller = column_family_set_->write_controller_;
+    if (cf_write_controller_ != nullptr) {
+      // Follow the changes of the DB's delayed_write_rate
+      if (cf_write_controller_->max_delayed_write_rate() !=
+          write_controller->max_delayed_write_rate()) {
+        cf_write_controller_->set_max_delayed_write_rate(
+            write_controller->max_delayed_write_rate());
+      }
+      write_controller = cf_write_controller_.get();
+    }
     uint64_t compaction_needed_bytes =
         vstorage->estimated_compaction_needed_bytes();
+    // Reads binary search each sub-level rather than each file
+    int l0_count = mutable_cf_options.level0_stall_by_sublevels
+                       ? vstorage->l0_sublevel_delay_trigger_count()
+                       : vstorage->l0_delay_trigger_count();
+    const char* l0_unit =
+        mutable_cf_options.level0_stall_by_sublevels ? "sub-levels" : "files";
 
     auto write_stall_condition_and_cause = GetWriteStallConditionAndCause(
-        imm()->NumNotFlushed(), vstorage->l0_delay_trigger_count(),
+        imm()->NumNotFlushed(), l0_count,
         int(vstorage->read_amplification()),
         vstorage->estimated_compaction_needed_bytes(), ioptions_.num_levels,
         mutable_cf_options);
     write_stall_condition = write_stall_condition_and_cause.first;
     auto write_stall_cause = write_stall_condition_and_cause.second;
+    if (write_stall_condition == WriteStallCondition::kNormal &&
+        ioptions_.compaction_dispatcher != nullptr &&
+        !mutable_cf_options.disable_auto_compactions &&
+        remote_compaction_scheduler_.Overloaded(
+            mutable_cf_options.remote_compaction_max_pending_jobs)) {
+      write_stall_condition = WriteStallCondition::kDelayed;
+      write_stall_cause = WriteStallCause::kRemoteCompactionQueue;
+    }
 
     bool was_stopped = write_controller->IsStopped();
     bool needed_delay = write_controller->NeedsDelay();
@@ -778,8 +829,8 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
             InternalStats::LOCKED_L0_FILE_COUNT_LIMIT_STOPS, 1);
       }
       ROCKS_LOG_WARN(ioptions_.info_log,
-                     "[%s] Stopping writes because we have %d level-0 files",
-                     name_.c_str(), vstorage->l0_delay_trigger_count());
+                     "[%s] Stopping writes because we have %d level-0 %s",
+                     name_.c_str(), l0_count, l0_unit);
     } else if (write_stall_condition == WriteStallCondition::kStopped &&
                write_stall_cause == WriteStallCause::kPendingCompactionBytes) {
       write_controller_token_ = write_controller->GetStopToken();
@@ -817,8 +868,8 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
     } else if (write_stall_condition == WriteStallCondition::kDelayed &&
                write_stall_cause == WriteStallCause::kL0FileCountLimit) {
       // L0 is the last two files from stopping.
-      bool near_stop = vstorage->l0_delay_trigger_count() >=
-                       mutable_cf_options.level0_stop_writes_trigger - 2;
+      bool near_stop =
+          l0_count >= mutable_cf_options.level0_stop_writes_trigger - 2;
       write_controller_token_ =
           SetupDelay(write_controller, compaction_needed_bytes,
                      prev_compaction_needed_bytes_, was_stopped || near_stop,
@@ -830,9 +881,9 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
             InternalStats::LOCKED_L0_FILE_COUNT_LIMIT_SLOWDOWNS, 1);
       }
       ROCKS_LOG_WARN(ioptions_.info_log,
-                     "[%s] Stalling writes because we have %d level-0 files "
+                     "[%s] Stalling writes because we have %d level-0 %s "
                      "rate %" PRIu64,
-                     name_.c_str(), vstorage->l0_delay_trigger_count(),
+                     name_.c_str(), l0_count, l0_unit,
                      write_controller->delayed_write_rate());
     } else if (write_stall_condition == WriteStallCondition::kDelayed &&
                write_stall_cause == WriteStallCause::kPendingCompactionBytes) {
@@ -875,6 +926,19 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
           "(waiting for compaction) rate %" PRIu64,
           name_.c_str(), vstorage->read_amplification(),
           write_controller->delayed_write_rate());
+    } else if (write_stall_condition == WriteStallCondition::kDelayed &&
+               write_stall_cause == WriteStallCause::kRemoteCompactionQueue) {
+      write_controller_token_ =
+          SetupDelay(write_controller, compaction_needed_bytes,
+                     prev_compaction_needed_bytes_, was_stopped,
+                     mutable_cf_options.disable_auto_compactions);
+      ROCKS_LOG_WARN(
+          ioptions_.info_log,
+          "[%s] Stalling writes because %" PRIu64
+          " remote compactions are in flight rate %" PRIu64,
+          name_.c_str(),
+          remote_compaction_scheduler_.GetStats().pending_jobs,
+          write_controller->delayed_write_rate());
     } else {
       assert(write_stall_condition == WriteStallCondition::kNormal);
       if (vstorage->l0_delay_trigger_count() >=
@@ -981,9 +1045,14 @@ bool ColumnFamilyData::NeedsCompaction() const {
 
 bool ColumnFamilyData::NeedsGarbageCollection() const {
   auto vstorage = current_->storage_info();
-  return !vstorage->IsPickGarbageCollectionFail() &&
-         (vstorage->blob_marked_for_compaction() ||
-          vstorage->total_garbage_ratio() >= mutable_cf_options_.blob_gc_ratio);
+  if (vstorage->IsPickGarbageCollectionFail()) {
+    return false;
+  }
+  return vstorage->blob_marked_for_compaction() ||
+         vstorage->total_garbage_ratio() >= mutable_cf_options_.blob_gc_ratio ||
+         vstorage->blob_fragment_count() >=
+             VersionStorageInfo::kMinBlobDefragmentFiles ||
+         !vstorage->BlobsMarkedForPathMigration().empty();
 }
 
 Compaction* ColumnFamilyData::PickCompaction(
@@ -1038,6 +1107,36 @@ Compaction* ColumnFamilyData::PickZNSGarbageCollection(
   return result;
 }
 
+Compaction* ColumnFamilyData::PickBlobDefragment(
+    const MutableCFOptions& mutable_options, LogBuffer* log_buffer) {
+  StopWatch sw(ioptions_.env, ioptions_.statistics,
+               PICK_GARBAGE_COLLECTION_TIME);
+  auto* result = compaction_picker_->PickBlobDefragment(
+      GetName(), mutable_options, current_->storage_info(), log_buffer);
+  if (result != nullptr) {
+    result->SetInputVersion(current_);
+    result->set_compaction_load(0);
+  } else {
+    current_->storage_info()->SetPickGarbageCollectionFail();
+  }
+  return result;
+}
+
+Compaction* ColumnFamilyData::PickBlobPathMigration(
+    const MutableCFOptions& mutable_options, LogBuffer* log_buffer) {
+  StopWatch sw(ioptions_.env, ioptions_.statistics,
+               PICK_GARBAGE_COLLECTION_TIME);
+  auto* result = compaction_picker_->PickBlobPathMigration(
+      GetName(), mutable_options, current_->storage_info(), log_buffer);
+  if (result != nullptr) {
+    result->SetInputVersion(current_);
+    result->set_compaction_load(0);
+  } else {
+    current_->storage_info()->SetPickGarbageCollectionFail();
+  }
+  return result;
+}
+
 bool ColumnFamilyData::RangeOverlapWithCompaction(
     const Slice& smallest_user_key, const Slice& largest_user_key,
     int level) const {
@@ -1237,6 +1336,12 @@ void ColumnFamilyData::InstallSuperVersion(
   super_version_->version_number = super_version_number_;
   super_version_->write_stall_condition =
       RecalculateWriteStallConditions(mutable_cf_options);
+  if (old_superversion == nullptr || old_superversion->current != current_ ||
+      old_superversion->mutable_cf_options
+              .prefetch_index_and_filter_hot_file_ratio !=
+          mutable_cf_options.prefetch_index_and_filter_hot_file_ratio) {
+    UpdateColdFiles(mutable_cf_options);
+  }
 
   if (old_superversion != nullptr) {
     // Reset SuperVersions cached in thread local storage.
@@ -1262,6 +1367,52 @@ void ColumnFamilyData::InstallSuperVersion(
   }
 }
 
+void ColumnFamilyData::UpdateColdFiles(
+    const MutableCFOptions& mutable_cf_options) {
+  std::unordered_set<uint64_t> cold_files;
+  const double ratio =
+      mutable_cf_options.prefetch_index_and_filter_hot_file_ratio;
+  if (ratio >= 1 || current_ == nullptr) {
+    table_cache_->SetColdFiles(std::move(cold_files));
+    return;
+  }
+  // <num_reads_sampled, file number>
+  std::vector<std::pair<uint64_t, uint64_t>> files;
+  auto* vstorage = current_->storage_info();
+  auto add_file = [&files](const FileMetaData* f) {
+    files.emplace_back(
+        f->stats.num_reads_sampled.load(std::memory_order_relaxed),
+        f->fd.GetNumber());
+  };
+  for (int level = 0; level < vstorage->num_levels(); ++level) {
+    for (auto f : vstorage->LevelFiles(level)) {
+      add_file(f);
+    }
+  }
+  for (auto& pair : vstorage->dependence_map()) {
+    add_file(pair.second);
+  }
+  size_t num_hot =
+      static_cast<size_t>(std::ceil(std::max(ratio, 0.0) * files.size()));
+  if (num_hot < files.size()) {
+    // Files as hot as the coldest of the hottest ones are hot as well, so
+    // files nobody read yet all stay hot
+    uint64_t min_hot_reads = port::kMaxUint64;
+    if (num_hot > 0) {
+      std::nth_element(files.begin(), files.begin() + (num_hot - 1),
+                       files.end(),
+                       std::greater<std::pair<uint64_t, uint64_t>>());
+      min_hot_reads = files[num_hot - 1].first;
+    }
+    for (auto& pair : files) {
+      if (pair.first < min_hot_reads) {
+        cold_files.emplace(pair.second);
+      }
+    }
+  }
+  table_cache_->SetColdFiles(std::move(cold_files));
+}
+
 void ColumnFamilyData::ResetThreadLocalSuperVersions() {
   autovector<void*> sv_ptrs;
   local_sv_->Scrape(&sv_ptrs, SuperVersion::kSVObsolete);
@@ -1366,7 +1517,8 @@ ColumnFamilySet::ColumnFamilySet(const std::string& dbname,
       env_options_(env_options),
       table_cache_(table_cache),
       write_buffer_manager_(write_buffer_manager),
-      write_controller_(write_controller) {
+      write_controller_(write_controller),
+      has_resource_groups_(false) {
   // initialize linked list
   dummy_cfd_->prev_ = dummy_cfd_;
   dummy_cfd_->next_ = dummy_cfd_;
@@ -1447,6 +1599,9 @@ ColumnFamilyData* ColumnFamilySet::CreateColumnFamily(
   if (id == 0) {
     default_cfd_cache_ = new_cfd;
   }
+  if (options.resource_group != nullptr) {
+    has_resource_groups_.store(true, std::memory_order_relaxed);
+  }
   return new_cfd;
 }
 
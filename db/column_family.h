@@ -16,10 +16,12 @@
 #include <vector>
 
 #include "db/memtable_list.h"
+#include "db/remote_compaction_scheduler.h"
 #include "db/table_cache.h"
 #include "db/table_properties_collector.h"
 #include "db/write_batch_internal.h"
 #include "db/write_controller.h"
+#include "monitoring/cpu_attribution.h"
 #include "options/cf_options.h"
 #include "rocksdb/compaction_job_stats.h"
 #include "rocksdb/db.h"
@@ -242,6 +244,9 @@ class ColumnFamilyData {
 
   InternalStats* internal_stats() { return internal_stats_.get(); }
 
+  // The CPU time of the background jobs of the column family
+  CpuAttributionCounters* cpu_attribution() { return &cpu_attribution_; }
+
   MemTableList* imm() { return &imm_; }
   MemTable* mem() { return mem_; }
   Version* current() { return current_; }
@@ -283,6 +288,12 @@ class ColumnFamilyData {
 
   Compaction* PickZNSGarbageCollection(const MutableCFOptions& mutable_options,
                                        LogBuffer* log_buffer);
+
+  Compaction* PickBlobDefragment(const MutableCFOptions& mutable_options,
+                                 LogBuffer* log_buffer);
+
+  Compaction* PickBlobPathMigration(const MutableCFOptions& mutable_options,
+                                    LogBuffer* log_buffer);
   // Check if the passed range overlap with any running compactions.
   // REQUIRES: DB mutex held
   bool RangeOverlapWithCompaction(const Slice& smallest_user_key,
@@ -320,6 +331,12 @@ class ColumnFamilyData {
                            const chash_set<uint64_t>* files_being_compact);
 
   CompactionPicker* compaction_picker() { return compaction_picker_.get(); }
+  RemoteCompactionScheduler* remote_compaction_scheduler() {
+    return &remote_compaction_scheduler_;
+  }
+  // The write stalls of this column family with
+  // DBOptions::isolate_cf_write_stalls, nullptr otherwise. REQUIRES: DB mutex
+  WriteController* cf_write_controller() { return cf_write_controller_.get(); }
   // thread-safe
   const Comparator* user_comparator() const {
     return internal_comparator_.user_comparator();
@@ -392,6 +409,7 @@ class ColumnFamilyData {
     kL0FileCountLimit,
     kPendingCompactionBytes,
     kReadAmpLimit,
+    kRemoteCompactionQueue,
   };
   static std::pair<WriteStallCondition, WriteStallCause>
   GetWriteStallConditionAndCause(int num_unflushed_memtables, int num_l0_files,
@@ -432,6 +450,10 @@ class ColumnFamilyData {
                    const EnvOptions& env_options,
                    ColumnFamilySet* column_family_set);
 
+  // Hand the files of the current version outside the hottest
+  // prefetch_index_and_filter_hot_file_ratio of them to the table cache
+  void UpdateColdFiles(const MutableCFOptions& mutable_cf_options);
+
   uint32_t id_;
   const std::string name_;
   Version* dummy_versions_;  // Head of circular doubly-linked list of versions.
@@ -453,6 +475,8 @@ class ColumnFamilyData {
 
   std::unique_ptr<InternalStats> internal_stats_;
 
+  CpuAttributionCounters cpu_attribution_;
+
   WriteBufferManager* write_buffer_manager_;
 
   MemTable* mem_;
@@ -484,9 +508,11 @@ class ColumnFamilyData {
   // An object that keeps all the compaction stats
   // and picks the next compaction
   std::unique_ptr<CompactionPicker> compaction_picker_;
+  RemoteCompactionScheduler remote_compaction_scheduler_;
 
   ColumnFamilySet* column_family_set_;
 
+  std::unique_ptr<WriteController> cf_write_controller_;
   std::unique_ptr<WriteControllerToken> write_controller_token_;
 
   // If true --> this ColumnFamily is currently present in DBImpl::flush_queue_
@@ -586,6 +612,14 @@ class ColumnFamilySet {
 
   Cache* get_table_cache() { return table_cache_; }
 
+  WriteController* write_controller() { return write_controller_; }
+
+  // Whether a column family, even a dropped one, was created with a
+  // ResourceGroup. Can be called without holding DB mutex.
+  bool has_resource_groups() const {
+    return has_resource_groups_.load(std::memory_order_relaxed);
+  }
+
  private:
   friend class ColumnFamilyData;
   // helper function that gets called from cfd destructor
@@ -616,6 +650,7 @@ class ColumnFamilySet {
   Cache* table_cache_;
   WriteBufferManager* write_buffer_manager_;
   WriteController* write_controller_;
+  std::atomic<bool> has_resource_groups_;
 };
 
 // We use ColumnFamilyMemTablesImpl to provide WriteBatch a way to access
@@ -2265,6 +2265,44 @@ TEST_P(ColumnFamilyTest, SanitizeOptions) {
   }
 }
 
+TEST_P(ColumnFamilyTest, SanitizeZoneAlignedFileSize) {
+  class ZonedEnv : public EnvWrapper {
+   public:
+    explicit ZonedEnv(Env* target) : EnvWrapper(target) {}
+    uint64_t GetZoneCapacity() override { return capacity; }
+    uint64_t capacity = 0;
+  } zoned_env(Env::Default());
+
+  DBOptions db_options;
+  db_options.env = &zoned_env;
+  db_options.zenfs_zone_aligned_file_size = true;
+  ColumnFamilyOptions original;
+  original.target_file_size_base = 32 << 20;
+  original.target_file_size_multiplier = 2;
+  original.target_blob_file_size = 32 << 20;
+
+  // Not backed by zones
+  ColumnFamilyOptions result =
+      SanitizeOptions(ImmutableDBOptions(db_options), original);
+  ASSERT_EQ(original.target_file_size_base, result.target_file_size_base);
+  ASSERT_EQ(original.target_blob_file_size, result.target_blob_file_size);
+
+  zoned_env.capacity = 1077 << 20;
+  result = SanitizeOptions(ImmutableDBOptions(db_options), original);
+  uint64_t file_size = ZoneAlignedFileSize(zoned_env.capacity);
+  ASSERT_EQ(file_size, result.target_file_size_base);
+  ASSERT_EQ(file_size, result.target_blob_file_size);
+  ASSERT_EQ(1, result.target_file_size_multiplier);
+  ASSERT_EQ(file_size * 25, result.max_compaction_bytes);
+  ASSERT_LT(file_size, zoned_env.capacity);
+  ASSERT_GE(file_size, zoned_env.capacity - zoned_env.capacity / 32 - 4096);
+  ASSERT_EQ(0u, file_size % 4096);
+
+  db_options.zenfs_zone_aligned_file_size = false;
+  result = SanitizeOptions(ImmutableDBOptions(db_options), original);
+  ASSERT_EQ(original.target_file_size_base, result.target_file_size_base);
+}
+
 TEST_P(ColumnFamilyTest, ReadDroppedColumnFamily) {
   // iter 0 -- drop CF, don't reopen
   // iter 1 -- delete CF, reopen
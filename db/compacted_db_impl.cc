@@ -6,10 +6,15 @@
 #ifndef ROCKSDB_LITE
 #include "db/compacted_db_impl.h"
 
+#include <algorithm>
+#include <deque>
+
 #include "db/db_impl.h"
 #include "db/version_set.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/get_context.h"
+#include "table/internal_iterator.h"
+#include "util/coding.h"
 
 #if !defined(_MSC_VER) && !defined(__APPLE__)
 #include <sys/unistd.h>
@@ -33,18 +38,84 @@ CompactedDBImpl::CompactedDBImpl(const DBOptions& options,
     : DBImpl(options, dbname),
       cfd_(nullptr),
       version_(nullptr),
-      user_comparator_(nullptr) {}
+      user_comparator_(nullptr),
+      icmp_(nullptr) {}
 
 CompactedDBImpl::~CompactedDBImpl() {}
 
-size_t CompactedDBImpl::FindFile(const Slice& key) {
-  size_t right = files_.num_files - 1;
-  auto cmp = [&](const FdWithKeyRange& f, const Slice& k) -> bool {
-    return user_comparator_->Compare(ExtractUserKey(f.largest_key), k) < 0;
+size_t CompactedDBImpl::FindRange(const Slice& k) const {
+  auto cmp = [&](const FlatRange& r, const Slice& key) -> bool {
+    return icmp_->Compare(r.largest, key) < (r.include_largest ? 0 : 1);
   };
   return static_cast<size_t>(
-      std::lower_bound(files_.files, files_.files + right, key, cmp) -
-      files_.files);
+      std::lower_bound(ranges_.begin(), ranges_.end(), k, cmp) -
+      ranges_.begin());
+}
+
+CompactedDBImpl::RangeLookup CompactedDBImpl::LimitToRange(
+    const FlatRange& range, const Slice& k, IterKey* buffer, Slice* find_k,
+    GetContext* get_context) const {
+  *find_k = k;
+  int include_smallest = range.include_smallest;
+  // include_smallest ? cmp_result > 0 : cmp_result >= 0
+  if (icmp_->Compare(range.smallest, k) >= include_smallest) {
+    if (user_comparator_->Compare(ExtractUserKey(range.smallest),
+                                  ExtractUserKey(k)) != 0) {
+      return kNotInRange;
+    }
+    if (include_smallest) {
+      *find_k = range.smallest;
+    } else {
+      uint64_t seq_type = ExtractInternalKeyFooter(range.smallest);
+      if (seq_type == 0) {
+        return kNotInRange;
+      }
+      // A bit greater than smallest
+      *find_k = buffer->SetInternalKey(range.smallest, true /* copy */);
+      EncodeFixed64(const_cast<char*>(find_k->data() + find_k->size() - 8),
+                    seq_type - 1);
+    }
+  }
+  if (user_comparator_->Compare(ExtractUserKey(range.largest),
+                                ExtractUserKey(k)) != 0) {
+    return kLookup;
+  }
+  // Don't read the versions past largest
+  uint64_t seq_type = ExtractInternalKeyFooter(range.largest);
+  if (seq_type == port::kMaxUint64 && !range.include_largest) {
+    return kNextRange;
+  }
+  get_context->SetMinSequenceAndType(
+      std::max(get_context->GetMinSequenceAndType(),
+               seq_type + !range.include_largest));
+  return kLookupAndNextRange;
+}
+
+Status CompactedDBImpl::GetFromRanges(const ReadOptions& options,
+                                      const Slice& k, size_t i,
+                                      GetContext* get_context) const {
+  Status s;
+  IterKey buffer;
+  uint64_t min_seq_type = get_context->GetMinSequenceAndType();
+  for (; i < ranges_.size(); ++i) {
+    Slice find_k;
+    RangeLookup lookup =
+        LimitToRange(ranges_[i], k, &buffer, &find_k, get_context);
+    if (lookup == kNotInRange) {
+      break;
+    }
+    if (lookup != kNextRange) {
+      s = ranges_[i].reader->Get(options, find_k, get_context, nullptr);
+      if (!s.ok() || get_context->is_finished()) {
+        break;
+      }
+      get_context->SetMinSequenceAndType(min_seq_type);
+      if (lookup == kLookup) {
+        break;
+      }
+    }
+  }
+  return s;
 }
 
 Status CompactedDBImpl::Get(const ReadOptions& options, ColumnFamilyHandle*,
@@ -59,8 +130,11 @@ Status CompactedDBImpl::Get(const ReadOptions& options, ColumnFamilyHandle*,
     snapshot = kMaxSequenceNumber;
   }
   LookupKey lkey(key, snapshot);
-  files_.files[FindFile(key)].fd.table_reader->Get(options, lkey.internal_key(),
-                                                   &get_context, nullptr);
+  Status s = GetFromRanges(options, lkey.internal_key(),
+                           FindRange(lkey.internal_key()), &get_context);
+  if (!s.ok()) {
+    return s;
+  }
   if (get_context.State() == GetContext::kFound) {
     return value->fetch();
   } else if (get_context.State() == GetContext::kCorrupt) {
@@ -72,46 +146,141 @@ Status CompactedDBImpl::Get(const ReadOptions& options, ColumnFamilyHandle*,
 std::vector<Status> CompactedDBImpl::MultiGet(
     const ReadOptions& options, const std::vector<ColumnFamilyHandle*>&,
     const std::vector<Slice>& keys, std::vector<std::string>* values) {
-  autovector<TableReader*, 16> reader_list;
   SequenceNumber snapshot;
   if (options.snapshot != nullptr) {
     snapshot = reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_;
   } else {
     snapshot = kMaxSequenceNumber;
   }
-  for (const auto& key : keys) {
-    const FdWithKeyRange& f = files_.files[FindFile(key)];
-    if (user_comparator_->Compare(key, ExtractUserKey(f.smallest_key)) < 0) {
-      reader_list.push_back(nullptr);
+  const size_t num_keys = keys.size();
+  std::vector<Status> statuses(num_keys);
+  values->resize(num_keys);
+  std::deque<LookupKey> lkeys;
+  std::deque<LazyBuffer> lazy_values;
+  std::deque<GetContext> get_contexts;
+  std::deque<IterKey> buffers;
+  std::vector<size_t> range_index(num_keys);
+  std::vector<RangeLookup> lookups(num_keys, kNotInRange);
+  std::vector<Slice> find_keys(num_keys);
+  std::vector<size_t> order;
+  order.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; ++i) {
+    lkeys.emplace_back(keys[i], snapshot);
+    lazy_values.emplace_back(&(*values)[i]);
+    get_contexts.emplace_back(user_comparator_, nullptr, nullptr, nullptr,
+                              GetContext::kNotFound, keys[i], &lazy_values[i],
+                              nullptr, nullptr, version_, nullptr, nullptr);
+    buffers.emplace_back();
+    Slice k = lkeys[i].internal_key();
+    range_index[i] = FindRange(k);
+    if (range_index[i] < ranges_.size()) {
+      lookups[i] = LimitToRange(ranges_[range_index[i]], k, &buffers[i],
+                                &find_keys[i], &get_contexts[i]);
+    }
+    if (lookups[i] == kLookup || lookups[i] == kLookupAndNextRange) {
+      order.push_back(i);
+    }
+  }
+
+  // One batch per SST
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return range_index[a] < range_index[b];
+  });
+  std::vector<Slice> batch_keys;
+  std::vector<GetContext*> batch_contexts;
+  std::vector<Status> batch_statuses;
+  for (size_t begin = 0, end; begin < order.size(); begin = end) {
+    size_t range = range_index[order[begin]];
+    batch_keys.clear();
+    batch_contexts.clear();
+    for (end = begin;
+         end < order.size() && range_index[order[end]] == range; ++end) {
+      batch_keys.push_back(find_keys[order[end]]);
+      batch_contexts.push_back(&get_contexts[order[end]]);
+    }
+    batch_statuses.resize(batch_keys.size());
+    ranges_[range].reader->MultiGet(options, batch_keys.size(),
+                                    batch_keys.data(), batch_contexts.data(),
+                                    batch_statuses.data(), nullptr);
+    for (size_t j = begin; j < end; ++j) {
+      statuses[order[j]] = batch_statuses[j - begin];
+    }
+  }
+
+  for (size_t i = 0; i < num_keys; ++i) {
+    auto& get_context = get_contexts[i];
+    if (statuses[i].ok() && !get_context.is_finished() &&
+        (lookups[i] == kLookupAndNextRange || lookups[i] == kNextRange)) {
+      // Older versions of the key are in the next ranges
+      get_context.SetMinSequenceAndType(0);
+      statuses[i] = GetFromRanges(options, lkeys[i].internal_key(),
+                                  range_index[i] + 1, &get_context);
+    }
+    if (!statuses[i].ok()) {
+      continue;
+    }
+    if (get_context.State() == GetContext::kFound) {
+      statuses[i] = std::move(lazy_values[i]).dump(&(*values)[i]);
+    } else if (get_context.State() == GetContext::kCorrupt) {
+      statuses[i] = std::move(get_context).CorruptReason();
     } else {
-      LookupKey lkey(key, snapshot);
-      f.fd.table_reader->Prepare(lkey.internal_key());
-      reader_list.push_back(f.fd.table_reader);
-    }
-  }
-  std::vector<Status> statuses(keys.size(), Status::NotFound());
-  values->resize(keys.size());
-  int idx = 0;
-  for (auto* r : reader_list) {
-    if (r != nullptr) {
-      std::string& value = (*values)[idx];
-      LazyBuffer lazy_val(&value);
-      GetContext get_context(user_comparator_, nullptr, nullptr, nullptr,
-                             GetContext::kNotFound, keys[idx], &lazy_val,
-                             nullptr, nullptr, version_, nullptr, nullptr);
-      LookupKey lkey(keys[idx], kMaxSequenceNumber);
-      r->Get(options, lkey.internal_key(), &get_context, nullptr);
-      if (get_context.State() == GetContext::kFound) {
-        statuses[idx] = std::move(lazy_val).dump(&value);
-      } else if (get_context.State() == GetContext::kCorrupt) {
-        statuses[idx] = std::move(get_context).CorruptReason();
-      }
+      statuses[i] = Status::NotFound();
     }
-    ++idx;
   }
   return statuses;
 }
 
+Status CompactedDBImpl::AddRanges(const FileMetaData* f) {
+  if (f->fd.table_reader == nullptr) {
+    return Status::NotSupported("Table reader is not opened");
+  }
+  if (!f->prop.is_map_sst()) {
+    ranges_.push_back({f->smallest.Encode().ToString(),
+                       f->largest.Encode().ToString(), true, true,
+                       f->fd.table_reader});
+    return Status::OK();
+  }
+  auto& dependence_map = version_->storage_info()->dependence_map();
+  std::unique_ptr<InternalIterator> iter(f->fd.table_reader->NewIterator(
+      ReadOptions(), nullptr /* prefix_extractor */));
+  MapSstElement element;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    auto value = iter->value();
+    Status s = value.fetch();
+    if (!s.ok()) {
+      return s;
+    }
+    if (!element.Decode(iter->key(), value.slice())) {
+      return Status::Corruption("Map sst invalid key or value");
+    }
+    if (element.link.empty()) {
+      continue;
+    }
+    if (element.link.size() > 1) {
+      return Status::NotSupported("Map sst has read amp");
+    }
+    if (element.has_delete_range) {
+      return Status::NotSupported("Map sst has range deletions");
+    }
+    auto find = dependence_map.find(element.link.front().file_number);
+    if (find == dependence_map.end()) {
+      return Status::Corruption("Map sst dependence missing");
+    }
+    const FileMetaData* target = find->second;
+    if (target->prop.is_map_sst()) {
+      return Status::NotSupported("Map sst links to map sst");
+    }
+    if (target->fd.table_reader == nullptr) {
+      return Status::NotSupported("Table reader is not opened");
+    }
+    ranges_.push_back({element.smallest_key.ToString(),
+                       element.largest_key.ToString(),
+                       element.include_smallest, element.include_largest,
+                       target->fd.table_reader});
+  }
+  return iter->status();
+}
+
 Status CompactedDBImpl::Init(const Options& options) {
   SuperVersionContext sv_context(/* create_superversion */ true);
   mutex_.Lock();
@@ -131,6 +300,7 @@ Status CompactedDBImpl::Init(const Options& options) {
   NewThreadStatusCfInfo(cfd_);
   version_ = cfd_->GetSuperVersion()->current;
   user_comparator_ = cfd_->user_comparator();
+  icmp_ = &cfd_->internal_comparator();
   auto* vstorage = version_->storage_info();
   if (vstorage->num_non_empty_levels() == 0) {
     return Status::NotSupported("no file exists");
@@ -140,34 +310,29 @@ Status CompactedDBImpl::Init(const Options& options) {
   if (l0.num_files > 1) {
     return Status::NotSupported("L0 contain more than 1 file");
   }
+  int level = 0;
   if (l0.num_files == 1) {
     if (vstorage->num_non_empty_levels() > 1) {
       return Status::NotSupported("Both L0 and other level contain files");
     }
-    if (l0.files[0].file_metadata->prop.is_map_sst()) {
-      return Status::NotSupported("L0 has read amp");
-    }
-    files_ = l0;
-    return Status::OK();
-  }
-
-  for (int i = 1; i < vstorage->num_non_empty_levels() - 1; ++i) {
-    if (vstorage->LevelFilesBrief(i).num_files > 0) {
-      return Status::NotSupported("Other levels also contain files");
+  } else {
+    for (int i = 1; i < vstorage->num_non_empty_levels() - 1; ++i) {
+      if (vstorage->LevelFilesBrief(i).num_files > 0) {
+        return Status::NotSupported("Other levels also contain files");
+      }
     }
+    level = vstorage->num_non_empty_levels() - 1;
   }
-
-  int level = vstorage->num_non_empty_levels() - 1;
   for (auto f : vstorage->LevelFiles(level)) {
-    if (f->prop.is_map_sst()) {
-      return Status::NotSupported("Level has read amp");
+    s = AddRanges(f);
+    if (!s.ok()) {
+      return s;
     }
   }
-  if (vstorage->LevelFilesBrief(level).num_files > 0) {
-    files_ = vstorage->LevelFilesBrief(level);
-    return Status::OK();
+  if (ranges_.empty()) {
+    return Status::NotSupported("no file exists");
   }
-  return Status::NotSupported("no file exists");
+  return Status::OK();
 }
 
 Status CompactedDBImpl::Open(const Options& options, const std::string& dbname,
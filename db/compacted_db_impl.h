@@ -13,6 +13,9 @@
 
 namespace TERARKDB_NAMESPACE {
 
+// A read only DB whose data is on a single level. The map SSTs on that level
+// are resolved to the SSTs they link to when the DB is opened, so a lookup
+// only searches one flat array of key ranges and reads one SST.
 class CompactedDBImpl : public DBImpl {
  public:
   CompactedDBImpl(const DBOptions& options, const std::string& dbname);
@@ -89,13 +92,44 @@ class CompactedDBImpl : public DBImpl {
 
  private:
   friend class DB;
-  inline size_t FindFile(const Slice& key);
+
+  // The keys of an SST which are visible, the whole SST or a range of a map
+  // SST that links to it
+  struct FlatRange {
+    std::string smallest;
+    std::string largest;
+    bool include_smallest;
+    bool include_largest;
+    TableReader* reader;
+  };
+
+  enum RangeLookup {
+    kNotInRange,
+    // The range has none of the versions of the key, the next one may have
+    kNextRange,
+    kLookup,
+    // The next range may have older versions of the key
+    kLookupAndNextRange,
+  };
+
+  // Index of the first range not ending before the internal key `k`
+  size_t FindRange(const Slice& k) const;
+  // Limit the lookup of `k` to `range` like TableCache::Get() does for a map
+  // SST element, the key to look up is stored in *find_k
+  RangeLookup LimitToRange(const FlatRange& range, const Slice& k,
+                           IterKey* buffer, Slice* find_k,
+                           GetContext* get_context) const;
+  // Look up `k` from ranges_[i] on
+  Status GetFromRanges(const ReadOptions& options, const Slice& k, size_t i,
+                       GetContext* get_context) const;
+  Status AddRanges(const FileMetaData* f);
   Status Init(const Options& options);
 
   ColumnFamilyData* cfd_;
   Version* version_;
   const Comparator* user_comparator_;
-  LevelFilesBrief files_;
+  const InternalKeyComparator* icmp_;
+  std::vector<FlatRange> ranges_;
 
   // No copying allowed
   CompactedDBImpl(const CompactedDBImpl&);
@@ -211,6 +211,8 @@ void ProcessFileMetaData(const char* job_info, FileMetaData* meta,
     GetCompactionTimePoint(tp->user_collected_properties,
                            &meta->prop.earliest_time_begin_compact,
                            &meta->prop.latest_time_end_compact);
+    meta->prop.latest_time_expire =
+        GetLatestTimeExpire(tp->user_collected_properties);
     ROCKS_LOG_INFO(iopt->info_log,
                    "%s earliest_time_begin_compact = %" PRIu64
                    ", latest_time_end_compact = %" PRIu64,
@@ -315,6 +317,20 @@ bool Compaction::IsFullCompaction(
   return num_files_in_compaction == total_num_files;
 }
 
+namespace {
+// The automatic compactions write to the tier of the temperature of their
+// inputs, see ColumnFamilyOptions::hot_data_ratio
+uint32_t TieredOutputPathId(const CompactionParams& params, int level) {
+  if (params.manual_compaction) {
+    return params.output_path_id;
+  }
+  auto vstorage = params.input_version;
+  return vstorage->TieredPathId(params.immutable_cf_options, level,
+                                vstorage->IsHotData(params.inputs),
+                                params.output_path_id);
+}
+}  // namespace
+
 Compaction::Compaction(CompactionParams&& params)
     : input_vstorage_(params.input_version),
       start_level_(params.inputs[0].level),
@@ -328,7 +344,8 @@ Compaction::Compaction(CompactionParams&& params)
       input_version_(nullptr),
       number_levels_(params.input_version->num_levels()),
       cfd_(nullptr),
-      output_path_id_(params.output_path_id),
+      output_path_id_(TieredOutputPathId(params, params.output_level)),
+      blob_output_path_id_(TieredOutputPathId(params, -1)),
       output_compression_(params.compression),
       output_compression_opts_(params.compression_opts),
       partial_compaction_(params.partial_compaction),
@@ -676,6 +693,18 @@ uint64_t Compaction::MaxInputFileCreationTime() const {
   }
   return max_creation_time;
 }
+
+uint64_t Compaction::InputLatestTimeExpire() const {
+  uint64_t latest_time_expire = 0;
+  for (auto& input : inputs_) {
+    for (auto f : input.files) {
+      latest_time_expire =
+          std::max(latest_time_expire, input_vstorage_->LatestTimeExpire(f));
+    }
+  }
+  return latest_time_expire;
+}
+
 std::unordered_map<uint64_t, uint64_t>&
 Compaction::current_blob_overlap_scores() const {
   return input_vstorage_->blob_overlap_scores();
@@ -8,6 +8,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <unordered_set>
 
@@ -84,6 +85,8 @@ enum CompactionType {
   kZNSWarmGarbageCollection = 5,
   kZNSColdGarbageCollection = 6,
   kZNSPartitionGarbageCollection = 7,
+  // The sub_compaction_type of a kGarbageCollection merging small blob files
+  kBlobDefragment = 8,
 };
 
 struct CompactionParams {
@@ -199,6 +202,12 @@ struct CompactionWorkerContext {
   int level, output_level, number_levels;
   bool skip_filters, bottommost_level, allow_ingest_behind, preserve_deletes;
   std::vector<NameParam> int_tbl_prop_collector_factories;
+  // Size of the metadata tail (everything behind the data blocks) of the
+  // tables the dispatcher has open, so that a worker fetches footer,
+  // metaindex, properties, index and filter with a single read
+  std::vector<std::pair<uint64_t, uint64_t>> table_tail_sizes;
+  // Readahead used when scanning the compaction inputs, 0 for the default
+  uint64_t compaction_readahead_size = 0;
 };
 
 struct CompactionWorkerResult {
@@ -308,6 +317,10 @@ class Compaction {
   // Whether need to write output file to second DB path.
   uint32_t output_path_id() const { return output_path_id_; }
 
+  // The path of the blob files written, which only differs from
+  // output_path_id() by the temperature, see hot_data_ratio
+  uint32_t blob_output_path_id() const { return blob_output_path_id_; }
+
   // Is this a trivial compaction that can be implemented by just
   // moving a single input file to the next level (no merging or splitting)
   bool IsTrivialMove() const;
@@ -456,7 +469,7 @@ class Compaction {
 
   int GetInputBaseLevel() const;
 
-  CompactionReason compaction_reason() { return compaction_reason_; }
+  CompactionReason compaction_reason() const { return compaction_reason_; }
 
   const std::vector<FileMetaData*>& grandparents() const {
     return grandparents_;
@@ -468,6 +481,9 @@ class Compaction {
 
   uint64_t MaxInputFileCreationTime() const;
 
+  // The latest expiry time of the entries of all input files
+  uint64_t InputLatestTimeExpire() const;
+
   // get the smallest and largest key present in files to be compacted
   static void GetBoundaryKeys(VersionStorageInfo* vstorage,
                               const std::vector<CompactionInputFiles>& inputs,
@@ -479,7 +495,8 @@ class Compaction {
   std::vector<TableTransientStat>& transient_stat() { return transient_stat_; }
   std::unordered_map<uint64_t, uint64_t>& current_blob_overlap_scores() const;
 
-  mutable uint64_t gc_write_bytes = 0;
+  // Added by every subcompaction of a garbage collection
+  mutable std::atomic<uint64_t> gc_write_bytes{0};
 
  private:
   // mark (or clear) all files that are being compacted
@@ -511,6 +528,7 @@ class Compaction {
   Arena arena_;  // Arena used to allocate space for file_levels_
 
   const uint32_t output_path_id_;
+  const uint32_t blob_output_path_id_;
   CompressionType output_compression_;
   CompressionOptions output_compression_opts_;
 
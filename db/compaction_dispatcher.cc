@@ -16,9 +16,19 @@
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <errno.h>
 #include <inttypes.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_set>
 
 #ifdef WITH_TERARK_ZIP
 #include <terark/num_to_str.hpp>
@@ -28,6 +38,7 @@
 #endif
 
 #include "db/compaction_iterator.h"
+#include "db/compaction_worker_codec.h"
 #include "db/map_builder.h"
 #include "db/merge_helper.h"
 #include "db/range_del_aggregator.h"
@@ -45,6 +56,7 @@
 #include "table/table_reader.h"
 #include "table/two_level_iterator.h"
 #include "util/c_style_callback.h"
+#include "util/coding.h"
 #include "util/filename.h"
 
 #ifndef WITH_TERARK_ZIP
@@ -321,8 +333,8 @@ class WorkerSeparateHelper : public SeparateHelper, public LazyBufferState {
 std::function<CompactionWorkerResult()>
 RemoteCompactionDispatcher::StartCompaction(
     const CompactionWorkerContext& context) {
-  ajson::string_stream stream;
-  ajson::save_to(stream, context);
+  std::string encoded_context;
+  EncodeCompactionWorkerContext(context, &encoded_context);
   struct Result {
     Result(std::future<std::string>&& _future) : future(_future.share()) {}
 
@@ -331,6 +343,15 @@ RemoteCompactionDispatcher::StartCompaction(
     CompactionWorkerResult operator()() {
       CompactionWorkerResult result;
       std::string encoded_result = future.get();
+      if (IsCompactionWorkerBinary(encoded_result)) {
+        Status s = DecodeCompactionWorkerResult(encoded_result, &result);
+        if (!s.ok()) {
+          result = CompactionWorkerResult();
+          result.status = std::move(s);
+        }
+        return result;
+      }
+      // Worker built before the binary format
       try {
         ajson::load_from_buff(result, encoded_result);
       } catch (const std::exception& ex) {
@@ -343,16 +364,87 @@ RemoteCompactionDispatcher::StartCompaction(
       return result;
     }
   };
-  std::future<std::string> str_result = DoCompaction(stream.str());
+  std::future<std::string> str_result =
+      DoCompaction(std::move(encoded_context));
   return Result(std::move(str_result));
 }
 
+// Input readahead of a worker when the dispatcher does not ask for one
+static const size_t kWorkerReadaheadSize = 2 << 20;
+
 static bool g_isCompactionWorkerNode = false;
 bool IsCompactionWorkerNode() { return g_isCompactionWorkerNode; }
 
+// Table readers opened by a worker outlive a single job, so that a persistent
+// worker serving many compactions of the same column family finds the index,
+// filter and block cache of its inputs already warm. Readers are grouped by
+// the options they were opened with, they keep references into them.
+struct WorkerTableCache {
+  ColumnFamilyOptions cf_options;
+  ImmutableDBOptions db_options;
+  ImmutableCFOptions ioptions;
+  MutableCFOptions moptions;
+
+  std::mutex mutex;
+  std::unordered_map<uint64_t, std::shared_ptr<TableReader>> readers;
+
+  WorkerTableCache(const ColumnFamilyOptions& _cf_options, Env* env)
+      : cf_options(_cf_options),
+        db_options(DBOptions()),
+        ioptions(db_options, cf_options),
+        moptions(cf_options, env) {}
+
+  // Drop the readers of files the new job does not reference, those files
+  // are most likely compacted away already.
+  void Retain(const DependenceMap& live_files) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = readers.begin(); it != readers.end();) {
+      if (live_files.count(it->first) == 0) {
+        it = readers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+};
+
 struct RemoteCompactionDispatcher::Worker::Rep {
   EnvOptions env_options;
   Env* env;
+
+  std::mutex table_cache_mutex;
+  std::unordered_map<std::string, std::shared_ptr<WorkerTableCache>>
+      table_caches;
+
+  // Set by Serve(), called whenever an output file is finished
+  std::function<void(const CompactionWorkerResult::FileInfo&)>
+      on_file_finished;
+
+  std::shared_ptr<WorkerTableCache> GetTableCache(
+      const CompactionWorkerContext& context,
+      const ColumnFamilyOptions& cf_options) {
+    std::string signature;
+    PutLengthPrefixedSlice(&signature, context.user_comparator);
+    PutLengthPrefixedSlice(&signature, context.table_factory);
+    PutLengthPrefixedSlice(&signature, context.table_factory_options);
+    PutLengthPrefixedSlice(&signature, context.prefix_extractor);
+    PutLengthPrefixedSlice(&signature, context.prefix_extractor_options);
+    for (auto& path : context.cf_paths) {
+      PutLengthPrefixedSlice(&signature, path);
+    }
+    std::lock_guard<std::mutex> lock(table_cache_mutex);
+    auto& cache = table_caches[signature];
+    if (!cache) {
+      ColumnFamilyOptions reader_options;
+      reader_options.comparator = cf_options.comparator;
+      reader_options.table_factory = cf_options.table_factory;
+      reader_options.prefix_extractor = cf_options.prefix_extractor;
+      reader_options.bloom_locality = cf_options.bloom_locality;
+      reader_options.cf_paths = cf_options.cf_paths;
+      cache = std::make_shared<WorkerTableCache>(reader_options, env);
+    }
+    return cache;
+  }
 };
 
 RemoteCompactionDispatcher::Worker::Worker(EnvOptions env_options, Env* env) {
@@ -398,17 +490,36 @@ class RemoteCompactionProxy : public CompactionIterator::CompactionProxy {
   bool bottommost_level_, allow_ingest_behind_, preserve_deletes_;
 };
 
-static std::string make_error(Status&& status) {
-  CompactionWorkerResult result;
-  result.status = std::move(status);
+// Answer in the format of the request, so a dispatcher built before the
+// binary format keeps working with new workers.
+static std::string EncodeResult(const CompactionWorkerResult& result,
+                                bool binary) {
+  if (binary) {
+    std::string encoded;
+    EncodeCompactionWorkerResult(result, &encoded);
+    return encoded;
+  }
   ajson::string_stream stream;
   ajson::save_to(stream, result);
   return stream.str();
-};
+}
 
 std::string RemoteCompactionDispatcher::Worker::DoCompaction(Slice data) {
+  const bool binary = IsCompactionWorkerBinary(data);
+  auto make_error = [binary](Status&& status) {
+    CompactionWorkerResult result;
+    result.status = std::move(status);
+    return EncodeResult(result, binary);
+  };
   CompactionWorkerContext context;
-  ajson::load_from_buff(context, data);
+  if (binary) {
+    Status s = DecodeCompactionWorkerContext(data, &context);
+    if (!s.ok()) {
+      return make_error(std::move(s));
+    }
+  } else {
+    ajson::load_from_buff(context, data);
+  }
   context.compaction_filter_context.smallest_user_key =
       context.smallest_user_key;
   context.compaction_filter_context.largest_user_key = context.largest_user_key;
@@ -550,31 +661,74 @@ std::string RemoteCompactionDispatcher::Worker::DoCompaction(Slice data) {
       assert(false);
     }
   }
-  std::unordered_map<uint64_t, std::unique_ptr<TableReader>> table_cache;
+  // Readers used by this job, pinned here so that a concurrent job trimming
+  // the shared cache can not close them
+  std::unordered_map<uint64_t, std::shared_ptr<TableReader>> table_cache;
   std::mutex table_cache_mutex;
+  auto shared_table_cache = rep_->GetTableCache(context, cf_options);
+  shared_table_cache->Retain(contxt_dependence_map);
+  std::unordered_map<uint64_t, uint64_t> tail_sizes(
+      context.table_tail_sizes.begin(), context.table_tail_sizes.end());
+  // Inputs are read front to back, on shared storage a large readahead turns
+  // the scan into few big sequential requests. Separated values are point
+  // lookups and read without it.
+  std::unordered_set<uint64_t> input_files;
+  for (auto& pair : context.inputs) {
+    input_files.insert(pair.second);
+  }
+  const size_t readahead_size = context.compaction_readahead_size > 0
+                                    ? context.compaction_readahead_size
+                                    : kWorkerReadaheadSize;
+  auto open_table_reader = [&](uint64_t file_number,
+                               std::shared_ptr<TableReader>* reader_ptr) {
+    assert(contxt_dependence_map.count(file_number) > 0);
+    const FileMetaData* file_metadata = contxt_dependence_map[file_number];
+    auto cache = shared_table_cache.get();
+    {
+      std::lock_guard<std::mutex> lock(cache->mutex);
+      auto find = cache->readers.find(file_number);
+      if (find != cache->readers.end()) {
+        *reader_ptr = find->second;
+        return Status::OK();
+      }
+    }
+    std::string file_name = TableFileName(
+        cache->ioptions.cf_paths, file_number, file_metadata->fd.GetPathId());
+    std::unique_ptr<RandomAccessFile> file;
+    auto s = env->NewRandomAccessFile(file_name, &file, env_opt);
+    if (!s.ok()) {
+      return s;
+    }
+    if (input_files.count(file_number) > 0 && !env_opt.use_direct_reads) {
+      file = NewReadaheadRandomAccessFile(std::move(file), readahead_size);
+    }
+    std::unique_ptr<RandomAccessFileReader> file_reader(
+        new RandomAccessFileReader(std::move(file), file_name, env));
+    std::unique_ptr<TableReader> reader;
+    TableReaderOptions table_reader_options(
+        cache->ioptions, cache->moptions.prefix_extractor.get(), env_opt,
+        cache->ioptions.internal_comparator, true, false, -1, file_number);
+    auto tail = tail_sizes.find(file_number);
+    if (tail != tail_sizes.end()) {
+      table_reader_options.tail_size_hint = tail->second;
+    }
+    s = cache->ioptions.table_factory->NewTableReader(
+        table_reader_options, std::move(file_reader),
+        file_metadata->fd.file_size, &reader, false);
+    if (!s.ok()) {
+      return s;
+    }
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    *reader_ptr = cache->readers.emplace(file_number, std::move(reader))
+                      .first->second;
+    return Status::OK();
+  };
   auto get_table_reader = [&](uint64_t file_number, TableReader** reader_ptr) {
     std::lock_guard<std::mutex> lock(table_cache_mutex);
     auto find = table_cache.find(file_number);
     if (find == table_cache.end()) {
-      assert(contxt_dependence_map.count(file_number) > 0);
-      const FileMetaData* file_metadata = contxt_dependence_map[file_number];
-      std::string file_name =
-          TableFileName(immutable_cf_options.cf_paths, file_number,
-                        file_metadata->fd.GetPathId());
-      std::unique_ptr<RandomAccessFile> file;
-      auto s = env->NewRandomAccessFile(file_name, &file, env_opt);
-      if (!s.ok()) {
-        return s;
-      }
-      std::unique_ptr<RandomAccessFileReader> file_reader(
-          new RandomAccessFileReader(std::move(file), file_name, env));
-      std::unique_ptr<TableReader> reader;
-      TableReaderOptions table_reader_options(
-          immutable_cf_options, mutable_cf_options.prefix_extractor.get(),
-          env_opt, *icmp, true, false, -1, file_number);
-      s = immutable_cf_options.table_factory->NewTableReader(
-          table_reader_options, std::move(file_reader),
-          file_metadata->fd.file_size, &reader, false);
+      std::shared_ptr<TableReader> reader;
+      auto s = open_table_reader(file_number, &reader);
       if (!s.ok()) {
         return s;
       }
@@ -981,6 +1135,9 @@ std::string RemoteCompactionDispatcher::Worker::DoCompaction(Slice data) {
       file_info.largest_seqno = meta.fd.largest_seqno;
       file_info.file_size = meta.fd.file_size;
       file_info.marked_for_compaction = meta.marked_for_compaction;
+      if (rep_->on_file_finished) {
+        rep_->on_file_finished(file_info);
+      }
       result.files.emplace_back(file_info);
     }
     meta = FileMetaData();
@@ -1096,18 +1253,23 @@ std::string RemoteCompactionDispatcher::Worker::DoCompaction(Slice data) {
   auto finish_time = system_clock::now();
   auto duration = duration_cast<microseconds>(finish_time - start_time);
   result.time_us = duration.count();
-  ajson::string_stream stream;
-  ajson::save_to(stream, result);
-  return stream.str();
+  return EncodeResult(result, binary);
 }
 
 void RemoteCompactionDispatcher::Worker::DebugSerializeCheckResult(Slice data) {
 #ifdef WITH_TERARK_ZIP
   using namespace terark;
-  LittleEndianDataInput<MemIO> dio;
-  dio.set((void*)(data.data_), data.size());
   CompactionWorkerResult res;
-  dio >> res;
+  if (IsCompactionWorkerBinary(data)) {
+    Status s = DecodeCompactionWorkerResult(data, &res);
+    if (!s.ok()) {
+      res.status = std::move(s);
+    }
+  } else {
+    LittleEndianDataInput<MemIO> dio;
+    dio.set((void*)(data.data_), data.size());
+    dio >> res;
+  }
   string_appender<> str;
   str << "CompactionWorkerResult: time_us = " << res.time_us << " ("
       << (res.time_us * 1e-6) << " sec), ";
@@ -1134,6 +1296,105 @@ void RemoteCompactionDispatcher::Worker::DebugSerializeCheckResult(Slice data) {
 #endif
 }
 
+namespace {
+
+Status WriteFully(int fd, const std::string& data, bool is_socket) {
+  size_t pos = 0;
+  while (pos < data.size()) {
+    // The dispatcher side must not die of SIGPIPE when a worker crashed
+    ssize_t n = is_socket ? ::send(fd, data.data() + pos, data.size() - pos,
+                                   MSG_NOSIGNAL)
+                          : ::write(fd, data.data() + pos, data.size() - pos);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Status::IOError("CompactionWorker: write", strerror(errno));
+    }
+    pos += n;
+  }
+  return Status::OK();
+}
+
+// Returns NotFound if the stream ended cleanly before the first byte
+Status ReadFully(int fd, char* buf, size_t size) {
+  size_t pos = 0;
+  while (pos < size) {
+    ssize_t n = ::read(fd, buf + pos, size - pos);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Status::IOError("CompactionWorker: read", strerror(errno));
+    }
+    if (n == 0) {
+      return pos == 0
+                 ? Status::NotFound("CompactionWorker: end of stream")
+                 : Status::IOError("CompactionWorker: truncated frame");
+    }
+    pos += n;
+  }
+  return Status::OK();
+}
+
+Status ReadFrame(int fd, CompactionWorkerFrameType* type,
+                 std::string* payload) {
+  char header[kCompactionWorkerFrameHeaderSize];
+  Status s = ReadFully(fd, header, sizeof header);
+  if (!s.ok()) {
+    return s;
+  }
+  uint32_t size;
+  if (!DecodeCompactionWorkerFrameHeader(header, type, &size)) {
+    return Status::Corruption("CompactionWorker: bad frame type");
+  }
+  payload->resize(size);
+  s = ReadFully(fd, &(*payload)[0], size);
+  return s.IsNotFound() ? Status::IOError("CompactionWorker: truncated frame")
+                        : s;
+}
+
+}  // namespace
+
+Status RemoteCompactionDispatcher::Worker::Serve(int in_fd, int out_fd) {
+  std::string frame;
+  rep_->on_file_finished =
+      [&](const CompactionWorkerResult::FileInfo& file_info) {
+        std::string payload;
+        EncodeCompactionWorkerFileInfo(file_info, &payload);
+        frame.clear();
+        PutCompactionWorkerFrame(&frame, kCompactionWorkerFileInfo, payload);
+        // A broken connection shows up again when the result is sent
+        WriteFully(out_fd, frame, false);
+      };
+  Status s;
+  std::string request;
+  while (true) {
+    CompactionWorkerFrameType type;
+    s = ReadFrame(in_fd, &type, &request);
+    if (s.IsNotFound()) {
+      s = Status::OK();
+      break;
+    }
+    if (!s.ok()) {
+      break;
+    }
+    if (type != kCompactionWorkerRequest) {
+      s = Status::Corruption("CompactionWorker: unexpected frame");
+      break;
+    }
+    std::string result = DoCompaction(request);
+    frame.clear();
+    PutCompactionWorkerFrame(&frame, kCompactionWorkerResult, result);
+    s = WriteFully(out_fd, frame, false);
+    if (!s.ok()) {
+      break;
+    }
+  }
+  rep_->on_file_finished = nullptr;
+  return s;
+}
+
 const char* RemoteCompactionDispatcher::Name() const {
   return "RemoteCompactionDispatcher";
 }
@@ -1181,4 +1442,176 @@ std::shared_ptr<CompactionDispatcher> NewCommandLineCompactionDispatcher(
   return std::make_shared<CommandLineCompactionDispatcher>(std::move(cmd));
 }
 
+// Keeps up to `max_workers` worker processes alive, each one running
+// `Worker::Serve()` on a unix socket connected to its stdin and stdout. A job
+// is written as one request frame, the worker answers with one frame per
+// finished output file followed by the result frame.
+class PersistentCompactionDispatcher : public RemoteCompactionDispatcher {
+  struct WorkerProcess {
+    pid_t pid = -1;
+    int fd = -1;
+  };
+
+  std::string m_cmd;
+  size_t m_max_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<WorkerProcess> m_idle;
+  size_t m_num_workers = 0;  // idle and busy
+
+  static void Reap(WorkerProcess* worker, bool kill) {
+    ::close(worker->fd);
+    if (kill) {
+      ::kill(worker->pid, SIGKILL);
+    }
+    int status;
+    while (::waitpid(worker->pid, &status, 0) < 0 && errno == EINTR) {
+    }
+  }
+
+  Status Spawn(WorkerProcess* worker) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+      return Status::IOError("CompactionWorker: socketpair", strerror(errno));
+    }
+    pid_t pid = ::fork();
+    if (pid < 0) {
+      int err = errno;
+      ::close(fds[0]);
+      ::close(fds[1]);
+      return Status::IOError("CompactionWorker: fork", strerror(err));
+    }
+    if (pid == 0) {
+      // stderr is inherited for the worker log
+      ::dup2(fds[1], STDIN_FILENO);
+      ::dup2(fds[1], STDOUT_FILENO);
+      ::execl("/bin/sh", "sh", "-c", m_cmd.c_str(), (char*)nullptr);
+      ::_exit(127);
+    }
+    ::close(fds[1]);
+    worker->pid = pid;
+    worker->fd = fds[0];
+    fprintf(stderr, "INFO: PersistentCompactionDispatcher(%s) spawn pid %d\n",
+            m_cmd.c_str(), int(pid));
+    return Status::OK();
+  }
+
+  Status Acquire(WorkerProcess* worker) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      while (!m_idle.empty()) {
+        *worker = m_idle.back();
+        m_idle.pop_back();
+        int status;
+        if (::waitpid(worker->pid, &status, WNOHANG) == 0) {
+          return Status::OK();
+        }
+        // Exited while idle
+        ::close(worker->fd);
+        --m_num_workers;
+      }
+      if (m_num_workers < m_max_workers) {
+        ++m_num_workers;
+        lock.unlock();
+        Status s = Spawn(worker);
+        if (!s.ok()) {
+          lock.lock();
+          --m_num_workers;
+          m_cv.notify_all();
+        }
+        return s;
+      }
+      m_cv.wait(lock);
+    }
+  }
+
+  void Release(WorkerProcess* worker, bool reuse) {
+    if (!reuse) {
+      Reap(worker, true);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (reuse) {
+      m_idle.push_back(*worker);
+    } else {
+      --m_num_workers;
+    }
+    m_cv.notify_all();
+  }
+
+  std::string Run(const std::string& request) {
+    WorkerProcess worker;
+    Status s = Acquire(&worker);
+    std::vector<CompactionWorkerResult::FileInfo> finished;
+    if (s.ok()) {
+      std::string frame;
+      PutCompactionWorkerFrame(&frame, kCompactionWorkerRequest, request);
+      s = WriteFully(worker.fd, frame, true);
+      std::string payload;
+      while (s.ok()) {
+        CompactionWorkerFrameType type;
+        s = ReadFrame(worker.fd, &type, &payload);
+        if (!s.ok()) {
+          break;
+        }
+        if (type == kCompactionWorkerResult) {
+          Release(&worker, true);
+          return payload;
+        } else if (type == kCompactionWorkerFileInfo) {
+          finished.emplace_back();
+          s = DecodeCompactionWorkerFileInfo(payload, &finished.back());
+        } else {
+          s = Status::Corruption("CompactionWorker: unexpected frame");
+        }
+      }
+      Release(&worker, false);
+    }
+    // The worker is gone, report the files it had finished so they can be
+    // told apart from garbage left by the crash
+    std::string detail = s.ToString();
+    detail += ", finished files:";
+    for (auto& f : finished) {
+      detail += ' ';
+      detail += f.file_name;
+    }
+    fprintf(stderr, "ERROR: PersistentCompactionDispatcher(%s) = %s\n",
+            m_cmd.c_str(), detail.c_str());
+    CompactionWorkerResult result;
+    result.status = Status::IOError("CompactionWorker failed", detail);
+    std::string encoded;
+    EncodeCompactionWorkerResult(result, &encoded);
+    return encoded;
+  }
+
+ public:
+  PersistentCompactionDispatcher(std::string&& cmd, size_t max_workers)
+      : m_cmd(std::move(cmd)),
+        m_max_workers(std::max<size_t>(max_workers, 1)) {}
+
+  ~PersistentCompactionDispatcher() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_idle.size() == m_num_workers; });
+    // Workers leave Serve() on EOF
+    for (auto& worker : m_idle) {
+      Reap(&worker, false);
+    }
+  }
+
+  const char* Name() const override {
+    return "PersistentCompactionDispatcher";
+  }
+
+  std::future<std::string> DoCompaction(std::string data) override {
+    return std::async(
+        std::launch::async,
+        [this](const std::string& request) { return Run(request); },
+        std::move(data));
+  }
+};
+
+std::shared_ptr<CompactionDispatcher> NewPersistentCompactionDispatcher(
+    std::string cmd, size_t max_workers) {
+  return std::make_shared<PersistentCompactionDispatcher>(std::move(cmd),
+                                                          max_workers);
+}
+
 }  // namespace TERARKDB_NAMESPACE
@@ -28,6 +28,7 @@ struct CompactionIterationStats {
   // Deletions obsoleted before bottom level due to file gap optimization.
   int64_t num_optimized_del_drop_obsolete = 0;
   uint64_t total_filter_time = 0;
+  uint64_t num_filter_calls = 0;
 
   // Input statistics
   // TODO(noetzli): The stats are incomplete. They are lacking everything
@@ -288,6 +288,7 @@ void CompactionIterator::InvokeFilterIfNeeded(bool* need_skip,
     CompactionFilter::Decision filter;
     compaction_filter_value_.clear();
     compaction_filter_skip_until_.Clear();
+    uint64_t filter_nanos;
     auto doFilter = [&]() {
       filter = compaction_filter_->FilterV2(
           compaction_->level(), ikey_.user_key,
@@ -295,7 +296,13 @@ void CompactionIterator::InvokeFilterIfNeeded(bool* need_skip,
           &compaction_filter_value_, compaction_filter_skip_until_.rep());
     };
     auto sample = filter_sample_interval_;
-    if (env_ && sample && (filter_hit_count_ & (sample - 1)) == 0) {
+    if (parallel_filter_iter_ != nullptr &&
+        parallel_filter_iter_->TakeDecision(
+            &filter, &compaction_filter_value_,
+            compaction_filter_skip_until_.rep(), &filter_nanos)) {
+      // Filtered ahead, every call is timed
+      iter_stats_.total_filter_time += filter_nanos;
+    } else if (env_ && sample && (filter_hit_count_ & (sample - 1)) == 0) {
       StopWatchNano timer(env_, true);
       doFilter();
       iter_stats_.total_filter_time += timer.ElapsedNanos() * sample;
@@ -311,6 +318,7 @@ void CompactionIterator::InvokeFilterIfNeeded(bool* need_skip,
       filter = CompactionFilter::Decision::kKeep;
     }
     ++filter_hit_count_;
+    ++iter_stats_.num_filter_calls;
 
     if (filter == CompactionFilter::Decision::kRemove) {
       // convert the current key to a delete; key_ is pointing into
@@ -334,6 +342,26 @@ void CompactionIterator::InvokeFilterIfNeeded(bool* need_skip,
   }
 }
 
+void CompactionIterator::SetFilterThreads(size_t threads) {
+  assert(!valid_);
+  if (threads == 0 || compaction_filter_ == nullptr ||
+      snapshot_checker_ != nullptr || parallel_filter_iter_ != nullptr) {
+    return;
+  }
+  std::vector<std::unique_ptr<CompactionFilter>> filters(threads);
+  for (auto& filter : filters) {
+    filter.reset(compaction_filter_->Clone());
+    if (filter == nullptr) {
+      return;
+    }
+  }
+  parallel_filter_iter_.reset(new ParallelFilterIterator(
+      input_.iter_, input_.separate_helper(), cmp_, end_, std::move(filters),
+      compaction_->level(), visible_at_tip_ || ignore_snapshots_,
+      latest_snapshot_, env_));
+  input_.iter_ = parallel_filter_iter_.get();
+}
+
 void CompactionIterator::SetFilterSampleInterval(size_t sample_interval) {
   assert((sample_interval & (sample_interval - 1)) == 0);  // must be power of 2
   filter_sample_interval_ = sample_interval;
@@ -919,6 +947,29 @@ void CompactionIterator::PrepareOutput() {
 inline SequenceNumber CompactionIterator::findEarliestVisibleSnapshot(
     SequenceNumber in, SequenceNumber* prev_snapshot) {
   assert(snapshots_->size());
+  if (snapshot_checker_ == nullptr) {
+    // Most versions are older than all snapshots or newer than all of them,
+    // and adjacent versions mostly fall into the same stripe, so the cost
+    // stays flat with the number of snapshots
+    if (in <= earliest_snapshot_) {
+      *prev_snapshot = 0;
+      return earliest_snapshot_;
+    }
+    if (in > latest_snapshot_) {
+      *prev_snapshot = latest_snapshot_;
+      return kMaxSequenceNumber;
+    }
+    if (in <= stripe_upper_ && in > stripe_lower_) {
+      *prev_snapshot = stripe_lower_;
+      return stripe_upper_;
+    }
+    auto it = std::lower_bound(snapshots_->begin(), snapshots_->end(), in);
+    assert(it != snapshots_->begin() && it != snapshots_->end());
+    stripe_lower_ = *std::prev(it);
+    stripe_upper_ = *it;
+    *prev_snapshot = stripe_lower_;
+    return stripe_upper_;
+  }
   auto snapshots_iter =
       std::lower_bound(snapshots_->begin(), snapshots_->end(), in);
   if (snapshots_iter == snapshots_->begin()) {
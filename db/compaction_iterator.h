@@ -12,6 +12,7 @@
 #include "db/compaction.h"
 #include "db/compaction_iteration_stats.h"
 #include "db/merge_helper.h"
+#include "db/parallel_filter_iterator.h"
 #include "db/range_del_aggregator.h"
 #include "db/snapshot_checker.h"
 #include "options/cf_options.h"
@@ -114,6 +115,13 @@ class CompactionIterator {
     track_obsolete_records_flag_ = flag;
   }
 
+  // Run the compaction filter ahead on `threads` clones of it, see
+  // ParallelFilterIterator. Does nothing if the filter can't be cloned or the
+  // visibility of the records depends on a snapshot checker.
+  //
+  // REQUIRED: Call before SeekToFirst(), with the input positioned.
+  void SetFilterThreads(size_t threads);
+
   // Getters
   const Slice& key() const { return key_; }
   const LazyBuffer& value() const { return value_; }
@@ -141,8 +149,9 @@ class CompactionIterator {
   // earliest snapshot that this sequence number is visible in.
   // The snapshots themselves are arranged in ascending order of
   // sequence numbers.
-  // Employ a sequential search because the total number of
-  // snapshots are typically small.
+  // Without a snapshot checker, the answer only depends on the stripe
+  // between two adjacent snapshots the sequence number falls into, which is
+  // cached in stripe_lower_ and stripe_upper_.
   inline SequenceNumber findEarliestVisibleSnapshot(
       SequenceNumber in, SequenceNumber* prev_snapshot);
 
@@ -173,6 +182,10 @@ class CompactionIterator {
   bool visible_at_tip_;
   SequenceNumber earliest_snapshot_;
   SequenceNumber latest_snapshot_;
+  // The sequence numbers in (stripe_lower_, stripe_upper_] are first visible
+  // in snapshot stripe_upper_, the result of the last binary search
+  SequenceNumber stripe_lower_ = 0;
+  SequenceNumber stripe_upper_ = 0;
   bool ignore_snapshots_;
 
   // State
@@ -231,6 +244,7 @@ class CompactionIterator {
   bool do_combine_value_;   // fetch and combine bigvalue from blobs
 
   size_t filter_sample_interval_ = 64;
+  std::unique_ptr<ParallelFilterIterator> parallel_filter_iter_;
   size_t filter_hit_count_ = 0;
   const chash_set<uint64_t>* rebuild_blob_set_;
 
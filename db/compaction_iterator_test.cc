@@ -499,6 +499,97 @@ TEST_P(CompactionIteratorTest, CompactionFilterSkipUntil) {
   ASSERT_EQ(expected_actions, iter_->log);
 }
 
+TEST_P(CompactionIteratorTest, ParallelFilter) {
+  // Removes, changes or skips by the number of the key. The filter given to
+  // the compaction is slow, the keys filtered by its clones come first.
+  class Filter : public CompactionFilter {
+   public:
+    explicit Filter(std::atomic<int>* clone_calls, bool clone = false)
+        : clone_calls_(clone_calls), clone_(clone) {}
+
+    Decision FilterV2(int /*level*/, const Slice& key, ValueType /*t*/,
+                      const Slice& /*existing_value_meta*/,
+                      const LazyBuffer& existing_value, LazyBuffer* new_value,
+                      std::string* skip_until) const override {
+      EXPECT_OK(existing_value.fetch());
+      if (clone_) {
+        clone_calls_->fetch_add(1);
+      } else {
+        Env::Default()->SleepForMicroseconds(1000);
+      }
+      int i = std::stoi(key.ToString().substr(1));
+      if (i % 4 == 0) {
+        return Decision::kRemove;
+      }
+      if (i % 10 == 7) {
+        *skip_until = "k" + ToString(i + 2);
+        return Decision::kRemoveAndSkipUntil;
+      }
+      if (i % 4 == 1) {
+        new_value->reset(existing_value.ToString() + "-changed", true);
+        return Decision::kChangeValue;
+      }
+      return Decision::kKeep;
+    }
+
+    CompactionFilter* Clone() const override {
+      return new Filter(clone_calls_, true);
+    }
+
+    const char* Name() const override {
+      return "CompactionIteratorTest.ParallelFilter::Filter";
+    }
+
+   private:
+    std::atomic<int>* clone_calls_;
+    bool clone_;
+  };
+
+  // Every even key has an older version only visible to the snapshot
+  std::vector<std::string> ks, vs;
+  for (int i = 10; i < 100; ++i) {
+    std::string user_key = "k" + ToString(i);
+    ks.push_back(test::KeyStr(user_key, 100 + i, kTypeValue));
+    vs.push_back("v" + ToString(i));
+    if (i % 2 == 0) {
+      ks.push_back(test::KeyStr(user_key, 40, kTypeValue));
+      vs.push_back("old" + ToString(i));
+    }
+  }
+  AddSnapshot(50);
+
+  std::atomic<int> clone_calls{0};
+  Filter filter(&clone_calls);
+  auto run = [&](size_t threads, uint64_t* filter_calls) {
+    InitIterators(ks, vs, {}, {}, kMaxSequenceNumber, kMaxSequenceNumber,
+                  nullptr, &filter);
+    c_iter_->SetFilterThreads(threads);
+    c_iter_->SeekToFirst();
+    std::vector<std::string> output;
+    for (; c_iter_->Valid(); c_iter_->Next()) {
+      EXPECT_OK(c_iter_->value().fetch());
+      output.push_back(c_iter_->key().ToString() + "=" +
+                       c_iter_->value().ToString());
+    }
+    EXPECT_OK(c_iter_->status());
+    *filter_calls = c_iter_->iter_stats().num_filter_calls;
+    return output;
+  };
+
+  uint64_t inline_calls, parallel_calls;
+  auto expected = run(0, &inline_calls);
+  ASSERT_EQ(0, clone_calls.load());
+  auto output = run(3, &parallel_calls);
+  ASSERT_EQ(expected, output);
+  ASSERT_EQ(inline_calls, parallel_calls);
+  if (GetParam()) {
+    // Not with a snapshot checker
+    ASSERT_EQ(0, clone_calls.load());
+  } else {
+    ASSERT_GT(clone_calls.load(), 0);
+  }
+}
+
 TEST_P(CompactionIteratorTest, ShuttingDownInFilter) {
   NoMergingMergeOp merge_op;
   StallingFilter filter;
@@ -705,6 +796,26 @@ TEST_P(CompactionIteratorTest, ZeroOutSequenceAtBottomLevel) {
           true /*bottommost_level*/);
 }
 
+TEST_P(CompactionIteratorTest, ManySnapshots) {
+  for (SequenceNumber s = 10; s <= 10000; s += 10) {
+    AddSnapshot(s);
+  }
+  // Versions before the earliest and after the latest snapshot, and b@24 in
+  // the stripe looked up for a@24
+  RunTest({test::KeyStr("a", 25, kTypeValue), test::KeyStr("a", 24, kTypeValue),
+           test::KeyStr("a", 15, kTypeValue), test::KeyStr("b", 24, kTypeValue),
+           test::KeyStr("b", 21, kTypeValue),
+           test::KeyStr("c", 10005, kTypeValue),
+           test::KeyStr("c", 10001, kTypeValue),
+           test::KeyStr("c", 3, kTypeValue), test::KeyStr("c", 2, kTypeValue)},
+          {"a25", "a24", "a15", "b24", "b21", "c10005", "c10001", "c3", "c2"},
+          {test::KeyStr("a", 25, kTypeValue), test::KeyStr("a", 15, kTypeValue),
+           test::KeyStr("b", 24, kTypeValue),
+           test::KeyStr("c", 10005, kTypeValue),
+           test::KeyStr("c", 3, kTypeValue)},
+          {"a25", "a15", "b24", "c10005", "c3"});
+}
+
 // In bottommost level, deletions earlier than earliest snapshot can be removed
 // permanently.
 TEST_P(CompactionIteratorTest, RemoveDeletionAtBottomLevel) {
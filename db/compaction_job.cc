@@ -59,12 +59,15 @@
 #include "db/range_del_aggregator.h"
 #include "db/version_edit.h"
 #include "db/version_set.h"
+#include "monitoring/cpu_attribution.h"
+#include "monitoring/io_attribution.h"
 #include "monitoring/iostats_context_imp.h"
 #include "monitoring/thread_status_util.h"
 #include "port/port.h"
 #include "rocksdb/db.h"
 #include "rocksdb/env.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/status.h"
 #include "rocksdb/table.h"
@@ -145,6 +148,12 @@ const char* GetCompactionReasonString(CompactionReason compaction_reason) {
       return "GarbageCollectionMarkedForHigh";
     case CompactionReason::kRangeDeletion:
       return "RangeDeletion";
+    case CompactionReason::kUniversalTimeWindow:
+      return "UniversalTimeWindow";
+    case CompactionReason::kBlobDefragment:
+      return "BlobDefragment";
+    case CompactionReason::kPathMigration:
+      return "PathMigration";
     case CompactionReason::kZNSGarbageCollection:
       return "ZNSGarbageCollectioin";
     case CompactionReason::kZNSHotGarbageCollection:
@@ -275,6 +284,11 @@ struct CompactionJob::SubcompactionState {
   // A flag determine whether the key has been seen in ShouldStopBefore()
   bool seen_key = false;
   std::string compression_dict;
+  // Sampled from the values of the first blob output, for the blob outputs
+  // opened after it, see blob_compression_per_record
+  std::string blob_compression_dict;
+  std::string blob_dict_samples;
+  std::vector<size_t> blob_dict_sample_lens;
 
   SubcompactionState(Compaction* c, const Slice* _start, const Slice* _end,
                      uint64_t size = 0)
@@ -320,6 +334,9 @@ struct CompactionJob::SubcompactionState {
     overlapped_bytes = std::move(o.overlapped_bytes);
     seen_key = std::move(o.seen_key);
     compression_dict = std::move(o.compression_dict);
+    blob_compression_dict = std::move(o.blob_compression_dict);
+    blob_dict_samples = std::move(o.blob_dict_samples);
+    blob_dict_sample_lens = std::move(o.blob_dict_sample_lens);
     return *this;
   }
 
@@ -766,7 +783,9 @@ CompactionJob::CompactionJob(
       bottommost_level_(false),
       paranoid_file_checks_(paranoid_file_checks),
       measure_io_stats_(measure_io_stats),
-      write_hint_(Env::WLTH_NOT_SET) {
+      write_hint_(Env::WLTH_NOT_SET),
+      write_controller_(nullptr),
+      output_gc_generation_(0) {
   assert(log_buffer_ != nullptr);
   const auto* cfd = compact_->compaction->column_family_data();
   ThreadStatusUtil::SetColumnFamily(cfd, cfd->ioptions()->env,
@@ -832,6 +851,25 @@ int CompactionJob::Prepare(int sub_compaction_slots) {
              compact_->compaction->level()) > 0);
   write_hint_ =
       c->column_family_data()->CalculateSSTWriteHint(c->output_level());
+  write_controller_ = c->column_family_data()->cf_write_controller();
+  if (write_controller_ == nullptr) {
+    write_controller_ = versions_->GetColumnFamilySet()->write_controller();
+  }
+  // Blobs rewritten by GC are one generation older than their inputs
+  if (c->compaction_type() == kGarbageCollection) {
+    auto& file_map = c->input_version()->storage_info()->dependence_multi_map();
+    uint32_t max_generation = 0;
+    for (auto& level_files : *c->inputs()) {
+      for (auto f : level_files.files) {
+        uint32_t generation = 0;
+        if (file_map != nullptr &&
+            file_map->QueryGeneration(f->fd.GetNumber(), &generation).ok()) {
+          max_generation = std::max(max_generation, generation);
+        }
+      }
+    }
+    output_gc_generation_ = max_generation + 1;
+  }
   // Is this compaction producing files at the bottommost level?
   bottommost_level_ = c->bottommost_level();
 
@@ -864,6 +902,20 @@ int CompactionJob::Prepare(int sub_compaction_slots) {
       }
       compact_->sub_compact_states.emplace_back(c, start, end);
     }
+  } else if (c->compaction_type() == kGarbageCollection &&
+             (c->sub_compaction_type() == kKeyValueCompaction ||
+              c->sub_compaction_type() == kBlobDefragment) &&
+             c->max_subcompactions() > 1 && sub_compaction_slots > 0) {
+    GenGarbageCollectionBoundaries(sub_compaction_slots + 1);
+    assert(sizes_.size() == boundaries_.size() + 1);
+
+    for (size_t i = 0; i <= boundaries_.size(); i++) {
+      Slice* start = i == 0 ? nullptr : &boundaries_[i - 1];
+      Slice* end = i == boundaries_.size() ? nullptr : &boundaries_[i];
+      compact_->sub_compact_states.emplace_back(c, start, end, sizes_[i]);
+    }
+    MeasureTime(stats_, NUM_SUBCOMPACTIONS_SCHEDULED,
+                compact_->sub_compact_states.size());
   } else if (c->ShouldFormSubcompactions()) {
     const uint64_t start_micros = env_->NowMicros();
     GenSubcompactionBoundaries(sub_compaction_slots + 1);
@@ -959,6 +1011,9 @@ void CompactionJob::GenSubcompactionBoundaries(int max_usable_threads) {
       }
     }
   }
+  // File boundaries can't cut inside a file, while the bytes of a map SST or
+  // of the blobs of a KV separated SST often sit in a few of them
+  SampleSubcompactionBounds(max_usable_threads, &bounds);
   terark::sort_a(bounds, &ExtractUserKey < *cfd_comparator);
 
   // Remove duplicated entries from bounds
@@ -1034,10 +1089,247 @@ void CompactionJob::GenSubcompactionBoundaries(int max_usable_threads) {
   }
 }
 
+void CompactionJob::SampleSubcompactionBounds(int max_usable_threads,
+                                              std::vector<Slice>* bounds) {
+  // Enough candidates for each subcompaction to end within a few percent of
+  // its share
+  const size_t kSamplesPerSubcompaction = 32;
+  auto* c = compact_->compaction;
+  auto* cfd = c->column_family_data();
+  auto* vstorage = c->input_version()->storage_info();
+  auto& dependence_map = vstorage->dependence_map();
+
+  // The tables holding the input records, with their bytes. A map SST holds
+  // none, the tables it points to do.
+  std::vector<std::pair<const FileMetaData*, uint64_t>> tables;
+  uint64_t total_size = 0;
+  chash_set<uint64_t> visited;
+  auto add_table = [&](const FileMetaData* f, double ratio) {
+    if (!visited.emplace(f->fd.GetNumber()).second) {
+      return;
+    }
+    uint64_t size = vstorage->FileSizeWithBlob(f, true, ratio);
+    tables.emplace_back(f, size);
+    total_size += size;
+  };
+  for (auto& level_inputs : *c->inputs()) {
+    for (auto f : level_inputs.files) {
+      if (!f->prop.is_map_sst()) {
+        add_table(f, 1);
+        continue;
+      }
+      for (auto& dependence : f->prop.dependence) {
+        auto find = dependence_map.find(dependence.file_number);
+        if (find != dependence_map.end()) {
+          const FileMetaData* d = find->second;
+          add_table(d, d->prop.num_entries == 0
+                           ? 1
+                           : double(dependence.entry_count) /
+                                 d->prop.num_entries);
+        }
+      }
+    }
+  }
+  if (total_size == 0) {
+    return;
+  }
+
+  const size_t budget =
+      kSamplesPerSubcompaction *
+      std::min<size_t>(std::max(max_usable_threads, 1),
+                       std::max<uint32_t>(c->max_subcompactions(), 1));
+  auto* table_cache = cfd->table_cache();
+  auto* prefix_extractor = c->mutable_cf_options()->prefix_extractor.get();
+  // Opening the tables may read their index, don't hold the db mutex
+  db_mutex_->Unlock();
+  for (auto& table : tables) {
+    size_t limit =
+        static_cast<size_t>(double(budget) * table.second / total_size);
+    if (limit == 0) {
+      continue;
+    }
+    const FileMetaData* f = table.first;
+    TableReader* reader = f->fd.table_reader;
+    Cache::Handle* handle = nullptr;
+    if (reader == nullptr) {
+      if (!table_cache->FindTable(env_options_, f->fd, &handle,
+                                  prefix_extractor)
+               .ok()) {
+        continue;
+      }
+      reader = table_cache->GetTableReaderFromHandle(handle);
+    }
+    reader->GetSampleKeys(limit, &sampled_bounds_);
+    if (handle != nullptr) {
+      table_cache->ReleaseHandle(handle);
+    }
+  }
+  db_mutex_->Lock();
+  // sampled_bounds_ is complete, the slices stay valid
+  for (auto& key : sampled_bounds_) {
+    bounds->emplace_back(key);
+  }
+}
+
+// Blob files picked by GC are not range partitioned. Split the key space at
+// the smallest and largest key of every input blob file, and assume that the
+// bytes of a blob file spread evenly over the pieces it covers.
+void CompactionJob::GenGarbageCollectionBoundaries(int max_usable_threads) {
+  auto* c = compact_->compaction;
+  const Comparator* ucmp = c->column_family_data()->user_comparator();
+  std::vector<Slice> bounds;
+  uint64_t sum = 0;
+  for (auto& level_files : *c->inputs()) {
+    for (auto f : level_files.files) {
+      bounds.emplace_back(f->smallest.user_key());
+      bounds.emplace_back(f->largest.user_key());
+      sum += f->fd.GetFileSize();
+    }
+  }
+  auto less = [ucmp](const Slice& a, const Slice& b) {
+    return ucmp->Compare(a, b) < 0;
+  };
+  std::sort(bounds.begin(), bounds.end(), less);
+  bounds.erase(std::unique(bounds.begin(), bounds.end(),
+                           [ucmp](const Slice& a, const Slice& b) {
+                             return ucmp->Compare(a, b) == 0;
+                           }),
+               bounds.end());
+  if (bounds.size() < 2) {
+    sizes_.emplace_back(sum);
+    return;
+  }
+
+  // piece i is [bounds[i], bounds[i + 1])
+  std::vector<uint64_t> piece_sizes(bounds.size() - 1, 0);
+  auto lower_bound = [&](const Slice& key) {
+    return size_t(std::lower_bound(bounds.begin(), bounds.end(), key, less) -
+                  bounds.begin());
+  };
+  for (auto& level_files : *c->inputs()) {
+    for (auto f : level_files.files) {
+      size_t lo = lower_bound(f->smallest.user_key());
+      size_t hi = lower_bound(f->largest.user_key());
+      lo = std::min(lo, piece_sizes.size() - 1);
+      hi = std::max(hi, lo + 1);
+      uint64_t size = f->fd.GetFileSize() / (hi - lo);
+      for (size_t i = lo; i < hi; ++i) {
+        piece_sizes[i] += size;
+      }
+    }
+  }
+
+  auto* ioptions = c->immutable_cf_options();
+  uint64_t max_output_files = static_cast<uint64_t>(std::ceil(
+      1.0 * sum /
+      std::max<uint64_t>(1, MaxBlobSize(*c->mutable_cf_options(),
+                                        ioptions->num_levels,
+                                        ioptions->compaction_style))));
+  int subcompactions =
+      std::min({max_usable_threads, static_cast<int>(piece_sizes.size()),
+                static_cast<int>(c->max_subcompactions()),
+                static_cast<int>(max_output_files)});
+
+  if (subcompactions > 1) {
+    double mean = sum * 1.0 / subcompactions;
+    sum = 0;
+    for (size_t i = 0; i < piece_sizes.size() - 1; i++) {
+      sum += piece_sizes[i];
+      if (subcompactions == 1) {
+        continue;
+      }
+      if (sum >= mean) {
+        boundaries_.emplace_back(bounds[i + 1]);
+        sizes_.emplace_back(sum);
+        subcompactions--;
+        sum = 0;
+      }
+    }
+    sizes_.emplace_back(sum + piece_sizes.back());
+  } else {
+    sizes_.emplace_back(sum);
+  }
+}
+
+namespace {
+
+// The thresholds of adaptive_blob_separation are this many times larger for
+// hot key ranges and smaller for cold ones
+const size_t kAdaptiveBlobSizeFactor = 4;
+// Not below this, the blob index would save little of a smaller value
+const size_t kMinAdaptiveBlobSize = 64;
+// A key range is cold with fewer sampled writes per entry than this
+const double kColdWritesPerEntry = 1.0 / 64;
+
+// The separation thresholds of the inputs of `c` in the user key range
+// [start, end), nullptr for unbounded. The sampled writes of the key range
+// heatmap per input entry tell how often the keys are overwritten before a
+// compaction reaches them again.
+BlobConfig GetBlobConfig(const Compaction* c, const Slice* start,
+                         const Slice* end) {
+  BlobConfig blob_config = c->mutable_cf_options()->get_blob_config();
+  if (!c->mutable_cf_options()->adaptive_blob_separation ||
+      blob_config.blob_size == size_t(-1)) {
+    return blob_config;
+  }
+  auto ucmp = c->column_family_data()->user_comparator();
+  auto& dependence_map = c->input_version()->storage_info()->dependence_map();
+  uint64_t writes = 0, entries = 0;
+  for (auto& level_files : *c->inputs()) {
+    for (auto f : level_files.files) {
+      if ((start != nullptr &&
+           ucmp->Compare(f->largest.user_key(), *start) < 0) ||
+          (end != nullptr &&
+           ucmp->Compare(f->smallest.user_key(), *end) >= 0)) {
+        continue;
+      }
+      writes += f->stats.num_writes_sampled.load(std::memory_order_relaxed);
+      if (!f->prop.is_map_sst()) {
+        entries += f->prop.num_entries;
+        continue;
+      }
+      // The writes are charged to the map SST, the entries are the ones of
+      // the key SSTs it links
+      for (auto& dependence : f->prop.dependence) {
+        auto find = dependence_map.find(dependence.file_number);
+        if (find != dependence_map.end() &&
+            find->second->prop.purpose == kEssenceSst) {
+          entries += dependence.entry_count;
+        }
+      }
+    }
+  }
+  if (entries == 0) {
+    return blob_config;
+  }
+  double writes_per_entry = 1.0 * writes / entries;
+  if (writes_per_entry >= 1) {
+    // Most values are overwritten soon, their blobs would only be garbage
+    if (blob_config.blob_size < size_t(-1) / kAdaptiveBlobSizeFactor) {
+      blob_config.blob_size *= kAdaptiveBlobSizeFactor;
+    }
+  } else if (writes_per_entry < kColdWritesPerEntry) {
+    blob_config.blob_size =
+        std::max(std::min(blob_config.blob_size, kMinAdaptiveBlobSize),
+                 blob_config.blob_size / kAdaptiveBlobSizeFactor);
+    blob_config.large_key_ratio =
+        std::min(1.0, blob_config.large_key_ratio * kAdaptiveBlobSizeFactor);
+  }
+  return blob_config;
+}
+
+}  // namespace
+
 static std::shared_ptr<CompactionDispatcher> GetCmdLineDispatcher() {
   const char* cmdline = getenv("TerarkDB_compactionWorkerCommandLine");
   if (cmdline) {
 #ifdef WITH_TERARK_ZIP
+    // A positive pool size keeps that many workers alive between jobs, the
+    // command line must run the worker in serve mode then
+    const char* pool_size = getenv("TerarkDB_compactionWorkerPoolSize");
+    if (pool_size && atoi(pool_size) > 0) {
+      return NewPersistentCompactionDispatcher(cmdline, atoi(pool_size));
+    }
     return NewCommandLineCompactionDispatcher(cmdline);
 #endif
   }
@@ -1060,6 +1352,14 @@ Status CompactionJob::Run() {
   if (!dispatcher || c->compaction_type() != kKeyValueCompaction) {
     return RunSelf();
   }
+  auto remote_scheduler = cfd->remote_compaction_scheduler();
+  const uint64_t total_input_size = c->CalculateTotalInputSize();
+  if (!remote_scheduler->ShouldDispatch(
+          c->start_level(), total_input_size,
+          c->mutable_cf_options()->remote_compaction_min_input_size,
+          c->mutable_cf_options()->remote_compaction_max_pending_jobs)) {
+    return RunSelf();
+  }
   Status s;
   const ImmutableCFOptions* iopt = c->immutable_cf_options();
   CompactionWorkerContext context;
@@ -1110,7 +1410,7 @@ Status CompactionJob::Run() {
     }
     context.compaction_filter_factory = factory->Name();
   }
-  context.blob_config = c->mutable_cf_options()->get_blob_config();
+  context.blob_config = GetBlobConfig(c, nullptr, nullptr);
   context.separation_type = c->separation_type();
   context.table_factory = iopt->table_factory->Name();
   s = iopt->table_factory->GetOptionString(&context.table_factory_options,
@@ -1143,6 +1443,24 @@ Status CompactionJob::Run() {
       context.inputs.emplace_back(files.level, f->fd.GetNumber());
     }
   }
+  // Tables already open here tell the worker the size of their metadata, the
+  // worker then reads it with a single request instead of probing the tail
+  for (auto& pair : context.file_metadata) {
+    std::shared_ptr<const TableProperties> tp;
+    auto& fd = pair.second.fd;
+    if (cfd->table_cache()
+            ->GetTableProperties(
+                env_options_, pair.second, &tp,
+                c->mutable_cf_options()->prefix_extractor.get(),
+                true /* no_io */)
+            .ok() &&
+        tp != nullptr && tp->data_size > 0 && tp->data_size < fd.file_size) {
+      context.table_tail_sizes.emplace_back(fd.GetNumber(),
+                                            fd.file_size - tp->data_size);
+    }
+  }
+  context.compaction_readahead_size =
+      env_options_for_read_.compaction_readahead_size;
   context.cf_name = cfd->GetName();
   context.target_file_size = c->max_output_file_size();
   context.compression = c->output_compression();
@@ -1173,6 +1491,9 @@ Status CompactionJob::Run() {
         {collector->Name(), {std::move(param)}});
   }
   std::vector<std::function<CompactionWorkerResult()>> results_fn;
+  const uint64_t sub_input_size =
+      total_input_size / compact_->sub_compact_states.size();
+  const uint64_t dispatch_micros = env_->NowMicros();
   for (const auto& state : compact_->sub_compact_states) {
     if (state.start != nullptr) {
       context.has_start = true;
@@ -1188,16 +1509,30 @@ Status CompactionJob::Run() {
       context.has_end = false;
       context.end.clear();
     }
+    remote_scheduler->Start(sub_input_size);
     results_fn.emplace_back(dispatcher->StartCompaction(context));
   }
   Status status = Status::Corruption();
   for (size_t i = 0; i < compact_->sub_compact_states.size(); ++i) {
     auto& sub_compact = compact_->sub_compact_states[i];
     CompactionWorkerResult result;
+    // Accounts the job even if fetching its result throws
+    struct RemoteJobGuard {
+      RemoteCompactionScheduler* scheduler;
+      uint64_t input_size;
+      uint64_t start_micros;
+      Env* env;
+      bool ok;
+      ~RemoteJobGuard() {
+        scheduler->Finish(input_size, env->NowMicros() - start_micros, ok);
+      }
+    } remote_job{remote_scheduler, sub_input_size, dispatch_micros, env_,
+                 false};
 #if defined(NDEBUG)
     try {
 #endif
       result = results_fn[i]();
+      remote_job.ok = result.status.ok();
       sub_compact.status = std::move(result.status);
       s = sub_compact.status;
       if (s.ok()) {
@@ -1257,6 +1592,13 @@ Status CompactionJob::Run() {
                 tp->user_collected_properties,
                 &output.meta.prop.earliest_time_begin_compact,
                 &output.meta.prop.latest_time_end_compact);
+            output.meta.prop.latest_time_expire =
+                GetLatestTimeExpire(tp->user_collected_properties);
+            if (iopt->ttl_extractor_factory->BoundedByInputs()) {
+              output.meta.prop.latest_time_expire =
+                  std::min(output.meta.prop.latest_time_expire,
+                           c->InputLatestTimeExpire());
+            }
             ROCKS_LOG_INFO(
                 db_options_.info_log,
                 "CompactionOutput earliest_time_begin_compact = %" PRIu64
@@ -1300,9 +1642,22 @@ Status CompactionJob::Run() {
     }
 #endif
   }
+  auto remote_stats = remote_scheduler->GetStats();
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "[%s] [JOB %d] remote compaction pending %" PRIu64
+                 " jobs %" PRIu64 " bytes, avg latency %.3f sec %.1f MB/sec, "
+                 "failed %" PRIu64 ", local fallbacks %" PRIu64,
+                 cfd->GetName().c_str(), job_id_, remote_stats.pending_jobs,
+                 remote_stats.pending_bytes,
+                 remote_stats.avg_latency_us / 1e6,
+                 remote_stats.avg_bytes_per_sec / 1048576,
+                 remote_stats.failed_jobs, remote_stats.local_fallbacks);
   if (status.ok()) {
     status = VerifyFiles();
   }
+  if (status.ok()) {
+    WarmUpBlockCache();
+  }
   return status;
 }
 
@@ -1357,6 +1712,9 @@ Status CompactionJob::RunSelf() {
   if (status.ok()) {
     status = VerifyFiles();
   }
+  if (status.ok()) {
+    WarmUpBlockCache();
+  }
 
   // Finish up all book-keeping to unify the subcompaction results
   AggregateStatistics();
@@ -1446,6 +1804,105 @@ Status CompactionJob::VerifyFiles() {
   return s;
 }
 
+void CompactionJob::WarmUpBlockCache() {
+  if (!db_options_.warm_block_cache_after_compaction ||
+      db_options_.hot_block_sample_interval == 0 ||
+      compact_->compaction->compaction_type() != kKeyValueCompaction) {
+    return;
+  }
+  // Blocks taken from every input table
+  const size_t kMaxHotBlocksPerInput = 64;
+  ColumnFamilyData* cfd = compact_->compaction->column_family_data();
+  TableCache* table_cache = cfd->table_cache();
+  auto prefix_extractor =
+      compact_->compaction->mutable_cf_options()->prefix_extractor.get();
+  auto& dependence_map =
+      compact_->compaction->input_version()->storage_info()->dependence_map();
+
+  std::vector<std::string> hot_keys;
+  chash_set<uint64_t> visited;
+  auto collect_hot_keys = [&](const FileMetaData* f) {
+    if (!visited.emplace(f->fd.GetNumber()).second) {
+      return;
+    }
+    TableReader* reader = f->fd.table_reader;
+    Cache::Handle* handle = nullptr;
+    if (reader == nullptr) {
+      // A table not open has no reads sampled
+      if (!table_cache
+               ->FindTable(env_options_, f->fd, &handle, prefix_extractor,
+                           true /* no_io */)
+               .ok()) {
+        return;
+      }
+      reader = table_cache->GetTableReaderFromHandle(handle);
+    }
+    reader->GetHotBlockKeys(kMaxHotBlocksPerInput, &hot_keys);
+    if (handle != nullptr) {
+      table_cache->ReleaseHandle(handle);
+    }
+  };
+  for (auto& level_inputs : *compact_->compaction->inputs()) {
+    for (auto f : level_inputs.files) {
+      collect_hot_keys(f);
+      // Reads of map and link SSTs are sampled by the tables they point to
+      for (auto& dependence : f->prop.dependence) {
+        auto find = dependence_map.find(dependence.file_number);
+        if (find != dependence_map.end()) {
+          collect_hot_keys(find->second);
+        }
+      }
+    }
+  }
+  if (hot_keys.empty()) {
+    return;
+  }
+  const InternalKeyComparator& icmp = cfd->internal_comparator();
+  const Comparator* ucmp = icmp.user_comparator();
+  std::sort(hot_keys.begin(), hot_keys.end(),
+            [&](const std::string& a, const std::string& b) {
+              return icmp.Compare(a, b) < 0;
+            });
+
+  size_t num_keys = 0;
+  std::vector<std::string> keys;
+  for (auto& state : compact_->sub_compact_states) {
+    for (auto& output : state.outputs) {
+      const FileMetaData& meta = output.meta;
+      auto it = std::lower_bound(
+          hot_keys.begin(), hot_keys.end(), meta.smallest.user_key(),
+          [&](const std::string& key, const Slice& user_key) {
+            return ucmp->Compare(ExtractUserKey(key), user_key) < 0;
+          });
+      keys.clear();
+      for (; it != hot_keys.end() &&
+             ucmp->Compare(ExtractUserKey(*it), meta.largest.user_key()) <= 0;
+           ++it) {
+        keys.emplace_back(*it);
+      }
+      if (keys.empty()) {
+        continue;
+      }
+      Cache::Handle* handle = nullptr;
+      if (!table_cache
+               ->FindTable(env_options_, meta.fd, &handle, prefix_extractor)
+               .ok()) {
+        continue;
+      }
+      if (table_cache->GetTableReaderFromHandle(handle)
+              ->WarmUpBlocks(keys)
+              .ok()) {
+        num_keys += keys.size();
+      }
+      table_cache->ReleaseHandle(handle);
+    }
+  }
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "[%s] [JOB %d] Warmed up the block cache with %" ROCKSDB_PRIszt
+                 " of %" ROCKSDB_PRIszt " hot blocks of the inputs",
+                 cfd->GetName().c_str(), job_id_, num_keys, hot_keys.size());
+}
+
 Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
   AutoThreadOperationStageUpdater stage_updater(
       ThreadStatus::STAGE_COMPACTION_INSTALL);
@@ -1544,6 +2001,29 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
 
 void CompactionJob::ProcessCompaction(SubcompactionState* sub_compact) {
   // SetThreadSched(kSchedIdle);
+  const uint64_t start_micros = env_->NowMicros();
+  // Subcompactions run on threads of their own
+  IOJobScope io_job_scope(
+      sub_compact->compaction->compaction_type() == kGarbageCollection
+          ? IOJobKind::kGC
+          : IOJobKind::kCompaction);
+  CpuJobKind cpu_job = CpuJobKind::kCompaction;
+  if (sub_compact->compaction->compaction_type() == kGarbageCollection) {
+    switch (sub_compact->compaction->compaction_reason()) {
+      case CompactionReason::kZNSGarbageCollection:
+      case CompactionReason::kZNSPartitionGarbageCollection:
+      case CompactionReason::kZNSHotGarbageCollection:
+      case CompactionReason::kZNSWarmGarbageCollection:
+        cpu_job = CpuJobKind::kZoneMigration;
+        break;
+      default:
+        cpu_job = CpuJobKind::kGC;
+        break;
+    }
+  }
+  CpuJobScope cpu_job_scope(
+      cpu_job,
+      sub_compact->compaction->column_family_data()->cpu_attribution());
   switch (sub_compact->compaction->compaction_type()) {
     case kKeyValueCompaction:
       ProcessKeyValueCompaction(sub_compact);
@@ -1552,6 +2032,8 @@ void CompactionJob::ProcessCompaction(SubcompactionState* sub_compact) {
       assert(false);
       break;
     case kGarbageCollection: {
+      // Blob migration is throttled as GC I/O by zone aware rate limiters
+      GCIOScope gc_io_scope;
       // We use sub_compaction_type to distinguish different garbage collection
       // tasks
       auto sub_c_type = sub_compact->compaction->sub_compaction_type();
@@ -1569,9 +2051,39 @@ void CompactionJob::ProcessCompaction(SubcompactionState* sub_compact) {
       assert(false);
       break;
   }
+  uint64_t elapsed_micros =
+      std::max<uint64_t>(1, env_->NowMicros() - start_micros);
+  uint64_t write_rate = static_cast<uint64_t>(
+      sub_compact->total_bytes * 1000000.0 / elapsed_micros);
+  sub_compact->compaction_job_stats.num_subcompactions = 1;
+  sub_compact->compaction_job_stats.min_subcompaction_write_rate = write_rate;
+  sub_compact->compaction_job_stats.max_subcompaction_write_rate = write_rate;
   // SetThreadSched(kSchedOther);
 }
 
+bool CompactionJob::CanPreempt() const {
+  // Only the map SST installation of InstallCompactionResults() keeps the
+  // inputs left out of the compacted ranges
+  Compaction* c = compact_->compaction;
+  const ImmutableCFOptions* iopt = c->immutable_cf_options();
+  return c->compaction_type() == kKeyValueCompaction &&
+         !c->partial_compaction() &&
+         (!c->input_range().empty() || iopt->enable_lazy_compaction ||
+          iopt->compaction_dispatcher != nullptr);
+}
+
+bool CompactionJob::ShouldPreempt() const {
+  if (shutting_down_->load(std::memory_order_relaxed)) {
+    return true;
+  }
+  // Compactions of L0 relieve the stall, and manual compactions keep going
+  // until their range is done
+  const Compaction* c = compact_->compaction;
+  return c->start_level() > 0 && !c->is_manual_compaction() &&
+         write_controller_ != nullptr &&
+         (write_controller_->IsStopped() || write_controller_->NeedsDelay());
+}
+
 void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
   assert(sub_compact != nullptr);
   // Measurement of Key SST Compaction work
@@ -1646,13 +2158,18 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
         sub_compact->compaction->CreateCompactionFilter();
     compaction_filter = compaction_filter_from_factory.get();
   }
+  // A preemptible job doesn't abort on shutdown, it stops at the end of the
+  // current output file and installs the finished files
+  const bool can_preempt = CanPreempt();
+  const std::atomic<bool>* shutting_down =
+      can_preempt ? nullptr : shutting_down_;
   MergeHelper merge(
       env_, cfd->user_comparator(), cfd->ioptions()->merge_operator,
       compaction_filter, db_options_.info_log.get(),
       false /* internal key corruption is expected */,
       existing_snapshots_.empty() ? 0 : existing_snapshots_.back(),
       snapshot_checker_, compact_->compaction->level(),
-      db_options_.statistics.get(), shutting_down_);
+      db_options_.statistics.get(), shutting_down);
 
   struct BuilderSeparateHelper : public SeparateHelper {
     SeparateHelper* separate_helper = nullptr;
@@ -1712,6 +2229,7 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
       s = blob_builder->Add(key, value);
     }
     if (s.ok()) {
+      SampleBlobValue(sub_compact, value);
       blob_meta->UpdateBoundaries(key, GetInternalKeySeqno(key));
       s = SeparateHelper::TransToSeparate(
           key, value, blob_meta->fd.GetNumber(), Slice(),
@@ -1733,6 +2251,7 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
 
   const Slice* start = sub_compact->start;
   const Slice* end = sub_compact->end;
+  BlobConfig blob_config = GetBlobConfig(sub_compact->compaction, start, end);
   if (start != nullptr) {
     sub_compact->actual_start.SetMinPossibleForUserKey(*start);
     input->Seek(sub_compact->actual_start.Encode());
@@ -1764,13 +2283,13 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
       versions_->LastSequence(), &existing_snapshots_,
       earliest_write_conflict_snapshot_, snapshot_checker_, env_,
       ShouldReportDetailedTime(env_, stats_), false, &range_del_agg,
-      sub_compact->compaction, mutable_cf_options->get_blob_config(),
-      compaction_filter, shutting_down_, preserve_deletes_seqnum_,
-      &rebuild_blobs_info.blobs));
+      sub_compact->compaction, blob_config, compaction_filter, shutting_down,
+      preserve_deletes_seqnum_, &rebuild_blobs_info.blobs));
   auto c_iter = sub_compact->c_iter.get();
   // (ZNS): This is a compaction job, we need it to gather the obsolete
   // information. Set the flag before it seeks to the first element
   c_iter->SetTrackObsoleteRecordsFlag(true);
+  c_iter->SetFilterThreads(mutable_cf_options->compaction_filter_threads);
   c_iter->SeekToFirst();
 
   struct SecondPassIterStorage {
@@ -1813,7 +2332,7 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
         false /* internal key corruption is expected */,
         existing_snapshots_.empty() ? 0 : existing_snapshots_.back(),
         snapshot_checker_, compact_->compaction->level(),
-        db_options_.statistics.get(), shutting_down_);
+        db_options_.statistics.get(), shutting_down);
     second_pass_iter_storage.input.reset(versions_->MakeInputIterator(
         sub_compact->compaction, range_del_agg_ptr, env_options_for_read_));
     return new CompactionIterator(
@@ -1821,8 +2340,8 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
         cfd->user_comparator(), merge_ptr, versions_->LastSequence(),
         &existing_snapshots_, earliest_write_conflict_snapshot_,
         snapshot_checker_, env_, false, false, range_del_agg_ptr,
-        sub_compact->compaction, mutable_cf_options->get_blob_config(),
-        second_pass_iter_storage.compaction_filter, shutting_down_,
+        sub_compact->compaction, blob_config,
+        second_pass_iter_storage.compaction_filter, shutting_down,
         preserve_deletes_seqnum_, &rebuild_blobs_info.blobs);
   };
   std::unique_ptr<InternalIterator> second_pass_iter(
@@ -2020,6 +2539,19 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
         }
         break;
       }
+      if (status.ok() && can_preempt && next_key != nullptr &&
+          ShouldPreempt()) {
+        // Install the finished outputs, the rest of the range stays in the
+        // map SST for a later compaction
+        sub_compact->actual_end.SetMinPossibleForUserKey(
+            ExtractUserKey(*next_key));
+        ROCKS_LOG_INFO(db_options_.info_log,
+                       "[%s] [JOB %d] Compaction preempted before %s",
+                       cfd->GetName().c_str(), job_id_,
+                       sub_compact->actual_end.DebugString(true).c_str());
+        TEST_SYNC_POINT("CompactionJob::ProcessKeyValueCompaction:Preempted");
+        break;
+      }
       sub_compact->overlapped_bytes = 0;
       if (sub_compact->outputs.size() == 1) {
         // Use samples from first output file to create dictionary for
@@ -2045,6 +2577,10 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
       c_iter_stats.num_single_del_fallthru;
   sub_compact->compaction_job_stats.num_single_del_mismatch =
       c_iter_stats.num_single_del_mismatch;
+  sub_compact->compaction_job_stats.num_filter_calls =
+      c_iter_stats.num_filter_calls;
+  sub_compact->compaction_job_stats.total_filter_nanos =
+      c_iter_stats.total_filter_time;
   sub_compact->compaction_job_stats.total_input_raw_key_bytes +=
       c_iter_stats.total_input_raw_key_bytes;
   sub_compact->compaction_job_stats.total_input_raw_value_bytes +=
@@ -2076,7 +2612,9 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
   RecordCompactionIOStats();
 
   if (status.ok() &&
-      (shutting_down_->load(std::memory_order_relaxed) || cfd->IsDropped())) {
+      ((shutting_down != nullptr &&
+        shutting_down->load(std::memory_order_relaxed)) ||
+       cfd->IsDropped())) {
     status = Status::ShutdownInProgress(
         "Database shutdown or Column family drop during compaction");
   }
@@ -2148,6 +2686,131 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
   sub_compact->status = status;
 }  // namespace TERARKDB_NAMESPACE
 
+namespace {
+
+// Checks whether the records of the input blob of a GC are still referenced by
+// the key SSTs of the version, in the sorted order of the records. A record is
+// reached by stepping an iterator over the key SSTs from the last one, a merge
+// join reading each key SST block once, unless it is too far off. Far records
+// are looked up by Version::GetKey(), which skips most key SSTs by their
+// filters, and the iterator seeks again after a run of them.
+class GarbageCollectionKeyProbe {
+ public:
+  GarbageCollectionKeyProbe(Version* version, const EnvOptions& env_options,
+                            Statistics* statistics)
+      : version_(version),
+        env_options_(env_options),
+        statistics_(statistics),
+        icmp_(version->cfd()->internal_comparator()),
+        range_del_agg_(&icmp_, kMaxSequenceNumber),
+        iter_(&GarbageCollectionKeyProbe::NewIterator, this, nullptr, nullptr,
+              &arena_) {}
+
+  // Set found if the key SSTs hold the value or merge index of ikey, and
+  // file_number to the blob it points to.
+  // REQUIRES: ikey is after the ikey of the last call
+  Status Lookup(const ParsedInternalKey& ikey, const FileMetaData& blob,
+                bool* found, uint64_t* file_number) {
+    *found = false;
+    target_.SetInternalKey(ikey.user_key, ikey.sequence, kValueTypeForSeek);
+    Slice target = target_.GetInternalKey();
+    if (positioned_) {
+      for (size_t i = 0; i < kMaxSteps && iter_.Valid() &&
+                         icmp_.Compare(iter_.key(), target) < 0;
+           ++i) {
+        iter_.Next();
+      }
+      if (!iter_.Valid() || icmp_.Compare(iter_.key(), target) >= 0) {
+        lookups_ = 0;
+        return FromIterator(ikey, found, file_number);
+      }
+    }
+    if (!positioned_ || ++lookups_ > kMaxLookups) {
+      iter_.Seek(target);
+      positioned_ = true;
+      lookups_ = 0;
+      return FromIterator(ikey, found, file_number);
+    }
+
+    Status s;
+    ValueType type = kTypeDeletion;
+    SequenceNumber seq = kMaxSequenceNumber;
+    LazyBuffer value;
+    version_->GetKey(ikey.user_key, target, &s, &type, &seq, &value, blob);
+    if (s.IsNotFound()) {
+      return Status::OK();
+    } else if (!s.ok()) {
+      return s;
+    } else if (seq != ikey.sequence ||
+               (type != kTypeValueIndex && type != kTypeMergeIndex)) {
+      return Status::OK();
+    }
+    s = value.fetch();
+    if (s.ok()) {
+      *found = true;
+      *file_number = SeparateHelper::DecodeFileNumber(value.slice());
+    }
+    return s;
+  }
+
+ private:
+  // Steps tried before looking a record up instead
+  static const size_t kMaxSteps = 16;
+  // Lookups of far records before seeking the iterator again
+  static const size_t kMaxLookups = 32;
+
+  static InternalIterator* NewIterator(void* arg, Arena* arena) {
+    auto probe = reinterpret_cast<GarbageCollectionKeyProbe*>(arg);
+    ReadOptions read_options;
+    read_options.fill_cache = false;
+    read_options.total_order_seek = true;
+    MergeIteratorBuilder builder(&probe->icmp_, arena);
+    probe->version_->AddIterators(read_options, probe->env_options_, &builder,
+                                  &probe->range_del_agg_);
+    return builder.Finish();
+  }
+
+  Status FromIterator(const ParsedInternalKey& ikey, bool* found,
+                      uint64_t* file_number) {
+    RecordTick(statistics_, GC_PROBE_BY_ITERATOR);
+    if (!iter_.Valid()) {
+      return iter_.status();
+    }
+    ParsedInternalKey entry;
+    if (!ParseInternalKey(iter_.key(), &entry)) {
+      return Status::Corruption(
+          "GarbageCollectionKeyProbe invalid InternalKey");
+    }
+    if (entry.sequence != ikey.sequence ||
+        (entry.type != kTypeValueIndex && entry.type != kTypeMergeIndex) ||
+        !icmp_.user_comparator()->Equal(entry.user_key, ikey.user_key) ||
+        range_del_agg_.ShouldDelete(
+            entry, RangeDelPositioningMode::kForwardTraversal)) {
+      return Status::OK();
+    }
+    LazyBuffer value = iter_.value();
+    Status s = value.fetch();
+    if (s.ok()) {
+      *found = true;
+      *file_number = SeparateHelper::DecodeFileNumber(value.slice());
+    }
+    return s;
+  }
+
+  Version* version_;
+  const EnvOptions& env_options_;
+  Statistics* statistics_;
+  const InternalKeyComparator& icmp_;
+  ReadRangeDelAggregator range_del_agg_;
+  Arena arena_;
+  LazyInternalIteratorWrapper iter_;
+  IterKey target_;
+  bool positioned_ = false;
+  size_t lookups_ = 0;
+};
+
+}  // namespace
+
 void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
   ZnsLog(kYellow, "ProcessGarbageCollection::Start");
   Defer d([]() { ZnsLog(kYellow, "ProcessGarbageCollection::End"); });
@@ -2176,10 +2839,19 @@ void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
     prev_prepare_write_nanos = IOSTATS(prepare_write_nanos);
   }
 
-  assert(sub_compact->start == nullptr);
-  assert(sub_compact->end == nullptr);
-
-  input->SeekToFirst();
+  // Subcompactions of a GC split the key space, see
+  // GenGarbageCollectionBoundaries. Every version of a user key falls into
+  // the same subcompaction.
+  const Slice* const start_user_key = sub_compact->start;
+  const Slice* const end_user_key = sub_compact->end;
+  if (start_user_key != nullptr) {
+    IterKey start_key;
+    start_key.SetInternalKey(*start_user_key, kMaxSequenceNumber,
+                             kValueTypeForSeek);
+    input->Seek(start_key.GetInternalKey());
+  } else {
+    input->SeekToFirst();
+  }
 
   Arena arena;
   // Status status = OpenCompactionOutputBlob(sub_compact);
@@ -2200,7 +2872,6 @@ void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
   auto version_number = input_version->GetVersionNumber();
   auto& comp = cfd->internal_comparator();
   std::string last_key;
-  IterKey iter_key;
   ParsedInternalKey ikey;
   struct {
     uint64_t input = 0;
@@ -2245,15 +2916,21 @@ void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
                                              inheritance_tree, close_type);
   };
 
+  GarbageCollectionKeyProbe probe(input_version, env_options_for_read_,
+                                  stats_);
   std::string key_buffer;
   while (status.ok() && !cfd->IsDropped() && input->Valid()) {
-    ++counter.input;
     Slice curr_key = input->key();
     if (!ParseInternalKey(curr_key, &ikey)) {
       status =
           Status::Corruption("ProcessGarbageCollection invalid InternalKey");
       break;
     }
+    if (end_user_key != nullptr &&
+        cfd->user_comparator()->Compare(ikey.user_key, *end_user_key) >= 0) {
+      break;
+    }
+    ++counter.input;
 
     key_buffer.assign(ikey.user_key.data(), ikey.user_key.size());
     occurrence_map[key_buffer] += 1;
@@ -2291,35 +2968,19 @@ void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
         ++counter.garbage_type;
         break;
       }
-      iter_key.SetInternalKey(ikey.user_key, ikey.sequence, kValueTypeForSeek);
-      Status s;
-      ValueType type = kTypeDeletion;
-      SequenceNumber seq = kMaxSequenceNumber;
-      LazyBuffer value;
-
+      bool found = false;
+      uint64_t file_number = 0;
       {
         auto start = env_->NowMicros();
-        input_version->GetKey(ikey.user_key, iter_key.GetInternalKey(), &s,
-                              &type, &seq, &value, *blob_meta);
+        status = probe.Lookup(ikey, *blob_meta, &found, &file_number);
         time_counter.get_key += (env_->NowMicros() - start);
       }
-
-      if (s.IsNotFound()) {
-        ++counter.get_not_found;
-        break;
-      } else if (!s.ok()) {
-        status = std::move(s);
+      if (!status.ok()) {
         break;
-      } else if (seq != ikey.sequence ||
-                 (type != kTypeValueIndex && type != kTypeMergeIndex)) {
+      } else if (!found) {
         ++counter.get_not_found;
         break;
       }
-      status = value.fetch();
-      if (!status.ok()) {
-        break;
-      }
-      uint64_t file_number = SeparateHelper::DecodeFileNumber(value.slice());
       // auto find = dependence_map.find(file_number);
       FileMetaData* find = nullptr;
       auto fm_status = dependence_multi_map->QueryFileMeta(
@@ -2329,7 +2990,7 @@ void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
         status = Status::Corruption("Separate value dependence missing");
         break;
       }
-      value = input->value();
+      LazyBuffer value = input->value();
       if (find->fd.GetNumber() != value.file_number()) {
         ++counter.file_number_mismatch;
         break;
@@ -2424,7 +3085,9 @@ void CompactionJob::ProcessGarbageCollection(SubcompactionState* sub_compact) {
                       [](FileMetaData* f) {
                         return f->marked_for_compaction;
                       }) == files.end() &&
-         files.size() == 1 && counter.input == meta.prop.num_entries) ||
+         files.size() == 1 && start_user_key == nullptr &&
+         end_user_key == nullptr &&
+         counter.input == meta.prop.num_entries) ||
         meta.prop.num_entries == 0) {
       ROCKS_LOG_INFO(db_options_.info_log,
                      "[%s] [JOB %d] Table #%" PRIu64
@@ -2695,6 +3358,7 @@ Status CompactionJob::ProcessZNSNonPartitionGarbageCollection(
       if (!status.ok()) {
         break;
       }
+      SampleBlobValue(sub_compact, value);
       sub_compact->current_blob_output()->meta.UpdateBoundaries(curr_key,
                                                                 ikey.sequence);
       sub_compact->num_output_records++;
@@ -3072,6 +3736,7 @@ Status CompactionJob::ProcessZNSNonPartitionGarbageCollectionWithNoLookback(
       if (!status.ok()) {
         break;
       }
+      SampleBlobValue(sub_compact, prev_value);
       sub_compact->current_blob_output()->meta.UpdateBoundaries(
           prev_slice, parsed_prev_internal_key.sequence);
       sub_compact->num_output_records++;
@@ -3451,6 +4116,7 @@ Status CompactionJob::ProcessZNSPartitionGarbageCollection(
       if (!status.ok()) {
         break;
       }
+      SampleBlobValue(sub_compact, value);
       current_blob_output->meta.UpdateBoundaries(
           prev_slice, parsed_prev_internal_key.sequence);
       sub_compact->num_output_records++;
@@ -3808,6 +4474,7 @@ Status CompactionJob::ProcessZNSPartitionGarbageCollectionWithNoTriaging(
       if (!status.ok()) {
         break;
       }
+      SampleBlobValue(sub_compact, value);
       current_blob_output->meta.UpdateBoundaries(
           prev_slice, parsed_prev_internal_key.sequence);
       sub_compact->num_output_records++;
@@ -4188,6 +4855,14 @@ Status CompactionJob::FinishCompactionOutputFile(
     ProcessFileMetaData("CompactionOutput", meta, &tp,
                         sub_compact->compaction->immutable_cf_options(),
                         sub_compact->compaction->mutable_cf_options());
+    auto ttl_extractor_factory =
+        sub_compact->compaction->immutable_cf_options()->ttl_extractor_factory;
+    if (ttl_extractor_factory != nullptr &&
+        ttl_extractor_factory->BoundedByInputs()) {
+      meta->prop.latest_time_expire =
+          std::min(meta->prop.latest_time_expire,
+                   sub_compact->compaction->InputLatestTimeExpire());
+    }
   }
 
   if (s.ok() && tp.num_entries == 0 && tp.num_range_deletions == 0) {
@@ -4536,6 +5211,44 @@ void CompactionJob::CallProcessCompaction(void* arg) {
   finished.set_value(true);
 }
 
+// The outputs take over the sampled accesses of the inputs by their size, so
+// the temperature of the data for hot_data_ratio survives its compactions
+void CompactionJob::InheritSampledStats() {
+  uint64_t reads = 0;
+  uint64_t writes = 0;
+  uint64_t blob_fetches = 0;
+  for (auto& input : *compact_->compaction->inputs()) {
+    for (auto f : input.files) {
+      reads += f->stats.num_reads_sampled.load(std::memory_order_relaxed);
+      writes += f->stats.num_writes_sampled.load(std::memory_order_relaxed);
+      blob_fetches +=
+          f->stats.num_blob_fetches_sampled.load(std::memory_order_relaxed);
+    }
+  }
+  std::vector<FileMetaData*> outputs;
+  uint64_t output_size = 0;
+  for (auto& sub_compact : compact_->sub_compact_states) {
+    for (auto* outputs_of :
+         {&sub_compact.outputs, &sub_compact.blob_outputs}) {
+      for (auto& out : *outputs_of) {
+        outputs.push_back(&out.meta);
+        output_size += out.meta.fd.file_size;
+      }
+    }
+  }
+  double total_size = static_cast<double>(std::max<uint64_t>(output_size, 1));
+  for (auto meta : outputs) {
+    double share = meta->fd.file_size / total_size;
+    meta->stats.num_reads_sampled.store(static_cast<uint64_t>(reads * share),
+                                        std::memory_order_relaxed);
+    meta->stats.num_writes_sampled.store(
+        static_cast<uint64_t>(writes * share), std::memory_order_relaxed);
+    meta->stats.num_blob_fetches_sampled.store(
+        static_cast<uint64_t>(blob_fetches * share),
+        std::memory_order_relaxed);
+  }
+}
+
 Status CompactionJob::InstallCompactionResults(
     const MutableCFOptions& mutable_cf_options) {
   db_mutex_->AssertHeld();
@@ -4553,6 +5266,9 @@ Status CompactionJob::InstallCompactionResults(
                     job_id_, compaction->InputLevelSummary(&inputs_summary));
     return Status::Corruption("Compaction input files inconsistent");
   }
+  if (compaction->immutable_cf_options()->hot_data_ratio > 0) {
+    InheritSampledStats();
+  }
 
   {
     Compaction::InputLevelSummaryBuffer inputs_summary;
@@ -4661,7 +5377,8 @@ Status CompactionJob::InstallCompactionResults(
         *compaction->inputs(), deleted_range, added_files,
         compaction->output_level(), compaction->output_path_id(), cfd,
         optimize_range_deletion, compaction->input_version(),
-        compact_->compaction->edit(), &file_meta, &prop);
+        compact_->compaction->edit(), &file_meta, &prop,
+        nullptr /* deleted_files */, &existing_snapshots_);
     if (s.ok() && file_meta.fd.file_size > 0) {
       // test map sst
       DependenceMap empty_dependence_map;
@@ -4846,6 +5563,10 @@ Status CompactionJob::OpenCompactionOutputFile(
   sub_compact->outfile.reset(
       new WritableFileWriter(std::move(writable_file), fname, env_options_,
                              db_options_.statistics.get(), listeners));
+  sub_compact->outfile->set_io_file_kind(
+      IOFileKindOfTable(sub_compact->compaction->output_level(), false));
+  sub_compact->outfile->set_resource_group(
+      sub_compact->compaction->immutable_cf_options()->resource_group.get());
 
   // If the Column family flag is to only optimize filters for hits,
   // we can skip creating filters if this is the bottommost_level where
@@ -4946,6 +5667,23 @@ Status CompactionJob::OpenCompactionOutputBlob(SubcompactionState* sub_compact,
                                        open_blob_builder, type, false);
 }
 
+Env::WriteLifeTimeHint CompactionJob::BlobWriteHint(
+    PlacementFileType type) const {
+  if (type.IsHot()) {
+    return Env::WLTH_SHORT;
+  }
+  if (type.IsWarm()) {
+    return Env::WLTH_MEDIUM;
+  }
+  if (output_gc_generation_ == 0) {
+    // Separated by a regular compaction, the values are at least as old as
+    // the keys of the output level
+    return std::max(Env::WLTH_LONG, write_hint_);
+  }
+  // Cold data surviving a second GC is very likely static
+  return output_gc_generation_ >= 2 ? Env::WLTH_EXTREME : Env::WLTH_LONG;
+}
+
 Status CompactionJob::OpenCompactinOutputBlobHelper(
     SubcompactionState* sub_compact,
     std::unique_ptr<WritableFileWriter>& blob_outfile,
@@ -4957,9 +5695,9 @@ Status CompactionJob::OpenCompactinOutputBlobHelper(
   uint64_t file_number = versions_->NewFileNumber();
   ZnsLog(Color::kYellow, "Opening SST(%lu) in OpenCompactionOutputBlobHelper",
          file_number);
-  std::string fname =
-      TableFileName(sub_compact->compaction->immutable_cf_options()->cf_paths,
-                    file_number, sub_compact->compaction->output_path_id());
+  std::string fname = TableFileName(
+      sub_compact->compaction->immutable_cf_options()->cf_paths, file_number,
+      sub_compact->compaction->blob_output_path_id());
   // Fire events.
   ColumnFamilyData* cfd = sub_compact->compaction->column_family_data();
 #ifndef ROCKSDB_LITE
@@ -4995,8 +5733,8 @@ Status CompactionJob::OpenCompactinOutputBlobHelper(
   }
 
   SubcompactionState::Output out;
-  out.meta.fd =
-      FileDescriptor(file_number, sub_compact->compaction->output_path_id(), 0);
+  out.meta.fd = FileDescriptor(
+      file_number, sub_compact->compaction->blob_output_path_id(), 0);
   out.finished = false;
 
   if (use_default_blob) {
@@ -5013,9 +5751,7 @@ Status CompactionJob::OpenCompactinOutputBlobHelper(
     }
   }
   writable_file->SetIOPriority(Env::IO_LOW);
-  // writable_file->SetWriteLifeTimeHint(write_hint_);
-  // (kqh): Blob file should have extremely long lifetime
-  writable_file->SetWriteLifeTimeHint(Env::WriteLifeTimeHint::WLTH_EXTREME);
+  writable_file->SetWriteLifeTimeHint(BlobWriteHint(type));
   writable_file->SetPreallocationBlockSize(static_cast<size_t>(
       sub_compact->compaction->OutputFilePreallocationSize()));
   const auto& listeners =
@@ -5023,6 +5759,9 @@ Status CompactionJob::OpenCompactinOutputBlobHelper(
   blob_outfile.reset(
       new WritableFileWriter(std::move(writable_file), fname, env_options_,
                              db_options_.statistics.get(), listeners));
+  blob_outfile->set_io_file_kind(IOFileKind::kBlob);
+  blob_outfile->set_resource_group(
+      sub_compact->compaction->immutable_cf_options()->resource_group.get());
 
   uint64_t output_file_creation_time =
       sub_compact->compaction->MaxInputFileCreationTime();
@@ -5042,6 +5781,14 @@ Status CompactionJob::OpenCompactinOutputBlobHelper(
 
   auto c = sub_compact->compaction;
   auto& moptions = *c->mutable_cf_options();
+  if (!sub_compact->blob_dict_sample_lens.empty()) {
+    TrainBlobCompressionDict(sub_compact);
+  }
+  // Never changes once set, the open blob builders point to it
+  const std::string* compression_dict =
+      sub_compact->blob_compression_dict.empty()
+          ? nullptr
+          : &sub_compact->blob_compression_dict;
   // skip_filters always false, Blob all hits
   blob_builder.reset(NewTableBuilder(
       *cfd->ioptions(), moptions, cfd->internal_comparator(),
@@ -5049,12 +5796,52 @@ Status CompactionJob::OpenCompactinOutputBlobHelper(
       cfd->GetName(), blob_outfile.get(),
       sub_compact->compaction->output_compression(),
       sub_compact->compaction->output_compression_opts(), -1 /* level */,
-      c->compaction_load(), nullptr, true /* skip_filters */,
-      output_file_creation_time, 0 /* oldest_key_time */, kEssenceSst, env_));
+      c->compaction_load(), compression_dict, true /* skip_filters */,
+      output_file_creation_time, 0 /* oldest_key_time */, kEssenceSst, env_,
+      true /* for_blob */));
   LogFlush(db_options_.info_log);
   return s;
 }
 
+void CompactionJob::SampleBlobValue(SubcompactionState* sub_compact,
+                                    const LazyBuffer& value) {
+  const CompressionOptions& opts =
+      sub_compact->compaction->output_compression_opts();
+  if (opts.max_dict_bytes == 0 ||
+      !sub_compact->compaction->mutable_cf_options()
+           ->blob_compression_per_record ||
+      !sub_compact->blob_compression_dict.empty()) {
+    return;
+  }
+  const size_t sample_bytes = opts.zstd_max_train_bytes > 0
+                                  ? opts.zstd_max_train_bytes
+                                  : opts.max_dict_bytes;
+  std::string& samples = sub_compact->blob_dict_samples;
+  if (samples.size() >= sample_bytes || !value.fetch().ok()) {
+    return;
+  }
+  size_t len = std::min(value.size(), sample_bytes - samples.size());
+  samples.append(value.data(), len);
+  sub_compact->blob_dict_sample_lens.push_back(len);
+}
+
+void CompactionJob::TrainBlobCompressionDict(SubcompactionState* sub_compact) {
+  const CompressionOptions& opts =
+      sub_compact->compaction->output_compression_opts();
+  if (opts.zstd_max_train_bytes > 0) {
+    sub_compact->blob_compression_dict =
+        ZSTD_TrainDictionary(sub_compact->blob_dict_samples,
+                             sub_compact->blob_dict_sample_lens,
+                             opts.max_dict_bytes);
+  } else {
+    sub_compact->blob_compression_dict =
+        std::move(sub_compact->blob_dict_samples);
+  }
+  std::string().swap(sub_compact->blob_dict_samples);
+  sub_compact->blob_dict_sample_lens.clear();
+  sub_compact->blob_dict_sample_lens.shrink_to_fit();
+}
+
 void CompactionJob::CleanupCompaction() {
   for (SubcompactionState& sub_compact : compact_->sub_compact_states) {
     const auto& sub_status = sub_compact.status;
@@ -98,6 +98,10 @@ class CompactionJob {
 
   Status VerifyFiles();
 
+  // Load the blocks of the outputs holding the hot blocks of the inputs into
+  // the block cache, see DBOptions::warm_block_cache_after_compaction
+  void WarmUpBlockCache();
+
   // REQUIRED: mutex held
   Status Install(const MutableCFOptions& mutable_cf_options);
 
@@ -117,6 +121,11 @@ class CompactionJob {
 
   void AggregateStatistics();
   void GenSubcompactionBoundaries(int max_usable_threads);
+  // Append keys sampled inside the input tables to `bounds`, as many from a
+  // table as its share of the input bytes, blobs included
+  void SampleSubcompactionBounds(int max_usable_threads,
+                                 std::vector<Slice>* bounds);
+  void GenGarbageCollectionBoundaries(int max_usable_threads);
 
   // update the thread status for starting a compaction.
   void ReportStartedCompaction(Compaction* compaction);
@@ -125,6 +134,12 @@ class CompactionJob {
   // kv-pairs
   void ProcessCompaction(SubcompactionState* sub_compact);
   void ProcessKeyValueCompaction(SubcompactionState* sub_compact);
+  // Whether the job can stop at an output file boundary and install what it
+  // has compacted, leaving the rest of its input range to a later compaction
+  bool CanPreempt() const;
+  // Whether the job should stop at the next output file boundary, for the DB
+  // shutdown or for a write stall it doesn't take part in relieving
+  bool ShouldPreempt() const;
   void ProcessGarbageCollection(SubcompactionState* sub_compact);
 
   // For ZNS
@@ -156,6 +171,7 @@ class CompactionJob {
       const Status& input_status, SubcompactionState* sub_compact,
       const std::vector<uint64_t>& inheritance_tree, PlacementFileType type);
   Status InstallCompactionResults(const MutableCFOptions& mutable_cf_options);
+  void InheritSampledStats();
   void RecordCompactionIOStats();
   Status OpenCompactionOutputFile(SubcompactionState* sub_compact);
 
@@ -179,6 +195,17 @@ class CompactionJob {
       std::unique_ptr<WritableFileWriter>& blob_outfile,
       std::unique_ptr<TableBuilder>& blob_builder, PlacementFileType type,
       bool use_default_blob = true);
+
+  // (ZNS): Lifetime class of an output blob. Hot and warm data is expected to
+  // be overwritten soon, everything else lives longer the more garbage
+  // collections it has already survived.
+  Env::WriteLifeTimeHint BlobWriteHint(PlacementFileType type) const;
+  // Collect `value`, written to a blob output, into the samples of the
+  // compression dictionary of the later blob outputs, see
+  // blob_compression_per_record
+  void SampleBlobValue(SubcompactionState* sub_compact,
+                       const LazyBuffer& value);
+  void TrainBlobCompressionDict(SubcompactionState* sub_compact);
   void CleanupCompaction();
   void UpdateCompactionJobStats(
       const InternalStats::CompactionStats& stats) const;
@@ -238,9 +265,15 @@ class CompactionJob {
   bool measure_io_stats_;
   // Stores the Slices that designate the boundaries for each subcompaction
   std::vector<Slice> boundaries_;
+  // Owns the sampled keys some of boundaries_ point to
+  std::vector<std::string> sampled_bounds_;
   // Stores the approx size of keys covered in the range of each subcompaction
   std::vector<uint64_t> sizes_;
   Env::WriteLifeTimeHint write_hint_;
+  // The write stalls of the column family, set by Prepare()
+  const WriteController* write_controller_;
+  // (ZNS): GC generation of the blobs written by this job, see FileMap
+  uint32_t output_gc_generation_;
 };
 
 }  // namespace TERARKDB_NAMESPACE
@@ -870,10 +870,8 @@ Compaction* CompactionPicker::PickGarbageCollection(
   size_t target_blob_file_size = MaxBlobSize(
       mutable_cf_options, ioptions_.num_levels, ioptions_.compaction_style);
 
-  size_t fragment_size = mutable_cf_options.blob_file_defragment_size;
-  if (fragment_size == 0) {
-    fragment_size = target_blob_file_size / 8;
-  }
+  size_t fragment_size = BlobFragmentSize(
+      mutable_cf_options, ioptions_.num_levels, ioptions_.compaction_style);
   // Preferentially select files marked by high priority
   auto candidate_cmp = [](const GarbageFileInfo& l, const GarbageFileInfo& r) {
     assert(l.f != nullptr && !l.f->being_compacted);
@@ -884,21 +882,30 @@ Compaction* CompactionPicker::PickGarbageCollection(
   };
 
   auto& hidden_files = vstorage->LevelFiles(-1);
-  uint64_t idx = 0;
-  // Find largest score blob
+  uint64_t idx = vstorage->blob_gc_scan_end();
+  // Find largest score blob. Files which can not be picked now are popped
+  // and pushed back afterwards, they may be picked again once released.
   GarbageFileInfo dirtiest_blob{nullptr};
-  for (; idx < hidden_files.size() && !hidden_files[idx]->is_gc_forbidden();
-       ++idx) {
-    FileMetaData* f = hidden_files[idx];
-    if (!f->is_gc_permitted() || f->being_compacted) {
-      continue;
+  auto& garbage_heap = vstorage->blob_garbage_heap();
+  std::vector<FileMetaData*> skipped;
+  while (!garbage_heap.empty()) {
+    FileMetaData* f = garbage_heap.front();
+    if (f->is_gc_permitted() && !f->being_compacted) {
+      dirtiest_blob = GarbageFileInfo{f};
+      break;
     }
-    GarbageFileInfo info{f};
-    // candidate_cmp is less comparator
-    if (dirtiest_blob.f == nullptr || candidate_cmp(dirtiest_blob, info)) {
-      dirtiest_blob = info;
+    std::pop_heap(garbage_heap.begin(), garbage_heap.end(),
+                  VersionStorageInfo::BlobGarbageLess);
+    garbage_heap.pop_back();
+    if (f->is_gc_permitted()) {
+      skipped.push_back(f);
     }
   }
+  for (auto f : skipped) {
+    garbage_heap.push_back(f);
+    std::push_heap(garbage_heap.begin(), garbage_heap.end(),
+                   VersionStorageInfo::BlobGarbageLess);
+  }
 
   if (dirtiest_blob.f == nullptr ||
       (!dirtiest_blob.f->marked_for_compaction &&
@@ -999,7 +1006,8 @@ Compaction* CompactionPicker::PickGarbageCollection(
       ioptions_, vstorage, mutable_cf_options, bottommost_level, 1, true);
   params.compression_opts =
       GetCompressionOptions(ioptions_, vstorage, bottommost_level, true);
-  params.max_subcompactions = 1;
+  // Large blob sets are split into key range subcompactions by CompactionJob
+  params.max_subcompactions = mutable_cf_options.max_subcompactions;
   params.score = vstorage->total_garbage_ratio();
   params.compaction_type = kGarbageCollection;
   params.compaction_reason = ConvertInputsCompactionReason(
@@ -1011,6 +1019,172 @@ Compaction* CompactionPicker::PickGarbageCollection(
   return c;
 }
 
+// Merge the small blob files left behind by deletions, which GC only takes
+// a few of at a time as neighbors of a dirty blob. The files are taken in the
+// order of their largest sequence numbers, so the values merged together were
+// written about the same time and likely die about the same time. They are
+// packed into target_blob_file_size outputs, up to one per subcompaction.
+Compaction* CompactionPicker::PickBlobDefragment(
+    const std::string& /*cf_name*/, const MutableCFOptions& mutable_cf_options,
+    VersionStorageInfo* vstorage, LogBuffer* /*log_buffer*/) {
+  // Bounds the table readers a job opens
+  const size_t kMaxBlobDefragmentFiles = 256;
+  uint64_t target_blob_file_size = MaxBlobSize(
+      mutable_cf_options, ioptions_.num_levels, ioptions_.compaction_style);
+  uint64_t fragment_size = BlobFragmentSize(
+      mutable_cf_options, ioptions_.num_levels, ioptions_.compaction_style);
+
+  auto& hidden_files = vstorage->LevelFiles(-1);
+  std::vector<GarbageFileInfo> fragments;
+  for (size_t i = 0; i < vstorage->blob_gc_scan_end(); ++i) {
+    FileMetaData* f = hidden_files[i];
+    if (!f->is_gc_permitted() || f->being_compacted) {
+      continue;
+    }
+    GarbageFileInfo blob(f);
+    if (blob.estimate_size <= fragment_size) {
+      fragments.emplace_back(blob);
+    }
+  }
+  if (fragments.size() < VersionStorageInfo::kMinBlobDefragmentFiles) {
+    return nullptr;
+  }
+  std::sort(fragments.begin(), fragments.end(),
+            [](const GarbageFileInfo& l, const GarbageFileInfo& r) {
+              return l.f->fd.largest_seqno < r.f->fd.largest_seqno;
+            });
+
+  std::vector<CompactionInputFiles> inputs(1);
+  auto& input = inputs.front();
+  input.level = -1;
+  uint64_t max_total_size =
+      target_blob_file_size *
+      std::max<uint64_t>(1, mutable_cf_options.max_subcompactions);
+  uint64_t total_estimate_size = 0;
+  uint64_t num_antiquation = 0;
+  for (auto& blob : fragments) {
+    if (input.files.size() >= kMaxBlobDefragmentFiles ||
+        total_estimate_size + blob.estimate_size > max_total_size) {
+      break;
+    }
+    total_estimate_size += blob.estimate_size;
+    num_antiquation += blob.f->num_antiquation;
+    input.files.push_back(blob.f);
+  }
+  if (input.files.size() < VersionStorageInfo::kMinBlobDefragmentFiles) {
+    return nullptr;
+  }
+  for (auto f : input.files) {
+    f->set_gc_candidate();
+  }
+
+  int bottommost_level = vstorage->num_levels() - 1;
+  CompactionParams params(vstorage, ioptions_, mutable_cf_options);
+  params.inputs = std::move(inputs);
+  params.output_level = -1;
+  params.num_antiquation = num_antiquation;
+  params.max_compaction_bytes = LLONG_MAX;
+  params.output_path_id = GetPathId(ioptions_, mutable_cf_options, 1);
+  params.compression = GetCompressionType(
+      ioptions_, vstorage, mutable_cf_options, bottommost_level, 1, true);
+  params.compression_opts =
+      GetCompressionOptions(ioptions_, vstorage, bottommost_level, true);
+  params.max_subcompactions = mutable_cf_options.max_subcompactions;
+  params.score = vstorage->total_garbage_ratio();
+  params.compaction_type = kGarbageCollection;
+  params.sub_compaction_type = kBlobDefragment;
+  params.compaction_reason = ConvertInputsCompactionReason(
+      params.inputs, CompactionReason::kBlobDefragment);
+
+  Compaction* c = RegisterCompaction(new Compaction(std::move(params)));
+  vstorage->ComputeCompactionScore(ioptions_, mutable_cf_options);
+
+  return c;
+}
+
+// The compaction moves the file as the outputs of the compactions go to the
+// tier of the temperature of their inputs, see Compaction::Compaction(). A map
+// SST is copied by the DB rather than rebuilt, see
+// DBImpl::BackgroundCompaction().
+Compaction* CompactionPicker::PickPathMigration(
+    const std::string& cf_name, const MutableCFOptions& mutable_cf_options,
+    VersionStorageInfo* vstorage, LogBuffer* log_buffer) {
+  for (auto& level_and_file : vstorage->FilesMarkedForPathMigration()) {
+    int level = level_and_file.first;
+    FileMetaData* f = level_and_file.second;
+    if (f->being_compacted) {
+      continue;
+    }
+    std::vector<CompactionInputFiles> inputs(1);
+    inputs.front().level = level;
+    inputs.front().files.push_back(f);
+    if (FilesRangeOverlapWithCompaction(inputs, level)) {
+      continue;
+    }
+    CompactionParams params(vstorage, ioptions_, mutable_cf_options);
+    params.inputs = std::move(inputs);
+    params.output_level = level;
+    params.target_file_size = MaxFileSizeForLevel(
+        mutable_cf_options, level, ioptions_.compaction_style,
+        vstorage->base_level(), ioptions_.level_compaction_dynamic_level_bytes);
+    params.max_compaction_bytes = mutable_cf_options.max_compaction_bytes;
+    params.output_path_id = f->fd.GetPathId();
+    params.compression = GetCompressionType(
+        ioptions_, vstorage, mutable_cf_options, level, vstorage->base_level());
+    params.compression_opts = GetCompressionOptions(ioptions_, vstorage, level);
+    params.max_subcompactions = 1;
+    params.score = 0;
+    params.compaction_reason = CompactionReason::kPathMigration;
+    ROCKS_LOG_BUFFER(log_buffer,
+                     "[%s] Moving #%" PRIu64 " of level-%d for its temperature",
+                     cf_name.c_str(), f->fd.GetNumber(), level);
+
+    Compaction* c = RegisterCompaction(new Compaction(std::move(params)));
+    vstorage->ComputeCompactionScore(ioptions_, mutable_cf_options);
+    return c;
+  }
+  return nullptr;
+}
+
+// A blob file at a time, several could be bound for different tiers
+Compaction* CompactionPicker::PickBlobPathMigration(
+    const std::string& cf_name, const MutableCFOptions& mutable_cf_options,
+    VersionStorageInfo* vstorage, LogBuffer* log_buffer) {
+  for (auto f : vstorage->BlobsMarkedForPathMigration()) {
+    if (!f->is_gc_permitted() || f->being_compacted) {
+      continue;
+    }
+    f->set_gc_candidate();
+    std::vector<CompactionInputFiles> inputs(1);
+    inputs.front().level = -1;
+    inputs.front().files.push_back(f);
+
+    int bottommost_level = vstorage->num_levels() - 1;
+    CompactionParams params(vstorage, ioptions_, mutable_cf_options);
+    params.inputs = std::move(inputs);
+    params.output_level = -1;
+    params.num_antiquation = f->num_antiquation;
+    params.max_compaction_bytes = LLONG_MAX;
+    params.output_path_id = f->fd.GetPathId();
+    params.compression = GetCompressionType(
+        ioptions_, vstorage, mutable_cf_options, bottommost_level, 1, true);
+    params.compression_opts =
+        GetCompressionOptions(ioptions_, vstorage, bottommost_level, true);
+    params.max_subcompactions = 1;
+    params.score = vstorage->total_garbage_ratio();
+    params.compaction_type = kGarbageCollection;
+    params.compaction_reason = CompactionReason::kPathMigration;
+    ROCKS_LOG_BUFFER(log_buffer,
+                     "[%s] Moving blob #%" PRIu64 " for its temperature",
+                     cf_name.c_str(), f->fd.GetNumber());
+
+    Compaction* c = RegisterCompaction(new Compaction(std::move(params)));
+    vstorage->ComputeCompactionScore(ioptions_, mutable_cf_options);
+    return c;
+  }
+  return nullptr;
+}
+
 //
 // Try to perform garbage collection from certain column family.
 // Resulting as a pointer of compaction, nullptr as nothing to do.
@@ -2079,6 +2253,27 @@ Compaction* CompactionPicker::PickCompositeCompaction(
     }
     return 1.0 / find->second->fd.GetNumber();
   };
+  // Sampled reads that reached this range. A read is counted on every linked
+  // sst it visits, the share of a linked sst falling into the range is
+  // estimated by the linked size
+  auto read_heat = [vstorage](const MapSstElement& e) -> double {
+    double heat = 0;
+    auto& dependence_map = vstorage->dependence_map();
+    for (auto& l : e.link) {
+      auto find = dependence_map.find(l.file_number);
+      if (find == dependence_map.end()) {
+        continue;
+      }
+      auto f = find->second;
+      uint64_t file_size = std::max<uint64_t>(1, f->fd.GetFileSize());
+      heat = std::max(heat, 1.0 *
+                                f->stats.num_reads_sampled.load(
+                                    std::memory_order_relaxed) *
+                                std::min(l.size, file_size) / file_size);
+    }
+    return heat;
+  };
+  double read_heat_weight = mutable_cf_options.lazy_compaction_read_heat_weight;
   MapSstElement map_element;
   SelectedRange range;
   auto uc = ioptions_.internal_comparator.user_comparator();
@@ -2092,6 +2287,8 @@ Compaction* CompactionPicker::PickCompositeCompaction(
   };
 
   std::vector<PickerCompositeHeapItem> priority_heap;
+  std::vector<double> heat_list;
+  double total_heat = 0;
   for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
     if (!ReadMapElement(map_element, iter.get(), log_buffer, cf_name)) {
       return nullptr;
@@ -2124,6 +2321,18 @@ Compaction* CompactionPicker::PickCompositeCompaction(
     PickerCompositeHeapItem item = {
         ArenaPinSlice(map_element.largest_key, &arena), p};
     priority_heap.push_back(item);
+    if (read_heat_weight > 0) {
+      heat_list.push_back(read_heat(map_element));
+      total_heat += heat_list.back();
+    }
+  }
+  if (read_heat_weight > 0 && total_heat > 0) {
+    // Lazy compaction trades read amp for write amp, pay it back first where
+    // reads are hottest
+    double avg_heat = total_heat / heat_list.size();
+    for (size_t i = 0; i < priority_heap.size(); ++i) {
+      priority_heap[i].s *= 1 + read_heat_weight * heat_list[i] / avg_heat;
+    }
   }
   std::make_heap(priority_heap.begin(), priority_heap.end(),
                  std::less<double>());
@@ -2302,7 +2511,8 @@ bool LevelCompactionPicker::NeedsCompaction(
   }
   // FilesMarkedForCompaction & BottommostFilesMarkedForCompaction move to
   // has_space_amplification
-  return vstorage->has_space_amplification();
+  return vstorage->has_space_amplification() ||
+         !vstorage->FilesMarkedForPathMigration().empty();
 }
 
 bool LevelCompactionPicker::ShouldSkipMarkedForCompaction(
@@ -3143,11 +3353,16 @@ Compaction* LevelCompactionPicker::PickCompaction(
     LogBuffer* log_buffer) {
   LevelCompactionBuilder builder(cf_name, vstorage, this, log_buffer,
                                  mutable_cf_options, ioptions_);
+  Compaction* c;
   if (ioptions_.enable_lazy_compaction) {
-    return builder.PickLazyCompaction(snapshots);
+    c = builder.PickLazyCompaction(snapshots);
   } else {
-    return builder.PickCompaction();
+    c = builder.PickCompaction();
   }
+  if (c == nullptr) {
+    c = PickPathMigration(cf_name, mutable_cf_options, vstorage, log_buffer);
+  }
+  return c;
 }
 
 }  // namespace TERARKDB_NAMESPACE
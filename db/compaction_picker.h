@@ -117,6 +117,25 @@ class CompactionPicker {
       const std::string& cf_name, const MutableCFOptions& mutable_cf_options,
       VersionStorageInfo* vstorage, LogBuffer* log_buffer, Env* env);
 
+  // Pick small blob files of about the same age to merge
+  Compaction* PickBlobDefragment(const std::string& cf_name,
+                                 const MutableCFOptions& mutable_cf_options,
+                                 VersionStorageInfo* vstorage,
+                                 LogBuffer* log_buffer);
+
+  // Pick a file on the wrong tier for its temperature to rewrite to its own
+  // level on the right one, see ColumnFamilyOptions::hot_data_ratio
+  Compaction* PickPathMigration(const std::string& cf_name,
+                                const MutableCFOptions& mutable_cf_options,
+                                VersionStorageInfo* vstorage,
+                                LogBuffer* log_buffer);
+
+  // Pick a blob file on the wrong tier for its temperature to GC
+  Compaction* PickBlobPathMigration(const std::string& cf_name,
+                                    const MutableCFOptions& mutable_cf_options,
+                                    VersionStorageInfo* vstorage,
+                                    LogBuffer* log_buffer);
+
   virtual void InitFilesBeingCompact(const MutableCFOptions& mutable_cf_options,
                                      VersionStorageInfo* vstorage,
                                      const InternalKey* begin,
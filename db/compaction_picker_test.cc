@@ -511,6 +511,136 @@ TEST_F(CompactionPickerTest, AllowsTrivialMoveUniversal) {
   ASSERT_TRUE(compaction->is_trivial_move());
 }
 
+TEST_F(CompactionPickerTest, LazyUniversalSizeAmpMapCompaction) {
+  const uint64_t kFileSize = 100000;
+  ioptions_.enable_lazy_compaction = true;
+  mutable_cf_options_.level0_file_num_compaction_trigger = 4;
+  mutable_cf_options_.compaction_options_universal
+      .max_size_amplification_percent = 200;
+  EnvOptions env_options;
+  UniversalCompactionPicker universal_compaction_picker(nullptr, env_options,
+                                                        ioptions_, &icmp_);
+
+  NewVersionStorage(3, kCompactionStyleUniversal);
+
+  Add(0, 1U, "150", "200", kFileSize, 0, 500, 550);
+  Add(0, 2U, "201", "250", kFileSize, 0, 401, 450);
+  Add(0, 4U, "260", "300", kFileSize, 0, 260, 300);
+  Add(2, 3U, "100", "350", kFileSize, 0, 101, 150);
+
+  UpdateVersionStorageInfo();
+
+  std::unique_ptr<Compaction> compaction(
+      universal_compaction_picker.PickCompaction(
+          cf_name_, mutable_cf_options_, vstorage_.get(), {}, &log_buffer_));
+
+  // All the sorted runs are linked into the last level, the real merge is
+  // left to the composite compaction
+  ASSERT_TRUE(compaction.get() != nullptr);
+  ASSERT_EQ(kMapCompaction, compaction->compaction_type());
+  ASSERT_EQ(CompactionReason::kUniversalSizeAmplification,
+            compaction->compaction_reason());
+  ASSERT_EQ(2, compaction->output_level());
+  ASSERT_EQ(3U, compaction->num_input_files(0));
+  ASSERT_EQ(1U, compaction->num_input_files(2));
+}
+
+TEST_F(CompactionPickerTest, UniversalTimeWindow) {
+  const uint64_t kFileSize = 100000;
+  test::TestTtlExtractorFactory ttl_extractor_factory(Env::Default());
+  ioptions_.ttl_extractor_factory = &ttl_extractor_factory;
+  mutable_cf_options_.compaction_options_universal.time_window = 100;
+  EnvOptions env_options;
+  UniversalCompactionPicker universal_compaction_picker(nullptr, env_options,
+                                                        ioptions_, &icmp_);
+  auto set_expire = [&](uint32_t file_number, uint64_t latest_time_expire) {
+    file_map_[file_number].first->prop.latest_time_expire =
+        latest_time_expire;
+  };
+
+  // Windows 3, 3, 2, 2 and 1, the older window goes first
+  NewVersionStorage(3, kCompactionStyleUniversal);
+  Add(0, 1U, "150", "200", kFileSize, 0, 500, 550);
+  Add(0, 2U, "201", "250", kFileSize, 0, 401, 450);
+  Add(0, 4U, "260", "300", kFileSize, 0, 260, 300);
+  Add(1, 5U, "100", "151", kFileSize, 0, 200, 251);
+  Add(2, 6U, "120", "200", kFileSize, 0, 20, 100);
+  set_expire(1U, 350);
+  set_expire(2U, 320);
+  set_expire(4U, 250);
+  set_expire(5U, 210);
+  set_expire(6U, 150);
+  UpdateVersionStorageInfo();
+
+  std::unique_ptr<Compaction> compaction(
+      universal_compaction_picker.PickCompaction(
+          cf_name_, mutable_cf_options_, vstorage_.get(), {}, &log_buffer_));
+  ASSERT_TRUE(compaction.get() != nullptr);
+  ASSERT_EQ(CompactionReason::kUniversalTimeWindow,
+            compaction->compaction_reason());
+  ASSERT_EQ(1, compaction->output_level());
+  ASSERT_EQ(1U, compaction->num_input_files(0));
+  ASSERT_EQ(4U, compaction->input(0, 0)->fd.GetNumber());
+  ASSERT_EQ(1U, compaction->num_input_files(1));
+  ASSERT_EQ(5U, compaction->input(1, 0)->fd.GetNumber());
+}
+
+TEST_F(CompactionPickerTest, UniversalTimeWindowLateSortedRun) {
+  const uint64_t kFileSize = 100000;
+  test::TestTtlExtractorFactory ttl_extractor_factory(Env::Default());
+  ioptions_.ttl_extractor_factory = &ttl_extractor_factory;
+  mutable_cf_options_.compaction_options_universal.time_window = 100;
+  EnvOptions env_options;
+  UniversalCompactionPicker universal_compaction_picker(nullptr, env_options,
+                                                        ioptions_, &icmp_);
+  auto set_expire = [&](uint32_t file_number, uint64_t latest_time_expire) {
+    file_map_[file_number].first->prop.latest_time_expire =
+        latest_time_expire;
+  };
+
+  // File 1 is written late for window 1, it moves down to the last level
+  // across the sorted runs of the windows 3 and 2
+  NewVersionStorage(3, kCompactionStyleUniversal);
+  Add(0, 1U, "500", "600", kFileSize, 0, 500, 550);
+  Add(0, 2U, "100", "200", kFileSize, 0, 401, 450);
+  Add(1, 3U, "100", "200", kFileSize, 0, 200, 251);
+  Add(2, 4U, "100", "700", kFileSize, 0, 20, 100);
+  set_expire(1U, 150);
+  set_expire(2U, 350);
+  set_expire(3U, 250);
+  set_expire(4U, 110);
+  UpdateVersionStorageInfo();
+
+  std::unique_ptr<Compaction> compaction(
+      universal_compaction_picker.PickCompaction(
+          cf_name_, mutable_cf_options_, vstorage_.get(), {}, &log_buffer_));
+  ASSERT_TRUE(compaction.get() != nullptr);
+  ASSERT_EQ(CompactionReason::kUniversalTimeWindow,
+            compaction->compaction_reason());
+  ASSERT_EQ(2, compaction->output_level());
+  ASSERT_EQ(1U, compaction->num_input_files(0));
+  ASSERT_EQ(1U, compaction->input(0, 0)->fd.GetNumber());
+  ASSERT_EQ(0U, compaction->num_input_files(1));
+  ASSERT_EQ(1U, compaction->num_input_files(2));
+  ASSERT_EQ(4U, compaction->input(2, 0)->fd.GetNumber());
+
+  // It stays if a sorted run in between overlaps it
+  NewVersionStorage(3, kCompactionStyleUniversal);
+  Add(0, 1U, "500", "600", kFileSize, 0, 500, 550);
+  Add(0, 2U, "100", "200", kFileSize, 0, 401, 450);
+  Add(1, 3U, "100", "550", kFileSize, 0, 200, 251);
+  Add(2, 4U, "100", "700", kFileSize, 0, 20, 100);
+  set_expire(1U, 150);
+  set_expire(2U, 350);
+  set_expire(3U, 250);
+  set_expire(4U, 110);
+  UpdateVersionStorageInfo();
+
+  compaction.reset(universal_compaction_picker.PickCompaction(
+      cf_name_, mutable_cf_options_, vstorage_.get(), {}, &log_buffer_));
+  ASSERT_TRUE(compaction.get() == nullptr);
+}
+
 #endif  // ROCKSDB_LITE
 
 // kMarkedFromRangeDeletion is handled by compaction_pri, so SST(4) is the first
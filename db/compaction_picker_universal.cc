@@ -183,7 +183,7 @@ bool UniversalCompactionPicker::NeedsCompaction(
   if (!vstorage->LevelFiles(-1).empty()) {
     return true;
   }
-  return false;
+  return !vstorage->FilesMarkedForPathMigration().empty();
 }
 
 void UniversalCompactionPicker::SortedRun::Dump(char* out_buf,
@@ -260,17 +260,24 @@ Compaction* UniversalCompactionPicker::PickCompaction(
   double score = vstorage->CompactionScore(kLevel0);
   std::vector<SortedRun> sorted_runs =
       CalculateSortedRuns(*vstorage, ioptions_, mutable_cf_options);
+  const bool time_window =
+      mutable_cf_options.compaction_options_universal.time_window > 0 &&
+      ioptions_.ttl_extractor_factory != nullptr;
 
   if (sorted_runs.size() == 0 ||
-      (vstorage->FilesMarkedForCompaction().empty() &&
+      (!time_window && vstorage->FilesMarkedForCompaction().empty() &&
        !vstorage->has_space_amplification() &&
        sorted_runs.size() < (unsigned int)mutable_cf_options
                                 .level0_file_num_compaction_trigger)) {
-    ROCKS_LOG_BUFFER(log_buffer, "[%s] Universal: nothing to do\n",
-                     cf_name.c_str());
+    Compaction* c =
+        PickPathMigration(cf_name, mutable_cf_options, vstorage, log_buffer);
+    if (c == nullptr) {
+      ROCKS_LOG_BUFFER(log_buffer, "[%s] Universal: nothing to do\n",
+                       cf_name.c_str());
+    }
     TEST_SYNC_POINT_CALLBACK("UniversalCompactionPicker::PickCompaction:Return",
-                             nullptr);
-    return nullptr;
+                             c);
+    return c;
   }
   VersionStorageInfo::LevelSummaryStorage tmp;
   ROCKS_LOG_BUFFER_MAX_SZ(
@@ -280,14 +287,38 @@ Compaction* UniversalCompactionPicker::PickCompaction(
 
   // Check for size amplification first.
   Compaction* c = nullptr;
-  if (ioptions_.enable_lazy_compaction) {
+  if (time_window) {
+    // Size amplification and sorted runs are bounded per window, a composite
+    // compaction rewrites the map SSTs of one sorted run, so of one window
+    c = PickTimeWindowCompaction(cf_name, mutable_cf_options, vstorage, score,
+                                 sorted_runs, log_buffer);
+    if (c == nullptr && ioptions_.enable_lazy_compaction &&
+        table_cache_ != nullptr) {
+      c = PickCompositeCompaction(cf_name, mutable_cf_options, vstorage,
+                                  snapshots, sorted_runs, log_buffer);
+    }
+  } else if (ioptions_.enable_lazy_compaction) {
     bool has_map_compaction_in_progress =
         std::find_if(compactions_in_progress_.begin(),
                      compactions_in_progress_.end(), [](Compaction* cip) {
                        return cip->compaction_type() == kMapCompaction;
                      }) != compactions_in_progress_.end();
     int reduce_sorted_run_target = std::numeric_limits<int>::max();
+    // Size amplification is reduced by a map compaction as well, which only
+    // links all the sorted runs into one at the last level. The composite
+    // compaction rewrites the garbage afterwards.
     if (!has_map_compaction_in_progress &&
+        sorted_runs.size() >=
+            static_cast<size_t>(
+                mutable_cf_options.level0_file_num_compaction_trigger) &&
+        (c = PickCompactionToReduceSizeAmp(cf_name, mutable_cf_options,
+                                           vstorage, score, sorted_runs,
+                                           log_buffer)) != nullptr) {
+      ROCKS_LOG_BUFFER(log_buffer,
+                       "[%s] Universal: map compacting for size amp\n",
+                       cf_name.c_str());
+    }
+    if (c == nullptr && !has_map_compaction_in_progress &&
         (c = PickTrivialMoveCompaction(cf_name, mutable_cf_options, vstorage,
                                        sorted_runs, log_buffer)) == nullptr &&
         table_cache_ != nullptr) {
@@ -305,7 +336,7 @@ Compaction* UniversalCompactionPicker::PickCompaction(
       reduce_sorted_run_target =
           std::min(max_sorted_run_size, reduce_sorted_run_target);
     }
-    if (int(sorted_runs.size()) > reduce_sorted_run_target &&
+    if (c == nullptr && int(sorted_runs.size()) > reduce_sorted_run_target &&
         (c = PickCompactionToReduceSortedRuns(
              cf_name, mutable_cf_options, vstorage, score, &sorted_runs,
              reduce_sorted_run_target, log_buffer)) != nullptr) {
@@ -372,7 +403,7 @@ Compaction* UniversalCompactionPicker::PickCompaction(
       }
     }
   }
-  if (c == nullptr && !ioptions_.enable_lazy_compaction) {
+  if (c == nullptr && !time_window && !ioptions_.enable_lazy_compaction) {
     if ((c = PickDeleteTriggeredCompaction(cf_name, mutable_cf_options,
                                            vstorage, score, sorted_runs,
                                            log_buffer)) != nullptr) {
@@ -382,9 +413,11 @@ Compaction* UniversalCompactionPicker::PickCompaction(
     }
   }
   if (c == nullptr) {
+    // Registered already, and never a trivial move
+    c = PickPathMigration(cf_name, mutable_cf_options, vstorage, log_buffer);
     TEST_SYNC_POINT_CALLBACK("UniversalCompactionPicker::PickCompaction:Return",
-                             nullptr);
-    return nullptr;
+                             c);
+    return c;
   }
 
   bool allow_trivial_move =
@@ -1041,7 +1074,8 @@ Compaction* UniversalCompactionPicker::PickCompactionToReduceSizeAmp(
       GetPathId(ioptions_, mutable_cf_options, estimated_total_size);
   int start_level = sorted_runs[start_index].level;
 
-  std::vector<CompactionInputFiles> inputs(vstorage->num_levels());
+  std::vector<CompactionInputFiles> inputs(vstorage->num_levels() -
+                                           start_level);
   for (size_t i = 0; i < inputs.size(); ++i) {
     inputs[i].level = start_level + static_cast<int>(i);
   }
@@ -1083,6 +1117,10 @@ Compaction* UniversalCompactionPicker::PickCompactionToReduceSizeAmp(
   params.compression_opts =
       GetCompressionOptions(ioptions_, vstorage, output_level);
   params.score = score;
+  if (ioptions_.enable_lazy_compaction) {
+    params.max_subcompactions = 1;
+    params.compaction_type = kMapCompaction;
+  }
   params.compaction_reason = CompactionReason::kUniversalSizeAmplification;
 
   return new Compaction(std::move(params));
@@ -1445,6 +1483,163 @@ Compaction* UniversalCompactionPicker::PickCompactionToReduceSortedRuns(
   return new Compaction(std::move(params));
 }
 
+// Merge the sorted runs of a time window while they are contiguous in
+// time-range, so no other sorted run is crossed. Failing that, move a sorted
+// run written late for an older window down to that window, if none of the
+// sorted runs it crosses overlaps its key range. It only moves into a level,
+// as L0 files are ordered by sequence number rather than by position.
+Compaction* UniversalCompactionPicker::PickTimeWindowCompaction(
+    const std::string& cf_name, const MutableCFOptions& mutable_cf_options,
+    VersionStorageInfo* vstorage, double score,
+    const std::vector<SortedRun>& sorted_runs, LogBuffer* log_buffer) {
+  const auto& options = mutable_cf_options.compaction_options_universal;
+  const size_t min_merge_width = std::max(2u, options.min_merge_width);
+  const size_t max_merge_width =
+      std::max<size_t>(min_merge_width, options.max_merge_width);
+  const Comparator* ucmp = icmp_->user_comparator();
+  if (sorted_runs.empty()) {
+    return nullptr;
+  }
+
+  std::vector<uint64_t> windows(sorted_runs.size());
+  std::vector<std::pair<Slice, Slice>> ranges(sorted_runs.size());
+  for (size_t i = 0; i < sorted_runs.size(); ++i) {
+    auto& sr = sorted_runs[i];
+    uint64_t latest_time_expire = 0;
+    if (sr.level == 0) {
+      latest_time_expire = vstorage->LatestTimeExpire(sr.file);
+      ranges[i] = {sr.file->smallest.user_key(), sr.file->largest.user_key()};
+    } else {
+      auto& level_files = vstorage->LevelFiles(sr.level);
+      for (auto f : level_files) {
+        latest_time_expire =
+            std::max(latest_time_expire, vstorage->LatestTimeExpire(f));
+      }
+      ranges[i] = {level_files.front()->smallest.user_key(),
+                   level_files.back()->largest.user_key()};
+    }
+    // Runs without a ttl never expire, they make a window of their own
+    windows[i] = latest_time_expire == port::kMaxUint64
+                     ? port::kMaxUint64
+                     : latest_time_expire / options.time_window;
+  }
+  auto output_level_after = [&](size_t last_index) {
+    int output_level;
+    if (last_index + 1 == sorted_runs.size()) {
+      output_level = vstorage->num_levels() - 1;
+    } else if (sorted_runs[last_index + 1].level == 0) {
+      output_level = 0;
+    } else {
+      output_level = sorted_runs[last_index + 1].level - 1;
+    }
+    // last level is reserved for the files ingested behind
+    if (ioptions_.allow_ingest_behind &&
+        (output_level == vstorage->num_levels() - 1)) {
+      assert(output_level > 1);
+      output_level--;
+    }
+    return output_level;
+  };
+
+  // Older windows first, they are complete
+  std::vector<size_t> picked;
+  for (size_t end = sorted_runs.size(); end > 0 && picked.empty();) {
+    size_t start = end - 1;
+    if (!sorted_runs[start].being_compacted) {
+      while (start > 0 && !sorted_runs[start - 1].being_compacted &&
+             windows[start - 1] == windows[end - 1]) {
+        --start;
+      }
+      if (end - start >= min_merge_width) {
+        for (size_t i = end - std::min(end - start, max_merge_width); i < end;
+             ++i) {
+          picked.push_back(i);
+        }
+      }
+    }
+    end = start;
+  }
+  // Then the late sorted runs, the newest one has no older window to go to
+  for (size_t i = sorted_runs.size() - 1; i-- > 0 && picked.empty();) {
+    if (sorted_runs[i].being_compacted) {
+      continue;
+    }
+    for (size_t k = i + 1; k < sorted_runs.size(); ++k) {
+      auto& sr = sorted_runs[k];
+      if (sr.being_compacted) {
+        break;
+      }
+      if (windows[k] == windows[i]) {
+        if (k > i + 1 && output_level_after(k) > 0) {
+          picked = {i, k};
+        }
+        break;
+      }
+      bool overlap =
+          sr.level == 0
+              ? ucmp->Compare(ranges[i].first, ranges[k].second) <= 0 &&
+                    ucmp->Compare(ranges[k].first, ranges[i].second) <= 0
+              : vstorage->OverlapInLevel(sr.level, &ranges[i].first,
+                                         &ranges[i].second);
+      if (overlap) {
+        break;
+      }
+    }
+  }
+  if (picked.empty()) {
+    ROCKS_LOG_BUFFER(log_buffer, "[%s] Universal: time window nothing to do\n",
+                     cf_name.c_str());
+    return nullptr;
+  }
+
+  int start_level = sorted_runs[picked.front()].level;
+  int output_level = output_level_after(picked.back());
+  std::vector<CompactionInputFiles> inputs(vstorage->num_levels() -
+                                           start_level);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i].level = start_level + static_cast<int>(i);
+  }
+  uint64_t estimated_total_size = 0;
+  char file_num_buf[kFormatFileNumberBufSize];
+  for (auto i : picked) {
+    auto& picking_sr = sorted_runs[i];
+    if (picking_sr.level == 0) {
+      inputs[0].files.push_back(picking_sr.file);
+    } else {
+      inputs[picking_sr.level - start_level].files =
+          vstorage->LevelFiles(picking_sr.level);
+    }
+    estimated_total_size += picking_sr.size;
+    picking_sr.DumpSizeInfo(file_num_buf, sizeof(file_num_buf), i);
+    ROCKS_LOG_BUFFER(log_buffer,
+                     "[%s] Universal: Picking %s of time window %" PRIu64,
+                     cf_name.c_str(), file_num_buf, windows[i]);
+  }
+
+  CompactionParams params(vstorage, ioptions_, mutable_cf_options);
+  params.inputs = std::move(inputs);
+  params.output_level = output_level;
+  params.target_file_size = MaxFileSizeForLevel(
+      mutable_cf_options, output_level, kCompactionStyleUniversal);
+  params.max_compaction_bytes = LLONG_MAX;
+  params.output_path_id =
+      GetPathId(ioptions_, mutable_cf_options, estimated_total_size);
+  params.compression = GetCompressionType(ioptions_, vstorage,
+                                          mutable_cf_options, output_level, 1);
+  params.compression_opts =
+      GetCompressionOptions(ioptions_, vstorage, output_level);
+  params.score = score;
+  // A map compaction links the late sorted run into its window, the
+  // composite compaction merges them afterwards
+  if (ioptions_.enable_lazy_compaction) {
+    params.max_subcompactions = 1;
+    params.compaction_type = kMapCompaction;
+  }
+  params.compaction_reason = CompactionReason::kUniversalTimeWindow;
+
+  return new Compaction(std::move(params));
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 #endif  // !ROCKSDB_LITE
@@ -71,6 +71,13 @@ class UniversalCompactionPicker : public CompactionPicker {
       std::vector<SortedRun>* sorted_runs, size_t reduce_sorted_run_target,
       LogBuffer* log_buffer);
 
+  // Pick the sorted runs of one time window to merge, see
+  // CompactionOptionsUniversal::time_window
+  Compaction* PickTimeWindowCompaction(
+      const std::string& cf_name, const MutableCFOptions& mutable_cf_options,
+      VersionStorageInfo* vstorage, double score,
+      const std::vector<SortedRun>& sorted_runs, LogBuffer* log_buffer);
+
   // Used in universal compaction when the enabled_trivial_move
   // option is set. Checks whether there are any overlapping files
   // in the input. Returns true if the input files are non
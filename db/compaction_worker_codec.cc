@@ -0,0 +1,463 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/compaction_worker_codec.h"
+
+#include <cstring>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+
+namespace TERARKDB_NAMESPACE {
+
+const Slice kCompactionWorkerMagic("\xff" "TWC", 4);
+
+namespace {
+
+const uint32_t kCompactionWorkerFormatVersion = 1;
+
+// Writer and Reader keep the field lists of Encode and Decode side by side,
+// a reader stays !ok() after the first truncated or malformed field.
+struct Writer {
+  std::string* dst;
+
+  void U64(uint64_t v) { PutVarint64(dst, v); }
+  void I64(int64_t v) { PutVarsignedint64(dst, v); }
+  void Bool(bool v) { dst->push_back(v ? 1 : 0); }
+  void Str(const Slice& v) { PutLengthPrefixedSlice(dst, v); }
+  void Double(double v) {
+    uint64_t u;
+    static_assert(sizeof(u) == sizeof(v), "double must be 64 bits");
+    memcpy(&u, &v, sizeof(u));
+    PutFixed64(dst, u);
+  }
+  void Float(float v) {
+    uint32_t u;
+    static_assert(sizeof(u) == sizeof(v), "float must be 32 bits");
+    memcpy(&u, &v, sizeof(u));
+    PutFixed32(dst, u);
+  }
+};
+
+struct Reader {
+  Slice input;
+  bool ok = true;
+
+  template <class T>
+  void U64(T* v) {
+    uint64_t u = 0;
+    ok = ok && GetVarint64(&input, &u);
+    *v = static_cast<T>(u);
+  }
+  template <class T>
+  void I64(T* v) {
+    uint64_t u = 0;
+    ok = ok && GetVarint64(&input, &u);
+    *v = static_cast<T>(zigzagToI64(u));
+  }
+  void Bool(bool* v) {
+    ok = ok && !input.empty();
+    if (ok) {
+      *v = input[0] != 0;
+      input.remove_prefix(1);
+    }
+  }
+  void Str(std::string* v) {
+    Slice s;
+    ok = ok && GetLengthPrefixedSlice(&input, &s);
+    if (ok) {
+      v->assign(s.data(), s.size());
+    }
+  }
+  void Double(double* v) {
+    uint64_t u = 0;
+    ok = ok && GetFixed64(&input, &u);
+    memcpy(v, &u, sizeof(u));
+  }
+  void Float(float* v) {
+    uint32_t u = 0;
+    ok = ok && GetFixed32(&input, &u);
+    memcpy(v, &u, sizeof(u));
+  }
+  // Element count of a vector, bounded by the remaining input so a corrupted
+  // count can not trigger a huge allocation.
+  size_t Count() {
+    uint64_t n = 0;
+    U64(&n);
+    ok = ok && n <= input.size();
+    return ok ? static_cast<size_t>(n) : 0;
+  }
+};
+
+void EncodeStatus(Writer& w, const Status& s) {
+  w.U64(s.code());
+  w.U64(s.subcode());
+  w.U64(s.severity());
+  w.Str(s.getState() == nullptr ? Slice() : Slice(s.getState()));
+}
+
+void DecodeStatus(Reader& r, Status* s) {
+  unsigned char code = 0, subcode = 0, sev = 0;
+  std::string state;
+  r.U64(&code);
+  r.U64(&subcode);
+  r.U64(&sev);
+  r.Str(&state);
+  if (r.ok) {
+    *s = Status(code, subcode, sev, state.empty() ? nullptr : state.c_str());
+  }
+}
+
+// InternalKey::Encode() asserts a non empty key, actual_end is empty when the
+// compaction ran to the end of its input.
+void EncodeInternalKey(Writer& w, const InternalKey& key) {
+  w.Str(*key.rep());
+}
+
+void DecodeInternalKey(Reader& r, InternalKey* key) { r.Str(key->rep()); }
+
+void EncodeFileMetaData(Writer& w, const FileMetaData& f) {
+  w.U64(f.fd.packed_number_and_path_id);
+  w.U64(f.fd.file_size);
+  w.U64(f.fd.smallest_seqno);
+  w.U64(f.fd.largest_seqno);
+  EncodeInternalKey(w, f.smallest);
+  EncodeInternalKey(w, f.largest);
+  const TablePropertyCache& p = f.prop;
+  w.U64(p.num_entries);
+  w.U64(p.num_deletions);
+  w.U64(p.raw_key_size);
+  w.U64(p.raw_value_size);
+  w.U64(p.flags);
+  w.U64(p.purpose);
+  w.U64(p.max_read_amp);
+  w.Float(p.read_amp);
+  w.U64(p.dependence.size());
+  for (auto& d : p.dependence) {
+    w.U64(d.file_number);
+    w.U64(d.entry_count);
+  }
+  w.U64(p.inheritance.size());
+  for (auto i : p.inheritance) {
+    w.U64(i);
+  }
+}
+
+void DecodeFileMetaData(Reader& r, FileMetaData* f) {
+  r.U64(&f->fd.packed_number_and_path_id);
+  r.U64(&f->fd.file_size);
+  r.U64(&f->fd.smallest_seqno);
+  r.U64(&f->fd.largest_seqno);
+  DecodeInternalKey(r, &f->smallest);
+  DecodeInternalKey(r, &f->largest);
+  TablePropertyCache& p = f->prop;
+  r.U64(&p.num_entries);
+  r.U64(&p.num_deletions);
+  r.U64(&p.raw_key_size);
+  r.U64(&p.raw_value_size);
+  r.U64(&p.flags);
+  r.U64(&p.purpose);
+  r.U64(&p.max_read_amp);
+  r.Float(&p.read_amp);
+  p.dependence.resize(r.Count());
+  for (auto& d : p.dependence) {
+    r.U64(&d.file_number);
+    r.U64(&d.entry_count);
+  }
+  std::vector<uint64_t> inheritance(r.Count());
+  for (auto& i : inheritance) {
+    r.U64(&i);
+  }
+  p.inheritance = std::move(inheritance);
+}
+
+void EncodeFileInfo(Writer& w, const CompactionWorkerResult::FileInfo& f) {
+  EncodeInternalKey(w, f.smallest);
+  EncodeInternalKey(w, f.largest);
+  w.Str(f.file_name);
+  w.U64(f.smallest_seqno);
+  w.U64(f.largest_seqno);
+  w.U64(f.file_size);
+  w.U64(f.marked_for_compaction);
+}
+
+void DecodeFileInfo(Reader& r, CompactionWorkerResult::FileInfo* f) {
+  DecodeInternalKey(r, &f->smallest);
+  DecodeInternalKey(r, &f->largest);
+  r.Str(&f->file_name);
+  r.U64(&f->smallest_seqno);
+  r.U64(&f->largest_seqno);
+  r.U64(&f->file_size);
+  r.U64(&f->marked_for_compaction);
+}
+
+void EncodeHeader(std::string* dst) {
+  dst->append(kCompactionWorkerMagic.data(), kCompactionWorkerMagic.size());
+  PutVarint32(dst, kCompactionWorkerFormatVersion);
+}
+
+Status DecodeHeader(Slice* input) {
+  if (!IsCompactionWorkerBinary(*input)) {
+    return Status::Corruption("CompactionWorker: bad magic");
+  }
+  input->remove_prefix(kCompactionWorkerMagic.size());
+  uint32_t version = 0;
+  if (!GetVarint32(input, &version)) {
+    return Status::Corruption("CompactionWorker: truncated header");
+  }
+  if (version != kCompactionWorkerFormatVersion) {
+    return Status::NotSupported("CompactionWorker: unknown format version",
+                                std::to_string(version));
+  }
+  return Status::OK();
+}
+
+Status CheckReader(const Reader& r, const char* what) {
+  if (!r.ok) {
+    return Status::Corruption("CompactionWorker: truncated message", what);
+  }
+  if (!r.input.empty()) {
+    return Status::Corruption("CompactionWorker: trailing bytes", what);
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+bool IsCompactionWorkerBinary(const Slice& data) {
+  return data.starts_with(kCompactionWorkerMagic);
+}
+
+void EncodeCompactionWorkerContext(const CompactionWorkerContext& c,
+                                   std::string* dst) {
+  EncodeHeader(dst);
+  Writer w{dst};
+  w.Str(c.user_comparator);
+  w.Str(c.merge_operator);
+  w.Str(c.merge_operator_data.data);
+  w.Str(c.value_meta_extractor_factory);
+  w.Str(c.value_meta_extractor_factory_options.data);
+  w.Str(c.compaction_filter);
+  w.Str(c.compaction_filter_factory);
+  w.Bool(c.compaction_filter_context.is_full_compaction);
+  w.Bool(c.compaction_filter_context.is_manual_compaction);
+  w.U64(c.compaction_filter_context.column_family_id);
+  w.Str(c.compaction_filter_data.data);
+  w.U64(c.blob_config.blob_size);
+  w.Double(c.blob_config.large_key_ratio);
+  w.U64(c.separation_type);
+  w.Str(c.table_factory);
+  w.Str(c.table_factory_options);
+  w.U64(c.bloom_locality);
+  w.U64(c.cf_paths.size());
+  for (auto& path : c.cf_paths) {
+    w.Str(path);
+  }
+  w.Str(c.prefix_extractor);
+  w.Str(c.prefix_extractor_options);
+  w.Bool(c.has_start);
+  w.Bool(c.has_end);
+  w.Str(c.start.data);
+  w.Str(c.end.data);
+  w.U64(c.last_sequence);
+  w.U64(c.earliest_write_conflict_snapshot);
+  w.U64(c.preserve_deletes_seqnum);
+  w.U64(c.file_metadata.size());
+  for (auto& pair : c.file_metadata) {
+    w.U64(pair.first);
+    EncodeFileMetaData(w, pair.second);
+  }
+  w.U64(c.inputs.size());
+  for (auto& pair : c.inputs) {
+    w.I64(pair.first);
+    w.U64(pair.second);
+  }
+  w.Str(c.cf_name);
+  w.U64(c.target_file_size);
+  w.U64(c.compression);
+  w.I64(c.compression_opts.window_bits);
+  w.I64(c.compression_opts.level);
+  w.I64(c.compression_opts.strategy);
+  w.U64(c.compression_opts.max_dict_bytes);
+  w.U64(c.compression_opts.zstd_max_train_bytes);
+  w.Bool(c.compression_opts.enabled);
+  w.U64(c.existing_snapshots.size());
+  for (auto s : c.existing_snapshots) {
+    w.U64(s);
+  }
+  w.Str(c.smallest_user_key.data);
+  w.Str(c.largest_user_key.data);
+  w.I64(c.level);
+  w.I64(c.output_level);
+  w.I64(c.number_levels);
+  w.Bool(c.skip_filters);
+  w.Bool(c.bottommost_level);
+  w.Bool(c.allow_ingest_behind);
+  w.Bool(c.preserve_deletes);
+  w.U64(c.int_tbl_prop_collector_factories.size());
+  for (auto& np : c.int_tbl_prop_collector_factories) {
+    w.Str(np.name);
+    w.Str(np.param.data);
+  }
+  w.U64(c.table_tail_sizes.size());
+  for (auto& pair : c.table_tail_sizes) {
+    w.U64(pair.first);
+    w.U64(pair.second);
+  }
+  w.U64(c.compaction_readahead_size);
+}
+
+Status DecodeCompactionWorkerContext(Slice input, CompactionWorkerContext* c) {
+  Status s = DecodeHeader(&input);
+  if (!s.ok()) {
+    return s;
+  }
+  Reader r{input};
+  r.Str(&c->user_comparator);
+  r.Str(&c->merge_operator);
+  r.Str(&c->merge_operator_data.data);
+  r.Str(&c->value_meta_extractor_factory);
+  r.Str(&c->value_meta_extractor_factory_options.data);
+  r.Str(&c->compaction_filter);
+  r.Str(&c->compaction_filter_factory);
+  r.Bool(&c->compaction_filter_context.is_full_compaction);
+  r.Bool(&c->compaction_filter_context.is_manual_compaction);
+  r.U64(&c->compaction_filter_context.column_family_id);
+  r.Str(&c->compaction_filter_data.data);
+  r.U64(&c->blob_config.blob_size);
+  r.Double(&c->blob_config.large_key_ratio);
+  r.U64(&c->separation_type);
+  r.Str(&c->table_factory);
+  r.Str(&c->table_factory_options);
+  r.U64(&c->bloom_locality);
+  c->cf_paths.resize(r.Count());
+  for (auto& path : c->cf_paths) {
+    r.Str(&path);
+  }
+  r.Str(&c->prefix_extractor);
+  r.Str(&c->prefix_extractor_options);
+  r.Bool(&c->has_start);
+  r.Bool(&c->has_end);
+  r.Str(&c->start.data);
+  r.Str(&c->end.data);
+  r.U64(&c->last_sequence);
+  r.U64(&c->earliest_write_conflict_snapshot);
+  r.U64(&c->preserve_deletes_seqnum);
+  c->file_metadata.resize(r.Count());
+  for (auto& pair : c->file_metadata) {
+    r.U64(&pair.first);
+    DecodeFileMetaData(r, &pair.second);
+  }
+  c->inputs.resize(r.Count());
+  for (auto& pair : c->inputs) {
+    r.I64(&pair.first);
+    r.U64(&pair.second);
+  }
+  r.Str(&c->cf_name);
+  r.U64(&c->target_file_size);
+  r.U64(&c->compression);
+  r.I64(&c->compression_opts.window_bits);
+  r.I64(&c->compression_opts.level);
+  r.I64(&c->compression_opts.strategy);
+  r.U64(&c->compression_opts.max_dict_bytes);
+  r.U64(&c->compression_opts.zstd_max_train_bytes);
+  r.Bool(&c->compression_opts.enabled);
+  c->existing_snapshots.resize(r.Count());
+  for (auto& s : c->existing_snapshots) {
+    r.U64(&s);
+  }
+  r.Str(&c->smallest_user_key.data);
+  r.Str(&c->largest_user_key.data);
+  r.I64(&c->level);
+  r.I64(&c->output_level);
+  r.I64(&c->number_levels);
+  r.Bool(&c->skip_filters);
+  r.Bool(&c->bottommost_level);
+  r.Bool(&c->allow_ingest_behind);
+  r.Bool(&c->preserve_deletes);
+  c->int_tbl_prop_collector_factories.resize(r.Count());
+  for (auto& np : c->int_tbl_prop_collector_factories) {
+    r.Str(&np.name);
+    r.Str(&np.param.data);
+  }
+  c->table_tail_sizes.resize(r.Count());
+  for (auto& pair : c->table_tail_sizes) {
+    r.U64(&pair.first);
+    r.U64(&pair.second);
+  }
+  r.U64(&c->compaction_readahead_size);
+  return CheckReader(r, "context");
+}
+
+void EncodeCompactionWorkerResult(const CompactionWorkerResult& result,
+                                  std::string* dst) {
+  EncodeHeader(dst);
+  Writer w{dst};
+  EncodeStatus(w, result.status);
+  EncodeInternalKey(w, result.actual_start);
+  EncodeInternalKey(w, result.actual_end);
+  w.U64(result.files.size());
+  for (auto& f : result.files) {
+    EncodeFileInfo(w, f);
+  }
+  w.Str(result.stat_all);
+  w.U64(result.time_us);
+}
+
+Status DecodeCompactionWorkerResult(Slice input,
+                                    CompactionWorkerResult* result) {
+  Status s = DecodeHeader(&input);
+  if (!s.ok()) {
+    return s;
+  }
+  Reader r{input};
+  DecodeStatus(r, &result->status);
+  DecodeInternalKey(r, &result->actual_start);
+  DecodeInternalKey(r, &result->actual_end);
+  result->files.resize(r.Count());
+  for (auto& f : result->files) {
+    DecodeFileInfo(r, &f);
+  }
+  r.Str(&result->stat_all);
+  r.U64(&result->time_us);
+  return CheckReader(r, "result");
+}
+
+void EncodeCompactionWorkerFileInfo(
+    const CompactionWorkerResult::FileInfo& file_info, std::string* dst) {
+  Writer w{dst};
+  EncodeFileInfo(w, file_info);
+}
+
+Status DecodeCompactionWorkerFileInfo(
+    Slice input, CompactionWorkerResult::FileInfo* file_info) {
+  Reader r{input};
+  DecodeFileInfo(r, file_info);
+  return CheckReader(r, "file info");
+}
+
+void PutCompactionWorkerFrame(std::string* dst, CompactionWorkerFrameType type,
+                              const Slice& payload) {
+  PutFixed32(dst, static_cast<uint32_t>(payload.size()));
+  dst->push_back(type);
+  dst->append(payload.data(), payload.size());
+}
+
+bool DecodeCompactionWorkerFrameHeader(const char* header,
+                                       CompactionWorkerFrameType* type,
+                                       uint32_t* payload_size) {
+  *payload_size = DecodeFixed32(header);
+  *type = static_cast<CompactionWorkerFrameType>(header[4]);
+  switch (*type) {
+    case kCompactionWorkerRequest:
+    case kCompactionWorkerFileInfo:
+    case kCompactionWorkerResult:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,66 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <string>
+
+#include "db/compaction.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// Binary wire format of the remote compaction protocol. A message starts with
+// kCompactionWorkerMagic followed by a varint32 format version, every field
+// is written in declaration order with the varint / length prefixed encoding
+// of util/coding.h. Decoders use IsCompactionWorkerBinary() to tell the
+// format apart from the legacy serialization, so old and new dispatchers and
+// workers can talk to each other during a rolling upgrade.
+extern const Slice kCompactionWorkerMagic;
+
+extern bool IsCompactionWorkerBinary(const Slice& data);
+
+extern void EncodeCompactionWorkerContext(
+    const CompactionWorkerContext& context, std::string* dst);
+
+extern Status DecodeCompactionWorkerContext(Slice input,
+                                            CompactionWorkerContext* context);
+
+extern void EncodeCompactionWorkerResult(const CompactionWorkerResult& result,
+                                         std::string* dst);
+
+extern Status DecodeCompactionWorkerResult(Slice input,
+                                           CompactionWorkerResult* result);
+
+// A single output file, streamed by a persistent worker as soon as the file
+// is finished. Not prefixed with the magic, it is only used inside frames.
+extern void EncodeCompactionWorkerFileInfo(
+    const CompactionWorkerResult::FileInfo& file_info, std::string* dst);
+
+extern Status DecodeCompactionWorkerFileInfo(
+    Slice input, CompactionWorkerResult::FileInfo* file_info);
+
+// Framing used between a persistent dispatcher and its worker processes:
+// fixed32 payload length, one byte frame type, payload.
+enum CompactionWorkerFrameType : char {
+  kCompactionWorkerRequest = 'C',
+  kCompactionWorkerFileInfo = 'F',
+  kCompactionWorkerResult = 'R',
+};
+
+static const size_t kCompactionWorkerFrameHeaderSize = 5;
+
+extern void PutCompactionWorkerFrame(std::string* dst,
+                                     CompactionWorkerFrameType type,
+                                     const Slice& payload);
+
+// Parse a frame header, returns false if the type is unknown.
+extern bool DecodeCompactionWorkerFrameHeader(const char* header,
+                                              CompactionWorkerFrameType* type,
+                                              uint32_t* payload_size);
+
+}  // namespace TERARKDB_NAMESPACE
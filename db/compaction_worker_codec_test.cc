@@ -0,0 +1,206 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/compaction_worker_codec.h"
+
+#include <string>
+
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class CompactionWorkerCodecTest : public testing::Test {
+ public:
+  static CompactionWorkerContext NewContext() {
+    CompactionWorkerContext c;
+    c.user_comparator = "leveldb.BytewiseComparator";
+    c.merge_operator = "merge";
+    c.merge_operator_data = std::string("\0\1\2", 3);
+    c.compaction_filter_context.is_full_compaction = true;
+    c.compaction_filter_context.is_manual_compaction = false;
+    c.compaction_filter_context.column_family_id = 7;
+    c.blob_config = {4096, 0.25};
+    c.separation_type = 2;
+    c.table_factory = "BlockBasedTable";
+    c.table_factory_options = "block_size=4096;";
+    c.bloom_locality = 1;
+    c.cf_paths = {"/data/a", "/data/b"};
+    c.has_start = true;
+    c.has_end = false;
+    c.start = std::string("k100");
+    c.last_sequence = 1000;
+    c.earliest_write_conflict_snapshot = 900;
+    c.preserve_deletes_seqnum = 0;
+    FileMetaData f;
+    f.fd = FileDescriptor(12, 1, 65536, 10, 20);
+    f.smallest.Set("a", 10, kTypeValue);
+    f.largest.Set("z", 20, kTypeDeletion);
+    f.prop.num_entries = 100;
+    f.prop.purpose = kMapSst;
+    f.prop.read_amp = 1.5f;
+    f.prop.dependence = {{3, 40}, {5, 60}};
+    f.prop.inheritance = {1, 2};
+    c.file_metadata.emplace_back(12, f);
+    c.inputs = {{-1, 12}, {6, 12}};
+    c.cf_name = "default";
+    c.target_file_size = 64 << 20;
+    c.compression = kZSTD;
+    c.compression_opts.level = -3;
+    c.existing_snapshots = {500, 800};
+    c.smallest_user_key = std::string("a");
+    c.largest_user_key = std::string("z");
+    c.level = 5;
+    c.output_level = 6;
+    c.number_levels = 7;
+    c.skip_filters = false;
+    c.bottommost_level = true;
+    c.allow_ingest_behind = false;
+    c.preserve_deletes = false;
+    c.int_tbl_prop_collector_factories.push_back({"collector", {"param"}});
+    c.table_tail_sizes = {{12, 8192}};
+    c.compaction_readahead_size = 2 << 20;
+    return c;
+  }
+};
+
+TEST_F(CompactionWorkerCodecTest, ContextRoundTrip) {
+  auto c = NewContext();
+  std::string encoded;
+  EncodeCompactionWorkerContext(c, &encoded);
+  ASSERT_TRUE(IsCompactionWorkerBinary(encoded));
+
+  CompactionWorkerContext d;
+  ASSERT_OK(DecodeCompactionWorkerContext(encoded, &d));
+  ASSERT_EQ(c.user_comparator, d.user_comparator);
+  ASSERT_EQ(c.merge_operator_data.data, d.merge_operator_data.data);
+  ASSERT_TRUE(d.compaction_filter_context.is_full_compaction);
+  ASSERT_EQ(7, d.compaction_filter_context.column_family_id);
+  ASSERT_EQ(4096, d.blob_config.blob_size);
+  ASSERT_EQ(0.25, d.blob_config.large_key_ratio);
+  ASSERT_EQ(c.cf_paths, d.cf_paths);
+  ASSERT_TRUE(d.has_start);
+  ASSERT_FALSE(d.has_end);
+  ASSERT_EQ("k100", d.start.data);
+  ASSERT_EQ(900, d.earliest_write_conflict_snapshot);
+  ASSERT_EQ(1, d.file_metadata.size());
+  auto& f = d.file_metadata[0].second;
+  ASSERT_EQ(12, d.file_metadata[0].first);
+  ASSERT_EQ(12, f.fd.GetNumber());
+  ASSERT_EQ(1, f.fd.GetPathId());
+  ASSERT_EQ(65536, f.fd.file_size);
+  ASSERT_EQ(20, f.fd.largest_seqno);
+  ASSERT_EQ(c.file_metadata[0].second.smallest.Encode(), f.smallest.Encode());
+  ASSERT_EQ(c.file_metadata[0].second.largest.Encode(), f.largest.Encode());
+  ASSERT_TRUE(f.prop.is_map_sst());
+  ASSERT_EQ(1.5f, f.prop.read_amp);
+  ASSERT_EQ(2, f.prop.dependence.size());
+  ASSERT_EQ(5, f.prop.dependence[1].file_number);
+  ASSERT_EQ(60, f.prop.dependence[1].entry_count);
+  ASSERT_EQ(c.file_metadata[0].second.prop.inheritance, f.prop.inheritance);
+  ASSERT_EQ(c.inputs, d.inputs);
+  ASSERT_EQ(kZSTD, d.compression);
+  ASSERT_EQ(-3, d.compression_opts.level);
+  ASSERT_EQ(c.existing_snapshots, d.existing_snapshots);
+  ASSERT_EQ(6, d.output_level);
+  ASSERT_TRUE(d.bottommost_level);
+  ASSERT_EQ(1, d.int_tbl_prop_collector_factories.size());
+  ASSERT_EQ("param", d.int_tbl_prop_collector_factories[0].param.data);
+  ASSERT_EQ(c.table_tail_sizes, d.table_tail_sizes);
+  ASSERT_EQ(2 << 20, d.compaction_readahead_size);
+}
+
+TEST_F(CompactionWorkerCodecTest, ResultRoundTrip) {
+  CompactionWorkerResult r;
+  r.status = Status::Corruption("bad", "block");
+  r.actual_start.SetMinPossibleForUserKey("a");
+  CompactionWorkerResult::FileInfo file_info;
+  file_info.smallest.Set("a", 1, kTypeValue);
+  file_info.largest.Set("b", 2, kTypeValue);
+  file_info.file_name = "/tmp/000001.sst";
+  file_info.smallest_seqno = 1;
+  file_info.largest_seqno = 2;
+  file_info.file_size = 1234;
+  file_info.marked_for_compaction = 1;
+  r.files.push_back(file_info);
+  r.stat_all = "stat";
+  r.time_us = 42;
+
+  std::string encoded;
+  EncodeCompactionWorkerResult(r, &encoded);
+  CompactionWorkerResult d;
+  ASSERT_OK(DecodeCompactionWorkerResult(encoded, &d));
+  ASSERT_TRUE(d.status.IsCorruption());
+  ASSERT_EQ(r.status.ToString(), d.status.ToString());
+  ASSERT_EQ(r.actual_start.Encode(), d.actual_start.Encode());
+  ASSERT_TRUE(d.actual_end.rep()->empty());
+  ASSERT_EQ(1, d.files.size());
+  ASSERT_EQ("/tmp/000001.sst", d.files[0].file_name);
+  ASSERT_EQ(1234, d.files[0].file_size);
+  ASSERT_EQ(1, d.files[0].marked_for_compaction);
+  ASSERT_EQ("stat", d.stat_all);
+  ASSERT_EQ(42, d.time_us);
+
+  std::string encoded_file;
+  EncodeCompactionWorkerFileInfo(file_info, &encoded_file);
+  CompactionWorkerResult::FileInfo decoded_file;
+  ASSERT_OK(DecodeCompactionWorkerFileInfo(encoded_file, &decoded_file));
+  ASSERT_EQ(file_info.largest.Encode(), decoded_file.largest.Encode());
+  ASSERT_EQ(2, decoded_file.largest_seqno);
+}
+
+TEST_F(CompactionWorkerCodecTest, Corruption) {
+  std::string encoded;
+  EncodeCompactionWorkerContext(NewContext(), &encoded);
+  CompactionWorkerContext d;
+  for (size_t len : {size_t(0), size_t(3), size_t(5), encoded.size() / 2,
+                     encoded.size() - 1}) {
+    ASSERT_TRUE(
+        DecodeCompactionWorkerContext(Slice(encoded.data(), len), &d)
+            .IsCorruption());
+  }
+  ASSERT_TRUE(
+      DecodeCompactionWorkerContext(encoded + "x", &d).IsCorruption());
+  ASSERT_FALSE(IsCompactionWorkerBinary("{\"status\":{}}"));
+
+  // Unknown format version
+  std::string future(kCompactionWorkerMagic.data(),
+                     kCompactionWorkerMagic.size());
+  PutVarint32(&future, 100);
+  CompactionWorkerResult r;
+  ASSERT_TRUE(DecodeCompactionWorkerResult(future, &r).IsNotSupported());
+}
+
+TEST_F(CompactionWorkerCodecTest, Frame) {
+  std::string frames;
+  PutCompactionWorkerFrame(&frames, kCompactionWorkerFileInfo, "abc");
+  PutCompactionWorkerFrame(&frames, kCompactionWorkerResult, "");
+  ASSERT_EQ(2 * kCompactionWorkerFrameHeaderSize + 3, frames.size());
+
+  CompactionWorkerFrameType type;
+  uint32_t size;
+  ASSERT_TRUE(DecodeCompactionWorkerFrameHeader(frames.data(), &type, &size));
+  ASSERT_EQ(kCompactionWorkerFileInfo, type);
+  ASSERT_EQ(3, size);
+  ASSERT_EQ("abc",
+            frames.substr(kCompactionWorkerFrameHeaderSize, size));
+  const char* next = frames.data() + kCompactionWorkerFrameHeaderSize + size;
+  ASSERT_TRUE(DecodeCompactionWorkerFrameHeader(next, &type, &size));
+  ASSERT_EQ(kCompactionWorkerResult, type);
+  ASSERT_EQ(0, size);
+
+  frames[4] = 'x';
+  ASSERT_FALSE(DecodeCompactionWorkerFrameHeader(frames.data(), &type, &size));
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
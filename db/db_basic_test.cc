@@ -219,6 +219,59 @@ TEST_F(DBBasicTest, CompactedDB) {
             "Not implemented: Not supported operation in read only mode.");
 }
 
+TEST_F(DBBasicTest, CompactedDBWithMapSst) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  options.enable_lazy_compaction = true;
+  options.write_buffer_size = 1 << 20;
+  options.target_file_size_base = 1 << 20;
+  options.blob_size = 100;
+  options.compression = kNoCompression;
+  Reopen(options);
+  for (int i = 0; i < 300; ++i) {
+    ASSERT_OK(Put(Key(i), DummyString(1000, 'a' + i % 26)));
+  }
+  db_->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  // Leaves map ssts linking to the two sides of the deleted range
+  std::string begin = Key(100), end = Key(199);
+  Slice begin_slice(begin), end_slice(end);
+  ASSERT_OK(DeleteFilesInRange(db_, db_->DefaultColumnFamily(), &begin_slice,
+                               &end_slice));
+  Close();
+
+  options.max_open_files = -1;
+  ASSERT_OK(ReadOnlyReopen(options));
+  ASSERT_EQ(Put("new", "value").ToString(),
+            "Not implemented: Not supported in compacted db mode.");
+  for (int i = 0; i < 300; ++i) {
+    if (i >= 100 && i <= 199) {
+      ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+    } else {
+      ASSERT_EQ(DummyString(1000, 'a' + i % 26), Get(Key(i)));
+    }
+  }
+
+  std::vector<std::string> keys = {Key(250), Key(5), Key(150), Key(99),
+                                   Key(200), Key(300)};
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  std::vector<std::string> values;
+  std::vector<Status> status_list =
+      dbfull()->MultiGet(ReadOptions(), key_slices, &values);
+  ASSERT_EQ(6u, status_list.size());
+  ASSERT_EQ(6u, values.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    std::string expected = Get(keys[i]);
+    if (expected == "NOT_FOUND") {
+      ASSERT_TRUE(status_list[i].IsNotFound());
+    } else {
+      ASSERT_OK(status_list[i]);
+      ASSERT_EQ(expected, values[i]);
+    }
+  }
+  ASSERT_TRUE(status_list[2].IsNotFound());
+  ASSERT_TRUE(status_list[5].IsNotFound());
+}
+
 TEST_F(DBBasicTest, LevelLimitReopen) {
   Options options = CurrentOptions();
   CreateAndReopenWithCF({"pikachu"}, options);
@@ -564,6 +617,39 @@ TEST_F(DBBasicTest, Snapshot) {
   } while (ChangeOptions(kSkipHashCuckoo));
 }
 
+TEST_F(DBBasicTest, StaleSnapshot) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  Reopen(options);
+  const uint64_t kStalenessMicros = 1000000;
+  ASSERT_OK(Put("foo", "v1"));
+
+  // The snapshots within the staleness bound are shared
+  const Snapshot* s1 = db_->GetStaleSnapshot(kStalenessMicros);
+  ASSERT_OK(Put("foo", "v2"));
+  const Snapshot* s2 = db_->GetStaleSnapshot(kStalenessMicros);
+  ASSERT_EQ(s1, s2);
+  ASSERT_EQ(1U, GetNumSnapshots());
+  ASSERT_EQ("v1", Get("foo", s2));
+  db_->ReleaseSnapshot(s1);
+  ASSERT_EQ("v1", Get("foo", s2));
+
+  // Past the bound a new one is taken, the old one lives on with its holders
+  env_->addon_time_.fetch_add(2 * kStalenessMicros);
+  const Snapshot* s3 = db_->GetStaleSnapshot(kStalenessMicros);
+  ASSERT_NE(s2, s3);
+  ASSERT_EQ(2U, GetNumSnapshots());
+  ASSERT_EQ("v1", Get("foo", s2));
+  ASSERT_EQ("v2", Get("foo", s3));
+  db_->ReleaseSnapshot(s2);
+  ASSERT_EQ(1U, GetNumSnapshots());
+  db_->ReleaseSnapshot(s3);
+
+  // The DB holds the last one until closed
+  ASSERT_EQ(1U, GetNumSnapshots());
+  Close();
+}
+
 #endif  // ROCKSDB_LITE
 
 TEST_F(DBBasicTest, CompactBetweenSnapshots) {
@@ -847,13 +933,55 @@ TEST_F(DBBasicTest, MultiGetEmpty) {
   } while (ChangeCompactOptions());
 }
 
+#ifdef WITH_BOOSTLIB
+TEST_F(DBBasicTest, MultiGetAsync) {
+  CreateAndReopenWithCF({"pikachu"}, CurrentOptions());
+  ASSERT_OK(Put(1, "k1", "v1"));
+  ASSERT_OK(Put(1, "k2", "v2"));
+  ASSERT_OK(Flush(1));
+  ASSERT_OK(Put(1, "k3", "v3"));
+  ASSERT_OK(Put(0, "k1", "default"));
+
+  ReadOptions read_options;
+  read_options.aio_concurrency = 4;
+  std::vector<Status> statuses;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  int callbacks = 0;
+  auto cb = [&](std::vector<Status>&& s, std::vector<std::string>&& k,
+                std::vector<std::string>&& v) {
+    statuses = std::move(s);
+    keys = std::move(k);
+    values = std::move(v);
+    callbacks++;
+  };
+  db_->MultiGetAsync(read_options,
+                     {handles_[1], handles_[1], handles_[1], handles_[0]},
+                     {"k3", "k1", "no_key", "k1"}, cb);
+  DB::WaitAsync();
+  ASSERT_EQ(1, callbacks);
+  ASSERT_EQ(std::vector<std::string>({"k3", "k1", "no_key", "k1"}), keys);
+  ASSERT_OK(statuses[0]);
+  ASSERT_EQ("v3", values[0]);
+  ASSERT_OK(statuses[1]);
+  ASSERT_EQ("v1", values[1]);
+  ASSERT_TRUE(statuses[2].IsNotFound());
+  ASSERT_OK(statuses[3]);
+  ASSERT_EQ("default", values[3]);
+
+  db_->MultiGetAsync(read_options, {}, cb);
+  ASSERT_EQ(2, callbacks);
+  ASSERT_TRUE(statuses.empty());
+}
+#endif  // WITH_BOOSTLIB
+
 TEST_F(DBBasicTest, ChecksumTest) {
   BlockBasedTableOptions table_options;
   Options options = CurrentOptions();
   options.enable_lazy_compaction = false;
   options.blob_size = -1;
   // change when new checksum type added
-  int max_checksum = static_cast<int>(kxxHash64);
+  int max_checksum = static_cast<int>(kXXH3);
   const int kNumPerFile = 2;
 
   // generate one table with each type of checksum
@@ -868,7 +996,7 @@ TEST_F(DBBasicTest, ChecksumTest) {
   }
 
   // verify data with each type of checksum
-  for (int i = 0; i <= kxxHash64; ++i) {
+  for (int i = 0; i <= max_checksum; ++i) {
     table_options.checksum = static_cast<ChecksumType>(i);
     options.table_factory.reset(NewBlockBasedTableFactory(table_options));
     Reopen(options);
@@ -10,6 +10,7 @@
 
 #include "cache/lru_cache.h"
 #include "db/db_test_util.h"
+#include "monitoring/file_read_sample.h"
 #include "port/stack_trace.h"
 #include "rocksdb/terark_namespace.h"
 
@@ -252,6 +253,41 @@ TEST_F(DBBlockCacheTest, TestWithCompressedBlockCache) {
 }
 #endif  // SNAPPY
 
+TEST_F(DBBlockCacheTest, TestWithSecondaryCache) {
+  auto table_options = GetTableOptions();
+  auto options = GetOptions(table_options);
+  InitTable(options);
+
+  std::shared_ptr<SecondaryCache> secondary_cache =
+      NewCompressedSecondaryCache(1 << 25);
+  LRUCacheOptions cache_options(0, 0, false, 0.0);
+  cache_options.secondary_cache = secondary_cache;
+  table_options.block_cache = NewLRUCache(cache_options);
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+
+  // The block cache keeps no block, every block is demoted once released.
+  std::string value(kValueSize, 'a');
+  for (size_t i = 0; i < kNumBlocks; i++) {
+    ASSERT_EQ(value, Get(ToString(i)));
+  }
+  ASSERT_EQ(0U, TestGetTickerCount(options, BLOCK_CACHE_SECONDARY_HIT));
+  uint64_t secondary_misses =
+      TestGetTickerCount(options, BLOCK_CACHE_SECONDARY_MISS);
+  ASSERT_LE(kNumBlocks, secondary_misses);
+  ASSERT_LT(0U, secondary_cache->GetUsage());
+
+  // Now the blocks are decompressed from the secondary cache instead of read
+  // from the file.
+  for (size_t i = 0; i < kNumBlocks; i++) {
+    ASSERT_EQ(value, Get(ToString(i)));
+  }
+  ASSERT_EQ(kNumBlocks,
+            TestGetTickerCount(options, BLOCK_CACHE_SECONDARY_HIT));
+  ASSERT_EQ(secondary_misses,
+            TestGetTickerCount(options, BLOCK_CACHE_SECONDARY_MISS));
+}
+
 #ifndef ROCKSDB_LITE
 
 // Make sure that when options.block_cache is set, after a new table is
@@ -515,6 +551,113 @@ TEST_F(DBBlockCacheTest, ParanoidFileChecks) {
             TestGetTickerCount(options, BLOCK_CACHE_ADD));
 }
 
+TEST_F(DBBlockCacheTest, WarmUpHotBlocksOnOpen) {
+  auto table_options = GetTableOptions();
+  table_options.block_cache = NewLRUCache(1 << 20);
+  auto options = GetOptions(table_options);
+  options.hot_block_sample_interval = 1;
+  options.hot_block_set_persist_period_sec = 3600;
+  Reopen(options);
+  InitTable(options);
+  ASSERT_OK(Flush());
+  std::string value(kValueSize, 'a');
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(value, Get("1"));
+    ASSERT_EQ(value, Get("7"));
+  }
+
+  // Closing persists the hot blocks
+  Close();
+  ASSERT_OK(env_->FileExists(dbname_ + "/HOT_BLOCKS"));
+
+  // Reopen with an empty block cache
+  table_options.block_cache = NewLRUCache(1 << 20);
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  options.statistics = TERARKDB_NAMESPACE::CreateDBStatistics();
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"DBImpl::BGWorkBlockCacheWarmUp:end",
+        "DBBlockCacheTest::WarmUpHotBlocksOnOpen:Warmed"}});
+  SyncPoint::GetInstance()->EnableProcessing();
+  Reopen(options);
+  TEST_SYNC_POINT("DBBlockCacheTest::WarmUpHotBlocksOnOpen:Warmed");
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_EQ(2, TestGetTickerCount(options, BLOCK_CACHE_DATA_ADD));
+
+  uint64_t data_misses = TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS);
+  ASSERT_EQ(value, Get("1"));
+  ASSERT_EQ(value, Get("7"));
+  ASSERT_EQ(data_misses, TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS));
+  // Blocks never read are left alone
+  ASSERT_EQ(value, Get("4"));
+  ASSERT_EQ(data_misses + 1,
+            TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS));
+}
+
+TEST_F(DBBlockCacheTest, WarmUpHotBlocksAfterCompaction) {
+  auto table_options = GetTableOptions();
+  table_options.block_cache = NewLRUCache(1 << 20);
+  auto options = GetOptions(table_options);
+  options.disable_auto_compactions = true;
+  options.hot_block_sample_interval = 1;
+  options.warm_block_cache_after_compaction = true;
+  Reopen(options);
+  InitTable(options);
+  ASSERT_OK(Flush());
+  std::string value(kValueSize, 'b');
+  ASSERT_OK(Put("1", value));
+  ASSERT_OK(Put("7", value));
+  ASSERT_OK(Flush());
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(value, Get("1"));
+    ASSERT_EQ(value, Get("7"));
+  }
+
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  uint64_t data_misses = TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS);
+  ASSERT_EQ(value, Get("1"));
+  ASSERT_EQ(value, Get("7"));
+  ASSERT_EQ(data_misses, TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS));
+}
+
+TEST_F(DBBlockCacheTest, PrefetchIndexAndFilterOfHotFiles) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  options.prefetch_index_and_filter_hot_file_ratio = 0.4;
+  Reopen(options);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_OK(Put(Key(i), "v"));
+    ASSERT_OK(Flush());
+  }
+  auto cfd = reinterpret_cast<ColumnFamilyHandleImpl*>(
+                 db_->DefaultColumnFamily())
+                 ->cfd();
+  // Level 0 lists the newest file first, newer files are read more
+  std::vector<uint64_t> file_numbers;
+  uint64_t num_reads = 8 * kFileReadSampleRate;
+  for (auto f : cfd->current()->storage_info()->LevelFiles(0)) {
+    file_numbers.push_back(f->fd.GetNumber());
+    f->stats.num_reads_sampled.store(num_reads);
+    num_reads /= 2;
+  }
+  ASSERT_EQ(4, file_numbers.size());
+
+  // The next version ranks the files, two out of five are hot
+  ASSERT_OK(Put(Key(4), "v"));
+  ASSERT_OK(Flush());
+  auto table_cache = cfd->table_cache();
+  ASSERT_FALSE(table_cache->IsColdFile(file_numbers[0]));
+  ASSERT_FALSE(table_cache->IsColdFile(file_numbers[1]));
+  ASSERT_TRUE(table_cache->IsColdFile(file_numbers[2]));
+  ASSERT_TRUE(table_cache->IsColdFile(file_numbers[3]));
+
+  ASSERT_OK(dbfull()->SetOptions(
+      {{"prefetch_index_and_filter_hot_file_ratio", "1"}}));
+  for (auto file_number : file_numbers) {
+    ASSERT_FALSE(table_cache->IsColdFile(file_number));
+  }
+}
+
 TEST_F(DBBlockCacheTest, CompressedCache) {
   if (!Snappy_Supported()) {
     return;
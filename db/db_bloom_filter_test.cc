@@ -792,6 +792,48 @@ TEST_F(DBBloomFilterTest, PrefixExtractorBlockFilter) {
   delete iter;
 }
 
+TEST_F(DBBloomFilterTest, MemtableWholeKeyBloomFilter) {
+  const int kMemtableSize = 1 << 20;
+  const int kMemtableFilterSize = 1 << 13;
+  Options options = CurrentOptions();
+  options.write_buffer_size = kMemtableSize;
+  options.memtable_prefix_bloom_size_ratio =
+      static_cast<double>(kMemtableFilterSize) / kMemtableSize;
+  // No prefix extractor, the filter holds whole keys only
+  options.memtable_whole_key_filtering = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("AAAABBBB", "v1"));
+  ASSERT_OK(Put("AAAACCCC", "v2"));
+  get_perf_context()->Reset();
+  ASSERT_EQ("v1", Get("AAAABBBB"));
+  ASSERT_EQ("v2", Get("AAAACCCC"));
+  ASSERT_EQ(2, get_perf_context()->bloom_memtable_hit_count);
+  ASSERT_EQ(0, get_perf_context()->bloom_memtable_miss_count);
+  ASSERT_EQ("NOT_FOUND", Get("AAAADDDD"));
+  ASSERT_EQ(1, get_perf_context()->bloom_memtable_miss_count);
+
+  // With a prefix extractor a missing key sharing a prefix still hits
+  options.prefix_extractor.reset(NewFixedPrefixTransform(4));
+  options.memtable_whole_key_filtering = false;
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("AAAABBBB", "v1"));
+  get_perf_context()->Reset();
+  ASSERT_EQ("NOT_FOUND", Get("AAAADDDD"));
+  ASSERT_EQ(1, get_perf_context()->bloom_memtable_hit_count);
+  ASSERT_EQ(0, get_perf_context()->bloom_memtable_miss_count);
+
+  // Both together, whole keys decide point lookups
+  options.memtable_whole_key_filtering = true;
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("AAAABBBB", "v1"));
+  get_perf_context()->Reset();
+  ASSERT_EQ("NOT_FOUND", Get("AAAADDDD"));
+  ASSERT_EQ(1, get_perf_context()->bloom_memtable_miss_count);
+  ASSERT_EQ("v1", Get("AAAABBBB"));
+  ASSERT_EQ(1, get_perf_context()->bloom_memtable_hit_count);
+}
+
 #ifndef ROCKSDB_LITE
 class BloomStatsTestWithParam
     : public DBBloomFilterTest,
@@ -8,6 +8,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "db/db_test_util.h"
+#include "monitoring/file_read_sample.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
 #include "rocksdb/experimental.h"
@@ -425,6 +426,48 @@ TEST_F(DBCompactionTest, LazyCompactionTest) {
   }
 }
 
+TEST_F(DBCompactionTest, LazyCompactionPreemptedByShutdown) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  options.enable_lazy_compaction = true;
+  options.target_file_size_base = 32 << 10;
+  DestroyAndReopen(options);
+
+  Random rnd(301);
+  const int kNumKeys = 400;
+  std::vector<std::string> values;
+  for (int k = 0; k < kNumKeys; ++k) {
+    values.push_back(RandomString(&rnd, 1000));
+    ASSERT_OK(Put(Key(k), values[k]));
+  }
+  ASSERT_OK(Flush());
+
+  // The shutdown starts while the compaction runs, the compaction stops at
+  // the end of its first output file and installs it
+  int preempted = 0;
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "CompactFilesImpl:0",
+      [&](void* /*arg*/) { dbfull()->CancelAllBackgroundWork(false); });
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "CompactionJob::ProcessKeyValueCompaction:Preempted",
+      [&](void* /*arg*/) { ++preempted; });
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->EnableProcessing();
+
+  std::vector<LiveFileMetaData> level_files;
+  dbfull()->GetLiveFilesMetaData(&level_files);
+  ASSERT_EQ(1U, level_files.size());
+  ASSERT_OK(
+      dbfull()->CompactFiles(CompactionOptions(), {level_files[0].name}, 1));
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_EQ(1, preempted);
+
+  Reopen(options);
+  for (int k = 0; k < kNumKeys; ++k) {
+    ASSERT_EQ(values[k], Get(Key(k)));
+  }
+}
+
 TEST_P(DBCompactionTestWithParam, CompactionsPreserveDeletes) {
   //  For each options type we test following
   //  - Enable preserve_deletes
@@ -2336,6 +2379,57 @@ TEST_P(DBCompactionTestWithParam, LevelCompactionCFPathUse) {
   Destroy(options, true);
 }
 
+TEST_F(DBCompactionTest, HotDataRatioPathPlacement) {
+  Options options = CurrentOptions();
+  options.db_paths.emplace_back(dbname_, 1024 * 1024 * 1024);
+  options.db_paths.emplace_back(dbname_ + "_cold", 1024 * 1024 * 1024);
+  options.compaction_style = kCompactionStyleLevel;
+  options.level0_file_num_compaction_trigger = 2;
+  options.num_levels = 2;
+  options.target_file_size_base = 100 << 10;  // 100KB
+  options.hot_data_ratio = 0.5;
+  DestroyAndReopen(options);
+
+  Random rnd(301);
+  for (int num = 0; num < 2; num++) {
+    for (int i = 0; i < 40; i++) {
+      ASSERT_OK(Put(Key(i), RandomString(&rnd, 10000)));
+    }
+    ASSERT_OK(Flush());
+  }
+  dbfull()->TEST_WaitForCompact();
+
+  // Nothing is read yet, the last level is cold
+  int num_files = NumTableFilesAtLevel(1);
+  ASSERT_GT(num_files, 2);
+  ASSERT_EQ(0, GetSstFileCount(options.db_paths[0].path));
+  ASSERT_EQ(num_files, GetSstFileCount(options.db_paths[1].path));
+
+  auto cfd = reinterpret_cast<ColumnFamilyHandleImpl*>(
+                 db_->DefaultColumnFamily())
+                 ->cfd();
+  FileMetaData* hot_file = cfd->current()->storage_info()->LevelFiles(1)[0];
+  hot_file->stats.num_reads_sampled.store(100 * kFileReadSampleRate);
+  std::string smallest = hot_file->smallest.user_key().ToString();
+
+  // The next version moves the hot file to the first path, with its heat
+  ASSERT_OK(Put(Key(100), "v"));
+  ASSERT_OK(Flush());
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_EQ("1," + ToString(num_files), FilesPerLevel());
+  ASSERT_EQ(2, GetSstFileCount(options.db_paths[0].path));
+  ASSERT_EQ(num_files - 1, GetSstFileCount(options.db_paths[1].path));
+  hot_file = cfd->current()->storage_info()->LevelFiles(1)[0];
+  ASSERT_EQ(0U, hot_file->fd.GetPathId());
+  ASSERT_EQ(smallest, hot_file->smallest.user_key().ToString());
+  ASSERT_GT(hot_file->stats.num_reads_sampled.load(), 0U);
+
+  for (int i = 0; i < 40; i++) {
+    ASSERT_NE("NOT_FOUND", Get(Key(i)));
+  }
+  Destroy(options, true);
+}
+
 TEST_P(DBCompactionTestWithParam, ConvertCompactionStyle) {
   Random rnd(301);
   int max_key_level_insert = 200;
@@ -2587,6 +2681,59 @@ TEST_P(DBCompactionTestWithParam, ManualCompaction) {
   }
 }
 
+TEST_P(DBCompactionTestWithParam, ParallelRangeManualCompaction) {
+  Options options = CurrentOptions();
+  options.num_levels = 3;
+  options.disable_auto_compactions = true;
+  options.max_subcompactions = max_subcompactions_;
+  options.max_background_compactions = 4;
+  DestroyAndReopen(options);
+
+  // 8 files of disjoint ranges in the last level
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 50; ++j) {
+      ASSERT_OK(Put(Key(i * 100 + j), "v1"));
+    }
+    ASSERT_OK(Flush());
+    MoveFilesToLevel(2);
+  }
+  ASSERT_EQ("0,0,8", FilesPerLevel());
+
+  // In between the ranges of the second and the third file
+  ASSERT_OK(Put(Key(170), "v2"));
+  ASSERT_OK(Flush());
+  MoveFilesToLevel(1);
+  for (int j = 0; j < 50; j += 2) {
+    ASSERT_OK(Put(Key(600 + j), "v2"));
+  }
+  ASSERT_OK(Flush());
+  ASSERT_EQ("1,1,8", FilesPerLevel());
+
+  std::atomic<size_t> num_ranges{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::CompactRange:SplitRanges",
+      [&](void* arg) { num_ranges = *reinterpret_cast<size_t*>(arg); });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  CompactRangeOptions cro;
+  cro.exclusive_manual_compaction = exclusive_manual_compaction_;
+  cro.max_parallel_ranges = 4;
+  ASSERT_OK(db_->CompactRange(cro, nullptr, nullptr));
+  ASSERT_EQ(4u, num_ranges.load());
+  // The file in between the ranges is moved down after them
+  ASSERT_EQ("0,0,9", FilesPerLevel());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  ASSERT_EQ("v2", Get(Key(170)));
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 50; ++j) {
+      ASSERT_EQ(i == 6 && j % 2 == 0 ? "v2" : "v1", Get(Key(i * 100 + j)));
+    }
+  }
+}
+
 TEST_P(DBCompactionTestWithParam, ManualLevelCompactionOutputPathId) {
   Options options = CurrentOptions();
   options.db_paths.emplace_back(dbname_ + "_2", 2 * 10485760);
@@ -4028,6 +4175,41 @@ class NoopMergeOperator : public MergeOperator {
   virtual const char* Name() const override { return "Noop"; }
 };
 
+TEST_F(DBCompactionTest, DeferCompactionWithoutBuildMemory) {
+  Options options = CurrentOptions();
+  options.level0_file_num_compaction_trigger = 2;
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+
+  // The block based table doesn't bound the memory of its builds
+  uint64_t value;
+  ASSERT_FALSE(
+      db_->GetIntProperty(DB::Properties::kTableBuildWorkingMem, &value));
+
+  int admissions = 0;
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::EnoughMemoryForCompaction", [&](void* arg) {
+        // Defer the first attempt only
+        if (admissions++ == 0) {
+          *static_cast<bool*>(arg) = false;
+        }
+      });
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->EnableProcessing();
+
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK(Put(Key(0), "val"));
+    ASSERT_OK(Put(Key(1), "val"));
+    ASSERT_OK(Flush());
+  }
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_GE(admissions, 2);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  ASSERT_EQ(1, NumTableFilesAtLevel(1));
+  ASSERT_GT(options.statistics->getTickerCount(COMPACTION_CANCELLED), 0U);
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
 TEST_F(DBCompactionTest, PartialManualCompaction) {
   Options opts = CurrentOptions();
   opts.num_levels = 3;
@@ -4175,6 +4357,84 @@ TEST_P(DBCompactionTestWithParam, FixFileIngestionCompactionDeadlock) {
   Close();
 }
 
+TEST_F(DBCompactionTest, BlobCompressionPerRecord) {
+  if (!ZSTD_Supported()) {
+    return;
+  }
+  Options opts = CurrentOptions();
+  opts.compression = kZSTD;
+  opts.compression_opts.max_dict_bytes = 4096;
+  opts.blob_size = 32;  // turn on kv separation
+  opts.target_blob_file_size = 64 << 10;
+  opts.blob_compression_per_record = true;
+  DestroyAndReopen(opts);
+
+  auto value_of = [](int i) {
+    return "{\"id\": " + ToString(i) +
+           ", \"name\": \"user name\", \"tags\": [\"alpha\", \"beta\"], "
+           "\"payload\": \"" +
+           std::string(64 + i % 64, 'a' + i % 26) + "\"}";
+  };
+  for (int round = 0; round < 2; ++round) {
+    for (int i = round * 1000; i < round * 1000 + 2000; ++i) {
+      ASSERT_OK(Put(Key(i), value_of(i)));
+    }
+    ASSERT_OK(Flush());
+  }
+  // The blob outputs after the first one share its dictionary
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_GT(NumTableFilesAtLevel(-1), 1);
+
+  // Every blob SST holds a block per value
+  TablePropertiesCollection props;
+  ASSERT_OK(db_->GetPropertiesOfAllTables(&props));
+  size_t num_blob_tables = 0;
+  for (auto& pair : props) {
+    auto& p = *pair.second;
+    if (p.num_entries > 1 && p.num_data_blocks == p.num_entries) {
+      ++num_blob_tables;
+    }
+  }
+  ASSERT_EQ(static_cast<size_t>(NumTableFilesAtLevel(-1)), num_blob_tables);
+
+  Reopen(opts);
+  for (int i = 0; i < 3000; ++i) {
+    ASSERT_EQ(value_of(i), Get(Key(i)));
+  }
+}
+
+TEST_F(DBCompactionTest, BlobDefragment) {
+  Options opts = CurrentOptions();
+  opts.compression = kNoCompression;
+  opts.blob_size = 32;  // turn on kv separation
+  opts.target_blob_file_size = 1 << 20;
+  // Keep the key SSTs in L0, only GC rewrites the blob files
+  opts.level0_file_num_compaction_trigger = 100;
+  opts.level0_slowdown_writes_trigger = 200;
+  opts.level0_stop_writes_trigger = 200;
+  DestroyAndReopen(opts);
+
+  const int kNumFiles = 12;
+  const int kKeysPerFile = 100;
+  std::string value(100, 'v');
+  for (int i = 0; i < kNumFiles; ++i) {
+    for (int j = 0; j < kKeysPerFile; ++j) {
+      ASSERT_OK(Put(Key(i * kKeysPerFile + j), value + ToString(i)));
+    }
+    ASSERT_OK(Flush());
+  }
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  // A defragmentation merges at least 8 of the small blob files into one
+  ASSERT_LE(NumTableFilesAtLevel(-1), kNumFiles - 7);
+
+  Reopen(opts);
+  for (int i = 0; i < kNumFiles; ++i) {
+    for (int j = 0; j < kKeysPerFile; ++j) {
+      ASSERT_EQ(value + ToString(i), Get(Key(i * kKeysPerFile + j)));
+    }
+  }
+}
+
 TEST_F(DBCompactionTest, BlobOverlapThredhold) {
   std::string bigval =
       "012345678901234567890123456789012345678901234567890123456789012345678901"
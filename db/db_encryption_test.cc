@@ -7,6 +7,7 @@
 
 #include "db/db_test_util.h"
 #include "port/stack_trace.h"
+#include "rocksdb/env_encryption.h"
 #include "rocksdb/terark_namespace.h"
 #if !defined(ROCKSDB_LITE)
 #include "util/sync_point.h"
@@ -83,6 +84,112 @@ TEST_F(DBEncryptionTest, CheckEncrypted) {
   }
 }
 
+TEST_F(DBEncryptionTest, AESBlockCipher) {
+  // FIPS-197 appendix C
+  const char* expected[] = {"69C4E0D86A7B0430D8CDB78070B4C55A",
+                            "DDA97CA4864CDFE06EAF70A0EC0D7191",
+                            "8EA2B7CA516745BFEAFC49904B496089"};
+  std::string plain;
+  for (int i = 0; i < 16; ++i) {
+    plain.push_back(static_cast<char>(i * 0x11));
+  }
+  for (bool allow_aesni : {true, false}) {
+    for (size_t k = 0; k < 3; ++k) {
+      std::string key;
+      for (size_t i = 0; i < 16 + 8 * k; ++i) {
+        key.push_back(static_cast<char>(i));
+      }
+      std::unique_ptr<AESBlockCipher> cipher;
+      ASSERT_OK(AESBlockCipher::Create(key, &cipher, allow_aesni));
+      std::string block = plain;
+      ASSERT_OK(cipher->Encrypt(&block[0]));
+      ASSERT_EQ(expected[k], Slice(block).ToString(true));
+      ASSERT_OK(cipher->Decrypt(&block[0]));
+      ASSERT_EQ(plain, block);
+    }
+  }
+  std::unique_ptr<AESBlockCipher> cipher;
+  Status s = AESBlockCipher::Create(std::string(20, 'k'), &cipher);
+  ASSERT_TRUE(s.IsInvalidArgument());
+}
+
+TEST_F(DBEncryptionTest, AESCTRCipherStream) {
+  std::string key(32, 'k');
+  std::unique_ptr<AESBlockCipher> cipher;
+  ASSERT_OK(AESBlockCipher::Create(key, &cipher));
+  AESCTREncryptionProvider provider(std::move(cipher));
+  std::unique_ptr<AESBlockCipher> reference_cipher;
+  ASSERT_OK(AESBlockCipher::Create(key, &reference_cipher, false));
+  CTREncryptionProvider reference_provider(*reference_cipher);
+
+  // Files written by either provider are read by the other
+  std::string prefix(provider.GetPrefixLength(), '\0');
+  ASSERT_OK(provider.CreateNewPrefix("file", &prefix[0], prefix.size()));
+  std::string reference_prefix = prefix;
+  Slice prefix_slice(prefix);
+  Slice reference_prefix_slice(reference_prefix);
+  std::unique_ptr<BlockAccessCipherStream> stream;
+  std::unique_ptr<BlockAccessCipherStream> reference_stream;
+  ASSERT_OK(provider.CreateCipherStream("file", EnvOptions(), prefix_slice,
+                                        &stream));
+  ASSERT_OK(reference_provider.CreateCipherStream(
+      "file", EnvOptions(), reference_prefix_slice, &reference_stream));
+
+  Random rnd(301);
+  for (int i = 0; i < 1000; ++i) {
+    uint64_t offset = rnd.Uniform(1 << 20);
+    std::string plain = RandomString(&rnd, rnd.Uniform(4096));
+    std::string data = plain;
+    std::string reference_data = plain;
+    ASSERT_OK(stream->Encrypt(offset, &data[0], data.size()));
+    ASSERT_OK(reference_stream->Encrypt(offset, &reference_data[0],
+                                        reference_data.size()));
+    ASSERT_EQ(reference_data, data);
+    ASSERT_OK(stream->Decrypt(offset, &data[0], data.size()));
+    ASSERT_EQ(plain, data);
+  }
+}
+
+TEST_F(DBEncryptionTest, AESEncryptedDB) {
+  std::unique_ptr<AESBlockCipher> cipher;
+  ASSERT_OK(AESBlockCipher::Create(std::string(16, 'k'), &cipher));
+  std::unique_ptr<EncryptionProvider> provider(
+      new AESCTREncryptionProvider(std::move(cipher)));
+  std::unique_ptr<Env> encrypted_env(
+      NewEncryptedEnv(Env::Default(), provider.get()));
+
+  Options options = CurrentOptions();
+  options.env = encrypted_env.get();
+  std::string dbname = test::PerThreadDBPath("db_aes_encryption_test");
+  ASSERT_OK(DestroyDB(dbname, options));
+  DB* db;
+  ASSERT_OK(DB::Open(options, dbname, &db));
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_OK(db->Put(WriteOptions(), Key(i), "plain_value" + ToString(i)));
+  }
+  ASSERT_OK(db->Flush(FlushOptions()));
+  delete db;
+
+  // Nothing is readable without the key
+  std::vector<std::string> files;
+  ASSERT_OK(Env::Default()->GetChildren(dbname, &files));
+  for (auto& f : files) {
+    std::string contents;
+    if (ReadFileToString(Env::Default(), dbname + "/" + f, &contents).ok()) {
+      ASSERT_EQ(std::string::npos, contents.find("plain_value")) << f;
+    }
+  }
+
+  ASSERT_OK(DB::Open(options, dbname, &db));
+  std::string value;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_OK(db->Get(ReadOptions(), Key(i), &value));
+    ASSERT_EQ("plain_value" + ToString(i), value);
+  }
+  delete db;
+  ASSERT_OK(DestroyDB(dbname, options));
+}
+
 #endif  // ROCKSDB_LITE
 
 }  // namespace TERARKDB_NAMESPACE
@@ -248,6 +248,112 @@ TEST_F(DBFlushTest, FlushError) {
   ASSERT_NE(s, Status::OK());
 }
 
+TEST_F(DBFlushTest, PartitionedFlush) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 4 << 20;
+  options.target_file_size_base = 64 << 10;
+  options.max_flush_partitions = 4;
+  options.disable_auto_compactions = true;
+  options.env = env_;
+  Reopen(options);
+
+  const int kNumKeys = 4000;
+  Random rnd(301);
+  std::vector<std::string> values(kNumKeys);
+  for (int i = 0; i < kNumKeys; ++i) {
+    values[i] = RandomString(&rnd, 100);
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  // Newer versions of a user key stay in the range of the older ones
+  for (int i = 0; i < kNumKeys; i += 3) {
+    values[i] = RandomString(&rnd, 100);
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_OK(Flush());
+  ASSERT_EQ(4, NumTableFilesAtLevel(0));
+
+  std::vector<LiveFileMetaData> files;
+  db_->GetLiveFilesMetaData(&files);
+  std::sort(files.begin(), files.end(),
+            [](const LiveFileMetaData& a, const LiveFileMetaData& b) {
+              return a.smallestkey < b.smallestkey;
+            });
+  for (size_t i = 1; i < files.size(); ++i) {
+    ASSERT_LT(files[i - 1].largestkey, files[i].smallestkey);
+  }
+
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(values[count], iter->value().ToString());
+    ++count;
+  }
+  ASSERT_EQ(kNumKeys, count);
+
+  // Range deletions may span every range, such flushes keep one output
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(),
+                             Key(1), Key(2)));
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_OK(Flush());
+  ASSERT_EQ(5, NumTableFilesAtLevel(0));
+}
+
+TEST_F(DBFlushTest, FlushToBottommostLevel) {
+  Options options = CurrentOptions();
+  options.PrepareForBulkLoad();
+  options.num_levels = 3;
+  options.env = env_;
+  Reopen(options);
+
+  // Loaded in order, each flush overlaps nothing
+  const int kNumKeys = 3000;
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+    if (i % 1000 == 999) {
+      ASSERT_OK(Flush());
+    }
+  }
+  ASSERT_EQ("0,0,3", FilesPerLevel());
+
+  // Overlaps the files of the last level
+  ASSERT_OK(Put(Key(10), "new"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("1,0,3", FilesPerLevel());
+  ASSERT_OK(Put(Key(kNumKeys), "v" + ToString(kNumKeys)));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("1,0,4", FilesPerLevel());
+
+  ASSERT_EQ("new", Get(Key(10)));
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    ++count;
+  }
+  ASSERT_EQ(kNumKeys + 1, count);
+
+  // Concurrent writers into the vector memtable
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 100; ++i) {
+        ASSERT_OK(Put("z" + ToString(t) + Key(i), "v"));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_OK(Flush());
+  ASSERT_EQ("1,0,5", FilesPerLevel());
+  ASSERT_EQ("v", Get("z3" + Key(99)));
+}
+
 TEST_F(DBFlushTest, ManualFlushFailsInReadOnlyMode) {
   // Regression test for bug where manual flush hangs forever when the DB
   // is in read-only mode. Verify it now at least returns, despite failing.
@@ -520,6 +626,60 @@ TEST_P(DBAtomicFlushTest, PickMemtablesRaceWithBackgroundFlush) {
 INSTANTIATE_TEST_CASE_P(DBFlushDirectIOTest, DBFlushDirectIOTest,
                         testing::Bool());
 
+TEST_P(DBAtomicFlushTest, SmallColumnFamiliesFlushValuesInline) {
+  bool atomic_flush = GetParam();
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  if (atomic_flush) {
+    options.atomic_flush_group = NewAtomicFlushGroup();
+  }
+  options.blob_size = 16;
+  options.atomic_flush_inline_value_size = 64 << 20;
+  options.write_buffer_size = (static_cast<size_t>(64) << 20);
+
+  CreateAndReopenWithCF({"pikachu", "eevee"}, options);
+  size_t num_cfs = handles_.size();
+  ASSERT_EQ(3, num_cfs);
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i != 100; ++i) {
+    values.push_back(RandomString(&rnd, 100));
+  }
+  std::vector<int> cf_ids;
+  for (size_t cf = 0; cf != num_cfs; ++cf) {
+    cf_ids.emplace_back(static_cast<int>(cf));
+    for (int i = 0; i != 100; ++i) {
+      ASSERT_OK(Put(static_cast<int>(cf), Key(i), values[i]));
+    }
+  }
+  ASSERT_OK(Flush(cf_ids));
+
+  // A grouped flush writes one file per column family, the other flushes
+  // separate the values into blob files
+  std::vector<LiveFileMetaData> files;
+  db_->GetLiveFilesMetaData(&files);
+  std::map<std::string, int> num_files;
+  int num_blob_files = 0;
+  for (auto& file : files) {
+    ++num_files[file.column_family_name];
+    num_blob_files += file.level == -1;
+  }
+  if (atomic_flush) {
+    ASSERT_EQ(num_cfs, num_files.size());
+    for (auto& pair : num_files) {
+      ASSERT_EQ(1, pair.second);
+    }
+    ASSERT_EQ(0, num_blob_files);
+  } else {
+    ASSERT_GT(num_blob_files, 0);
+  }
+  for (size_t cf = 0; cf != num_cfs; ++cf) {
+    for (int i = 0; i != 100; ++i) {
+      ASSERT_EQ(values[i], Get(static_cast<int>(cf), Key(i)));
+    }
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(DBAtomicFlushTest, DBAtomicFlushTest, testing::Bool());
 
 }  // namespace TERARKDB_NAMESPACE
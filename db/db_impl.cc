@@ -54,7 +54,9 @@
 #include "db/version_edit.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "monitoring/cpu_attribution.h"
 #include "monitoring/in_memory_stats_history.h"
+#include "monitoring/io_attribution.h"
 #include "monitoring/iostats_context_imp.h"
 #include "monitoring/perf_context_imp.h"
 #include "monitoring/persistent_stats_history.h"
@@ -69,15 +71,18 @@
 #include "rocksdb/db.h"
 #include "rocksdb/env.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/stats_history.h"
 #include "rocksdb/status.h"
 #include "rocksdb/table.h"
 #include "rocksdb/terark_namespace.h"
+#include "rocksdb/utilities/sim_cache.h"
 #include "table/block_based_table_factory.h"
 #include "table/merging_iterator.h"
 #include "table/two_level_iterator.h"
 #include "util/autovector.h"
+#include "util/background_coordinator_impl.h"
 #include "util/build_version.h"
 #include "util/c_style_callback.h"
 #include "util/coding.h"
@@ -216,6 +221,9 @@ class TablePropertiesCollectionIteratorImpl
 
 const std::string kDefaultColumnFamilyName("default");
 const uint64_t kDumpStatsWaitMicroseconds = 10000;
+// Bounds the memory of KeyHotnessSampler and WriteHeatSampler between two
+// drains
+const size_t kMaxSampledKeysPerCore = 4096;
 const std::string kPersistentStatsColumnFamilyName(
     "___rocksdb_stats_history___");
 void DumpRocksDBBuildVersion(Logger* log);
@@ -256,6 +264,18 @@ void DumpSupportInfo(Logger* logger) {
 }
 
 int64_t kDefaultLowPriThrottledRate = 2 * 1024 * 1024;
+
+// Bytes under table_cache_memory_budget, otherwise files. Reserve ten files
+// or so for other uses and give the rest to TableCache. Give a large number
+// for setting of "infinite" open files.
+size_t TableCacheCapacity(const ImmutableDBOptions& db_options,
+                          int max_open_files) {
+  if (db_options.table_cache_memory_budget > 0) {
+    return static_cast<size_t>(db_options.table_cache_memory_budget);
+  }
+  return max_open_files == -1 ? TableCache::kInfiniteCapacity
+                              : max_open_files - 10;
+}
 }  // namespace
 
 static std::string write_qps_metric_name = "dbimpl_writeimpl_qps";
@@ -321,6 +341,8 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
           static_cast<int64_t>(mutable_db_options_.delayed_write_rate / 8),
           kDefaultLowPriThrottledRate))),
       last_batch_group_size_(0),
+      stale_snapshot_(nullptr),
+      stale_snapshot_micros_(0),
       unscheduled_flushes_(0),
       unscheduled_compactions_(0),
       unscheduled_garbage_collections_(0),
@@ -332,6 +354,7 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
       bg_flush_scheduled_(0),
       num_running_flushes_(0),
       bg_purge_scheduled_(0),
+      bg_block_cache_warm_up_scheduled_(0),
       disable_delete_obsolete_files_(0),
       pending_purge_obsolete_files_(0),
       delete_obsolete_files_last_run_(env_->NowMicros()),
@@ -374,6 +397,7 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
       // requires a custom gc for compaction, we use that to set use_custom_gc_
       // as well.
       use_custom_gc_(seq_per_batch),
+      num_wal_streams_(seq_per_batch ? 1 : immutable_db_options_.wal_streams),
       shutdown_initiated_(false),
       own_sfm_(options.sst_file_manager == nullptr),
       preserve_deletes_(options.preserve_deletes),
@@ -454,14 +478,23 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
   // WriteUnprepared, which should use seq_per_batch_.
   assert(batch_per_txn_ || seq_per_batch_);
   env_->GetAbsolutePath(dbname, &db_absolute_path_);
-
-  // Reserve ten files or so for other uses and give the rest to TableCache.
-  // Give a large number for setting of "infinite" open files.
-  const int table_cache_size = (mutable_db_options_.max_open_files == -1)
-                                   ? TableCache::kInfiniteCapacity
-                                   : mutable_db_options_.max_open_files - 10;
-  table_cache_ = NewLRUCache(table_cache_size,
-                             immutable_db_options_.table_cache_numshardbits);
+  GetIOAttributionStats(&io_attribution_last_dump_);
+  io_attribution_last_dump_micros_ = env_->NowMicros();
+  GetCpuAttributionStats(&cpu_attribution_last_dump_);
+
+  table_cache_ = NewLRUCache(
+      TableCacheCapacity(immutable_db_options_,
+                         mutable_db_options_.max_open_files),
+      immutable_db_options_.table_cache_numshardbits);
+  if (immutable_db_options_.background_coordinator != nullptr) {
+    // The table cache shares the budget of the coordinator unless the DB
+    // has its own
+    bool shared_budget = options.table_cache_memory_budget == 0 &&
+                         immutable_db_options_.table_cache_memory_budget > 0;
+    static_cast<BackgroundCoordinatorImpl*>(
+        immutable_db_options_.background_coordinator.get())
+        ->Register(this, shared_budget ? table_cache_ : nullptr);
+  }
 
   versions_.reset(new VersionSet(dbname_, &immutable_db_options_, env_options_,
                                  seq_per_batch, table_cache_.get(),
@@ -480,6 +513,29 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
   // we won't drop any deletion markers until SetPreserveDeletesSequenceNumber()
   // is called by client and this seqnum is advanced.
   preserve_deletes_seqnum_.store(0);
+
+  if (immutable_db_options_.hotness_sample_interval > 0) {
+    key_hotness_sampler_.reset(new KeyHotnessSampler(
+        immutable_db_options_.hotness_sample_interval,
+        kMaxSampledKeysPerCore));
+  }
+  write_heat_sampler_.reset(new WriteHeatSampler(kMaxSampledKeysPerCore));
+  if (immutable_db_options_.async_wal_sync &&
+      !immutable_db_options_.enable_pipelined_write && !two_write_queues_) {
+    wal_syncer_.reset(new WalSyncer(
+        [this] {
+          StopWatch sw(env_, stats_, WAL_FILE_SYNC_MICROS);
+          Status s = manual_wal_flush_ ? FlushWAL(true) : SyncWAL();
+          if (s.ok()) {
+            default_cf_internal_stats_->AddDBStats(
+                InternalStats::WAL_FILE_SYNCED, 1, true /* concurrent */);
+          } else {
+            WriteStatusCheck(s);
+          }
+          return s;
+        },
+        immutable_db_options_.async_wal_sync_max_delay_us));
+  }
 }
 
 Status DBImpl::Resume() {
@@ -617,6 +673,12 @@ void DBImpl::CancelAllBackgroundWork(bool wait) {
   }
 #endif  // !ROCKSDB_LITE
 
+  if (opened_successfully_ && !shutting_down_.load(std::memory_order_acquire) &&
+      immutable_db_options_.hot_block_set_persist_period_sec > 0) {
+    // Leave the latest hot blocks for the next open
+    PersistHotBlocks();
+  }
+
   InstrumentedMutexLock l(&mutex_);
   if (!shutting_down_.load(std::memory_order_acquire) &&
       has_unpersisted_data_.load(std::memory_order_relaxed) &&
@@ -647,6 +709,17 @@ void DBImpl::CancelAllBackgroundWork(bool wait) {
 
 Status DBImpl::CloseHelper() {
   console_runner_.closing_ = true;
+  {
+    SnapshotImpl* stale_snapshot;
+    {
+      std::lock_guard<SpinMutex> l(stale_snapshot_mutex_);
+      stale_snapshot = stale_snapshot_;
+      stale_snapshot_ = nullptr;
+    }
+    if (stale_snapshot != nullptr) {
+      ReleaseSnapshot(stale_snapshot);
+    }
+  }
   // Guarantee that there is no background error recovery in progress before
   // continuing with the shutdown
   mutex_.Lock();
@@ -657,6 +730,9 @@ Status DBImpl::CloseHelper() {
   }
   mutex_.Unlock();
 
+  // Finish the pending WAL syncs while the logs are still around
+  wal_syncer_.reset();
+
   // CancelAllBackgroundWork called with false means we just set the shutdown
   // marker. After this we do a variant of the waiting and unschedule work
   // (to consider: moving all the waiting into CancelAllBackgroundWork(true))
@@ -672,7 +748,8 @@ Status DBImpl::CloseHelper() {
   while (true) {
     int bg_scheduled = bg_bottom_compaction_scheduled_ +
                        bg_compaction_scheduled_ + bg_flush_scheduled_ +
-                       bg_purge_scheduled_ - bg_unscheduled;
+                       bg_purge_scheduled_ + bg_block_cache_warm_up_scheduled_ -
+                       bg_unscheduled;
     if (bg_scheduled || pending_purge_obsolete_files_ ||
         error_handler_.IsRecoveryInProgress() || !console_runner_.closed_) {
       TEST_SYNC_POINT("DBImpl::~DBImpl:WaitJob");
@@ -682,13 +759,18 @@ Status DBImpl::CloseHelper() {
       bg_compaction_scheduled_ = 0;
       bg_flush_scheduled_ = 0;
       bg_purge_scheduled_ = 0;
+      bg_block_cache_warm_up_scheduled_ = 0;
       break;
     }
   }
   TEST_SYNC_POINT_CALLBACK("DBImpl::CloseHelper:PendingPurgeFinished",
                            &files_grabbed_for_purge_);
+  EventHelpers::NotifyOnDBClosing(immutable_db_options_.listeners, this,
+                                  &mutex_);
   EraseThreadStatusDbInfo();
   flush_scheduler_.Clear();
+  // Other DBs sharing the write buffer manager must not pick our memtables
+  write_buffer_manager_->UnregisterDB(this);
 
   while (!flush_queue_.empty()) {
     const FlushRequest& flush_req = PopFirstFromFlushQueue();
@@ -780,6 +862,21 @@ Status DBImpl::CloseHelper() {
     }
   }
   logs_.clear();
+  for (auto& stream : wal_streams_) {
+    uint64_t log_number = stream.number;
+    Status s = stream.ClearWriter();
+    if (!s.ok()) {
+      ROCKS_LOG_WARN(
+          immutable_db_options_.info_log,
+          "Unable to Sync WAL file %s with error -- %s",
+          LogFileName(immutable_db_options_.wal_dir, log_number).c_str(),
+          s.ToString().c_str());
+      if (ret.ok()) {
+        ret = s;
+      }
+    }
+  }
+  wal_streams_.clear();
 
   // Table cache may have table handles holding blocks from the block cache.
   // We need to release them before the block cache is destroyed. The block
@@ -808,6 +905,12 @@ Status DBImpl::CloseHelper() {
     env_->UnlockFile(db_lock_);
   }
 
+  if (immutable_db_options_.background_coordinator != nullptr) {
+    static_cast<BackgroundCoordinatorImpl*>(
+        immutable_db_options_.background_coordinator.get())
+        ->Unregister(this);
+  }
+
   ROCKS_LOG_INFO(immutable_db_options_.info_log, "Shutdown complete");
   LogFlush(immutable_db_options_.info_log);
 
@@ -882,6 +985,17 @@ void DBImpl::StartPeriodicWorkScheduler() {
 #endif  // !ROCKSDB_LITE
 }
 
+void DBImpl::SignalPeriodicWork(PeriodicWorkSignal signal) {
+  mutex_.AssertHeld();
+#ifndef ROCKSDB_LITE
+  if (periodic_work_scheduler_ != nullptr) {
+    periodic_work_scheduler_->Signal(this, signal);
+  }
+#else
+  (void)signal;
+#endif  // !ROCKSDB_LITE
+}
+
 // esitmate the total size of stats_history_
 size_t DBImpl::EstimateInMemoryStatsHistorySize() const {
   size_t size_total =
@@ -951,6 +1065,56 @@ void DBImpl::PersistStats() {
     }
     // TODO(Zhongyi): add purging for persisted data
   } else {
+    // The key range heatmap summed per level. Unlike the tickers these are
+    // the current sampled totals, not deltas: files come and go with
+    // compactions, so the totals of a level are not monotonic.
+    std::map<std::string, uint64_t> heatmap;
+    {
+      InstrumentedMutexLock l(&mutex_);
+      for (auto cfd : *versions_->GetColumnFamilySet()) {
+        if (cfd->IsDropped()) {
+          continue;
+        }
+        const auto* vstorage = cfd->current()->storage_info();
+        for (int level = -1; level < vstorage->num_levels(); ++level) {
+          uint64_t reads = 0, writes = 0, blob_fetches = 0;
+          for (auto* f : vstorage->LevelFiles(level)) {
+            reads +=
+                f->stats.num_reads_sampled.load(std::memory_order_relaxed);
+            writes +=
+                f->stats.num_writes_sampled.load(std::memory_order_relaxed);
+            blob_fetches += f->stats.num_blob_fetches_sampled.load(
+                std::memory_order_relaxed);
+          }
+          std::string prefix = DB::Properties::kKeyRangeHeatmap + "." +
+                               cfd->GetName() + ".l" + ToString(level) + ".";
+          if (reads != 0) {
+            heatmap[prefix + "reads"] = reads;
+          }
+          if (writes != 0) {
+            heatmap[prefix + "writes"] = writes;
+          }
+          if (blob_fetches != 0) {
+            heatmap[prefix + "blob-fetches"] = blob_fetches;
+          }
+        }
+      }
+    }
+    // The hit ratio curve of the block cache of the default column family, in
+    // basis points by capacity. Also the current values, not deltas.
+    std::map<std::string, uint64_t> hit_ratio_curve;
+    {
+      InstrumentedMutexLock l(&mutex_);
+      std::vector<SimCacheHitRatio> curve;
+      auto* default_cfd = versions_->GetColumnFamilySet()->GetDefault();
+      if (default_cfd->internal_stats()->GetBlockCacheHitRatioCurve(&curve)) {
+        for (auto& point : curve) {
+          hit_ratio_curve[DB::Properties::kBlockCacheHitRatioCurve + "." +
+                          ToString(point.capacity)] =
+              static_cast<uint64_t>(point.hit_ratio * 10000 + 0.5);
+        }
+      }
+    }
     InstrumentedMutexLock l(&stats_history_mutex_);
     // calculate the delta from last time
     if (stats_slice_initialized_) {
@@ -960,6 +1124,8 @@ void DBImpl::PersistStats() {
           stats_delta[stat.first] = stat.second - stats_slice_[stat.first];
         }
       }
+      stats_delta.insert(heatmap.begin(), heatmap.end());
+      stats_delta.insert(hit_ratio_curve.begin(), hit_ratio_curve.end());
       stats_history_[now_seconds] = stats_delta;
     }
     stats_slice_initialized_ = true;
@@ -1017,6 +1183,419 @@ Status DBImpl::GetStatsHistory(
   return (*stats_iterator)->status();
 }
 
+void DBImpl::MergeSampledKeyHotness() {
+  TEST_SYNC_POINT("DBImpl::MergeSampledKeyHotness");
+  if (key_hotness_sampler_ == nullptr) {
+    return;
+  }
+  std::shared_ptr<Oracle> oracle = env_->GetOracle();
+  if (oracle == nullptr) {
+    return;
+  }
+  std::unordered_map<std::string, uint64_t> occurrence;
+  size_t sampled = key_hotness_sampler_->Drain(&occurrence);
+  if (occurrence.empty()) {
+    return;
+  }
+  // MergeKeys() refreshes the oracle stats itself
+  oracle->MergeKeys(occurrence);
+  ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                 "Merged %" ROCKSDB_PRIszt " sampled keys (%" ROCKSDB_PRIszt
+                 " distinct, %" PRIu64 " dropped in total) into oracle",
+                 sampled, occurrence.size(), key_hotness_sampler_->dropped());
+}
+
+void DBImpl::ChargeSampledWrites() {
+  TEST_SYNC_POINT("DBImpl::ChargeSampledWrites");
+  std::vector<std::pair<uint32_t, std::string>> keys;
+  write_heat_sampler_->Drain(&keys);
+  if (keys.empty()) {
+    return;
+  }
+  // Batches mostly write a single column family, so look up the version only
+  // when the column family changes
+  std::sort(keys.begin(), keys.end(),
+            [](const std::pair<uint32_t, std::string>& a,
+               const std::pair<uint32_t, std::string>& b) {
+              return a.first < b.first;
+            });
+  for (size_t i = 0; i < keys.size();) {
+    uint32_t column_family_id = keys[i].first;
+    size_t end = i;
+    while (end < keys.size() && keys[end].first == column_family_id) {
+      ++end;
+    }
+    Version* version = nullptr;
+    {
+      InstrumentedMutexLock l(&mutex_);
+      auto cfd =
+          versions_->GetColumnFamilySet()->GetColumnFamily(column_family_id);
+      if (cfd != nullptr && !cfd->IsDropped()) {
+        version = cfd->current();
+        version->Ref();
+      }
+    }
+    if (version != nullptr) {
+      for (; i < end; ++i) {
+        version->SampleWrite(keys[i].second);
+      }
+      InstrumentedMutexLock l(&mutex_);
+      version->Unref();
+    }
+    i = end;
+  }
+}
+
+namespace {
+// Blocks persisted per table, the sampler of a table remembers more so that
+// the ones dropping out keep competing
+const size_t kMaxPersistedHotBlocksPerTable = 64;
+
+// Append the tables of `vstorage` to `files`, including the ones only
+// reachable through map or link SSTs
+void GetAllTables(const VersionStorageInfo* vstorage,
+                  std::unordered_map<uint64_t, const FileMetaData*>* files) {
+  for (int level = 0; level < vstorage->num_levels(); ++level) {
+    for (auto f : vstorage->LevelFiles(level)) {
+      files->emplace(f->fd.GetNumber(), f);
+    }
+  }
+  for (auto& pair : vstorage->dependence_map()) {
+    files->emplace(pair.first, pair.second);
+  }
+}
+}  // namespace
+
+void DBImpl::PersistHotBlocks() {
+  TEST_SYNC_POINT("DBImpl::PersistHotBlocks:Start");
+  if (immutable_db_options_.hot_block_sample_interval == 0) {
+    return;
+  }
+  autovector<ColumnFamilyData*> cfds;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (!cfd->IsDropped() && cfd->initialized()) {
+        cfd->Ref();
+        cfds.push_back(cfd);
+      }
+    }
+  }
+  HotBlockSet hot_blocks;
+  size_t num_keys = 0;
+  for (auto cfd : cfds) {
+    SuperVersion* sv = cfd->GetReferencedSuperVersion(this);
+    std::unordered_map<uint64_t, const FileMetaData*> files;
+    GetAllTables(sv->current->storage_info(), &files);
+    for (auto& pair : files) {
+      const FileMetaData* f = pair.second;
+      TableReader* reader = f->fd.table_reader;
+      Cache::Handle* handle = nullptr;
+      if (reader == nullptr) {
+        // A table not open has no reads sampled since the last open
+        Status s = cfd->table_cache()->FindTable(
+            env_options_, f->fd, &handle,
+            sv->mutable_cf_options.prefix_extractor.get(), true /* no_io */);
+        if (!s.ok()) {
+          continue;
+        }
+        reader = cfd->table_cache()->GetTableReaderFromHandle(handle);
+      }
+      HotBlockSet::Table table;
+      table.column_family_id = cfd->GetID();
+      table.file_number = f->fd.GetNumber();
+      reader->GetHotBlockKeys(kMaxPersistedHotBlocksPerTable, &table.keys);
+      if (handle != nullptr) {
+        cfd->table_cache()->ReleaseHandle(handle);
+      }
+      if (!table.keys.empty()) {
+        num_keys += table.keys.size();
+        hot_blocks.tables.emplace_back(std::move(table));
+      }
+    }
+    CleanupSuperVersion(sv);
+  }
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (auto cfd : cfds) {
+      if (cfd->Unref()) {
+        delete cfd;
+      }
+    }
+  }
+  Status s = WriteHotBlockSetFile(env_, hot_blocks, HotBlocksFileName(dbname_),
+                                  TempHotBlocksFileName(dbname_));
+  if (s.ok()) {
+    ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                   "Persisted %" ROCKSDB_PRIszt
+                   " hot blocks of %" ROCKSDB_PRIszt " tables",
+                   num_keys, hot_blocks.tables.size());
+  } else {
+    ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                   "Failed to persist hot blocks: %s", s.ToString().c_str());
+  }
+  TEST_SYNC_POINT("DBImpl::PersistHotBlocks:End");
+}
+
+void DBImpl::ScheduleBlockCacheWarmUp() {
+  mutex_.AssertHeld();
+  if (immutable_db_options_.hot_block_set_persist_period_sec == 0) {
+    return;
+  }
+  HotBlockSet hot_blocks;
+  Status s = ReadHotBlockSetFile(env_, HotBlocksFileName(dbname_), &hot_blocks);
+  if (!s.ok()) {
+    if (!s.IsNotFound()) {
+      ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                     "Skip block cache warm up: %s", s.ToString().c_str());
+    }
+    return;
+  }
+  if (hot_blocks.tables.empty()) {
+    return;
+  }
+  // Every job walks the tables of few column families
+  std::stable_sort(
+      hot_blocks.tables.begin(), hot_blocks.tables.end(),
+      [](const HotBlockSet::Table& a, const HotBlockSet::Table& b) {
+        return a.column_family_id < b.column_family_id;
+      });
+  size_t num_jobs =
+      std::min<size_t>(hot_blocks.tables.size(),
+                       std::max(1, GetBGJobLimits().max_compactions));
+  size_t begin = 0;
+  for (size_t i = 0; i < num_jobs; ++i) {
+    size_t end = hot_blocks.tables.size() * (i + 1) / num_jobs;
+    auto arg = new BlockCacheWarmUpArg;
+    arg->db = this;
+    arg->tables.assign(
+        std::make_move_iterator(hot_blocks.tables.begin() + begin),
+        std::make_move_iterator(hot_blocks.tables.begin() + end));
+    begin = end;
+    ++bg_block_cache_warm_up_scheduled_;
+    env_->Schedule(&DBImpl::BGWorkBlockCacheWarmUp, arg, Env::Priority::LOW,
+                   this, &DBImpl::UnscheduleBlockCacheWarmUpCallback);
+  }
+  ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                 "Scheduled %" ROCKSDB_PRIszt
+                 " jobs to warm up the block cache with the hot blocks of "
+                 "%" ROCKSDB_PRIszt " tables",
+                 num_jobs, hot_blocks.tables.size());
+}
+
+void DBImpl::BGWorkBlockCacheWarmUp(void* arg) {
+  std::unique_ptr<BlockCacheWarmUpArg> ba(
+      reinterpret_cast<BlockCacheWarmUpArg*>(arg));
+  IOSTATS_SET_THREAD_POOL_ID(Env::Priority::LOW);
+  TEST_SYNC_POINT("DBImpl::BGWorkBlockCacheWarmUp:start");
+  ba->db->BackgroundCallBlockCacheWarmUp(ba->tables);
+  TEST_SYNC_POINT("DBImpl::BGWorkBlockCacheWarmUp:end");
+}
+
+void DBImpl::UnscheduleBlockCacheWarmUpCallback(void* arg) {
+  delete reinterpret_cast<BlockCacheWarmUpArg*>(arg);
+}
+
+void DBImpl::BackgroundCallBlockCacheWarmUp(
+    const std::vector<HotBlockSet::Table>& tables) {
+  size_t num_tables = 0;
+  size_t num_keys = 0;
+  ColumnFamilyData* cfd = nullptr;
+  SuperVersion* sv = nullptr;
+  std::unordered_map<uint64_t, const FileMetaData*> files;
+  auto release_column_family = [&] {
+    if (sv != nullptr) {
+      CleanupSuperVersion(sv);
+      sv = nullptr;
+    }
+    if (cfd != nullptr) {
+      InstrumentedMutexLock l(&mutex_);
+      if (cfd->Unref()) {
+        delete cfd;
+      }
+      cfd = nullptr;
+    }
+    files.clear();
+  };
+  for (size_t i = 0; i < tables.size(); ++i) {
+    if (shutting_down_.load(std::memory_order_acquire)) {
+      break;
+    }
+    auto& table = tables[i];
+    if (i == 0 || table.column_family_id != tables[i - 1].column_family_id) {
+      release_column_family();
+      {
+        InstrumentedMutexLock l(&mutex_);
+        cfd = versions_->GetColumnFamilySet()->GetColumnFamily(
+            table.column_family_id);
+        if (cfd != nullptr && (cfd->IsDropped() || !cfd->initialized())) {
+          cfd = nullptr;
+        }
+        if (cfd != nullptr) {
+          cfd->Ref();
+        }
+      }
+      if (cfd != nullptr) {
+        sv = cfd->GetReferencedSuperVersion(this);
+        GetAllTables(sv->current->storage_info(), &files);
+      }
+    }
+    auto find = files.find(table.file_number);
+    if (find == files.end()) {
+      // Compacted away since the hot blocks were persisted
+      continue;
+    }
+    const FileMetaData* f = find->second;
+    TableReader* reader = f->fd.table_reader;
+    Cache::Handle* handle = nullptr;
+    if (reader == nullptr) {
+      Status s = cfd->table_cache()->FindTable(
+          env_options_, f->fd, &handle,
+          sv->mutable_cf_options.prefix_extractor.get());
+      if (!s.ok()) {
+        continue;
+      }
+      reader = cfd->table_cache()->GetTableReaderFromHandle(handle);
+    }
+    if (reader->WarmUpBlocks(table.keys).ok()) {
+      ++num_tables;
+      num_keys += table.keys.size();
+    }
+    if (handle != nullptr) {
+      cfd->table_cache()->ReleaseHandle(handle);
+    }
+  }
+  release_column_family();
+  ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                 "Warmed up the block cache with %" ROCKSDB_PRIszt
+                 " hot blocks of %" ROCKSDB_PRIszt " tables",
+                 num_keys, num_tables);
+
+  InstrumentedMutexLock l(&mutex_);
+  --bg_block_cache_warm_up_scheduled_;
+  bg_cv_.SignalAll();
+  // IMPORTANT: there should be no code after calling SignalAll. This call may
+  // signal the DB destructor that it's OK to proceed with destruction.
+}
+
+void DBImpl::DropExpiredTtlFiles(ColumnFamilyData* cfd,
+                                 JobContext* job_context,
+                                 LogBuffer* log_buffer) {
+  mutex_.AssertHeld();
+  if (cfd->IsDropped()) {
+    return;
+  }
+  uint64_t now = cfd->ioptions()->ttl_extractor_factory->Now();
+  Version* input_version = cfd->current();
+  VersionStorageInfo* vstorage = input_version->storage_info();
+  const Comparator* ucmp = cfd->user_comparator();
+  auto is_expired_essence = [now](const FileMetaData* f) {
+    return f->prop.latest_time_expire <= now &&
+           f->prop.purpose == kEssenceSst && f->prop.dependence.empty() &&
+           !f->prop.has_range_deletions();
+  };
+  // A map SST expires with all the SSTs it depends on, which go with it
+  // unless another SST still depends on them
+  auto& dependence_map = vstorage->dependence_map();
+  auto is_expired = [&](const FileMetaData* f) {
+    if (f->being_compacted) {
+      return false;
+    }
+    if (!f->prop.is_map_sst()) {
+      return is_expired_essence(f);
+    }
+    if (f->prop.has_range_deletions() || f->prop.dependence.empty()) {
+      return false;
+    }
+    for (auto& dependence : f->prop.dependence) {
+      auto find = dependence_map.find(dependence.file_number);
+      if (find == dependence_map.end() || !is_expired_essence(find->second)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto overlap = [ucmp](const FileMetaData* a, const FileMetaData* b) {
+    return ucmp->Compare(a->smallest.user_key(), b->largest.user_key()) <= 0 &&
+           ucmp->Compare(b->smallest.user_key(), a->largest.user_key()) <= 0;
+  };
+
+  // Dropping a file brings back the older versions of its keys, so a file
+  // goes only if every file it overlaps beneath goes as well. Walk from the
+  // bottom up, and L0 from the oldest file to the newest one.
+  std::unordered_set<FileMetaData*> dropped;
+  std::vector<FileMetaData*> overlapped;
+  for (int level = vstorage->num_non_empty_levels() - 1; level >= 0;
+       --level) {
+    auto& level_files = vstorage->LevelFiles(level);
+    for (size_t i = level_files.size(); i-- > 0;) {
+      FileMetaData* f = level_files[i];
+      if (!is_expired(f)) {
+        continue;
+      }
+      bool covered = true;
+      for (size_t j = i + 1; level == 0 && covered && j < level_files.size();
+           ++j) {
+        covered = dropped.count(level_files[j]) > 0 ||
+                  !overlap(f, level_files[j]);
+      }
+      for (int l = level + 1; covered && l < vstorage->num_non_empty_levels();
+           ++l) {
+        overlapped.clear();
+        vstorage->GetOverlappingInputs(l, &f->smallest, &f->largest,
+                                       &overlapped, -1 /* hint_index */,
+                                       nullptr /* file_index */,
+                                       false /* expand_range */);
+        for (auto of : overlapped) {
+          if (dropped.count(of) == 0) {
+            covered = false;
+            break;
+          }
+        }
+      }
+      if (covered) {
+        dropped.emplace(f);
+      }
+    }
+  }
+  if (dropped.empty()) {
+    return;
+  }
+
+  VersionEdit edit;
+  edit.SetColumnFamily(cfd->GetID());
+  for (int level = 0; level < vstorage->num_non_empty_levels(); ++level) {
+    for (auto f : vstorage->LevelFiles(level)) {
+      if (dropped.count(f) > 0) {
+        edit.DeleteFile(level, f->fd.GetNumber());
+        f->being_compacted = true;
+        ROCKS_LOG_BUFFER(log_buffer,
+                         "[%s] SST #%" PRIu64 " @L%d dropped as expired, "
+                         "latest_time_expire: %" PRIu64 " now: %" PRIu64,
+                         cfd->GetName().c_str(), f->fd.GetNumber(), level,
+                         f->prop.latest_time_expire, now);
+      }
+    }
+  }
+  input_version->Ref();
+  job_context->superversion_contexts.emplace_back(SuperVersionContext(true));
+  Status s = versions_->LogAndApply(cfd, *cfd->GetLatestMutableCFOptions(),
+                                    &edit, &mutex_, directories_.GetDbDir());
+  if (s.ok()) {
+    InstallSuperVersionAndScheduleWork(
+        cfd, &job_context->superversion_contexts.back(),
+        *cfd->GetLatestMutableCFOptions(), FlushReason::kDeleteFiles);
+  } else {
+    ROCKS_LOG_BUFFER(log_buffer, "[%s] Dropping expired SSTs failed: %s",
+                     cfd->GetName().c_str(), s.ToString().c_str());
+  }
+  for (auto f : dropped) {
+    f->being_compacted = false;
+  }
+  input_version->Unref();
+  TEST_SYNC_POINT_CALLBACK("DBImpl::DropExpiredTtlFiles:Dropped", &dropped);
+}
+
 void DBImpl::ScheduleTtlGC() {
   TEST_SYNC_POINT("DBImpl:ScheduleTtlGC");
   LogBuffer log_buffer_info(InfoLogLevel::INFO_LEVEL,
@@ -1024,6 +1603,37 @@ void DBImpl::ScheduleTtlGC() {
   LogBuffer log_buffer_debug(InfoLogLevel::DEBUG_LEVEL,
                              immutable_db_options_.info_log.get());
 
+  // Whole expired files go first, what remains is marked for compaction
+  {
+    JobContext job_context(next_job_id_.fetch_add(1));
+    autovector<ColumnFamilyData*> cfds;
+    mutex_.Lock();
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (cfd->initialized() && !cfd->IsDropped() &&
+          cfd->ioptions()->ttl_extractor_factory != nullptr &&
+          cfd->GetLatestMutableCFOptions()->ttl_drop_expired_files) {
+        cfd->Ref();
+        cfds.push_back(cfd);
+      }
+    }
+    for (auto cfd : cfds) {
+      DropExpiredTtlFiles(cfd, &job_context, &log_buffer_info);
+    }
+    for (auto cfd : cfds) {
+      if (cfd->Unref()) {
+        delete cfd;
+      }
+    }
+    if (!cfds.empty()) {
+      FindObsoleteFiles(&job_context, false);
+    }
+    mutex_.Unlock();
+    if (job_context.HaveSomethingToDelete()) {
+      PurgeObsoleteFiles(job_context);
+    }
+    job_context.Clean(&mutex_);
+  }
+
   auto should_marked_for_compacted = [&](int level, uint64_t file_number,
                                          uint64_t earliest_time_begin_compact,
                                          uint64_t latest_time_end_compact,
@@ -1102,6 +1712,11 @@ void DBImpl::ScheduleTtlGC() {
 #ifdef WITH_ZENFS
 // Implemented inside `env/env_zenfs.cc`
 void GetStat(Env* env, BDZenFSStat& stat);
+// Zone stats only, without files and extents
+void GetZoneStat(Env* env, BDZenFSStat& stat);
+// Extents of the given sealed zones, served from an incremental view
+void GetZoneExtents(Env* env, const std::vector<BDZoneStat>& zones,
+                    std::vector<ZoneExtentSnapshot>* exts);
 void GetZenFSSnapshot(Env* env, ZenFSSnapshot& snapshot,
                       const ZenFSSnapshotOptions& options);
 // Migrate target zone's all extents to a new zone
@@ -1131,11 +1746,11 @@ void DBImpl::ScheduleZNSStatusReporter() {
   BDZenFSStat zenfs_stat;
   {
     LatencyHistGuard guard(&zenfs_get_snapshot_latency_reporter_);
-    // Pick files for GC
-    GetStat(env_, zenfs_stat);
+    GetZoneStat(env_, zenfs_stat);
     // ROCKS_LOG_BUFFER(&log_buffer_info,"ZNS GC :\n\t[GetStat]=%s\n",
     //                  zenfs_stat.ToString());
   }
+  UpdateZoneGCRateLimit(GetZenFSStatistics(zenfs_stat));
   std::vector<BDZoneStat>& stat = zenfs_stat.zone_stats_;
 
   size_t free = 0, used = 0, reclaim = 0, total = 0;
@@ -1200,8 +1815,51 @@ void DBImpl::ScheduleZNSStatusReporter() {
   printf("%s\n", zenfs_stat.snapshot_.summarize_info_.c_str());
 }
 
-void DBImpl::PickMigrationZone(const std::vector<BDZoneStat>& zone_stat,
-                               std::set<uint64_t>* picked_zones) {}
+void DBImpl::PickMigrationZone(const BDZenFSStat& zenfs_stat,
+                               std::vector<uint64_t>* picked_zones) {
+  ZoneGCPickerOptions picker_options;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    picker_options.free_ratio_target =
+        mutable_db_options_.zenfs_gc_free_ratio_target;
+    picker_options.min_garbage_ratio = mutable_db_options_.zenfs_high_gc_ratio;
+    picker_options.max_zones_per_run =
+        mutable_db_options_.zenfs_gc_max_zones_per_run;
+  }
+  if (zone_gc_picker_ == nullptr) {
+    zone_gc_picker_.reset(
+        new ZoneGCPicker(immutable_db_options_.zenfs_zone_victim_policy));
+  }
+
+  auto zenfs_statistics = GetZenFSStatistics(zenfs_stat);
+  std::vector<ZoneVictimCandidate> zones;
+  zones.reserve(zenfs_stat.zone_stats_.size());
+  for (const auto& zone : zenfs_stat.zone_stats_) {
+    ZoneVictimCandidate candidate;
+    candidate.zone_id = zone.ZoneId();
+    candidate.start = zone.start_position;
+    candidate.max_capacity =
+        zone.free_capacity + zone.used_capacity + zone.reclaim_capacity;
+    candidate.free_bytes = zone.free_capacity;
+    candidate.valid_bytes = zone.used_capacity;
+    candidate.reclaim_bytes = zone.reclaim_capacity;
+    zones.emplace_back(candidate);
+  }
+
+  ZoneGCPickStats pick_stats;
+  {
+    LatencyHistGuard guard(&zenfs_get_snapshot_latency_reporter_);
+    zone_gc_picker_->Pick(&zones, zenfs_statistics.free,
+                          zenfs_statistics.total, env_->NowMicros(),
+                          picker_options, picked_zones, &pick_stats);
+  }
+  ROCKS_LOG_INFO(zenfs_get_snapshot_latency_reporter_.GetLogger(),
+                 "[GC] Zone victim pick (%s): %s",
+                 zone_gc_picker_->policy()->Name(),
+                 pick_stats.ToString().c_str());
+  ZnsLog(kGCColor, "[GC] Zone victim pick: %s\n",
+         pick_stats.ToString().c_str());
+}
 
 DBImpl::ZenFSStatisticsStatus DBImpl::GetZenFSStatistics(
     const BDZenFSStat& zenfs_stat) {
@@ -1225,84 +1883,109 @@ DBImpl::ZenFSStatisticsStatus DBImpl::GetZenFSStatistics(
 }
 
 void DBImpl::MaybeDoZoneCompaction() {
-  const double force_free_r = 0.15;
   TEST_SYNC_POINT("DBImpl::MaybeDoZoneCompaction");
   ZnsLog(kGCColor, "[GC] Running Zone Compaction\n");
 
+  // Picking only needs zone level stats, extents are fetched for the victim
+  // zones afterwards so a round costs O(zones + extents in victims)
   BDZenFSStat zenfs_stat;
   {
     LatencyHistGuard guard(&zenfs_get_snapshot_latency_reporter_);
-    GetStat(env_, zenfs_stat);
+    GetZoneStat(env_, zenfs_stat);
   }
-  auto zenfs_statistics = GetZenFSStatistics(zenfs_stat);
-  const auto& stat = zenfs_stat.zone_stats_;
 
-  double free_ratio = static_cast<double>(zenfs_statistics.free) /
-                      (zenfs_statistics.total + zenfs_statistics.free);
-  bool need_zone_compact = free_ratio < force_free_r;
-  ZnsLog(kGCColor,
-         "[GC] Current Free Capacity Ratio: %.4lf; Empty Zone Cnt=%lu\n",
-         free_ratio, zenfs_statistics.empty_zone_cnt);
+  UpdateZoneGCRateLimit(GetZenFSStatistics(zenfs_stat));
 
-  if (!need_zone_compact) {
+  std::vector<uint64_t> migrate_zone_ids;
+  PickMigrationZone(zenfs_stat, &migrate_zone_ids);
+  if (migrate_zone_ids.empty()) {
     return;
   }
   compact_zone_count_ += 1;
-  std::vector<uint64_t> migrate_zone_ids;
 
-  // Pick zones for compaction
-  ZnsLog(kGCColor, "[GC] Running Zone Compaction\n");
-  std::deque<BDZoneStat> zone_heap(stat.begin(), stat.end());
-  std::sort(zone_heap.begin(), zone_heap.end(),
-            [](const BDZoneStat& z1, const BDZoneStat& z2) {
-              return z1.GarbageRate() > z2.GarbageRate();
-            });
-  // Calculate the expect free space
-  uint64_t expect_free =
-      (zenfs_statistics.free + zenfs_statistics.total) * force_free_r;
-  auto theory_free = zenfs_statistics.free + zenfs_statistics.reclaim;
-  expect_free = std::min(expect_free, theory_free);
-
-  auto curr_free = zenfs_statistics.free;
-  while (curr_free < expect_free && !zone_heap.empty()) {
-    auto candidate_zone = zone_heap.front();
-    zone_heap.pop_front();
-    // Only compact zones that are full
-    if (candidate_zone.free_capacity == 0) {
-      curr_free += candidate_zone.reclaim_capacity;
-      migrate_zone_ids.emplace_back(candidate_zone.start_position);
-      ZnsLog(kGCColor,
-             "[GC] Pick Zone(%lu) for Compaction: GR=%.4lf VR=%.4lf start=%zu "
-             "expect "
-             "release %zu MiB\n",
-             candidate_zone.ZoneId(), candidate_zone.GarbageRate(),
-             candidate_zone.ValidRate(), candidate_zone.start_position,
-             ToMiB(candidate_zone.reclaim_capacity));
+  std::vector<BDZoneStat> victims;
+  for (const auto& zone : zenfs_stat.zone_stats_) {
+    if (std::find(migrate_zone_ids.begin(), migrate_zone_ids.end(),
+                  zone.start_position) != migrate_zone_ids.end()) {
+      victims.push_back(zone);
     }
   }
-
-  // (kqh) Maybe we should limit the maximum number of compact zones?
-  if (migrate_zone_ids.size() > 5) {
-    migrate_zone_ids.erase(migrate_zone_ids.begin() + 5,
-                           migrate_zone_ids.end());
-    assert(migrate_zone_ids.size() <= 5);
+  std::vector<ZoneExtentSnapshot> victim_exts;
+  {
+    LatencyHistGuard guard(&zenfs_get_snapshot_latency_reporter_);
+    GetZoneExtents(env_, victims, &victim_exts);
   }
 
   uint32_t min_size = 0;  // 128 << 10;
-  std::vector<ZoneExtentSnapshot*> compact_exts;
-  for (auto& ext : zenfs_stat.snapshot_.extents_) {
-    auto iter = std::find(migrate_zone_ids.begin(), migrate_zone_ids.end(),
-                          ext.zone_start);
-    if (iter != migrate_zone_ids.end()) {
-      if (ext.length > min_size) {
-        compact_exts.push_back(&ext);
-      }
+  std::unordered_map<uint64_t, std::vector<ZoneExtentSnapshot*>> compact_exts;
+  for (auto& ext : victim_exts) {
+    if (ext.length > min_size) {
+      compact_exts[ext.zone_start].push_back(&ext);
     }
   }
 
+  // Zone migration is done inside ZenFS, so the valid bytes it copies are
+  // charged to the GC class of the rate limiter up front
+  RateLimiter* rate_limiter = immutable_db_options_.rate_limiter.get();
+  GCIOScope gc_io_scope;
+  std::vector<ZoneExtentSnapshot*> relocate_exts;
   for (const auto& compact_zone_start : migrate_zone_ids) {
-    CompactZones(env_, compact_zone_start, compact_exts, true);
+    auto& exts = compact_exts[compact_zone_start];
+    for (const auto* ext : exts) {
+      zone_gc_migrated_bytes_.fetch_add(ext->length,
+                                        std::memory_order_relaxed);
+    }
+    if (rate_limiter != nullptr) {
+      for (const auto* ext : exts) {
+        int64_t left = ext->length;
+        while (left > 0) {
+          left -= static_cast<int64_t>(rate_limiter->RequestToken(
+              left, 0 /* alignment */, Env::IO_LOW, stats_,
+              RateLimiter::OpType::kWrite));
+        }
+      }
+    }
+    if (!immutable_db_options_.zenfs_gc_relocate_extents) {
+      CompactZones(env_, compact_zone_start, exts, true);
+      continue;
+    }
+    // The extents of a file are kept in file order, group them so they are
+    // copied with large sequential reads and appends
+    std::stable_sort(exts.begin(), exts.end(),
+                     [](const ZoneExtentSnapshot* a,
+                        const ZoneExtentSnapshot* b) {
+                       return a->filename < b->filename;
+                     });
+    relocate_exts.insert(relocate_exts.end(), exts.begin(), exts.end());
+  }
+  if (!relocate_exts.empty()) {
+    // Only the ZenFS metadata of the files changes, the table files are
+    // neither rewritten nor reopened
+    MigrateExtents(
+        env_, relocate_exts,
+        immutable_db_options_.use_direct_io_for_flush_and_compaction);
+    ZnsLog(kGCColor, "[GC] Relocated %zu extents of %zu zones\n",
+           relocate_exts.size(), migrate_zone_ids.size());
+  }
+}
+
+void DBImpl::UpdateZoneGCRateLimit(const ZenFSStatisticsStatus& stat) {
+  zone_free_bytes_.store(stat.free, std::memory_order_relaxed);
+  zone_garbage_bytes_.store(stat.garbage, std::memory_order_relaxed);
+  zone_capacity_bytes_.store(stat.free + stat.total,
+                             std::memory_order_relaxed);
+  RateLimiter* rate_limiter = immutable_db_options_.rate_limiter.get();
+  if (rate_limiter == nullptr || stat.free + stat.total == 0) {
+    return;
   }
+  double free_ratio_target;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    free_ratio_target = mutable_db_options_.zenfs_gc_free_ratio_target;
+  }
+  double free_ratio = static_cast<double>(stat.free) /
+                      static_cast<double>(stat.free + stat.total);
+  rate_limiter->UpdateZoneFreeRatio(free_ratio, free_ratio_target);
 }
 
 // copied from compaction_picker.cc
@@ -1764,6 +2447,10 @@ void DBImpl::DumpStats() {
           *cf_property_info, DB::Properties::kCFStatsNoFileHistogram, &stats);
       cfd->internal_stats()->GetStringProperty(
           *cf_property_info, DB::Properties::kCFFileHistogram, &stats);
+      CpuAttributionStats cpu_stats;
+      cfd->cpu_attribution()->AddTo(&cpu_stats);
+      stats.append("\n** CPU Attribution [" + cfd->GetName() + "] **\n");
+      stats.append(cpu_stats.ToString(CpuAttributionStats()));
     }
   }
   {
@@ -1787,11 +2474,79 @@ void DBImpl::DumpStats() {
       ROCKS_LOG_WARN(immutable_db_options_.info_log, "%s", stats.c_str());
     }
   }
+  DumpIOAttribution();
+  DumpCpuAttribution();
 #endif  // !ROCKSDB_LITE
 
   PrintStatistics();
 }
 
+void DBImpl::DumpIOAttribution() {
+  IOAttributionStats curr;
+  GetIOAttributionStats(&curr);
+  uint64_t now_micros = env_->NowMicros();
+  ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                 "------- I/O ATTRIBUTION (process wide) -------\n%s",
+                 curr.ToString(io_attribution_last_dump_,
+                               now_micros - io_attribution_last_dump_micros_)
+                     .c_str());
+
+  io_attribution_reporters_.resize(IOAttributionStats::kNumEntries, nullptr);
+  for (size_t f = 0; f < static_cast<size_t>(IOFileKind::kNumKinds); ++f) {
+    for (size_t j = 0; j < static_cast<size_t>(IOJobKind::kNumKinds); ++j) {
+      for (size_t o = 0; o < static_cast<size_t>(IOOpKind::kNumKinds); ++o) {
+        auto file = static_cast<IOFileKind>(f);
+        auto job = static_cast<IOJobKind>(j);
+        auto op = static_cast<IOOpKind>(o);
+        size_t i = IOAttributionStats::Index(file, job, op);
+        uint64_t bytes = curr.bytes[i] - io_attribution_last_dump_.bytes[i];
+        if (bytes == 0) {
+          continue;
+        }
+        auto& reporter = io_attribution_reporters_[i];
+        if (reporter == nullptr) {
+          std::string name = std::string("io_attribution_") +
+                             IOFileKindName(file) + "_" + IOJobKindName(job) +
+                             "_" + IOOpKindName(op) + "_throughput";
+          reporter = metrics_reporter_factory_->BuildCountReporter(
+              name, bytedance_tags_, immutable_db_options_.info_log.get(),
+              env_);
+        }
+        reporter->AddCount(static_cast<size_t>(bytes));
+      }
+    }
+  }
+  io_attribution_last_dump_ = curr;
+  io_attribution_last_dump_micros_ = now_micros;
+}
+
+void DBImpl::DumpCpuAttribution() {
+  CpuAttributionStats curr;
+  GetCpuAttributionStats(&curr);
+  ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                 "------- CPU ATTRIBUTION (process wide) -------\n%s",
+                 curr.ToString(cpu_attribution_last_dump_).c_str());
+
+  cpu_attribution_reporters_.resize(CpuAttributionStats::kNumKinds, nullptr);
+  for (size_t i = 0; i < CpuAttributionStats::kNumKinds; ++i) {
+    uint64_t cpu_nanos =
+        curr.cpu_nanos[i] - cpu_attribution_last_dump_.cpu_nanos[i];
+    if (cpu_nanos == 0) {
+      continue;
+    }
+    auto& reporter = cpu_attribution_reporters_[i];
+    if (reporter == nullptr) {
+      std::string name = std::string("cpu_attribution_") +
+                         CpuJobKindName(static_cast<CpuJobKind>(i)) +
+                         "_cpu_micros";
+      reporter = metrics_reporter_factory_->BuildCountReporter(
+          name, bytedance_tags_, immutable_db_options_.info_log.get(), env_);
+    }
+    reporter->AddCount(static_cast<size_t>(cpu_nanos / 1000));
+  }
+  cpu_attribution_last_dump_ = curr;
+}
+
 void DBImpl::ScheduleBgFree(JobContext* job_context, SuperVersion* sv) {
   mutex_.AssertHeld();
   bool schedule = false;
@@ -1951,9 +2706,8 @@ Status DBImpl::SetDBOptions(
       }
       write_controller_.set_max_delayed_write_rate(
           new_options.delayed_write_rate);
-      table_cache_.get()->SetCapacity(new_options.max_open_files == -1
-                                          ? TableCache::kInfiniteCapacity
-                                          : new_options.max_open_files - 10);
+      table_cache_.get()->SetCapacity(TableCacheCapacity(
+          immutable_db_options_, new_options.max_open_files));
       wal_changed = mutable_db_options_.wal_bytes_per_sync !=
                     new_options.wal_bytes_per_sync;
       if (new_options.bytes_per_sync == 0) {
@@ -2093,6 +2847,12 @@ Status DBImpl::SyncWAL() {
       log.getting_synced = true;
       logs_to_sync.push_back(log.writer);
     }
+    // The streams of the current log are numbered after it, and are synced
+    // as well
+    for (auto& stream : wal_streams_) {
+      logs_to_sync.push_back(stream.writer);
+    }
+    ++wal_stream_syncs_;
 
     need_log_dir_sync = !log_dir_synced_;
   }
@@ -2161,6 +2921,8 @@ void DBImpl::MarkLogsSynced(uint64_t up_to, bool synced_dir,
   }
   assert(!status.ok() || logs_.empty() || logs_[0].number > up_to ||
          (logs_.size() == 1 && !logs_[0].getting_synced));
+  assert(wal_stream_syncs_ > 0);
+  --wal_stream_syncs_;
   log_sync_cv_.SignalAll();
 }
 
@@ -2388,6 +3150,11 @@ Status DBImpl::GetImpl(const ReadOptions& read_options,
                        ReadCallback* callback) {
   LatencyHistGuard guard(&read_latency_reporter_);
   read_qps_reporter_.AddCount(1);
+  if (key_hotness_sampler_ != nullptr &&
+      immutable_db_options_.hotness_sample_reads &&
+      key_hotness_sampler_->ShouldSample()) {
+    key_hotness_sampler_->SampleKey(key);
+  }
 
   StopWatch sw(env_, stats_, DB_GET);
   PERF_TIMER_GUARD(get_snapshot_time);
@@ -2476,12 +3243,13 @@ Status DBImpl::GetImpl(const ReadOptions& read_options,
   }
   if (!done) {
     PERF_TIMER_GUARD(get_from_output_files_time);
-    uint64_t seq = uint64_t(-1);
     bool exists = false;
     bool value_found = false;
+    // Not asking for the sequence number, a Get() without a value is then
+    // free to skip reading it, see GetContext::key_presence_only()
     sv->current->Get(read_options, key, lkey, lazy_val, &s, &merge_context,
-                     &max_covering_tombstone_seq, &value_found, &exists, &seq,
-                     callback);
+                     &max_covering_tombstone_seq, &value_found, &exists,
+                     nullptr /* seq */, callback);
     RecordTick(stats_, MEMTABLE_MISS);
   }
 
@@ -2652,6 +3420,33 @@ std::vector<Status> DBImpl::MultiGet(
   // First look in the memtable, then in the immutable memtable (if any).
   // s is both in/out. When in, s could either be OK or MergeInProgress.
   // merge_operands will contain the sequence of merges in the latter case.
+  //
+  // Keys are looked up sorted by column family and user key, so that
+  // consecutive lookups walk the same files and index blocks. Values separated
+  // into blob files are not fetched during the lookup, they are fetched
+  // afterwards grouped by blob file and in key order within each file, so
+  // that neighbouring values share data block reads and block cache entries.
+  std::vector<size_t> order(num_keys);
+  for (size_t i = 0; i < num_keys; ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    auto cfd_a = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[a])
+                     ->cfd();
+    auto cfd_b = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[b])
+                     ->cfd();
+    if (cfd_a->GetID() != cfd_b->GetID()) {
+      return cfd_a->GetID() < cfd_b->GetID();
+    }
+    return cfd_a->user_comparator()->Compare(keys[a], keys[b]) < 0;
+  });
+  std::vector<LazyBuffer> lazy_values;
+  lazy_values.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; ++i) {
+    lazy_values.emplace_back(&(*values)[i]);
+  }
+  std::vector<bool> deferred(num_keys, false);
+
   size_t num_found = 0;
   size_t counting = num_keys;
   auto get_one = [&](size_t i) {
@@ -2659,7 +3454,7 @@ std::vector<Status> DBImpl::MultiGet(
     MergeContext merge_context;
     Status& s = stat_list[i];
     std::string* value = &(*values)[i];
-    LazyBuffer lazy_val(value);
+    LazyBuffer& lazy_val = lazy_values[i];
 
     LookupKey lkey(keys[i], snapshot);
     auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[i]);
@@ -2686,9 +3481,17 @@ std::vector<Status> DBImpl::MultiGet(
     }
     if (!done) {
       PERF_TIMER_GUARD(get_from_output_files_time);
-      super_version->current->Get(read_options, keys[i], lkey, &lazy_val, &s,
-                                  &merge_context, &max_covering_tombstone_seq);
+      super_version->current->Get(
+          read_options, keys[i], lkey, &lazy_val, &s, &merge_context,
+          &max_covering_tombstone_seq, nullptr /* value_found */,
+          nullptr /* key_exists */, nullptr /* seq */, nullptr /* callback */,
+          true /* defer_separated_value */);
       RecordTick(stats_, MEMTABLE_MISS);
+      if (s.ok() && !lazy_val.valid()) {
+        deferred[i] = true;
+        counting--;
+        return;
+      }
     }
     if (s.ok()) {
       s = std::move(lazy_val).dump(value);
@@ -2714,7 +3517,7 @@ std::vector<Status> DBImpl::MultiGet(
     auto tls = &gt_fibers;
     tls->update_fiber_count(read_options.aio_concurrency);
     for (size_t i = 0; i < num_keys; ++i) {
-      tls->push([&, i]() { get_one(i); });
+      tls->push([&, i]() { get_one(order[i]); });
     }
     while (counting) {
       // boost::this_fiber::yield();
@@ -2724,12 +3527,36 @@ std::vector<Status> DBImpl::MultiGet(
   } else {
 #endif
     for (size_t i = 0; i < num_keys; ++i) {
-      get_one(i);
+      get_one(order[i]);
     }
 #ifdef WITH_BOOSTLIB
   }
 #endif
 
+  std::vector<size_t> fetch_order;
+  for (size_t i : order) {
+    if (deferred[i]) {
+      fetch_order.push_back(i);
+    }
+  }
+  if (!fetch_order.empty()) {
+    PERF_TIMER_GUARD(get_from_output_files_time);
+    std::stable_sort(fetch_order.begin(), fetch_order.end(),
+                     [&](size_t a, size_t b) {
+                       return lazy_values[a].file_number() <
+                              lazy_values[b].file_number();
+                     });
+    for (size_t i : fetch_order) {
+      std::string* value = &(*values)[i];
+      Status& s = stat_list[i];
+      s = std::move(lazy_values[i]).dump(value);
+      if (s.ok()) {
+        bytes_read += value->size();
+        num_found++;
+      }
+    }
+  }
+
   // Post processing (decrement reference counts and record statistics)
   PERF_TIMER_GUARD(get_post_process_time);
   autovector<SuperVersion*> superversions_to_delete;
@@ -3132,6 +3959,11 @@ bool DBImpl::KeyMayExist(const ReadOptions& read_options,
   }
   ReadOptions roptions = read_options;
   roptions.read_tier = kBlockCacheTier;  // read from block cache only
+  if (value_found == nullptr) {
+    // The value is not returned, so don't read it
+    auto s = GetImpl(roptions, column_family, key, nullptr);
+    return s.ok() || s.IsIncomplete();
+  }
   LazyBuffer lazy_val(value);
   auto s = GetImpl(roptions, column_family, key, &lazy_val, value_found);
   if (s.ok()) {
@@ -3319,34 +4151,70 @@ const Snapshot* DBImpl::GetSnapshotForWriteConflictBoundary() {
 #endif  // ROCKSDB_LITE
 
 SnapshotImpl* DBImpl::GetSnapshotImpl(bool is_write_conflict_boundary) {
+  // returns null if the underlying memtable does not support snapshot.
+  if (!is_snapshot_supported_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
   int64_t unix_time = 0;
   env_->GetCurrentTime(&unix_time);  // Ignore error
   SnapshotImpl* s = new SnapshotImpl;
 
-  InstrumentedMutexLock l(&mutex_);
-  // returns null if the underlying memtable does not support snapshot.
-  if (!is_snapshot_supported_) {
-    delete s;
+  // The snapshot list has locks of its own, the DB mutex is not needed
+  return snapshots_.New(
+      s,
+      [this] {
+        return last_seq_same_as_publish_seq_
+                   ? versions_->LastSequence()
+                   : versions_->LastPublishedSequence();
+      },
+      unix_time, is_write_conflict_boundary);
+}
+
+const Snapshot* DBImpl::GetStaleSnapshot(uint64_t max_staleness_micros) {
+  uint64_t now_micros = env_->NowMicros();
+  {
+    std::lock_guard<SpinMutex> l(stale_snapshot_mutex_);
+    if (stale_snapshot_ != nullptr && now_micros >= stale_snapshot_micros_ &&
+        now_micros - stale_snapshot_micros_ <= max_staleness_micros) {
+      stale_snapshot_->shared_refs_.fetch_add(1, std::memory_order_relaxed);
+      return stale_snapshot_;
+    }
+  }
+  SnapshotImpl* s = GetSnapshotImpl(false);
+  if (s == nullptr) {
     return nullptr;
   }
-  auto snapshot_seq = last_seq_same_as_publish_seq_
-                          ? versions_->LastSequence()
-                          : versions_->LastPublishedSequence();
-  return snapshots_.New(s, snapshot_seq, unix_time, is_write_conflict_boundary);
+  // One reference for the caller, one for the DB while it hands it out
+  s->shared_refs_.store(2, std::memory_order_relaxed);
+  SnapshotImpl* retired;
+  {
+    std::lock_guard<SpinMutex> l(stale_snapshot_mutex_);
+    retired = stale_snapshot_;
+    stale_snapshot_ = s;
+    stale_snapshot_micros_ = now_micros;
+  }
+  if (retired != nullptr) {
+    ReleaseSnapshot(retired);
+  }
+  return s;
 }
 
 void DBImpl::ReleaseSnapshot(const Snapshot* s) {
   const SnapshotImpl* casted_s = reinterpret_cast<const SnapshotImpl*>(s);
-  {
+  if (casted_s->shared_refs_.load(std::memory_order_acquire) != 0 &&
+      casted_s->shared_refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    // Still held by others
+    return;
+  }
+  // Only when the oldest snapshot is released may the bottommost files
+  // become ready for compaction, the others leave the mutex alone
+  if (snapshots_.Delete(casted_s)) {
     InstrumentedMutexLock l(&mutex_);
-    snapshots_.Delete(casted_s);
-    uint64_t oldest_snapshot;
-    if (snapshots_.empty()) {
+    uint64_t oldest_snapshot = snapshots_.GetOldest();
+    if (oldest_snapshot == kMaxSequenceNumber) {
       oldest_snapshot = last_seq_same_as_publish_seq_
                             ? versions_->LastSequence()
                             : versions_->LastPublishedSequence();
-    } else {
-      oldest_snapshot = snapshots_.oldest()->number_;
     }
     for (auto* cfd : *versions_->GetColumnFamilySet()) {
       cfd->current()->storage_info()->UpdateOldestSnapshot(oldest_snapshot);
@@ -3727,12 +4595,30 @@ Status DBImpl::GetUpdatesSince(
     SequenceNumber seq, std::unique_ptr<TransactionLogIterator>* iter,
     const TransactionLogIterator::ReadOptions& read_options) {
   RecordTick(stats_, GET_UPDATES_SINCE_CALLS);
+  if (num_wal_streams_ > 1) {
+    return Status::NotSupported("GetUpdatesSince with wal_streams > 1");
+  }
   if (seq > versions_->LastSequence()) {
     return Status::NotFound("Requested sequence not yet written in the db");
   }
   return wal_manager_.GetUpdatesSince(seq, iter, read_options, versions_.get());
 }
 
+Status DBImpl::NewChangeFeedIterator(
+    SequenceNumber seq, std::unique_ptr<ChangeFeedIterator>* iter,
+    const TransactionLogIterator::ReadOptions& read_options) {
+  if (change_feed_ == nullptr) {
+    return Status::NotSupported("change_feed_buffer_size is 0");
+  }
+  iter->reset(new ChangeFeedIteratorImpl(
+      change_feed_.get(), seq,
+      [this, read_options](SequenceNumber wal_seq,
+                           std::unique_ptr<TransactionLogIterator>* wal_iter) {
+        return GetUpdatesSince(wal_seq, wal_iter, read_options);
+      }));
+  return Status::OK();
+}
+
 void DBImpl::SetGuardSeqno(SequenceNumber guard_seqno) {
   wal_manager_.SetGuardSeqno(guard_seqno);
 }
@@ -4366,11 +5252,60 @@ void DB::GetAsync(const ReadOptions& ro, std::string key, GetAsyncCallback cb) {
   GetAsync(ro, DefaultColumnFamily(), move(key), move(cb));
 }
 
+void DB::MultiGetAsync(const ReadOptions& ro,
+                       std::vector<ColumnFamilyHandle*> column_families,
+                       std::vector<std::string> keys,
+                       MultiGetAsyncCallback cb) {
+  assert(column_families.size() == keys.size());
+  struct MultiGetAsyncContext {
+    std::vector<ColumnFamilyHandle*> column_families;
+    std::vector<std::string> keys;
+    std::vector<Status> statuses;
+    std::vector<std::string> values;
+    MultiGetAsyncCallback cb;
+    // All the lookups run on fibers of the calling thread
+    size_t pending;
+  };
+  using std::move;
+  size_t num_keys = keys.size();
+  if (num_keys == 0) {
+    cb(std::vector<Status>(), move(keys), std::vector<std::string>());
+    return;
+  }
+  auto ctx = std::make_shared<MultiGetAsyncContext>();
+  ctx->column_families = move(column_families);
+  ctx->keys = move(keys);
+  ctx->statuses.resize(num_keys);
+  ctx->values.resize(num_keys);
+  ctx->cb = move(cb);
+  ctx->pending = num_keys;
+  auto tls = &gt_fibers;
+  tls->update_fiber_count(ro.aio_concurrency);
+  for (size_t i = 0; i < num_keys; ++i) {
+    tls->push([this, ro, ctx, i]() {
+      ctx->statuses[i] = this->Get(ro, ctx->column_families[i], ctx->keys[i],
+                                   &ctx->values[i]);
+      if (--ctx->pending == 0) {
+        ctx->cb(move(ctx->statuses), move(ctx->keys), move(ctx->values));
+      }
+    });
+  }
+}
+
+void DB::MultiGetAsync(const ReadOptions& ro, std::vector<std::string> keys,
+                       MultiGetAsyncCallback cb) {
+  std::vector<ColumnFamilyHandle*> column_families(keys.size(),
+                                                   DefaultColumnFamily());
+  MultiGetAsync(ro, std::move(column_families), std::move(keys),
+                std::move(cb));
+}
+
 ///@returns == 0 indicate there is nothing to wait
 ///          < 0 indicate number of finished GetAsync/GetFuture requests after
 ///              timeout
 ///          > 0 indicate number of all GetAsync/GetFuture requests have
 ///              finished within timeout
+///          every key of a MultiGetAsync request counts as one request
 int DB::WaitAsync(int timeout_us) { return gt_fibers.wait(timeout_us); }
 
 int DB::WaitAsync() { return gt_fibers.wait(); }
@@ -19,6 +19,7 @@
 #include <utility>
 #include <vector>
 
+#include "db/change_feed.h"
 #include "db/column_family.h"
 #include "db/compaction_job.h"
 #include "db/dbformat.h"
@@ -27,7 +28,9 @@
 #include "db/external_sst_file_ingestion_job.h"
 #include "db/flush_job.h"
 #include "db/flush_scheduler.h"
+#include "db/hot_block_set.h"
 #include "db/internal_stats.h"
+#include "db/key_hotness_sampler.h"
 #include "db/log_writer.h"
 #include "db/logs_with_prep_tracker.h"
 #include "db/pre_release_callback.h"
@@ -35,12 +38,17 @@
 #include "db/read_callback.h"
 #include "db/snapshot_checker.h"
 #include "db/snapshot_impl.h"
+#include "db/value_log.h"
 #include "db/version_edit.h"
 #include "db/wal_manager.h"
+#include "db/wal_syncer.h"
 #include "db/write_controller.h"
 #include "db/write_thread.h"
+#include "db/zone_gc_picker.h"
 #include "memtable_list.h"
+#include "monitoring/cpu_attribution.h"
 #include "monitoring/instrumented_mutex.h"
+#include "monitoring/io_attribution.h"
 #include "options/db_options.h"
 #include "port/port.h"
 #include "rocksdb/db.h"
@@ -73,6 +81,7 @@ class InMemoryStatsHistoryIterator;
 class MemTable;
 class PersistentStatsHistoryIterator;
 class PeriodicWorkScheduler;
+enum class PeriodicWorkSignal;
 #ifndef NDEBUG
 class PeriodicWorkTestScheduler;
 #endif  // !NDEBUG
@@ -174,6 +183,8 @@ class DBImpl : public DB {
                                       bool allow_refresh = true);
 
   virtual const Snapshot* GetSnapshot() override;
+  virtual const Snapshot* GetStaleSnapshot(
+      uint64_t max_staleness_micros) override;
   virtual void ReleaseSnapshot(const Snapshot* snapshot) override;
   using DB::GetProperty;
   virtual bool GetProperty(ColumnFamilyHandle* column_family,
@@ -288,6 +299,10 @@ class DBImpl : public DB {
       SequenceNumber seq_number, std::unique_ptr<TransactionLogIterator>* iter,
       const TransactionLogIterator::ReadOptions& read_options =
           TransactionLogIterator::ReadOptions()) override;
+  virtual Status NewChangeFeedIterator(
+      SequenceNumber seq_number, std::unique_ptr<ChangeFeedIterator>* iter,
+      const TransactionLogIterator::ReadOptions& read_options =
+          TransactionLogIterator::ReadOptions()) override;
   virtual void SetGuardSeqno(SequenceNumber guard_seqno) override;
   virtual Status DeleteFile(std::string name) override;
   Status DeleteFilesInRanges(ColumnFamilyHandle* column_family,
@@ -393,7 +408,8 @@ class DBImpl : public DB {
                              const Slice* end,
                              const chash_set<uint64_t>* files_being_compact,
                              bool exclusive,
-                             bool disallow_trivial_move = false);
+                             bool disallow_trivial_move = false,
+                             const void* parallel_group = nullptr);
 
   // Return an internal iterator over the current state of the database.
   // The keys of this iterator are internal keys (see format.h).
@@ -693,6 +709,10 @@ class DBImpl : public DB {
     return recovered_transactions_;
   }
 
+  // The value log `index` points into, opened from the WAL directory if it
+  // isn't open yet, as when the WAL is recovered
+  Status GetValueLog(const Slice& index, std::shared_ptr<ValueLog>* log);
+
   RecoveredTransaction* GetRecoveredTransaction(const std::string& name) {
     auto it = recovered_transactions_.find(name);
     if (it == recovered_transactions_.end()) {
@@ -816,6 +836,22 @@ class DBImpl : public DB {
 
   void ScheduleTtlGC();
 
+  // Drop the SSTs of `cfd` whose entries have all expired, and that no older
+  // data of their key range lies beneath. REQUIRES: mutex locked, may be
+  // released and re-acquired while the deletion is logged.
+  void DropExpiredTtlFiles(ColumnFamilyData* cfd, JobContext* job_context,
+                           LogBuffer* log_buffer);
+
+  // Merge the keys sampled on the foreground path into the Env's Oracle
+  void MergeSampledKeyHotness();
+
+  // Charge the sampled writes to the files of the current versions, for the
+  // key range heatmap
+  void ChargeSampledWrites();
+
+  // Write the hot block sets of the live tables to HOT_BLOCKS
+  void PersistHotBlocks();
+
 #ifdef WITH_ZENFS
   struct ZenFSStatisticsStatus {
     uint64_t used = 0;
@@ -830,6 +866,16 @@ class DBImpl : public DB {
   // Get Current ZenFS Statistics
   ZenFSStatisticsStatus GetZenFSStatistics(const BDZenFSStat& zenfs_stat);
 
+  // Valid bytes zone GC has handed to ZenFS to migrate since open
+  uint64_t GetZoneGCMigratedBytes() const {
+    return zone_gc_migrated_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Feed the free capacity ratio into the rate limiter so that the budget of
+  // GC migration I/O follows the zone pressure, and keep the capacity for
+  // GetZoneCapacity()
+  void UpdateZoneGCRateLimit(const ZenFSStatisticsStatus& stat);
+
   //====================================================================
   // Implementation of naive ZenFS Garbage collection
   //====================================================================
@@ -839,17 +885,41 @@ class DBImpl : public DB {
   void ScheduleZNSGC();
   // (kqh): Report ZNS status
   void ScheduleZNSStatusReporter();
-  // (kqh): Pick zones for migration during ZNS GC
-  void PickMigrationZone(const std::vector<BDZoneStat>& zone_stat,
-                         std::set<uint64_t>* picked_zones);
+  // (kqh): Pick zones for migration during ZNS GC, the picked zones are
+  // returned in victim order. An empty result means no GC is needed
+  void PickMigrationZone(const BDZenFSStat& zenfs_stat,
+                         std::vector<uint64_t>* picked_zones);
   // (kqh): Do Compaction work for a zone to reclaim the free space
   void MaybeDoZoneCompaction();
   int force_gc_count_ = 0;
   int schedule_gc_count_ = 0;
   int regular_gc_count_ = 0;
   int compact_zone_count_ = 0;
+  std::atomic<uint64_t> zone_gc_migrated_bytes_{0};
+  // Keeps zone history across GC rounds, only accessed by the GC thread
+  std::unique_ptr<ZoneGCPicker> zone_gc_picker_;
 #endif
 
+  // The memory of the buffers of the sampled key hotness, 0 if not sampled
+  size_t ApproximateKeyHotnessMemoryUsage() const {
+    return key_hotness_sampler_ == nullptr
+               ? 0
+               : key_hotness_sampler_->ApproximateMemoryUsage();
+  }
+
+  // The free, reclaimable and total bytes of the zones as of the last zone
+  // stats, false before the first or without ZenFS
+  bool GetZoneCapacity(uint64_t* free, uint64_t* garbage,
+                       uint64_t* capacity) const {
+    *free = zone_free_bytes_.load(std::memory_order_relaxed);
+    *garbage = zone_garbage_bytes_.load(std::memory_order_relaxed);
+    *capacity = zone_capacity_bytes_.load(std::memory_order_relaxed);
+    return *capacity > 0;
+  }
+  std::atomic<uint64_t> zone_free_bytes_{0};
+  std::atomic<uint64_t> zone_garbage_bytes_{0};
+  std::atomic<uint64_t> zone_capacity_bytes_{0};
+
  protected:
   Env* const env_;
   const std::string dbname_;
@@ -995,6 +1065,7 @@ class DBImpl : public DB {
   friend class WriteUnpreparedTxn;
 
 #ifndef ROCKSDB_LITE
+  friend class DBImplSecondary;
   friend class ForwardIterator;
 #endif
   friend struct SuperVersion;
@@ -1160,6 +1231,18 @@ class DBImpl : public DB {
   //            `num_bytes` going through.
   Status DelayWrite(uint64_t num_bytes, const WriteOptions& write_options);
 
+  // With DBOptions::isolate_cf_write_stalls, wait for the stalls of the
+  // column families `my_batch` writes to. Called before the write joins a
+  // write group, without holding the DB mutex.
+  Status DelayColumnFamilyWrite(const WriteOptions& write_options,
+                                WriteBatch* my_batch);
+
+  // Charge `my_batch` to the ResourceGroup of every column family it writes
+  // to, and wait for their token buckets. Called before the write joins a
+  // write group, without holding the DB mutex.
+  Status ThrottleResourceGroupWrites(const WriteOptions& write_options,
+                                     WriteBatch* my_batch);
+
   Status ThrottleLowPriWritesIfNeeded(const WriteOptions& write_options,
                                       WriteBatch* my_batch);
 
@@ -1217,9 +1300,20 @@ class DBImpl : public DB {
                          WriteBatch* tmp_batch, size_t* write_with_wal,
                          WriteBatch** to_be_cached_state);
 
+  // Lay out `batches` as the WAL record MergeBatch() would build from them:
+  // `header` followed by the entries of each batch, so the record can be
+  // written straight from the batches. Returns false if a batch is only
+  // partly written to the WAL.
+  static bool GatherWALBatches(const autovector<WriteBatch*, 8>& batches,
+                               SequenceNumber sequence, char* header,
+                               std::vector<Slice>* parts);
+
   Status WriteToWAL(const WriteBatch& merged_batch, log::Writer* log_writer,
                     uint64_t* log_used, uint64_t* log_size);
 
+  Status WriteToWAL(const SliceParts& log_entry, log::Writer* log_writer,
+                    uint64_t* log_used, uint64_t* log_size);
+
   Status WriteToWAL(const WriteThread::WriteGroup& write_group,
                     log::Writer* log_writer, uint64_t* log_used,
                     bool need_log_sync, bool need_log_dir_sync,
@@ -1229,6 +1323,24 @@ class DBImpl : public DB {
                               uint64_t* log_used, SequenceNumber* last_sequence,
                               size_t seq_inc);
 
+  // Cut a parallel write group into runs of writers, one per stream in
+  // wal_streams, after the sequences of the writers are assigned. The first
+  // writer of each run appends the run in WriteToWALStream().
+  void AssignWALStreams(const WriteThread::WriteGroup& write_group,
+                        const autovector<log::Writer*, 8>& wal_streams,
+                        uint64_t log_size, uint64_t* log_used);
+
+  // Publish the batches of a group written to the WAL streams to change_feed_
+  void PublishToChangeFeed(const WriteThread::WriteGroup& write_group);
+
+  Status WriteToWALStream(WriteThread::Writer* w);
+
+  // With value_log_threshold, append the large values of the batches of a
+  // group to the value log of `log_writer`, and point the writers to the
+  // copies of their batches with the value indexes instead
+  Status WriteToValueLog(const WriteThread::WriteGroup& write_group,
+                         log::Writer* log_writer);
+
   // Used by WriteImpl to update bg_error_ if paranoid check is enabled.
   void WriteStatusCheck(const Status& status);
 
@@ -1289,13 +1401,17 @@ class DBImpl : public DB {
   static void BGWorkBottomCompaction(void* arg);
   static void BGWorkFlush(void* db);
   static void BGWorkPurge(void* arg);
+  static void BGWorkBlockCacheWarmUp(void* arg);
   static void UnscheduleCallback(void* arg);
+  static void UnscheduleBlockCacheWarmUpCallback(void* arg);
   void BackgroundCallCompaction(PrepickedCompaction* prepicked_compaction,
                                 Env::Priority bg_thread_pri);
   void BackgroundCallGarbageCollection();
   void BackgroundCallZNSGarbageCollection();
   void BackgroundCallFlush();
   void BackgroundCallPurge();
+  void BackgroundCallBlockCacheWarmUp(
+      const std::vector<HotBlockSet::Table>& tables);
   Status BackgroundCompaction(bool* madeProgress, JobContext* job_context,
                               LogBuffer* log_buffer,
                               PrepickedCompaction* prepicked_compaction);
@@ -1312,11 +1428,30 @@ class DBImpl : public DB {
                                const std::vector<CompactionInputFiles>& inputs,
                                bool* sfm_bookkeeping, LogBuffer* log_buffer);
 
+  // Whether the table factory admits the builds of `c`, see
+  // TableFactory::AdmitBuild()
+  bool EnoughMemoryForCompaction(const Compaction* c, LogBuffer* log_buffer);
+
   // Schedule background tasks
   void StartPeriodicWorkScheduler();
 
+  // Run the periodic work reacting to `signal` early.
+  // REQUIRES: mutex locked
+  void SignalPeriodicWork(PeriodicWorkSignal signal);
+
+  // Load the blocks recorded in HOT_BLOCKS into the block cache with
+  // background jobs in the LOW pool
+  void ScheduleBlockCacheWarmUp();
+
   void PrintStatistics();
 
+  // Log the I/O attributed since the last call and feed it to the metrics
+  // reporters. Only called from DumpStats()
+  void DumpIOAttribution();
+
+  // The same for the CPU time of the background jobs
+  void DumpCpuAttribution();
+
   size_t EstimateInMemoryStatsHistorySize() const;
 
   // Return the minimum empty level that could hold the total data in the
@@ -1330,6 +1465,24 @@ class DBImpl : public DB {
   // hold the data set.
   Status ReFitLevel(ColumnFamilyData* cfd, int level, int target_level = -1);
 
+  // Compact [begin, end] of each level down to max_level_with_files, one
+  // level after the other, as CompactRange() does. Raises
+  // *final_output_level to the last level written.
+  Status CompactRangeLevels(const CompactRangeOptions& options,
+                            ColumnFamilyData* cfd, const Slice* begin,
+                            const Slice* end, int max_level_with_files,
+                            bool skip_bottommost,
+                            const chash_set<uint64_t>* files_being_compact,
+                            bool exclusive, const void* parallel_group,
+                            int* final_output_level);
+
+  // Split [begin, end] into up to max_ranges ranges at the boundaries of the
+  // files of `level` that overlap it. Returns the inner bounds, the end of a
+  // range followed by the begin of the next one, or nothing if not split.
+  std::vector<std::string> SplitManualCompactionRange(
+      ColumnFamilyData* cfd, int level, const Slice* begin, const Slice* end,
+      uint32_t max_ranges);
+
   // helper functions for adding and removing from flush & compaction queues
   void AddToCompactionQueue(ColumnFamilyData* cfd);
   ColumnFamilyData* PopFirstFromCompactionQueue();
@@ -1473,6 +1626,15 @@ class DBImpl : public DB {
   //  - it follows that the items with getting_synced=true can be safely read
   //  from the same thread that has set getting_synced=true
   std::deque<LogWriterNumber> logs_;
+  // The secondary WAL streams of the logs in logs_, see DBOptions::wal_streams.
+  // The streams of a log are numbered right after it and before the next log,
+  // the last num_wal_streams_ - 1 of them belong to the current log. They are
+  // pushed and popped like logs_, and are not popped while
+  // wal_stream_syncs_ > 0.
+  std::deque<LogWriterNumber> wal_streams_;
+  // Number of running WAL syncs that sync wal_streams_ as well, protected by
+  // mutex_. MarkLogsSynced() ends a sync.
+  int wal_stream_syncs_ = 0;
   // Signaled when getting_synced becomes false for some of the logs_.
   InstrumentedCondVar log_sync_cv_;
   // This is the app-level state that is written to the WAL but will be used
@@ -1495,7 +1657,8 @@ class DBImpl : public DB {
   // threads. Protected by db mutex.
   autovector<log::Writer*> logs_to_free_;
 
-  bool is_snapshot_supported_;
+  // Read without the mutex by GetSnapshot(), set under it
+  std::atomic<bool> is_snapshot_supported_;
 
   std::map<uint64_t, std::map<std::string, uint64_t>> stats_history_;
 
@@ -1533,6 +1696,8 @@ class DBImpl : public DB {
 
   WriteThread write_thread_;
   WriteBatch tmp_batch_;
+  // The record of a group gathered by GatherWALBatches() in WriteToWAL()
+  std::vector<Slice> wal_parts_;
   // The write thread when the writers have no memtable write. This will be used
   // in 2PC to batch the prepares separately from the serial commit.
   WriteThread nonmem_write_thread_;
@@ -1551,6 +1716,11 @@ class DBImpl : public DB {
 
   SnapshotList snapshots_;
 
+  // The snapshot GetStaleSnapshot() shares, taken at stale_snapshot_micros_
+  SpinMutex stale_snapshot_mutex_;
+  SnapshotImpl* stale_snapshot_;
+  uint64_t stale_snapshot_micros_;
+
   // For each background job, pending_outputs_ keeps the current file number at
   // the time that background job started.
   // FindObsoleteFiles()/PurgeObsoleteFiles() never deletes any file that has
@@ -1648,6 +1818,9 @@ class DBImpl : public DB {
   // number of background obsolete file purge jobs, submitted to the HIGH pool
   int bg_purge_scheduled_;
 
+  // number of background block cache warm up jobs, submitted to the LOW pool
+  int bg_block_cache_warm_up_scheduled_;
+
   // Information for a manual compaction
   struct ManualCompactionState {
     ColumnFamilyData* cfd;
@@ -1662,6 +1835,9 @@ class DBImpl : public DB {
     bool disallow_trivial_move;  // Force actual compaction to run
     const InternalKey* begin;    // nullptr means beginning of key range
     const InternalKey* end;      // nullptr means end of key range
+    // The ranges of a range-parallel CompactRange() share it and don't
+    // conflict with each other, nullptr if not part of one
+    const void* parallel_group;
     InternalKey* manual_end;     // how far we are compacting
     InternalKey tmp_storage;     // Used to keep track of compaction progress
     InternalKey tmp_storage1;    // Used to keep track of compaction progress
@@ -1682,6 +1858,12 @@ class DBImpl : public DB {
     PrepickedCompaction* prepicked_compaction;
   };
 
+  struct BlockCacheWarmUpArg {
+    // caller retains ownership of `db`.
+    DBImpl* db;
+    std::vector<HotBlockSet::Table> tables;
+  };
+
   // shall we disable deletion of obsolete files
   // if 0 the deletion is enabled.
   // if non-zero, files will not be getting deleted
@@ -1827,6 +2009,28 @@ class DBImpl : public DB {
   PeriodicWorkScheduler* periodic_work_scheduler_;
 #endif
 
+  // Samples foreground keys for the hotness Oracle, nullptr if
+  // hotness_sample_interval is 0
+  std::unique_ptr<KeyHotnessSampler> key_hotness_sampler_;
+
+  // Samples foreground writes for the key range heatmap
+  std::unique_ptr<WriteHeatSampler> write_heat_sampler_;
+
+  // Runs the WAL fsyncs of sync writes of the main write queue, nullptr
+  // unless async_wal_sync is set
+  std::unique_ptr<WalSyncer> wal_syncer_;
+
+  // The latest WAL records for NewChangeFeedIterator(), nullptr unless
+  // change_feed_buffer_size is set. Published by the write group leaders.
+  std::unique_ptr<ChangeFeed> change_feed_;
+
+  // The value log of the current WAL appended to by the write group leaders,
+  // nullptr unless value_log_threshold is set
+  std::shared_ptr<ValueLog> value_log_;
+  // The value logs kept by memtables, by number
+  InstrumentedMutex value_logs_mutex_;
+  std::map<uint64_t, std::weak_ptr<ValueLog>> value_logs_;
+
   // When set, we use a separate queue for writes that dont write to memtable.
   // In 2PC these are the writes at Prepare phase.
   const bool two_write_queues_;
@@ -1852,6 +2056,8 @@ class DBImpl : public DB {
   // flush/compaction and if it is not provided vis SnapshotChecker, we should
   // disable gc to be safe.
   const bool use_custom_gc_;
+  // Number of WAL streams per log, 1 unless DBOptions::wal_streams applies
+  const size_t num_wal_streams_;
   // Flag to indicate that the DB instance shutdown has been initiated. This
   // different from shutting_down_ atomic in that it is set at the beginning
   // of shutdown sequence, specifically in order to prevent any background
@@ -1912,6 +2118,17 @@ class DBImpl : public DB {
 
   ThroughputReporter write_throughput_reporter_;
   DistributionReporter write_batch_size_reporter_;
+
+  // The process wide I/O attribution at the last DumpIOAttribution(), and the
+  // reporters of the bytes of every entry, built when it first has I/O
+  IOAttributionStats io_attribution_last_dump_;
+  uint64_t io_attribution_last_dump_micros_ = 0;
+  std::vector<CountReporterHandle*> io_attribution_reporters_;
+
+  // The process wide CPU attribution at the last DumpCpuAttribution(), and
+  // the reporters of the CPU time of every kind of job
+  CpuAttributionStats cpu_attribution_last_dump_;
+  std::vector<CountReporterHandle*> cpu_attribution_reporters_;
 };
 
 extern Options SanitizeOptions(const std::string& db, const Options& src);
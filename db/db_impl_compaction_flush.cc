@@ -14,6 +14,7 @@
 #include "db/snapshot_checker.h"
 #include "fs/log.h"
 #include "rocksdb/compaction_job_stats.h"
+#include "rocksdb/resource_group.h"
 #include "rocksdb/types.h"
 
 #ifndef __STDC_FORMAT_MACROS
@@ -25,11 +26,16 @@
 #include "db/error_handler.h"
 #include "db/event_helpers.h"
 #include "db/map_builder.h"
+#include "db/periodic_work_scheduler.h"
+#include "monitoring/cpu_attribution.h"
+#include "monitoring/io_attribution.h"
 #include "monitoring/iostats_context_imp.h"
 #include "monitoring/perf_context_imp.h"
 #include "monitoring/thread_status_updater.h"
 #include "monitoring/thread_status_util.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/background_coordinator_impl.h"
+#include "util/file_util.h"
 #include "util/sst_file_manager_impl.h"
 #include "util/sync_point.h"
 
@@ -69,6 +75,25 @@ bool DBImpl::EnoughRoomForCompaction(
   return enough_room;
 }
 
+bool DBImpl::EnoughMemoryForCompaction(const Compaction* c,
+                                       LogBuffer* log_buffer) {
+  // A compaction builds its output files one after another
+  uint64_t build_bytes =
+      std::min(c->CalculateTotalInputSize(), c->max_output_file_size());
+  bool enough_memory = c->immutable_cf_options()->table_factory->AdmitBuild(
+      c->output_level(), build_bytes);
+  TEST_SYNC_POINT_CALLBACK("DBImpl::EnoughMemoryForCompaction",
+                           &enough_memory);
+  if (!enough_memory) {
+    ROCKS_LOG_BUFFER(log_buffer,
+                     "[%s] Deferred compaction because not enough memory for "
+                     "its table builds",
+                     c->column_family_data()->GetName().c_str());
+    RecordTick(stats_, COMPACTION_CANCELLED, 1);
+  }
+  return enough_memory;
+}
+
 Status DBImpl::SyncClosedLogs(JobContext* job_context) {
   TEST_SYNC_POINT("DBImpl::SyncClosedLogs:Start");
   mutex_.AssertHeld();
@@ -88,6 +113,12 @@ Status DBImpl::SyncClosedLogs(JobContext* job_context) {
 
   Status s;
   if (!logs_to_sync.empty()) {
+    for (auto& stream : wal_streams_) {
+      if (stream.number < current_log_number) {
+        logs_to_sync.push_back(stream.writer);
+      }
+    }
+    ++wal_stream_syncs_;
     mutex_.Unlock();
 
     for (log::Writer* log : logs_to_sync) {
@@ -700,6 +731,7 @@ Status DBImpl::CompactRange(const CompactRangeOptions& options,
 
   int max_level_with_files = 0;
   chash_set<uint64_t> files_being_compact;
+  std::vector<std::string> split_keys;
   {
     InstrumentedMutexLock l(&mutex_);
     Version* base = cfd->current();
@@ -711,6 +743,12 @@ Status DBImpl::CompactRange(const CompactRangeOptions& options,
     }
     cfd->PrepareManualCompaction(*cfd->GetLatestMutableCFOptions(), begin, end,
                                  &files_being_compact);
+    if (options.max_parallel_ranges > 1 &&
+        cfd->ioptions()->compaction_style == kCompactionStyleLevel &&
+        !cfd->ioptions()->enable_lazy_compaction) {
+      split_keys = SplitManualCompactionRange(cfd, max_level_with_files, begin,
+                                              end, options.max_parallel_ranges);
+    }
   }
 
   int final_output_level = 0;
@@ -728,70 +766,82 @@ Status DBImpl::CompactRange(const CompactRangeOptions& options,
         cfd, options.separation_type, ColumnFamilyData::kCompactAllLevels,
         final_output_level, options.target_path_id, options.max_subcompactions,
         begin, end, &files_being_compact, exclusive, false);
+  } else if (split_keys.empty()) {
+    s = CompactRangeLevels(options, cfd, begin, end, max_level_with_files,
+                           false /* skip_bottommost */, &files_being_compact,
+                           exclusive, nullptr /* parallel_group */,
+                           &final_output_level);
   } else {
-    for (int level = 0; level <= max_level_with_files; level++) {
-      int output_level;
-      // in case the compaction is universal or if we're compacting the
-      // bottom-most level, the output level will be the same as input one.
-      // level 0 can never be the bottommost level (i.e. if all files are in
-      // level 0, we will compact to level 1)
-      if (cfd->ioptions()->compaction_style == kCompactionStyleUniversal) {
-        output_level = level;
-      } else if (level == max_level_with_files && level > 0) {
-        if (options.bottommost_level_compaction ==
-            BottommostLevelCompaction::kSkip) {
-          // Skip bottommost level compaction
-          continue;
-        } else if (options.bottommost_level_compaction ==
-                       BottommostLevelCompaction::kIfHaveCompactionFilter &&
-                   cfd->ioptions()->compaction_filter == nullptr &&
-                   cfd->ioptions()->compaction_filter_factory == nullptr) {
-          // Skip bottommost level compaction since we don't have a compaction
-          // filter
-          continue;
-        }
-        output_level = level;
-      } else {
-        output_level = level + 1;
-        if (cfd->ioptions()->compaction_style == kCompactionStyleLevel &&
-            cfd->ioptions()->level_compaction_dynamic_level_bytes &&
-            level == 0) {
-          output_level = ColumnFamilyData::kCompactToBaseLevel;
-        }
-      }
-      s = RunManualCompaction(cfd, options.separation_type, level, output_level,
-                              options.target_path_id,
-                              options.max_subcompactions, begin, end,
-                              &files_being_compact, exclusive, false);
-      if (!s.ok()) {
-        break;
+    size_t num_ranges = split_keys.size() / 2 + 1;
+    std::vector<Slice> bounds(split_keys.begin(), split_keys.end());
+    std::vector<Status> statuses(num_ranges);
+    std::vector<int> final_output_levels(num_ranges, 0);
+    // Stands for the whole range in the manual compaction queue: while it's
+    // there, no automatic compaction gets scheduled if exclusive, and its
+    // address groups the ranges
+    ManualCompactionState group;
+    group.cfd = cfd;
+    group.input_level = 0;
+    group.output_level = 0;
+    group.output_path_id = options.target_path_id;
+    group.done = false;
+    group.in_progress = false;
+    group.incomplete = false;
+    group.exclusive = exclusive;
+    group.disallow_trivial_move = false;
+    group.begin = nullptr;
+    group.end = nullptr;
+    group.parallel_group = &group;
+    group.manual_end = nullptr;
+    if (exclusive) {
+      InstrumentedMutexLock l(&mutex_);
+      AddManualCompaction(&group);
+      while (bg_bottom_compaction_scheduled_ > 0 ||
+             bg_compaction_scheduled_ > bg_garbage_collection_scheduled_) {
+        bg_cv_.Wait();
       }
-      if (output_level == ColumnFamilyData::kCompactToBaseLevel) {
-        final_output_level = cfd->NumberLevels() - 1;
-      } else if (output_level > final_output_level) {
-        final_output_level = output_level;
-      }
-      TEST_SYNC_POINT("DBImpl::RunManualCompaction()::1");
-      TEST_SYNC_POINT("DBImpl::RunManualCompaction()::2");
-      while (cfd->ioptions()->enable_lazy_compaction) {
-        int bottommost_level;
-        {
-          InstrumentedMutexLock l(&mutex_);
-          bottommost_level =
-              cfd->current()->storage_info()->num_non_empty_levels() - 1;
-        }
-        if (max_level_with_files >= bottommost_level) {
-          break;
-        }
-        do {
-          ++max_level_with_files;
-          s = RunManualCompaction(cfd, options.separation_type,
-                                  max_level_with_files, max_level_with_files,
-                                  options.target_path_id,
-                                  options.max_subcompactions, begin, end,
-                                  &files_being_compact, exclusive, false);
-        } while (max_level_with_files < bottommost_level);
+    }
+    ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                   "[%s] Manual compaction split into %" ROCKSDB_PRIszt
+                   " ranges",
+                   cfd->GetName().c_str(), num_ranges);
+    TEST_SYNC_POINT_CALLBACK("DBImpl::CompactRange:SplitRanges", &num_ranges);
+    auto compact_range = [&](size_t i) {
+      const Slice* range_begin = i == 0 ? begin : &bounds[2 * i - 1];
+      const Slice* range_end = i + 1 == num_ranges ? end : &bounds[2 * i];
+      statuses[i] = CompactRangeLevels(
+          options, cfd, range_begin, range_end, max_level_with_files,
+          false /* skip_bottommost */, &files_being_compact,
+          false /* exclusive */, &group, &final_output_levels[i]);
+    };
+    std::vector<port::Thread> threads;
+    threads.reserve(num_ranges - 1);
+    for (size_t i = 1; i < num_ranges; ++i) {
+      threads.emplace_back(compact_range, i);
+    }
+    compact_range(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (size_t i = 0; i < num_ranges; ++i) {
+      if (s.ok()) {
+        s = statuses[i];
       }
+      final_output_level =
+          std::max(final_output_level, final_output_levels[i]);
+    }
+    // The files of the upper levels in between two ranges are left behind,
+    // moving them down doesn't need the last level compacted again
+    if (s.ok()) {
+      s = CompactRangeLevels(options, cfd, begin, end, max_level_with_files,
+                             true /* skip_bottommost */, &files_being_compact,
+                             false /* exclusive */, &group,
+                             &final_output_level);
+    }
+    if (exclusive) {
+      InstrumentedMutexLock l(&mutex_);
+      RemoveManualCompaction(&group);
+      bg_cv_.SignalAll();
     }
   }
   if (!s.ok()) {
@@ -820,6 +870,117 @@ Status DBImpl::CompactRange(const CompactRangeOptions& options,
   return s;
 }
 
+Status DBImpl::CompactRangeLevels(
+    const CompactRangeOptions& options, ColumnFamilyData* cfd,
+    const Slice* begin, const Slice* end, int max_level_with_files,
+    bool skip_bottommost, const chash_set<uint64_t>* files_being_compact,
+    bool exclusive, const void* parallel_group, int* final_output_level) {
+  Status s;
+  for (int level = 0; level <= max_level_with_files; level++) {
+    int output_level;
+    // in case the compaction is universal or if we're compacting the
+    // bottom-most level, the output level will be the same as input one.
+    // level 0 can never be the bottommost level (i.e. if all files are in
+    // level 0, we will compact to level 1)
+    if (cfd->ioptions()->compaction_style == kCompactionStyleUniversal) {
+      output_level = level;
+    } else if (level == max_level_with_files && level > 0) {
+      if (skip_bottommost || options.bottommost_level_compaction ==
+                                 BottommostLevelCompaction::kSkip) {
+        // Skip bottommost level compaction
+        continue;
+      } else if (options.bottommost_level_compaction ==
+                     BottommostLevelCompaction::kIfHaveCompactionFilter &&
+                 cfd->ioptions()->compaction_filter == nullptr &&
+                 cfd->ioptions()->compaction_filter_factory == nullptr) {
+        // Skip bottommost level compaction since we don't have a compaction
+        // filter
+        continue;
+      }
+      output_level = level;
+    } else {
+      output_level = level + 1;
+      if (cfd->ioptions()->compaction_style == kCompactionStyleLevel &&
+          cfd->ioptions()->level_compaction_dynamic_level_bytes &&
+          level == 0) {
+        output_level = ColumnFamilyData::kCompactToBaseLevel;
+      }
+    }
+    s = RunManualCompaction(cfd, options.separation_type, level, output_level,
+                            options.target_path_id, options.max_subcompactions,
+                            begin, end, files_being_compact, exclusive, false,
+                            parallel_group);
+    if (!s.ok()) {
+      break;
+    }
+    if (output_level == ColumnFamilyData::kCompactToBaseLevel) {
+      *final_output_level = cfd->NumberLevels() - 1;
+    } else if (output_level > *final_output_level) {
+      *final_output_level = output_level;
+    }
+    TEST_SYNC_POINT("DBImpl::RunManualCompaction()::1");
+    TEST_SYNC_POINT("DBImpl::RunManualCompaction()::2");
+    while (cfd->ioptions()->enable_lazy_compaction) {
+      int bottommost_level;
+      {
+        InstrumentedMutexLock l(&mutex_);
+        bottommost_level =
+            cfd->current()->storage_info()->num_non_empty_levels() - 1;
+      }
+      if (max_level_with_files >= bottommost_level) {
+        break;
+      }
+      do {
+        ++max_level_with_files;
+        s = RunManualCompaction(cfd, options.separation_type,
+                                max_level_with_files, max_level_with_files,
+                                options.target_path_id,
+                                options.max_subcompactions, begin, end,
+                                files_being_compact, exclusive, false,
+                                parallel_group);
+      } while (max_level_with_files < bottommost_level);
+    }
+  }
+  return s;
+}
+
+std::vector<std::string> DBImpl::SplitManualCompactionRange(
+    ColumnFamilyData* cfd, int level, const Slice* begin, const Slice* end,
+    uint32_t max_ranges) {
+  mutex_.AssertHeld();
+  std::vector<std::string> split_keys;
+  if (level == 0) {
+    // Level 0 files overlap each other
+    return split_keys;
+  }
+  InternalKey begin_storage, end_storage;
+  if (begin != nullptr) {
+    begin_storage.SetMinPossibleForUserKey(*begin);
+  }
+  if (end != nullptr) {
+    end_storage.SetMaxPossibleForUserKey(*end);
+  }
+  std::vector<FileMetaData*> files;
+  cfd->current()->storage_info()->GetOverlappingInputs(
+      level, begin == nullptr ? nullptr : &begin_storage,
+      end == nullptr ? nullptr : &end_storage, &files);
+  size_t files_per_range = (files.size() + max_ranges - 1) / max_ranges;
+  if (files_per_range == 0 || files_per_range == files.size()) {
+    return split_keys;
+  }
+  const Comparator* ucmp = cfd->user_comparator();
+  for (size_t i = files_per_range; i < files.size(); i += files_per_range) {
+    Slice range_end = files[i - 1]->largest.user_key();
+    Slice next_begin = files[i]->smallest.user_key();
+    // A user key shared by two files can't be split
+    if (ucmp->Compare(range_end, next_begin) < 0) {
+      split_keys.emplace_back(range_end.data(), range_end.size());
+      split_keys.emplace_back(next_begin.data(), next_begin.size());
+    }
+  }
+  return split_keys;
+}
+
 Status DBImpl::CompactFiles(const CompactionOptions& compact_options,
                             ColumnFamilyHandle* column_family,
                             const std::vector<std::string>& input_file_names,
@@ -1390,7 +1551,7 @@ Status DBImpl::RunManualCompaction(
     int output_level, uint32_t output_path_id, uint32_t max_subcompactions,
     const Slice* begin, const Slice* end,
     const chash_set<uint64_t>* files_being_compact, bool exclusive,
-    bool disallow_trivial_move) {
+    bool disallow_trivial_move, const void* parallel_group) {
   assert(input_level == ColumnFamilyData::kCompactAllLevels ||
          input_level >= 0);
 
@@ -1410,6 +1571,7 @@ Status DBImpl::RunManualCompaction(
   manual.incomplete = false;
   manual.exclusive = exclusive;
   manual.disallow_trivial_move = disallow_trivial_move;
+  manual.parallel_group = parallel_group;
   // For universal compaction, we enforce every manual compaction to compact
   // all files.
   if (begin == nullptr ||
@@ -1831,13 +1993,28 @@ void DBImpl::MaybeScheduleFlushOrCompaction() {
     // DB is being deleted; no more background compactions
     return;
   }
+  if (immutable_db_options_.background_coordinator != nullptr) {
+    static_cast<BackgroundCoordinatorImpl*>(
+        immutable_db_options_.background_coordinator.get())
+        ->SetBusy(this, unscheduled_compactions_ > 0 ||
+                            unscheduled_garbage_collections_ > 0 ||
+                            bg_compaction_scheduled_ > 0);
+  }
   auto bg_job_limits = GetBGJobLimits();
+  // While writes are delayed or stopped, flushes and compactions jump the
+  // queued jobs, e.g. the GC and the compactions of other DBs sharing the
+  // Env. The compaction picker then favors the L0 files behind the stall.
+  auto schedule = write_controller_.IsStopped() ||
+                          write_controller_.NeedsDelay()
+                      ? &Env::ScheduleUrgent
+                      : &Env::Schedule;
   bool is_flush_pool_empty =
       env_->GetBackgroundThreads(Env::Priority::HIGH) == 0;
   while (!is_flush_pool_empty && unscheduled_flushes_ > 0 &&
          bg_flush_scheduled_ < bg_job_limits.max_flushes) {
     bg_flush_scheduled_++;
-    env_->Schedule(&DBImpl::BGWorkFlush, this, Env::Priority::HIGH, this);
+    (env_->*schedule)(&DBImpl::BGWorkFlush, this, Env::Priority::HIGH, this,
+                      nullptr);
   }
 
   // special case -- if high-pri (flush) thread pool is empty, then schedule
@@ -1847,7 +2024,8 @@ void DBImpl::MaybeScheduleFlushOrCompaction() {
            bg_flush_scheduled_ + bg_compaction_scheduled_ <
                bg_job_limits.max_flushes) {
       bg_flush_scheduled_++;
-      env_->Schedule(&DBImpl::BGWorkFlush, this, Env::Priority::LOW, this);
+      (env_->*schedule)(&DBImpl::BGWorkFlush, this, Env::Priority::LOW, this,
+                        nullptr);
     }
   }
 
@@ -1907,8 +2085,8 @@ void DBImpl::MaybeScheduleFlushOrCompaction() {
     ca->prepicked_compaction = nullptr;
     bg_compaction_scheduled_++;
     unscheduled_compactions_--;
-    env_->Schedule(&DBImpl::BGWorkCompaction, ca, Env::Priority::LOW, this,
-                   &DBImpl::UnscheduleCallback);
+    (env_->*schedule)(&DBImpl::BGWorkCompaction, ca, Env::Priority::LOW, this,
+                      &DBImpl::UnscheduleCallback);
   }
 }
 
@@ -1919,11 +2097,22 @@ DBImpl::BGJobLimits DBImpl::GetBGJobLimits() const {
     need_speedup_compaction |=
         cfd->current()->storage_info()->has_space_amplification();
   }
-  return GetBGJobLimits(immutable_db_options_.max_background_flushes,
-                        mutable_db_options_.max_background_compactions,
-                        mutable_db_options_.max_background_garbage_collections,
-                        mutable_db_options_.max_background_jobs,
-                        need_speedup_compaction);
+  auto res =
+      GetBGJobLimits(immutable_db_options_.max_background_flushes,
+                     mutable_db_options_.max_background_compactions,
+                     mutable_db_options_.max_background_garbage_collections,
+                     mutable_db_options_.max_background_jobs,
+                     need_speedup_compaction);
+  if (immutable_db_options_.background_coordinator != nullptr) {
+    // The compactions and the GCs, which count as compactions too, are
+    // within the share of the DB
+    int share =
+        immutable_db_options_.background_coordinator->GetBackgroundJobsShare();
+    res.max_compactions = std::min(res.max_compactions, share);
+    res.max_garbage_collections =
+        std::min(res.max_garbage_collections, res.max_compactions);
+  }
+  return res;
 }
 
 DBImpl::BGJobLimits DBImpl::GetBGJobLimits(
@@ -1975,14 +2164,27 @@ void DBImpl::AddToCompactionQueue(ColumnFamilyData* cfd) {
   cfd->set_queued_for_compaction(true);
 }
 
+namespace {
+// The background jobs of a column family whose ResourceGroup is throttled
+// would hold a thread waiting, the others are picked first
+bool BackgroundThrottled(ColumnFamilyData* cfd) {
+  auto& group = cfd->ioptions()->resource_group;
+  return group != nullptr && group->IsThrottled(ResourceGroup::kBackground);
+}
+}  // namespace
+
 ColumnFamilyData* DBImpl::PopFirstFromCompactionQueue() {
   assert(!compaction_queue_.empty());
   auto max_iter = compaction_queue_.begin();
   double max_load = (*max_iter)->current()->GetCompactionLoad();
+  bool max_throttled = BackgroundThrottled(*max_iter);
   for (auto it = std::next(max_iter); it != compaction_queue_.end(); ++it) {
     double tmp_load = (*it)->current()->GetCompactionLoad();
-    if (max_load < tmp_load) {
+    bool tmp_throttled = BackgroundThrottled(*it);
+    if (max_throttled != tmp_throttled ? max_throttled
+                                       : max_load < tmp_load) {
       max_load = tmp_load;
+      max_throttled = tmp_throttled;
       max_iter = it;
     }
   }
@@ -2004,11 +2206,15 @@ ColumnFamilyData* DBImpl::PopFirstFromGarbageCollectionQueue() {
   assert(!garbage_collection_queue_.empty());
   auto max_iter = garbage_collection_queue_.begin();
   double max_load = (*max_iter)->current()->GetGarbageCollectionLoad();
+  bool max_throttled = BackgroundThrottled(*max_iter);
   for (auto it = std::next(max_iter); it != garbage_collection_queue_.end();
        ++it) {
     double tmp_load = (*it)->current()->GetGarbageCollectionLoad();
-    if (max_load < tmp_load) {
+    bool tmp_throttled = BackgroundThrottled(*it);
+    if (max_throttled != tmp_throttled ? max_throttled
+                                       : max_load < tmp_load) {
       max_load = tmp_load;
+      max_throttled = tmp_throttled;
       max_iter = it;
     }
   }
@@ -2241,6 +2447,8 @@ Status DBImpl::BackgroundFlush(bool* made_progress, JobContext* job_context,
 void DBImpl::BackgroundCallFlush() {
   bool made_progress = false;
   JobContext job_context(next_job_id_.fetch_add(1), true);
+  IOJobScope io_job_scope(IOJobKind::kFlush);
+  CpuJobScope cpu_job_scope(CpuJobKind::kFlush);
 
   TEST_SYNC_POINT("DBImpl::BackgroundCallFlush:start");
 
@@ -2340,6 +2548,8 @@ void DBImpl::BackgroundCallCompaction(PrepickedCompaction* prepicked_compaction,
                                       Env::Priority bg_thread_pri) {
   bool made_progress = false;
   JobContext job_context(next_job_id_.fetch_add(1), true);
+  IOJobScope io_job_scope(IOJobKind::kCompaction);
+  CpuJobScope cpu_job_scope(CpuJobKind::kCompaction);
   TEST_SYNC_POINT("BackgroundCallCompaction:0");
   LogBuffer log_buffer(InfoLogLevel::INFO_LEVEL,
                        immutable_db_options_.info_log.get());
@@ -2440,6 +2650,8 @@ void DBImpl::BackgroundCallCompaction(PrepickedCompaction* prepicked_compaction,
 void DBImpl::BackgroundCallZNSGarbageCollection() {
   bool made_progress = false;
   JobContext job_context(next_job_id_.fetch_add(1), true);
+  IOJobScope io_job_scope(IOJobKind::kGC);
+  CpuJobScope cpu_job_scope(CpuJobKind::kZoneMigration);
   TEST_SYNC_POINT("BackgroundCallZNSGarbageCollection:0");
   LogBuffer log_buffer(InfoLogLevel::INFO_LEVEL,
                        immutable_db_options_.info_log.get());
@@ -2531,6 +2743,8 @@ void DBImpl::BackgroundCallZNSGarbageCollection() {
 void DBImpl::BackgroundCallGarbageCollection() {
   bool made_progress = false;
   JobContext job_context(next_job_id_.fetch_add(1), true);
+  IOJobScope io_job_scope(IOJobKind::kGC);
+  CpuJobScope cpu_job_scope(CpuJobKind::kGC);
   TEST_SYNC_POINT("BackgroundCallGarbageCollection:0");
   LogBuffer log_buffer(InfoLogLevel::INFO_LEVEL,
                        immutable_db_options_.info_log.get());
@@ -2767,8 +2981,11 @@ Status DBImpl::BackgroundCompaction(bool* made_progress,
       TEST_SYNC_POINT("DBImpl::BackgroundCompaction():AfterPickCompaction");
 
       if (c != nullptr) {
-        bool enough_room = EnoughRoomForCompaction(
-            cfd, *(c->inputs()), &sfm_reserved_compact_space, log_buffer);
+        // Check the memory first, the SstFileManager reserves the room
+        bool enough_room =
+            EnoughMemoryForCompaction(c.get(), log_buffer) &&
+            EnoughRoomForCompaction(cfd, *(c->inputs()),
+                                    &sfm_reserved_compact_space, log_buffer);
 
         if (!enough_room) {
           // Then don't do the compaction
@@ -2816,6 +3033,63 @@ Status DBImpl::BackgroundCompaction(bool* made_progress,
     // Nothing to do
     ROCKS_LOG_BUFFER(log_buffer, "[%s] Compaction nothing to do",
                      cf_name.c_str());
+  } else if (c->compaction_reason() == CompactionReason::kPathMigration &&
+             c->input(0, 0)->prop.is_map_sst()) {
+    TEST_SYNC_POINT("DBImpl::BackgroundCompaction:MoveMapSst");
+    // A map SST is small, its dependencies keep their own paths
+    ThreadStatusUtil::SetColumnFamily(
+        c->column_family_data(), c->column_family_data()->ioptions()->env,
+        immutable_db_options_.enable_thread_tracking);
+    ThreadStatusUtil::SetThreadOperation(ThreadStatus::OP_COMPACTION);
+
+    compaction_job_stats.num_input_files = 1;
+
+    NotifyOnCompactionBegin(c->column_family_data(), c.get(), status,
+                            compaction_job_stats, job_context->job_id);
+
+    FileMetaData* f = c->input(0, 0);
+    const auto& cf_paths = c->immutable_cf_options()->cf_paths;
+    auto pending_outputs_inserted_elem =
+        CaptureCurrentFileNumberInPendingOutputs();
+    FileMetaData meta;
+    meta.fd = FileDescriptor(versions_->NewFileNumber(), c->output_path_id(),
+                             f->fd.GetFileSize(), f->fd.smallest_seqno,
+                             f->fd.largest_seqno);
+    meta.smallest = f->smallest;
+    meta.largest = f->largest;
+    meta.marked_for_compaction = f->marked_for_compaction;
+    meta.prop = f->prop;
+    meta.stats = f->stats;
+    mutex_.Unlock();
+    status = CopyFile(
+        env_, TableFileName(cf_paths, f->fd.GetNumber(), f->fd.GetPathId()),
+        TableFileName(cf_paths, meta.fd.GetNumber(), meta.fd.GetPathId()),
+        f->fd.GetFileSize(), immutable_db_options_.use_fsync);
+    mutex_.Lock();
+    if (status.ok()) {
+      c->edit()->DeleteFile(c->level(), f->fd.GetNumber());
+      c->edit()->AddFile(c->level(), meta);
+      c->AddOutputTableFileNumber(meta.fd.GetNumber());
+      status = versions_->LogAndApply(c->column_family_data(),
+                                      *c->mutable_cf_options(), c->edit(),
+                                      &mutex_, directories_.GetDbDir());
+    }
+    ReleaseFileNumberFromPendingOutputs(pending_outputs_inserted_elem);
+    if (status.ok()) {
+      InstallSuperVersionAndScheduleWork(
+          c->column_family_data(), &job_context->superversion_contexts[0],
+          *c->mutable_cf_options(), FlushReason::kAutoCompaction);
+      *made_progress = true;
+    }
+    ROCKS_LOG_BUFFER(log_buffer,
+                     "[%s] Moved map SST #%" PRIu64 " to path %" PRIu32
+                     " as #%" PRIu64 ": %s\n",
+                     c->column_family_data()->GetName().c_str(),
+                     f->fd.GetNumber(), meta.fd.GetPathId(),
+                     meta.fd.GetNumber(), status.ToString().c_str());
+
+    // Clear Instrument
+    ThreadStatusUtil::ResetThreadStatus();
   } else if (!trivial_move_disallowed && c->IsTrivialMove()) {
     TEST_SYNC_POINT("DBImpl::BackgroundCompaction:TrivialMove");
     // Instrument for event update
@@ -3098,6 +3372,12 @@ Status DBImpl::BackgroundGarbageCollection(bool* made_progress,
       TEST_SYNC_POINT(
           "DBImpl::BackgroundGarbageCollection():BeforePickGarbageCollection");
       c.reset(cfd->PickGarbageCollection(*mutable_cf_options, log_buffer));
+      if (c == nullptr) {
+        c.reset(cfd->PickBlobDefragment(*mutable_cf_options, log_buffer));
+      }
+      if (c == nullptr) {
+        c.reset(cfd->PickBlobPathMigration(*mutable_cf_options, log_buffer));
+      }
       TEST_SYNC_POINT(
           "DBImpl::BackgroundGarbageCollection():AfterPickGarbageCollection");
 
@@ -3163,7 +3443,9 @@ Status DBImpl::BackgroundGarbageCollection(bool* made_progress,
         &event_logger_, c->mutable_cf_options()->paranoid_file_checks,
         c->mutable_cf_options()->report_bg_io_stats, dbname_,
         &garbage_collection_job_stats);
-    garbage_collection_job.Prepare(0 /* sub_compaction_slots */);
+    int sub_compaction_scheduled = garbage_collection_job.Prepare(
+        GetSubCompactionSlots(c->max_subcompactions()));
+    bg_compaction_scheduled_ += sub_compaction_scheduled;
     NotifyOnCompactionBegin(c->column_family_data(), c.get(), status,
                             garbage_collection_job_stats, job_context->job_id);
 
@@ -3171,6 +3453,7 @@ Status DBImpl::BackgroundGarbageCollection(bool* made_progress,
     garbage_collection_job.Run();
     TEST_SYNC_POINT("DBImpl::BackgroundGarbageCollection:NonTrivial:AfterRun");
     mutex_.Lock();
+    bg_compaction_scheduled_ -= sub_compaction_scheduled;
     status = garbage_collection_job.Install(*c->mutable_cf_options());
     if (status.ok()) {
       InstallSuperVersionAndScheduleWork(
@@ -3285,6 +3568,12 @@ Status DBImpl::BackgroundZNSGarbageCollection(bool* made_progress,
       // PickZNSGarbageCollection() call, which designates all blob files
       // located in a specific zone to be merged
       c.reset(cfd->PickZNSGarbageCollection(*mutable_cf_options, log_buffer));
+      if (c == nullptr) {
+        c.reset(cfd->PickBlobDefragment(*mutable_cf_options, log_buffer));
+      }
+      if (c == nullptr) {
+        c.reset(cfd->PickBlobPathMigration(*mutable_cf_options, log_buffer));
+      }
       TEST_SYNC_POINT(
           "DBImpl::BackgroundZNSGarbageCollection():"
           "AfterPickGarbageCollection");
@@ -3347,7 +3636,13 @@ Status DBImpl::BackgroundZNSGarbageCollection(bool* made_progress,
         &event_logger_, c->mutable_cf_options()->paranoid_file_checks,
         c->mutable_cf_options()->report_bg_io_stats, dbname_,
         &garbage_collection_job_stats);
-    garbage_collection_job.Prepare(0);
+    // The zones of a ZNS GC are reclaimed by a single job, a defragmentation
+    // merges its key ranges in parallel
+    int sub_compaction_scheduled = garbage_collection_job.Prepare(
+        c->sub_compaction_type() == kBlobDefragment
+            ? GetSubCompactionSlots(c->max_subcompactions())
+            : 0);
+    bg_compaction_scheduled_ += sub_compaction_scheduled;
     NotifyOnCompactionBegin(c->column_family_data(), c.get(), status,
                             garbage_collection_job_stats, job_context->job_id);
 
@@ -3356,6 +3651,7 @@ Status DBImpl::BackgroundZNSGarbageCollection(bool* made_progress,
     TEST_SYNC_POINT(
         "DBImpl::BackgroundZNSGarbageCollection:NonTrivial:AfterRun");
     mutex_.Lock();
+    bg_compaction_scheduled_ -= sub_compaction_scheduled;
     ZnsLog(kCyan, "DBImpl::BackgroundZNSGarbageCollection:NonTrivial:AfterRun");
     status = garbage_collection_job.Install(*c->mutable_cf_options());
     if (status.ok()) {
@@ -3502,6 +3798,11 @@ bool DBImpl::HasExclusiveManualCompaction() {
 }
 
 bool DBImpl::MCOverlap(ManualCompactionState* m, ManualCompactionState* m1) {
+  if (m->parallel_group != nullptr &&
+      m->parallel_group == m1->parallel_group) {
+    // Disjoint ranges of the same CompactRange()
+    return false;
+  }
   if ((m->exclusive) || (m1->exclusive)) {
     return true;
   }
@@ -3534,9 +3835,13 @@ void DBImpl::InstallSuperVersionAndScheduleWork(
   // Update max_total_in_memory_state_
   size_t old_memtable_size = 0;
   auto* old_sv = cfd->GetSuperVersion();
+  Version* old_version = nullptr;
+  auto old_stall_condition = WriteStallCondition::kNormal;
   if (old_sv) {
     old_memtable_size = old_sv->mutable_cf_options.write_buffer_size *
                         old_sv->mutable_cf_options.max_write_buffer_number;
+    old_version = old_sv->current;
+    old_stall_condition = old_sv->write_stall_condition;
   }
 
   // this branch is unlikely to step in
@@ -3545,6 +3850,15 @@ void DBImpl::InstallSuperVersionAndScheduleWork(
   }
   cfd->InstallSuperVersion(sv_context, &mutex_, mutable_cf_options);
 
+  auto* new_sv = cfd->GetSuperVersion();
+  if (old_sv != nullptr && new_sv->current != old_version) {
+    SignalPeriodicWork(PeriodicWorkSignal::kTablesWritten);
+  }
+  if (new_sv->write_stall_condition != WriteStallCondition::kNormal &&
+      old_stall_condition == WriteStallCondition::kNormal) {
+    SignalPeriodicWork(PeriodicWorkSignal::kWriteStall);
+  }
+
   // Whenever we install new SuperVersion, we might need to issue new flushes or
   // compactions.
   SchedulePendingCompaction(cfd);
@@ -18,6 +18,7 @@
 
 #include "db/event_helpers.h"
 #include "db/memtable_list.h"
+#include "db/periodic_work_scheduler.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/file_util.h"
 #include "util/sst_file_manager_impl.h"
@@ -267,6 +268,21 @@ void DBImpl::FindObsoleteFiles(JobContext* job_context, bool force,
     }
     // Current log cannot be obsolete.
     assert(!logs_.empty());
+    while (!wal_streams_.empty() &&
+           wal_streams_.front().number < min_log_number) {
+      if (wal_stream_syncs_ > 0) {
+        log_sync_cv_.Wait();
+        continue;
+      }
+      auto& stream = wal_streams_.front();
+      job_context->log_delete_files.push_back(stream.number);
+      job_context->files_grabbed_for_purge.emplace_back(stream.number);
+      logs_to_free_.push_back(stream.ReleaseWriter());
+      {
+        InstrumentedMutexLock wl(&log_write_mutex_);
+        wal_streams_.pop_front();
+      }
+    }
   }
 
   // We're just cleaning up for DB::Write().
@@ -387,6 +403,11 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
       candidate_files.emplace_back(JobContext::CandidateFileInfo{
           LogFileName(kDumbDbName, file_num),
           state.PushPath(immutable_db_options_.wal_dir)});
+      if (immutable_db_options_.value_log_threshold > 0) {
+        candidate_files.emplace_back(JobContext::CandidateFileInfo{
+            ValueLogFileName(kDumbDbName, file_num),
+            state.PushPath(immutable_db_options_.wal_dir)});
+      }
     }
   }
   for (auto filename : state.manifest_delete_files) {
@@ -419,6 +440,7 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
   // candidate_files.
   uint64_t optsfile_num1 = std::numeric_limits<uint64_t>::min();
   uint64_t optsfile_num2 = std::numeric_limits<uint64_t>::min();
+  size_t num_tables_deleted = 0;
   for (size_t i = 0; i < candidate_files.size();) {
     const auto& candidate_file = candidate_files[i];
     const std::string& fname = candidate_file.file_name;
@@ -462,6 +484,11 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
                 (log_recycle_files_set.find(number) !=
                  log_recycle_files_set.end()));
         break;
+      case kValueLogFile:
+        // Deleted with its WAL, never recycled nor archived
+        keep = (number >= state.log_number) ||
+               (number == state.prev_log_number);
+        break;
       case kDescriptorFile:
         // Keep my manifest file, and any newer incarnations'
         // (can happen during manifest roll)
@@ -506,6 +533,7 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
       case kDBLockFile:
       case kIdentityFile:
       case kMetaDatabase:
+      case kHotBlocksFile:
         keep = true;
         break;
     }
@@ -522,8 +550,9 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
       fname = MakeTableFileName(*candidate_file.file_path, number);
       dir_to_sync = *candidate_file.file_path;
     } else {
-      dir_to_sync =
-          (type == kLogFile) ? immutable_db_options_.wal_dir : dbname_;
+      dir_to_sync = (type == kLogFile || type == kValueLogFile)
+                        ? immutable_db_options_.wal_dir
+                        : dbname_;
       fname = dir_to_sync +
               ((!dir_to_sync.empty() && dir_to_sync.back() == '/') ||
                        (!to_delete.empty() && to_delete.front() == '/')
@@ -562,6 +591,9 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
       SchedulePendingPurge(fname, dir_to_sync, type, number, state.job_id);
     } else {
       DeleteObsoleteFileImpl(state.job_id, fname, dir_to_sync, type, number);
+      if (type == kTableFile) {
+        ++num_tables_deleted;
+      }
     }
   }
 
@@ -612,6 +644,9 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
 #endif  // ROCKSDB_LITE
   LogFlush(immutable_db_options_.info_log);
   InstrumentedMutexLock l(&mutex_);
+  if (num_tables_deleted > 0) {
+    SignalPeriodicWork(PeriodicWorkSignal::kTablesDeleted);
+  }
   if (state.doing_the_full_scan) {
     delete_obsolete_files_lock_ = false;
   }
@@ -100,6 +100,50 @@ TEST_F(DBImplGCTTL_Test, BlockBasedTableTest) {
   run();
   read();
 }
+
+TEST_F(DBImplGCTTL_Test, DropExpiredFiles) {
+  init();
+  options.ttl_drop_expired_files = true;
+  options.env = mock_env_.get();
+  SetUp();
+  size_t dropped = 0;
+  SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::DropExpiredTtlFiles:Dropped", [&](void* arg) {
+        dropped += reinterpret_cast<std::unordered_set<FileMetaData*>*>(arg)
+                       ->size();
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+  Reopen(options);
+
+  // Two files expire at ttl, the third one of another key range later
+  auto put = [&](const std::string& prefix, uint64_t ttl_time_point) {
+    char ts_string[8];
+    EncodeFixed64(ts_string, ttl_time_point);
+    for (int j = 0; j < 100; j++) {
+      std::string key = prefix;
+      std::string value = "value";
+      AppendNumberTo(&key, j);
+      AppendNumberTo(&value, j);
+      value.append(ts_string, 8);
+      ASSERT_OK(dbfull()->Put(WriteOptions(), key, value));
+    }
+    ASSERT_OK(dbfull()->Flush(FlushOptions()));
+  };
+  put("key", ttl);
+  put("key", ttl);
+  put("other", ttl * 5);
+  ASSERT_EQ("3", FilesPerLevel());
+
+  dbfull()->TEST_WaitForStatsDumpRun(
+      [&] { mock_env_->set_current_time(ttl); });
+  ASSERT_EQ(2U, dropped);
+  ASSERT_EQ("1", FilesPerLevel());
+  ASSERT_EQ("NOT_FOUND", Get("key1"));
+  ASSERT_NE("NOT_FOUND", Get("other1"));
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
 #ifdef TERARK_ZIP
 TEST_F(DBImplGCTTL_Test, TerarkTableTest) {
   init();
@@ -13,6 +13,8 @@
 #endif
 #include <inttypes.h>
 
+#include <functional>
+
 #include "db/builder.h"
 #include "db/error_handler.h"
 #include "db/map_builder.h"
@@ -21,7 +23,10 @@
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/wal_filter.h"
 #include "table/block_based_table_factory.h"
+#include "util/background_coordinator_impl.h"
 #include "util/c_style_callback.h"
+#include "util/compression.h"
+#include "util/mutexlock.h"
 #include "util/rate_limiter.h"
 #include "util/sst_file_manager_impl.h"
 #include "util/string_util.h"
@@ -33,6 +38,124 @@
 
 namespace TERARKDB_NAMESPACE {
 
+namespace {
+// A group of WAL records inserted at once ends at either
+const size_t kRecoveryGroupBatches = 256;
+const size_t kRecoveryGroupBytes = 4 << 20;
+
+// A record inserted by RecoveryInsertPool, with the results of the insert
+struct RecoveredBatch {
+  WriteBatch batch;
+  uint64_t log_number = 0;
+  size_t record_size = 0;
+  log::Reader::Reporter* reporter = nullptr;
+  Status status;
+  SequenceNumber next_sequence = 0;
+  bool has_valid_writes = false;
+};
+
+// Checks a record can be inserted concurrently with others: it has only
+// puts and deletions, and decodes
+class RecoveryBatchChecker : public WriteBatch::Handler {
+ public:
+  Status PutCF(uint32_t, const Slice&, const Slice&) override {
+    return Status::OK();
+  }
+  Status DeleteCF(uint32_t, const Slice&) override { return Status::OK(); }
+  Status SingleDeleteCF(uint32_t, const Slice&) override {
+    return Status::OK();
+  }
+  Status DeleteRangeCF(uint32_t, const Slice&, const Slice&) override {
+    return Status::OK();
+  }
+  // Anything else is inserted alone
+  Status MergeCF(uint32_t, const Slice&, const Slice&) override {
+    return Status::NotSupported();
+  }
+  Status PutValueIndexCF(uint32_t, const Slice&, const Slice&) override {
+    return Status::NotSupported();
+  }
+  Status MarkBeginPrepare(bool) override { return Status::NotSupported(); }
+  Status MarkEndPrepare(const Slice&) override {
+    return Status::NotSupported();
+  }
+  Status MarkNoop(bool) override { return Status::NotSupported(); }
+  Status MarkRollback(const Slice&) override { return Status::NotSupported(); }
+  Status MarkCommit(const Slice&) override { return Status::NotSupported(); }
+};
+
+// Inserts groups of recovered records on its threads, one group at a time
+class RecoveryInsertPool {
+ public:
+  RecoveryInsertPool(size_t num_threads,
+                     std::function<void(RecoveredBatch*)> insert)
+      : insert_(std::move(insert)), cv_(&mutex_) {
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { Run(); });
+    }
+  }
+
+  ~RecoveryInsertPool() {
+    Wait();
+    {
+      MutexLock l(&mutex_);
+      stop_ = true;
+      cv_.SignalAll();
+    }
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Start inserting `group`, which is kept until Wait()
+  void Start(std::vector<RecoveredBatch>* group) {
+    MutexLock l(&mutex_);
+    assert(group_ == nullptr);
+    group_ = group;
+    next_ = 0;
+    done_ = 0;
+    cv_.SignalAll();
+  }
+
+  void Wait() {
+    MutexLock l(&mutex_);
+    while (group_ != nullptr && done_ < group_->size()) {
+      cv_.Wait();
+    }
+    group_ = nullptr;
+  }
+
+ private:
+  void Run() {
+    MutexLock l(&mutex_);
+    while (true) {
+      if (group_ != nullptr && next_ < group_->size()) {
+        RecoveredBatch* batch = &(*group_)[next_++];
+        mutex_.Unlock();
+        insert_(batch);
+        mutex_.Lock();
+        if (++done_ == group_->size()) {
+          cv_.SignalAll();
+        }
+      } else if (stop_) {
+        break;
+      } else {
+        cv_.Wait();
+      }
+    }
+  }
+
+  const std::function<void(RecoveredBatch*)> insert_;
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::vector<RecoveredBatch>* group_ = nullptr;
+  size_t next_ = 0;
+  size_t done_ = 0;
+  bool stop_ = false;
+  std::vector<port::Thread> threads_;
+};
+}  // namespace
+
 Options SanitizeOptions(const std::string& dbname, const Options& src) {
   auto db_options = SanitizeOptions(dbname, DBOptions(src));
   ImmutableDBOptions immutable_db_options(db_options);
@@ -53,6 +176,10 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
     ClipToRange(&result.max_open_files, 20, max_max_open_files);
   }
 
+  if (result.partition_num == 0) {
+    result.partition_num = 1;
+  }
+
   if (result.info_log == nullptr) {
     Status s = CreateLoggerFromOptions(dbname, result, &result.info_log);
     if (!s.ok()) {
@@ -74,6 +201,19 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
   result.env->IncBackgroundThreadsIfNeeded(bg_job_limits.max_flushes,
                                            Env::Priority::HIGH);
 
+  if (result.background_coordinator != nullptr) {
+    auto coordinator = static_cast<BackgroundCoordinatorImpl*>(
+        result.background_coordinator.get());
+    if (result.rate_limiter == nullptr) {
+      result.rate_limiter = coordinator->rate_limiter();
+    }
+    if (result.table_cache_memory_budget == 0) {
+      // The coordinator resizes the table cache to the share of this DB
+      result.table_cache_memory_budget =
+          coordinator->table_cache_memory_budget();
+    }
+  }
+
   if (result.rate_limiter.get() != nullptr) {
     if (result.bytes_per_sync == 0) {
       result.bytes_per_sync = 1024 * 1024;
@@ -108,6 +248,23 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
     result.wal_recovery_mode = WALRecoveryMode::kTolerateCorruptedTailRecords;
   }
 
+  if ((result.wal_compression != kLZ4Compression &&
+       result.wal_compression != kZSTD) ||
+      !CompressionTypeSupported(result.wal_compression)) {
+    result.wal_compression = kNoCompression;
+  }
+
+  if (result.wal_streams == 0 || result.enable_pipelined_write ||
+      result.two_write_queues || result.manual_wal_flush || result.allow_2pc ||
+      result.recycle_log_file_num) {
+    result.wal_streams = 1;
+  }
+  if (result.wal_streams > 1) {
+    // The secondary streams of a WAL generation take the file numbers right
+    // after its first stream, pre-created logs would be numbered before them
+    result.prepare_log_writer_num = 0;
+  }
+
   if (result.recycle_log_file_num && result.prepare_log_writer_num) {
     result.recycle_log_file_num =
         std::max(result.prepare_log_writer_num, result.recycle_log_file_num);
@@ -235,6 +392,13 @@ static Status ValidateOptions(
         "be disabled. ");
   }
 
+  if (db_options.allow_mmap_writes && db_options.use_direct_io_for_wal) {
+    return Status::NotSupported(
+        "If memory mapped writes (allow_mmap_writes) are enabled "
+        "then direct I/O WAL writes (use_direct_io_for_wal) must be "
+        "disabled. ");
+  }
+
   if (db_options.keep_log_file_num == 0) {
     return Status::InvalidArgument("keep_log_file_num must be greater than 0");
   }
@@ -703,9 +867,24 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
   uint64_t corrupted_log_number = kMaxSequenceNumber;
   std::vector<SequenceNumber> log_seqs;
   log_seqs.resize(log_numbers.size(), kMaxSequenceNumber);
+
+  // The records of all the log files are replayed merged by sequence. With
+  // DBOptions::wal_streams the files of one WAL generation were written side
+  // by side, otherwise each file starts after the previous one ends and they
+  // are replayed one after another.
+  struct LogFile {
+    size_t index;  // into log_numbers and log_seqs
+    uint64_t log_number;
+    std::string fname;
+    Status status;
+    LogReporter reporter;
+    std::unique_ptr<log::Reader> reader;
+    std::string scratch;
+    WriteBatch batch;  // the next record
+  };
+  std::vector<std::unique_ptr<LogFile>> log_files;
   for (size_t log_it = 0; log_it < log_numbers.size(); ++log_it) {
     uint64_t log_number = log_numbers[log_it];
-    uint64_t& log_seq = log_seqs[log_it];
     if (log_number < versions_->min_log_number_to_keep_2pc()) {
       ROCKS_LOG_INFO(immutable_db_options_.info_log,
                      "Skipping log #%" PRIu64
@@ -723,18 +902,6 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
     ROCKS_LOG_INFO(immutable_db_options_.info_log,
                    "Recovering log #%" PRIu64 " mode %d", log_number,
                    int(immutable_db_options_.wal_recovery_mode));
-    auto logFileDropped = [this, &fname]() {
-      uint64_t bytes;
-      if (env_->GetFileSize(fname, &bytes).ok()) {
-        auto info_log = immutable_db_options_.info_log.get();
-        ROCKS_LOG_WARN(info_log, "%s: dropping %d bytes", fname.c_str(),
-                       static_cast<int>(bytes));
-      }
-    };
-    if (stop_replay_by_wal_filter) {
-      logFileDropped();
-      continue;
-    }
 
     std::unique_ptr<SequentialFileReader> file_reader;
     {
@@ -754,162 +921,368 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
       file_reader.reset(new SequentialFileReader(std::move(file), fname));
     }
 
+    std::unique_ptr<LogFile> log_file(new LogFile);
+    log_file->index = log_it;
+    log_file->log_number = log_number;
+    log_file->fname = fname;
     // Create the log reader.
-    LogReporter reporter;
+    LogReporter& reporter = log_file->reporter;
     reporter.env = env_;
     reporter.info_log = immutable_db_options_.info_log.get();
-    reporter.fname = fname.c_str();
+    reporter.fname = log_file->fname.c_str();
     if (!immutable_db_options_.paranoid_checks ||
         immutable_db_options_.wal_recovery_mode ==
             WALRecoveryMode::kSkipAnyCorruptedRecords) {
       reporter.status = nullptr;
     } else {
-      reporter.status = &status;
+      reporter.status = &log_file->status;
     }
     // We intentially make log::Reader do checksumming even if
     // paranoid_checks==false so that corruptions cause entire commits
     // to be skipped instead of propagating bad information (like overly
     // large sequence numbers).
-    log::Reader reader(immutable_db_options_.info_log, std::move(file_reader),
-                       &reporter, true /*checksum*/, log_number,
-                       false /* retry_after_eof */);
-
-    // Determine if we should tolerate incomplete records at the tail end of the
-    // Read all the records and add to a memtable
-    std::string scratch;
+    log_file->reader.reset(new log::Reader(
+        immutable_db_options_.info_log, std::move(file_reader), &reporter,
+        true /*checksum*/, log_number, false /* retry_after_eof */));
+    log_files.emplace_back(std::move(log_file));
+  }
+
+  auto logFileDropped = [this](const LogFile* log_file) {
+    uint64_t bytes;
+    if (env_->GetFileSize(log_file->fname, &bytes).ok()) {
+      auto info_log = immutable_db_options_.info_log.get();
+      ROCKS_LOG_WARN(info_log, "%s: dropping %d bytes",
+                     log_file->fname.c_str(), static_cast<int>(bytes));
+    }
+  };
+  // Read the next record of the file into its batch, false at the end of
+  // the file or on an error
+  auto readRecord = [this](LogFile* log_file) {
     Slice record;
-    WriteBatch batch;
-
-    while (!stop_replay_by_wal_filter &&
-           reader.ReadRecord(&record, &scratch,
-                             immutable_db_options_.wal_recovery_mode) &&
-           status.ok()) {
+    while (log_file->reader->ReadRecord(
+               &record, &log_file->scratch,
+               immutable_db_options_.wal_recovery_mode) &&
+           log_file->status.ok()) {
       if (record.size() < WriteBatchInternal::kHeader) {
-        reporter.Corruption(record.size(),
-                            Status::Corruption("log record too small"));
+        log_file->reporter.Corruption(
+            record.size(), Status::Corruption("log record too small"));
         continue;
       }
-      WriteBatchInternal::SetContents(&batch, record);
-      SequenceNumber sequence = WriteBatchInternal::Sequence(&batch);
-
-      if (log_seq == kMaxSequenceNumber) {
-        assert(sequence > 0);
-        log_seq = std::max<SequenceNumber>(sequence, 1) - 1;
+      WriteBatchInternal::SetContents(&log_file->batch, record);
+      return true;
+    }
+    return false;
+  };
+  // With wal_recovery_threads, the records are inserted by the pool in
+  // groups. A group is inserted while the next one is read, and the
+  // memtables it fills are switched before the next group starts, then
+  // flushed while it is inserted.
+  std::vector<RecoveredBatch> reading_group;
+  size_t reading_group_bytes = 0;
+  std::vector<RecoveredBatch> inserting_group;
+  std::unique_ptr<RecoveryInsertPool> insert_pool;
+  if (immutable_db_options_.wal_recovery_threads > 1 &&
+      immutable_db_options_.allow_concurrent_memtable_write &&
+      !seq_per_batch_) {
+    insert_pool.reset(new RecoveryInsertPool(
+        immutable_db_options_.wal_recovery_threads,
+        [this](RecoveredBatch* recovered) {
+          ColumnFamilyMemTablesImpl memtables(versions_->GetColumnFamilySet());
+          recovered->status = WriteBatchInternal::InsertInto(
+              &recovered->batch, &memtables, &flush_scheduler_, true,
+              recovered->log_number, this,
+              true /* concurrent_memtable_writes */, &recovered->next_sequence,
+              &recovered->has_valid_writes, seq_per_batch_, batch_per_txn_);
+        }));
+  }
+  std::vector<std::pair<ColumnFamilyData*, MemTable*>> switched_memtables;
+  // Wait for the group being inserted, and switch the memtables it filled
+  auto waitInsertingGroup = [&] {
+    if (inserting_group.empty()) {
+      return;
+    }
+    insert_pool->Wait();
+    bool has_valid_writes = false;
+    for (auto& recovered : inserting_group) {
+      MaybeIgnoreError(&recovered.status);
+      if (!recovered.status.ok()) {
+        // The same as a record failing on its own, the next records of its
+        // file already read are still replayed
+        recovered.reporter->Corruption(recovered.record_size,
+                                       recovered.status);
       }
+      has_valid_writes |= recovered.has_valid_writes;
+    }
+    *next_sequence = inserting_group.back().next_sequence;
+    inserting_group.clear();
+    ColumnFamilyData* cfd;
+    while (has_valid_writes && !read_only &&
+           (cfd = flush_scheduler_.TakeNextColumnFamily()) != nullptr) {
+      cfd->Unref();
+      MemTable* mem = cfd->mem();
+      mem->Ref();
+      cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
+                             /* needs_dup_key_check */ false,
+                             *next_sequence);
+      switched_memtables.emplace_back(cfd, mem);
+    }
+  };
+  auto flushSwitchedMemtables = [&] {
+    Status s;
+    for (auto& cfd_mem : switched_memtables) {
+      if (s.ok()) {
+        auto iter = version_edits.find(cfd_mem.first->GetID());
+        assert(iter != version_edits.end());
+        s = WriteLevel0TableForRecovery(job_id, cfd_mem.first, cfd_mem.second,
+                                        &iter->second);
+        flushed = true;
+      }
+      delete cfd_mem.second->Unref();
+    }
+    switched_memtables.clear();
+    return s;
+  };
+  // Start inserting the group read, and flush the memtables filled before
+  auto insertReadingGroup = [&] {
+    waitInsertingGroup();
+    if (!reading_group.empty()) {
+      inserting_group.swap(reading_group);
+      reading_group_bytes = 0;
+      insert_pool->Start(&inserting_group);
+    }
+    return flushSwitchedMemtables();
+  };
+  // Insert all the records read, before one inserted alone
+  auto drainGroups = [&] {
+    Status s = insertReadingGroup();
+    waitInsertingGroup();
+    Status flush_status = flushSwitchedMemtables();
+    return s.ok() ? flush_status : s;
+  };
 
+  // Called once a file has no more records to replay
+  auto finishLogFile = [&](LogFile* log_file) {
+    if (insert_pool != nullptr) {
+      Status drain_status = drainGroups();
+      if (!drain_status.ok()) {
+        return drain_status;
+      }
+    }
+    Status s = log_file->status;
+    if (!s.ok()) {
+      if (s.IsNotSupported()) {
+        // We should not treat NotSupported as corruption. It is rather a clear
+        // sign that we are processing a WAL that is produced by an incompatible
+        // version of the code.
+        return s;
+      }
       if (immutable_db_options_.wal_recovery_mode ==
-          WALRecoveryMode::kPointInTimeRecovery) {
-        // In point-in-time recovery mode, if sequence id of log files are
-        // consecutive, we continue recovery despite corruption. This could
-        // happen when we open and write to a corrupted DB, where sequence id
-        // will start from the last sequence id we recovered.
-        if (sequence == *next_sequence) {
-          stop_replay_for_corruption = false;
-        }
-        if (stop_replay_for_corruption) {
-          logFileDropped();
-          break;
-        }
+          WALRecoveryMode::kSkipAnyCorruptedRecords) {
+        // We should ignore all errors unconditionally
+        s = Status::OK();
+      } else if (immutable_db_options_.wal_recovery_mode ==
+                 WALRecoveryMode::kPointInTimeRecovery) {
+        // We should ignore the error but not continue replaying
+        s = Status::OK();
+        stop_replay_for_corruption = true;
+        corrupted_log_number = log_file->log_number;
+        ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                       "Point in time recovered to log #%" PRIu64
+                       " seq #%" PRIu64,
+                       log_file->log_number, *next_sequence);
+      } else {
+        assert(immutable_db_options_.wal_recovery_mode ==
+                   WALRecoveryMode::kTolerateCorruptedTailRecords ||
+               immutable_db_options_.wal_recovery_mode ==
+                   WALRecoveryMode::kAbsoluteConsistency);
+        return s;
       }
+    }
 
+    flush_scheduler_.Clear();
+    auto last_sequence = *next_sequence - 1;
+    if ((*next_sequence != kMaxSequenceNumber) &&
+        (versions_->LastSequence() <= last_sequence)) {
+      versions_->SetLastAllocatedSequence(last_sequence);
+      versions_->SetLastPublishedSequence(last_sequence);
+      versions_->SetLastSequence(last_sequence);
+    }
+    return s;
+  };
+
+  // Files that still have records to replay
+  std::vector<LogFile*> pending;
+  for (auto& log_file : log_files) {
+    if (readRecord(log_file.get())) {
+      pending.push_back(log_file.get());
+    } else {
+      status = finishLogFile(log_file.get());
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  while (!pending.empty()) {
+    // Few files are replayed at a time, a linear scan finds the next record
+    size_t next = 0;
+    for (size_t i = 1; i < pending.size(); ++i) {
+      if (WriteBatchInternal::Sequence(&pending[i]->batch) <
+          WriteBatchInternal::Sequence(&pending[next]->batch)) {
+        next = i;
+      }
+    }
+    LogFile* log_file = pending[next];
+    uint64_t log_number = log_file->log_number;
+    uint64_t& log_seq = log_seqs[log_file->index];
+    WriteBatch& batch = log_file->batch;
+    size_t record_size = WriteBatchInternal::ByteSize(&batch);
+    SequenceNumber sequence = WriteBatchInternal::Sequence(&batch);
+    bool drop_log_file = false;
+
+    if (log_seq == kMaxSequenceNumber) {
+      assert(sequence > 0);
+      log_seq = std::max<SequenceNumber>(sequence, 1) - 1;
+    }
+
+    if (immutable_db_options_.wal_recovery_mode ==
+        WALRecoveryMode::kPointInTimeRecovery) {
+      // In point-in-time recovery mode, if sequence id of log files are
+      // consecutive, we continue recovery despite corruption. This could
+      // happen when we open and write to a corrupted DB, where sequence id
+      // will start from the last sequence id we recovered.
+      if (sequence == *next_sequence) {
+        stop_replay_for_corruption = false;
+      }
+      if (stop_replay_for_corruption) {
+        logFileDropped(log_file);
+        drop_log_file = true;
+      }
+    }
+
+    bool skip_record = drop_log_file;
 #ifndef ROCKSDB_LITE
-      if (immutable_db_options_.wal_filter != nullptr) {
-        WriteBatch new_batch;
-        bool batch_changed = false;
+    if (!skip_record && immutable_db_options_.wal_filter != nullptr) {
+      WriteBatch new_batch;
+      bool batch_changed = false;
 
-        WalFilter::WalProcessingOption wal_processing_option =
-            immutable_db_options_.wal_filter->LogRecordFound(
-                log_number, fname, batch, &new_batch, &batch_changed);
+      WalFilter::WalProcessingOption wal_processing_option =
+          immutable_db_options_.wal_filter->LogRecordFound(
+              log_number, log_file->fname, batch, &new_batch, &batch_changed);
 
-        switch (wal_processing_option) {
-          case WalFilter::WalProcessingOption::kContinueProcessing:
-            // do nothing, proceeed normally
-            break;
-          case WalFilter::WalProcessingOption::kIgnoreCurrentRecord:
-            // skip current record
-            continue;
-          case WalFilter::WalProcessingOption::kStopReplay:
-            // skip current record and stop replay
-            stop_replay_by_wal_filter = true;
-            continue;
-          case WalFilter::WalProcessingOption::kCorruptedRecord: {
-            status =
-                Status::Corruption("Corruption reported by Wal Filter ",
-                                   immutable_db_options_.wal_filter->Name());
-            MaybeIgnoreError(&status);
-            if (!status.ok()) {
-              reporter.Corruption(record.size(), status);
-              continue;
-            }
-            break;
-          }
-          default: {
-            assert(false);  // unhandled case
-            status = Status::NotSupported(
-                "Unknown WalProcessingOption returned"
-                " by Wal Filter ",
-                immutable_db_options_.wal_filter->Name());
-            MaybeIgnoreError(&status);
-            if (!status.ok()) {
-              return status;
-            } else {
-              // Ignore the error with current record processing.
-              continue;
-            }
+      switch (wal_processing_option) {
+        case WalFilter::WalProcessingOption::kContinueProcessing:
+          // do nothing, proceeed normally
+          break;
+        case WalFilter::WalProcessingOption::kIgnoreCurrentRecord:
+          // skip current record
+          skip_record = true;
+          break;
+        case WalFilter::WalProcessingOption::kStopReplay:
+          // skip current record and stop replay
+          stop_replay_by_wal_filter = true;
+          skip_record = true;
+          break;
+        case WalFilter::WalProcessingOption::kCorruptedRecord: {
+          Status s =
+              Status::Corruption("Corruption reported by Wal Filter ",
+                                 immutable_db_options_.wal_filter->Name());
+          MaybeIgnoreError(&s);
+          if (!s.ok()) {
+            log_file->reporter.Corruption(record_size, s);
+            skip_record = true;
           }
+          break;
         }
-
-        if (batch_changed) {
-          // Make sure that the count in the new batch is
-          // within the orignal count.
-          int new_count = WriteBatchInternal::Count(&new_batch);
-          int original_count = WriteBatchInternal::Count(&batch);
-          if (new_count > original_count) {
-            ROCKS_LOG_FATAL(
-                immutable_db_options_.info_log,
-                "Recovering log #%" PRIu64
-                " mode %d log filter %s returned "
-                "more records (%d) than original (%d) which is not allowed. "
-                "Aborting recovery.",
-                log_number, int(immutable_db_options_.wal_recovery_mode),
-                immutable_db_options_.wal_filter->Name(), new_count,
-                original_count);
-            status = Status::NotSupported(
-                "More than original # of records "
-                "returned by Wal Filter ",
-                immutable_db_options_.wal_filter->Name());
+        default: {
+          assert(false);  // unhandled case
+          status = Status::NotSupported(
+              "Unknown WalProcessingOption returned"
+              " by Wal Filter ",
+              immutable_db_options_.wal_filter->Name());
+          MaybeIgnoreError(&status);
+          if (!status.ok()) {
             return status;
+          } else {
+            // Ignore the error with current record processing.
+            skip_record = true;
           }
-          // Set the same sequence number in the new_batch
-          // as the original batch.
-          WriteBatchInternal::SetSequence(&new_batch,
-                                          WriteBatchInternal::Sequence(&batch));
-          batch = new_batch;
         }
       }
+
+      if (!skip_record && batch_changed) {
+        // Make sure that the count in the new batch is
+        // within the orignal count.
+        int new_count = WriteBatchInternal::Count(&new_batch);
+        int original_count = WriteBatchInternal::Count(&batch);
+        if (new_count > original_count) {
+          ROCKS_LOG_FATAL(
+              immutable_db_options_.info_log,
+              "Recovering log #%" PRIu64
+              " mode %d log filter %s returned "
+              "more records (%d) than original (%d) which is not allowed. "
+              "Aborting recovery.",
+              log_number, int(immutable_db_options_.wal_recovery_mode),
+              immutable_db_options_.wal_filter->Name(), new_count,
+              original_count);
+          status = Status::NotSupported(
+              "More than original # of records "
+              "returned by Wal Filter ",
+              immutable_db_options_.wal_filter->Name());
+          return status;
+        }
+        // Set the same sequence number in the new_batch
+        // as the original batch.
+        WriteBatchInternal::SetSequence(&new_batch,
+                                        WriteBatchInternal::Sequence(&batch));
+        batch = new_batch;
+      }
+    }
 #endif  // ROCKSDB_LITE
 
+    bool grouped = false;
+    if (!skip_record && insert_pool != nullptr) {
+      RecoveryBatchChecker checker;
+      if (batch.Iterate(&checker).ok()) {
+        reading_group.emplace_back();
+        RecoveredBatch& recovered = reading_group.back();
+        recovered.batch = batch;
+        recovered.log_number = log_number;
+        recovered.record_size = record_size;
+        recovered.reporter = &log_file->reporter;
+        reading_group_bytes += record_size;
+        grouped = true;
+        if (reading_group.size() >= kRecoveryGroupBatches ||
+            reading_group_bytes >= kRecoveryGroupBytes) {
+          status = insertReadingGroup();
+        }
+      } else {
+        status = drainGroups();
+      }
+      if (!status.ok()) {
+        return status;
+      }
+    }
+
+    if (!skip_record && !grouped) {
       // If column family was not found, it might mean that the WAL write
       // batch references to the column family that was dropped after the
       // insert. We don't want to fail the whole write batch in that case --
       // we just ignore the update.
       // That's why we set ignore missing column families to true
       bool has_valid_writes = false;
-      status = WriteBatchInternal::InsertInto(
+      Status s = WriteBatchInternal::InsertInto(
           &batch, column_family_memtables_.get(), &flush_scheduler_, true,
           log_number, this, false /* concurrent_memtable_writes */,
           next_sequence, &has_valid_writes, seq_per_batch_, batch_per_txn_);
-      MaybeIgnoreError(&status);
-      if (!status.ok()) {
+      MaybeIgnoreError(&s);
+      if (!s.ok()) {
         // We are treating this as a failure while reading since we read valid
         // blocks that do not form coherent data
-        reporter.Corruption(record.size(), status);
-        continue;
-      }
-
-      if (has_valid_writes && !read_only) {
-        // we can do this because this is called before client has access to the
-        // DB and there is only a single thread operating on DB
+        log_file->reporter.Corruption(record_size, s);
+      } else if (has_valid_writes && !read_only) {
+        // we can do this because this is called before client has access to
+        // the DB and there is only a single thread operating on DB
         ColumnFamilyData* cfd;
 
         while ((cfd = flush_scheduler_.TakeNextColumnFamily()) != nullptr) {
@@ -935,43 +1308,21 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
       }
     }
 
-    if (!status.ok()) {
-      if (status.IsNotSupported()) {
-        // We should not treat NotSupported as corruption. It is rather a clear
-        // sign that we are processing a WAL that is produced by an incompatible
-        // version of the code.
-        return status;
-      }
-      if (immutable_db_options_.wal_recovery_mode ==
-          WALRecoveryMode::kSkipAnyCorruptedRecords) {
-        // We should ignore all errors unconditionally
-        status = Status::OK();
-      } else if (immutable_db_options_.wal_recovery_mode ==
-                 WALRecoveryMode::kPointInTimeRecovery) {
-        // We should ignore the error but not continue replaying
-        status = Status::OK();
-        stop_replay_for_corruption = true;
-        corrupted_log_number = log_number;
-        ROCKS_LOG_INFO(immutable_db_options_.info_log,
-                       "Point in time recovered to log #%" PRIu64
-                       " seq #%" PRIu64,
-                       log_number, *next_sequence);
-      } else {
-        assert(immutable_db_options_.wal_recovery_mode ==
-                   WALRecoveryMode::kTolerateCorruptedTailRecords ||
-               immutable_db_options_.wal_recovery_mode ==
-                   WALRecoveryMode::kAbsoluteConsistency);
-        return status;
+    if (stop_replay_by_wal_filter) {
+      for (auto* other : pending) {
+        if (other != log_file) {
+          logFileDropped(other);
+        }
       }
+      pending.clear();
+    } else if (drop_log_file || !readRecord(log_file)) {
+      pending.erase(pending.begin() + next);
+    } else {
+      continue;
     }
-
-    flush_scheduler_.Clear();
-    auto last_sequence = *next_sequence - 1;
-    if ((*next_sequence != kMaxSequenceNumber) &&
-        (versions_->LastSequence() <= last_sequence)) {
-      versions_->SetLastAllocatedSequence(last_sequence);
-      versions_->SetLastPublishedSequence(last_sequence);
-      versions_->SetLastSequence(last_sequence);
+    status = finishLogFile(log_file);
+    if (!status.ok()) {
+      return status;
     }
   }
   // Compare the corrupted log number to all columnfamily's current log number.
@@ -1379,7 +1730,22 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
             new log::Writer(
                 std::move(file_writer), new_log_number,
                 impl->immutable_db_options_.recycle_log_file_num > 0,
-                impl->immutable_db_options_.manual_wal_flush));
+                impl->immutable_db_options_.manual_wal_flush,
+                impl->immutable_db_options_.wal_compression));
+      }
+      for (size_t i = 1; s.ok() && i < impl->num_wal_streams_; ++i) {
+        std::unique_ptr<log::Writer> stream;
+        s = impl->NewLogWriter(&stream, 0 /* recycle_log_number */,
+                               BuildDBOptions(impl->immutable_db_options_,
+                                              impl->mutable_db_options_),
+                               write_hint);
+        if (s.ok()) {
+          stream->file()->writable_file()->SetPreallocationBlockSize(
+              impl->GetWalPreallocateBlockSize(max_write_buffer_size));
+          InstrumentedMutexLock wl(&impl->log_write_mutex_);
+          impl->wal_streams_.emplace_back(stream->get_log_number(),
+                                          stream.release());
+        }
       }
 
       autovector<const ColumnFamilyOptions*> cf_options_list;
@@ -1438,6 +1804,15 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
       if (impl->two_write_queues_) {
         impl->log_write_mutex_.Unlock();
       }
+#ifndef ROCKSDB_LITE
+      if (impl->immutable_db_options_.change_feed_buffer_size > 0 &&
+          !impl->seq_per_batch_ && !impl->two_write_queues_) {
+        // The recovered writes are only in the WAL
+        impl->change_feed_.reset(
+            new ChangeFeed(impl->immutable_db_options_.change_feed_buffer_size,
+                           impl->versions_->LastSequence() + 1));
+      }
+#endif  // ROCKSDB_LITE
       impl->DeleteObsoleteFiles();
       s = impl->directories_.GetDbDir()->Fsync();
     }
@@ -1534,6 +1909,8 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
   }
   if (s.ok()) {
     impl->StartPeriodicWorkScheduler();
+    InstrumentedMutexLock l(&impl->mutex_);
+    impl->ScheduleBlockCacheWarmUp();
   } else {
     for (auto* h : *handles) {
       delete h;
@@ -0,0 +1,393 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/db_impl_secondary.h"
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "db/column_family.h"
+#include "db/write_batch_internal.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/file_reader_writer.h"
+#include "util/filename.h"
+
+namespace TERARKDB_NAMESPACE {
+
+#ifndef ROCKSDB_LITE
+
+DBImplSecondary::DBImplSecondary(const DBOptions& db_options,
+                                 const std::string& dbname)
+    : DBImplReadOnly(db_options, dbname) {
+  ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                 "Opening the db in secondary mode");
+  LogFlush(immutable_db_options_.info_log);
+}
+
+DBImplSecondary::~DBImplSecondary() {}
+
+void DBImplSecondary::LogReporter::Corruption(size_t bytes, const Status& s) {
+  ROCKS_LOG_WARN(info_log, "%s: dropping %d bytes; %s", fname.c_str(),
+                 static_cast<int>(bytes), s.ToString().c_str());
+  if (status.ok()) {
+    status = s;
+  }
+}
+
+Status DBImplSecondary::Recover(
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    bool /*read_only*/, bool /*error_if_log_file_exist*/,
+    bool /*error_if_data_exists_in_logs*/) {
+  mutex_.AssertHeld();
+
+  Status s = versions_->RecoverAsSecondary(column_families);
+  if (!s.ok()) {
+    return s;
+  }
+
+  max_total_in_memory_state_ = 0;
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    auto* mutable_cf_options = cfd->GetLatestMutableCFOptions();
+    max_total_in_memory_state_ += mutable_cf_options->write_buffer_size *
+                                  mutable_cf_options->max_write_buffer_number;
+  }
+  default_cf_handle_ = new ColumnFamilyHandleImpl(
+      versions_->GetColumnFamilySet()->GetDefault(), this, &mutex_);
+  default_cf_internal_stats_ = default_cf_handle_->cfd()->internal_stats();
+  single_column_family_mode_ =
+      versions_->GetColumnFamilySet()->NumberOfColumnFamilies() == 1;
+
+  // The callers install the super versions of all column families
+  std::unordered_set<ColumnFamilyData*> cfds_changed;
+  autovector<MemTable*> to_delete;
+  s = CatchUpWithLogs(versions_->LastSequence(), &cfds_changed, &to_delete);
+  for (auto m : to_delete) {
+    delete m;
+  }
+  return s;
+}
+
+void DBImplSecondary::SwitchMemTable(
+    ColumnFamilyData* cfd, std::unordered_set<ColumnFamilyData*>* cfds_changed,
+    autovector<MemTable*>* to_delete) {
+  mutex_.AssertHeld();
+  MemTableLogs& logs = memtable_logs_[cfd->GetID()];
+  MemTable* new_mem = cfd->ConstructNewMemtable(
+      *cfd->GetLatestMutableCFOptions(), seq_per_batch_,
+      versions_->LastSequence());
+  // Dropped by CatchUpWithLogs() once the column family starts at a later log
+  cfd->mem()->SetNextLogNumber(logs.last_log + 1);
+  cfd->imm()->Add(cfd->mem(), to_delete);
+  new_mem->Ref();
+  cfd->SetMemtable(new_mem);
+  logs = MemTableLogs();
+  cfds_changed->insert(cfd);
+}
+
+Status DBImplSecondary::CatchUpWithLogs(
+    SequenceNumber manifest_sequence,
+    std::unordered_set<ColumnFamilyData*>* cfds_changed,
+    autovector<MemTable*>* to_delete) {
+  mutex_.AssertHeld();
+  auto* cf_set = versions_->GetColumnFamilySet();
+
+  // Drop the memtables of the logs the primary has flushed
+  uint64_t min_log_number = std::numeric_limits<uint64_t>::max();
+  for (auto cfd : *cf_set) {
+    uint64_t log_number = cfd->GetLogNumber();
+    min_log_number = std::min(min_log_number, log_number);
+    int num_imm = cfd->imm()->NumNotFlushed();
+    cfd->imm()->RemoveOldMemTables(log_number, to_delete);
+    if (cfd->imm()->NumNotFlushed() != num_imm) {
+      cfds_changed->insert(cfd);
+    }
+    MemTableLogs& logs = memtable_logs_[cfd->GetID()];
+    if (logs.num_entries > 0 && logs.last_log < log_number) {
+      cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
+                             seq_per_batch_, versions_->LastSequence());
+      logs = MemTableLogs();
+      cfds_changed->insert(cfd);
+    }
+  }
+  while (!log_tailers_.empty() &&
+         log_tailers_.begin()->first < min_log_number) {
+    log_tailers_.erase(log_tailers_.begin());
+  }
+
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(immutable_db_options_.wal_dir, &filenames);
+  if (!s.ok()) {
+    return s;
+  }
+  for (auto& filename : filenames) {
+    uint64_t log_number;
+    FileType type;
+    if (!ParseFileName(filename, &log_number, &type) || type != kLogFile ||
+        log_number < min_log_number || log_tailers_.count(log_number) > 0) {
+      continue;
+    }
+    std::string fname = LogFileName(immutable_db_options_.wal_dir, log_number);
+    std::unique_ptr<SequentialFile> file;
+    s = env_->NewSequentialFile(fname, &file,
+                                env_->OptimizeForLogRead(env_options_));
+    if (s.IsNotFound()) {
+      // Deleted by the primary since GetChildren()
+      s = Status::OK();
+      continue;
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                   "Tailing log #%" PRIu64 " of the primary", log_number);
+    std::unique_ptr<LogTailer> tailer(new LogTailer);
+    tailer->reporter.info_log = immutable_db_options_.info_log.get();
+    tailer->reporter.fname = fname;
+    std::unique_ptr<SequentialFileReader> file_reader(
+        new SequentialFileReader(std::move(file), fname));
+    tailer->reader.reset(new log::FragmentBufferedReader(
+        immutable_db_options_.info_log, std::move(file_reader),
+        &tailer->reporter, true /* checksum */, log_number));
+    log_tailers_.emplace(log_number, std::move(tailer));
+  }
+
+  // The logs are read oldest first, a record from a log of a later WAL
+  // generation than the data of a memtable switches the memtable, so the
+  // memtables can be dropped in the order the primary flushes them
+  for (auto& pair : log_tailers_) {
+    uint64_t log_number = pair.first;
+    LogTailer* tailer = pair.second.get();
+    Slice record;
+    std::string scratch;
+    WriteBatch batch;
+    while (s.ok() && tailer->reader->ReadRecord(&record, &scratch)) {
+      if (record.size() < WriteBatchInternal::kHeader) {
+        tailer->reporter.Corruption(record.size(),
+                                    Status::Corruption("log record too small"));
+        continue;
+      }
+      WriteBatchInternal::SetContents(&batch, record);
+      SequenceNumber sequence = WriteBatchInternal::Sequence(&batch);
+      for (auto cfd : *cf_set) {
+        const MemTableLogs& logs = memtable_logs_[cfd->GetID()];
+        if (logs.num_entries > 0 &&
+            log_number >= logs.first_log + num_wal_streams_) {
+          SwitchMemTable(cfd, cfds_changed, to_delete);
+        }
+      }
+      // Writes to the column families not opened are ignored, as are the
+      // writes to the column families the primary has flushed
+      SequenceNumber next_sequence = kMaxSequenceNumber;
+      bool has_valid_writes = false;
+      s = WriteBatchInternal::InsertInto(
+          &batch, column_family_memtables_.get(), &flush_scheduler_, true,
+          log_number, this, false /* concurrent_memtable_writes */,
+          &next_sequence, &has_valid_writes, seq_per_batch_, batch_per_txn_);
+      if (!s.ok()) {
+        break;
+      }
+      if (has_valid_writes) {
+        for (auto cfd : *cf_set) {
+          MemTableLogs& logs = memtable_logs_[cfd->GetID()];
+          uint64_t num_entries = cfd->mem()->num_entries();
+          if (num_entries == logs.num_entries) {
+            continue;
+          }
+          if (logs.num_entries == 0) {
+            logs.first_log = logs.last_log = log_number;
+          } else {
+            logs.first_log = std::min(logs.first_log, log_number);
+            logs.last_log = std::max(logs.last_log, log_number);
+          }
+          logs.num_entries = num_entries;
+          cfds_changed->insert(cfd);
+        }
+      }
+      ColumnFamilyData* cfd;
+      while ((cfd = flush_scheduler_.TakeNextColumnFamily()) != nullptr) {
+        cfd->Unref();
+        if (!cfd->IsDropped() && memtable_logs_[cfd->GetID()].num_entries > 0) {
+          SwitchMemTable(cfd, cfds_changed, to_delete);
+        }
+      }
+      if (next_sequence != kMaxSequenceNumber && next_sequence > sequence) {
+        auto& end = pending_sequences_[sequence];
+        end = std::max(end, next_sequence);
+      }
+    }
+    if (s.ok()) {
+      s = tailer->reporter.status;
+    }
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  // With WAL streams a sequence is visible once all the sequences before it
+  // are, or the MANIFEST has recorded a later sequence
+  SequenceNumber last_sequence =
+      std::max(versions_->LastSequence(), manifest_sequence);
+  while (!pending_sequences_.empty()) {
+    auto first = pending_sequences_.begin();
+    if (num_wal_streams_ > 1 && first->first > last_sequence + 1) {
+      break;
+    }
+    last_sequence = std::max(last_sequence, first->second - 1);
+    pending_sequences_.erase(first);
+  }
+  if (last_sequence > versions_->LastSequence()) {
+    versions_->SetLastAllocatedSequence(last_sequence);
+    versions_->SetLastPublishedSequence(last_sequence);
+    versions_->SetLastSequence(last_sequence);
+  }
+  return Status::OK();
+}
+
+Status DBImplSecondary::TryCatchUpWithPrimary() {
+  InstrumentedMutexLock catch_up_lock(&catch_up_mutex_);
+  SuperVersionContext sv_context(/* create_superversion */ true);
+  autovector<MemTable*> to_delete;
+  std::vector<ObsoleteFileInfo> obsolete_files;
+  Status s;
+  {
+    InstrumentedMutexLock lock(&mutex_);
+    std::unordered_set<ColumnFamilyData*> cfds_changed;
+    SequenceNumber manifest_sequence = 0;
+    s = versions_->CatchUpWithManifest(&mutex_, &cfds_changed,
+                                       &manifest_sequence);
+    if (s.ok()) {
+      s = CatchUpWithLogs(manifest_sequence, &cfds_changed, &to_delete);
+    }
+    for (auto cfd : cfds_changed) {
+      sv_context.NewSuperVersion();
+      cfd->InstallSuperVersion(&sv_context, &mutex_);
+    }
+    // The versions no longer used release the tables and blobs the primary
+    // has deleted
+    std::vector<std::string> obsolete_manifests;
+    versions_->GetObsoleteFiles(&obsolete_files, &obsolete_manifests,
+                                std::numeric_limits<uint64_t>::max());
+  }
+  for (auto& file : obsolete_files) {
+    if (file.metadata->table_reader_handle) {
+      table_cache_->Release(file.metadata->table_reader_handle);
+    }
+    TableCache::Evict(table_cache_.get(), file.metadata->fd.GetNumber());
+    file.DeleteMetadata();
+  }
+  for (auto m : to_delete) {
+    delete m;
+  }
+  sv_context.Clean();
+  return s;
+}
+
+Status DB::OpenAsSecondary(const Options& options, const std::string& dbname,
+                           const std::string& secondary_path, DB** dbptr) {
+  *dbptr = nullptr;
+
+  DBOptions db_options(options);
+  ColumnFamilyOptions cf_options(options);
+  std::vector<ColumnFamilyDescriptor> column_families;
+  column_families.push_back(
+      ColumnFamilyDescriptor(kDefaultColumnFamilyName, cf_options));
+  std::vector<ColumnFamilyHandle*> handles;
+
+  Status s = DB::OpenAsSecondary(db_options, dbname, secondary_path,
+                                 column_families, &handles, dbptr);
+  if (s.ok()) {
+    assert(handles.size() == 1);
+    // i can delete the handle since DBImpl is always holding a
+    // reference to default column family
+    delete handles[0];
+  }
+  return s;
+}
+
+Status DB::OpenAsSecondary(
+    const DBOptions& db_options, const std::string& dbname,
+    const std::string& secondary_path,
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    std::vector<ColumnFamilyHandle*>* handles, DB** dbptr) {
+  *dbptr = nullptr;
+  handles->clear();
+
+  DBOptions tmp_opts(db_options);
+  if (tmp_opts.info_log == nullptr) {
+    // Never write the info log of the primary
+    Status s = CreateLoggerFromOptions(secondary_path, tmp_opts,
+                                       &tmp_opts.info_log);
+    if (!s.ok()) {
+      tmp_opts.info_log = nullptr;
+    }
+  }
+
+  SuperVersionContext sv_context(/* create_superversion */ true);
+  DBImplSecondary* impl = new DBImplSecondary(tmp_opts, dbname);
+  impl->mutex_.Lock();
+  Status s = impl->Recover(column_families, true /* read only */,
+                           false /* error_if_log_file_exist */,
+                           false /* error_if_data_exists_in_logs */);
+  if (s.ok()) {
+    // set column family handles
+    for (auto cf : column_families) {
+      auto cfd =
+          impl->versions_->GetColumnFamilySet()->GetColumnFamily(cf.name);
+      if (cfd == nullptr) {
+        s = Status::InvalidArgument("Column family not found: ", cf.name);
+        break;
+      }
+      handles->push_back(new ColumnFamilyHandleImpl(cfd, impl, &impl->mutex_));
+    }
+  }
+  if (s.ok()) {
+    for (auto cfd : *impl->versions_->GetColumnFamilySet()) {
+      sv_context.NewSuperVersion();
+      cfd->InstallSuperVersion(&sv_context, &impl->mutex_);
+    }
+  }
+  impl->mutex_.Unlock();
+  sv_context.Clean();
+  if (s.ok()) {
+    *dbptr = impl;
+    for (auto* h : *handles) {
+      impl->NewThreadStatusCfInfo(
+          reinterpret_cast<ColumnFamilyHandleImpl*>(h)->cfd());
+    }
+  } else {
+    for (auto h : *handles) {
+      delete h;
+    }
+    handles->clear();
+    delete impl;
+  }
+  return s;
+}
+
+#else  // !ROCKSDB_LITE
+
+Status DB::OpenAsSecondary(const Options& /*options*/,
+                           const std::string& /*dbname*/,
+                           const std::string& /*secondary_path*/,
+                           DB** /*dbptr*/) {
+  return Status::NotSupported("Not supported in ROCKSDB_LITE.");
+}
+
+Status DB::OpenAsSecondary(
+    const DBOptions& /*db_options*/, const std::string& /*dbname*/,
+    const std::string& /*secondary_path*/,
+    const std::vector<ColumnFamilyDescriptor>& /*column_families*/,
+    std::vector<ColumnFamilyHandle*>* /*handles*/, DB** /*dbptr*/) {
+  return Status::NotSupported("Not supported in ROCKSDB_LITE.");
+}
+#endif  // !ROCKSDB_LITE
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,147 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#ifndef ROCKSDB_LITE
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "db/db_impl_readonly.h"
+#include "db/log_reader.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/autovector.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// A read only instance which follows the MANIFEST and the WALs of a running
+// primary, see DB::OpenAsSecondary(). The files of the primary are never
+// written or deleted, the tables and blobs the primary has deleted are only
+// evicted from the table cache.
+class DBImplSecondary : public DBImplReadOnly {
+ public:
+  DBImplSecondary(const DBOptions& options, const std::string& dbname);
+  virtual ~DBImplSecondary();
+
+  // The memtables of a secondary change, read them like DBImpl does
+  using DB::Get;
+  virtual Status Get(const ReadOptions& options,
+                     ColumnFamilyHandle* column_family, const Slice& key,
+                     LazyBuffer* value) override {
+    return DBImpl::Get(options, column_family, key, value);
+  }
+
+  using DBImpl::NewIterator;
+  virtual Iterator* NewIterator(const ReadOptions& options,
+                                ColumnFamilyHandle* column_family) override {
+    return DBImpl::NewIterator(options, column_family);
+  }
+
+  virtual Status NewIterators(
+      const ReadOptions& options,
+      const std::vector<ColumnFamilyHandle*>& column_families,
+      std::vector<Iterator*>* iterators) override {
+    return DBImpl::NewIterators(options, column_families, iterators);
+  }
+
+  using DBImpl::CreateColumnFamily;
+  virtual Status CreateColumnFamily(const ColumnFamilyOptions& /*options*/,
+                                    const std::string& /*column_family*/,
+                                    ColumnFamilyHandle** /*handle*/) override {
+    return Status::NotSupported("Not supported operation in secondary mode.");
+  }
+
+  using DBImpl::CreateColumnFamilies;
+  virtual Status CreateColumnFamilies(
+      const ColumnFamilyOptions& /*options*/,
+      const std::vector<std::string>& /*column_family_names*/,
+      std::vector<ColumnFamilyHandle*>* /*handles*/) override {
+    return Status::NotSupported("Not supported operation in secondary mode.");
+  }
+
+  virtual Status CreateColumnFamilies(
+      const std::vector<ColumnFamilyDescriptor>& /*column_families*/,
+      std::vector<ColumnFamilyHandle*>* /*handles*/) override {
+    return Status::NotSupported("Not supported operation in secondary mode.");
+  }
+
+  virtual Status DropColumnFamily(
+      ColumnFamilyHandle* /*column_family*/) override {
+    return Status::NotSupported("Not supported operation in secondary mode.");
+  }
+
+  virtual Status DropColumnFamilies(
+      const std::vector<ColumnFamilyHandle*>& /*column_families*/) override {
+    return Status::NotSupported("Not supported operation in secondary mode.");
+  }
+
+  virtual Status TryCatchUpWithPrimary() override;
+
+ private:
+  friend class DB;
+
+  // Recover the MANIFEST and the WALs of the primary as of now
+  virtual Status Recover(
+      const std::vector<ColumnFamilyDescriptor>& column_families,
+      bool read_only, bool error_if_log_file_exist,
+      bool error_if_data_exists_in_logs) override;
+
+  struct LogReporter : public log::Reader::Reporter {
+    Logger* info_log;
+    std::string fname;
+    Status status;
+    virtual void Corruption(size_t bytes, const Status& s) override;
+  };
+
+  // A WAL of the primary, read to its end so far
+  struct LogTailer {
+    LogReporter reporter;
+    std::unique_ptr<log::FragmentBufferedReader> reader;
+  };
+
+  // The logs the data of a memtable was read from
+  struct MemTableLogs {
+    uint64_t first_log = 0;
+    uint64_t last_log = 0;
+    uint64_t num_entries = 0;
+  };
+
+  // Read the records the primary has appended to its WALs since the last call
+  // into the memtables, and advance the last sequence to at least
+  // `manifest_sequence`. The memtables the primary has flushed are dropped.
+  // REQUIRES: mutex_ held
+  Status CatchUpWithLogs(SequenceNumber manifest_sequence,
+                         std::unordered_set<ColumnFamilyData*>* cfds_changed,
+                         autovector<MemTable*>* to_delete);
+
+  // Switch the memtable of `cfd` to the immutable memtables, which are
+  // dropped once the primary has flushed their logs
+  // REQUIRES: mutex_ held
+  void SwitchMemTable(ColumnFamilyData* cfd,
+                      std::unordered_set<ColumnFamilyData*>* cfds_changed,
+                      autovector<MemTable*>* to_delete);
+
+  // Serializes TryCatchUpWithPrimary()
+  InstrumentedMutex catch_up_mutex_;
+  // Protected by mutex_
+  std::map<uint64_t, std::unique_ptr<LogTailer>> log_tailers_;
+  std::unordered_map<uint32_t, MemTableLogs> memtable_logs_;
+  // The sequences [first, second) read from the WAL streams past the last
+  // sequence, which only becomes visible once the gaps are read, see
+  // DBOptions::wal_streams
+  std::map<SequenceNumber, SequenceNumber> pending_sequences_;
+
+  // No copying allowed
+  DBImplSecondary(const DBImplSecondary&);
+  void operator=(const DBImplSecondary&);
+};
+}  // namespace TERARKDB_NAMESPACE
+
+#endif  // !ROCKSDB_LITE
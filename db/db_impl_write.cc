@@ -18,7 +18,9 @@
 #include "monitoring/perf_context_imp.h"
 #include "options/options_helper.h"
 #include "rocksdb/metrics_reporter.h"
+#include "rocksdb/resource_group.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
 #include "util/sync_point.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -85,6 +87,13 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   if (my_batch == nullptr) {
     return Status::Corruption("Batch is nullptr!");
   }
+  if (key_hotness_sampler_ != nullptr && !disable_memtable &&
+      key_hotness_sampler_->ShouldSample()) {
+    key_hotness_sampler_->SampleBatch(my_batch);
+  }
+  if (!disable_memtable && write_heat_sampler_->ShouldSample()) {
+    write_heat_sampler_->SampleBatch(my_batch);
+  }
   if (tracer_) {
     InstrumentedMutexLock lock(&trace_mutex_);
     if (tracer_) {
@@ -114,6 +123,19 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
       return status;
     }
   }
+  if (UNLIKELY(!disable_memtable && write_controller_.HasStalledChildren())) {
+    status = DelayColumnFamilyWrite(write_options, my_batch);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (UNLIKELY(!disable_memtable &&
+               versions_->GetColumnFamilySet()->has_resource_groups())) {
+    status = ThrottleResourceGroupWrites(write_options, my_batch);
+    if (!status.ok()) {
+      return status;
+    }
+  }
 
   if (two_write_queues_ && disable_memtable) {
     return WriteImplWALOnly(write_options, my_batch, callback, log_used,
@@ -139,6 +161,9 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   if (w.state == WriteThread::STATE_PARALLEL_MEMTABLE_WRITER) {
     // we are a non-leader in a parallel group
 
+    if (w.wal_stream != nullptr) {
+      w.status = WriteToWALStream(&w);
+    }
     if (w.ShouldWriteToMemtable()) {
       PERF_TIMER_STOP(write_pre_and_post_process_time);
       PERF_TIMER_GUARD(write_memtable_time);
@@ -185,7 +210,11 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
       *seq_used = w.sequence;
     }
     // write is complete and leader has updated sequence
-    return w.FinalStatus();
+    status = w.FinalStatus();
+    if (status.ok() && w.sync_sequence != 0) {
+      status = wal_syncer_->Wait(w.sync_sequence);
+    }
+    return status;
   }
   // else we are the leader of the write batch group
   assert(w.state == WriteThread::STATE_GROUP_LEADER);
@@ -205,6 +234,14 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   mutex_.Lock();
 
   bool need_log_sync = write_options.sync;
+  // Hand the WAL fsync of this group to wal_syncer_, which needs a WAL that
+  // can be synced while the next group appends to it
+  bool async_log_sync =
+      need_log_sync && wal_syncer_ != nullptr &&
+      logs_.back().writer->file()->writable_file()->IsSyncThreadSafe();
+  if (async_log_sync) {
+    need_log_sync = false;
+  }
   bool need_log_dir_sync = need_log_sync && !log_dir_synced_;
   if (!two_write_queues_ || !disable_memtable) {
     // With concurrent writes we do preprocess only in the write thread that
@@ -219,6 +256,16 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     PERF_TIMER_START(write_pre_and_post_process_time);
   }
   log::Writer* log_writer = logs_.back().writer;
+  // A sync group goes to the first stream, which syncs all of them
+  autovector<log::Writer*, 8> wal_streams;
+  if (num_wal_streams_ > 1 && !write_options.sync &&
+      !write_options.disableWAL) {
+    wal_streams.push_back(log_writer);
+    for (size_t i = wal_streams_.size() + 1 - num_wal_streams_;
+         i < wal_streams_.size(); ++i) {
+      wal_streams.push_back(wal_streams_[i].writer);
+    }
+  }
 
   mutex_.Unlock();
 
@@ -267,6 +314,9 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     // memtable it still consumes a seq. Otherwise, if !seq_per_batch_, we inc
     // the seq per valid written key to mem.
     size_t seq_inc = seq_per_batch_ ? valid_batches : total_count;
+    // The writers of a parallel group append their runs of the group to the
+    // WAL streams themselves
+    const bool use_wal_streams = parallel && !wal_streams.empty();
 
     const bool concurrent_update = two_write_queues_;
     // Update stats while we are an exclusive group leader, so we know
@@ -297,7 +347,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     PERF_TIMER_STOP(write_pre_and_post_process_time);
 
     if (!two_write_queues_) {
-      if (status.ok() && !write_options.disableWAL) {
+      if (status.ok() && !write_options.disableWAL && !use_wal_streams) {
         PERF_TIMER_GUARD(write_wal_time);
         status = WriteToWAL(write_group, log_writer, log_used, need_log_sync,
                             need_log_dir_sync, last_sequence + 1);
@@ -318,6 +368,17 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     const SequenceNumber current_sequence = last_sequence + 1;
     last_sequence += seq_inc;
 
+    if (status.ok() && async_log_sync) {
+      // The group is in the WAL, its sync writers wait for the fsync after
+      // the group exits
+      for (auto* writer : write_group) {
+        if (writer->sync) {
+          writer->sync_sequence = last_sequence;
+        }
+      }
+      wal_syncer_->Request(last_sequence);
+    }
+
     if (status.ok()) {
       PERF_TIMER_GUARD(write_memtable_time);
 
@@ -346,12 +407,19 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
             next_sequence += WriteBatchInternal::Count(writer->batch);
           }
         }
+        if (use_wal_streams) {
+          AssignWALStreams(write_group, wal_streams, total_byte_size,
+                           log_used);
+        }
         write_group.last_sequence = last_sequence;
         write_thread_.LaunchParallelMemTableWriters(&write_group);
         in_parallel_group = true;
 
         // Each parallel follower is doing each own writes. The leader should
         // also do its own.
+        if (w.wal_stream != nullptr) {
+          w.status = WriteToWALStream(&w);
+        }
         if (w.ShouldWriteToMemtable()) {
           ColumnFamilyMemTablesImpl column_family_memtables(
               versions_->GetColumnFamilySet());
@@ -417,6 +485,9 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   if (status.ok()) {
     status = w.FinalStatus();
   }
+  if (status.ok() && w.sync_sequence != 0) {
+    status = wal_syncer_->Wait(w.sync_sequence);
+  }
   return status;
 }
 
@@ -729,7 +800,8 @@ Status DBImpl::PreprocessWrite(const WriteOptions& write_options,
     status = SwitchWAL(write_context);
   }
 
-  if (UNLIKELY(status.ok() && write_buffer_manager_->ShouldFlush())) {
+  if (UNLIKELY(status.ok() && (write_buffer_manager_->ShouldFlush() ||
+                                write_buffer_manager_->HasFlushRequests()))) {
     // Before a new memtable is added in SwitchMemtable(),
     // write_buffer_manager_->ShouldFlush() will keep returning true. If another
     // thread is writing to another DB with the same write buffer, they may also
@@ -782,6 +854,7 @@ Status DBImpl::PreprocessWrite(const WriteOptions& write_options,
       // actually write to the WAL
       log.getting_synced = true;
     }
+    ++wal_stream_syncs_;
   } else {
     *need_log_sync = false;
   }
@@ -811,8 +884,8 @@ WriteBatch* DBImpl::MergeBatch(const WriteThread::WriteGroup& write_group,
     *write_with_wal = 1;
   } else {
     // WAL needs all of the batches flattened into a single batch.
-    // We could avoid copying here with an iov-like AddRecord
-    // interface
+    // GatherWALBatches avoids the copy unless a batch has a WAL
+    // termination point
     merged_batch = tmp_batch;
     for (auto writer : write_group) {
       if (!writer->CallbackFailed()) {
@@ -829,14 +902,43 @@ WriteBatch* DBImpl::MergeBatch(const WriteThread::WriteGroup& write_group,
   return merged_batch;
 }
 
-// When two_write_queues_ is disabled, this function is called from the only
-// write thread. Otherwise this must be called holding log_write_mutex_.
+bool DBImpl::GatherWALBatches(const autovector<WriteBatch*, 8>& batches,
+                              SequenceNumber sequence, char* header,
+                              std::vector<Slice>* parts) {
+  uint32_t count = 0;
+  parts->clear();
+  parts->emplace_back(header, WriteBatchInternal::kHeader);
+  for (auto* batch : batches) {
+    if (!batch->GetWalTerminationPoint().is_cleared()) {
+      return false;
+    }
+    Slice entries = WriteBatchInternal::Contents(batch);
+    entries.remove_prefix(WriteBatchInternal::kHeader);
+    parts->push_back(entries);
+    count += WriteBatchInternal::Count(batch);
+  }
+  // Same as the header of WriteBatch::rep_
+  EncodeFixed64(header, sequence);
+  EncodeFixed32(header + 8, count);
+  return true;
+}
+
 Status DBImpl::WriteToWAL(const WriteBatch& merged_batch,
                           log::Writer* log_writer, uint64_t* log_used,
                           uint64_t* log_size) {
-  assert(log_size != nullptr);
   Slice log_entry = WriteBatchInternal::Contents(&merged_batch);
-  *log_size = log_entry.size();
+  return WriteToWAL(SliceParts(&log_entry, 1), log_writer, log_used, log_size);
+}
+
+// When two_write_queues_ is disabled, this function is called from the only
+// write thread. Otherwise this must be called holding log_write_mutex_.
+Status DBImpl::WriteToWAL(const SliceParts& log_entry, log::Writer* log_writer,
+                          uint64_t* log_used, uint64_t* log_size) {
+  assert(log_size != nullptr);
+  *log_size = 0;
+  for (int i = 0; i < log_entry.num_parts; ++i) {
+    *log_size += log_entry.parts[i].size();
+  }
   // When two_write_queues_ WriteToWAL has to be protected from concurretn calls
   // from the two queues anyway and log_write_mutex_ is already held. Otherwise
   // if manual_wal_flush_ is enabled we need to protect log_writer->AddRecord
@@ -852,13 +954,16 @@ Status DBImpl::WriteToWAL(const WriteBatch& merged_batch,
   if (UNLIKELY(needs_locking)) {
     log_write_mutex_.Unlock();
   }
+  if (change_feed_ != nullptr && status.ok()) {
+    change_feed_->Publish(log_entry);
+  }
   if (log_used != nullptr) {
     *log_used = logfile_number_;
   }
-  total_log_size_ += log_entry.size();
+  total_log_size_ += *log_size;
   // TODO(myabandeh): it might be unsafe to access alive_log_files_.back() here
   // since alive_log_files_ might be modified concurrently
-  alive_log_files_.back().AddSize(log_entry.size());
+  alive_log_files_.back().AddSize(*log_size);
   log_empty_ = false;
   return status;
 }
@@ -870,11 +975,43 @@ Status DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
   Status status;
 
   assert(!write_group.leader->disable_wal);
+  if (immutable_db_options_.value_log_threshold > 0 &&
+      change_feed_ == nullptr) {
+    status = WriteToValueLog(write_group, log_writer);
+    if (!status.ok()) {
+      return status;
+    }
+  }
   // Same holds for all in the batch group
   size_t write_with_wal = 0;
   WriteBatch* to_be_cached_state = nullptr;
-  WriteBatch* merged_batch = MergeBatch(write_group, &tmp_batch_,
-                                        &write_with_wal, &to_be_cached_state);
+  WriteBatch* merged_batch = nullptr;
+  // A group of several batches is written from the batches themselves
+  // rather than from a copy of them in tmp_batch_
+  autovector<WriteBatch*, 8> wal_batches;
+  if (write_group.size > 1) {
+    for (auto writer : write_group) {
+      if (!writer->CallbackFailed()) {
+        wal_batches.push_back(writer->batch);
+      }
+    }
+  }
+  char wal_header[WriteBatchInternal::kHeader];
+  const bool gathered =
+      wal_batches.size() > 1 &&
+      GatherWALBatches(wal_batches, sequence, wal_header, &wal_parts_);
+  if (gathered) {
+    write_with_wal = wal_batches.size();
+    for (auto* batch : wal_batches) {
+      if (WriteBatchInternal::IsLatestPersistentState(batch)) {
+        // We only need to cache the last of such write batch
+        to_be_cached_state = batch;
+      }
+    }
+  } else {
+    merged_batch = MergeBatch(write_group, &tmp_batch_, &write_with_wal,
+                              &to_be_cached_state);
+  }
   if (merged_batch == write_group.leader->batch) {
     write_group.leader->log_used = logfile_number_;
   } else if (write_with_wal > 1) {
@@ -886,10 +1023,15 @@ Status DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
     }
   }
 
-  WriteBatchInternal::SetSequence(merged_batch, sequence);
-
   uint64_t log_size;
-  status = WriteToWAL(*merged_batch, log_writer, log_used, &log_size);
+  if (gathered) {
+    status = WriteToWAL(
+        SliceParts(wal_parts_.data(), static_cast<int>(wal_parts_.size())),
+        log_writer, log_used, &log_size);
+  } else {
+    WriteBatchInternal::SetSequence(merged_batch, sequence);
+    status = WriteToWAL(*merged_batch, log_writer, log_used, &log_size);
+  }
   if (to_be_cached_state) {
     cached_recoverable_state_ = *to_be_cached_state;
     cached_recoverable_state_empty_ = false;
@@ -913,6 +1055,13 @@ Status DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
         break;
       }
     }
+    // wal_streams_ is not popped during the sync either
+    for (auto& stream : wal_streams_) {
+      if (!status.ok()) {
+        break;
+      }
+      status = stream.writer->file()->Sync(immutable_db_options_.use_fsync);
+    }
     if (status.ok() && need_log_dir_sync) {
       // We only sync WAL directory the first time WAL syncing is
       // requested, so that in case users never turn on WAL sync,
@@ -938,6 +1087,218 @@ Status DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
   return status;
 }
 
+Status DBImpl::WriteToValueLog(const WriteThread::WriteGroup& write_group,
+                               log::Writer* log_writer) {
+  const size_t threshold = immutable_db_options_.value_log_threshold;
+  Status status;
+  uint64_t appended = 0;
+  bool created = false;
+  for (auto writer : write_group) {
+    if (writer->CallbackFailed() || !writer->ShouldWriteToMemtable() ||
+        writer->batch->GetDataSize() < threshold ||
+        !writer->batch->GetWalTerminationPoint().is_cleared()) {
+      continue;
+    }
+    if (value_log_ == nullptr ||
+        value_log_->number() != log_writer->get_log_number()) {
+      value_log_.reset();
+      std::shared_ptr<ValueLog> log;
+      status = ValueLog::Create(
+          env_,
+          env_->OptimizeForLogWrite(
+              env_options_,
+              BuildDBOptions(immutable_db_options_, mutable_db_options_)),
+          immutable_db_options_.wal_dir, log_writer->get_log_number(), &log);
+      if (!status.ok()) {
+        break;
+      }
+      InstrumentedMutexLock l(&value_logs_mutex_);
+      for (auto it = value_logs_.begin(); it != value_logs_.end();) {
+        it = it->second.expired() ? value_logs_.erase(it) : std::next(it);
+      }
+      value_logs_[log->number()] = log;
+      value_log_ = std::move(log);
+      created = true;
+    }
+    std::unique_ptr<WriteBatch> batch(new WriteBatch());
+    bool separated = false;
+    status = WriteBatchInternal::SeparateValues(
+        writer->batch, threshold,
+        [&](const Slice& value, std::string* index) {
+          appended += value.size();
+          return value_log_->Append(value, index);
+        },
+        batch.get(), &separated);
+    if (!status.ok()) {
+      break;
+    }
+    if (separated) {
+      writer->value_log_batch = std::move(batch);
+      writer->batch = writer->value_log_batch.get();
+    }
+  }
+  if (status.ok() && appended > 0) {
+    // Readable and durable before the WAL records pointing into it
+    status = write_group.leader->sync
+                 ? value_log_->Sync(immutable_db_options_.use_fsync)
+                 : value_log_->Flush();
+    if (status.ok() && created && write_group.leader->sync) {
+      status = directories_.GetWalDir()->Fsync();
+    }
+    if (status.ok()) {
+      total_log_size_ += appended;
+      alive_log_files_.back().AddSize(appended);
+      RecordTick(stats_, VALUE_LOG_BYTES_WRITTEN, appended);
+    }
+  }
+  return status;
+}
+
+Status DBImpl::GetValueLog(const Slice& index,
+                           std::shared_ptr<ValueLog>* log) {
+  uint64_t number;
+  if (!ValueLog::DecodeNumber(index, &number)) {
+    return Status::Corruption("bad value index");
+  }
+  InstrumentedMutexLock l(&value_logs_mutex_);
+  auto& weak_log = value_logs_[number];
+  *log = weak_log.lock();
+  if (*log != nullptr) {
+    return Status::OK();
+  }
+  Status s = ValueLog::Open(env_, env_options_, immutable_db_options_.wal_dir,
+                            number, log);
+  if (s.ok()) {
+    weak_log = *log;
+  }
+  return s;
+}
+
+void DBImpl::AssignWALStreams(const WriteThread::WriteGroup& write_group,
+                              const autovector<log::Writer*, 8>& wal_streams,
+                              uint64_t log_size, uint64_t* log_used) {
+  size_t num_batches = 0;
+  for (auto* writer : write_group) {
+    if (!writer->CallbackFailed()) {
+      ++num_batches;
+    }
+  }
+  if (num_batches == 0) {
+    return;
+  }
+  size_t num_runs = std::min(wal_streams.size(), num_batches);
+  size_t run_size = (num_batches + num_runs - 1) / num_runs;
+  WriteThread::Writer* run_leader = nullptr;
+  size_t next_stream = 0;
+  size_t run_batches = 0;
+  for (auto* writer : write_group) {
+    writer->log_used = logfile_number_;
+    if (!writer->CallbackFailed() &&
+        (run_leader == nullptr || run_batches == run_size)) {
+      // A run starts with a batch, so it also starts at the sequence of its
+      // leader
+      run_leader = writer;
+      run_leader->wal_stream = wal_streams[next_stream++];
+      run_batches = 0;
+    }
+    if (run_leader != nullptr) {
+      ++run_leader->wal_stream_writers;
+      if (!writer->CallbackFailed()) {
+        ++run_batches;
+      }
+    }
+  }
+  if (log_used != nullptr) {
+    *log_used = logfile_number_;
+  }
+  // Counts the batches but not the record headers, good enough for the WAL
+  // size limits
+  total_log_size_ += log_size;
+  alive_log_files_.back().AddSize(log_size);
+  log_empty_ = false;
+  if (change_feed_ != nullptr) {
+    PublishToChangeFeed(write_group);
+  }
+}
+
+void DBImpl::PublishToChangeFeed(const WriteThread::WriteGroup& write_group) {
+  // The runs are written to the streams concurrently, so the group is
+  // published as one record in sequence order before they are
+  autovector<WriteBatch*, 8> batches;
+  SequenceNumber sequence = 0;
+  for (auto* writer : write_group) {
+    if (!writer->CallbackFailed()) {
+      if (batches.empty()) {
+        sequence = writer->sequence;
+      }
+      batches.push_back(writer->batch);
+    }
+  }
+  char header[WriteBatchInternal::kHeader];
+  std::vector<Slice> parts;
+  WriteBatch tmp_batch;
+  if (!GatherWALBatches(batches, sequence, header, &parts)) {
+    for (auto* batch : batches) {
+      WriteBatchInternal::Append(&tmp_batch, batch, /*WAL_only*/ true);
+    }
+    WriteBatchInternal::SetSequence(&tmp_batch, sequence);
+    parts.assign(1, WriteBatchInternal::Contents(&tmp_batch));
+  }
+  change_feed_->Publish(
+      SliceParts(parts.data(), static_cast<int>(parts.size())));
+}
+
+Status DBImpl::WriteToWALStream(WriteThread::Writer* w) {
+  PERF_TIMER_GUARD(write_wal_time);
+  assert(w->wal_stream != nullptr);
+  autovector<WriteBatch*, 8> batches;
+  WriteThread::Writer* writer = w;
+  for (size_t i = 0; i < w->wal_stream_writers; ++i) {
+    if (i > 0) {
+      writer = writer->link_newer;
+    }
+    if (!writer->CallbackFailed()) {
+      batches.push_back(writer->batch);
+    }
+  }
+  assert(!batches.empty() && batches.front() == w->batch);
+  char header[WriteBatchInternal::kHeader];
+  std::vector<Slice> parts;
+  WriteBatch tmp_batch;
+  if (batches.size() == 1 ||
+      !GatherWALBatches(batches, w->sequence, header, &parts)) {
+    WriteBatch* merged_batch = w->batch;
+    if (batches.size() > 1 ||
+        !merged_batch->GetWalTerminationPoint().is_cleared()) {
+      merged_batch = &tmp_batch;
+      for (auto* batch : batches) {
+        WriteBatchInternal::Append(merged_batch, batch, /*WAL_only*/ true);
+      }
+    }
+    WriteBatchInternal::SetSequence(merged_batch, w->sequence);
+    parts.assign(1, WriteBatchInternal::Contents(merged_batch));
+  }
+  size_t log_size = 0;
+  for (auto& part : parts) {
+    log_size += part.size();
+  }
+
+  Status status = w->wal_stream->AddRecord(
+      SliceParts(parts.data(), static_cast<int>(parts.size())));
+  if (status.ok()) {
+    auto stats = default_cf_internal_stats_;
+    stats->AddDBStats(InternalStats::WAL_FILE_BYTES, log_size,
+                      true /* concurrent */);
+    RecordTick(stats_, WAL_FILE_BYTES, log_size);
+    stats->AddDBStats(InternalStats::WRITE_WITH_WAL, batches.size(),
+                      true /* concurrent */);
+    RecordTick(stats_, WRITE_WITH_WAL, batches.size());
+  } else {
+    WriteStatusCheck(status);
+  }
+  return status;
+}
+
 Status DBImpl::ConcurrentWriteToWAL(const WriteThread::WriteGroup& write_group,
                                     uint64_t* log_used,
                                     SequenceNumber* last_sequence,
@@ -1161,25 +1522,77 @@ Status DBImpl::HandleWriteBufferFull(WriteContext* write_context) {
   SequenceNumber seq_num_for_cf_picked = kMaxSequenceNumber;
   size_t largest_cfd_size = 0;
 
-  for (auto cfd : *versions_->GetColumnFamilySet()) {
-    if (cfd->IsDropped()) {
-      continue;
+  const char* pick_reason = flush_pri == kFlushLargest
+                                ? "largest mem table size"
+                                : flush_pri == kFlushOldest
+                                      ? "oldest sequence number"
+                                      : "arbitrated mem table";
+
+  uint32_t requested_cf_id;
+  if (write_buffer_manager_->TakeFlushRequest(this, &requested_cf_id)) {
+    // Another DB sharing the write buffer manager picked our memtable
+    cfd_picked =
+        versions_->GetColumnFamilySet()->GetColumnFamily(requested_cf_id);
+    if (cfd_picked != nullptr &&
+        (cfd_picked->IsDropped() || cfd_picked->mem()->IsEmpty())) {
+      cfd_picked = nullptr;
+    }
+    pick_reason = "flush request of another DB";
+  }
+  if (cfd_picked == nullptr && !write_buffer_manager_->ShouldFlush()) {
+    // Only requests for other DBs are pending
+    return status;
+  }
+
+  if (cfd_picked == nullptr && flush_pri == kFlushArbitrated) {
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (cfd->IsDropped()) {
+        continue;
+      }
+      write_buffer_manager_->ReportMemTable(
+          this, cfd->GetID(),
+          cfd->mem()->IsEmpty() || cfd->queued_for_flush()
+              ? 0
+              : cfd->mem()->ApproximateMemoryUsage(),
+          cfd->mem()->ApproximateOldestKeyTime());
+    }
+    int64_t now = 0;
+    env_->GetCurrentTime(&now);
+    const void* victim_db = nullptr;
+    uint32_t victim_cf_id = 0;
+    if (write_buffer_manager_->PickFlushVictim(this, static_cast<uint64_t>(now),
+                                               &victim_db, &victim_cf_id)) {
+      if (victim_db == this) {
+        cfd_picked =
+            versions_->GetColumnFamilySet()->GetColumnFamily(victim_cf_id);
+      } else {
+        ROCKS_LOG_BUFFER(&write_context->info_buffer,
+                         "Write buffer is full, left column family %" PRIu32
+                         " of DB %p to flush.",
+                         victim_cf_id, victim_db);
+      }
     }
-    if (!cfd->mem()->IsEmpty()) {
-      // We only consider active mem table, hoping immutable memtable is already
-      // in the process of flushing.
-      if (flush_pri == kFlushOldest) {
-        uint64_t seq = cfd->mem()->GetCreationSeq();
-        if (cfd_picked == nullptr || seq < seq_num_for_cf_picked) {
-          cfd_picked = cfd;
-          seq_num_for_cf_picked = seq;
-        }
-      } else if (!cfd->queued_for_flush()) {
-        assert(flush_pri == kFlushLargest);
-        size_t cfd_size = cfd->mem()->ApproximateMemoryUsage();
-        if (cfd_picked == nullptr || cfd_size > largest_cfd_size) {
-          cfd_picked = cfd;
-          largest_cfd_size = cfd_size;
+  } else if (cfd_picked == nullptr) {
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (cfd->IsDropped()) {
+        continue;
+      }
+      if (!cfd->mem()->IsEmpty()) {
+        // We only consider active mem table, hoping immutable memtable is
+        // already in the process of flushing.
+        if (flush_pri == kFlushOldest) {
+          uint64_t seq = cfd->mem()->GetCreationSeq();
+          if (cfd_picked == nullptr || seq < seq_num_for_cf_picked) {
+            cfd_picked = cfd;
+            seq_num_for_cf_picked = seq;
+          }
+        } else if (!cfd->queued_for_flush()) {
+          assert(flush_pri == kFlushLargest);
+          size_t cfd_size = cfd->mem()->ApproximateMemoryUsage();
+          if (cfd_picked == nullptr || cfd_size > largest_cfd_size) {
+            cfd_picked = cfd;
+            largest_cfd_size = cfd_size;
+          }
         }
       }
     }
@@ -1195,10 +1608,7 @@ Status DBImpl::HandleWriteBufferFull(WriteContext* write_context) {
         &write_context->info_buffer,
         "Flushing column family [%s] with %s. Write buffer is using %" PRIu64
         " bytes out of a total of %" PRIu64 ".",
-        cfd->GetName().c_str(),
-        flush_pri == kFlushLargest ? "largest mem table size"
-                                   : "oldest sequence number",
-        memory_usage, buffer_size);
+        cfd->GetName().c_str(), pick_reason, memory_usage, buffer_size);
   }
 
   for (auto cfd : cfds) {
@@ -1346,6 +1756,163 @@ Status DBImpl::DelayWrite(uint64_t num_bytes,
   return s;
 }
 
+namespace {
+// Collects the column families a write batch writes to
+class ColumnFamilyCollector : public WriteBatch::Handler {
+ public:
+  explicit ColumnFamilyCollector(autovector<uint32_t>* cf_ids)
+      : cf_ids_(cf_ids) {}
+
+  Status PutCF(uint32_t cf, const Slice& /*key*/,
+               const Slice& /*value*/) override {
+    return Add(cf);
+  }
+  Status DeleteCF(uint32_t cf, const Slice& /*key*/) override {
+    return Add(cf);
+  }
+  Status SingleDeleteCF(uint32_t cf, const Slice& /*key*/) override {
+    return Add(cf);
+  }
+  Status DeleteRangeCF(uint32_t cf, const Slice& /*begin_key*/,
+                       const Slice& /*end_key*/) override {
+    return Add(cf);
+  }
+  Status MergeCF(uint32_t cf, const Slice& /*key*/,
+                 const Slice& /*value*/) override {
+    return Add(cf);
+  }
+
+  Status MarkBeginPrepare(bool /*unprepare*/) override { return Status::OK(); }
+  Status MarkEndPrepare(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkCommit(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkRollback(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkNoop(bool /*empty_batch*/) override { return Status::OK(); }
+
+ private:
+  Status Add(uint32_t cf) {
+    if (std::find(cf_ids_->begin(), cf_ids_->end(), cf) == cf_ids_->end()) {
+      cf_ids_->push_back(cf);
+    }
+    return Status::OK();
+  }
+
+  autovector<uint32_t>* cf_ids_;
+};
+}  // namespace
+
+Status DBImpl::DelayColumnFamilyWrite(const WriteOptions& write_options,
+                                      WriteBatch* my_batch) {
+  PERF_TIMER_GUARD(write_delay_time);
+  autovector<uint32_t> cf_ids;
+  ColumnFamilyCollector collector(&cf_ids);
+  if (!my_batch->Iterate(&collector).ok()) {
+    // The write reports the bad batch itself
+    return Status::OK();
+  }
+  const uint64_t num_bytes = WriteBatchInternal::ByteSize(my_batch);
+
+  InstrumentedMutexLock l(&mutex_);
+  auto cf_write_controller = [this](uint32_t cf_id) -> WriteController* {
+    auto* cfd = versions_->GetColumnFamilySet()->GetColumnFamily(cf_id);
+    return cfd == nullptr || cfd->IsDropped() ? nullptr
+                                              : cfd->cf_write_controller();
+  };
+  auto stopped = [&] {
+    for (uint32_t cf_id : cf_ids) {
+      auto* controller = cf_write_controller(cf_id);
+      if (controller != nullptr && controller->IsStopped()) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  uint64_t time_delayed = 0;
+  bool delayed = false;
+  {
+    StopWatch sw(env_, stats_, WRITE_STALL, &time_delayed);
+    // The batch is charged to the delay of every column family it writes
+    // to, and waits for the longest of them
+    uint64_t delay = 0;
+    for (uint32_t cf_id : cf_ids) {
+      auto* controller = cf_write_controller(cf_id);
+      if (controller != nullptr) {
+        delay = std::max(delay, controller->GetDelay(env_, num_bytes));
+      }
+    }
+    if (delay > 0) {
+      if (write_options.no_slowdown) {
+        return Status::Incomplete("Write stall");
+      }
+      TEST_SYNC_POINT("DBImpl::DelayColumnFamilyWrite:Sleep");
+      mutex_.Unlock();
+      // Like DelayWrite(), stop early once no column family is stalled
+      const uint64_t kDelayInterval = 1000;
+      uint64_t stall_end = sw.start_time() + delay;
+      while (write_controller_.HasStalledChildren() &&
+             env_->NowMicros() < stall_end) {
+        delayed = true;
+        env_->SleepForMicroseconds(kDelayInterval);
+      }
+      mutex_.Lock();
+    }
+
+    while (error_handler_.GetBGError().ok() && stopped()) {
+      if (write_options.no_slowdown) {
+        return Status::Incomplete("Write stall");
+      }
+      delayed = true;
+      TEST_SYNC_POINT("DBImpl::DelayColumnFamilyWrite:Wait");
+      bg_cv_.Wait();
+    }
+  }
+  assert(!delayed || !write_options.no_slowdown);
+  if (delayed) {
+    default_cf_internal_stats_->AddDBStats(InternalStats::WRITE_STALL_MICROS,
+                                           time_delayed);
+    RecordTick(stats_, STALL_MICROS, time_delayed);
+  }
+  if (stopped()) {
+    // Bailed out due to a background error
+    return Status::Incomplete(error_handler_.GetBGError().ToString());
+  }
+  return Status::OK();
+}
+
+Status DBImpl::ThrottleResourceGroupWrites(const WriteOptions& write_options,
+                                           WriteBatch* my_batch) {
+  autovector<uint32_t> cf_ids;
+  ColumnFamilyCollector collector(&cf_ids);
+  if (!my_batch->Iterate(&collector).ok()) {
+    // The write reports the bad batch itself
+    return Status::OK();
+  }
+  autovector<std::shared_ptr<ResourceGroup>> groups;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (uint32_t cf_id : cf_ids) {
+      auto* cfd = versions_->GetColumnFamilySet()->GetColumnFamily(cf_id);
+      if (cfd == nullptr || cfd->IsDropped()) {
+        continue;
+      }
+      auto& group = cfd->ioptions()->resource_group;
+      if (group != nullptr &&
+          std::find(groups.begin(), groups.end(), group) == groups.end()) {
+        groups.push_back(group);
+      }
+    }
+  }
+  const uint64_t num_bytes = WriteBatchInternal::ByteSize(my_batch);
+  for (auto& group : groups) {
+    if (write_options.no_slowdown &&
+        group->IsThrottled(ResourceGroup::kWrite)) {
+      return Status::Incomplete("Write stall");
+    }
+    group->Request(ResourceGroup::kWrite, num_bytes, stats_);
+  }
+  return Status::OK();
+}
+
 Status DBImpl::ThrottleLowPriWritesIfNeeded(const WriteOptions& write_options,
                                             WriteBatch* my_batch) {
   assert(write_options.low_pri);
@@ -1456,7 +2023,8 @@ Status DBImpl::NewLogWriter(std::unique_ptr<log::Writer>* new_log,
         immutable_db_options_.listeners));
     new_log->reset(new log::Writer(
         std::move(file_writer), new_log_number,
-        immutable_db_options_.recycle_log_file_num > 0, manual_wal_flush_));
+        immutable_db_options_.recycle_log_file_num > 0, manual_wal_flush_,
+        immutable_db_options_.wal_compression));
   }
   return s;
 }
@@ -1624,6 +2192,32 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
     assert(log_writer_pool_state_ == kLogWriterPoolWorking);
     log_writer_pool_state_ = s.ok() ? kLogWriterPoolIdle : kLogWriterPoolError;
   }
+  autovector<log::Writer*, 8> new_wal_streams;
+  if (s.ok() && creating_new_log && num_wal_streams_ > 1) {
+    // No log writer is pre-created with more than one stream, so the streams
+    // of the new log are numbered right after it
+    DBOptions db_options =
+        BuildDBOptions(immutable_db_options_, mutable_db_options_);
+    auto write_hint = CalculateWALWriteHint();
+    mutex_.Unlock();
+    for (size_t i = 1; s.ok() && i < num_wal_streams_; ++i) {
+      std::unique_ptr<log::Writer> stream;
+      s = NewLogWriter(&stream, 0 /* recycle_log_number */, db_options,
+                       write_hint);
+      if (s.ok()) {
+        new_wal_streams.push_back(stream.release());
+      }
+    }
+    mutex_.Lock();
+    if (!s.ok()) {
+      for (auto* stream : new_wal_streams) {
+        delete stream;
+      }
+      new_wal_streams.clear();
+      delete new_log;
+      new_log = nullptr;
+    }
+  }
   // PLEASE NOTE: We assume that there are no failable operations
   // after lock is acquired below since we are already notifying
   // client about mem table becoming immutable.
@@ -1648,6 +2242,10 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
     // of calling GetWalPreallocateBlockSize()
     new_log->file()->writable_file()->SetPreallocationBlockSize(
         preallocate_block_size);
+    for (auto* stream : new_wal_streams) {
+      stream->file()->writable_file()->SetPreallocationBlockSize(
+          preallocate_block_size);
+    }
 
     log_write_mutex_.Lock();
     logfile_number_ = new_log_number;
@@ -1685,6 +2283,9 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
       }
     }
     logs_.emplace_back(logfile_number_, new_log);
+    for (auto* stream : new_wal_streams) {
+      wal_streams_.emplace_back(stream->get_log_number(), stream);
+    }
     alive_log_files_.emplace_back(logfile_number_, versions_->LastSequence());
     log_write_mutex_.Unlock();
   }
@@ -1724,6 +2325,10 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
   cfd->imm()->Add(cfd->mem(), &context->memtables_to_free);
   new_mem->Ref();
   cfd->SetMemtable(new_mem);
+  if (immutable_db_options_.write_buffer_flush_pri == kFlushArbitrated) {
+    write_buffer_manager_->ReportMemTable(this, cfd->GetID(), 0,
+                                          new_mem->ApproximateOldestKeyTime());
+  }
   InstallSuperVersionAndScheduleWork(cfd, &context->superversion_context,
                                      mutable_cf_options);
   if (two_write_queues_) {
@@ -80,6 +80,7 @@ class DBIter final : public Iterator {
       prev_found_count_ = 0;
       bytes_read_ = 0;
       skip_count_ = 0;
+      separated_value_not_fetched_ = 0;
     }
 
     void BumpGlobalStatistics(Statistics* global_statistics) {
@@ -89,6 +90,8 @@ class DBIter final : public Iterator {
       RecordTick(global_statistics, NUMBER_DB_PREV_FOUND, prev_found_count_);
       RecordTick(global_statistics, ITER_BYTES_READ, bytes_read_);
       RecordTick(global_statistics, NUMBER_ITER_SKIP, skip_count_);
+      RecordTick(global_statistics, ITER_SEPARATED_VALUE_NOT_FETCHED,
+                 separated_value_not_fetched_);
       PERF_COUNTER_ADD(iter_read_bytes, bytes_read_);
       ResetCounters();
     }
@@ -105,6 +108,8 @@ class DBIter final : public Iterator {
     uint64_t bytes_read_;
     // Map to Tickers::NUMBER_ITER_SKIP
     uint64_t skip_count_;
+    // Map to Tickers::ITER_SEPARATED_VALUE_NOT_FETCHED
+    uint64_t separated_value_not_fetched_;
   };
 
   DBIter(Env* _env, const ReadOptions& read_options,
@@ -125,6 +130,9 @@ class DBIter final : public Iterator {
         direction_(kForward),
         valid_(false),
         current_entry_is_merged_(false),
+        value_separated_(false),
+        value_sequence_(0),
+        keys_only_(read_options.keys_only),
         statistics_(cf_options.statistics),
         num_internal_keys_skipped_(0),
         iterate_lower_bound_(read_options.iterate_lower_bound),
@@ -161,9 +169,10 @@ class DBIter final : public Iterator {
             assert(old_sv == nullptr ||
                    old_sv->current == self->separate_helper_);
             (void)old_sv;
-            self->PinLazyBuffer();
-            self->separate_helper_ =
+            const SeparateHelper* new_separate_helper =
                 new_sv == nullptr ? nullptr : new_sv->current;
+            self->PinLazyBuffer(new_separate_helper);
+            self->separate_helper_ = new_separate_helper;
           },
           this);
     }
@@ -238,7 +247,7 @@ class DBIter final : public Iterator {
   // PRE: iter_->Valid() && status_.ok()
   // Return false if there was an error, and status() is non-ok, valid_ = false;
   // in this case callers would usually stop what they were doing and return.
-  void PinLazyBuffer();
+  void PinLazyBuffer(const SeparateHelper* new_separate_helper);
   bool ReverseToForward();
   bool ReverseToBackward();
   bool FindValueForCurrentKey();
@@ -256,10 +265,26 @@ class DBIter final : public Iterator {
                                                ikey.sequence, iter_->value());
     }
   }
+  // Make ikey the value of saved_key_
+  void SetValue(const ParsedInternalKey& ikey) {
+    value_ = GetValue(ikey, kTypeValueIndex);
+    value_separated_ =
+        separate_helper_ != nullptr && ikey.type == kTypeValueIndex;
+    value_sequence_ = ikey.sequence;
+  }
+  // MergeHelper::TimedFullMerge() of merge_context_ onto existing_value, or,
+  // with keys_only_, an error for result instead of reading the operands
+  Status FullMerge(const Slice& user_key, LazyBuffer* existing_value,
+                   LazyBuffer* result);
 
   void PrevInternal();
   bool TooManyInternalKeysSkipped(bool increment = true);
   bool IsVisible(SequenceNumber sequence);
+  // Whether ikey_ is deleted by a range tombstone in forward traversal. If
+  // so, also returns the end and the sequence number of the newest tombstone
+  // covering it.
+  bool ShouldDeleteByRange(std::string* tombstone_end,
+                           SequenceNumber* tombstone_seq);
 
   // CanReseekToSkip() returns whether the iterator can use the optimization
   // where it reseek by sequence number to get the next key when there are too
@@ -279,6 +304,10 @@ class DBIter final : public Iterator {
       local_stats_.skip_count_--;
     }
     num_internal_keys_skipped_ = 0;
+    if (value_separated_ && !value_.valid()) {
+      local_stats_.separated_value_not_fetched_++;
+    }
+    value_separated_ = false;
     value_.reset();
     if (value_buffer_.capacity() > 1048576) {
       std::string().swap(value_buffer_);
@@ -306,6 +335,10 @@ class DBIter final : public Iterator {
   Direction direction_;
   mutable bool valid_;
   bool current_entry_is_merged_;
+  // Whether value_ is a separated value, and the sequence number of it
+  bool value_separated_;
+  SequenceNumber value_sequence_;
+  const bool keys_only_;
   // for prefix seek mode to support prev()
   Statistics* statistics_;
   uint64_t max_skip_;
@@ -430,7 +463,11 @@ bool DBIter::FindNextUserEntryInternal(bool skipping, bool prefix_check) {
   //  - none of the above  : saved_key_ can contain anything, it doesn't matter.
   uint64_t num_skipped = 0;
   bool reseek_done = false;
+  // The end of the range tombstone covering the current entry, if any
+  std::string covered_end;
+  SequenceNumber covered_seq = kMaxSequenceNumber;
   do {
+    covered_end.clear();
     if (!ParseKey(&ikey_)) {
       return false;
     }
@@ -484,7 +521,7 @@ bool DBIter::FindNextUserEntryInternal(bool skipping, bool prefix_check) {
             if (start_seqnum_ > 0) {
               if (ikey_.sequence >= start_seqnum_) {
                 saved_key_.SetInternalKey(ikey_);
-                value_ = GetValue(ikey_, kTypeValueIndex);
+                SetValue(ikey_);
                 valid_ = true;
                 return true;
               } else {
@@ -495,8 +532,7 @@ bool DBIter::FindNextUserEntryInternal(bool skipping, bool prefix_check) {
               }
             } else {
               saved_key_.SetUserKey(ikey_.user_key);
-              if (range_del_agg_.ShouldDelete(
-                      ikey_, RangeDelPositioningMode::kForwardTraversal)) {
+              if (ShouldDeleteByRange(&covered_end, &covered_seq)) {
                 // Arrange to skip all upcoming entries for this key since
                 // they are hidden by this deletion.
                 skipping = true;
@@ -504,7 +540,7 @@ bool DBIter::FindNextUserEntryInternal(bool skipping, bool prefix_check) {
                 reseek_done = false;
                 PERF_COUNTER_ADD(internal_delete_skipped_count, 1);
               } else {
-                value_ = GetValue(ikey_, kTypeValueIndex);
+                SetValue(ikey_);
                 valid_ = true;
                 return true;
               }
@@ -513,8 +549,7 @@ bool DBIter::FindNextUserEntryInternal(bool skipping, bool prefix_check) {
           case kTypeMerge:
           case kTypeMergeIndex:
             saved_key_.SetUserKey(ikey_.user_key);
-            if (range_del_agg_.ShouldDelete(
-                    ikey_, RangeDelPositioningMode::kForwardTraversal)) {
+            if (ShouldDeleteByRange(&covered_end, &covered_seq)) {
               // Arrange to skip all upcoming entries for this key since
               // they are hidden by this deletion.
               skipping = true;
@@ -580,6 +615,9 @@ bool DBIter::FindNextUserEntryInternal(bool skipping, bool prefix_check) {
       TEST_SYNC_POINT_CALLBACK("DBIter::FindNextUserEntryInternal::Reseek",
                                &last_key);
       RecordTick(statistics_, NUMBER_OF_RESEEKS_IN_ITERATION);
+    } else if (!covered_end.empty()) {
+      // Older sources may jump over the rest of the deleted range at once
+      iter_->NextSkipCovered(covered_end, covered_seq);
     } else {
       iter_->Next();
     }
@@ -631,9 +669,7 @@ bool DBIter::MergeValuesNewToOld() {
       // final result in value_. We are done!
       LazyBuffer val = GetValue(ikey, kTypeValueIndex);
       value_.reset(&value_buffer_);
-      s = MergeHelper::TimedFullMerge(merge_operator_, ikey.user_key, &val,
-                                      merge_context_.GetOperands(), &value_,
-                                      logger_, statistics_, env_, true);
+      s = FullMerge(ikey.user_key, &val, &value_);
       if (!s.ok()) {
         valid_ = false;
         status_ = s;
@@ -668,9 +704,7 @@ bool DBIter::MergeValuesNewToOld() {
   // feed null as the existing value to the merge operator, such that
   // client can differentiate this scenario and do things accordingly.
   value_.reset(&value_buffer_);
-  s = MergeHelper::TimedFullMerge(merge_operator_, saved_key_.GetUserKey(),
-                                  nullptr, merge_context_.GetOperands(),
-                                  &value_, logger_, statistics_, env_, true);
+  s = FullMerge(saved_key_.GetUserKey(), nullptr, &value_);
   if (!s.ok()) {
     valid_ = false;
     status_ = s;
@@ -710,11 +744,46 @@ void DBIter::Prev() {
   }
 }
 
-void DBIter::PinLazyBuffer() {
-  value_.pin(LazyBufferPinLevel::DB);
+void DBIter::PinLazyBuffer(const SeparateHelper* new_separate_helper) {
+  if (keys_only_ && value_separated_ && !value_.valid() &&
+      new_separate_helper != nullptr) {
+    // Look the separated value up again in the new version instead of
+    // fetching it before the old one goes away
+    uint64_t file_number = value_.file_number();
+    value_ = new_separate_helper->TransToCombined(
+        saved_key_.GetUserKey(), value_sequence_,
+        LazyBuffer(SeparateHelper::EncodeFileNumber(file_number)));
+  } else {
+    value_.pin(LazyBufferPinLevel::DB);
+  }
   merge_context_.PinLazyBuffer();
 }
 
+Status DBIter::FullMerge(const Slice& user_key, LazyBuffer* existing_value,
+                         LazyBuffer* result) {
+  // The result takes the place of value_
+  value_separated_ = false;
+  if (!keys_only_) {
+    return MergeHelper::TimedFullMerge(
+        merge_operator_, user_key, existing_value, merge_context_.GetOperands(),
+        result, logger_, statistics_, env_, true);
+  }
+  // The operands may be separated, count the ones never fetched
+  auto& operands = merge_context_.GetOperands();
+  if (existing_value != nullptr && !existing_value->valid()) {
+    local_stats_.separated_value_not_fetched_++;
+  }
+  for (auto& operand : operands) {
+    if (!operand.valid()) {
+      local_stats_.separated_value_not_fetched_++;
+    }
+  }
+  merge_context_.Clear();
+  *result = LazyBuffer(Status::NotSupported(
+      "DBIter", "merged value is not available with keys_only"));
+  return Status::OK();
+}
+
 bool DBIter::ReverseToForward() {
   assert(iter_->status().ok());
 
@@ -879,7 +948,7 @@ bool DBIter::FindValueForCurrentKey() {
           last_key_entry_type = kTypeRangeDeletion;
           PERF_COUNTER_ADD(internal_delete_skipped_count, 1);
         } else {
-          value_ = GetValue(ikey, kTypeValueIndex);
+          SetValue(ikey);
           value_.pin(LazyBufferPinLevel::Internal);
         }
         merge_context_.Clear();
@@ -933,18 +1002,12 @@ bool DBIter::FindValueForCurrentKey() {
           last_not_merge_type == kTypeSingleDeletion ||
           last_not_merge_type == kTypeRangeDeletion) {
         value_.reset(&value_buffer_);
-        s = MergeHelper::TimedFullMerge(merge_operator_,
-                                        saved_key_.GetUserKey(), nullptr,
-                                        merge_context_.GetOperands(), &value_,
-                                        logger_, statistics_, env_, true);
+        s = FullMerge(saved_key_.GetUserKey(), nullptr, &value_);
       } else {
         assert(last_not_merge_type == kTypeValue ||
                last_not_merge_type == kTypeValueIndex);
         LazyBuffer merge_result(&value_buffer_);
-        s = MergeHelper::TimedFullMerge(
-            merge_operator_, saved_key_.GetUserKey(), &value_,
-            merge_context_.GetOperands(), &merge_result, logger_, statistics_,
-            env_, true);
+        s = FullMerge(saved_key_.GetUserKey(), &value_, &merge_result);
         value_ = std::move(merge_result);
       }
       break;
@@ -1011,7 +1074,7 @@ bool DBIter::FindValueForCurrentKeyUsingSeek() {
     return true;
   }
   if (ikey.type == kTypeValue || ikey.type == kTypeValueIndex) {
-    value_ = GetValue(ikey, kTypeValueIndex);
+    SetValue(ikey);
     value_.pin(LazyBufferPinLevel::Internal);
     valid_ = true;
     return true;
@@ -1047,10 +1110,7 @@ bool DBIter::FindValueForCurrentKeyUsingSeek() {
     } else if (ikey.type == kTypeValue || ikey.type == kTypeValueIndex) {
       LazyBuffer val = GetValue(ikey, kTypeValueIndex);
       value_.reset(&value_buffer_);
-      Status s = MergeHelper::TimedFullMerge(
-          merge_operator_, saved_key_.GetUserKey(), &val,
-          merge_context_.GetOperands(), &value_, logger_, statistics_, env_,
-          true);
+      Status s = FullMerge(saved_key_.GetUserKey(), &val, &value_);
       if (!s.ok()) {
         valid_ = false;
         status_ = s;
@@ -1068,9 +1128,7 @@ bool DBIter::FindValueForCurrentKeyUsingSeek() {
   }
 
   value_.reset(&value_buffer_);
-  Status s = MergeHelper::TimedFullMerge(
-      merge_operator_, saved_key_.GetUserKey(), nullptr,
-      merge_context_.GetOperands(), &value_, logger_, statistics_, env_, true);
+  Status s = FullMerge(saved_key_.GetUserKey(), nullptr, &value_);
   if (!s.ok()) {
     valid_ = false;
     status_ = s;
@@ -1167,6 +1225,17 @@ bool DBIter::IsVisible(SequenceNumber sequence) {
          (read_callback_ == nullptr || read_callback_->IsVisible(sequence));
 }
 
+bool DBIter::ShouldDeleteByRange(std::string* tombstone_end,
+                                 SequenceNumber* tombstone_seq) {
+  ParsedInternalKey end;
+  if (!range_del_agg_.ShouldDeleteForward(ikey_, &end, tombstone_seq)) {
+    return false;
+  }
+  tombstone_end->clear();
+  AppendInternalKey(tombstone_end, end);
+  return true;
+}
+
 bool DBIter::CanReseekToSkip() {
   return read_callback_ == nullptr ||
          read_callback_->MaxUnpreparedSequenceNumber() == 0;
@@ -1614,6 +1614,116 @@ TEST_P(DBIteratorTest, ReadAhead) {
   delete iter;
 }
 
+TEST_P(DBIteratorTest, AsyncPrefetch) {
+  Options options;
+  env_->count_random_reads_ = true;
+  options.env = env_;
+  options.disable_auto_compactions = true;
+  options.blob_size = -1;
+  options.write_buffer_size = 4 << 20;
+  BlockBasedTableOptions table_options;
+  table_options.block_size = 1024;
+  table_options.no_block_cache = true;
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+
+  // Two files in L1, so that the scan moves between files of a level
+  std::string value(1024, 'a');
+  for (int i = 0; i < 50; i++) {
+    Put(Key(i), value);
+  }
+  ASSERT_OK(Flush());
+  MoveFilesToLevel(1);
+  for (int i = 50; i < 100; i++) {
+    Put(Key(i), value);
+  }
+  ASSERT_OK(Flush());
+  MoveFilesToLevel(1);
+#ifndef ROCKSDB_LITE
+  ASSERT_EQ("0,2", FilesPerLevel());
+#endif  // !ROCKSDB_LITE
+
+  auto scan = [&](const ReadOptions& read_options) {
+    std::unique_ptr<Iterator> iter(NewIterator(read_options));
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      EXPECT_EQ(value, iter->value());
+      count++;
+    }
+    EXPECT_OK(iter->status());
+    EXPECT_EQ(100, count);
+    // Going back must not keep the stale window
+    iter->Seek(Key(10));
+    for (int i = 10; i < 100; i++, iter->Next()) {
+      EXPECT_TRUE(iter->Valid());
+      EXPECT_EQ(Key(i), iter->key());
+    }
+  };
+
+  ReadOptions read_options;
+  int prefetches = env_->prefetch_async_counter_.Read();
+  scan(read_options);
+  ASSERT_EQ(prefetches, env_->prefetch_async_counter_.Read());
+
+  read_options.async_prefetch_size = 8 * 1024;
+  scan(read_options);
+  // Every file of 50 blocks takes several windows
+  ASSERT_GT(env_->prefetch_async_counter_.Read(), prefetches + 4);
+}
+
+TEST_P(DBIteratorTest, KeysOnly) {
+  Options options = CurrentOptions();
+  options.blob_size = 32;  // turn on kv separation
+  options.compression = kNoCompression;
+  options.disable_auto_compactions = true;
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  options.statistics = TERARKDB_NAMESPACE::CreateDBStatistics();
+  DestroyAndReopen(options);
+
+  std::string value(100, 'v');
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), value));
+  }
+  ASSERT_OK(Flush());
+  ASSERT_OK(Merge(Key(100), "a"));
+  ASSERT_OK(Merge(Key(100), "b"));
+
+  ReadOptions read_options;
+  read_options.keys_only = true;
+  uint64_t not_fetched =
+      TestGetTickerCount(options, ITER_SEPARATED_VALUE_NOT_FETCHED);
+  std::unique_ptr<Iterator> iter(NewIterator(read_options));
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(101, count);
+  iter.reset();
+  ASSERT_GE(TestGetTickerCount(options, ITER_SEPARATED_VALUE_NOT_FETCHED),
+            not_fetched + 100);
+
+  // Separated values are still read when asked for
+  iter.reset(NewIterator(read_options));
+  iter->Seek(Key(10));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(value, iter->value());
+
+  // But merged values are not
+  iter->Seek(Key(100));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(100), iter->key());
+  iter->value();
+  ASSERT_FALSE(iter->Valid());
+  ASSERT_TRUE(iter->status().IsNotSupported());
+
+  read_options.keys_only = false;
+  iter.reset(NewIterator(read_options));
+  iter->Seek(Key(100));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("a,b", iter->value());
+}
+
 // Insert a key, create a snapshot iterator, overwrite key lots of times,
 // seek to a smaller key. Expect DBIter to fall back to a seek instead of
 // going through all the overwrites linearly.
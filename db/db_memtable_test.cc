@@ -4,6 +4,7 @@
 //  (found in the LICENSE.Apache file in the root directory).
 
 #include <memory>
+#include <set>
 #include <string>
 
 #include "db/db_test_util.h"
@@ -218,6 +219,310 @@ TEST_F(DBMemTableTest, DuplicateSeq) {
   delete mem;
 }
 
+TEST_F(DBMemTableTest, HashDualListOrderedIterator) {
+  Options options;
+  options.prefix_extractor.reset(NewFixedPrefixTransform(2));
+  options.memtable_factory.reset(NewConcurrentHashDualListReqFactory(
+      16 /* bucket_count */, 0, 4096, 0, false));
+  InternalKeyComparator cmp(BytewiseComparator());
+  ImmutableCFOptions ioptions(options);
+  WriteBufferManager wb(options.db_write_buffer_size);
+  std::unique_ptr<MemTable> mem(new MemTable(
+      cmp, ioptions, MutableCFOptions(options),
+      /* needs_dup_key_check */ false, &wb, kMaxSequenceNumber, 0));
+
+  Random rnd(301);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; ++i) {
+    keys.push_back(ToString(rnd.Uniform(100000) + 100000));
+  }
+  auto less = [&](const std::string& a, const std::string& b) {
+    return cmp.Compare(a, b) < 0;
+  };
+  std::set<std::string, decltype(less)> expected(less);
+  SequenceNumber seq = 1;
+  for (auto& key : keys) {
+    // Some user keys get several versions
+    ASSERT_TRUE(mem->Add(seq++, kTypeValue, key, "value"));
+    expected.insert(InternalKey(key, seq - 1, kTypeValue).Encode().ToString());
+  }
+
+  ReadOptions ro;
+  ro.total_order_seek = true;
+  Arena arena;
+  ScopedArenaIterator iter(mem->NewIterator(ro, &arena));
+  auto expected_iter = expected.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_TRUE(expected_iter != expected.end());
+    ASSERT_EQ(*expected_iter, iter->key().ToString());
+    ++expected_iter;
+  }
+  ASSERT_TRUE(expected_iter == expected.end());
+
+  // Seek lands on the first version of the next user key when every
+  // version of the target is older than the seek sequence
+  std::string target = InternalKey(keys[0], 0, kTypeValue).Encode().ToString();
+  iter->Seek(target);
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(*expected.lower_bound(target), iter->key().ToString());
+
+  // Backward moves switch to the sorted copy
+  expected_iter = expected.lower_bound(target);
+  if (expected_iter != expected.begin()) {
+    iter->Prev();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(*std::prev(expected_iter), iter->key().ToString());
+  }
+  iter->SeekToLast();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(*expected.rbegin(), iter->key().ToString());
+}
+
+TEST_F(DBMemTableTest, PrefixSkipListOrderedIterator) {
+  Options options;
+  // Fewer prefixes than tenants, the keys of the others are stored in full
+  options.memtable_factory.reset(
+      NewPrefixSkipListRepFactory(24 /* prefix_length */, 3));
+  InternalKeyComparator cmp(BytewiseComparator());
+  ImmutableCFOptions ioptions(options);
+  WriteBufferManager wb(options.db_write_buffer_size);
+  std::unique_ptr<MemTable> mem(new MemTable(
+      cmp, ioptions, MutableCFOptions(options),
+      /* needs_dup_key_check */ false, &wb, kMaxSequenceNumber, 0));
+
+  Random rnd(301);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; ++i) {
+    std::string tenant = "tenant_" + ToString(100 + rnd.Uniform(5));
+    tenant.resize(24, 'p');
+    // Some keys are shorter than the prefix, or end in it
+    int suffix = rnd.Uniform(1000);
+    keys.push_back(suffix < 20 ? tenant.substr(0, suffix)
+                               : tenant + ToString(suffix));
+  }
+  auto less = [&](const std::string& a, const std::string& b) {
+    return cmp.Compare(a, b) < 0;
+  };
+  std::set<std::string, decltype(less)> expected(less);
+  SequenceNumber seq = 1;
+  for (auto& key : keys) {
+    ASSERT_TRUE(mem->Add(seq++, kTypeValue, key, "value" + key));
+    expected.insert(InternalKey(key, seq - 1, kTypeValue).Encode().ToString());
+  }
+  ASSERT_FALSE(mem->Add(seq - 1, kTypeValue, keys.back(), "value"));
+
+  ReadOptions ro;
+  Arena arena;
+  ScopedArenaIterator iter(mem->NewIterator(ro, &arena));
+  auto expected_iter = expected.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_TRUE(expected_iter != expected.end());
+    ASSERT_EQ(*expected_iter, iter->key().ToString());
+    ASSERT_EQ("value" + ExtractUserKey(iter->key()).ToString(),
+              iter->value().ToString());
+    ++expected_iter;
+  }
+  ASSERT_TRUE(expected_iter == expected.end());
+
+  for (int i = 0; i < 100; ++i) {
+    const std::string& key = keys[rnd.Uniform(static_cast<int>(keys.size()))];
+    std::string target =
+        InternalKey(key + "a", kMaxSequenceNumber, kTypeValue)
+            .Encode()
+            .ToString();
+    iter->Seek(target);
+    auto lower = expected.lower_bound(target);
+    ASSERT_EQ(lower != expected.end(), iter->Valid());
+    if (iter->Valid()) {
+      ASSERT_EQ(*lower, iter->key().ToString());
+    }
+    iter->SeekForPrev(target);
+    ASSERT_EQ(lower != expected.begin(), iter->Valid());
+    if (iter->Valid()) {
+      ASSERT_EQ(*std::prev(lower), iter->key().ToString());
+      iter->Prev();
+      if (std::prev(lower) != expected.begin()) {
+        ASSERT_EQ(*std::prev(lower, 2), iter->key().ToString());
+      }
+    }
+  }
+
+  // Through a DB
+  options.create_if_missing = true;
+  options.env = env_;
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("tenant_000000000000000001key1", "v1"));
+  ASSERT_OK(Put("tenant_000000000000000001key2", "v2"));
+  ASSERT_OK(Put("short", "v3"));
+  ASSERT_OK(Delete("tenant_000000000000000001key2"));
+  ASSERT_EQ("v1", Get("tenant_000000000000000001key1"));
+  ASSERT_EQ("NOT_FOUND", Get("tenant_000000000000000001key2"));
+  ASSERT_EQ("v3", Get("short"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v1", Get("tenant_000000000000000001key1"));
+  ASSERT_EQ("NOT_FOUND", Get("tenant_000000000000000001key2"));
+  ASSERT_EQ("v3", Get("short"));
+}
+
+TEST_F(DBMemTableTest, ShardedOrderedIterator) {
+  Options options;
+  options.memtable_factory.reset(NewShardedRepFactory(nullptr, 4));
+  InternalKeyComparator cmp(BytewiseComparator());
+  ImmutableCFOptions ioptions(options);
+  WriteBufferManager wb(options.db_write_buffer_size);
+  std::unique_ptr<MemTable> mem(new MemTable(
+      cmp, ioptions, MutableCFOptions(options),
+      /* needs_dup_key_check */ false, &wb, kMaxSequenceNumber, 0));
+
+  Random rnd(301);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; ++i) {
+    // Some keys get several versions
+    keys.push_back("key" + ToString(rnd.Uniform(500)));
+  }
+  auto less = [&](const std::string& a, const std::string& b) {
+    return cmp.Compare(a, b) < 0;
+  };
+  std::set<std::string, decltype(less)> expected(less);
+  SequenceNumber seq = 1;
+  for (auto& key : keys) {
+    ASSERT_TRUE(mem->Add(seq++, kTypeValue, key, "value" + key));
+    expected.insert(InternalKey(key, seq - 1, kTypeValue).Encode().ToString());
+  }
+  ASSERT_FALSE(mem->Add(seq - 1, kTypeValue, keys.back(), "value"));
+
+  ReadOptions ro;
+  Arena arena;
+  ScopedArenaIterator iter(mem->NewIterator(ro, &arena));
+  auto expected_iter = expected.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_TRUE(expected_iter != expected.end());
+    ASSERT_EQ(*expected_iter, iter->key().ToString());
+    ++expected_iter;
+  }
+  ASSERT_TRUE(expected_iter == expected.end());
+  auto expected_riter = expected.rbegin();
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    ASSERT_TRUE(expected_riter != expected.rend());
+    ASSERT_EQ(*expected_riter, iter->key().ToString());
+    ++expected_riter;
+  }
+  ASSERT_TRUE(expected_riter == expected.rend());
+
+  for (int i = 0; i < 100; ++i) {
+    const std::string& key = keys[rnd.Uniform(static_cast<int>(keys.size()))];
+    std::string target =
+        InternalKey(key + "a", kMaxSequenceNumber, kTypeValue)
+            .Encode()
+            .ToString();
+    iter->Seek(target);
+    auto lower = expected.lower_bound(target);
+    ASSERT_EQ(lower != expected.end(), iter->Valid());
+    if (iter->Valid()) {
+      ASSERT_EQ(*lower, iter->key().ToString());
+      // Changes direction
+      iter->Prev();
+      ASSERT_EQ(lower != expected.begin(), iter->Valid());
+      if (iter->Valid()) {
+        ASSERT_EQ(*std::prev(lower), iter->key().ToString());
+        iter->Next();
+        ASSERT_EQ(*lower, iter->key().ToString());
+      }
+    }
+    iter->SeekForPrev(target);
+    ASSERT_EQ(lower != expected.begin(), iter->Valid());
+    if (iter->Valid()) {
+      ASSERT_EQ(*std::prev(lower), iter->key().ToString());
+    }
+  }
+
+  // Through a DB, with concurrent writers
+  options.create_if_missing = true;
+  options.env = env_;
+  options.allow_concurrent_memtable_write = true;
+  DestroyAndReopen(options);
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 100; ++i) {
+        std::string key = "key" + ToString(t) + "_" + ToString(i);
+        ASSERT_OK(Put(key, "v" + key));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_OK(Delete("key0_0"));
+  ASSERT_EQ("NOT_FOUND", Get("key0_0"));
+  ASSERT_EQ("vkey3_99", Get("key3_99"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("NOT_FOUND", Get("key0_0"));
+  ASSERT_EQ("vkey3_99", Get("key3_99"));
+  std::unique_ptr<Iterator> db_iter(db_->NewIterator(ReadOptions()));
+  int count = 0;
+  for (db_iter->SeekToFirst(); db_iter->Valid(); db_iter->Next()) {
+    ++count;
+  }
+  ASSERT_EQ(399, count);
+}
+
+TEST_F(DBMemTableTest, HashCuckooVersions) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.memtable_factory.reset(
+      NewHashCuckooRepFactory(options.write_buffer_size));
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  options.allow_concurrent_memtable_write = true;
+  DestroyAndReopen(options);
+
+  // The older versions are read through the overflow
+  ASSERT_OK(Put("key", "v1"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("key", "v2"));
+  ASSERT_OK(Merge("counter", "a"));
+  ASSERT_OK(Merge("counter", "b"));
+  ASSERT_EQ("v2", Get("key"));
+  ASSERT_EQ("v1", Get("key", snapshot));
+  ASSERT_EQ("a,b", Get("counter"));
+  ASSERT_EQ("NOT_FOUND", Get("missing"));
+
+  // Concurrent writers of the same keys
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 100; ++i) {
+        ASSERT_OK(Merge("counter" + ToString(i % 10), ToString(t)));
+        ASSERT_OK(Put("key" + ToString(i), "v" + ToString(t)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto check = [&] {
+    ASSERT_EQ("v1", Get("key", snapshot));
+    ASSERT_EQ("v2", Get("key"));
+    ASSERT_EQ("a,b", Get("counter"));
+    for (int i = 0; i < 10; ++i) {
+      std::string operands = Get("counter" + ToString(i));
+      // The 40 operands of one digit
+      ASSERT_EQ(79, operands.size());
+      ASSERT_EQ(39, std::count(operands.begin(), operands.end(), ','));
+    }
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ++count;
+    }
+    ASSERT_EQ(112, count);
+  };
+  check();
+  ASSERT_OK(Flush());
+  check();
+  db_->ReleaseSnapshot(snapshot);
+}
+
 TEST_F(DBMemTableTest, InsertWithHint) {
   Options options;
   options.allow_concurrent_memtable_write = false;
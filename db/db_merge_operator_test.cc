@@ -153,6 +153,36 @@ TEST_F(DBMergeOperatorTest, MergeErrorOnWrite) {
   VerifyDBInternal({{"k1", "corrupted"}, {"k1", "v2"}, {"k1", "v1"}});
 }
 
+TEST_F(DBMergeOperatorTest, MaxSuccessiveMergesInRecovery) {
+  Options options;
+  options.create_if_missing = true;
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  options.avoid_flush_during_recovery = true;
+  options.env = env_;
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("k1", "a"));
+  ASSERT_OK(Merge("k1", "b"));
+  ASSERT_OK(Merge("k1", "c"));
+  ASSERT_OK(Merge("k1", "d"));
+  ASSERT_OK(Merge("k2", "x"));
+  ASSERT_OK(Merge("k2", "y"));
+  ASSERT_OK(Merge("k2", "z"));
+
+  // The base value of k1 is in the memtable, so the chain is folded while the
+  // log is replayed. k2 has no base value, and is left as it is.
+  options.max_successive_merges = 2;
+  Reopen(options);
+  VerifyDBInternal({{"k1", "a,b,c,d"},
+                    {"k1", "c"},
+                    {"k1", "b"},
+                    {"k1", "a"},
+                    {"k2", "z"},
+                    {"k2", "y"},
+                    {"k2", "x"}});
+  ASSERT_EQ("a,b,c,d", Get("k1"));
+  ASSERT_EQ("x,y,z", Get("k2"));
+}
+
 TEST_F(DBMergeOperatorTest, MergeErrorOnIteration) {
   Options options;
   options.create_if_missing = true;
@@ -1576,8 +1576,61 @@ TEST_F(DBRangeDelTest, SeekInDeleteRange) {
         skipped);
   };
 
-  test(Slice("b" + Key(5)), Slice("b" + Key(10)), 5, false);
-  test(Slice("b" + Key(5)), Slice("c" + Key(10)), 251, true);
+  // The L2 files are older than the tombstone, the first deleted key seeks
+  // them past it
+  test(Slice("b" + Key(5)), Slice("b" + Key(10)), 1, false);
+  test(Slice("b" + Key(5)), Slice("c" + Key(10)), 1, true);
+}
+
+TEST_F(DBRangeDelTest, SkipCoveredKeysKeepsNewerKeys) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  Reopen(options);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_OK(Put(Key(i), "old" + ToString(i)));
+  }
+  ASSERT_OK(Flush());
+  MoveFilesToLevel(2);
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(),
+                             Key(10), Key(90)));
+  // Newer than the tombstone, in an L0 file and in the memtable
+  ASSERT_OK(Put(Key(30), "new30"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(Put(Key(60), "new60"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put(Key(70), "new70"));
+
+  get_perf_context()->Reset();
+  std::vector<std::string> keys;
+  auto* iter = db_->NewIterator(ReadOptions());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    keys.push_back(iter->key().ToString());
+  }
+  ASSERT_OK(iter->status());
+  delete iter;
+  ASSERT_EQ(23, keys.size());
+  ASSERT_EQ(Key(9), keys[9]);
+  ASSERT_EQ(Key(30), keys[10]);
+  ASSERT_EQ(Key(60), keys[11]);
+  ASSERT_EQ(Key(70), keys[12]);
+  ASSERT_EQ(Key(90), keys[13]);
+  // The first deleted key seeks L2 past the tombstone, the sources with
+  // newer keys are still stepped through
+  ASSERT_EQ(
+      1, static_cast<int>(get_perf_context()->internal_delete_skipped_count));
+
+  ReadOptions read_opts;
+  read_opts.snapshot = snapshot;
+  iter = db_->NewIterator(read_opts);
+  iter->Seek(Key(50));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(60), iter->key());
+  ASSERT_EQ("new60", iter->value());
+  iter->Next();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(90), iter->key());
+  delete iter;
+  db_->ReleaseSnapshot(snapshot);
 }
 
 #endif  // ROCKSDB_LITE
@@ -0,0 +1,178 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "rocksdb/db.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/string_util.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+#ifndef ROCKSDB_LITE
+
+class DBSecondaryTest : public testing::Test {
+ public:
+  DBSecondaryTest()
+      : dbname_(test::PerThreadDBPath("db_secondary_test")),
+        secondary_path_(test::PerThreadDBPath("db_secondary_test_secondary")) {
+    options_.create_if_missing = true;
+    options_.max_open_files = -1;
+    DestroyDB(dbname_, options_);
+    Env::Default()->CreateDirIfMissing(secondary_path_);
+    DB* db = nullptr;
+    EXPECT_OK(DB::Open(options_, dbname_, &db));
+    primary_.reset(db);
+  }
+
+  ~DBSecondaryTest() {
+    secondary_.reset();
+    primary_.reset();
+    DestroyDB(dbname_, options_);
+  }
+
+  void OpenSecondary() {
+    DB* db = nullptr;
+    ASSERT_OK(DB::OpenAsSecondary(options_, dbname_, secondary_path_, &db));
+    secondary_.reset(db);
+  }
+
+  void ReopenPrimary() {
+    primary_.reset();
+    DB* db = nullptr;
+    ASSERT_OK(DB::Open(options_, dbname_, &db));
+    primary_.reset(db);
+  }
+
+  std::string Get(DB* db, const std::string& key) {
+    std::string value;
+    Status s = db->Get(ReadOptions(), key, &value);
+    if (s.IsNotFound()) {
+      return "NOT_FOUND";
+    }
+    EXPECT_OK(s);
+    return value;
+  }
+
+  const std::string dbname_;
+  const std::string secondary_path_;
+  Options options_;
+  std::unique_ptr<DB> primary_;
+  std::unique_ptr<DB> secondary_;
+};
+
+TEST_F(DBSecondaryTest, CatchUpWithWal) {
+  ASSERT_OK(primary_->Put(WriteOptions(), "a", "v1"));
+  OpenSecondary();
+  ASSERT_EQ("v1", Get(secondary_.get(), "a"));
+
+  ASSERT_OK(primary_->Put(WriteOptions(), "a", "v2"));
+  ASSERT_OK(primary_->Put(WriteOptions(), "b", "v1"));
+  ASSERT_EQ("v1", Get(secondary_.get(), "a"));
+  ASSERT_EQ("NOT_FOUND", Get(secondary_.get(), "b"));
+
+  ASSERT_OK(secondary_->TryCatchUpWithPrimary());
+  ASSERT_EQ("v2", Get(secondary_.get(), "a"));
+  ASSERT_EQ("v1", Get(secondary_.get(), "b"));
+
+  ASSERT_OK(primary_->Delete(WriteOptions(), "a"));
+  ASSERT_OK(secondary_->TryCatchUpWithPrimary());
+  ASSERT_EQ("NOT_FOUND", Get(secondary_.get(), "a"));
+
+  ASSERT_TRUE(secondary_->Put(WriteOptions(), "c", "v1").IsNotSupported());
+  ASSERT_TRUE(primary_->TryCatchUpWithPrimary().IsNotSupported());
+}
+
+TEST_F(DBSecondaryTest, CatchUpWithFlushAndCompaction) {
+  OpenSecondary();
+  for (int i = 0; i < 3; ++i) {
+    for (int k = 0; k < 100; ++k) {
+      ASSERT_OK(primary_->Put(WriteOptions(), "key" + ToString(k),
+                              "v" + ToString(i)));
+    }
+    ASSERT_OK(primary_->Flush(FlushOptions()));
+    ASSERT_OK(secondary_->TryCatchUpWithPrimary());
+    ASSERT_EQ("v" + ToString(i), Get(secondary_.get(), "key7"));
+  }
+  ASSERT_OK(primary_->Put(WriteOptions(), "key7", "unflushed"));
+  ASSERT_OK(primary_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_OK(secondary_->TryCatchUpWithPrimary());
+  ASSERT_EQ("unflushed", Get(secondary_.get(), "key7"));
+
+  std::unique_ptr<Iterator> iter(secondary_->NewIterator(ReadOptions()));
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ++count;
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(100, count);
+}
+
+TEST_F(DBSecondaryTest, NewManifest) {
+  ASSERT_OK(primary_->Put(WriteOptions(), "a", "v1"));
+  OpenSecondary();
+  // The primary writes a new MANIFEST when it is opened again
+  ReopenPrimary();
+  ASSERT_OK(primary_->Put(WriteOptions(), "a", "v2"));
+  ASSERT_OK(primary_->Flush(FlushOptions()));
+  ReopenPrimary();
+  ASSERT_OK(primary_->Put(WriteOptions(), "b", "v1"));
+  ASSERT_OK(secondary_->TryCatchUpWithPrimary());
+  ASSERT_EQ("v2", Get(secondary_.get(), "a"));
+  ASSERT_EQ("v1", Get(secondary_.get(), "b"));
+}
+
+TEST_F(DBSecondaryTest, ColumnFamilies) {
+  ColumnFamilyHandle* handle = nullptr;
+  ASSERT_OK(primary_->CreateColumnFamily(options_, "one", &handle));
+  ASSERT_OK(primary_->Put(WriteOptions(), handle, "a", "v1"));
+
+  std::vector<ColumnFamilyDescriptor> column_families = {
+      ColumnFamilyDescriptor(kDefaultColumnFamilyName, options_),
+      ColumnFamilyDescriptor("one", options_),
+      ColumnFamilyDescriptor("two", options_)};
+  std::vector<ColumnFamilyHandle*> handles;
+  DB* db = nullptr;
+  // Not created by the primary yet
+  ASSERT_TRUE(DB::OpenAsSecondary(options_, dbname_, secondary_path_,
+                                  column_families, &handles, &db)
+                  .IsInvalidArgument());
+  column_families.pop_back();
+  ASSERT_OK(DB::OpenAsSecondary(options_, dbname_, secondary_path_,
+                                column_families, &handles, &db));
+  secondary_.reset(db);
+  ASSERT_EQ(2u, handles.size());
+  ColumnFamilyHandle* two = nullptr;
+  ASSERT_TRUE(
+      secondary_->CreateColumnFamily(options_, "two", &two).IsNotSupported());
+
+  std::string value;
+  ASSERT_OK(secondary_->Get(ReadOptions(), handles[1], "a", &value));
+  ASSERT_EQ("v1", value);
+  ASSERT_OK(primary_->Put(WriteOptions(), handle, "a", "v2"));
+  ASSERT_OK(primary_->Flush(FlushOptions(), handle));
+  ASSERT_OK(secondary_->TryCatchUpWithPrimary());
+  ASSERT_OK(secondary_->Get(ReadOptions(), handles[1], "a", &value));
+  ASSERT_EQ("v2", value);
+
+  for (auto h : handles) {
+    delete h;
+  }
+  delete handle;
+}
+
+#endif  // !ROCKSDB_LITE
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -481,6 +481,47 @@ TEST_F(DBTestTailingIterator, TailingIteratorGap) {
   ASSERT_EQ("40", it->key().ToString());
 }
 
+TEST_F(DBTestTailingIterator, TailingIteratorKeepsLevelIterators) {
+  // The table iterators of files still in the new version are kept when the
+  // super version changes
+  CreateAndReopenWithCF({"pikachu"}, CurrentOptions());
+
+  ReadOptions read_options;
+  read_options.tailing = true;
+
+  ASSERT_OK(Put(1, "10", "10"));
+  ASSERT_OK(Put(1, "20", "20"));
+  ASSERT_OK(Flush(1));
+  MoveFilesToLevel(1, 1);
+
+  std::unique_ptr<Iterator> it(db_->NewIterator(read_options, handles_[1]));
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ("10", it->key().ToString());
+
+  int kept_file_iters = 0;
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "ForwardLevelIterator::Renew:KeepFileIter",
+      [&](void* /*arg*/) { kept_file_iters++; });
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->EnableProcessing();
+
+  ASSERT_OK(Put(1, "15", "15"));
+  ASSERT_OK(Flush(1));
+
+  it->Seek("10");
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_EQ(1, kept_file_iters);
+
+  for (auto key : {"10", "15", "20"}) {
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(key, it->key().ToString());
+    it->Next();
+  }
+  ASSERT_FALSE(it->Valid());
+  ASSERT_OK(it->status());
+}
+
 TEST_F(DBTestTailingIterator, SeekWithUpperBoundBug) {
   ReadOptions read_options;
   read_options.tailing = true;
@@ -14,7 +14,9 @@
 #include "db/read_callback.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
+#include "rocksdb/background_coordinator.h"
 #include "rocksdb/persistent_cache.h"
+#include "rocksdb/resource_group.h"
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/wal_filter.h"
 
@@ -2763,6 +2765,58 @@ TEST_F(DBTest2, TraceWithLimit) {
   ASSERT_OK(DestroyDB(dbname2, options));
 }
 
+TEST_F(DBTest2, TraceMultiThreadReplay) {
+  Options options = CurrentOptions();
+  ReadOptions ro;
+  EnvOptions env_opts;
+  TraceOptions trace_opts;
+  Reopen(options);
+
+  std::string trace_filename = dbname_ + "/rocksdb.trace2";
+  std::unique_ptr<TraceWriter> trace_writer;
+  ASSERT_OK(NewFileTraceWriter(env_, env_opts, trace_filename, &trace_writer));
+  ASSERT_OK(db_->StartTrace(trace_opts, std::move(trace_writer)));
+  const int kKeys = 20;
+  const int kRounds = 10;
+  for (int round = 0; round < kRounds; ++round) {
+    for (int i = 0; i < kKeys; ++i) {
+      ASSERT_OK(Put(Key(i), "v" + ToString(round)));
+    }
+  }
+  ASSERT_EQ("v" + ToString(kRounds - 1), Get(Key(0)));
+  ASSERT_OK(db_->EndTrace());
+
+  std::string dbname2 = test::TmpDir(env_) + "/db_replay3";
+  ASSERT_OK(DestroyDB(dbname2, options));
+  DB* db2 = nullptr;
+  options.create_if_missing = true;
+  ASSERT_OK(DB::Open(options, dbname2, &db2));
+
+  std::unique_ptr<TraceReader> trace_reader;
+  ASSERT_OK(NewFileTraceReader(env_, env_opts, trace_filename, &trace_reader));
+  Replayer replayer(db2, {db2->DefaultColumnFamily()},
+                    std::move(trace_reader));
+  ReplayOptions replay_options;
+  replay_options.num_threads = 4;
+  replay_options.fast_forward = 0;
+  ReplayStats replay_stats;
+  ASSERT_OK(replayer.Replay(replay_options, &replay_stats));
+
+  // The writes of a key are replayed in their recorded order
+  std::string value;
+  for (int i = 0; i < kKeys; ++i) {
+    ASSERT_OK(db2->Get(ro, Key(i), &value));
+    ASSERT_EQ("v" + ToString(kRounds - 1), value);
+  }
+  ASSERT_EQ(uint64_t(kKeys * kRounds),
+            replay_stats.latency[kTraceWrite].num());
+  ASSERT_EQ(1U, replay_stats.latency[kTraceGet].num());
+  ASSERT_NE(std::string::npos, replay_stats.ToString().find("write"));
+
+  delete db2;
+  ASSERT_OK(DestroyDB(dbname2, options));
+}
+
 #endif  // ROCKSDB_LITE
 
 TEST_F(DBTest2, LazyBufferAndMmapReads) {
@@ -3096,6 +3150,252 @@ TEST_F(DBTest2, TestCompactFiles) {
   TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
   TERARKDB_NAMESPACE::SyncPoint::GetInstance()->ClearAllCallBacks();
 }
+
+TEST_F(DBTest2, LazyOpenDeepSst) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  options.max_open_files = -1;
+  options.lazy_open_deep_sst = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Flush());
+  MoveFilesToLevel(2);
+  ASSERT_OK(Put("b", "vb"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("1,0,1", FilesPerLevel());
+
+  options.statistics = TERARKDB_NAMESPACE::CreateDBStatistics();
+  Reopen(options);
+  // Only the L0 file is opened by DB::Open()
+  ASSERT_EQ(1U, TestGetTickerCount(options, NO_FILE_OPENS));
+  ASSERT_EQ("vb", Get("b"));
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ(2U, TestGetTickerCount(options, NO_FILE_OPENS));
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ(2U, TestGetTickerCount(options, NO_FILE_OPENS));
+}
+
+TEST_F(DBTest2, TableCacheMemoryBudget) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  options.table_cache_memory_budget = 1 << 20;
+  DestroyAndReopen(options);
+  ASSERT_EQ(1U << 20, dbfull()->TEST_table_cache()->GetCapacity());
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_OK(Put(Key(i), "v" + ToString(i)));
+    ASSERT_OK(Flush());
+  }
+  options.statistics = TERARKDB_NAMESPACE::CreateDBStatistics();
+  Reopen(options);
+  // Nothing but map ssts is opened eagerly, readers are charged by memory
+  ASSERT_EQ(0U, TestGetTickerCount(options, NO_FILE_OPENS));
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ("v" + ToString(i), Get(Key(i)));
+  }
+  ASSERT_EQ(3U, TestGetTickerCount(options, NO_FILE_OPENS));
+  ASSERT_GT(dbfull()->TEST_table_cache()->GetUsage(), 3U);
+
+  // Changing max_open_files leaves the budget
+  ASSERT_OK(dbfull()->SetDBOptions({{"max_open_files", "100"}}));
+  ASSERT_EQ(1U << 20, dbfull()->TEST_table_cache()->GetCapacity());
+}
+
+TEST_F(DBTest2, PinTableReaderOnFirstAccess) {
+  for (bool pin : {false, true}) {
+    Options options = CurrentOptions();
+    options.disable_auto_compactions = true;
+    options.max_open_files = -1;
+    options.lazy_open_deep_sst = true;
+    options.pin_table_reader_on_first_access = pin;
+    DestroyAndReopen(options);
+
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Flush());
+    MoveFilesToLevel(2);
+    Reopen(options);
+
+    Cache* table_cache = dbfull()->TEST_table_cache();
+    size_t pinned_usage = table_cache->GetPinnedUsage();
+    ASSERT_EQ("va", Get("a"));
+    // A pinned reader holds its handle until the file is deleted
+    ASSERT_EQ(pinned_usage + (pin ? 1 : 0), table_cache->GetPinnedUsage());
+    ASSERT_EQ("va", Get("a"));
+    ASSERT_EQ(pinned_usage + (pin ? 1 : 0), table_cache->GetPinnedUsage());
+
+    ASSERT_OK(dbfull()->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+    ASSERT_EQ("va", Get("a"));
+  }
+}
+
+TEST_F(DBTest2, RowCache) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  options.statistics = TERARKDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.blob_cache = NewLRUCache(1 << 20);
+  options.blob_size = 1024;
+  DestroyAndReopen(options);
+
+  std::string blob_value(8 << 10, 'b');
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("b", blob_value));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("a", "va2"));
+  ASSERT_OK(Flush());
+
+  ASSERT_EQ(0, TestGetTickerCount(options, ROW_CACHE_HIT));
+  ASSERT_EQ("va2", Get("a"));
+  ASSERT_EQ(0, TestGetTickerCount(options, ROW_CACHE_HIT));
+  ASSERT_EQ("va2", Get("a"));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_HIT));
+
+  // The snapshot sees less of the file, so it has a row of its own
+  ASSERT_EQ("va", Get("a", snapshot));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_HIT));
+  ASSERT_EQ("va", Get("a", snapshot));
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_HIT));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Keys in the range of the file but not in it are cached too
+  ASSERT_EQ("NOT_FOUND", Get("ab"));
+  ASSERT_EQ("NOT_FOUND", Get("ab"));
+  ASSERT_EQ(3, TestGetTickerCount(options, ROW_CACHE_HIT));
+
+  ASSERT_EQ(blob_value, Get("b"));
+  ASSERT_EQ(blob_value, Get("b"));
+  ASSERT_EQ(4, TestGetTickerCount(options, ROW_CACHE_HIT));
+  ASSERT_EQ(1, TestGetTickerCount(options, BLOB_CACHE_HIT));
+  // The rows keep the index of the separated values only
+  ASSERT_LT(options.row_cache->GetUsage(), blob_value.size());
+
+  // The rows of the files compacted away are not hit again
+  ASSERT_OK(Delete("a"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(dbfull()->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ(blob_value, Get("b"));
+}
+
+TEST_F(DBTest2, BlobCache) {
+  for (bool admit_on_second_access : {false, true}) {
+    Options options = CurrentOptions();
+    options.disable_auto_compactions = true;
+    options.statistics = TERARKDB_NAMESPACE::CreateDBStatistics();
+    options.blob_cache = NewLRUCache(1 << 20);
+    options.blob_cache_admit_on_second_access = admit_on_second_access;
+    options.blob_size = 1024;
+    BlockBasedTableOptions table_options;
+    table_options.block_cache = NewLRUCache(1 << 20);
+    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    DestroyAndReopen(options);
+
+    std::string blob_value(8 << 10, 'b');
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("b", blob_value));
+    ASSERT_OK(Flush());
+    // Open the tables and cache the blocks of the key sst
+    ASSERT_EQ("va", Get("a"));
+    ASSERT_EQ(0, TestGetTickerCount(options, BLOB_CACHE_MISS));
+
+    size_t block_cache_usage = table_options.block_cache->GetUsage();
+    ASSERT_EQ(blob_value, Get("b"));
+    ASSERT_EQ(1, TestGetTickerCount(options, BLOB_CACHE_MISS));
+    ASSERT_EQ(blob_value, Get("b"));
+    ASSERT_EQ(admit_on_second_access ? 2 : 1,
+              TestGetTickerCount(options, BLOB_CACHE_MISS));
+    ASSERT_EQ(blob_value, Get("b"));
+    ASSERT_EQ(blob_value, Get("b"));
+    ASSERT_EQ(admit_on_second_access ? 2 : 3,
+              TestGetTickerCount(options, BLOB_CACHE_HIT));
+    ASSERT_GT(options.blob_cache->GetUsage(), blob_value.size());
+
+    // The blocks of the blob sst stay out of the block cache, apart from the
+    // key sst blocks, which may be read once more
+    ASSERT_LT(table_options.block_cache->GetUsage(),
+              block_cache_usage + blob_value.size());
+  }
+}
+
+TEST_F(DBTest2, ResourceGroup) {
+  Options options = CurrentOptions();
+  options.statistics = CreateDBStatistics();
+  options.disable_auto_compactions = true;
+  Options group_options = options;
+  ResourceGroupOptions group_opts;
+  group_opts.name = "tenant";
+  group_opts.write_bytes_per_sec = 1 << 20;
+  group_options.resource_group.reset(NewResourceGroup(group_opts));
+  auto* group = group_options.resource_group.get();
+  CreateColumnFamilies({"tenant"}, group_options);
+  ReopenWithColumnFamilies({"default", "tenant"},
+                           std::vector<Options>{options, group_options});
+
+  // Only the writes to the column family of the group are charged
+  ASSERT_OK(Put(0, "a", "value"));
+  ASSERT_EQ(0U, group->GetStats().write_bytes);
+  Random rnd(301);
+  for (int i = 0; i < 200; ++i) {
+    ASSERT_OK(Put(1, Key(i), RandomString(&rnd, 1024)));
+  }
+  ResourceGroupStats stats = group->GetStats();
+  ASSERT_GT(stats.write_bytes, 200U * 1024);
+  ASSERT_GT(stats.write_wait_micros, 0U);
+  ASSERT_GT(TestGetTickerCount(options, RESOURCE_GROUP_WRITE_WAIT_MICROS), 0U);
+  ASSERT_EQ(0U, stats.background_bytes);
+
+  ASSERT_OK(Flush(1));
+  ASSERT_EQ(0U, group->GetStats().background_bytes);
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), handles_[1], nullptr,
+                              nullptr));
+  stats = group->GetStats();
+  ASSERT_GT(stats.background_bytes, 200U * 1024);
+
+  ASSERT_NE("NOT_FOUND", Get(1, Key(0)));
+  ASSERT_GT(group->GetStats().read_ops, stats.read_ops);
+  ASSERT_EQ(0U, group->GetStats().read_wait_micros);
+}
+
+TEST_F(DBTest2, BackgroundCoordinator) {
+  BackgroundCoordinatorOptions coordinator_options;
+  coordinator_options.max_background_jobs = 4;
+  coordinator_options.rate_bytes_per_sec = 64 << 20;
+  std::shared_ptr<BackgroundCoordinator> coordinator(
+      NewBackgroundCoordinator(coordinator_options));
+  Options options = CurrentOptions();
+  options.background_coordinator = coordinator;
+  options.disable_auto_compactions = true;
+  Reopen(options);
+  ASSERT_EQ(1U, coordinator->GetNumDBs());
+  ASSERT_NE(nullptr, dbfull()->GetDBOptions().rate_limiter);
+
+  std::string dbname2 = test::PerThreadDBPath("db_background_coordinator2");
+  ASSERT_OK(DestroyDB(dbname2, options));
+  DB* db2 = nullptr;
+  ASSERT_OK(DB::Open(options, dbname2, &db2));
+  ASSERT_EQ(2U, coordinator->GetNumDBs());
+  // The rate limiter is shared by the DBs
+  ASSERT_EQ(dbfull()->GetDBOptions().rate_limiter,
+            db2->GetDBOptions().rate_limiter);
+
+  // The job slots are shared by the DBs with compactions to run
+  ASSERT_EQ(0U, coordinator->GetNumBusyDBs());
+  ASSERT_EQ(4, coordinator->GetBackgroundJobsShare());
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK(Put(Key(i), "value"));
+    ASSERT_OK(Flush());
+  }
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  // Not busy anymore once the compaction is done
+  ASSERT_EQ(0U, coordinator->GetNumBusyDBs());
+
+  delete db2;
+  ASSERT_OK(DestroyDB(dbname2, options));
+  ASSERT_EQ(1U, coordinator->GetNumDBs());
+  Close();
+  ASSERT_EQ(0U, coordinator->GetNumDBs());
+}
 #endif  // ROCKSDB_LITE
 
 }  // namespace TERARKDB_NAMESPACE
@@ -46,6 +46,18 @@ SpecialEnv::SpecialEnv(Env* base)
 }
 #ifndef ROCKSDB_LITE
 ROT13BlockCipher rot13Cipher_(16);
+
+namespace {
+// ENCRYPTED_ENV=aes encrypts with AES-256, any other value with ROT13
+EncryptionProvider* NewTestEncryptionProvider() {
+  if (strcmp(getenv("ENCRYPTED_ENV"), "aes") == 0) {
+    std::unique_ptr<AESBlockCipher> cipher;
+    AESBlockCipher::Create(std::string(32, 'k'), &cipher);
+    return new AESCTREncryptionProvider(std::move(cipher));
+  }
+  return new CTREncryptionProvider(rot13Cipher_);
+}
+}  // namespace
 #endif  // ROCKSDB_LITE
 
 DBTestBase::DBTestBase(const std::string path)
@@ -55,7 +67,7 @@ DBTestBase::DBTestBase(const std::string path)
           !getenv("ENCRYPTED_ENV")
               ? nullptr
               : NewEncryptedEnv(mem_env_ ? mem_env_ : Env::Default(),
-                                new CTREncryptionProvider(rot13Cipher_))),
+                                NewTestEncryptionProvider())),
 #else
       encrypted_env_(nullptr),
 #endif  // ROCKSDB_LITE
@@ -427,10 +427,12 @@ class SpecialEnv : public EnvWrapper {
      public:
       CountingFile(std::unique_ptr<RandomAccessFile>&& target,
                    anon::AtomicCounter* counter,
-                   std::atomic<size_t>* bytes_read)
+                   std::atomic<size_t>* bytes_read,
+                   anon::AtomicCounter* prefetch_async_counter)
           : target_(std::move(target)),
             counter_(counter),
-            bytes_read_(bytes_read) {}
+            bytes_read_(bytes_read),
+            prefetch_async_counter_(prefetch_async_counter) {}
       virtual Status Read(uint64_t offset, size_t n, Slice* result,
                           char* scratch) const override {
         counter_->Increment();
@@ -438,6 +440,10 @@ class SpecialEnv : public EnvWrapper {
         *bytes_read_ += result->size();
         return s;
       }
+      virtual Status PrefetchAsync(uint64_t offset, size_t n) override {
+        prefetch_async_counter_->Increment();
+        return target_->PrefetchAsync(offset, n);
+      }
       virtual intptr_t FileDescriptor() const override {
         return target_->FileDescriptor();
       }
@@ -446,13 +452,15 @@ class SpecialEnv : public EnvWrapper {
       std::unique_ptr<RandomAccessFile> target_;
       anon::AtomicCounter* counter_;
       std::atomic<size_t>* bytes_read_;
+      anon::AtomicCounter* prefetch_async_counter_;
     };
 
     Status s = target()->NewRandomAccessFile(f, r, soptions);
     random_file_open_counter_++;
     if (s.ok() && count_random_reads_) {
       r->reset(new CountingFile(std::move(*r), &random_read_counter_,
-                                &random_read_bytes_counter_));
+                                &random_read_bytes_counter_,
+                                &prefetch_async_counter_));
     }
     if (s.ok() && soptions.compaction_readahead_size > 0) {
       compaction_readahead_size_ = soptions.compaction_readahead_size;
@@ -555,6 +563,7 @@ class SpecialEnv : public EnvWrapper {
   bool count_random_reads_;
   anon::AtomicCounter random_read_counter_;
   std::atomic<size_t> random_read_bytes_counter_;
+  anon::AtomicCounter prefetch_async_counter_;
   std::atomic<int> random_file_open_counter_;
 
   bool count_sequential_reads_;
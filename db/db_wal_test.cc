@@ -12,6 +12,7 @@
 #include "port/port.h"
 #include "port/stack_trace.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/compression.h"
 #include "util/fault_injection_test_env.h"
 #include "util/sync_point.h"
 
@@ -221,6 +222,186 @@ TEST_F(DBWALTest, SyncWALNotBlockWrite) {
   TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
 }
 
+TEST_F(DBWALTest, AsyncWALSync) {
+  Options options = CurrentOptions();
+  options.async_wal_sync = true;
+  options.async_wal_sync_max_delay_us = 10000;
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+
+  const int kThreads = 8;
+  const int kWritesPerThread = 20;
+  WriteOptions wo;
+  wo.sync = true;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kWritesPerThread; ++i) {
+        ASSERT_OK(db_->Put(wo, Key(t * kWritesPerThread + i), "v"));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // The writes of concurrent groups share fsyncs
+  ASSERT_LT(TestGetTickerCount(options, WAL_FILE_SYNCED),
+            kThreads * kWritesPerThread);
+
+  Reopen(options);
+  for (int i = 0; i < kThreads * kWritesPerThread; ++i) {
+    ASSERT_EQ("v", Get(Key(i)));
+  }
+}
+
+TEST_F(DBWALTest, WALStreams) {
+  Options options = CurrentOptions();
+  options.wal_streams = 4;
+  options.allow_concurrent_memtable_write = true;
+  DestroyAndReopen(options);
+
+  auto count_log_files = [&] {
+    std::vector<std::string> files;
+    EXPECT_OK(env_->GetChildren(dbname_, &files));
+    int count = 0;
+    for (auto& f : files) {
+      uint64_t number;
+      FileType type;
+      if (ParseFileName(f, &number, &type) && type == kLogFile) {
+        ++count;
+      }
+    }
+    return count;
+  };
+  // Every log comes with its secondary streams
+  ASSERT_GE(count_log_files(), 4);
+
+  const int kThreads = 8;
+  const int kWritesPerThread = 200;
+  auto write = [&](const std::string& value) {
+    std::vector<port::Thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kWritesPerThread; ++i) {
+          ASSERT_OK(Put(Key(t * kWritesPerThread + i), value));
+          // Overwritten from every stream, recovery has to keep the last one
+          ASSERT_OK(Put("hot", value + ToString(t * kWritesPerThread + i)));
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  };
+  auto verify = [&](const std::string& value) {
+    for (int i = 0; i < kThreads * kWritesPerThread; ++i) {
+      ASSERT_EQ(value, Get(Key(i)));
+    }
+  };
+
+  write("v1");
+  std::string hot = Get("hot");
+  Reopen(options);
+  verify("v1");
+  ASSERT_EQ(hot, Get("hot"));
+
+  // The streams of flushed logs go away with them
+  ASSERT_OK(Flush());
+  write("v2");
+  hot = Get("hot");
+  Reopen(options);
+  verify("v2");
+  ASSERT_EQ(hot, Get("hot"));
+
+  // A single stream DB replays the streams left by the previous one
+  write("v3");
+  hot = Get("hot");
+  options.wal_streams = 1;
+  Reopen(options);
+  verify("v3");
+  ASSERT_EQ(hot, Get("hot"));
+}
+
+TEST_F(DBWALTest, ParallelRecovery) {
+  Options options = CurrentOptions();
+  options.allow_concurrent_memtable_write = true;
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  options.write_buffer_size = 4 << 20;
+  CreateAndReopenWithCF({"pikachu"}, options);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 2000; ++i) {
+    values.push_back(RandomString(&rnd, 100));
+    WriteBatch batch;
+    ASSERT_OK(batch.Put(handles_[i % 2], Key(i), values.back()));
+    ASSERT_OK(batch.Put(handles_[0], "hot", values.back()));
+    ASSERT_OK(dbfull()->Write(WriteOptions(), &batch));
+    // Merges are inserted alone, in between the groups
+    if (i % 100 == 0) {
+      ASSERT_OK(Merge(1, "merged", ToString(i)));
+    }
+  }
+  ASSERT_EQ(0, NumTableFilesAtLevel(0, 0));
+  ASSERT_EQ(0, NumTableFilesAtLevel(0, 1));
+
+  // The memtables filled by the replay are flushed along the way
+  options.wal_recovery_threads = 4;
+  options.write_buffer_size = 32 << 10;
+  ReopenWithColumnFamilies({"default", "pikachu"}, options);
+  ASSERT_GT(NumTableFilesAtLevel(0, 0), 1);
+  ASSERT_GT(NumTableFilesAtLevel(0, 1), 1);
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_EQ(values[i], Get(i % 2, Key(i)));
+  }
+  ASSERT_EQ(values.back(), Get(0, "hot"));
+  std::string merged;
+  for (int i = 0; i < 2000; i += 100) {
+    merged += (merged.empty() ? "" : ",") + ToString(i);
+  }
+  ASSERT_EQ(merged, Get(1, "merged"));
+}
+
+TEST_F(DBWALTest, WALCompression) {
+  Options options = CurrentOptions();
+  if (ZSTD_Supported()) {
+    options.wal_compression = kZSTD;
+  } else if (LZ4_Supported()) {
+    options.wal_compression = kLZ4Compression;
+  } else {
+    return;
+  }
+  options.WAL_ttl_seconds = 1000;
+  DestroyAndReopen(options);
+  const int kNumKeys = 100;
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_OK(Put(Key(i), std::string(1000, 'a' + i % 26)));
+  }
+  ASSERT_OK(Put("small", "v"));
+
+  // The iterator reads the compressed records
+  std::unique_ptr<TransactionLogIterator> iter;
+  ASSERT_OK(dbfull()->GetUpdatesSince(0, &iter));
+  int count = 0;
+  for (; iter->Valid(); iter->Next()) {
+    ASSERT_OK(iter->status());
+    ++count;
+  }
+  ASSERT_EQ(kNumKeys + 1, count);
+  iter.reset();
+
+  // Recovery reads them too, with the compression on or off
+  Reopen(options);
+  options.wal_compression = kNoCompression;
+  ASSERT_OK(Put("uncompressed", std::string(1000, 'u')));
+  Reopen(options);
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(std::string(1000, 'a' + i % 26), Get(Key(i)));
+  }
+  ASSERT_EQ("v", Get("small"));
+  ASSERT_EQ(std::string(1000, 'u'), Get("uncompressed"));
+}
+
 TEST_F(DBWALTest, SyncWALNotWaitWrite) {
   ASSERT_OK(Put("foo1", "bar1"));
   ASSERT_OK(Put("foo3", "bar3"));
@@ -1462,6 +1643,63 @@ TEST_F(DBWALTest, WalTermTest) {
   ASSERT_EQ("bar", Get(1, "foo"));
   ASSERT_EQ("NOT_FOUND", Get(1, "foo2"));
 }
+
+TEST_F(DBWALTest, ValueLog) {
+  Options options = CurrentOptions();
+  options.value_log_threshold = 1024;
+  options.avoid_flush_during_recovery = true;
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+
+  auto count_value_logs = [&] {
+    std::vector<std::string> files;
+    EXPECT_OK(env_->GetChildren(dbname_, &files));
+    int count = 0;
+    for (auto& f : files) {
+      uint64_t number;
+      FileType type;
+      if (ParseFileName(f, &number, &type) && type == kValueLogFile) {
+        ++count;
+      }
+    }
+    return count;
+  };
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 10; ++i) {
+    values.push_back(RandomString(&rnd, i % 2 == 0 ? 4096 : 100));
+    ASSERT_OK(Put(Key(i), values.back()));
+  }
+  ASSERT_EQ(1, count_value_logs());
+  ASSERT_EQ(5 * 4096,
+            options.statistics->getTickerCount(VALUE_LOG_BYTES_WRITTEN));
+
+  auto verify = [&] {
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_EQ(values[i], Get(Key(i)));
+    }
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ(values[i], iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(10, i);
+  };
+  verify();
+
+  // Recovered from the WAL and its value log
+  Reopen(options);
+  verify();
+
+  // The value log goes with its WAL
+  ASSERT_OK(Flush());
+  verify();
+  ASSERT_EQ(0, count_value_logs());
+  Reopen(options);
+  verify();
+}
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
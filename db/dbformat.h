@@ -53,7 +53,7 @@ enum ValueType : unsigned char {
   kTypeNoop = 0xD,                        // WAL only.
   kTypeColumnFamilyRangeDeletion = 0xE,   // WAL only.
   kTypeRangeDeletion = 0xF,               // meta block
-  kTypeValueIndex = 0x10,                 // Blob DB only
+  kTypeValueIndex = 0x10,  // Blob DB only, and WAL with a value log
   kTypeMergeIndex = 0x11,                 // Blob DB only
   // When the prepared record is also persisted in db, we use a different
   // record. This is to ensure that the WAL that is generated by a WritePolicy
@@ -64,6 +64,9 @@ enum ValueType : unsigned char {
   // generated by WriteUnprepared write policy is not mistakenly read by
   // another.
   kTypeBeginUnprepareXID = 0x13,  // WAL only.
+  // A put whose value went to the value log of its WAL, see
+  // DBOptions::value_log_threshold
+  kTypeColumnFamilyValueIndex = 0x14,  // WAL only.
   kMaxValue = 0x7F                // Not used for storing records.
 };
 
@@ -772,6 +775,59 @@ inline int InternalKeyComparator::CompareKeySeq(const Slice& akey,
   return r;
 }
 
+// Internal key comparison by an InternalKeyComparator, for the hot loops which
+// are instantiated with it and with BytewiseInternalKeyCompare
+struct InternalKeyCompare {
+  explicit InternalKeyCompare(const InternalKeyComparator* c) : cmp(c) {}
+
+  int Compare(const Slice& a, const Slice& b) const {
+    return cmp->Compare(a, b);
+  }
+  bool Equal(const Slice& a, const Slice& b) const { return cmp->Equal(a, b); }
+
+  const InternalKeyComparator* cmp;
+};
+
+// InternalKeyComparator::Compare() of BytewiseComparator(), or of
+// ReverseBytewiseComparator() if kReverse, with the user keys compared inline
+// instead of by a virtual call. See GetBytewiseKind()
+template <bool kReverse>
+struct BytewiseInternalKeyCompare {
+  BytewiseInternalKeyCompare() {}
+  explicit BytewiseInternalKeyCompare(const InternalKeyComparator* c) {
+    assert(c->user_comparator() ==
+           (kReverse ? ReverseBytewiseComparator() : BytewiseComparator()));
+    (void)c;
+  }
+
+  int Compare(const Slice& akey, const Slice& bkey) const {
+    int r = ExtractUserKey(akey).compare(ExtractUserKey(bkey));
+    PERF_COUNTER_ADD(user_key_comparison_count, 1);
+    if (r != 0) {
+      return kReverse ? -r : r;
+    }
+    const uint64_t anum = DecodeFixed64(akey.data() + akey.size() - 8);
+    const uint64_t bnum = DecodeFixed64(bkey.data() + bkey.size() - 8);
+    return anum > bnum ? -1 : (anum < bnum ? +1 : 0);
+  }
+  // Internal keys compare equal only if they are the same bytes
+  bool Equal(const Slice& a, const Slice& b) const { return a == b; }
+};
+
+enum class BytewiseKind { kNone, kForward, kReverse };
+
+// Which of the bytewise comparators `ucmp` is, by identity, for picking the
+// BytewiseInternalKeyCompare instantiations of a hot loop
+inline BytewiseKind GetBytewiseKind(const Comparator* ucmp) {
+  if (ucmp == BytewiseComparator()) {
+    return BytewiseKind::kForward;
+  }
+  if (ucmp == ReverseBytewiseComparator()) {
+    return BytewiseKind::kReverse;
+  }
+  return BytewiseKind::kNone;
+}
+
 struct ParsedInternalKeyComparator {
   explicit ParsedInternalKeyComparator(const InternalKeyComparator* c)
       : cmp(c) {}
@@ -221,4 +221,25 @@ void EventHelpers::NotifyOnErrorRecoveryCompleted(
 #endif  // ROCKSDB_LITE
 }
 
+void EventHelpers::NotifyOnDBClosing(
+    const std::vector<std::shared_ptr<EventListener>>& listeners, DB* db,
+    InstrumentedMutex* db_mutex) {
+#ifndef ROCKSDB_LITE
+  if (listeners.size() == 0U) {
+    return;
+  }
+  db_mutex->AssertHeld();
+  // release lock while notifying events
+  db_mutex->Unlock();
+  for (auto& listener : listeners) {
+    listener->OnDBClosing(db);
+  }
+  db_mutex->Lock();
+#else
+  (void)listeners;
+  (void)db;
+  (void)db_mutex;
+#endif  // ROCKSDB_LITE
+}
+
 }  // namespace TERARKDB_NAMESPACE
@@ -45,6 +45,9 @@ class EventHelpers {
   static void NotifyOnErrorRecoveryCompleted(
       const std::vector<std::shared_ptr<EventListener>>& listeners,
       Status bg_error, InstrumentedMutex* db_mutex);
+  static void NotifyOnDBClosing(
+      const std::vector<std::shared_ptr<EventListener>>& listeners, DB* db,
+      InstrumentedMutex* db_mutex);
 
  private:
   static void LogAndNotifyTableFileCreation(
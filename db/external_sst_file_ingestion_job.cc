@@ -14,10 +14,12 @@
 #include <inttypes.h>
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <vector>
 
 #include "db/version_edit.h"
+#include "port/port.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/merging_iterator.h"
 #include "table/scoped_arena_iterator.h"
@@ -35,15 +37,20 @@ Status ExternalSstFileIngestionJob::Prepare(
     const std::vector<std::string>& external_files_paths,
     uint64_t next_file_number, SuperVersion* sv) {
   Status status;
-
-  // Read the information of files we are ingesting
-  for (const std::string& file_path : external_files_paths) {
-    IngestedFileInfo file_to_ingest;
-    status = GetIngestedFileInfo(file_path, &file_to_ingest, sv);
-    if (!status.ok()) {
-      return status;
+  std::vector<Status> file_status(external_files_paths.size());
+
+  // Read the information of files we are ingesting, bulk loads bring
+  // thousands of them
+  files_to_ingest_.resize(external_files_paths.size());
+  ForEachFileInParallel([&](size_t i) {
+    file_status[i] = GetIngestedFileInfo(external_files_paths[i],
+                                         &files_to_ingest_[i], sv);
+  });
+  for (auto& s : file_status) {
+    if (!s.ok()) {
+      files_to_ingest_.clear();
+      return s;
     }
-    files_to_ingest_.push_back(file_to_ingest);
   }
 
   for (const IngestedFileInfo& f : files_to_ingest_) {
@@ -90,38 +97,47 @@ Status ExternalSstFileIngestionJob::Prepare(
   // Copy/Move external files into DB
   for (IngestedFileInfo& f : files_to_ingest_) {
     f.fd = FileDescriptor(next_file_number++, 0, f.file_size);
-
+  }
+  ForEachFileInParallel([&](size_t i) {
+    IngestedFileInfo& f = files_to_ingest_[i];
     const std::string path_outside_db = f.external_file_path;
     const std::string path_inside_db = TableFileName(
         cfd_->ioptions()->cf_paths, f.fd.GetNumber(), f.fd.GetPathId());
 
+    Status s;
     if (ingestion_options_.move_files) {
-      status = env_->LinkFile(path_outside_db, path_inside_db);
-      if (status.IsNotSupported()) {
+      s = env_->LinkFile(path_outside_db, path_inside_db);
+      if (s.IsNotSupported()) {
         // Original file is on a different FS, use copy instead of hard linking
-        status = CopyFile(env_, path_outside_db, path_inside_db, 0,
-                          db_options_.use_fsync);
+        s = CopyFile(env_, path_outside_db, path_inside_db, 0,
+                     db_options_.use_fsync);
         f.copy_file = true;
       } else {
         f.copy_file = false;
       }
     } else {
-      status = CopyFile(env_, path_outside_db, path_inside_db, 0,
-                        db_options_.use_fsync);
+      s = CopyFile(env_, path_outside_db, path_inside_db, 0,
+                   db_options_.use_fsync);
       f.copy_file = true;
     }
     TEST_SYNC_POINT("ExternalSstFileIngestionJob::Prepare:FileAdded");
-    if (!status.ok()) {
+    if (s.ok()) {
+      f.internal_file_path = path_inside_db;
+    }
+    file_status[i] = std::move(s);
+  });
+  for (auto& s : file_status) {
+    if (!s.ok()) {
+      status = s;
       break;
     }
-    f.internal_file_path = path_inside_db;
   }
 
   if (!status.ok()) {
     // We failed, remove all files that we copied into the db
     for (IngestedFileInfo& f : files_to_ingest_) {
       if (f.internal_file_path.empty()) {
-        break;
+        continue;
       }
       Status s = env_->DeleteFile(f.internal_file_path);
       if (!s.ok()) {
@@ -135,6 +151,31 @@ Status ExternalSstFileIngestionJob::Prepare(
   return status;
 }
 
+void ExternalSstFileIngestionJob::ForEachFileInParallel(
+    const std::function<void(size_t)>& func) {
+  const size_t num_files = files_to_ingest_.size();
+  std::atomic<size_t> next_file_idx(0);
+  auto worker = [&]() {
+    while (true) {
+      size_t file_idx = next_file_idx.fetch_add(1);
+      if (file_idx >= num_files) {
+        break;
+      }
+      func(file_idx);
+    }
+  };
+  size_t num_threads = static_cast<size_t>(
+      std::max(db_options_.max_file_opening_threads, 1));
+  std::vector<port::Thread> threads;
+  for (size_t i = 1; i < std::min(num_threads, num_files); i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
 Status ExternalSstFileIngestionJob::NeedsFlush(bool* flush_needed,
                                                SuperVersion* super_version) {
   autovector<Range> ranges;
@@ -345,6 +386,15 @@ Status ExternalSstFileIngestionJob::GetIngestedFileInfo(
     return status;
   }
 
+  if (ingestion_options_.verify_checksums_before_ingest) {
+    status = table_reader->VerifyChecksum();
+    if (status.IsNotSupported()) {
+      status = Status::OK();
+    } else if (!status.ok()) {
+      return status;
+    }
+  }
+
   // Get the external file properties
   auto props = table_reader->GetTableProperties();
   const auto& uprops = props->user_collected_properties;
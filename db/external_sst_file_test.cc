@@ -835,6 +835,45 @@ TEST_F(ExternalSSTFileTest, PurgeObsoleteFilesBug) {
   TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
 }
 
+TEST_F(ExternalSSTFileTest, IngestManyFilesVerifyChecksums) {
+  Options options = CurrentOptions();
+  options.max_file_opening_threads = 4;
+  DestroyAndReopen(options);
+  SstFileWriter sst_file_writer(EnvOptions(), options);
+
+  const int kNumFiles = 20;
+  std::vector<std::string> files;
+  for (int i = 0; i < kNumFiles; i++) {
+    std::string file = sst_files_dir_ + "many" + ToString(i) + ".sst";
+    ASSERT_OK(sst_file_writer.Open(file));
+    for (int k = i * 100; k < (i + 1) * 100; k++) {
+      ASSERT_OK(sst_file_writer.Put(Key(k), Key(k) + "_val"));
+    }
+    ASSERT_OK(sst_file_writer.Finish());
+    files.push_back(file);
+  }
+
+  // Corrupt the first data block of one file
+  std::string corrupted = sst_files_dir_ + "corrupted.sst";
+  std::string content;
+  ASSERT_OK(ReadFileToString(env_, files[7], &content));
+  content[10] ^= 0x5a;
+  ASSERT_OK(WriteStringToFile(env_, content, corrupted));
+  std::vector<std::string> bad_files = files;
+  bad_files[7] = corrupted;
+
+  IngestExternalFileOptions ifo;
+  ifo.verify_checksums_before_ingest = true;
+  Status s = db_->IngestExternalFile(bad_files, ifo);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  ASSERT_EQ("NOT_FOUND", Get(Key(0)));
+
+  ASSERT_OK(db_->IngestExternalFile(files, ifo));
+  for (int k = 0; k < kNumFiles * 100; k++) {
+    ASSERT_EQ(Key(k) + "_val", Get(Key(k)));
+  }
+}
+
 TEST_F(ExternalSSTFileTest, SkipSnapshot) {
   Options options = CurrentOptions();
 
@@ -1,21 +1,179 @@
 #include "filemap.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "db/dbformat.h"
 #include "fs/log.h"
+#include "monitoring/perf_context_imp.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/status.h"
+#include "util/mutexlock.h"
 
 namespace TERARKDB_NAMESPACE {
 
+namespace {
+
+std::atomic<uint64_t> next_file_map_id{1};
+
+// One end of a key interval
+struct Bound {
+  Slice key;
+  bool inclusive = false;
+  bool bounded = false;
+};
+
+// The user keys that take the same path through the lineage as the queried
+// key. Bounds point into the MapNode keys, which live as long as the map.
+struct KeyInterval {
+  Bound lower;
+  Bound upper;
+
+  bool Contain(const Slice& ukey, const Comparator* cmp) const {
+    if (lower.bounded) {
+      int c = cmp->Compare(ukey, lower.key);
+      if (c < 0 || (c == 0 && !lower.inclusive)) {
+        return false;
+      }
+    }
+    if (upper.bounded) {
+      int c = cmp->Compare(ukey, upper.key);
+      if (c > 0 || (c == 0 && !upper.inclusive)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void TightenLower(const Slice& key, bool inclusive, const Comparator* cmp) {
+    if (lower.bounded) {
+      int c = cmp->Compare(key, lower.key);
+      if (c < 0 || (c == 0 && (inclusive || !lower.inclusive))) {
+        return;
+      }
+    }
+    lower.key = key;
+    lower.inclusive = inclusive;
+    lower.bounded = true;
+  }
+
+  void TightenUpper(const Slice& key, bool inclusive, const Comparator* cmp) {
+    if (upper.bounded) {
+      int c = cmp->Compare(key, upper.key);
+      if (c > 0 || (c == 0 && (inclusive || !upper.inclusive))) {
+        return;
+      }
+    }
+    upper.key = key;
+    upper.inclusive = inclusive;
+    upper.bounded = true;
+  }
+
+  // Keys must fall in the range of `node`
+  void Intersect(const FileMap::MapNode* node, const Comparator* cmp) {
+    TightenLower(node->smallest_key.user_key(), true, cmp);
+    TightenUpper(node->largest_key.user_key(), true, cmp);
+  }
+
+  // Keys must stay out of the range of `node`, which does not contain `ukey`
+  void Exclude(const FileMap::MapNode* node, const Slice& ukey,
+               const Comparator* cmp) {
+    if (cmp->Compare(ukey, node->smallest_key.user_key()) < 0) {
+      TightenUpper(node->smallest_key.user_key(), false, cmp);
+    } else {
+      TightenLower(node->largest_key.user_key(), false, cmp);
+    }
+  }
+};
+
+// Per thread cache of the latest resolutions, direct mapped on (file number,
+// version) with a few ways per set
+struct ResolveCache {
+  static constexpr size_t kSets = 16;
+  static constexpr size_t kWays = 4;
+
+  struct Entry {
+    uint64_t map_id = 0;
+    uint64_t epoch = 0;
+    uint64_t fn = 0;
+    uint64_t version = 0;
+    KeyInterval range;
+    FileMap::MapNode* node = nullptr;
+  };
+
+  static size_t SetOf(uint64_t fn, uint64_t version) {
+    return static_cast<size_t>((fn ^ (version * 0x9e3779b97f4a7c15ull)) %
+                               kSets);
+  }
+
+  Entry entries[kSets][kWays];
+  uint8_t victim[kSets] = {};
+};
+
+thread_local ResolveCache resolve_cache;
+
+}  // namespace
+
+FileMap::MapNode::~MapNode() {
+  ChildChunk* chunk = head_.next.load(std::memory_order_relaxed);
+  while (chunk != nullptr) {
+    ChildChunk* next = chunk->next.load(std::memory_order_relaxed);
+    delete chunk;
+    chunk = next;
+  }
+}
+
+void FileMap::MapNode::AppendChild(MapNode* child) {
+  size_t n = num_children_.load(std::memory_order_relaxed);
+  if (n > 0 && n % ChildChunk::kSize == 0) {
+    auto* chunk = new ChildChunk();
+    tail_->next.store(chunk, std::memory_order_release);
+    tail_ = chunk;
+  }
+  tail_->slots[n % ChildChunk::kSize].store(child, std::memory_order_relaxed);
+  // Publish the child, readers acquire the count before reading the slot
+  num_children_.store(n + 1, std::memory_order_release);
+}
+
+FileMap::FileMap(const Comparator *u_cmp)
+    : u_cmp_(u_cmp),
+      auto_shrink_(false),
+      id_(next_file_map_id.fetch_add(1, std::memory_order_relaxed)),
+      epoch_(0) {}
+
+FileMap::MapNode *FileMap::FindNode(uint64_t fn) const {
+  auto iter = nodes_.find(fn);
+  return iter == nodes_.end() ? nullptr : iter->second.get();
+}
+
+size_t FileMap::ApproximateMemoryUsage() const {
+  // The parents of the nodes are only accessed by writers
+  MutexLock l(&write_mutex_);
+  size_t usage = 0;
+  for (const auto &entry : nodes_) {
+    const MapNode *node = entry.second.get();
+    // The node with the shared_ptr control block and the hash map entry
+    usage += sizeof(MapNode) + 2 * sizeof(void *) + sizeof(entry);
+    usage += node->smallest_key.size() + node->largest_key.size();
+    usage += node->parents.capacity() * sizeof(MapNode *);
+    size_t num_children = node->NumChildren();
+    if (num_children > MapNode::ChildChunk::kSize) {
+      usage += (num_children - 1) / MapNode::ChildChunk::kSize *
+               sizeof(MapNode::ChildChunk);
+    }
+  }
+  return usage;
+}
+
 Status FileMap::AddNode(FileMetaData *fmeta, uint64_t version_num) {
   auto file_number = fmeta->fd.GetNumber();
+  MutexLock l(&write_mutex_);
   if (nodes_.find(file_number) != nodes_.end()) {
     return Status::Corruption("Node to add already exists");
   }
   // ZnsLog(kCyan, "FileMap::AddNode %lu.sst", fmeta->fd.GetNumber());
   nodes_.emplace(file_number, std::make_shared<MapNode>(fmeta, version_num));
+  epoch_.fetch_add(1, std::memory_order_release);
   return Status::OK();
 }
 
@@ -27,23 +185,33 @@ Status FileMap::AddDerivedNode(FileMetaData *p, FileMetaData *c,
 Status FileMap::AddDerivedNode(uint64_t p_filenum, FileMetaData *c,
                                uint64_t version_num) {
   auto c_filenum = c->fd.GetNumber();
-  if (nodes_.find(p_filenum) == nodes_.end()) {
+  MutexLock l(&write_mutex_);
+  MapNode *p_node = FindNode(p_filenum);
+  if (p_node == nullptr) {
     return Status::Corruption("Request parent node does not exist");
   }
-  auto p_node = nodes_[p_filenum];
   // The parantal version number must be less than child's version number
   assert(p_node->version_num < version_num);
 
-  std::shared_ptr<MapNode> add_child = nullptr;
-  if (nodes_.find(c_filenum) != nodes_.end()) {
-    add_child = nodes_[c_filenum];
+  MapNode *add_child = FindNode(c_filenum);
+  if (add_child != nullptr) {
     assert(add_child->version_num == version_num);
   } else {
-    add_child = std::make_shared<MapNode>(c, version_num);
-    nodes_.emplace(c_filenum, add_child);
+    auto node = std::make_shared<MapNode>(c, version_num);
+    add_child = node.get();
+    nodes_.emplace(c_filenum, std::move(node));
   }
   assert(add_child != nullptr);
-  nodes_[p_filenum]->children.emplace_back(add_child);
+  add_child->generation.store(
+      std::max(add_child->generation.load(std::memory_order_relaxed),
+               p_node->generation.load(std::memory_order_relaxed) + 1),
+      std::memory_order_relaxed);
+  add_child->parents.push_back(p_node);
+  p_node->AppendChild(add_child);
+  if (p_node->NumChildren() == 1) {
+    FlattenLineage(p_node, add_child);
+  }
+  epoch_.fetch_add(1, std::memory_order_release);
 
   // TODO: May sort the children nodes based on their key ranges
 
@@ -52,83 +220,181 @@ Status FileMap::AddDerivedNode(uint64_t p_filenum, FileMetaData *c,
   return Status::OK();
 }
 
-Status FileMap::QueryFileNumber(uint64_t fn, const Slice &ukey,
-                                const Comparator *u_cmp, uint64_t version_num,
-                                uint64_t *ret) {
-  if (nodes_.find(fn) == nodes_.end()) {
-    return Status::Corruption("Queried file number does not exist");
+Status FileMap::QueryGeneration(uint64_t fn, uint32_t *generation) {
+  MapNode *node = FindNode(fn);
+  if (node == nullptr) {
+    return Status::NotFound("Queried file number does not exist");
   }
-  auto node = nodes_[fn];
-  uint64_t hop_num = 0;
-  while (!node->IsLeaf() && node->Accessible(version_num)) {
-    auto iter = node->children.begin();
-    bool changed = false;
-    // Seeking to the child that contains the requested user key
-    for (; iter != node->children.end(); ++iter) {
-      if ((*iter)->Accessible(version_num) && (*iter)->Contain(ukey, u_cmp)) {
-        node = *iter;
-        changed = true;
-        hop_num++;
-        break;
-      }
-    }
-    // No further step
-    if (!changed) {
+  *generation = node->generation.load(std::memory_order_relaxed);
+  return Status::OK();
+}
+
+FileMap::MapNode *FileMap::LineageJump(MapNode *node,
+                                       const Comparator *u_cmp) {
+  // The first child is always taken by the walk if it covers the whole range
+  // of its parent. The versions grow along the chain, so the target being
+  // accessible implies every node in between is. A jump thus stays valid
+  // forever, it is only extended when the chain grows.
+  MapNode *target = node->jump.load(std::memory_order_acquire);
+  MapNode *cur = target == nullptr ? node : target;
+  for (uint32_t hops = 0; hops < kMaxJumpHops; ++hops) {
+    MapNode *first = nullptr;
+    cur->ForEachChild([&](MapNode *child) {
+      first = child;
+      return false;
+    });
+    if (first == nullptr || !first->Cover(cur, u_cmp)) {
       break;
     }
+    cur = first;
+  }
+  if (cur != node && cur != target) {
+    // Racing queries compute jumps along the same chain, any of them is valid
+    node->jump.store(cur, std::memory_order_release);
   }
+  return cur == node ? nullptr : cur;
+}
 
-  if (!node->Contain(ukey, u_cmp) || !node->Accessible(version_num)) {
-    return Status::Corruption("Resultant file does not contain seeking key");
+void FileMap::FlattenLineage(MapNode *p, MapNode *c) {
+  write_mutex_.AssertHeld();
+  // Without a comparator the jumps are only computed lazily by queries
+  if (u_cmp_ == nullptr || !c->Cover(p, u_cmp_)) {
+    return;
+  }
+  MapNode *c_jump = c->jump.load(std::memory_order_relaxed);
+  MapNode *target = c_jump == nullptr ? c : c_jump;
+  // `p` was a leaf, so ancestors flowing into it either jump to `p` or do not
+  // have a jump yet. Move them to the new end of the chain.
+  std::vector<MapNode *> stack{p};
+  for (uint32_t depth = 0; !stack.empty() && depth < kMaxJumpHops; ++depth) {
+    std::vector<MapNode *> next;
+    for (MapNode *node : stack) {
+      MapNode *jump = node->jump.load(std::memory_order_relaxed);
+      if (node != p && jump != p) {
+        continue;
+      }
+      node->jump.store(target, std::memory_order_release);
+      for (MapNode *parent : node->parents) {
+        MapNode *first = nullptr;
+        parent->ForEachChild([&](MapNode *child) {
+          first = child;
+          return false;
+        });
+        if (first == node) {
+          next.push_back(parent);
+        }
+      }
+    }
+    stack.swap(next);
   }
+}
 
-  if (ret) {
-    *ret = node->fd.GetNumber();
+void FileMap::RecordHops(uint64_t hop_num) {
+  monitor_.hop_num.fetch_add(hop_num, std::memory_order_relaxed);
+  uint64_t max_hop = monitor_.max_hop_num.load(std::memory_order_relaxed);
+  while (max_hop < hop_num && !monitor_.max_hop_num.compare_exchange_weak(
+                                  max_hop, hop_num, std::memory_order_relaxed)) {
   }
-  monitor_.hop_num += hop_num;
-  monitor_.max_hop_num = std::max(monitor_.max_hop_num, hop_num);
-  return Status::OK();
 }
 
-Status FileMap::QueryFileMeta(uint64_t fn, const Slice &ukey,
-                              const Comparator *u_cmp, uint64_t version_num,
-                              FileMetaData **filemeta) {
-  if (nodes_.find(fn) == nodes_.end()) {
+Status FileMap::Resolve(uint64_t fn, const Slice &ukey,
+                        const Comparator *u_cmp, uint64_t version_num,
+                        MapNode **result) {
+  monitor_.query_num.fetch_add(1, std::memory_order_relaxed);
+  uint64_t epoch = epoch_.load(std::memory_order_acquire);
+  ResolveCache &cache = resolve_cache;
+  size_t set = ResolveCache::SetOf(fn, version_num);
+  for (auto &entry : cache.entries[set]) {
+    if (entry.map_id == id_ && entry.epoch == epoch && entry.fn == fn &&
+        entry.version == version_num && entry.range.Contain(ukey, u_cmp)) {
+      monitor_.cache_hit.fetch_add(1, std::memory_order_relaxed);
+      PERF_COUNTER_ADD(blob_lineage_resolve_count, 1);
+      *result = entry.node;
+      return Status::OK();
+    }
+  }
+
+  MapNode *node = FindNode(fn);
+  if (node == nullptr) {
     return Status::Corruption("Queried file number does not exist");
   }
-  auto node = nodes_[fn];
+  KeyInterval range;
   uint64_t hop_num = 0;
   // node->version_num <= version_num means this node can be accessed in the
   // requested version.
   while (!node->IsLeaf() && node->Accessible(version_num)) {
-    auto iter = node->children.begin();
-    bool changed = false;
-    // Seeking to the child that contains the requested user key
-    for (; iter != node->children.end(); ++iter) {
-      if ((*iter)->Accessible(version_num) && (*iter)->Contain(ukey, u_cmp)) {
-        node = *iter;
+    if (node->Contain(ukey, u_cmp)) {
+      MapNode *target = LineageJump(node, u_cmp);
+      if (target != nullptr && target->Accessible(version_num)) {
+        range.Intersect(node, u_cmp);
+        node = target;
         hop_num++;
-        changed = true;
-        break;
+        continue;
       }
     }
-    if (!changed) {
+    // Seeking to the child that contains the requested user key
+    MapNode *next = nullptr;
+    node->ForEachChild([&](MapNode *child) {
+      if (!child->Accessible(version_num)) {
+        return true;
+      }
+      if (child->Contain(ukey, u_cmp)) {
+        next = child;
+        return false;
+      }
+      range.Exclude(child, ukey, u_cmp);
+      return true;
+    });
+    // No further step
+    if (next == nullptr) {
       break;
     }
+    node = next;
+    hop_num++;
   }
+  RecordHops(hop_num);
+  PERF_COUNTER_ADD(blob_lineage_resolve_count, 1);
+  PERF_COUNTER_ADD(blob_lineage_hop_count, hop_num);
 
   if (!node->Contain(ukey, u_cmp) || !node->Accessible(version_num)) {
     return Status::Corruption("Resultant file does not contain seeking key");
   }
+  range.Intersect(node, u_cmp);
+
+  auto &entry = cache.entries[set][cache.victim[set]];
+  cache.victim[set] = (cache.victim[set] + 1) % ResolveCache::kWays;
+  entry.map_id = id_;
+  entry.epoch = epoch;
+  entry.fn = fn;
+  entry.version = version_num;
+  entry.range = range;
+  entry.node = node;
+  *result = node;
+  return Status::OK();
+}
 
-  if (filemeta) {
+Status FileMap::QueryFileNumber(uint64_t fn, const Slice &ukey,
+                                const Comparator *u_cmp, uint64_t version_num,
+                                uint64_t *ret) {
+  MapNode *node = nullptr;
+  Status s = Resolve(fn, ukey, u_cmp, version_num, &node);
+  if (s.ok() && ret) {
+    *ret = node->fd.GetNumber();
+  }
+  return s;
+}
+
+Status FileMap::QueryFileMeta(uint64_t fn, const Slice &ukey,
+                              const Comparator *u_cmp, uint64_t version_num,
+                              FileMetaData **filemeta) {
+  MapNode *node = nullptr;
+  Status s = Resolve(fn, ukey, u_cmp, version_num, &node);
+  if (s.ok() && filemeta) {
     *filemeta = node->file_meta;
   }
-  monitor_.hop_num += hop_num;
-  monitor_.max_hop_num = std::max(monitor_.max_hop_num, hop_num);
-  return Status::OK();
+  return s;
 }
 
 void FileMap::Shrink(Comparator *u_cmp) {}
 
-}  // namespace TERARKDB_NAMESPACE
\ No newline at end of file
+}  // namespace TERARKDB_NAMESPACE
@@ -1,6 +1,7 @@
 #pragma once
 #include <folly/concurrency/ConcurrentHashMap.h>
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <limits>
@@ -24,8 +25,23 @@ namespace TERARKDB_NAMESPACE {
 // FileMap is a class tracking the GC history and provides the functionalities
 // of quering the latest corresponding blob file given user key.
 //
-// Concurrency Control: This class is supposed to be Thread-Safe but not
-// implmented yet
+// Concurrency Control: Queries may run concurrently with each other and with
+// one writer (AddNode/AddDerivedNode are serialized by the version installing
+// thread, a mutex guards them anyway). Nodes are never removed while the map
+// is alive, so readers walk raw node pointers without taking any lock:
+//  * A node is fully constructed before it is inserted in `nodes_`.
+//  * Children are appended into per node slots and published by a release
+//    store of the child count, readers acquire the count before reading the
+//    slots. Published slots are never rewritten.
+//  * Every node memorizes a lineage jump, the deepest descendant reachable by
+//    following only children covering their whole parent range. A query may
+//    take the jump as soon as it can access the target, which bounds the hops
+//    of long single file GC chains. Jumps are flattened eagerly when a version
+//    installs a derived node, so an SST referencing the first blob of such a
+//    chain reaches the live blob in one hop.
+//  * Each thread caches the latest resolutions together with the key interval
+//    for which walking the lineage takes the very same path. The cache is
+//    invalidated by any mutation of the map.
 //
 // The FileMap is implemented in a MVCC manner, a version number is passed unpon
 // creation to identify which version this file belongs to. A query operation
@@ -38,12 +54,31 @@ class FileMap {
   // We say a.sst is derived from b.sst, if b.sst contains at least
   // one valid entry from a.sst
   struct MapNode {
+    // Children are stored in chunks which never move once published
+    struct ChildChunk {
+      static constexpr size_t kSize = 8;
+      std::atomic<MapNode*> slots[kSize];
+      std::atomic<ChildChunk*> next;
+
+      ChildChunk() : next(nullptr) {
+        for (auto& slot : slots) {
+          slot.store(nullptr, std::memory_order_relaxed);
+        }
+      }
+    };
+
     uint64_t version_num;
     FileMetaData* file_meta;
     FileDescriptor fd;         // FileDescriptor of this file
     InternalKey smallest_key;  // smallest internal key
     InternalKey largest_key;   // largest internal key
-    std::vector<std::shared_ptr<MapNode>> children;  // derived blobs
+    // Number of garbage collections the data of this file has survived, a
+    // derived node is one generation older than its oldest parent
+    std::atomic<uint32_t> generation;
+    // See FileMap comments, nullptr if not computed yet
+    std::atomic<MapNode*> jump;
+    // Nodes this one is derived from, only accessed by writers
+    std::vector<MapNode*> parents;
 
     MapNode(FileMetaData* _file_meta, uint64_t _version_num)
         : version_num(_version_num),
@@ -51,29 +86,78 @@ class FileMap {
           fd(_file_meta->fd),
           smallest_key(_file_meta->smallest),
           largest_key(_file_meta->largest),
-          children() {
-      // We reserve the space for children to prevent concurrent error
-      // We hope 16 is enough for our case
-      children.reserve(32);
-    }
+          generation(0),
+          jump(nullptr),
+          num_children_(0),
+          tail_(&head_) {}
+
+    ~MapNode();
 
-    bool IsLeaf() const { return children.size() == 0; }
+    MapNode(const MapNode&) = delete;
+    MapNode& operator=(const MapNode&) = delete;
+
+    size_t NumChildren() const {
+      return num_children_.load(std::memory_order_acquire);
+    }
+    bool IsLeaf() const { return NumChildren() == 0; }
     bool Accessible(uint64_t version) const { return version_num <= version; }
     bool Contain(const Slice& u_key, const Comparator* cmp) const {
       return cmp->Compare(smallest_key.user_key(), u_key) <= 0 &&
              cmp->Compare(u_key, largest_key.user_key()) <= 0;
     }
+    // Whether the key range of this node covers `other`'s
+    bool Cover(const MapNode* other, const Comparator* cmp) const {
+      return cmp->Compare(smallest_key.user_key(),
+                          other->smallest_key.user_key()) <= 0 &&
+             cmp->Compare(other->largest_key.user_key(),
+                          largest_key.user_key()) <= 0;
+    }
+
+    // Calls `f(child)` for the published children in insertion order until
+    // it returns false
+    template <class F>
+    void ForEachChild(F&& f) const {
+      size_t n = NumChildren();
+      const ChildChunk* chunk = &head_;
+      for (size_t i = 0; i < n; ++i) {
+        if (i > 0 && i % ChildChunk::kSize == 0) {
+          chunk = chunk->next.load(std::memory_order_acquire);
+        }
+        if (!f(chunk->slots[i % ChildChunk::kSize].load(
+                std::memory_order_relaxed))) {
+          return;
+        }
+      }
+    }
+
+    // REQUIRES: external synchronization between writers
+    void AppendChild(MapNode* child);
+
+   private:
+    std::atomic<size_t> num_children_;
+    ChildChunk head_;
+    ChildChunk* tail_;
   };
 
   // Monitor for internal metrics
   struct Monitor {
-    uint64_t query_num = 0;    // The number of invokations of Query
-    uint64_t hop_num = 0;      // The total hop number during Query
-    uint64_t max_hop_num = 0;  // The max number of hop ever executed
+    // The number of invokations of Query
+    std::atomic<uint64_t> query_num{0};
+    // The total hop number during Query
+    std::atomic<uint64_t> hop_num{0};
+    // The max number of hop ever executed
+    std::atomic<uint64_t> max_hop_num{0};
+    // The number of queries served by the thread cache
+    std::atomic<uint64_t> cache_hit{0};
   };
 
+  // Upper bound of the hops a single lineage jump skips
+  static constexpr uint32_t kMaxJumpHops = 64;
+
  public:
-  FileMap() = default;
+  // `u_cmp` orders the user keys of the tracked files, it enables the eager
+  // lineage flattening
+  explicit FileMap(const Comparator* u_cmp = nullptr);
 
   // Copy is not allowed for FileMap, using pointer or reference to access it
   FileMap(const FileMap&) = delete;
@@ -113,6 +197,9 @@ class FileMap {
                        const Comparator* user_cmp, uint64_t version_num,
                        FileMetaData** filemeta);
 
+  // Returns the GC generation of file `fn`, see MapNode::generation
+  Status QueryGeneration(uint64_t fn, uint32_t* generation);
+
   // The mapping/tracking chain gets longer as the garbage collection work
   // continues to add new relations, which aggravates the inefficiency of
   // query operation. A explicit invokation of Shrink() removes useless
@@ -123,12 +210,38 @@ class FileMap {
   // Return the number of nodes in current file map
   size_t size() const { return nodes_.size(); }
 
+  // The memory held by the nodes, their keys and lineage links
+  size_t ApproximateMemoryUsage() const;
+
+  const Monitor& monitor() const { return monitor_; }
+
  private:
+  MapNode* FindNode(uint64_t fn) const;
+
+  // Walks the lineage from file `fn`, see FileMap comments
+  Status Resolve(uint64_t fn, const Slice& ukey, const Comparator* u_cmp,
+                 uint64_t version_num, MapNode** result);
+
+  // Returns the jump target of `node`, computing it if necessary
+  MapNode* LineageJump(MapNode* node, const Comparator* u_cmp);
+
+  // Points the jumps ending at `p` to the new chain end after `c`, derived
+  // from `p`, became the first child of `p`. REQUIRES: write_mutex_ held
+  void FlattenLineage(MapNode* p, MapNode* c);
+
+  void RecordHops(uint64_t hop_num);
+
+  const Comparator* const u_cmp_;
   // Indexing node in a map makes the query swiftly
   folly::ConcurrentHashMap<uint64_t, std::shared_ptr<MapNode>> nodes_;
   Monitor monitor_;   // Monitoring information
   bool auto_shrink_;  // enable auto shrink or not
 
-  // TODO: Some concurrency control stuff
+  // Identifies this map in the thread caches, never reused
+  const uint64_t id_;
+  // Bumped by every mutation, thread cache entries of older epochs are stale
+  std::atomic<uint64_t> epoch_;
+  // Serializes writers
+  mutable port::Mutex write_mutex_;
 };
 }  // namespace TERARKDB_NAMESPACE
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "db/version_edit.h"
@@ -10,6 +12,8 @@
 #include "port/port_posix.h"
 #include "port/stack_trace.h"
 #include "rocksdb/comparator.h"
+#include "rocksdb/perf_context.h"
+#include "rocksdb/perf_level.h"
 #include "rocksdb/slice.h"
 #include "util/testharness.h"
 
@@ -173,6 +177,161 @@ TEST_F(FileMapTest, TestQueryWithMVCC) {
   ASSERT_EQ(fn, 7);
   ASSERT_OK(test_map->QueryFileNumber(6, Int64ToUserKey(25), &cmp, v3, &fn));
   ASSERT_EQ(fn, 8);
+
+  // GC generation follows the oldest parent
+  uint32_t generation = 0;
+  ASSERT_OK(test_map->QueryGeneration(1, &generation));
+  ASSERT_EQ(generation, 0);
+  ASSERT_OK(test_map->QueryGeneration(4, &generation));
+  ASSERT_EQ(generation, 1);
+  ASSERT_OK(test_map->QueryGeneration(6, &generation));
+  ASSERT_EQ(generation, 0);
+  ASSERT_OK(test_map->QueryGeneration(7, &generation));
+  ASSERT_EQ(generation, 2);
+  ASSERT_TRUE(test_map->QueryGeneration(100, &generation).IsNotFound());
+}
+
+TEST_F(FileMapTest, TestLineageJump) {
+  auto test_map = std::make_shared<FileMap>();
+  MockComparator cmp;
+  const uint64_t kChain = 100;
+
+  // Every GC rewrites the single file into a new one covering its range
+  std::vector<std::shared_ptr<FileMetaData>> files;
+  for (uint64_t i = 1; i <= kChain; ++i) {
+    files.push_back(ConstructFile(1, 100, i));
+  }
+  ASSERT_OK(test_map->AddNode(files[0].get(), 1));
+  for (uint64_t i = 1; i < kChain; ++i) {
+    ASSERT_OK(test_map->AddDerivedNode(files[i - 1].get(), files[i].get(),
+                                       i + 1));
+  }
+
+  uint64_t fn = -1;
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(50), &cmp, kChain, &fn));
+  ASSERT_EQ(fn, kChain);
+  // Older versions can not take the jump
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(50), &cmp, 10, &fn));
+  ASSERT_EQ(fn, 10);
+
+  // A fresh thread has an empty cache and follows the memorized jumps
+  uint64_t hops = test_map->monitor().hop_num.load();
+  std::thread([&] {
+    ASSERT_OK(
+        test_map->QueryFileNumber(1, Int64ToUserKey(60), &cmp, kChain, &fn));
+  }).join();
+  ASSERT_EQ(fn, kChain);
+  ASSERT_LE(test_map->monitor().hop_num.load() - hops,
+            kChain / FileMap::kMaxJumpHops + 1);
+}
+
+TEST_F(FileMapTest, TestThreadCache) {
+  auto test_map = std::make_shared<FileMap>();
+  MockComparator cmp;
+  uint64_t fn = -1;
+
+  // Overlapping outputs, the first child containing the key wins
+  auto f1 = ConstructFile(1, 30, 1);
+  auto f2 = ConstructFile(1, 10, 2);
+  auto f3 = ConstructFile(5, 20, 3);
+  auto f4 = ConstructFile(25, 30, 4);
+  ASSERT_OK(test_map->AddNode(f1.get(), 1));
+  ASSERT_OK(test_map->AddDerivedNode(f1.get(), f2.get(), 2));
+  ASSERT_OK(test_map->AddDerivedNode(f1.get(), f3.get(), 2));
+
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(15), &cmp, 2, &fn));
+  ASSERT_EQ(fn, 3);
+  uint64_t hits = test_map->monitor().cache_hit.load();
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(16), &cmp, 2, &fn));
+  ASSERT_EQ(fn, 3);
+  ASSERT_EQ(test_map->monitor().cache_hit.load(), hits + 1);
+  // Within the range of 3.sst, but reaching 2.sst first
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(7), &cmp, 2, &fn));
+  ASSERT_EQ(fn, 2);
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(15), &cmp, 1, &fn));
+  ASSERT_EQ(fn, 1);
+  // Not covered by any child
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(26), &cmp, 2, &fn));
+  ASSERT_EQ(fn, 1);
+
+  // A new child invalidates the cached resolution
+  ASSERT_OK(test_map->AddDerivedNode(f1.get(), f4.get(), 2));
+  ASSERT_OK(test_map->QueryFileNumber(1, Int64ToUserKey(27), &cmp, 2, &fn));
+  ASSERT_EQ(fn, 4);
+}
+
+TEST_F(FileMapTest, TestConcurrentQuery) {
+  auto test_map = std::make_shared<FileMap>();
+  MockComparator cmp;
+  const uint64_t kChain = 2000;
+
+  std::vector<std::shared_ptr<FileMetaData>> files;
+  for (uint64_t i = 1; i <= kChain; ++i) {
+    // Only every other output covers its parent and yields a lineage jump
+    files.push_back(ConstructFile(1, i % 2 == 0 ? 100 : 90, i));
+  }
+  ASSERT_OK(test_map->AddNode(files[0].get(), 1));
+  std::atomic<uint64_t> published{1};
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t] {
+      Slice key = Int64ToUserKey(10 + t);
+      while (!done.load()) {
+        uint64_t version = published.load();
+        uint64_t fn = -1;
+        ASSERT_OK(test_map->QueryFileNumber(1, key, &cmp, version, &fn));
+        ASSERT_EQ(fn, version);
+      }
+    });
+  }
+  for (uint64_t i = 1; i < kChain; ++i) {
+    ASSERT_OK(test_map->AddDerivedNode(files[i - 1].get(), files[i].get(),
+                                       i + 1));
+    published.store(i + 1);
+  }
+  done.store(true);
+  for (auto& t : readers) {
+    t.join();
+  }
+}
+
+TEST_F(FileMapTest, TestEagerFlatten) {
+  MockComparator cmp;
+  auto test_map = std::make_shared<FileMap>(&cmp);
+  const uint64_t kChain = FileMap::kMaxJumpHops / 2;
+
+  // 1.sst and 2.sst are merged into 3.sst, then 3.sst keeps being rewritten
+  std::vector<std::shared_ptr<FileMetaData>> files;
+  files.push_back(ConstructFile(1, 50, 1));
+  files.push_back(ConstructFile(51, 100, 2));
+  for (uint64_t i = 3; i <= kChain; ++i) {
+    files.push_back(ConstructFile(1, 100, i));
+  }
+  ASSERT_OK(test_map->AddNode(files[0].get(), 1));
+  ASSERT_OK(test_map->AddNode(files[1].get(), 1));
+  ASSERT_OK(test_map->AddDerivedNode(files[0].get(), files[2].get(), 2));
+  ASSERT_OK(test_map->AddDerivedNode(files[1].get(), files[2].get(), 2));
+  for (uint64_t i = 3; i < kChain; ++i) {
+    ASSERT_OK(
+        test_map->AddDerivedNode(files[i - 1].get(), files[i].get(), i));
+  }
+
+  SetPerfLevel(PerfLevel::kEnableCount);
+  for (uint64_t fn : {1, 2}) {
+    uint64_t ret = -1;
+    std::thread([&] {
+      get_perf_context()->Reset();
+      ASSERT_OK(test_map->QueryFileNumber(fn, Int64ToUserKey(fn * 50 - 1),
+                                          &cmp, kChain, &ret));
+      // Both originals jump to the live blob directly
+      ASSERT_EQ(1, get_perf_context()->blob_lineage_resolve_count);
+      ASSERT_EQ(1, get_perf_context()->blob_lineage_hop_count);
+    }).join();
+    ASSERT_EQ(ret, kChain);
+  }
+  SetPerfLevel(PerfLevel::kDisable);
 }
 
 }  // namespace TERARKDB_NAMESPACE
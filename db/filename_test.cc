@@ -39,8 +39,11 @@ TEST_F(FileNameTest, Parse) {
       {"100.log", 100, kLogFile, kAllMode},
       {"0.log", 0, kLogFile, kAllMode},
       {"0.sst", 0, kTableFile, kAllMode},
+      {"100.vlog", 100, kValueLogFile, kAllMode},
       {"CURRENT", 0, kCurrentFile, kAllMode},
       {"LOCK", 0, kDBLockFile, kAllMode},
+      {"HOT_BLOCKS", 0, kHotBlocksFile, kAllMode},
+      {"HOT_BLOCKS.dbtmp", 0, kHotBlocksFile, kAllMode},
       {"MANIFEST-2", 2, kDescriptorFile, kAllMode},
       {"MANIFEST-7", 7, kDescriptorFile, kAllMode},
       {"METADB-2", 2, kMetaDatabase, kAllMode},
@@ -143,6 +146,12 @@ TEST_F(FileNameTest, Construction) {
   ASSERT_EQ(192U, number);
   ASSERT_EQ(kLogFile, type);
 
+  fname = ValueLogFileName("foo", 192);
+  ASSERT_EQ("foo/", std::string(fname.data(), 4));
+  ASSERT_TRUE(ParseFileName(fname.c_str() + 4, &number, &type));
+  ASSERT_EQ(192U, number);
+  ASSERT_EQ(kValueLogFile, type);
+
   fname = TableFileName({DbPath("bar", 0)}, 200, 0);
   std::string fname1 =
       TableFileName({DbPath("foo", 0), DbPath("bar", 0)}, 200, 1);
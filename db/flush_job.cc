@@ -32,6 +32,8 @@
 #include "db/merge_context.h"
 #include "db/range_tombstone_fragmenter.h"
 #include "db/version_set.h"
+#include "monitoring/cpu_attribution.h"
+#include "monitoring/io_attribution.h"
 #include "monitoring/iostats_context_imp.h"
 #include "monitoring/perf_context_imp.h"
 #include "monitoring/thread_status_util.h"
@@ -47,6 +49,7 @@
 #include "table/merging_iterator.h"
 #include "table/table_builder.h"
 #include "table/two_level_iterator.h"
+#include "util/async_task.h"
 #include "util/c_style_callback.h"
 #include "util/coding.h"
 #include "util/event_logger.h"
@@ -93,6 +96,130 @@ const char* GetFlushReasonString(FlushReason flush_reason) {
   }
 }
 
+namespace {
+
+// Restricts an arena allocated internal iterator to the user keys in
+// [start, end), a null bound is open. Every key range of a partitioned flush
+// reads the memtables through one of these.
+class FlushRangeIterator : public InternalIterator {
+ public:
+  FlushRangeIterator(InternalIterator* iter, const Comparator* ucmp,
+                     const std::string* start, const std::string* end)
+      : iter_(iter), ucmp_(ucmp), start_(start), end_(end), valid_(false) {
+    if (start_ != nullptr) {
+      start_ikey_.SetMinPossibleForUserKey(*start_);
+    }
+    if (end_ != nullptr) {
+      end_ikey_.SetMinPossibleForUserKey(*end_);
+    }
+  }
+
+  ~FlushRangeIterator() { iter_->~InternalIterator(); }
+
+  bool Valid() const override { return valid_; }
+
+  void SeekToFirst() override {
+    if (start_ != nullptr) {
+      iter_->Seek(start_ikey_.Encode());
+    } else {
+      iter_->SeekToFirst();
+    }
+    Update();
+  }
+
+  void SeekToLast() override {
+    if (end_ != nullptr) {
+      iter_->Seek(end_ikey_.Encode());
+      if (iter_->Valid()) {
+        iter_->Prev();
+      } else if (iter_->status().ok()) {
+        iter_->SeekToLast();
+      }
+    } else {
+      iter_->SeekToLast();
+    }
+    Update();
+  }
+
+  void Seek(const Slice& target) override {
+    if (start_ != nullptr &&
+        ucmp_->Compare(ExtractUserKey(target), *start_) < 0) {
+      iter_->Seek(start_ikey_.Encode());
+    } else {
+      iter_->Seek(target);
+    }
+    Update();
+  }
+
+  void SeekForPrev(const Slice& target) override {
+    if (end_ != nullptr && ucmp_->Compare(ExtractUserKey(target), *end_) >= 0) {
+      SeekToLast();
+      return;
+    }
+    iter_->SeekForPrev(target);
+    Update();
+  }
+
+  void Next() override {
+    iter_->Next();
+    Update();
+  }
+
+  void Prev() override {
+    iter_->Prev();
+    Update();
+  }
+
+  Slice key() const override { return iter_->key(); }
+  LazyBuffer value() const override { return iter_->value(); }
+  Status status() const override { return iter_->status(); }
+
+ private:
+  void Update() {
+    valid_ = iter_->Valid();
+    if (valid_) {
+      Slice user_key = ExtractUserKey(iter_->key());
+      valid_ = (start_ == nullptr || ucmp_->Compare(user_key, *start_) >= 0) &&
+               (end_ == nullptr || ucmp_->Compare(user_key, *end_) < 0);
+    }
+  }
+
+  InternalIterator* iter_;
+  const Comparator* ucmp_;
+  const std::string* start_;
+  const std::string* end_;
+  InternalKey start_ikey_;
+  InternalKey end_ikey_;
+  bool valid_;
+};
+
+// Walks `iter` and picks up to `n - 1` user keys that split its `num_entries`
+// entries into ranges of about the same count. All versions of a user key
+// fall into the same range.
+void SampleFlushFences(InternalIterator* iter, uint64_t num_entries, size_t n,
+                       const Comparator* ucmp,
+                       std::vector<std::string>* fences) {
+  uint64_t step = num_entries / n;
+  if (step == 0) {
+    return;
+  }
+  uint64_t count = 0;
+  for (iter->SeekToFirst(); iter->Valid() && fences->size() + 1 < n;
+       iter->Next()) {
+    if (++count < step) {
+      continue;
+    }
+    Slice user_key = ExtractUserKey(iter->key());
+    if (!fences->empty() && ucmp->Compare(user_key, fences->back()) <= 0) {
+      continue;
+    }
+    fences->emplace_back(user_key.data(), user_key.size());
+    count = 0;
+  }
+}
+
+}  // namespace
+
 FlushJob::FlushJob(
     const std::string& dbname, ColumnFamilyData* cfd,
     const ImmutableDBOptions& db_options,
@@ -129,6 +256,7 @@ FlushJob::FlushJob(
       sync_output_directory_(sync_output_directory),
       write_manifest_(write_manifest),
       flush_load_(flush_load),
+      num_sst_outputs_(1),
       edit_(nullptr),
       base_(nullptr),
       pick_memtable_called_(false),
@@ -202,6 +330,8 @@ Status FlushJob::Run(LogsWithPrepTracker* prep_tracker) {
   db_mutex_->AssertHeld();
   assert(pick_memtable_called_);
   AutoThreadOperationStageUpdater stage_run(ThreadStatus::STAGE_FLUSH_RUN);
+  IOJobScope io_job_scope(IOJobKind::kFlush);
+  CpuJobScope cpu_job_scope(CpuJobKind::kFlush, cfd_->cpu_attribution());
   if (mems_.empty()) {
     ROCKS_LOG_BUFFER(log_buffer_, "[%s] Nothing in memtable to flush",
                      cfd_->GetName().c_str());
@@ -401,22 +531,156 @@ Status FlushJob::WriteLevel0Table() {
       // if this implementation is error-free
       //
 
-      // s = BuildTable(
-      s = BuildPartitionTable(
-          dbname_, versions_, db_options_.env, *cfd_->ioptions(),
-          mutable_cf_options_, env_options, cfd_->table_cache(),
-          c_style_callback(get_arena_input_iter), &get_arena_input_iter,
-          c_style_callback(get_range_del_iters), &get_range_del_iters, &meta_,
-          cfd_->internal_comparator(),
-          cfd_->int_tbl_prop_collector_factories(mutable_cf_options_),
-          cfd_->int_tbl_prop_collector_factories_for_blob(mutable_cf_options_),
-          cfd_->GetID(), cfd_->GetName(), existing_snapshots_,
-          earliest_write_conflict_snapshot_, snapshot_checker_,
-          output_compression_, cfd_->ioptions()->compression_opts,
-          mutable_cf_options_.paranoid_file_checks, cfd_->internal_stats(),
-          TableFileCreationReason::kFlush, event_logger_, job_context_->job_id,
-          Env::IO_HIGH, &table_properties_, 0 /* level */, flush_load_,
-          current_time, oldest_key_time, write_hint);
+      // A small column family of an atomic flush group writes its values
+      // inline, the group then outputs one file per column family
+      MutableCFOptions inline_value_options;
+      const MutableCFOptions* build_options = &mutable_cf_options_;
+      if (cfd_->ioptions()->atomic_flush_group != nullptr &&
+          total_memory_usage <
+              mutable_cf_options_.atomic_flush_inline_value_size) {
+        inline_value_options = mutable_cf_options_;
+        inline_value_options.blob_size = size_t(-1);
+        build_options = &inline_value_options;
+        ROCKS_LOG_INFO(db_options_.info_log,
+                       "[%s] [JOB %d] Grouped flush of %" ROCKSDB_PRIszt
+                       " bytes keeps the values inline",
+                       cfd_->GetName().c_str(), job_context_->job_id,
+                       total_memory_usage);
+      }
+
+      // Split a large flush into key ranges at fences sampled from the
+      // biggest memtable. Range tombstones may span several ranges, those
+      // flushes keep a single output.
+      std::vector<std::string> fences;
+      size_t max_partitions = std::min<uint64_t>(
+          mutable_cf_options_.max_flush_partitions,
+          total_memory_usage /
+              std::max<uint64_t>(mutable_cf_options_.target_file_size_base, 1));
+      if (build_options != &mutable_cf_options_) {
+        max_partitions = 1;
+      }
+      if (max_partitions > 1 && get_range_del_iters().empty()) {
+        MemTable* largest = *std::max_element(
+            mems_.begin(), mems_.end(), [](MemTable* a, MemTable* b) {
+              return a->num_entries() < b->num_entries();
+            });
+        Arena sample_arena;
+        ScopedArenaIterator sample_iter(
+            largest->NewIterator(ro, &sample_arena));
+        SampleFlushFences(sample_iter.get(), largest->num_entries(),
+                          max_partitions, cfd_->user_comparator(), &fences);
+      }
+
+      struct FlushPartition {
+        std::vector<FileMetaData> meta;
+        std::vector<TableProperties> table_properties;
+        Status status;
+      };
+      std::vector<FlushPartition> partitions(fences.size() + 1);
+      partitions.front().meta = std::move(meta_);
+      for (size_t i = 1; i < partitions.size(); ++i) {
+        partitions[i].meta.emplace_back();
+        partitions[i].meta.front().fd =
+            FileDescriptor(versions_->NewFileNumber(), 0, 0);
+      }
+
+      auto build_partition = [&](size_t i) {
+        const std::string* start = i == 0 ? nullptr : &fences[i - 1];
+        const std::string* end = i == fences.size() ? nullptr : &fences[i];
+        auto get_partition_input_iter = [&](Arena& arena) {
+          InternalIterator* input = get_arena_input_iter(arena);
+          if (fences.empty()) {
+            return input;
+          }
+          return static_cast<InternalIterator*>(
+              new (arena.AllocateAligned(sizeof(FlushRangeIterator)))
+                  FlushRangeIterator(input, cfd_->user_comparator(), start,
+                                     end));
+        };
+        auto& partition = partitions[i];
+        // s = BuildTable(
+        partition.status = BuildPartitionTable(
+            dbname_, versions_, db_options_.env, *cfd_->ioptions(),
+            *build_options, env_options, cfd_->table_cache(),
+            c_style_callback(get_partition_input_iter),
+            &get_partition_input_iter, c_style_callback(get_range_del_iters),
+            &get_range_del_iters, &partition.meta,
+            cfd_->internal_comparator(),
+            cfd_->int_tbl_prop_collector_factories(mutable_cf_options_),
+            cfd_->int_tbl_prop_collector_factories_for_blob(
+                mutable_cf_options_),
+            cfd_->GetID(), cfd_->GetName(), existing_snapshots_,
+            earliest_write_conflict_snapshot_, snapshot_checker_,
+            output_compression_, cfd_->ioptions()->compression_opts,
+            mutable_cf_options_.paranoid_file_checks, cfd_->internal_stats(),
+            TableFileCreationReason::kFlush, event_logger_,
+            job_context_->job_id, Env::IO_HIGH, &partition.table_properties,
+            0 /* level */, flush_load_, current_time, oldest_key_time,
+            write_hint);
+      };
+      // Helpers on the flush pool and this thread take the ranges in turn.
+      // A helper that has not started when this thread runs out of ranges is
+      // unscheduled, its callback then finds nothing left to build.
+      std::atomic<size_t> next_partition(0);
+      auto build_partitions = [&]() {
+        for (size_t i; (i = next_partition.fetch_add(1)) < partitions.size();) {
+          build_partition(i);
+        }
+        return Status::OK();
+      };
+      std::vector<std::unique_ptr<AsyncTask<Status>>> vec_task;
+      for (size_t i = 1; i < partitions.size(); ++i) {
+        vec_task.emplace_back(new AsyncTask<Status>(build_partitions));
+        auto task = vec_task.back().get();
+        db_options_.env->Schedule(c_style_callback(*task), task, Env::HIGH,
+                                  task, c_style_callback(*task));
+      }
+      build_partitions();
+      for (auto& task : vec_task) {
+        db_options_.env->UnSchedule(task.get(), Env::HIGH);
+        task->get();
+      }
+
+      // Keep the non empty ranges, their L0 files first, then the blobs
+      assert(meta_.empty() && table_properties_.empty());
+      std::vector<FileMetaData> blob_meta;
+      std::vector<TableProperties> blob_table_properties;
+      for (auto& partition : partitions) {
+        if (s.ok()) {
+          s = partition.status;
+        }
+        assert(partition.meta.size() == partition.table_properties.size());
+        if (partition.meta.front().fd.GetFileSize() == 0 &&
+            partitions.size() > 1) {
+          continue;
+        }
+        meta_.emplace_back(std::move(partition.meta.front()));
+        table_properties_.emplace_back(
+            std::move(partition.table_properties.front()));
+        for (size_t i = 1; i < partition.meta.size(); ++i) {
+          blob_meta.emplace_back(std::move(partition.meta[i]));
+          blob_table_properties.emplace_back(
+              std::move(partition.table_properties[i]));
+        }
+      }
+      if (meta_.empty()) {
+        // Every range came out empty, report it the same as a single output
+        meta_.emplace_back(std::move(partitions.front().meta.front()));
+        table_properties_.emplace_back(
+            std::move(partitions.front().table_properties.front()));
+      }
+      num_sst_outputs_ = meta_.size();
+      for (size_t i = 0; i < blob_meta.size(); ++i) {
+        meta_.emplace_back(std::move(blob_meta[i]));
+        table_properties_.emplace_back(std::move(blob_table_properties[i]));
+      }
+      if (partitions.size() > 1) {
+        ROCKS_LOG_INFO(db_options_.info_log,
+                       "[%s] [JOB %d] Level-0 flush split into %" ROCKSDB_PRIszt
+                       " ranges, %" ROCKSDB_PRIszt " non empty",
+                       cfd_->GetName().c_str(), job_context_->job_id,
+                       partitions.size(), num_sst_outputs_);
+      }
       if (s.ok() && cfd_->ioptions()->ttl_extractor_factory != nullptr) {
         ROCKS_LOG_INFO(db_options_.info_log,
                        "FlushOutput earliest_time_begin_compact = %" PRIu64
@@ -445,29 +709,32 @@ Status FlushJob::WriteLevel0Table() {
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
+  int output_level = 0;
   if (s.ok() && meta_[0].fd.GetFileSize() > 0) {
     // if we have more than 1 background thread, then we cannot
     // insert files directly into higher levels because some other
     // threads could be concurrently producing compacted files for
-    // that key range.
-    // Add file to L0
+    // that key range, unless PickOutputLevel() finds none.
+    output_level = PickOutputLevel();
     for (size_t i = 0; i < meta_.size(); ++i) {
       auto& f = meta_[i];
-      edit_->AddFile(i == 0 ? 0 : -1, f.fd.GetNumber(), f.fd.GetPathId(),
-                     f.fd.GetFileSize(), f.smallest, f.largest,
-                     f.fd.smallest_seqno, f.fd.largest_seqno,
+      bool is_sst = i < num_sst_outputs_;
+      edit_->AddFile(is_sst ? output_level : -1, f.fd.GetNumber(),
+                     f.fd.GetPathId(), f.fd.GetFileSize(), f.smallest,
+                     f.largest, f.fd.smallest_seqno, f.fd.largest_seqno,
                      f.marked_for_compaction, f.prop);
-      if (i > 0) {
+      if (!is_sst) {
         edit_->AddNewBlob(f);
       }
     }
   }
 
-  // Note that here we treat flush as level 0 compaction in internal stats
+  // Note that here we treat flush as a compaction into its output level in
+  // internal stats
   InternalStats::CompactionStats stats(CompactionReason::kFlush, 1);
   stats.micros = db_options_.env->NowMicros() - start_micros;
   for (size_t i = 0; i < meta_.size(); ++i) {
-    if (i == 0) {
+    if (i < num_sst_outputs_) {
       stats.bytes_written += meta_[i].fd.GetFileSize();
     } else {
       stats.bytes_blob_written += meta_[i].fd.GetFileSize();
@@ -476,10 +743,45 @@ Status FlushJob::WriteLevel0Table() {
                                        meta_[i].fd.GetFileSize());
   }
   MeasureTime(stats_, FLUSH_TIME, stats.micros);
-  cfd_->internal_stats()->AddCompactionStats(0 /* level */, stats);
+  cfd_->internal_stats()->AddCompactionStats(output_level, stats);
   RecordFlushIOStats();
 
   return s;
 }
 
+int FlushJob::PickOutputLevel() {
+  db_mutex_->AssertHeld();
+  const ImmutableCFOptions* ioptions = cfd_->ioptions();
+  int bottommost_level =
+      ioptions->num_levels - (ioptions->allow_ingest_behind ? 2 : 1);
+  if (!mutable_cf_options_.flush_to_bottommost_level ||
+      ioptions->compaction_style != kCompactionStyleLevel ||
+      bottommost_level <= 0 || num_sst_outputs_ == 0) {
+    return 0;
+  }
+  // An older memtable flushed later would land above the newer keys of this
+  // one
+  if (cfd_->imm()->NumNotFlushed() != static_cast<int>(mems_.size())) {
+    return 0;
+  }
+  // The outputs of the partitions are sorted and don't overlap
+  Slice smallest = meta_[0].smallest.user_key();
+  Slice largest = meta_[num_sst_outputs_ - 1].largest.user_key();
+  VersionStorageInfo* vstorage = cfd_->current()->storage_info();
+  for (int level = 0; level <= bottommost_level; ++level) {
+    if (vstorage->OverlapInLevel(level, &smallest, &largest)) {
+      return 0;
+    }
+  }
+  if (cfd_->compaction_picker()->RangeOverlapWithCompaction(
+          smallest, largest, bottommost_level)) {
+    return 0;
+  }
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "[%s] [JOB %d] Flush overlaps no file, placing it at level %d",
+                 cfd_->GetName().c_str(), job_context_->job_id,
+                 bottommost_level);
+  return bottommost_level;
+}
+
 }  // namespace TERARKDB_NAMESPACE
@@ -90,6 +90,9 @@ class FlushJob {
   void ReportFlushInputSize(const autovector<MemTable*>& mems);
   void RecordFlushIOStats();
   Status WriteLevel0Table();
+  // The level of the flushed table files, see flush_to_bottommost_level.
+  // REQUIRES: db_mutex held
+  int PickOutputLevel();
 
   const std::string& dbname_;
   ColumnFamilyData* cfd_;
@@ -139,7 +142,9 @@ class FlushJob {
   const double flush_load_;
 
   // Variables below are set by PickMemTable():
+  // The L0 files of every key range come first, then the blobs
   std::vector<FileMetaData> meta_;
+  size_t num_sst_outputs_;
   autovector<MemTable*> mems_;
   VersionEdit* edit_;
   Version* base_;
@@ -6,6 +6,7 @@
 #ifndef ROCKSDB_LITE
 #include "db/forward_iterator.h"
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <utility>
@@ -42,8 +43,8 @@ class ForwardLevelIterator : public InternalIterator {
                        const SliceTransform* prefix_extractor)
       : cfd_(cfd),
         read_options_(read_options),
-        files_(files),
-        dependence_map_(dependence_map),
+        files_(&files),
+        dependence_map_(&dependence_map),
         valid_(false),
         file_index_(std::numeric_limits<uint32_t>::max()),
         file_iter_(nullptr),
@@ -55,15 +56,40 @@ class ForwardLevelIterator : public InternalIterator {
   }
 
   void SetFileIndex(uint32_t file_index) {
-    assert(file_index < files_.size());
+    assert(file_index < files_->size());
     status_ = Status::OK();
     if (file_index != file_index_) {
       file_index_ = file_index;
       Reset();
     }
   }
+  // Switch to the files of a newer version of the level. The table iterator
+  // is kept if its file is still there, unless it is a map SST, whose
+  // iterator refers to the dependence map of the old version.
+  void Renew(const std::vector<FileMetaData*>& files,
+             const DependenceMap& dependence_map) {
+    uint32_t file_index = std::numeric_limits<uint32_t>::max();
+    if (file_iter_ != nullptr && status_.ok() && file_iter_->status().ok()) {
+      FileMetaData* f = (*files_)[file_index_];
+      auto find = std::find(files.begin(), files.end(), f);
+      if (!f->prop.is_map_sst() && find != files.end()) {
+        file_index = static_cast<uint32_t>(find - files.begin());
+      }
+    }
+    if (file_index == std::numeric_limits<uint32_t>::max()) {
+      delete file_iter_;
+      file_iter_ = nullptr;
+      status_ = Status::OK();
+    } else {
+      TEST_SYNC_POINT("ForwardLevelIterator::Renew:KeepFileIter");
+    }
+    files_ = &files;
+    dependence_map_ = &dependence_map;
+    file_index_ = file_index;
+    valid_ = false;
+  }
   void Reset() {
-    assert(file_index_ < files_.size());
+    assert(file_index_ < files_->size());
 
     // Reset current pointer
     delete file_iter_;
@@ -71,8 +97,8 @@ class ForwardLevelIterator : public InternalIterator {
     ReadRangeDelAggregator range_del_agg(&cfd_->internal_comparator(),
                                          kMaxSequenceNumber /* upper_bound */);
     file_iter_ = cfd_->table_cache()->NewIterator(
-        read_options_, *(cfd_->soptions()), *files_[file_index_],
-        dependence_map_,
+        read_options_, *(cfd_->soptions()), *(*files_)[file_index_],
+        *dependence_map_,
         read_options_.ignore_range_deletions ? nullptr : &range_del_agg,
         prefix_extractor_, nullptr /* table_reader_ptr */, nullptr, false);
     valid_ = false;
@@ -131,7 +157,7 @@ class ForwardLevelIterator : public InternalIterator {
       if (valid_) {
         return;
       }
-      if (file_index_ + 1 >= files_.size()) {
+      if (file_index_ + 1 >= files_->size()) {
         valid_ = false;
         return;
       }
@@ -163,8 +189,8 @@ class ForwardLevelIterator : public InternalIterator {
  private:
   const ColumnFamilyData* const cfd_;
   const ReadOptions& read_options_;
-  const std::vector<FileMetaData*>& files_;
-  const DependenceMap& dependence_map_;
+  const std::vector<FileMetaData*>* files_;
+  const DependenceMap* dependence_map_;
 
   bool valid_;
   uint32_t file_index_;
@@ -564,7 +590,7 @@ void ForwardIterator::RebuildIterators(bool refresh_sv) {
         read_options_.ignore_range_deletions ? nullptr : &range_del_agg,
         sv_->mutable_cf_options.prefix_extractor.get()));
   }
-  BuildLevelIterators(vstorage);
+  BuildLevelIterators(vstorage, sv_);
   current_ = nullptr;
   is_prev_set_ = false;
 
@@ -607,13 +633,18 @@ void ForwardIterator::RenewIterators() {
   const auto& l0_files_new = vstorage_new->LevelFiles(0);
   size_t iold, inew;
   bool found;
+  // The iterators of the old version were built with its prefix extractor
+  bool reuse_iters = svnew->mutable_cf_options.prefix_extractor.get() ==
+                     sv_->mutable_cf_options.prefix_extractor.get();
   std::vector<InternalIterator*> l0_iters_new;
   l0_iters_new.reserve(l0_files_new.size());
 
   for (inew = 0; inew < l0_files_new.size(); inew++) {
     found = false;
-    for (iold = 0; iold < l0_files.size(); iold++) {
-      if (l0_files[iold] == l0_files_new[inew]) {
+    // Iterators of map SSTs refer to the dependence map of the old version
+    for (iold = 0; iold < l0_files.size() && reuse_iters; iold++) {
+      if (l0_files[iold] == l0_files_new[inew] &&
+          !l0_files[iold]->prop.is_map_sst()) {
         found = true;
         break;
       }
@@ -642,11 +673,13 @@ void ForwardIterator::RenewIterators() {
   l0_iters_.clear();
   l0_iters_ = l0_iters_new;
 
-  for (auto* l : level_iters_) {
+  std::vector<ForwardLevelIterator*> level_iters_old;
+  level_iters_old.swap(level_iters_);
+  BuildLevelIterators(vstorage_new, svnew,
+                      reuse_iters ? &level_iters_old : nullptr);
+  for (auto* l : level_iters_old) {
     DeleteIterator(l);
   }
-  level_iters_.clear();
-  BuildLevelIterators(vstorage_new);
   current_ = nullptr;
   is_prev_set_ = false;
   SVUpdate(svnew);
@@ -658,7 +691,9 @@ void ForwardIterator::RenewIterators() {
   }
 }
 
-void ForwardIterator::BuildLevelIterators(const VersionStorageInfo* vstorage) {
+void ForwardIterator::BuildLevelIterators(
+    const VersionStorageInfo* vstorage, SuperVersion* sv,
+    std::vector<ForwardLevelIterator*>* level_iters_old) {
   level_iters_.reserve(vstorage->num_levels() - 1);
   for (int32_t level = 1; level < vstorage->num_levels(); ++level) {
     const auto& level_files = vstorage->LevelFiles(level);
@@ -671,10 +706,19 @@ void ForwardIterator::BuildLevelIterators(const VersionStorageInfo* vstorage) {
       if (!level_files.empty()) {
         has_iter_trimmed_for_upper_bound_ = true;
       }
+    } else if (level_iters_old != nullptr &&
+               static_cast<size_t>(level - 1) < level_iters_old->size() &&
+               (*level_iters_old)[level - 1] != nullptr) {
+      // Patch the iterator of the old version, it keeps the table iterator
+      // of a file the compactions didn't touch
+      auto* level_iter = (*level_iters_old)[level - 1];
+      (*level_iters_old)[level - 1] = nullptr;
+      level_iter->Renew(level_files, vstorage->dependence_map());
+      level_iters_.push_back(level_iter);
     } else {
       level_iters_.push_back(new ForwardLevelIterator(
           cfd_, read_options_, level_files, vstorage->dependence_map(),
-          sv_->mutable_cf_options.prefix_extractor.get()));
+          sv->mutable_cf_options.prefix_extractor.get()));
     }
   }
 }
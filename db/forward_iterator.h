@@ -113,7 +113,11 @@ class ForwardIterator : public InternalIterator, public SVDestructCallback {
 
   void RebuildIterators(bool refresh_sv);
   void RenewIterators();
-  void BuildLevelIterators(const VersionStorageInfo* vstorage);
+  // Build the iterators of level 1 and up for vstorage of sv, taking over the
+  // ones of level_iters_old, which are left nullptr, if not nullptr
+  void BuildLevelIterators(
+      const VersionStorageInfo* vstorage, SuperVersion* sv,
+      std::vector<ForwardLevelIterator*>* level_iters_old = nullptr);
   void ResetIncompleteIterators();
   void SeekInternal(const Slice& internal_key, bool seek_to_first);
   void UpdateCurrent();
@@ -0,0 +1,114 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/hot_block_set.h"
+
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+const Slice kHotBlockSetMagic("HOTBLKS", 7);
+const uint32_t kHotBlockSetFormatVersion = 1;
+}  // namespace
+
+void HotBlockSet::EncodeTo(std::string* dst) const {
+  const size_t start = dst->size();
+  dst->append(kHotBlockSetMagic.data(), kHotBlockSetMagic.size());
+  PutVarint32(dst, kHotBlockSetFormatVersion);
+  PutVarint64(dst, tables.size());
+  for (auto& table : tables) {
+    PutVarint32(dst, table.column_family_id);
+    PutVarint64(dst, table.file_number);
+    PutVarint64(dst, table.keys.size());
+    for (auto& key : table.keys) {
+      PutLengthPrefixedSlice(dst, key);
+    }
+  }
+  PutFixed32(dst, crc32c::Mask(crc32c::Value(dst->data() + start,
+                                             dst->size() - start)));
+}
+
+Status HotBlockSet::DecodeFrom(Slice input) {
+  tables.clear();
+  if (input.size() < kHotBlockSetMagic.size() + sizeof(uint32_t) ||
+      !input.starts_with(kHotBlockSetMagic)) {
+    return Status::Corruption("hot block set", "bad magic");
+  }
+  const size_t body_size = input.size() - sizeof(uint32_t);
+  uint32_t crc = crc32c::Unmask(DecodeFixed32(input.data() + body_size));
+  if (crc != crc32c::Value(input.data(), body_size)) {
+    return Status::Corruption("hot block set", "checksum mismatch");
+  }
+  input = Slice(input.data() + kHotBlockSetMagic.size(),
+                body_size - kHotBlockSetMagic.size());
+
+  uint32_t version;
+  uint64_t num_tables;
+  if (!GetVarint32(&input, &version) || !GetVarint64(&input, &num_tables)) {
+    return Status::Corruption("hot block set", "truncated header");
+  }
+  if (version != kHotBlockSetFormatVersion) {
+    return Status::NotSupported("hot block set", "unknown format version");
+  }
+  // Every table takes at least three bytes, don't let a bogus count reserve
+  // memory
+  if (num_tables > input.size()) {
+    return Status::Corruption("hot block set", "bad table count");
+  }
+  tables.resize(num_tables);
+  for (auto& table : tables) {
+    uint64_t num_keys;
+    if (!GetVarint32(&input, &table.column_family_id) ||
+        !GetVarint64(&input, &table.file_number) ||
+        !GetVarint64(&input, &num_keys) || num_keys > input.size()) {
+      tables.clear();
+      return Status::Corruption("hot block set", "truncated table");
+    }
+    table.keys.resize(num_keys);
+    for (auto& key : table.keys) {
+      Slice slice;
+      if (!GetLengthPrefixedSlice(&input, &slice)) {
+        tables.clear();
+        return Status::Corruption("hot block set", "truncated key");
+      }
+      key.assign(slice.data(), slice.size());
+    }
+  }
+  if (!input.empty()) {
+    tables.clear();
+    return Status::Corruption("hot block set", "trailing bytes");
+  }
+  return Status::OK();
+}
+
+Status WriteHotBlockSetFile(Env* env, const HotBlockSet& hot_blocks,
+                            const std::string& fname,
+                            const std::string& tmp_fname) {
+  std::string data;
+  hot_blocks.EncodeTo(&data);
+  Status s = WriteStringToFile(env, data, tmp_fname, true /* should_sync */);
+  if (s.ok()) {
+    s = env->RenameFile(tmp_fname, fname);
+  }
+  if (!s.ok()) {
+    env->DeleteFile(tmp_fname);
+  }
+  return s;
+}
+
+Status ReadHotBlockSetFile(Env* env, const std::string& fname,
+                           HotBlockSet* hot_blocks) {
+  std::string data;
+  Status s = ReadFileToString(env, fname, &data);
+  if (s.ok()) {
+    s = hot_blocks->DecodeFrom(data);
+  }
+  return s;
+}
+
+}  // namespace TERARKDB_NAMESPACE
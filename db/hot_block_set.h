@@ -0,0 +1,49 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// The hot block sets of the live tables of a DB, as persisted in HOT_BLOCKS.
+// A table is named by its column family and file number, its blocks by the
+// internal keys TableReader::GetHotBlockKeys() reports, which stay valid as
+// long as the table lives.
+//
+// The file holds kHotBlockSetMagic, a varint32 format version and the tables
+// in the varint / length prefixed encoding of util/coding.h, followed by a
+// fixed32 masked crc32c of everything before it.
+struct HotBlockSet {
+  struct Table {
+    uint32_t column_family_id = 0;
+    uint64_t file_number = 0;
+    std::vector<std::string> keys;
+  };
+
+  std::vector<Table> tables;
+
+  void EncodeTo(std::string* dst) const;
+
+  Status DecodeFrom(Slice input);
+};
+
+// Replace `fname` with `hot_blocks` through the temporary file `tmp_fname`
+extern Status WriteHotBlockSetFile(Env* env, const HotBlockSet& hot_blocks,
+                                   const std::string& fname,
+                                   const std::string& tmp_fname);
+
+extern Status ReadHotBlockSetFile(Env* env, const std::string& fname,
+                                  HotBlockSet* hot_blocks);
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,107 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/hot_block_set.h"
+
+#include <string>
+
+#include "port/stack_trace.h"
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class HotBlockSetTest : public testing::Test {
+ public:
+  static HotBlockSet NewHotBlockSet() {
+    HotBlockSet hot_blocks;
+    hot_blocks.tables.resize(2);
+    hot_blocks.tables[0].column_family_id = 0;
+    hot_blocks.tables[0].file_number = 7;
+    hot_blocks.tables[0].keys = {"a", std::string("b\0c", 3), ""};
+    hot_blocks.tables[1].column_family_id = 3;
+    hot_blocks.tables[1].file_number = 1ull << 40;
+    return hot_blocks;
+  }
+
+  static void AssertEqual(const HotBlockSet& expected,
+                          const HotBlockSet& actual) {
+    ASSERT_EQ(expected.tables.size(), actual.tables.size());
+    for (size_t i = 0; i < expected.tables.size(); ++i) {
+      ASSERT_EQ(expected.tables[i].column_family_id,
+                actual.tables[i].column_family_id);
+      ASSERT_EQ(expected.tables[i].file_number, actual.tables[i].file_number);
+      ASSERT_EQ(expected.tables[i].keys, actual.tables[i].keys);
+    }
+  }
+};
+
+TEST_F(HotBlockSetTest, RoundTrip) {
+  HotBlockSet hot_blocks = NewHotBlockSet();
+  std::string encoded;
+  hot_blocks.EncodeTo(&encoded);
+
+  HotBlockSet decoded;
+  ASSERT_OK(decoded.DecodeFrom(encoded));
+  AssertEqual(hot_blocks, decoded);
+
+  encoded.clear();
+  HotBlockSet().EncodeTo(&encoded);
+  ASSERT_OK(decoded.DecodeFrom(encoded));
+  ASSERT_TRUE(decoded.tables.empty());
+}
+
+TEST_F(HotBlockSetTest, Corruption) {
+  std::string encoded;
+  NewHotBlockSet().EncodeTo(&encoded);
+
+  HotBlockSet decoded;
+  ASSERT_TRUE(decoded.DecodeFrom(Slice()).IsCorruption());
+  ASSERT_TRUE(decoded.DecodeFrom("HOTBLK").IsCorruption());
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    std::string corrupted = encoded;
+    corrupted[i] ^= 0x40;
+    ASSERT_TRUE(decoded.DecodeFrom(corrupted).IsCorruption()) << i;
+    ASSERT_TRUE(decoded.tables.empty());
+  }
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    ASSERT_TRUE(decoded.DecodeFrom(Slice(encoded.data(), size)).IsCorruption())
+        << size;
+  }
+}
+
+TEST_F(HotBlockSetTest, File) {
+  Env* env = Env::Default();
+  std::string dir = test::PerThreadDBPath(env, "hot_block_set_test");
+  env->CreateDirIfMissing(dir);
+  std::string fname = dir + "/HOT_BLOCKS";
+  std::string tmp_fname = fname + ".dbtmp";
+
+  HotBlockSet hot_blocks = NewHotBlockSet();
+  ASSERT_OK(WriteHotBlockSetFile(env, hot_blocks, fname, tmp_fname));
+  ASSERT_TRUE(env->FileExists(tmp_fname).IsNotFound());
+
+  HotBlockSet read;
+  ASSERT_OK(ReadHotBlockSetFile(env, fname, &read));
+  AssertEqual(hot_blocks, read);
+
+  // Replaced as a whole
+  ASSERT_OK(WriteHotBlockSetFile(env, HotBlockSet(), fname, tmp_fname));
+  ASSERT_OK(ReadHotBlockSetFile(env, fname, &read));
+  ASSERT_TRUE(read.tables.empty());
+
+  ASSERT_OK(env->DeleteFile(fname));
+  ASSERT_TRUE(ReadHotBlockSetFile(env, fname, &read).IsNotFound());
+  env->DeleteDir(dir);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -13,6 +13,7 @@
 #endif
 
 #include <inttypes.h>
+#include <string.h>
 
 #include <algorithm>
 #include <limits>
@@ -22,8 +23,12 @@
 
 #include "db/column_family.h"
 #include "db/db_impl.h"
+#include "db/filemap.h"
+#include "monitoring/cpu_attribution.h"
 #include "rocksdb/terark_namespace.h"
+#include "rocksdb/utilities/sim_cache.h"
 #include "table/block_based_table_factory.h"
+#include "util/iterator_cache.h"
 #include "util/string_util.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -212,10 +217,13 @@ static const std::string compression_ratio_at_level_prefix =
     "compression-ratio-at-level";
 static const std::string allstats = "stats";
 static const std::string sstables = "sstables";
+static const std::string key_range_heatmap = "key-range-heatmap";
 static const std::string cfstats = "cfstats";
 static const std::string cfstats_no_file_histogram =
     "cfstats-no-file-histogram";
 static const std::string cf_file_histogram = "cf-file-histogram";
+static const std::string cf_cpu_attribution = "cf-cpu-attribution";
+static const std::string cpu_attribution = "cpu-attribution";
 static const std::string dbstats = "dbstats";
 static const std::string levelstats = "levelstats";
 static const std::string num_immutable_mem_table = "num-immutable-mem-table";
@@ -239,6 +247,12 @@ static const std::string num_deletes_imm_mem_tables =
 static const std::string estimate_num_keys = "estimate-num-keys";
 static const std::string estimate_table_readers_mem =
     "estimate-table-readers-mem";
+static const std::string estimate_file_metadata_mem =
+    "estimate-file-metadata-mem";
+static const std::string estimate_file_map_mem = "estimate-file-map-mem";
+static const std::string estimate_key_hotness_mem = "estimate-key-hotness-mem";
+static const std::string estimate_iterator_cache_mem =
+    "estimate-iterator-cache-mem";
 static const std::string is_file_deletions_enabled =
     "is-file-deletions-enabled";
 static const std::string num_snapshots = "num-snapshots";
@@ -253,6 +267,9 @@ static const std::string min_obsolete_sst_number_to_keep_str =
 static const std::string base_level_str = "base-level";
 static const std::string total_sst_files_size = "total-sst-files-size";
 static const std::string live_sst_files_size = "live-sst-files-size";
+static const std::string live_blob_files_size = "live-blob-files-size";
+static const std::string estimate_blob_garbage_bytes =
+    "estimate-blob-garbage-bytes";
 static const std::string estimate_pending_comp_bytes =
     "estimate-pending-compaction-bytes";
 static const std::string aggregated_table_properties =
@@ -267,6 +284,14 @@ static const std::string is_write_stopped = "is-write-stopped";
 static const std::string block_cache_capacity = "block-cache-capacity";
 static const std::string block_cache_usage = "block-cache-usage";
 static const std::string block_cache_pinned_usage = "block-cache-pinned-usage";
+static const std::string block_cache_hit_ratio_curve =
+    "block-cache-hit-ratio-curve";
+static const std::string table_build_working_mem = "table-build-working-mem";
+static const std::string table_build_waiting_mem = "table-build-waiting-mem";
+static const std::string zenfs_free_bytes = "zenfs-free-bytes";
+static const std::string zenfs_garbage_bytes = "zenfs-garbage-bytes";
+static const std::string zenfs_capacity_bytes = "zenfs-capacity-bytes";
+static const std::string zenfs_gc_migrated_bytes = "zenfs-gc-migrated-bytes";
 static const std::string options_statistics = "options-statistics";
 
 const std::string DB::Properties::kNumFilesAtLevelPrefix =
@@ -275,11 +300,17 @@ const std::string DB::Properties::kCompressionRatioAtLevelPrefix =
     rocksdb_prefix + compression_ratio_at_level_prefix;
 const std::string DB::Properties::kStats = rocksdb_prefix + allstats;
 const std::string DB::Properties::kSSTables = rocksdb_prefix + sstables;
+const std::string DB::Properties::kKeyRangeHeatmap =
+    rocksdb_prefix + key_range_heatmap;
 const std::string DB::Properties::kCFStats = rocksdb_prefix + cfstats;
 const std::string DB::Properties::kCFStatsNoFileHistogram =
     rocksdb_prefix + cfstats_no_file_histogram;
 const std::string DB::Properties::kCFFileHistogram =
     rocksdb_prefix + cf_file_histogram;
+const std::string DB::Properties::kCFCpuAttribution =
+    rocksdb_prefix + cf_cpu_attribution;
+const std::string DB::Properties::kCpuAttribution =
+    rocksdb_prefix + cpu_attribution;
 const std::string DB::Properties::kDBStats = rocksdb_prefix + dbstats;
 const std::string DB::Properties::kLevelStats = rocksdb_prefix + levelstats;
 const std::string DB::Properties::kNumImmutableMemTable =
@@ -314,6 +345,14 @@ const std::string DB::Properties::kEstimateNumKeys =
     rocksdb_prefix + estimate_num_keys;
 const std::string DB::Properties::kEstimateTableReadersMem =
     rocksdb_prefix + estimate_table_readers_mem;
+const std::string DB::Properties::kEstimateFileMetaDataMem =
+    rocksdb_prefix + estimate_file_metadata_mem;
+const std::string DB::Properties::kEstimateFileMapMem =
+    rocksdb_prefix + estimate_file_map_mem;
+const std::string DB::Properties::kEstimateKeyHotnessMem =
+    rocksdb_prefix + estimate_key_hotness_mem;
+const std::string DB::Properties::kEstimateIteratorCacheMem =
+    rocksdb_prefix + estimate_iterator_cache_mem;
 const std::string DB::Properties::kIsFileDeletionsEnabled =
     rocksdb_prefix + is_file_deletions_enabled;
 const std::string DB::Properties::kNumSnapshots =
@@ -334,6 +373,10 @@ const std::string DB::Properties::kTotalSstFilesSize =
     rocksdb_prefix + total_sst_files_size;
 const std::string DB::Properties::kLiveSstFilesSize =
     rocksdb_prefix + live_sst_files_size;
+const std::string DB::Properties::kLiveBlobFilesSize =
+    rocksdb_prefix + live_blob_files_size;
+const std::string DB::Properties::kEstimateBlobGarbageBytes =
+    rocksdb_prefix + estimate_blob_garbage_bytes;
 const std::string DB::Properties::kBaseLevel = rocksdb_prefix + base_level_str;
 const std::string DB::Properties::kEstimatePendingCompactionBytes =
     rocksdb_prefix + estimate_pending_comp_bytes;
@@ -351,6 +394,20 @@ const std::string DB::Properties::kBlockCacheUsage =
     rocksdb_prefix + block_cache_usage;
 const std::string DB::Properties::kBlockCachePinnedUsage =
     rocksdb_prefix + block_cache_pinned_usage;
+const std::string DB::Properties::kBlockCacheHitRatioCurve =
+    rocksdb_prefix + block_cache_hit_ratio_curve;
+const std::string DB::Properties::kTableBuildWorkingMem =
+    rocksdb_prefix + table_build_working_mem;
+const std::string DB::Properties::kTableBuildWaitingMem =
+    rocksdb_prefix + table_build_waiting_mem;
+const std::string DB::Properties::kZenFSFreeBytes =
+    rocksdb_prefix + zenfs_free_bytes;
+const std::string DB::Properties::kZenFSGarbageBytes =
+    rocksdb_prefix + zenfs_garbage_bytes;
+const std::string DB::Properties::kZenFSCapacityBytes =
+    rocksdb_prefix + zenfs_capacity_bytes;
+const std::string DB::Properties::kZenFSGCMigratedBytes =
+    rocksdb_prefix + zenfs_gc_migrated_bytes;
 const std::string DB::Properties::kOptionsStatistics =
     rocksdb_prefix + options_statistics;
 
@@ -375,10 +432,19 @@ const std::unordered_map<std::string, DBPropertyInfo>
         {DB::Properties::kCFFileHistogram,
          {false, &InternalStats::HandleCFFileHistogram, nullptr, nullptr,
           nullptr}},
+        {DB::Properties::kCFCpuAttribution,
+         {false, &InternalStats::HandleCFCpuAttribution, nullptr, nullptr,
+          nullptr}},
+        {DB::Properties::kCpuAttribution,
+         {false, &InternalStats::HandleCpuAttribution, nullptr, nullptr,
+          nullptr}},
         {DB::Properties::kDBStats,
          {false, &InternalStats::HandleDBStats, nullptr, nullptr, nullptr}},
         {DB::Properties::kSSTables,
          {false, &InternalStats::HandleSsTables, nullptr, nullptr, nullptr}},
+        {DB::Properties::kKeyRangeHeatmap,
+         {false, &InternalStats::HandleKeyRangeHeatmap, nullptr, nullptr,
+          nullptr}},
         {DB::Properties::kAggregatedTableProperties,
          {false, &InternalStats::HandleAggregatedTableProperties, nullptr,
           nullptr, nullptr}},
@@ -427,6 +493,18 @@ const std::unordered_map<std::string, DBPropertyInfo>
         {DB::Properties::kEstimateTableReadersMem,
          {true, nullptr, &InternalStats::HandleEstimateTableReadersMem, nullptr,
           nullptr}},
+        {DB::Properties::kEstimateFileMetaDataMem,
+         {true, nullptr, &InternalStats::HandleEstimateFileMetaDataMem, nullptr,
+          nullptr}},
+        {DB::Properties::kEstimateFileMapMem,
+         {true, nullptr, &InternalStats::HandleEstimateFileMapMem, nullptr,
+          nullptr}},
+        {DB::Properties::kEstimateKeyHotnessMem,
+         {false, nullptr, &InternalStats::HandleEstimateKeyHotnessMem, nullptr,
+          nullptr}},
+        {DB::Properties::kEstimateIteratorCacheMem,
+         {false, nullptr, &InternalStats::HandleEstimateIteratorCacheMem,
+          nullptr, nullptr}},
         {DB::Properties::kIsFileDeletionsEnabled,
          {false, nullptr, &InternalStats::HandleIsFileDeletionsEnabled, nullptr,
           nullptr}},
@@ -459,6 +537,12 @@ const std::unordered_map<std::string, DBPropertyInfo>
         {DB::Properties::kLiveSstFilesSize,
          {false, nullptr, &InternalStats::HandleLiveSstFilesSize, nullptr,
           nullptr}},
+        {DB::Properties::kLiveBlobFilesSize,
+         {false, nullptr, &InternalStats::HandleLiveBlobFilesSize, nullptr,
+          nullptr}},
+        {DB::Properties::kEstimateBlobGarbageBytes,
+         {false, nullptr, &InternalStats::HandleEstimateBlobGarbageBytes,
+          nullptr, nullptr}},
         {DB::Properties::kEstimatePendingCompactionBytes,
          {false, nullptr, &InternalStats::HandleEstimatePendingCompactionBytes,
           nullptr, nullptr}},
@@ -483,6 +567,27 @@ const std::unordered_map<std::string, DBPropertyInfo>
         {DB::Properties::kBlockCachePinnedUsage,
          {false, nullptr, &InternalStats::HandleBlockCachePinnedUsage, nullptr,
           nullptr}},
+        {DB::Properties::kBlockCacheHitRatioCurve,
+         {false, &InternalStats::HandleBlockCacheHitRatioCurve, nullptr,
+          nullptr, nullptr}},
+        {DB::Properties::kTableBuildWorkingMem,
+         {false, nullptr, &InternalStats::HandleTableBuildWorkingMem, nullptr,
+          nullptr}},
+        {DB::Properties::kTableBuildWaitingMem,
+         {false, nullptr, &InternalStats::HandleTableBuildWaitingMem, nullptr,
+          nullptr}},
+        {DB::Properties::kZenFSFreeBytes,
+         {false, nullptr, &InternalStats::HandleZenFSFreeBytes, nullptr,
+          nullptr}},
+        {DB::Properties::kZenFSGarbageBytes,
+         {false, nullptr, &InternalStats::HandleZenFSGarbageBytes, nullptr,
+          nullptr}},
+        {DB::Properties::kZenFSCapacityBytes,
+         {false, nullptr, &InternalStats::HandleZenFSCapacityBytes, nullptr,
+          nullptr}},
+        {DB::Properties::kZenFSGCMigratedBytes,
+         {false, nullptr, &InternalStats::HandleZenFSGCMigratedBytes, nullptr,
+          nullptr}},
         {DB::Properties::kOptionsStatistics,
          {false, nullptr, nullptr, nullptr,
           &DBImpl::GetPropertyHandleOptionsStatistics}},
@@ -616,12 +721,60 @@ bool InternalStats::HandleDBStats(std::string* value, Slice /*suffix*/) {
   return true;
 }
 
+bool InternalStats::HandleCFCpuAttribution(std::string* value,
+                                           Slice /*suffix*/) {
+  CpuAttributionStats stats;
+  cfd_->cpu_attribution()->AddTo(&stats);
+  *value = stats.ToString(CpuAttributionStats());
+  return true;
+}
+
+bool InternalStats::HandleCpuAttribution(std::string* value,
+                                         Slice /*suffix*/) {
+  CpuAttributionStats stats;
+  GetCpuAttributionStats(&stats);
+  *value = stats.ToString(CpuAttributionStats());
+  return true;
+}
+
 bool InternalStats::HandleSsTables(std::string* value, Slice /*suffix*/) {
   auto* current = cfd_->current();
   *value = current->DebugString(true, true);
   return true;
 }
 
+bool InternalStats::HandleKeyRangeHeatmap(std::string* value,
+                                          Slice /*suffix*/) {
+  const auto* vstorage = cfd_->current()->storage_info();
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%5s %10s %12s %12s %12s  %s\n", "Level", "File",
+           "Reads", "Writes", "BlobFetches", "KeyRange");
+  value->append(buf);
+  for (int level = -1; level < vstorage->num_levels(); ++level) {
+    for (auto* f : vstorage->LevelFiles(level)) {
+      uint64_t reads =
+          f->stats.num_reads_sampled.load(std::memory_order_relaxed);
+      uint64_t writes =
+          f->stats.num_writes_sampled.load(std::memory_order_relaxed);
+      uint64_t blob_fetches =
+          f->stats.num_blob_fetches_sampled.load(std::memory_order_relaxed);
+      if (reads == 0 && writes == 0 && blob_fetches == 0) {
+        continue;
+      }
+      snprintf(buf, sizeof(buf),
+               "%5d %10" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "  ",
+               level, f->fd.GetNumber(), reads, writes, blob_fetches);
+      value->append(buf);
+      value->append("[");
+      value->append(f->smallest.user_key().ToString(true));
+      value->append(" .. ");
+      value->append(f->largest.user_key().ToString(true));
+      value->append("]\n");
+    }
+  }
+  return true;
+}
+
 bool InternalStats::HandleAggregatedTableProperties(std::string* value,
                                                     Slice /*suffix*/) {
   std::shared_ptr<const TableProperties> tp;
@@ -818,6 +971,30 @@ bool InternalStats::HandleLiveSstFilesSize(uint64_t* value, DBImpl* /*db*/,
   return true;
 }
 
+bool InternalStats::HandleLiveBlobFilesSize(uint64_t* value, DBImpl* /*db*/,
+                                            Version* /*version*/) {
+  *value = 0;
+  for (auto f : cfd_->current()->storage_info()->LevelFiles(-1)) {
+    *value += f->fd.GetFileSize();
+  }
+  return true;
+}
+
+bool InternalStats::HandleEstimateBlobGarbageBytes(uint64_t* value,
+                                                   DBImpl* /*db*/,
+                                                   Version* /*version*/) {
+  // A blob file is garbage in the proportion of its entries no SST depends
+  // on, as GC picks it
+  *value = 0;
+  for (auto f : cfd_->current()->storage_info()->LevelFiles(-1)) {
+    *value += static_cast<uint64_t>(
+        f->fd.GetFileSize() *
+        std::min(1.0, f->num_antiquation /
+                          std::max<double>(1, f->prop.num_entries)));
+  }
+  return true;
+}
+
 bool InternalStats::HandleEstimatePendingCompactionBytes(uint64_t* value,
                                                          DBImpl* /*db*/,
                                                          Version* /*version*/) {
@@ -833,6 +1010,38 @@ bool InternalStats::HandleEstimateTableReadersMem(uint64_t* value,
   return true;
 }
 
+bool InternalStats::HandleEstimateFileMetaDataMem(uint64_t* value,
+                                                  DBImpl* /*db*/,
+                                                  Version* version) {
+  *value = (version == nullptr) ? 0 : version->GetMemoryUsageByFileMetaData();
+  return true;
+}
+
+bool InternalStats::HandleEstimateFileMapMem(uint64_t* value, DBImpl* /*db*/,
+                                             Version* version) {
+  const FileMap* file_map =
+      version == nullptr
+          ? nullptr
+          : version->storage_info()->dependence_multi_map().get();
+  *value = (file_map == nullptr) ? 0 : file_map->ApproximateMemoryUsage();
+  return true;
+}
+
+bool InternalStats::HandleEstimateKeyHotnessMem(uint64_t* value, DBImpl* db,
+                                                Version* /*version*/) {
+  std::shared_ptr<Oracle> oracle = db->GetEnv()->GetOracle();
+  *value = db->ApproximateKeyHotnessMemoryUsage() +
+           (oracle == nullptr ? 0 : oracle->ApproximateMemoryUsage());
+  return true;
+}
+
+bool InternalStats::HandleEstimateIteratorCacheMem(uint64_t* value,
+                                                   DBImpl* /*db*/,
+                                                   Version* /*version*/) {
+  *value = IteratorCache::TotalArenaMemoryUsage();
+  return true;
+}
+
 bool InternalStats::HandleEstimateLiveDataSize(uint64_t* value, DBImpl* /*db*/,
                                                Version* version) {
   const auto* vstorage = version->storage_info();
@@ -922,6 +1131,76 @@ bool InternalStats::HandleBlockCachePinnedUsage(uint64_t* value, DBImpl* /*db*/,
   return true;
 }
 
+bool InternalStats::GetBlockCacheHitRatioCurve(
+    std::vector<SimCacheHitRatio>* curve) {
+  Cache* block_cache;
+  if (!HandleBlockCacheStat(&block_cache) ||
+      strcmp(block_cache->Name(), "SimCache") != 0) {
+    return false;
+  }
+  static_cast<SimCache*>(block_cache)->GetHitRatioCurve(curve);
+  return !curve->empty();
+}
+
+bool InternalStats::HandleBlockCacheHitRatioCurve(std::string* value,
+                                                  Slice /*suffix*/) {
+  std::vector<SimCacheHitRatio> curve;
+  if (!GetBlockCacheHitRatioCurve(&curve)) {
+    return false;
+  }
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%20s %9s\n", "Capacity", "HitRatio");
+  value->append(buf);
+  for (auto& point : curve) {
+    snprintf(buf, sizeof(buf), "%20" PRIu64 " %9.4f\n", point.capacity,
+             point.hit_ratio);
+    value->append(buf);
+  }
+  return true;
+}
+
+bool InternalStats::HandleTableBuildWorkingMem(uint64_t* value, DBImpl* /*db*/,
+                                               Version* /*version*/) {
+  uint64_t waiting;
+  return cfd_->ioptions()->table_factory->GetBuildMemoryUsage(value, &waiting);
+}
+
+bool InternalStats::HandleTableBuildWaitingMem(uint64_t* value, DBImpl* /*db*/,
+                                               Version* /*version*/) {
+  uint64_t working;
+  return cfd_->ioptions()->table_factory->GetBuildMemoryUsage(&working, value);
+}
+
+bool InternalStats::HandleZenFSFreeBytes(uint64_t* value, DBImpl* db,
+                                         Version* /*version*/) {
+  uint64_t garbage, capacity;
+  return db->GetZoneCapacity(value, &garbage, &capacity);
+}
+
+bool InternalStats::HandleZenFSGarbageBytes(uint64_t* value, DBImpl* db,
+                                            Version* /*version*/) {
+  uint64_t free, capacity;
+  return db->GetZoneCapacity(&free, value, &capacity);
+}
+
+bool InternalStats::HandleZenFSCapacityBytes(uint64_t* value, DBImpl* db,
+                                             Version* /*version*/) {
+  uint64_t free, garbage;
+  return db->GetZoneCapacity(&free, &garbage, value);
+}
+
+bool InternalStats::HandleZenFSGCMigratedBytes(uint64_t* value, DBImpl* db,
+                                               Version* /*version*/) {
+#ifdef WITH_ZENFS
+  *value = db->GetZoneGCMigratedBytes();
+  return true;
+#else
+  (void)value;
+  (void)db;
+  return false;
+#endif
+}
+
 void InternalStats::DumpDBStats(std::string* value) {
   char buf[1000];
   // DB-level stats, only available from default column family
@@ -21,6 +21,7 @@ namespace TERARKDB_NAMESPACE {
 class ColumnFamilyData;
 class DBImpl;
 class MemTableList;
+struct SimCacheHitRatio;
 
 // Config for retrieving a property's value.
 struct DBPropertyInfo {
@@ -364,6 +365,10 @@ class InternalStats {
   bool GetIntPropertyOutOfMutex(const DBPropertyInfo& property_info,
                                 Version* version, uint64_t* value);
 
+  // The hit ratio curve of the block cache, false unless it's a SimCache
+  // sampling one
+  bool GetBlockCacheHitRatioCurve(std::vector<SimCacheHitRatio>* curve);
+
   const std::vector<CompactionStats>& TEST_GetCompactionStats() const {
     return comp_stats_;
   }
@@ -497,7 +502,11 @@ class InternalStats {
   bool HandleCFStatsNoFileHistogram(std::string* value, Slice suffix);
   bool HandleCFFileHistogram(std::string* value, Slice suffix);
   bool HandleDBStats(std::string* value, Slice suffix);
+  bool HandleCFCpuAttribution(std::string* value, Slice suffix);
+  bool HandleCpuAttribution(std::string* value, Slice suffix);
   bool HandleSsTables(std::string* value, Slice suffix);
+  bool HandleKeyRangeHeatmap(std::string* value, Slice suffix);
+  bool HandleBlockCacheHitRatioCurve(std::string* value, Slice suffix);
   bool HandleAggregatedTableProperties(std::string* value, Slice suffix);
   bool HandleAggregatedTablePropertiesAtLevel(std::string* value, Slice suffix);
   bool HandleNumImmutableMemTable(uint64_t* value, DBImpl* db,
@@ -534,10 +543,20 @@ class InternalStats {
   bool HandleBaseLevel(uint64_t* value, DBImpl* db, Version* version);
   bool HandleTotalSstFilesSize(uint64_t* value, DBImpl* db, Version* version);
   bool HandleLiveSstFilesSize(uint64_t* value, DBImpl* db, Version* version);
+  bool HandleLiveBlobFilesSize(uint64_t* value, DBImpl* db, Version* version);
+  bool HandleEstimateBlobGarbageBytes(uint64_t* value, DBImpl* db,
+                                      Version* version);
   bool HandleEstimatePendingCompactionBytes(uint64_t* value, DBImpl* db,
                                             Version* version);
   bool HandleEstimateTableReadersMem(uint64_t* value, DBImpl* db,
                                      Version* version);
+  bool HandleEstimateFileMetaDataMem(uint64_t* value, DBImpl* db,
+                                     Version* version);
+  bool HandleEstimateFileMapMem(uint64_t* value, DBImpl* db, Version* version);
+  bool HandleEstimateKeyHotnessMem(uint64_t* value, DBImpl* db,
+                                   Version* version);
+  bool HandleEstimateIteratorCacheMem(uint64_t* value, DBImpl* db,
+                                      Version* version);
   bool HandleEstimateLiveDataSize(uint64_t* value, DBImpl* db,
                                   Version* version);
   bool HandleMinLogNumberToKeep(uint64_t* value, DBImpl* db, Version* version);
@@ -552,6 +571,15 @@ class InternalStats {
   bool HandleBlockCacheUsage(uint64_t* value, DBImpl* db, Version* version);
   bool HandleBlockCachePinnedUsage(uint64_t* value, DBImpl* db,
                                    Version* version);
+  bool HandleTableBuildWorkingMem(uint64_t* value, DBImpl* db,
+                                  Version* version);
+  bool HandleTableBuildWaitingMem(uint64_t* value, DBImpl* db,
+                                  Version* version);
+  bool HandleZenFSFreeBytes(uint64_t* value, DBImpl* db, Version* version);
+  bool HandleZenFSGarbageBytes(uint64_t* value, DBImpl* db, Version* version);
+  bool HandleZenFSCapacityBytes(uint64_t* value, DBImpl* db, Version* version);
+  bool HandleZenFSGCMigratedBytes(uint64_t* value, DBImpl* db,
+                                  Version* version);
   // Total number of background errors encountered. Every time a flush task
   // or compaction task fails, this counter is incremented. The failure can
   // be caused by any possible reason, including file system errors, out of
@@ -0,0 +1,210 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/key_hotness_sampler.h"
+
+#include <iterator>
+#include <mutex>
+
+#include "monitoring/file_read_sample.h"
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/write_batch.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+// Collects the user keys of every update in a write batch. Range deletions
+// and blob indexes carry no per-key lifetime information and are skipped.
+class SampleKeyHandler : public WriteBatch::Handler {
+ public:
+  explicit SampleKeyHandler(KeyHotnessSampler* sampler) : sampler_(sampler) {}
+
+  Status PutCF(uint32_t /*cf*/, const Slice& key,
+               const Slice& /*value*/) override {
+    sampler_->SampleKey(key);
+    return Status::OK();
+  }
+
+  Status DeleteCF(uint32_t /*cf*/, const Slice& key) override {
+    sampler_->SampleKey(key);
+    return Status::OK();
+  }
+
+  Status SingleDeleteCF(uint32_t /*cf*/, const Slice& key) override {
+    sampler_->SampleKey(key);
+    return Status::OK();
+  }
+
+  Status MergeCF(uint32_t /*cf*/, const Slice& key,
+                 const Slice& /*value*/) override {
+    sampler_->SampleKey(key);
+    return Status::OK();
+  }
+
+  Status DeleteRangeCF(uint32_t /*cf*/, const Slice& /*begin_key*/,
+                       const Slice& /*end_key*/) override {
+    return Status::OK();
+  }
+
+  Status MarkBeginPrepare(bool /*unprepare*/) override { return Status::OK(); }
+  Status MarkEndPrepare(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkCommit(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkRollback(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkNoop(bool /*empty_batch*/) override { return Status::OK(); }
+
+ private:
+  KeyHotnessSampler* sampler_;
+};
+
+// Collects the column family and user key of every update in a write batch,
+// a range deletion is charged to its begin key.
+class SampleWriteHandler : public WriteBatch::Handler {
+ public:
+  explicit SampleWriteHandler(WriteHeatSampler* sampler) : sampler_(sampler) {}
+
+  Status PutCF(uint32_t cf, const Slice& key, const Slice& /*value*/) override {
+    sampler_->SampleKey(cf, key);
+    return Status::OK();
+  }
+
+  Status DeleteCF(uint32_t cf, const Slice& key) override {
+    sampler_->SampleKey(cf, key);
+    return Status::OK();
+  }
+
+  Status SingleDeleteCF(uint32_t cf, const Slice& key) override {
+    sampler_->SampleKey(cf, key);
+    return Status::OK();
+  }
+
+  Status MergeCF(uint32_t cf, const Slice& key,
+                 const Slice& /*value*/) override {
+    sampler_->SampleKey(cf, key);
+    return Status::OK();
+  }
+
+  Status DeleteRangeCF(uint32_t cf, const Slice& begin_key,
+                       const Slice& /*end_key*/) override {
+    sampler_->SampleKey(cf, begin_key);
+    return Status::OK();
+  }
+
+  Status MarkBeginPrepare(bool /*unprepare*/) override { return Status::OK(); }
+  Status MarkEndPrepare(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkCommit(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkRollback(const Slice& /*xid*/) override { return Status::OK(); }
+  Status MarkNoop(bool /*empty_batch*/) override { return Status::OK(); }
+
+ private:
+  WriteHeatSampler* sampler_;
+};
+
+}  // namespace
+
+KeyHotnessSampler::KeyHotnessSampler(uint32_t sample_interval,
+                                     size_t max_keys_per_core)
+    : sample_interval_(sample_interval == 0 ? 1 : sample_interval),
+      max_keys_per_core_(max_keys_per_core),
+      dropped_(0) {}
+
+bool KeyHotnessSampler::ShouldSample() const {
+  return sample_interval_ == 1 ||
+         Random::GetTLSInstance()->OneIn(static_cast<int>(sample_interval_));
+}
+
+void KeyHotnessSampler::Add(CoreBuffer* buffer, const Slice& user_key) {
+  std::lock_guard<SpinMutex> lock(buffer->mutex);
+  if (buffer->keys.size() >= max_keys_per_core_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->keys.emplace_back(user_key.data(), user_key.size());
+}
+
+void KeyHotnessSampler::SampleKey(const Slice& user_key) {
+  Add(buffers_.Access(), user_key);
+}
+
+void KeyHotnessSampler::SampleBatch(const WriteBatch* batch) {
+  SampleKeyHandler handler(this);
+  // A malformed batch is rejected later by the write path itself
+  batch->Iterate(&handler);
+}
+
+size_t KeyHotnessSampler::Drain(
+    std::unordered_map<std::string, uint64_t>* occurrence) {
+  size_t drained = 0;
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < buffers_.Size(); ++i) {
+    CoreBuffer* buffer = buffers_.AccessAtCore(i);
+    {
+      std::lock_guard<SpinMutex> lock(buffer->mutex);
+      keys.swap(buffer->keys);
+    }
+    drained += keys.size();
+    for (auto& key : keys) {
+      ++(*occurrence)[std::move(key)];
+    }
+    keys.clear();
+  }
+  return drained;
+}
+
+size_t KeyHotnessSampler::ApproximateMemoryUsage() const {
+  size_t usage = 0;
+  for (size_t i = 0; i < buffers_.Size(); ++i) {
+    CoreBuffer* buffer = buffers_.AccessAtCore(i);
+    std::lock_guard<SpinMutex> lock(buffer->mutex);
+    usage += sizeof(CoreBuffer) + buffer->keys.capacity() * sizeof(std::string);
+    for (auto& key : buffer->keys) {
+      if (key.capacity() > sizeof(std::string)) {
+        usage += key.capacity();
+      }
+    }
+  }
+  return usage;
+}
+
+WriteHeatSampler::WriteHeatSampler(size_t max_keys_per_core)
+    : max_keys_per_core_(max_keys_per_core), dropped_(0) {}
+
+bool WriteHeatSampler::ShouldSample() const {
+  return should_sample_file_read();
+}
+
+void WriteHeatSampler::SampleKey(uint32_t column_family_id,
+                                 const Slice& user_key) {
+  CoreBuffer* buffer = buffers_.Access();
+  std::lock_guard<SpinMutex> lock(buffer->mutex);
+  if (buffer->keys.size() >= max_keys_per_core_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->keys.emplace_back(column_family_id, user_key.ToString());
+}
+
+void WriteHeatSampler::SampleBatch(const WriteBatch* batch) {
+  SampleWriteHandler handler(this);
+  // A malformed batch is rejected later by the write path itself
+  batch->Iterate(&handler);
+}
+
+void WriteHeatSampler::Drain(
+    std::vector<std::pair<uint32_t, std::string>>* keys) {
+  std::vector<std::pair<uint32_t, std::string>> buffered;
+  for (size_t i = 0; i < buffers_.Size(); ++i) {
+    CoreBuffer* buffer = buffers_.AccessAtCore(i);
+    {
+      std::lock_guard<SpinMutex> lock(buffer->mutex);
+      buffered.swap(buffer->keys);
+    }
+    std::move(buffered.begin(), buffered.end(), std::back_inserter(*keys));
+    buffered.clear();
+  }
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,103 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/core_local.h"
+#include "util/mutexlock.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class WriteBatch;
+
+// KeyHotnessSampler samples user keys on the foreground write (and optionally
+// read) path into per-core buffers. A background job periodically drains the
+// buffers into an occurrence map which is merged into the Env's Oracle, so
+// that the hot/warm classification used by flush follows the live workload.
+//
+// Sampling is decided per write batch (per Get) with a thread local random
+// number, a sampled batch contributes all its keys. The per-core buffer is
+// protected by a spin lock which is only contended by the drain, keys that do
+// not fit into a full buffer are dropped.
+class KeyHotnessSampler {
+ public:
+  // Sample one out of `sample_interval` batches, buffer at most
+  // `max_keys_per_core` keys per core between two drains.
+  KeyHotnessSampler(uint32_t sample_interval, size_t max_keys_per_core);
+
+  bool ShouldSample() const;
+
+  void SampleKey(const Slice& user_key);
+
+  void SampleBatch(const WriteBatch* batch);
+
+  // Move every buffered key into `occurrence`, returns the number of keys
+  // moved.
+  size_t Drain(std::unordered_map<std::string, uint64_t>* occurrence);
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // The memory of the per-core buffers and the keys in them
+  size_t ApproximateMemoryUsage() const;
+
+ private:
+  struct ALIGN_AS(CACHE_LINE_SIZE) CoreBuffer {
+    SpinMutex mutex;
+    std::vector<std::string> keys;
+  };
+
+  void Add(CoreBuffer* buffer, const Slice& user_key);
+
+  const uint32_t sample_interval_;
+  const size_t max_keys_per_core_;
+  CoreLocalArray<CoreBuffer> buffers_;
+  std::atomic<uint64_t> dropped_;
+};
+
+// WriteHeatSampler samples the user keys of foreground writes, together with
+// their column family, for the key range heatmap. A background job drains the
+// buffers and charges every key to the SST files of the current version whose
+// range covers it, see Version::SampleWrite(). The file lookup is kept off the
+// write path this way, which only pays for copying the sampled keys.
+//
+// Batches are sampled at the rate of the file read sampling, so the sampled
+// write counters of FileMetaData are comparable with the read ones.
+class WriteHeatSampler {
+ public:
+  explicit WriteHeatSampler(size_t max_keys_per_core);
+
+  bool ShouldSample() const;
+
+  void SampleKey(uint32_t column_family_id, const Slice& user_key);
+
+  void SampleBatch(const WriteBatch* batch);
+
+  // Move every buffered (column family id, user key) pair into `keys`
+  void Drain(std::vector<std::pair<uint32_t, std::string>>* keys);
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct ALIGN_AS(CACHE_LINE_SIZE) CoreBuffer {
+    SpinMutex mutex;
+    std::vector<std::pair<uint32_t, std::string>> keys;
+  };
+
+  const size_t max_keys_per_core_;
+  CoreLocalArray<CoreBuffer> buffers_;
+  std::atomic<uint64_t> dropped_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,104 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/key_hotness_sampler.h"
+
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/write_batch.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class KeyHotnessSamplerTest : public testing::Test {};
+
+TEST_F(KeyHotnessSamplerTest, SampleBatch) {
+  KeyHotnessSampler sampler(1, 1024);
+  ASSERT_TRUE(sampler.ShouldSample());
+
+  WriteBatch batch;
+  batch.Put("a", "v");
+  batch.Put("b", "v");
+  batch.Merge("a", "v");
+  batch.Delete("c");
+  batch.DeleteRange("d", "e");
+  sampler.SampleBatch(&batch);
+  sampler.SampleKey("a");
+
+  std::unordered_map<std::string, uint64_t> occurrence;
+  ASSERT_EQ(5, sampler.Drain(&occurrence));
+  ASSERT_EQ(3, occurrence.size());
+  ASSERT_EQ(3, occurrence["a"]);
+  ASSERT_EQ(1, occurrence["b"]);
+  ASSERT_EQ(1, occurrence["c"]);
+
+  occurrence.clear();
+  ASSERT_EQ(0, sampler.Drain(&occurrence));
+  ASSERT_TRUE(occurrence.empty());
+}
+
+TEST_F(KeyHotnessSamplerTest, BoundedBuffer) {
+  const size_t kMaxKeys = 16;
+  KeyHotnessSampler sampler(1, kMaxKeys);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&sampler] {
+      for (int i = 0; i < 1000; ++i) {
+        sampler.SampleKey("k" + std::to_string(i % 10));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  std::unordered_map<std::string, uint64_t> occurrence;
+  size_t drained = sampler.Drain(&occurrence);
+  ASSERT_GT(drained, 0);
+  ASSERT_EQ(4000, drained + sampler.dropped());
+}
+
+TEST_F(KeyHotnessSamplerTest, SampleInterval) {
+  KeyHotnessSampler sampler(8, 1 << 20);
+  size_t sampled = 0;
+  for (int i = 0; i < 8000; ++i) {
+    sampled += sampler.ShouldSample();
+  }
+  ASSERT_GT(sampled, 500);
+  ASSERT_LT(sampled, 1500);
+}
+
+TEST_F(KeyHotnessSamplerTest, WriteHeatSampleBatch) {
+  WriteHeatSampler sampler(1024);
+  WriteBatch batch;
+  batch.Put("a", "v");
+  batch.Delete("b");
+  batch.DeleteRange("c", "d");
+  sampler.SampleBatch(&batch);
+  sampler.SampleKey(7, "e");
+
+  std::vector<std::pair<uint32_t, std::string>> keys;
+  sampler.Drain(&keys);
+  std::vector<std::pair<uint32_t, std::string>> expected = {
+      {0, "a"}, {0, "b"}, {0, "c"}, {7, "e"}};
+  ASSERT_EQ(expected, keys);
+
+  keys.clear();
+  sampler.Drain(&keys);
+  ASSERT_TRUE(keys.empty());
+  ASSERT_EQ(0, sampler.dropped());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,177 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/level_key_model.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "db/dbformat.h"
+#include "db/version_edit.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+// The first position in [0, keys.size()] for which `below` is false,
+// galloping from `hint`. `below` is true then false over `keys`.
+template <class Below>
+uint32_t Gallop(const std::vector<uint64_t>& keys, uint32_t hint,
+                Below below) {
+  size_t n = keys.size();
+  size_t l, r;
+  if (below(keys[hint])) {
+    l = hint + 1;
+    r = l;
+    for (size_t step = 1; r < n && below(keys[r]); step *= 2) {
+      l = r + 1;
+      r += step;
+    }
+    r = std::min(r, n);
+  } else {
+    r = hint;
+    for (size_t step = 1;; step *= 2) {
+      if (r < step) {
+        l = 0;
+        break;
+      }
+      if (below(keys[r - step])) {
+        l = r - step + 1;
+        break;
+      }
+      r -= step;
+    }
+  }
+  return static_cast<uint32_t>(
+      std::partition_point(keys.begin() + l, keys.begin() + r, below) -
+      keys.begin());
+}
+
+}  // namespace
+
+bool LevelKeyModel::Build(const Comparator* ucmp,
+                          const LevelFilesBrief& level) {
+  prefix_.clear();
+  keys_.clear();
+  segments_.clear();
+  size_t n = level.num_files;
+  if (ucmp != BytewiseComparator() || n < kMinFiles) {
+    return false;
+  }
+  size_t width = ExtractUserKey(level.files[0].smallest_key).size();
+  for (size_t i = 0; i < n; ++i) {
+    if (ExtractUserKey(level.files[i].smallest_key).size() != width ||
+        ExtractUserKey(level.files[i].largest_key).size() != width) {
+      return false;
+    }
+  }
+  // The files are sorted, all their keys share the prefix of the first and
+  // the last one
+  Slice first = ExtractUserKey(level.files[0].smallest_key);
+  Slice last = ExtractUserKey(level.files[n - 1].largest_key);
+  size_t prefix_size = first.difference_offset(last);
+  prefix_.assign(first.data(), prefix_size);
+
+  keys_.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys_.push_back(Encode(ExtractUserKey(level.files[i].largest_key)));
+  }
+  if (keys_.front() == keys_.back()) {
+    // The keys only differ past the encoded bytes
+    prefix_.clear();
+    keys_.clear();
+    return false;
+  }
+
+  // Extend each segment while a line from its first file stays within
+  // kMaxError files of all of its files
+  for (size_t i = 0; i < n;) {
+    Segment segment;
+    segment.key = keys_[i];
+    segment.index = static_cast<uint32_t>(i);
+    double min_slope = 0;
+    double max_slope = std::numeric_limits<double>::infinity();
+    size_t j = i + 1;
+    for (; j < n; ++j) {
+      double dy = static_cast<double>(j - i);
+      if (keys_[j] == segment.key) {
+        if (dy > kMaxError) {
+          break;
+        }
+        continue;
+      }
+      double dx = static_cast<double>(keys_[j] - segment.key);
+      double lo = std::max(min_slope, (dy - kMaxError) / dx);
+      double hi = std::min(max_slope, (dy + kMaxError) / dx);
+      if (lo > hi) {
+        break;
+      }
+      min_slope = lo;
+      max_slope = hi;
+    }
+    segment.slope = max_slope == std::numeric_limits<double>::infinity()
+                        ? 0
+                        : (min_slope + max_slope) / 2;
+    segments_.push_back(segment);
+    i = j;
+  }
+  return true;
+}
+
+void LevelKeyModel::Narrow(const Slice& user_key, uint32_t* left,
+                           uint32_t* right) const {
+  if (keys_.empty()) {
+    return;
+  }
+  uint32_t lo, hi;
+  int cmp = Slice(user_key.data(), std::min(user_key.size(), prefix_.size()))
+                .compare(prefix_);
+  if (cmp < 0) {
+    // Before all files
+    lo = hi = 0;
+  } else if (cmp > 0) {
+    // After all files
+    lo = hi = static_cast<uint32_t>(keys_.size());
+  } else {
+    uint64_t key = Encode(user_key);
+    // The files whose encoded largest key equals `key` are left to the
+    // comparator
+    lo = Gallop(keys_, Predict(key), [key](uint64_t k) { return k < key; });
+    hi = lo == keys_.size()
+             ? lo
+             : Gallop(keys_, lo, [key](uint64_t k) { return k <= key; });
+  }
+  uint32_t l = *left, r = *right;
+  *left = std::min(std::max(lo, l), r);
+  *right = std::min(std::max(hi, l), r);
+}
+
+uint64_t LevelKeyModel::Encode(const Slice& user_key) const {
+  uint64_t key = 0;
+  for (size_t i = prefix_.size(); i < prefix_.size() + sizeof(key); ++i) {
+    key <<= 8;
+    if (i < user_key.size()) {
+      key |= static_cast<uint8_t>(user_key[i]);
+    }
+  }
+  return key;
+}
+
+uint32_t LevelKeyModel::Predict(uint64_t key) const {
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), key,
+      [](uint64_t k, const Segment& segment) { return k < segment.key; });
+  if (it == segments_.begin()) {
+    return 0;
+  }
+  --it;
+  double pos = it->index + it->slope * static_cast<double>(key - it->key);
+  double max_pos = static_cast<double>(keys_.size() - 1);
+  return static_cast<uint32_t>(std::min(pos, max_pos));
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,71 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class Comparator;
+struct LevelFilesBrief;
+
+// A learned index over the largest keys of the files of a sorted level.
+// The bytes following the common prefix of the level are read as a big
+// endian integer, and the position of a key among the files is predicted by
+// a piecewise-linear model over these integers, each segment keeping the
+// prediction within kMaxError files. Version::Get() then only needs the
+// comparator for the few files sharing the integer of the lookup key,
+// instead of a binary search over the whole level.
+//
+// The model is only built for a bytewise comparator and for files whose
+// boundary user keys all have the same width, like the fixed-width binary
+// keys it is meant for. It is rebuilt with the LevelFilesBrief of each
+// Version and never changes afterwards.
+class LevelKeyModel {
+ public:
+  enum : uint32_t {
+    // Smaller levels are searched fast enough with the comparator
+    kMinFiles = 64,
+    kMaxError = 8,
+  };
+
+  LevelKeyModel() = default;
+
+  // Build the model for `level`, returns false and leaves the model empty if
+  // the files or the comparator don't qualify
+  bool Build(const Comparator* ucmp, const LevelFilesBrief& level);
+
+  bool empty() const { return keys_.empty(); }
+
+  // Narrow the file range [*left, *right] holding the first file whose
+  // largest key is not less than a key of `user_key`, so that a search of
+  // [*left, *right) gives the same result. Unchanged if the model is empty.
+  void Narrow(const Slice& user_key, uint32_t* left, uint32_t* right) const;
+
+  size_t num_segments() const { return segments_.size(); }
+
+ private:
+  struct Segment {
+    uint64_t key;  // The key of the first file of the segment
+    uint32_t index;
+    double slope;
+  };
+
+  uint64_t Encode(const Slice& user_key) const;
+  // The predicted position of `key`
+  uint32_t Predict(uint64_t key) const;
+
+  std::string prefix_;
+  // The encoded largest user keys of the files
+  std::vector<uint64_t> keys_;
+  std::vector<Segment> segments_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,180 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/level_key_model.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/version_edit.h"
+#include "port/stack_trace.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "util/string_util.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class LevelKeyModelTest : public testing::Test {
+ public:
+  LevelKeyModelTest() : icmp_(BytewiseComparator()) {}
+
+  static std::string UserKey(uint64_t n) {
+    std::string key = "prefix";
+    PutFixed64(&key, 0);
+    // Big endian, so the keys sort by `n`
+    for (int i = 7; i >= 0; --i) {
+      key[6 + 7 - i] = static_cast<char>(n >> (i * 8));
+    }
+    return key;
+  }
+
+  // Files with the key ranges [bounds[2i], bounds[2i + 1]]
+  void SetFiles(const std::vector<std::string>& bounds) {
+    keys_.clear();
+    for (const auto& user_key : bounds) {
+      InternalKey ikey(user_key, 100, kTypeValue);
+      keys_.push_back(ikey.Encode().ToString());
+    }
+    files_.resize(bounds.size() / 2);
+    for (size_t i = 0; i < files_.size(); ++i) {
+      files_[i].smallest_key = keys_[2 * i];
+      files_[i].largest_key = keys_[2 * i + 1];
+    }
+    level_.num_files = files_.size();
+    level_.files = files_.data();
+  }
+
+  void SetFiles(const std::vector<uint64_t>& bounds) {
+    std::vector<std::string> user_keys;
+    for (uint64_t n : bounds) {
+      user_keys.push_back(UserKey(n));
+    }
+    SetFiles(user_keys);
+  }
+
+  uint32_t LowerBound(const Slice& ikey, uint32_t left, uint32_t right) {
+    return static_cast<uint32_t>(
+        std::lower_bound(files_.begin() + left, files_.begin() + right, ikey,
+                         [&](const FdWithKeyRange& f, const Slice& k) {
+                           return icmp_.Compare(f.largest_key, k) < 0;
+                         }) -
+        files_.begin());
+  }
+
+  // The narrowed range of `user_key` in [left, right), the search of which
+  // must give the same file
+  uint32_t CheckNarrow(const std::string& user_key, uint32_t left,
+                       uint32_t right) {
+    std::string ikey =
+        InternalKey(user_key, 50, kTypeValue).Encode().ToString();
+    uint32_t l = left, r = right;
+    model_.Narrow(user_key, &l, &r);
+    EXPECT_LE(left, l);
+    EXPECT_LE(l, r);
+    EXPECT_LE(r, right);
+    EXPECT_EQ(LowerBound(ikey, left, right), LowerBound(ikey, l, r));
+    return r - l;
+  }
+
+  InternalKeyComparator icmp_;
+  std::vector<std::string> keys_;
+  std::vector<FdWithKeyRange> files_;
+  LevelFilesBrief level_;
+  LevelKeyModel model_;
+};
+
+TEST_F(LevelKeyModelTest, Qualify) {
+  std::vector<uint64_t> bounds;
+  for (uint64_t i = 0; i < 2 * LevelKeyModel::kMinFiles; ++i) {
+    bounds.push_back(i * 10);
+  }
+  SetFiles(bounds);
+  ASSERT_TRUE(model_.Build(BytewiseComparator(), level_));
+  ASSERT_FALSE(model_.empty());
+  ASSERT_FALSE(model_.Build(ReverseBytewiseComparator(), level_));
+  ASSERT_TRUE(model_.empty());
+
+  // Too few files
+  bounds.resize(2 * LevelKeyModel::kMinFiles - 2);
+  SetFiles(bounds);
+  ASSERT_FALSE(model_.Build(BytewiseComparator(), level_));
+
+  // Keys of different widths
+  std::vector<std::string> user_keys;
+  for (uint64_t i = 0; i < 2 * LevelKeyModel::kMinFiles; ++i) {
+    user_keys.push_back(ToString(i * 10 + 1000));
+  }
+  user_keys.back() += "0";
+  SetFiles(user_keys);
+  ASSERT_FALSE(model_.Build(BytewiseComparator(), level_));
+
+  // The keys only differ past the encoded bytes
+  user_keys.clear();
+  for (uint64_t i = 0; i < 2 * LevelKeyModel::kMinFiles; ++i) {
+    user_keys.push_back("1aaaaaaaa" + ToString(1000 + i));
+    user_keys.push_back(user_keys.back());
+  }
+  user_keys.front()[0] = '0';
+  SetFiles(user_keys);
+  ASSERT_FALSE(model_.Build(BytewiseComparator(), level_));
+}
+
+TEST_F(LevelKeyModelTest, Narrow) {
+  Random64 rnd(301);
+  const uint32_t kNumFiles = 10000;
+  std::vector<uint64_t> bounds;
+  uint64_t n = 1000;
+  for (uint32_t i = 0; i < 2 * kNumFiles; ++i) {
+    bounds.push_back(n);
+    // Uneven gaps, and files sharing a boundary user key
+    n += i % 97 == 1 ? 0 : 1 + rnd.Uniform(i < kNumFiles ? 100 : 1000000);
+  }
+  SetFiles(bounds);
+  ASSERT_TRUE(model_.Build(BytewiseComparator(), level_));
+  ASSERT_GT(model_.num_segments(), 1u);
+  ASSERT_LT(model_.num_segments(), kNumFiles / 10);
+
+  uint32_t max_range = 0;
+  for (int i = 0; i < 10000; ++i) {
+    uint64_t key = bounds[0] + rnd.Uniform(n - bounds[0] + 1000);
+    max_range = std::max(max_range, CheckNarrow(UserKey(key), 0, kNumFiles));
+  }
+  // Only files with the same largest key are left to the comparator
+  ASSERT_LE(max_range, 1u);
+  for (uint64_t key : bounds) {
+    CheckNarrow(UserKey(key), 0, kNumFiles);
+    CheckNarrow(UserKey(key - 1), 0, kNumFiles);
+    CheckNarrow(UserKey(key + 1), 0, kNumFiles);
+  }
+  // Sub ranges
+  for (int i = 0; i < 1000; ++i) {
+    uint32_t left = static_cast<uint32_t>(rnd.Uniform(kNumFiles));
+    uint32_t right =
+        left + static_cast<uint32_t>(rnd.Uniform(kNumFiles - left + 1));
+    uint64_t key = bounds[2 * left] + rnd.Uniform(1000);
+    CheckNarrow(UserKey(key), left, right);
+  }
+  // Outside of the prefix and of the files
+  ASSERT_EQ(0u, CheckNarrow("a", 0, kNumFiles));
+  ASSERT_EQ(0u, CheckNarrow("prefiw", 0, kNumFiles));
+  ASSERT_EQ(0u, CheckNarrow("prefiz", 0, kNumFiles));
+  ASSERT_EQ(0u, CheckNarrow("prefix", 0, kNumFiles));
+  ASSERT_EQ(0u, CheckNarrow(UserKey(0), 0, kNumFiles));
+  ASSERT_EQ(0u, CheckNarrow(UserKey(n + 1000000), 0, kNumFiles));
+  ASSERT_LE(CheckNarrow(UserKey(n) + "x", 0, kNumFiles), 1u);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
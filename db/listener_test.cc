@@ -920,6 +920,144 @@ TEST_F(EventListenerTest, OnFileOperationTest) {
   ASSERT_GT(listener->file_reads_.load(), 0);
 }
 
+class SlowListener : public EventListener {
+ public:
+  void OnTableFileDeleted(const TableFileDeletionInfo& info) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++entered_;
+    cv_.wait(lock, [this] { return !blocked_; });
+    job_ids_.push_back(info.job_id);
+    thread_ids_.insert(std::this_thread::get_id());
+  }
+
+  void OnFlushCompleted(DB* /*db*/, const FlushJobInfo& /*info*/) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++flushes_;
+    thread_ids_.insert(std::this_thread::get_id());
+  }
+
+  void OnDBClosing(DB* /*db*/) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushes_at_closing_ = flushes_;
+  }
+
+  void Block(bool blocked) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocked_ = blocked;
+    cv_.notify_all();
+  }
+
+  // Until `n` OnTableFileDeleted() calls started
+  void WaitForEntered(int n) {
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entered_ >= n) {
+          return;
+        }
+      }
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool blocked_ = false;
+  int entered_ = 0;
+  std::vector<int> job_ids_;
+  std::set<std::thread::id> thread_ids_;
+  int flushes_ = 0;
+  int flushes_at_closing_ = -1;
+};
+
+TEST_F(EventListenerTest, AsyncListenerDropWhenFull) {
+  auto slow = std::make_shared<SlowListener>();
+  AsyncEventListenerOptions options;
+  options.max_queued_events = 2;
+  options.drop_when_full = true;
+  options.statistics = CreateDBStatistics();
+  auto listener = NewAsyncEventListener(slow, options);
+
+  slow->Block(true);
+  TableFileDeletionInfo info;
+  info.job_id = 0;
+  listener->OnTableFileDeleted(info);
+  slow->WaitForEntered(1);
+  // 1 and 2 are queued, 3 and 4 dropped
+  for (int i = 1; i < 5; ++i) {
+    info.job_id = i;
+    listener->OnTableFileDeleted(info);
+  }
+  ASSERT_EQ(2, options.statistics->getTickerCount(
+                   ASYNC_LISTENER_EVENTS_DROPPED));
+  slow->Block(false);
+  listener->OnDBClosing(nullptr);
+
+  ASSERT_EQ(std::vector<int>({0, 1, 2}), slow->job_ids_);
+  ASSERT_EQ(1, slow->thread_ids_.size());
+  ASSERT_EQ(0, slow->thread_ids_.count(std::this_thread::get_id()));
+  ASSERT_EQ(0, options.statistics->getTickerCount(
+                   ASYNC_LISTENER_EVENTS_BLOCKED));
+  HistogramData callback;
+  options.statistics->histogramData(ASYNC_LISTENER_CALLBACK_MICROS,
+                                    &callback);
+  ASSERT_EQ(3, callback.count);
+}
+
+TEST_F(EventListenerTest, AsyncListenerBackpressure) {
+  auto slow = std::make_shared<SlowListener>();
+  AsyncEventListenerOptions options;
+  options.max_queued_events = 1;
+  options.statistics = CreateDBStatistics();
+  auto listener = NewAsyncEventListener(slow, options);
+
+  slow->Block(true);
+  TableFileDeletionInfo info;
+  info.job_id = 0;
+  listener->OnTableFileDeleted(info);
+  slow->WaitForEntered(1);
+  info.job_id = 1;
+  listener->OnTableFileDeleted(info);
+
+  std::atomic<bool> notified{false};
+  port::Thread thread([&] {
+    TableFileDeletionInfo blocked_info;
+    blocked_info.job_id = 2;
+    listener->OnTableFileDeleted(blocked_info);
+    notified = true;
+  });
+  while (options.statistics->getTickerCount(ASYNC_LISTENER_EVENTS_BLOCKED) ==
+         0) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  ASSERT_FALSE(notified.load());
+  slow->Block(false);
+  thread.join();
+  ASSERT_TRUE(notified.load());
+  listener->OnDBClosing(nullptr);
+
+  ASSERT_EQ(std::vector<int>({0, 1, 2}), slow->job_ids_);
+  ASSERT_EQ(0, options.statistics->getTickerCount(
+                   ASYNC_LISTENER_EVENTS_DROPPED));
+}
+
+TEST_F(EventListenerTest, AsyncListenerDeliversBeforeClose) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  auto slow = std::make_shared<SlowListener>();
+  options.listeners.push_back(NewAsyncEventListener(slow));
+  DestroyAndReopen(options);
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_OK(Put("foo", ToString(i)));
+    ASSERT_OK(Flush());
+  }
+  Close();
+  std::lock_guard<std::mutex> lock(slow->mutex_);
+  ASSERT_EQ(3, slow->flushes_at_closing_);
+  ASSERT_EQ(0, slow->thread_ids_.count(std::this_thread::get_id()));
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 #endif  // ROCKSDB_LITE
@@ -11,6 +11,8 @@
 // See ../doc/log_format.txt for more detail.
 
 #pragma once
+#include <stdint.h>
+
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -31,8 +33,21 @@ enum RecordType {
   kRecyclableFirstType = 6,
   kRecyclableMiddleType = 7,
   kRecyclableLastType = 8,
+
+  // First or only fragment of a compressed record, the payload of the
+  // whole record is the CompressionType (1 byte) and the compressed data
+  kCompressedFullType = 9,
+  kCompressedFirstType = 10,
+  kRecyclableCompressedFullType = 11,
+  kRecyclableCompressedFirstType = 12,
 };
-static const int kMaxRecordType = kRecyclableLastType;
+static const int kMaxRecordType = kRecyclableCompressedFirstType;
+
+inline bool IsRecyclableType(unsigned int type) {
+  return (type >= kRecyclableFullType && type <= kRecyclableLastType) ||
+         type == kRecyclableCompressedFullType ||
+         type == kRecyclableCompressedFirstType;
+}
 
 static const unsigned int kBlockSize = 32768;
 
@@ -43,5 +58,17 @@ static const int kHeaderSize = 4 + 2 + 1;
 // log number (4 bytes).
 static const int kRecyclableHeaderSize = 4 + 2 + 1 + 4;
 
+// A log written with direct I/O is padded with zeros to a multiple of this
+// before each flush. The padding starts with a zero header (kZeroType, zero
+// length) and the reader skips it.
+static const unsigned int kPaddingAlignment = 4096;
+
+// The end of the padding starting at `offset`, the first boundary leaving
+// room for its zero header
+inline uint64_t PaddingEnd(uint64_t offset) {
+  return (offset + kHeaderSize + kPaddingAlignment - 1) / kPaddingAlignment *
+         kPaddingAlignment;
+}
+
 }  // namespace log
 }  // namespace TERARKDB_NAMESPACE
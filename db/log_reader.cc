@@ -11,9 +11,12 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+
 #include "rocksdb/env.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/coding.h"
+#include "util/compression.h"
 #include "util/crc32c.h"
 #include "util/file_reader_writer.h"
 #include "util/util.h"
@@ -56,6 +59,8 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
   scratch->clear();
   record->clear();
   bool in_fragmented_record = false;
+  // Whether the fragmented record started with a compressed first fragment
+  bool compressed_record = false;
   // Record offset of the logical record that we're reading
   // 0 is a dummy value to make compilers happy
   uint64_t prospective_record_offset = 0;
@@ -68,6 +73,8 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
     switch (record_type) {
       case kFullType:
       case kRecyclableFullType:
+      case kCompressedFullType:
+      case kRecyclableCompressedFullType:
         if (in_fragmented_record && !scratch->empty()) {
           // Handle bug in earlier versions of log::Writer where
           // it could emit an empty kFirstType record at the tail end
@@ -77,12 +84,23 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         }
         prospective_record_offset = physical_record_offset;
         scratch->clear();
-        *record = fragment;
+        if (record_type == kCompressedFullType ||
+            record_type == kRecyclableCompressedFullType) {
+          if (!UncompressRecord(fragment, record)) {
+            ReportCorruption(fragment.size(), "bad compressed record(1)");
+            in_fragmented_record = false;
+            break;
+          }
+        } else {
+          *record = fragment;
+        }
         last_record_offset_ = prospective_record_offset;
         return true;
 
       case kFirstType:
       case kRecyclableFirstType:
+      case kCompressedFirstType:
+      case kRecyclableCompressedFirstType:
         if (in_fragmented_record && !scratch->empty()) {
           // Handle bug in earlier versions of log::Writer where
           // it could emit an empty kFirstType record at the tail end
@@ -93,6 +111,8 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         prospective_record_offset = physical_record_offset;
         scratch->assign(fragment.data(), fragment.size());
         in_fragmented_record = true;
+        compressed_record = record_type == kCompressedFirstType ||
+                            record_type == kRecyclableCompressedFirstType;
         break;
 
       case kMiddleType:
@@ -112,7 +132,14 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
                            "missing start of fragmented record(2)");
         } else {
           scratch->append(fragment.data(), fragment.size());
-          *record = Slice(*scratch);
+          if (!compressed_record) {
+            *record = Slice(*scratch);
+          } else if (!UncompressRecord(*scratch, record)) {
+            ReportCorruption(scratch->size(), "bad compressed record(2)");
+            in_fragmented_record = false;
+            scratch->clear();
+            break;
+          }
           last_record_offset_ = prospective_record_offset;
           return true;
         }
@@ -197,6 +224,44 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
   return false;
 }
 
+bool Reader::UncompressRecord(const Slice& data, Slice* record) {
+  if (data.empty()) {
+    return false;
+  }
+  const CompressionType type = static_cast<CompressionType>(data[0]);
+  if (type != kLZ4Compression && type != kZSTD) {
+    return false;
+  }
+  const char* input = data.data() + 1;
+  size_t input_length = data.size() - 1;
+  uint32_t output_len = 0;
+  if (!compression::GetDecompressedSizeInfo(&input, &input_length,
+                                            &output_len)) {
+    return false;
+  }
+  // Recovery replays records one by one, so decompress them all into the
+  // same buffer, grown only for a larger record
+  if (output_len > uncompressed_capacity_ || !uncompressed_) {
+    uncompressed_ = AllocateBlock(output_len, nullptr);
+    uncompressed_capacity_ = output_len;
+  }
+  UncompressionContext ctx(type);
+  size_t size;
+  if (type == kLZ4Compression) {
+    int lz4_size = LZ4_UncompressInto(ctx, input, input_length,
+                                      uncompressed_.get(), output_len);
+    size = lz4_size < 0 ? output_len + 1 : static_cast<size_t>(lz4_size);
+  } else {
+    size = ZSTD_UncompressInto(ctx, input, input_length, uncompressed_.get(),
+                               output_len);
+  }
+  if (size != output_len) {
+    return false;
+  }
+  *record = Slice(uncompressed_.get(), size);
+  return true;
+}
+
 uint64_t Reader::LastRecordOffset() { return last_record_offset_; }
 
 void Reader::UnmarkEOF() {
@@ -311,6 +376,12 @@ bool Reader::ReadMore(size_t* drop_size, int* error) {
   }
 }
 
+void Reader::SkipPadding() {
+  uint64_t offset = end_of_buffer_offset_ - buffer_.size();
+  buffer_.remove_prefix(static_cast<size_t>(
+      std::min<uint64_t>(PaddingEnd(offset) - offset, buffer_.size())));
+}
+
 unsigned int Reader::ReadPhysicalRecord(Slice* result, size_t* drop_size) {
   while (true) {
     // We need at least the minimum header size
@@ -332,7 +403,7 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result, size_t* drop_size) {
     const unsigned int type = header[6];
     const uint32_t length = a | (b << 8);
     int header_size = kHeaderSize;
-    if (type >= kRecyclableFullType && type <= kRecyclableLastType) {
+    if (IsRecyclableType(type)) {
       if (end_of_buffer_offset_ - buffer_.size() == 0) {
         recycled_ = true;
       }
@@ -375,11 +446,11 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result, size_t* drop_size) {
 
     if (type == kZeroType && length == 0) {
       // Skip zero length record without reporting any drops since
-      // such records are produced by the mmap based writing code in
-      // env_posix.cc that preallocates file regions.
-      // NOTE: this should never happen in DB written by new RocksDB versions,
-      // since we turn off mmap writes to manifest and log files
-      buffer_.clear();
+      // such records are produced by the padding of the direct I/O writer,
+      // see Writer::PadToAlignment(), and by the mmap based writing code in
+      // env_posix.cc that preallocates file regions. The zeros of the latter
+      // are skipped one padding at a time.
+      SkipPadding();
       return kBadRecord;
     }
 
@@ -405,5 +476,258 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result, size_t* drop_size) {
   }
 }
 
+bool FragmentBufferedReader::ReadRecord(Slice* record, std::string* scratch,
+                                        WALRecoveryMode /*unused*/) {
+  assert(record != nullptr);
+  assert(scratch != nullptr);
+  record->clear();
+  scratch->clear();
+
+  while (true) {
+    uint64_t physical_record_offset = end_of_buffer_offset_ - buffer_.size();
+    size_t drop_size = 0;
+    unsigned int type = kEof;
+    Slice fragment;
+    if (!TryReadFragment(&fragment, &drop_size, &type)) {
+      // The end of what has been written so far, or a read error reported
+      // by TryReadMore()
+      return false;
+    }
+    switch (type) {
+      case kFullType:
+      case kRecyclableFullType:
+      case kCompressedFullType:
+      case kRecyclableCompressedFullType:
+        if (in_fragmented_record_ && !fragments_.empty()) {
+          ReportCorruption(fragments_.size(), "partial record without end(1)");
+        }
+        fragments_.clear();
+        in_fragmented_record_ = false;
+        if (type == kCompressedFullType ||
+            type == kRecyclableCompressedFullType) {
+          if (!UncompressRecord(fragment, record)) {
+            ReportCorruption(fragment.size(), "bad compressed record(1)");
+            break;
+          }
+        } else {
+          *record = fragment;
+        }
+        last_record_offset_ = physical_record_offset;
+        return true;
+
+      case kFirstType:
+      case kRecyclableFirstType:
+      case kCompressedFirstType:
+      case kRecyclableCompressedFirstType:
+        if (in_fragmented_record_ && !fragments_.empty()) {
+          ReportCorruption(fragments_.size(), "partial record without end(2)");
+        }
+        record_offset_ = physical_record_offset;
+        fragments_.assign(fragment.data(), fragment.size());
+        in_fragmented_record_ = true;
+        compressed_record_ = type == kCompressedFirstType ||
+                             type == kRecyclableCompressedFirstType;
+        break;
+
+      case kMiddleType:
+      case kRecyclableMiddleType:
+        if (!in_fragmented_record_) {
+          ReportCorruption(fragment.size(),
+                           "missing start of fragmented record(1)");
+        } else {
+          fragments_.append(fragment.data(), fragment.size());
+        }
+        break;
+
+      case kLastType:
+      case kRecyclableLastType:
+        if (!in_fragmented_record_) {
+          ReportCorruption(fragment.size(),
+                           "missing start of fragmented record(2)");
+          break;
+        }
+        fragments_.append(fragment.data(), fragment.size());
+        in_fragmented_record_ = false;
+        scratch->swap(fragments_);
+        fragments_.clear();
+        if (!compressed_record_) {
+          *record = Slice(*scratch);
+        } else if (!UncompressRecord(*scratch, record)) {
+          ReportCorruption(scratch->size(), "bad compressed record(2)");
+          scratch->clear();
+          break;
+        }
+        last_record_offset_ = record_offset_;
+        return true;
+
+      case kBadRecord:
+      case kOldRecord:
+        if (in_fragmented_record_) {
+          ReportCorruption(fragments_.size(), "error in middle of record");
+          in_fragmented_record_ = false;
+          fragments_.clear();
+        }
+        break;
+
+      case kBadRecordLen:
+      case kBadRecordChecksum:
+        if (recycled_) {
+          fragments_.clear();
+          return false;
+        }
+        if (type == kBadRecordLen) {
+          ReportCorruption(drop_size, "bad record length");
+        } else {
+          ReportCorruption(drop_size, "checksum mismatch");
+        }
+        if (in_fragmented_record_) {
+          ReportCorruption(fragments_.size(), "error in middle of record");
+          in_fragmented_record_ = false;
+          fragments_.clear();
+        }
+        break;
+
+      default: {
+        char buf[40];
+        snprintf(buf, sizeof(buf), "unknown record type %u", type);
+        ReportCorruption(
+            fragment.size() + (in_fragmented_record_ ? fragments_.size() : 0),
+            buf);
+        in_fragmented_record_ = false;
+        fragments_.clear();
+        break;
+      }
+    }
+  }
+}
+
+void FragmentBufferedReader::UnmarkEOF() {
+  if (read_error_) {
+    return;
+  }
+  Reader::UnmarkEOF();
+}
+
+bool FragmentBufferedReader::TryReadMore(size_t* drop_size, int* error) {
+  if (!eof_ && !read_error_) {
+    // Last read was a full read, so this is a trailer to skip
+    buffer_.clear();
+    Status status = file_->Read(kBlockSize, &buffer_, backing_store_);
+    end_of_buffer_offset_ += buffer_.size();
+    if (!status.ok()) {
+      buffer_.clear();
+      ReportDrop(kBlockSize, status);
+      read_error_ = true;
+      *error = kEof;
+      return false;
+    } else if (buffer_.size() < static_cast<size_t>(kBlockSize)) {
+      eof_ = true;
+      eof_offset_ = buffer_.size();
+    }
+    return true;
+  }
+  if (!read_error_) {
+    // The rest of the block may have been written since, keep what is in
+    // buffer_ and read it
+    UnmarkEOF();
+  }
+  if (!read_error_) {
+    return true;
+  }
+  *error = buffer_.empty() ? kEof : kBadHeader;
+  *drop_size = buffer_.size();
+  buffer_.clear();
+  return false;
+}
+
+bool FragmentBufferedReader::TryReadFragment(
+    Slice* fragment, size_t* drop_size, unsigned int* fragment_type_or_err) {
+  assert(fragment != nullptr);
+  assert(drop_size != nullptr);
+  assert(fragment_type_or_err != nullptr);
+
+  // Read until buffer_ has `size` bytes, false if what has been written of
+  // the log ends before. What is left of a full block is the trailer, which
+  // is skipped
+  auto readHeader = [&](size_t size) {
+    while (buffer_.size() < size) {
+      size_t old_size = buffer_.size();
+      int error = kEof;
+      if (!TryReadMore(drop_size, &error)) {
+        *fragment_type_or_err = error;
+        return false;
+      }
+      if (eof_ && old_size == buffer_.size()) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (!readHeader(kHeaderSize)) {
+    return false;
+  }
+  const unsigned int type = buffer_[6];
+  int header_size = kHeaderSize;
+  if (IsRecyclableType(type)) {
+    if (end_of_buffer_offset_ - buffer_.size() == 0) {
+      recycled_ = true;
+    }
+    header_size = kRecyclableHeaderSize;
+    if (!readHeader(kRecyclableHeaderSize)) {
+      return false;
+    }
+    if (DecodeFixed32(buffer_.data() + 7) != log_number_) {
+      *fragment_type_or_err = kOldRecord;
+      return true;
+    }
+  }
+  const uint32_t length = (static_cast<uint32_t>(buffer_[4]) & 0xff) |
+                          ((static_cast<uint32_t>(buffer_[5]) & 0xff) << 8);
+  // The payload never spans blocks, only the rest of a block cut by the end
+  // of the log can be read into buffer_
+  while (header_size + length > buffer_.size()) {
+    size_t old_size = buffer_.size();
+    int error = kEof;
+    if (!eof_) {
+      *drop_size = buffer_.size();
+      buffer_.clear();
+      *fragment_type_or_err = kBadRecordLen;
+      return true;
+    }
+    if (!TryReadMore(drop_size, &error)) {
+      *fragment_type_or_err = error;
+      return false;
+    }
+    if (eof_ && old_size == buffer_.size()) {
+      return false;
+    }
+  }
+
+  if (type == kZeroType && length == 0) {
+    SkipPadding();
+    *fragment_type_or_err = kBadRecord;
+    return true;
+  }
+
+  const char* header = buffer_.data();
+  if (checksum_) {
+    uint32_t expected_crc = crc32c::Unmask(DecodeFixed32(header));
+    uint32_t actual_crc = crc32c::Value(header + 6, length + header_size - 6);
+    if (actual_crc != expected_crc) {
+      *drop_size = buffer_.size();
+      buffer_.clear();
+      *fragment_type_or_err = kBadRecordChecksum;
+      return true;
+    }
+  }
+
+  buffer_.remove_prefix(header_size + length);
+
+  *fragment = Slice(header + header_size, length);
+  *fragment_type_or_err = type;
+  return true;
+}
+
 }  // namespace log
 }  // namespace TERARKDB_NAMESPACE
@@ -17,6 +17,7 @@
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/memory_allocator.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -57,16 +58,17 @@ class Reader {
          std::unique_ptr<SequentialFileReader>&& file, Reporter* reporter,
          bool checksum, uint64_t log_num, bool retry_after_eof);
 
-  ~Reader();
+  virtual ~Reader();
 
   // Read the next record into *record.  Returns true if read
   // successfully, false if we hit end of the input.  May use
   // "*scratch" as temporary storage.  The contents filled in *record
   // will only be valid until the next mutating operation on this
-  // reader or the next mutation to *scratch.
-  bool ReadRecord(Slice* record, std::string* scratch,
-                  WALRecoveryMode wal_recovery_mode =
-                      WALRecoveryMode::kTolerateCorruptedTailRecords);
+  // reader or the next mutation to *scratch.  Compressed records are
+  // returned uncompressed.
+  virtual bool ReadRecord(Slice* record, std::string* scratch,
+                          WALRecoveryMode wal_recovery_mode =
+                              WALRecoveryMode::kTolerateCorruptedTailRecords);
 
   // Returns the physical offset of the last record returned by ReadRecord.
   //
@@ -81,11 +83,11 @@ class Reader {
   // Also aligns the file position indicator to the start of the next block
   // by reading the rest of the data from the EOF position to the end of the
   // block that was partially read.
-  void UnmarkEOF();
+  virtual void UnmarkEOF();
 
   SequentialFileReader* file() { return file_.get(); }
 
- private:
+ protected:
   std::shared_ptr<Logger> info_log_;
   const std::unique_ptr<SequentialFileReader> file_;
   Reporter* const reporter_;
@@ -115,6 +117,11 @@ class Reader {
   // etc.
   const bool retry_after_eof_;
 
+  // Holds the last compressed record returned by ReadRecord
+  CacheAllocationPtr uncompressed_;
+  // Bytes allocated for uncompressed_, reused by the following records
+  uint32_t uncompressed_capacity_ = 0;
+
   // Extend record types with the following special values
   enum {
     kEof = kMaxRecordType + 1,
@@ -139,15 +146,67 @@ class Reader {
   // Read some more
   bool ReadMore(size_t* drop_size, int* error);
 
+  // Uncompress the payload of a compressed record into uncompressed_
+  bool UncompressRecord(const Slice& data, Slice* record);
+
+  // Skip the padding starting with the zero header at the front of buffer_
+  void SkipPadding();
+
   // Reports dropped bytes to the reporter.
   // buffer_ must be updated to remove the dropped bytes prior to invocation.
   void ReportCorruption(size_t bytes, const char* reason);
   void ReportDrop(size_t bytes, const Status& reason);
 
+ private:
   // No copying allowed
   Reader(const Reader&);
   void operator=(const Reader&);
 };
 
+// A Reader of a log that is still being written, ReadRecord() returns false
+// when the end of the written part of the log cuts a record, and keeps the
+// fragments read so far to continue the record on the next call once more of
+// the log has been written. Used by secondary instances to tail the MANIFEST
+// and the WAL of their primary, see DB::OpenAsSecondary().
+class FragmentBufferedReader : public Reader {
+ public:
+  FragmentBufferedReader(std::shared_ptr<Logger> info_log,
+                         std::unique_ptr<SequentialFileReader>&& _file,
+                         Reporter* reporter, bool checksum, uint64_t log_num)
+      : Reader(info_log, std::move(_file), reporter, checksum, log_num,
+               false /* retry_after_eof */),
+        fragments_(),
+        in_fragmented_record_(false),
+        compressed_record_(false),
+        record_offset_(0) {}
+  ~FragmentBufferedReader() override {}
+
+  // wal_recovery_mode is ignored, a cut record at the end of the log is
+  // never a corruption
+  bool ReadRecord(Slice* record, std::string* scratch,
+                  WALRecoveryMode wal_recovery_mode =
+                      WALRecoveryMode::kTolerateCorruptedTailRecords) override;
+  void UnmarkEOF() override;
+
+ private:
+  // Return false if the end of the log cuts the next fragment, which is
+  // then read again by the next call
+  bool TryReadFragment(Slice* fragment, size_t* drop_size,
+                       unsigned int* fragment_type_or_err);
+  // Read the next block, or what has been written of it, into buffer_
+  bool TryReadMore(size_t* drop_size, int* error);
+
+  // The fragments of the record being read
+  std::string fragments_;
+  bool in_fragmented_record_;
+  bool compressed_record_;
+  // Offset of the first fragment of the record being read
+  uint64_t record_offset_;
+
+  // No copying allowed
+  FragmentBufferedReader(const FragmentBufferedReader&);
+  void operator=(const FragmentBufferedReader&);
+};
+
 }  // namespace log
 }  // namespace TERARKDB_NAMESPACE
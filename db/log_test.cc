@@ -12,6 +12,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/coding.h"
+#include "util/compression.h"
 #include "util/crc32c.h"
 #include "util/file_reader_writer.h"
 #include "util/random.h"
@@ -180,6 +181,8 @@ class LogTest : public ::testing::TestWithParam<int> {
 
   void Write(const std::string& msg) { writer_.AddRecord(Slice(msg)); }
 
+  void Write(const SliceParts& parts) { writer_.AddRecord(parts); }
+
   size_t WrittenBytes() const { return dest_contents().size(); }
 
   std::string Read(const WALRecoveryMode wal_recovery_mode =
@@ -350,6 +353,40 @@ TEST_P(LogTest, AlignedEof) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_P(LogTest, PaddedDirectWrites) {
+  class DirectStringSink : public test::StringSink {
+   public:
+    bool use_direct_io() const override { return true; }
+    Status PositionedAppend(const Slice& data, uint64_t offset) override {
+      // Nothing is written twice
+      EXPECT_EQ(contents_.size(), offset);
+      contents_.append(data.data(), data.size());
+      return Status::OK();
+    }
+  };
+  auto sink = new DirectStringSink();
+  Writer writer(std::unique_ptr<WritableFileWriter>(
+                    test::GetWritableFileWriter(sink, "" /* don't care */)),
+                123, GetParam());
+  int header_size = GetParam() ? kRecyclableHeaderSize : kHeaderSize;
+  ASSERT_OK(writer.AddRecord("foo"));
+  ASSERT_EQ(kPaddingAlignment, sink->contents_.size());
+  // Less than a header left before the boundary
+  std::string bar = BigString("bar", kPaddingAlignment - header_size - 3);
+  ASSERT_OK(writer.AddRecord(bar));
+  ASSERT_EQ(3 * kPaddingAlignment, sink->contents_.size());
+  std::string baz = BigString("baz", 2 * kBlockSize);
+  ASSERT_OK(writer.AddRecord(baz));
+  ASSERT_EQ(0, sink->contents_.size() % kPaddingAlignment);
+
+  *get_reader_contents() = Slice(sink->contents_);
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ(bar, Read());
+  ASSERT_EQ(baz, Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
 TEST_P(LogTest, RandomRead) {
   const int N = 500;
   Random write_rnd(301);
@@ -641,6 +678,60 @@ TEST_P(LogTest, Recycle) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_P(LogTest, SliceParts) {
+  Slice parts[] = {"foo", "", "bar"};
+  Write(SliceParts(parts, 3));
+  // Parts that cross block boundaries
+  std::string big1 = BigString("big", 3 * log::kBlockSize / 2);
+  std::string big2 = BigString("parts", 3 * log::kBlockSize / 2);
+  Slice big_parts[] = {big1, big2, "end"};
+  Write(SliceParts(big_parts, 3));
+  Write("next");
+  ASSERT_EQ("foobar", Read());
+  ASSERT_EQ(big1 + big2 + "end", Read());
+  ASSERT_EQ("next", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
+TEST_P(LogTest, CompressedRecords) {
+  CompressionType compression = kNoCompression;
+  if (ZSTD_Supported()) {
+    compression = kZSTD;
+  } else if (LZ4_Supported()) {
+    compression = kLZ4Compression;
+  } else {
+    return;
+  }
+  std::unique_ptr<WritableFileWriter> dest_holder(test::GetWritableFileWriter(
+      new test::StringSink(get_reader_contents()), "" /* don't care */));
+  Writer compressed_writer(std::move(dest_holder), 123, GetParam(),
+                           false /* manual_flush */, compression);
+  Random rnd(301);
+  std::string incompressible;
+  test::RandomString(&rnd, 1000, &incompressible);
+  std::string medium = BigString("medium", 1000);
+  std::string large = BigString("large", 100000);
+  Slice parts[] = {medium, large};
+  size_t raw_size = 0;
+  for (const std::string& record : {std::string("small"), medium, large,
+                                    incompressible}) {
+    compressed_writer.AddRecord(Slice(record));
+    raw_size += record.size();
+  }
+  compressed_writer.AddRecord(SliceParts(parts, 2));
+  raw_size += medium.size() + large.size();
+  ASSERT_LT(get_reader_contents()->size(), raw_size / 10);
+
+  ASSERT_EQ("small", Read());
+  ASSERT_EQ(medium, Read());
+  ASSERT_EQ(large, Read());
+  ASSERT_EQ(incompressible, Read());
+  ASSERT_EQ(medium + large, Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
 INSTANTIATE_TEST_CASE_P(bool, LogTest, ::testing::Values(0, 2));
 
 class RetriableLogTest : public ::testing::TestWithParam<int> {
@@ -681,7 +772,7 @@ class RetriableLogTest : public ::testing::TestWithParam<int> {
         reader_(nullptr),
         log_reader_(nullptr) {}
 
-  Status SetupTestEnv() {
+  Status SetupTestEnv(bool fragment_buffered = false) {
     dest_holder_.reset(test::GetWritableFileWriter(
         new test::StringSink(&contents_), "" /* file name */));
     assert(dest_holder_ != nullptr);
@@ -706,9 +797,15 @@ class RetriableLogTest : public ::testing::TestWithParam<int> {
     if (s.ok()) {
       reader_.reset(new SequentialFileReader(std::move(seq_file), log_file_));
       assert(reader_ != nullptr);
-      log_reader_.reset(new Reader(nullptr, std::move(reader_), &report_,
-                                   true /* checksum */, 123 /* log_number */,
-                                   true /* retry_after_eof */));
+      if (fragment_buffered) {
+        log_reader_.reset(new FragmentBufferedReader(
+            nullptr, std::move(reader_), &report_, true /* checksum */,
+            123 /* log_number */));
+      } else {
+        log_reader_.reset(new Reader(nullptr, std::move(reader_), &report_,
+                                     true /* checksum */, 123 /* log_number */,
+                                     true /* retry_after_eof */));
+      }
       assert(log_reader_ != nullptr);
     }
     return s;
@@ -812,6 +909,41 @@ TEST_P(RetriableLogTest, TailLog_FullHeader) {
   ASSERT_EQ("foo", record);
 }
 
+TEST_P(RetriableLogTest, FragmentBufferedTailLog) {
+  ASSERT_OK(SetupTestEnv(true /* fragment_buffered */));
+  ASSERT_EQ("Read error", Read());
+
+  // A record of three blocks, written in parts which cut its headers and its
+  // fragments
+  std::string big(2 * kBlockSize + 100, 'x');
+  Encode(big);
+  size_t big_size = contents().size();
+  Encode("foo");
+  std::string all = contents();
+  size_t header_size = GetParam() ? kRecyclableHeaderSize : kHeaderSize;
+  std::vector<size_t> cuts = {header_size - 1, 100, kBlockSize - 3,
+                              kBlockSize + 2, 2 * kBlockSize + 50};
+  size_t written = 0;
+  for (size_t cut : cuts) {
+    Write(Slice(all.data() + written, cut - written));
+    written = cut;
+    ASSERT_EQ("Read error", Read());
+  }
+  Write(Slice(all.data() + written, big_size + 1 - written));
+  written = big_size + 1;
+  ASSERT_EQ(big, Read());
+  ASSERT_EQ("Read error", Read());
+  Write(Slice(all.data() + written, all.size() - written));
+  written = all.size();
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ("Read error", Read());
+
+  Encode("bar");
+  all = contents();
+  Write(Slice(all.data() + written, all.size() - written));
+  ASSERT_EQ("bar", Read());
+}
+
 INSTANTIATE_TEST_CASE_P(bool, RetriableLogTest, ::testing::Values(0, 2));
 
 }  // namespace log
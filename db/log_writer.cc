@@ -11,26 +11,41 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include "rocksdb/env.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/coding.h"
+#include "util/compression.h"
 #include "util/crc32c.h"
 #include "util/file_reader_writer.h"
 
 namespace TERARKDB_NAMESPACE {
 namespace log {
 
+namespace {
+// Smaller records rarely shrink enough to pay for the compression
+const size_t kMinCompressionSize = 128;
+}  // namespace
+
 Writer::Writer(std::unique_ptr<WritableFileWriter>&& dest, uint64_t log_number,
-               bool recycle_log_files, bool manual_flush)
+               bool recycle_log_files, bool manual_flush,
+               CompressionType compression)
     : dest_(std::move(dest)),
       block_offset_(0),
       log_number_(log_number),
       recycle_log_files_(recycle_log_files),
-      manual_flush_(manual_flush) {
+      manual_flush_(manual_flush),
+      pad_flushes_(dest_->use_direct_io()),
+      compression_(compression),
+      compression_tag_(static_cast<char>(compression)) {
   for (int i = 0; i <= kMaxRecordType; i++) {
     char t = static_cast<char>(i);
     type_crc_[i] = crc32c::Value(&t, 1);
   }
+  if (compression_ == kLZ4Compression || compression_ == kZSTD) {
+    compression_ctx_.reset(new CompressionContext(compression_));
+  }
 }
 
 Writer::~Writer() {
@@ -38,13 +53,58 @@ Writer::~Writer() {
   Frozen();
 }
 
-Status Writer::WriteBuffer() { return dest_->Flush(); }
+Status Writer::WriteBuffer() { return FlushRecords(); }
+
+Status Writer::FlushRecords() {
+  if (pad_flushes_) {
+    Status s = PadToAlignment();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return dest_->Flush();
+}
+
+Status Writer::PadToAlignment() {
+  if (block_offset_ % kPaddingAlignment == 0) {
+    return Status::OK();
+  }
+  static const char kZeros[kPaddingAlignment + kHeaderSize] = {};
+  // Less than a header left in the block is its trailer, which the reader
+  // skips anyway
+  size_t end = std::min<size_t>(PaddingEnd(block_offset_), kBlockSize);
+  Status s = dest_->Append(Slice(kZeros, end - block_offset_));
+  if (s.ok()) {
+    block_offset_ = end;
+  }
+  return s;
+}
 
 Status Writer::Frozen() { return dest_->Frozen(); }
 
 Status Writer::AddRecord(const Slice& slice) {
-  const char* ptr = slice.data();
-  size_t left = slice.size();
+  return AddRecord(SliceParts(&slice, 1));
+}
+
+Status Writer::AddRecord(const SliceParts& parts) {
+  size_t left = 0;
+  for (int i = 0; i < parts.num_parts; ++i) {
+    left += parts.parts[i].size();
+  }
+
+  SliceParts payload = parts;
+  Slice compressed_parts[2];
+  const bool compressed = compression_ctx_ != nullptr &&
+                          left >= kMinCompressionSize &&
+                          CompressRecord(parts, left);
+  if (compressed) {
+    compressed_parts[0] = Slice(&compression_tag_, 1);
+    compressed_parts[1] = compressed_;
+    payload = SliceParts(compressed_parts, 2);
+    left = 1 + compressed_.size();
+  }
+  int part = 0;
+  size_t offset = 0;
 
   // Header size varies depending on whether we are recycling or not.
   const int header_size =
@@ -81,7 +141,13 @@ Status Writer::AddRecord(const Slice& slice) {
 
     RecordType type;
     const bool end = (left == fragment_length);
-    if (begin && end) {
+    if (begin && end && compressed) {
+      type = recycle_log_files_ ? kRecyclableCompressedFullType
+                                : kCompressedFullType;
+    } else if (begin && compressed) {
+      type = recycle_log_files_ ? kRecyclableCompressedFirstType
+                                : kCompressedFirstType;
+    } else if (begin && end) {
       type = recycle_log_files_ ? kRecyclableFullType : kFullType;
     } else if (begin) {
       type = recycle_log_files_ ? kRecyclableFirstType : kFirstType;
@@ -91,17 +157,47 @@ Status Writer::AddRecord(const Slice& slice) {
       type = recycle_log_files_ ? kRecyclableMiddleType : kMiddleType;
     }
 
-    s = EmitPhysicalRecord(type, ptr, fragment_length);
-    ptr += fragment_length;
+    s = EmitPhysicalRecord(type, payload, &part, &offset, fragment_length);
     left -= fragment_length;
     begin = false;
   } while (s.ok() && left > 0);
+  if (s.ok() && !manual_flush_ && pad_flushes_) {
+    // Once for the whole record
+    s = FlushRecords();
+  }
   return s;
 }
 
 bool Writer::TEST_BufferIsEmpty() { return dest_->TEST_BufferIsEmpty(); }
 
-Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
+bool Writer::CompressRecord(const SliceParts& record, size_t size) {
+  Slice input;
+  if (record.num_parts == 1) {
+    input = record.parts[0];
+  } else {
+    compression_input_.clear();
+    input = Slice(record, &compression_input_);
+  }
+  compressed_.clear();
+  bool ok = false;
+  switch (compression_) {
+    case kLZ4Compression:
+      ok = LZ4_Compress(*compression_ctx_, 2, input.data(), size,
+                        &compressed_);
+      break;
+    case kZSTD:
+      ok = ZSTD_Compress(*compression_ctx_, input.data(), size, &compressed_);
+      break;
+    default:
+      break;
+  }
+  // Keep the record as is unless it shrinks by at least 12.5%, the same
+  // bar the block based table uses for its blocks
+  return ok && compressed_.size() + 1 < size - (size / 8u);
+}
+
+Status Writer::EmitPhysicalRecord(RecordType t, const SliceParts& payload,
+                                  int* part, size_t* offset, size_t n) {
   assert(n <= 0xffff);  // Must fit in two bytes
 
   size_t header_size;
@@ -113,7 +209,7 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   buf[6] = static_cast<char>(t);
 
   uint32_t crc = type_crc_[t];
-  if (t < kRecyclableFullType) {
+  if (!IsRecyclableType(t)) {
     // Legacy record format
     assert(block_offset_ + kHeaderSize + n <= kBlockSize);
     header_size = kHeaderSize;
@@ -132,18 +228,38 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   }
 
   // Compute the crc of the record type and the payload.
-  crc = crc32c::Extend(crc, ptr, n);
+  int p = *part;
+  size_t off = *offset;
+  for (size_t left = n; left > 0;) {
+    const Slice& piece = payload.parts[p];
+    const size_t len = std::min(left, piece.size() - off);
+    crc = crc32c::Extend(crc, piece.data() + off, len);
+    left -= len;
+    off += len;
+    if (off == piece.size()) {
+      ++p;
+      off = 0;
+    }
+  }
   crc = crc32c::Mask(crc);  // Adjust for storage
   EncodeFixed32(buf, crc);
 
   // Write the header and the payload
   Status s = dest_->Append(Slice(buf, header_size));
+  for (size_t left = n; s.ok() && left > 0;) {
+    const Slice& piece = payload.parts[*part];
+    const size_t len = std::min(left, piece.size() - *offset);
+    s = dest_->Append(Slice(piece.data() + *offset, len));
+    left -= len;
+    *offset += len;
+    if (*offset == piece.size()) {
+      ++*part;
+      *offset = 0;
+    }
+  }
   if (s.ok()) {
-    s = dest_->Append(Slice(ptr, n));
-    if (s.ok()) {
-      if (!manual_flush_) {
-        s = dest_->Flush();
-      }
+    if (!manual_flush_ && !pad_flushes_) {
+      s = dest_->Flush();
     }
   }
   block_offset_ += header_size + n;
@@ -11,14 +11,17 @@
 #include <stdint.h>
 
 #include <memory>
+#include <string>
 
 #include "db/log_format.h"
+#include "rocksdb/options.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
 
+class CompressionContext;
 class WritableFileWriter;
 
 using std::unique_ptr;
@@ -67,6 +70,15 @@ namespace log {
  * Same as above, with the addition of
  * Log number = 32bit log file number, so that we can distinguish between
  * records written by the most recent log writer vs a previous one.
+ *
+ * Compressed records:
+ *
+ * With a compression type set, a record that shrinks enough is written as
+ * the CompressionType (1 byte) followed by the compressed record, and its
+ * first fragment uses one of the compressed types (kCompressedFullType,
+ * kCompressedFirstType or their recyclable variants). Every record is
+ * compressed on its own, so one of them can still be read back when the
+ * records around it are lost.
  */
 class Writer {
  public:
@@ -75,16 +87,22 @@ class Writer {
   // "*dest" must remain live while this Writer is in use.
   explicit Writer(std::unique_ptr<WritableFileWriter>&& dest,
                   uint64_t log_number, bool recycle_log_files,
-                  bool manual_flush = false);
+                  bool manual_flush = false,
+                  CompressionType compression = kNoCompression);
   ~Writer();
 
   Status AddRecord(const Slice& slice);
 
+  // Write the concatenation of `parts` as one record without copying them
+  // into a contiguous buffer first
+  Status AddRecord(const SliceParts& parts);
+
   WritableFileWriter* file() { return dest_.get(); }
   const WritableFileWriter* file() const { return dest_.get(); }
 
   uint64_t get_log_number() const { return log_number_; }
 
+  // Flush the buffered records, see manual_flush
   Status WriteBuffer();
 
   // Notify underlaying filesystem that this file wil not be written again.
@@ -105,12 +123,35 @@ class Writer {
   // record type stored in the header.
   uint32_t type_crc_[kMaxRecordType + 1];
 
-  Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
+  // Emit `length` bytes of `payload` starting at part `*part`, offset
+  // `*offset`, and advance the position past them
+  Status EmitPhysicalRecord(RecordType type, const SliceParts& payload,
+                            int* part, size_t* offset, size_t length);
+
+  // Compress `record` into compressed_, returns false if the record should
+  // be written uncompressed
+  bool CompressRecord(const SliceParts& record, size_t size);
+
+  // Pad the log to the next multiple of kPaddingAlignment, see pad_flushes_
+  Status PadToAlignment();
+
+  // Flush the records, padded if pad_flushes_
+  Status FlushRecords();
 
   // If true, it does not flush after each write. Instead it relies on the upper
   // layer to manually does the flush by calling ::WriteBuffer()
   bool manual_flush_;
 
+  // With direct I/O, pad the log before each flush so that the flushes don't
+  // leave a partial page to be written again by the next one
+  const bool pad_flushes_;
+
+  const CompressionType compression_;
+  const char compression_tag_;
+  std::unique_ptr<CompressionContext> compression_ctx_;
+  std::string compression_input_;
+  std::string compressed_;
+
   // No copying allowed
   Writer(const Writer&);
   void operator=(const Writer&);
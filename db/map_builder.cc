@@ -16,6 +16,7 @@
 #include <inttypes.h>
 
 #include <algorithm>
+#include <atomic>
 #include <list>
 #include <string>
 #include <unordered_map>
@@ -901,6 +902,71 @@ std::vector<RangeWithDepend> PartitionRangeWithDepend(
   return output;
 }
 
+// Sorted runs at least this many are merged in parallel rounds
+const size_t kParallelMergeMinRuns = 8;
+
+// Merge sorted runs into one, always merging adjacent runs, so that the
+// dependence order follows the run order. Many runs (e.g. a lot of L0 files
+// linked at once after a write burst) are merged round by round, the pairs
+// of a round are disjoint and are merged on up to `max_threads` threads.
+void MergeRangeWithDepend(std::list<std::vector<RangeWithDepend>>* level_ranges,
+                          const InternalKeyComparator& icomp,
+                          size_t max_threads) {
+  if (max_threads > 1 && level_ranges->size() >= kParallelMergeMinRuns) {
+    std::vector<std::vector<RangeWithDepend>> runs(
+        std::make_move_iterator(level_ranges->begin()),
+        std::make_move_iterator(level_ranges->end()));
+    level_ranges->clear();
+    while (runs.size() > 1) {
+      size_t pairs = runs.size() / 2;
+      std::vector<std::vector<RangeWithDepend>> merged(runs.size() - pairs);
+      std::atomic<size_t> next_pair(0);
+      auto merge_pairs = [&] {
+        for (size_t i = next_pair.fetch_add(1); i < pairs;
+             i = next_pair.fetch_add(1)) {
+          merged[i] = PartitionRangeWithDepend(runs[i * 2], runs[i * 2 + 1],
+                                               icomp, PartitionType::kMerge);
+        }
+      };
+      std::vector<port::Thread> thread_pool;
+      size_t num_threads = std::min(max_threads, pairs);
+      for (size_t i = 1; i < num_threads; ++i) {
+        thread_pool.emplace_back(merge_pairs);
+      }
+      merge_pairs();
+      for (auto& thread : thread_pool) {
+        thread.join();
+      }
+      if (runs.size() % 2 != 0) {
+        merged.back() = std::move(runs.back());
+      }
+      runs.swap(merged);
+    }
+    level_ranges->emplace_back(std::move(runs.front()));
+    return;
+  }
+  // TODO(zouzhizhang): multi way union
+  while (level_ranges->size() > 1) {
+    auto union_a = level_ranges->begin();
+    auto union_b = std::next(union_a);
+    size_t min_sum = union_a->size() + union_b->size();
+    for (auto next = std::next(union_b); next != level_ranges->end();
+         ++union_b, ++next) {
+      size_t sum = union_b->size() + next->size();
+      if (sum < min_sum) {
+        min_sum = sum;
+        union_a = union_b;
+      }
+    }
+    union_b = std::next(union_a);
+    level_ranges->insert(union_a,
+                         PartitionRangeWithDepend(*union_a, *union_b, icomp,
+                                                  PartitionType::kMerge));
+    level_ranges->erase(union_a);
+    level_ranges->erase(union_b);
+  }
+}
+
 Status LoadDeleteRangeIterImpl(
     const FileMetaData* f, const InternalKeyComparator& ic,
     IteratorCache& iterator_cache,
@@ -952,6 +1018,80 @@ Status LoadDeleteRangeIter(
   return Status::OK();
 };
 
+struct MapBuilderTombstone {
+  Slice start_key, end_key;  // user keys
+  SequenceNumber seq;
+};
+
+// Whether f has nothing left in the user keys [start_key, end_key] or, if
+// end_exclusive, [start_key, end_key) for any reader: tombstones newer than
+// all of f, with no snapshot between f and them, cover the whole range.
+// tombstones are sorted by start_key.
+bool IsRangeOfFileDeleted(const Slice& start_key, const Slice& end_key,
+                          bool end_exclusive, const FileMetaData* f,
+                          const std::vector<MapBuilderTombstone>& tombstones,
+                          const std::vector<SequenceNumber>& snapshots,
+                          const Comparator* uc) {
+  auto snapshot = std::lower_bound(snapshots.begin(), snapshots.end(),
+                                   f->fd.smallest_seqno);
+  Slice covered_end = start_key;
+  for (auto& t : tombstones) {
+    if (uc->Compare(t.start_key, covered_end) > 0) {
+      break;
+    }
+    if (t.seq <= f->fd.largest_seqno ||
+        (snapshot != snapshots.end() && *snapshot < t.seq) ||
+        uc->Compare(t.end_key, covered_end) <= 0) {
+      continue;
+    }
+    covered_end = t.end_key;
+    int c = uc->Compare(covered_end, end_key);
+    if (c > 0 || (c == 0 && end_exclusive)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Unlink the files of the ranges with range deletions whose keys in the range
+// are all deleted, so dropping a key range needs no rewrite of its data. Files
+// with range deletions of their own are kept, they may still cover ranges out
+// of this map.
+void DropDeletedDependence(std::vector<RangeWithDepend>* ranges,
+                           const std::vector<MapBuilderTombstone>& tombstones,
+                           const std::vector<SequenceNumber>& snapshots,
+                           IteratorCache& iterator_cache,
+                           const InternalKeyComparator& icomp) {
+  auto uc = icomp.user_comparator();
+  auto end = std::remove_if(
+      ranges->begin(), ranges->end(), [&](RangeWithDepend& r) {
+        if (!r.has_delete_range) {
+          return false;
+        }
+        Slice start_key = ExtractUserKey(r.point[0]);
+        Slice end_key = ExtractUserKey(r.point[1]);
+        // No key of end_key is before point[1] at kMaxSequenceNumber
+        bool end_exclusive =
+            GetInternalKeySeqno(r.point[1]) == kMaxSequenceNumber;
+        auto& dependence = r.dependence;
+        auto dependence_end = std::remove_if(
+            dependence.begin(), dependence.end(),
+            [&](const MapSstElement::LinkTarget& link) {
+              auto f = iterator_cache.GetFileMetaData(link.file_number);
+              return f != nullptr && !f->prop.is_map_sst() &&
+                     !f->prop.has_range_deletions() &&
+                     IsRangeOfFileDeleted(start_key, end_key, end_exclusive,
+                                          f, tombstones, snapshots, uc);
+            });
+        if (dependence_end != dependence.end()) {
+          dependence.erase(dependence_end, dependence.end());
+          r.stable = false;
+        }
+        return dependence.empty();
+      });
+  ranges->erase(end, ranges->end());
+}
+
 }  // namespace
 
 MapBuilder::MapBuilder(int job_id, const ImmutableDBOptions& db_options,
@@ -965,15 +1105,15 @@ MapBuilder::MapBuilder(int job_id, const ImmutableDBOptions& db_options,
       versions_(versions),
       stats_(stats) {}
 
-Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
-                         const std::vector<Range>& deleted_range,
-                         const std::vector<FileMetaData*>& added_files,
-                         int output_level, uint32_t output_path_id,
-                         ColumnFamilyData* cfd, bool optimize_range_deletion,
-                         Version* version, VersionEdit* edit,
-                         FileMetaData* file_meta_ptr,
-                         std::unique_ptr<TableProperties>* prop_ptr,
-                         std::set<FileMetaData*>* deleted_files) {
+Status MapBuilder::Build(
+    const std::vector<CompactionInputFiles>& inputs,
+    const std::vector<Range>& deleted_range,
+    const std::vector<FileMetaData*>& added_files, int output_level,
+    uint32_t output_path_id, ColumnFamilyData* cfd,
+    bool optimize_range_deletion, Version* version, VersionEdit* edit,
+    FileMetaData* file_meta_ptr, std::unique_ptr<TableProperties>* prop_ptr,
+    std::set<FileMetaData*>* deleted_files,
+    const std::vector<SequenceNumber>* existing_snapshots) {
   assert(output_level != 0 || inputs.front().level == 0);
   assert(!inputs.front().files.empty());
   auto vstorage = version->storage_info();
@@ -1041,27 +1181,8 @@ Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
   }
 
   // merge ranges
-  // TODO(zouzhizhang): multi way union
-  while (level_ranges.size() > 1) {
-    auto union_a = level_ranges.begin();
-    auto union_b = std::next(union_a);
-    size_t min_sum = union_a->size() + union_b->size();
-    for (auto next = std::next(union_b); next != level_ranges.end();
-         ++union_b, ++next) {
-      size_t sum = union_b->size() + next->size();
-      if (sum < min_sum) {
-        min_sum = sum;
-        union_a = union_b;
-      }
-    }
-    union_b = std::next(union_a);
-    level_ranges.insert(
-        union_a,
-        PartitionRangeWithDepend(*union_a, *union_b, cfd->internal_comparator(),
-                                 PartitionType::kMerge));
-    level_ranges.erase(union_a);
-    level_ranges.erase(union_b);
-  }
+  MergeRangeWithDepend(&level_ranges, icomp,
+                       version->GetMutableCFOptions().max_subcompactions);
 
   if (!level_ranges.empty() && !deleted_range.empty()) {
     std::vector<RangeWithDepend> ranges;
@@ -1151,6 +1272,7 @@ Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
   }
   if (optimize_range_deletion && !tombstones.empty() && !level_ranges.empty()) {
     std::vector<RangeWithDepend> ranges;
+    std::vector<MapBuilderTombstone> deleted_ranges;
     auto uc = icomp.user_comparator();
     Slice last_end_key;
     for (tombstone_iter->SeekToFirst(); tombstone_iter->Valid();
@@ -1162,6 +1284,11 @@ Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
         return s;
       }
       auto end_key = v.slice();
+      if (existing_snapshots != nullptr) {
+        deleted_ranges.emplace_back(MapBuilderTombstone{
+            ArenaPinSlice(start_key, arena), ArenaPinSlice(end_key, arena),
+            GetInternalKeySeqno(tombstone_iter->key())});
+      }
 
       if (!ranges.empty() && uc->Compare(start_key, last_end_key) <= 0) {
         if (uc->Compare(end_key, last_end_key) > 0) {
@@ -1186,6 +1313,13 @@ Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
     // assert(!level_ranges.empty());
     level_ranges.front() = PartitionRangeWithDepend(
         level_ranges.front(), ranges, icomp, PartitionType::kMerge);
+    if (!deleted_ranges.empty()) {
+      DropDeletedDependence(&level_ranges.front(), deleted_ranges,
+                            *existing_snapshots, iterator_cache, icomp);
+      if (level_ranges.front().empty()) {
+        level_ranges.pop_front();
+      }
+    }
   }
   std::vector<RangeWithDepend> ranges;
   if (!level_ranges.empty()) {
@@ -1346,6 +1480,7 @@ Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
     assert(level_files.level <= output_level);
     FileMetaDataBoundBuilder bound_builder(&cfd->internal_comparator());
     if (level_files.level == 0) {
+      std::list<std::vector<RangeWithDepend>> level_ranges;
       for (auto f : level_files.files) {
         s = LoadDeleteRangeIter(f, icomp, iterator_cache, &range_del_iter_vec);
         if (!s.ok()) {
@@ -1359,18 +1494,27 @@ Status MapBuilder::Build(const std::vector<CompactionInputFiles>& inputs,
         }
         assert(std::is_sorted(ranges.begin(), ranges.end(),
                               TERARK_FIELD(point[1]) < icomp));
-        if (range_items.empty()) {
-          range_items.emplace_back(FileMetaDataBoundBuilder(nullptr), 0,
-                                   f->prop.is_map_sst(), std::move(ranges));
-        } else {
-          assert(range_items.front().level == 0);
-          auto& level_ranges = range_items.front();
-          level_ranges.is_map = false;
-          level_ranges.ranges = PartitionRangeWithDepend(
-              level_ranges.ranges, ranges, cfd->internal_comparator(),
-              PartitionType::kMerge);
-          level_ranges.input_range_count = size_t(-1);
-        }
+        level_ranges.emplace_back(std::move(ranges));
+      }
+      bool is_merged = level_ranges.size() > 1;
+      MergeRangeWithDepend(&level_ranges, icomp,
+                           version->GetMutableCFOptions().max_subcompactions);
+      if (range_items.empty()) {
+        range_items.emplace_back(
+            FileMetaDataBoundBuilder(nullptr), 0,
+            !is_merged && level_files.files.front()->prop.is_map_sst(),
+            std::move(level_ranges.front()));
+      } else {
+        assert(range_items.front().level == 0);
+        auto& front = range_items.front();
+        front.ranges = PartitionRangeWithDepend(
+            front.ranges, level_ranges.front(), cfd->internal_comparator(),
+            PartitionType::kMerge);
+        is_merged = true;
+      }
+      if (is_merged) {
+        range_items.front().is_map = false;
+        range_items.front().input_range_count = size_t(-1);
       }
       range_items.front().bound_builder = std::move(bound_builder);
     } else {
@@ -1622,6 +1766,7 @@ Status MapBuilder::WriteOutputFile(
   writable_file->SetPreallocationBlockSize(4ULL << 20);
   std::unique_ptr<WritableFileWriter> outfile(new WritableFileWriter(
       std::move(writable_file), fname, env_options_, stats_));
+  outfile->set_io_file_kind(IOFileKind::kMap);
 
   uint64_t output_file_creation_time;
   {
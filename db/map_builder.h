@@ -58,6 +58,8 @@ class MapBuilder {
   // added_files is sorted
   // file_meta::fd::file_size == 0 if don't need create map files
   // file_meta , porp , deleted_files nullptr if ignore
+  // With optimize_range_deletion and existing_snapshots (sorted), files are
+  // unlinked from the ranges whose keys are all deleted by range tombstones
   Status Build(const std::vector<CompactionInputFiles>& inputs,
                const std::vector<Range>& deleted_range,
                const std::vector<FileMetaData*>& added_files, int output_level,
@@ -65,7 +67,8 @@ class MapBuilder {
                bool optimize_range_deletion, Version* version,
                VersionEdit* edit, FileMetaData* file_meta = nullptr,
                std::unique_ptr<TableProperties>* porp = nullptr,
-               std::set<FileMetaData*>* deleted_files = nullptr);
+               std::set<FileMetaData*>* deleted_files = nullptr,
+               const std::vector<SequenceNumber>* existing_snapshots = nullptr);
 
   // All params are references or pointers
   // push_range use user key
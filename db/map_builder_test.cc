@@ -197,6 +197,42 @@ class MapBuilderTest : public testing::Test {
     return "";
   }
 
+  // Map a file of keys under a newer tombstone of another file
+  void BuildWithDeletedFile(bool has_snapshot) {
+    Init();
+    MapBuilder map_builder(0, db_options_, env_options_, versions_.get(),
+                           stats_, dbname_);
+    input_files_.resize(2);
+    stl_wrappers::KVMap kv_contents = CreateFile(0, 5, false);
+    stl_wrappers::KVMap del_contents = CreateFile(0, 9, true);
+    AddMockFile(kv_contents, 1 /*level*/, false, stl_wrappers::KVMap());
+    AddMockFile(stl_wrappers::KVMap(), 0, true, del_contents);
+    UpdateVersionStorageInfo();
+    uint64_t data_file_number = files_[0]->fd.GetNumber();
+    std::vector<SequenceNumber> snapshots;
+    if (has_snapshot) {
+      // Sees the keys but not the tombstone
+      snapshots.push_back(sequence_number - 1);
+    }
+    VersionEdit map_edit;
+    std::vector<Range> deleted_range;
+    std::vector<FileMetaData*> added_files;
+    std::unique_ptr<FileMetaData> output_file(new FileMetaData);
+    Status s = map_builder.Build(input_files_, deleted_range, added_files, 1,
+                                 0, cfd_, true /* optimize_range_deletion */,
+                                 cfd_->current(), &map_edit, output_file.get(),
+                                 nullptr, nullptr, &snapshots);
+    ASSERT_OK(s);
+    bool data_file_linked = false;
+    for (auto& dependence : output_file->prop.dependence) {
+      data_file_linked |= dependence.file_number == data_file_number;
+    }
+    for (auto& pair : map_edit.GetNewFiles()) {
+      data_file_linked |= pair.second.fd.GetNumber() == data_file_number;
+    }
+    ASSERT_EQ(has_snapshot, data_file_linked);
+  }
+
   bool CheckFile(FileMetaData* f) {
     Status s;
     DependenceMap empty_dependence_map;
@@ -394,6 +430,16 @@ TEST_F(MapBuilderTest, NoNeedBuildMapSst) {
   ASSERT_LE(output_file->fd.GetNumber(), 0);
 }
 
+// The older file in the range of a newer tombstone is unlinked unless a
+// snapshot is between them
+TEST_F(MapBuilderTest, DropDeletedDependence) {
+  BuildWithDeletedFile(false /* has_snapshot */);
+}
+
+TEST_F(MapBuilderTest, SnapshotKeepsDeletedDependence) {
+  BuildWithDeletedFile(true /* has_snapshot */);
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
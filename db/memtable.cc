@@ -18,6 +18,7 @@
 #include "db/merge_helper.h"
 #include "db/range_tombstone_fragmenter.h"
 #include "db/read_callback.h"
+#include "db/value_log.h"
 #include "monitoring/perf_context_imp.h"
 #include "monitoring/statistics.h"
 #include "port/port.h"
@@ -49,6 +50,8 @@ ImmutableMemTableOptions::ImmutableMemTableOptions(
               static_cast<double>(mutable_cf_options.write_buffer_size) *
               mutable_cf_options.memtable_prefix_bloom_size_ratio) *
           8u),
+      memtable_whole_key_filtering(
+          mutable_cf_options.memtable_whole_key_filtering),
       memtable_huge_page_size(mutable_cf_options.memtable_huge_page_size),
       inplace_update_support(ioptions.inplace_update_support),
       inplace_update_num_locks(mutable_cf_options.inplace_update_num_locks),
@@ -101,6 +104,7 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
       locks_(moptions_.inplace_update_support
                  ? moptions_.inplace_update_num_locks
                  : 0),
+      value_log_bytes_(0),
       prefix_extractor_(mutable_cf_options.prefix_extractor.get()),
       flush_state_(FLUSH_NOT_REQUESTED),
       env_(ioptions.env),
@@ -112,7 +116,8 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
   // something went wrong if we need to flush before inserting anything
   assert(!ShouldScheduleFlush());
 
-  if (prefix_extractor_ && moptions_.memtable_prefix_bloom_bits > 0) {
+  if ((prefix_extractor_ || moptions_.memtable_whole_key_filtering) &&
+      moptions_.memtable_prefix_bloom_bits > 0) {
     prefix_bloom_.reset(new DynamicBloom(
         &arena_, moptions_.memtable_prefix_bloom_bits, ioptions.bloom_locality,
         6 /* hard coded 6 probes */, nullptr, moptions_.memtable_huge_page_size,
@@ -169,7 +174,8 @@ bool MemTable::ShouldFlushNow() const {
   // shouldn't flush.
   auto allocated_memory = table_->ApproximateMemoryUsage() +
                           range_del_table_->ApproximateMemoryUsage() +
-                          arena_.MemoryAllocatedBytes();
+                          arena_.MemoryAllocatedBytes() +
+                          value_log_bytes_.load(std::memory_order_relaxed);
 
   // if we can still allocate one more block without exceeding the
   // over-allocation ratio, then we should not flush.
@@ -395,7 +401,10 @@ class MemTableIterator : public InternalIteratorBase<LazyBuffer>,
   virtual LazyBuffer value() const override {
     assert(valid_);
     ValueType type = GetInternalKeyType(iter_->key());
-    if (value_pinned_ || (type != kTypeValue && type != kTypeValueIndex)) {
+    if (type == kTypeValueIndex) {
+      return mem_.GetValueLogValue(GetLengthPrefixedSlice(iter_->value()));
+    }
+    if (value_pinned_ || type != kTypeValue) {
       return LazyBuffer(GetLengthPrefixedSlice(iter_->value()), Cleanable());
     } else {
       return LazyBuffer(this, {});
@@ -468,7 +477,15 @@ class MemTableIterator : public InternalIteratorBase<LazyBuffer>,
   }
   virtual Slice key() const override {
     assert(valid_);
-    return iter_->key();
+    Slice internal_key = iter_->key();
+    if (GetInternalKeyType(internal_key) != kTypeValueIndex) {
+      return internal_key;
+    }
+    // The value index of a value log reads as the value it points to
+    value_index_key_.SetInternalKey(ExtractUserKey(internal_key),
+                                    GetInternalKeySeqno(internal_key),
+                                    kTypeValue);
+    return value_index_key_.GetInternalKey();
   }
 
   virtual Status status() const override { return Status::OK(); }
@@ -483,6 +500,7 @@ class MemTableIterator : public InternalIteratorBase<LazyBuffer>,
   bool arena_mode_;
   bool value_pinned_;
   bool is_seek_for_prev_supported_;
+  mutable IterKey value_index_key_;
 
   // No copying allowed
   MemTableIterator(const MemTableIterator&) = delete;
@@ -614,22 +632,25 @@ bool MemTable::Add(SequenceNumber s, ValueType type,
   std::unique_ptr<MemTableRep>& table =
       type == kTypeRangeDeletion ? range_del_table_ : table_;
 
-  InternalKey internal_key(key, s, type);
-  size_t encoded_len =
-      MemTableRep::EncodeKeyValueSize(internal_key.Encode(), value);
+  // The rep copies the internal key and the value into the arena, that is the
+  // only copy of them on the write path. Build the internal key in the inline
+  // space of IterKey, so that it does not cost a heap allocation of its own.
+  IterKey encoded_key;
+  encoded_key.SetInternalKey(key, s, type);
+  Slice internal_key = encoded_key.GetInternalKey();
+  size_t encoded_len = MemTableRep::EncodeKeyValueSize(internal_key, value);
   if (!allow_concurrent) {
     // Extract prefix for insert with hint.
     if (insert_with_hint_prefix_extractor_ != nullptr &&
-        insert_with_hint_prefix_extractor_->InDomain(internal_key.user_key())) {
-      Slice prefix = insert_with_hint_prefix_extractor_->Transform(
-          internal_key.user_key());
-      bool res = table->InsertKeyValueWithHint(internal_key.Encode(), value,
+        insert_with_hint_prefix_extractor_->InDomain(key)) {
+      Slice prefix = insert_with_hint_prefix_extractor_->Transform(key);
+      bool res = table->InsertKeyValueWithHint(internal_key, value,
                                                &insert_hints_[prefix]);
       if (UNLIKELY(!res)) {
         return res;
       }
     } else {
-      bool res = table->InsertKeyValue(internal_key.Encode(), value);
+      bool res = table->InsertKeyValue(internal_key, value);
       if (UNLIKELY(!res)) {
         return res;
       }
@@ -647,8 +668,12 @@ bool MemTable::Add(SequenceNumber s, ValueType type,
     }
 
     if (prefix_bloom_) {
-      assert(prefix_extractor_);
-      prefix_bloom_->Add(prefix_extractor_->Transform(key));
+      if (prefix_extractor_) {
+        prefix_bloom_->Add(prefix_extractor_->Transform(key));
+      }
+      if (moptions_.memtable_whole_key_filtering) {
+        prefix_bloom_->Add(key);
+      }
     }
 
     // The first sequence number inserted into the memtable
@@ -665,7 +690,7 @@ bool MemTable::Add(SequenceNumber s, ValueType type,
     assert(post_process_info == nullptr);
     UpdateFlushState();
   } else {
-    bool res = table->InsertKeyValueConcurrently(internal_key.Encode(), value);
+    bool res = table->InsertKeyValueConcurrently(internal_key, value);
     if (UNLIKELY(!res)) {
       return res;
     }
@@ -678,8 +703,12 @@ bool MemTable::Add(SequenceNumber s, ValueType type,
     }
 
     if (prefix_bloom_) {
-      assert(prefix_extractor_);
-      prefix_bloom_->AddConcurrently(prefix_extractor_->Transform(key));
+      if (prefix_extractor_) {
+        prefix_bloom_->AddConcurrently(prefix_extractor_->Transform(key));
+      }
+      if (moptions_.memtable_whole_key_filtering) {
+        prefix_bloom_->AddConcurrently(key);
+      }
     }
 
     // atomically update first_seqno_ and earliest_seqno_.
@@ -764,9 +793,28 @@ static bool SaveValue(void* arg, const Slice& internal_key, const char* value) {
       type = kTypeRangeDeletion;
     }
     switch (type) {
-      case kTypeValueIndex:
-        assert(false);
-        FALLTHROUGH_INTENDED;
+      case kTypeValueIndex: {
+        // The value index of a value log, never updated in place
+        LazyBuffer lazy_val =
+            s->mem->GetValueLogValue(GetLengthPrefixedSlice(value));
+        *s->status = Status::OK();
+        if (*s->merge_in_progress) {
+          if (LIKELY(s->value != nullptr)) {
+            *s->status = MergeHelper::TimedFullMerge(
+                merge_operator, s->key->user_key(), &lazy_val,
+                merge_context->GetOperands(), s->value, s->logger,
+                s->statistics, s->env_, true);
+            if (s->status->ok()) {
+              s->value->pin(LazyBufferPinLevel::Internal);
+            }
+          }
+        } else if (LIKELY(s->value != nullptr)) {
+          s->value->reset(std::move(lazy_val));
+          *s->status = s->value->fetch();
+        }
+        *s->found_final_value = true;
+        return false;
+      }
       case kTypeValue: {
         if (s->inplace_update_support) {
           s->mem->GetLock(s->key->user_key())->ReadLock();
@@ -879,10 +927,16 @@ bool MemTable::Get(const LookupKey& key, LazyBuffer* value, Status* s,
   Slice user_key = key.user_key();
   bool found_final_value = false;
   bool merge_in_progress = s->IsMergeInProgress();
-  bool const may_contain =
-      nullptr == prefix_bloom_
-          ? false
-          : prefix_bloom_->MayContain(prefix_extractor_->Transform(user_key));
+  bool may_contain = true;
+  if (prefix_bloom_) {
+    if (moptions_.memtable_whole_key_filtering) {
+      may_contain = prefix_bloom_->MayContain(user_key);
+    } else {
+      assert(prefix_extractor_);
+      may_contain =
+          prefix_bloom_->MayContain(prefix_extractor_->Transform(user_key));
+    }
+  }
   if (prefix_bloom_ && !may_contain) {
     // iter is null if prefix bloom says the key does not exist
     PERF_COUNTER_ADD(bloom_memtable_miss_count, 1);
@@ -1059,6 +1113,32 @@ size_t MemTable::CountSuccessiveMergeEntries(const LookupKey& key) {
   return num_successive_merges;
 }
 
+void MemTable::RefValueLog(const std::shared_ptr<ValueLog>& log,
+                           uint64_t value_size) {
+  value_log_bytes_.fetch_add(value_size, std::memory_order_relaxed);
+  MutexLock l(&value_logs_mutex_);
+  // The puts of a memtable mostly come from the value log of one WAL
+  if (value_logs_.empty() || value_logs_.back() != log) {
+    if (std::find(value_logs_.begin(), value_logs_.end(), log) ==
+        value_logs_.end()) {
+      value_logs_.push_back(log);
+    }
+  }
+}
+
+LazyBuffer MemTable::GetValueLogValue(const Slice& index) const {
+  uint64_t number;
+  if (ValueLog::DecodeNumber(index, &number)) {
+    MutexLock l(&value_logs_mutex_);
+    for (auto& log : value_logs_) {
+      if (log->number() == number) {
+        return log->GetValue(index);
+      }
+    }
+  }
+  return LazyBuffer(Status::Corruption("bad value index in memtable"));
+}
+
 void MemTable::RefLogContainingPrepSection(uint64_t log) {
   assert(log > 0);
   auto cur = min_prep_log_referenced_.load();
@@ -36,6 +36,7 @@ namespace TERARKDB_NAMESPACE {
 class Mutex;
 template <class TValue>
 class MemTableIteratorBase;
+class ValueLog;
 class MergeContext;
 
 struct ImmutableMemTableOptions {
@@ -43,6 +44,7 @@ struct ImmutableMemTableOptions {
                                     const MutableCFOptions& mutable_cf_options);
   size_t arena_block_size;
   uint32_t memtable_prefix_bloom_bits;
+  bool memtable_whole_key_filtering;
   size_t memtable_huge_page_size;
   bool inplace_update_support;
   size_t inplace_update_num_locks;
@@ -247,6 +249,14 @@ class MemTable {
   // key in the memtable.
   size_t CountSuccessiveMergeEntries(const LookupKey& key);
 
+  // Keep `log` for the value index of a value of `value_size` bytes added
+  // next. The value counts toward the write buffer size. Thread safe, for
+  // the concurrent memtable writes.
+  void RefValueLog(const std::shared_ptr<ValueLog>& log, uint64_t value_size);
+
+  // The value a value index of the memtable points to, read on fetch
+  LazyBuffer GetValueLogValue(const Slice& index) const;
+
   // Update counters and flush status after inserting a whole write batch
   // Used in concurrent memtable inserts.
   void BatchPostProcess(const MemTablePostProcessInfo& update_counters) {
@@ -467,6 +477,11 @@ class MemTable {
   // FragmentedRangeTombstoneList lock
   port::Mutex tombstone_locks_;
 
+  // The value logs of the value indexes added to the memtable
+  mutable port::Mutex value_logs_mutex_;
+  std::vector<std::shared_ptr<ValueLog>> value_logs_;
+  std::atomic<uint64_t> value_log_bytes_;
+
   const SliceTransform* const prefix_extractor_;
   std::unique_ptr<DynamicBloom> prefix_bloom_;
 
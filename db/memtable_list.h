@@ -230,6 +230,12 @@ class MemTableList {
   // Takes ownership of the referenced held on *m by the caller of Add().
   void Add(MemTable* m, autovector<MemTable*>* to_delete);
 
+  // Remove the memtables that only hold data of the logs older than
+  // log_number, which has been flushed by the primary of a secondary
+  // instance. See DB::OpenAsSecondary().
+  void RemoveOldMemTables(uint64_t log_number,
+                          autovector<MemTable*>* to_delete);
+
   // Returns an estimate of the number of bytes of data in use.
   size_t ApproximateMemoryUsage();
 
@@ -0,0 +1,304 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/parallel_filter_iterator.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
+#include "util/stop_watch.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// The records read ahead for each filter thread
+const size_t kRecordsPerThread = 64;
+// The most records filtered by a single CompactionFilter::FilterBatch()
+const size_t kMaxBatchSize = 16;
+}  // namespace
+
+ParallelFilterIterator::ParallelFilterIterator(
+    InternalIterator* input, SeparateHelper* separate_helper,
+    const Comparator* ucmp, const Slice* end,
+    std::vector<std::unique_ptr<CompactionFilter>>&& filters, int level,
+    bool filter_all, SequenceNumber latest_snapshot, Env* env)
+    : input_(input),
+      separate_helper_(separate_helper),
+      ucmp_(ucmp),
+      end_(end),
+      filters_(std::move(filters)),
+      level_(level),
+      filter_all_(filter_all),
+      latest_snapshot_(latest_snapshot),
+      env_(env),
+      window_(filters_.size() * kRecordsPerThread),
+      work_cv_(&mutex_),
+      done_cv_(&mutex_) {
+  assert(!filters_.empty());
+  workers_.reserve(filters_.size());
+  for (size_t i = 0; i < filters_.size(); ++i) {
+    workers_.emplace_back(&ParallelFilterIterator::Worker, this, i);
+  }
+  ReadAhead();
+}
+
+ParallelFilterIterator::~ParallelFilterIterator() {
+  {
+    MutexLock l(&mutex_);
+    stop_ = true;
+    work_cv_.SignalAll();
+  }
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+Slice ParallelFilterIterator::key() const {
+  assert(Valid());
+  return records_[pos_].key;
+}
+
+LazyBuffer ParallelFilterIterator::value() const {
+  assert(Valid());
+  const Record& record = records_[pos_];
+  if (!record.status.ok()) {
+    return LazyBuffer(Status(record.status));
+  }
+  return LazyBuffer(Slice(record.value), true, record.file_number);
+}
+
+Status ParallelFilterIterator::status() const {
+  if (!status_.ok()) {
+    return status_;
+  }
+  return input_->status();
+}
+
+void ParallelFilterIterator::Next() {
+  assert(Valid());
+  ++pos_;
+  // The previous record stays, the caller may still refer to its key
+  while (pos_ > 1) {
+    PopFront();
+  }
+  if (records_.size() - pos_ <= window_ / 2) {
+    ReadAhead();
+  }
+}
+
+void ParallelFilterIterator::Seek(const Slice& target) {
+  Clear();
+  input_->Seek(target);
+  ReadAhead();
+}
+
+void ParallelFilterIterator::SeekToFirst() {
+  Clear();
+  input_->SeekToFirst();
+  ReadAhead();
+}
+
+void ParallelFilterIterator::SeekForPrev(const Slice& /*target*/) {
+  assert(false);
+  Clear();
+  status_ = Status::NotSupported("ParallelFilterIterator::SeekForPrev");
+}
+
+void ParallelFilterIterator::SeekToLast() {
+  assert(false);
+  Clear();
+  status_ = Status::NotSupported("ParallelFilterIterator::SeekToLast");
+}
+
+void ParallelFilterIterator::Prev() {
+  assert(false);
+  Clear();
+  status_ = Status::NotSupported("ParallelFilterIterator::Prev");
+}
+
+bool ParallelFilterIterator::TakeDecision(CompactionFilter::Decision* decision,
+                                          LazyBuffer* new_value,
+                                          std::string* skip_until,
+                                          uint64_t* filter_nanos) {
+  assert(Valid());
+  Record& record = records_[pos_];
+  if (!record.filter) {
+    return false;
+  }
+  record.filter = false;
+  {
+    MutexLock l(&mutex_);
+    if (!record.done) {
+      // The oldest record not filtered yet, the caller is faster than
+      // waiting for a worker to pick it up
+      if (!queue_.empty() && queue_.front() == &record) {
+        queue_.pop_front();
+        record.done = true;
+        return false;
+      }
+      while (!record.done) {
+        done_cv_.Wait();
+      }
+    }
+  }
+  *decision = record.decision;
+  new_value->reset(std::move(record.new_value));
+  skip_until->swap(record.skip_until);
+  *filter_nanos = record.filter_nanos;
+  return true;
+}
+
+void ParallelFilterIterator::Worker(size_t index) {
+  const CompactionFilter* filter = filters_[index].get();
+  std::vector<Record*> batch;
+  MutexLock l(&mutex_);
+  while (true) {
+    while (queue_.empty() && !stop_) {
+      work_cv_.Wait();
+    }
+    if (stop_) {
+      break;
+    }
+    // A share of the queue, the first records are soon waited for
+    size_t n = std::min(kMaxBatchSize, (queue_.size() + filters_.size() - 1) /
+                                           filters_.size());
+    batch.assign(queue_.begin(), queue_.begin() + n);
+    queue_.erase(queue_.begin(), queue_.begin() + n);
+    running_ += n;
+    mutex_.Unlock();
+    Filter(filter, batch);
+    mutex_.Lock();
+    for (auto record : batch) {
+      record->done = true;
+    }
+    running_ -= n;
+    done_cv_.SignalAll();
+  }
+}
+
+void ParallelFilterIterator::Filter(const CompactionFilter* filter,
+                                    const std::vector<Record*>& batch) {
+  size_t n = batch.size();
+  std::vector<std::string> metas(n);
+  std::vector<LazyBuffer> values(n);
+  std::vector<CompactionFilter::BatchEntry> entries(n);
+  for (size_t i = 0; i < n; ++i) {
+    Record* record = batch[i];
+    ParsedInternalKey ikey;
+    bool parsed = ParseInternalKey(record->key, &ikey);
+    assert(parsed);
+    (void)parsed;
+    // As CombinedInternalIterator::value() with the meta of the index
+    if (separate_helper_ != nullptr && ikey.type == kTypeValueIndex) {
+      LazyBuffer value_index(Slice(record->value), false, record->file_number);
+      values[i] = separate_helper_->TransToCombined(
+          ikey.user_key, ikey.sequence, value_index);
+      auto meta_slice = SeparateHelper::DecodeValueMeta(record->value);
+      metas[i].assign(meta_slice.data(), meta_slice.size());
+    } else {
+      values[i].reset(Slice(record->value), false, record->file_number);
+    }
+    entries[i] = {ikey.user_key,
+                  metas[i],
+                  &values[i],
+                  CompactionFilter::Decision::kKeep,
+                  &record->new_value,
+                  &record->skip_until};
+  }
+  uint64_t filter_nanos = 0;
+  if (env_ != nullptr) {
+    StopWatchNano timer(env_, true);
+    filter->FilterBatch(level_, entries.data(), n);
+    filter_nanos = timer.ElapsedNanos();
+  } else {
+    filter->FilterBatch(level_, entries.data(), n);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    batch[i]->decision = entries[i].decision;
+    // Shared evenly among the records of the batch
+    batch[i]->filter_nanos = filter_nanos / n;
+  }
+}
+
+void ParallelFilterIterator::ReadAhead() {
+  while (records_.size() - pos_ < window_ && input_->Valid()) {
+    Slice key = input_->key();
+    ParsedInternalKey ikey;
+    bool parsed = ParseInternalKey(key, &ikey);
+    if (parsed && end_ != nullptr &&
+        ucmp_->Compare(ikey.user_key, *end_) >= 0) {
+      // Past the end of the subcompaction, the caller stops there too
+      break;
+    }
+    records_.emplace_back();
+    Record& record = records_.back();
+    record.key.assign(key.data(), key.size());
+    LazyBuffer value = input_->value();
+    record.status = value.fetch();
+    if (record.status.ok()) {
+      record.value.assign(value.data(), value.size());
+      record.file_number = value.file_number();
+    }
+    if (!parsed) {
+      has_last_user_key_ = false;
+    } else {
+      bool first = !has_last_user_key_ ||
+                   !ucmp_->Equal(ikey.user_key, last_user_key_);
+      if (first) {
+        last_user_key_.assign(ikey.user_key.data(), ikey.user_key.size());
+        has_last_user_key_ = true;
+      }
+      record.filter =
+          first && record.status.ok() &&
+          (ikey.type == kTypeValue || ikey.type == kTypeValueIndex) &&
+          (filter_all_ || ikey.sequence > latest_snapshot_);
+    }
+    if (record.filter) {
+      MutexLock l(&mutex_);
+      record.done = false;
+      queue_.push_back(&record);
+      work_cv_.Signal();
+    }
+    input_->Next();
+  }
+}
+
+void ParallelFilterIterator::PopFront() {
+  Record* record = &records_.front();
+  {
+    MutexLock l(&mutex_);
+    // The records are queued in order, a record not taken by a worker yet is
+    // the first one queued
+    if (!record->done && !queue_.empty() && queue_.front() == record) {
+      queue_.pop_front();
+      record->done = true;
+    }
+    while (!record->done) {
+      done_cv_.Wait();
+    }
+  }
+  records_.pop_front();
+  --pos_;
+}
+
+void ParallelFilterIterator::Clear() {
+  {
+    MutexLock l(&mutex_);
+    for (auto record : queue_) {
+      record->done = true;
+    }
+    queue_.clear();
+    while (running_ > 0) {
+      done_cv_.Wait();
+    }
+  }
+  records_.clear();
+  pos_ = 0;
+  has_last_user_key_ = false;
+}
+
+}  // namespace TERARKDB_NAMESPACE
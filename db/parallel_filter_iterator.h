@@ -0,0 +1,121 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "port/port.h"
+#include "rocksdb/compaction_filter.h"
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+#include "table/internal_iterator.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// Reads the input of a compaction ahead of the CompactionIterator and runs
+// the compaction filter on the upcoming records on a few threads, each with
+// its own clone of the filter, in batches of CompactionFilter::FilterBatch().
+// The records are returned in order, the decision on the current record is
+// taken by TakeDecision().
+//
+// A record is filtered ahead when it is the first one of its user key, a put,
+// and not visible to any snapshot, as CompactionIterator::
+// InvokeFilterIfNeeded() would filter it. So it's not used with a snapshot
+// checker. The records the CompactionIterator skips or merges may have been
+// filtered for nothing.
+class ParallelFilterIterator : public InternalIterator {
+ public:
+  // Reads `input` from its current position up to user key `end`, if not
+  // nullptr. The filters run on one thread each. `filter_all` if the
+  // snapshots are ignored, or else the records newer than `latest_snapshot`
+  // are filtered.
+  ParallelFilterIterator(
+      InternalIterator* input, SeparateHelper* separate_helper,
+      const Comparator* ucmp, const Slice* end,
+      std::vector<std::unique_ptr<CompactionFilter>>&& filters, int level,
+      bool filter_all, SequenceNumber latest_snapshot, Env* env);
+
+  ~ParallelFilterIterator() override;
+
+  bool Valid() const override { return pos_ < records_.size(); }
+  Slice key() const override;
+  // A copy of the value, it outlives the record
+  LazyBuffer value() const override;
+  Status status() const override;
+  void Next() override;
+  void Seek(const Slice& target) override;
+  void SeekToFirst() override;
+
+  // The input is only read forward
+  void SeekForPrev(const Slice& target) override;
+  void SeekToLast() override;
+  void Prev() override;
+
+  // Returns false if the current record was not filtered ahead, or its
+  // filtering has not started yet, the caller runs the filter then
+  bool TakeDecision(CompactionFilter::Decision* decision,
+                    LazyBuffer* new_value, std::string* skip_until,
+                    uint64_t* filter_nanos);
+
+ private:
+  struct Record {
+    std::string key;
+    std::string value;
+    uint64_t file_number = uint64_t(-1);
+    Status status;
+    // If to be filtered ahead, and if the filter is done or was dropped
+    bool filter = false;
+    bool done = true;
+    CompactionFilter::Decision decision = CompactionFilter::Decision::kKeep;
+    LazyBuffer new_value;
+    std::string skip_until;
+    uint64_t filter_nanos = 0;
+  };
+
+  void Worker(size_t index);
+  // Runs the filter on the records taken from the queue at once
+  void Filter(const CompactionFilter* filter,
+              const std::vector<Record*>& batch);
+  void ReadAhead();
+  // Waits for the filter of the first record or drops it, then the record
+  void PopFront();
+  void Clear();
+
+  InternalIterator* input_;
+  SeparateHelper* separate_helper_;
+  const Comparator* ucmp_;
+  const Slice* end_;
+  const std::vector<std::unique_ptr<CompactionFilter>> filters_;
+  const int level_;
+  const bool filter_all_;
+  const SequenceNumber latest_snapshot_;
+  Env* env_;
+  // The number of records read ahead of the current one
+  const size_t window_;
+
+  // Only the records the filters are run on are shared with the workers,
+  // through queue_
+  std::deque<Record> records_;
+  size_t pos_ = 0;
+  std::string last_user_key_;
+  bool has_last_user_key_ = false;
+  Status status_;
+
+  port::Mutex mutex_;
+  port::CondVar work_cv_;
+  port::CondVar done_cv_;
+  std::deque<Record*> queue_;
+  // The records being filtered
+  size_t running_ = 0;
+  bool stop_ = false;
+  std::vector<port::Thread> workers_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -701,6 +701,33 @@ TEST_F(PerfContextTest, MergeOperatorTime) {
   delete db;
 }
 
+TEST_F(PerfContextTest, BlobFetch) {
+  DestroyDB(kDbName, Options());
+  DB* db;
+  Options options;
+  options.create_if_missing = true;
+  options.blob_size = 16;
+  ASSERT_OK(DB::Open(options, kDbName, &db));
+
+  std::string value(4096, 'v');
+  ASSERT_OK(db->Put(WriteOptions(), "k1", value));
+  ASSERT_OK(db->Flush(FlushOptions()));
+  ASSERT_OK(db->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+
+  SetPerfLevel(kEnableTimeExceptForMutex);
+  get_perf_context()->Reset();
+  std::string val;
+  ASSERT_OK(db->Get(ReadOptions(), "k1", &val));
+  ASSERT_EQ(value, val);
+  ASSERT_GE(get_perf_context()->blob_fetch_count, 1);
+  ASSERT_GT(get_perf_context()->blob_fetch_nanos, 0);
+  ASSERT_NE(std::string::npos,
+            get_perf_context()->ToString(true).find("blob_fetch_count"));
+
+  SetPerfLevel(kDisable);
+  delete db;
+}
+
 TEST_F(PerfContextTest, PerfContextByLevelGetSet) {
   get_perf_context()->Reset();
   get_perf_context()->EnablePerLevelPerfContext();
@@ -35,6 +35,17 @@ void PeriodicWorkScheduler::Register(DBImpl* dbi,
             static_cast<uint64_t>(stats_persist_period_sec) * kMicrosInSecond,
         static_cast<uint64_t>(stats_persist_period_sec) * kMicrosInSecond);
   }
+  unsigned int hot_block_set_persist_period_sec =
+      dbi->immutable_db_options().hot_block_set_persist_period_sec;
+  if (hot_block_set_persist_period_sec > 0) {
+    timer->Add([dbi]() { dbi->PersistHotBlocks(); },
+               GetTaskName(dbi, "persist_hot_blocks"),
+               initial_delay.fetch_add(1) %
+                   static_cast<uint64_t>(hot_block_set_persist_period_sec) *
+                   kMicrosInSecond,
+               static_cast<uint64_t>(hot_block_set_persist_period_sec) *
+                   kMicrosInSecond);
+  }
   timer->Add([dbi]() { dbi->FlushInfoLog(); },
              GetTaskName(dbi, "flush_info_log"),
              initial_delay.fetch_add(1) % kDefaultFlushInfoLogPeriodSec *
@@ -45,6 +56,11 @@ void PeriodicWorkScheduler::Register(DBImpl* dbi,
              initial_delay.fetch_add(1) % kDefaultScheduleGCTTLPeriodSec *
                  kMicrosInSecond,
              kDefaultScheduleGCTTLPeriodSec * kMicrosInSecond);
+  timer->Add([dbi]() { dbi->ChargeSampledWrites(); },
+             GetTaskName(dbi, "charge_sampled_writes"),
+             initial_delay.fetch_add(1) % kDefaultChargeSampledWritesPeriodSec *
+                 kMicrosInSecond,
+             kDefaultChargeSampledWritesPeriodSec * kMicrosInSecond);
 #if defined(WITH_ZENFS)
   // timer->Add([dbi]() { dbi->ScheduleZNSGC(); },
   //            GetTaskName(dbi, "schedule_gc_zns"),
@@ -60,7 +76,12 @@ void PeriodicWorkScheduler::Register(DBImpl* dbi,
              GetTaskName(dbi, "schedule_zns_status_reporter"),
              initial_delay.fetch_add(1) % kDefaultScheduleZNSTTLPeriodSec *
                  kMicrosInSecond,
-             kDefaultScheduleZNSTTLPeriodSec * kMicrosInSecond);
+             kDefaultZNSStatusMaxPeriodSec * kMicrosInSecond);
+  timer->Add([dbi]() { dbi->MergeSampledKeyHotness(); },
+             GetTaskName(dbi, "merge_sampled_key_hotness"),
+             initial_delay.fetch_add(1) % kDefaultMergeKeyHotnessPeriodSec *
+                 kMicrosInSecond,
+             kDefaultMergeKeyHotnessPeriodSec * kMicrosInSecond);
 #endif
 }
 
@@ -68,18 +89,39 @@ void PeriodicWorkScheduler::Unregister(DBImpl* dbi) {
   MutexLock l(&timer_mu_);
   timer->Cancel(GetTaskName(dbi, "dump_st"));
   timer->Cancel(GetTaskName(dbi, "pst_st"));
+  timer->Cancel(GetTaskName(dbi, "persist_hot_blocks"));
   timer->Cancel(GetTaskName(dbi, "flush_info_log"));
   timer->Cancel(GetTaskName(dbi, "schedule_gc_ttl"));
+  timer->Cancel(GetTaskName(dbi, "charge_sampled_writes"));
 #ifdef WITH_ZENFS
   timer->Cancel(GetTaskName(dbi, "schedule_gc_zns"));
   timer->Cancel(GetTaskName(dbi, "schedule_metrics_background_report"));
   timer->Cancel(GetTaskName(dbi, "schedule_zns_status_reporter"));
+  timer->Cancel(GetTaskName(dbi, "merge_sampled_key_hotness"));
 #endif
   if (!timer->HasPendingTask()) {
     timer->Shutdown();
   }
 }
 
+void PeriodicWorkScheduler::Signal(DBImpl* dbi, PeriodicWorkSignal signal) {
+  // The timer mutex is never held while the work runs, unlike `timer_mu_`
+  switch (signal) {
+    case PeriodicWorkSignal::kTablesWritten:
+    case PeriodicWorkSignal::kTablesDeleted:
+#ifdef WITH_ZENFS
+      // Zones fill up and get freed by table files
+      timer->Trigger(GetTaskName(dbi, "schedule_zns_status_reporter"),
+                     kDefaultScheduleZNSTTLPeriodSec * kMicrosInSecond);
+#endif
+      break;
+    case PeriodicWorkSignal::kWriteStall:
+      timer->Trigger(GetTaskName(dbi, "dump_st"),
+                     kDefaultStallStatsDumpMinPeriodSec * kMicrosInSecond);
+      break;
+  }
+}
+
 PeriodicWorkScheduler* PeriodicWorkScheduler::Default() {
   // Always use the default Env for the scheduler, as we only use the NowMicros
   // which is the same for all env.
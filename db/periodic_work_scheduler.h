@@ -5,17 +5,32 @@
 
 #pragma once
 
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// Events the periodic work reacts to, see PeriodicWorkScheduler::Signal()
+enum class PeriodicWorkSignal {
+  // A flush, compaction or ingestion installed new table files
+  kTablesWritten,
+  // Obsolete table files were deleted
+  kTablesDeleted,
+  // A column family entered a write stall
+  kWriteStall,
+};
+
+}  // namespace TERARKDB_NAMESPACE
+
 #ifndef ROCKSDB_LITE
 
 #include "db/db_impl.h"
-#include "rocksdb/terark_namespace.h"
 #include "util/timer.h"
 
 namespace TERARKDB_NAMESPACE {
 
 // PeriodicWorkScheduler is a singleton object, which is scheduling/running
-// DumpStats(), PersistStats(), and FlushInfoLog() for all DB instances. All DB
-// instances use the same object from `Default()`.
+// DumpStats(), PersistStats(), PersistHotBlocks(), FlushInfoLog() and
+// ChargeSampledWrites() for all DB instances. All DB instances use the same object from `Default()`.
 //
 // Internally, it uses a single threaded timer object to run the periodic work
 // functions. Timer thread will always be started since the info log flushing
@@ -35,6 +50,13 @@ class PeriodicWorkScheduler {
 
   void Unregister(DBImpl* dbi);
 
+  // Run the work of `dbi` subscribed to `signal` early. Every task keeps a
+  // min interval between two runs however often it is signaled, and its
+  // period as the max interval when nothing happens, so idle DBs only wake
+  // up at the max intervals. Doesn't block on the running work, so it can be
+  // called with the DB mutex held.
+  void Signal(DBImpl* dbi, PeriodicWorkSignal signal);
+
   // Periodically flush info log out of application buffer at a low frequency.
   // This improves debuggability in case of RocksDB hanging since it ensures the
   // log messages leading up to the hang will eventually become visible in the
@@ -42,7 +64,14 @@ class PeriodicWorkScheduler {
   static const uint64_t kDefaultFlushInfoLogPeriodSec = 10;
   static const uint64_t kDefaultScheduleGCTTLPeriodSec = 10;
   static const uint64_t kDefaultScheduleZNSTTLPeriodSec = 1;
+  // The zone status is checked on table writes and deletions, at most every
+  // kDefaultScheduleZNSTTLPeriodSec, and at least every this period
+  static const uint64_t kDefaultZNSStatusMaxPeriodSec = 10;
+  // Min interval of the stats dumps triggered by write stalls
+  static const uint64_t kDefaultStallStatsDumpMinPeriodSec = 60;
   static const uint64_t kDefaultScheduleZNSMetricsPeriodSec = 30;
+  static const uint64_t kDefaultMergeKeyHotnessPeriodSec = 10;
+  static const uint64_t kDefaultChargeSampledWritesPeriodSec = 10;
 
  protected:
   std::unique_ptr<Timer> timer;
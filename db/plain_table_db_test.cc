@@ -1156,6 +1156,46 @@ TEST_P(PlainTableDBTest, AdaptiveTable) {
   ASSERT_NE("v5", Get("3000000000000bar"));
 }
 
+TEST_P(PlainTableDBTest, MmapLoad) {
+  Options options = CurrentOptions();
+  options.statistics = CreateDBStatistics();
+  PlainTableOptions plain_table_options;
+  plain_table_options.mmap_load.pretouch = true;
+  plain_table_options.mmap_load.transparent_huge_pages = true;
+  plain_table_options.mmap_load.numa_interleave = true;
+  options.table_factory.reset(NewPlainTableFactory(plain_table_options));
+  DestroyAndReopen(&options);
+
+  ASSERT_OK(Put("1000000000000foo", "v1"));
+  ASSERT_OK(Put("0000000000000bar", "v2"));
+  dbfull()->TEST_FlushMemTable();
+  Reopen(&options);
+  ASSERT_EQ("v1", Get("1000000000000foo"));
+  ASSERT_EQ("v2", Get("0000000000000bar"));
+  if (GetParam() /* mmap_mode */) {
+    // The pre-touch runs in the background
+    for (int i = 0; i < 1000 && options.statistics->getTickerCount(
+                                    TABLE_MMAP_PRETOUCH_BYTES) == 0;
+         ++i) {
+      Env::Default()->SleepForMicroseconds(10000);
+    }
+    ASSERT_GT(options.statistics->getTickerCount(TABLE_MMAP_PRETOUCH_BYTES),
+              0);
+  } else {
+    ASSERT_EQ(options.statistics->getTickerCount(TABLE_MMAP_PRETOUCH_BYTES),
+              0);
+  }
+
+  // Read from the huge page copy, or from the mapping if there are no huge
+  // pages reserved
+  plain_table_options.mmap_load.huge_page_size = 2 << 20;
+  options.table_factory.reset(NewPlainTableFactory(plain_table_options));
+  Reopen(&options);
+  ASSERT_EQ("v1", Get("1000000000000foo"));
+  ASSERT_EQ("v2", Get("0000000000000bar"));
+  ASSERT_EQ("NOT_FOUND", Get("2000000000000foo"));
+}
+
 INSTANTIATE_TEST_CASE_P(PlainTableDBTest, PlainTableDBTest, ::testing::Bool());
 
 }  // namespace TERARKDB_NAMESPACE
@@ -327,6 +327,18 @@ bool ReadRangeDelAggregator::ShouldDelete(const ParsedInternalKey& parsed,
   return rep_.ShouldDelete(parsed, mode);
 }
 
+bool ReadRangeDelAggregator::ShouldDeleteForward(
+    const ParsedInternalKey& parsed, ParsedInternalKey* tombstone_end,
+    SequenceNumber* tombstone_seq) {
+  if (!rep_.ShouldDelete(parsed, RangeDelPositioningMode::kForwardTraversal)) {
+    return false;
+  }
+  auto* tombstone = rep_.ForwardCoveringTombstone();
+  *tombstone_end = tombstone->end_key();
+  *tombstone_seq = tombstone->seq();
+  return true;
+}
+
 bool ReadRangeDelAggregator::IsRangeOverlapped(const Slice& start,
                                                const Slice& end) {
   InvalidateRangeDelMapPositions();
@@ -125,6 +125,13 @@ class ForwardRangeDelIterator {
   size_t UnusedIdx() const { return unused_idx_; }
   void IncUnusedIdx() { unused_idx_++; }
 
+  // The newest tombstone covering the key of the last ShouldDelete() call,
+  // REQUIRES: that call returned true
+  const TruncatedRangeDelIterator* CoveringTombstone() const {
+    assert(!active_seqnums_.empty());
+    return *active_seqnums_.begin();
+  }
+
  private:
   using ActiveSeqSet =
       std::multiset<TruncatedRangeDelIterator*, SeqMaxComparator>;
@@ -319,6 +326,12 @@ class RangeDelAggregator {
     bool ShouldDelete(const ParsedInternalKey& parsed,
                       RangeDelPositioningMode mode);
 
+    // REQUIRES: the last ShouldDelete() call was in kForwardTraversal mode
+    // and returned true
+    const TruncatedRangeDelIterator* ForwardCoveringTombstone() const {
+      return forward_iter_.CoveringTombstone();
+    }
+
     void Invalidate() {
       InvalidateForwardIter();
       InvalidateReverseIter();
@@ -366,6 +379,14 @@ class ReadRangeDelAggregator : public RangeDelAggregator {
   bool ShouldDelete(const ParsedInternalKey& parsed,
                     RangeDelPositioningMode mode) override;
 
+  // Like ShouldDelete() in kForwardTraversal mode. If parsed is deleted, also
+  // returns the end and the sequence number of the newest tombstone covering
+  // it: all keys in [parsed, *tombstone_end) older than *tombstone_seq are
+  // deleted as well.
+  bool ShouldDeleteForward(const ParsedInternalKey& parsed,
+                           ParsedInternalKey* tombstone_end,
+                           SequenceNumber* tombstone_seq);
+
   bool IsRangeOverlapped(const Slice& start, const Slice& end);
 
   void InvalidateRangeDelMapPositions() override { rep_.Invalidate(); }
@@ -0,0 +1,62 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/remote_compaction_scheduler.h"
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+bool RemoteCompactionScheduler::ShouldDispatch(int start_level,
+                                               uint64_t input_size,
+                                               uint64_t min_input_size,
+                                               uint64_t max_pending) {
+  bool dispatch = start_level > 0 && input_size >= min_input_size;
+  // Concurrent callers may overshoot max_pending by a few jobs, that is
+  // harmless for a soft limit
+  if (dispatch && Overloaded(max_pending)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.local_fallbacks;
+    dispatch = false;
+  }
+  return dispatch;
+}
+
+void RemoteCompactionScheduler::Start(uint64_t input_size) {
+  pending_jobs_.fetch_add(1, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.pending_bytes += input_size;
+}
+
+void RemoteCompactionScheduler::Finish(uint64_t input_size,
+                                       uint64_t elapsed_us, bool ok) {
+  pending_jobs_.fetch_sub(1, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.pending_bytes -= input_size;
+  if (!ok) {
+    ++stats_.failed_jobs;
+    return;
+  }
+  double bytes_per_sec =
+      elapsed_us > 0 ? input_size * 1e6 / elapsed_us : double(input_size);
+  if (stats_.finished_jobs == 0) {
+    stats_.avg_latency_us = double(elapsed_us);
+    stats_.avg_bytes_per_sec = bytes_per_sec;
+  } else {
+    stats_.avg_latency_us += kAlpha * (elapsed_us - stats_.avg_latency_us);
+    stats_.avg_bytes_per_sec +=
+        kAlpha * (bytes_per_sec - stats_.avg_bytes_per_sec);
+  }
+  ++stats_.finished_jobs;
+}
+
+RemoteCompactionScheduler::Stats RemoteCompactionScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.pending_jobs = pending_jobs_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,63 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// RemoteCompactionScheduler decides, per column family, whether a compaction
+// is handed to the CompactionDispatcher or run by a local thread, and keeps
+// track of the jobs in flight on the dispatcher.
+//
+// Small jobs and L0 jobs run locally, they block the write path and do not
+// amortize the cost of shipping the job. Once the dispatcher has `max_pending`
+// jobs in flight new jobs run locally as well and the column family reports
+// itself Overloaded(), which delays writes the same way pending compaction
+// bytes do, so a slow worker no longer inflates the backlog silently.
+class RemoteCompactionScheduler {
+ public:
+  struct Stats {
+    uint64_t pending_jobs = 0;
+    uint64_t pending_bytes = 0;
+    uint64_t finished_jobs = 0;
+    uint64_t failed_jobs = 0;
+    uint64_t local_fallbacks = 0;
+    // Exponentially weighted moving averages of finished remote jobs
+    double avg_latency_us = 0;
+    double avg_bytes_per_sec = 0;
+  };
+
+  // `min_input_size` and `max_pending` come from the mutable options of the
+  // column family, `max_pending` == 0 means unlimited.
+  bool ShouldDispatch(int start_level, uint64_t input_size,
+                      uint64_t min_input_size, uint64_t max_pending);
+
+  // Bracket a remote job
+  void Start(uint64_t input_size);
+  void Finish(uint64_t input_size, uint64_t elapsed_us, bool ok);
+
+  bool Overloaded(uint64_t max_pending) const {
+    return max_pending > 0 &&
+           pending_jobs_.load(std::memory_order_relaxed) >= max_pending;
+  }
+
+  Stats GetStats() const;
+
+ private:
+  // Weight of the newest sample in the moving averages
+  static constexpr double kAlpha = 0.2;
+
+  std::atomic<uint64_t> pending_jobs_{0};
+  mutable std::mutex mutex_;
+  Stats stats_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,78 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/remote_compaction_scheduler.h"
+
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class RemoteCompactionSchedulerTest : public testing::Test {};
+
+TEST_F(RemoteCompactionSchedulerTest, Placement) {
+  RemoteCompactionScheduler scheduler;
+  // L0 jobs stay local whatever their size
+  ASSERT_FALSE(scheduler.ShouldDispatch(0, 1 << 30, 0, 0));
+  ASSERT_TRUE(scheduler.ShouldDispatch(1, 1 << 30, 0, 0));
+  // Small jobs stay local
+  ASSERT_FALSE(scheduler.ShouldDispatch(5, 1 << 20, 64 << 20, 0));
+  ASSERT_TRUE(scheduler.ShouldDispatch(5, 64 << 20, 64 << 20, 0));
+  ASSERT_EQ(0, scheduler.GetStats().local_fallbacks);
+}
+
+TEST_F(RemoteCompactionSchedulerTest, Backpressure) {
+  RemoteCompactionScheduler scheduler;
+  const uint64_t kMaxPending = 2;
+  scheduler.Start(100);
+  ASSERT_FALSE(scheduler.Overloaded(kMaxPending));
+  ASSERT_TRUE(scheduler.ShouldDispatch(6, 100, 0, kMaxPending));
+  scheduler.Start(100);
+  ASSERT_TRUE(scheduler.Overloaded(kMaxPending));
+  // Unlimited
+  ASSERT_FALSE(scheduler.Overloaded(0));
+
+  // A full queue sends the job to a local thread
+  ASSERT_FALSE(scheduler.ShouldDispatch(6, 100, 0, kMaxPending));
+  auto stats = scheduler.GetStats();
+  ASSERT_EQ(2, stats.pending_jobs);
+  ASSERT_EQ(200, stats.pending_bytes);
+  ASSERT_EQ(1, stats.local_fallbacks);
+
+  scheduler.Finish(100, 1000, false);
+  ASSERT_FALSE(scheduler.Overloaded(kMaxPending));
+  stats = scheduler.GetStats();
+  ASSERT_EQ(1, stats.pending_jobs);
+  ASSERT_EQ(1, stats.failed_jobs);
+  ASSERT_EQ(0, stats.finished_jobs);
+}
+
+TEST_F(RemoteCompactionSchedulerTest, Latency) {
+  RemoteCompactionScheduler scheduler;
+  scheduler.Start(1 << 20);
+  scheduler.Finish(1 << 20, 1000000, true);
+  auto stats = scheduler.GetStats();
+  ASSERT_EQ(1, stats.finished_jobs);
+  ASSERT_EQ(0, stats.pending_bytes);
+  ASSERT_DOUBLE_EQ(1000000, stats.avg_latency_us);
+  ASSERT_DOUBLE_EQ(1 << 20, stats.avg_bytes_per_sec);
+
+  // A slow job moves the average towards it
+  scheduler.Start(1 << 20);
+  scheduler.Finish(1 << 20, 11000000, true);
+  stats = scheduler.GetStats();
+  ASSERT_GT(stats.avg_latency_us, 1000000);
+  ASSERT_LT(stats.avg_latency_us, 11000000);
+  ASSERT_LT(stats.avg_bytes_per_sec, 1 << 20);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
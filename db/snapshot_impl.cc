@@ -3,6 +3,10 @@
 //  COPYING file in the root directory) and Apache 2.0 License
 //  (found in the LICENSE.Apache file in the root directory).
 
+#include "db/snapshot_impl.h"
+
+#include <algorithm>
+
 #include "rocksdb/db.h"
 #include "rocksdb/snapshot.h"
 #include "rocksdb/terark_namespace.h"
@@ -23,4 +27,130 @@ ManagedSnapshot::~ManagedSnapshot() {
 
 const Snapshot* ManagedSnapshot::snapshot() { return snapshot_; }
 
+SnapshotList::Shard::Shard() : oldest(kMaxSequenceNumber) {
+  list.prev_ = &list;
+  list.next_ = &list;
+  list.number_ = 0xFFFFFFFFL;  // placeholder marker, for debugging
+  // Set all the variables to make UBSAN happy.
+  list.list_ = nullptr;
+  list.shard_ = 0;
+  list.unix_time_ = 0;
+  list.is_write_conflict_boundary_ = false;
+}
+
+SnapshotList::SnapshotList()
+    : count_(0),
+      version_(0),
+      cached_version_(0),
+      cached_oldest_write_conflict_(kMaxSequenceNumber) {}
+
+size_t SnapshotList::ShardOfThisThread() {
+  // The threads are spread over the shards as they first take a snapshot
+  static std::atomic<size_t> next_shard(0);
+  thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
+bool SnapshotList::Delete(const SnapshotImpl* s) {
+  assert(s->list_ == this);
+  Shard& shard = shards_[s->shard_];
+  bool was_oldest;
+  {
+    std::lock_guard<SpinMutex> l(shard.mutex);
+    was_oldest = s->prev_ == &shard.list;
+    s->prev_->next_ = s->next_;
+    s->next_->prev_ = s->prev_;
+    if (was_oldest) {
+      shard.oldest.store(shard.list.next_ == &shard.list
+                             ? kMaxSequenceNumber
+                             : shard.list.next_->number_,
+                         std::memory_order_relaxed);
+    }
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    version_.fetch_add(1, std::memory_order_release);
+  }
+  if (!was_oldest) {
+    return false;
+  }
+  for (size_t i = 0; i < kNumShards; ++i) {
+    if (i != s->shard_ &&
+        shards_[i].oldest.load(std::memory_order_relaxed) < s->number_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<SequenceNumber> SnapshotList::GetAll(
+    SequenceNumber* oldest_write_conflict_snapshot,
+    const SequenceNumber& max_seq) const {
+  std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+  if (cached_version_ != version_.load(std::memory_order_acquire)) {
+    // Lock all the shards for a consistent view of the snapshots
+    for (size_t i = 0; i < kNumShards; ++i) {
+      shards_[i].mutex.lock();
+    }
+    cached_version_ = version_.load(std::memory_order_relaxed);
+    cached_all_.clear();
+    cached_oldest_write_conflict_ = kMaxSequenceNumber;
+    for (size_t i = 0; i < kNumShards; ++i) {
+      const SnapshotImpl* list = &shards_[i].list;
+      for (const SnapshotImpl* s = list->next_; s != list; s = s->next_) {
+        cached_all_.push_back(s->number_);
+        if (s->is_write_conflict_boundary_ &&
+            s->number_ < cached_oldest_write_conflict_) {
+          cached_oldest_write_conflict_ = s->number_;
+        }
+      }
+    }
+    for (size_t i = 0; i < kNumShards; ++i) {
+      shards_[i].mutex.unlock();
+    }
+    std::sort(cached_all_.begin(), cached_all_.end());
+  }
+  if (oldest_write_conflict_snapshot != nullptr) {
+    *oldest_write_conflict_snapshot =
+        cached_oldest_write_conflict_ <= max_seq ? cached_oldest_write_conflict_
+                                                 : kMaxSequenceNumber;
+  }
+  return std::vector<SequenceNumber>(
+      cached_all_.begin(),
+      std::upper_bound(cached_all_.begin(), cached_all_.end(), max_seq));
+}
+
+SequenceNumber SnapshotList::GetOldest() const {
+  SequenceNumber oldest = kMaxSequenceNumber;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    oldest =
+        std::min(oldest, shards_[i].oldest.load(std::memory_order_relaxed));
+  }
+  return oldest;
+}
+
+SequenceNumber SnapshotList::GetNewest() const {
+  SequenceNumber newest = 0;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    std::lock_guard<SpinMutex> l(shards_[i].mutex);
+    if (shards_[i].list.prev_ != &shards_[i].list) {
+      newest = std::max(newest, shards_[i].list.prev_->number_);
+    }
+  }
+  return newest;
+}
+
+int64_t SnapshotList::GetOldestSnapshotTime() const {
+  SequenceNumber oldest = kMaxSequenceNumber;
+  int64_t unix_time = 0;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    std::lock_guard<SpinMutex> l(shards_[i].mutex);
+    const SnapshotImpl* s = shards_[i].list.next_;
+    if (s != &shards_[i].list && s->number_ < oldest) {
+      oldest = s->number_;
+      unix_time = s->unix_time_;
+    }
+  }
+  return unix_time;
+}
+
 }  // namespace TERARKDB_NAMESPACE
@@ -8,16 +8,20 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #pragma once
+#include <atomic>
+#include <mutex>
 #include <vector>
 
+#include "db/dbformat.h"
 #include "rocksdb/db.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
 
 namespace TERARKDB_NAMESPACE {
 
 class SnapshotList;
 
-// Snapshots are kept in a doubly-linked list in the DB.
+// Snapshots are kept in doubly-linked lists in the DB.
 // Each SnapshotImpl corresponds to a particular sequence number.
 class SnapshotImpl : public Snapshot {
  public:
@@ -27,6 +31,10 @@ class SnapshotImpl : public Snapshot {
   // scope of queries to IsInSnpashot.
   SequenceNumber min_uncommitted_ = 0;
 
+  // The holders of a snapshot shared by DB::GetStaleSnapshot(), the DB
+  // included while it hands it out. 0 for the snapshots of a single holder.
+  mutable std::atomic<uint32_t> shared_refs_{0};
+
   virtual SequenceNumber GetSequenceNumber() const override { return number_; }
 
  private:
@@ -37,6 +45,7 @@ class SnapshotImpl : public Snapshot {
   SnapshotImpl* next_;
 
   SnapshotList* list_;  // just for sanity checks
+  size_t shard_;
 
   int64_t unix_time_;
 
@@ -44,110 +53,95 @@ class SnapshotImpl : public Snapshot {
   bool is_write_conflict_boundary_;
 };
 
+// The snapshots of a DB, in shards of their own lock rather than under the
+// DB mutex, so that taking and releasing a snapshot is a short critical
+// section of one shard. Every shard keeps its snapshots in ascending order,
+// as their sequence numbers are read under the shard lock. The sorted
+// snapshot numbers of all shards that compactions and flushes ask for are
+// cached until the snapshots change.
 class SnapshotList {
  public:
-  SnapshotList() {
-    list_.prev_ = &list_;
-    list_.next_ = &list_;
-    list_.number_ = 0xFFFFFFFFL;  // placeholder marker, for debugging
-    // Set all the variables to make UBSAN happy.
-    list_.list_ = nullptr;
-    list_.unix_time_ = 0;
-    list_.is_write_conflict_boundary_ = false;
-    count_ = 0;
-  }
+  static const size_t kNumShards = 16;
+
+  SnapshotList();
 
   // No copy-construct.
   SnapshotList(const SnapshotList&) = delete;
 
-  bool empty() const { return list_.next_ == &list_; }
-  SnapshotImpl* oldest() const {
-    assert(!empty());
-    return list_.next_;
-  }
-  SnapshotImpl* newest() const {
-    assert(!empty());
-    return list_.prev_;
-  }
+  bool empty() const { return count() == 0; }
 
-  SnapshotImpl* New(SnapshotImpl* s, SequenceNumber seq, uint64_t unix_time,
+  // Register `s` at the sequence number `get_seq()` returns, read under the
+  // shard lock: a compaction that missed `s` picked its inputs before it.
+  template <typename GetSeq>
+  SnapshotImpl* New(SnapshotImpl* s, GetSeq&& get_seq, uint64_t unix_time,
                     bool is_write_conflict_boundary) {
-    s->number_ = seq;
+    size_t shard_index = ShardOfThisThread();
+    Shard& shard = shards_[shard_index];
+    std::lock_guard<SpinMutex> l(shard.mutex);
+    s->number_ = get_seq();
     s->unix_time_ = unix_time;
     s->is_write_conflict_boundary_ = is_write_conflict_boundary;
     s->list_ = this;
-    s->next_ = &list_;
-    s->prev_ = list_.prev_;
+    s->shard_ = shard_index;
+    s->next_ = &shard.list;
+    s->prev_ = shard.list.prev_;
     s->prev_->next_ = s;
     s->next_->prev_ = s;
-    count_++;
+    if (s->prev_ == &shard.list) {
+      shard.oldest.store(s->number_, std::memory_order_relaxed);
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+    version_.fetch_add(1, std::memory_order_release);
     return s;
   }
 
-  // Do not responsible to free the object.
-  void Delete(const SnapshotImpl* s) {
-    assert(s->list_ == this);
-    s->prev_->next_ = s->next_;
-    s->next_->prev_ = s->prev_;
-    count_--;
-  }
+  // Do not responsible to free the object. Returns whether `s` was the
+  // oldest snapshot, the oldest snapshot of the DB is then newer.
+  bool Delete(const SnapshotImpl* s);
 
   // retrieve all snapshot numbers up until max_seq. They are sorted in
   // ascending order.
   std::vector<SequenceNumber> GetAll(
       SequenceNumber* oldest_write_conflict_snapshot = nullptr,
-      const SequenceNumber& max_seq = kMaxSequenceNumber) const {
-    std::vector<SequenceNumber> ret;
-
-    if (oldest_write_conflict_snapshot != nullptr) {
-      *oldest_write_conflict_snapshot = kMaxSequenceNumber;
-    }
+      const SequenceNumber& max_seq = kMaxSequenceNumber) const;
 
-    if (empty()) {
-      return ret;
-    }
-    const SnapshotImpl* s = &list_;
-    while (s->next_ != &list_) {
-      if (s->next_->number_ > max_seq) {
-        break;
-      }
-      ret.push_back(s->next_->number_);
-
-      if (oldest_write_conflict_snapshot != nullptr &&
-          *oldest_write_conflict_snapshot == kMaxSequenceNumber &&
-          s->next_->is_write_conflict_boundary_) {
-        // If this is the first write-conflict boundary snapshot in the list,
-        // it is the oldest
-        *oldest_write_conflict_snapshot = s->next_->number_;
-      }
-
-      s = s->next_;
-    }
-    return ret;
-  }
+  // get the sequence number of the oldest snapshot, kMaxSequenceNumber if
+  // there is none
+  SequenceNumber GetOldest() const;
 
   // get the sequence number of the most recent snapshot
-  SequenceNumber GetNewest() {
-    if (empty()) {
-      return 0;
-    }
-    return newest()->number_;
-  }
+  SequenceNumber GetNewest() const;
 
-  int64_t GetOldestSnapshotTime() const {
-    if (empty()) {
-      return 0;
-    } else {
-      return oldest()->unix_time_;
-    }
-  }
+  int64_t GetOldestSnapshotTime() const;
 
-  uint64_t count() const { return count_; }
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
 
  private:
-  // Dummy head of doubly-linked list of snapshots
-  SnapshotImpl list_;
-  uint64_t count_;
+  struct Shard {
+    Shard();
+
+    mutable SpinMutex mutex;
+    // Dummy head of doubly-linked list of snapshots
+    SnapshotImpl list;
+    // The number of the first snapshot, kMaxSequenceNumber if none, for
+    // Delete() to tell the oldest snapshot without locking all shards
+    std::atomic<SequenceNumber> oldest;
+    // Keep the locks of the shards off the cache lines of each other
+    char padding[64];
+  };
+
+  static size_t ShardOfThisThread();
+
+  Shard shards_[kNumShards];
+  std::atomic<uint64_t> count_;
+  // Bumped under the shard lock by every change of the snapshots
+  std::atomic<uint64_t> version_;
+
+  // The numbers of all snapshots as of `cached_version_`
+  mutable std::mutex cache_mutex_;
+  mutable uint64_t cached_version_;
+  mutable std::vector<SequenceNumber> cached_all_;
+  mutable SequenceNumber cached_oldest_write_conflict_;
 };
 
 }  // namespace TERARKDB_NAMESPACE
@@ -9,9 +9,12 @@
 
 #include "db/table_cache.h"
 
+#include <algorithm>
+
 #include "db/dbformat.h"
 #include "db/range_tombstone_fragmenter.h"
 #include "db/version_edit.h"
+#include "monitoring/file_read_sample.h"
 #include "monitoring/perf_context_imp.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/terark_namespace.h"
@@ -142,10 +145,41 @@ TableCache::TableCache(const ImmutableCFOptions& ioptions,
     : ioptions_(ioptions),
       env_options_(env_options),
       cache_(cache),
-      immortal_tables_(false) {}
+      immortal_tables_(false) {
+  // As many stripes as the table cache has shards, but enough ones to let
+  // max_file_opening_threads open different files concurrently
+  int bits = std::min(std::max(ioptions.table_cache_numshardbits,
+                               kMinLoaderMutexBits),
+                      kMaxLoaderMutexBits);
+  loader_mutex_.reset(new port::Mutex[size_t(1) << bits]);
+  loader_mutex_mask_ = (uint64_t(1) << bits) - 1;
+  if (ioptions_.row_cache) {
+    PutVarint64(&row_cache_id_, ioptions_.row_cache->NewId());
+  }
+  if (ioptions_.blob_cache) {
+    PutVarint64(&blob_cache_id_, ioptions_.blob_cache->NewId());
+  }
+}
 
 TableCache::~TableCache() {}
 
+size_t TableCache::TableCharge(const TableReader& table_reader) const {
+  if (ioptions_.table_cache_memory_budget == 0) {
+    return 1;
+  }
+  return std::max<size_t>(1, table_reader.ApproximateMemoryUsage());
+}
+
+void TableCache::SetColdFiles(std::unordered_set<uint64_t>&& cold_files) {
+  MutexLock l(&cold_files_mutex_);
+  cold_files_.swap(cold_files);
+}
+
+bool TableCache::IsColdFile(uint64_t file_number) const {
+  MutexLock l(&cold_files_mutex_);
+  return cold_files_.count(file_number) > 0;
+}
+
 TableReader* TableCache::GetTableReaderFromHandle(Cache::Handle* handle) {
   return reinterpret_cast<TableReader*>(cache_->Value(handle));
 }
@@ -213,13 +247,17 @@ Status TableCache::GetTableReaderImpl(
             record_read_stats ? ioptions_.statistics : nullptr, SST_READ_MICROS,
             file_read_hist, ioptions_.rate_limiter, for_compaction,
             ioptions_.listeners));
+    // Only map ssts are forced into memory
+    file_reader->set_io_file_kind(IOFileKindOfTable(level, force_memory));
+    file_reader->set_resource_group(ioptions_.resource_group.get());
+    TableReaderOptions table_reader_options(
+        ioptions_, prefix_extractor, env_options,
+        ioptions_.internal_comparator, skip_filters, immortal_tables_, level,
+        fd.GetNumber(), fd.largest_seqno);
+    table_reader_options.cold = IsColdFile(fd.GetNumber());
     s = ioptions_.table_factory->NewTableReader(
-        TableReaderOptions(ioptions_, prefix_extractor, env_options,
-                           ioptions_.internal_comparator, skip_filters,
-                           immortal_tables_, level, fd.GetNumber(),
-                           fd.largest_seqno),
-        std::move(file_reader), fd.GetFileSize(), table_reader,
-        prefetch_index_and_filter_in_cache);
+        table_reader_options, std::move(file_reader), fd.GetFileSize(),
+        table_reader, prefetch_index_and_filter_in_cache);
     TEST_SYNC_POINT("TableCache::GetTableReader:0");
   }
   return s;
@@ -251,6 +289,13 @@ Status TableCache::FindTable(const EnvOptions& env_options,
     if (no_io) {  // Don't do IO and return a not-found status
       return Status::Incomplete("Table not found in table_cache, no_io is set");
     }
+    // Concurrent misses of the same table wait for the first one to open it
+    // instead of opening it once more each
+    MutexLock load_lock(&loader_mutex_[number & loader_mutex_mask_]);
+    *handle = cache_->Lookup(key);
+    if (*handle != nullptr) {
+      return s;
+    }
     std::unique_ptr<TableReader> table_reader;
     s = GetTableReader(env_options, fd, false /* sequential mode */,
                        0 /* readahead */, record_read_stats, file_read_hist,
@@ -263,8 +308,8 @@ Status TableCache::FindTable(const EnvOptions& env_options,
       // We do not cache error results so that if the error is transient,
       // or somebody repairs the file, we recover automatically.
     } else {
-      s = cache_->Insert(key, table_reader.get(), 1, &DeleteEntry<TableReader>,
-                         handle);
+      s = cache_->Insert(key, table_reader.get(), TableCharge(*table_reader),
+                         &DeleteEntry<TableReader>, handle);
       if (s.ok()) {
         table_reader->SetTableCacheHandle(cache_, *handle);
         // Release ownership of table reader.
@@ -275,6 +320,31 @@ Status TableCache::FindTable(const EnvOptions& env_options,
   return s;
 }
 
+Status TableCache::FindTableReader(
+    const EnvOptions& env_options, const FileMetaData& file_meta,
+    Cache::Handle** handle, TableReader** table_reader,
+    const SliceTransform* prefix_extractor, bool no_io, bool record_read_stats,
+    HistogramImpl* file_read_hist, bool skip_filters, int level) {
+  auto& pinned = file_meta.pinned_table_reader;
+  Cache::Handle* pinned_handle = pinned.handle.load(std::memory_order_acquire);
+  if (pinned_handle != nullptr) {
+    *table_reader = GetTableReaderFromHandle(pinned_handle);
+    return Status::OK();
+  }
+  Status s = FindTable(env_options, file_meta.fd, handle, prefix_extractor,
+                       no_io, record_read_stats, file_read_hist, skip_filters,
+                       level, true /* prefetch_index_and_filter_in_cache */,
+                       file_meta.prop.is_map_sst());
+  if (s.ok()) {
+    *table_reader = GetTableReaderFromHandle(*handle);
+    if (ioptions_.pin_table_reader_on_first_access &&
+        pinned.Pin(cache_, *handle)) {
+      *handle = nullptr;
+    }
+  }
+  return s;
+}
+
 InternalIterator* TableCache::NewIterator(
     const ReadOptions& options, const EnvOptions& env_options,
     const FileMetaData& file_meta, const DependenceMap& dependence_map,
@@ -328,14 +398,10 @@ InternalIterator* TableCache::NewIterator(
   } else {
     table_reader = fd.table_reader;
     if (table_reader == nullptr) {
-      s = FindTable(env_options, fd, &handle, prefix_extractor,
-                    options.read_tier == kBlockCacheTier /* no_io */,
-                    record_stats, file_read_hist, skip_filters, level,
-                    true /* prefetch_index_and_filter_in_cache */,
-                    file_meta.prop.is_map_sst());
-      if (s.ok()) {
-        table_reader = GetTableReaderFromHandle(handle);
-      }
+      s = FindTableReader(env_options, file_meta, &handle, &table_reader,
+                          prefix_extractor,
+                          options.read_tier == kBlockCacheTier /* no_io */,
+                          record_stats, file_read_hist, skip_filters, level);
     }
   }
   InternalIterator* result = nullptr;
@@ -433,6 +499,73 @@ InternalIterator* TableCache::NewIterator(
   return result;
 }
 
+#ifndef ROCKSDB_LITE
+Cache* TableCache::RowCacheOf(const GetContext* get_context) const {
+  // The separated values have the blob cache of their own
+  if (!get_context->CanUseRowCache() || get_context->is_blob_fetch()) {
+    return nullptr;
+  }
+  return ioptions_.row_cache.get();
+}
+
+bool TableCache::GetFromRowCache(Cache* row_cache, const Slice& row_cache_key,
+                                 const Slice& user_key,
+                                 GetContext* get_context) {
+  Cache::Handle* row_handle = row_cache->Lookup(row_cache_key);
+  if (row_handle == nullptr) {
+    RecordTick(ioptions_.statistics, ROW_CACHE_MISS);
+    return false;
+  }
+  RecordTick(ioptions_.statistics, ROW_CACHE_HIT);
+  auto* row_cache_entry =
+      reinterpret_cast<const std::string*>(row_cache->Value(row_handle));
+  ReplayGetContextLog(*row_cache_entry, user_key, get_context, row_cache,
+                      row_handle);
+  row_cache->Release(row_handle);
+  return true;
+}
+#endif  // ROCKSDB_LITE
+
+bool TableCache::LookupBlobCache(uint64_t file_number, SequenceNumber sequence,
+                                 const Slice& user_key, LazyBuffer* value,
+                                 std::string* cache_key, bool* admit) {
+  Cache* blob_cache = ioptions_.blob_cache.get();
+  assert(blob_cache != nullptr);
+  *cache_key = blob_cache_id_;
+  PutVarint64(cache_key, file_number);
+  PutVarint64(cache_key, sequence);
+  cache_key->append(user_key.data(), user_key.size());
+  Cache::Handle* blob_handle = blob_cache->Lookup(*cache_key);
+  if (blob_handle != nullptr) {
+    auto* cached =
+        reinterpret_cast<const std::string*>(blob_cache->Value(blob_handle));
+    if (cached != nullptr) {
+      RecordTick(ioptions_.statistics, BLOB_CACHE_HIT);
+      value->reset(*cached, Cleanable(&UnrefEntry, blob_cache, blob_handle),
+                   file_number);
+      return true;
+    }
+    // Only the key is cached, the value was fetched once before
+    blob_cache->Release(blob_handle);
+    *admit = true;
+  } else if (ioptions_.blob_cache_admit_on_second_access) {
+    blob_cache->Insert(*cache_key, nullptr, cache_key->size(),
+                       [](const Slice& /*key*/, void* /*value*/) {});
+    *admit = false;
+  } else {
+    *admit = true;
+  }
+  RecordTick(ioptions_.statistics, BLOB_CACHE_MISS);
+  return false;
+}
+
+void TableCache::InsertBlobCache(const Slice& cache_key, const Slice& value) {
+  Cache* blob_cache = ioptions_.blob_cache.get();
+  size_t charge = cache_key.size() + value.size() + sizeof(std::string);
+  blob_cache->Insert(cache_key, new std::string(value.data(), value.size()),
+                     charge, &DeleteEntry<std::string>);
+}
+
 // @k is the internal key
 Status TableCache::Get(const ReadOptions& options,
                        const FileMetaData& file_meta,
@@ -462,18 +595,39 @@ Status TableCache::Get(const ReadOptions& options,
   TableReader* t = fd.table_reader;
   Cache::Handle* handle = nullptr;
   if (t == nullptr) {
-    s = FindTable(env_options_, fd, &handle, prefix_extractor,
-                  options.read_tier == kBlockCacheTier /* no_io */,
-                  true /* record_read_stats */, file_read_hist, skip_filters,
-                  level, true /* prefetch_index_and_filter_in_cache */,
-                  file_meta.prop.is_map_sst());
-    if (s.ok()) {
-      t = GetTableReaderFromHandle(handle);
-    }
+    s = FindTableReader(env_options_, file_meta, &handle, &t, prefix_extractor,
+                        options.read_tier == kBlockCacheTier /* no_io */,
+                        true /* record_read_stats */, file_read_hist,
+                        skip_filters, level);
   }
   if (s.ok()) {
     t->UpdateMaxCoveringTombstoneSeq(options, ExtractUserKey(k),
                                      get_context->max_covering_tombstone_seq());
+#ifndef ROCKSDB_LITE
+    // The files are immutable, so all that decides what a lookup finds in one
+    // is the key and which of its sequence numbers are visible, all of them
+    // unless the snapshot is older than the file. The lookups of GC would
+    // only churn the cache
+    Cache* row_cache =
+        inheritance == nullptr ? RowCacheOf(get_context) : nullptr;
+    std::string row_cache_key;
+    std::string row_cache_entry;
+    if (row_cache != nullptr) {
+      SequenceNumber seq = GetInternalKeySeqno(k);
+      row_cache_key = row_cache_id_;
+      PutVarint64(&row_cache_key, fd.GetNumber());
+      PutVarint64(&row_cache_key, seq >= fd.largest_seqno ? 0 : seq + 1);
+      Slice user_key = ExtractUserKey(k);
+      row_cache_key.append(user_key.data(), user_key.size());
+      if (GetFromRowCache(row_cache, row_cache_key, user_key, get_context)) {
+        if (handle != nullptr) {
+          ReleaseHandle(handle);
+        }
+        return s;
+      }
+      get_context->SetReplayLog(&row_cache_entry);
+    }
+#endif  // ROCKSDB_LITE
     if (!file_meta.prop.is_map_sst()) {
       s = t->Get(options, k, get_context, prefix_extractor, skip_filters);
     } else if (dependence_map.empty()) {
@@ -481,6 +635,7 @@ Status TableCache::Get(const ReadOptions& options,
           "TableCache::Get: Composite sst depend files missing");
     } else {
       // Forward query to target sst
+      PERF_COUNTER_ADD(map_sst_get_count, 1);
       ReadOptions forward_options = options;
       forward_options.ignore_range_deletions |=
           file_meta.prop.map_handle_range_deletions();
@@ -568,6 +723,12 @@ Status TableCache::Get(const ReadOptions& options,
             return false;
           }
           assert(find->second->fd.GetNumber() == file_number);
+          if (get_context->sample()) {
+            // Count the read on the linked sst, lazy compaction uses it to
+            // weight the read amplification of this map range
+            sample_file_read_inc(find->second);
+          }
+          PERF_COUNTER_ADD(map_sst_hop_count, 1);
           s = Get(forward_options, *find->second, dependence_map, find_k,
                   get_context, prefix_extractor, file_read_hist, skip_filters,
                   level, inheritance);
@@ -584,6 +745,20 @@ Status TableCache::Get(const ReadOptions& options,
       t->RangeScan(&k, prefix_extractor, &get_from_map,
                    c_style_callback(get_from_map));
     }
+#ifndef ROCKSDB_LITE
+    if (row_cache != nullptr) {
+      // Without io the lookup may have stopped short of the blocks not cached
+      if (s.ok() && get_context->has_replay_log() && options.fill_cache &&
+          options.read_tier != kBlockCacheTier) {
+        size_t charge =
+            row_cache_key.size() + row_cache_entry.size() + sizeof(std::string);
+        void* row_ptr = new std::string(std::move(row_cache_entry));
+        row_cache->Insert(row_cache_key, row_ptr, charge,
+                          &DeleteEntry<std::string>);
+      }
+      get_context->SetReplayLog(nullptr);
+    }
+#endif  // ROCKSDB_LITE
   } else if (options.read_tier == kBlockCacheTier && s.IsIncomplete()) {
     // Couldn't find Table in cache but treat as kFound if no_io set
     get_context->MarkKeyMayExist();
@@ -647,6 +822,35 @@ size_t TableCache::GetMemoryUsageByTableReader(
   return ret;
 }
 
+void TableCache::PrefetchAsync(const EnvOptions& env_options,
+                               const FileMetaData& file_meta,
+                               const SliceTransform* prefix_extractor,
+                               size_t n) {
+  if (file_meta.prop.is_map_sst()) {
+    return;
+  }
+  auto table_reader = file_meta.fd.table_reader;
+  if (table_reader) {
+    table_reader->PrefetchAsync(n);
+    return;
+  }
+
+  // Opening the table would be synchronous I/O, skip it if not cached
+  Cache::Handle* table_handle = nullptr;
+  Status s = FindTableReader(env_options, file_meta, &table_handle,
+                             &table_reader, prefix_extractor, true /* no_io */,
+                             false /* record_read_stats */,
+                             nullptr /* file_read_hist */,
+                             false /* skip_filters */, -1 /* level */);
+  if (!s.ok()) {
+    return;
+  }
+  table_reader->PrefetchAsync(n);
+  if (table_handle != nullptr) {
+    ReleaseHandle(table_handle);
+  }
+}
+
 void TableCache::Evict(Cache* cache, uint64_t file_number) {
   cache->Erase(GetSliceForFileNumber(&file_number));
 }
@@ -12,7 +12,9 @@
 #pragma once
 #include <stdint.h>
 
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "db/dbformat.h"
@@ -26,6 +28,7 @@
 #include "rocksdb/terark_namespace.h"
 #include "table/table_reader.h"
 #include "util/iterator_cache.h"
+#include "util/mutexlock.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -76,6 +79,16 @@ class TableCache {
              HistogramImpl* file_read_hist = nullptr, bool skip_filters = false,
              int level = -1, const FileMetaData* inheritance = nullptr);
 
+  // Look the separated value of user_key at sequence in the blob file up in
+  // ColumnFamilyOptions::blob_cache. Return true with the value referring to
+  // the cache entry if found. Otherwise set cache_key, and *admit to whether
+  // to insert the value with InsertBlobCache() once it is fetched.
+  // REQUIRES: ioptions.blob_cache != nullptr
+  bool LookupBlobCache(uint64_t file_number, SequenceNumber sequence,
+                       const Slice& user_key, LazyBuffer* value,
+                       std::string* cache_key, bool* admit);
+  void InsertBlobCache(const Slice& cache_key, const Slice& value);
+
   // Evict any entry for the specified file number
   static void Evict(Cache* cache, uint64_t file_number);
 
@@ -116,6 +129,12 @@ class TableCache {
       const EnvOptions& toptions, const FileDescriptor& fd,
       const SliceTransform* prefix_extractor = nullptr);
 
+  // Start reading the first `n` bytes of data of the file in background, if
+  // its table reader is already open. Map SSTs are skipped.
+  void PrefetchAsync(const EnvOptions& env_options,
+                     const FileMetaData& file_meta,
+                     const SliceTransform* prefix_extractor, size_t n);
+
   // Release the handle from a cache
   void ReleaseHandle(Cache::Handle* handle);
 
@@ -131,6 +150,12 @@ class TableCache {
     }
   }
 
+  // Replace the table files reported cold to the table readers opened from
+  // now on, see prefetch_index_and_filter_hot_file_ratio
+  void SetColdFiles(std::unordered_set<uint64_t>&& cold_files);
+
+  bool IsColdFile(uint64_t file_number) const;
+
   void TEST_AddMockTableReader(TableReader* table_reader, FileDescriptor fd);
 
  private:
@@ -153,10 +178,45 @@ class TableCache {
                             bool prefetch_index_and_filter_in_cache,
                             bool for_compaction, bool force_memory);
 
+  // The charge of a table reader in the cache, its memory usage under
+  // table_cache_memory_budget and otherwise one per file
+  size_t TableCharge(const TableReader& table_reader) const;
+
+  // Find the table reader of a file without a preloaded one, through its
+  // pinned reader if any. *handle is left null if there is nothing to release
+  Status FindTableReader(const EnvOptions& env_options,
+                         const FileMetaData& file_meta, Cache::Handle** handle,
+                         TableReader** table_reader,
+                         const SliceTransform* prefix_extractor, bool no_io,
+                         bool record_read_stats, HistogramImpl* file_read_hist,
+                         bool skip_filters, int level);
+
+#ifndef ROCKSDB_LITE
+  // The row cache of the lookups of get_context, nullptr if none
+  Cache* RowCacheOf(const GetContext* get_context) const;
+
+  // Replay the row cache entry of row_cache_key into get_context, return
+  // false if there is none
+  bool GetFromRowCache(Cache* row_cache, const Slice& row_cache_key,
+                       const Slice& user_key, GetContext* get_context);
+#endif  // ROCKSDB_LITE
+
+  static const int kMinLoaderMutexBits = 7;
+  static const int kMaxLoaderMutexBits = 12;
+
   const ImmutableCFOptions& ioptions_;
   const EnvOptions& env_options_;
   Cache* const cache_;
   bool immortal_tables_;
+  // Prefixes of the row and blob cache keys, for the caches shared by table
+  // caches
+  std::string row_cache_id_;
+  std::string blob_cache_id_;
+  // Stripes of FindTable() misses by file number
+  std::unique_ptr<port::Mutex[]> loader_mutex_;
+  uint64_t loader_mutex_mask_;
+  mutable port::Mutex cold_files_mutex_;
+  std::unordered_set<uint64_t> cold_files_;
 };
 
 }  // namespace TERARKDB_NAMESPACE
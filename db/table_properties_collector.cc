@@ -76,6 +76,8 @@ class TtlIntTblPropCollector : public IntTblPropCollector {
   uint64_t ttl_entries_ = 0;
 
   uint64_t min_scan_cap_ttl_ = port::kMaxUint64;
+  // Deletions expire at once, entries without ttl never
+  uint64_t latest_time_expire_ = 0;
 
   void AddTtlToSliceWindow(uint64_t ttl) {
     if (ttl_max_scan_cap_ > 0) {
@@ -144,6 +146,10 @@ class TtlIntTblPropCollector : public IntTblPropCollector {
       PushItem(properties, TablePropertiesNames::kLatestTimeEndCompact,
                min_scan_cap_ttl_);
     }
+    if (total_entries_ > 0 && latest_time_expire_ < port::kMaxUint64) {
+      PushItem(properties, TablePropertiesNames::kLatestTimeExpire,
+               latest_time_expire_);
+    }
     return Status::OK();
   }
 
@@ -176,7 +182,9 @@ class TtlIntTblPropCollector : public IntTblPropCollector {
         uint64_t ttl_duration = std::max(ttl_time_point, now_) - now_;
         histogram_.Add(ttl_duration);
         AddTtlToSliceWindow(ttl_time_point);
+        latest_time_expire_ = std::max(latest_time_expire_, ttl_time_point);
       } else {
+        latest_time_expire_ = port::kMaxUint64;
         ttl_slice_window_.clear();
         slice_window_ttl_index_.clear();
         slice_index_ = 0;
@@ -184,6 +192,8 @@ class TtlIntTblPropCollector : public IntTblPropCollector {
     } else if (entry_type < kEntryOther) {
       // Delete Key is always not found for scan operation.
       AddTtlToSliceWindow(0ul);
+    } else {
+      latest_time_expire_ = port::kMaxUint64;
     }
     return Status::OK();
   }
@@ -271,6 +281,13 @@ void GetCompactionTimePoint(const UserCollectedProperties& props,
   }
 }
 
+uint64_t GetLatestTimeExpire(const UserCollectedProperties& props) {
+  bool property_present;
+  uint64_t latest_time_expire = GetUint64Property(
+      props, TablePropertiesNames::kLatestTimeExpire, &property_present);
+  return property_present ? latest_time_expire : port::kMaxUint64;
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 TERARK_FACTORY_INSTANTIATE_GNS(
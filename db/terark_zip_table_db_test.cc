@@ -10,6 +10,7 @@
 #include "db/db_impl.h"
 #include "rocksdb/db.h"
 #include "rocksdb/env.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/meta_blocks.h"
 #include "util/string_util.h"
@@ -186,6 +187,148 @@ TEST_F(TerarkZipTableDBTest, Flush) {
   ASSERT_EQ("NOT_FOUND", Get("key6"));
 }
 
+TEST_F(TerarkZipTableDBTest, UpperLevelIndexType) {
+  Options options = CurrentOptions();
+  TerarkZipTableOptions opt;
+  opt.localTempDir = dbname_;
+  opt.upperLevelMax = 0;
+  opt.upperLevelIndexType = "IL_256";
+  opt.upperLevelSampleRatio = 0.5;
+  std::shared_ptr<TableFactory> block_based_factory(
+      NewBlockBasedTableFactory());
+  std::shared_ptr<TableFactory> adaptive_table_factory(
+      NewAdaptiveTableFactory(block_based_factory));
+  options.table_factory.reset(
+      NewTerarkZipTableFactory(opt, adaptive_table_factory));
+  Destroy(&options);
+  Reopen(&options);
+
+  auto check_index_type = [&](const std::string& index_type) {
+    TablePropertiesCollection ptc;
+    ASSERT_OK(db_->GetPropertiesOfAllTables(&ptc));
+    ASSERT_EQ(1U, ptc.size());
+    auto& props = ptc.begin()->second->user_collected_properties;
+    ASSERT_EQ(index_type, props.at("terark.build.index_type"));
+  };
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_OK(Put("key" + ToString(i), "value" + ToString(i)));
+  }
+  dbfull()->TEST_FlushMemTable();
+  ASSERT_EQ("1", FilesPerLevel());
+  check_index_type("IL_256");
+
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ("0,1", FilesPerLevel());
+  check_index_type(opt.indexType);
+  ASSERT_EQ("value42", Get("key42"));
+}
+
+TEST_F(TerarkZipTableDBTest, WarmUpIndexInBackground) {
+  Options options = CurrentOptions();
+  options.rate_limiter.reset(NewGenericRateLimiter(
+      1 << 20, 100 * 1000, 10, RateLimiter::Mode::kReadsOnly));
+  TerarkZipTableOptions opt;
+  opt.localTempDir = dbname_;
+  opt.warmUpIndexOnOpen = true;
+  opt.warmUpIndexInBackground = true;
+  std::shared_ptr<TableFactory> block_based_factory(
+      NewBlockBasedTableFactory());
+  std::shared_ptr<TableFactory> adaptive_table_factory(
+      NewAdaptiveTableFactory(block_based_factory));
+  options.table_factory.reset(
+      NewTerarkZipTableFactory(opt, adaptive_table_factory));
+  Destroy(&options);
+  Reopen(&options);
+
+  // The readers of the flushed files are served before their warm-up, and
+  // the compaction drops the warm-up of its inputs
+  for (int file = 0; file < 3; ++file) {
+    for (int i = 0; i < 1000; ++i) {
+      ASSERT_OK(Put("key" + ToString(i), "value" + ToString(file * i)));
+    }
+    dbfull()->TEST_FlushMemTable();
+    ASSERT_EQ("value" + ToString(file * 42), Get("key42"));
+  }
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ("0,1", FilesPerLevel());
+  ASSERT_EQ("value84", Get("key42"));
+
+  Reopen(&options);
+  ASSERT_EQ("value84", Get("key42"));
+  ASSERT_EQ("value1998", Get("key999"));
+}
+
+TEST_F(TerarkZipTableDBTest, DictReuse) {
+  Options options = CurrentOptions();
+  TerarkZipTableOptions opt;
+  opt.localTempDir = dbname_;
+  opt.dictReuseCacheBytes = 64 << 20;
+  opt.sampleRatio = 0.5;
+  std::shared_ptr<TableFactory> block_based_factory(
+      NewBlockBasedTableFactory());
+  std::shared_ptr<TableFactory> adaptive_table_factory(
+      NewAdaptiveTableFactory(block_based_factory));
+  options.table_factory.reset(
+      NewTerarkZipTableFactory(opt, adaptive_table_factory));
+  Destroy(&options);
+  Reopen(&options);
+
+  // Alike values in both tables, the second one reuses the first dict
+  Random rnd(301);
+  std::string base;
+  test::RandomString(&rnd, 200, &base);
+  for (int t = 0; t < 2; ++t) {
+    for (int i = 0; i < 2000; ++i) {
+      std::string key = "key" + ToString(t * 10000 + i);
+      ASSERT_OK(Put(key, base + ToString(i)));
+    }
+    dbfull()->TEST_FlushMemTable();
+  }
+  ASSERT_EQ("2", FilesPerLevel());
+  for (int t = 0; t < 2; ++t) {
+    for (int i = 0; i < 2000; i += 97) {
+      std::string key = "key" + ToString(t * 10000 + i);
+      ASSERT_EQ(base + ToString(i), Get(key));
+    }
+  }
+}
+
+TEST_F(TerarkZipTableDBTest, PreadScanWithAsyncPrefetch) {
+  Options options = CurrentOptions();
+  TerarkZipTableOptions opt;
+  opt.localTempDir = dbname_;
+  opt.minPreadLen = 0;  // always pread the value store
+  std::shared_ptr<TableFactory> block_based_factory(
+      NewBlockBasedTableFactory());
+  std::shared_ptr<TableFactory> adaptive_table_factory(
+      NewAdaptiveTableFactory(block_based_factory));
+  options.table_factory.reset(
+      NewTerarkZipTableFactory(opt, adaptive_table_factory));
+  Destroy(&options);
+  Reopen(&options);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.emplace_back();
+    test::RandomString(&rnd, 300, &values.back());
+    ASSERT_OK(Put("key" + ToString(10000 + i), values.back()));
+  }
+  dbfull()->TEST_FlushMemTable();
+
+  ReadOptions ro;
+  ro.async_prefetch_size = 16 << 10;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ro));
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+    ASSERT_EQ("key" + ToString(10000 + i), iter->key().ToString());
+    ASSERT_EQ(values[i], iter->value().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(1000, i);
+}
+
 TEST_F(TerarkZipTableDBTest, Iteratorseekfirstandlast) {
   Options options = CurrentOptions();
   Destroy(&options);
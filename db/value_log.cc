@@ -0,0 +1,223 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/value_log.h"
+
+#include <string.h>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/file_reader_writer.h"
+#include "util/filename.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+Status OpenReader(Env* env, const EnvOptions& env_options,
+                  const std::string& fname,
+                  std::unique_ptr<RandomAccessFileReader>* reader) {
+  // A mapping would not see the values appended after it
+  EnvOptions read_options(env_options);
+  read_options.use_mmap_reads = false;
+  std::unique_ptr<RandomAccessFile> file;
+  Status s = env->NewRandomAccessFile(fname, &file, read_options);
+  if (s.ok()) {
+    reader->reset(new RandomAccessFileReader(std::move(file), fname, env));
+  }
+  return s;
+}
+
+}  // namespace
+
+Status ValueLog::Create(Env* env, const EnvOptions& env_options,
+                        const std::string& dir, uint64_t number,
+                        std::shared_ptr<ValueLog>* result) {
+  std::string fname = ValueLogFileName(dir, number);
+  std::unique_ptr<WritableFile> file;
+  Status s = NewWritableFile(env, fname, &file, env_options);
+  if (!s.ok()) {
+    return s;
+  }
+  std::unique_ptr<WritableFileWriter> writer(
+      new WritableFileWriter(std::move(file), fname, env_options));
+  std::unique_ptr<RandomAccessFileReader> reader;
+  s = OpenReader(env, env_options, fname, &reader);
+  if (s.ok()) {
+    result->reset(new ValueLog(env, std::move(fname), number, std::move(writer),
+                               std::move(reader), 0));
+  }
+  return s;
+}
+
+Status ValueLog::Open(Env* env, const EnvOptions& env_options,
+                      const std::string& dir, uint64_t number,
+                      std::shared_ptr<ValueLog>* result) {
+  std::string fname = ValueLogFileName(dir, number);
+  uint64_t size;
+  Status s = env->GetFileSize(fname, &size);
+  std::unique_ptr<RandomAccessFileReader> reader;
+  if (s.ok()) {
+    s = OpenReader(env, env_options, fname, &reader);
+  }
+  if (s.ok()) {
+    result->reset(new ValueLog(env, std::move(fname), number, nullptr,
+                               std::move(reader), size));
+  }
+  return s;
+}
+
+ValueLog::ValueLog(Env* env, std::string fname, uint64_t number,
+                   std::unique_ptr<WritableFileWriter>&& writer,
+                   std::unique_ptr<RandomAccessFileReader>&& reader,
+                   uint64_t size)
+    : env_(env),
+      fname_(std::move(fname)),
+      number_(number),
+      writer_(std::move(writer)),
+      reader_(std::move(reader)),
+      appended_size_(size),
+      readable_size_(size) {}
+
+ValueLog::~ValueLog() {
+  if (writer_ != nullptr) {
+    writer_->Close();
+  }
+}
+
+bool ValueLog::DecodeIndex(Slice index, uint64_t* number, uint64_t* offset,
+                           uint32_t* size, uint32_t* checksum) {
+  return GetVarint64(&index, number) && GetVarint64(&index, offset) &&
+         GetVarint32(&index, size) && GetFixed32(&index, checksum) &&
+         index.empty();
+}
+
+bool ValueLog::DecodeNumber(Slice index, uint64_t* number) {
+  return GetVarint64(&index, number);
+}
+
+bool ValueLog::DecodeValueSize(Slice index, uint64_t* size) {
+  uint64_t number, offset;
+  uint32_t value_size, checksum;
+  if (!DecodeIndex(index, &number, &offset, &value_size, &checksum)) {
+    return false;
+  }
+  *size = value_size;
+  return true;
+}
+
+Status ValueLog::Append(const Slice& value, std::string* index) {
+  assert(writer_ != nullptr);
+  if (value.size() > size_t{port::kMaxUint32}) {
+    return Status::InvalidArgument("value is too large");
+  }
+  Status s = writer_->Append(value);
+  if (!s.ok()) {
+    return s;
+  }
+  PutVarint64(index, number_);
+  PutVarint64(index, appended_size_);
+  PutVarint32(index, static_cast<uint32_t>(value.size()));
+  PutFixed32(index, crc32c::Mask(crc32c::Value(value.data(), value.size())));
+  appended_size_ += value.size();
+  return s;
+}
+
+Status ValueLog::Flush() {
+  assert(writer_ != nullptr);
+  Status s = writer_->Flush();
+  if (s.ok()) {
+    readable_size_.store(appended_size_, std::memory_order_release);
+  }
+  return s;
+}
+
+Status ValueLog::Sync(bool use_fsync) {
+  assert(writer_ != nullptr);
+  Status s = Flush();
+  if (s.ok()) {
+    s = writer_->Sync(use_fsync);
+  }
+  return s;
+}
+
+Status ValueLog::CheckIndex(const Slice& index) const {
+  uint64_t number, offset;
+  uint32_t size, checksum;
+  if (!DecodeIndex(index, &number, &offset, &size, &checksum) ||
+      number != number_) {
+    return Status::Corruption("bad value index", fname_);
+  }
+  uint64_t end = offset + size;
+  if (end > readable_size_.load(std::memory_order_acquire) &&
+      writer_ == nullptr) {
+    // Someone else may be appending to it
+    uint64_t file_size;
+    if (env_->GetFileSize(fname_, &file_size).ok()) {
+      readable_size_.store(file_size, std::memory_order_release);
+    }
+  }
+  if (end > readable_size_.load(std::memory_order_acquire)) {
+    return Status::Corruption("value index past the end of the value log",
+                              fname_);
+  }
+  return Status::OK();
+}
+
+LazyBuffer ValueLog::GetValue(const Slice& index) const {
+  uint64_t number, offset;
+  uint32_t size, checksum;
+  if (!DecodeIndex(index, &number, &offset, &size, &checksum)) {
+    return LazyBuffer(Status::Corruption("bad value index", fname_));
+  }
+  assert(number == number_);
+  return LazyBuffer(this, {offset, size, checksum});
+}
+
+void ValueLog::destroy(LazyBuffer* /*buffer*/) const {}
+
+Status ValueLog::pin_buffer(LazyBuffer* /*buffer*/) const {
+  // Reads as long as the memtables holding the value indexes
+  return Status::OK();
+}
+
+Status ValueLog::dump_buffer(LazyBuffer* buffer, LazyBuffer* target) const {
+  Status s = fetch_buffer(buffer);
+  if (s.ok()) {
+    target->reset(std::move(*buffer));
+  }
+  return s;
+}
+
+Status ValueLog::fetch_buffer(LazyBuffer* buffer) const {
+  auto context = get_context(buffer);
+  uint64_t offset = context->data[0];
+  size_t size = static_cast<size_t>(context->data[1]);
+  uint32_t checksum = static_cast<uint32_t>(context->data[2]);
+  LazyBuffer value(size);
+  if (!value.valid()) {
+    return value.fetch();
+  }
+  char* scratch = const_cast<char*>(value.data());
+  Slice result;
+  Status s = reader_->Read(offset, size, &result, scratch);
+  if (!s.ok()) {
+    return s;
+  }
+  if (result.size() != size) {
+    return Status::Corruption("truncated value log", fname_);
+  }
+  if (crc32c::Unmask(checksum) != crc32c::Value(result.data(), size)) {
+    return Status::Corruption("value log checksum mismatch", fname_);
+  }
+  if (result.data() != scratch) {
+    memcpy(scratch, result.data(), size);
+  }
+  buffer->reset(std::move(value));
+  return Status::OK();
+}
+
+}  // namespace TERARKDB_NAMESPACE
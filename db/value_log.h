@@ -0,0 +1,102 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "rocksdb/env.h"
+#include "rocksdb/lazy_buffer.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class RandomAccessFileReader;
+class WritableFileWriter;
+
+// The value log of a WAL holds the large values of the puts written to the
+// WAL, which only records the value indexes pointing to them, see
+// DBOptions::value_log_threshold. The file is deleted with its WAL, the
+// object is kept by the memtables the puts went to and reads the values for
+// them.
+//
+// A value index is the varint64 number of the value log, followed by the
+// varint64 offset and the varint32 size of the value and the masked crc32c of
+// the value.
+class ValueLog : public LazyBufferState {
+ public:
+  // Create the value log of the WAL `number` in `dir` to append to
+  static Status Create(Env* env, const EnvOptions& env_options,
+                       const std::string& dir, uint64_t number,
+                       std::shared_ptr<ValueLog>* result);
+
+  // Open the value log of the WAL `number` in `dir` to read the values of
+  // its puts, e.g. while the WAL is recovered
+  static Status Open(Env* env, const EnvOptions& env_options,
+                     const std::string& dir, uint64_t number,
+                     std::shared_ptr<ValueLog>* result);
+
+  // The number of the value log `index` points into
+  static bool DecodeNumber(Slice index, uint64_t* number);
+
+  // The size of the value `index` points to
+  static bool DecodeValueSize(Slice index, uint64_t* size);
+
+  ~ValueLog();
+
+  uint64_t number() const { return number_; }
+
+  // Append `value` and set `index` to its value index. The value can't be
+  // read before Flush().
+  // REQUIRES: created by Create(), one writer at a time
+  Status Append(const Slice& value, std::string* index);
+
+  // Make the appended values readable
+  // REQUIRES: created by Create(), one writer at a time
+  Status Flush();
+
+  // Make the appended values durable
+  // REQUIRES: created by Create(), one writer at a time
+  Status Sync(bool use_fsync);
+
+  // Corruption if `index` doesn't point to a readable value of this value log
+  Status CheckIndex(const Slice& index) const;
+
+  // The value `index` points to, read on fetch
+  // REQUIRES: CheckIndex(index) is ok
+  LazyBuffer GetValue(const Slice& index) const;
+
+  // LazyBufferState, the value is read into a buffer of its own when fetched
+  void destroy(LazyBuffer* buffer) const override;
+  Status pin_buffer(LazyBuffer* buffer) const override;
+  Status dump_buffer(LazyBuffer* buffer, LazyBuffer* target) const override;
+  Status fetch_buffer(LazyBuffer* buffer) const override;
+
+  ValueLog(const ValueLog&) = delete;
+  ValueLog& operator=(const ValueLog&) = delete;
+
+ private:
+  ValueLog(Env* env, std::string fname, uint64_t number,
+           std::unique_ptr<WritableFileWriter>&& writer,
+           std::unique_ptr<RandomAccessFileReader>&& reader, uint64_t size);
+
+  static bool DecodeIndex(Slice index, uint64_t* number, uint64_t* offset,
+                          uint32_t* size, uint32_t* checksum);
+
+  Env* const env_;
+  const std::string fname_;
+  const uint64_t number_;
+  std::unique_ptr<WritableFileWriter> writer_;
+  std::unique_ptr<RandomAccessFileReader> reader_;
+  // The bytes appended by writer_
+  uint64_t appended_size_;
+  // The bytes that can be read
+  mutable std::atomic<uint64_t> readable_size_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -190,6 +190,10 @@ class VersionBuilder::Rep {
     }
   };
 
+  // With lazy_open_deep_sst the essence ssts of deeper levels are opened on
+  // their first access
+  static const int kMaxEagerOpenLevel = 1;
+
   std::unique_ptr<VersionBuilderContextImpl> context_;
   std::unique_ptr<VersionBuilderDebugger> debugger_;
 
@@ -631,7 +635,15 @@ class VersionBuilder::Rep {
                       external_file_seqno);
               abort();
             }
-          } else if (f1->fd.smallest_seqno <= f2->fd.smallest_seqno) {
+          } else if (f1->fd.smallest_seqno <= f2->fd.smallest_seqno &&
+                     // The key ranges of a partitioned flush interleave
+                     // their seqnos but never overlap
+                     vstorage->InternalComparator()->Compare(f1->largest,
+                                                             f2->smallest) >=
+                         0 &&
+                     vstorage->InternalComparator()->Compare(f2->largest,
+                                                             f1->smallest) >=
+                         0) {
             fprintf(stderr,
                     "L0 files seqno %" PRIu64 " %" PRIu64 " vs. %" PRIu64
                     " %" PRIu64 "\n",
@@ -1037,16 +1049,20 @@ class VersionBuilder::Rep {
   void LoadTableHandlers(InternalStats* internal_stats,
                          bool prefetch_index_and_filter_in_cache,
                          const SliceTransform* prefix_extractor,
-                         bool load_essence_sst, int max_threads) {
+                         bool load_essence_sst, int max_threads,
+                         bool lazy_open_deep_sst) {
     assert(table_cache_ != nullptr);
     Init();
     // <file metadata, level>
     std::vector<std::pair<FileMetaData*, int>> files_meta;
     auto dependence_version = context_->dependence_version;
     for (int level = 0; level < num_levels_; level++) {
+      bool load_level_essence_sst =
+          load_essence_sst &&
+          (!lazy_open_deep_sst || level <= kMaxEagerOpenLevel);
       for (auto& file_meta_pair : context_->levels[level]) {
         auto* file_meta = file_meta_pair.second;
-        if ((load_essence_sst || file_meta->prop.is_map_sst()) &&
+        if ((load_level_essence_sst || file_meta->prop.is_map_sst()) &&
             file_meta->table_reader_handle == nullptr) {
           files_meta.emplace_back(file_meta, level);
         }
@@ -1055,7 +1071,8 @@ class VersionBuilder::Rep {
     for (auto& pair : context_->dependence_map) {
       auto& item = pair.second;
       if (item.dependence_version == dependence_version && item.level == -1 &&
-          (load_essence_sst || item.f->prop.is_map_sst()) &&
+          ((load_essence_sst && !lazy_open_deep_sst) ||
+           item.f->prop.is_map_sst()) &&
           item.f->table_reader_handle == nullptr) {
         files_meta.emplace_back(item.f, -1);
       }
@@ -1192,9 +1209,11 @@ void VersionBuilder::SaveTo(VersionStorageInfo* vstorage,
 void VersionBuilder::LoadTableHandlers(InternalStats* internal_stats,
                                        bool prefetch_index_and_filter_in_cache,
                                        const SliceTransform* prefix_extractor,
-                                       bool load_essence_sst, int max_threads) {
+                                       bool load_essence_sst, int max_threads,
+                                       bool lazy_open_deep_sst) {
   rep_->LoadTableHandlers(internal_stats, prefetch_index_and_filter_in_cache,
-                          prefix_extractor, load_essence_sst, max_threads);
+                          prefix_extractor, load_essence_sst, max_threads,
+                          lazy_open_deep_sst);
 }
 
 void VersionBuilder::UpgradeFileMetaData(const SliceTransform* prefix_extractor,
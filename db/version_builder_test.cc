@@ -433,10 +433,12 @@ TEST_F(VersionBuilderTest, HugeLSM) {
 
   for (uint32_t i = 0; i < kFilesBlobCount; ++i) {
     TablePropertyCache prop;
+    std::vector<uint64_t> inheritance;
     for (uint32_t j = i * 32 + 1, je = j + kFilesBlobInheritance - 1; j < je;
          ++j) {
-      prop.inheritance.emplace_back(j);
+      inheritance.emplace_back(j);
     }
+    prop.inheritance = std::move(inheritance);
     Add(-1, (i + 1) * 32, "0", "1", 100, 0, 0, 100, 100000, 0, 0, 100, prop);
   }
 
@@ -9,6 +9,9 @@
 
 #include "db/version_edit.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include "db/version_set.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/terark_namespace.h"
@@ -77,6 +80,7 @@ enum CustomTag : uint32_t {
   kMinLogNumberToKeepHack = 3,
   kPropertyCache = 64,
   kPathId = 65,
+  kInheritance = 66,
 };
 // If this bit for the custom tag is set, opening DB should fail if
 // we don't know this field.
@@ -87,14 +91,77 @@ uint64_t PackFileNumberAndPathId(uint64_t number, uint64_t path_id) {
   return number | (path_id * (kFileNumberMask + 1));
 }
 
+const std::vector<uint64_t>& InheritanceSet::file_numbers() const {
+  static const std::vector<uint64_t> empty;
+  return file_numbers_ ? *file_numbers_ : empty;
+}
+
+size_t InheritanceSet::Prune(const std::vector<uint64_t>& referenced) {
+  assert(std::is_sorted(referenced.begin(), referenced.end()));
+  std::vector<uint64_t> kept;
+  std::set_intersection(begin(), end(), referenced.begin(), referenced.end(),
+                        std::back_inserter(kept));
+  size_t dropped = size() - kept.size();
+  if (dropped > 0) {
+    *this = std::move(kept);
+  }
+  return dropped;
+}
+
+void InheritanceSet::EncodeTo(std::string* dst) const {
+  const std::vector<uint64_t>& v = file_numbers();
+  std::string runs;
+  uint64_t num_runs = 0;
+  uint64_t next = 0;
+  for (size_t i = 0; i < v.size();) {
+    size_t j = i + 1;
+    while (j < v.size() && v[j] == v[j - 1] + 1) {
+      ++j;
+    }
+    PutVarint64Varint64(&runs, v[i] - next, j - i);
+    next = v[j - 1] + 1;
+    ++num_runs;
+    i = j;
+  }
+  PutVarint64(dst, num_runs);
+  dst->append(runs);
+}
+
+bool InheritanceSet::DecodeFrom(Slice* input) {
+  uint64_t num_runs;
+  // Every run takes at least two bytes
+  if (!GetVarint64(input, &num_runs) || num_runs > input->size()) {
+    return false;
+  }
+  std::vector<uint64_t> v;
+  uint64_t next = 0;
+  for (uint64_t i = 0; i < num_runs; ++i) {
+    uint64_t gap, length;
+    if (!GetVarint64(input, &gap) || !GetVarint64(input, &length) ||
+        length == 0 || next > kFileNumberMask || gap > kFileNumberMask - next ||
+        length - 1 > kFileNumberMask - next - gap) {
+      return false;
+    }
+    for (uint64_t file_number = next + gap; file_number < next + gap + length;
+         ++file_number) {
+      v.emplace_back(file_number);
+    }
+    next += gap + length;
+  }
+  *this = std::move(v);
+  return true;
+}
+
 std::vector<SequenceNumber> FileMetaData::ShrinkSnapshot(
     const std::vector<SequenceNumber>& snapshots) const {
-  std::vector<SequenceNumber> ret = snapshots;
-  auto end = std::unique(ret.begin(), ret.end());
-  end = std::remove_if(ret.begin(), end, [this](SequenceNumber seqno) {
-    return seqno < fd.smallest_seqno || seqno > fd.largest_seqno;
-  });
-  ret.erase(end, ret.end());
+  assert(std::is_sorted(snapshots.begin(), snapshots.end()));
+  // Only copy the snapshots in [smallest_seqno, largest_seqno]
+  auto begin =
+      std::lower_bound(snapshots.begin(), snapshots.end(), fd.smallest_seqno);
+  auto end = std::upper_bound(begin, snapshots.end(), fd.largest_seqno);
+  std::vector<SequenceNumber> ret;
+  ret.reserve(end - begin);
+  std::unique_copy(begin, end, std::back_inserter(ret));
   return ret;
 }
 
@@ -217,10 +284,8 @@ bool VersionEdit::EncodeTo(std::string* dst) const {
       PutVarint64(&encode_property_cache, f.prop.num_entries);
       PutVarint32Varint64(&encode_property_cache, f.prop.max_read_amp,
                           DoubleToU64(f.prop.read_amp));
-      PutVarint64(&encode_property_cache, f.prop.inheritance.size());
-      for (auto file_number : f.prop.inheritance) {
-        PutVarint64(&encode_property_cache, file_number);
-      }
+      // The inheritance set has moved to kInheritance
+      PutVarint64(&encode_property_cache, 0);
       for (auto& dependence : f.prop.dependence) {
         PutVarint64(&encode_property_cache, dependence.entry_count);
       }
@@ -230,8 +295,15 @@ bool VersionEdit::EncodeTo(std::string* dst) const {
                           f.prop.raw_value_size);
       PutVarint64(&encode_property_cache, f.prop.earliest_time_begin_compact);
       PutVarint64(&encode_property_cache, f.prop.latest_time_end_compact);
+      PutVarint64(&encode_property_cache, f.prop.latest_time_expire);
       PutLengthPrefixedSlice(dst, encode_property_cache);
     }
+    if (!f.prop.inheritance.empty()) {
+      PutVarint32(dst, CustomTag::kInheritance);
+      std::string encode_inheritance;
+      f.prop.inheritance.EncodeTo(&encode_inheritance);
+      PutLengthPrefixedSlice(dst, encode_inheritance);
+    }
     TEST_SYNC_POINT_CALLBACK("VersionEdit::EncodeTo:NewFile4:CustomizeFields",
                              dst);
 
@@ -372,13 +444,22 @@ const char* VersionEdit::DecodeNewFile4From(Slice* input) {
               }
               f.prop.max_read_amp = uint16_t(max_read_amp);
               f.prop.read_amp = U64ToDouble(read_amp);
-              f.prop.inheritance.reserve(size);
-              for (size_t i = 0; i < size; ++i) {
-                uint64_t file_number;
+              // Written by old versions, sorted but not range collapsed
+              if (size > field.size()) {
+                return error_msg;
+              }
+              std::vector<uint64_t> inheritance(size);
+              for (auto& file_number : inheritance) {
                 if (!GetVarint64(&field, &file_number)) {
                   return error_msg;
                 }
-                f.prop.inheritance.emplace_back(file_number);
+              }
+              if (size > 0) {
+                std::sort(inheritance.begin(), inheritance.end());
+                inheritance.erase(
+                    std::unique(inheritance.begin(), inheritance.end()),
+                    inheritance.end());
+                f.prop.inheritance = std::move(inheritance);
               }
             }
             if (!field.empty()) {
@@ -408,12 +489,22 @@ const char* VersionEdit::DecodeNewFile4From(Slice* input) {
                 return error_msg;
               }
             }
+            if (!field.empty()) {
+              if (!GetVarint64(&field, &f.prop.latest_time_expire)) {
+                return error_msg;
+              }
+            }
             if (f.prop.num_entries > 0 || f.prop.raw_key_size > 0 ||
                 f.prop.raw_value_size > 0) {
               f.need_upgrade = false;
             }
           }
           break;
+        case kInheritance:
+          if (!f.prop.inheritance.DecodeFrom(&field) || !field.empty()) {
+            return "inheritance field";
+          }
+          break;
         default:
           if ((custom_tag & kCustomTagNonSafeIgnoreMask) != 0) {
             // Should not proceed if cannot understand it
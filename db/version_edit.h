@@ -10,6 +10,9 @@
 #pragma once
 #include <algorithm>
 #include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -69,15 +72,98 @@ struct FileDescriptor {
 };
 
 struct FileSampledStats {
-  FileSampledStats() : num_reads_sampled(0) {}
+  FileSampledStats()
+      : num_reads_sampled(0),
+        num_writes_sampled(0),
+        num_blob_fetches_sampled(0) {}
   FileSampledStats(const FileSampledStats& other) { *this = other; }
   FileSampledStats& operator=(const FileSampledStats& other) {
     num_reads_sampled = other.num_reads_sampled.load();
+    num_writes_sampled = other.num_writes_sampled.load();
+    num_blob_fetches_sampled = other.num_blob_fetches_sampled.load();
     return *this;
   }
 
   // number of user reads to this file.
   mutable std::atomic<uint64_t> num_reads_sampled;
+  // number of user writes to the key range of this file.
+  mutable std::atomic<uint64_t> num_writes_sampled;
+  // number of separated values fetched from this file.
+  mutable std::atomic<uint64_t> num_blob_fetches_sampled;
+};
+
+// The sorted file numbers a blob sst inherited by GC. The array is immutable
+// and shared by all copies, so a FileMetaData copied into every VersionEdit
+// doesn't duplicate inheritance sets of thousands of entries.
+class InheritanceSet {
+ public:
+  using const_iterator = std::vector<uint64_t>::const_iterator;
+
+  InheritanceSet() = default;
+  InheritanceSet(std::vector<uint64_t> file_numbers) {
+    assert(std::adjacent_find(file_numbers.begin(), file_numbers.end(),
+                              std::greater_equal<uint64_t>()) ==
+           file_numbers.end());
+    if (!file_numbers.empty()) {
+      file_numbers_ =
+          std::make_shared<const std::vector<uint64_t>>(std::move(file_numbers));
+    }
+  }
+  InheritanceSet(std::initializer_list<uint64_t> file_numbers)
+      : InheritanceSet(std::vector<uint64_t>(file_numbers)) {}
+
+  const std::vector<uint64_t>& file_numbers() const;
+  const_iterator begin() const { return file_numbers().begin(); }
+  const_iterator end() const { return file_numbers().end(); }
+  size_t size() const { return file_numbers_ ? file_numbers_->size() : 0; }
+  bool empty() const { return file_numbers_ == nullptr; }
+
+  bool operator==(const InheritanceSet& other) const {
+    return file_numbers_ == other.file_numbers_ ||
+           file_numbers() == other.file_numbers();
+  }
+  bool operator!=(const InheritanceSet& other) const {
+    return !(*this == other);
+  }
+
+  // Keep only the file numbers in `referenced`, which is sorted. The array
+  // stays shared if nothing is dropped. Return the number of dropped ones.
+  size_t Prune(const std::vector<uint64_t>& referenced);
+
+  // Runs of consecutive file numbers, as the varint gap to the end of the
+  // previous run and the varint run length
+  void EncodeTo(std::string* dst) const;
+  bool DecodeFrom(Slice* input);
+
+ private:
+  std::shared_ptr<const std::vector<uint64_t>> file_numbers_;
+};
+
+// A table reader pinned by the first read of a file that has no preloaded
+// one, see DBOptions::pin_table_reader_on_first_access. Later reads load it
+// without going through the table cache. Copies don't share the pin, which
+// is released and erased from the cache with its FileMetaData.
+struct PinnedTableReader {
+  PinnedTableReader() : cache(nullptr), handle(nullptr) {}
+  PinnedTableReader(const PinnedTableReader&) : PinnedTableReader() {}
+  PinnedTableReader& operator=(const PinnedTableReader&) { return *this; }
+  ~PinnedTableReader() {
+    Cache::Handle* h = handle.load(std::memory_order_relaxed);
+    if (h != nullptr) {
+      cache.load(std::memory_order_relaxed)->Release(h, true /* force_erase */);
+    }
+  }
+
+  // Take over `h` of `c` unless another read pinned the reader first
+  bool Pin(Cache* c, Cache::Handle* h) const {
+    Cache::Handle* expected = nullptr;
+    cache.store(c, std::memory_order_relaxed);
+    return handle.compare_exchange_strong(expected, h,
+                                          std::memory_order_acq_rel);
+  }
+
+  mutable std::atomic<Cache*> cache;
+  mutable std::atomic<Cache::Handle*> handle;
 };
 
 struct TablePropertyCache {
@@ -95,9 +181,10 @@ struct TablePropertyCache {
   uint16_t max_read_amp = 1;           // max read amp from sst
   float read_amp = 1;                  // expt read amp from sst
   std::vector<Dependence> dependence;  // make these sst hidden
-  std::vector<uint64_t> inheritance;   // inheritance set
+  InheritanceSet inheritance;         // inheritance set
   uint64_t earliest_time_begin_compact = port::kMaxUint64;
   uint64_t latest_time_end_compact = port::kMaxUint64;
+  uint64_t latest_time_expire = port::kMaxUint64;
 
   bool is_map_sst() const { return purpose == kMapSst; }
   bool has_range_deletions() const { return (flags & kNoRangeDeletions) == 0; }
@@ -127,6 +214,8 @@ struct FileMetaData {
 
   FileSampledStats stats;
 
+  PinnedTableReader pinned_table_reader;
+
   // Stats for compensating deletion entries during compaction
 
   // File size compensated by deletion entry.
@@ -171,6 +260,8 @@ struct FileMetaData {
     return old_refs == 1;
   }
 
+  // The distinct ones of the sorted `snapshots` that fall into the sequence
+  // number range of the file
   std::vector<SequenceNumber> ShrinkSnapshot(
       const std::vector<SequenceNumber>& snapshots) const;
 
@@ -269,6 +360,10 @@ struct LevelFilesBrief {
 class VersionEdit {
  public:
   VersionEdit() { Clear(); }
+  VersionEdit(const VersionEdit&) = default;
+  VersionEdit(VersionEdit&&) = default;
+  VersionEdit& operator=(const VersionEdit&) = default;
+  VersionEdit& operator=(VersionEdit&&) = default;
   ~VersionEdit() = default;
 
   struct ApplyCallback {
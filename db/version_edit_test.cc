@@ -10,6 +10,7 @@
 #include "db/version_edit.h"
 
 #include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
 #include "util/sync_point.h"
 #include "util/testharness.h"
 
@@ -189,6 +190,74 @@ TEST_F(VersionEditTest, EncodeEmptyFile) {
   ASSERT_TRUE(!edit.EncodeTo(&buffer));
 }
 
+TEST_F(VersionEditTest, InheritanceSet) {
+  InheritanceSet inheritance = {1, 2, 3, 4, 10, 12, 13, 1000000};
+  std::string encoded;
+  inheritance.EncodeTo(&encoded);
+  // 4 runs of two single byte varint plus the run count, the gap of the last
+  // one takes three bytes
+  ASSERT_EQ(1U + 3 * 2 + 3 + 1, encoded.size());
+  Slice input(encoded);
+  InheritanceSet decoded;
+  ASSERT_TRUE(decoded.DecodeFrom(&input));
+  ASSERT_TRUE(input.empty());
+  ASSERT_EQ(inheritance, decoded);
+
+  // Copies share the array
+  InheritanceSet copy = inheritance;
+  ASSERT_EQ(inheritance.begin(), copy.begin());
+  ASSERT_EQ(0U, copy.Prune({1, 2, 3, 4, 5, 10, 12, 13, 1000000, 1000001}));
+  ASSERT_EQ(inheritance.begin(), copy.begin());
+  ASSERT_EQ(5U, copy.Prune({2, 3, 13}));
+  ASSERT_EQ(InheritanceSet({2, 3, 13}), copy);
+  ASSERT_EQ(8U, inheritance.size());
+  ASSERT_EQ(3U, copy.Prune({}));
+  ASSERT_TRUE(copy.empty());
+
+  // Truncated or overflowing runs
+  encoded.pop_back();
+  input = encoded;
+  ASSERT_FALSE(decoded.DecodeFrom(&input));
+  encoded.clear();
+  PutVarint64(&encoded, 2);
+  PutVarint64Varint64(&encoded, kFileNumberMask, 1);
+  PutVarint64Varint64(&encoded, 0, 1);
+  input = encoded;
+  ASSERT_FALSE(decoded.DecodeFrom(&input));
+}
+
+TEST_F(VersionEditTest, ShrinkSnapshot) {
+  FileMetaData meta;
+  meta.fd = FileDescriptor(1, 0, 0, 10, 20);
+  using SeqVec = std::vector<SequenceNumber>;
+  ASSERT_EQ(SeqVec({10, 15, 20}),
+            meta.ShrinkSnapshot({5, 9, 10, 10, 15, 15, 20, 21, 30}));
+  ASSERT_EQ(SeqVec(), meta.ShrinkSnapshot({1, 2, 21}));
+  ASSERT_EQ(SeqVec(), meta.ShrinkSnapshot({}));
+}
+
+TEST_F(VersionEditTest, EncodeDecodeInheritance) {
+  std::vector<uint64_t> file_numbers;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    file_numbers.emplace_back(i < 900 ? 100 + i : 10000 + i * 3);
+  }
+  TablePropertyCache prop = GetPropCache(0, {}, {});
+  prop.inheritance = file_numbers;
+  VersionEdit edit;
+  edit.AddFile(-1, 20000, 0, 100, InternalKey("foo", 500, kTypeValue),
+               InternalKey("zoo", 600, kTypeValue), 500, 600, false, prop);
+  TestEncodeDecode(edit);
+
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  // Collapsed in 101 runs instead of 1000 varint
+  ASSERT_LT(encoded.size(), 500U);
+  VersionEdit parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  ASSERT_EQ(1U, parsed.GetNewFiles().size());
+  ASSERT_EQ(prop.inheritance, parsed.GetNewFiles()[0].second.prop.inheritance);
+}
+
 TEST_F(VersionEditTest, ColumnFamilyTest) {
   VersionEdit edit;
   edit.SetColumnFamily(2);
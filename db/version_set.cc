@@ -58,6 +58,7 @@
 #include "util/filename.h"
 #include "util/heap.h"
 #include "util/logging.h"
+#include "util/mutexlock.h"
 #include "util/stop_watch.h"
 #include "util/string_util.h"
 #include "util/sync_point.h"
@@ -114,6 +115,8 @@ class FilePicker {
   FilePicker(std::vector<FileMetaData*>* files, const Slice& user_key,
              const Slice& ikey, autovector<LevelFilesBrief>* file_levels,
              unsigned int num_levels, FileIndexer* file_indexer,
+             const LevelKeyModel* level_key_models,
+             const std::vector<std::vector<uint32_t>>* level0_sublevels,
              const Comparator* user_comparator,
              const InternalKeyComparator* internal_comparator)
       : num_levels_(num_levels),
@@ -131,6 +134,9 @@ class FilePicker {
         user_key_(user_key),
         ikey_(ikey),
         file_indexer_(file_indexer),
+        level_key_models_(level_key_models),
+        level0_sublevels_(level0_sublevels),
+        use_level0_hits_(false),
         user_comparator_(user_comparator),
         internal_comparator_(internal_comparator) {
 #ifdef NDEBUG
@@ -144,8 +150,11 @@ class FilePicker {
     search_ended_ = !PrepareNextLevel();
     if (!search_ended_) {
       // Prefetch Level 0 table data to avoid cache miss if possible.
-      for (unsigned int i = 0; i < (*level_files_brief_)[0].num_files; ++i) {
-        auto* r = (*level_files_brief_)[0].files[i].fd.table_reader;
+      size_t num_files = use_level0_hits_ ? level0_hits_.size()
+                                          : (*level_files_brief_)[0].num_files;
+      for (size_t i = 0; i < num_files; ++i) {
+        size_t index = use_level0_hits_ ? level0_hits_[i] : i;
+        auto* r = (*level_files_brief_)[0].files[index].fd.table_reader;
         if (r) {
           r->Prepare(ikey);
         }
@@ -157,12 +166,13 @@ class FilePicker {
 
   FdWithKeyRange* GetNextFile() {
     while (!search_ended_) {  // Loops over different levels.
-      while (curr_index_in_curr_level_ < curr_file_level_->num_files) {
+      while (curr_index_in_curr_level_ < NumFilesToCheck()) {
         // Loops over all files in current level.
-        FdWithKeyRange* f = &curr_file_level_->files[curr_index_in_curr_level_];
+        unsigned int file_index = FileIndex(curr_index_in_curr_level_);
+        FdWithKeyRange* f = &curr_file_level_->files[file_index];
         hit_file_level_ = curr_level_;
         is_hit_file_last_in_level_ =
-            curr_index_in_curr_level_ == curr_file_level_->num_files - 1;
+            file_index == curr_file_level_->num_files - 1;
         int cmp_largest = -1;
 
         // Do key range filtering of files or/and fractional cascading if:
@@ -218,9 +228,9 @@ class FilePicker {
             // level == 0, the current file cannot be newer than the previous
             // one. Use compressed data structure, has no attribute seqNo
             assert(curr_index_in_curr_level_ > 0);
-            assert(
-                !NewestFirstBySeqNo(files_[0][curr_index_in_curr_level_],
-                                    files_[0][curr_index_in_curr_level_ - 1]));
+            assert(!NewestFirstBySeqNo(
+                files_[0][file_index],
+                files_[0][FileIndex(curr_index_in_curr_level_ - 1)]));
           }
         }
         prev_file_ = f;
@@ -268,12 +278,50 @@ class FilePicker {
   Slice user_key_;
   Slice ikey_;
   FileIndexer* file_indexer_;
+  const LevelKeyModel* level_key_models_;
+  const std::vector<std::vector<uint32_t>>* level0_sublevels_;
+  // The level 0 files holding user_key_ in their ranges, newest first, found
+  // through the sub-levels
+  autovector<uint32_t, 8> level0_hits_;
+  bool use_level0_hits_;
   const Comparator* user_comparator_;
   const InternalKeyComparator* internal_comparator_;
 #ifndef NDEBUG
   FdWithKeyRange* prev_file_;
 #endif
 
+  // The files of the current level to go through
+  unsigned int NumFilesToCheck() const {
+    return use_level0_hits_ ? static_cast<unsigned int>(level0_hits_.size())
+                            : curr_file_level_->num_files;
+  }
+
+  // The index in the current level of the file to check at `pos`
+  unsigned int FileIndex(unsigned int pos) const {
+    return use_level0_hits_ ? level0_hits_[pos] : pos;
+  }
+
+  // Binary search each level 0 sub-level for the file holding user_key_, a
+  // sub-level on top of another holds the newer files
+  void FindLevel0Hits() {
+    level0_hits_.clear();
+    const FdWithKeyRange* files = curr_file_level_->files;
+    auto largest_before = [&](uint32_t index, const Slice& key) {
+      return user_comparator_->Compare(ExtractUserKey(files[index].largest_key),
+                                       key) < 0;
+    };
+    for (auto it = level0_sublevels_->rbegin(); it != level0_sublevels_->rend();
+         ++it) {
+      auto found =
+          std::lower_bound(it->begin(), it->end(), user_key_, largest_before);
+      if (found != it->end() &&
+          user_comparator_->Compare(ExtractUserKey(files[*found].smallest_key),
+                                    user_key_) <= 0) {
+        level0_hits_.push_back(*found);
+      }
+    }
+  }
+
   // Setup local variables to search next level.
   // Returns false if there are no more levels to search.
   bool PrepareNextLevel() {
@@ -301,9 +349,20 @@ class FilePicker {
       // any level. Otherwise, it only occurs at Level-0 (since Put/Deletes
       // are always compacted into a single entry).
       int32_t start_index;
+      use_level0_hits_ = false;
       if (curr_level_ == 0) {
-        // On Level-0, we read through all files to check for overlap.
+        // On Level-0, we read through all files to check for overlap, or only
+        // those the sub-levels say hold the key when there are too many
         start_index = 0;
+        if (curr_file_level_->num_files > 3 && level0_sublevels_ != nullptr &&
+            !level0_sublevels_->empty()) {
+          FindLevel0Hits();
+          if (level0_hits_.empty()) {
+            curr_level_++;
+            continue;
+          }
+          use_level0_hits_ = true;
+        }
       } else {
         // On Level-n (n>=1), files are sorted. Binary search to find the
         // earliest file whose largest key >= ikey. Search left bound and
@@ -317,10 +376,15 @@ class FilePicker {
           // determined based on user key, it is still possible the lookup key
           // falls to the right of `search_right_bound_`'s corresponding file.
           // So, pass a limit one higher, which allows us to detect this case.
-          start_index =
-              FindFileInRange(*internal_comparator_, *curr_file_level_, ikey_,
-                              static_cast<uint32_t>(search_left_bound_),
-                              static_cast<uint32_t>(search_right_bound_) + 1);
+          uint32_t left = static_cast<uint32_t>(search_left_bound_);
+          uint32_t right = static_cast<uint32_t>(search_right_bound_) + 1;
+          if (right - left > LevelKeyModel::kMaxError) {
+            // Leaves the comparator only the files the model can't tell
+            // apart
+            level_key_models_[curr_level_].Narrow(user_key_, &left, &right);
+          }
+          start_index = FindFileInRange(*internal_comparator_,
+                                        *curr_file_level_, ikey_, left, right);
           if (start_index == search_right_bound_ + 1) {
             // `ikey_` comes after `search_right_bound_`. The lookup key does
             // not exist on this level, so let's skip this level and do a full
@@ -569,6 +633,7 @@ class LevelIterator final : public InternalIterator, public Snapshot {
   void SkipEmptyFileBackward();
   void SetFileIterator(InternalIterator* iter);
   void InitFileIterator(size_t new_file_index);
+  void PrefetchNextFile();
 
   const Slice& file_smallest_key(size_t file_index) {
     assert(file_index < flevel_->num_files);
@@ -684,9 +749,24 @@ void LevelIterator::SkipEmptyFileForward() {
     if (file_iter_.iter() != nullptr) {
       file_iter_.SeekToFirst();
     }
+    if (read_options_.async_prefetch_size > 0 && !for_compaction_) {
+      PrefetchNextFile();
+    }
   }
 }
 
+void LevelIterator::PrefetchNextFile() {
+  // The scan moved into a new file, start the head of the one after it
+  size_t next_file_index = file_index_ + 1;
+  if (next_file_index >= flevel_->num_files ||
+      KeyReachedUpperBound(file_smallest_key(next_file_index))) {
+    return;
+  }
+  table_cache_->PrefetchAsync(
+      env_options_, *flevel_->files[next_file_index].file_metadata,
+      prefix_extractor_, read_options_.async_prefetch_size);
+}
+
 void LevelIterator::SkipEmptyFileBackward() {
   while (file_iter_.iter() == nullptr ||
          (!file_iter_.Valid() && file_iter_.status().ok())) {
@@ -741,6 +821,14 @@ class BaseReferencedVersionBuilder {
         version_(cfd->current()) {
     version_->Ref();
   }
+  // Based on `base` instead of the current version of cfd
+  BaseReferencedVersionBuilder(ColumnFamilyData* cfd, Version* base)
+      : version_builder_(new VersionBuilder(
+            base->version_set()->env_options(), cfd->table_cache(),
+            base->storage_info(), cfd->ioptions()->info_log)),
+        version_(base) {
+    version_->Ref();
+  }
   ~BaseReferencedVersionBuilder() {
     delete version_builder_;
     version_->Unref();
@@ -961,6 +1049,20 @@ size_t Version::GetMemoryUsageByTableReaders() {
   return total_usage;
 }
 
+size_t Version::GetMemoryUsageByFileMetaData() const {
+  size_t total_usage = 0;
+  for (int level = -1; level < storage_info_.num_levels(); ++level) {
+    for (auto file_meta : storage_info_.LevelFiles(level)) {
+      const TablePropertyCache& prop = file_meta->prop;
+      total_usage += sizeof(FileMetaData) + file_meta->smallest.size() +
+                     file_meta->largest.size() +
+                     prop.dependence.capacity() * sizeof(Dependence) +
+                     prop.inheritance.size() * sizeof(uint64_t);
+    }
+  }
+  return total_usage;
+}
+
 double Version::GetCompactionLoad() const {
   double read_amp = storage_info_.read_amplification();
   int level_add = cfd_->ioptions()->num_levels - 1;
@@ -1019,6 +1121,10 @@ void Version::GetColumnFamilyMetaData(ColumnFamilyMetaData* cf_meta) {
           file->stats.num_reads_sampled.load(std::memory_order_relaxed),
           file->being_compacted});
       auto& back = files.back();
+      back.num_writes_sampled =
+          file->stats.num_writes_sampled.load(std::memory_order_relaxed);
+      back.num_blob_fetches_sampled =
+          file->stats.num_blob_fetches_sampled.load(std::memory_order_relaxed);
       back.num_entries = file->prop.num_entries;
       back.num_deletions = file->prop.num_deletions;
       level_size += file->fd.GetFileSize();
@@ -1140,7 +1246,8 @@ void Version::AddIteratorsForLevel(const ReadOptions& read_options,
           storage_info_.dependence_map(), range_del_agg,
           mutable_cf_options_.prefix_extractor.get(), nullptr,
           cfd_->internal_stats()->GetFileReadHist(level), false, arena,
-          false /* skip_filters */, 0 /* level */));
+          false /* skip_filters */, 0 /* level */),
+          file.fd.largest_seqno);
     }
     if (should_sample) {
       // Count ones for every L0 files. This is done per iterator creation
@@ -1155,15 +1262,23 @@ void Version::AddIteratorsForLevel(const ReadOptions& read_options,
     // For levels > 0, we can use a concatenating iterator that sequentially
     // walks through the non-overlapping files in the level, opening them
     // lazily.
+    auto& level_files = storage_info_.LevelFilesBrief(level);
+    SequenceNumber max_seqno = 0;
+    for (size_t i = 0; i < level_files.num_files; ++i) {
+      max_seqno = std::max(max_seqno, level_files.files[i].fd.largest_seqno);
+    }
     auto* mem = arena->AllocateAligned(sizeof(LevelIterator));
-    merge_iter_builder->AddIterator(new (mem) LevelIterator(
-        cfd_->table_cache(), read_options, soptions,
-        cfd_->internal_comparator(), &storage_info_.LevelFilesBrief(level),
-        storage_info_.dependence_map(),
-        mutable_cf_options_.prefix_extractor.get(), should_sample_file_read(),
-        cfd_->internal_stats()->GetFileReadHist(level),
-        false /* for_compaction */, IsFilterSkipped(level), level,
-        range_del_agg));
+    merge_iter_builder->AddIterator(
+        new (mem) LevelIterator(
+            cfd_->table_cache(), read_options, soptions,
+            cfd_->internal_comparator(), &level_files,
+            storage_info_.dependence_map(),
+            mutable_cf_options_.prefix_extractor.get(),
+            should_sample_file_read(),
+            cfd_->internal_stats()->GetFileReadHist(level),
+            false /* for_compaction */, IsFilterSkipped(level), level,
+            range_del_agg),
+        max_seqno);
   }
 }
 
@@ -1261,6 +1376,9 @@ VersionStorageInfo::VersionStorageInfo(
       lsm_num_deletions_(0),
       estimated_compaction_needed_bytes_(0),
       total_garbage_ratio_(0),
+      hot_data_density_(std::numeric_limits<double>::max()),
+      blob_gc_scan_end_(0),
+      blob_fragment_count_(0),
       finalized_(false),
       is_pick_compaction_fail(false),
       is_pick_garbage_collection_fail(false),
@@ -1299,7 +1417,8 @@ Version::Version(ColumnFamilyData* column_family_data, VersionSet* vset,
   // creating this new version
   std::shared_ptr<FileMap> last_filemap = nullptr;
   if (cfd_ == nullptr || cfd_->current() == nullptr) {  // init version
-    last_filemap = std::make_shared<FileMap>();
+    last_filemap = std::make_shared<FileMap>(
+        cfd_ == nullptr ? nullptr : cfd_->user_comparator());
     ZnsLog(kCyan, "Create new FileMap (%p)", last_filemap.get());
   } else {
     // An existed version must have a valid FileMap
@@ -1326,16 +1445,34 @@ Status Version::fetch_buffer(LazyBuffer* buffer) const {
   // } else {
   //   RecordTick(db_statistics_, READ_BLOB_VALID);
   // }
+
+  // The blob cache holds the values, keep the blocks out of the block cache
+  ReadOptions read_options;
+  std::string blob_cache_key;
+  bool admit = false;
+  if (cfd_->ioptions()->blob_cache != nullptr) {
+    if (table_cache_->LookupBlobCache(meta->fd.GetNumber(), sequence, user_key,
+                                      buffer, &blob_cache_key, &admit)) {
+      return Status::OK();
+    }
+    read_options.fill_cache = false;
+  }
   bool value_found = false;
   SequenceNumber context_seq;
   GetContext get_context(cfd_->internal_comparator().user_comparator(), nullptr,
                          cfd_->ioptions()->info_log, db_statistics_,
                          GetContext::kNotFound, user_key, buffer, &value_found,
                          nullptr, nullptr, nullptr, env_, &context_seq);
+  get_context.set_is_blob_fetch(true);
   IterKey iter_key;
   iter_key.SetInternalKey(user_key, sequence, kValueTypeForSeek);
+  if (should_sample_file_read()) {
+    sample_file_blob_fetch_inc(meta);
+  }
+  PERF_COUNTER_ADD(blob_fetch_count, 1);
+  PERF_TIMER_GUARD(blob_fetch_nanos);
   auto s = table_cache_->Get(
-      ReadOptions(), *meta, storage_info_.dependence_map(),
+      read_options, *meta, storage_info_.dependence_map(),
       iter_key.GetInternalKey(), &get_context,
       mutable_cf_options_.prefix_extractor.get(), nullptr, true);
   if (!s.ok()) {
@@ -1354,6 +1491,13 @@ Status Version::fetch_buffer(LazyBuffer* buffer) const {
     }
   }
   assert(buffer->file_number() == meta->fd.GetNumber());
+  if (admit) {
+    s = buffer->fetch();
+    if (s.ok()) {
+      table_cache_->InsertBlobCache(blob_cache_key, buffer->slice());
+    }
+    return s;
+  }
   return Status::OK();
 }
 
@@ -1397,7 +1541,7 @@ void Version::Get(const ReadOptions& read_options, const Slice& user_key,
                   MergeContext* merge_context,
                   SequenceNumber* max_covering_tombstone_seq, bool* value_found,
                   bool* key_exists, SequenceNumber* seq,
-                  ReadCallback* callback) {
+                  ReadCallback* callback, bool defer_separated_value) {
   Slice ikey = k.internal_key();
 
   assert(status->ok() || status->IsMergeInProgress());
@@ -1412,11 +1556,14 @@ void Version::Get(const ReadOptions& read_options, const Slice& user_key,
       status->ok() ? GetContext::kNotFound : GetContext::kMerge, user_key,
       value, value_found, merge_context, this, max_covering_tombstone_seq,
       this->env_, seq, callback);
+  get_context.set_defer_separated_value(defer_separated_value);
 
   FilePicker fp(
       storage_info_.files_, user_key, ikey, &storage_info_.level_files_brief_,
       storage_info_.num_non_empty_levels_, &storage_info_.file_indexer_,
-      user_comparator(), internal_comparator());
+      storage_info_.level_key_models_.data(),
+      &storage_info_.level0_sublevels_, user_comparator(),
+      internal_comparator());
   FdWithKeyRange* f = fp.GetNextFile();
 
   while (f != nullptr) {
@@ -1511,6 +1658,21 @@ void Version::Get(const ReadOptions& read_options, const Slice& user_key,
   }
 }
 
+void Version::SampleWrite(const Slice& user_key) {
+  LookupKey lkey(user_key, kMaxSequenceNumber);
+  FilePicker fp(storage_info_.files_, user_key, lkey.internal_key(),
+                &storage_info_.level_files_brief_,
+                storage_info_.num_non_empty_levels_,
+                &storage_info_.file_indexer_,
+                storage_info_.level_key_models_.data(),
+                &storage_info_.level0_sublevels_, user_comparator(),
+                internal_comparator());
+  for (FdWithKeyRange* f = fp.GetNextFile(); f != nullptr;
+       f = fp.GetNextFile()) {
+    sample_file_write_inc(f->file_metadata);
+  }
+}
+
 void Version::GetKey(const Slice& user_key, const Slice& ikey, Status* status,
                      ValueType* type, SequenceNumber* seq, LazyBuffer* value,
                      const FileMetaData& blob) {
@@ -1531,7 +1693,9 @@ void Version::GetKey(const Slice& user_key, const Slice& ikey, Status* status,
   FilePicker fp(
       storage_info_.files_, user_key, ikey, &storage_info_.level_files_brief_,
       storage_info_.num_non_empty_levels_, &storage_info_.file_indexer_,
-      user_comparator(), internal_comparator());
+      storage_info_.level_key_models_.data(),
+      &storage_info_.level0_sublevels_, user_comparator(),
+      internal_comparator());
   FdWithKeyRange* f = fp.GetNextFile();
 
   while (f != nullptr) {
@@ -1573,15 +1737,22 @@ bool Version::IsFilterSkipped(int level, bool is_file_last_in_level) {
 
 void VersionStorageInfo::GenerateLevelFilesBrief() {
   level_files_brief_.resize(num_non_empty_levels_);
+  level_key_models_.resize(num_non_empty_levels_);
   for (int level = 0; level < num_non_empty_levels_; level++) {
     DoGenerateLevelFilesBrief(&level_files_brief_[level], files_[level],
                               &arena_);
+    // The files of level 0 overlap
+    if (level > 0) {
+      level_key_models_[level].Build(user_comparator_,
+                                     level_files_brief_[level]);
+    }
   }
 }
 
 void Version::PrepareApply(const MutableCFOptions& mutable_cf_options) {
   storage_info_.ComputeCompensatedSizes();
   storage_info_.UpdateNumNonEmptyLevels();
+  storage_info_.GenerateLevel0SubLevels();
   storage_info_.CalculateBaseBytes(*cfd_->ioptions(), mutable_cf_options);
   storage_info_.UpdateFilesByCompactionPri(cfd_->ioptions()->compaction_pri);
   storage_info_.GenerateFileIndexer();
@@ -1912,7 +2083,18 @@ void VersionStorageInfo::ComputeCompactionScore(
   uint64_t num_antiquation = 0;
   uint64_t num_entries = 0;
   bool marked = false;
-  for (auto& f : LevelFiles(-1)) {
+  auto& hidden_files = LevelFiles(-1);
+  blob_garbage_heap_.clear();
+  blob_gc_scan_end_ = hidden_files.size();
+  blob_fragment_count_ = 0;
+  uint64_t fragment_size =
+      BlobFragmentSize(mutable_cf_options, immutable_cf_options.num_levels,
+                       immutable_cf_options.compaction_style);
+  for (size_t i = 0; i < hidden_files.size(); ++i) {
+    FileMetaData* f = hidden_files[i];
+    if (f->is_gc_forbidden() && blob_gc_scan_end_ == hidden_files.size()) {
+      blob_gc_scan_end_ = i;
+    }
     if (!f->is_gc_permitted()) {
       continue;
     }
@@ -1920,16 +2102,39 @@ void VersionStorageInfo::ComputeCompactionScore(
     marked |= f->marked_for_compaction;
     num_antiquation += f->num_antiquation;
     num_entries += f->prop.num_entries;
+    if (i < blob_gc_scan_end_) {
+      blob_garbage_heap_.push_back(f);
+      double garbage_ratio = std::min(
+          1.0, f->num_antiquation / std::max<double>(1, f->prop.num_entries));
+      if (f->fd.file_size * (1 - garbage_ratio) <= fragment_size) {
+        ++blob_fragment_count_;
+      }
+    }
   }
+  std::make_heap(blob_garbage_heap_.begin(), blob_garbage_heap_.end(),
+                 BlobGarbageLess);
   blob_marked_for_compaction_ = marked;
   total_garbage_ratio_ = num_antiquation / std::max<double>(1, num_entries);
 
   is_pick_compaction_fail = false;
   ComputeFilesMarkedForCompaction();
   ComputeBottommostFilesMarkedForCompaction();
+  ComputeFilesMarkedForPathMigration(immutable_cf_options);
   EstimateCompactionBytesNeeded(mutable_cf_options);
 }
 
+bool VersionStorageInfo::BlobGarbageLess(const FileMetaData* l,
+                                         const FileMetaData* r) {
+  if (l->marked_for_compaction != r->marked_for_compaction) {
+    return l->marked_for_compaction < r->marked_for_compaction;
+  }
+  auto score = [](const FileMetaData* f) {
+    return std::min(
+        1.0, f->num_antiquation / std::max<double>(1, f->prop.num_entries));
+  };
+  return score(l) < score(r);
+}
+
 void VersionStorageInfo::ComputeFilesMarkedForCompaction() {
   files_marked_for_compaction_.clear();
   int last_qualify_level = 0;
@@ -2091,15 +2296,35 @@ uint64_t VersionStorageInfo::FileSizeWithBlob(const FileMetaData* f,
   return uint64_t(ratio * file_size);
 }
 
+uint64_t VersionStorageInfo::LatestTimeExpire(const FileMetaData* f) const {
+  if (!f->prop.is_map_sst()) {
+    return f->prop.latest_time_expire;
+  }
+  if (f->prop.dependence.empty()) {
+    return port::kMaxUint64;
+  }
+  uint64_t latest_time_expire = 0;
+  for (auto& dependence : f->prop.dependence) {
+    auto find = dependence_map_.find(dependence.file_number);
+    if (find == dependence_map_.end() || find->second->prop.is_map_sst()) {
+      return port::kMaxUint64;
+    }
+    latest_time_expire =
+        std::max(latest_time_expire, find->second->prop.latest_time_expire);
+  }
+  return latest_time_expire;
+}
+
 // Version::PrepareApply() need to be called before calling the function, or
 // following functions called:
 // 1. UpdateNumNonEmptyLevels();
-// 2. CalculateBaseBytes();
-// 3. UpdateFilesByCompactionPri();
-// 4. GenerateFileIndexer();
-// 5. GenerateLevelFilesBrief();
-// 6. GenerateLevel0NonOverlapping();
-// 7. GenerateBottommostFiles();
+// 2. GenerateLevel0SubLevels();
+// 3. CalculateBaseBytes();
+// 4. UpdateFilesByCompactionPri();
+// 5. GenerateFileIndexer();
+// 6. GenerateLevelFilesBrief();
+// 7. GenerateLevel0NonOverlapping();
+// 8. GenerateBottommostFiles();
 void VersionStorageInfo::SetFinalized() {
   finalized_ = true;
 #ifndef NDEBUG
@@ -2281,6 +2506,45 @@ void VersionStorageInfo::GenerateLevel0NonOverlapping() {
   }
 }
 
+void VersionStorageInfo::GenerateLevel0SubLevels() {
+  assert(!finalized_);
+  level0_sublevels_.clear();
+  if (num_levels_ == 0) {
+    return;
+  }
+  auto ucmp = user_comparator_;
+  const auto& files = files_[0];
+  // From the oldest file, which is the last one
+  for (size_t i = files.size(); i-- > 0;) {
+    const FileMetaData* f = files[i];
+    Slice smallest = f->smallest.user_key();
+    Slice largest = f->largest.user_key();
+    // The first file of `sublevel` whose largest key isn't before `smallest`
+    auto lower_bound = [&](const std::vector<uint32_t>& sublevel) {
+      return std::lower_bound(
+          sublevel.begin(), sublevel.end(), smallest,
+          [&](uint32_t index, const Slice& key) {
+            return ucmp->Compare(files[index]->largest.user_key(), key) < 0;
+          });
+    };
+    size_t target = 0;
+    for (size_t j = level0_sublevels_.size(); j-- > 0;) {
+      auto& sublevel = level0_sublevels_[j];
+      auto it = lower_bound(sublevel);
+      if (it != sublevel.end() &&
+          ucmp->Compare(files[*it]->smallest.user_key(), largest) <= 0) {
+        target = j + 1;
+        break;
+      }
+    }
+    if (target == level0_sublevels_.size()) {
+      level0_sublevels_.emplace_back();
+    }
+    auto& sublevel = level0_sublevels_[target];
+    sublevel.insert(lower_bound(sublevel), static_cast<uint32_t>(i));
+  }
+}
+
 void VersionStorageInfo::GenerateBottommostFiles() {
   assert(!finalized_);
   assert(bottommost_files_.empty());
@@ -2343,6 +2607,112 @@ void VersionStorageInfo::ComputeBottommostFilesMarkedForCompaction() {
             BottommostMarkedFilesComp());
 }
 
+namespace {
+uint64_t SampledAccesses(const FileMetaData* f) {
+  return f->stats.num_reads_sampled.load(std::memory_order_relaxed) +
+         f->stats.num_writes_sampled.load(std::memory_order_relaxed) +
+         f->stats.num_blob_fetches_sampled.load(std::memory_order_relaxed);
+}
+
+// The temperature of a file for hot_data_ratio
+double SampledAccessDensity(uint64_t accesses, uint64_t size) {
+  return accesses * 1048576.0 / std::max<uint64_t>(size, 1);
+}
+}  // namespace
+
+void VersionStorageInfo::ComputeFilesMarkedForPathMigration(
+    const ImmutableCFOptions& immutable_cf_options) {
+  files_marked_for_path_migration_.clear();
+  blobs_marked_for_path_migration_.clear();
+  hot_data_density_ = std::numeric_limits<double>::max();
+  if (immutable_cf_options.hot_data_ratio <= 0 ||
+      immutable_cf_options.cf_paths.size() < 2) {
+    return;
+  }
+  // The hottest files holding up to hot_data_ratio of the bytes are hot
+  std::vector<std::pair<double, uint64_t>> densities;
+  uint64_t total_size = 0;
+  for (int level = -1; level < num_levels(); ++level) {
+    for (auto f : LevelFiles(level)) {
+      densities.emplace_back(
+          SampledAccessDensity(SampledAccesses(f), f->fd.file_size),
+          f->fd.file_size);
+      total_size += f->fd.file_size;
+    }
+  }
+  std::sort(densities.begin(), densities.end(),
+            std::greater<std::pair<double, uint64_t>>());
+  uint64_t max_hot_size = static_cast<uint64_t>(
+      total_size * std::min(1.0, immutable_cf_options.hot_data_ratio));
+  uint64_t hot_size = 0;
+  for (auto& density : densities) {
+    hot_size += density.second;
+    if (density.first <= 0 || hot_size > max_hot_size) {
+      break;
+    }
+    hot_data_density_ = density.first;
+  }
+
+  // Level 0 is compacted soon anyway. A file leaves the first path only once
+  // twice colder than the hot files, so the files close to the threshold
+  // don't move back and forth.
+  for (int level = -1; level < num_levels(); ++level) {
+    if (level == 0) {
+      continue;
+    }
+    for (auto f : LevelFiles(level)) {
+      if (f->being_compacted || (level == -1 && !f->is_gc_permitted())) {
+        continue;
+      }
+      double density =
+          SampledAccessDensity(SampledAccesses(f), f->fd.file_size);
+      uint32_t path_id = f->fd.GetPathId();
+      bool hot = density >= (path_id == 0 ? hot_data_density_ / 2
+                                          : hot_data_density_);
+      if (TieredPathId(immutable_cf_options, level, hot, path_id) == path_id) {
+        continue;
+      }
+      if (level == -1) {
+        blobs_marked_for_path_migration_.push_back(f);
+      } else {
+        files_marked_for_path_migration_.emplace_back(level, f);
+      }
+    }
+  }
+}
+
+bool VersionStorageInfo::IsHotData(
+    const std::vector<CompactionInputFiles>& inputs) const {
+  if (hot_data_density_ == std::numeric_limits<double>::max()) {
+    return false;
+  }
+  uint64_t accesses = 0;
+  uint64_t size = 0;
+  for (auto& input : inputs) {
+    for (auto f : input.files) {
+      accesses += SampledAccesses(f);
+      size += f->fd.file_size;
+    }
+  }
+  return SampledAccessDensity(accesses, size) >= hot_data_density_;
+}
+
+uint32_t VersionStorageInfo::TieredPathId(
+    const ImmutableCFOptions& immutable_cf_options, int level, bool hot,
+    uint32_t size_path_id) const {
+  auto& cf_paths = immutable_cf_options.cf_paths;
+  if (immutable_cf_options.hot_data_ratio <= 0 || cf_paths.size() < 2) {
+    return size_path_id;
+  }
+  if (hot) {
+    return 0;
+  }
+  if (level == -1 || level == num_levels() - 1) {
+    return static_cast<uint32_t>(cf_paths.size() - 1);
+  }
+  return size_path_id;
+}
+
 void Version::Ref() { ++refs_; }
 
 bool Version::Unref() {
@@ -2795,6 +3165,7 @@ void VersionStorageInfo::CalculateBaseBytes(const ImmutableCFOptions& ioptions,
   // Special logic to set number of sorted runs.
   // It is to match the previous behavior when all files are in L0.
   int num_l0_count = static_cast<int>(files_[0].size());
+  int num_l0_sublevel_count = static_cast<int>(level0_sublevels_.size());
   if (compaction_style_ == kCompactionStyleUniversal &&
       !ioptions.enable_lazy_compaction) {
     // For universal compaction, we use level0 score to indicate
@@ -2803,10 +3174,12 @@ void VersionStorageInfo::CalculateBaseBytes(const ImmutableCFOptions& ioptions,
     for (int i = 1; i < num_levels(); i++) {
       if (!files_[i].empty()) {
         num_l0_count++;
+        num_l0_sublevel_count++;
       }
     }
   }
   set_l0_delay_trigger_count(num_l0_count);
+  l0_sublevel_delay_trigger_count_ = num_l0_sublevel_count;
 
   level_max_bytes_.resize(ioptions.num_levels);
   if (!ioptions.level_compaction_dynamic_level_bytes) {
@@ -3041,6 +3414,49 @@ struct VersionSet::ManifestWriter {
         new_cf_options(_new_cf_options) {}
 };
 
+// The state of a secondary instance reading the MANIFEST of its primary, see
+// RecoverAsSecondary() and CatchUpWithManifest()
+struct VersionSet::ManifestTailer {
+  explicit ManifestTailer(
+      const std::vector<ColumnFamilyDescriptor>& column_families) {
+    for (auto& cf : column_families) {
+      cf_name_to_options.emplace(cf.name, cf.options);
+    }
+    reporter.status = &status;
+  }
+
+  Status Open(Env* env, const std::string& dbname,
+              const EnvOptions& env_options, uint64_t manifest_file_number) {
+    reader.reset();
+    status = Status::OK();
+    atomic_group.clear();
+    std::string fname = DescriptorFileName(dbname, manifest_file_number);
+    std::unique_ptr<SequentialFile> file;
+    Status s = env->NewSequentialFile(
+        fname, &file, env->OptimizeForManifestRead(env_options));
+    if (s.ok()) {
+      std::unique_ptr<SequentialFileReader> file_reader(
+          new SequentialFileReader(std::move(file), fname));
+      reader.reset(new log::FragmentBufferedReader(
+          nullptr, std::move(file_reader), &reporter, true /* checksum */,
+          0 /* log_number */));
+    }
+    return s;
+  }
+
+  // The column families to open, the others are not followed
+  std::unordered_map<std::string, ColumnFamilyOptions> cf_name_to_options;
+  LogReporter reporter;
+  // Set by the reporter
+  Status status;
+  // nullptr until the MANIFEST CURRENT names is opened
+  std::unique_ptr<log::FragmentBufferedReader> reader;
+  // The edits read so far of an atomic group
+  std::vector<VersionEdit> atomic_group;
+  // The last sequence recorded by the MANIFEST
+  SequenceNumber last_sequence = 0;
+};
+
 VersionSet::VersionSet(const std::string& dbname,
                        const ImmutableDBOptions* _db_options,
                        const EnvOptions& storage_options, bool seq_per_batch,
@@ -3319,8 +3735,9 @@ Status VersionSet::ProcessManifestWrites(std::deque<ManifestWriter>& writers,
 
     if (!first_writer.edit_list.front()->IsColumnFamilyManipulation()) {
       bool load_essence_sst =
+          db_options_->table_cache_memory_budget == 0 &&
           column_family_set_->get_table_cache()->GetCapacity() ==
-          TableCache::kInfiniteCapacity;
+              TableCache::kInfiniteCapacity;
       for (int i = 0; i < static_cast<int>(versions.size()); ++i) {
         assert(!builder_guards.empty() &&
                builder_guards.size() == versions.size());
@@ -3331,7 +3748,8 @@ Status VersionSet::ProcessManifestWrites(std::deque<ManifestWriter>& writers,
             cfd->internal_stats(),
             mutable_cf_options_ptrs[i]->optimize_filters_for_hits,
             mutable_cf_options_ptrs[i]->prefix_extractor.get(),
-            load_essence_sst);
+            load_essence_sst, 1 /* max_threads */,
+            db_options_->lazy_open_deep_sst);
       }
     }
 
@@ -3821,6 +4239,99 @@ Status VersionSet::ApplyOneVersionEdit(
   return Status::OK();
 }
 
+// Reads and decodes the MANIFEST in a background thread, so that reading,
+// checksumming and decoding the next records overlap with applying the
+// previous edits to the version builders in Recover().
+class VersionSet::ManifestEditReader {
+ public:
+  explicit ManifestEditReader(std::unique_ptr<SequentialFileReader>&& file)
+      : reader_(nullptr, std::move(file), &reporter_, true /* checksum */,
+                0 /* log_number */, false /* retry_after_eof */),
+        cv_(&mutex_),
+        stopped_(false),
+        done_(false) {
+    reporter_.status = &read_status_;
+    thread_ = port::Thread(&ManifestEditReader::DecodeLoop, this);
+  }
+
+  ~ManifestEditReader() {
+    {
+      MutexLock l(&mutex_);
+      stopped_ = true;
+      cv_.SignalAll();
+    }
+    thread_.join();
+  }
+
+  // Return false at the end of the MANIFEST or at the first bad record, see
+  // status()
+  bool Next(VersionEdit* edit) {
+    MutexLock l(&mutex_);
+    while (pending_.empty() && !done_) {
+      cv_.Wait();
+    }
+    if (pending_.empty()) {
+      return false;
+    }
+    if (pending_.size() == kMaxPendingEdits) {
+      cv_.SignalAll();
+    }
+    *edit = std::move(pending_.front());
+    pending_.pop_front();
+    return true;
+  }
+
+  Status status() {
+    MutexLock l(&mutex_);
+    return status_;
+  }
+
+ private:
+  // Bounds the memory of edits decoded ahead of the one being applied
+  static const size_t kMaxPendingEdits = 1024;
+
+  void DecodeLoop() {
+    Slice record;
+    std::string scratch;
+    Status s;
+    while (reader_.ReadRecord(&record, &scratch) && read_status_.ok()) {
+      VersionEdit edit;
+      s = edit.DecodeFrom(record);
+      if (!s.ok()) {
+        break;
+      }
+      MutexLock l(&mutex_);
+      while (pending_.size() >= kMaxPendingEdits && !stopped_) {
+        cv_.Wait();
+      }
+      if (stopped_) {
+        break;
+      }
+      pending_.emplace_back(std::move(edit));
+      if (pending_.size() == 1) {
+        cv_.SignalAll();
+      }
+    }
+    MutexLock l(&mutex_);
+    status_ = s.ok() ? read_status_ : s;
+    done_ = true;
+    cv_.SignalAll();
+  }
+
+  // Only touched by the decoding thread
+  LogReporter reporter_;
+  Status read_status_;
+  log::Reader reader_;
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::deque<VersionEdit> pending_;
+  bool stopped_;
+  bool done_;
+  Status status_;
+  port::Thread thread_;
+};
+
 Status VersionSet::Recover(
     const std::vector<ColumnFamilyDescriptor>& column_families,
     bool read_only) {
@@ -3902,21 +4413,11 @@ Status VersionSet::Recover(
   builders.insert({0, new BaseReferencedVersionBuilder(default_cfd)});
 
   {
-    VersionSet::LogReporter reporter;
-    reporter.status = &s;
-    log::Reader reader(nullptr, std::move(manifest_file_reader), &reporter,
-                       true /* checksum */, 0 /* log_number */,
-                       false /* retry_after_eof */);
-    Slice record;
-    std::string scratch;
+    ManifestEditReader reader(std::move(manifest_file_reader));
     std::vector<VersionEdit> replay_buffer;
     size_t num_entries_decoded = 0;
-    while (reader.ReadRecord(&record, &scratch) && s.ok()) {
-      VersionEdit edit;
-      s = edit.DecodeFrom(record);
-      if (!s.ok()) {
-        break;
-      }
+    VersionEdit edit;
+    while (reader.Next(&edit)) {
       ++current_manifest_edit_count;
 
       if (edit.is_in_atomic_group_) {
@@ -3936,7 +4437,7 @@ Status VersionSet::Recover(
         replay_buffer[num_entries_decoded - 1] = std::move(edit);
         if (num_entries_decoded == replay_buffer.size()) {
           TEST_SYNC_POINT_CALLBACK("VersionSet::Recover:LastInAtomicGroup",
-                                   &edit);
+                                   &replay_buffer.back());
           for (auto& e : replay_buffer) {
             e.set_open_db(true);
             s = ApplyOneVersionEdit(
@@ -3972,6 +4473,9 @@ Status VersionSet::Recover(
         break;
       }
     }
+    if (s.ok()) {
+      s = reader.status();
+    }
   }
 
   if (s.ok()) {
@@ -4022,33 +4526,58 @@ Status VersionSet::Recover(
   }
 
   if (s.ok()) {
+    std::vector<ColumnFamilyData*> live_cfds;
     for (auto cfd : *column_family_set_) {
       if (cfd->IsDropped()) {
         continue;
       }
-      if (read_only) {
+      // The primary of a secondary instance deletes the tables it no longer
+      // uses, CatchUpWithManifest() evicts them
+      if (read_only && manifest_tailer_ == nullptr) {
         cfd->table_cache()->SetTablesAreImmortal();
       }
       assert(cfd->initialized());
-      auto builders_iter = builders.find(cfd->GetID());
-      assert(builders_iter != builders.end());
-      auto* builder = builders_iter->second->version_builder();
+      live_cfds.emplace_back(cfd);
+    }
 
-      bool load_essence_sst =
-          GetColumnFamilySet()->get_table_cache()->GetCapacity() ==
-          TableCache::kInfiniteCapacity;
+    bool load_essence_sst =
+        db_options_->table_cache_memory_budget == 0 &&
+        GetColumnFamilySet()->get_table_cache()->GetCapacity() ==
+            TableCache::kInfiniteCapacity;
+    auto load_table_handlers = [&](ColumnFamilyData* cfd) {
+      auto* builder = builders.at(cfd->GetID())->version_builder();
       // if unlimited table cache, pre-load all table handle. otherwise only
       // pre-load map sst.
       // Need to do it out of the mutex.
       builder->LoadTableHandlers(
           cfd->internal_stats(), false /* prefetch_index_and_filter_in_cache */,
           cfd->GetLatestMutableCFOptions()->prefix_extractor.get(),
-          load_essence_sst, db_options_->max_file_opening_threads);
+          load_essence_sst, db_options_->max_file_opening_threads,
+          db_options_->lazy_open_deep_sst);
 
       builder->UpgradeFileMetaData(
           cfd->GetLatestMutableCFOptions()->prefix_extractor.get(),
           db_options_->max_file_opening_threads);
+    };
+    // The files of all column families are final now, open them concurrently
+    // unless the files are to be opened by a single thread
+    if (live_cfds.size() > 1 && db_options_->max_file_opening_threads > 1) {
+      std::vector<port::Thread> threads;
+      for (size_t i = 1; i < live_cfds.size(); ++i) {
+        threads.emplace_back(load_table_handlers, live_cfds[i]);
+      }
+      load_table_handlers(live_cfds.front());
+      for (auto& t : threads) {
+        t.join();
+      }
+    } else {
+      for (auto cfd : live_cfds) {
+        load_table_handlers(cfd);
+      }
+    }
 
+    for (auto cfd : live_cfds) {
+      auto* builder = builders.at(cfd->GetID())->version_builder();
       Version* v = new Version(cfd, this, env_options_,
                                *cfd->GetLatestMutableCFOptions(),
                                current_version_number_++);
@@ -4096,6 +4625,289 @@ Status VersionSet::Recover(
   return s;
 }
 
+namespace {
+Status ReadCurrentManifestNumber(Env* env, const std::string& dbname,
+                                 uint64_t* manifest_file_number) {
+  std::string manifest_filename;
+  Status s = ReadFileToString(env, CurrentFileName(dbname), &manifest_filename);
+  if (!s.ok()) {
+    return s;
+  }
+  if (manifest_filename.empty() || manifest_filename.back() != '\n') {
+    return Status::Corruption("CURRENT file does not end with newline");
+  }
+  manifest_filename.resize(manifest_filename.size() - 1);
+  FileType type;
+  if (!ParseFileName(manifest_filename, manifest_file_number, &type) ||
+      type != kDescriptorFile) {
+    return Status::Corruption("CURRENT file corrupted");
+  }
+  return Status::OK();
+}
+}  // anonymous namespace
+
+Status VersionSet::RecoverAsSecondary(
+    const std::vector<ColumnFamilyDescriptor>& column_families) {
+  manifest_tailer_.reset(new ManifestTailer(column_families));
+  Status s = Recover(column_families, true /* read_only */);
+  ManifestTailer* tailer = manifest_tailer_.get();
+  tailer->last_sequence = last_sequence_;
+  if (s.ok()) {
+    s = tailer->Open(env_, dbname_, env_options_, manifest_file_number_);
+    if (s.IsNotFound()) {
+      // Already replaced by a new MANIFEST, which CatchUpWithManifest()
+      // follows
+      tailer->reader.reset();
+      return Status::OK();
+    }
+  }
+  // Skip the records Recover() has read, but keep the edits of an atomic
+  // group it has not read to the end, and thus not applied
+  uint64_t to_skip = manifest_edit_count_;
+  Slice record;
+  std::string scratch;
+  while (s.ok() && to_skip > 0 &&
+         tailer->reader->ReadRecord(&record, &scratch) &&
+         tailer->status.ok()) {
+    --to_skip;
+    VersionEdit edit;
+    s = edit.DecodeFrom(record);
+    if (!s.ok()) {
+      break;
+    }
+    auto& group = tailer->atomic_group;
+    if (!edit.is_in_atomic_group_) {
+      group.clear();
+    } else {
+      group.emplace_back(std::move(edit));
+      if (group.size() == group.front().remaining_entries_ + 1u) {
+        group.clear();
+      }
+    }
+  }
+  if (s.ok()) {
+    s = tailer->status;
+  }
+  if (s.ok() && to_skip > 0) {
+    s = Status::Corruption("MANIFEST is shorter than recovered");
+  }
+  if (!s.ok()) {
+    manifest_tailer_.reset();
+  }
+  return s;
+}
+
+Status VersionSet::ApplyTailedEdit(
+    VersionEdit& edit, bool rebuild,
+    std::unordered_map<uint32_t,
+                       std::unique_ptr<BaseReferencedVersionBuilder>>* builders,
+    std::unordered_set<ColumnFamilyData*>* cfds_changed) {
+  ManifestTailer* tailer = manifest_tailer_.get();
+  ColumnFamilyData* cfd = column_family_set_->GetColumnFamily(
+      edit.column_family_);
+  edit.set_open_db(true);
+
+  if (edit.is_column_family_add_) {
+    // A new MANIFEST starts with adding the existing column families again
+    if (cfd == nullptr) {
+      auto cf_options =
+          tailer->cf_name_to_options.find(edit.column_family_name_);
+      if (cf_options != tailer->cf_name_to_options.end()) {
+        cfd = CreateColumnFamily(cf_options->second, &edit);
+        cfd->set_initialized();
+        cfds_changed->insert(cfd);
+      }
+    }
+  } else if (edit.is_column_family_drop_) {
+    if (cfd != nullptr) {
+      builders->erase(cfd->GetID());
+      cfds_changed->erase(cfd);
+      cfd->SetDropped();
+      if (cfd->Unref()) {
+        delete cfd;
+      }
+      cfd = nullptr;
+    }
+  } else if (cfd != nullptr) {
+    auto& builder = (*builders)[cfd->GetID()];
+    if (builder == nullptr) {
+      if (rebuild) {
+        // The snapshot of a new MANIFEST lists all the files again
+        Version* base = new Version(cfd, this, env_options_,
+                                    *cfd->GetLatestMutableCFOptions(),
+                                    current_version_number_++);
+        builder.reset(new BaseReferencedVersionBuilder(cfd, base));
+      } else {
+        builder.reset(new BaseReferencedVersionBuilder(cfd));
+      }
+    }
+    builder->version_builder()->Apply(&edit);
+    cfds_changed->insert(cfd);
+  }
+
+  if (cfd != nullptr) {
+    if (edit.has_log_number_ && edit.log_number_ > cfd->GetLogNumber()) {
+      cfd->SetLogNumber(edit.log_number_);
+      cfds_changed->insert(cfd);
+    }
+    if (edit.has_comparator_ &&
+        edit.comparator_ != cfd->user_comparator()->Name() &&
+        !cfd->user_comparator()->IsAlias(edit.comparator_)) {
+      return Status::InvalidArgument(
+          cfd->user_comparator()->Name(),
+          "does not match existing comparator " + edit.comparator_);
+    }
+  }
+  if (edit.has_prev_log_number_) {
+    prev_log_number_ = edit.prev_log_number_;
+  }
+  if (edit.has_next_file_number_ &&
+      edit.next_file_number_ >= next_file_number_.load()) {
+    next_file_number_.store(edit.next_file_number_ + 1);
+  }
+  if (edit.has_max_column_family_) {
+    column_family_set_->UpdateMaxColumnFamily(edit.max_column_family_);
+  }
+  if (edit.has_min_log_number_to_keep_) {
+    MarkMinLogNumberToKeep2PC(edit.min_log_number_to_keep_);
+  }
+  if (edit.has_last_sequence_) {
+    tailer->last_sequence =
+        std::max<SequenceNumber>(tailer->last_sequence, edit.last_sequence_);
+  }
+  return Status::OK();
+}
+
+Status VersionSet::CatchUpWithManifest(
+    InstrumentedMutex* mu, std::unordered_set<ColumnFamilyData*>* cfds_changed,
+    SequenceNumber* last_sequence) {
+  mu->AssertHeld();
+  assert(manifest_tailer_ != nullptr);
+  ManifestTailer* tailer = manifest_tailer_.get();
+  std::unordered_map<uint32_t, std::unique_ptr<BaseReferencedVersionBuilder>>
+      builders;
+  // Whether the versions are built again from a new MANIFEST
+  bool rebuild = false;
+  Status s;
+  while (s.ok()) {
+    if (tailer->reader != nullptr) {
+      Slice record;
+      std::string scratch;
+      while (s.ok() && tailer->reader->ReadRecord(&record, &scratch) &&
+             tailer->status.ok()) {
+        VersionEdit edit;
+        s = edit.DecodeFrom(record);
+        if (!s.ok()) {
+          break;
+        }
+        auto& group = tailer->atomic_group;
+        if (edit.is_in_atomic_group_) {
+          if (!group.empty() &&
+              group.size() + edit.remaining_entries_ !=
+                  group.front().remaining_entries_) {
+            s = Status::Corruption("corrupted atomic group");
+            break;
+          }
+          group.emplace_back(std::move(edit));
+          if (group.size() == group.front().remaining_entries_ + 1u) {
+            for (auto& e : group) {
+              s = ApplyTailedEdit(e, rebuild, &builders, cfds_changed);
+              if (!s.ok()) {
+                break;
+              }
+            }
+            group.clear();
+          }
+        } else if (!group.empty()) {
+          s = Status::Corruption("corrupted atomic group");
+        } else {
+          s = ApplyTailedEdit(edit, rebuild, &builders, cfds_changed);
+        }
+      }
+      if (s.ok()) {
+        s = tailer->status;
+      }
+      if (!s.ok()) {
+        break;
+      }
+    }
+    // At the end of the MANIFEST, follow CURRENT if the primary has switched
+    // to a new one
+    uint64_t manifest_file_number = 0;
+    s = ReadCurrentManifestNumber(env_, dbname_, &manifest_file_number);
+    if (!s.ok() || (tailer->reader != nullptr &&
+                    manifest_file_number == manifest_file_number_)) {
+      break;
+    }
+    ROCKS_LOG_INFO(db_options_->info_log,
+                   "Switching to manifest file %" PRIu64 " from %" PRIu64,
+                   manifest_file_number, manifest_file_number_);
+    s = tailer->Open(env_, dbname_, env_options_, manifest_file_number);
+    if (s.ok()) {
+      manifest_file_number_ = manifest_file_number;
+      builders.clear();
+      rebuild = true;
+      // Column families without files in the new MANIFEST are emptied
+      for (auto cfd : *column_family_set_) {
+        if (cfd->IsDropped()) {
+          continue;
+        }
+        Version* base = new Version(cfd, this, env_options_,
+                                    *cfd->GetLatestMutableCFOptions(),
+                                    current_version_number_++);
+        builders[cfd->GetID()].reset(
+            new BaseReferencedVersionBuilder(cfd, base));
+        cfds_changed->insert(cfd);
+      }
+    }
+  }
+
+  if (s.ok() && !builders.empty()) {
+    bool load_essence_sst =
+        db_options_->table_cache_memory_budget == 0 &&
+        column_family_set_->get_table_cache()->GetCapacity() ==
+            TableCache::kInfiniteCapacity;
+    // Only the files new to the column families are opened, the tables of
+    // their current versions are shared through the table cache
+    mu->Unlock();
+    for (auto& pair : builders) {
+      ColumnFamilyData* cfd = column_family_set_->GetColumnFamily(pair.first);
+      auto* builder = pair.second->version_builder();
+      builder->LoadTableHandlers(
+          cfd->internal_stats(), false /* prefetch_index_and_filter_in_cache */,
+          cfd->GetLatestMutableCFOptions()->prefix_extractor.get(),
+          load_essence_sst, db_options_->max_file_opening_threads,
+          db_options_->lazy_open_deep_sst);
+      builder->UpgradeFileMetaData(
+          cfd->GetLatestMutableCFOptions()->prefix_extractor.get(),
+          db_options_->max_file_opening_threads);
+    }
+    mu->Lock();
+    for (auto& pair : builders) {
+      ColumnFamilyData* cfd = column_family_set_->GetColumnFamily(pair.first);
+      if (!pair.second->version_builder()->CheckConsistencyForNumLevels()) {
+        s = Status::InvalidArgument(
+            "db has more levels than options.num_levels");
+        break;
+      }
+      Version* v = new Version(cfd, this, env_options_,
+                               *cfd->GetLatestMutableCFOptions(),
+                               current_version_number_++);
+      pair.second->version_builder()->SaveTo(v->storage_info(), 0);
+      v->PrepareApply(*cfd->GetLatestMutableCFOptions());
+      AppendVersion(cfd, v);
+    }
+  }
+  builders.clear();
+  if (!s.ok()) {
+    // Read the MANIFEST again from the start on the next call, the edits
+    // applied by this call are lost with the builders
+    tailer->reader.reset();
+  }
+  *last_sequence = tailer->last_sequence;
+  return s;
+}
+
 Status VersionSet::ListColumnFamilies(std::vector<std::string>* column_families,
                                       const std::string& dbname, Env* env) {
   // these are just for performance reasons, not correcntes,
@@ -4517,13 +5329,30 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
       VersionEdit edit;
       edit.SetColumnFamily(cfd->GetID());
 
+      // An inherited file number is only needed to resolve the dependence of
+      // some live sst. New dependences only come from values of live ssts, so
+      // the rest can never be referenced again and is not written
+      auto vstorage = cfd->current()->storage_info();
+      std::vector<uint64_t> referenced;
+      for (int level = -1; level < cfd->NumberLevels(); level++) {
+        for (const auto& f : vstorage->LevelFiles(level)) {
+          for (auto& dependence : f->prop.dependence) {
+            referenced.emplace_back(dependence.file_number);
+          }
+        }
+      }
+      std::sort(referenced.begin(), referenced.end());
+      referenced.erase(std::unique(referenced.begin(), referenced.end()),
+                       referenced.end());
+
       for (int level = -1; level < cfd->NumberLevels(); level++) {
-        for (const auto& f :
-             cfd->current()->storage_info()->LevelFiles(level)) {
+        for (const auto& f : vstorage->LevelFiles(level)) {
+          TablePropertyCache prop = f->prop;
+          prop.inheritance.Prune(referenced);
           edit.AddFile(level, f->fd.GetNumber(), f->fd.GetPathId(),
                        f->fd.GetFileSize(), f->smallest, f->largest,
                        f->fd.smallest_seqno, f->fd.largest_seqno,
-                       f->marked_for_compaction, f->prop);
+                       f->marked_for_compaction, prop);
         }
       }
       edit.SetLogNumber(cfd->GetLogNumber());
@@ -4788,9 +5617,9 @@ InternalIterator* VersionSet::MakeInputIterator(
     }
   }
   assert(num <= space);
-  InternalIterator* result =
-      NewMergingIterator(&c->column_family_data()->internal_comparator(), list,
-                         static_cast<int>(num));
+  InternalIterator* result = NewLoserTreeMergingIterator(
+      &c->column_family_data()->internal_comparator(), list,
+      static_cast<int>(num));
   delete[] list;
   return result;
 }
@@ -4897,6 +5726,11 @@ void VersionSet::GetLiveFilesMetaData(std::vector<LiveFileMetaData>* metadata) {
         filemetadata.largest_seqno = file->fd.largest_seqno;
         filemetadata.num_reads_sampled =
             file->stats.num_reads_sampled.load(std::memory_order_relaxed);
+        filemetadata.num_writes_sampled =
+            file->stats.num_writes_sampled.load(std::memory_order_relaxed);
+        filemetadata.num_blob_fetches_sampled =
+            file->stats.num_blob_fetches_sampled.load(
+                std::memory_order_relaxed);
         filemetadata.being_compacted = file->being_compacted;
         filemetadata.num_entries = file->prop.num_entries;
         filemetadata.num_deletions = file->prop.num_deletions;
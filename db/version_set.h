@@ -25,6 +25,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -35,6 +36,7 @@
 #include "db/dbformat.h"
 #include "db/file_indexer.h"
 #include "db/filemap.h"
+#include "db/level_key_model.h"
 #include "db/log_reader.h"
 #include "db/range_del_aggregator.h"
 #include "db/read_callback.h"
@@ -113,6 +115,10 @@ class VersionStorageInfo {
   uint64_t FileSizeWithBlob(const FileMetaData* f, bool recursive = true,
                             double ratio = 1) const;
 
+  // The latest expiry time of the entries of `f`. Those of a map SST are in
+  // the SSTs it depends on.
+  uint64_t LatestTimeExpire(const FileMetaData* f) const;
+
   void SetFinalized();
 
   // Update num_non_empty_levels_.
@@ -153,6 +159,12 @@ class VersionStorageInfo {
   // REQUIRES: DB mutex held
   void ComputeBottommostFilesMarkedForCompaction();
 
+  // This computes files_marked_for_path_migration_,
+  // blobs_marked_for_path_migration_ and the temperature of the hot files, see
+  // ColumnFamilyOptions::hot_data_ratio. Called by ComputeCompactionScore().
+  void ComputeFilesMarkedForPathMigration(
+      const ImmutableCFOptions& immutable_cf_options);
+
   // Generate level_files_brief_ from files_
   void GenerateLevelFilesBrief();
   // Sort all files for this version based on their file size and
@@ -163,6 +175,18 @@ class VersionStorageInfo {
   void GenerateLevel0NonOverlapping();
   bool level0_non_overlapping() const { return level0_non_overlapping_; }
 
+  // Group the files of level 0 into sub-levels of non-overlapping files. A
+  // file goes to the sub-level above the highest one holding an older file
+  // it overlaps, so of the files holding a key, the newer ones are in the
+  // higher sub-levels.
+  void GenerateLevel0SubLevels();
+
+  // The level 0 sub-levels, oldest first, each sorted by key as indexes into
+  // LevelFiles(0)
+  const std::vector<std::vector<uint32_t>>& level0_sublevels() const {
+    return level0_sublevels_;
+  }
+
   // Check whether each file in this version is bottommost (i.e., nothing in its
   // key-range could possibly exist in an older file/level).
   // REQUIRES: This version has not been saved
@@ -270,10 +294,32 @@ class VersionStorageInfo {
 
   double total_garbage_ratio() const { return total_garbage_ratio_; }
 
+  // Order of blob files for garbage collection, files marked for compaction
+  // first, then by estimated garbage ratio
+  static bool BlobGarbageLess(const FileMetaData* l, const FileMetaData* r);
+
+  // Max heap (on BlobGarbageLess) of the blob files GC may pick, rebuilt
+  // together with total_garbage_ratio(). The picker pops the files it can
+  // not take instead of scanning every blob file.
+  std::vector<FileMetaData*>& blob_garbage_heap() {
+    return blob_garbage_heap_;
+  }
+
+  // Blob files at or after this index of LevelFiles(-1) are not considered
+  // by GC
+  size_t blob_gc_scan_end() const { return blob_gc_scan_end_; }
+
   bool blob_marked_for_compaction() const {
     return blob_marked_for_compaction_;
   }
 
+  // A GC job merges the small blob files once there are this many it may pick
+  static const size_t kMinBlobDefragmentFiles = 8;
+
+  // The number of blob files GC may pick holding less live data than
+  // BlobFragmentSize(), rebuilt together with total_garbage_ratio()
+  size_t blob_fragment_count() const { return blob_fragment_count_; }
+
   bool has_space_amplification() const { return !space_amplification_.empty(); }
 
   bool has_space_amplification(int level) const {
@@ -324,6 +370,13 @@ class VersionStorageInfo {
 
   void set_l0_delay_trigger_count(int v) { l0_delay_trigger_count_ = v; }
 
+  // l0_delay_trigger_count() counting the level 0 sub-levels rather than
+  // the files, see ColumnFamilyOptions::level0_stall_by_sublevels
+  // REQUIRES: This version has been finalized.
+  int l0_sublevel_delay_trigger_count() const {
+    return l0_sublevel_delay_trigger_count_;
+  }
+
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   int NumLevelFiles(int level) const {
     assert(finalized_);
@@ -374,6 +427,31 @@ class VersionStorageInfo {
     return bottommost_files_marked_for_compaction_;
   }
 
+  // REQUIRES: This version has been saved (see VersionSet::SaveTo)
+  // REQUIRES: DB mutex held during access
+  // The files on the wrong tier for their temperature, of the levels and of
+  // level -1, which GC moves
+  const autovector<std::pair<int, FileMetaData*>>&
+  FilesMarkedForPathMigration() const {
+    assert(finalized_);
+    return files_marked_for_path_migration_;
+  }
+  const autovector<FileMetaData*>& BlobsMarkedForPathMigration() const {
+    assert(finalized_);
+    return blobs_marked_for_path_migration_;
+  }
+
+  // Whether the files of `inputs` together are as hot as the hot files, by
+  // their sampled accesses per byte. Always false without hot_data_ratio.
+  bool IsHotData(const std::vector<CompactionInputFiles>& inputs) const;
+
+  // The path of a file of `level`, -1 for a blob file, by its temperature
+  // with hot_data_ratio. The hot files go to the first path, the cold blob
+  // files and the cold files of the bottommost level to the last one, the
+  // others to `size_path_id`, the path picked by size.
+  uint32_t TieredPathId(const ImmutableCFOptions& immutable_cf_options,
+                        int level, bool hot, uint32_t size_path_id) const;
+
   int base_level() const { return base_level_; }
   double level_multiplier() const { return level_multiplier_; }
 
@@ -528,6 +606,9 @@ class VersionStorageInfo {
 
   // A short brief metadata of files per level
   autovector<TERARKDB_NAMESPACE::LevelFilesBrief> level_files_brief_;
+  // Built from level_files_brief_, empty for level 0 and the levels it
+  // doesn't qualify for
+  std::vector<LevelKeyModel> level_key_models_;
   FileIndexer file_indexer_;
   Arena arena_;  // Used to allocate space for file_levels_
 
@@ -567,6 +648,8 @@ class VersionStorageInfo {
   // If true, means that files in L0 have keys with non overlapping ranges
   bool level0_non_overlapping_;
 
+  std::vector<std::vector<uint32_t>> level0_sublevels_;
+
   // An index into files_by_compaction_pri_ that specifies the first
   // file that is not yet compacted
   std::vector<int> next_file_to_compact_by_size_;
@@ -624,6 +707,7 @@ class VersionStorageInfo {
 
   int l0_delay_trigger_count_ = 0;  // Count used to trigger slow down and stop
                                     // for number of L0 files.
+  int l0_sublevel_delay_trigger_count_ = 0;
 
   uint64_t blob_file_count_;
   uint64_t blob_file_size_;
@@ -640,6 +724,18 @@ class VersionStorageInfo {
   // Store quantity of files that needs gc.
   double total_garbage_ratio_;
 
+  // The sampled accesses per MB of the coldest hot file, the max double if
+  // none is hot. Calculated in ComputeFilesMarkedForPathMigration().
+  double hot_data_density_;
+
+  // The files to move to another path, calculated together with
+  // hot_data_density_
+  autovector<std::pair<int, FileMetaData*>> files_marked_for_path_migration_;
+  autovector<FileMetaData*> blobs_marked_for_path_migration_;
+  std::vector<FileMetaData*> blob_garbage_heap_;
+  size_t blob_gc_scan_end_;
+  size_t blob_fragment_count_;
+
   bool finalized_;
 
   bool is_pick_compaction_fail;
@@ -698,12 +794,18 @@ class Version : public SeparateHelper, private LazyBufferState {
            LazyBuffer* value, Status* status, MergeContext* merge_context,
            SequenceNumber* max_covering_tombstone_seq,
            bool* value_found = nullptr, bool* key_exists = nullptr,
-           SequenceNumber* seq = nullptr, ReadCallback* callback = nullptr);
+           SequenceNumber* seq = nullptr, ReadCallback* callback = nullptr,
+           bool defer_separated_value = false);
 
   void GetKey(const Slice& user_key, const Slice& ikey, Status* status,
               ValueType* type, SequenceNumber* seq, LazyBuffer* value,
               const FileMetaData& blob);
 
+  // Charge one sampled write of `user_key` to every file whose range covers
+  // it, the files a Get() of the key could consult.
+  // REQUIRES: lock is not held
+  void SampleWrite(const Slice& user_key);
+
   // Loads some stats information from files. Call without mutex held. It needs
   // to be called before applying the version to the version set.
   void PrepareApply(const MutableCFOptions& mutable_cf_options);
@@ -755,6 +857,11 @@ class Version : public SeparateHelper, private LazyBufferState {
 
   size_t GetMemoryUsageByTableReaders();
 
+  // The memory of the metadata of the files, their keys, dependences and
+  // inheritance sets, which map SSTs and GC'ed blobs have many of. The
+  // FileMap, shared by the versions of a column family, is not included.
+  size_t GetMemoryUsageByFileMetaData() const;
+
   // REQUIRES: lock is held
   double GetCompactionLoad() const;
 
@@ -958,6 +1065,21 @@ class VersionSet {
   Status Recover(const std::vector<ColumnFamilyDescriptor>& column_families,
                  bool read_only = false);
 
+  // Recover() for a secondary instance, which keeps the MANIFEST open to
+  // follow the edits of the primary with CatchUpWithManifest()
+  Status RecoverAsSecondary(
+      const std::vector<ColumnFamilyDescriptor>& column_families);
+
+  // Apply the edits the primary has written to the MANIFEST since the last
+  // call, switching to a new MANIFEST if CURRENT points to one. The column
+  // families with new versions or log numbers are added to `cfds_changed`,
+  // `last_sequence` is set to the last sequence the MANIFEST records.
+  // REQUIRES: RecoverAsSecondary() succeeded, *mu is held
+  Status CatchUpWithManifest(
+      InstrumentedMutex* mu,
+      std::unordered_set<ColumnFamilyData*>* cfds_changed,
+      SequenceNumber* last_sequence);
+
   // Reads a manifest file and returns a list of column families in
   // column_families.
   static Status ListColumnFamilies(std::vector<std::string>* column_families,
@@ -1139,6 +1261,8 @@ class VersionSet {
 
  private:
   struct ManifestWriter;
+  struct ManifestTailer;
+  class ManifestEditReader;
 
   friend class Version;
   friend class DBImpl;
@@ -1175,6 +1299,15 @@ class VersionSet {
       bool* have_last_sequence, SequenceNumber* last_sequence,
       uint64_t* min_log_number_to_keep, uint32_t* max_column_family);
 
+  // CatchUpWithManifest() helper, `rebuild` is set once the edits come from
+  // a new MANIFEST
+  Status ApplyTailedEdit(
+      VersionEdit& edit, bool rebuild,
+      std::unordered_map<uint32_t,
+                         std::unique_ptr<BaseReferencedVersionBuilder>>*
+          builders,
+      std::unordered_set<ColumnFamilyData*>* cfds_changed);
+
   Status ProcessManifestWrites(std::deque<ManifestWriter>& writers,
                                InstrumentedMutex* mu, Directory* db_directory,
                                bool new_descriptor_log);
@@ -1232,6 +1365,9 @@ class VersionSet {
   // env options for all reads and writes except compactions
   EnvOptions env_options_;
 
+  // Reads the MANIFEST of the primary, only set for secondary instances
+  std::unique_ptr<ManifestTailer> manifest_tailer_;
+
   // No copying allowed
   VersionSet(const VersionSet&);
   void operator=(const VersionSet&);
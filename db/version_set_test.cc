@@ -416,6 +416,22 @@ TEST_F(VersionStorageInfoTest, GetOverlappingInputs) {
             GetOverlappingFiles(1, {"i", 0, kTypeValue}, {"j", 0, kTypeValue}));
 }
 
+TEST_F(VersionStorageInfoTest, Level0SubLevels) {
+  // Newest first
+  Add(0, 4U, "a", "c");
+  Add(0, 3U, "d", "f");
+  Add(0, 2U, "b", "e");
+  Add(0, 1U, "a", "z");
+  vstorage_.UpdateNumNonEmptyLevels();
+  vstorage_.GenerateLevel0SubLevels();
+  vstorage_.CalculateBaseBytes(ioptions_, mutable_cf_options_);
+
+  std::vector<std::vector<uint32_t>> expected = {{3}, {2}, {0, 1}};
+  ASSERT_EQ(expected, vstorage_.level0_sublevels());
+  ASSERT_EQ(4, vstorage_.l0_delay_trigger_count());
+  ASSERT_EQ(3, vstorage_.l0_sublevel_delay_trigger_count());
+}
+
 class FindLevelFileTest : public testing::Test {
  public:
   LevelFilesBrief file_level_;
@@ -0,0 +1,94 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/wal_syncer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+WalSyncer::WalSyncer(std::function<Status()> sync, uint64_t max_delay_us)
+    : sync_(std::move(sync)), max_delay_us_(max_delay_us) {
+  thread_ = port::Thread(&WalSyncer::BGThread, this);
+}
+
+WalSyncer::~WalSyncer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  request_cv_.notify_one();
+  thread_.join();
+}
+
+void WalSyncer::Request(SequenceNumber seq) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (seq <= requested_) {
+      return;
+    }
+    requested_ = seq;
+  }
+  request_cv_.notify_one();
+}
+
+Status WalSyncer::Wait(SequenceNumber seq) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  durable_cv_.wait(lock, [&] {
+    return durable_ >= seq || !error_.ok() || stopped_;
+  });
+  if (durable_ >= seq) {
+    return Status::OK();
+  }
+  if (!error_.ok()) {
+    return error_;
+  }
+  return Status::ShutdownInProgress("WAL syncer stopped");
+}
+
+SequenceNumber WalSyncer::DurableSequence() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return durable_;
+}
+
+uint64_t WalSyncer::NumSyncs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_syncs_;
+}
+
+void WalSyncer::BGThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    request_cv_.wait(lock, [&] { return stop_ || requested_ > durable_; });
+    if (requested_ <= durable_ || !error_.ok()) {
+      // Stopping with nothing left to sync, or nothing can be synced anymore
+      break;
+    }
+    if (max_delay_us_ > 0 && !stop_) {
+      auto deadline = std::chrono::steady_clock::now() +
+                      std::chrono::microseconds(max_delay_us_);
+      request_cv_.wait_until(lock, deadline, [&] { return stop_; });
+    }
+    // Everything requested so far is in the WAL already
+    SequenceNumber target = requested_;
+    lock.unlock();
+    Status s = sync_();
+    lock.lock();
+    ++num_syncs_;
+    if (s.ok()) {
+      durable_ = std::max(durable_, target);
+    } else {
+      error_ = s;
+    }
+    durable_cv_.notify_all();
+  }
+  stopped_ = true;
+  durable_cv_.notify_all();
+}
+
+}  // namespace TERARKDB_NAMESPACE
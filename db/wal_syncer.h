@@ -0,0 +1,65 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "port/port.h"
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/types.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// WalSyncer runs the WAL fsyncs of sync writes on its own thread, so the
+// write group leader that wrote them can exit the group right away.
+//
+// The leader calls Request() with the last sequence of its group after the
+// group is in the WAL, every sync writer then blocks in Wait() until the
+// durable watermark reaches its batch. The thread folds all the requests
+// pending when an fsync starts into that fsync, and with `max_delay_us` it
+// holds back up to that long after the first pending request to let more
+// groups join.
+class WalSyncer {
+ public:
+  // `sync` makes every WAL record written before the call durable
+  WalSyncer(std::function<Status()> sync, uint64_t max_delay_us);
+
+  // Syncs what is still pending, then joins the thread
+  ~WalSyncer();
+
+  // REQUIRES: the records up to `seq` have been written to the WAL
+  void Request(SequenceNumber seq);
+
+  // Block until `seq` is durable. Returns the error of the fsync that should
+  // have covered it, a failed fsync fails every later wait as well.
+  Status Wait(SequenceNumber seq);
+
+  SequenceNumber DurableSequence() const;
+  uint64_t NumSyncs() const;
+
+ private:
+  void BGThread();
+
+  const std::function<Status()> sync_;
+  const uint64_t max_delay_us_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable request_cv_;
+  std::condition_variable durable_cv_;
+  SequenceNumber requested_ = 0;
+  SequenceNumber durable_ = 0;
+  uint64_t num_syncs_ = 0;
+  Status error_;
+  bool stop_ = false;
+  bool stopped_ = false;
+  port::Thread thread_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
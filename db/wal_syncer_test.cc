@@ -0,0 +1,100 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/wal_syncer.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class WalSyncerTest : public testing::Test {};
+
+TEST_F(WalSyncerTest, Watermark) {
+  std::atomic<int> syncs{0};
+  WalSyncer syncer(
+      [&] {
+        ++syncs;
+        return Status::OK();
+      },
+      0);
+  ASSERT_EQ(0, syncer.DurableSequence());
+  syncer.Request(10);
+  ASSERT_OK(syncer.Wait(10));
+  ASSERT_GE(syncer.DurableSequence(), 10);
+  // Already durable
+  ASSERT_OK(syncer.Wait(5));
+  syncer.Request(8);
+  ASSERT_OK(syncer.Wait(10));
+  syncer.Request(20);
+  ASSERT_OK(syncer.Wait(15));
+  ASSERT_EQ(20, syncer.DurableSequence());
+  ASSERT_EQ(syncs.load(), syncer.NumSyncs());
+}
+
+TEST_F(WalSyncerTest, Coalesce) {
+  std::atomic<int> syncs{0};
+  // A long delay lets all the requests below share one fsync
+  WalSyncer syncer(
+      [&] {
+        ++syncs;
+        return Status::OK();
+      },
+      200000);
+  const int kThreads = 8;
+  std::vector<std::thread> threads;
+  for (int i = 1; i <= kThreads; ++i) {
+    threads.emplace_back([&syncer, i] {
+      syncer.Request(i);
+      ASSERT_OK(syncer.Wait(i));
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(kThreads, syncer.DurableSequence());
+  ASSERT_LT(syncs.load(), kThreads);
+}
+
+TEST_F(WalSyncerTest, Error) {
+  std::atomic<bool> fail{true};
+  WalSyncer syncer(
+      [&] { return fail ? Status::IOError("sync") : Status::OK(); }, 0);
+  syncer.Request(1);
+  ASSERT_TRUE(syncer.Wait(1).IsIOError());
+  // Errors are sticky
+  fail = false;
+  syncer.Request(2);
+  ASSERT_TRUE(syncer.Wait(2).IsIOError());
+  ASSERT_EQ(0, syncer.DurableSequence());
+}
+
+TEST_F(WalSyncerTest, SyncOnStop) {
+  std::atomic<int> syncs{0};
+  {
+    WalSyncer syncer(
+        [&] {
+          ++syncs;
+          return Status::OK();
+        },
+        10000000);
+    syncer.Request(1);
+  }
+  // The pending request is synced without waiting for the delay
+  ASSERT_EQ(1, syncs.load());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
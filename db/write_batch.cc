@@ -22,6 +22,8 @@
 //    kTypeColumnFamilySingleDeletion varint32 varstring
 //    kTypeColumnFamilyRangeDeletion varint32 varstring varstring
 //    kTypeColumnFamilyMerge varint32 varstring varstring
+//    kTypeValueIndex varstring varstring
+//    kTypeColumnFamilyValueIndex varint32 varstring varstring
 //    kTypeBeginPrepareXID varstring
 //    kTypeEndPrepareXID
 //    kTypeCommitXID varstring
@@ -48,6 +50,7 @@
 #include "db/memtable.h"
 #include "db/merge_context.h"
 #include "db/snapshot_impl.h"
+#include "db/value_log.h"
 #include "db/write_batch_internal.h"
 #include "monitoring/perf_context_imp.h"
 #include "monitoring/statistics.h"
@@ -105,6 +108,11 @@ struct BatchContentClassifier : public WriteBatch::Handler {
     return Status::OK();
   }
 
+  Status PutValueIndexCF(uint32_t, const Slice&, const Slice&) override {
+    content_flags |= ContentFlags::HAS_PUT;
+    return Status::OK();
+  }
+
   Status MarkBeginPrepare(bool unprepare) override {
     content_flags |= ContentFlags::HAS_BEGIN_PREPARE;
     if (unprepare) {
@@ -346,10 +354,19 @@ Status ReadRecordFromWriteBatch(Slice* input, char* tag,
         return Status::Corruption("bad WriteBatch Merge");
       }
       break;
+    case kTypeColumnFamilyValueIndex:
+      if (!GetVarint32(input, column_family)) {
+        return Status::Corruption("bad WriteBatch PutValueIndex");
+      }
+      FALLTHROUGH_INTENDED;
     case kTypeValueIndex:
+      if (!GetLengthPrefixedSlice(input, key) ||
+          !GetLengthPrefixedSlice(input, value)) {
+        return Status::Corruption("bad WriteBatch PutValueIndex");
+      }
+      break;
     case kTypeMergeIndex:
-      return Status::Corruption(
-          "WriteBatch don't contents ValueIndex or MergeIndex");
+      return Status::Corruption("WriteBatch don't contents MergeIndex");
     case kTypeLogData:
       assert(blob != nullptr);
       if (!GetLengthPrefixedSlice(input, blob)) {
@@ -483,9 +500,18 @@ Status WriteBatch::Iterate(Handler* handler) const {
           found++;
         }
         break;
+      case kTypeColumnFamilyValueIndex:
       case kTypeValueIndex:
+        assert(content_flags_.load(std::memory_order_relaxed) &
+               (ContentFlags::DEFERRED | ContentFlags::HAS_PUT));
+        s = handler->PutValueIndexCF(column_family, key, value);
+        if (LIKELY(s.ok())) {
+          empty_batch = false;
+          found++;
+        }
+        break;
       case kTypeMergeIndex:
-        // WriteBatch don't contents value index or merge index
+        // WriteBatch don't contents merge index
         assert(false);
         break;
       case kTypeLogData:
@@ -688,6 +714,128 @@ Status WriteBatch::Put(ColumnFamilyHandle* column_family, const SliceParts& key,
                                  value);
 }
 
+Status WriteBatchInternal::Put(WriteBatch* b, uint32_t column_family_id,
+                               const Slice& key, size_t value_size,
+                               const WriteBatch::ValueWriter& writer) {
+  if (key.size() > size_t{port::kMaxUint32}) {
+    return Status::InvalidArgument("key is too large");
+  }
+  if (value_size > size_t{port::kMaxUint32}) {
+    return Status::InvalidArgument("value is too large");
+  }
+
+  LocalSavePoint save(b);
+  WriteBatchInternal::SetCount(b, WriteBatchInternal::Count(b) + 1);
+  if (column_family_id == 0) {
+    b->rep_.push_back(static_cast<char>(kTypeValue));
+  } else {
+    b->rep_.push_back(static_cast<char>(kTypeColumnFamilyValue));
+    PutVarint32(&b->rep_, column_family_id);
+  }
+  PutLengthPrefixedSlice(&b->rep_, key);
+  PutVarint32(&b->rep_, static_cast<uint32_t>(value_size));
+  size_t offset = b->rep_.size();
+  b->rep_.resize(offset + value_size);
+  Status s = writer(&b->rep_[offset], value_size);
+  if (!s.ok()) {
+    save.rollback();
+    return s;
+  }
+  b->content_flags_.store(
+      b->content_flags_.load(std::memory_order_relaxed) | ContentFlags::HAS_PUT,
+      std::memory_order_relaxed);
+  return save.commit();
+}
+
+Status WriteBatch::Put(ColumnFamilyHandle* column_family, const Slice& key,
+                       size_t value_size, const ValueWriter& writer) {
+  return WriteBatchInternal::Put(this, GetColumnFamilyID(column_family), key,
+                                 value_size, writer);
+}
+
+namespace {
+void AppendValueIndex(std::string* rep, uint32_t column_family_id,
+                      const Slice& key, const Slice& index) {
+  if (column_family_id == 0) {
+    rep->push_back(static_cast<char>(kTypeValueIndex));
+  } else {
+    rep->push_back(static_cast<char>(kTypeColumnFamilyValueIndex));
+    PutVarint32(rep, column_family_id);
+  }
+  PutLengthPrefixedSlice(rep, key);
+  PutLengthPrefixedSlice(rep, index);
+}
+}  // namespace
+
+Status WriteBatchInternal::PutValueIndex(WriteBatch* b,
+                                         uint32_t column_family_id,
+                                         const Slice& key, const Slice& index) {
+  if (key.size() > size_t{port::kMaxUint32}) {
+    return Status::InvalidArgument("key is too large");
+  }
+
+  LocalSavePoint save(b);
+  WriteBatchInternal::SetCount(b, WriteBatchInternal::Count(b) + 1);
+  AppendValueIndex(&b->rep_, column_family_id, key, index);
+  b->content_flags_.store(
+      b->content_flags_.load(std::memory_order_relaxed) | ContentFlags::HAS_PUT,
+      std::memory_order_relaxed);
+  return save.commit();
+}
+
+Status WriteBatchInternal::SeparateValues(const WriteBatch* src,
+                                          size_t threshold,
+                                          const ValueSeparator& separator,
+                                          WriteBatch* dst, bool* separated) {
+  *separated = false;
+  Slice input(src->rep_);
+  if (input.size() < kHeader) {
+    return Status::Corruption("malformed WriteBatch (too small)");
+  }
+  input.remove_prefix(kHeader);
+  dst->rep_.assign(src->rep_.data(), kHeader);
+  // The records up to the next separated value are copied as they are
+  const char* pending = input.data();
+  std::string index;
+  char tag;
+  uint32_t column_family;
+  Slice key, value, blob, xid;
+  while (!input.empty()) {
+    const char* record = input.data();
+    Status s = ReadRecordFromWriteBatch(&input, &tag, &column_family, &key,
+                                        &value, &blob, &xid);
+    if (!s.ok()) {
+      return s;
+    }
+    if (tag == kTypeBeginPrepareXID || tag == kTypeBeginPersistedPrepareXID ||
+        tag == kTypeBeginUnprepareXID) {
+      // The recovery of a prepared transaction rebuilds it from its puts
+      *separated = false;
+      return Status::OK();
+    }
+    if ((tag != kTypeValue && tag != kTypeColumnFamilyValue) ||
+        value.size() < threshold) {
+      continue;
+    }
+    index.clear();
+    s = separator(value, &index);
+    if (!s.ok()) {
+      return s;
+    }
+    dst->rep_.append(pending, record - pending);
+    AppendValueIndex(&dst->rep_, column_family, key, index);
+    pending = input.data();
+    *separated = true;
+  }
+  dst->rep_.append(pending, input.data() - pending);
+  dst->content_flags_.store(
+      src->content_flags_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  return Status::OK();
+}
+
+void WriteBatch::Reserve(size_t bytes) { rep_.reserve(rep_.size() + bytes); }
+
 Status WriteBatchInternal::InsertNoop(WriteBatch* b) {
   b->rep_.push_back(static_cast<char>(kTypeNoop));
   return Status::OK();
@@ -1292,6 +1440,40 @@ class MemTableInserter : public WriteBatch::Handler {
     return PutCFImpl(column_family_id, key, value, kTypeValue);
   }
 
+  virtual Status PutValueIndexCF(uint32_t column_family_id, const Slice& key,
+                                 const Slice& index) override {
+    Status seek_status;
+    if (UNLIKELY(!SeekToColumnFamily(column_family_id, &seek_status))) {
+      MaybeAdvanceSeq();
+      return seek_status;
+    }
+    std::shared_ptr<ValueLog> log;
+    Status s = db_ != nullptr
+                   ? db_->GetValueLog(index, &log)
+                   : Status::Corruption("value index without a value log");
+    if (s.ok()) {
+      s = log->CheckIndex(index);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    MemTable* mem = cf_mems_->GetMemTable();
+    if (mem->GetImmutableMemTableOptions()->inplace_update_support ||
+        rebuilding_trx_ != nullptr) {
+      // Both need the value itself
+      LazyBuffer value = log->GetValue(index);
+      s = value.fetch();
+      if (!s.ok()) {
+        return s;
+      }
+      return PutCFImpl(column_family_id, key, value.slice(), kTypeValue);
+    }
+    uint64_t value_size = 0;
+    ValueLog::DecodeValueSize(index, &value_size);
+    mem->RefValueLog(log, value_size);
+    return PutCFImpl(column_family_id, key, index, kTypeValueIndex);
+  }
+
   Status DeleteImpl(uint32_t /*column_family_id*/, const Slice& key,
                     const Slice& value, ValueType delete_type) {
     Status ret_status;
@@ -1463,13 +1645,13 @@ class MemTableInserter : public WriteBatch::Handler {
     MemTable* mem = cf_mems_->GetMemTable();
     auto* moptions = mem->GetImmutableMemTableOptions();
     bool perform_merge = false;
+    // The value the new operand is applied to, nullptr if there is none
+    LazyBuffer* existing_value = nullptr;
+    LazyBuffer get_value;
 
-    // If we pass DB through and options.max_successive_merges is hit
-    // during recovery, Get() will be issued which will try to acquire
-    // DB mutex and cause deadlock, as DB mutex is already held.
-    // So we disable merge in recovery
-    if (moptions->max_successive_merges > 0 && db_ != nullptr &&
-        recovering_log_number_ == 0) {
+    if (moptions->max_successive_merges > 0) {
+      // Pass in the sequence number so that we also include previous merge
+      // operations in the same batch.
       LookupKey lkey(key, sequence_);
 
       // Count the number of successive merges at the head
@@ -1477,27 +1659,44 @@ class MemTableInserter : public WriteBatch::Handler {
       size_t num_merges = mem->CountSuccessiveMergeEntries(lkey);
 
       if (num_merges >= moptions->max_successive_merges) {
-        perform_merge = true;
+        // 1) Get the existing value. Hot keys usually have their base value
+        // in the active memtable, then the chain is folded from the memtable
+        // alone. Everything outside of it is older, so a value or deletion
+        // found here shadows the rest of the DB.
+        Status get_status;
+        MergeContext merge_context;
+        SequenceNumber max_covering_tombstone_seq = 0;
+        if (mem->Get(lkey, &get_value, &get_status, &merge_context,
+                     &max_covering_tombstone_seq, ReadOptions())) {
+          if (get_status.ok()) {
+            perform_merge = true;
+            existing_value = &get_value;
+          } else if (get_status.IsNotFound()) {
+            perform_merge = true;
+          }
+        } else if (db_ != nullptr && recovering_log_number_ == 0) {
+          // If we pass DB through and options.max_successive_merges is hit
+          // during recovery, Get() will be issued which will try to acquire
+          // DB mutex and cause deadlock, as DB mutex is already held.
+          // So we only look out of the memtable after recovery
+          SnapshotImpl read_from_snapshot;
+          read_from_snapshot.number_ = sequence_;
+          ReadOptions read_options;
+          read_options.snapshot = &read_from_snapshot;
+
+          auto cf_handle = cf_mems_->GetColumnFamilyHandle();
+          if (cf_handle == nullptr) {
+            cf_handle = db_->DefaultColumnFamily();
+          }
+          get_value.clear();
+          db_->Get(read_options, cf_handle, key, &get_value);
+          perform_merge = true;
+          existing_value = &get_value;
+        }
       }
     }
 
     if (perform_merge) {
-      // 1) Get the existing value
-      LazyBuffer get_value;
-
-      // Pass in the sequence number so that we also include previous merge
-      // operations in the same batch.
-      SnapshotImpl read_from_snapshot;
-      read_from_snapshot.number_ = sequence_;
-      ReadOptions read_options;
-      read_options.snapshot = &read_from_snapshot;
-
-      auto cf_handle = cf_mems_->GetColumnFamilyHandle();
-      if (cf_handle == nullptr) {
-        cf_handle = db_->DefaultColumnFamily();
-      }
-      db_->Get(read_options, cf_handle, key, &get_value);
-
       // 2) Apply this merge
       auto merge_operator = moptions->merge_operator;
       assert(merge_operator);
@@ -1507,7 +1706,7 @@ class MemTableInserter : public WriteBatch::Handler {
       operands.emplace_back(value);
 
       Status merge_status = MergeHelper::TimedFullMerge(
-          merge_operator, key, &get_value, operands, &new_value,
+          merge_operator, key, existing_value, operands, &new_value,
           moptions->info_log, moptions->statistics, Env::Default());
 
       if (!merge_status.ok()) {
@@ -8,6 +8,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #pragma once
+#include <functional>
 #include <vector>
 
 #include "db/write_thread.h"
@@ -75,6 +76,10 @@ class WriteBatchInternal {
   static Status Put(WriteBatch* batch, uint32_t column_family_id,
                     const SliceParts& key, const SliceParts& value);
 
+  static Status Put(WriteBatch* batch, uint32_t column_family_id,
+                    const Slice& key, size_t value_size,
+                    const WriteBatch::ValueWriter& writer);
+
   static Status Delete(WriteBatch* batch, uint32_t column_family_id,
                        const SliceParts& key);
 
@@ -100,6 +105,22 @@ class WriteBatchInternal {
   static Status Merge(WriteBatch* batch, uint32_t column_family_id,
                       const SliceParts& key, const SliceParts& value);
 
+  // A put of a value the value log `index` points into
+  static Status PutValueIndex(WriteBatch* batch, uint32_t column_family_id,
+                              const Slice& key, const Slice& index);
+
+  // Writes the value and returns its value index
+  using ValueSeparator =
+      std::function<Status(const Slice& value, std::string* index)>;
+
+  // Copies src to dst with the puts of values of at least threshold bytes
+  // turned into puts of the value indexes `separator` returns for them.
+  // `separated` is whether any was, a batch of a prepared transaction is
+  // never separated.
+  static Status SeparateValues(const WriteBatch* src, size_t threshold,
+                               const ValueSeparator& separator,
+                               WriteBatch* dst, bool* separated);
+
   static Status MarkEndPrepare(WriteBatch* batch, const Slice& xid,
                                const bool write_after_commit = true,
                                const bool unprepared_batch = false);
@@ -223,6 +244,17 @@ class LocalSavePoint {
     return Status::OK();
   }
 
+  // Drop everything appended since the construction
+  void rollback() {
+#ifndef NDEBUG
+    committed_ = true;
+#endif
+    batch_->rep_.resize(savepoint_.size);
+    WriteBatchInternal::SetCount(batch_, savepoint_.count);
+    batch_->content_flags_.store(savepoint_.content_flags,
+                                 std::memory_order_relaxed);
+  }
+
  private:
   WriteBatch* batch_;
   SavePoint savepoint_;
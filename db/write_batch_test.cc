@@ -617,6 +617,34 @@ TEST_F(WriteBatchTest, PutGatherSlices) {
   ASSERT_EQ(3, batch.Count());
 }
 
+TEST_F(WriteBatchTest, PutWithValueWriter) {
+  WriteBatch batch;
+  batch.Reserve(2 * WriteBatch::kMaxEntryOverhead + 64);
+  size_t capacity = batch.Data().capacity();
+  ASSERT_OK(batch.Put("foo", 6, [](char* dst, size_t size) {
+    memcpy(dst, "barbaz", size);
+    return Status::OK();
+  }));
+  ASSERT_OK(batch.Put("empty", 0, [](char* /*dst*/, size_t size) {
+    EXPECT_EQ(0, size);
+    return Status::OK();
+  }));
+  // A failed writer leaves the batch as it was
+  Status s = batch.Put("bad", 3, [](char* /*dst*/, size_t /*size*/) {
+    return Status::Aborted("serialization failed");
+  });
+  ASSERT_TRUE(s.IsAborted());
+  ASSERT_EQ(capacity, batch.Data().capacity());
+
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(
+      "Put(empty, )@101"
+      "Put(foo, barbaz)@100",
+      PrintContents(&batch));
+  ASSERT_EQ(2, batch.Count());
+  ASSERT_TRUE(batch.HasPut());
+}
+
 namespace {
 class ColumnFamilyHandleImplDummy : public ColumnFamilyHandleImpl {
  public:
@@ -901,6 +929,12 @@ TEST_F(WriteBatchTest, MemoryLimitTest) {
   ASSERT_OK(batch.Put("b", "...."));
   s = batch.Put("c", "....");
   ASSERT_TRUE(s.IsMemoryLimit());
+  s = batch.Put("c", 4, [](char* dst, size_t size) {
+    memset(dst, '.', size);
+    return Status::OK();
+  });
+  ASSERT_TRUE(s.IsMemoryLimit());
+  ASSERT_EQ(2, batch.Count());
 }
 
 }  // namespace TERARKDB_NAMESPACE
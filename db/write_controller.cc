@@ -16,12 +16,14 @@ namespace TERARKDB_NAMESPACE {
 
 std::unique_ptr<WriteControllerToken> WriteController::GetStopToken() {
   ++total_stopped_;
+  AddStalledChild(1);
   return std::unique_ptr<WriteControllerToken>(new StopWriteToken(this));
 }
 
 std::unique_ptr<WriteControllerToken> WriteController::GetDelayToken(
     uint64_t write_rate) {
   total_delayed_++;
+  AddStalledChild(1);
   // Reset counters.
   last_refill_time_ = 0;
   bytes_left_ = 0;
@@ -32,6 +34,9 @@ std::unique_ptr<WriteControllerToken> WriteController::GetDelayToken(
 std::unique_ptr<WriteControllerToken>
 WriteController::GetCompactionPressureToken() {
   ++total_compaction_pressure_;
+  if (parent_ != nullptr) {
+    parent_->AddCompactionPressure(1);
+  }
   return std::unique_ptr<WriteControllerToken>(
       new CompactionPressureToken(this));
 }
@@ -112,19 +117,39 @@ uint64_t WriteController::NowMicrosMonotonic(Env* env) {
   return env->NowNanos() / std::milli::den;
 }
 
+void WriteController::AddStalledChild(int delta) {
+  if (parent_ != nullptr) {
+    parent_->total_stalled_children_ += delta;
+    assert(parent_->total_stalled_children_ >= 0);
+    // A stalled column family needs its compactions sped up as much as a
+    // stalled DB does
+    parent_->AddCompactionPressure(delta);
+  }
+}
+
+void WriteController::AddCompactionPressure(int delta) {
+  total_compaction_pressure_ += delta;
+  assert(total_compaction_pressure_ >= 0);
+}
+
 StopWriteToken::~StopWriteToken() {
   assert(controller_->total_stopped_ >= 1);
   --controller_->total_stopped_;
+  controller_->AddStalledChild(-1);
 }
 
 DelayWriteToken::~DelayWriteToken() {
   controller_->total_delayed_--;
   assert(controller_->total_delayed_.load() >= 0);
+  controller_->AddStalledChild(-1);
 }
 
 CompactionPressureToken::~CompactionPressureToken() {
   controller_->total_compaction_pressure_--;
   assert(controller_->total_compaction_pressure_ >= 0);
+  if (controller_->parent_ != nullptr) {
+    controller_->parent_->AddCompactionPressure(-1);
+  }
 }
 
 }  // namespace TERARKDB_NAMESPACE
@@ -26,15 +26,25 @@ class WriteController {
  public:
   explicit WriteController(uint64_t _delayed_write_rate = 1024u * 1024u * 32u,
                            int64_t low_pri_rate_bytes_per_sec = 1024 * 1024)
-      : total_stopped_(0),
+      : parent_(nullptr),
+        total_stopped_(0),
         total_delayed_(0),
         total_compaction_pressure_(0),
+        total_stalled_children_(0),
         bytes_left_(0),
         last_refill_time_(0),
         low_pri_rate_limiter_(
             NewGenericRateLimiter(low_pri_rate_bytes_per_sec)) {
     set_max_delayed_write_rate(_delayed_write_rate);
   }
+  // A controller for the write stalls of a single column family. Its stop
+  // and delay tokens only hold up the writes to that column family, they
+  // count as stalled children and as compaction pressure in `parent`, which
+  // has to outlive it.
+  explicit WriteController(WriteController* parent)
+      : WriteController(parent->max_delayed_write_rate()) {
+    parent_ = parent;
+  }
   ~WriteController() = default;
 
   // When an actor (column family) requests a stop token, all writes will be
@@ -56,6 +66,11 @@ class WriteController {
   bool NeedSpeedupCompaction() const {
     return IsStopped() || NeedsDelay() || total_compaction_pressure_ > 0;
   }
+  // Whether a child controller has a stop or delay token. Can be called
+  // without holding DB mutex.
+  bool HasStalledChildren() const {
+    return total_stalled_children_.load(std::memory_order_relaxed) > 0;
+  }
   // return how many microseconds the caller needs to sleep after the call
   // num_bytes: how many number of bytes to put into the DB.
   // Prerequisite: DB mutex held.
@@ -89,14 +104,20 @@ class WriteController {
  private:
   uint64_t NowMicrosMonotonic(Env* env);
 
+  // Account a stop or delay token of this child controller in parent_
+  void AddStalledChild(int delta);
+  void AddCompactionPressure(int delta);
+
   friend class WriteControllerToken;
   friend class StopWriteToken;
   friend class DelayWriteToken;
   friend class CompactionPressureToken;
 
+  WriteController* parent_;
   std::atomic<int> total_stopped_;
   std::atomic<int> total_delayed_;
   std::atomic<int> total_compaction_pressure_;
+  std::atomic<int> total_stalled_children_;
   uint64_t bytes_left_;
   uint64_t last_refill_time_;
   // write rate set when initialization or by `DBImpl::SetDBOptions`
@@ -128,6 +128,42 @@ TEST_F(WriteControllerTest, SanityTest) {
   ASSERT_FALSE(controller.IsStopped());
 }
 
+TEST_F(WriteControllerTest, ColumnFamilyController) {
+  TimeSetEnv env;
+  WriteController controller(10000000u);
+  WriteController cf_controller(&controller);
+  WriteController other_cf_controller(&controller);
+  ASSERT_EQ(10000000u, cf_controller.max_delayed_write_rate());
+
+  // A stopped column family doesn't stop the DB
+  auto stop_token = cf_controller.GetStopToken();
+  ASSERT_TRUE(cf_controller.IsStopped());
+  ASSERT_FALSE(other_cf_controller.IsStopped());
+  ASSERT_FALSE(controller.IsStopped());
+  ASSERT_TRUE(controller.HasStalledChildren());
+  ASSERT_TRUE(controller.NeedSpeedupCompaction());
+  stop_token.reset();
+  ASSERT_FALSE(controller.HasStalledChildren());
+  ASSERT_FALSE(controller.NeedSpeedupCompaction());
+
+  // Each column family is delayed at its own rate
+  auto delay_token = cf_controller.GetDelayToken(1000000u);
+  ASSERT_FALSE(controller.NeedsDelay());
+  ASSERT_TRUE(controller.HasStalledChildren());
+  ASSERT_EQ(0u, controller.GetDelay(&env, 20000000u));
+  ASSERT_EQ(0u, other_cf_controller.GetDelay(&env, 20000000u));
+  ASSERT_EQ(20000000u, cf_controller.GetDelay(&env, 20000000u));
+  delay_token.reset();
+  ASSERT_FALSE(controller.HasStalledChildren());
+
+  // Compaction pressure of a column family goes to the DB
+  auto pressure_token = other_cf_controller.GetCompactionPressureToken();
+  ASSERT_FALSE(controller.HasStalledChildren());
+  ASSERT_TRUE(controller.NeedSpeedupCompaction());
+  pressure_token.reset();
+  ASSERT_FALSE(controller.NeedSpeedupCompaction());
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
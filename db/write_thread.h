@@ -11,6 +11,7 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <type_traits>
 #include <vector>
@@ -28,6 +29,10 @@
 
 namespace TERARKDB_NAMESPACE {
 
+namespace log {
+class Writer;
+}  // namespace log
+
 class WriteThread {
  public:
   enum State : uint8_t {
@@ -129,6 +134,17 @@ class WriteThread {
     std::atomic<uint8_t> state;  // write under StateMutex() or pre-link
     WriteGroup* write_group;
     SequenceNumber sequence;  // the sequence number to use for the first key
+    // With async WAL sync, the sequence that must be durable before the write
+    // returns, 0 if there is nothing to wait for
+    SequenceNumber sync_sequence;
+    // With DBOptions::wal_streams, the WAL stream this writer appends the
+    // batches of its run of wal_stream_writers writers to, nullptr if the
+    // leader writes the WAL for the whole group
+    log::Writer* wal_stream;
+    size_t wal_stream_writers;
+    // With DBOptions::value_log_threshold, the copy of the batch with its
+    // large values replaced by their value indexes, which batch then points to
+    std::unique_ptr<WriteBatch> value_log_batch;
     Status status;
     Status callback_status;   // status returned by callback->Callback()
 
@@ -152,6 +168,9 @@ class WriteThread {
           state(STATE_INIT),
           write_group(nullptr),
           sequence(kMaxSequenceNumber),
+          sync_sequence(0),
+          wal_stream(nullptr),
+          wal_stream_writers(0),
           link_older(nullptr),
           link_newer(nullptr) {}
 
@@ -173,6 +192,9 @@ class WriteThread {
           state(STATE_INIT),
           write_group(nullptr),
           sequence(kMaxSequenceNumber),
+          sync_sequence(0),
+          wal_stream(nullptr),
+          wal_stream_writers(0),
           link_older(nullptr),
           link_newer(nullptr) {}
 
@@ -0,0 +1,200 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/zone_gc_picker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+class GreedyZoneVictimPolicy : public ZoneVictimPolicy {
+ public:
+  const char* Name() const override { return "GreedyZoneVictimPolicy"; }
+
+  double Score(const ZoneVictimCandidate& zone) const override {
+    return zone.GarbageRate();
+  }
+};
+
+class CostBenefitZoneVictimPolicy : public ZoneVictimPolicy {
+ public:
+  explicit CostBenefitZoneVictimPolicy(double hotness_weight)
+      : hotness_weight_(std::max(0.0, hotness_weight)) {}
+
+  const char* Name() const override { return "CostBenefitZoneVictimPolicy"; }
+
+  double Score(const ZoneVictimCandidate& zone) const override {
+    if (zone.max_capacity == 0) {
+      return -1;
+    }
+    // benefit: garbage released, weighted by how long the data stayed cold
+    // cost: read the valid bytes + write them to another zone
+    double u = zone.ValidRate();
+    double age_sec = static_cast<double>(zone.age_micros) / 1000000 + 1;
+    double score = zone.GarbageRate() * age_sec / (1 + u);
+    return score / (1 + hotness_weight_ * zone.hotness);
+  }
+
+ private:
+  double hotness_weight_;
+};
+
+}  // namespace
+
+std::shared_ptr<ZoneVictimPolicy> NewGreedyZoneVictimPolicy() {
+  return std::make_shared<GreedyZoneVictimPolicy>();
+}
+
+std::shared_ptr<ZoneVictimPolicy> NewCostBenefitZoneVictimPolicy(
+    double hotness_weight) {
+  return std::make_shared<CostBenefitZoneVictimPolicy>(hotness_weight);
+}
+
+std::string ZoneGCPickStats::ToString() const {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "zones=%zu sealed=%zu picked=%zu reset=%zu budget=%zu copy=%" PRIu64
+           "MiB reclaim=%" PRIu64 "MiB free_ratio=%.4lf pressure=%.4lf",
+           total_zones, sealed_zones, picked_zones, reset_zones, budget,
+           copy_bytes >> 20, reclaim_bytes >> 20, free_ratio, pressure);
+  return buf;
+}
+
+ZoneGCPicker::ZoneGCPicker(std::shared_ptr<ZoneVictimPolicy> policy)
+    : policy_(policy != nullptr ? std::move(policy)
+                                : NewCostBenefitZoneVictimPolicy()),
+      last_budget_(0) {}
+
+void ZoneGCPicker::UpdateHistory(std::vector<ZoneVictimCandidate>* zones,
+                                 uint64_t now_micros) {
+  const double kMicrosPerMinute = 60.0 * 1000000;
+  for (auto& zone : *zones) {
+    if (zone.free_bytes > 0) {
+      // Zone is still open, or has been reset since last round
+      history_.erase(zone.start);
+      continue;
+    }
+    auto ib = history_.emplace(
+        zone.start, ZoneHistory{now_micros, now_micros, zone.reclaim_bytes, 0});
+    auto& h = ib.first->second;
+    if (!ib.second && now_micros > h.last_micros && zone.max_capacity > 0) {
+      uint64_t invalidated = zone.reclaim_bytes > h.last_reclaim
+                                 ? zone.reclaim_bytes - h.last_reclaim
+                                 : 0;
+      double rate = double(invalidated) / zone.max_capacity /
+                    (double(now_micros - h.last_micros) / kMicrosPerMinute);
+      h.hotness = (h.hotness + rate) / 2;
+      h.last_micros = now_micros;
+      h.last_reclaim = zone.reclaim_bytes;
+    }
+    zone.age_micros = now_micros - h.sealed_micros;
+    zone.hotness = h.hotness;
+  }
+}
+
+void ZoneGCPicker::Pick(std::vector<ZoneVictimCandidate>* zones,
+                        uint64_t free_bytes, uint64_t total_bytes,
+                        uint64_t now_micros,
+                        const ZoneGCPickerOptions& options,
+                        std::vector<uint64_t>* picked,
+                        ZoneGCPickStats* stats) {
+  assert(zones != nullptr && picked != nullptr);
+  ZoneGCPickStats local_stats;
+  if (stats == nullptr) {
+    stats = &local_stats;
+  }
+  *stats = ZoneGCPickStats();
+  picked->clear();
+
+  UpdateHistory(zones, now_micros);
+  stats->total_zones = zones->size();
+
+  uint64_t capacity = free_bytes + total_bytes;
+  if (capacity == 0 || options.max_zones_per_run == 0) {
+    return;
+  }
+  // Fully invalidated zones are reset whatever the headroom
+  for (const auto& zone : *zones) {
+    if (zone.free_bytes == 0 && zone.valid_bytes == 0 &&
+        zone.reclaim_bytes > 0) {
+      picked->emplace_back(zone.start);
+      stats->reclaim_bytes += zone.reclaim_bytes;
+    }
+  }
+  stats->reset_zones = picked->size();
+  stats->picked_zones = picked->size();
+  double target = options.free_ratio_target;
+  double high_watermark = target * (1 + std::max(0.0, options.free_ratio_slack));
+  double free_ratio = double(free_bytes) / capacity;
+  stats->free_ratio = free_ratio;
+
+  size_t budget;
+  uint64_t need = 0;
+  double min_garbage_ratio = 0;
+  if (free_ratio >= high_watermark) {
+    last_budget_ = 0;
+    return;
+  } else if (free_ratio >= target) {
+    // Trickle mode, clean the obvious victims only
+    budget = 1;
+    min_garbage_ratio = options.min_garbage_ratio;
+  } else {
+    double pressure = target > 0 ? (target - free_ratio) / target : 1;
+    stats->pressure = pressure;
+    budget = static_cast<size_t>(
+        std::ceil(options.max_zones_per_run * pressure));
+    if (free_ratio >= target / 2) {
+      budget = std::min(budget, last_budget_ * 2 + 1);
+    }
+    need = static_cast<uint64_t>(capacity * target) - free_bytes;
+  }
+  budget = std::max<size_t>(1, std::min(budget, options.max_zones_per_run));
+  stats->budget = budget;
+
+  std::vector<std::pair<double, const ZoneVictimCandidate*>> candidates;
+  for (const auto& zone : *zones) {
+    if (zone.free_bytes > 0) {
+      continue;
+    }
+    ++stats->sealed_zones;
+    if (zone.valid_bytes == 0 || zone.reclaim_bytes == 0 ||
+        zone.GarbageRate() < min_garbage_ratio) {
+      continue;
+    }
+    double score = policy_->Score(zone);
+    if (score >= 0) {
+      candidates.emplace_back(score, &zone);
+    }
+  }
+  size_t top = std::min(budget, candidates.size());
+  std::partial_sort(
+      candidates.begin(), candidates.begin() + top, candidates.end(),
+      [](const std::pair<double, const ZoneVictimCandidate*>& l,
+         const std::pair<double, const ZoneVictimCandidate*>& r) {
+        return l.first > r.first;
+      });
+
+  for (size_t i = 0; i < top; ++i) {
+    if (need > 0 && stats->reclaim_bytes >= need) {
+      break;
+    }
+    const ZoneVictimCandidate* zone = candidates[i].second;
+    picked->emplace_back(zone->start);
+    stats->copy_bytes += zone->valid_bytes;
+    stats->reclaim_bytes += zone->reclaim_bytes;
+  }
+  stats->picked_zones = picked->size();
+  last_budget_ = picked->size() - stats->reset_zones;
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,93 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/zone_victim_policy.h"
+
+namespace TERARKDB_NAMESPACE {
+
+struct ZoneGCPickerOptions {
+  // Free capacity ratio the picker tries to keep on the device
+  double free_ratio_target = 0.15;
+  // Above `free_ratio_target * (1 + free_ratio_slack)` GC stays idle. Inside
+  // the band only one zone with at least `min_garbage_ratio` garbage is
+  // migrated per round, which spreads GC work over time instead of waiting
+  // for the target to be crossed and then bursting.
+  double free_ratio_slack = 0.5;
+  double min_garbage_ratio = 0.6;
+  // Upper bound of migrated zones per round
+  size_t max_zones_per_run = 5;
+};
+
+struct ZoneGCPickStats {
+  size_t total_zones = 0;
+  size_t sealed_zones = 0;
+  size_t picked_zones = 0;
+  // Picked zones without valid bytes, which only need a reset
+  size_t reset_zones = 0;
+  uint64_t copy_bytes = 0;
+  uint64_t reclaim_bytes = 0;
+  size_t budget = 0;
+  double free_ratio = 0;
+  double pressure = 0;
+
+  std::string ToString() const;
+};
+
+// ZoneGCPicker decides how many and which zones a zone GC round migrates.
+//
+// The number of zones is driven by the free capacity headroom: the further
+// the device is below `free_ratio_target`, the larger the budget. Growth of
+// the budget between two rounds is limited so that a sudden drop of free
+// space ramps GC up over a few rounds rather than stalling foreground writes
+// with one huge migration, unless free space is below half of the target.
+//
+// Sealed zones left without valid bytes, by deletions or by earlier rounds,
+// are picked ahead of the others in every round, outside of the budget and
+// the watermarks, as resetting them copies nothing.
+//
+// The picker keeps per-zone history across rounds to derive zone age and
+// hotness for the victim policy. It is not thread safe, all calls are
+// expected to come from the single GC thread.
+class ZoneGCPicker {
+ public:
+  explicit ZoneGCPicker(std::shared_ptr<ZoneVictimPolicy> policy);
+
+  const ZoneVictimPolicy* policy() const { return policy_.get(); }
+
+  // `zones` holds every zone of the device, `free_bytes` and `total_bytes`
+  // are the device level free and written (valid + garbage) bytes.
+  // Fills age and hotness of `zones` and returns the start positions of
+  // picked zones through `picked`, best victim first.
+  void Pick(std::vector<ZoneVictimCandidate>* zones, uint64_t free_bytes,
+            uint64_t total_bytes, uint64_t now_micros,
+            const ZoneGCPickerOptions& options, std::vector<uint64_t>* picked,
+            ZoneGCPickStats* stats);
+
+ private:
+  struct ZoneHistory {
+    uint64_t sealed_micros;
+    uint64_t last_micros;
+    uint64_t last_reclaim;
+    double hotness;
+  };
+
+  void UpdateHistory(std::vector<ZoneVictimCandidate>* zones,
+                     uint64_t now_micros);
+
+  std::shared_ptr<ZoneVictimPolicy> policy_;
+  std::unordered_map<uint64_t, ZoneHistory> history_;
+  size_t last_budget_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
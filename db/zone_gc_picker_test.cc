@@ -0,0 +1,197 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/zone_gc_picker.h"
+
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class ZoneGCPickerTest : public testing::Test {
+ public:
+  static constexpr uint64_t kZoneSize = 1ull << 30;
+  static constexpr uint64_t kMinute = 60ull * 1000000;
+
+  ZoneVictimCandidate Zone(uint64_t id, uint64_t free, uint64_t valid) {
+    ZoneVictimCandidate z;
+    z.zone_id = id;
+    z.start = id * kZoneSize;
+    z.max_capacity = kZoneSize;
+    z.free_bytes = free;
+    z.valid_bytes = valid;
+    z.reclaim_bytes = kZoneSize - free - valid;
+    return z;
+  }
+
+  // free/total as computed by DBImpl::GetZenFSStatistics
+  void Totals(const std::vector<ZoneVictimCandidate>& zones, uint64_t* free,
+              uint64_t* total) {
+    *free = *total = 0;
+    for (auto& z : zones) {
+      *free += z.free_bytes;
+      *total += z.valid_bytes + z.reclaim_bytes;
+    }
+  }
+};
+
+TEST_F(ZoneGCPickerTest, IdleWithEnoughHeadroom) {
+  ZoneGCPicker picker(NewGreedyZoneVictimPolicy());
+  std::vector<ZoneVictimCandidate> zones;
+  for (uint64_t i = 0; i < 10; ++i) {
+    zones.push_back(i < 5 ? Zone(i, kZoneSize, 0) : Zone(i, 0, kZoneSize / 2));
+  }
+  uint64_t free, total;
+  Totals(zones, &free, &total);
+  std::vector<uint64_t> picked;
+  ZoneGCPickStats stats;
+  picker.Pick(&zones, free, total, 0, ZoneGCPickerOptions(), &picked, &stats);
+  ASSERT_TRUE(picked.empty());
+  ASSERT_EQ(0, stats.budget);
+}
+
+TEST_F(ZoneGCPickerTest, BudgetFollowsPressure) {
+  ZoneGCPicker picker(NewGreedyZoneVictimPolicy());
+  std::vector<ZoneVictimCandidate> zones;
+  // 2 empty zones out of 20, all others sealed with growing garbage
+  for (uint64_t i = 0; i < 20; ++i) {
+    zones.push_back(i < 2 ? Zone(i, kZoneSize, 0)
+                          : Zone(i, 0, kZoneSize / 20 * (20 - i)));
+  }
+  uint64_t free, total;
+  Totals(zones, &free, &total);
+  ZoneGCPickerOptions options;
+  options.max_zones_per_run = 8;
+
+  std::vector<uint64_t> picked;
+  ZoneGCPickStats stats;
+  picker.Pick(&zones, free, total, 0, options, &picked, &stats);
+  // Free ratio 10% is above half of the 15% target, the first round ramps up
+  ASSERT_EQ(1, stats.budget);
+  ASSERT_EQ(1, picked.size());
+  ASSERT_EQ(19 * kZoneSize, picked[0]);
+
+  // Budget grows, but picking stops once the target would be reached
+  picker.Pick(&zones, free, total, kMinute, options, &picked, &stats);
+  ASSERT_EQ(3, stats.budget);
+  ASSERT_EQ(2, picked.size());
+  ASSERT_EQ(19 * kZoneSize, picked[0]);
+  ASSERT_EQ(18 * kZoneSize, picked[1]);
+
+  // Below half of the target there is no ramp up
+  ZoneGCPicker emergency_picker(NewGreedyZoneVictimPolicy());
+  zones[1] = Zone(1, 0, kZoneSize);
+  Totals(zones, &free, &total);
+  emergency_picker.Pick(&zones, free, total, 0, options, &picked, &stats);
+  ASSERT_EQ(6, stats.budget);
+  ASSERT_EQ(3, picked.size());
+}
+
+TEST_F(ZoneGCPickerTest, TrickleOnlyGarbageZones) {
+  ZoneGCPicker picker(NewGreedyZoneVictimPolicy());
+  std::vector<ZoneVictimCandidate> zones;
+  // 18% free: between target and high watermark
+  for (uint64_t i = 0; i < 100; ++i) {
+    zones.push_back(i < 18 ? Zone(i, kZoneSize, 0)
+                           : Zone(i, 0, kZoneSize / 2));
+  }
+  uint64_t free, total;
+  Totals(zones, &free, &total);
+  std::vector<uint64_t> picked;
+  picker.Pick(&zones, free, total, 0, ZoneGCPickerOptions(), &picked, nullptr);
+  ASSERT_TRUE(picked.empty());
+
+  zones[50] = Zone(50, 0, kZoneSize / 10);
+  picker.Pick(&zones, free, total, 0, ZoneGCPickerOptions(), &picked, nullptr);
+  ASSERT_EQ(1, picked.size());
+  ASSERT_EQ(50 * kZoneSize, picked[0]);
+}
+
+TEST_F(ZoneGCPickerTest, ResetEmptyZonesFirst) {
+  ZoneGCPicker picker(NewGreedyZoneVictimPolicy());
+  std::vector<ZoneVictimCandidate> zones;
+  for (uint64_t i = 0; i < 10; ++i) {
+    zones.push_back(i < 5 ? Zone(i, kZoneSize, 0) : Zone(i, 0, kZoneSize / 2));
+  }
+  // Every file in zone 7 was deleted
+  zones[7] = Zone(7, 0, 0);
+  uint64_t free, total;
+  Totals(zones, &free, &total);
+  std::vector<uint64_t> picked;
+  ZoneGCPickStats stats;
+  // Reset even with enough headroom
+  picker.Pick(&zones, free, total, 0, ZoneGCPickerOptions(), &picked, &stats);
+  ASSERT_EQ(1U, picked.size());
+  ASSERT_EQ(7 * kZoneSize, picked[0]);
+  ASSERT_EQ(1U, stats.reset_zones);
+  ASSERT_EQ(0U, stats.copy_bytes);
+  ASSERT_EQ(kZoneSize, stats.reclaim_bytes);
+
+  // Under pressure the resets come on top of the budget
+  for (uint64_t i = 0; i < 5; ++i) {
+    zones[i] = Zone(i, 0, kZoneSize / 10 * (i + 3));
+  }
+  zones[2] = Zone(2, 0, 0);
+  Totals(zones, &free, &total);
+  ZoneGCPickerOptions options;
+  options.free_ratio_target = 0.5;
+  options.max_zones_per_run = 1;
+  picker.Pick(&zones, free, total, kMinute, options, &picked, &stats);
+  ASSERT_EQ(1U, stats.budget);
+  ASSERT_EQ(2U, stats.reset_zones);
+  ASSERT_EQ(3U, picked.size());
+  ASSERT_EQ(2 * kZoneSize, picked[0]);
+  ASSERT_EQ(7 * kZoneSize, picked[1]);
+  ASSERT_EQ(0, picked[2]);
+}
+
+TEST_F(ZoneGCPickerTest, CostBenefitPrefersColdZones) {
+  ZoneGCPicker picker(NewCostBenefitZoneVictimPolicy());
+  std::vector<ZoneVictimCandidate> zones;
+  zones.push_back(Zone(0, 0, kZoneSize / 2));
+  zones.push_back(Zone(1, 0, kZoneSize / 4));
+  for (uint64_t i = 2; i < 40; ++i) {
+    zones.push_back(Zone(i, 0, kZoneSize));
+  }
+  uint64_t free, total;
+  Totals(zones, &free, &total);
+  ZoneGCPickerOptions options;
+  options.max_zones_per_run = 1;
+  std::vector<uint64_t> picked;
+
+  picker.Pick(&zones, free, total, 0, options, &picked, nullptr);
+  ASSERT_EQ(1, picked.size());
+  ASSERT_EQ(1 * kZoneSize, picked[0]);
+
+  // Zone 0 catches up on garbage, but it is still being invalidated while
+  // zone 1 is cold
+  zones[0] = Zone(0, 0, kZoneSize / 4);
+  picker.Pick(&zones, free, total, kMinute, options, &picked, nullptr);
+  ASSERT_GT(zones[0].hotness, zones[1].hotness);
+  ASSERT_EQ(kMinute, zones[0].age_micros);
+  ASSERT_EQ(1, picked.size());
+  ASSERT_EQ(1 * kZoneSize, picked[0]);
+
+  // Zone 0 is reset and reused
+  zones[1] = Zone(1, kZoneSize, 0);
+  picker.Pick(&zones, free, total, 2 * kMinute, options, &picked, nullptr);
+  ASSERT_EQ(1, picked.size());
+  ASSERT_EQ(0, picked[0]);
+  zones[1] = Zone(1, 0, kZoneSize / 4);
+  picker.Pick(&zones, free, total, 3 * kMinute, options, &picked, nullptr);
+  ASSERT_EQ(0, zones[1].age_micros);
+  ASSERT_EQ(3 * kMinute, zones[0].age_micros);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
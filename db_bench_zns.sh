@@ -17,10 +17,11 @@ ZENFS_BIN=$BIN_DIR/zenfs
 # benchmark configuration
 KEY_SIZE=36
 VALUE_SIZE=$((8 * 1024))
-BLOB_FILE_SIZE=$((32 * 1024 * 1024))
 MEMTABLE_SIZE=$((128 * 1024 * 1024))
 BYTES_PER_GiB=$((1024 * 1024 * 1024))
 BENCH_BASE_SIZE=20
+# e.g. BENCHMARKS=fillrandom,zns_overwrite_skewed ./db_bench_zns.sh
+BENCHMARKS=${BENCHMARKS:-fillrandom}
 KEY_NUM=$(($BENCH_BASE_SIZE * $BYTES_PER_GiB / $VALUE_SIZE))
 
 # ./cp.sh
@@ -33,7 +34,7 @@ sudo ${ZENFS_BIN} mkfs --zbd=$DEVICE --aux_path=/tmp/zenfs_$DEVICE --force=true
    sudo gdb --args ${DB_BIN} \
     --zbd_path=$DEVICE \
     --disable_wal=false \
-    --benchmarks=fillrandom \
+    --benchmarks=$BENCHMARKS \
     --use_existing_db=0 \
     --statistics=1 \
     --stats_per_interval=1 \
@@ -58,9 +59,7 @@ sudo ${ZENFS_BIN} mkfs --zbd=$DEVICE --aux_path=/tmp/zenfs_$DEVICE --force=true
     --blob_size=1024 \
     --blob_gc_ratio=0.0625 \
     --write_buffer_size=$MEMTABLE_SIZE \
-    --target_file_size_base=$BLOB_FILE_SIZE \
-    --target_blob_file_size=$BLOB_FILE_SIZE \
-    --blob_file_defragment_size=33554432 \
+    --zenfs_zone_aligned_file_size=true \
     --optimize_filters_for_hits=true \
     --num=$KEY_NUM \
     --db=testdb \
@@ -529,6 +529,17 @@ class LegacyFileSystemWrapper : public FileSystem {
   Env* target_;
 };
 
+void Oracle::ProbeKeyTypes(const Slice* keys, size_t n, uint64_t occurrence,
+                           KeyType* types) {
+  // Keeps its capacity across calls, so probing one key at a time does not
+  // allocate either
+  static thread_local std::string buf;
+  for (size_t i = 0; i < n; ++i) {
+    buf.assign(keys[i].data(), keys[i].size());
+    types[i] = ProbeKeyType(buf, occurrence);
+  }
+}
+
 Env::Env() : thread_status_updater_(nullptr) {
   file_system_ = std::make_shared<LegacyFileSystemWrapper>(this);
 }
@@ -911,6 +922,7 @@ void AssignEnvOptions(EnvOptions* env_options, const DBOptions& options) {
   env_options->rate_limiter = options.rate_limiter.get();
   env_options->writable_file_max_buffer_size =
       options.writable_file_max_buffer_size;
+  env_options->write_behind_buffers = options.write_behind_buffers;
   env_options->allow_fallocate = options.allow_fallocate;
   env_options->partition_num = options.partition_num;
   env_options->enable_hot_separation = options.enable_hot_separation;
@@ -922,6 +934,7 @@ void AssignEnvOptions(EnvOptions* env_options, const DBOptions& options) {
 EnvOptions Env::OptimizeForLogWrite(const EnvOptions& env_options,
                                     const DBOptions& db_options) const {
   EnvOptions optimized_env_options(env_options);
+  optimized_env_options.use_direct_writes = db_options.use_direct_io_for_wal;
   optimized_env_options.bytes_per_sync = db_options.wal_bytes_per_sync;
   optimized_env_options.writable_file_max_buffer_size =
       db_options.writable_file_max_buffer_size;
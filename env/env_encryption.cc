@@ -7,9 +7,15 @@
 
 #include "rocksdb/env_encryption.h"
 
+#include <string.h>
+#ifdef HAVE_AESNI
+#include <wmmintrin.h>
+#endif
+
 #include <algorithm>
 #include <cctype>
 #include <iostream>
+#include <random>
 
 #include "util/aligned_buffer.h"
 #include "util/coding.h"
@@ -873,11 +879,12 @@ static void decodeCTRParameters(const char* prefix, size_t blockSize,
 Status CTREncryptionProvider::CreateNewPrefix(const std::string& /*fname*/,
                                               char* prefix,
                                               size_t prefixLength) {
-  // Create & seed rnd.
-  Random rnd((uint32_t)Env::Default()->NowMicros());
+  // The initial counter & IV must not repeat across files, don't derive them
+  // from the clock.
+  std::random_device rnd;
   // Fill entire prefix block with random values.
   for (size_t i = 0; i < prefixLength; i++) {
-    prefix[i] = rnd.Uniform(256) & 0xFF;
+    prefix[i] = rnd() & 0xFF;
   }
   // Take random data to extract initial counter & IV
   auto blockSize = cipher_.BlockSize();
@@ -945,6 +952,419 @@ Status CTREncryptionProvider::CreateCipherStreamFromPrefix(
   return Status::OK();
 }
 
+namespace {
+
+const unsigned char kAESSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
+    0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
+    0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
+    0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
+    0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
+    0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
+    0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16};
+
+const unsigned char kAESInvSbox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e,
+    0x81, 0xf3, 0xd7, 0xfb, 0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+    0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb, 0x54, 0x7b, 0x94, 0x32,
+    0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49,
+    0x6d, 0x8b, 0xd1, 0x25, 0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+    0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92, 0x6c, 0x70, 0x48, 0x50,
+    0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05,
+    0xb8, 0xb3, 0x45, 0x06, 0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+    0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b, 0x3a, 0x91, 0x11, 0x41,
+    0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8,
+    0x1c, 0x75, 0xdf, 0x6e, 0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+    0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b, 0xfc, 0x56, 0x3e, 0x4b,
+    0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59,
+    0x27, 0x80, 0xec, 0x5f, 0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+    0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef, 0xa0, 0xe0, 0x3b, 0x4d,
+    0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63,
+    0x55, 0x21, 0x0c, 0x7d};
+
+// Blocks encrypted at a time, 8 keeps the pipelined AES units of current
+// CPUs busy
+const size_t kAESParallelBlocks = 8;
+
+inline unsigned char AESTimes2(unsigned char x) {
+  return static_cast<unsigned char>((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+inline unsigned char AESMultiply(unsigned char x, unsigned char y) {
+  unsigned char r = 0;
+  while (y != 0) {
+    if (y & 1) {
+      r ^= x;
+    }
+    x = AESTimes2(x);
+    y >>= 1;
+  }
+  return r;
+}
+
+// The state is 16 bytes in column order, as the input block
+inline void AESAddRoundKey(unsigned char* s, const unsigned char* k) {
+  for (size_t i = 0; i < AESBlockCipher::kBlockSize; ++i) {
+    s[i] ^= k[i];
+  }
+}
+
+inline void AESSubBytesShiftRows(unsigned char* s, const unsigned char* box,
+                                 bool inverse) {
+  unsigned char t[AESBlockCipher::kBlockSize];
+  for (size_t c = 0; c < 4; ++c) {
+    for (size_t r = 0; r < 4; ++r) {
+      size_t from = inverse ? (c + 4 - r) % 4 : (c + r) % 4;
+      t[r + 4 * c] = box[s[r + 4 * from]];
+    }
+  }
+  memcpy(s, t, sizeof(t));
+}
+
+inline void AESMixColumns(unsigned char* s) {
+  for (size_t c = 0; c < 4; ++c) {
+    unsigned char* a = s + 4 * c;
+    unsigned char a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+    unsigned char all = a0 ^ a1 ^ a2 ^ a3;
+    a[0] ^= all ^ AESTimes2(a0 ^ a1);
+    a[1] ^= all ^ AESTimes2(a1 ^ a2);
+    a[2] ^= all ^ AESTimes2(a2 ^ a3);
+    a[3] ^= all ^ AESTimes2(a3 ^ a0);
+  }
+}
+
+inline void AESInvMixColumns(unsigned char* s) {
+  for (size_t c = 0; c < 4; ++c) {
+    unsigned char* a = s + 4 * c;
+    unsigned char a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+    a[0] = AESMultiply(a0, 14) ^ AESMultiply(a1, 11) ^ AESMultiply(a2, 13) ^
+           AESMultiply(a3, 9);
+    a[1] = AESMultiply(a0, 9) ^ AESMultiply(a1, 14) ^ AESMultiply(a2, 11) ^
+           AESMultiply(a3, 13);
+    a[2] = AESMultiply(a0, 13) ^ AESMultiply(a1, 9) ^ AESMultiply(a2, 14) ^
+           AESMultiply(a3, 11);
+    a[3] = AESMultiply(a0, 11) ^ AESMultiply(a1, 13) ^ AESMultiply(a2, 9) ^
+           AESMultiply(a3, 14);
+  }
+}
+
+bool IsAESNI() {
+#ifndef HAVE_AESNI
+  return false;
+#elif defined(__GNUC__) && defined(__x86_64__) && !defined(IOS_CROSS_COMPILE)
+  uint32_t c_;
+  __asm__("cpuid" : "=c"(c_) : "a"(1) : "ebx", "edx");
+  return c_ & (1U << 25);  // AES is in bit 25
+#elif defined(_WIN64)
+  int info[4];
+  __cpuidex(info, 0x00000001, 0);
+  return (info[2] & ((int)1 << 25)) != 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+Status AESBlockCipher::Create(const Slice& key,
+                              std::unique_ptr<AESBlockCipher>* result,
+                              bool allow_aesni) {
+  if (key.size() != 16 && key.size() != 24 && key.size() != 32) {
+    return Status::InvalidArgument("AES key must be 16, 24 or 32 bytes");
+  }
+  result->reset(new AESBlockCipher(key, allow_aesni && IsAESNI()));
+  return Status::OK();
+}
+
+AESBlockCipher::AESBlockCipher(const Slice& key, bool use_aesni)
+    : rounds_(key.size() / 4 + 6), use_aesni_(use_aesni) {
+  // FIPS-197 key expansion, into words of 4 bytes
+  const size_t nk = key.size() / 4;
+  unsigned char* w = &round_keys_[0][0];
+  memcpy(w, key.data(), key.size());
+  unsigned char rcon = 1;
+  for (size_t i = nk; i < 4 * (rounds_ + 1); ++i) {
+    unsigned char t[4];
+    memcpy(t, w + 4 * (i - 1), 4);
+    if (i % nk == 0) {
+      unsigned char t0 = t[0];
+      t[0] = kAESSbox[t[1]] ^ rcon;
+      t[1] = kAESSbox[t[2]];
+      t[2] = kAESSbox[t[3]];
+      t[3] = kAESSbox[t0];
+      rcon = AESTimes2(rcon);
+    } else if (nk > 6 && i % nk == 4) {
+      for (auto& b : t) {
+        b = kAESSbox[b];
+      }
+    }
+    for (size_t j = 0; j < 4; ++j) {
+      w[4 * i + j] = w[4 * (i - nk) + j] ^ t[j];
+    }
+  }
+  memcpy(dec_round_keys_, round_keys_, sizeof(round_keys_));
+#ifdef HAVE_AESNI
+  if (use_aesni_) {
+    for (size_t r = 1; r < rounds_; ++r) {
+      __m128i k = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(round_keys_[r]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dec_round_keys_[r]),
+                       _mm_aesimc_si128(k));
+    }
+  }
+#endif
+}
+
+Status AESBlockCipher::Encrypt(char* data) {
+#ifdef HAVE_AESNI
+  if (use_aesni_) {
+    __m128i* p = reinterpret_cast<__m128i*>(data);
+    __m128i x = _mm_xor_si128(
+        _mm_loadu_si128(p),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys_[0])));
+    for (size_t r = 1; r < rounds_; ++r) {
+      x = _mm_aesenc_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                                  round_keys_[r])));
+    }
+    x = _mm_aesenclast_si128(
+        x, _mm_loadu_si128(
+               reinterpret_cast<const __m128i*>(round_keys_[rounds_])));
+    _mm_storeu_si128(p, x);
+    return Status::OK();
+  }
+#endif
+  unsigned char* s = reinterpret_cast<unsigned char*>(data);
+  AESAddRoundKey(s, round_keys_[0]);
+  for (size_t r = 1; r < rounds_; ++r) {
+    AESSubBytesShiftRows(s, kAESSbox, false);
+    AESMixColumns(s);
+    AESAddRoundKey(s, round_keys_[r]);
+  }
+  AESSubBytesShiftRows(s, kAESSbox, false);
+  AESAddRoundKey(s, round_keys_[rounds_]);
+  return Status::OK();
+}
+
+Status AESBlockCipher::Decrypt(char* data) {
+#ifdef HAVE_AESNI
+  if (use_aesni_) {
+    __m128i* p = reinterpret_cast<__m128i*>(data);
+    __m128i x = _mm_xor_si128(
+        _mm_loadu_si128(p),
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(dec_round_keys_[rounds_])));
+    for (size_t r = rounds_ - 1; r > 0; --r) {
+      x = _mm_aesdec_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                                  dec_round_keys_[r])));
+    }
+    x = _mm_aesdeclast_si128(
+        x, _mm_loadu_si128(
+               reinterpret_cast<const __m128i*>(dec_round_keys_[0])));
+    _mm_storeu_si128(p, x);
+    return Status::OK();
+  }
+#endif
+  unsigned char* s = reinterpret_cast<unsigned char*>(data);
+  AESAddRoundKey(s, round_keys_[rounds_]);
+  for (size_t r = rounds_ - 1; r > 0; --r) {
+    AESSubBytesShiftRows(s, kAESInvSbox, true);
+    AESAddRoundKey(s, round_keys_[r]);
+    AESInvMixColumns(s);
+  }
+  AESSubBytesShiftRows(s, kAESInvSbox, true);
+  AESAddRoundKey(s, round_keys_[0]);
+  return Status::OK();
+}
+
+void AESBlockCipher::CTRXorBlocks(const char* iv, uint64_t counter, char* data,
+                                  size_t num_blocks) {
+#ifdef HAVE_AESNI
+  if (use_aesni_) {
+    __m128i keys[15];
+    for (size_t r = 0; r <= rounds_; ++r) {
+      keys[r] =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys_[r]));
+    }
+    int64_t iv_high;
+    memcpy(&iv_high, iv + 8, sizeof(iv_high));
+    // The counter is the little endian low half of the block
+    auto counter_block = [&](uint64_t i) {
+      return _mm_xor_si128(
+          _mm_set_epi64x(iv_high, static_cast<int64_t>(counter + i)),
+          keys[0]);
+    };
+    __m128i* p = reinterpret_cast<__m128i*>(data);
+    // The rounds of independent blocks overlap in the AES units. Unrolled by
+    // hand, so the blocks stay in registers without -O3.
+    static_assert(kAESParallelBlocks == 8, "");
+    for (; num_blocks >= kAESParallelBlocks; num_blocks -= kAESParallelBlocks) {
+      __m128i x0 = counter_block(0);
+      __m128i x1 = counter_block(1);
+      __m128i x2 = counter_block(2);
+      __m128i x3 = counter_block(3);
+      __m128i x4 = counter_block(4);
+      __m128i x5 = counter_block(5);
+      __m128i x6 = counter_block(6);
+      __m128i x7 = counter_block(7);
+      for (size_t r = 1; r < rounds_; ++r) {
+        __m128i k = keys[r];
+        x0 = _mm_aesenc_si128(x0, k);
+        x1 = _mm_aesenc_si128(x1, k);
+        x2 = _mm_aesenc_si128(x2, k);
+        x3 = _mm_aesenc_si128(x3, k);
+        x4 = _mm_aesenc_si128(x4, k);
+        x5 = _mm_aesenc_si128(x5, k);
+        x6 = _mm_aesenc_si128(x6, k);
+        x7 = _mm_aesenc_si128(x7, k);
+      }
+      __m128i k = keys[rounds_];
+      x0 = _mm_aesenclast_si128(x0, k);
+      x1 = _mm_aesenclast_si128(x1, k);
+      x2 = _mm_aesenclast_si128(x2, k);
+      x3 = _mm_aesenclast_si128(x3, k);
+      x4 = _mm_aesenclast_si128(x4, k);
+      x5 = _mm_aesenclast_si128(x5, k);
+      x6 = _mm_aesenclast_si128(x6, k);
+      x7 = _mm_aesenclast_si128(x7, k);
+      _mm_storeu_si128(p + 0, _mm_xor_si128(_mm_loadu_si128(p + 0), x0));
+      _mm_storeu_si128(p + 1, _mm_xor_si128(_mm_loadu_si128(p + 1), x1));
+      _mm_storeu_si128(p + 2, _mm_xor_si128(_mm_loadu_si128(p + 2), x2));
+      _mm_storeu_si128(p + 3, _mm_xor_si128(_mm_loadu_si128(p + 3), x3));
+      _mm_storeu_si128(p + 4, _mm_xor_si128(_mm_loadu_si128(p + 4), x4));
+      _mm_storeu_si128(p + 5, _mm_xor_si128(_mm_loadu_si128(p + 5), x5));
+      _mm_storeu_si128(p + 6, _mm_xor_si128(_mm_loadu_si128(p + 6), x6));
+      _mm_storeu_si128(p + 7, _mm_xor_si128(_mm_loadu_si128(p + 7), x7));
+      p += kAESParallelBlocks;
+      counter += kAESParallelBlocks;
+    }
+    for (; num_blocks > 0; --num_blocks, ++p, ++counter) {
+      __m128i x = counter_block(0);
+      for (size_t r = 1; r < rounds_; ++r) {
+        x = _mm_aesenc_si128(x, keys[r]);
+      }
+      x = _mm_aesenclast_si128(x, keys[rounds_]);
+      _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), x));
+    }
+    return;
+  }
+#endif
+  char block[kBlockSize];
+  for (; num_blocks > 0; --num_blocks, ++counter) {
+    memcpy(block, iv, kBlockSize);
+    EncodeFixed64(block, counter);
+    Encrypt(block);
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      *data++ ^= block[i];
+    }
+  }
+}
+
+namespace {
+
+// The CTR cipher stream of CTRCipherStream on an AESBlockCipher, XORing
+// whole buffers at a time with the key stream
+class AESCTRCipherStream final : public BlockAccessCipherStream {
+ public:
+  AESCTRCipherStream(AESBlockCipher* cipher, const char* iv,
+                     uint64_t initialCounter)
+      : cipher_(cipher),
+        iv_(iv, AESBlockCipher::kBlockSize),
+        initialCounter_(initialCounter) {}
+
+  virtual size_t BlockSize() override { return AESBlockCipher::kBlockSize; }
+
+  virtual Status Encrypt(uint64_t fileOffset, char* data,
+                         size_t dataSize) override {
+    Xor(fileOffset, data, dataSize);
+    return Status::OK();
+  }
+
+  // For CTR decryption & encryption are the same
+  virtual Status Decrypt(uint64_t fileOffset, char* data,
+                         size_t dataSize) override {
+    Xor(fileOffset, data, dataSize);
+    return Status::OK();
+  }
+
+ protected:
+  virtual void AllocateScratch(std::string&) override {}
+
+  virtual Status EncryptBlock(uint64_t blockIndex, char* data,
+                              char* /*scratch*/) override {
+    cipher_->CTRXorBlocks(iv_.data(), blockIndex + initialCounter_, data, 1);
+    return Status::OK();
+  }
+
+  virtual Status DecryptBlock(uint64_t blockIndex, char* data,
+                              char* scratch) override {
+    return EncryptBlock(blockIndex, data, scratch);
+  }
+
+ private:
+  // XORs `data` with the key stream from `fileOffset` on
+  void Xor(uint64_t fileOffset, char* data, size_t dataSize) {
+    const size_t kBlockSize = AESBlockCipher::kBlockSize;
+    uint64_t counter = fileOffset / kBlockSize + initialCounter_;
+    size_t blockOffset = fileOffset % kBlockSize;
+    if (blockOffset != 0) {
+      // Partial first block
+      char block[kBlockSize];
+      size_t n = std::min(dataSize, kBlockSize - blockOffset);
+      memcpy(block + blockOffset, data, n);
+      cipher_->CTRXorBlocks(iv_.data(), counter++, block, 1);
+      memcpy(data, block + blockOffset, n);
+      data += n;
+      dataSize -= n;
+    }
+    size_t num_blocks = dataSize / kBlockSize;
+    cipher_->CTRXorBlocks(iv_.data(), counter, data, num_blocks);
+    data += num_blocks * kBlockSize;
+    dataSize -= num_blocks * kBlockSize;
+    if (dataSize > 0) {
+      // Partial last block
+      char block[kBlockSize];
+      memcpy(block, data, dataSize);
+      cipher_->CTRXorBlocks(iv_.data(), counter + num_blocks, block, 1);
+      memcpy(data, block, dataSize);
+    }
+  }
+
+  AESBlockCipher* cipher_;
+  std::string iv_;
+  uint64_t initialCounter_;
+};
+
+}  // namespace
+
+Status AESCTREncryptionProvider::CreateCipherStreamFromPrefix(
+    const std::string& /*fname*/, const EnvOptions& /*options*/,
+    uint64_t initialCounter, const Slice& iv, const Slice& /*prefix*/,
+    std::unique_ptr<BlockAccessCipherStream>* result) {
+  result->reset(
+      new AESCTRCipherStream(aes_cipher_.get(), iv.data(), initialCounter));
+  return Status::OK();
+}
+
 #endif  // ROCKSDB_LITE
 
 }  // namespace TERARKDB_NAMESPACE
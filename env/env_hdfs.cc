@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 
 #include "rocksdb/status.h"
@@ -49,17 +50,12 @@ static Status IOError(const std::string& context, int err_number) {
 // but need not be because the logger is initialized at db-open time.
 static Logger* mylog = nullptr;
 
-// Used for reading a file from HDFS. It implements both sequential-read
-// access methods as well as random read access methods.
-class HdfsReadableFile : virtual public SequentialFile,
-                         virtual public RandomAccessFile {
- private:
-  hdfsFS fileSys_;
-  std::string filename_;
-  hdfsFile hfile_;
+}  // namespace
 
+// An hdfsFile opened for reading, closed once no file reads it any more
+class HdfsReadHandle {
  public:
-  HdfsReadableFile(hdfsFS fileSys, const std::string& fname)
+  HdfsReadHandle(hdfsFS fileSys, const std::string& fname)
       : fileSys_(fileSys), filename_(fname), hfile_(nullptr) {
     ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile opening file %s\n",
                     filename_.c_str());
@@ -69,7 +65,7 @@ class HdfsReadableFile : virtual public SequentialFile,
                     filename_.c_str(), hfile_);
   }
 
-  virtual ~HdfsReadableFile() {
+  ~HdfsReadHandle() {
     ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile closing file %s\n",
                     filename_.c_str());
     hdfsCloseFile(fileSys_, hfile_);
@@ -78,6 +74,51 @@ class HdfsReadableFile : virtual public SequentialFile,
     hfile_ = nullptr;
   }
 
+  hdfsFile hfile() const { return hfile_; }
+
+ private:
+  hdfsFS fileSys_;
+  std::string filename_;
+  hdfsFile hfile_;
+};
+
+namespace {
+
+// Used for reading a file from HDFS. It implements both sequential-read
+// access methods as well as random read access methods.
+//
+// The random reads are positional, so the random access files of one name
+// can share a handle, see HdfsEnv::GetReadHandle(). A read shorter than
+// readahead_size reads readahead_size bytes at its offset, the next reads of
+// these bytes, like the following blocks of an iterator or a compaction, are
+// then served from memory.
+class HdfsReadableFile : virtual public SequentialFile,
+                         virtual public RandomAccessFile {
+ private:
+  hdfsFS fileSys_;
+  std::string filename_;
+  std::shared_ptr<HdfsReadHandle> handle_;
+  hdfsFile hfile_;
+  size_t readahead_size_;
+
+  mutable std::mutex buffer_mutex_;
+  mutable std::string buffer_;
+  mutable uint64_t buffer_offset_;
+
+ public:
+  HdfsReadableFile(hdfsFS fileSys, const std::string& fname,
+                   std::shared_ptr<HdfsReadHandle> handle = nullptr,
+                   size_t readahead_size = 0)
+      : fileSys_(fileSys),
+        filename_(fname),
+        handle_(handle ? std::move(handle)
+                       : std::make_shared<HdfsReadHandle>(fileSys, fname)),
+        hfile_(handle_->hfile()),
+        readahead_size_(readahead_size),
+        buffer_offset_(0) {}
+
+  virtual ~HdfsReadableFile() {}
+
   bool isValid() { return hfile_ != nullptr; }
 
   // sequential access, read data at current offset in file
@@ -120,21 +161,44 @@ class HdfsReadableFile : virtual public SequentialFile,
   // random access, read data from specified offset in file
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const {
-    Status s;
-    ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile preading %s\n",
-                    filename_.c_str());
-    ssize_t bytes_read =
-        hdfsPread(fileSys_, hfile_, offset, (void*)scratch, (tSize)n);
-    ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile pread %s\n",
-                    filename_.c_str());
-    *result = Slice(scratch, (bytes_read < 0) ? 0 : bytes_read);
-    if (bytes_read < 0) {
-      // An error: return a non-ok status
-      s = IOError(filename_, errno);
+    if (readahead_size_ > 0 && ReadBuffered(offset, n, result, scratch)) {
+      return Status::OK();
+    }
+    if (n >= readahead_size_) {
+      size_t bytes_read = 0;
+      Status s = Pread(offset, n, scratch, &bytes_read);
+      *result = Slice(scratch, bytes_read);
+      return s;
+    }
+    Status s = Fill(offset, readahead_size_);
+    if (!s.ok()) {
+      *result = Slice(scratch, 0);
+      return s;
+    }
+    if (!ReadBuffered(offset, n, result, scratch)) {
+      // Past the end of the file, or replaced by a concurrent read
+      size_t bytes_read = 0;
+      s = Pread(offset, n, scratch, &bytes_read);
+      *result = Slice(scratch, bytes_read);
     }
     return s;
   }
 
+  // Read [offset, offset + n) into the buffer with one pread, so that the
+  // reads of adjacent blocks in it are coalesced
+  virtual Status Prefetch(uint64_t offset, size_t n) override {
+    if (readahead_size_ == 0) {
+      return Status::NotSupported("Prefetch");
+    }
+    return Fill(offset, n);
+  }
+
+  virtual Status InvalidateCache(size_t /*offset*/, size_t /*length*/) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    buffer_.clear();
+    return Status::OK();
+  }
+
   virtual Status Skip(uint64_t n) {
     ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile skip %s\n",
                     filename_.c_str());
@@ -153,6 +217,59 @@ class HdfsReadableFile : virtual public SequentialFile,
   }
 
  private:
+  // Read until n bytes are read or the end of the file
+  Status Pread(uint64_t offset, size_t n, char* scratch,
+               size_t* total_bytes_read) const {
+    ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile preading %s\n",
+                    filename_.c_str());
+    *total_bytes_read = 0;
+    while (*total_bytes_read < n) {
+      tSize bytes_read =
+          hdfsPread(fileSys_, hfile_, offset + *total_bytes_read,
+                    (void*)(scratch + *total_bytes_read),
+                    (tSize)(n - *total_bytes_read));
+      if (bytes_read < 0) {
+        // An error: return a non-ok status
+        return IOError(filename_, errno);
+      }
+      if (bytes_read == 0) {
+        break;
+      }
+      *total_bytes_read += bytes_read;
+    }
+    ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile pread %s\n",
+                    filename_.c_str());
+    return Status::OK();
+  }
+
+  // Replace the buffer by [offset, offset + n) of the file
+  Status Fill(uint64_t offset, size_t n) const {
+    std::string data;
+    data.resize(n);
+    size_t bytes_read = 0;
+    Status s = Pread(offset, n, &data[0], &bytes_read);
+    if (s.ok()) {
+      data.resize(bytes_read);
+      std::lock_guard<std::mutex> lock(buffer_mutex_);
+      buffer_.swap(data);
+      buffer_offset_ = offset;
+    }
+    return s;
+  }
+
+  // Copy [offset, offset + n) from the buffer, if it has all of it
+  bool ReadBuffered(uint64_t offset, size_t n, Slice* result,
+                    char* scratch) const {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    if (offset < buffer_offset_ ||
+        offset + n > buffer_offset_ + buffer_.size()) {
+      return false;
+    }
+    memcpy(scratch, buffer_.data() + (offset - buffer_offset_), n);
+    *result = Slice(scratch, n);
+    return true;
+  }
+
   // returns true if we are at the end of file, false otherwise
   bool feof() {
     ROCKS_LOG_DEBUG(mylog, "[hdfs] HdfsReadableFile feof %s\n",
@@ -388,16 +505,35 @@ Status HdfsEnv::NewRandomAccessFile(const std::string& fname,
                                     std::unique_ptr<RandomAccessFile>* result,
                                     const EnvOptions& options) {
   result->reset();
-  HdfsReadableFile* f = new HdfsReadableFile(fileSys_, fname);
-  if (f == nullptr || !f->isValid()) {
-    delete f;
-    *result = nullptr;
+  std::shared_ptr<HdfsReadHandle> handle = GetReadHandle(fname);
+  if (handle->hfile() == nullptr) {
     return IOError(fname, errno);
   }
+  HdfsReadableFile* f =
+      new HdfsReadableFile(fileSys_, fname, std::move(handle),
+                           options_.random_access_readahead_size);
   result->reset(dynamic_cast<RandomAccessFile*>(f));
   return Status::OK();
 }
 
+std::shared_ptr<HdfsReadHandle> HdfsEnv::GetReadHandle(
+    const std::string& fname) {
+  if (!options_.reuse_read_handles) {
+    return std::make_shared<HdfsReadHandle>(fileSys_, fname);
+  }
+  std::lock_guard<std::mutex> lock(read_handles_mutex_);
+  auto& handle = read_handles_[fname];
+  if (handle == nullptr || handle->hfile() == nullptr) {
+    handle = std::make_shared<HdfsReadHandle>(fileSys_, fname);
+  }
+  return handle;
+}
+
+void HdfsEnv::ReleaseReadHandle(const std::string& fname) {
+  std::lock_guard<std::mutex> lock(read_handles_mutex_);
+  read_handles_.erase(fname);
+}
+
 // create a new file for writing
 Status HdfsEnv::NewWritableFile(const std::string& fname,
                                 std::unique_ptr<WritableFile>* result,
@@ -491,6 +627,7 @@ Status HdfsEnv::GetChildren(const std::string& path,
 }
 
 Status HdfsEnv::DeleteFile(const std::string& fname) {
+  ReleaseReadHandle(fname);
   if (hdfsDelete(fileSys_, fname.c_str(), 1) == 0) {
     return Status::OK();
   }
@@ -547,6 +684,8 @@ Status HdfsEnv::GetFileModificationTime(const std::string& fname,
 // target already exists. So, we delete the target before attempting the
 // rename.
 Status HdfsEnv::RenameFile(const std::string& src, const std::string& target) {
+  ReleaseReadHandle(src);
+  ReleaseReadHandle(target);
   hdfsDelete(fileSys_, target.c_str(), 1);
   if (hdfsRename(fileSys_, src.c_str(), target.c_str()) == 0) {
     return Status::OK();
@@ -584,6 +723,12 @@ Status NewHdfsEnv(Env** hdfs_env, const std::string& fsname) {
   *hdfs_env = new HdfsEnv(fsname);
   return Status::OK();
 }
+
+Status NewHdfsEnv(Env** hdfs_env, const std::string& fsname,
+                  const HdfsEnvOptions& options) {
+  *hdfs_env = new HdfsEnv(fsname, options);
+  return Status::OK();
+}
 }  // namespace TERARKDB_NAMESPACE
 
 #endif  // ROCKSDB_HDFS_FILE_C
@@ -601,6 +746,11 @@ Status HdfsEnv::NewSequentialFile(const std::string& /*fname*/,
 Status NewHdfsEnv(Env** /*hdfs_env*/, const std::string& /*fsname*/) {
   return Status::NotSupported("Not compiled with hdfs support");
 }
+
+Status NewHdfsEnv(Env** /*hdfs_env*/, const std::string& /*fsname*/,
+                  const HdfsEnvOptions& /*options*/) {
+  return Status::NotSupported("Not compiled with hdfs support");
+}
 }  // namespace TERARKDB_NAMESPACE
 
 #endif
@@ -257,7 +257,8 @@ class PosixEnv : public Env {
         }
 #endif
       }
-      result->reset(new PosixRandomAccessFile(fname, fd, options));
+      result->reset(new PosixRandomAccessFile(fname, fd, options,
+                                              thread_local_io_urings_.get()));
     }
     return s;
   }
@@ -751,6 +752,11 @@ class PosixEnv : public Env {
                         Priority pri = LOW, void* tag = nullptr,
                         void (*unschedFunction)(void* arg) = nullptr) override;
 
+  virtual void ScheduleUrgent(
+      void (*function)(void* arg1), void* arg, Priority pri = LOW,
+      void* tag = nullptr,
+      void (*unschedFunction)(void* arg) = nullptr) override;
+
   virtual int UnSchedule(void* arg, Priority pri) override;
 
   virtual void StartThread(void (*function)(void* arg), void* arg) override;
@@ -861,6 +867,17 @@ class PosixEnv : public Env {
 #endif
   }
 
+  virtual uint64_t NowCPUNanos() override {
+#if defined(OS_LINUX) || defined(OS_FREEBSD) || defined(OS_AIX) || \
+    (defined(__MACH__) && defined(__MAC_10_12))
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return 0;
+#endif
+  }
+
   virtual void SleepForMicroseconds(int micros) override {
 #ifdef WITH_BOOSTLIB
     boost::this_fiber::sleep_for(std::chrono::microseconds(micros));
@@ -946,6 +963,15 @@ class PosixEnv : public Env {
 #endif
   }
 
+  virtual void SetThreadPoolStealing(Priority victim, Priority thief,
+                                     int reserve) override {
+    assert(victim >= Priority::BOTTOM && victim <= Priority::HIGH);
+    assert(thief >= Priority::BOTTOM && thief <= Priority::HIGH);
+    if (victim != thief) {
+      thread_pools_[thief].StealFrom(&thread_pools_[victim], reserve);
+    }
+  }
+
   virtual std::string TimeToString(uint64_t secondsSince1970) override {
     const time_t seconds = (time_t)secondsSince1970;
     struct tm t;
@@ -964,7 +990,7 @@ class PosixEnv : public Env {
                                  const DBOptions& db_options) const override {
     EnvOptions optimized = env_options;
     optimized.use_mmap_writes = false;
-    optimized.use_direct_writes = false;
+    optimized.use_direct_writes = db_options.use_direct_io_for_wal;
     optimized.bytes_per_sync = db_options.wal_bytes_per_sync;
     // TODO(icanadi) it's faster if fallocate_with_keep_size is false, but it
     // breaks TransactionLogIteratorStallAtLastRecord unit test. Fix the unit
@@ -1027,6 +1053,10 @@ class PosixEnv : public Env {
   // If true, allow non owner read access for db files. Otherwise, non-owner
   //  has no access to db files.
   bool allow_non_owner_access_;
+
+  // One io_uring per thread for PosixRandomAccessFile, nullptr if io_uring
+  // is not available
+  std::unique_ptr<ThreadLocalPtr> thread_local_io_urings_;
 };
 
 PosixEnv::PosixEnv()
@@ -1043,6 +1073,14 @@ PosixEnv::PosixEnv()
     thread_pools_[pool_id].SetHostEnv(this);
   }
   thread_status_updater_ = CreateThreadStatusUpdater();
+#if defined(ROCKSDB_IOURING_PRESENT)
+  // Probe once, so that files don't retry io_uring on kernels without it
+  PosixIOUring* iu = CreateIOUring();
+  if (iu != nullptr) {
+    thread_local_io_urings_.reset(new ThreadLocalPtr(DeleteIOUring));
+    thread_local_io_urings_->Reset(iu);
+  }
+#endif
 }
 
 void PosixEnv::Schedule(void (*function)(void* arg1), void* arg, Priority pri,
@@ -1057,6 +1095,16 @@ void PosixEnv::Schedule(void (*function)(void* arg1), void* arg, Priority pri,
   }
 }
 
+void PosixEnv::ScheduleUrgent(void (*function)(void* arg1), void* arg,
+                              Priority pri, void* tag,
+                              void (*unschedFunction)(void* arg)) {
+  assert(pri >= Priority::BOTTOM && pri <= Priority::FORCE);
+  if (pri == Priority::FORCE) {
+    pri = Priority::HIGH;
+  }
+  thread_pools_[pri].Schedule(function, arg, tag, unschedFunction, true);
+}
+
 int PosixEnv::UnSchedule(void* arg, Priority pri) {
   return thread_pools_[pri].UnSchedule(arg);
 }
@@ -251,6 +251,40 @@ TEST_F(EnvPosixTest, MemoryMappedFileBuffer) {
   ASSERT_EQ(expected_data, actual_data);
 }
 
+TEST_F(EnvPosixTest, MultiRead) {
+  const size_t kNumReads = 300;
+  const size_t kReadSize = 100;
+  std::string fname = test::PerThreadDBPath(env_, "testfile");
+  Random rnd(301);
+  std::string expected_data;
+  test::RandomString(&rnd, static_cast<int>(kNumReads * kReadSize - 10),
+                     &expected_data);
+  ASSERT_OK(WriteStringToFile(env_, expected_data, fname));
+
+  std::unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(fname, &file, EnvOptions()));
+  ASSERT_OK(file->PrefetchAsync(0, expected_data.size()));
+
+  // More reads than the io_uring queue depth, in reverse order, the last
+  // one is cut by the end of the file
+  std::vector<std::string> scratches(kNumReads, std::string(kReadSize, 0));
+  std::vector<FSReadRequest> reqs(kNumReads);
+  for (size_t i = 0; i < kNumReads; ++i) {
+    size_t pos = kNumReads - 1 - i;
+    reqs[i].offset = pos * kReadSize;
+    reqs[i].len = kReadSize;
+    reqs[i].scratch = &scratches[i][0];
+  }
+  ASSERT_OK(file->MultiRead(reqs.data(), reqs.size()));
+  for (size_t i = 0; i < kNumReads; ++i) {
+    ASSERT_OK(reqs[i].status);
+    ASSERT_EQ(expected_data.substr(reqs[i].offset, kReadSize),
+              reqs[i].result.ToString());
+  }
+  ASSERT_EQ(kReadSize - 10, reqs[0].result.size());
+  ASSERT_OK(env_->DeleteFile(fname));
+}
+
 TEST_P(EnvPosixTestWithParam, UnSchedule) {
   std::atomic<bool> called(false);
   env_->SetBackgroundThreads(1, Env::LOW);
@@ -287,6 +321,89 @@ TEST_P(EnvPosixTestWithParam, UnSchedule) {
   WaitThreadPoolsEmpty();
 }
 
+TEST_P(EnvPosixTestWithParam, ScheduleUrgent) {
+  env_->SetBackgroundThreads(1, Env::LOW);
+
+  /* Block the low priority queue */
+  test::SleepingBackgroundTask sleeping_task;
+  env_->Schedule(&test::SleepingBackgroundTask::DoSleepTask, &sleeping_task,
+                 Env::Priority::LOW);
+  sleeping_task.WaitUntilSleeping();
+
+  struct Job {
+    port::Mutex* mu;
+    std::vector<int>* order;
+    int id;
+    static void Run(void* arg) {
+      auto* job = reinterpret_cast<Job*>(arg);
+      MutexLock l(job->mu);
+      job->order->push_back(job->id);
+    }
+  };
+  port::Mutex mu;
+  std::vector<int> order;
+  Job bulk{&mu, &order, 1}, urgent{&mu, &order, 2};
+  env_->Schedule(&Job::Run, &bulk, Env::Priority::LOW);
+  env_->ScheduleUrgent(&Job::Run, &urgent, Env::Priority::LOW);
+
+  sleeping_task.WakeUp();
+  sleeping_task.WaitUntilDone();
+  for (int i = 0; i < kDelayMicros; i++) {
+    MutexLock l(&mu);
+    if (order.size() == 2) {
+      break;
+    }
+    Env::Default()->SleepForMicroseconds(1);
+  }
+  MutexLock l(&mu);
+  ASSERT_EQ(std::vector<int>({2, 1}), order);
+}
+
+TEST_P(EnvPosixTestWithParam, ThreadPoolStealing) {
+  env_->SetBackgroundThreads(1, Env::LOW);
+  env_->SetBackgroundThreads(1, Env::HIGH);
+
+  /* Block the high priority queue */
+  test::SleepingBackgroundTask sleeping_task;
+  env_->Schedule(&test::SleepingBackgroundTask::DoSleepTask, &sleeping_task,
+                 Env::Priority::HIGH);
+  sleeping_task.WaitUntilSleeping();
+
+  // Queued before the stealing starts
+  std::atomic<bool> called1(false);
+  env_->Schedule(&SetBool, &called1, Env::Priority::HIGH);
+  env_->SetThreadPoolStealing(Env::Priority::HIGH, Env::Priority::LOW, 0);
+  // Queued while the pool is busy
+  std::atomic<bool> called2(false);
+  env_->Schedule(&SetBool, &called2, Env::Priority::HIGH);
+
+  for (int i = 0; i < kDelayMicros; i++) {
+    if (called1.load() && called2.load()) {
+      break;
+    }
+    Env::Default()->SleepForMicroseconds(1);
+  }
+  ASSERT_TRUE(called1.load());
+  ASSERT_TRUE(called2.load());
+  ASSERT_TRUE(sleeping_task.IsSleeping());
+
+  // A reserve of one keeps the only low priority thread for its own jobs
+  env_->SetThreadPoolStealing(Env::Priority::HIGH, Env::Priority::LOW, 1);
+  std::atomic<bool> called3(false);
+  env_->Schedule(&SetBool, &called3, Env::Priority::HIGH);
+  Env::Default()->SleepForMicroseconds(kDelayMicros);
+  ASSERT_FALSE(called3.load());
+
+  env_->SetThreadPoolStealing(Env::Priority::HIGH, Env::Priority::LOW, -1);
+  sleeping_task.WakeUp();
+  sleeping_task.WaitUntilDone();
+  WaitThreadPoolsEmpty();
+  for (int i = 0; i < kDelayMicros && !called3.load(); i++) {
+    Env::Default()->SleepForMicroseconds(1);
+  }
+  ASSERT_TRUE(called3.load());
+}
+
 // This tests assumes that the last scheduled
 // task will run last. In fact, in the allotted
 // sleeping time nothing may actually run or they may
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <mutex>
 #include <ratio>
 
 #include "db/compaction_iteration_stats.h"
@@ -10,6 +11,7 @@
 #include "fs/snapshot.h"
 #include "rocksdb/env.h"
 #include "rocksdb/file_system.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/table_properties.h"
@@ -20,6 +22,7 @@
 #include "fs/zbd_zenfs.h"
 #include "libcuckoo/cuckoohash_map.hh"
 #include "utilities/trace/bytedance_metrics_histogram.h"
+#include "util/zone_token_scheduler.h"
 #include "utilities/trace/zbd_stat.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -95,15 +98,23 @@ class ZenfsRandomAccessFile : public RandomAccessFile {
   std::unique_ptr<FSRandomAccessFile> target_;
 };
 
+// The writes that may reach a zone hold an active zone token of `scheduler`
+// if there is one, see ZoneTokenOptions
 class ZenfsWritableFile : public WritableFile {
  public:
-  explicit ZenfsWritableFile(std::unique_ptr<FSWritableFile>&& target)
-      : target_(std::move(target)) {}
+  ZenfsWritableFile(std::unique_ptr<FSWritableFile>&& target,
+                    std::shared_ptr<ZoneTokenScheduler> scheduler,
+                    ZoneTokenScheduler::WriterClass writer_class)
+      : target_(std::move(target)),
+        scheduler_(std::move(scheduler)),
+        token_(scheduler_.get(), writer_class) {}
 
   Status Append(const Slice& data) override {
+    ZoneTokenScheduler::WriteGuard guard(&token_);
     return target_->Append(data, IOOptions(), nullptr);
   }
   Status PositionedAppend(const Slice& data, uint64_t offset) override {
+    ZoneTokenScheduler::WriteGuard guard(&token_);
     return target_->PositionedAppend(data, offset, IOOptions(), nullptr);
   }
   Status Truncate(uint64_t size) override {
@@ -119,11 +130,25 @@ class ZenfsWritableFile : public WritableFile {
   //
   // For other filesystems(e.g. ext4) the logic is still reminds since Frozen()
   // will do nothing on page cache enabled filesystems.
-  Status Frozen() override { return target_->Close(IOOptions(), nullptr); }
-  Status Close() override { return target_->Close(IOOptions(), nullptr); }
-  Status Flush() override { return target_->Flush(IOOptions(), nullptr); }
-  Status Sync() override { return target_->Sync(IOOptions(), nullptr); }
-  Status Fsync() override { return target_->Fsync(IOOptions(), nullptr); }
+  Status Frozen() override { return Close(); }
+  Status Close() override {
+    // Closing doesn't wait for a token, it releases the zone of the file
+    Status s = target_->Close(IOOptions(), nullptr);
+    token_.Release();
+    return s;
+  }
+  Status Flush() override {
+    ZoneTokenScheduler::WriteGuard guard(&token_);
+    return target_->Flush(IOOptions(), nullptr);
+  }
+  Status Sync() override {
+    ZoneTokenScheduler::WriteGuard guard(&token_);
+    return target_->Sync(IOOptions(), nullptr);
+  }
+  Status Fsync() override {
+    ZoneTokenScheduler::WriteGuard guard(&token_);
+    return target_->Fsync(IOOptions(), nullptr);
+  }
   bool IsSyncThreadSafe() const override { return target_->IsSyncThreadSafe(); }
 
   bool use_direct_io() const override { return target_->use_direct_io(); }
@@ -168,6 +193,7 @@ class ZenfsWritableFile : public WritableFile {
   }
 
   Status RangeSync(uint64_t offset, uint64_t nbytes) override {
+    ZoneTokenScheduler::WriteGuard guard(&token_);
     return target_->RangeSync(offset, nbytes, IOOptions(), nullptr);
   }
 
@@ -181,6 +207,8 @@ class ZenfsWritableFile : public WritableFile {
 
  private:
   std::unique_ptr<FSWritableFile> target_;
+  std::shared_ptr<ZoneTokenScheduler> scheduler_;
+  ZoneTokenScheduler::Writer token_;
 };
 
 class ZenfsDirectory : public Directory {
@@ -460,6 +488,17 @@ class ZenFSOracle : public Oracle {
     }
   }
 
+  size_t ApproximateMemoryUsage() const override {
+    size_t usage = 0;
+    for (const auto& it : key_set_) {
+      // The map entry, the hint with its shared_ptr control block and the
+      // two copies of the key
+      usage += sizeof(it) + sizeof(KeyHint) + 2 * sizeof(void*) +
+               it.first.capacity() + it.second->key.capacity();
+    }
+    return usage;
+  }
+
  private:
   struct KeyHint {
     std::string key;
@@ -546,6 +585,10 @@ class ZenfsEnv : public EnvWrapper {
 
   std::shared_ptr<Oracle> GetOracle() override { return key_oracle_; }
 
+  void SetOracle(std::shared_ptr<Oracle> oracle) override {
+    key_oracle_ = std::move(oracle);
+  }
+
   void UpdateCompactionIterStats(
       const CompactionIterationStats* iter_stat) override {
     fs_->UpdateCompactionIterStats(iter_stat);
@@ -560,6 +603,27 @@ class ZenfsEnv : public EnvWrapper {
     fs_->MaybeReleaseGCWriteZone(type);
   }
 
+  // The smallest zone of the device, so that a file sized to it fits any zone
+  uint64_t GetZoneCapacity() override {
+    uint64_t capacity = zone_capacity_.load(std::memory_order_relaxed);
+    if (capacity == 0) {
+      auto zen_fs = dynamic_cast<ZenFS*>(fs_);
+      ZenFSSnapshot snapshot;
+      ZenFSSnapshotOptions options;
+      options.zone_ = 1;
+      zen_fs->GetZenFSSnapshot(snapshot, options);
+      for (const auto& zone : snapshot.zones_) {
+        if (zone.max_capacity > 0 &&
+            (capacity == 0 || zone.max_capacity < capacity)) {
+          capacity = zone.max_capacity;
+        }
+      }
+      // The geometry doesn't change
+      zone_capacity_.store(capacity, std::memory_order_relaxed);
+    }
+    return capacity;
+  }
+
   // Return the target to which this Env forwards all calls
   Env* target() const { return target_; }
 
@@ -609,8 +673,9 @@ class ZenfsEnv : public EnvWrapper {
     FileOptions foptions(options);
     static const std::string log_end = ".log";
 
+    bool is_wal = false;
     if (f.size() > log_end.size()) {
-      bool is_wal = std::equal(log_end.rbegin(), log_end.rend(), f.rbegin());
+      is_wal = std::equal(log_end.rbegin(), log_end.rend(), f.rbegin());
       foptions.io_options.type = is_wal ? IOType::kWAL : IOType::kUnknown;
     }
     if (options.db_file_type != DBFileType::kNoType) {
@@ -641,11 +706,30 @@ class ZenfsEnv : public EnvWrapper {
 
     IOStatus s = fs_->NewWritableFile(f, foptions, &file, nullptr);
     if (s.ok()) {
-      r->reset(new ZenfsWritableFile(std::move(file)));
+      auto writer_class = ZoneTokenScheduler::ClassOf(
+          is_wal ? DBFileType::kWAL : options.db_file_type,
+          GCIOScope::Active());
+      r->reset(new ZenfsWritableFile(std::move(file), zone_token_scheduler(),
+                                     writer_class));
     }
     return s;
   }
 
+  void SetZoneTokenOptions(const ZoneTokenOptions& options) {
+    std::shared_ptr<ZoneTokenScheduler> scheduler;
+    if (options.max_active_zones > 0) {
+      scheduler = std::make_shared<ZoneTokenScheduler>(options, target_);
+    }
+    // The files created before keep the scheduler they started with
+    std::lock_guard<std::mutex> lock(zone_token_mutex_);
+    zone_token_scheduler_ = std::move(scheduler);
+  }
+
+  std::shared_ptr<ZoneTokenScheduler> zone_token_scheduler() {
+    std::lock_guard<std::mutex> lock(zone_token_mutex_);
+    return zone_token_scheduler_;
+  }
+
   Status ReopenWritableFile(const std::string& fname,
                             std::unique_ptr<WritableFile>* result,
                             const EnvOptions& options) override {
@@ -699,7 +783,11 @@ class ZenfsEnv : public EnvWrapper {
   }
 
   Status DeleteFile(const std::string& f) override {
-    return fs_->DeleteFile(f, IOOptions(), nullptr);
+    Status s = fs_->DeleteFile(f, IOOptions(), nullptr);
+    if (s.ok()) {
+      zone_view_.RemoveFile(f);
+    }
+    return s;
   }
 
   Status Truncate(const std::string& fname, size_t size) override {
@@ -729,7 +817,11 @@ class ZenfsEnv : public EnvWrapper {
   }
 
   Status RenameFile(const std::string& s, const std::string& t) override {
-    return fs_->RenameFile(s, t, IOOptions(), nullptr);
+    Status st = fs_->RenameFile(s, t, IOOptions(), nullptr);
+    if (st.ok()) {
+      zone_view_.RenameFile(s, t);
+    }
+    return st;
   }
 
   Status LinkFile(const std::string& s, const std::string& t) override {
@@ -768,6 +860,12 @@ class ZenfsEnv : public EnvWrapper {
     target_->Schedule(f, a, pri, tag, u);
   }
 
+  void ScheduleUrgent(void (*f)(void* arg), void* a, Priority pri,
+                      void* tag = nullptr,
+                      void (*u)(void* arg) = nullptr) override {
+    target_->ScheduleUrgent(f, a, pri, tag, u);
+  }
+
   int UnSchedule(void* tag, Priority pri) override {
     return target_->UnSchedule(tag, pri);
   }
@@ -826,6 +924,11 @@ class ZenfsEnv : public EnvWrapper {
     target_->LowerThreadPoolCPUPriority(pool);
   }
 
+  void SetThreadPoolStealing(Priority victim, Priority thief,
+                             int reserve) override {
+    target_->SetThreadPoolStealing(victim, thief, reserve);
+  }
+
   std::string TimeToString(uint64_t time) override {
     return target_->TimeToString(time);
   }
@@ -920,6 +1023,41 @@ class ZenfsEnv : public EnvWrapper {
     stat.SetStat(snapshot, options);
   }
 
+  // Zone level stat only, no file or extent is copied
+  void GetZoneStat(BDZenFSStat& stat) {
+    auto zen_fs = dynamic_cast<ZenFS*>(fs_);
+    ZenFSSnapshot snapshot;
+    ZenFSSnapshotOptions options;
+
+    options.zbd_ = 1;
+    options.zone_ = 1;
+    options.log_garbage_ = 1;
+
+    zen_fs->GetZenFSSnapshot(snapshot, options);
+    stat.SetStat(snapshot, options);
+  }
+
+  // Serve the extents of `zones` from the incremental view, the view is
+  // rebuilt from a full snapshot only if it does not cover all of them.
+  void GetZoneExtents(const std::vector<BDZoneStat>& zones,
+                      std::vector<ZoneExtentSnapshot>* exts) {
+    if (!zone_view_.Covers(zones)) {
+      auto zen_fs = dynamic_cast<ZenFS*>(fs_);
+      ZenFSSnapshot snapshot;
+      ZenFSSnapshotOptions options;
+      options.zone_ = 1;
+      options.zone_file_ = 1;
+      zen_fs->GetZenFSSnapshot(snapshot, options);
+      zone_view_.Rebuild(snapshot);
+    }
+    std::vector<uint64_t> zone_starts;
+    zone_starts.reserve(zones.size());
+    for (const auto& zone : zones) {
+      zone_starts.push_back(zone.start_position);
+    }
+    zone_view_.CollectExtents(zone_starts, exts);
+  }
+
   void GetZenFSSnapshot(ZenFSSnapshot& snapshot,
                         const ZenFSSnapshotOptions& options) {
     auto zen_fs = dynamic_cast<ZenFS*>(fs_);
@@ -929,12 +1067,16 @@ class ZenfsEnv : public EnvWrapper {
   void MigrateExtents(const std::vector<ZoneExtentSnapshot*>& exts,
                       bool direct_io) {
     auto zen_fs = dynamic_cast<ZenFS*>(fs_);
+    for (auto ext : exts) {
+      zone_view_.DropZone(ext->zone_start);
+    }
     zen_fs->MigrateExtents(exts);
   }
 
   void CompactZones(uint64_t zone_start,
                     const std::vector<ZoneExtentSnapshot*>& exts) {
     auto zen_fs = dynamic_cast<ZenFS*>(fs_);
+    zone_view_.DropZone(zone_start);
     zen_fs->CompactZone(zone_start, exts);
   }
 
@@ -946,6 +1088,10 @@ class ZenfsEnv : public EnvWrapper {
   FileSystem* fs_;
   std::shared_ptr<Oracle> key_oracle_;
   std::string metrics_tag_;
+  ZenFSZoneExtentView zone_view_;
+  std::mutex zone_token_mutex_;
+  std::shared_ptr<ZoneTokenScheduler> zone_token_scheduler_;
+  std::atomic<uint64_t> zone_capacity_{0};
 };
 
 Status NewZenfsEnv(
@@ -985,6 +1131,21 @@ void GetStat(Env* env, BDZenFSStat& stat) {
   }
 }
 
+void GetZoneStat(Env* env, BDZenFSStat& stat) {
+  auto zen_env = dynamic_cast<ZenfsEnv*>(env);
+  if (zen_env) {
+    zen_env->GetZoneStat(stat);
+  }
+}
+
+void GetZoneExtents(Env* env, const std::vector<BDZoneStat>& zones,
+                    std::vector<ZoneExtentSnapshot>* exts) {
+  auto zen_env = dynamic_cast<ZenfsEnv*>(env);
+  if (zen_env) {
+    zen_env->GetZoneExtents(zones, exts);
+  }
+}
+
 void GetZenFSSnapshot(Env* env, ZenFSSnapshot& snapshot,
                       const ZenFSSnapshotOptions& options) {
   auto zen_env = dynamic_cast<ZenfsEnv*>(env);
@@ -1007,6 +1168,15 @@ void CompactZones(Env* env, uint64_t zone_start,
   zen_env->CompactZones(zone_start, exts);
 }
 
+Status SetZoneTokenOptions(Env* env, const ZoneTokenOptions& options) {
+  auto zen_env = dynamic_cast<ZenfsEnv*>(env);
+  if (!zen_env) {
+    return Status::NotSupported("SetZoneTokenOptions needs a ZenFS Env");
+  }
+  zen_env->SetZoneTokenOptions(options);
+  return Status::OK();
+}
+
 std::string MetricsTag(Env* env) {
   auto zen_env = dynamic_cast<ZenfsEnv*>(env);
   if (!zen_env) return "";
@@ -1031,6 +1201,10 @@ Status GetZbdDiskSpaceInfo(Env* env, uint64_t* total_size, uint64_t* avail_size,
   return Status::NotSupported("GetZbdDiskSpaceInfo is not implemented.");
 }
 
+Status SetZoneTokenOptions(Env* env, const ZoneTokenOptions& options) {
+  return Status::NotSupported("SetZoneTokenOptions is not implemented.");
+}
+
 void GetStat(Env* env, BDZenFSStat& stat) {}
 void GetZenFSSnapshot(Env* env, ZenFSSnapshot& snapshot,
                       const ZenFSSnapshotOptions& options) {}
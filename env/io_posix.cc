@@ -14,6 +14,7 @@
 #include <fcntl.h>
 
 #include <algorithm>
+#include <vector>
 #if defined(OS_LINUX)
 #include <linux/fs.h>
 #endif
@@ -313,13 +314,15 @@ size_t PosixHelper::GetUniqueIdFromFile(int fd, char* id, size_t max_size) {
  *
  * pread() based random-access
  */
-PosixRandomAccessFile::PosixRandomAccessFile(const std::string& fname, int fd,
-                                             const EnvOptions& options)
+PosixRandomAccessFile::PosixRandomAccessFile(
+    const std::string& fname, int fd, const EnvOptions& options,
+    ThreadLocalPtr* thread_local_io_urings)
     : filename_(fname),
       fd_(fd),
       use_direct_io_(options.use_direct_reads),
       use_aio_reads_(options.use_aio_reads),
-      logical_sector_size_(GetLogicalBufferSize(fd_)) {
+      logical_sector_size_(GetLogicalBufferSize(fd_)),
+      thread_local_io_urings_(thread_local_io_urings) {
   assert(!options.use_direct_reads || !options.use_mmap_reads);
   assert(!options.use_mmap_reads || sizeof(void*) < 8);
 }
@@ -386,6 +389,156 @@ Status PosixRandomAccessFile::Read(uint64_t offset, size_t n, Slice* result,
                      use_direct_io_, GetRequiredBufferAlignment());
 }
 
+#if defined(ROCKSDB_IOURING_PRESENT)
+PosixIOUring* PosixRandomAccessFile::GetIOUring() const {
+  if (thread_local_io_urings_ == nullptr) {
+    return nullptr;
+  }
+  PosixIOUring* iu = static_cast<PosixIOUring*>(thread_local_io_urings_->Get());
+  if (iu == nullptr) {
+    iu = CreateIOUring();
+    if (iu != nullptr) {
+      thread_local_io_urings_->Reset(iu);
+    }
+  }
+  return iu;
+}
+
+void PosixRandomAccessFile::ResetIOUring() const {
+  void* iu = thread_local_io_urings_->Swap(nullptr);
+  if (iu != nullptr) {
+    DeleteIOUring(iu);
+  }
+}
+
+namespace {
+// Consume the completions of finished prefetches, which are the only ones
+// left on the ring between calls
+void ReapIOUringPrefetches(PosixIOUring* iu) {
+  struct io_uring_cqe* cqe;
+  while (iu->pending_prefetches > 0 &&
+         io_uring_peek_cqe(&iu->ring, &cqe) == 0) {
+    assert(io_uring_cqe_get_data(cqe) == nullptr);
+    io_uring_cqe_seen(&iu->ring, cqe);
+    --iu->pending_prefetches;
+  }
+}
+
+struct IOUringReadRequest {
+  FSReadRequest* req;
+  size_t finished_len;
+  struct iovec iov;
+};
+}  // namespace
+#endif
+
+Status PosixRandomAccessFile::MultiRead(FSReadRequest* reqs, size_t num_reqs) {
+#if defined(ROCKSDB_IOURING_PRESENT)
+  PosixIOUring* iu = num_reqs > 1 ? GetIOUring() : nullptr;
+  if (iu == nullptr) {
+    return RandomAccessFile::MultiRead(reqs, num_reqs);
+  }
+  ReapIOUringPrefetches(iu);
+
+  std::vector<IOUringReadRequest> requests(num_reqs);
+  std::vector<IOUringReadRequest*> incomplete(num_reqs);
+  for (size_t i = 0; i < num_reqs; ++i) {
+#if !defined(NDEBUG)
+    if (use_direct_io_) {
+      assert(IsSectorAligned(reqs[i].offset, GetRequiredBufferAlignment()));
+      assert(IsSectorAligned(reqs[i].len, GetRequiredBufferAlignment()));
+      assert(IsSectorAligned(reqs[i].scratch, GetRequiredBufferAlignment()));
+    }
+#endif
+    requests[i].req = &reqs[i];
+    requests[i].finished_len = 0;
+    incomplete[i] = &requests[i];
+  }
+  std::vector<IOUringReadRequest*> resubmit;
+  while (!incomplete.empty()) {
+    size_t num_submit = std::min<size_t>(incomplete.size(), kIoUringDepth);
+    for (size_t i = 0; i < num_submit; ++i) {
+      IOUringReadRequest* r = incomplete[i];
+      r->iov.iov_base = r->req->scratch + r->finished_len;
+      r->iov.iov_len = r->req->len - r->finished_len;
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&iu->ring);
+      io_uring_prep_readv(sqe, fd_, &r->iov, 1,
+                          static_cast<off_t>(r->req->offset + r->finished_len));
+      io_uring_sqe_set_data(sqe, r);
+    }
+    int ret = io_uring_submit(&iu->ring);
+    if (ret < 0 || static_cast<size_t>(ret) != num_submit) {
+      // Wait for what was submitted, the unsubmitted entries go with the
+      // ring
+      for (int i = 0; i < ret;) {
+        struct io_uring_cqe* cqe;
+        if (io_uring_wait_cqe(&iu->ring, &cqe) != 0) {
+          break;
+        }
+        i += io_uring_cqe_get_data(cqe) != nullptr;
+        io_uring_cqe_seen(&iu->ring, cqe);
+      }
+      ResetIOUring();
+      return IOError("While io_uring_submit " + ToString(num_submit) +
+                         " reads, submitted " + ToString(ret),
+                     filename_, ret < 0 ? -ret : EIO);
+    }
+
+    resubmit.clear();
+    for (size_t i = 0; i < num_submit;) {
+      struct io_uring_cqe* cqe;
+      ret = io_uring_wait_cqe(&iu->ring, &cqe);
+      if (ret == -EINTR) {
+        continue;
+      }
+      if (ret != 0) {
+        // The ring can't be trusted anymore, tearing it down cancels the
+        // reads still in flight
+        ResetIOUring();
+        return IOError("While io_uring_wait_cqe", filename_, -ret);
+      }
+      IOUringReadRequest* r =
+          static_cast<IOUringReadRequest*>(io_uring_cqe_get_data(cqe));
+      int res = cqe->res;
+      io_uring_cqe_seen(&iu->ring, cqe);
+      if (r == nullptr) {
+        --iu->pending_prefetches;
+        continue;
+      }
+      ++i;
+      FSReadRequest* req = r->req;
+      if (res == -EINTR || res == -EAGAIN) {
+        resubmit.push_back(r);
+      } else if (res < 0) {
+        req->status = IOError("While io_uring read offset " +
+                                  ToString(req->offset) + " len " +
+                                  ToString(req->len),
+                              filename_, -res);
+        req->result = Slice(req->scratch, 0);
+      } else {
+        r->finished_len += static_cast<size_t>(res);
+        // Like PosixFsRead(), a direct read not filling sectors or reading
+        // nothing means the end of the file
+        if (res == 0 || r->finished_len == req->len ||
+            (use_direct_io_ && r->finished_len % GetRequiredBufferAlignment() !=
+                                   0)) {
+          req->status = Status::OK();
+          req->result = Slice(req->scratch, r->finished_len);
+        } else {
+          resubmit.push_back(r);
+        }
+      }
+    }
+    resubmit.insert(resubmit.end(), incomplete.begin() + num_submit,
+                    incomplete.end());
+    incomplete.swap(resubmit);
+  }
+  return Status::OK();
+#else
+  return RandomAccessFile::MultiRead(reqs, num_reqs);
+#endif
+}
+
 Status PosixRandomAccessFile::Prefetch(uint64_t offset, size_t n) {
   Status s;
   if (!use_direct_io_) {
@@ -408,6 +561,29 @@ Status PosixRandomAccessFile::Prefetch(uint64_t offset, size_t n) {
   return s;
 }
 
+Status PosixRandomAccessFile::PrefetchAsync(uint64_t offset, size_t n) {
+#if defined(ROCKSDB_IOURING_PRESENT)
+  PosixIOUring* iu = use_direct_io_ ? nullptr : GetIOUring();
+  if (iu != nullptr) {
+    ReapIOUringPrefetches(iu);
+    struct io_uring_sqe* sqe = iu->pending_prefetches < kIoUringDepth
+                                   ? io_uring_get_sqe(&iu->ring)
+                                   : nullptr;
+    if (sqe != nullptr) {
+      io_uring_prep_fadvise(sqe, fd_, static_cast<off_t>(offset),
+                            static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+      io_uring_sqe_set_data(sqe, nullptr);
+      if (io_uring_submit(&iu->ring) == 1) {
+        ++iu->pending_prefetches;
+        return Status::OK();
+      }
+      ResetIOUring();
+    }
+  }
+#endif
+  return Prefetch(offset, n);
+}
+
 #if defined(OS_LINUX) || defined(OS_MACOSX) || defined(OS_AIX)
 size_t PosixRandomAccessFile::GetUniqueId(char* id, size_t max_size) const {
   return PosixHelper::GetUniqueIdFromFile(fd_, id, max_size);
@@ -8,6 +8,10 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #pragma once
 #include <errno.h>
+#if defined(ROCKSDB_IOURING_PRESENT)
+#include <liburing.h>
+#include <sys/uio.h>
+#endif
 #include <unistd.h>
 
 #include <atomic>
@@ -15,6 +19,7 @@
 
 #include "rocksdb/env.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/thread_local.h"
 
 // For non linux platform, the following macros are used only as place
 // holder.
@@ -79,6 +84,35 @@ class PosixSequentialFile : public SequentialFile {
   }
 };
 
+#if defined(ROCKSDB_IOURING_PRESENT)
+// Queue depth of the io_uring instance of every thread
+const unsigned int kIoUringDepth = 256;
+
+struct PosixIOUring {
+  struct io_uring ring;
+  // PrefetchAsync() doesn't wait for its completions, they are reaped by
+  // later calls on the ring. At most kIoUringDepth are in flight.
+  unsigned int pending_prefetches = 0;
+};
+
+// Return nullptr if the kernel doesn't support io_uring
+inline PosixIOUring* CreateIOUring() {
+  PosixIOUring* iu = new PosixIOUring;
+  int ret = io_uring_queue_init(kIoUringDepth, &iu->ring, 0);
+  if (ret != 0) {
+    delete iu;
+    iu = nullptr;
+  }
+  return iu;
+}
+
+inline void DeleteIOUring(void* p) {
+  PosixIOUring* iu = static_cast<PosixIOUring*>(p);
+  io_uring_queue_exit(&iu->ring);
+  delete iu;
+}
+#endif
+
 class PosixRandomAccessFile : public RandomAccessFile {
  protected:
   std::string filename_;
@@ -86,17 +120,29 @@ class PosixRandomAccessFile : public RandomAccessFile {
   bool use_direct_io_;
   bool use_aio_reads_;
   size_t logical_sector_size_;
+  // The io_uring instances shared by all files of the Env, one per thread,
+  // nullptr if io_uring is not available
+  ThreadLocalPtr* thread_local_io_urings_;
 
  public:
   PosixRandomAccessFile(const std::string& fname, int fd,
-                        const EnvOptions& options);
+                        const EnvOptions& options,
+                        ThreadLocalPtr* thread_local_io_urings = nullptr);
   virtual ~PosixRandomAccessFile();
   virtual bool use_aio_reads() const final;
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const final;
 
+  // Submit all the reads to the io_uring of the calling thread at once
+  // instead of one pread at a time
+  virtual Status MultiRead(FSReadRequest* reqs, size_t num_reqs) override;
+
   virtual Status Prefetch(uint64_t offset, size_t n) override;
 
+  // Queue a readahead on the io_uring of the calling thread without waiting
+  // for it, fall back to Prefetch() without io_uring
+  virtual Status PrefetchAsync(uint64_t offset, size_t n) override;
+
 #if defined(OS_LINUX) || defined(OS_MACOSX) || defined(OS_AIX)
   virtual size_t GetUniqueId(char* id, size_t max_size) const override;
 #endif
@@ -107,6 +153,14 @@ class PosixRandomAccessFile : public RandomAccessFile {
     return logical_sector_size_;
   }
   virtual intptr_t FileDescriptor() const final;
+
+#if defined(ROCKSDB_IOURING_PRESENT)
+ private:
+  PosixIOUring* GetIOUring() const;
+  // Drop the io_uring of the calling thread after an error left it in an
+  // unknown state, a new one is created by the next call
+  void ResetIOUring() const;
+#endif
 };
 
 class PosixWritableFile : public WritableFile {
@@ -10,6 +10,10 @@
 
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "port/sys_time.h"
 #include "rocksdb/env.h"
@@ -38,6 +42,8 @@ class HdfsFatalException : public std::exception {
   const std::string what_;
 };
 
+class HdfsReadHandle;
+
 //
 // The HDFS environment for rocksdb. This class overrides all the
 // file/dir access methods and delegates the thread-mgmt methods to the
@@ -45,7 +51,9 @@ class HdfsFatalException : public std::exception {
 //
 class HdfsEnv : public Env {
  public:
-  explicit HdfsEnv(const std::string& fsname) : fsname_(fsname) {
+  explicit HdfsEnv(const std::string& fsname,
+                   const HdfsEnvOptions& options = HdfsEnvOptions())
+      : fsname_(fsname), options_(options) {
     posixEnv = Env::Default();
     fileSys_ = connectToPath(fsname_);
   }
@@ -169,12 +177,22 @@ class HdfsEnv : public Env {
   virtual uint64_t GetThreadID() const override { return HdfsEnv::gettid(); }
 
  private:
+  // The handle the random access files of fname read, shared by all of them
+  // if HdfsEnvOptions::reuse_read_handles
+  std::shared_ptr<HdfsReadHandle> GetReadHandle(const std::string& fname);
+  // Don't reuse the handle of fname any more, as it is deleted or renamed
+  void ReleaseReadHandle(const std::string& fname);
+
   std::string fsname_;  // string of the form "hdfs://hostname:port/"
   hdfsFS fileSys_;      //  a single FileSystem object for all files
   Env* posixEnv;        // This object is derived from Env, but not from
                         // posixEnv. We have posixnv as an encapsulated
                         // object here so that we can use posix timers,
                         // posix threads, etc.
+  HdfsEnvOptions options_;
+  std::mutex read_handles_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<HdfsReadHandle>>
+      read_handles_;
 
   static const std::string kProto;
   static const std::string pathsep;
@@ -191,7 +209,7 @@ class HdfsEnv : public Env {
     if (uri.find(kProto) != 0) {
       // uri doesn't start with hdfs:// -> use default:0, which is special
       // to libhdfs.
-      return hdfsConnectNewInstance("default", 0);
+      return connect("default", 0);
     }
     const std::string hostport = uri.substr(kProto.length());
 
@@ -212,10 +230,34 @@ class HdfsEnv : public Env {
     if (port == 0) {
       throw HdfsFatalException("Bad host-port for hdfs " + uri);
     }
-    hdfsFS fs = hdfsConnectNewInstance(host.c_str(), port);
+    hdfsFS fs = connect(host.c_str(), port);
     return fs;
   }
 
+  // Hedged reads are configured through a builder, only needed for them, so
+  // that older libhdfs without them still work otherwise
+  hdfsFS connect(const char* host, tPort port) {
+    if (options_.hedged_read_threads <= 0) {
+      return hdfsConnectNewInstance(host, port);
+    }
+    hdfsBuilder* builder = hdfsNewBuilder();
+    if (builder == nullptr) {
+      return nullptr;
+    }
+    hdfsBuilderSetForceNewInstance(builder);
+    hdfsBuilderSetNameNode(builder, host);
+    hdfsBuilderSetNameNodePort(builder, port);
+    std::string threads = std::to_string(options_.hedged_read_threads);
+    std::string threshold =
+        std::to_string(options_.hedged_read_threshold_millis);
+    hdfsBuilderConfSetStr(builder, "dfs.client.hedged.read.threadpool.size",
+                          threads.c_str());
+    hdfsBuilderConfSetStr(builder, "dfs.client.hedged.read.threshold.millis",
+                          threshold.c_str());
+    // Frees the builder
+    return hdfsBuilderConnect(builder);
+  }
+
   void split(const std::string& s, char delim,
              std::vector<std::string>& elems) {
     elems.clear();
@@ -240,7 +282,8 @@ static const Status notsup;
 
 class HdfsEnv : public Env {
  public:
-  explicit HdfsEnv(const std::string& /*fsname*/) {
+  explicit HdfsEnv(const std::string& /*fsname*/,
+                   const HdfsEnvOptions& /*options*/ = HdfsEnvOptions()) {
     fprintf(stderr, "You have not build rocksdb with HDFS support\n");
     fprintf(stderr, "Please see hdfs/README for details\n");
     abort();
@@ -290,6 +290,16 @@ struct AdvancedColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   double memtable_prefix_bloom_size_ratio = 0.0;
 
+  // Also add whole user keys to the memtable bloom filter, so point lookups
+  // that miss a memtable skip its rep entirely. Only takes effect when
+  // memtable_prefix_bloom_size_ratio is not 0, and works without a
+  // prefix_extractor.
+  //
+  // Default: false (disable)
+  //
+  // Dynamically changeable through SetOptions() API
+  bool memtable_whole_key_filtering = false;
+
   // Page size for huge page for the arena used by the memtable. If <=0, it
   // won't allocate from huge page but from malloc.
   // Users are responsible to reserve huge pages for it to be allocated. For
@@ -391,6 +401,39 @@ struct AdvancedColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   int level0_stop_writes_trigger = 36;
 
+  // Count the sub-levels of level-0 rather than its files towards
+  // level0_slowdown_writes_trigger and level0_stop_writes_trigger. The files
+  // of a sub-level don't overlap, a newer file is in a higher sub-level than
+  // the files it overlaps, and a read looks up one file per sub-level by
+  // binary search, so the triggers bound the level-0 lookups of a read
+  // rather than the files. Flushes of disjoint key ranges, e.g. the outputs
+  // of a partitioned flush, share a sub-level.
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool level0_stall_by_sublevels = false;
+
+  // Place the output of a flush at the bottommost level, rather than in
+  // level-0, when its key range overlaps no file of any level and no running
+  // compaction, and no older memtable is still waiting for its own flush.
+  // The loads writing their keys in order then skip level-0 and all the
+  // compactions below it. Only applies to kCompactionStyleLevel.
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool flush_to_bottommost_level = false;
+
+  // The number of threads evaluating the compaction filter of a compaction
+  // ahead of it, for the filters expensive enough to be the bottleneck. Each
+  // thread runs its own CompactionFilter::Clone(), the filters that can't be
+  // cloned run inline as with 0. The decisions are taken in key order, the
+  // output is the same as with the filter inline. Not used with a snapshot
+  // checker (WritePrepared transactions).
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API
+  uint32_t compaction_filter_threads = 0;
+
   // Target file size for compaction.
   // target_file_size_base is per-file size for level-1.
   // Target file size for level L can be calculated by
@@ -609,6 +652,11 @@ struct AdvancedColumnFamilyOptions {
   // ensure that there are never more than max_successive_merges merge
   // operations in the memtable.
   //
+  // When the chain ends at a value or deletion in the same memtable, the value
+  // is computed from the memtable alone, also while the WAL is recovered.
+  // Otherwise the value is read from the whole DB, which is skipped during
+  // recovery.
+  //
   // Default: 0 (disabled)
   //
   // Dynamically changeable through SetOptions() API
@@ -655,6 +703,19 @@ struct AdvancedColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   bool report_bg_io_stats = false;
 
+  // Only the table files among the hottest this share of the column family,
+  // by sampled reads, prefetch their index and filter at open, the others
+  // load them on demand. Files on level 0 and on the levels the table format
+  // pins (e.g. BlockBasedTableOptions::
+  // pin_index_and_filter_partitions_max_level) are always prefetched. The
+  // hotness is taken from the current version whenever it changes, files not
+  // in it yet count as hot.
+  //
+  // Default: 1.0 (prefetch all files)
+  //
+  // Dynamically changeable through SetOptions() API
+  double prefetch_index_and_filter_hot_file_ratio = 1.0;
+
   // Create ColumnFamilyOptions with default values for all fields
   AdvancedColumnFamilyOptions();
   // Create ColumnFamilyOptions from Options
@@ -0,0 +1,51 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+struct BackgroundCoordinatorOptions {
+  // The most compactions and GCs running at once in all the DBs. Each DB
+  // with compactions or GCs to run gets an equal share, and at least one.
+  // The flushes of a DB are limited by its own options only. 0 for no limit.
+  int max_background_jobs = 0;
+
+  // The flushes, compactions and GCs of the DBs without their own
+  // DBOptions::rate_limiter share a rate limiter of this rate, 0 for none
+  int64_t rate_bytes_per_sec = 0;
+
+  // The DBs without their own DBOptions::table_cache_memory_budget share
+  // this budget for their table readers, equally. 0 leaves them bounded by
+  // max_open_files.
+  uint64_t table_cache_memory_budget = 0;
+};
+
+// Shares the background resources of a process among the DBs it is set on,
+// see DBOptions::background_coordinator. The DBs register on open and
+// unregister on close. The DBs sharing an Env already share its thread pools,
+// the periodic work timer and, with ZenFS, the zone token pool of the device.
+class BackgroundCoordinator {
+ public:
+  virtual ~BackgroundCoordinator() {}
+
+  // The registered DBs, and how many of them have compactions or GCs
+  // pending or running
+  virtual size_t GetNumDBs() const = 0;
+  virtual size_t GetNumBusyDBs() const = 0;
+
+  // The compactions and GCs a busy DB may run at once now
+  virtual int GetBackgroundJobsShare() const = 0;
+};
+
+extern BackgroundCoordinator* NewBackgroundCoordinator(
+    const BackgroundCoordinatorOptions& options);
+
+}  // namespace TERARKDB_NAMESPACE
@@ -302,6 +302,21 @@ extern ROCKSDB_LIBRARY_API void rocksdb_multi_get_cf(
     const size_t* keys_list_sizes, char** values_list,
     size_t* values_list_sizes, char** errs);
 
+// Like rocksdb_multi_get(), but each value found is returned in a pinnable
+// slice to read in place and to release with rocksdb_pinnableslice_destroy(),
+// instead of a malloc'ed copy. NULL is returned for keys not found.
+extern ROCKSDB_LIBRARY_API void rocksdb_multi_get_pinned(
+    rocksdb_t* db, const rocksdb_readoptions_t* options, size_t num_keys,
+    const char* const* keys_list, const size_t* keys_list_sizes,
+    rocksdb_pinnableslice_t** values_list, char** errs);
+
+extern ROCKSDB_LIBRARY_API void rocksdb_multi_get_pinned_cf(
+    rocksdb_t* db, const rocksdb_readoptions_t* options,
+    const rocksdb_column_family_handle_t* const* column_families,
+    size_t num_keys, const char* const* keys_list,
+    const size_t* keys_list_sizes, rocksdb_pinnableslice_t** values_list,
+    char** errs);
+
 extern ROCKSDB_LIBRARY_API rocksdb_iterator_t* rocksdb_create_iterator(
     rocksdb_t* db, const rocksdb_readoptions_t* options);
 
@@ -410,6 +425,14 @@ extern ROCKSDB_LIBRARY_API const char* rocksdb_iter_value(
     const rocksdb_iterator_t*, size_t* vlen);
 extern ROCKSDB_LIBRARY_API void rocksdb_iter_get_error(
     const rocksdb_iterator_t*, char** errptr);
+// Copy up to max_entries entries from the current one on into buf, and
+// advance the iterator past them. keys_list and values_list point into buf.
+// Stops at the first entry that does not fit, and returns the number of
+// entries copied.
+extern ROCKSDB_LIBRARY_API size_t rocksdb_iter_next_batch(
+    rocksdb_iterator_t* iter, char* buf, size_t buf_len, size_t max_entries,
+    const char** keys_list, size_t* keys_list_sizes, const char** values_list,
+    size_t* values_list_sizes);
 
 extern ROCKSDB_LIBRARY_API void rocksdb_wal_iter_next(
     rocksdb_wal_iterator_t* iter);
@@ -450,6 +473,19 @@ extern ROCKSDB_LIBRARY_API void rocksdb_writebatch_putv_cf(
     int num_keys, const char* const* keys_list, const size_t* keys_list_sizes,
     int num_values, const char* const* values_list,
     const size_t* values_list_sizes);
+// Put or delete num_entries keys in one call
+extern ROCKSDB_LIBRARY_API void rocksdb_writebatch_put_many(
+    rocksdb_writebatch_t* b, size_t num_entries, const char* const* keys_list,
+    const size_t* keys_list_sizes, const char* const* values_list,
+    const size_t* values_list_sizes);
+extern ROCKSDB_LIBRARY_API void rocksdb_writebatch_put_many_cf(
+    rocksdb_writebatch_t* b, rocksdb_column_family_handle_t* column_family,
+    size_t num_entries, const char* const* keys_list,
+    const size_t* keys_list_sizes, const char* const* values_list,
+    const size_t* values_list_sizes);
+extern ROCKSDB_LIBRARY_API void rocksdb_writebatch_delete_many(
+    rocksdb_writebatch_t* b, size_t num_entries, const char* const* keys_list,
+    const size_t* keys_list_sizes);
 extern ROCKSDB_LIBRARY_API void rocksdb_writebatch_merge(rocksdb_writebatch_t*,
                                                          const char* key,
                                                          size_t klen,
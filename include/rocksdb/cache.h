@@ -37,6 +37,33 @@ namespace TERARKDB_NAMESPACE {
 
 class Cache;
 
+// A tier below a cache for the entries it evicts for capacity, e.g. keeping
+// them compressed, so that it holds more of them in the same memory as the
+// cache. The cache offers every entry it evicts to Demote() before calling
+// its deleter, the secondary cache keeps the ones it knows how to store. A
+// user missing in the cache asks Promote() for the entry and inserts it back
+// into the cache.
+class SecondaryCache {
+ public:
+  virtual ~SecondaryCache() {}
+
+  virtual const char* Name() const = 0;
+
+  // Offer an entry evicted from the cache. The entry is freed once this
+  // returns, so the secondary cache has to copy what it keeps.
+  virtual void Demote(const Slice& key, void* value, size_t charge,
+                      void (*deleter)(const Slice& key, void* value)) = 0;
+
+  // Take the entry of `key` out of the secondary cache. Returns nullptr if
+  // there is none. Otherwise returns its contents in a buffer of *size bytes
+  // from `allocator` (new[] if it is nullptr), which the caller owns.
+  virtual char* Promote(const Slice& key, MemoryAllocator* allocator,
+                        size_t* size) = 0;
+
+  // Memory used by the entries kept.
+  virtual size_t GetUsage() const = 0;
+};
+
 struct LRUCacheOptions {
   // Capacity of the cache.
   size_t capacity = 0;
@@ -75,6 +102,10 @@ struct LRUCacheOptions {
   // internally (currently only XPRESS).
   std::shared_ptr<MemoryAllocator> memory_allocator;
 
+  // If non-nullptr, the entries evicted for capacity are demoted into it.
+  // See SecondaryCache.
+  std::shared_ptr<SecondaryCache> secondary_cache;
+
   LRUCacheOptions() {}
   LRUCacheOptions(size_t _capacity, int _num_shard_bits,
                   bool _strict_capacity_limit, double _high_pri_pool_ratio,
@@ -92,15 +123,26 @@ struct LIRSCacheOptions {
   bool strict_capacity_limit = false;
   double irr_ratio = 0.9;
   std::shared_ptr<MemoryAllocator> memory_allocator;
+  // If true, irr_ratio is only the initial share of the LIR entries, every
+  // shard moves it online like ARC adapts its target size. Re-inserting a
+  // recently evicted HIR entry (a ghost hit) gives more room to the LIR
+  // entries, a hit on the bottom of the LIR stack gives more room to the HIR
+  // entries. The ratio stays within [0.1, 0.99].
+  bool adaptive_irr_ratio = false;
+  // If non-nullptr, the entries evicted for capacity are demoted into it.
+  // See SecondaryCache.
+  std::shared_ptr<SecondaryCache> secondary_cache;
   LIRSCacheOptions() {}
   LIRSCacheOptions(size_t _capacity, int _num_shard_bits,
                    bool _strict_capacity_limit, double _irr_ratio,
-                   std::shared_ptr<MemoryAllocator> _memory_allocator = nullptr)
+                   std::shared_ptr<MemoryAllocator> _memory_allocator = nullptr,
+                   bool _adaptive_irr_ratio = false)
       : capacity(_capacity),
         num_shard_bits(_num_shard_bits),
         strict_capacity_limit(_strict_capacity_limit),
         irr_ratio(_irr_ratio),
-        memory_allocator(std::move(_memory_allocator)) {}
+        memory_allocator(std::move(_memory_allocator)),
+        adaptive_irr_ratio(_adaptive_irr_ratio) {}
 };
 
 // Create a new cache with a fixed size capacity. The cache is sharded
@@ -129,15 +171,14 @@ std::shared_ptr<Cache> NewDiagnosableLRUCache(
 extern std::shared_ptr<Cache> NewLIRSCache(
     size_t capacity, int num_shard_bits = -1,
     bool strict_capacity_limit = false, double irr_ratio = 0.9,
-    std::shared_ptr<MemoryAllocator> memory_allocator = nullptr);
+    std::shared_ptr<MemoryAllocator> memory_allocator = nullptr,
+    bool adaptive_irr_ratio = false);
 
 extern std::shared_ptr<Cache> NewLIRSCache(const LIRSCacheOptions& cache_opts);
 
 // Similar to NewLRUCache, but create a cache based on CLOCK algorithm with
-// better concurrent performance in some cases. See util/clock_cache.cc for
+// better concurrent performance in some cases. See cache/clock_cache.cc for
 // more detail.
-//
-// Return nullptr if it is not supported.
 extern std::shared_ptr<Cache> NewClockCache(size_t capacity,
                                             int num_shard_bits = -1,
                                             bool strict_capacity_limit = false);
@@ -282,6 +323,9 @@ class Cache {
 
   MemoryAllocator* memory_allocator() const { return memory_allocator_.get(); }
 
+  // The tier the cache demotes its evicted entries into, if any.
+  virtual SecondaryCache* secondary_cache() const { return nullptr; }
+
  private:
   // No copying allowed
   Cache(const Cache&);
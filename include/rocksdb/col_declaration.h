@@ -0,0 +1,61 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// Encodings of a "FixedLength" column, which reads the column as an unsigned
+// integer of `size` bytes:
+// Varint: Variable length integer. See util/coding.h for more details
+// Rle (Run length encoding): encode a sequence of contiguous value as
+// [run_value][run_length]. Can be combined with Varint
+// Delta: Encode value to its delta with its adjacent entry. Use varint to
+// possibly reduce stored bytes. Can be combined with Rle.
+// Dictionary: Use a dictionary to record all possible values in the block and
+// encode them with an ID started from 0. IDs are encoded as varint. Can be
+// combined with Rle.
+enum ColCompressionType {
+  kColNoCompression,
+  kColRle,
+  kColVarint,
+  kColRleVarint,
+  kColDeltaVarint,
+  kColRleDeltaVarint,
+  kColDict,
+  kColRleDict
+};
+
+// ColDeclaration declares a column's type, algorithm of column-aware encoding,
+// and other column data like endian and nullability. The column types are:
+// "FixedLength":     `size` bytes, no more than 8
+// "LongFixedLength": `size` bytes, without special encodings
+// "VariableLength":  one byte length k, followed by k bytes
+// "VariableChunk":   chunks of 8 bytes, each followed by a one byte mask,
+//                    see utilities/col_buf_encoder.h
+struct ColDeclaration {
+  explicit ColDeclaration(
+      std::string _col_type,
+      ColCompressionType _col_compression_type = kColNoCompression,
+      size_t _size = 0, bool _nullable = false, bool _big_endian = false)
+      : col_type(_col_type),
+        col_compression_type(_col_compression_type),
+        size(_size),
+        nullable(_nullable),
+        big_endian(_big_endian) {}
+  std::string col_type;
+  ColCompressionType col_compression_type;
+  size_t size;
+  bool nullable;
+  bool big_endian;
+};
+
+}  // namespace TERARKDB_NAMESPACE
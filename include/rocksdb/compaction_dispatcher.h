@@ -45,6 +45,11 @@ class RemoteCompactionDispatcher : public CompactionDispatcher {
     virtual ~Worker();
     virtual std::string GenerateOutputFileName(size_t file_index) = 0;
     std::string DoCompaction(Slice data);
+    // Serve the framed requests of a persistent dispatcher until `in_fd` is
+    // closed. Table readers (and the block cache of the table factory) stay
+    // open between jobs of the same column family, output file metadata is
+    // streamed to `out_fd` as soon as each file is finished.
+    Status Serve(int in_fd, int out_fd);
     static void DebugSerializeCheckResult(Slice data);
 
    protected:
@@ -56,4 +61,10 @@ class RemoteCompactionDispatcher : public CompactionDispatcher {
 extern std::shared_ptr<CompactionDispatcher> NewCommandLineCompactionDispatcher(
     std::string cmd);
 
+// Keep a pool of at most `max_workers` worker processes started with `cmd`,
+// which must call RemoteCompactionDispatcher::Worker::Serve(0, 1). Workers are
+// reused between jobs, a worker that fails is killed and replaced.
+extern std::shared_ptr<CompactionDispatcher> NewPersistentCompactionDispatcher(
+    std::string cmd, size_t max_workers);
+
 }  // namespace TERARKDB_NAMESPACE
@@ -188,6 +188,30 @@ class CompactionFilter
     return Decision::kKeep;
   }
 
+  // The input and the decision of a FilterV2() call on a value
+  struct BatchEntry {
+    Slice key;
+    Slice existing_value_meta;
+    const LazyBuffer* existing_value;
+    Decision decision;
+    LazyBuffer* new_value;
+    std::string* skip_until;
+  };
+
+  // Sets the decision of each of the `n` entries, as FilterV2() with
+  // kValue. Only called with compaction_filter_threads, on the keys of a
+  // compaction filtered ahead. A filter with an overhead per call can do it
+  // once for the whole batch.
+  virtual void FilterBatch(int level, BatchEntry* entries, size_t n) const {
+    for (size_t i = 0; i < n; ++i) {
+      BatchEntry& entry = entries[i];
+      entry.decision = FilterV2(level, entry.key, ValueType::kValue,
+                                entry.existing_value_meta,
+                                *entry.existing_value, entry.new_value,
+                                entry.skip_until);
+    }
+  }
+
   // By default, compaction will only call Filter() on keys written after the
   // most recent call to GetSnapshot(). However, if the compaction filter
   // overrides IgnoreSnapshots to make it return true, the compaction filter
@@ -210,6 +234,9 @@ class CompactionFilter
     return Status::NotSupported();
   }
 
+  // Returns a new filter making the same decisions as this one, or nullptr.
+  // With compaction_filter_threads, the clones filter the upcoming keys of a
+  // compaction on other threads, one clone per thread.
   virtual CompactionFilter* Clone() const { return nullptr; }
 };
 
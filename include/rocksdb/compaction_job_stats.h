@@ -90,5 +90,19 @@ struct CompactionJobStats {
 
   // number of single-deletes which meet something other than a put
   uint64_t num_single_del_mismatch;
+
+  // the number of subcompactions this compaction was split into.
+  size_t num_subcompactions;
+  // the lowest and the highest output throughput of a single subcompaction
+  // in bytes per second.
+  uint64_t min_subcompaction_write_rate;
+  uint64_t max_subcompaction_write_rate;
+
+  // the number of compaction filter calls and the time spent in them, the
+  // time is estimated from a sample of the calls run inline. Their ratio is
+  // the rate of the filter, the filter is worth running on more
+  // compaction_filter_threads when it is below the input rate.
+  uint64_t num_filter_calls;
+  uint64_t total_filter_nanos;
 };
 }  // namespace TERARKDB_NAMESPACE
@@ -187,6 +187,31 @@ class DB {
       std::vector<ColumnFamilyHandle*>* handles, DB** dbptr,
       bool error_if_log_file_exist = false);
 
+  // Open the database `name` of a running primary as a secondary instance.
+  // Like a read only instance it never writes to `name`, but it follows the
+  // MANIFEST and the WALs of the primary with TryCatchUpWithPrimary(), so
+  // reads can be served by more than one process. `secondary_path` holds the
+  // info log of the secondary if options.info_log is nullptr.
+  //
+  // The primary does not know about its secondaries and deletes the files it
+  // no longer needs. A secondary keeps the tables it has opened readable, so
+  // max_open_files = -1 is recommended. Otherwise reads of the files deleted
+  // by the primary may fail until the next TryCatchUpWithPrimary().
+  //
+  // Not supported in ROCKSDB_LITE, in which case the function will
+  // return Status::NotSupported.
+  static Status OpenAsSecondary(const Options& options, const std::string& name,
+                                const std::string& secondary_path, DB** dbptr);
+
+  // OpenAsSecondary() with column families, which may be a subset of the
+  // column families of the database, but has to include the default one.
+  // Column families created by the primary later are not followed.
+  static Status OpenAsSecondary(
+      const DBOptions& db_options, const std::string& name,
+      const std::string& secondary_path,
+      const std::vector<ColumnFamilyDescriptor>& column_families,
+      std::vector<ColumnFamilyHandle*>* handles, DB** dbptr);
+
   // Open DB with column families.
   // db_options specify database specific options
   // column_families is the vector of all column families in the database,
@@ -207,6 +232,11 @@ class DB {
 
   virtual Status Resume() { return Status::NotSupported(); }
 
+  // Make the writes, flushes and compactions of the primary seen by a
+  // secondary instance up to now visible to the reads that follow, see
+  // OpenAsSecondary(). Only supported by secondary instances.
+  virtual Status TryCatchUpWithPrimary() { return Status::NotSupported(); }
+
   // Close the DB by releasing resources, closing files etc. This should be
   // called before calling the destructor so that the caller can get back a
   // status in case there are any errors. This will not fsync the WAL files.
@@ -408,6 +438,21 @@ class DB {
                 GetAsyncCallback);
   void GetAsync(const ReadOptions&, std::string key, GetAsyncCallback);
 
+  typedef std::function<void(std::vector<Status>&&,
+                             std::vector<std::string>&& keys,
+                             std::vector<std::string>&& values)>
+      MultiGetAsyncCallback;
+
+  // Look up every key in a fiber of its own, so that up to
+  // ReadOptions::aio_concurrency of them wait for reads at the same time, and
+  // call `cb` once all of them finished. Like GetAsync(), the lookups only
+  // make progress while the calling thread is in WaitAsync().
+  void MultiGetAsync(const ReadOptions&,
+                     std::vector<ColumnFamilyHandle*> column_families,
+                     std::vector<std::string> keys, MultiGetAsyncCallback);
+  void MultiGetAsync(const ReadOptions&, std::vector<std::string> keys,
+                     MultiGetAsyncCallback);
+
   static int WaitAsync(int timeout_us);
   static int WaitAsync();
 #endif  // WITH_BOOSTLIB
@@ -453,7 +498,8 @@ class DB {
   // If the key definitely does not exist in the database, then this method
   // returns false, else true. If the caller wants to obtain value when the key
   // is found in memory, a bool for 'value_found' must be passed. 'value_found'
-  // will be true on return if value has been set properly.
+  // will be true on return if value has been set properly. Without it, no
+  // value is read, as in KeyExists().
   // This check is potentially lighter-weight than invoking DB::Get(). One way
   // to make this lighter weight is to avoid doing any IOs.
   // Default implementation here returns true and sets 'value_found' to false
@@ -471,6 +517,19 @@ class DB {
     return KeyMayExist(options, DefaultColumnFamily(), key, value, value_found);
   }
 
+  // Returns OK if the key exists in the database, NotFound if it doesn't and
+  // another status on error. Same as Get() without a value, which reads no
+  // values: table formats that can tell from their index alone, such as
+  // TerarkZipTable, don't touch their value stores, and separated values are
+  // not fetched from their blob files.
+  Status KeyExists(const ReadOptions& options,
+                   ColumnFamilyHandle* column_family, const Slice& key) {
+    return Get(options, column_family, key);
+  }
+  Status KeyExists(const ReadOptions& options, const Slice& key) {
+    return KeyExists(options, DefaultColumnFamily(), key);
+  }
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -499,6 +558,16 @@ class DB {
   // not support snapshot.
   virtual const Snapshot* GetSnapshot() = 0;
 
+  // Like GetSnapshot(), but the snapshot may be one of up to
+  // `max_staleness_micros` ago that the DB shares with other callers, when
+  // the reads need a consistent view rather than the latest writes. The
+  // caller must call ReleaseSnapshot(result) just the same. The default
+  // takes a snapshot of its own.
+  virtual const Snapshot* GetStaleSnapshot(uint64_t max_staleness_micros) {
+    (void)max_staleness_micros;
+    return GetSnapshot();
+  }
+
   // Release a previously acquired snapshot.  The caller must not
   // use "snapshot" after this call.
   virtual void ReleaseSnapshot(const Snapshot* snapshot) = 0;
@@ -529,6 +598,14 @@ class DB {
     //      SST files.
     static const std::string kSSTables;
 
+    //  "rocksdb.key-range-heatmap" - returns a multi-line string with a row
+    //      per SST file of the current version, level -1 holding the blob
+    //      files: its key range and the estimated reads, writes and blob
+    //      fetches charged to it since it was opened. The estimates scale
+    //      the sampled counts up by the sampling rate, files that have not
+    //      been sampled are omitted.
+    static const std::string kKeyRangeHeatmap;
+
     //  "rocksdb.cfstats" - Both of "rocksdb.cfstats-no-file-histogram" and
     //      "rocksdb.cf-file-histogram" together. See below for description
     //      of the two.
@@ -548,6 +625,15 @@ class DB {
     //      level, as well as the histogram of latency of single requests.
     static const std::string kCFFileHistogram;
 
+    //  "rocksdb.cf-cpu-attribution" - returns a multi-line string with the
+    //      jobs, CPU time and wall time of the background jobs of the column
+    //      family since open, per kind of job.
+    static const std::string kCFCpuAttribution;
+
+    //  "rocksdb.cpu-attribution" - returns the same for all the background
+    //      jobs of the process, of all DBs.
+    static const std::string kCpuAttribution;
+
     //  "rocksdb.dbstats" - returns a multi-line string with general database
     //      stats, both cumulative (over the db's lifetime) and interval (since
     //      the last retrieval of kDBStats).
@@ -622,6 +708,24 @@ class DB {
     //      filter and index blocks).
     static const std::string kEstimateTableReadersMem;
 
+    //  "rocksdb.estimate-file-metadata-mem" - returns estimated memory of the
+    //      metadata of the files of the latest LSM tree, with the dependences
+    //      of the map SSTs and the inheritance sets of the blob files.
+    static const std::string kEstimateFileMetaDataMem;
+
+    //  "rocksdb.estimate-file-map-mem" - returns estimated memory of the
+    //      FileMap, which tracks the GC lineage of the blob files.
+    static const std::string kEstimateFileMapMem;
+
+    //  "rocksdb.estimate-key-hotness-mem" - returns estimated memory of the
+    //      sampled key hotness buffers of the DB and of the Oracle of its Env.
+    static const std::string kEstimateKeyHotnessMem;
+
+    //  "rocksdb.estimate-iterator-cache-mem" - returns estimated memory of
+    //      the arenas of the iterators over the files map SSTs depend on,
+    //      process wide.
+    static const std::string kEstimateIteratorCacheMem;
+
     //  "rocksdb.is-file-deletions-enabled" - returns 0 if deletion of obsolete
     //      files is enabled; otherwise, returns a non-zero number.
     static const std::string kIsFileDeletionsEnabled;
@@ -668,6 +772,15 @@ class DB {
     //      files belong to the latest LSM tree.
     static const std::string kLiveSstFilesSize;
 
+    //  "rocksdb.live-blob-files-size" - returns the total size of the blob
+    //      files of the latest LSM tree, included in live-sst-files-size.
+    static const std::string kLiveBlobFilesSize;
+
+    //  "rocksdb.estimate-blob-garbage-bytes" - returns an estimate of the
+    //      bytes of the live blob files no SST refers to anymore, which GC
+    //      reclaims.
+    static const std::string kEstimateBlobGarbageBytes;
+
     //  "rocksdb.base-level" - returns number of level to which L0 data will be
     //      compacted.
     static const std::string kBaseLevel;
@@ -705,6 +818,32 @@ class DB {
     //      entries being pinned.
     static const std::string kBlockCachePinnedUsage;
 
+    // "rocksdb.block-cache-hit-ratio-curve" - returns a multi-line string
+    //      with a row per capacity: the hit ratio the block cache would have
+    //      had with it. Only for a SimCache block cache sampling the curve,
+    //      see NewSimCache().
+    static const std::string kBlockCacheHitRatioCurve;
+
+    // "rocksdb.table-build-working-mem" - returns the working memory held by
+    //      the table builds of the process, for the table types bounding it.
+    static const std::string kTableBuildWorkingMem;
+
+    // "rocksdb.table-build-waiting-mem" - returns the working memory the
+    //      table builds of the process wait for.
+    static const std::string kTableBuildWaitingMem;
+
+    // "rocksdb.zenfs-free-bytes", "rocksdb.zenfs-garbage-bytes" and
+    //      "rocksdb.zenfs-capacity-bytes" - return the free, reclaimable and
+    //      total bytes of the zones as of the last zone stats zone GC took.
+    //      Not available without ZenFS.
+    static const std::string kZenFSFreeBytes;
+    static const std::string kZenFSGarbageBytes;
+    static const std::string kZenFSCapacityBytes;
+
+    // "rocksdb.zenfs-gc-migrated-bytes" - returns the valid bytes zone GC
+    //      has migrated since open. Not available without ZenFS.
+    static const std::string kZenFSGCMigratedBytes;
+
     // "rocksdb.options-statistics" - returns multi-line string
     //      of options.statistics
     static const std::string kOptionsStatistics;
@@ -744,6 +883,10 @@ class DB {
   //  "rocksdb.num-deletes-imm-mem-tables"
   //  "rocksdb.estimate-num-keys"
   //  "rocksdb.estimate-table-readers-mem"
+  //  "rocksdb.estimate-file-metadata-mem"
+  //  "rocksdb.estimate-file-map-mem"
+  //  "rocksdb.estimate-key-hotness-mem"
+  //  "rocksdb.estimate-iterator-cache-mem"
   //  "rocksdb.is-file-deletions-enabled"
   //  "rocksdb.num-snapshots"
   //  "rocksdb.oldest-snapshot-time"
@@ -763,6 +906,8 @@ class DB {
   //  "rocksdb.block-cache-capacity"
   //  "rocksdb.block-cache-usage"
   //  "rocksdb.block-cache-pinned-usage"
+  //  "rocksdb.table-build-working-mem"
+  //  "rocksdb.table-build-waiting-mem"
   virtual bool GetIntProperty(ColumnFamilyHandle* column_family,
                               const Slice& property, uint64_t* value) = 0;
   virtual bool GetIntProperty(const Slice& property, uint64_t* value) {
@@ -1079,6 +1224,20 @@ class DB {
       const TransactionLogIterator::ReadOptions& read_options =
           TransactionLogIterator::ReadOptions()) = 0;
 
+  // Sets iter to an iterator over the writes like GetUpdatesSince(), which
+  // reads the latest writes from memory as the write group leaders publish
+  // them, see DBOptions::change_feed_buffer_size. Only the writes it has
+  // fallen behind on are read from the WAL files. seq_number may be past the
+  // last sequence, the iterator then waits for it in WaitForUpdates().
+  // The iterator must be deleted before the db.
+  virtual Status NewChangeFeedIterator(
+      SequenceNumber /*seq_number*/,
+      std::unique_ptr<ChangeFeedIterator>* /*iter*/,
+      const TransactionLogIterator::ReadOptions& /*read_options*/ =
+          TransactionLogIterator::ReadOptions()) {
+    return Status::NotSupported("NewChangeFeedIterator() is not implemented.");
+  }
+
   virtual void SetGuardSeqno(SequenceNumber /*guard_seqno*/) {}
 
 // Windows API macro interference
@@ -42,5 +42,66 @@ class DbUndumpTool {
   bool Run(const UndumpOptions& undump_options,
            TERARKDB_NAMESPACE::Options options = TERARKDB_NAMESPACE::Options());
 };
+
+// The export of a database into a directory of chunks, for a migration.
+// The key space is split into partitions, at the live files of the database,
+// which are scanned in parallel into chunks of sorted keys. The progress of
+// every partition is checkpointed as its chunks are completed, so an
+// interrupted export resumes from there when run again. The database must not
+// be written between the runs of an export.
+struct ExportOptions {
+  enum ChunkFormat : char {
+    // SST files, ingested by the import
+    kSstChunk,
+    // Files of the dump format, which DbUndumpTool also loads
+    kDumpChunk,
+  };
+
+  // Database that will be exported
+  std::string db_path;
+  // Directory that will contain the chunks and the progress of the export
+  std::string export_dir;
+  // The format and the partitions of a resumed export are those of its first
+  // run
+  ChunkFormat chunk_format = kSstChunk;
+  int num_partitions = 64;
+  // The number of partitions exported at once
+  int num_threads = 8;
+  // A chunk is completed once it reaches this size
+  uint64_t chunk_size = 256 << 20;
+};
+
+class DbExportTool {
+ public:
+  bool Run(const ExportOptions& export_options,
+           TERARKDB_NAMESPACE::Options options = TERARKDB_NAMESPACE::Options());
+};
+
+// The import of a completed export, in parallel. The chunks imported are
+// checkpointed, so an interrupted import resumes with the others. A chunk
+// imported again after a crash, before it was checkpointed, rewrites the
+// same keys.
+struct ImportOptions {
+  // Database that the export will be imported into
+  std::string db_path;
+  // Directory of the export
+  std::string export_dir;
+  // File keeping the chunks imported, "IMPORT_PROGRESS" in db_path if empty
+  std::string progress_path;
+  // The number of chunks imported at once
+  int num_threads = 8;
+  // The number of SST chunks ingested together
+  int chunks_per_ingestion = 4;
+  // Move the SST chunks into the database instead of copying them
+  bool move_files = false;
+  // Compact the db after the import
+  bool compact_db = false;
+};
+
+class DbImportTool {
+ public:
+  bool Run(const ImportOptions& import_options,
+           TERARKDB_NAMESPACE::Options options = TERARKDB_NAMESPACE::Options());
+};
 }  // namespace TERARKDB_NAMESPACE
 #endif  // ROCKSDB_LITE
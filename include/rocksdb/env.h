@@ -206,6 +206,9 @@ struct EnvOptions {
   // See DBOptions doc
   size_t writable_file_max_buffer_size = 1024 * 1024;
 
+  // See DBOptions doc
+  size_t write_behind_buffers = 0;
+
   // If not nullptr, write rate limiting is enabled for flush and compaction
   RateLimiter* rate_limiter = nullptr;
 
@@ -236,6 +239,20 @@ class Oracle {
   virtual OracleAddKeyStatus AddKey(const std::string& key, uint64_t occurrence) = 0;
   virtual void UpdateStats() = 0;
   virtual void ReportProbeStats() = 0;
+
+  // Probe the type of `n` user keys at once and store them in `types`.
+  // Implementations may overlap the lookups of a batch and must not require
+  // the keys to be copied. The default implementation forwards each key to
+  // ProbeKeyType() through a reused buffer.
+  virtual void ProbeKeyTypes(const Slice* keys, size_t n, uint64_t occurrence,
+                             KeyType* types);
+
+  // Record one access for each of `n` user keys. Oracles learning from the
+  // write path override this, the default implementation ignores the keys.
+  virtual void RecordKeys(const Slice* /*keys*/, size_t /*n*/) {}
+
+  // The memory held by the key statistics, 0 if unknown
+  virtual size_t ApproximateMemoryUsage() const { return 0; }
 };
 
 class Env {
@@ -335,6 +352,10 @@ class Env {
     return;
   }
 
+  // (ZNS): The number of bytes a zone of the device holds, or 0 if the Env
+  // is not backed by zones
+  virtual uint64_t GetZoneCapacity() { return 0; }
+
   // See FileSystem::RegisterDbPaths.
   virtual Status RegisterDbPaths(const std::vector<std::string>& /*paths*/) {
     return Status::OK();
@@ -570,6 +591,14 @@ class Env {
                         Priority pri = LOW, void* tag = nullptr,
                         void (*unschedFunction)(void* arg) = nullptr) = 0;
 
+  // Like Schedule(), but the job is queued ahead of the jobs scheduled
+  // without urgency in the same pool.
+  virtual void ScheduleUrgent(void (*function)(void* arg), void* arg,
+                              Priority pri = LOW, void* tag = nullptr,
+                              void (*unschedFunction)(void* arg) = nullptr) {
+    Schedule(function, arg, pri, tag, unschedFunction);
+  }
+
   // Arrange to remove jobs for given arg from the queue_ if they are not
   // already scheduled. Caller is expected to have exclusive lock on arg.
   virtual int UnSchedule(void* /*arg*/, Priority /*pri*/) { return 0; }
@@ -654,6 +683,14 @@ class Env {
   // Lower CPU priority for threads from the specified pool.
   virtual void LowerThreadPoolCPUPriority(Priority /*pool*/ = LOW) {}
 
+  // Let the idle threads of pool `thief` run the jobs queued in pool
+  // `victim` while all threads of `victim` are busy, as long as `reserve`
+  // threads of `thief` stay idle for its own jobs. The stolen jobs run with
+  // the IO and CPU priority of the `thief` threads. A negative `reserve`
+  // stops the stealing. Off by default.
+  virtual void SetThreadPoolStealing(Priority /*victim*/, Priority /*thief*/,
+                                     int /*reserve*/) {}
+
   // Converts seconds-since-Jan-01-1970 to a printable string
   virtual std::string TimeToString(uint64_t time) = 0;
 
@@ -740,6 +777,12 @@ class Env {
   // If you're adding methods here, remember to add them to EnvWrapper too.
   virtual std::shared_ptr<Oracle> GetOracle() { return key_oracle_; }
 
+  // Replace the hotness oracle, must be called before any DB using this Env
+  // is opened. See NewSketchOracle() in rocksdb/sketch_oracle.h
+  virtual void SetOracle(std::shared_ptr<Oracle> oracle) {
+    key_oracle_ = std::move(oracle);
+  }
+
  protected:
   // The pointer to an internal structure that will update the
   // status of each thread.
@@ -1548,6 +1591,12 @@ class EnvWrapper : public Env {
     return target_->Schedule(f, a, pri, tag, u);
   }
 
+  void ScheduleUrgent(void (*f)(void* arg), void* a, Priority pri,
+                      void* tag = nullptr,
+                      void (*u)(void* arg) = nullptr) override {
+    return target_->ScheduleUrgent(f, a, pri, tag, u);
+  }
+
   int UnSchedule(void* tag, Priority pri) override {
     return target_->UnSchedule(tag, pri);
   }
@@ -1606,6 +1655,11 @@ class EnvWrapper : public Env {
     target_->LowerThreadPoolCPUPriority(pool);
   }
 
+  void SetThreadPoolStealing(Priority victim, Priority thief,
+                             int reserve) override {
+    target_->SetThreadPoolStealing(victim, thief, reserve);
+  }
+
   std::string TimeToString(uint64_t time) override {
     return target_->TimeToString(time);
   }
@@ -1662,6 +1716,11 @@ class EnvWrapper : public Env {
   }
 
   std::shared_ptr<Oracle> GetOracle() override { return target_->GetOracle(); }
+  void SetOracle(std::shared_ptr<Oracle> oracle) override {
+    target_->SetOracle(std::move(oracle));
+  }
+
+  uint64_t GetZoneCapacity() override { return target_->GetZoneCapacity(); }
 
  private:
   Env* target_;
@@ -1706,6 +1765,9 @@ class RandomAccessFileWrapper : public RandomAccessFile {
   Status Prefetch(uint64_t offset, size_t n) override {
     return target_->Prefetch(offset, n);
   }
+  Status PrefetchAsync(uint64_t offset, size_t n) override {
+    return target_->PrefetchAsync(offset, n);
+  }
   size_t GetUniqueId(char* id, size_t max_size) const override {
     return target_->GetUniqueId(id, max_size);
   }
@@ -1869,14 +1931,38 @@ class LoggerWrapper : public Logger {
 // *base_env must remain live while the result is in use.
 Env* NewMemEnv(Env* base_env);
 
+// Options of the HDFS environment, see hdfs/README
+struct HdfsEnvOptions {
+  // A random read shorter than this reads that many bytes at its offset, and
+  // the next reads of them are served from memory, so that the reads of
+  // adjacent blocks take a single round trip. 0 disables the readahead.
+  size_t random_access_readahead_size = 0;
+
+  // Open a file once for all of its random access files, instead of asking
+  // the name node again every time the table cache opens it
+  bool reuse_read_handles = true;
+
+  // If > 0, a read of a block that takes longer than
+  // hedged_read_threshold_millis is sent to another replica too, on a pool of
+  // this many threads, and the first to answer is used. Needs a libhdfs of
+  // Hadoop 2.4 or later.
+  int hedged_read_threads = 0;
+  int hedged_read_threshold_millis = 500;
+};
+
 // Returns a new environment that is used for HDFS environment.
 // This is a factory method for HdfsEnv declared in hdfs/env_hdfs.h
 Status NewHdfsEnv(Env** hdfs_env, const std::string& fsname);
+Status NewHdfsEnv(Env** hdfs_env, const std::string& fsname,
+                  const HdfsEnvOptions& options);
 
 // Returns a new environment that measures function call times for filesystem
 // operations, reporting results to variables in PerfContext.
 // This is a factory method for TimedEnv defined in utilities/env_timed.cc.
 Env* NewTimedEnv(Env* base_env);
+// Like above, but only times 1 in sample_every calls, at random, and counts
+// each of them sample_every times, so that the timing costs little
+Env* NewTimedEnv(Env* base_env, uint32_t sample_every);
 
 class MetricsReporterFactory;
 
@@ -1884,6 +1970,33 @@ Status NewZenfsEnv(
     Env** zenfs_env, const std::string& zdb_path, std::string bytedance_tags_,
     std::shared_ptr<MetricsReporterFactory> metrics_reporter_factory_);
 
+// (ZNS): Arbitration of the active zones of a ZenFS Env among its writers.
+// A writable file holds an active zone token from its first write until it
+// is closed. The writers are classed by priority: WAL and MANIFEST, flush,
+// compaction, and GC (the files created inside a GCIOScope).
+struct ZoneTokenOptions {
+  // Tokens shared by all writers, keep it within the device's active zone
+  // limit. 0 disables the arbitration.
+  int max_active_zones = 0;
+
+  // Tokens only the writers of a class may take. If they don't all fit in
+  // max_active_zones the reservations of the lower priority classes shrink.
+  int reserved_wal = 1;
+  int reserved_flush = 1;
+  int reserved_compaction = 0;
+  int reserved_gc = 0;
+
+  // A writer above the reservation of its class gives its token back once
+  // it has not written for this long and another writer waits. A writer of
+  // a lower priority class gives it back to a waiting higher priority writer
+  // right away. 0 only gives tokens back to higher priority writers.
+  uint64_t idle_micros = 1000 * 1000;
+};
+
+// (ZNS): Start arbitrating the active zones of the writable files `env`
+// creates from now on. Returns NotSupported if `env` is not a ZenFS Env.
+Status SetZoneTokenOptions(Env* env, const ZoneTokenOptions& options);
+
 #ifdef WITH_ZENFS
 Status GetZbdDiskSpaceInfo(Env* env, uint64_t* total, uint64_t* free,
                            uint64_t* used);
@@ -7,6 +7,7 @@
 
 #if !defined(ROCKSDB_LITE)
 
+#include <memory>
 #include <string>
 
 #include "env.h"
@@ -94,6 +95,52 @@ class ROT13BlockCipher : public BlockCipher {
   virtual Status Decrypt(char* data) override;
 };
 
+// Implements a BlockCipher using AES, with the AES-NI instructions when the
+// CPU has them.
+class AESBlockCipher final : public BlockCipher {
+ public:
+  static const size_t kBlockSize = 16;
+
+  // `key` is 16, 24 or 32 bytes long, for AES-128, AES-192 or AES-256.
+  // `allow_aesni` false forces the portable implementation.
+  static Status Create(const Slice& key,
+                       std::unique_ptr<AESBlockCipher>* result,
+                       bool allow_aesni = true);
+
+  virtual ~AESBlockCipher() {}
+
+  // BlockSize returns the size of each block supported by this cipher stream.
+  virtual size_t BlockSize() override { return kBlockSize; }
+
+  // Encrypt a block of data.
+  // Length of data is equal to BlockSize().
+  virtual Status Encrypt(char* data) override;
+
+  // Decrypt a block of data.
+  // Length of data is equal to BlockSize().
+  virtual Status Decrypt(char* data) override;
+
+  // XORs `num_blocks` blocks of `data` with the CTR mode key stream of `iv`
+  // from block `counter` on. Like in CTRCipherStream, the counter of a block
+  // replaces the first 8 bytes of `iv`, in little endian. Several blocks are
+  // encrypted at a time to keep the AES units of the CPU busy.
+  void CTRXorBlocks(const char* iv, uint64_t counter, char* data,
+                    size_t num_blocks);
+
+  bool UsesAESNI() const { return use_aesni_; }
+
+ private:
+  AESBlockCipher(const Slice& key, bool use_aesni);
+
+  size_t rounds_;
+  bool use_aesni_;
+  // The key schedule is only read after construction, and shared by all
+  // threads using the cipher
+  unsigned char round_keys_[15][kBlockSize];
+  // Round keys of the equivalent inverse cipher, for AES-NI
+  unsigned char dec_round_keys_[15][kBlockSize];
+};
+
 // CTRCipherStream implements BlockAccessCipherStream using an
 // Counter operations mode.
 // See https://en.wikipedia.org/wiki/Block_cipher_mode_of_operation
@@ -202,6 +249,26 @@ class CTREncryptionProvider : public EncryptionProvider {
       std::unique_ptr<BlockAccessCipherStream>* result);
 };
 
+// This encryption provider uses AES in CTR mode. The files are compatible
+// with a CTREncryptionProvider on the same AESBlockCipher, but its cipher
+// streams encrypt whole buffers at a time instead of a block per virtual
+// call.
+class AESCTREncryptionProvider : public CTREncryptionProvider {
+ public:
+  explicit AESCTREncryptionProvider(std::unique_ptr<AESBlockCipher>&& cipher)
+      : CTREncryptionProvider(*cipher), aes_cipher_(std::move(cipher)) {}
+  virtual ~AESCTREncryptionProvider() {}
+
+ protected:
+  virtual Status CreateCipherStreamFromPrefix(
+      const std::string& fname, const EnvOptions& options,
+      uint64_t initialCounter, const Slice& iv, const Slice& prefix,
+      std::unique_ptr<BlockAccessCipherStream>* result) override;
+
+ private:
+  std::unique_ptr<AESBlockCipher> aes_cipher_;
+};
+
 }  // namespace TERARKDB_NAMESPACE
 
 #endif  // !defined(ROCKSDB_LITE)
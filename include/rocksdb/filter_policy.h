@@ -26,6 +26,7 @@
 #include <string>
 #include <vector>
 
+#include "rocksdb/slice.h"
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -73,6 +74,16 @@ class FilterBitsReader {
 
   // Check if the entry match the bits in filter
   virtual bool MayMatch(const Slice& entry) = 0;
+
+  // Check keys[0, num_keys) at once, may_match[i] is set to
+  // MayMatch(keys[i]). Readers which can overlap the memory accesses of
+  // different keys override it, the default checks them one by one.
+  virtual void KeysMayMatch(size_t num_keys, const Slice* keys,
+                            bool* may_match) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      may_match[i] = MayMatch(keys[i]);
+    }
+  }
 };
 
 // We add a new format of filter block called full filter block
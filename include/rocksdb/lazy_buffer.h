@@ -9,6 +9,7 @@
 #pragma once
 
 #include <assert.h>
+#include <string.h>
 
 #include <string>
 #include <utility>
@@ -68,7 +69,8 @@ class LazyBufferState {
 
   // Use LazyBufferContext as local storage
   // data -> 32 bytes
-  static const LazyBufferState* light_state();
+  // Plain slices use it, so it's checked inline and never destroyed
+  static const LazyBufferState* light_state() { return light_state_; }
 
   // Use LazyBufferContext as buffer
   // data[0]     -> handle
@@ -98,6 +100,9 @@ class LazyBufferState {
 
   // Get &buffer->context_
   static LazyBufferContext* get_context(LazyBuffer* buffer);
+
+ private:
+  static const LazyBufferState* const light_state_;
 };
 
 class LazyBuffer {
@@ -125,6 +130,13 @@ class LazyBuffer {
   // Fix light_state local storage
   void fix_light_state(const LazyBuffer& other);
 
+  // light_state local storage
+  char* light_data() { return reinterpret_cast<char*>(context_.data); }
+
+  // Copy into light_state local storage if it fits, without going through
+  // the state
+  bool assign_light(const Slice& _slice);
+
  public:
   // Empty buffer
   LazyBuffer() noexcept;
@@ -396,7 +408,7 @@ inline LazyBuffer::LazyBuffer(const Slice& _slice, bool _copy,
       file_number_(_file_number),
       ucmp_(ucmp) {
   assert(_slice.valid());
-  if (_copy) {
+  if (_copy && !assign_light(_slice)) {
     state_->assign_slice(this, _slice);
   }
 }
@@ -431,11 +443,34 @@ inline LazyBuffer::LazyBuffer(const LazyBufferState* _state,
 #endif
 
 inline void LazyBuffer::destroy() {
-  if (state_ != nullptr) {
+  if (state_ != nullptr && state_ != LazyBufferState::light_state()) {
     state_->destroy(this);
   }
 }
 
+inline void LazyBuffer::fix_light_state(const LazyBuffer& other) {
+  assert(state_ == LazyBufferState::light_state());
+  assert(other.size_ <= sizeof(LazyBufferContext));
+  data_ = light_data();
+  size_ = other.size_;
+  if (!other.empty()) {
+    ::memmove(data_, other.data_, size_);
+  }
+}
+
+inline bool LazyBuffer::assign_light(const Slice& _slice) {
+  if (state_ != LazyBufferState::light_state() ||
+      _slice.size() > sizeof(LazyBufferContext)) {
+    return false;
+  }
+  if (!_slice.empty()) {
+    ::memmove(light_data(), _slice.data(), _slice.size());
+  }
+  data_ = light_data();
+  size_ = _slice.size();
+  return true;
+}
+
 inline void LazyBuffer::assign_error(Status&& _status) {
   if (_status.ok()) {
     state_->assign_slice(this, Slice());
@@ -488,7 +523,9 @@ inline void LazyBuffer::reset(const Slice& _slice, bool _copy,
                               uint64_t _file_number, Comparator* _ucmp) {
   assert(_slice.valid());
   if (_copy) {
-    state_->assign_slice(this, _slice);
+    if (!assign_light(_slice)) {
+      state_->assign_slice(this, _slice);
+    }
     assert(slice_ == _slice);
   } else {
     destroy();
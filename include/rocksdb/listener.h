@@ -50,6 +50,7 @@ class TablePropertiesCollectionIterator {
 
 class DB;
 class ColumnFamilyHandle;
+class Statistics;
 class Status;
 struct CompactionJobStats;
 enum CompressionType : unsigned char;
@@ -141,6 +142,12 @@ enum class CompactionReason : int {
   kGarbageCollectionMarkForHigh,
   // Found RangeDeletion
   kRangeDeletion,
+  // [Universal] Merging the sorted runs of a time window
+  kUniversalTimeWindow,
+  // kv separate GC merging small blob files
+  kBlobDefragment,
+  // Moving a file to the tier of its temperature, see hot_data_ratio
+  kPathMigration,
   // total number of compaction reasons, new reasons must be added above this.
   kNumOfReasons,
 
@@ -524,9 +531,40 @@ class EventListener {
   // initiate any further recovery actions needed
   virtual void OnErrorRecoveryCompleted(Status /* old_bg_error */) {}
 
+  // A callback function for RocksDB which will be called when a DB the
+  // listener is registered to is being closed, once its background work has
+  // stopped. The DB can still be used from within the callback.
+  virtual void OnDBClosing(DB* /*db*/) {}
+
   virtual ~EventListener() {}
 };
 
+struct AsyncEventListenerOptions {
+  // The most events waiting for the listener
+  size_t max_queued_events = 1024;
+  // If true, an event finding the queue full is dropped, otherwise the thread
+  // notifying it waits for room
+  bool drop_when_full = false;
+  // If non-null, ASYNC_LISTENER_EVENTS_DROPPED, ASYNC_LISTENER_EVENTS_BLOCKED,
+  // ASYNC_LISTENER_QUEUE_MICROS and ASYNC_LISTENER_CALLBACK_MICROS are
+  // recorded in it
+  std::shared_ptr<Statistics> statistics;
+};
+
+// Returns a listener that copies the events into a bounded queue and
+// notifies `listener` of them, in order, on a thread of its own. Slow
+// callbacks, such as ones making RPCs, then don't hold up flushes and
+// compactions.
+//
+// OnBackgroundError(), OnErrorRecoveryBegin() and ShouldBeNotifiedOnFileIO()
+// hand something back to the DB, and the handle passed to
+// OnColumnFamilyHandleDeletionStarted() is deleted right after it, so those
+// are still called on the thread of the event. The events of a DB queued
+// when it's closed are delivered by OnDBClosing().
+extern std::shared_ptr<EventListener> NewAsyncEventListener(
+    std::shared_ptr<EventListener> listener,
+    const AsyncEventListenerOptions& options = AsyncEventListenerOptions());
+
 #else
 
 class EventListener {};
@@ -75,4 +75,28 @@ extern Status NewJemallocNodumpAllocator(
     JemallocAllocatorOptions& options,
     std::shared_ptr<MemoryAllocator>* memory_allocator);
 
+struct PoolingAllocatorOptions {
+  // Allocations up to this size are rounded up to a size class, and recycled
+  // through per-core free lists when freed. Larger ones go to the base
+  // allocator directly. When used with block cache, it is recommended to set
+  // it a few times above block_size.
+  size_t max_pooled_size = 64 * 1024;
+
+  // Upper bound of the free memory kept by each core. It is not charged to
+  // the block cache, which charges every entry at the size of its class.
+  size_t max_free_bytes_per_core = 4 * 1024 * 1024;
+
+  // Where the pooled memory comes from, e.g. NewJemallocNodumpAllocator().
+  // nullptr for operator new[].
+  std::shared_ptr<MemoryAllocator> base_allocator;
+};
+
+// Allocator recycling freed blocks of the same size class. Block cache
+// entries are read and evicted at the rate of the lookups, mostly in the
+// sizes around the block size, so they reuse each other's memory instead of
+// going through the general allocator.
+extern Status NewPoolingMemoryAllocator(
+    const PoolingAllocatorOptions& options,
+    std::shared_ptr<MemoryAllocator>* memory_allocator);
+
 }  // namespace TERARKDB_NAMESPACE
@@ -342,15 +342,22 @@ class SkipListFactory : public MemTableRepFactory {
 // the vector is sorted. This is useful for workloads where iteration is very
 // rare and writes are generally not issued after reads begin.
 //
+// The writers append to a vector of their core, concurrent inserts are
+// supported.
+//
 // Parameters:
 //   count: Passed to the constructor of the underlying std::vector of each
 //     VectorRep. On initialization, the underlying array will be at least count
 //     bytes reserved for usage.
+//   sort_threads: The threads sorting an immutable memtable, the flush and up
+//     to sort_threads - 1 helpers, each given a run of at least 64K entries.
 class VectorRepFactory : public MemTableRepFactory {
   const size_t count_;
+  const size_t sort_threads_;
 
  public:
-  explicit VectorRepFactory(size_t count = 0) : count_(count) {}
+  explicit VectorRepFactory(size_t count = 0, size_t sort_threads = 1)
+      : count_(count), sort_threads_(sort_threads) {}
 
   using MemTableRepFactory::CreateMemTableRep;
   virtual MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator&,
@@ -359,6 +366,8 @@ class VectorRepFactory : public MemTableRepFactory {
                                          Logger* logger) override;
 
   virtual const char* Name() const override { return "VectorRepFactory"; }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
 };
 
 // This class contains a fixed array of buckets, each
@@ -393,37 +402,26 @@ extern MemTableRepFactory* NewHashLinkListRepFactory(
     bool if_log_bucket_dist_when_flash = true,
     uint32_t threshold_use_skiplist = 256);
 
-// This factory creates a cuckoo-hashing based mem-table representation.
-// Cuckoo-hash is a closed-hash strategy, in which all key/value pairs
-// are stored in the bucket array itself instead of in some data structures
-// external to the bucket array.  In addition, each key in cuckoo hash
-// has a constant number of possible buckets in the bucket array.  These
-// two properties together makes cuckoo hash more memory efficient and
-// a constant worst-case read time.  Cuckoo hash is best suitable for
-// point-lookup workload.
-//
-// When inserting a key / value, it first checks whether one of its possible
-// buckets is empty.  If so, the key / value will be inserted to that vacant
-// bucket.  Otherwise, one of the keys originally stored in one of these
-// possible buckets will be "kicked out" and move to one of its possible
-// buckets (and possibly kicks out another victim.)  In the current
-// implementation, such "kick-out" path is bounded.  If it cannot find a
-// "kick-out" path for a specific key, this key will be stored in a backup
-// structure, and the current memtable to be forced to immutable.
+// This factory creates a cuckoo-hashing based mem-table representation,
+// best suited for the point writes and lookups of column families that are
+// not scanned, like counters.
 //
-// Note that currently this mem-table representation does not support
-// snapshot (i.e., it only queries latest state) and iterators.  In addition,
-// MultiGet operation might also lose its atomicity due to the lack of
-// snapshot support.
+// The latest entry of each user key is stored in a concurrent cuckoo hash
+// map (libcuckoo), locked per bucket, so that concurrent writers of
+// different keys don't contend and a lookup of a key of a single version is
+// one probe of the map. The older versions of a key are stored in an
+// ordered overflow, which keeps the snapshots and the merge operator
+// working. The entries are only sorted when an iterator is created, as by
+// the flush; creating one locks the map until the entries are collected.
+// Concurrent memtable writes are supported.
 //
 // Parameters:
 //   write_buffer_size: the write buffer size in bytes.
 //   average_data_size: the average size of key + value in bytes.  This value
 //     together with write_buffer_size will be used to compute the number
-//     of buckets.
-//   hash_function_count: the number of hash functions that will be used by
-//     the cuckoo-hash.  The number also equals to the number of possible
-//     buckets each key will have.
+//     of slots reserved in the map.
+//   hash_function_count: ignored, kept for compatibility.  The map hashes
+//     each key to two buckets of several slots.
 extern MemTableRepFactory* NewHashCuckooRepFactory(
     size_t write_buffer_size, size_t average_data_size = 64,
     unsigned int hash_function_count = 4);
@@ -435,6 +433,30 @@ extern MemTableRepFactory* NewPatriciaTrieRepFactory(
     const std::unordered_map<std::string, std::string>& options,
     class Status* s);
 
+// This creates MemTableReps backed by a skip list whose entries store their
+// keys relative to a per-memtable dictionary of key prefixes, like the
+// tenant or table id shared by long keys. The prefix of a key is stored
+// once in the dictionary, and comparisons of keys sharing it skip it.
+// Falls back to SkipListFactory for a comparator other than the bytewise
+// one, and if no prefix is defined.
+//
+// @prefix_length: the length of the shared prefix of the user keys. If 0,
+//                 the prefix_extractor of the column family gives it.
+// @max_prefixes: the size of the dictionary of a memtable, the keys with a
+//                prefix past it are stored in full.
+extern MemTableRepFactory* NewPrefixSkipListRepFactory(
+    size_t prefix_length = 0, uint32_t max_prefixes = 1024);
+
+// This creates MemTableReps made of num_shards reps of the base factory,
+// the entries of a user key going to the rep its hash picks. The concurrent
+// writers of different keys insert into different reps instead of all
+// contending on the head of a single one, and the iterators merge them.
+//
+// @base: the factory of the shards. If null, SkipListFactory.
+// @num_shards: the number of reps of a memtable.
+extern MemTableRepFactory* NewShardedRepFactory(
+    std::shared_ptr<MemTableRepFactory> base = nullptr, size_t num_shards = 8);
+
 // The factory is to create memtables based on a hash table:
 // it contains a fixed array of buckets, each pointing to a
 // dualinked list. It also support concurrent updated
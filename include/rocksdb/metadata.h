@@ -63,6 +63,8 @@ struct SstFileMetaData {
         smallestkey(""),
         largestkey(""),
         num_reads_sampled(0),
+        num_writes_sampled(0),
+        num_blob_fetches_sampled(0),
         being_compacted(false),
         num_entries(0),
         num_deletions(0) {}
@@ -81,6 +83,8 @@ struct SstFileMetaData {
         smallestkey(_smallestkey),
         largestkey(_largestkey),
         num_reads_sampled(_num_reads_sampled),
+        num_writes_sampled(0),
+        num_blob_fetches_sampled(0),
         being_compacted(_being_compacted),
         num_entries(0),
         num_deletions(0) {}
@@ -97,6 +101,10 @@ struct SstFileMetaData {
   std::string smallestkey;        // Smallest user defined key in the file.
   std::string largestkey;         // Largest user defined key in the file.
   uint64_t num_reads_sampled;     // How many times the file is read.
+  // How many user writes hit the key range of the file.
+  uint64_t num_writes_sampled;
+  // How many separated values are fetched from the file.
+  uint64_t num_blob_fetches_sampled;
   bool being_compacted;  // true if the file is currently being compacted.
 
   uint64_t num_entries;
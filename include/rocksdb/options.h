@@ -36,6 +36,7 @@
 
 namespace TERARKDB_NAMESPACE {
 
+class BackgroundCoordinator;
 class Cache;
 class CompactionFilter;
 class CompactionFilterFactory;
@@ -49,10 +50,12 @@ class MergeOperator;
 class Snapshot;
 class MemTableRepFactory;
 class RateLimiter;
+class ResourceGroup;
 class Slice;
 class Statistics;
 class InternalKeyComparator;
 class WalFilter;
+class ZoneVictimPolicy;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -81,7 +84,14 @@ enum CompressionType : unsigned char {
   kDisableCompressionOption = 0xff,
 };
 
-enum WriteBufferFlushPri : unsigned char { kFlushOldest, kFlushLargest };
+// Which active memtable to flush when the WriteBufferManager is full
+enum WriteBufferFlushPri : unsigned char {
+  kFlushOldest,
+  kFlushLargest,
+  // Weigh size, age and write rate of the memtables of all column families of
+  // all DBs sharing the manager, see WriteBufferManager::PickFlushVictim()
+  kFlushArbitrated,
+};
 
 // Sst purpose
 enum SstPurpose {
@@ -302,6 +312,28 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // Default: 0 (init from DBOptions::max_subcompactions.)
   uint32_t max_subcompactions = 8;
 
+  // Upper bound on the number of key ranges a single flush is split into.
+  // The ranges are built in parallel on the flush pool and installed in one
+  // VersionEdit, each range becomes its own L0 file. A flush is only split
+  // into ranges of at least target_file_size_base bytes of memtable, and not
+  // at all when the memtables hold range deletions. Every output counts
+  // towards level0_slowdown_writes_trigger and level0_stop_writes_trigger.
+  // Default: 1 (disable)
+  //
+  // Dynamically changeable through SetOptions() API
+  uint32_t max_flush_partitions = 1;
+
+  // In a flush of an atomic_flush_group, a column family whose memtables to
+  // flush use less than this many bytes keeps its values in its L0 file
+  // instead of separating them into blob files, and is not split into key
+  // ranges. A flush of many small column families then writes one file and
+  // syncs one file per column family, the compactions separate the values
+  // later. The flush is still committed in a single MANIFEST write.
+  // Default: 0 (disable)
+  //
+  // Dynamically changeable through SetOptions() API
+  uint64_t atomic_flush_inline_value_size = 0;
+
   // Don't separate Value if value.size < blob_size
   // Set size_t(-1) to disable Key Value separation
   // valid [8 , size_t(-1)]
@@ -311,16 +343,39 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // valid [0 , 1]
   double blob_large_key_ratio = 0.25;
 
+  // (KV separation): Adapt blob_size and blob_large_key_ratio in a
+  // compaction to the sampled writes of the key range heatmap over its input
+  // key range. Where the keys are overwritten about as often as they are
+  // compacted, a blob_size several times larger keeps the medium values
+  // inline, since their blobs would soon be garbage to GC. Where the keys are
+  // barely written, a smaller blob_size and a larger blob_large_key_ratio
+  // separate the cold values more aggressively.
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool adaptive_blob_separation = false;
+
   // Key Value separation gc ratio
   // Startup GC when garbage ratio larger than blob_gc_ratio
   // valid [0 , 0.5]
   double blob_gc_ratio = 0.05;
 
+  // (ZNS): Number of hash partitions flush splits separated values into.
+  // Each non-empty partition holds its own blob file and thus an active
+  // zone, so keep it within the device's active zone limit.
+  // Default: 0 (use DBOptions::partition_num)
+  //
+  // Dynamically changeable through SetOptions() API
+  uint32_t blob_partition_num = 0;
+
   // Blob file size
   // Default : same as bottommost level sst file size
   uint64_t target_blob_file_size = 0;
 
-  // Blob file defragment threshold
+  // Blob file defragment threshold. Once there are 8 blob files GC may pick
+  // holding less live data than this, a GC job of their own merges many of
+  // them of about the same age into target_blob_file_size outputs, in up to
+  // max_subcompactions key ranges in parallel.
   // Default : target_blob_file_size / 8
   uint64_t blob_file_defragment_size = 0;
 
@@ -332,6 +387,50 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // 0 to 1
   double maintainer_job_ratio = 0.1;
 
+  // (Lazy compaction): Weight of the sampled read frequency when ranking map
+  // sst ranges for a real merge. A range's overlap depth is scaled by
+  // 1 + weight * (its sampled reads / the average sampled reads), so the
+  // hottest deeply overlapped ranges are merged first. 0 ranks ranges by
+  // overlap depth and garbage only.
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API
+  double lazy_compaction_read_heat_weight = 0;
+
+  // (With compaction_dispatcher): Compactions reading less than this many
+  // bytes run on local threads, as do all compactions out of level 0, they
+  // are on the write path and too small to amortize shipping the job.
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API
+  uint64_t remote_compaction_min_input_size = 0;
+
+  // (With compaction_dispatcher): Maximum number of jobs in flight on the
+  // dispatcher. When reached, new compactions run locally and writes are
+  // delayed until the dispatcher catches up. 0 means unlimited.
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API
+  uint64_t remote_compaction_max_pending_jobs = 0;
+
+  // If set, the values fetched from blob files are cached here, keyed by the
+  // blob file number, sequence number and user key, and the blocks of blob
+  // files they are read from no longer go to the block cache. This keeps the
+  // separated values from evicting the index and data blocks of key ssts.
+  // Default: nullptr (disabled)
+  std::shared_ptr<Cache> blob_cache = nullptr;
+
+  // (With blob_cache): Only cache a value at its second fetch, a value read
+  // once, as by a scan, then costs a small entry of the blob_cache only.
+  // Default: false
+  bool blob_cache_admit_on_second_access = false;
+
+  // If set, the file reads, the writes and the compactions and GCs of this
+  // column family draw from the token buckets of the group, shared with the
+  // other column families of the group. See NewResourceGroup().
+  // Default: nullptr (not limited)
+  std::shared_ptr<ResourceGroup> resource_group = nullptr;
+
   // This is a factory that provides TableFactory objects.
   // Default: a block-based table factory that provides a default
   // implementation of TableBuilder and TableReader with default
@@ -352,6 +451,17 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // Default: empty
   std::vector<DbPath> cf_paths;
 
+  // With several cf_paths (or db_paths), also place the SSTs by temperature:
+  // the first path is the fast tier and the last path the slowest one. The
+  // files holding the hottest `hot_data_ratio` of the bytes of the column
+  // family, by their sampled reads, writes and blob fetches per byte since
+  // the DB was opened, go to the first path. The cold blob SSTs and the cold
+  // SSTs of the bottommost level go to the last path, the other SSTs to the
+  // path of their level as above. The files on the wrong tier are moved by
+  // background compactions and GCs, a map SST is copied as is.
+  // Default: 0 (placement by size only)
+  double hot_data_ratio = 0;
+
   // The ratio of ttl to mark a SST to be compacted.
   // The value should be set no greater than 1.000.
   // If value less than 0.0, it acts the same as 0.0.
@@ -364,6 +474,24 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // Default: 0
   size_t ttl_max_scan_gap = 0;
 
+  // Drop the SSTs whose entries have all expired as whole files, without
+  // rewriting them through a compaction. Only files that have no older data
+  // of their key range beneath them are dropped, see ScheduleTtlGC. Needs
+  // ttl_extractor_factory.
+  // Default: false
+  bool ttl_drop_expired_files = false;
+
+  // (KV separation): Write every value of the blob SSTs in a data block of
+  // its own, so a point read of one value decompresses only that value
+  // rather than a whole block. With compression_opts.max_dict_bytes, a
+  // dictionary sampled from the first blob output of a compaction or GC
+  // (trained if zstd_max_train_bytes is set) is shared by its later blob
+  // outputs and stored in their compression dictionary meta block.
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool blob_compression_per_record = false;
+
   // Create ColumnFamilyOptions with default values for all fields
   ColumnFamilyOptions();
   // Create ColumnFamilyOptions from Options
@@ -470,6 +598,12 @@ struct DBOptions {
   // Default: nullptr
   std::shared_ptr<SstFileManager> sst_file_manager = nullptr;
 
+  // If set, this DB shares the background job slots, the rate limiter and
+  // the table cache budget of the coordinator with the other DBs of the
+  // process it is set on. See NewBackgroundCoordinator().
+  // Default: nullptr
+  std::shared_ptr<BackgroundCoordinator> background_coordinator = nullptr;
+
   // Any internal progress/error information generated by the db will
   // be written to info_log if it is non-nullptr, or to a file stored
   // in the same directory as the DB contents if info_log is nullptr.
@@ -727,6 +861,15 @@ struct DBOptions {
   // Not supported in ROCKSDB_LITE mode!
   bool use_direct_io_for_flush_and_compaction = false;
 
+  // Use O_DIRECT for the WAL writes, so they don't go through the page cache.
+  // Every flush of the WAL pads it with zeros to a 4 KB boundary, which the
+  // reader skips, so no partial page is written twice. Each write group then
+  // takes at least 4 KB of the WAL unless manual_wal_flush batches them. With
+  // recycle_log_file_num the recycled WALs are reopened for direct I/O too.
+  // Default: false
+  // Not supported in ROCKSDB_LITE mode!
+  bool use_direct_io_for_wal = false;
+
   // If false, fallocate() calls are bypassed
   bool allow_fallocate = true;
 
@@ -775,7 +918,10 @@ struct DBOptions {
 
   bool allow_mmap_populate = false;
 
-  //
+  // The memtable to flush when the write buffer manager is full. With
+  // kFlushArbitrated the victim may be in another DB sharing
+  // write_buffer_manager, that DB flushes it on its next write.
+  // Default: kFlushLargest
   WriteBufferFlushPri write_buffer_flush_pri = kFlushLargest;
 
   // Amount of data to build up in memtables across all column
@@ -993,7 +1139,10 @@ struct DBOptions {
   // transaction is encountered in the WAL
   bool allow_2pc = false;
 
-  // A global cache for table-level rows.
+  // A global cache for table-level rows. Point lookups cache what they find
+  // of a key in a table file, keyed by the file number, so entries of deleted
+  // files are never hit again and age out. The values separated to blob files
+  // are cached as their index only, see ColumnFamilyOptions::blob_cache.
   // Default: nullptr (disabled)
   // Not supported in ROCKSDB_LITE mode!
   std::shared_ptr<Cache> row_cache = nullptr;
@@ -1075,6 +1224,63 @@ struct DBOptions {
   // file.
   bool manual_wal_flush = false;
 
+  // If true, the WAL fsync of WriteOptions::sync writes runs on a dedicated
+  // thread instead of on the write group leader. The leader exits its group
+  // right after writing the WAL and the memtables, so the next group forms
+  // during the fsync, and every sync writer returns once the WAL holding its
+  // batch is durable. Such writes may become visible to readers before they
+  // are durable.
+  // Ignored with enable_pipelined_write and two_write_queues.
+  bool async_wal_sync = false;
+
+  // With async_wal_sync, the sync thread waits up to this long after the
+  // first pending sync request, so the groups written meanwhile share the
+  // fsync. 0 syncs as soon as a request comes in.
+  uint64_t async_wal_sync_max_delay_us = 0;
+
+  // Number of WAL files written side by side for each memtable generation.
+  // With more than one stream, a parallel memtable write group (see
+  // allow_concurrent_memtable_write) is cut into up to this many runs of
+  // batches, and each run is appended to its own stream by the first of its
+  // writers, so the WAL appends of one group no longer go through a single
+  // file. Every record keeps its global sequence number and recovery replays
+  // all the streams merged by sequence. Groups with a sync write still go to
+  // the first stream only, and sync all of them.
+  // After a crash each stream may lose its unsynced tail on its own, so what
+  // was written after the last WAL sync is not necessarily recovered as a
+  // prefix of the writes. GetUpdatesSince() is not supported with more than
+  // one stream.
+  // Ignored with enable_pipelined_write, two_write_queues, manual_wal_flush,
+  // allow_2pc and recycle_log_file_num. prepare_log_writer_num is ignored
+  // with more than one stream.
+  size_t wal_streams = 1;
+
+  // Compress the WAL records written from now on, kLZ4Compression and kZSTD
+  // are supported, anything else turns the compression off. Each record is
+  // compressed on its own and only kept compressed if that saves at least
+  // 12.5% of it, so small write batches are written as is. Recovery and
+  // GetUpdatesSince() read compressed and uncompressed records alike, but a
+  // WAL with compressed records can't be read by an older version.
+  CompressionType wal_compression = kNoCompression;
+
+  // With more than one thread, recovery inserts the WAL records into the
+  // memtables on this many threads, in groups of records, while the
+  // opening thread reads and checks the next records. A recovered memtable
+  // is flushed while the next group is inserted. Records with merges,
+  // transaction markers or value log indexes are still inserted one at a
+  // time. Needs allow_concurrent_memtable_write, ignored with seq_per_batch.
+  size_t wal_recovery_threads = 1;
+
+  // If true, every column family gets its own write stall state: the stop
+  // and slowdown conditions of a column family (too many memtables, level-0
+  // files or pending compaction bytes) only stop or delay the writes to it,
+  // at its own delayed write rate, and writes to other column families keep
+  // going. A write batch spanning several column families waits for the
+  // strictest of them. delayed_write_rate is the maximum rate of every
+  // column family. The stalled writes wait before they join a write group.
+  // If false, a stall in any column family stops or delays all writes.
+  bool isolate_cf_write_stalls = false;
+
   // If true, working thread may avoid doing unnecessary and long-latency
   // operation (such as deleting obsolete files directly or deleting memtable)
   // and will instead schedule a background job to do it.
@@ -1093,6 +1299,39 @@ struct DBOptions {
   double zenfs_high_gc_ratio = 0.6;
   double zenfs_force_gc_ratio = 0.9;
 
+  // (ZNS): Zone GC tries to keep at least this ratio of the device capacity
+  // free. The number of zones migrated per round grows with the distance
+  // below this target, and a single highly garbaged zone is trickled out per
+  // round while free space is within 1.5x of the target.
+  double zenfs_gc_free_ratio_target = 0.15;
+
+  // (ZNS): Upper bound of zones migrated by a single zone GC round.
+  uint64_t zenfs_gc_max_zones_per_run = 5;
+
+  // (ZNS): Ranks sealed zones for zone GC. If nullptr, a cost-benefit
+  // policy weighing garbage, zone age and hotness is used.
+  // See NewCostBenefitZoneVictimPolicy() in rocksdb/zone_victim_policy.h
+  std::shared_ptr<ZoneVictimPolicy> zenfs_zone_victim_policy = nullptr;
+
+  // (ZNS): If true and the Env reports its zone capacity (see
+  // Env::GetZoneCapacity()), the SST and blob files of flush, compaction and
+  // GC are cut to fill a zone: target_file_size_base and
+  // target_blob_file_size of every column family are set to the zone
+  // capacity minus 1/32 of it, which leaves room for the blocks written when
+  // a file is finished, and target_file_size_multiplier is set to 1. A
+  // full file then takes a zone of its own, and the last, partly filled
+  // output of a job shares the placement type, and thus the zones, of the
+  // files written with it.
+  bool zenfs_zone_aligned_file_size = false;
+
+  // (ZNS): If true, zone GC relocates the valid extents of a victim zone
+  // inside ZenFS: the extents are copied to another zone, the extents of a
+  // file back to back, and the ZenFS file metadata is pointed at the new
+  // location. The table files keep their contents and their numbers, so
+  // nothing is rewritten or verified again by the DB. If false, zone GC
+  // compacts the victim zones instead.
+  bool zenfs_gc_relocate_extents = true;
+
   // (ZNS): Used to designate the number of partitions constructed in ZenFS. 
   // This partition number can not be too big as we need to assign at least 
   // one active zone token for each partition while ZNS has a limitation on 
@@ -1101,6 +1340,85 @@ struct DBOptions {
   uint64_t partition_num = 4;
 
   bool enable_hot_separation = true;
+
+  // (ZNS): Sample the keys of one out of `hotness_sample_interval` write
+  // batches and periodically merge them into the Env's Oracle, so that the
+  // hot/warm separation of flush follows the live workload.
+  // Default: 0 (disabled)
+  uint32_t hotness_sample_interval = 0;
+
+  // (ZNS): Also sample the keys of Get() with the same interval.
+  bool hotness_sample_reads = false;
+
+  // Sample one out of `hot_block_sample_interval` data block reads which
+  // Get() and iterators filling the block cache do on block based tables.
+  // The blocks a table reads most form its hot block set.
+  // Default: 0 (disabled)
+  uint32_t hot_block_sample_interval = 0;
+
+  // If non-zero, the hot block sets of the live tables are written to
+  // HOT_BLOCKS in the DB directory every `hot_block_set_persist_period_sec`
+  // seconds and when the DB is closed. DB::Open() loads the blocks of a
+  // persisted set into the block cache again, by jobs in the LOW priority
+  // thread pool. Requires hot_block_sample_interval.
+  // Default: 0
+  unsigned int hot_block_set_persist_period_sec = 0;
+
+  // After a compaction, load the blocks of the outputs which hold the keys of
+  // the hot block sets of the inputs into the block cache. Requires
+  // hot_block_sample_interval.
+  // Default: false
+  bool warm_block_cache_after_compaction = false;
+
+  // With max_open_files = -1, only open the table readers of L0, L1 and map
+  // SSTs when the DB is opened or they are created. Other SSTs, blob SSTs
+  // included, are opened on their first access.
+  // Default: false
+  bool lazy_open_deep_sst = false;
+
+  // If non-zero, the table cache evicts idle table readers by their memory
+  // usage to stay in `table_cache_memory_budget` bytes instead of counting
+  // open files, and max_open_files is ignored. Only map SSTs are opened
+  // when the DB is opened.
+  // Default: 0
+  uint64_t table_cache_memory_budget = 0;
+
+  // Keep the table reader of an SST found in the table cache by its file
+  // metadata on first access, so later reads of the file skip the table
+  // cache lookup. Pinned readers are not evicted until the file is deleted,
+  // the option suits lazy_open_deep_sst with a bounded working set of files.
+  // Default: false
+  bool pin_table_reader_on_first_access = false;
+
+  // If non-zero, the write group leaders keep the records they write to the
+  // WAL in a buffer of up to this many bytes, and DB::NewChangeFeedIterator()
+  // reads the latest writes from it instead of reading the WAL files. A
+  // subscriber falling behind the buffer reads the WAL like GetUpdatesSince().
+  // Ignored with two_write_queues.
+  // Default: 0
+  size_t change_feed_buffer_size = 0;
+
+  // If non-zero, the put values of at least this many bytes are appended to a
+  // value log file next to the WAL, and the WAL and the memtable only record
+  // the value indexes pointing to them. The values are read from the value log
+  // until the memtable is flushed, and still count toward write_buffer_size
+  // and max_total_wal_size. A value log is deleted with its WAL. Sync writes
+  // sync it, SyncWAL() and FlushWAL() don't. GetUpdatesSince() and wal_filter
+  // pass the value indexes to WriteBatch::Handler::PutValueIndexCF(). Backups
+  // and checkpoints copying the WAL files don't copy the value logs.
+  // Ignored with two_write_queues, wal_streams and change_feed_buffer_size.
+  // Default: 0
+  size_t value_log_threshold = 0;
+
+  // If greater than 1, the table files written by flushes, compactions and
+  // SstFileWriter are written behind by a thread of each file's own: the
+  // filled buffers of up to writable_file_max_buffer_size bytes are copied to
+  // a queue of up to this many minus one buffers, and the job fills its next
+  // buffer while the thread writes the previous ones. Syncing and closing the
+  // file wait for the queued writes. Each open table file holds up to this
+  // many more buffers.
+  // Default: 0
+  size_t write_behind_buffers = 0;
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -1127,7 +1445,11 @@ struct Options : public DBOptions, public ColumnFamilyOptions {
   // constructor is to enable chaining of multiple similar calls in the future.
   //
 
-  // All data will be in level 0 without any automatic compaction.
+  // All data will be in level 0 without any automatic compaction, but for
+  // the flushes overlapping nothing, which go to the last level, see
+  // flush_to_bottommost_level. Loading the keys in order skips level 0.
+  // The memtables are vectors sorted in parallel when flushed, reading them
+  // is slow.
   // It's recommended to manually call CompactRange(NULL, NULL) before reading
   // from the database, because otherwise the read can be very slow.
   Options* PrepareForBulkLoad();
@@ -1191,6 +1513,16 @@ struct ReadOptions {
   // Default: 0
   size_t readahead_size;
 
+  // If non-zero, long forward scans keep the next async_prefetch_size bytes
+  // of the table file ahead of the data block being read in flight through
+  // RandomAccessFile::PrefetchAsync(), and start the head of the next file of
+  // a level when the scan moves into a new file, so that I/O overlaps with
+  // consuming the keys. TerarkZip tables do the same for the value stores
+  // they read by pread. Only effective on file systems implementing
+  // PrefetchAsync(), such as ZenFS.
+  // Default: 0
+  size_t async_prefetch_size;
+
   // A threshold for the number of keys that can be skipped before failing an
   // iterator seek as incomplete. The default value of 0 should be used to
   // never fail a request as incomplete, even on skipping too many keys.
@@ -1276,6 +1608,23 @@ struct ReadOptions {
   // Used to initialize an iterator for garbage collection usage. 
   bool open_for_gc = false;
 
+  // If true, the iterator only reads values stored separately (KV
+  // separation) when value() is called. Merge operands are not merged, the
+  // value() of a key merged from operands fails with Status::NotSupported.
+  // This suits scans that only need the keys, such as existence checks.
+  // The values left unfetched are counted by
+  // ITER_SEPARATED_VALUE_NOT_FETCHED.
+  // Default: false
+  bool keys_only = false;
+
+  // The indexes of the BlockBasedTableOptions::value_col_declarations a read
+  // needs. Only these columns are decoded from the columnar data blocks read
+  // without going through the block cache, e.g. with fill_cache false; the
+  // others read back as zero bytes, or as empty for "VariableLength". The
+  // values of cached blocks, memtables and row format blocks are complete.
+  // Default: empty, all the columns
+  std::vector<uint32_t> value_columns;
+
   ReadOptions();
   ReadOptions(bool cksum, bool cache);
 };
@@ -1432,6 +1781,12 @@ struct CompactRangeOptions {
   bool allow_write_stall = false;
   // If > 0, it will replace the option in the CFOptions for this compaction.
   uint32_t max_subcompactions = 0;
+  // If > 1, a level style compaction of the range is split into up to this
+  // many key ranges at the file boundaries of the last level it covers, and
+  // the ranges are compacted concurrently, each level after the other. With
+  // exclusive_manual_compaction, no other compaction runs alongside them.
+  // Ignored by universal and lazy compaction.
+  uint32_t max_parallel_ranges = 1;
 };
 
 // IngestExternalFileOptions is used by IngestExternalFile()
@@ -1469,6 +1824,11 @@ struct IngestExternalFileOptions {
   bool write_global_seqno = true;
   // Mark all files need compaction
   bool marked_for_compaction = false;
+  // Set to true to verify the block checksums of the files before they are
+  // ingested. The files are read and verified in parallel, on up to
+  // DBOptions::max_file_opening_threads threads. Tables that can't verify
+  // their checksums are ingested unverified.
+  bool verify_checksums_before_ingest = false;
 };
 
 // TraceOptions is used for StartTrace
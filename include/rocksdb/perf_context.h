@@ -108,6 +108,33 @@ struct PerfContext {
   // total nanos spent after Get() finds a key
   uint64_t get_post_process_time;
   uint64_t get_from_output_files_time;  // total nanos reading from output files
+  // (ZNS): number of separated values resolved through the blob lineage and
+  // the total lineage hops walked by them, see FileMap
+  uint64_t blob_lineage_resolve_count;
+  uint64_t blob_lineage_hop_count;
+  // Breakdown of the TerarkDB specific read costs. The timers nest, e.g. a
+  // blob fetch includes the index and store time of the blob file.
+  //
+  // number of separated values fetched from blob files
+  uint64_t blob_fetch_count;
+  // total nanos spent on fetching separated values from blob files
+  uint64_t blob_fetch_nanos;
+  // number of point lookups forwarded to linked files by map SSTs
+  uint64_t map_sst_get_count;
+  // number of linked files probed by the forwarded point lookups
+  uint64_t map_sst_hop_count;
+  // total nanos spent by map SST iterators on positioning the iterators of
+  // the linked files of a map element
+  uint64_t map_sst_seek_link_nanos;
+  // number of iterators on dependence files created by IteratorCache
+  uint64_t dependence_iter_create_count;
+  // total nanos spent on resolving dependence files and creating their
+  // iterators in IteratorCache
+  uint64_t dependence_iter_create_nanos;
+  // total nanos spent on searching the index of TerarkZip tables
+  uint64_t terark_zip_index_nanos;
+  // total nanos spent on reading records from the store of TerarkZip tables
+  uint64_t terark_zip_store_nanos;
   // total nanos spent on seeking memtable
   uint64_t seek_on_memtable_time;
   // number of seeks issued on memtable
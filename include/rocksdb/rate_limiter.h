@@ -92,6 +92,12 @@ class RateLimiter {
 
   virtual int64_t GetBytesPerSecond() const = 0;
 
+  // (ZNS): Reports the free capacity ratio of the device and the zone GC free
+  // ratio target, so that limiters budgeting GC migration I/O separately can
+  // adjust the GC share. No-op by default, see NewZoneGCRateLimiter().
+  virtual void UpdateZoneFreeRatio(double /*free_ratio*/,
+                                   double /*free_ratio_target*/) {}
+
   virtual bool IsRateLimited(OpType op_type) {
     if ((mode_ == RateLimiter::Mode::kWritesOnly &&
          op_type == RateLimiter::OpType::kRead) ||
@@ -137,4 +143,36 @@ extern RateLimiter* NewGenericRateLimiter(
     RateLimiter::Mode mode = RateLimiter::Mode::kWritesOnly,
     bool auto_tuned = false);
 
+// (ZNS): While alive, rate limited I/O issued by the current thread belongs to
+// the GC class of limiters created by NewZoneGCRateLimiter(). Zone migration
+// and blob garbage collection wrap their work with it. Scopes may nest.
+class GCIOScope {
+ public:
+  GCIOScope();
+  ~GCIOScope();
+
+  GCIOScope(const GCIOScope&) = delete;
+  GCIOScope& operator=(const GCIOScope&) = delete;
+
+  // Whether the calling thread is inside a GCIOScope
+  static bool Active();
+
+ private:
+  bool prev_;
+};
+
+// (ZNS): Create a RateLimiter which splits @rate_bytes_per_sec between the
+// regular flush/compaction I/O (high and low priority, as the generic limiter)
+// and a dedicated class for GC migration I/O issued inside a GCIOScope. The GC
+// class gets @max_gc_share of the budget when the free capacity reported by
+// UpdateZoneFreeRatio() is at or below half of the zone GC target, and
+// @min_gc_share when it is at or above 1.5x of the target, interpolating
+// linearly in between. Until the first report the GC class gets
+// @min_gc_share. See NewGenericRateLimiter() for the other parameters.
+extern RateLimiter* NewZoneGCRateLimiter(
+    int64_t rate_bytes_per_sec, double min_gc_share = 0.1,
+    double max_gc_share = 0.6, int64_t refill_period_us = 100 * 1000,
+    int32_t fairness = 10,
+    RateLimiter::Mode mode = RateLimiter::Mode::kWritesOnly);
+
 }  // namespace TERARKDB_NAMESPACE
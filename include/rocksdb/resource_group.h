@@ -0,0 +1,71 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class Statistics;
+
+struct ResourceGroupOptions {
+  // Shown in the info log of the column families in the group
+  std::string name;
+
+  // The token buckets of the group, 0 for no limit. The reads are the reads
+  // of the files of the group not served by a cache, for Get(), MultiGet()
+  // and the iterators. An operation limit below 100 per second is raised to
+  // 100.
+  int64_t read_ops_per_sec = 0;
+  int64_t read_bytes_per_sec = 0;
+  // The bytes of the write batches to the group
+  int64_t write_bytes_per_sec = 0;
+  // The bytes the compactions and the GCs of the group read and write
+  int64_t background_bytes_per_sec = 0;
+};
+
+struct ResourceGroupStats {
+  uint64_t read_ops = 0;
+  uint64_t read_bytes = 0;
+  uint64_t write_bytes = 0;
+  uint64_t background_bytes = 0;
+  // The time spent waiting for the token buckets
+  uint64_t read_wait_micros = 0;
+  uint64_t write_wait_micros = 0;
+  uint64_t background_wait_micros = 0;
+};
+
+// A share of the resources of a DB for the column families of a tenant, see
+// ColumnFamilyOptions::resource_group. The column families of a group, and
+// of several DBs, draw from the same token buckets. The time waited is also
+// recorded in the RESOURCE_GROUP_*_WAIT_MICROS tickers of the DB.
+class ResourceGroup {
+ public:
+  enum IOType { kRead, kWrite, kBackground };
+
+  virtual ~ResourceGroup() {}
+
+  virtual const std::string& Name() const = 0;
+
+  // Waits until the group may use `bytes` of `type`, a read counts as one
+  // operation too
+  virtual void Request(IOType type, size_t bytes, Statistics* stats) = 0;
+
+  // Whether the requests of `type` had to wait lately. The compactions and
+  // GCs of such a group are picked after those of other groups.
+  virtual bool IsThrottled(IOType type) const = 0;
+
+  virtual ResourceGroupStats GetStats() const = 0;
+};
+
+extern ResourceGroup* NewResourceGroup(const ResourceGroupOptions& options);
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,47 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+struct SketchOracleOptions {
+  // Number of counter blocks, rounded up to a power of two. Each block is one
+  // cache line of 16 counters, so the sketch takes `num_blocks * 64` bytes.
+  size_t num_blocks = 1 << 16;
+
+  // Counters updated per key, valid [1, 8]. All counters of a key live in the
+  // same block so that a probe costs a single cache miss.
+  size_t depth = 4;
+
+  // A key whose estimated access count within the current window reaches
+  // `warm_threshold` (`hot_threshold`) is classified as warm (hot), all other
+  // keys are cold. Set `hot_threshold` to UINT32_MAX to merge hot into warm.
+  uint32_t warm_threshold = 2;
+  uint32_t hot_threshold = 8;
+
+  // All counters are halved every `decay_interval` recorded accesses, so the
+  // classification follows the recent workload. 0 disables aging.
+  uint64_t decay_interval = 1 << 22;
+};
+
+// Create a lock free Oracle backed by a blocked count-min sketch.
+//
+// Unlike the ZenFS key set oracle it keeps no per-key state, so recording and
+// probing never allocate and are safe from any number of threads. Keys are
+// fed through Oracle::RecordKeys() (e.g. from the write path) and through
+// MergeKeys()/AddKey() with the occurrence counted by compaction.
+extern std::shared_ptr<Oracle> NewSketchOracle(
+    const SketchOracleOptions& options = SketchOracleOptions());
+
+}  // namespace TERARKDB_NAMESPACE
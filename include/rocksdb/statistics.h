@@ -262,6 +262,46 @@ enum Tickers : uint32_t {
   READ_BLOB_VALID,
   READ_BLOB_INVALID,
 
+  // # of times a block missing in the block cache is found in, or missing in,
+  // the secondary cache of the block cache.
+  BLOCK_CACHE_SECONDARY_HIT,
+  BLOCK_CACHE_SECONDARY_MISS,
+
+  // # of lazily loaded values, such as separated values and merge operands,
+  // that iterators moved past without fetching them.
+  ITER_SEPARATED_VALUE_NOT_FETCHED,
+
+  // # of separated values found in, or missing in, the blob cache.
+  BLOB_CACHE_HIT,
+  BLOB_CACHE_MISS,
+
+  // The residency of the PlainTable and CuckooTable files read through mmap,
+  // see MmapLoadOptions. The bytes of the files already resident in memory
+  // when opened with pretouch, the bytes pre-touched in the background, and
+  // the bytes copied into explicit huge pages.
+  TABLE_MMAP_RESIDENT_BYTES_AT_OPEN,
+  TABLE_MMAP_PRETOUCH_BYTES,
+  TABLE_MMAP_HUGE_PAGE_BYTES,
+
+  // # of events a listener from NewAsyncEventListener() dropped, and # of
+  // events it made wait for room, because its queue was full.
+  ASYNC_LISTENER_EVENTS_DROPPED,
+  ASYNC_LISTENER_EVENTS_BLOCKED,
+
+  // # of bytes of values appended to the value logs, see
+  // DBOptions::value_log_threshold.
+  VALUE_LOG_BYTES_WRITTEN,
+
+  // # of GC liveness checks answered by stepping the key SST iterator rather
+  // than by GC_GET_KEYS point lookups.
+  GC_PROBE_BY_ITERATOR,
+
+  // The time the reads, the writes and the background jobs waited for the
+  // token buckets of their ResourceGroup.
+  RESOURCE_GROUP_READ_WAIT_MICROS,
+  RESOURCE_GROUP_WRITE_WAIT_MICROS,
+  RESOURCE_GROUP_BACKGROUND_WAIT_MICROS,
+
   TICKER_ENUM_MAX
 };
 
@@ -379,6 +419,11 @@ enum Histograms : uint32_t {
 
   ZNS_WARM_GC_GET_KEY,
 
+  // Time the events of a listener from NewAsyncEventListener() wait in its
+  // queue, and time its callbacks take.
+  ASYNC_LISTENER_QUEUE_MICROS,
+  ASYNC_LISTENER_CALLBACK_MICROS,
+
   HISTOGRAM_ENUM_MAX,
 };
 
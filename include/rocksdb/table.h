@@ -20,8 +20,10 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "rocksdb/cache.h"
+#include "rocksdb/col_declaration.h"
 #include "rocksdb/env.h"
 #include "rocksdb/iterator.h"
 #include "rocksdb/options.h"
@@ -50,6 +52,9 @@ enum ChecksumType : char {
   kCRC32c = 0x1,
   kxxHash = 0x2,
   kxxHash64 = 0x3,
+  // XXH3 of xxHash 0.8, several times faster than the others on large blocks.
+  // The tables are not readable by versions without it.
+  kXXH3 = 0x4,
 };
 
 // For advanced user only
@@ -88,6 +93,18 @@ struct BlockBasedTableOptions {
   // freed. This is not limited to l0 in LSM tree.
   bool pin_top_level_index_and_filter = true;
 
+  // Limit pin_top_level_index_and_filter to the files on levels up to this
+  // one, the top-level index and filter of deeper files are cached and
+  // looked up on demand like their partitions. Files on unknown levels, e.g.
+  // ingested ones, are pinned as before. -1 pins all levels.
+  int pin_top_level_index_and_filter_max_level = -1;
+
+  // If cache_index_and_filter_blocks is true, prefetch and pin all index and
+  // filter partitions of the files on levels up to this one, like
+  // pin_l0_filter_and_index_blocks_in_cache does for level 0. -1 pins no
+  // level besides that.
+  int pin_index_and_filter_partitions_max_level = -1;
+
   // The index type that will be used for this table.
   enum IndexType : char {
     // A space efficient index block that is optimized for
@@ -108,6 +125,10 @@ struct BlockBasedTableOptions {
   enum DataBlockIndexType : char {
     kDataBlockBinarySearch = 0,   // traditional block type
     kDataBlockBinaryAndHash = 1,  // additional hash index
+    // additional fixed width key prefix per restart point, which narrows the
+    // restart search of Seek() before comparing keys. Only supported with
+    // BytewiseComparator(), see table/data_block_key_prefix.h
+    kDataBlockBinaryAndKeyPrefix = 2,
   };
 
   DataBlockIndexType data_block_index_type = kDataBlockBinarySearch;
@@ -259,6 +280,32 @@ struct BlockBasedTableOptions {
 
   // Align data blocks on lesser of page size and block size
   bool block_align = false;
+
+  // Compress the data blocks of a table on this many background threads,
+  // while the thread adding the keys writes them back in order. Only used
+  // with compression, the kBinarySearch index and full or no filters, other
+  // layouts compress on the thread adding the keys. The FileSize() of a
+  // builder counts the blocks being compressed by their raw size.
+  // Default: 1, no background compression
+  uint32_t parallel_compression_threads = 1;
+
+  // Declares the values as a sequence of columns, and stores the data blocks
+  // column by column: the keys, then every column of all the values of the
+  // block, each with its own encoding. Fixed schema values compress and scan
+  // better this way, and ReadOptions::value_columns can skip decoding the
+  // columns a scan does not need. Supported are "FixedLength" columns with
+  // any ColCompressionType, and "LongFixedLength" and "VariableLength"
+  // columns with kColNoCompression, none of them nullable.
+  //
+  // The values that do not match the columns, and the entries other than
+  // kTypeValue, are stored as they are. A block where fewer than half of the
+  // entries match is written in the row format. The columnar blocks are
+  // decoded to the row format when loaded, so the block cache holds row
+  // format blocks as usual. They cannot be read by versions without this
+  // option.
+  //
+  // Default: empty, row format data blocks
+  std::vector<ColDeclaration> value_col_declarations;
 };
 
 // Table Properties that are specific to block-based table properties.
@@ -275,6 +322,19 @@ struct BlockBasedTablePropertyNames {
 extern TableFactory* NewBlockBasedTableFactory(
     const BlockBasedTableOptions& table_options = BlockBasedTableOptions());
 
+// Create a secondary cache for BlockBasedTableOptions::block_cache (see
+// LRUCacheOptions::secondary_cache). It keeps the data and index blocks the
+// block cache evicts compressed with compression_type, and a block cache miss
+// decompresses the block from it instead of reading the file. Blocks which
+// don't compress well, or all of them if compression_type is not supported,
+// are kept uncompressed. Unlike block_cache_compressed, which is filled with
+// the blocks read from the file, it only holds the blocks evicted from the
+// block cache, so no block is kept in both. Return nullptr if
+// num_shard_bits is too large.
+extern std::shared_ptr<SecondaryCache> NewCompressedSecondaryCache(
+    size_t capacity, CompressionType compression_type = kLZ4Compression,
+    int num_shard_bits = -1);
+
 #ifndef ROCKSDB_LITE
 
 enum EncodingType : char {
@@ -303,6 +363,33 @@ struct PlainTablePropertyNames {
 
 const uint32_t kPlainTableVariableLength = 0;
 
+// How the PlainTable and CuckooTable readers bring the files they read
+// through mmap (allow_mmap_reads) into memory, for the tables served from RAM.
+// By default the pages are faulted in one by one by the reads.
+struct MmapLoadOptions {
+  // Touch all the pages of a file in the background once it is opened, so
+  // that the reads after a restart don't fault them in. Runs in the LOW
+  // priority thread pool.
+  bool pretouch = false;
+
+  // Ask for the mapping of a file to be backed by transparent huge pages
+  // (MADV_HUGEPAGE), which the kernel only does for file mappings if built
+  // with CONFIG_READ_ONLY_THP_FOR_FS.
+  bool transparent_huge_pages = false;
+
+  // If not 0, copy each file into memory taken from explicit huge pages of
+  // this size (MAP_HUGETLB) when opening it, and read it from there. The
+  // huge pages need to be reserved, like:
+  //     sysctl -w vm.nr_hugepages=20
+  // The file mapping is read if there are not enough of them.
+  size_t huge_page_size = 0;
+
+  // Interleave the pages of a file over all the NUMA nodes. Applies to the
+  // pages not in the page cache yet, and to the huge page copy. Requires a
+  // build with NUMA support.
+  bool numa_interleave = false;
+};
+
 struct PlainTableOptions {
   // @user_key_len: plain table has optimization for fix-sized keys, which can
   //                be specified via user_key_len.  Alternatively, you can pass
@@ -353,6 +440,9 @@ struct PlainTableOptions {
   //                       file building and store it in file. When reading
   //                       file, index will be mmaped instead of recomputation.
   bool store_index_in_file = false;
+
+  // @mmap_load: how the files are brought into memory in mmap mode.
+  MmapLoadOptions mmap_load;
 };
 
 // -- Plain Table with prefix-only seek
@@ -423,6 +513,8 @@ struct CuckooTableOptions {
   // power of two, and bit and is used to calculate hash, which is faster in
   // general.
   bool use_module_hash = true;
+  // How the files are brought into memory, they are always read through mmap.
+  MmapLoadOptions mmap_load;
 };
 
 // Cuckoo Table Factory for SST table format using Cache Friendly Cuckoo Hashing
@@ -532,6 +624,21 @@ class TableFactory
 
   // Return if table builder need second pass iter
   virtual bool IsBuilderNeedSecondPass() const { return false; }
+
+  // Whether a compaction writing about `build_bytes` to `level` would get the
+  // working memory of its table builds now. The DB defers the automatic
+  // compactions rejected here, so they don't wait for the memory inside the
+  // builders while holding a compaction slot.
+  virtual bool AdmitBuild(int /*level*/, uint64_t /*build_bytes*/) const {
+    return true;
+  }
+
+  // The working memory held by the table builds of the process, and the one
+  // they wait for, if this table type bounds it
+  virtual bool GetBuildMemoryUsage(uint64_t* /*working*/,
+                                   uint64_t* /*waiting*/) const {
+    return false;
+  }
 };
 
 #ifndef ROCKSDB_LITE
@@ -71,6 +71,7 @@ struct TablePropertiesNames {
   static const std::string kInheritanceTree;
   static const std::string kEarliestTimeBeginCompact;
   static const std::string kLatestTimeEndCompact;
+  static const std::string kLatestTimeExpire;
 };
 
 extern const std::string kPropertiesBlock;
@@ -287,5 +288,8 @@ extern uint64_t GetMergeOperands(const UserCollectedProperties& props,
 extern void GetCompactionTimePoint(const UserCollectedProperties& props,
                                    uint64_t* earliest_time_begin_compact,
                                    uint64_t* latest_time_end_compact);
+// The time point when every entry of the table has expired, kMaxUint64 if
+// some entries never expire
+extern uint64_t GetLatestTimeExpire(const UserCollectedProperties& props);
 
 }  // namespace TERARKDB_NAMESPACE
@@ -120,4 +120,15 @@ class TransactionLogIterator {
         : verify_checksums_(verify_checksums) {}
   };
 };
+
+// A TransactionLogIterator over the change feed of a db, see
+// DB::NewChangeFeedIterator(). Past the latest write the iterator is not
+// valid and its status() is OK, WaitForUpdates() then waits for more writes.
+class ChangeFeedIterator : public TransactionLogIterator {
+ public:
+  // If the iterator is not valid, wait up to `timeout_micros` for the write
+  // after the last one read and position the iterator at it.
+  // Returns Valid().
+  virtual bool WaitForUpdates(uint64_t timeout_micros) = 0;
+};
 }  //  namespace TERARKDB_NAMESPACE
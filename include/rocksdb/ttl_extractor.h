@@ -44,6 +44,12 @@ class TtlExtractorFactory
 
   virtual uint64_t Now() const = 0;
 
+  // Return true if an entry never expires later than the input SSTs of the
+  // compaction rewriting it say, e.g. when Extract() computes the ttl time
+  // point from Now() rather than from the entry. The latest expiry time of
+  // the compaction outputs is then capped by that of the inputs.
+  virtual bool BoundedByInputs() const { return false; }
+
   virtual const char* Name() const = 0;
 
   virtual Status Serialize(std::string* /*bytes*/) const {
@@ -75,6 +75,18 @@ class CompactionOptionsUniversal {
   // Default: false
   bool allow_trivial_move;
 
+  // Time window compaction, replacing DateTieredDB. If not zero, every sorted
+  // run belongs to the window of the latest expiry time of its entries, as
+  // reported by ttl_extractor_factory, divided by `time_window`, in the unit
+  // of TtlExtractorFactory::Now(). Sorted runs are only merged with the runs
+  // of the same window, at least min_merge_width and at most max_merge_width
+  // of them at a time. A run written late for an older window is linked into
+  // that window when no run in between overlaps its key range. Set
+  // ttl_drop_expired_files to drop whole windows once they expire.
+  // Needs ttl_extractor_factory, ignored without it.
+  // Default: 0
+  uint64_t time_window;
+
   // Default set of parameters
   CompactionOptionsUniversal()
       : size_ratio(1),
@@ -83,7 +95,8 @@ class CompactionOptionsUniversal {
         max_size_amplification_percent(200),
         compression_size_percent(-1),
         stop_style(kCompactionStopStyleTotalSize),
-        allow_trivial_move(false) {}
+        allow_trivial_move(false),
+        time_window(0) {}
 };
 
 }  // namespace TERARKDB_NAMESPACE
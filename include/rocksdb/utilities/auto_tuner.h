@@ -0,0 +1,120 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class ColumnFamilyHandle;
+class DB;
+
+// A condition of an AutoTunerRule, like the conditions of tools/advisor but
+// on live metrics. A metric is the per second rate of a ticker since the last
+// evaluation when it names one, e.g. "rocksdb.stall.micros", or else an
+// integer property of the tuned column family, e.g.
+// "rocksdb.estimate-pending-compaction-bytes". If `divisor` names a metric
+// too, metric / divisor is compared against the threshold. A condition whose
+// metrics are not available does not hold.
+struct AutoTunerCondition {
+  enum Operator { kGreater, kLess };
+
+  std::string metric;
+  std::string divisor;
+  Operator op = kGreater;
+  double threshold = 0;
+};
+
+struct AutoTunerSuggestion {
+  enum Action { kIncrease, kDecrease };
+
+  // A mutable DB option or mutable option of the tuned column family
+  std::string option;
+  Action action = kIncrease;
+};
+
+// The suggestions of a rule apply when all its conditions hold
+struct AutoTunerRule {
+  std::string name;
+  std::vector<AutoTunerCondition> conditions;
+  std::vector<AutoTunerSuggestion> suggestions;
+};
+
+// An option is changed by `factor` at a time, and by at least 1 if it is an
+// integer, within [min, max]
+struct AutoTunerBounds {
+  double min = 0;
+  double max = 0;
+  double factor = 1.25;
+};
+
+// The rules of tools/advisor/advisor/rules.ini the live metrics can tell, and
+// rules on the space of the blob files and of the ZenFS zones for the GC
+// options
+extern std::vector<AutoTunerRule> DefaultAutoTunerRules();
+
+struct AutoTunerOptions {
+  std::vector<AutoTunerRule> rules = DefaultAutoTunerRules();
+
+  // The options the tuner may change, by option name. The suggestions on any
+  // other option are ignored.
+  std::unordered_map<std::string, AutoTunerBounds> bounds;
+
+  // The column family whose options are tuned and whose properties are the
+  // metrics, nullptr for the default column family
+  ColumnFamilyHandle* column_family = nullptr;
+
+  // The rules are evaluated every period_sec seconds on a thread of the
+  // tuner. If 0, only by AutoTuner::EvaluateOnce().
+  unsigned int period_sec = 300;
+
+  // The metric measuring the effect of a change, at the evaluation after it.
+  // The options are not changed while the effect of a change is measured.
+  std::string objective = "rocksdb.bytes.written";
+
+  // A change is undone if the objective dropped by more than this fraction
+  // after it, and not made again for 8 evaluations. 0 keeps every change.
+  double revert_threshold = 0.1;
+};
+
+// A change the tuner made, logged to the info log of the DB with its effect
+struct AutoTunerChange {
+  std::string rule;
+  std::string option;
+  std::string old_value;
+  std::string new_value;
+  // The objective in the period before the change and after it, negative
+  // until measured or if not available
+  double objective_before = -1;
+  double objective_after = -1;
+  bool reverted = false;
+};
+
+class AutoTuner {
+ public:
+  virtual ~AutoTuner() {}
+
+  // Evaluate the rules and apply their suggestions now
+  virtual Status EvaluateOnce() = 0;
+
+  // The changes made so far, oldest first
+  virtual std::vector<AutoTunerChange> GetChanges() const = 0;
+};
+
+// Tune the options of `db` by the rules of `options` while `tuner` lives.
+// The tuner must be destroyed before the DB and the tuned column family.
+extern Status NewAutoTuner(DB* db, const AutoTunerOptions& options,
+                           std::unique_ptr<AutoTuner>* tuner);
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
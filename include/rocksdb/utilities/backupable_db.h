@@ -120,6 +120,20 @@ struct BackupableDBOptions {
   // Default: INT_MAX
   int max_valid_backups_to_open;
 
+  // Table files of at least this size are backed up as content defined
+  // chunks in the directory shared_chunks, rather than as whole files. A
+  // chunk is uploaded only if no backup holds it yet, so the blob files GC
+  // rewrites under new file numbers only ship the regions that changed. The
+  // chunks are uploaded by the max_background_operations threads. Only used
+  // if share_table_files is true.
+  // Default: 0, which backs up whole files
+  uint64_t chunked_table_file_min_size = 0;
+
+  // The average size of the chunks above, rounded down to a power of two.
+  // Chunks are cut between a quarter and four times this size.
+  // Default: 1MB
+  uint64_t table_file_chunk_avg_size = 1 << 20;
+
   void Dump(Logger* logger) const;
 
   explicit BackupableDBOptions(
@@ -8,7 +8,10 @@
 #pragma once
 #ifndef ROCKSDB_LITE
 
+#include <stdint.h>
+
 #include <string>
+#include <vector>
 
 #include "rocksdb/status.h"
 #include "rocksdb/terark_namespace.h"
@@ -17,6 +20,13 @@ namespace TERARKDB_NAMESPACE {
 
 class DB;
 
+// A table file of the database a reference checkpoint points to
+struct CheckpointFileRef {
+  // Relative to the database directory, prefixed with "/"
+  std::string name;
+  uint64_t size = 0;
+};
+
 class Checkpoint {
  public:
   // Creates a Checkpoint object to be used for creating openable snapshots
@@ -38,6 +48,27 @@ class Checkpoint {
   virtual Status CreateCheckpoint(const std::string& checkpoint_dir,
                                   uint64_t log_size_for_flush = 0);
 
+  // Builds a checkpoint without hard links or copies of the table files, for
+  // filesystems such as ZenFS where links are not cheap or not supported.
+  // The manifest, the options and the live WAL files are copied into
+  // `checkpoint_dir`, as by CreateCheckpoint(). The live table files are only
+  // recorded, in `referenced_files` and in the file REFERENCED_FILES of the
+  // directory, one "<file name> <size>" per line. The directory becomes
+  // openable once the referenced files are copied into it.
+  //
+  // The deletion of obsolete files in the database stays disabled until
+  // ReleaseReferenceCheckpoint() is called, so the referenced files can be
+  // read from the database directory meanwhile. File numbers are never
+  // reused, so an incremental backup only needs to ship the referenced files
+  // missing from the previous backup.
+  virtual Status CreateReferenceCheckpoint(
+      const std::string& checkpoint_dir,
+      std::vector<CheckpointFileRef>* referenced_files,
+      uint64_t log_size_for_flush = 0);
+
+  // Releases the files pinned by one successful CreateReferenceCheckpoint()
+  virtual Status ReleaseReferenceCheckpoint();
+
   virtual ~Checkpoint() {}
 };
 
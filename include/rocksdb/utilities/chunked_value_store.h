@@ -0,0 +1,82 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+
+#include <memory>
+
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+struct ChunkedValueOptions {
+  // The values are split into chunks of this size, a write or a read of a
+  // value holds a chunk in memory at a time
+  size_t chunk_size = 1 << 20;
+};
+
+// A value read by ChunkedValueStore::GetStream(), fetched a chunk at a time
+class ValueStream {
+ public:
+  virtual ~ValueStream() {}
+
+  // The size of the whole value, and the bytes read or skipped so far
+  virtual uint64_t size() const = 0;
+  virtual uint64_t offset() const = 0;
+
+  // Read up to `n` bytes, less at the end of the value. `*result` is valid
+  // until the next call.
+  virtual Status Read(size_t n, Slice* result) = 0;
+
+  // Skip up to `n` bytes, without fetching the chunks skipped over
+  virtual Status Skip(uint64_t n) = 0;
+};
+
+// Writes and reads values far larger than the memory a write batch or a
+// LazyBuffer should take. A value is written as chunks to `chunk_cf`, and
+// as a small index of the chunks to `value_cf` once all the chunks are
+// written. Set the blob options of `chunk_cf`, e.g. a blob_size below
+// chunk_size, to separate the chunks into blob files, the compactions of
+// `chunk_cf` then move their references and not the chunks.
+//
+// `chunk_cf` must use the bytewise comparator and hold nothing else. A key
+// must not be written by two PutStream() or Delete() at once.
+class ChunkedValueStore {
+ public:
+  // `db` and the column families outlive the store
+  ChunkedValueStore(DB* db, ColumnFamilyHandle* value_cf,
+                    ColumnFamilyHandle* chunk_cf,
+                    const ChunkedValueOptions& options = ChunkedValueOptions());
+
+  // Write the `size` bytes of `reader` as the value of `key`. The previous
+  // value of `key` is replaced, with its chunks, when all the chunks are
+  // written. The chunks of an interrupted PutStream() are left behind until
+  // DeleteOrphanChunks().
+  Status PutStream(const WriteOptions& options, const Slice& key,
+                   SequentialFile* reader, uint64_t size);
+
+  // Read the value of `key` on a snapshot, `read_options.snapshot` if set,
+  // which the stream holds until destroyed. A value not written by
+  // PutStream() is streamed from memory.
+  Status GetStream(const ReadOptions& read_options, const Slice& key,
+                   std::unique_ptr<ValueStream>* stream);
+
+  Status Delete(const WriteOptions& options, const Slice& key);
+
+  // Delete the chunks no index refers to. Not to be run with PutStream().
+  Status DeleteOrphanChunks(const WriteOptions& options);
+
+ private:
+  DB* db_;
+  ColumnFamilyHandle* value_cf_;
+  ColumnFamilyHandle* chunk_cf_;
+  const ChunkedValueOptions options_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // !ROCKSDB_LITE
@@ -35,6 +35,10 @@ namespace TERARKDB_NAMESPACE {
 // expired (CF_Timestamp <= CUR_Timestamp - TTL), we directly drop the whole
 // column family.
 //
+// CompactionOptionsUniversal::time_window tiers a single column family by
+// time instead, with iterators across the windows and without the overhead of
+// a column family per window.
+//
 // TODO(jhli): This is only a simplified version of DTCS. In a complete DTCS,
 // time windows can be merged over time, so that older time windows will have
 // larger time range. Also, compaction are executed only for adjacent SST files
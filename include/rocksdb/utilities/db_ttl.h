@@ -35,6 +35,15 @@ namespace TERARKDB_NAMESPACE {
 // read_only=true opens in the usual read-only mode. Compactions will not be
 //  triggered(neither manual nor automatic), so no expired entries removed
 //
+// use_ttl_extractor=true stores values as is, without the timestamp suffix.
+//  The ttl is kept in the table properties by a TtlExtractorFactory which
+//  DBWithTTL installs, and whole SSTs are dropped once all their entries
+//  have expired(see ttl_drop_expired_files in rocksdb/options.h). Puts and
+//  Gets then copy no values, but the ttl applies to files rather than to
+//  single entries: an entry lives as long as the newest one it shares an SST
+//  with, so this suits universal compaction with a time window(see
+//  time_window in rocksdb/universal_compaction.h)
+//
 // CONSTRAINTS:
 // Not specifying/passing or non-positive TTL behaves like TTL = infinity
 //
@@ -42,6 +51,7 @@ namespace TERARKDB_NAMESPACE {
 // Calling DB::Open directly to re-open a db created by this API will get
 //  corrupt values(timestamp suffixed) and no ttl effect will be there
 //  during the second Open, so use this API consistently to open the db
+// The same goes for use_ttl_extractor, which must not change between Opens
 // Be careful when passing ttl with a small positive value because the
 //  whole database may be deleted in a small amount of time
 
@@ -53,13 +63,13 @@ class DBWithTTL : public StackableDB {
 
   static Status Open(const Options& options, const std::string& dbname,
                      DBWithTTL** dbptr, int32_t ttl = 0,
-                     bool read_only = false);
+                     bool read_only = false, bool use_ttl_extractor = false);
 
   static Status Open(const DBOptions& db_options, const std::string& dbname,
                      const std::vector<ColumnFamilyDescriptor>& column_families,
                      std::vector<ColumnFamilyHandle*>* handles,
                      DBWithTTL** dbptr, std::vector<int32_t> ttls,
-                     bool read_only = false);
+                     bool read_only = false, bool use_ttl_extractor = false);
 
   virtual void SetTtl(int32_t ttl) = 0;
 
@@ -54,6 +54,8 @@ struct DocumentDBOptions {
   int background_threads = 4;
   uint64_t memtable_size = 128 * 1024 * 1024;    // 128 MB
   uint64_t cache_size = 1 * 1024 * 1024 * 1024;  // 1 GB
+  // CreateIndex() scans the documents in this many ranges at once
+  int index_build_threads = 4;
 };
 
 // TODO(icanadi) Add `JSONDocument* info` parameter to all calls that can be
@@ -83,7 +85,7 @@ class DocumentDB : public StackableDB {
 
   // Create a new index. It will stop all writes for the duration of the call.
   // All current documents in the DB are scanned and corresponding index entries
-  // are created
+  // are created, in SST files ingested at once
   virtual Status CreateIndex(const WriteOptions& write_options,
                              const IndexDescriptor& index) = 0;
 
@@ -14,6 +14,9 @@
 // This is useful when implementing a new Env and ensuring that the
 // semantics and behavior are correct (in that they match that of an
 // existing, stable Env, like the default POSIX one).
+//
+// AsyncMirrorEnv mirrors the writes to a secondary Env asynchronously
+// instead, to move a live DB to another Env without blocking on both.
 
 #pragma once
 
@@ -21,6 +24,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "rocksdb/env.h"
@@ -176,6 +180,67 @@ class EnvMirror : public EnvWrapper {
   }
 };
 
+struct AsyncMirrorEnvOptions {
+  enum AckMode {
+    // Everything returns once the primary did it, the secondary does it
+    // later
+    kAckPrimary,
+    // Syncs and closes of files and directories also wait for the secondary
+    // to do everything queued before them, so that the data is durable in
+    // both Envs when they return
+    kAckBoth,
+  };
+  AckMode ack_mode = kAckPrimary;
+
+  // The writes wait for the secondary once this many bytes are queued for it
+  size_t max_queued_bytes = 64 << 20;
+};
+
+class AsyncMirrorQueue;
+
+// AsyncMirrorEnv reads from the primary Env only. The changes of files and
+// directories are done in the primary, then queued to be done in the same
+// order in the secondary, on a thread of its own. The first error of the
+// secondary is returned by WaitForSecondary(), and by the syncs with
+// kAckBoth. Files opened before the Env are not mirrored, so the secondary
+// needs a copy of the primary to start with, like a checkpoint.
+class AsyncMirrorEnv : public EnvWrapper {
+ public:
+  AsyncMirrorEnv(Env* primary, Env* secondary,
+                 const AsyncMirrorEnvOptions& options =
+                     AsyncMirrorEnvOptions());
+  // Waits for the secondary to do everything queued
+  ~AsyncMirrorEnv();
+
+  Status NewWritableFile(const std::string& f, std::unique_ptr<WritableFile>* r,
+                         const EnvOptions& options) override;
+  Status ReuseWritableFile(const std::string& fname,
+                           const std::string& old_fname,
+                           std::unique_ptr<WritableFile>* r,
+                           const EnvOptions& options) override;
+  Status NewRandomRWFile(const std::string& f,
+                         std::unique_ptr<RandomRWFile>* r,
+                         const EnvOptions& options) override;
+  Status NewDirectory(const std::string& name,
+                      std::unique_ptr<Directory>* result) override;
+  Status DeleteFile(const std::string& f) override;
+  Status CreateDir(const std::string& d) override;
+  Status CreateDirIfMissing(const std::string& d) override;
+  Status DeleteDir(const std::string& d) override;
+  Status Truncate(const std::string& f, size_t size) override;
+  Status RenameFile(const std::string& s, const std::string& t) override;
+  Status LinkFile(const std::string& s, const std::string& t) override;
+
+  // Wait for the secondary to do everything queued so far, and return its
+  // first error, if any
+  Status WaitForSecondary();
+
+ private:
+  Env* secondary_;
+  AsyncMirrorEnvOptions options_;
+  std::unique_ptr<AsyncMirrorQueue> queue_;
+};
+
 }  // namespace TERARKDB_NAMESPACE
 
 #endif  // ROCKSDB_LITE
@@ -13,6 +13,8 @@ extern "C" {
 #include <lualib.h>
 }
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -25,8 +27,26 @@ extern "C" {
 #include "rocksdb/utilities/lua/rocks_lua_util.h"
 
 namespace TERARKDB_NAMESPACE {
+
+class ThreadLocalPtr;
+
 namespace lua {
 
+// An entry of FilterBatch() with use_ffi, declared to the ffi of LuaJIT as
+//   ffi.cdef[[
+//     typedef struct {
+//       const char* key; size_t key_size;
+//       const char* value; size_t value_size;
+//     } rocks_lua_entry;
+//   ]]
+// The value is null with ignore_value.
+struct RocksLuaEntry {
+  const char* key;
+  size_t key_size;
+  const char* value;
+  size_t value_size;
+};
+
 struct RocksLuaCompactionFilterOptions {
   // The lua script in string that implements all necessary CompactionFilter
   // virtual functions.  The specified lua_script must implement the following
@@ -86,6 +106,22 @@ struct RocksLuaCompactionFilterOptions {
   //     function Filter(level, key, existing_value)
   //       return false, true, "Rocks"
   //     end
+  //
+  // 2. The script may also contain a function called FilterBatch, which
+  //    filters many keys in one call, the keys of a compaction filtered ahead
+  //    with compaction_filter_threads. It takes the arrays of the keys and of
+  //    the values, and returns the array of the is_filtered flags and a table
+  //    of the new values, by the index of the changed ones:
+  //
+  //   function FilterBatch(level, keys, existing_values)
+  //     ...
+  //     return is_filtered, new_values
+  //   end
+  //
+  //   With ignore_value, FilterBatch(level, keys) returns is_filtered only.
+  //
+  // The state of the script is per thread, the filter may be shared by the
+  // compactions running at once.
 
   std::string lua_script;
 
@@ -102,6 +138,17 @@ struct RocksLuaCompactionFilterOptions {
   // A boolean flag to determine whether to ignore snapshots.
   bool ignore_snapshots = false;
 
+  // If set to true, the keys and the values are not copied to Lua strings,
+  // their memory is passed as light userdata and a size, which LuaJIT
+  // scripts read through the ffi, e.g. ffi.string(key, key_size):
+  //
+  //   function Filter(level, key, key_size, existing_value, value_size)
+  //   function FilterBatch(level, n, entries)
+  //
+  // where `entries` points to n rocks_lua_entry, see RocksLuaEntry. The
+  // memory is only valid during the call. The return values are the same.
+  bool use_ffi = false;
+
   // When specified a non-null pointer, the first "error_limit_per_filter"
   // errors of each CompactionFilter that is lua related will be included
   // in this log.
@@ -159,15 +206,16 @@ class RocksLuaCompactionFilterFactory : public CompactionFilterFactory {
 // functions.
 class RocksLuaCompactionFilter : public TERARKDB_NAMESPACE::CompactionFilter {
  public:
-  explicit RocksLuaCompactionFilter(const RocksLuaCompactionFilterOptions& opt)
-      : options_(opt),
-        lua_state_wrapper_(opt.lua_script, opt.libraries),
-        error_count_(0),
-        name_("") {}
+  explicit RocksLuaCompactionFilter(const RocksLuaCompactionFilterOptions& opt);
+
+  virtual ~RocksLuaCompactionFilter();
 
   virtual bool Filter(int level, const Slice& key, const Slice& existing_value,
                       std::string* new_value,
                       bool* value_changed) const override;
+  // Calls FilterBatch of the script if it has one, or else Filter per entry
+  virtual void FilterBatch(int level, BatchEntry* entries,
+                           size_t n) const override;
   // Not yet supported
   virtual bool FilterMergeOperand(int /*level*/, const Slice& /*key*/,
                                   const Slice& /*operand*/) const override {
@@ -175,14 +223,21 @@ class RocksLuaCompactionFilter : public TERARKDB_NAMESPACE::CompactionFilter {
   }
   virtual bool IgnoreSnapshots() const override;
   virtual const char* Name() const override;
+  // A filter with its own lua states, for compaction_filter_threads
+  virtual CompactionFilter* Clone() const override {
+    return new RocksLuaCompactionFilter(options_);
+  }
 
  protected:
   void LogLuaError(const char* format, ...) const;
+  // The state of the script for the calling thread
+  lua_State* GetLuaState() const;
 
   RocksLuaCompactionFilterOptions options_;
-  LuaStateWrapper lua_state_wrapper_;
-  mutable int error_count_;
-  mutable std::string name_;
+  // A LuaStateWrapper per thread
+  std::unique_ptr<ThreadLocalPtr> lua_states_;
+  mutable std::atomic<int> error_count_;
+  std::string name_;
 };
 
 }  // namespace lua
@@ -30,7 +30,15 @@ class MemoryUtil {
     kTableReadersTotal = 2,
     // Memory usage by Cache.
     kCacheTotal = 3,
-    kNumUsageTypes = 4
+    // Memory usage of the metadata of the files and of the FileMaps.
+    kTableMetadataTotal = 4,
+    // Memory usage of the working memory of the table builds.
+    kTableBuildersTotal = 5,
+    // Memory usage of the iterator cache arenas of the process.
+    kIteratorCachesTotal = 6,
+    // Memory usage of the key hotness samplers and Oracles.
+    kKeyHotnessTotal = 7,
+    kNumUsageTypes = 8
   };
 
   // Returns the approximate memory usage of different types in the input
@@ -42,6 +50,9 @@ class MemoryUtil {
   // only report the usage of the input "cache_set" without
   // including those Cache usage inside the input list "dbs"
   // of DBs.
+  //
+  // The table factories of the default column families and the Oracles of
+  // the Envs are counted once however many DBs share them.
   static Status GetApproximateMemoryUsageByType(
       const std::vector<DB*>& dbs,
       const std::unordered_set<const Cache*> cache_set,
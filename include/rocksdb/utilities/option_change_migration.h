@@ -15,7 +15,9 @@ namespace TERARKDB_NAMESPACE {
 // Try to migrate DB created with old_opts to be use new_opts.
 // Multiple column families is not supported.
 // It is best-effort. No guarantee to succeed.
-// A full compaction may be executed.
+// A full compaction may be executed. If new_opts.enable_lazy_compaction, the
+// files are linked into a map SST on the destination level instead, and the
+// lazy compaction reshapes them later.
 Status OptionChangeMigration(std::string dbname, const Options& old_opts,
                              const Options& new_opts);
 }  // namespace TERARKDB_NAMESPACE
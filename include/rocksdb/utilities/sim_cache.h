@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "rocksdb/cache.h"
 #include "rocksdb/env.h"
@@ -35,9 +36,23 @@ class SimCache;
 // BlockBasedTableOptions.block_size = 4096 by default but is configurable,
 // Therefore, generally the actual memory overhead of SimCache is Less than
 // sim_capacity * 2%
+//
+// If curve_sample_rate > 0, the lookups of that fraction of the keys, picked
+// by hash, are also sampled for the hit ratio curve of the LRU caches of
+// every capacity, see SimCache::GetHitRatioCurve(). A rate of 0.01 or less
+// keeps its cost to a mutex per sampled lookup and about 100 bytes per
+// sampled key, at most 1M keys.
 extern std::shared_ptr<SimCache> NewSimCache(std::shared_ptr<Cache> cache,
                                              size_t sim_capacity,
-                                             int num_shard_bits);
+                                             int num_shard_bits,
+                                             double curve_sample_rate = 0);
+
+// A point of a hit ratio curve: the estimated hit ratio of an LRU cache of
+// capacity bytes
+struct SimCacheHitRatio {
+  uint64_t capacity;
+  double hit_ratio;
+};
 
 class SimCache : public Cache {
  public:
@@ -71,6 +86,15 @@ class SimCache : public Cache {
   // String representation of the statistics of the simcache
   virtual std::string ToString() const = 0;
 
+  // The hit ratio curve of the sampled lookups since the last
+  // reset_counter(), by increasing capacity. It comes from the sampled
+  // Mattson stack distances of the lookups, so a single pass gives the hit
+  // ratio of every capacity. Empty without a curve_sample_rate or sampled
+  // lookups.
+  virtual void GetHitRatioCurve(std::vector<SimCacheHitRatio>* curve) const {
+    curve->clear();
+  }
+
   // Start storing logs of the cache activity (Add/Lookup) into
   // a file located at activity_log_file, max_logging_size option can be used to
   // stop logging to the file automatically after reaching a specific size in
@@ -203,6 +203,17 @@ class Cursor {
   void operator=(const Cursor&);
 };
 
+// SpatialElement is an element to insert with SpatialDB::BulkInsert()
+struct SpatialElement {
+  BoundingBox<double> bbox;
+  std::string blob;
+  FeatureSet feature_set;
+  SpatialElement() = default;
+  SpatialElement(const BoundingBox<double>& _bbox, const std::string& _blob,
+                 const FeatureSet& _feature_set = FeatureSet())
+      : bbox(_bbox), blob(_blob), feature_set(_feature_set) {}
+};
+
 // SpatialIndexOptions defines a spatial index that will be built on the data
 struct SpatialIndexOptions {
   // Spatial indexes are referenced by names
@@ -244,6 +255,18 @@ class SpatialDB : public StackableDB {
                         const FeatureSet& feature_set,
                         const std::vector<std::string>& spatial_indexes) = 0;
 
+  // Insert the elements into the DB, like one Insert() each, but much faster
+  // for loading many elements at once. The elements get their ids in the
+  // order of their positions in the first of spatial_indexes, so the elements
+  // close to each other are stored close to each other. The data and the
+  // spatial index entries are then written to SST files in order, and
+  // ingested, bypassing the memtables and the WAL. An element is only
+  // returned by queries once the spatial_indexes have all been ingested.
+  // REQUIRES: spatial_indexes.size() > 0
+  virtual Status BulkInsert(
+      const std::vector<SpatialElement>& elements,
+      const std::vector<std::string>& spatial_indexes) = 0;
+
   // Calling Compact() after inserting a bunch of elements should speed up
   // reading. This is especially useful if you use SpatialDBOptions::bulk_load
   // Num threads determines how many threads we'll use for compactions. Setting
@@ -251,7 +274,8 @@ class SpatialDB : public StackableDB {
   virtual Status Compact(int num_threads = 1) = 0;
 
   // Query the specified spatial_index. Query will return all elements that
-  // intersect bbox, but it may also return some extra elements.
+  // intersect bbox, but it may also return some extra elements. The tiles of
+  // bbox are scanned as the fewest ranges of consecutive quad keys.
   virtual Cursor* Query(const ReadOptions& read_options,
                         const BoundingBox<double>& bbox,
                         const std::string& spatial_index) = 0;
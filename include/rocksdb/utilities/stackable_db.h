@@ -38,6 +38,10 @@ class StackableDB : public DB {
 
   virtual Status Close() override { return db_->Close(); }
 
+  virtual Status TryCatchUpWithPrimary() override {
+    return db_->TryCatchUpWithPrimary();
+  }
+
   virtual DB* GetBaseDB() { return db_; }
 
   virtual DB* GetRootDB() override { return db_->GetRootDB(); }
@@ -370,6 +374,12 @@ class StackableDB : public DB {
     return db_->GetUpdatesSince(seq_number, iter, read_options);
   }
 
+  virtual Status NewChangeFeedIterator(
+      SequenceNumber seq_number, std::unique_ptr<ChangeFeedIterator>* iter,
+      const TransactionLogIterator::ReadOptions& read_options) override {
+    return db_->NewChangeFeedIterator(seq_number, iter, read_options);
+  }
+
   virtual Status SuggestCompactRange(ColumnFamilyHandle* column_family,
                                      const Slice* begin,
                                      const Slice* end) override {
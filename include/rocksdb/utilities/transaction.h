@@ -269,6 +269,26 @@ class Transaction {
       const ReadOptions& options, const std::vector<Slice>& keys,
       std::vector<std::string>* values) = 0;
 
+  // Lock all the keys in [start, end) of the column family with a single
+  // range lock, including the keys that don't exist yet. Meant for bulk
+  // updates: GetForUpdate()/Put() of the keys covered by a range lock of
+  // this transaction take no point lock, so iterating a range and
+  // calling GetForUpdate() on every key costs the lock manager one lock
+  // instead of one per key. The keys are still validated against the
+  // snapshot, if there is one.
+  //
+  // The range lock is held until the transaction commits or rolls back.
+  // Waits up to TransactionOptions.lock_timeout for conflicting locks.
+  //
+  // Returns Status::OK() on success, Status::TimedOut() if the range could
+  // not be locked, Status::Busy() on deadlock, and Status::NotSupported()
+  // if the transaction was not created by a TransactionDB.
+  virtual Status GetRangeLock(ColumnFamilyHandle* /*column_family*/,
+                              const Slice& /*start*/, const Slice& /*end*/,
+                              bool /*exclusive*/ = true) {
+    return Status::NotSupported("Range locks not supported");
+  }
+
   // Returns an iterator that will iterate on all keys in the default
   // column family including both keys in the DB and uncommitted keys in this
   // transaction.
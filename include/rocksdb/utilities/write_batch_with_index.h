@@ -249,6 +249,18 @@ class WriteBatchWithIndex : public WriteBatchBase {
                            ColumnFamilyHandle* column_family, const Slice& key,
                            LazyBuffer* value);
 
+  // Similar to DB::MultiGet() but will also read writes from this batch, like
+  // GetFromBatchAndDB(). The keys that this batch cannot resolve are read from
+  // the DB by a single MultiGet(), sharing one super version, instead of a
+  // Get() each.
+  //
+  // (*values) will always be resized to be the same size as (keys), and the
+  // status of every key is returned in the same order.
+  std::vector<Status> MultiGetFromBatchAndDB(
+      DB* db, const ReadOptions& read_options,
+      ColumnFamilyHandle* column_family, const std::vector<Slice>& keys,
+      std::vector<std::string>* values);
+
   // Records the state of the batch for future calls to RollbackToSavePoint().
   // May be called multiple times to set multiple save points.
   void SetSavePoint() override;
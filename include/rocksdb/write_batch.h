@@ -27,6 +27,7 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <functional>
 #include <stack>
 #include <string>
 
@@ -83,6 +84,25 @@ class WriteBatch : public WriteBatchBase {
     return Put(nullptr, key, value);
   }
 
+  // Serializes a value of `size` bytes straight into the batch. It must fill
+  // all of `dst`, a non-ok status drops the entry and is returned by Put().
+  using ValueWriter = std::function<Status(char* dst, size_t size)>;
+
+  // Variant of Put() that reserves `value_size` bytes for the value in the
+  // batch and lets `writer` serialize the value in place, saving the copy of
+  // a value built in a temporary buffer first.
+  Status Put(ColumnFamilyHandle* column_family, const Slice& key,
+             size_t value_size, const ValueWriter& writer);
+  Status Put(const Slice& key, size_t value_size, const ValueWriter& writer) {
+    return Put(nullptr, key, value_size, writer);
+  }
+
+  // Reserve room for `bytes` more bytes of entries, so that building a batch
+  // of known size does not grow the buffer repeatedly. The overhead of an
+  // entry is at most kMaxEntryOverhead bytes besides its key and value.
+  void Reserve(size_t bytes);
+  static const size_t kMaxEntryOverhead = 1 + 5 + 5 + 5;
+
   using WriteBatchBase::Delete;
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   Status Delete(ColumnFamilyHandle* column_family, const Slice& key) override;
@@ -237,6 +257,15 @@ class WriteBatch : public WriteBatchBase {
     }
     virtual void Merge(const Slice& /*key*/, const Slice& /*value*/) {}
 
+    // A put whose value was appended to a value log when it was written,
+    // `index` points to it. Only found in the WAL of a DB with
+    // DBOptions::value_log_threshold.
+    virtual Status PutValueIndexCF(uint32_t /*column_family_id*/,
+                                   const Slice& /*key*/,
+                                   const Slice& /*index*/) {
+      return Status::InvalidArgument("PutValueIndexCF not implemented");
+    }
+
     // The default implementation of LogData does nothing.
     virtual void LogData(const Slice& blob);
 
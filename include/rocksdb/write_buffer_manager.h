@@ -14,6 +14,9 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
 
 #include "rocksdb/cache.h"
 #include "rocksdb/terark_namespace.h"
@@ -30,7 +33,7 @@ class WriteBufferManager {
                               std::shared_ptr<Cache> cache = {});
   ~WriteBufferManager();
 
-  bool enabled() const { return buffer_size_ != 0; }
+  bool enabled() const { return enabled_; }
 
   bool cost_to_cache() const { return cache_rep_ != nullptr; }
 
@@ -41,16 +44,19 @@ class WriteBufferManager {
   size_t mutable_memtable_memory_usage() const {
     return memory_active_.load(std::memory_order_relaxed);
   }
-  size_t buffer_size() const { return buffer_size_; }
+  size_t buffer_size() const {
+    return buffer_size_.load(std::memory_order_relaxed);
+  }
 
   // Should only be called from write thread
   bool ShouldFlush() const {
     if (enabled()) {
-      if (mutable_memtable_memory_usage() > mutable_limit_) {
+      size_t buffer_size = buffer_size_.load(std::memory_order_relaxed);
+      if (mutable_memtable_memory_usage() > buffer_size * 7 / 8) {
         return true;
       }
-      if (memory_usage() >= buffer_size_ &&
-          mutable_memtable_memory_usage() >= buffer_size_ / 2) {
+      if (memory_usage() >= buffer_size &&
+          mutable_memtable_memory_usage() >= buffer_size / 2) {
         // If the memory exceeds the buffer size, we trigger more aggressive
         // flush. But if already more than half memory is being flushed,
         // triggering more flush may not help. We will hold it instead.
@@ -60,6 +66,42 @@ class WriteBufferManager {
     return false;
   }
 
+  // Only valid if cost_to_cache(). Let the buffer size follow the pressure on
+  // the cache between `min_buffer_size` and `max_buffer_size`: it grows while
+  // more than 1/8 of the cache is free and shrinks while less than 1/32 is.
+  // When the DBs of a process share one cache and one manager, memtables and
+  // blocks are traded against each other in a single budget.
+  void SetBufferSizeRange(size_t min_buffer_size, size_t max_buffer_size);
+
+  // Flush arbitration across the column families of all DBs sharing the
+  // manager, see WriteBufferFlushPri::kFlushArbitrated. A DB is an opaque
+  // pointer to the manager.
+  //
+  // Record the active memtable of column family `column_family_id` of `db`,
+  // `oldest_key_time` is the time in seconds its first key was written.
+  void ReportMemTable(const void* db, uint32_t column_family_id,
+                      size_t memory_usage, uint64_t oldest_key_time);
+
+  // Forget the memtables and flush requests of `db`
+  void UnregisterDB(const void* db);
+
+  // Pick the active memtable to flush among the reported ones for `db`, `now`
+  // in seconds. The score prefers large memtables, old ones and the ones
+  // written slowly: a column family filling its memtable fast flushes on its
+  // own soon enough, flushing small memtables only makes small L0 files. If
+  // the victim belongs to another DB a flush request is left for it, DBs
+  // holding a request not taken yet are passed over. Returns false if there
+  // is nothing to flush.
+  bool PickFlushVictim(const void* db, uint64_t now, const void** victim_db,
+                       uint32_t* column_family_id);
+
+  bool HasFlushRequests() const {
+    return num_flush_requests_.load(std::memory_order_relaxed) != 0;
+  }
+
+  // Take the flush request another DB left for `db`
+  bool TakeFlushRequest(const void* db, uint32_t* column_family_id);
+
   void ReserveMem(size_t mem) {
     if (cache_rep_ != nullptr) {
       ReserveMemWithCache(mem);
@@ -86,16 +128,37 @@ class WriteBufferManager {
   }
 
  private:
-  const size_t buffer_size_;
-  const size_t mutable_limit_;
+  struct MemTableStat {
+    size_t memory_usage;
+    uint64_t oldest_key_time;
+  };
+  struct DBStat {
+    std::unordered_map<uint32_t, MemTableStat> memtables;
+    bool flush_requested = false;
+    uint32_t requested_column_family_id = 0;
+  };
+
+  const bool enabled_;
+  std::atomic<size_t> buffer_size_;
   std::atomic<size_t> memory_used_;
   // Memory that hasn't been scheduled to free.
   std::atomic<size_t> memory_active_;
+  // The range SetBufferSizeRange() set, 0 if the buffer size is fixed.
+  // Guarded by the mutex of CacheRep
+  size_t min_buffer_size_;
+  size_t max_buffer_size_;
+
+  std::mutex arbitration_mutex_;
+  std::unordered_map<const void*, DBStat> db_stats_;
+  std::atomic<size_t> num_flush_requests_;
+
   struct CacheRep;
   std::unique_ptr<CacheRep> cache_rep_;
 
   void ReserveMemWithCache(size_t mem);
   void FreeMemWithCache(size_t mem);
+  // REQUIRES: the mutex of CacheRep held
+  void AdjustBufferSizeToCache();
 
   // No copying allowed
   WriteBufferManager(const WriteBufferManager&) = delete;
@@ -0,0 +1,69 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// A snapshot of one zone as seen by the zone GC picker. Byte counts come
+// straight from the ZenFS zone stats, `age_micros` and `hotness` are derived
+// by the picker from the history of previous GC rounds.
+struct ZoneVictimCandidate {
+  uint64_t zone_id = 0;
+  uint64_t start = 0;
+  uint64_t max_capacity = 0;
+  // Bytes still writable in this zone, a zone is sealed when this is zero
+  uint64_t free_bytes = 0;
+  // Live bytes that have to be copied out before the zone can be reset
+  uint64_t valid_bytes = 0;
+  // Garbage bytes released by resetting the zone
+  uint64_t reclaim_bytes = 0;
+  // Time elapsed since the zone was first observed sealed
+  uint64_t age_micros = 0;
+  // Fraction of the zone capacity invalidated per minute, averaged over the
+  // recent GC rounds. Hot zones clean themselves, so copying them early
+  // mostly wastes migration bandwidth.
+  double hotness = 0;
+
+  double GarbageRate() const {
+    return max_capacity == 0 ? 0 : double(reclaim_bytes) / max_capacity;
+  }
+  double ValidRate() const {
+    return max_capacity == 0 ? 0 : double(valid_bytes) / max_capacity;
+  }
+};
+
+// ZoneVictimPolicy ranks sealed zones for zone GC. The picker migrates the
+// zones with the highest score first, a negative score excludes the zone
+// from the current round.
+//
+// Implementations must be thread safe, Score() is called from the
+// background GC thread without any lock held.
+class ZoneVictimPolicy {
+ public:
+  virtual ~ZoneVictimPolicy() = default;
+
+  virtual const char* Name() const = 0;
+
+  virtual double Score(const ZoneVictimCandidate& zone) const = 0;
+};
+
+// Rank zones only by their garbage ratio. This is the legacy behavior.
+extern std::shared_ptr<ZoneVictimPolicy> NewGreedyZoneVictimPolicy();
+
+// Rank zones by the LFS-style cost-benefit ratio
+//     reclaim * age / (zone_size + valid)
+// divided by (1 + hotness_weight * hotness), so that cold zones full of
+// garbage are picked first and zones still being invalidated are left alone.
+extern std::shared_ptr<ZoneVictimPolicy> NewCostBenefitZoneVictimPolicy(
+    double hotness_weight = 1.0);
+
+}  // namespace TERARKDB_NAMESPACE
@@ -9,6 +9,7 @@
 #include <jni.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "include/org_rocksdb_RocksIterator.h"
 #include "rocksdb/iterator.h"
@@ -184,3 +185,46 @@ jbyteArray Java_org_rocksdb_RocksIterator_value0(JNIEnv* env, jobject /*jobj*/,
       const_cast<jbyte*>(reinterpret_cast<const jbyte*>(value_slice.data())));
   return jkeyValue;
 }
+
+/*
+ * Class:     org_rocksdb_RocksIterator
+ * Method:    nextBatch0
+ * Signature: (JLjava/nio/ByteBuffer;II)J
+ */
+jlong Java_org_rocksdb_RocksIterator_nextBatch0(JNIEnv* env, jobject /*jobj*/,
+                                                jlong handle, jobject jbuf,
+                                                jint jbuf_off, jint jbuf_len) {
+  auto* it = reinterpret_cast<TERARKDB_NAMESPACE::Iterator*>(handle);
+  char* buf = TERARKDB_NAMESPACE::JniUtil::getDirectBufferRange(
+      env, jbuf, jbuf_off, jbuf_len);
+  if (buf == nullptr) {
+    // exception thrown: IllegalArgumentException
+    return 0;
+  }
+
+  // Lengths are big-endian, the default byte order of java.nio.ByteBuffer
+  auto put_len = [](char* dst, size_t len) {
+    dst[0] = static_cast<char>(len >> 24);
+    dst[1] = static_cast<char>(len >> 16);
+    dst[2] = static_cast<char>(len >> 8);
+    dst[3] = static_cast<char>(len);
+  };
+  const size_t capacity = static_cast<size_t>(jbuf_len);
+  size_t used = 0;
+  uint32_t count = 0;
+  for (; it->Valid(); it->Next(), count++) {
+    TERARKDB_NAMESPACE::Slice key = it->key();
+    TERARKDB_NAMESPACE::Slice value = it->value();
+    const size_t entry_len = 8 + key.size() + value.size();
+    if (entry_len > capacity - used) {
+      break;
+    }
+    char* dst = buf + used;
+    put_len(dst, key.size());
+    memcpy(dst + 4, key.data(), key.size());
+    put_len(dst + 4 + key.size(), value.size());
+    memcpy(dst + 8 + key.size(), value.data(), value.size());
+    used += entry_len;
+  }
+  return static_cast<jlong>((static_cast<uint64_t>(count) << 32) | used);
+}
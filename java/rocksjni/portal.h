@@ -3480,8 +3480,38 @@ class TickerTypeJni {
         return 0x65;
       case TERARKDB_NAMESPACE::Tickers::READ_BLOB_INVALID:
         return 0x66;
-      case TERARKDB_NAMESPACE::Tickers::TICKER_ENUM_MAX:
+      case TERARKDB_NAMESPACE::Tickers::BLOCK_CACHE_SECONDARY_HIT:
         return 0x67;
+      case TERARKDB_NAMESPACE::Tickers::BLOCK_CACHE_SECONDARY_MISS:
+        return 0x68;
+      case TERARKDB_NAMESPACE::Tickers::ITER_SEPARATED_VALUE_NOT_FETCHED:
+        return 0x69;
+      case TERARKDB_NAMESPACE::Tickers::BLOB_CACHE_HIT:
+        return 0x6A;
+      case TERARKDB_NAMESPACE::Tickers::BLOB_CACHE_MISS:
+        return 0x6B;
+      case TERARKDB_NAMESPACE::Tickers::TABLE_MMAP_RESIDENT_BYTES_AT_OPEN:
+        return 0x6C;
+      case TERARKDB_NAMESPACE::Tickers::TABLE_MMAP_PRETOUCH_BYTES:
+        return 0x6D;
+      case TERARKDB_NAMESPACE::Tickers::TABLE_MMAP_HUGE_PAGE_BYTES:
+        return 0x6E;
+      case TERARKDB_NAMESPACE::Tickers::ASYNC_LISTENER_EVENTS_DROPPED:
+        return 0x6F;
+      case TERARKDB_NAMESPACE::Tickers::ASYNC_LISTENER_EVENTS_BLOCKED:
+        return 0x70;
+      case TERARKDB_NAMESPACE::Tickers::VALUE_LOG_BYTES_WRITTEN:
+        return 0x71;
+      case TERARKDB_NAMESPACE::Tickers::GC_PROBE_BY_ITERATOR:
+        return 0x72;
+      case TERARKDB_NAMESPACE::Tickers::RESOURCE_GROUP_READ_WAIT_MICROS:
+        return 0x73;
+      case TERARKDB_NAMESPACE::Tickers::RESOURCE_GROUP_WRITE_WAIT_MICROS:
+        return 0x74;
+      case TERARKDB_NAMESPACE::Tickers::RESOURCE_GROUP_BACKGROUND_WAIT_MICROS:
+        return 0x75;
+      case TERARKDB_NAMESPACE::Tickers::TICKER_ENUM_MAX:
+        return 0x76;
       default:
         // undefined/default
         return 0x0;
@@ -3699,6 +3729,37 @@ class TickerTypeJni {
       case 0x66:
         return TERARKDB_NAMESPACE::Tickers::READ_BLOB_INVALID;
       case 0x67:
+        return TERARKDB_NAMESPACE::Tickers::BLOCK_CACHE_SECONDARY_HIT;
+      case 0x68:
+        return TERARKDB_NAMESPACE::Tickers::BLOCK_CACHE_SECONDARY_MISS;
+      case 0x69:
+        return TERARKDB_NAMESPACE::Tickers::ITER_SEPARATED_VALUE_NOT_FETCHED;
+      case 0x6A:
+        return TERARKDB_NAMESPACE::Tickers::BLOB_CACHE_HIT;
+      case 0x6B:
+        return TERARKDB_NAMESPACE::Tickers::BLOB_CACHE_MISS;
+      case 0x6C:
+        return TERARKDB_NAMESPACE::Tickers::TABLE_MMAP_RESIDENT_BYTES_AT_OPEN;
+      case 0x6D:
+        return TERARKDB_NAMESPACE::Tickers::TABLE_MMAP_PRETOUCH_BYTES;
+      case 0x6E:
+        return TERARKDB_NAMESPACE::Tickers::TABLE_MMAP_HUGE_PAGE_BYTES;
+      case 0x6F:
+        return TERARKDB_NAMESPACE::Tickers::ASYNC_LISTENER_EVENTS_DROPPED;
+      case 0x70:
+        return TERARKDB_NAMESPACE::Tickers::ASYNC_LISTENER_EVENTS_BLOCKED;
+      case 0x71:
+        return TERARKDB_NAMESPACE::Tickers::VALUE_LOG_BYTES_WRITTEN;
+      case 0x72:
+        return TERARKDB_NAMESPACE::Tickers::GC_PROBE_BY_ITERATOR;
+      case 0x73:
+        return TERARKDB_NAMESPACE::Tickers::RESOURCE_GROUP_READ_WAIT_MICROS;
+      case 0x74:
+        return TERARKDB_NAMESPACE::Tickers::RESOURCE_GROUP_WRITE_WAIT_MICROS;
+      case 0x75:
+        return TERARKDB_NAMESPACE::Tickers::
+            RESOURCE_GROUP_BACKGROUND_WAIT_MICROS;
+      case 0x76:
         return TERARKDB_NAMESPACE::Tickers::TICKER_ENUM_MAX;
 
       default:
@@ -4869,6 +4930,92 @@ class JniUtil {
         new TERARKDB_NAMESPACE::Status(status));
   }
 
+  /**
+   * Get the memory of a direct java.nio.ByteBuffer in the range
+   * [offset, offset + len), without copying it
+   *
+   * @param env A pointer to the java environment
+   * @param jbuf The direct java.nio.ByteBuffer
+   * @param offset The start of the range
+   * @param len The length of the range
+   *
+   * @return the address of the range, or nullptr if the buffer is not direct
+   *     or the range is out of it, an IllegalArgumentException is thrown then
+   */
+  static char* getDirectBufferRange(JNIEnv* env, jobject jbuf, jint offset,
+                                    jint len) {
+    char* addr = nullptr;
+    if (jbuf != nullptr) {
+      addr = reinterpret_cast<char*>(env->GetDirectBufferAddress(jbuf));
+    }
+    if (addr == nullptr) {
+      // error: memory region is undefined, given object is not a direct
+      // java.nio.Buffer, or JNI access to direct buffers is not supported by
+      // JVM
+      IllegalArgumentExceptionJni::ThrowNew(
+          env, Status::InvalidArgument("Could not access DirectBuffer"));
+      return nullptr;
+    }
+    const jlong capacity = env->GetDirectBufferCapacity(jbuf);
+    if (offset < 0 || len < 0 ||
+        static_cast<jlong>(offset) + static_cast<jlong>(len) > capacity) {
+      IllegalArgumentExceptionJni::ThrowNew(
+          env, Status::InvalidArgument("Range out of DirectBuffer"));
+      return nullptr;
+    }
+    return addr + offset;
+  }
+
+  /*
+   * Helper for operations on a key and value held in direct
+   * java.nio.ByteBuffers, the slices point into the buffers
+   * for example RocksDB->putDirect
+   *
+   * @return nullptr if a Java exception was thrown
+   */
+  static std::unique_ptr<TERARKDB_NAMESPACE::Status> kv_op_direct(
+      std::function<TERARKDB_NAMESPACE::Status(TERARKDB_NAMESPACE::Slice,
+                                               TERARKDB_NAMESPACE::Slice)>
+          op,
+      JNIEnv* env, jobject jkey, jint jkey_off, jint jkey_len, jobject jvalue,
+      jint jvalue_off, jint jvalue_len) {
+    char* key = getDirectBufferRange(env, jkey, jkey_off, jkey_len);
+    if (key == nullptr) {
+      // exception thrown: IllegalArgumentException
+      return nullptr;
+    }
+    char* value = getDirectBufferRange(env, jvalue, jvalue_off, jvalue_len);
+    if (value == nullptr) {
+      // exception thrown: IllegalArgumentException
+      return nullptr;
+    }
+
+    auto status = op(TERARKDB_NAMESPACE::Slice(key, jkey_len),
+                     TERARKDB_NAMESPACE::Slice(value, jvalue_len));
+    return std::unique_ptr<TERARKDB_NAMESPACE::Status>(
+        new TERARKDB_NAMESPACE::Status(status));
+  }
+
+  /*
+   * Helper for operations on a key held in a direct java.nio.ByteBuffer
+   * for example WriteBatch->deleteDirect
+   *
+   * @return nullptr if a Java exception was thrown
+   */
+  static std::unique_ptr<TERARKDB_NAMESPACE::Status> k_op_direct(
+      std::function<TERARKDB_NAMESPACE::Status(TERARKDB_NAMESPACE::Slice)> op,
+      JNIEnv* env, jobject jkey, jint jkey_off, jint jkey_len) {
+    char* key = getDirectBufferRange(env, jkey, jkey_off, jkey_len);
+    if (key == nullptr) {
+      // exception thrown: IllegalArgumentException
+      return nullptr;
+    }
+
+    auto status = op(TERARKDB_NAMESPACE::Slice(key, jkey_len));
+    return std::unique_ptr<TERARKDB_NAMESPACE::Status>(
+        new TERARKDB_NAMESPACE::Status(status));
+  }
+
   /*
    * Helper for operations on a value
    * for example WriteBatchWithIndex->GetFromBatch
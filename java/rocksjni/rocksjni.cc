@@ -9,6 +9,7 @@
 #include <jni.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 #include <functional>
 #include <memory>
@@ -1017,6 +1018,214 @@ jint Java_org_rocksdb_RocksDB_get__JJ_3BII_3BIIJ(
   }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// TERARKDB_NAMESPACE::DB::Put/Get/MultiGet on direct ByteBuffers
+
+/*
+ * Class:     org_rocksdb_RocksDB
+ * Method:    putDirect
+ * Signature: (JJLjava/nio/ByteBuffer;IILjava/nio/ByteBuffer;IIJ)V
+ */
+void Java_org_rocksdb_RocksDB_putDirect(
+    JNIEnv* env, jobject /*jdb*/, jlong jdb_handle, jlong jwrite_options_handle,
+    jobject jkey, jint jkey_off, jint jkey_len, jobject jval, jint jval_off,
+    jint jval_len, jlong jcf_handle) {
+  auto* db = reinterpret_cast<TERARKDB_NAMESPACE::DB*>(jdb_handle);
+  auto* write_options =
+      reinterpret_cast<TERARKDB_NAMESPACE::WriteOptions*>(jwrite_options_handle);
+  auto* cf_handle =
+      reinterpret_cast<TERARKDB_NAMESPACE::ColumnFamilyHandle*>(jcf_handle);
+  if (cf_handle == nullptr) {
+    cf_handle = db->DefaultColumnFamily();
+  }
+  auto put = [&](TERARKDB_NAMESPACE::Slice key,
+                 TERARKDB_NAMESPACE::Slice value) {
+    return db->Put(*write_options, cf_handle, key, value);
+  };
+  std::unique_ptr<TERARKDB_NAMESPACE::Status> status =
+      TERARKDB_NAMESPACE::JniUtil::kv_op_direct(put, env, jkey, jkey_off,
+                                                jkey_len, jval, jval_off,
+                                                jval_len);
+  if (status != nullptr && !status->ok()) {
+    TERARKDB_NAMESPACE::RocksDBExceptionJni::ThrowNew(env, status);
+  }
+}
+
+/*
+ * Class:     org_rocksdb_RocksDB
+ * Method:    getDirect
+ * Signature: (JJLjava/nio/ByteBuffer;IILjava/nio/ByteBuffer;IIJ)I
+ */
+jint Java_org_rocksdb_RocksDB_getDirect(
+    JNIEnv* env, jobject /*jdb*/, jlong jdb_handle, jlong jropt_handle,
+    jobject jkey, jint jkey_off, jint jkey_len, jobject jval, jint jval_off,
+    jint jval_len, jlong jcf_handle) {
+  static const int kNotFound = -1;
+  static const int kStatusError = -2;
+
+  auto* db = reinterpret_cast<TERARKDB_NAMESPACE::DB*>(jdb_handle);
+  auto& read_options =
+      *reinterpret_cast<TERARKDB_NAMESPACE::ReadOptions*>(jropt_handle);
+  auto* cf_handle =
+      reinterpret_cast<TERARKDB_NAMESPACE::ColumnFamilyHandle*>(jcf_handle);
+  if (cf_handle == nullptr) {
+    cf_handle = db->DefaultColumnFamily();
+  }
+
+  char* key = TERARKDB_NAMESPACE::JniUtil::getDirectBufferRange(
+      env, jkey, jkey_off, jkey_len);
+  if (key == nullptr) {
+    // exception thrown: IllegalArgumentException
+    return kStatusError;
+  }
+  char* value = TERARKDB_NAMESPACE::JniUtil::getDirectBufferRange(
+      env, jval, jval_off, jval_len);
+  if (value == nullptr) {
+    // exception thrown: IllegalArgumentException
+    return kStatusError;
+  }
+
+  // The value is copied once, from where the LazyBuffer references it
+  // straight into the buffer
+  TERARKDB_NAMESPACE::LazyBuffer lazy_value;
+  TERARKDB_NAMESPACE::Status s =
+      db->Get(read_options, cf_handle, TERARKDB_NAMESPACE::Slice(key, jkey_len),
+              &lazy_value);
+  if (s.ok()) {
+    s = lazy_value.fetch();
+  }
+  if (s.IsNotFound()) {
+    return kNotFound;
+  } else if (!s.ok()) {
+    TERARKDB_NAMESPACE::RocksDBExceptionJni::ThrowNew(env, s);
+    return kStatusError;
+  }
+
+  const TERARKDB_NAMESPACE::Slice& value_slice = lazy_value.slice();
+  const jint value_len = static_cast<jint>(value_slice.size());
+  memcpy(value, value_slice.data(), std::min(jval_len, value_len));
+  return value_len;
+}
+
+/**
+ * Read the direct buffers of `jbufs` into `addrs`
+ *
+ * @return false if a Java exception was thrown
+ */
+bool multi_get_direct_helper_buffers(JNIEnv* env, jobjectArray jbufs,
+                                     const std::vector<jint>& offs,
+                                     const std::vector<jint>& lens,
+                                     std::vector<char*>* addrs) {
+  for (size_t i = 0; i < offs.size(); i++) {
+    jobject jbuf = env->GetObjectArrayElement(jbufs, static_cast<jsize>(i));
+    if (env->ExceptionCheck()) {
+      // exception thrown: ArrayIndexOutOfBoundsException
+      return false;
+    }
+    // The buffer stays reachable from jbufs, so does its memory
+    char* addr = TERARKDB_NAMESPACE::JniUtil::getDirectBufferRange(
+        env, jbuf, offs[i], lens[i]);
+    env->DeleteLocalRef(jbuf);
+    if (addr == nullptr) {
+      // exception thrown: IllegalArgumentException
+      return false;
+    }
+    addrs->push_back(addr);
+  }
+  return true;
+}
+
+/*
+ * Class:     org_rocksdb_RocksDB
+ * Method:    multiGetDirect
+ * Signature: (JJ[Ljava/nio/ByteBuffer;[I[I[Ljava/nio/ByteBuffer;[I[I[J)[I
+ */
+jintArray Java_org_rocksdb_RocksDB_multiGetDirect(
+    JNIEnv* env, jobject /*jdb*/, jlong jdb_handle, jlong jropt_handle,
+    jobjectArray jkeys, jintArray jkey_offs, jintArray jkey_lens,
+    jobjectArray jvals, jintArray jval_offs, jintArray jval_lens,
+    jlongArray jcolumn_family_handles) {
+  static const int kNotFound = -1;
+
+  auto* db = reinterpret_cast<TERARKDB_NAMESPACE::DB*>(jdb_handle);
+  auto& read_options =
+      *reinterpret_cast<TERARKDB_NAMESPACE::ReadOptions*>(jropt_handle);
+
+  const jsize len_keys = env->GetArrayLength(jkeys);
+  auto get_ints = [&](jintArray jarr, std::vector<jint>* ints) {
+    ints->resize(len_keys);
+    env->GetIntArrayRegion(jarr, 0, len_keys, ints->data());
+    // exception thrown: ArrayIndexOutOfBoundsException
+    return !env->ExceptionCheck();
+  };
+  std::vector<jint> key_offs, key_lens, val_offs, val_lens;
+  if (!get_ints(jkey_offs, &key_offs) || !get_ints(jkey_lens, &key_lens) ||
+      !get_ints(jval_offs, &val_offs) || !get_ints(jval_lens, &val_lens)) {
+    return nullptr;
+  }
+
+  std::vector<TERARKDB_NAMESPACE::ColumnFamilyHandle*> cf_handles(
+      len_keys, db->DefaultColumnFamily());
+  if (jcolumn_family_handles != nullptr) {
+    std::vector<jlong> jcfh(len_keys);
+    env->GetLongArrayRegion(jcolumn_family_handles, 0, len_keys, jcfh.data());
+    if (env->ExceptionCheck()) {
+      // exception thrown: ArrayIndexOutOfBoundsException
+      return nullptr;
+    }
+    for (jsize i = 0; i < len_keys; i++) {
+      cf_handles[i] =
+          reinterpret_cast<TERARKDB_NAMESPACE::ColumnFamilyHandle*>(jcfh[i]);
+    }
+  }
+
+  std::vector<char*> key_addrs, val_addrs;
+  key_addrs.reserve(len_keys);
+  val_addrs.reserve(len_keys);
+  if (!multi_get_direct_helper_buffers(env, jkeys, key_offs, key_lens,
+                                       &key_addrs) ||
+      !multi_get_direct_helper_buffers(env, jvals, val_offs, val_lens,
+                                       &val_addrs)) {
+    return nullptr;
+  }
+  std::vector<TERARKDB_NAMESPACE::Slice> keys;
+  keys.reserve(len_keys);
+  for (jsize i = 0; i < len_keys; i++) {
+    keys.emplace_back(key_addrs[i], key_lens[i]);
+  }
+
+  std::vector<std::string> values;
+  std::vector<TERARKDB_NAMESPACE::Status> s =
+      db->MultiGet(read_options, cf_handles, keys, &values);
+
+  std::vector<jint> results(len_keys);
+  for (jsize i = 0; i < len_keys; i++) {
+    if (s[i].IsNotFound()) {
+      results[i] = kNotFound;
+    } else if (!s[i].ok()) {
+      TERARKDB_NAMESPACE::RocksDBExceptionJni::ThrowNew(env, s[i]);
+      return nullptr;
+    } else {
+      results[i] = static_cast<jint>(values[i].size());
+      memcpy(val_addrs[i], values[i].data(),
+             std::min(val_lens[i], results[i]));
+    }
+  }
+
+  jintArray jresults = env->NewIntArray(len_keys);
+  if (jresults == nullptr) {
+    // exception thrown: OutOfMemoryError
+    return nullptr;
+  }
+  env->SetIntArrayRegion(jresults, 0, len_keys, results.data());
+  if (env->ExceptionCheck()) {
+    // exception thrown: ArrayIndexOutOfBoundsException
+    env->DeleteLocalRef(jresults);
+    return nullptr;
+  }
+  return jresults;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // TERARKDB_NAMESPACE::DB::Delete()
 
@@ -275,6 +275,58 @@ void Java_org_rocksdb_WriteBatch_delete__J_3BIJ(JNIEnv* env, jobject jobj,
   }
 }
 
+/*
+ * Class:     org_rocksdb_WriteBatch
+ * Method:    putDirect
+ * Signature: (JLjava/nio/ByteBuffer;IILjava/nio/ByteBuffer;IIJ)V
+ */
+void Java_org_rocksdb_WriteBatch_putDirect(JNIEnv* env, jobject /*jobj*/,
+                                           jlong jwb_handle, jobject jkey,
+                                           jint jkey_off, jint jkey_len,
+                                           jobject jval, jint jval_off,
+                                           jint jval_len, jlong jcf_handle) {
+  auto* wb = reinterpret_cast<TERARKDB_NAMESPACE::WriteBatch*>(jwb_handle);
+  assert(wb != nullptr);
+  auto* cf_handle =
+      reinterpret_cast<TERARKDB_NAMESPACE::ColumnFamilyHandle*>(jcf_handle);
+  auto put = [&wb, &cf_handle](TERARKDB_NAMESPACE::Slice key,
+                               TERARKDB_NAMESPACE::Slice value) {
+    return cf_handle == nullptr ? wb->Put(key, value)
+                                : wb->Put(cf_handle, key, value);
+  };
+  std::unique_ptr<TERARKDB_NAMESPACE::Status> status =
+      TERARKDB_NAMESPACE::JniUtil::kv_op_direct(put, env, jkey, jkey_off,
+                                                jkey_len, jval, jval_off,
+                                                jval_len);
+  if (status != nullptr && !status->ok()) {
+    TERARKDB_NAMESPACE::RocksDBExceptionJni::ThrowNew(env, status);
+  }
+}
+
+/*
+ * Class:     org_rocksdb_WriteBatch
+ * Method:    deleteDirect
+ * Signature: (JLjava/nio/ByteBuffer;IIJ)V
+ */
+void Java_org_rocksdb_WriteBatch_deleteDirect(JNIEnv* env, jobject /*jobj*/,
+                                              jlong jwb_handle, jobject jkey,
+                                              jint jkey_off, jint jkey_len,
+                                              jlong jcf_handle) {
+  auto* wb = reinterpret_cast<TERARKDB_NAMESPACE::WriteBatch*>(jwb_handle);
+  assert(wb != nullptr);
+  auto* cf_handle =
+      reinterpret_cast<TERARKDB_NAMESPACE::ColumnFamilyHandle*>(jcf_handle);
+  auto remove = [&wb, &cf_handle](TERARKDB_NAMESPACE::Slice key) {
+    return cf_handle == nullptr ? wb->Delete(key) : wb->Delete(cf_handle, key);
+  };
+  std::unique_ptr<TERARKDB_NAMESPACE::Status> status =
+      TERARKDB_NAMESPACE::JniUtil::k_op_direct(remove, env, jkey, jkey_off,
+                                               jkey_len);
+  if (status != nullptr && !status->ok()) {
+    TERARKDB_NAMESPACE::RocksDBExceptionJni::ThrowNew(env, status);
+  }
+}
+
 /*
  * Class:     org_rocksdb_WriteBatch
  * Method:    singleDelete
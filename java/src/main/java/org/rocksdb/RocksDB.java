@@ -7,6 +7,7 @@ package org.rocksdb;
 
 import java.util.*;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.concurrent.atomic.AtomicInteger;
 import java.util.concurrent.atomic.AtomicReference;
 
@@ -630,6 +631,55 @@ public class RocksDB extends RocksObject {
         vOffset, vLen, columnFamilyHandle.nativeHandle_);
   }
 
+  /**
+   * Set the database entry for "key" to "value", reading both from direct
+   * buffers without copying them into Java arrays.
+   *
+   * @param writeOpts {@link org.rocksdb.WriteOptions} instance.
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   * @param value the remaining bytes of the direct buffer are the value, the
+   *     position of the buffer is moved to its limit.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public void put(final WriteOptions writeOpts, final ByteBuffer key,
+      final ByteBuffer value) throws RocksDBException {
+    putDirect(writeOpts, key, value, 0);
+  }
+
+  /**
+   * Set the database entry for "key" to "value" in the specified column
+   * family, reading both from direct buffers without copying them into Java
+   * arrays.
+   *
+   * @param columnFamilyHandle {@link org.rocksdb.ColumnFamilyHandle}
+   *     instance
+   * @param writeOpts {@link org.rocksdb.WriteOptions} instance.
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   * @param value the remaining bytes of the direct buffer are the value, the
+   *     position of the buffer is moved to its limit.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public void put(final ColumnFamilyHandle columnFamilyHandle,
+      final WriteOptions writeOpts, final ByteBuffer key,
+      final ByteBuffer value) throws RocksDBException {
+    putDirect(writeOpts, key, value, columnFamilyHandle.nativeHandle_);
+  }
+
+  private void putDirect(final WriteOptions writeOpts, final ByteBuffer key,
+      final ByteBuffer value, final long cfHandle) throws RocksDBException {
+    assert(key.isDirect() && value.isDirect());
+    putDirect(nativeHandle_, writeOpts.nativeHandle_, key, key.position(),
+        key.remaining(), value, value.position(), value.remaining(), cfHandle);
+    key.position(key.limit());
+    value.position(value.limit());
+  }
+
   /**
    * If the key definitely does not exist in the database, then this method
    * returns false, else true.
@@ -1222,6 +1272,71 @@ public class RocksDB extends RocksObject {
         vOffset, vLen, columnFamilyHandle.nativeHandle_);
   }
 
+  /**
+   * Get the value associated with the specified key, the key is read from
+   * and the value written into direct buffers, no Java array is allocated.
+   *
+   * @param opt {@link org.rocksdb.ReadOptions} instance.
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   * @param value the direct buffer receiving the value from its position,
+   *     its limit is set to the end of the value, or left as is if the
+   *     value is partially written.
+   * @return The size of the actual value that matches the specified
+   *     {@code key} in byte.  If the return value is greater than the
+   *     remaining bytes of {@code value}, then it indicates that the buffer
+   *     is insufficient and partial result will be returned.
+   *     RocksDB.NOT_FOUND will be returned if the value not found.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public int get(final ReadOptions opt, final ByteBuffer key,
+      final ByteBuffer value) throws RocksDBException {
+    return getDirect(opt, key, value, 0);
+  }
+
+  /**
+   * Get the value associated with the specified key within column family,
+   * the key is read from and the value written into direct buffers, no Java
+   * array is allocated.
+   *
+   * @param columnFamilyHandle {@link org.rocksdb.ColumnFamilyHandle}
+   *     instance
+   * @param opt {@link org.rocksdb.ReadOptions} instance.
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   * @param value the direct buffer receiving the value from its position,
+   *     its limit is set to the end of the value, or left as is if the
+   *     value is partially written.
+   * @return The size of the actual value that matches the specified
+   *     {@code key} in byte.  If the return value is greater than the
+   *     remaining bytes of {@code value}, then it indicates that the buffer
+   *     is insufficient and partial result will be returned.
+   *     RocksDB.NOT_FOUND will be returned if the value not found.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public int get(final ColumnFamilyHandle columnFamilyHandle,
+      final ReadOptions opt, final ByteBuffer key, final ByteBuffer value)
+      throws RocksDBException {
+    return getDirect(opt, key, value, columnFamilyHandle.nativeHandle_);
+  }
+
+  private int getDirect(final ReadOptions opt, final ByteBuffer key,
+      final ByteBuffer value, final long cfHandle) throws RocksDBException {
+    assert(key.isDirect() && value.isDirect());
+    final int result = getDirect(nativeHandle_, opt.nativeHandle_, key,
+        key.position(), key.remaining(), value, value.position(),
+        value.remaining(), cfHandle);
+    if (result != NOT_FOUND) {
+      value.limit(Math.min(value.limit(), value.position() + result));
+    }
+    key.position(key.limit());
+    return result;
+  }
+
   /**
    * The simplified version of get which returns a new byte array storing
    * the value associated with the specified input key if any.  null will be
@@ -1580,6 +1695,99 @@ public class RocksDB extends RocksObject {
     return keyValueMap;
   }
 
+  /**
+   * Returns the values of a list of keys in a single JNI call, the keys are
+   * read from and the values written into direct buffers, no Java array is
+   * allocated for them.
+   *
+   * @param opt Read options.
+   * @param keys direct buffers, the remaining bytes of each are a key, their
+   *     positions are moved to their limits.
+   * @param values direct buffers receiving the value of the key at the same
+   *     index, from their positions. Their limits are set to the ends of the
+   *     values, or left as is for the partially written values.
+   * @return the sizes of the values, as returned by
+   *     {@link #get(ReadOptions, ByteBuffer, ByteBuffer)}.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   * @throws IllegalArgumentException thrown if the number of values is not
+   *    equal to the number of keys.
+   */
+  public int[] multiGet(final ReadOptions opt, final ByteBuffer[] keys,
+      final ByteBuffer[] values) throws RocksDBException {
+    return multiGetDirect(opt, null, keys, values);
+  }
+
+  /**
+   * Returns the values of a list of keys in a single JNI call, the keys are
+   * read from and the values written into direct buffers, no Java array is
+   * allocated for them.
+   *
+   * @param opt Read options.
+   * @param columnFamilyHandleList {@link java.util.List} containing
+   *     {@link org.rocksdb.ColumnFamilyHandle} instances, one per key.
+   * @param keys direct buffers, the remaining bytes of each are a key, their
+   *     positions are moved to their limits.
+   * @param values direct buffers receiving the value of the key at the same
+   *     index, from their positions. Their limits are set to the ends of the
+   *     values, or left as is for the partially written values.
+   * @return the sizes of the values, as returned by
+   *     {@link #get(ColumnFamilyHandle, ReadOptions, ByteBuffer, ByteBuffer)}.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   * @throws IllegalArgumentException thrown if the number of values or of
+   *    column family handles is not equal to the number of keys.
+   */
+  public int[] multiGet(final ReadOptions opt,
+      final List<ColumnFamilyHandle> columnFamilyHandleList,
+      final ByteBuffer[] keys, final ByteBuffer[] values)
+      throws RocksDBException {
+    if (keys.length != columnFamilyHandleList.size()) {
+      throw new IllegalArgumentException(
+          "For each key there must be a ColumnFamilyHandle.");
+    }
+    final long[] cfHandles = new long[columnFamilyHandleList.size()];
+    for (int i = 0; i < columnFamilyHandleList.size(); i++) {
+      cfHandles[i] = columnFamilyHandleList.get(i).nativeHandle_;
+    }
+    return multiGetDirect(opt, cfHandles, keys, values);
+  }
+
+  private int[] multiGetDirect(final ReadOptions opt, final long[] cfHandles,
+      final ByteBuffer[] keys, final ByteBuffer[] values)
+      throws RocksDBException {
+    if (keys.length != values.length) {
+      throw new IllegalArgumentException(
+          "For each key there must be a value buffer.");
+    }
+    final int[] keyOffsets = new int[keys.length];
+    final int[] keyLengths = new int[keys.length];
+    final int[] valueOffsets = new int[values.length];
+    final int[] valueLengths = new int[values.length];
+    for (int i = 0; i < keys.length; i++) {
+      assert(keys[i].isDirect() && values[i].isDirect());
+      keyOffsets[i] = keys[i].position();
+      keyLengths[i] = keys[i].remaining();
+      valueOffsets[i] = values[i].position();
+      valueLengths[i] = values[i].remaining();
+    }
+
+    final int[] results = multiGetDirect(nativeHandle_, opt.nativeHandle_,
+        keys, keyOffsets, keyLengths, values, valueOffsets, valueLengths,
+        cfHandles);
+
+    for (int i = 0; i < keys.length; i++) {
+      keys[i].position(keys[i].limit());
+      if (results[i] != NOT_FOUND) {
+        values[i].limit(
+            Math.min(values[i].limit(), values[i].position() + results[i]));
+      }
+    }
+    return results;
+  }
+
   /**
    * Remove the database entry (if any) for "key".  Returns OK on
    * success, and a non-OK status on error.  It is not an error if "key"
@@ -2927,6 +3135,10 @@ public class RocksDB extends RocksObject {
   protected native void put(long handle, long writeOptHandle, byte[] key,
       int keyOffset, int keyLength, byte[] value, int valueOffset,
       int valueLength, long cfHandle) throws RocksDBException;
+  protected native void putDirect(long handle, long writeOptHandle,
+      ByteBuffer key, int keyOffset, int keyLength, ByteBuffer value,
+      int valueOffset, int valueLength, long cfHandle)
+      throws RocksDBException;
   protected native void write0(final long handle, long writeOptHandle,
       long wbHandle) throws RocksDBException;
   protected native void write1(final long handle, long writeOptHandle,
@@ -2968,6 +3180,15 @@ public class RocksDB extends RocksObject {
   protected native int get(long handle, long readOptHandle, byte[] key,
       int keyOffset, int keyLength, byte[] value, int valueOffset,
       int valueLength, long cfHandle) throws RocksDBException;
+  protected native int getDirect(long handle, long readOptHandle,
+      ByteBuffer key, int keyOffset, int keyLength, ByteBuffer value,
+      int valueOffset, int valueLength, long cfHandle)
+      throws RocksDBException;
+  protected native int[] multiGetDirect(final long dbHandle,
+      final long rOptHandle, final ByteBuffer[] keys, final int[] keyOffsets,
+      final int[] keyLengths, final ByteBuffer[] values,
+      final int[] valueOffsets, final int[] valueLengths,
+      final long[] columnFamilyHandles) throws RocksDBException;
   protected native byte[][] multiGet(final long dbHandle, final byte[][] keys,
       final int[] keyOffsets, final int[] keyLengths);
   protected native byte[][] multiGet(final long dbHandle, final byte[][] keys,
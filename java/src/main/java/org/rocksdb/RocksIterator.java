@@ -5,6 +5,8 @@
 
 package org.rocksdb;
 
+import java.nio.ByteBuffer;
+
 /**
  * <p>An iterator that yields a sequence of key/value pairs from a source.
  * Multiple implementations are provided by this library.
@@ -50,6 +52,33 @@ public class RocksIterator extends AbstractRocksIterator<RocksDB> {
     return value0(nativeHandle_);
   }
 
+  /**
+   * <p>Copy the entries from the current one on into {@code buffer} and
+   * advance past them, in a single JNI call. Every entry is written as the
+   * key length, the key, the value length and the value. The lengths are
+   * 4-byte ints in big-endian order, as read by {@link ByteBuffer#getInt()}
+   * in the default byte order.</p>
+   *
+   * <p>The entries are written from the position of the buffer, which is
+   * moved past them. Filling stops at the first entry that does not fit in
+   * the remaining bytes, or when the iterator is no longer valid. If the
+   * current entry alone does not fit, nothing is written, 0 is returned and
+   * the iterator stays on it.</p>
+   *
+   * <p>REQUIRES: {@link #isValid()}</p>
+   *
+   * @param buffer a direct buffer receiving the entries.
+   * @return the number of entries written.
+   */
+  public int nextBatch(final ByteBuffer buffer) {
+    assert(isOwningHandle());
+    assert(buffer.isDirect());
+    final long result = nextBatch0(nativeHandle_, buffer, buffer.position(),
+        buffer.remaining());
+    buffer.position(buffer.position() + (int) result);
+    return (int) (result >>> 32);
+  }
+
   @Override protected final native void disposeInternal(final long handle);
   @Override final native boolean isValid0(long handle);
   @Override final native void seekToFirst0(long handle);
@@ -62,4 +91,6 @@ public class RocksIterator extends AbstractRocksIterator<RocksDB> {
 
   private native byte[] key0(long handle);
   private native byte[] value0(long handle);
+  private native long nextBatch0(long handle, ByteBuffer buffer, int offset,
+      int length);
 }
@@ -5,6 +5,8 @@
 
 package org.rocksdb;
 
+import java.nio.ByteBuffer;
+
 /**
  * WriteBatch holds a collection of updates to apply atomically to a DB.
  *
@@ -61,6 +63,90 @@ public class WriteBatch extends AbstractWriteBatch {
     iterate(nativeHandle_, handler.nativeHandle_);
   }
 
+  /**
+   * Store the mapping "key-&gt;value" in the database, reading both from
+   * direct buffers without copying them into Java arrays.
+   *
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   * @param value the remaining bytes of the direct buffer are the value, the
+   *     position of the buffer is moved to its limit.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public void put(final ByteBuffer key, final ByteBuffer value)
+      throws RocksDBException {
+    putDirect(key, value, 0);
+  }
+
+  /**
+   * Store the mapping "key-&gt;value" within given column family, reading
+   * both from direct buffers without copying them into Java arrays.
+   *
+   * @param columnFamilyHandle {@link org.rocksdb.ColumnFamilyHandle}
+   *     instance
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   * @param value the remaining bytes of the direct buffer are the value, the
+   *     position of the buffer is moved to its limit.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public void put(final ColumnFamilyHandle columnFamilyHandle,
+      final ByteBuffer key, final ByteBuffer value) throws RocksDBException {
+    putDirect(key, value, columnFamilyHandle.nativeHandle_);
+  }
+
+  /**
+   * If the database contains a mapping for "key", erase it, reading the key
+   * from a direct buffer without copying it into a Java array.
+   *
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public void delete(final ByteBuffer key) throws RocksDBException {
+    deleteDirect(key, 0);
+  }
+
+  /**
+   * If column family contains a mapping for "key", erase it, reading the key
+   * from a direct buffer without copying it into a Java array.
+   *
+   * @param columnFamilyHandle {@link org.rocksdb.ColumnFamilyHandle}
+   *     instance
+   * @param key the remaining bytes of the direct buffer are the key, the
+   *     position of the buffer is moved to its limit.
+   *
+   * @throws RocksDBException thrown if error happens in underlying
+   *    native library.
+   */
+  public void delete(final ColumnFamilyHandle columnFamilyHandle,
+      final ByteBuffer key) throws RocksDBException {
+    deleteDirect(key, columnFamilyHandle.nativeHandle_);
+  }
+
+  private void putDirect(final ByteBuffer key, final ByteBuffer value,
+      final long cfHandle) throws RocksDBException {
+    assert(key.isDirect() && value.isDirect());
+    putDirect(nativeHandle_, key, key.position(), key.remaining(), value,
+        value.position(), value.remaining(), cfHandle);
+    key.position(key.limit());
+    value.position(value.limit());
+  }
+
+  private void deleteDirect(final ByteBuffer key, final long cfHandle)
+      throws RocksDBException {
+    assert(key.isDirect());
+    deleteDirect(nativeHandle_, key, key.position(), key.remaining(),
+        cfHandle);
+    key.position(key.limit());
+  }
+
   /**
    * Retrieve the serialized version of this batch.
    *
@@ -251,6 +337,14 @@ public class WriteBatch extends AbstractWriteBatch {
   @Override final native void setMaxBytes(final long nativeHandle,
     final long maxBytes);
 
+  private native void putDirect(final long handle, final ByteBuffer key,
+      final int keyOffset, final int keyLength, final ByteBuffer value,
+      final int valueOffset, final int valueLength, final long cfHandle)
+      throws RocksDBException;
+  private native void deleteDirect(final long handle, final ByteBuffer key,
+      final int keyOffset, final int keyLength, final long cfHandle)
+      throws RocksDBException;
+
   private native static long newWriteBatch(final int reserved_bytes);
   private native static long newWriteBatch(final byte[] serialized,
       final int serializedLength);
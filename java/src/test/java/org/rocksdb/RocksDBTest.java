@@ -270,6 +270,60 @@ public class RocksDBTest {
     }
   }
 
+  private static ByteBuffer directBuffer(final String s) {
+    final byte[] bytes = s.getBytes();
+    final ByteBuffer buf = ByteBuffer.allocateDirect(bytes.length);
+    buf.put(bytes).flip();
+    return buf;
+  }
+
+  private static String bufferString(final ByteBuffer buf) {
+    final byte[] bytes = new byte[buf.remaining()];
+    buf.duplicate().get(bytes);
+    return new String(bytes);
+  }
+
+  @Test
+  public void directByteBuffers() throws RocksDBException {
+    try (final RocksDB db = RocksDB.open(dbFolder.getRoot().getAbsolutePath());
+         final WriteOptions wOpt = new WriteOptions();
+         final ReadOptions rOpt = new ReadOptions()) {
+      final ByteBuffer key1 = directBuffer("key1");
+      db.put(wOpt, key1, directBuffer("value1"));
+      assertThat(key1.remaining()).isEqualTo(0);
+      assertThat(db.get("key1".getBytes())).isEqualTo("value1".getBytes());
+
+      final ByteBuffer value = ByteBuffer.allocateDirect(16);
+      assertThat(db.get(rOpt, directBuffer("key1"), value)).isEqualTo(6);
+      assertThat(bufferString(value)).isEqualTo("value1");
+
+      // a short buffer gets the head of the value, and the full size
+      final ByteBuffer shortValue = ByteBuffer.allocateDirect(3);
+      assertThat(db.get(rOpt, directBuffer("key1"), shortValue))
+          .isEqualTo(6);
+      assertThat(bufferString(shortValue)).isEqualTo("val");
+
+      value.clear();
+      assertThat(db.get(rOpt, directBuffer("key2"), value))
+          .isEqualTo(RocksDB.NOT_FOUND);
+
+      try (final WriteBatch batch = new WriteBatch()) {
+        batch.put(directBuffer("key2"), directBuffer("value2"));
+        batch.delete(directBuffer("key1"));
+        db.write(wOpt, batch);
+      }
+      assertThat(db.get("key1".getBytes())).isNull();
+      assertThat(db.get("key2".getBytes())).isEqualTo("value2".getBytes());
+
+      final ByteBuffer[] keys = {directBuffer("key1"), directBuffer("key2")};
+      final ByteBuffer[] values = {ByteBuffer.allocateDirect(16),
+          ByteBuffer.allocateDirect(16)};
+      final int[] sizes = db.multiGet(rOpt, keys, values);
+      assertThat(sizes).containsExactly(RocksDB.NOT_FOUND, 6);
+      assertThat(bufferString(values[1])).isEqualTo("value2");
+    }
+  }
+
   @Test
   public void merge() throws RocksDBException {
     try (final StringAppendOperator stringAppendOperator = new StringAppendOperator();
@@ -9,6 +9,8 @@ import org.junit.Rule;
 import org.junit.Test;
 import org.junit.rules.TemporaryFolder;
 
+import java.nio.ByteBuffer;
+
 import static org.assertj.core.api.Assertions.assertThat;
 
 public class RocksIteratorTest {
@@ -97,4 +99,37 @@ public class RocksIteratorTest {
       }
     }
   }
+
+  @Test
+  public void nextBatch() throws RocksDBException {
+    try (final Options options = new Options().setCreateIfMissing(true);
+         final RocksDB db = RocksDB.open(options,
+             dbFolder.getRoot().getAbsolutePath())) {
+      db.put("key1".getBytes(), "value1".getBytes());
+      db.put("key2".getBytes(), "value2".getBytes());
+
+      try (final RocksIterator iterator = db.newIterator()) {
+        iterator.seekToFirst();
+        // too small for the first entry
+        final ByteBuffer small = ByteBuffer.allocateDirect(8);
+        assertThat(iterator.nextBatch(small)).isEqualTo(0);
+        assertThat(small.position()).isEqualTo(0);
+        assertThat(iterator.key()).isEqualTo("key1".getBytes());
+
+        final ByteBuffer buf = ByteBuffer.allocateDirect(1024);
+        assertThat(iterator.nextBatch(buf)).isEqualTo(2);
+        assertThat(iterator.isValid()).isFalse();
+        buf.flip();
+        for (final String suffix : new String[] {"1", "2"}) {
+          final byte[] key = new byte[buf.getInt()];
+          buf.get(key);
+          final byte[] value = new byte[buf.getInt()];
+          buf.get(value);
+          assertThat(key).isEqualTo(("key" + suffix).getBytes());
+          assertThat(value).isEqualTo(("value" + suffix).getBytes());
+        }
+        assertThat(buf.remaining()).isEqualTo(0);
+      }
+    }
+  }
 }
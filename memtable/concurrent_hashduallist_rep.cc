@@ -1,7 +1,9 @@
 #ifndef ROCKSDB_LITE
 #include "memtable/concurrent_hashduallist_rep.h"
 
+#include <algorithm>
 #include <atomic>
+#include <vector>
 
 #include "db/memtable.h"
 #include "memtable/fulllist_iter.h"
@@ -143,6 +145,11 @@ class ConcurrentHashDualListRep : public MemTableRep {
       while (memtable_rep_->KeyIsAfterNode(internal_key, vertical_node_)) {
         vertical_node_ = vertical_node_->VerticalNext();
       }
+      if (vertical_node_ == nullptr && level_node_ != nullptr) {
+        // Every version of this user key is before internal_key
+        level_node_ = level_node_->LevelNext();
+        vertical_node_ = level_node_;
+      }
     }
 
     void SeekForPrev(const Slice &internal_key,
@@ -207,6 +214,149 @@ class ConcurrentHashDualListRep : public MemTableRep {
     const ConcurrentHashDualListRep *const memtable_rep_;
   };
 
+  // Total order iterator merging the buckets, each of them is already
+  // sorted. Flush walks the rep in place instead of copying every key into
+  // a temporary skiplist first. The lists are singly linked, so the first
+  // backward move falls back to that sorted copy.
+  class MergingIterator : public MemTableRep::Iterator {
+   public:
+    explicit MergingIterator(ConcurrentHashDualListRep *const memtable_rep)
+        : memtable_rep_(memtable_rep) {
+      for (size_t i = 0; i < memtable_rep_->bucket_size_; ++i) {
+        Pointer *bucket = memtable_rep_->buckets_ + i;
+        if (bucket->load(std::memory_order_acquire) != nullptr) {
+          children_.emplace_back(memtable_rep_, bucket);
+        }
+      }
+      heap_.reserve(children_.size());
+    }
+
+    bool Valid() const override {
+      return fallback_ ? fallback_->Valid() : !heap_.empty();
+    }
+
+    const char *EncodedKey() const override {
+      assert(Valid());
+      return fallback_ ? fallback_->EncodedKey() : heap_.front()->EncodedKey();
+    }
+
+    void Next() override {
+      assert(Valid());
+      if (fallback_) {
+        return fallback_->Next();
+      }
+      std::pop_heap(heap_.begin(), heap_.end(), comp_);
+      auto *iter = heap_.back();
+      if (!counts_.empty()) {
+        ++counts_[iter - children_.data()];
+      }
+      iter->Next();
+      if (iter->Valid()) {
+        std::push_heap(heap_.begin(), heap_.end(), comp_);
+      } else {
+        heap_.pop_back();
+        if (heap_.empty() && !counts_.empty()) {
+          LogBucketDistribution();
+        }
+      }
+    }
+
+    void Prev() override {
+      assert(Valid());
+      if (!fallback_) {
+        const char *current = EncodedKey();
+        Fallback()->Seek(GetLengthPrefixedSlice(current), current);
+      }
+      fallback_->Prev();
+    }
+
+    void Seek(const Slice &internal_key, const char *memtable_key) override {
+      if (fallback_) {
+        return fallback_->Seek(internal_key, memtable_key);
+      }
+      counts_.clear();
+      Rebuild([&](DuaLinkListIterator *iter) {
+        iter->Seek(internal_key, memtable_key);
+      });
+    }
+
+    void SeekForPrev(const Slice &internal_key,
+                     const char *memtable_key) override {
+      Fallback()->SeekForPrev(internal_key, memtable_key);
+    }
+
+    void SeekToFirst() override {
+      if (fallback_) {
+        return fallback_->SeekToFirst();
+      }
+      Rebuild([](DuaLinkListIterator *iter) { iter->SeekToFirst(); });
+      if (memtable_rep_->if_log_bucket_dist_when_flush_ &&
+          memtable_rep_->logger_ != nullptr) {
+        counts_.assign(children_.size(), 0);
+      }
+    }
+
+    void SeekToLast() override { Fallback()->SeekToLast(); }
+
+    bool IsSeekForPrevSupported() const override { return true; }
+
+   private:
+    struct Comparator {
+      const MemTableRep::KeyComparator &compare;
+
+      bool operator()(const DuaLinkListIterator *l,
+                      const DuaLinkListIterator *r) const {
+        return compare(l->EncodedKey(), r->EncodedKey()) > 0;
+      }
+    };
+
+    template <class func_t>
+    void Rebuild(func_t &&position) {
+      heap_.clear();
+      for (auto &iter : children_) {
+        position(&iter);
+        if (iter.Valid()) {
+          heap_.push_back(&iter);
+        }
+      }
+      std::make_heap(heap_.begin(), heap_.end(), comp_);
+    }
+
+    MemTableRep::Iterator *Fallback() {
+      if (!fallback_) {
+        fallback_.reset(memtable_rep_->GetSortedIterator(nullptr));
+        heap_.clear();
+        children_.clear();
+        counts_.clear();
+      }
+      return fallback_.get();
+    }
+
+    // A full forward scan, which is what flush does, reached the end
+    void LogBucketDistribution() {
+      HistogramImpl keys_per_bucket_hist;
+      for (size_t i = 0; i < memtable_rep_->bucket_size_ - counts_.size();
+           ++i) {
+        keys_per_bucket_hist.Add(0);
+      }
+      for (size_t count : counts_) {
+        keys_per_bucket_hist.Add(count);
+      }
+      counts_.clear();
+      Info(memtable_rep_->logger_,
+           "ConcurrentHashDualList Entry distribution among buckets: %s",
+           keys_per_bucket_hist.ToString().c_str());
+    }
+
+    ConcurrentHashDualListRep *const memtable_rep_;
+    Comparator comp_{memtable_rep_->compare_};
+    std::vector<DuaLinkListIterator> children_;
+    std::vector<DuaLinkListIterator *> heap_;
+    // Entries per child, only kept during a full scan that logs them
+    std::vector<size_t> counts_;
+    std::unique_ptr<MemTableRep::Iterator> fallback_;
+  };
+
   using BucketCleaner = ConcurrentHashDualListReqFactory::BucketCleaner;
 
  public:
@@ -278,7 +428,14 @@ class ConcurrentHashDualListRep : public MemTableRep {
     }
   }
 
-  MemTableRep::Iterator *GetIterator(Arena *arena = nullptr) override;
+  MemTableRep::Iterator *GetIterator(Arena *arena = nullptr) override {
+    if (arena == nullptr) {
+      return new MergingIterator(this);
+    } else {
+      auto mem = arena->AllocateAligned(sizeof(MergingIterator));
+      return new (mem) MergingIterator(this);
+    }
+  }
 
   MemTableRep::Iterator *GetDynamicPrefixIterator(
       Arena *alloc_arena = nullptr) override {
@@ -291,6 +448,10 @@ class ConcurrentHashDualListRep : public MemTableRep {
   }
 
  private:
+  // Copy the entries of all buckets into a skiplist, logging the bucket
+  // distribution if asked to
+  MemTableRep::Iterator *GetSortedIterator(Arena *arena);
+
   void InsertImpl(KeyHandle handle, bool concurrent) {
     Node *x = static_cast<Node *>(handle);
     assert(x && !Contains(GetLengthPrefixedSlice(x->key)));
@@ -500,7 +661,7 @@ class ConcurrentHashDualListRep : public MemTableRep {
   bool if_log_bucket_dist_when_flush_;
 };
 
-MemTableRep::Iterator *ConcurrentHashDualListRep::GetIterator(
+MemTableRep::Iterator *ConcurrentHashDualListRep::GetSortedIterator(
     Arena *alloc_arena) {
   Arena *new_arena = new Arena(allocator_->BlockSize());
   auto list = new MemtableSkipList(compare_, new_arena);
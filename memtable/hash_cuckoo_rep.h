@@ -17,15 +17,13 @@ namespace TERARKDB_NAMESPACE {
 
 class HashCuckooRepFactory : public MemTableRepFactory {
  public:
-  // maxinum number of hash functions used in the cuckoo hash.
-  static const unsigned int kMaxHashCount = 10;
-
+  // hash_function_count is kept for compatibility, the cuckoo map always
+  // hashes a key to two buckets of several slots.
   explicit HashCuckooRepFactory(size_t write_buffer_size,
                                 size_t average_data_size,
-                                unsigned int hash_function_count)
+                                unsigned int /*hash_function_count*/)
       : write_buffer_size_(write_buffer_size),
-        average_data_size_(average_data_size),
-        hash_function_count_(hash_function_count) {}
+        average_data_size_(average_data_size) {}
 
   virtual ~HashCuckooRepFactory() {}
 
@@ -37,10 +35,11 @@ class HashCuckooRepFactory : public MemTableRepFactory {
 
   virtual const char* Name() const override { return "HashCuckooRepFactory"; }
 
+  virtual bool IsInsertConcurrentlySupported() const override { return true; }
+
  private:
   size_t write_buffer_size_;
   size_t average_data_size_;
-  const unsigned int hash_function_count_;
 };
 }  // namespace TERARKDB_NAMESPACE
 #endif  // ROCKSDB_LITE
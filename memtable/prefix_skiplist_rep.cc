@@ -0,0 +1,411 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include "memtable/prefix_skiplist_rep.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "memtable/inlineskiplist.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/allocator.h"
+#include "util/arena.h"
+#include "util/coding.h"
+#include "util/hash.h"
+#include "util/string_util.h"
+
+namespace TERARKDB_NAMESPACE {
+namespace {
+
+// The shared key prefixes of a memtable. An id is handed out to each new
+// prefix until the dictionary is full, id 0 is the empty prefix of the keys
+// stored in full.
+class PrefixDictionary {
+ public:
+  enum : uint32_t { kNoPrefix = 0 };
+
+  PrefixDictionary(Allocator* allocator, uint32_t max_prefixes)
+      : allocator_(allocator), max_prefixes_(max_prefixes) {
+    char* mem = allocator->AllocateAligned(sizeof(Slice) * (max_prefixes + 1));
+    prefixes_ = new (mem) Slice[max_prefixes + 1];
+  }
+
+  // REQUIRES: the writers are serialized. The readers only see a prefix once
+  // the entry referencing it is inserted.
+  uint32_t GetOrAdd(const Slice& prefix) {
+    if (prefix.empty()) {
+      return kNoPrefix;
+    }
+    auto find = ids_.find(prefix);
+    if (find != ids_.end()) {
+      return find->second;
+    }
+    if (ids_.size() >= max_prefixes_) {
+      return kNoPrefix;
+    }
+    uint32_t id = static_cast<uint32_t>(ids_.size()) + 1;
+    char* mem = allocator_->Allocate(prefix.size());
+    memcpy(mem, prefix.data(), prefix.size());
+    prefixes_[id] = Slice(mem, prefix.size());
+    ids_.emplace(prefixes_[id], id);
+    return id;
+  }
+
+  const Slice& prefix(uint32_t id) const { return prefixes_[id]; }
+
+  size_t ApproximateMemoryUsage() const {
+    return ids_.bucket_count() * sizeof(void*) +
+           ids_.size() * (sizeof(Slice) + sizeof(uint32_t) + 2 * sizeof(void*));
+  }
+
+ private:
+  Allocator* const allocator_;
+  const uint32_t max_prefixes_;
+  Slice* prefixes_;
+  std::unordered_map<Slice, uint32_t, SliceHasher> ids_;
+};
+
+// An entry is encoded as
+//   varint32 prefix id, varint32 suffix size, the internal key without its
+//   prefix, varint32 value size, value
+// A lookup key is encoded as an entry without prefix and value.
+struct PrefixKey {
+  uint32_t id;
+  Slice prefix;
+  Slice suffix;
+  // The id of the prefix a lookup key was found to start with
+  mutable uint32_t matched_id;
+
+  Slice user_suffix() const {
+    return Slice(suffix.data(), suffix.size() - 8);
+  }
+  uint64_t sequence() const {
+    return DecodeFixed64(suffix.data() + suffix.size() - 8) >> 8;
+  }
+};
+
+class PrefixKeyComparator {
+ public:
+  typedef PrefixKey DecodedType;
+
+  PrefixKeyComparator(const InternalKeyComparator& comparator,
+                      const PrefixDictionary* dict)
+      : comparator_(comparator), dict_(dict) {}
+
+  DecodedType decode_key(const char* key) const {
+    PrefixKey k;
+    key = GetVarint32Ptr(key, key + 5, &k.id);
+    k.prefix = dict_->prefix(k.id);
+    k.suffix = GetLengthPrefixedSlice(key);
+    k.matched_id = PrefixDictionary::kNoPrefix;
+    return k;
+  }
+
+  int operator()(const char* key1, const char* key2) const {
+    return Compare(decode_key(key1), decode_key(key2));
+  }
+  int operator()(const char* key, const DecodedType& decoded) const {
+    return Compare(decode_key(key), decoded);
+  }
+  const InternalKeyComparator* icomparator() const { return &comparator_; }
+
+ private:
+  // `a` is an entry, `b` is an entry or a lookup key
+  int Compare(const PrefixKey& a, const PrefixKey& b) const {
+    Slice ua = a.user_suffix();
+    Slice ub = b.user_suffix();
+    int r;
+    if (a.id == b.id) {
+      // Skips the shared prefix
+      r = ua.compare(ub);
+    } else {
+      if (b.id == PrefixDictionary::kNoPrefix && b.matched_id != a.id &&
+          ub.starts_with(a.prefix)) {
+        // The lookup key skips the prefix when compared to the next entries
+        // sharing it
+        b.matched_id = a.id;
+      }
+      if (b.id == PrefixDictionary::kNoPrefix && b.matched_id == a.id) {
+        r = ua.compare(Slice(ub.data() + a.prefix.size(),
+                             ub.size() - a.prefix.size()));
+      } else {
+        r = CompareParts(a.prefix, ua, b.prefix, ub);
+      }
+    }
+    if (r != 0) {
+      return r;
+    }
+    uint64_t a_seq = a.sequence();
+    uint64_t b_seq = b.sequence();
+    if (a_seq > b_seq) {
+      return -1;
+    } else if (a_seq < b_seq) {
+      return +1;
+    }
+    return 0;
+  }
+
+  // Bytewise comparison of a0 + a1 and b0 + b1
+  static int CompareParts(Slice a0, Slice a1, Slice b0, Slice b1) {
+    size_t a_size = a0.size() + a1.size();
+    size_t b_size = b0.size() + b1.size();
+    for (;;) {
+      if (a0.empty()) {
+        if (a1.empty()) {
+          break;
+        }
+        a0 = a1;
+        a1 = Slice();
+      }
+      if (b0.empty()) {
+        if (b1.empty()) {
+          break;
+        }
+        b0 = b1;
+        b1 = Slice();
+      }
+      size_t n = std::min(a0.size(), b0.size());
+      int r = memcmp(a0.data(), b0.data(), n);
+      if (r != 0) {
+        return r;
+      }
+      a0.remove_prefix(n);
+      b0.remove_prefix(n);
+    }
+    return a_size < b_size ? -1 : (a_size > b_size ? +1 : 0);
+  }
+
+  const InternalKeyComparator comparator_;
+  const PrefixDictionary* dict_;
+};
+
+class PrefixSkipListRep : public MemTableRep {
+ public:
+  PrefixSkipListRep(const InternalKeyComparator& comparator,
+                    Allocator* allocator, const SliceTransform* transform,
+                    size_t prefix_length, uint32_t max_prefixes)
+      : MemTableRep(allocator),
+        dict_(allocator, max_prefixes),
+        compare_(comparator, &dict_),
+        skip_list_(compare_, allocator),
+        transform_(transform),
+        prefix_length_(prefix_length) {}
+
+  virtual bool InsertKeyValue(const Slice& internal_key,
+                              const Slice& value) override {
+    return skip_list_.Insert(Encode(internal_key, value));
+  }
+
+  virtual bool InsertKeyValueWithHint(const Slice& internal_key,
+                                      const Slice& value,
+                                      void** hint) override {
+    return skip_list_.InsertWithHint(Encode(internal_key, value), hint);
+  }
+
+  // Only reached through MemTableRep::Allocate(), the entry is encoded again
+  virtual void Insert(KeyHandle handle) override {
+    Slice key = GetLengthPrefixedSlice(static_cast<const char*>(handle));
+    InsertKeyValue(key, GetLengthPrefixedSlice(key.data() + key.size()));
+  }
+
+  virtual bool Contains(const Slice& internal_key) const override {
+    std::string tmp;
+    return skip_list_.Contains(EncodeLookup(&tmp, internal_key));
+  }
+
+  virtual size_t ApproximateMemoryUsage() override {
+    // The entries and the prefixes are allocated through allocator
+    return dict_.ApproximateMemoryUsage();
+  }
+
+  virtual void Get(const LookupKey& k, void* callback_args,
+                   bool (*callback_func)(void* arg, const Slice& key,
+                                         const char* value)) override {
+    Iterator iter(this);
+    for (iter.Seek(k.internal_key(), nullptr);
+         iter.Valid() && callback_func(callback_args, iter.key(), iter.value());
+         iter.Next()) {
+    }
+  }
+
+  uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                 const Slice& end_ikey) override {
+    std::string tmp;
+    uint64_t start_count =
+        skip_list_.EstimateCount(EncodeLookup(&tmp, start_ikey));
+    uint64_t end_count = skip_list_.EstimateCount(EncodeLookup(&tmp, end_ikey));
+    return (end_count >= start_count) ? (end_count - start_count) : 0;
+  }
+
+  virtual ~PrefixSkipListRep() override {}
+
+  // Iteration over the contents of the skip list, the keys are put together
+  // again from their prefix and suffix
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const PrefixSkipListRep* rep)
+        : rep_(rep), iter_(&rep->skip_list_) {}
+
+    virtual ~Iterator() override {}
+
+    virtual bool Valid() const override { return iter_.Valid(); }
+
+    // The keys are not stored in full
+    virtual const char* EncodedKey() const override {
+      assert(false);
+      return nullptr;
+    }
+
+    virtual Slice key() const override {
+      assert(Valid());
+      if (node_ != iter_.key()) {
+        node_ = iter_.key();
+        PrefixKey k = rep_->compare_.decode_key(node_);
+        key_.assign(k.prefix.data(), k.prefix.size());
+        key_.append(k.suffix.data(), k.suffix.size());
+      }
+      return key_;
+    }
+
+    virtual const char* value() const override {
+      assert(Valid());
+      PrefixKey k = rep_->compare_.decode_key(iter_.key());
+      return k.suffix.data() + k.suffix.size();
+    }
+
+    virtual void Next() override { iter_.Next(); }
+
+    virtual void Prev() override { iter_.Prev(); }
+
+    virtual void Seek(const Slice& internal_key,
+                      const char* memtable_key) override {
+      iter_.Seek(EncodeLookup(&tmp_, internal_key, memtable_key));
+    }
+
+    virtual void SeekForPrev(const Slice& internal_key,
+                             const char* memtable_key) override {
+      iter_.SeekForPrev(EncodeLookup(&tmp_, internal_key, memtable_key));
+    }
+
+    virtual void SeekToFirst() override { iter_.SeekToFirst(); }
+
+    virtual void SeekToLast() override { iter_.SeekToLast(); }
+
+    virtual bool IsSeekForPrevSupported() const override { return true; }
+
+   private:
+    const PrefixSkipListRep* rep_;
+    InlineSkipList<const PrefixKeyComparator&>::Iterator iter_;
+    // The entry key_ was put together for
+    mutable const char* node_ = nullptr;
+    mutable std::string key_;
+    std::string tmp_;  // For passing to EncodeLookup
+  };
+
+  virtual MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override {
+    void* mem = arena ? arena->AllocateAligned(sizeof(Iterator))
+                      : operator new(sizeof(Iterator));
+    return new (mem) Iterator(this);
+  }
+
+ private:
+  Slice Prefix(const Slice& user_key) const {
+    if (prefix_length_ > 0) {
+      return user_key.size() >= prefix_length_
+                 ? Slice(user_key.data(), prefix_length_)
+                 : Slice();
+    }
+    return transform_->InDomain(user_key) ? transform_->Transform(user_key)
+                                          : Slice();
+  }
+
+  char* Encode(const Slice& internal_key, const Slice& value) {
+    uint32_t id = dict_.GetOrAdd(Prefix(ExtractUserKey(internal_key)));
+    size_t prefix_size = dict_.prefix(id).size();
+    Slice suffix(internal_key.data() + prefix_size,
+                 internal_key.size() - prefix_size);
+    size_t size = VarintLength(id) + VarintLength(suffix.size()) +
+                  suffix.size() + VarintLength(value.size()) + value.size();
+    char* buf = skip_list_.AllocateKey(size);
+    char* p = EncodeVarint32(buf, id);
+    p = EncodeVarint32(p, static_cast<uint32_t>(suffix.size()));
+    memcpy(p, suffix.data(), suffix.size());
+    p = EncodeVarint32(p + suffix.size(), static_cast<uint32_t>(value.size()));
+    memcpy(p, value.data(), value.size());
+    return buf;
+  }
+
+  static const char* EncodeLookup(std::string* buf, const Slice& internal_key,
+                                  const char* memtable_key = nullptr) {
+    Slice key = memtable_key != nullptr ? GetLengthPrefixedSlice(memtable_key)
+                                        : internal_key;
+    buf->clear();
+    PutVarint32(buf, PrefixDictionary::kNoPrefix);
+    PutLengthPrefixedSlice(buf, key);
+    return buf->data();
+  }
+
+  PrefixDictionary dict_;
+  const PrefixKeyComparator compare_;
+  InlineSkipList<const PrefixKeyComparator&> skip_list_;
+  const SliceTransform* transform_;
+  const size_t prefix_length_;
+};
+
+}  // namespace
+
+MemTableRep* PrefixSkipListRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+    Allocator* allocator, const SliceTransform* transform, Logger* logger) {
+  const InternalKeyComparator* icmp = compare.icomparator();
+  if ((prefix_length_ == 0 && transform == nullptr) ||
+      strcmp(icmp->user_comparator()->Name(), BytewiseComparator()->Name()) !=
+          0) {
+    // Comparing the suffixes only orders the keys of a bytewise comparator
+    return SkipListFactory().CreateMemTableRep(compare, needs_dup_key_check,
+                                               allocator, transform, logger);
+  }
+  return new PrefixSkipListRep(*icmp, allocator, transform, prefix_length_,
+                               max_prefixes_);
+}
+
+MemTableRepFactory* NewPrefixSkipListRepFactory(size_t prefix_length,
+                                                uint32_t max_prefixes) {
+  return new PrefixSkipListRepFactory(prefix_length, max_prefixes);
+}
+
+static MemTableRepFactory* NewPrefixSkipListRepFactory(
+    const std::unordered_map<std::string, std::string>& options,
+    Status* /*s*/) {
+  size_t prefix_length = 0;  // default
+  auto f = options.find("prefix_length");
+  if (options.end() != f) {
+    prefix_length = ParseSizeT(f->second);
+  }
+
+  uint32_t max_prefixes = 1024;  // default
+  f = options.find("max_prefixes");
+  if (options.end() != f) {
+    max_prefixes = ParseUint32(f->second);
+  }
+
+  return new PrefixSkipListRepFactory(prefix_length, max_prefixes);
+}
+
+ROCKSDB_REGISTER_MEM_TABLE("prefix_skip_list", PrefixSkipListRepFactory);
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,40 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/slice_transform.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class PrefixSkipListRepFactory : public MemTableRepFactory {
+ public:
+  explicit PrefixSkipListRepFactory(size_t prefix_length,
+                                    uint32_t max_prefixes)
+      : prefix_length_(prefix_length), max_prefixes_(max_prefixes) {}
+
+  virtual ~PrefixSkipListRepFactory() {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  virtual MemTableRep* CreateMemTableRep(
+      const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+      Allocator* allocator, const SliceTransform* transform,
+      Logger* logger) override;
+
+  virtual const char* Name() const override {
+    return "PrefixSkipListRepFactory";
+  }
+
+  bool CanHandleDuplicatedKey() const override { return true; }
+
+ private:
+  const size_t prefix_length_;
+  const uint32_t max_prefixes_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,372 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include "memtable/sharded_rep.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/arena.h"
+#include "util/hash.h"
+#include "util/string_util.h"
+
+namespace TERARKDB_NAMESPACE {
+namespace {
+
+// The entries of a user key all go to the shard its hash picks, so that the
+// writers of different keys insert into different reps, and a point lookup
+// reads a single shard. The iterators merge the shards.
+class ShardedRep : public MemTableRep {
+ public:
+  ShardedRep(const MemTableRep::KeyComparator& compare, Allocator* allocator,
+             std::vector<std::unique_ptr<MemTableRep>>&& shards)
+      : MemTableRep(allocator),
+        icmp_(compare.icomparator()),
+        shards_(std::move(shards)) {}
+
+  virtual bool InsertKeyValue(const Slice& internal_key,
+                              const Slice& value) override {
+    return Shard(internal_key)->InsertKeyValue(internal_key, value);
+  }
+
+  // The hints are kept by prefix, and the keys sharing one may go to
+  // different shards
+  virtual bool InsertKeyValueWithHint(const Slice& internal_key,
+                                      const Slice& value,
+                                      void** /*hint*/) override {
+    return Shard(internal_key)->InsertKeyValue(internal_key, value);
+  }
+
+  virtual bool InsertKeyValueConcurrently(const Slice& internal_key,
+                                          const Slice& value) override {
+    return Shard(internal_key)->InsertKeyValueConcurrently(internal_key,
+                                                           value);
+  }
+
+  // Only reached through MemTableRep::Allocate(), the entry is copied to the
+  // shard
+  virtual void Insert(KeyHandle handle) override {
+    Slice key = GetLengthPrefixedSlice(static_cast<const char*>(handle));
+    InsertKeyValue(key, GetLengthPrefixedSlice(key.data() + key.size()));
+  }
+
+  virtual void InsertConcurrently(KeyHandle handle) override {
+    Slice key = GetLengthPrefixedSlice(static_cast<const char*>(handle));
+    InsertKeyValueConcurrently(
+        key, GetLengthPrefixedSlice(key.data() + key.size()));
+  }
+
+  virtual bool Contains(const Slice& internal_key) const override {
+    return Shard(internal_key)->Contains(internal_key);
+  }
+
+  virtual void MarkReadOnly() override {
+    for (auto& shard : shards_) {
+      shard->MarkReadOnly();
+    }
+  }
+
+  virtual void MarkFlushed() override {
+    for (auto& shard : shards_) {
+      shard->MarkFlushed();
+    }
+  }
+
+  virtual void Get(const LookupKey& k, void* callback_args,
+                   bool (*callback_func)(void* arg, const Slice& key,
+                                         const char* value)) override {
+    Shard(k.internal_key())->Get(k, callback_args, callback_func);
+  }
+
+  uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                 const Slice& end_ikey) override {
+    uint64_t count = 0;
+    for (auto& shard : shards_) {
+      count += shard->ApproximateNumEntries(start_ikey, end_ikey);
+    }
+    return count;
+  }
+
+  virtual size_t ApproximateMemoryUsage() override {
+    size_t usage = 0;
+    for (auto& shard : shards_) {
+      usage += shard->ApproximateMemoryUsage();
+    }
+    return usage;
+  }
+
+  virtual bool IsMergeOperatorSupported() const override {
+    return shards_.front()->IsMergeOperatorSupported();
+  }
+
+  virtual bool IsSnapshotSupported() const override {
+    return shards_.front()->IsSnapshotSupported();
+  }
+
+  virtual ~ShardedRep() override {}
+
+  // Merges the iterators of the shards. The shards hold different user keys,
+  // no two of them are ever positioned at the same key.
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    Iterator(const InternalKeyComparator* icmp,
+             std::vector<MemTableRep::Iterator*>&& children, bool arena_mode)
+        : icmp_(icmp),
+          children_(std::move(children)),
+          arena_mode_(arena_mode) {}
+
+    virtual ~Iterator() override {
+      for (auto child : children_) {
+        if (arena_mode_) {
+          child->~Iterator();
+        } else {
+          delete child;
+        }
+      }
+    }
+
+    virtual bool Valid() const override { return current_ != nullptr; }
+
+    virtual const char* EncodedKey() const override {
+      assert(Valid());
+      return current_->EncodedKey();
+    }
+
+    virtual Slice key() const override {
+      assert(Valid());
+      return current_->key();
+    }
+
+    virtual const char* value() const override {
+      assert(Valid());
+      return current_->value();
+    }
+
+    virtual void Next() override {
+      assert(Valid());
+      if (!forward_) {
+        // The other children are before the key, move them past it
+        Slice target = current_->key();
+        for (auto child : children_) {
+          if (child != current_) {
+            child->Seek(target, nullptr);
+          }
+        }
+        forward_ = true;
+      }
+      current_->Next();
+      FindSmallest();
+    }
+
+    virtual void Prev() override {
+      assert(Valid());
+      if (forward_) {
+        // The other children are after the key, move them before it
+        Slice target = current_->key();
+        for (auto child : children_) {
+          if (child != current_) {
+            child->Seek(target, nullptr);
+            if (child->Valid()) {
+              child->Prev();
+            } else {
+              child->SeekToLast();
+            }
+          }
+        }
+        forward_ = false;
+      }
+      current_->Prev();
+      FindLargest();
+    }
+
+    virtual void Seek(const Slice& internal_key,
+                      const char* memtable_key) override {
+      for (auto child : children_) {
+        child->Seek(internal_key, memtable_key);
+      }
+      forward_ = true;
+      FindSmallest();
+    }
+
+    virtual void SeekForPrev(const Slice& internal_key,
+                             const char* memtable_key) override {
+      for (auto child : children_) {
+        if (child->IsSeekForPrevSupported()) {
+          child->SeekForPrev(internal_key, memtable_key);
+          continue;
+        }
+        child->Seek(internal_key, memtable_key);
+        if (!child->Valid()) {
+          child->SeekToLast();
+        } else if (icmp_->Compare(child->key(), internal_key) > 0) {
+          child->Prev();
+        }
+      }
+      forward_ = false;
+      FindLargest();
+    }
+
+    virtual void SeekToFirst() override {
+      for (auto child : children_) {
+        child->SeekToFirst();
+      }
+      forward_ = true;
+      FindSmallest();
+    }
+
+    virtual void SeekToLast() override {
+      for (auto child : children_) {
+        child->SeekToLast();
+      }
+      forward_ = false;
+      FindLargest();
+    }
+
+    virtual bool IsSeekForPrevSupported() const override { return true; }
+
+   private:
+    void FindSmallest() {
+      current_ = nullptr;
+      for (auto child : children_) {
+        if (child->Valid() &&
+            (current_ == nullptr ||
+             icmp_->Compare(child->key(), current_->key()) < 0)) {
+          current_ = child;
+        }
+      }
+    }
+
+    void FindLargest() {
+      current_ = nullptr;
+      for (auto child : children_) {
+        if (child->Valid() &&
+            (current_ == nullptr ||
+             icmp_->Compare(child->key(), current_->key()) > 0)) {
+          current_ = child;
+        }
+      }
+    }
+
+    const InternalKeyComparator* icmp_;
+    const std::vector<MemTableRep::Iterator*> children_;
+    const bool arena_mode_;
+    MemTableRep::Iterator* current_ = nullptr;
+    bool forward_ = true;
+  };
+
+  virtual MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override {
+    return NewIterator(arena, false /* dynamic_prefix */);
+  }
+
+  virtual MemTableRep::Iterator* GetDynamicPrefixIterator(
+      Arena* arena = nullptr) override {
+    return NewIterator(arena, true /* dynamic_prefix */);
+  }
+
+ private:
+  MemTableRep* Shard(const Slice& internal_key) const {
+    uint32_t hash = GetSliceHash(ExtractUserKey(internal_key));
+    return shards_[hash % shards_.size()].get();
+  }
+
+  MemTableRep::Iterator* NewIterator(Arena* arena, bool dynamic_prefix) {
+    std::vector<MemTableRep::Iterator*> children;
+    children.reserve(shards_.size());
+    for (auto& shard : shards_) {
+      children.push_back(dynamic_prefix ? shard->GetDynamicPrefixIterator(arena)
+                                        : shard->GetIterator(arena));
+    }
+    void* mem = arena ? arena->AllocateAligned(sizeof(Iterator))
+                      : operator new(sizeof(Iterator));
+    return new (mem) Iterator(icmp_, std::move(children), arena != nullptr);
+  }
+
+  const InternalKeyComparator* icmp_;
+  const std::vector<std::unique_ptr<MemTableRep>> shards_;
+};
+
+}  // namespace
+
+ShardedRepFactory::ShardedRepFactory(std::shared_ptr<MemTableRepFactory> base,
+                                     size_t num_shards)
+    : base_(base != nullptr ? std::move(base)
+                            : std::make_shared<SkipListFactory>()),
+      num_shards_(std::max<size_t>(num_shards, 1)) {}
+
+MemTableRep* ShardedRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+    Allocator* allocator, const SliceTransform* transform, Logger* logger) {
+  std::vector<std::unique_ptr<MemTableRep>> shards(num_shards_);
+  for (auto& shard : shards) {
+    shard.reset(base_->CreateMemTableRep(compare, needs_dup_key_check,
+                                         allocator, transform, logger));
+  }
+  return new ShardedRep(compare, allocator, std::move(shards));
+}
+
+MemTableRep* ShardedRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+    Allocator* allocator, const SliceTransform* transform, Logger* logger,
+    uint32_t column_family_id) {
+  std::vector<std::unique_ptr<MemTableRep>> shards(num_shards_);
+  for (auto& shard : shards) {
+    shard.reset(base_->CreateMemTableRep(compare, needs_dup_key_check,
+                                         allocator, transform, logger,
+                                         column_family_id));
+  }
+  return new ShardedRep(compare, allocator, std::move(shards));
+}
+
+MemTableRep* ShardedRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+    Allocator* allocator, const ImmutableCFOptions& ioptions,
+    const MutableCFOptions& mutable_cf_options, uint32_t column_family_id) {
+  std::vector<std::unique_ptr<MemTableRep>> shards(num_shards_);
+  for (auto& shard : shards) {
+    shard.reset(base_->CreateMemTableRep(compare, needs_dup_key_check,
+                                         allocator, ioptions,
+                                         mutable_cf_options, column_family_id));
+  }
+  return new ShardedRep(compare, allocator, std::move(shards));
+}
+
+MemTableRepFactory* NewShardedRepFactory(
+    std::shared_ptr<MemTableRepFactory> base, size_t num_shards) {
+  return new ShardedRepFactory(std::move(base), num_shards);
+}
+
+static MemTableRepFactory* NewShardedRepFactory(
+    const std::unordered_map<std::string, std::string>& options, Status* s) {
+  size_t num_shards = 8;  // default
+  auto f = options.find("shards");
+  if (options.end() != f) {
+    num_shards = ParseSizeT(f->second);
+  }
+
+  std::shared_ptr<MemTableRepFactory> base;
+  f = options.find("base");
+  if (options.end() != f) {
+    base.reset(CreateMemTableRepFactory(f->second, {}, s));
+    if (base == nullptr) {
+      return nullptr;
+    }
+  }
+
+  return new ShardedRepFactory(std::move(base), num_shards);
+}
+
+ROCKSDB_REGISTER_MEM_TABLE("sharded", ShardedRepFactory);
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
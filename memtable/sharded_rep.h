@@ -0,0 +1,57 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+#include <memory>
+
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class ShardedRepFactory : public MemTableRepFactory {
+ public:
+  ShardedRepFactory(std::shared_ptr<MemTableRepFactory> base,
+                    size_t num_shards);
+
+  virtual ~ShardedRepFactory() {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  virtual MemTableRep* CreateMemTableRep(
+      const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+      Allocator* allocator, const SliceTransform* transform,
+      Logger* logger) override;
+  virtual MemTableRep* CreateMemTableRep(
+      const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+      Allocator* allocator, const SliceTransform* transform, Logger* logger,
+      uint32_t column_family_id) override;
+  virtual MemTableRep* CreateMemTableRep(
+      const MemTableRep::KeyComparator& compare, bool needs_dup_key_check,
+      Allocator* allocator, const ImmutableCFOptions& ioptions,
+      const MutableCFOptions& mutable_cf_options,
+      uint32_t column_family_id) override;
+
+  virtual const char* Name() const override { return "ShardedRepFactory"; }
+
+  bool IsInsertConcurrentlySupported() const override {
+    return base_->IsInsertConcurrentlySupported();
+  }
+
+  bool CanHandleDuplicatedKey() const override {
+    return base_->CanHandleDuplicatedKey();
+  }
+
+  bool IsPrefixExtractorRequired() const override {
+    return base_->IsPrefixExtractorRequired();
+  }
+
+ private:
+  const std::shared_ptr<MemTableRepFactory> base_;
+  const size_t num_shards_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
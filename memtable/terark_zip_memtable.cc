@@ -82,12 +82,112 @@ bool MemWriterToken::init_value(void* valptr, size_t valsize) noexcept {
   return false;
 }
 
+// Insert a (key, tag) -> value mapping into trie, the tag vector of key is
+// kept sorted by tag.
+static details::InsertResult InsertToTrie(MainPatricia* trie,
+                                          terark::fstring key, uint64_t tag,
+                                          const Slice& value) {
+  auto token = trie->tls_writer_token_nn<MemWriterToken>();
+  assert(dynamic_cast<MemWriterToken*>(token) != nullptr);
+  token->reset_tag_value(tag, value);
+  token->acquire(trie);
+  TERARK_SCOPE_EXIT(token->idle());
+  uint32_t tmp_loc = UINT32_MAX;
+  if (!token->insert(key, &tmp_loc)) {
+    size_t vector_loc = token->value_of<uint32_t>();
+    auto* vector = (details::tag_vector_t*)trie->mem_get(vector_loc);
+    size_t value_size = VarintLength(value.size()) + value.size();
+    size_t value_loc = trie->mem_alloc(value_size);
+    if (value_loc == MainPatricia::mem_alloc_fail) {
+      return details::InsertResult::Fail;
+    }
+    auto valptr = (char*)trie->mem_get(value_loc);
+    valptr = EncodeVarint32(valptr, (uint32_t)value.size());
+    memcpy(valptr, value.data(), value.size());
+    uint64_t size_loc;
+    // row lock: infinite spin on LOCK_FLAG
+    do {
+      do {
+        size_loc = vector->size_loc.load(std::memory_order_relaxed);
+      } while (size_loc & LOCK_FLAG);
+      size_loc =
+          vector->size_loc.fetch_or(LOCK_FLAG, std::memory_order_acq_rel);
+    } while (size_loc & LOCK_FLAG);
+    auto* data =
+        (details::tag_vector_t::data_t*)trie->mem_get((uint32_t)size_loc);
+    uint32_t size = (size_loc >> 32);
+    assert(size > 0);
+    size_t insert_pos = terark::lower_bound_ex_n(
+        data, 0, size, tag >> 8,
+        [](details::tag_vector_t::data_t& item) { return item.tag >> 8; });
+    if (insert_pos < size && (tag >> 8) == (data[insert_pos].tag >> 8)) {
+      vector->size_loc.store(size_loc, std::memory_order_release);
+      trie->mem_free(value_loc, value_size);
+      return details::InsertResult::Duplicated;
+    }
+    if (!details::tag_vector_t::full(size) && insert_pos == size) {
+      data[size].loc = (uint32_t)value_loc;
+      data[size].tag = tag;
+
+      // update 'size' and unlock
+      vector->size_loc.store(size_loc + (1ULL << 32),
+                             std::memory_order_release);
+      return details::InsertResult::Success;
+    }
+    size_t old_data_cap =
+        sizeof(details::tag_vector_t::data_t) *
+        (1u << (32 - details::tag_vector_t::full(size) - fast_clz32(size)));
+    size_t cow_data_loc = trie->mem_alloc(
+        old_data_cap * (1 + details::tag_vector_t::full(size)));
+    if (cow_data_loc == MainPatricia::mem_alloc_fail) {
+      vector->size_loc.store(size_loc, std::memory_order_release);
+      trie->mem_free(value_loc, value_size);
+      return details::InsertResult::Fail;
+    }
+    auto* cow_data =
+        (details::tag_vector_t::data_t*)trie->mem_get(cow_data_loc);
+    memcpy(cow_data, data, sizeof(details::tag_vector_t::data_t) * insert_pos);
+    cow_data[insert_pos].loc = (uint32_t)value_loc;
+    cow_data[insert_pos].tag = tag;
+    memcpy(cow_data + insert_pos + 1, data + insert_pos,
+           sizeof(details::tag_vector_t::data_t) * (size - insert_pos));
+    vector->size_loc.store((uint64_t(size + 1) << 32) + cow_data_loc,
+                           std::memory_order_release);
+    trie->mem_lazy_free((uint32_t)size_loc, old_data_cap);
+    return details::InsertResult::Success;
+  } else if (token->value() != nullptr) {
+    const auto token_value_loc = token->value_of<uint32_t>();
+    TERARK_VERIFY(token_value_loc == tmp_loc);
+    return details::InsertResult::Success;
+  } else
+    return details::InsertResult::Fail;
+}
+
+static void ProtectTrie(MainPatricia* trie, bool read_only) {
+  void* base = trie->mem_get(0);
+  size_t size = terark::align_up(trie->mem_size(), 4096);
+  int prot = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+  if (mprotect(base, size, prot) < 0) {
+    fprintf(stderr, "%s:%d: %s: FATAL: mprotect(%p, %zd, %s) = %s\n",
+            __FILE__, __LINE__, BOOST_CURRENT_FUNCTION, base, size,
+            read_only ? "READ" : "READ|WRITE", strerror(errno));
+  }
+}
+
+details::trie_group_t::~trie_group_t() {
+  for (size_t i = 0; i < size; ++i) {
+    ProtectTrie(tries[i], false);
+    delete tries[i];
+  }
+}
+
 PatriciaTrieRep::PatriciaTrieRep(details::ConcurrentType concurrent_type,
                                  details::PatriciaKeyType patricia_key_type,
                                  bool handle_duplicate,
                                  intptr_t write_buffer_size,
-                                 Allocator* allocator)
-    : MemTableRep(allocator) {
+                                 Allocator* allocator,
+                                 const SliceTransform* prefix_extractor)
+    : MemTableRep(allocator), prefix_extractor_(prefix_extractor) {
   immutable_ = false;
   patricia_key_type_ = patricia_key_type;
   handle_duplicate_ = handle_duplicate;
@@ -96,70 +196,186 @@ PatriciaTrieRep::PatriciaTrieRep(details::ConcurrentType concurrent_type,
     concurrent_level_ = terark::Patricia::MultiWriteMultiRead;
   else
     concurrent_level_ = terark::Patricia::OneWriteMultiRead;
-  trie_vec_[0] =
+  group_.reset(new details::trie_group_t);
+  group_->tries[0] =
       new MainPatricia(sizeof(uint32_t), write_buffer_size_, concurrent_level_);
-  trie_vec_size_ = 1;
-  overhead_ = trie_vec_[0]->mem_size_inline();
+  group_->size = 1;
+  overhead_ = group_->tries[0]->mem_size_inline();
+  rotate_slot_ = 1;
+  watermark_ = write_buffer_size > 0 ? size_t(write_buffer_size) / 4 * 3
+                                     : size_t(-1);
+  spare_building_ = false;
+  spare_ = nullptr;
+  spare_capacity_ = 0;
+  current_ = group_.get();
+  merged_ = false;
+  merge_cancel_ = false;
+  pins_[0] = 0;
+  pins_[1] = 0;
+  num_inserted_ = 0;
+  sample_interval_ = 16;
+  samples_sorted_ = true;
 }
 
 PatriciaTrieRep::~PatriciaTrieRep() {
-  for (size_t i = 0; i < trie_vec_size_; ++i) {
-    auto trie = trie_vec_[i];
-    void* base = trie->mem_get(0);
-    size_t size = terark::align_up(trie->mem_size(), 4096);
-    if (mprotect(base, size, PROT_READ | PROT_WRITE) < 0) {
-      fprintf(stderr, "%s:%d: %s: FATAL: mprotect(%p, %zd, READ|WRITE) = %s\n",
-              __FILE__, __LINE__, BOOST_CURRENT_FUNCTION, base, size,
-              strerror(errno));
-    }
-    delete trie;
+  merge_cancel_ = true;
+  if (merge_thread_.joinable()) {
+    merge_thread_.join();
   }
+  delete spare_.exchange(nullptr);
 }
 
 void PatriciaTrieRep::MarkReadOnly() {
 #if 0  // set_readonly not released
-  for (size_t i = 0; i < trie_vec_size_; ++i) {
-    trie_vec_[i]->set_readonly();
+  for (size_t i = 0; i < group_->size; ++i) {
+    group_->tries[i]->set_readonly();
   }
 #endif
   static std::atomic<int> file_seq(0);
 
   if (terark::getEnvBool("TerarkDB_csppMemTabDump")) {
     int curr_seq = file_seq++;
-    for (size_t i = 0; i < trie_vec_size_; ++i) {
+    for (size_t i = 0; i < group_->size; ++i) {
       char fname[64];
       snprintf(fname, sizeof(fname) - 1, "cspp-memtab-%06d-%03zd.mmap",
                curr_seq, i);
-      trie_vec_[i]->save_mmap(fname);
+      group_->tries[i]->save_mmap(fname);
     }
   }
-  for (size_t i = 0; i < trie_vec_size_; ++i) {
-    auto trie = trie_vec_[i];
-    void* base = trie->mem_get(0);
-    size_t size = terark::align_up(trie->mem_size(), 4096);
-    if (mprotect(base, size, PROT_READ) < 0) {
-      fprintf(stderr, "%s:%d: %s: FATAL: mprotect(%p, %zd, READ) = %s\n",
-              __FILE__, __LINE__, BOOST_CURRENT_FUNCTION, base, size,
-              strerror(errno));
-    }
+  for (size_t i = 0; i < group_->size; ++i) {
+    ProtectTrie(group_->tries[i], true);
   }
   immutable_ = true;
+  delete spare_.exchange(nullptr);
+  if (group_->size > 1 &&
+      terark::getEnvBool("TerarkDB_csppMemTabMerge", true)) {
+    merge_thread_ = std::thread(&PatriciaTrieRep::MergeTries, this);
+  }
+}
+
+void PatriciaTrieRep::MergeTries() {
+  std::shared_ptr<details::trie_group_t> origin = group_;
+  size_t mem_size = 0;
+  for (size_t i = 0; i < origin->size; ++i) {
+    mem_size += origin->tries[i]->mem_size_inline();
+  }
+  // The merged trie leaves the free lists of the original tries behind, so
+  // their total size is enough to hold it
+  mem_size += mem_size >> 4;
+  if (mem_size > UINT32_MAX) {
+    // Value and tag vector locations are 32 bit
+    return;
+  }
+  std::shared_ptr<details::trie_group_t> merged(new details::trie_group_t);
+  merged->tries[0] =
+      new MainPatricia(sizeof(uint32_t), mem_size, concurrent_level_);
+  merged->size = 1;
+  {
+    PatriciaRepIterator<true> iter(origin);
+    // Backward iteration visits the tags of a key in ascending order, which
+    // appends to the tag vector instead of copying it on every insert
+    for (iter.SeekToLast(); iter.Valid(); iter.Prev()) {
+      if (merge_cancel_.load(std::memory_order_relaxed)) {
+        return;
+      }
+      Slice internal_key = iter.key();
+      auto result = InsertToTrie(
+          merged->tries[0],
+          terark::fstring(internal_key.data(), internal_key.size() - 8),
+          ExtractInternalKeyFooter(internal_key),
+          GetLengthPrefixedSlice(iter.value()));
+      if (result == details::InsertResult::Fail) {
+        // Keep serving from the original tries
+        return;
+      }
+    }
+  }
+  ProtectTrie(merged->tries[0], true);
+  {
+    std::unique_lock<std::mutex> lock(group_mutex_);
+    group_ = merged;
+  }
+  current_.store(merged.get());
+  merged_.store(true);
+  // Get() calls that may still look at the original tries
+  while (pins_[0].load() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+size_t PatriciaTrieRep::PinTries() const {
+  for (;;) {
+    size_t pin = merged_.load() ? 1 : 0;
+    pins_[pin].fetch_add(1);
+    if (merged_.load() == (pin == 1)) {
+      return pin;
+    }
+    // The merge finished in between, it may not wait for this pin
+    pins_[pin].fetch_sub(1);
+  }
 }
 
 size_t PatriciaTrieRep::ApproximateMemoryUsage() {
+  size_t pin = PinTries();
+  TERARK_SCOPE_EXIT(UnpinTries(pin));
+  auto* group = current_.load();
   size_t sum = 0;
-  for (size_t i = 0; i < trie_vec_size_; ++i) {
-    sum += trie_vec_[i]->mem_size_inline();
+  for (size_t i = 0; i < group->size; ++i) {
+    sum += group->tries[i]->mem_size_inline();
   }
   assert(sum >= overhead_);
   return sum - overhead_;
 }
 
+void PatriciaTrieRep::AddSample(terark::fstring user_key) {
+  std::unique_lock<std::mutex> lock(sample_mutex_);
+  if (!samples_.empty() && samples_sorted_ &&
+      terark::fstring(samples_.back()) > user_key) {
+    samples_sorted_ = false;
+  }
+  samples_.emplace_back(user_key.data(), user_key.size());
+  if (samples_.size() < kMaxSamples) {
+    return;
+  }
+  if (!samples_sorted_) {
+    std::sort(samples_.begin(), samples_.end());
+    samples_sorted_ = true;
+  }
+  for (size_t i = 1; i < samples_.size() / 2; ++i) {
+    samples_[i].swap(samples_[i * 2]);
+  }
+  samples_.resize(samples_.size() / 2);
+  sample_interval_.store(sample_interval_.load(std::memory_order_relaxed) * 2,
+                         std::memory_order_relaxed);
+}
+
+uint64_t PatriciaTrieRep::ApproximateNumEntries(const Slice& start_ikey,
+                                                const Slice& end_ikey) {
+  assert(start_ikey.size() >= 8 && end_ikey.size() >= 8);
+  std::string start(start_ikey.data(), start_ikey.size() - 8);
+  std::string end(end_ikey.data(), end_ikey.size() - 8);
+  if (end <= start) {
+    return 0;
+  }
+  std::unique_lock<std::mutex> lock(sample_mutex_);
+  if (!samples_sorted_) {
+    std::sort(samples_.begin(), samples_.end());
+    samples_sorted_ = true;
+  }
+  auto first = std::lower_bound(samples_.begin(), samples_.end(), start);
+  auto last = std::lower_bound(first, samples_.end(), end);
+  return uint64_t(last - first) *
+         sample_interval_.load(std::memory_order_relaxed);
+}
+
 bool PatriciaTrieRep::Contains(const Slice& internal_key) const {
   terark::fstring find_key(internal_key.data(), internal_key.size() - 8);
   uint64_t tag = ExtractInternalKeyFooter(internal_key);
-  for (size_t i = 0; i < trie_vec_size_; ++i) {
-    auto* trie = trie_vec_[i];
+  size_t pin = PinTries();
+  TERARK_SCOPE_EXIT(UnpinTries(pin));
+  auto* group = current_.load();
+  for (size_t i = 0; i < group->size; ++i) {
+    auto* trie = group->tries[i];
     auto token = trie->tls_reader_token();
     token->acquire(trie);
     if (trie->lookup(find_key, token)) {
@@ -215,16 +431,20 @@ void PatriciaTrieRep::Get(const LookupKey& k, void* callback_args,
                          value);
   };
 
+  size_t pin = PinTries();
+  TERARK_SCOPE_EXIT(UnpinTries(pin));
+  auto* group = current_.load();
+
   valvec<HeapItem>& heap = tls_ctx.heap;
   assert(heap.empty());
-  heap.reserve(trie_vec_size_);
+  heap.reserve(group->size);
 
   // initialization
-  for (size_t i = 0; i < trie_vec_size_; ++i) {
-    auto* trie = trie_vec_[i];
+  for (size_t i = 0; i < group->size; ++i) {
+    auto* trie = group->tries[i];
     auto token = trie->tls_reader_token();
     token->acquire(trie);
-    if (trie_vec_[i]->lookup(find_key, token)) {
+    if (trie->lookup(find_key, token)) {
       uint32_t loc = token->value_of<uint32_t>();
       auto vector = (details::tag_vector_t*)trie->mem_get(loc);
       uint64_t size_loc = vector->size_loc.load(std::memory_order_relaxed);
@@ -276,17 +496,32 @@ void PatriciaTrieRep::Get(const LookupKey& k, void* callback_args,
 }
 
 MemTableRep::Iterator* PatriciaTrieRep::GetIterator(Arena* arena) {
+  return NewIterator(arena, nullptr);
+}
+
+MemTableRep::Iterator* PatriciaTrieRep::GetDynamicPrefixIterator(
+    Arena* arena) {
+  return NewIterator(arena, prefix_extractor_);
+}
+
+MemTableRep::Iterator* PatriciaTrieRep::NewIterator(
+    Arena* arena, const SliceTransform* prefix_extractor) {
+  std::shared_ptr<details::trie_group_t> group;
+  {
+    std::unique_lock<std::mutex> lock(group_mutex_);
+    group = group_;
+  }
   MemTableRep::Iterator* iter;
-  if (trie_vec_size_ == 1) {
+  if (group->size == 1) {
     typedef PatriciaRepIterator<false> iter_t;
     iter = arena ? new (arena->AllocateAligned(sizeof(iter_t)))
-                       iter_t(trie_vec_, 1)
-                 : new iter_t(trie_vec_, 1);
+                       iter_t(std::move(group), prefix_extractor)
+                 : new iter_t(std::move(group), prefix_extractor);
   } else {
     typedef PatriciaRepIterator<true> iter_t;
     iter = arena ? new (arena->AllocateAligned(sizeof(iter_t)))
-                       iter_t(trie_vec_, trie_vec_size_)
-                 : new iter_t(trie_vec_, trie_vec_size_);
+                       iter_t(std::move(group), prefix_extractor)
+                 : new iter_t(std::move(group), prefix_extractor);
   }
   return iter;
 }
@@ -299,102 +534,10 @@ bool PatriciaTrieRep::InsertKeyValue(const Slice& internal_key,
   // prepare key
   terark::fstring key(internal_key.data(), internal_key.size() - 8);
   auto tag = ExtractInternalKeyFooter(internal_key);
-  // lambda impl fn for insert
-  auto fn_insert_impl = [&](MainPatricia* trie) {
-    auto token = trie->tls_writer_token_nn<MemWriterToken>();
-    assert(dynamic_cast<MemWriterToken*>(token) != nullptr);
-    token->reset_tag_value(tag, value);
-    token->acquire(trie);
-    TERARK_SCOPE_EXIT(token->idle());
-    uint32_t tmp_loc = UINT32_MAX;
-    if (!token->insert(key, &tmp_loc)) {
-      size_t vector_loc = token->value_of<uint32_t>();
-      auto* vector = (details::tag_vector_t*)trie->mem_get(vector_loc);
-      size_t value_size = VarintLength(value.size()) + value.size();
-      size_t value_loc = trie->mem_alloc(value_size);
-      if (value_loc == MainPatricia::mem_alloc_fail) {
-        return details::InsertResult::Fail;
-      }
-      auto valptr = (char*)trie->mem_get(value_loc);
-      valptr = EncodeVarint32(valptr, (uint32_t)value.size());
-      memcpy(valptr, value.data(), value.size());
-      uint64_t size_loc;
-      // row lock: infinite spin on LOCK_FLAG
-      do {
-        do {
-          size_loc = vector->size_loc.load(std::memory_order_relaxed);
-        } while (size_loc & LOCK_FLAG);
-        size_loc =
-            vector->size_loc.fetch_or(LOCK_FLAG, std::memory_order_acq_rel);
-      } while (size_loc & LOCK_FLAG);
-      auto* data =
-          (details::tag_vector_t::data_t*)trie->mem_get((uint32_t)size_loc);
-      uint32_t size = (size_loc >> 32);
-      assert(size > 0);
-      size_t insert_pos = terark::lower_bound_ex_n(
-          data, 0, size, tag >> 8,
-          [](details::tag_vector_t::data_t& item) { return item.tag >> 8; });
-      if (insert_pos < size && (tag >> 8) == (data[insert_pos].tag >> 8)) {
-        vector->size_loc.store(size_loc, std::memory_order_release);
-        trie->mem_free(value_loc, value_size);
-        return details::InsertResult::Duplicated;
-      }
-      if (!details::tag_vector_t::full(size) && insert_pos == size) {
-        data[size].loc = (uint32_t)value_loc;
-        data[size].tag = tag;
-
-        // update 'size' and unlock
-        vector->size_loc.store(size_loc + (1ULL << 32),
-                               std::memory_order_release);
-        return details::InsertResult::Success;
-      }
-      size_t old_data_cap =
-          sizeof(details::tag_vector_t::data_t) *
-          (1u << (32 - details::tag_vector_t::full(size) - fast_clz32(size)));
-      size_t cow_data_loc = trie->mem_alloc(
-          old_data_cap * (1 + details::tag_vector_t::full(size)));
-      if (cow_data_loc == MainPatricia::mem_alloc_fail) {
-        vector->size_loc.store(size_loc, std::memory_order_release);
-        trie->mem_free(value_loc, value_size);
-        return details::InsertResult::Fail;
-      }
-      auto* cow_data =
-          (details::tag_vector_t::data_t*)trie->mem_get(cow_data_loc);
-      memcpy(cow_data, data,
-             sizeof(details::tag_vector_t::data_t) * insert_pos);
-      cow_data[insert_pos].loc = (uint32_t)value_loc;
-      cow_data[insert_pos].tag = tag;
-      memcpy(cow_data + insert_pos + 1, data + insert_pos,
-             sizeof(details::tag_vector_t::data_t) * (size - insert_pos));
-      vector->size_loc.store((uint64_t(size + 1) << 32) + cow_data_loc,
-                             std::memory_order_release);
-      trie->mem_lazy_free((uint32_t)size_loc, old_data_cap);
-      return details::InsertResult::Success;
-    } else if (token->value() != nullptr) {
-      const auto token_value_loc = token->value_of<uint32_t>();
-      TERARK_VERIFY(token_value_loc == tmp_loc);
-      return details::InsertResult::Success;
-    } else
-      return details::InsertResult::Fail;
-  };
-
-  auto fn_create_new_trie = [&]() {
-    if (write_buffer_size_ > 0) {
-      if (write_buffer_size_ < size_limit_) write_buffer_size_ *= 2;
-      if (write_buffer_size_ > size_limit_) write_buffer_size_ = size_limit_;
-      size_t bound = key.size() + VarintLength(value.size()) + value.size();
-      if (size_t(write_buffer_size_) < bound)
-        write_buffer_size_ = std::min(bound + (16 << 20), size_t(-1) >> 1);
-    }
-    trie_vec_[trie_vec_size_] = new MainPatricia(
-        sizeof(uint32_t), write_buffer_size_, concurrent_level_);
-    trie_vec_size_++;
-  };
-  // tool lambda fn end
-  // function start
+  auto& group = *group_;
   if (handle_duplicate_) {
-    for (size_t i = 0; i < trie_vec_size_; ++i) {
-      auto* trie = trie_vec_[i];
+    for (size_t i = 0; i < group.size; ++i) {
+      auto* trie = group.tries[i];
       auto token = trie->tls_reader_token();
       token->acquire(trie);
       TERARK_SCOPE_EXIT(token->idle());
@@ -412,25 +555,92 @@ bool PatriciaTrieRep::InsertKeyValue(const Slice& internal_key,
   }
   details::InsertResult insert_result = details::InsertResult::Fail;
   for (;;) {
-    size_t curr_trie_vec_size = trie_vec_size_;
-    insert_result = fn_insert_impl(trie_vec_[curr_trie_vec_size - 1]);
+    size_t curr_trie_vec_size = group.size.load(std::memory_order_acquire);
+    auto* trie = group.tries[curr_trie_vec_size - 1];
+    insert_result = InsertToTrie(trie, key, tag, value);
     if (insert_result == details::InsertResult::Duplicated) {
       return !handle_duplicate_;
     }
     if (insert_result == details::InsertResult::Success) {
+      if (trie->mem_size_inline() >=
+          watermark_.load(std::memory_order_relaxed)) {
+        PrepareSpareTrie();
+      }
       break;
     } else {
       assert(insert_result == details::InsertResult::Fail);
-      std::unique_lock<std::mutex> lock(mutex_);
-      if (curr_trie_vec_size == trie_vec_size_) {
-        fn_create_new_trie();
-      }
+      RotateTrie(curr_trie_vec_size,
+                 key.size() + VarintLength(value.size()) + value.size());
     }
   }
   assert(insert_result == details::InsertResult::Success);
+  uint64_t n = num_inserted_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (n % sample_interval_.load(std::memory_order_relaxed) == 0) {
+    AddSample(key);
+  }
   return true;
 }
 
+MainPatricia* PatriciaTrieRep::NewTrie(size_t bound, size_t* capacity) {
+  int64_t size = write_buffer_size_.load(std::memory_order_relaxed);
+  if (size > 0) {
+    if (size < size_limit_) size *= 2;
+    if (size > size_limit_) size = size_limit_;
+    if (size_t(size) < bound)
+      size = std::min(bound + (16 << 20), size_t(-1) >> 1);
+    write_buffer_size_.store(size, std::memory_order_relaxed);
+  }
+  *capacity = size > 0 ? size_t(size) : size_t(-1);
+  return new MainPatricia(sizeof(uint32_t), size, concurrent_level_);
+}
+
+void PatriciaTrieRep::PrepareSpareTrie() {
+  // spare_building_ stays set until RotateTrie() consumed the spare, which
+  // also guards spare_capacity_
+  if (spare_building_.load(std::memory_order_relaxed) ||
+      spare_building_.exchange(true)) {
+    return;
+  }
+  MainPatricia* trie = NewTrie(0, &spare_capacity_);
+  spare_.store(trie, std::memory_order_release);
+}
+
+void PatriciaTrieRep::RotateTrie(size_t full_size, size_t bound) {
+  auto& group = *group_;
+  size_t expected = full_size;
+  if (!rotate_slot_.compare_exchange_strong(expected, full_size + 1)) {
+    // Another insert claimed the slot, wait for it to store the trie
+    while (group.size.load(std::memory_order_acquire) == full_size) {
+      std::this_thread::yield();
+    }
+    return;
+  }
+  TERARK_VERIFY(full_size < group.tries.size());
+  size_t capacity = 0;
+  MainPatricia* trie = spare_.exchange(nullptr, std::memory_order_acquire);
+  bool from_spare = trie != nullptr;
+  if (from_spare) {
+    capacity = spare_capacity_;
+    if (capacity < bound) {
+      // Too small for this entry
+      delete trie;
+      trie = nullptr;
+    }
+  }
+  if (trie == nullptr) {
+    // The spare is not ready yet, this is the only case an insert waits for
+    // a trie to be allocated
+    trie = NewTrie(bound, &capacity);
+  }
+  watermark_.store(capacity == size_t(-1) ? capacity : capacity / 4 * 3,
+                   std::memory_order_relaxed);
+  group.tries[full_size] = trie;
+  group.size.store(full_size + 1, std::memory_order_release);
+  if (from_spare) {
+    spare_building_.store(false);
+  }
+}
+
 template <bool heap_mode>
 typename PatriciaRepIterator<heap_mode>::HeapItem::VectorData
 PatriciaRepIterator<heap_mode>::HeapItem::GetVector() {
@@ -588,10 +798,16 @@ void PatriciaRepIterator<heap_mode>::Rebuild(func_t&& callback_func) {
 }
 
 template <bool heap_mode>
-PatriciaRepIterator<heap_mode>::PatriciaRepIterator(details::tries_t& tries,
-                                                    size_t tries_size)
-    : direction_(0) {
-  assert(tries.size() > 0);
+PatriciaRepIterator<heap_mode>::PatriciaRepIterator(
+    std::shared_ptr<details::trie_group_t> group,
+    const SliceTransform* prefix_extractor)
+    : group_(std::move(group)),
+      direction_(0),
+      prefix_extractor_(prefix_extractor),
+      prefix_bounded_(false) {
+  auto& tries = group_->tries;
+  size_t tries_size = group_->size;
+  assert(tries_size > 0);
   if (heap_mode) {
     valvec<HeapItem> hitem(tries.size(), terark::valvec_reserve());
     valvec<HeapItem*> hptrs(tries.size(), terark::valvec_reserve());
@@ -620,6 +836,17 @@ PatriciaRepIterator<heap_mode>::~PatriciaRepIterator() {
   }
 }
 
+template <bool heap_mode>
+void PatriciaRepIterator<heap_mode>::SetPrefix(terark::fstring find_key) {
+  Slice user_key(find_key.data(), find_key.size());
+  prefix_bounded_ =
+      prefix_extractor_ != nullptr && prefix_extractor_->InDomain(user_key);
+  if (prefix_bounded_) {
+    Slice prefix = prefix_extractor_->Transform(user_key);
+    prefix_.assign(prefix.data(), prefix.size());
+  }
+}
+
 template <bool heap_mode>
 const char* PatriciaRepIterator<heap_mode>::value() const {
   assert(direction_ != 0);
@@ -637,7 +864,7 @@ void PatriciaRepIterator<heap_mode>::Next() {
       auto tag = ExtractInternalKeyFooter(buffer_);
       Rebuild<1>([&](HeapItem* item) {
         item->Seek(find_key, tag);
-        return item->index != size_t(-1);
+        return InBound(item);
       });
       if (multi_.size == 0) {
         direction_ = 0;
@@ -645,7 +872,7 @@ void PatriciaRepIterator<heap_mode>::Next() {
       }
     }
     multi_.heap[0]->Next();
-    if (multi_.heap[0]->index == size_t(-1)) {
+    if (!InBound(multi_.heap[0])) {
       std::pop_heap(multi_.heap, multi_.heap + multi_.size, ForwardComp());
       if (--multi_.size == 0) {
         direction_ = 0;
@@ -656,7 +883,7 @@ void PatriciaRepIterator<heap_mode>::Next() {
     }
   } else {
     single_.Next();
-    if (single_.index == size_t(-1)) {
+    if (!InBound(&single_)) {
       direction_ = 0;
       return;
     }
@@ -672,7 +899,7 @@ void PatriciaRepIterator<heap_mode>::Prev() {
       auto tag = ExtractInternalKeyFooter(buffer_);
       Rebuild<-1>([&](HeapItem* item) {
         item->SeekForPrev(find_key, tag);
-        return item->index != size_t(-1);
+        return InBound(item);
       });
       if (multi_.size == 0) {
         direction_ = 0;
@@ -680,7 +907,7 @@ void PatriciaRepIterator<heap_mode>::Prev() {
       }
     }
     multi_.heap[0]->Prev();
-    if (multi_.heap[0]->index == size_t(-1)) {
+    if (!InBound(multi_.heap[0])) {
       std::pop_heap(multi_.heap, multi_.heap + multi_.size, BackwardComp());
       if (--multi_.size == 0) {
         direction_ = 0;
@@ -691,7 +918,7 @@ void PatriciaRepIterator<heap_mode>::Prev() {
     }
   } else {
     single_.Prev();
-    if (single_.index == size_t(-1)) {
+    if (!InBound(&single_)) {
       direction_ = 0;
       return;
     }
@@ -712,11 +939,12 @@ void PatriciaRepIterator<heap_mode>::Seek(const Slice& user_key,
     find_key = terark::fstring(user_key.data(), user_key.size() - 8);
     tag = ExtractInternalKeyFooter(user_key);
   }
+  SetPrefix(find_key);
 
   if (heap_mode) {
     Rebuild<1>([&](HeapItem* item) {
       item->Seek(find_key, tag);
-      return item->index != size_t(-1);
+      return InBound(item);
     });
     if (multi_.size == 0) {
       direction_ = 0;
@@ -724,7 +952,7 @@ void PatriciaRepIterator<heap_mode>::Seek(const Slice& user_key,
     }
   } else {
     single_.Seek(find_key, tag);
-    if (single_.index == size_t(-1)) {
+    if (!InBound(&single_)) {
       direction_ = 0;
       return;
     }
@@ -746,11 +974,12 @@ void PatriciaRepIterator<heap_mode>::SeekForPrev(const Slice& user_key,
     find_key = terark::fstring(user_key.data(), user_key.size() - 8);
     tag = ExtractInternalKeyFooter(user_key);
   }
+  SetPrefix(find_key);
 
   if (heap_mode) {
     Rebuild<-1>([&](HeapItem* item) {
       item->SeekForPrev(find_key, tag);
-      return item->index != size_t(-1);
+      return InBound(item);
     });
     if (multi_.size == 0) {
       direction_ = 0;
@@ -758,7 +987,7 @@ void PatriciaRepIterator<heap_mode>::SeekForPrev(const Slice& user_key,
     }
   } else {
     single_.SeekForPrev(find_key, tag);
-    if (single_.index == size_t(-1)) {
+    if (!InBound(&single_)) {
       direction_ = 0;
       return;
     }
@@ -769,10 +998,11 @@ void PatriciaRepIterator<heap_mode>::SeekForPrev(const Slice& user_key,
 
 template <bool heap_mode>
 void PatriciaRepIterator<heap_mode>::SeekToFirst() {
+  prefix_bounded_ = false;
   if (heap_mode) {
     Rebuild<1>([&](HeapItem* item) {
       item->SeekToFirst();
-      return item->index != size_t(-1);
+      return InBound(item);
     });
     if (multi_.size == 0) {
       direction_ = 0;
@@ -791,10 +1021,11 @@ void PatriciaRepIterator<heap_mode>::SeekToFirst() {
 
 template <bool heap_mode>
 void PatriciaRepIterator<heap_mode>::SeekToLast() {
+  prefix_bounded_ = false;
   if (heap_mode) {
     Rebuild<-1>([&](HeapItem* item) {
       item->SeekToLast();
-      return item->index != size_t(-1);
+      return InBound(item);
     });
     if (multi_.size == 0) {
       direction_ = 0;
@@ -817,7 +1048,7 @@ MemTableRep* PatriciaTrieRepFactory::CreateMemTableRep(
   if (IsForwardBytewiseComparator(key_cmp.icomparator()->user_comparator())) {
     return new PatriciaTrieRep(concurrent_type_, patricia_key_type_,
                                needs_dup_key_check, write_buffer_size_,
-                               allocator);
+                               allocator, transform);
   } else {
     return fallback_->CreateMemTableRep(key_cmp, needs_dup_key_check, allocator,
                                         transform, logger);
@@ -831,7 +1062,8 @@ MemTableRep* PatriciaTrieRepFactory::CreateMemTableRep(
   if (IsForwardBytewiseComparator(key_cmp.icomparator()->user_comparator())) {
     return new PatriciaTrieRep(concurrent_type_, patricia_key_type_,
                                needs_dup_key_check, write_buffer_size_,
-                               allocator);
+                               allocator,
+                               mutable_cf_options.prefix_extractor.get());
   } else {
     return fallback_->CreateMemTableRep(key_cmp, needs_dup_key_check, allocator,
                                         ioptions, mutable_cf_options,
@@ -9,6 +9,8 @@
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -16,6 +18,7 @@
 #include "port/port.h"
 #include "rocksdb/convenience.h"
 #include "rocksdb/memtablerep.h"
+#include "rocksdb/slice_transform.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/terark_zip_internal.h"
 #include "terark/fsa/cspptrie.inl"
@@ -66,6 +69,15 @@ struct tag_vector_t {
 };
 #pragma pack(pop)
 
+// Tries owned by a rep. Iterators share the ownership, so a group replaced
+// by the merge of an immutable rep lives until its last iterator is gone.
+struct trie_group_t : boost::noncopyable {
+  tries_t tries;
+  std::atomic<size_t> size{0};
+
+  ~trie_group_t();
+};
+
 }  // namespace terark_memtable_details
 
 // Patricia trie memtable rep
@@ -74,19 +86,69 @@ class PatriciaTrieRep : public MemTableRep {
   terark_memtable_details::PatriciaKeyType patricia_key_type_;
   bool handle_duplicate_;
   std::atomic_bool immutable_;
-  terark_memtable_details::tries_t trie_vec_;
-  size_t trie_vec_size_;
+  std::shared_ptr<terark_memtable_details::trie_group_t> group_;
   size_t overhead_;  // this overhead is for new memtable size check
-  int64_t write_buffer_size_;
+  std::atomic<int64_t> write_buffer_size_;
   static const int64_t size_limit_ = 1LL << 30;
-  std::mutex mutex_;
+  // Bounds the scans of GetDynamicPrefixIterator(), nullptr if none
+  const SliceTransform* prefix_extractor_;
+
+  // Trie rotation is lock free. The insert that takes the last trie past
+  // watermark_ allocates spare_, and the insert that first fails on a full
+  // trie claims the next slot through rotate_slot_ and publishes spare_ in
+  // it. Inserts losing that race only wait for the winner to store a
+  // pointer, they never wait for a trie to be allocated unless the last
+  // trie filled up before its spare was ready.
+  std::atomic<size_t> rotate_slot_;
+  std::atomic<size_t> watermark_;
+  std::atomic_bool spare_building_;
+  std::atomic<terark::MainPatricia*> spare_;
+  size_t spare_capacity_;
+
+  terark::MainPatricia* NewTrie(size_t bound, size_t* capacity);
+  void PrepareSpareTrie();
+  void RotateTrie(size_t full_size, size_t bound);
+
+  // Fence keys for ApproximateNumEntries(): every sample_interval_-th
+  // successful insert records its user key. Once kMaxSamples keys are held
+  // every other one is dropped and the interval doubles, so the samples stay
+  // an evenly thinned copy of the key distribution at bounded memory.
+  static const size_t kMaxSamples = 1 << 16;
+  std::atomic<uint64_t> num_inserted_;
+  std::atomic<uint64_t> sample_interval_;
+  std::mutex sample_mutex_;
+  std::vector<std::string> samples_;
+  bool samples_sorted_;
+
+  void AddSample(terark::fstring user_key);
+
+  // MarkReadOnly() merges the tries of the rep into a single one on
+  // merge_thread_, so flush and reads of the immutable memtable no longer
+  // pay a heap merge. Readers find the live group through current_.
+  // Get(), Contains() and ApproximateMemoryUsage() pin the group with
+  // PinTries(): pins taken before merged_ is set are counted in pins_[0],
+  // which the merge drains before the original group may be freed.
+  std::atomic<terark_memtable_details::trie_group_t*> current_;
+  std::atomic_bool merged_;
+  std::atomic_bool merge_cancel_;
+  mutable std::atomic<size_t> pins_[2];
+  mutable std::mutex group_mutex_;
+  std::thread merge_thread_;
+
+  void MergeTries();
+  size_t PinTries() const;
+  void UnpinTries(size_t pin) const { pins_[pin].fetch_sub(1); }
+
+  MemTableRep::Iterator* NewIterator(Arena* arena,
+                                     const SliceTransform* prefix_extractor);
 
  public:
   // Create a new patricia trie memtable rep with following options
   PatriciaTrieRep(terark_memtable_details::ConcurrentType concurrent_type,
                   terark_memtable_details::PatriciaKeyType patricia_key_type,
                   bool handle_duplicate, intptr_t write_buffer_size,
-                  Allocator* allocator);
+                  Allocator* allocator,
+                  const SliceTransform* prefix_extractor = nullptr);
 
   ~PatriciaTrieRep();
 
@@ -94,11 +156,10 @@ class PatriciaTrieRep : public MemTableRep {
   // all patricia trie handled by this rep.
   virtual size_t ApproximateMemoryUsage() override;
 
-  // This approximition is not supported, return 0 instead.
-  virtual uint64_t ApproximateNumEntries(const Slice& /*start_ikey*/,
-                                         const Slice& /*end_ikey*/) override {
-    return 0;
-  }
+  // Return approximate number of entries whose user key is in
+  // [start_ikey, end_ikey), estimated from the sampled fence keys.
+  virtual uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                         const Slice& end_ikey) override;
 
   // Return true if this rep contains querying key.
   virtual bool Contains(const Slice& internal_key) const override;
@@ -111,6 +172,11 @@ class PatriciaTrieRep : public MemTableRep {
   // Return iterator of this rep
   virtual MemTableRep::Iterator* GetIterator(Arena* arena) override;
 
+  // Return iterator of this rep for the prefix seeks, which ends at the
+  // prefix of the key sought
+  virtual MemTableRep::Iterator* GetDynamicPrefixIterator(
+      Arena* arena) override;
+
   // Insert with keyhandle is not supported.
   virtual void Insert(KeyHandle /*handle*/) override { assert(false); }
 
@@ -170,8 +236,25 @@ class PatriciaRepIterator : public MemTableRep::Iterator, boost::noncopyable {
     HeapItem single_;
   };
 
+  std::shared_ptr<terark_memtable_details::trie_group_t> group_;
   std::string buffer_;
   int direction_;
+  // With a prefix extractor, the seeks to a key in its domain bound the
+  // iteration to the prefix of the key: a trie whose entries past the key
+  // are of other prefixes leaves the heap right away, and an entry leaves
+  // it as soon as it steps out of the prefix.
+  const SliceTransform* prefix_extractor_;
+  bool prefix_bounded_;
+  std::string prefix_;
+
+  // Bound the iteration to the prefix of `find_key` if in the domain
+  void SetPrefix(terark::fstring find_key);
+
+  // Whether `item` is positioned at an entry within the bound
+  bool InBound(const HeapItem* item) const {
+    return item->index != size_t(-1) &&
+           (!prefix_bounded_ || item->handle->word().startsWith(prefix_));
+  }
 
   // Return pointer of current heap item.
   const HeapItem* Current() const {
@@ -210,8 +293,9 @@ class PatriciaRepIterator : public MemTableRep::Iterator, boost::noncopyable {
   void Rebuild(func_t&& callback_func);
 
  public:
-  PatriciaRepIterator(terark_memtable_details::tries_t& tries,
-                      size_t tries_size);
+  explicit PatriciaRepIterator(
+      std::shared_ptr<terark_memtable_details::trie_group_t> group,
+      const SliceTransform* prefix_extractor = nullptr);
 
   virtual ~PatriciaRepIterator();
 
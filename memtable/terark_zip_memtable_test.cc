@@ -53,6 +53,174 @@ TEST_F(TerarkZipMemtableTest, SimpleTest) {
   ASSERT_FALSE(res);
 }
 
+TEST_F(TerarkZipMemtableTest, ApproximateStatsTest) {
+  std::shared_ptr<MemTable> mem_;
+  Options options;
+  options.memtable_factory =
+      std::shared_ptr<MemTableRepFactory>(NewPatriciaTrieRepFactory());
+
+  InternalKeyComparator cmp(BytewiseComparator());
+  ImmutableCFOptions ioptions(options);
+  WriteBufferManager wb(options.db_write_buffer_size);
+
+  mem_ = std::shared_ptr<MemTable>(
+      new MemTable(cmp, ioptions, MutableCFOptions(options),
+                   /* needs_dup_key_check */ true, &wb, kMaxSequenceNumber,
+                   0 /* column_family_id */));
+
+  const int kNumKeys = 10000;
+  char buf[16];
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(buf, sizeof(buf), "key%05d", i);
+    ASSERT_TRUE(mem_->Add(i + 1, kTypeValue, buf, "value"));
+  }
+  auto ikey = [&](int i) {
+    snprintf(buf, sizeof(buf), "key%05d", i);
+    return InternalKey(buf, kMaxSequenceNumber, kValueTypeForSeek);
+  };
+  InternalKey start = ikey(kNumKeys / 4);
+  InternalKey end = ikey(kNumKeys * 3 / 4);
+  auto stats = mem_->ApproximateStats(start.Encode(), end.Encode());
+  ASSERT_GT(stats.count, kNumKeys / 2 * 9 / 10);
+  ASSERT_LT(stats.count, kNumKeys / 2 * 11 / 10);
+  ASSERT_GT(stats.size, 0);
+
+  // Empty and reversed ranges
+  stats = mem_->ApproximateStats(end.Encode(), end.Encode());
+  ASSERT_EQ(0, stats.count);
+  stats = mem_->ApproximateStats(end.Encode(), start.Encode());
+  ASSERT_EQ(0, stats.count);
+  InternalKey past("zzz", kMaxSequenceNumber, kValueTypeForSeek);
+  InternalKey past_end("zzzz", kMaxSequenceNumber, kValueTypeForSeek);
+  stats = mem_->ApproximateStats(past.Encode(), past_end.Encode());
+  ASSERT_EQ(0, stats.count);
+}
+
+TEST_F(TerarkZipMemtableTest, MergeOnReadOnlyTest) {
+  // A small write buffer spreads the entries over several tries
+  PatriciaTrieRep rep(terark_memtable_details::ConcurrentType::Native,
+                      terark_memtable_details::PatriciaKeyType::UserKey,
+                      /* handle_duplicate */ true, 1 << 20, nullptr);
+  const int kNumKeys = 20000;
+  std::string value(200, 'v');
+  char buf[16];
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(buf, sizeof(buf), "key%05d", i);
+    // Two versions for every other key
+    for (int v = 0; v < 1 + i % 2; ++v) {
+      InternalKey ikey(buf, i * 2 + v + 1, kTypeValue);
+      ASSERT_TRUE(rep.InsertKeyValue(ikey.Encode(), value + buf));
+    }
+  }
+  rep.MarkReadOnly();
+
+  // Reads race with the background merge
+  struct Arg {
+    Slice key;
+    std::string value;
+  } arg;
+  auto callback = [](void* a, const Slice& key, const char* v) {
+    auto* p = static_cast<Arg*>(a);
+    p->key = key;
+    p->value = GetLengthPrefixedSlice(v).ToString();
+    return false;
+  };
+  for (int i = 0; i < kNumKeys; i += 97) {
+    snprintf(buf, sizeof(buf), "key%05d", i);
+    arg.value.clear();
+    rep.Get(LookupKey(buf, kMaxSequenceNumber), &arg, callback);
+    ASSERT_EQ(value + buf, arg.value);
+  }
+
+  InternalKeyComparator cmp(BytewiseComparator());
+  std::unique_ptr<MemTableRep::Iterator> iter(rep.GetIterator(nullptr));
+  int count = 0;
+  std::string prev;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    std::string key = iter->key().ToString();
+    ASSERT_TRUE(prev.empty() || cmp.Compare(prev, key) < 0);
+    prev = std::move(key);
+    ++count;
+  }
+  ASSERT_EQ(kNumKeys + kNumKeys / 2, count);
+}
+
+TEST_F(TerarkZipMemtableTest, PrefixSeekTest) {
+  std::unique_ptr<const SliceTransform> prefix_extractor(
+      NewFixedPrefixTransform(4));
+  // A small write buffer spreads every prefix over several tries
+  PatriciaTrieRep rep(terark_memtable_details::ConcurrentType::Native,
+                      terark_memtable_details::PatriciaKeyType::UserKey,
+                      /* handle_duplicate */ true, 1 << 20, nullptr,
+                      prefix_extractor.get());
+  const int kNumPrefixes = 20;
+  const int kKeysPerPrefix = 1000;
+  std::string value(200, 'v');
+  char buf[16];
+  for (int i = 0; i < kKeysPerPrefix; ++i) {
+    for (int p = 0; p < kNumPrefixes; ++p) {
+      snprintf(buf, sizeof(buf), "p%03d%05d", p, i);
+      InternalKey ikey(buf, 1, kTypeValue);
+      ASSERT_TRUE(rep.InsertKeyValue(ikey.Encode(), value));
+    }
+  }
+
+  InternalKey target("p007", kMaxSequenceNumber, kValueTypeForSeek);
+  InternalKey last("p007~", kMaxSequenceNumber, kValueTypeForSeek);
+  std::unique_ptr<MemTableRep::Iterator> iter(
+      rep.GetDynamicPrefixIterator(nullptr));
+  int count = 0;
+  for (iter->Seek(target.Encode(), nullptr); iter->Valid(); iter->Next()) {
+    ASSERT_TRUE(ExtractUserKey(iter->key()).starts_with("p007"));
+    ++count;
+  }
+  ASSERT_EQ(kKeysPerPrefix, count);
+  count = 0;
+  for (iter->SeekForPrev(last.Encode(), nullptr); iter->Valid();
+       iter->Prev()) {
+    ASSERT_TRUE(ExtractUserKey(iter->key()).starts_with("p007"));
+    ++count;
+  }
+  ASSERT_EQ(kKeysPerPrefix, count);
+
+  // The total order iterator goes on with the next prefixes
+  iter.reset(rep.GetIterator(nullptr));
+  count = 0;
+  for (iter->Seek(target.Encode(), nullptr); iter->Valid(); iter->Next()) {
+    ++count;
+  }
+  ASSERT_EQ((kNumPrefixes - 7) * kKeysPerPrefix, count);
+}
+
+TEST_F(TerarkZipMemtableTest, ConcurrentRotationTest) {
+  PatriciaTrieRep rep(terark_memtable_details::ConcurrentType::Native,
+                      terark_memtable_details::PatriciaKeyType::UserKey,
+                      /* handle_duplicate */ true, 1 << 20, nullptr);
+  const int kThreads = 8;
+  const int kKeysPerThread = 20000;
+  std::string value(100, 'v');
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      char buf[16];
+      for (int i = 0; i < kKeysPerThread; ++i) {
+        snprintf(buf, sizeof(buf), "key%02d%06d", t, i);
+        InternalKey ikey(buf, 1, kTypeValue);
+        ASSERT_TRUE(rep.InsertKeyValueConcurrently(ikey.Encode(), value));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::unique_ptr<MemTableRep::Iterator> iter(rep.GetIterator(nullptr));
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ++count;
+  }
+  ASSERT_EQ(kThreads * kKeysPerThread, count);
+}
+
 // Test multi-threading insertion
 // we ignore multithread question for row-ttl
 TEST_F(TerarkZipMemtableTest, MultiThreadingTest) {
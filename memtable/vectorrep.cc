@@ -16,6 +16,7 @@
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/arena.h"
+#include "util/core_local.h"
 #include "util/mutexlock.h"
 #include "util/string_util.h"
 
@@ -24,9 +25,55 @@ namespace {
 
 using namespace stl_wrappers;
 
+// The smallest run a thread of a parallel sort is given
+const size_t kMinParallelSortRun = 1 << 16;
+
+// Sorts runs of the bucket on up to sort_threads threads, then merges them
+// pairwise, the merges of a round running in parallel too
+void SortBucket(std::vector<const char*>* bucket,
+                const MemTableRep::KeyComparator& compare,
+                size_t sort_threads) {
+  Compare cmp(compare);
+  size_t runs = std::min(sort_threads, bucket->size() / kMinParallelSortRun);
+  if (runs <= 1) {
+    std::sort(bucket->begin(), bucket->end(), cmp);
+    return;
+  }
+  std::vector<size_t> bounds(runs + 1);
+  for (size_t i = 0; i <= runs; ++i) {
+    bounds[i] = bucket->size() * i / runs;
+  }
+  auto begin = bucket->begin();
+  std::vector<port::Thread> threads;
+  for (size_t i = 1; i < runs; ++i) {
+    threads.emplace_back([begin, &bounds, &cmp, i] {
+      std::sort(begin + bounds[i], begin + bounds[i + 1], cmp);
+    });
+  }
+  std::sort(begin, begin + bounds[1], cmp);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t width = 1; width < runs; width *= 2) {
+    threads.clear();
+    for (size_t i = 0; i + width < runs; i += 2 * width) {
+      auto first = begin + bounds[i];
+      auto middle = begin + bounds[i + width];
+      auto last = begin + bounds[std::min(i + 2 * width, runs)];
+      threads.emplace_back([first, middle, last, &cmp] {
+        std::inplace_merge(first, middle, last, cmp);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
 class VectorRep : public MemTableRep {
  public:
-  VectorRep(const KeyComparator& compare, Allocator* allocator, size_t count);
+  VectorRep(const KeyComparator& compare, Allocator* allocator, size_t count,
+            size_t sort_threads);
 
   // Insert key into the collection. (The caller will pack key and value into a
   // single buffer and pass that in as the parameter to Insert)
@@ -34,6 +81,11 @@ class VectorRep : public MemTableRep {
   // collection.
   virtual void Insert(KeyHandle handle) override;
 
+  // The writers append to the buffer of their core
+  virtual void InsertConcurrently(KeyHandle handle) override {
+    Insert(handle);
+  }
+
   // Returns true iff an entry that compares equal to key is in the collection.
   virtual bool Contains(const Slice& internal_key) const override;
 
@@ -105,18 +157,37 @@ class VectorRep : public MemTableRep {
  private:
   friend class Iterator;
   typedef std::vector<const char*> Bucket;
+
+  // The keys appended on a core, moved to bucket_ by MarkReadOnly()
+  struct AppendBuffer {
+    char padding[40] ROCKSDB_FIELD_UNUSED;
+    SpinMutex mutex;
+    Bucket keys;
+    // Read without the mutex by ApproximateMemoryUsage()
+    std::atomic<size_t> size;
+
+    AppendBuffer() : size(0) {}
+  };
+
+  // A copy of the keys of a memtable still written to
+  std::shared_ptr<Bucket> CopyMutableBucket() const;
+
   std::shared_ptr<Bucket> bucket_;
+  CoreLocalArray<AppendBuffer> appends_;
   mutable port::RWMutex rwlock_;
   bool immutable_;
   bool sorted_;
   const KeyComparator& compare_;
+  const size_t sort_threads_;
 };
 
 void VectorRep::Insert(KeyHandle handle) {
   auto* key = static_cast<char*>(handle);
-  WriteLock l(&rwlock_);
   assert(!immutable_);
-  bucket_->push_back(key);
+  AppendBuffer* buffer = appends_.Access();
+  std::lock_guard<SpinMutex> l(buffer->mutex);
+  buffer->keys.push_back(key);
+  buffer->size.store(buffer->keys.size(), std::memory_order_relaxed);
 }
 
 // Returns true iff an entry that compares equal to key is in the collection.
@@ -124,29 +195,61 @@ bool VectorRep::Contains(const Slice& internal_key) const {
   std::string memtable_key;
   EncodeKey(&memtable_key, internal_key);
   ReadLock l(&rwlock_);
-  return std::find(bucket_->begin(), bucket_->end(), memtable_key.data()) !=
-         bucket_->end();
+  if (std::find(bucket_->begin(), bucket_->end(), memtable_key.data()) !=
+      bucket_->end()) {
+    return true;
+  }
+  for (size_t i = 0; i < appends_.Size(); ++i) {
+    AppendBuffer* buffer = appends_.AccessAtCore(i);
+    std::lock_guard<SpinMutex> buffer_lock(buffer->mutex);
+    if (std::find(buffer->keys.begin(), buffer->keys.end(),
+                  memtable_key.data()) != buffer->keys.end()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 void VectorRep::MarkReadOnly() {
   WriteLock l(&rwlock_);
+  // No more writers, the buffers are not locked
+  for (size_t i = 0; i < appends_.Size(); ++i) {
+    AppendBuffer* buffer = appends_.AccessAtCore(i);
+    bucket_->insert(bucket_->end(), buffer->keys.begin(), buffer->keys.end());
+    Bucket().swap(buffer->keys);
+  }
   immutable_ = true;
 }
 
 size_t VectorRep::ApproximateMemoryUsage() {
+  size_t size = 0;
+  for (size_t i = 0; i < appends_.Size(); ++i) {
+    size += appends_.AccessAtCore(i)->size.load(std::memory_order_relaxed);
+  }
   return sizeof(bucket_) + sizeof(*bucket_) +
-         bucket_->size() *
-             sizeof(
-                 std::remove_reference<decltype(*bucket_)>::type::value_type);
+         sizeof(AppendBuffer) * appends_.Size() +
+         size * sizeof(std::remove_reference<decltype(*bucket_)>::type::
+                           value_type);
+}
+
+std::shared_ptr<VectorRep::Bucket> VectorRep::CopyMutableBucket() const {
+  std::shared_ptr<Bucket> bucket(new Bucket());
+  for (size_t i = 0; i < appends_.Size(); ++i) {
+    AppendBuffer* buffer = appends_.AccessAtCore(i);
+    std::lock_guard<SpinMutex> l(buffer->mutex);
+    bucket->insert(bucket->end(), buffer->keys.begin(), buffer->keys.end());
+  }
+  return bucket;
 }
 
 VectorRep::VectorRep(const KeyComparator& compare, Allocator* allocator,
-                     size_t count)
+                     size_t count, size_t sort_threads)
     : MemTableRep(allocator),
       bucket_(new Bucket()),
       immutable_(false),
       sorted_(false),
-      compare_(compare) {
+      compare_(compare),
+      sort_threads_(std::max<size_t>(sort_threads, 1)) {
   bucket_.get()->reserve(count);
 }
 
@@ -164,7 +267,7 @@ void VectorRep::Iterator::DoSort() const {
   if (!sorted_ && vrep_ != nullptr) {
     WriteLock l(&vrep_->rwlock_);
     if (!vrep_->sorted_) {
-      std::sort(bucket_->begin(), bucket_->end(), Compare(compare_));
+      SortBucket(bucket_.get(), compare_, vrep_->sort_threads_);
       cit_ = bucket_->begin();
       vrep_->sorted_ = true;
     }
@@ -266,7 +369,7 @@ void VectorRep::Get(const LookupKey& k, void* callback_args,
     vector_rep = this;
   } else {
     vector_rep = nullptr;
-    bucket.reset(new Bucket(*bucket_));  // make a copy
+    bucket = CopyMutableBucket();
   }
   VectorRep::Iterator iter(vector_rep, immutable_ ? bucket_ : bucket, compare_);
   rwlock_.ReadUnlock();
@@ -291,8 +394,7 @@ MemTableRep::Iterator* VectorRep::GetIterator(Arena* arena) {
       return new (mem) Iterator(this, bucket_, compare_);
     }
   } else {
-    std::shared_ptr<Bucket> tmp;
-    tmp.reset(new Bucket(*bucket_));  // make a copy
+    std::shared_ptr<Bucket> tmp = CopyMutableBucket();
     if (arena == nullptr) {
       return new Iterator(nullptr, tmp, compare_);
     } else {
@@ -305,7 +407,7 @@ MemTableRep::Iterator* VectorRep::GetIterator(Arena* arena) {
 MemTableRep* VectorRepFactory::CreateMemTableRep(
     const MemTableRep::KeyComparator& compare, bool /*needs_dup_key_check*/,
     Allocator* allocator, const SliceTransform*, Logger* /*logger*/) {
-  return new VectorRep(compare, allocator, count_);
+  return new VectorRep(compare, allocator, count_, sort_threads_);
 }
 
 static MemTableRepFactory* NewVectorRepFactory(
@@ -315,7 +417,12 @@ static MemTableRepFactory* NewVectorRepFactory(
   if (options.end() != f) {
     count = ParseSizeT(f->second);
   }
-  return new VectorRepFactory(count);
+  size_t sort_threads = 1;
+  f = options.find("sort_threads");
+  if (options.end() != f) {
+    sort_threads = ParseSizeT(f->second);
+  }
+  return new VectorRepFactory(count, sort_threads);
 }
 
 ROCKSDB_REGISTER_MEM_TABLE("vector", VectorRepFactory);
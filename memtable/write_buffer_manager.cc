@@ -9,6 +9,7 @@
 
 #include "rocksdb/write_buffer_manager.h"
 
+#include <algorithm>
 #include <mutex>
 
 #include "rocksdb/terark_namespace.h"
@@ -53,10 +54,13 @@ struct WriteBufferManager::CacheRep {};
 
 WriteBufferManager::WriteBufferManager(size_t _buffer_size,
                                        std::shared_ptr<Cache> cache)
-    : buffer_size_(_buffer_size),
-      mutable_limit_(buffer_size_ * 7 / 8),
+    : enabled_(_buffer_size != 0),
+      buffer_size_(_buffer_size),
       memory_used_(0),
       memory_active_(0),
+      min_buffer_size_(0),
+      max_buffer_size_(0),
+      num_flush_requests_(0),
       cache_rep_(nullptr) {
 #ifndef ROCKSDB_LITE
   if (cache) {
@@ -97,6 +101,7 @@ void WriteBufferManager::ReserveMemWithCache(size_t mem) {
     cache_rep_->dummy_handles_.push_back(handle);
     cache_rep_->cache_allocated_size_ += kSizeDummyEntry;
   }
+  AdjustBufferSizeToCache();
 #else
   (void)mem;
 #endif  // ROCKSDB_LITE
@@ -126,8 +131,158 @@ void WriteBufferManager::FreeMemWithCache(size_t mem) {
     cache_rep_->dummy_handles_.pop_back();
     cache_rep_->cache_allocated_size_ -= kSizeDummyEntry;
   }
+  AdjustBufferSizeToCache();
 #else
   (void)mem;
 #endif  // ROCKSDB_LITE
 }
+
+void WriteBufferManager::SetBufferSizeRange(size_t min_buffer_size,
+                                            size_t max_buffer_size) {
+#ifndef ROCKSDB_LITE
+  if (cache_rep_ == nullptr || !enabled() || min_buffer_size == 0 ||
+      min_buffer_size > max_buffer_size) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(cache_rep_->cache_mutex_);
+  min_buffer_size_ = min_buffer_size;
+  max_buffer_size_ = max_buffer_size;
+  buffer_size_.store(std::min(std::max(buffer_size(), min_buffer_size),
+                              max_buffer_size),
+                     std::memory_order_relaxed);
+  AdjustBufferSizeToCache();
+#else
+  (void)min_buffer_size;
+  (void)max_buffer_size;
+#endif  // ROCKSDB_LITE
+}
+
+void WriteBufferManager::AdjustBufferSizeToCache() {
+#ifndef ROCKSDB_LITE
+  if (max_buffer_size_ == 0) {
+    return;
+  }
+  const Cache* cache = cache_rep_->cache_.get();
+  size_t capacity = cache->GetCapacity();
+  size_t usage = std::min(cache->GetUsage(), capacity);
+  size_t free_space = capacity - usage;
+  // Move by 1/16 of the range, but at least by one dummy entry, every time
+  // the cost in the cache changes
+  size_t step =
+      std::max((max_buffer_size_ - min_buffer_size_) / 16, kSizeDummyEntry);
+  size_t buffer_size = buffer_size_.load(std::memory_order_relaxed);
+  if (free_space > capacity / 8) {
+    // Room the blocks don't ask for
+    buffer_size = std::min(buffer_size + step, max_buffer_size_);
+  } else if (free_space < capacity / 32) {
+    // Blocks are evicted to make room, give some back
+    buffer_size = buffer_size > min_buffer_size_ + step
+                      ? buffer_size - step
+                      : min_buffer_size_;
+  }
+  buffer_size_.store(buffer_size, std::memory_order_relaxed);
+#endif  // ROCKSDB_LITE
+}
+
+void WriteBufferManager::ReportMemTable(const void* db,
+                                        uint32_t column_family_id,
+                                        size_t memory_usage,
+                                        uint64_t oldest_key_time) {
+  std::lock_guard<std::mutex> lock(arbitration_mutex_);
+  db_stats_[db].memtables[column_family_id] =
+      MemTableStat{memory_usage, oldest_key_time};
+}
+
+void WriteBufferManager::UnregisterDB(const void* db) {
+  std::lock_guard<std::mutex> lock(arbitration_mutex_);
+  auto find = db_stats_.find(db);
+  if (find == db_stats_.end()) {
+    return;
+  }
+  if (find->second.flush_requested) {
+    num_flush_requests_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  db_stats_.erase(find);
+}
+
+bool WriteBufferManager::PickFlushVictim(const void* db, uint64_t now,
+                                         const void** victim_db,
+                                         uint32_t* column_family_id) {
+  std::lock_guard<std::mutex> lock(arbitration_mutex_);
+  // The mean write rate, in bytes per second, the rate of every memtable is
+  // weighed against
+  double total_rate = 0;
+  size_t num_memtables = 0;
+  auto get_age = [now](const MemTableStat& stat) {
+    // One second at least, and no clock going backwards
+    return stat.oldest_key_time < now
+               ? static_cast<double>(now - stat.oldest_key_time)
+               : 1.0;
+  };
+  for (auto& db_pair : db_stats_) {
+    for (auto& memtable_pair : db_pair.second.memtables) {
+      auto& stat = memtable_pair.second;
+      if (stat.memory_usage > 0) {
+        total_rate += stat.memory_usage / get_age(stat);
+        ++num_memtables;
+      }
+    }
+  }
+  if (num_memtables == 0) {
+    return false;
+  }
+  const double mean_rate = total_rate / num_memtables;
+
+  DBStat* victim = nullptr;
+  double victim_score = 0;
+  for (auto& db_pair : db_stats_) {
+    if (db_pair.second.flush_requested) {
+      continue;
+    }
+    for (auto& memtable_pair : db_pair.second.memtables) {
+      auto& stat = memtable_pair.second;
+      if (stat.memory_usage == 0) {
+        continue;
+      }
+      double age = get_age(stat);
+      double rate = stat.memory_usage / age;
+      // Age weighs in by the minute
+      double score =
+          stat.memory_usage * (1 + age / 60) / (1 + rate / mean_rate);
+      if (victim == nullptr || score > victim_score) {
+        victim = &db_pair.second;
+        victim_score = score;
+        *victim_db = db_pair.first;
+        *column_family_id = memtable_pair.first;
+      }
+    }
+  }
+  if (victim == nullptr) {
+    return false;
+  }
+  // Not a candidate again until it reports the new memtable
+  victim->memtables[*column_family_id].memory_usage = 0;
+  if (*victim_db != db) {
+    victim->flush_requested = true;
+    victim->requested_column_family_id = *column_family_id;
+    num_flush_requests_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+bool WriteBufferManager::TakeFlushRequest(const void* db,
+                                          uint32_t* column_family_id) {
+  if (!HasFlushRequests()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(arbitration_mutex_);
+  auto find = db_stats_.find(db);
+  if (find == db_stats_.end() || !find->second.flush_requested) {
+    return false;
+  }
+  find->second.flush_requested = false;
+  *column_family_id = find->second.requested_column_family_id;
+  num_flush_requests_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
 }  // namespace TERARKDB_NAMESPACE
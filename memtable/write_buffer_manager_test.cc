@@ -10,6 +10,7 @@
 #include "rocksdb/write_buffer_manager.h"
 
 #include "rocksdb/terark_namespace.h"
+#include "util/string_util.h"
 #include "util/testharness.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -144,6 +145,85 @@ TEST_F(WriteBufferManagerTest, NoCapCacheCost) {
   ASSERT_GE(cache->GetPinnedUsage(), 1024 * 1024);
   ASSERT_LT(cache->GetPinnedUsage(), 1024 * 1024 + 10000);
 }
+TEST_F(WriteBufferManagerTest, FlushArbitration) {
+  WriteBufferManager wbf(10 * 1024 * 1024);
+  int db1 = 0;
+  int db2 = 0;
+  const uint64_t kNow = 100000;
+  const void* victim_db = nullptr;
+  uint32_t victim_cf_id = 0;
+  ASSERT_FALSE(wbf.PickFlushVictim(&db1, kNow, &victim_db, &victim_cf_id));
+
+  wbf.ReportMemTable(&db1, 0, 1 * 1024 * 1024, kNow - 60);
+  wbf.ReportMemTable(&db1, 1, 4 * 1024 * 1024, kNow - 60);
+  // As large as db1's column family 1, but written ten times slower
+  wbf.ReportMemTable(&db2, 0, 4 * 1024 * 1024, kNow - 600);
+  wbf.ReportMemTable(&db2, 1, 0, kNow);
+
+  ASSERT_TRUE(wbf.PickFlushVictim(&db1, kNow, &victim_db, &victim_cf_id));
+  ASSERT_EQ(&db2, victim_db);
+  ASSERT_EQ(0, victim_cf_id);
+  ASSERT_TRUE(wbf.HasFlushRequests());
+
+  // db2 holds a request it has not taken yet
+  ASSERT_TRUE(wbf.PickFlushVictim(&db1, kNow, &victim_db, &victim_cf_id));
+  ASSERT_EQ(&db1, victim_db);
+  ASSERT_EQ(1, victim_cf_id);
+
+  uint32_t requested_cf_id = 0;
+  ASSERT_FALSE(wbf.TakeFlushRequest(&db1, &requested_cf_id));
+  ASSERT_TRUE(wbf.TakeFlushRequest(&db2, &requested_cf_id));
+  ASSERT_EQ(0, requested_cf_id);
+  ASSERT_FALSE(wbf.HasFlushRequests());
+  ASSERT_FALSE(wbf.TakeFlushRequest(&db2, &requested_cf_id));
+
+  // The picked memtables wait for their successors to be reported
+  ASSERT_TRUE(wbf.PickFlushVictim(&db2, kNow, &victim_db, &victim_cf_id));
+  ASSERT_EQ(&db1, victim_db);
+  ASSERT_EQ(0, victim_cf_id);
+  ASSERT_TRUE(wbf.HasFlushRequests());
+  ASSERT_FALSE(wbf.PickFlushVictim(&db2, kNow, &victim_db, &victim_cf_id));
+
+  // Closing drops the request
+  wbf.UnregisterDB(&db1);
+  ASSERT_FALSE(wbf.HasFlushRequests());
+  wbf.ReportMemTable(&db2, 1, 1024, kNow - 1);
+  ASSERT_TRUE(wbf.PickFlushVictim(&db2, kNow, &victim_db, &victim_cf_id));
+  ASSERT_EQ(&db2, victim_db);
+  ASSERT_EQ(1, victim_cf_id);
+  ASSERT_FALSE(wbf.HasFlushRequests());
+}
+
+TEST_F(WriteBufferManagerTest, BufferSizeRange) {
+  const size_t kMB = 1024 * 1024;
+  // A fixed size without a cache
+  WriteBufferManager fixed(16 * kMB);
+  fixed.SetBufferSizeRange(8 * kMB, 32 * kMB);
+  ASSERT_EQ(16 * kMB, fixed.buffer_size());
+
+  std::shared_ptr<Cache> cache = NewLRUCache(64 * kMB, 4);
+  std::unique_ptr<WriteBufferManager> wbf(
+      new WriteBufferManager(16 * kMB, cache));
+  wbf->SetBufferSizeRange(8 * kMB, 32 * kMB);
+  // The cache has room to spare
+  for (int i = 0; i < 16; ++i) {
+    wbf->ReserveMem(kMB);
+  }
+  ASSERT_EQ(32 * kMB, wbf->buffer_size());
+  ASSERT_FALSE(wbf->ShouldFlush());
+
+  // Blocks fill up the cache
+  for (int i = 0; i < 1024; ++i) {
+    std::string key = "block" + ToString(i);
+    ASSERT_OK(cache->Insert(key, nullptr, 64 * 1024, nullptr));
+  }
+  for (int i = 0; i < 16; ++i) {
+    wbf->FreeMem(1);
+  }
+  ASSERT_EQ(8 * kMB, wbf->buffer_size());
+  // 16MB of memtables are over the shrunk buffer size
+  ASSERT_TRUE(wbf->ShouldFlush());
+}
 #endif  // ROCKSDB_LITE
 }  // namespace TERARKDB_NAMESPACE
 
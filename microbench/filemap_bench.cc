@@ -0,0 +1,179 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/filemap.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "db/version_edit.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// The blob files first written, by flushes, each with a range of the keys
+const uint64_t kNumRootFiles = 16;
+const uint64_t kKeysPerRootFile = 1 << 16;
+const uint64_t kNumKeys = kNumRootFiles * kKeysPerRootFile;
+
+// How a GC rewrites a blob file
+enum LineageKind {
+  // Into one file of the same key range, the lineage jumps skip the chain
+  kChain,
+  // Into two files of half the range each, a query walks every generation
+  kSplit,
+};
+
+std::string UserKey(uint64_t key) {
+  std::string user_key(8, '\0');
+  for (int i = 7; i >= 0; --i) {
+    user_key[i] = static_cast<char>(key & 0xff);
+    key >>= 8;
+  }
+  return user_key;
+}
+
+// The lineages of `generations` GCs of the root files
+class LineageFixture {
+ public:
+  LineageFixture(LineageKind kind, int generations)
+      : map_(BytewiseComparator()) {
+    std::vector<FileMetaData*> parents;
+    for (uint64_t i = 0; i < kNumRootFiles; ++i) {
+      FileMetaData* f = NewFile(i * kKeysPerRootFile,
+                                (i + 1) * kKeysPerRootFile);
+      map_.AddNode(f);
+      parents.push_back(f);
+    }
+    for (int g = 0; g < generations; ++g) {
+      std::vector<FileMetaData*> children;
+      for (FileMetaData* p : parents) {
+        uint64_t lo = range_[p].first;
+        uint64_t hi = range_[p].second;
+        if (kind == kSplit && hi - lo > 1) {
+          uint64_t mid = lo + (hi - lo) / 2;
+          children.push_back(NewFile(lo, mid));
+          children.push_back(NewFile(mid, hi));
+          map_.AddDerivedNode(p, children[children.size() - 2]);
+        } else {
+          children.push_back(NewFile(lo, hi));
+        }
+        map_.AddDerivedNode(p, children.back());
+      }
+      parents.swap(children);
+    }
+  }
+
+  FileMap* map() { return &map_; }
+
+ private:
+  // Covers the keys [lo, hi)
+  FileMetaData* NewFile(uint64_t lo, uint64_t hi) {
+    files_.emplace_back(new FileMetaData);
+    FileMetaData* f = files_.back().get();
+    f->fd = FileDescriptor(files_.size(), 0, 0);
+    f->smallest = InternalKey(UserKey(lo), kMaxSequenceNumber, kTypeValue);
+    f->largest = InternalKey(UserKey(hi - 1), 0, kTypeValue);
+    range_[f] = std::make_pair(lo, hi);
+    return f;
+  }
+
+  std::vector<std::unique_ptr<FileMetaData>> files_;
+  std::map<FileMetaData*, std::pair<uint64_t, uint64_t>> range_;
+  FileMap map_;
+};
+
+// The fixtures are built once and shared by the threads of a benchmark
+FileMap* GetFileMap(LineageKind kind, int generations) {
+  static std::mutex mutex;
+  static std::map<std::pair<int, int>, std::unique_ptr<LineageFixture>>
+      fixtures;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& fixture = fixtures[std::make_pair(int(kind), generations)];
+  if (!fixture) {
+    fixture.reset(new LineageFixture(kind, generations));
+  }
+  return fixture->map();
+}
+
+// The lookup of the live blob file of a key from the blob file an SST
+// refers to, as done for every separated value read
+void QueryLive(benchmark::State& state, LineageKind kind) {
+  FileMap* map = GetFileMap(kind, static_cast<int>(state.range(0)));
+  // Up to `locality` queries in a row for the same key
+  const uint64_t locality = static_cast<uint64_t>(state.range(1));
+  Random64 rnd(301 + state.thread_index());
+  std::string user_key;
+  uint64_t root = 0;
+  uint64_t since_new_key = locality;
+  uint64_t failed = 0;
+  for (auto _ : state) {
+    if (since_new_key >= locality) {
+      uint64_t key = rnd.Uniform(kNumKeys);
+      user_key = UserKey(key);
+      root = key / kKeysPerRootFile + 1;
+      since_new_key = 0;
+    }
+    ++since_new_key;
+    uint64_t fn = 0;
+    Status s = map->QueryFileNumber(root, user_key, BytewiseComparator(),
+                                    kMaxSequenceNumber, &fn);
+    failed += !s.ok();
+    benchmark::DoNotOptimize(fn);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["failed"] = double(failed);
+}
+
+void SplitArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"generations", "locality"});
+  for (int generations : {1, 4, 8}) {
+    for (int locality : {1, 16}) {
+      b->Args({generations, locality});
+    }
+  }
+  b->Threads(1)->Threads(8);
+}
+
+// The long chains of the files rewritten alone
+void ChainArgs(benchmark::internal::Benchmark* b) {
+  SplitArgs(b);
+  b->Args({64, 1});
+}
+}  // namespace
+
+static void BM_FileMapQueryChain(benchmark::State& state) {
+  QueryLive(state, kChain);
+}
+BENCHMARK(BM_FileMapQueryChain)->Apply(ChainArgs);
+
+static void BM_FileMapQuerySplit(benchmark::State& state) {
+  QueryLive(state, kSplit);
+}
+BENCHMARK(BM_FileMapQuerySplit)->Apply(SplitArgs);
+
+// A GC installing the derived nodes of its output, the lineage flattening
+// included
+static void BM_FileMapAddDerived(benchmark::State& state) {
+  const int generations = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    LineageFixture fixture(kChain, generations);
+    benchmark::DoNotOptimize(fixture.map()->size());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumRootFiles * generations);
+}
+BENCHMARK(BM_FileMapAddDerived)->Arg(8)->Arg(64);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
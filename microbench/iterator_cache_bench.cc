@@ -0,0 +1,112 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/iterator_cache.h"
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "db/version_edit.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// The files a map SST or a separated value depends on
+class DependenceFixture {
+ public:
+  explicit DependenceFixture(size_t num_files) {
+    for (size_t i = 0; i < num_files; ++i) {
+      files_.emplace_back(new FileMetaData);
+      files_.back()->fd = FileDescriptor(kFirstFileNumber + i, 0, 0);
+      dependence_map_.emplace(kFirstFileNumber + i, files_.back().get());
+    }
+  }
+
+  const DependenceMap& dependence_map() const { return dependence_map_; }
+
+  // An empty iterator in the arena, the opening of the table readers is
+  // left out
+  static InternalIterator* CreateIter(void* /*arg*/, const FileMetaData*,
+                                      const DependenceMap&, Arena* arena,
+                                      TableReader** reader_ptr) {
+    *reader_ptr = nullptr;
+    return NewEmptyInternalIterator<LazyBuffer>(arena);
+  }
+
+  static const uint64_t kFirstFileNumber = 1000;
+
+ private:
+  std::vector<std::unique_ptr<FileMetaData>> files_;
+  DependenceMap dependence_map_;
+};
+}  // namespace
+
+// The iterators of a map SST read, created on first use of a dependence and
+// found in the cache after that
+static void BM_IteratorCacheResolve(benchmark::State& state) {
+  const size_t num_files = static_cast<size_t>(state.range(0));
+  const size_t num_lookups = static_cast<size_t>(state.range(1));
+  DependenceFixture fixture(num_files);
+  Random64 rnd(301);
+  std::vector<uint64_t> file_numbers(num_lookups);
+  for (auto& fn : file_numbers) {
+    fn = DependenceFixture::kFirstFileNumber + rnd.Uniform(num_files);
+  }
+  for (auto _ : state) {
+    IteratorCache cache(fixture.dependence_map(), nullptr,
+                        &DependenceFixture::CreateIter);
+    for (uint64_t fn : file_numbers) {
+      benchmark::DoNotOptimize(cache.GetIterator(fn));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_lookups);
+}
+BENCHMARK(BM_IteratorCacheResolve)
+    ->ArgNames({"files", "lookups"})
+    ->Args({4, 64})
+    ->Args({64, 64})
+    ->Args({64, 4096})
+    ->Args({1024, 4096});
+
+// The lookups of the dependences already resolved
+static void BM_IteratorCacheHit(benchmark::State& state) {
+  const size_t num_files = static_cast<size_t>(state.range(0));
+  DependenceFixture fixture(num_files);
+  IteratorCache cache(fixture.dependence_map(), nullptr,
+                      &DependenceFixture::CreateIter);
+  for (size_t i = 0; i < num_files; ++i) {
+    cache.GetIterator(DependenceFixture::kFirstFileNumber + i);
+  }
+  Random64 rnd(301);
+  for (auto _ : state) {
+    uint64_t fn = DependenceFixture::kFirstFileNumber + rnd.Uniform(num_files);
+    TableReader* reader = nullptr;
+    benchmark::DoNotOptimize(cache.GetIterator(fn, &reader));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IteratorCacheHit)->Arg(4)->Arg(64)->Arg(1024);
+
+// The metadata of a dependence, looked up for every value of a map SST
+static void BM_IteratorCacheFileMetaData(benchmark::State& state) {
+  const size_t num_files = static_cast<size_t>(state.range(0));
+  DependenceFixture fixture(num_files);
+  IteratorCache cache(fixture.dependence_map(), nullptr,
+                      &DependenceFixture::CreateIter);
+  Random64 rnd(301);
+  for (auto _ : state) {
+    uint64_t fn = DependenceFixture::kFirstFileNumber + rnd.Uniform(num_files);
+    benchmark::DoNotOptimize(cache.GetFileMetaData(fn));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IteratorCacheFileMetaData)->Arg(4)->Arg(64)->Arg(1024);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
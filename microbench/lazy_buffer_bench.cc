@@ -0,0 +1,118 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "rocksdb/lazy_buffer.h"
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// The values up to 32 bytes fit in the light state of a buffer
+const int64_t kValueSizes[] = {8, 32, 100, 4096};
+
+std::string RandomValue(size_t size) {
+  Random rnd(301);
+  std::string value(size, '\0');
+  for (auto& c : value) {
+    c = static_cast<char>(' ' + rnd.Uniform(95));
+  }
+  return value;
+}
+
+void ValueSizes(benchmark::internal::Benchmark* b) {
+  for (int64_t size : kValueSizes) {
+    b->Arg(size);
+  }
+}
+
+void SetProcessed(benchmark::State& state) {
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void DoNothing(void* /*arg1*/, void* /*arg2*/) {}
+}  // namespace
+
+// A value referred to by an iterator and copied out, like Get() does
+static void BM_LazyBufferCopy(benchmark::State& state) {
+  std::string value = RandomValue(state.range(0));
+  for (auto _ : state) {
+    LazyBuffer buffer(value, true /* copy */);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  SetProcessed(state);
+}
+BENCHMARK(BM_LazyBufferCopy)->Apply(ValueSizes);
+
+static void BM_LazyBufferMove(benchmark::State& state) {
+  std::string value = RandomValue(state.range(0));
+  LazyBuffer a(value, true /* copy */);
+  LazyBuffer b;
+  for (auto _ : state) {
+    b = std::move(a);
+    a = std::move(b);
+    benchmark::DoNotOptimize(a.data());
+  }
+  SetProcessed(state);
+}
+BENCHMARK(BM_LazyBufferMove)->Apply(ValueSizes);
+
+static void BM_LazyBufferAssign(benchmark::State& state) {
+  std::string value = RandomValue(state.range(0));
+  LazyBuffer source(value);
+  LazyBuffer buffer;
+  for (auto _ : state) {
+    buffer.assign(source);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  SetProcessed(state);
+}
+BENCHMARK(BM_LazyBufferAssign)->Apply(ValueSizes);
+
+// The pinning of a value held by a table reader, in its block or mmap
+static void BM_LazyBufferPinCleanable(benchmark::State& state) {
+  std::string value = RandomValue(state.range(0));
+  for (auto _ : state) {
+    LazyBuffer buffer(value, Cleanable(&DoNothing, nullptr, nullptr));
+    buffer.pin();
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  SetProcessed(state);
+}
+BENCHMARK(BM_LazyBufferPinCleanable)->Apply(ValueSizes);
+
+// The dump of a value into the std::string of a DB::Get()
+static void BM_LazyBufferDumpString(benchmark::State& state) {
+  std::string value = RandomValue(state.range(0));
+  std::string result;
+  for (auto _ : state) {
+    LazyBuffer buffer(value);
+    Status s = std::move(buffer).dump(&result);
+    benchmark::DoNotOptimize(s);
+  }
+  SetProcessed(state);
+}
+BENCHMARK(BM_LazyBufferDumpString)->Apply(ValueSizes);
+
+static void BM_LazyBufferTransToString(benchmark::State& state) {
+  std::string value = RandomValue(state.range(0));
+  for (auto _ : state) {
+    LazyBuffer buffer(value);
+    std::string* str = buffer.trans_to_string();
+    str->push_back('x');
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  SetProcessed(state);
+}
+BENCHMARK(BM_LazyBufferTransToString)->Apply(ValueSizes);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "rocksdb/cache.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+const size_t kCapacity = 64 << 20;
+const size_t kCharge = 4 << 10;
+const int kShardBits = 4;
+// The cache holds half of the keys. Most lookups go to a hot fifth of the
+// keys, some are long scans over all the keys, which an LRU cache lets evict
+// the hot keys and a LIRS cache does not.
+const uint64_t kNumKeys = 2 * kCapacity / kCharge;
+const uint64_t kHotKeys = kNumKeys / 5;
+const uint64_t kScanOneIn = 16;
+const uint64_t kScanLength = kNumKeys / 4;
+
+enum CacheKind { kLRU, kLIRS, kAdaptiveLIRS, kNumCacheKinds };
+
+const char* CacheName(int kind) {
+  static const char* kNames[] = {"lru", "lirs", "lirs-adaptive"};
+  return kNames[kind];
+}
+
+// The caches are shared by the threads and the runs of a benchmark, the
+// runs after the first measure the cache warm
+Cache* GetCache(int kind) {
+  static std::shared_ptr<Cache> caches[kNumCacheKinds] = {
+      NewLRUCache(kCapacity, kShardBits),
+      NewLIRSCache(kCapacity, kShardBits),
+      NewLIRSCache(kCapacity, kShardBits, false /* strict_capacity_limit */,
+                   0.9 /* irr_ratio */, nullptr /* memory_allocator */,
+                   true /* adaptive_irr_ratio */)};
+  return caches[kind].get();
+}
+
+void DeleteValue(const Slice& /*key*/, void* /*value*/) {}
+
+// The key sequence of a thread, the same on every run
+class KeyGenerator {
+ public:
+  explicit KeyGenerator(uint32_t seed) : rnd_(seed) {}
+
+  uint64_t Next() {
+    if (scan_left_ > 0) {
+      --scan_left_;
+      return scan_next_++ % kNumKeys;
+    }
+    if (rnd_.OneIn(kScanOneIn * kScanLength)) {
+      scan_left_ = kScanLength;
+      scan_next_ = rnd_.Uniform(kNumKeys);
+    }
+    return rnd_.OneIn(5) ? rnd_.Uniform(kNumKeys) : rnd_.Uniform(kHotKeys);
+  }
+
+ private:
+  Random64 rnd_;
+  uint64_t scan_left_ = 0;
+  uint64_t scan_next_ = 0;
+};
+}  // namespace
+
+// A lookup, and an insert on a miss like the block cache of a table reader
+static void BM_CacheLookupInsert(benchmark::State& state) {
+  Cache* cache = GetCache(static_cast<int>(state.range(0)));
+  KeyGenerator key_gen(301 + state.thread_index());
+  char key_buf[8];
+  uint64_t hits = 0;
+  for (auto _ : state) {
+    EncodeFixed64(key_buf, key_gen.Next());
+    Slice key(key_buf, sizeof(key_buf));
+    Cache::Handle* handle = cache->Lookup(key);
+    if (handle != nullptr) {
+      ++hits;
+    } else {
+      cache->Insert(key, nullptr, kCharge, &DeleteValue, &handle);
+    }
+    if (handle != nullptr) {
+      cache->Release(handle);
+    }
+  }
+  state.SetLabel(CacheName(static_cast<int>(state.range(0))));
+  state.SetItemsProcessed(state.iterations());
+  state.counters["hit_ratio"] = benchmark::Counter(
+      state.iterations() == 0 ? 0 : double(hits) / state.iterations(),
+      benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_CacheLookupInsert)
+    ->DenseRange(0, kNumCacheKinds - 1)
+    ->Threads(1)
+    ->Threads(8);
+
+// The lookups of the keys always cached, the cost of the bookkeeping of a
+// hit alone
+static void BM_CacheHit(benchmark::State& state) {
+  Cache* cache = GetCache(static_cast<int>(state.range(0)));
+  Random64 rnd(301 + state.thread_index());
+  const uint64_t kCachedKeys = 1024;
+  char key_buf[8];
+  for (uint64_t i = 0; i < kCachedKeys; ++i) {
+    EncodeFixed64(key_buf, kNumKeys + i);
+    Slice key(key_buf, sizeof(key_buf));
+    Cache::Handle* handle = cache->Lookup(key);
+    if (handle == nullptr) {
+      cache->Insert(key, nullptr, kCharge, &DeleteValue, &handle,
+                    Cache::Priority::HIGH);
+    }
+    if (handle != nullptr) {
+      cache->Release(handle);
+    }
+  }
+  for (auto _ : state) {
+    EncodeFixed64(key_buf, kNumKeys + rnd.Uniform(kCachedKeys));
+    Cache::Handle* handle = cache->Lookup(Slice(key_buf, sizeof(key_buf)));
+    if (handle != nullptr) {
+      cache->Release(handle);
+    }
+  }
+  state.SetLabel(CacheName(static_cast<int>(state.range(0))));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CacheHit)
+    ->DenseRange(0, kNumCacheKinds - 1)
+    ->Threads(1)
+    ->Threads(8);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
@@ -0,0 +1,241 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "port/port.h"
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/listener.h"
+#include "rocksdb/options.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+const uint64_t kKeysPerFile = 50000;
+const size_t kValueSize = 100;
+
+// How the level 0 files are compacted into level 1
+enum CompactionKind {
+  // Into a map SST over the files, by MapBuilder
+  kMapCompaction,
+  // Into new SSTs, the reads of a map SST are compared to theirs
+  kKeyValueCompaction,
+  kNumCompactionKinds,
+};
+
+const char* CompactionName(int kind) {
+  static const char* kNames[] = {"map", "kv"};
+  return kNames[kind];
+}
+
+std::string UserKey(uint64_t key) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "key%012" PRIu64, key);
+  return buf;
+}
+
+// Records the run time of the compactions as they complete
+class CompactionTimer : public EventListener {
+ public:
+  CompactionTimer() : cv_(&mutex_) {}
+
+  void OnCompactionCompleted(DB* /*db*/,
+                             const CompactionJobInfo& ci) override {
+    MutexLock l(&mutex_);
+    elapsed_micros_ += ci.stats.elapsed_micros;
+    ++num_completed_;
+    cv_.SignalAll();
+  }
+
+  // Returns the run time of the first `n` compactions
+  uint64_t WaitForCompactions(int n) {
+    MutexLock l(&mutex_);
+    while (num_completed_ < n) {
+      cv_.Wait();
+    }
+    return elapsed_micros_;
+  }
+
+ private:
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  uint64_t elapsed_micros_ = 0;
+  int num_completed_ = 0;
+};
+
+// A DB of `num_files` overlapping level 0 files, of the same random keys on
+// every run, compacted into level 1
+class CompactedDB {
+ public:
+  CompactedDB(const std::string& name, int kind, int num_files)
+      : timer_(new CompactionTimer) {
+    Env::Default()->GetTestDirectory(&dbname_);
+    dbname_ += "/map_sst_bench_" + name + "_" + CompactionName(kind);
+    options_.create_if_missing = true;
+    options_.listeners.push_back(timer_);
+    options_.level0_file_num_compaction_trigger = num_files;
+    options_.level0_slowdown_writes_trigger = num_files + 1;
+    options_.level0_stop_writes_trigger = num_files + 1;
+    if (kind == kMapCompaction) {
+      // The files are compacted into a map SST once all written
+      options_.enable_lazy_compaction = true;
+    } else {
+      options_.disable_auto_compactions = true;
+    }
+    DestroyDB(dbname_, options_);
+    DB* db = nullptr;
+    Check(DB::Open(options_, dbname_, &db));
+    db_.reset(db);
+
+    num_keys_ = num_files * kKeysPerFile;
+    Random64 rnd(301);
+    std::string value(kValueSize, 'v');
+    for (int f = 0; f < num_files; ++f) {
+      for (uint64_t i = 0; i < kKeysPerFile; ++i) {
+        Check(db_->Put(WriteOptions(), UserKey(rnd.Uniform(num_keys_)), value));
+      }
+      Check(db_->Flush(FlushOptions()));
+    }
+    if (kind == kMapCompaction) {
+      compaction_micros_ = timer_->WaitForCompactions(1);
+      // The reads see the map SST, not the compactions that may follow it
+      Check(db_->SetOptions({{"disable_auto_compactions", "true"}}));
+    } else {
+      Check(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+      compaction_micros_ = timer_->WaitForCompactions(1);
+    }
+  }
+
+  ~CompactedDB() {
+    db_.reset();
+    DestroyDB(dbname_, options_);
+  }
+
+  DB* db() { return db_.get(); }
+  uint64_t num_keys() const { return num_keys_; }
+  uint64_t compaction_micros() const { return compaction_micros_; }
+
+ private:
+  static void Check(const Status& s) {
+    if (!s.ok()) {
+      fprintf(stderr, "map_sst_bench: %s\n", s.ToString().c_str());
+      abort();
+    }
+  }
+
+  std::string dbname_;
+  std::shared_ptr<CompactionTimer> timer_;
+  Options options_;
+  std::unique_ptr<DB> db_;
+  uint64_t num_keys_ = 0;
+  uint64_t compaction_micros_ = 0;
+};
+
+// The DBs read by the benchmarks, built once and shared by the threads
+CompactedDB* GetCompactedDB(int kind) {
+  static std::mutex mutex;
+  static std::unique_ptr<CompactedDB> dbs[kNumCompactionKinds];
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!dbs[kind]) {
+    dbs[kind].reset(new CompactedDB("read", kind, 8));
+  }
+  return dbs[kind].get();
+}
+}  // namespace
+
+// The compaction of the level 0 files into level 1, timed by the compaction
+// job itself
+static void BM_MapBuilderCompaction(benchmark::State& state) {
+  const int kind = static_cast<int>(state.range(0));
+  const int num_files = static_cast<int>(state.range(1));
+  for (auto _ : state) {
+    CompactedDB db("compaction", kind, num_files);
+    state.SetIterationTime(db.compaction_micros() / 1e6);
+  }
+  state.SetLabel(CompactionName(kind));
+}
+BENCHMARK(BM_MapBuilderCompaction)
+    ->ArgNames({"compaction", "files"})
+    ->Args({kMapCompaction, 4})
+    ->Args({kMapCompaction, 16})
+    ->Args({kKeyValueCompaction, 4})
+    ->Iterations(5)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// The point reads through a map SST resolve the file of the key from the
+// ranges of the map, then read the file
+static void BM_MapSstGet(benchmark::State& state) {
+  const int kind = static_cast<int>(state.range(0));
+  CompactedDB* db = GetCompactedDB(kind);
+  Random64 rnd(301 + state.thread_index());
+  std::string value;
+  uint64_t found = 0;
+  for (auto _ : state) {
+    found += db->db()
+                 ->Get(ReadOptions(), UserKey(rnd.Uniform(db->num_keys())),
+                       &value)
+                 .ok();
+  }
+  state.SetLabel(CompactionName(kind));
+  state.SetItemsProcessed(state.iterations());
+  state.counters["found"] = benchmark::Counter(
+      state.iterations() == 0 ? 0 : double(found) / state.iterations(),
+      benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_MapSstGet)
+    ->ArgName("compaction")
+    ->DenseRange(0, kNumCompactionKinds - 1)
+    ->Threads(1)
+    ->Threads(8);
+
+// A seek and a short scan, which go through the iterators of the files the
+// map depends on
+static void BM_MapSstSeekNext(benchmark::State& state) {
+  const int kind = static_cast<int>(state.range(0));
+  const int kScanLength = 10;
+  CompactedDB* db = GetCompactedDB(kind);
+  std::unique_ptr<Iterator> iter(db->db()->NewIterator(ReadOptions()));
+  Random64 rnd(301 + state.thread_index());
+  for (auto _ : state) {
+    iter->Seek(UserKey(rnd.Uniform(db->num_keys())));
+    for (int i = 0; i < kScanLength && iter->Valid(); ++i) {
+      benchmark::DoNotOptimize(iter->value());
+      iter->Next();
+    }
+  }
+  state.SetLabel(CompactionName(kind));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MapSstSeekNext)
+    ->ArgName("compaction")
+    ->DenseRange(0, kNumCompactionKinds - 1)
+    ->Threads(1)
+    ->Threads(8);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
+
+#else
+#include <stdio.h>
+
+int main(int /*argc*/, char** /*argv*/) {
+  fprintf(stderr, "SKIPPED as map SSTs are not supported in ROCKSDB_LITE\n");
+  return 0;
+}
+
+#endif  // !ROCKSDB_LITE
@@ -0,0 +1,176 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/concurrent_arena.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+const size_t kValueSize = 100;
+
+// The PatriciaTrieRep, and the skip list it is compared to
+enum RepKind { kSkipList, kPatriciaTrie, kNumRepKinds };
+
+const char* RepName(int kind) {
+  static const char* kNames[] = {"skiplist", "patricia"};
+  return kNames[kind];
+}
+
+// The user keys share a prefix, like the keys of a table
+std::string UserKey(uint64_t key) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "user%016" PRIu64, key);
+  return buf;
+}
+
+class RepFixture {
+ public:
+  explicit RepFixture(int kind)
+      : key_cmp_(InternalKeyComparator(BytewiseComparator())),
+        value_(kValueSize, 'v') {
+    if (kind == kPatriciaTrie) {
+      factory_.reset(NewPatriciaTrieRepFactory());
+    } else {
+      factory_.reset(new SkipListFactory);
+    }
+    Reset();
+  }
+
+  void Reset() {
+    rep_.reset();
+    arena_.reset(new ConcurrentArena);
+    rep_.reset(factory_->CreateMemTableRep(
+        key_cmp_, false /* needs_dup_key_check */, arena_.get(),
+        nullptr /* transform */, nullptr /* logger */));
+    seq_ = 0;
+  }
+
+  bool Insert(uint64_t key) {
+    InternalKey ikey(UserKey(key), ++seq_, kTypeValue);
+    return rep_->InsertKeyValue(ikey.Encode(), value_);
+  }
+
+  MemTableRep* rep() { return rep_.get(); }
+
+ private:
+  std::unique_ptr<MemTableRepFactory> factory_;
+  const MemTable::KeyComparator key_cmp_;
+  std::unique_ptr<ConcurrentArena> arena_;
+  std::unique_ptr<MemTableRep> rep_;
+  const std::string value_;
+  SequenceNumber seq_ = 0;
+};
+
+// The active memtables read by the benchmarks, filled once with `num_keys`
+// random keys of [0, 2 * num_keys) and shared by the threads
+MemTableRep* GetFilledRep(int kind, uint64_t num_keys) {
+  static std::mutex mutex;
+  static std::map<std::pair<int, uint64_t>, std::unique_ptr<RepFixture>>
+      fixtures;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& fixture = fixtures[std::make_pair(kind, num_keys)];
+  if (!fixture) {
+    fixture.reset(new RepFixture(kind));
+    Random64 rnd(301);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+      fixture->Insert(rnd.Uniform(2 * num_keys));
+    }
+  }
+  return fixture->rep();
+}
+
+bool CountEntry(void* arg, const Slice& /*key*/, const char* /*value*/) {
+  ++*static_cast<uint64_t*>(arg);
+  return false;
+}
+
+void RepArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"rep", "keys"});
+  for (int kind = 0; kind < kNumRepKinds; ++kind) {
+    b->Args({kind, 100000})->Args({kind, 1000000});
+  }
+}
+}  // namespace
+
+// The inserts of a write into an active memtable
+static void BM_MemTableRepInsert(benchmark::State& state) {
+  const int kind = static_cast<int>(state.range(0));
+  const uint64_t num_keys = static_cast<uint64_t>(state.range(1));
+  RepFixture fixture(kind);
+  Random64 rnd(301);
+  uint64_t inserted = 0;
+  for (auto _ : state) {
+    // A new memtable when full, as a switch after a flush
+    if (inserted == num_keys) {
+      state.PauseTiming();
+      fixture.Reset();
+      inserted = 0;
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(fixture.Insert(rnd.Uniform(2 * num_keys)));
+    ++inserted;
+  }
+  state.SetLabel(RepName(kind));
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * kValueSize);
+}
+BENCHMARK(BM_MemTableRepInsert)->Apply(RepArgs);
+
+static void BM_MemTableRepGet(benchmark::State& state) {
+  const int kind = static_cast<int>(state.range(0));
+  const uint64_t num_keys = static_cast<uint64_t>(state.range(1));
+  MemTableRep* rep = GetFilledRep(kind, num_keys);
+  Random64 rnd(301 + state.thread_index());
+  uint64_t found = 0;
+  for (auto _ : state) {
+    LookupKey lkey(UserKey(rnd.Uniform(2 * num_keys)), kMaxSequenceNumber);
+    rep->Get(lkey, &found, &CountEntry);
+  }
+  state.SetLabel(RepName(kind));
+  state.SetItemsProcessed(state.iterations());
+  state.counters["found"] = benchmark::Counter(
+      state.iterations() == 0 ? 0 : double(found) / state.iterations(),
+      benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_MemTableRepGet)->Apply(RepArgs)->Threads(1)->Threads(8);
+
+// A seek and a short scan, as done by the iterators of a read
+static void BM_MemTableRepSeekNext(benchmark::State& state) {
+  const int kind = static_cast<int>(state.range(0));
+  const uint64_t num_keys = static_cast<uint64_t>(state.range(1));
+  const int kScanLength = 10;
+  MemTableRep* rep = GetFilledRep(kind, num_keys);
+  std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+  Random64 rnd(301 + state.thread_index());
+  for (auto _ : state) {
+    LookupKey lkey(UserKey(rnd.Uniform(2 * num_keys)), kMaxSequenceNumber);
+    iter->Seek(lkey.internal_key(), lkey.memtable_key().data());
+    for (int i = 0; i < kScanLength && iter->Valid(); ++i) {
+      benchmark::DoNotOptimize(iter->key());
+      iter->Next();
+    }
+  }
+  state.SetLabel(RepName(kind));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemTableRepSeekNext)->Apply(RepArgs)->Threads(1)->Threads(8);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
@@ -0,0 +1,165 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/options.h"
+#include "rocksdb/table.h"
+#include "rocksdb/terark_namespace.h"
+#include "table/terark_zip_table.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+const uint64_t kNumKeys = 1000000;
+const size_t kValueSize = 100;
+const uint32_t kPrefixLen = 4;
+
+// The key `key` of index `prefix`, a prefix of kPrefixLen bytes
+std::string UserKey(uint32_t prefix, uint64_t key) {
+  char buf[32];
+  for (uint32_t i = 0; i < kPrefixLen; ++i) {
+    buf[i] = static_cast<char>(prefix >> (8 * (kPrefixLen - 1 - i)));
+  }
+  snprintf(buf + kPrefixLen, sizeof(buf) - kPrefixLen, "%012" PRIu64, key);
+  return std::string(buf, kPrefixLen + 12);
+}
+
+// A DB of one TerarkZipTable. With a key prefix and keys of several
+// prefixes, the table is read by a sub-reader per prefix.
+class ZipTableDB {
+ public:
+  ZipTableDB(uint32_t key_prefix_len, uint32_t num_prefixes)
+      : num_prefixes_(num_prefixes) {
+    std::string test_dir;
+    Env::Default()->GetTestDirectory(&test_dir);
+    dbname_ = test_dir + "/terark_zip_table_bench_" +
+              std::to_string(key_prefix_len) + "_" +
+              std::to_string(num_prefixes);
+    TerarkZipTableOptions tzto;
+    tzto.localTempDir = test_dir;
+    tzto.keyPrefixLen = key_prefix_len;
+    std::shared_ptr<TableFactory> block_based_factory(
+        NewBlockBasedTableFactory());
+    options_.table_factory.reset(
+        NewTerarkZipTableFactory(tzto, block_based_factory));
+    options_.allow_mmap_reads = true;
+    options_.create_if_missing = true;
+    options_.disable_auto_compactions = true;
+    options_.enable_lazy_compaction = false;
+    options_.blob_size = -1;
+    DestroyDB(dbname_, options_);
+    DB* db = nullptr;
+    Check(DB::Open(options_, dbname_, &db));
+    db_.reset(db);
+
+    // Text values of a small alphabet, compressible like most values
+    Random64 rnd(301);
+    std::string value(kValueSize, '\0');
+    for (uint64_t i = 0; i < kNumKeys; ++i) {
+      for (auto& c : value) {
+        c = static_cast<char>('a' + rnd.Uniform(16));
+      }
+      Check(db_->Put(WriteOptions(), UserKey(i % num_prefixes_, 2 * i), value));
+    }
+    Check(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  }
+
+  ~ZipTableDB() {
+    db_.reset();
+    DestroyDB(dbname_, options_);
+  }
+
+  DB* db() { return db_.get(); }
+
+  // A key of the DB, or one in `miss_one_in` a key between two of its keys
+  std::string RandomKey(Random64* rnd, uint64_t miss_one_in) const {
+    uint64_t i = rnd->Uniform(kNumKeys);
+    return UserKey(i % num_prefixes_, 2 * i + rnd->OneIn(miss_one_in));
+  }
+
+ private:
+  static void Check(const Status& s) {
+    if (!s.ok()) {
+      fprintf(stderr, "terark_zip_table_bench: %s\n", s.ToString().c_str());
+      abort();
+    }
+  }
+
+  const uint32_t num_prefixes_;
+  std::string dbname_;
+  Options options_;
+  std::unique_ptr<DB> db_;
+};
+
+// The DBs are built once and shared by the threads of a benchmark
+ZipTableDB* GetZipTableDB(uint32_t key_prefix_len, uint32_t num_prefixes) {
+  static std::mutex mutex;
+  static std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<ZipTableDB>>
+      dbs;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& db = dbs[std::make_pair(key_prefix_len, num_prefixes)];
+  if (!db) {
+    db.reset(new ZipTableDB(key_prefix_len, num_prefixes));
+  }
+  return db.get();
+}
+
+void ZipTableArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"prefix_len", "prefixes"});
+  // One reader of the whole table, then one sub-reader per prefix
+  b->Args({0, 16})->Args({kPrefixLen, 1})->Args({kPrefixLen, 16});
+  b->Threads(1)->Threads(8);
+}
+}  // namespace
+
+static void BM_TerarkZipGet(benchmark::State& state) {
+  ZipTableDB* db = GetZipTableDB(static_cast<uint32_t>(state.range(0)),
+                                 static_cast<uint32_t>(state.range(1)));
+  Random64 rnd(301 + state.thread_index());
+  std::string value;
+  uint64_t found = 0;
+  for (auto _ : state) {
+    found += db->db()->Get(ReadOptions(), db->RandomKey(&rnd, 10), &value).ok();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["found"] = benchmark::Counter(
+      state.iterations() == 0 ? 0 : double(found) / state.iterations(),
+      benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_TerarkZipGet)->Apply(ZipTableArgs);
+
+// A seek and a short scan, which crosses into the next sub-reader at the
+// end of a prefix
+static void BM_TerarkZipSeekNext(benchmark::State& state) {
+  const int kScanLength = 10;
+  ZipTableDB* db = GetZipTableDB(static_cast<uint32_t>(state.range(0)),
+                                 static_cast<uint32_t>(state.range(1)));
+  std::unique_ptr<Iterator> iter(db->db()->NewIterator(ReadOptions()));
+  Random64 rnd(301 + state.thread_index());
+  for (auto _ : state) {
+    iter->Seek(db->RandomKey(&rnd, 10));
+    for (int i = 0; i < kScanLength && iter->Valid(); ++i) {
+      benchmark::DoNotOptimize(iter->value());
+      iter->Next();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TerarkZipSeekNext)->Apply(ZipTableArgs);
+
+}  // namespace TERARKDB_NAMESPACE
+
+BENCHMARK_MAIN();
@@ -0,0 +1,152 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "monitoring/cpu_attribution.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/core_local.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+thread_local CpuJobScope* current_cpu_job = nullptr;
+thread_local uint64_t last_cpu_nanos = 0;
+thread_local uint64_t last_wall_nanos = 0;
+
+// Leaked on purpose, as the I/O attribution counters
+CoreLocalArray<CpuAttributionCounters>* GetCpuAttributionCounters() {
+  static auto* counters = new CoreLocalArray<CpuAttributionCounters>();
+  return counters;
+}
+}  // namespace
+
+const char* CpuJobKindName(CpuJobKind kind) {
+  switch (kind) {
+    case CpuJobKind::kFlush:
+      return "flush";
+    case CpuJobKind::kCompaction:
+      return "compaction";
+    case CpuJobKind::kGC:
+      return "gc";
+    case CpuJobKind::kZoneMigration:
+      return "zone_migration";
+    case CpuJobKind::kTableBuild:
+      return "table_build";
+    default:
+      return "unknown";
+  }
+}
+
+CpuAttributionCounters::CpuAttributionCounters() {
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    jobs_[i].store(0, std::memory_order_relaxed);
+    cpu_nanos_[i].store(0, std::memory_order_relaxed);
+    wall_nanos_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void CpuAttributionCounters::AddJob(CpuJobKind job) {
+  jobs_[static_cast<size_t>(job)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CpuAttributionCounters::AddTime(CpuJobKind job, uint64_t cpu_nanos,
+                                     uint64_t wall_nanos) {
+  size_t i = static_cast<size_t>(job);
+  cpu_nanos_[i].fetch_add(cpu_nanos, std::memory_order_relaxed);
+  wall_nanos_[i].fetch_add(wall_nanos, std::memory_order_relaxed);
+}
+
+void CpuAttributionCounters::AddTo(CpuAttributionStats* stats) const {
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    stats->jobs[i] += jobs_[i].load(std::memory_order_relaxed);
+    stats->cpu_nanos[i] += cpu_nanos_[i].load(std::memory_order_relaxed);
+    stats->wall_nanos[i] += wall_nanos_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void CpuJobScope::Sample() {
+  Env* env = Env::Default();
+  uint64_t cpu_nanos = env->NowCPUNanos();
+  uint64_t wall_nanos = env->NowNanos();
+  CpuJobScope* scope = current_cpu_job;
+  if (scope != nullptr) {
+    uint64_t cpu = cpu_nanos > last_cpu_nanos ? cpu_nanos - last_cpu_nanos : 0;
+    uint64_t wall =
+        wall_nanos > last_wall_nanos ? wall_nanos - last_wall_nanos : 0;
+    GetCpuAttributionCounters()->Access()->AddTime(scope->job_, cpu, wall);
+    if (scope->cf_ != nullptr) {
+      scope->cf_->AddTime(scope->job_, cpu, wall);
+    }
+  }
+  last_cpu_nanos = cpu_nanos;
+  last_wall_nanos = wall_nanos;
+}
+
+CpuJobScope::CpuJobScope(CpuJobKind job, CpuAttributionCounters* cf)
+    : prev_(current_cpu_job),
+      job_(job),
+      cf_(cf == nullptr && prev_ != nullptr ? prev_->cf_ : cf) {
+  Sample();
+  current_cpu_job = this;
+  bool same_job = prev_ != nullptr && prev_->job_ == job_;
+  if (!same_job) {
+    GetCpuAttributionCounters()->Access()->AddJob(job_);
+  }
+  if (cf_ != nullptr && !(same_job && prev_->cf_ == cf_)) {
+    cf_->AddJob(job_);
+  }
+}
+
+CpuJobScope::~CpuJobScope() {
+  Sample();
+  current_cpu_job = prev_;
+}
+
+CpuAttributionCounters* CpuJobScope::CurrentColumnFamily() {
+  return current_cpu_job == nullptr ? nullptr : current_cpu_job->cf_;
+}
+
+void GetCpuAttributionStats(CpuAttributionStats* stats) {
+  *stats = CpuAttributionStats();
+  CoreLocalArray<CpuAttributionCounters>* array = GetCpuAttributionCounters();
+  for (size_t core = 0; core < array->Size(); ++core) {
+    array->AccessAtCore(core)->AddTo(stats);
+  }
+}
+
+std::string CpuAttributionStats::ToString(
+    const CpuAttributionStats& prev) const {
+  std::string out;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-15s %10s %12s %12s %8s\n", "Job", "Jobs",
+           "CPU(sec)", "Wall(sec)", "CPU%");
+  out.append(buf);
+  uint64_t total_cpu = 0;
+  uint64_t total_wall = 0;
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    uint64_t num_jobs = jobs[i] - prev.jobs[i];
+    uint64_t cpu = cpu_nanos[i] - prev.cpu_nanos[i];
+    uint64_t wall = wall_nanos[i] - prev.wall_nanos[i];
+    if (num_jobs == 0 && wall == 0) {
+      continue;
+    }
+    total_cpu += cpu;
+    total_wall += wall;
+    snprintf(buf, sizeof(buf), "%-15s %10" PRIu64 " %12.3f %12.3f %8.1f\n",
+             CpuJobKindName(static_cast<CpuJobKind>(i)), num_jobs, cpu / 1e9,
+             wall / 1e9, wall == 0 ? 0.0 : 100.0 * cpu / wall);
+    out.append(buf);
+  }
+  snprintf(buf, sizeof(buf), "Total: CPU %.3f sec in %.3f sec of the jobs\n",
+           total_cpu / 1e9, total_wall / 1e9);
+  out.append(buf);
+  return out;
+}
+
+}  // namespace TERARKDB_NAMESPACE
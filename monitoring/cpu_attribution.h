@@ -0,0 +1,100 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+// Always-on attribution of the CPU time of the background jobs. The thread
+// CPU time (Env::NowCPUNanos(), CLOCK_THREAD_CPUTIME_ID) and the wall time
+// of a thread are sampled whenever it enters or leaves a CpuJobScope, and the
+// time between two samples is charged to the innermost scope: process wide,
+// and to its column family if it has one. Nothing is sampled outside of the
+// scopes, so the foreground threads pay nothing. DBImpl::DumpStats() logs
+// and reports the process wide counters, the "rocksdb.cf-cpu-attribution"
+// property tabulates those of a column family.
+
+enum class CpuJobKind : uint8_t {
+  kFlush,
+  kCompaction,
+  kGC,
+  // The ZNS GC jobs, migrating the valid data out of the zones to reset
+  kZoneMigration,
+  // The background tasks of the TerarkZipTable builds
+  kTableBuild,
+  kNumKinds,
+};
+
+extern const char* CpuJobKindName(CpuJobKind kind);
+
+struct CpuAttributionStats {
+  static const size_t kNumKinds = static_cast<size_t>(CpuJobKind::kNumKinds);
+
+  uint64_t jobs[kNumKinds] = {};
+  uint64_t cpu_nanos[kNumKinds] = {};
+  // The time the threads spent in the jobs, running or not
+  uint64_t wall_nanos[kNumKinds] = {};
+
+  // Tabulate the time charged since `prev`, skipping the jobs not run
+  std::string ToString(const CpuAttributionStats& prev) const;
+};
+
+class CpuAttributionCounters {
+ public:
+  CpuAttributionCounters();
+
+  CpuAttributionCounters(const CpuAttributionCounters&) = delete;
+  CpuAttributionCounters& operator=(const CpuAttributionCounters&) = delete;
+
+  void AddJob(CpuJobKind job);
+  void AddTime(CpuJobKind job, uint64_t cpu_nanos, uint64_t wall_nanos);
+
+  // Add the counters to `stats`
+  void AddTo(CpuAttributionStats* stats) const;
+
+ private:
+  static const size_t kNumKinds = CpuAttributionStats::kNumKinds;
+
+  std::atomic<uint64_t> jobs_[kNumKinds];
+  std::atomic<uint64_t> cpu_nanos_[kNumKinds];
+  std::atomic<uint64_t> wall_nanos_[kNumKinds];
+};
+
+// While alive, the time of the calling thread is charged to `job`, and to
+// `cf` unless nullptr. Scopes nest, a scope without a column family belongs
+// to the one of the scope it is nested in. A job is counted once for nested
+// scopes of the same kind, a subcompaction on a thread of its own counts as
+// a job.
+class CpuJobScope {
+ public:
+  explicit CpuJobScope(CpuJobKind job, CpuAttributionCounters* cf = nullptr);
+  ~CpuJobScope();
+
+  CpuJobScope(const CpuJobScope&) = delete;
+  CpuJobScope& operator=(const CpuJobScope&) = delete;
+
+  // The column family the time of the calling thread is charged to, for
+  // the tasks it hands to other threads
+  static CpuAttributionCounters* CurrentColumnFamily();
+
+ private:
+  // Charge the time since the last sample of the thread to its scope
+  static void Sample();
+
+  CpuJobScope* prev_;
+  const CpuJobKind job_;
+  CpuAttributionCounters* const cf_;
+};
+
+// Sum the process wide counters of all cores
+extern void GetCpuAttributionStats(CpuAttributionStats* stats);
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,105 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "monitoring/cpu_attribution.h"
+
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// Burn the CPU of the thread until its clock moved `nanos`
+void Spin(uint64_t nanos) {
+  Env* env = Env::Default();
+  uint64_t start = env->NowCPUNanos();
+  volatile uint64_t sink = 0;
+  while (env->NowCPUNanos() - start < nanos) {
+    for (int i = 0; i < 1000; ++i) {
+      sink = sink + i;
+    }
+  }
+}
+
+size_t Index(CpuJobKind job) { return static_cast<size_t>(job); }
+}  // namespace
+
+TEST(CpuAttributionTest, ScopeColumnFamily) {
+  CpuAttributionCounters cf;
+  ASSERT_EQ(nullptr, CpuJobScope::CurrentColumnFamily());
+  {
+    CpuJobScope compaction(CpuJobKind::kCompaction);
+    ASSERT_EQ(nullptr, CpuJobScope::CurrentColumnFamily());
+    {
+      CpuJobScope sub(CpuJobKind::kCompaction, &cf);
+      ASSERT_EQ(&cf, CpuJobScope::CurrentColumnFamily());
+      {
+        CpuJobScope build(CpuJobKind::kTableBuild);
+        ASSERT_EQ(&cf, CpuJobScope::CurrentColumnFamily());
+      }
+    }
+    ASSERT_EQ(nullptr, CpuJobScope::CurrentColumnFamily());
+  }
+  ASSERT_EQ(nullptr, CpuJobScope::CurrentColumnFamily());
+
+  CpuAttributionStats stats;
+  cf.AddTo(&stats);
+  ASSERT_EQ(1, stats.jobs[Index(CpuJobKind::kCompaction)]);
+  ASSERT_EQ(1, stats.jobs[Index(CpuJobKind::kTableBuild)]);
+  ASSERT_EQ(0, stats.jobs[Index(CpuJobKind::kFlush)]);
+}
+
+TEST(CpuAttributionTest, Charge) {
+  if (Env::Default()->NowCPUNanos() == 0) {
+    fprintf(stderr, "SKIPPED, no thread CPU clock\n");
+    return;
+  }
+  const uint64_t kNanos = 20 * 1000 * 1000;
+  CpuAttributionStats before;
+  GetCpuAttributionStats(&before);
+  CpuAttributionCounters cf;
+  // Not in a scope, not charged
+  Spin(kNanos);
+  {
+    CpuJobScope flush(CpuJobKind::kFlush);
+    Spin(kNanos);
+    {
+      // Charged to the inner scope only
+      CpuJobScope gc(CpuJobKind::kGC, &cf);
+      Spin(kNanos);
+    }
+  }
+  CpuAttributionStats after;
+  GetCpuAttributionStats(&after);
+
+  size_t flush = Index(CpuJobKind::kFlush);
+  size_t gc = Index(CpuJobKind::kGC);
+  ASSERT_EQ(1, after.jobs[flush] - before.jobs[flush]);
+  ASSERT_EQ(1, after.jobs[gc] - before.jobs[gc]);
+  uint64_t flush_cpu = after.cpu_nanos[flush] - before.cpu_nanos[flush];
+  uint64_t gc_cpu = after.cpu_nanos[gc] - before.cpu_nanos[gc];
+  ASSERT_GE(flush_cpu, kNanos);
+  ASSERT_LT(flush_cpu, 2 * kNanos);
+  ASSERT_GE(gc_cpu, kNanos);
+  ASSERT_GT(after.wall_nanos[gc] - before.wall_nanos[gc], 0);
+
+  CpuAttributionStats cf_stats;
+  cf.AddTo(&cf_stats);
+  ASSERT_EQ(0, cf_stats.cpu_nanos[flush]);
+  ASSERT_EQ(gc_cpu, cf_stats.cpu_nanos[gc]);
+
+  std::string summary = after.ToString(before);
+  ASSERT_NE(std::string::npos, summary.find("flush"));
+  ASSERT_NE(std::string::npos, summary.find("gc"));
+  ASSERT_EQ(std::string::npos, summary.find("zone_migration"));
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -12,6 +12,8 @@ namespace TERARKDB_NAMESPACE {
 static const uint32_t kFileReadSampleRate = 1024;
 extern bool should_sample_file_read();
 extern void sample_file_read_inc(FileMetaData*);
+extern void sample_file_write_inc(FileMetaData*);
+extern void sample_file_blob_fetch_inc(FileMetaData*);
 
 inline bool should_sample_file_read() {
   return (Random::GetTLSInstance()->Next() % kFileReadSampleRate == 307);
@@ -21,4 +23,14 @@ inline void sample_file_read_inc(FileMetaData* meta) {
   meta->stats.num_reads_sampled.fetch_add(kFileReadSampleRate,
                                           std::memory_order_relaxed);
 }
+
+inline void sample_file_write_inc(FileMetaData* meta) {
+  meta->stats.num_writes_sampled.fetch_add(kFileReadSampleRate,
+                                           std::memory_order_relaxed);
+}
+
+inline void sample_file_blob_fetch_inc(FileMetaData* meta) {
+  meta->stats.num_blob_fetches_sampled.fetch_add(kFileReadSampleRate,
+                                                 std::memory_order_relaxed);
+}
 }  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,179 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "monitoring/io_attribution.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/core_local.h"
+#include "util/filename.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+thread_local IOJobKind current_io_job = IOJobKind::kUser;
+
+struct IOAttributionCounters {
+  std::atomic<uint64_t> ops[IOAttributionStats::kNumEntries];
+  std::atomic<uint64_t> bytes[IOAttributionStats::kNumEntries];
+
+  IOAttributionCounters() {
+    for (size_t i = 0; i < IOAttributionStats::kNumEntries; ++i) {
+      ops[i].store(0, std::memory_order_relaxed);
+      bytes[i].store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+// Leaked on purpose, files may still be read and written by static
+// destructors
+CoreLocalArray<IOAttributionCounters>* GetIOAttributionCounters() {
+  static auto* counters = new CoreLocalArray<IOAttributionCounters>();
+  return counters;
+}
+}  // namespace
+
+const char* IOFileKindName(IOFileKind kind) {
+  switch (kind) {
+    case IOFileKind::kWAL:
+      return "wal";
+    case IOFileKind::kManifest:
+      return "manifest";
+    case IOFileKind::kL0:
+      return "l0";
+    case IOFileKind::kLn:
+      return "ln";
+    case IOFileKind::kBlob:
+      return "blob";
+    case IOFileKind::kMap:
+      return "map";
+    default:
+      return "other";
+  }
+}
+
+const char* IOJobKindName(IOJobKind kind) {
+  switch (kind) {
+    case IOJobKind::kFlush:
+      return "flush";
+    case IOJobKind::kCompaction:
+      return "compaction";
+    case IOJobKind::kGC:
+      return "gc";
+    default:
+      return "user";
+  }
+}
+
+const char* IOOpKindName(IOOpKind kind) {
+  return kind == IOOpKind::kRead ? "read" : "write";
+}
+
+IOFileKind IOFileKindFromName(const std::string& fname) {
+  size_t slash = fname.find_last_of('/');
+  std::string base =
+      slash == std::string::npos ? fname : fname.substr(slash + 1);
+  uint64_t number;
+  FileType type;
+  if (!ParseFileName(base, &number, &type)) {
+    return IOFileKind::kOther;
+  }
+  switch (type) {
+    case kLogFile:
+    case kValueLogFile:
+      return IOFileKind::kWAL;
+    case kDescriptorFile:
+      return IOFileKind::kManifest;
+    default:
+      return IOFileKind::kOther;
+  }
+}
+
+IOFileKind IOFileKindOfTable(int level, bool is_map_sst) {
+  if (is_map_sst) {
+    return IOFileKind::kMap;
+  }
+  if (level < 0) {
+    return IOFileKind::kBlob;
+  }
+  return level == 0 ? IOFileKind::kL0 : IOFileKind::kLn;
+}
+
+IOJobScope::IOJobScope(IOJobKind job) : prev_(current_io_job) {
+  current_io_job = job;
+}
+
+IOJobScope::~IOJobScope() { current_io_job = prev_; }
+
+IOJobKind IOJobScope::Current() {
+  return GCIOScope::Active() ? IOJobKind::kGC : current_io_job;
+}
+
+void RecordIOAttribution(IOFileKind file, IOOpKind op, uint64_t bytes) {
+  size_t index = IOAttributionStats::Index(file, IOJobScope::Current(), op);
+  IOAttributionCounters* counters = GetIOAttributionCounters()->Access();
+  counters->ops[index].fetch_add(1, std::memory_order_relaxed);
+  counters->bytes[index].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void GetIOAttributionStats(IOAttributionStats* stats) {
+  *stats = IOAttributionStats();
+  CoreLocalArray<IOAttributionCounters>* array = GetIOAttributionCounters();
+  for (size_t core = 0; core < array->Size(); ++core) {
+    IOAttributionCounters* counters = array->AccessAtCore(core);
+    for (size_t i = 0; i < IOAttributionStats::kNumEntries; ++i) {
+      stats->ops[i] += counters->ops[i].load(std::memory_order_relaxed);
+      stats->bytes[i] += counters->bytes[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+std::string IOAttributionStats::ToString(const IOAttributionStats& prev,
+                                         uint64_t micros) const {
+  const double seconds = std::max<uint64_t>(micros, 1) / 1000000.0;
+  std::string out;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-8s %-10s %-5s %12s %12s %10s\n", "File", "Job",
+           "Op", "Ops", "MB", "MB/s");
+  out.append(buf);
+  uint64_t total_bytes[static_cast<size_t>(IOOpKind::kNumKinds)] = {};
+  for (size_t f = 0; f < static_cast<size_t>(IOFileKind::kNumKinds); ++f) {
+    for (size_t j = 0; j < static_cast<size_t>(IOJobKind::kNumKinds); ++j) {
+      for (size_t o = 0; o < static_cast<size_t>(IOOpKind::kNumKinds); ++o) {
+        auto file = static_cast<IOFileKind>(f);
+        auto job = static_cast<IOJobKind>(j);
+        auto op = static_cast<IOOpKind>(o);
+        size_t i = Index(file, job, op);
+        uint64_t num_ops = ops[i] - prev.ops[i];
+        if (num_ops == 0) {
+          continue;
+        }
+        uint64_t num_bytes = bytes[i] - prev.bytes[i];
+        total_bytes[o] += num_bytes;
+        snprintf(buf, sizeof(buf),
+                 "%-8s %-10s %-5s %12" PRIu64 " %12.1f %10.2f\n",
+                 IOFileKindName(file), IOJobKindName(job), IOOpKindName(op),
+                 num_ops, num_bytes / 1048576.0,
+                 num_bytes / 1048576.0 / seconds);
+        out.append(buf);
+      }
+    }
+  }
+  snprintf(buf, sizeof(buf),
+           "Total: read %.1f MB, write %.1f MB in %.1f seconds\n",
+           total_bytes[static_cast<size_t>(IOOpKind::kRead)] / 1048576.0,
+           total_bytes[static_cast<size_t>(IOOpKind::kWrite)] / 1048576.0,
+           seconds);
+  out.append(buf);
+  return out;
+}
+
+}  // namespace TERARKDB_NAMESPACE
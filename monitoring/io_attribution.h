@@ -0,0 +1,102 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+// Always-on attribution of the file I/O issued through RandomAccessFileReader
+// and WritableFileWriter. Every read and write is counted, in operations and
+// bytes, under the kind of the file and the kind of job that the calling
+// thread runs. The counters are process wide and core local, so recording is
+// two relaxed atomic adds. DBImpl::DumpStats() logs the counters and feeds
+// them to the metrics reporters.
+
+enum class IOFileKind : uint8_t {
+  kOther,
+  kWAL,
+  kManifest,
+  kL0,
+  kLn,
+  kBlob,
+  kMap,
+  kNumKinds,
+};
+
+enum class IOJobKind : uint8_t {
+  kUser,
+  kFlush,
+  kCompaction,
+  kGC,
+  kNumKinds,
+};
+
+enum class IOOpKind : uint8_t {
+  kRead,
+  kWrite,
+  kNumKinds,
+};
+
+extern const char* IOFileKindName(IOFileKind kind);
+extern const char* IOJobKindName(IOJobKind kind);
+extern const char* IOOpKindName(IOOpKind kind);
+
+// The kind of a file told by its name. Table files are kOther, only the
+// place opening them knows their level, see IOFileKindOfTable().
+extern IOFileKind IOFileKindFromName(const std::string& fname);
+
+// The kind of a table file. Level -1 holds the dependence (blob) files.
+extern IOFileKind IOFileKindOfTable(int level, bool is_map_sst);
+
+// While alive, the I/O of the calling thread is attributed to `job`. Scopes
+// nest. I/O inside a GCIOScope is always attributed to IOJobKind::kGC.
+class IOJobScope {
+ public:
+  explicit IOJobScope(IOJobKind job);
+  ~IOJobScope();
+
+  IOJobScope(const IOJobScope&) = delete;
+  IOJobScope& operator=(const IOJobScope&) = delete;
+
+  // The job the I/O of the calling thread is attributed to
+  static IOJobKind Current();
+
+ private:
+  IOJobKind prev_;
+};
+
+extern void RecordIOAttribution(IOFileKind file, IOOpKind op, uint64_t bytes);
+
+struct IOAttributionStats {
+  static const size_t kNumEntries =
+      static_cast<size_t>(IOFileKind::kNumKinds) *
+      static_cast<size_t>(IOJobKind::kNumKinds) *
+      static_cast<size_t>(IOOpKind::kNumKinds);
+
+  static size_t Index(IOFileKind file, IOJobKind job, IOOpKind op) {
+    const size_t num_jobs = static_cast<size_t>(IOJobKind::kNumKinds);
+    const size_t num_ops = static_cast<size_t>(IOOpKind::kNumKinds);
+    return (static_cast<size_t>(file) * num_jobs + static_cast<size_t>(job)) *
+               num_ops +
+           static_cast<size_t>(op);
+  }
+
+  uint64_t ops[kNumEntries] = {};
+  uint64_t bytes[kNumEntries] = {};
+
+  // Tabulate the I/O done since `prev`, skipping the empty entries. `micros`
+  // is the time between the two snapshots, used for the rates.
+  std::string ToString(const IOAttributionStats& prev, uint64_t micros) const;
+};
+
+// Sum the counters of all cores
+extern void GetIOAttributionStats(IOAttributionStats* stats);
+
+}  // namespace TERARKDB_NAMESPACE
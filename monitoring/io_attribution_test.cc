@@ -0,0 +1,83 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "monitoring/io_attribution.h"
+
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+TEST(IOAttributionTest, FileKind) {
+  ASSERT_EQ(IOFileKind::kWAL, IOFileKindFromName("/db/000012.log"));
+  ASSERT_EQ(IOFileKind::kManifest, IOFileKindFromName("/db/MANIFEST-000003"));
+  ASSERT_EQ(IOFileKind::kOther, IOFileKindFromName("/db/000015.sst"));
+  ASSERT_EQ(IOFileKind::kOther, IOFileKindFromName("/db/CURRENT"));
+  ASSERT_EQ(IOFileKind::kOther, IOFileKindFromName("not a db file"));
+
+  ASSERT_EQ(IOFileKind::kL0, IOFileKindOfTable(0, false));
+  ASSERT_EQ(IOFileKind::kLn, IOFileKindOfTable(3, false));
+  ASSERT_EQ(IOFileKind::kBlob, IOFileKindOfTable(-1, false));
+  ASSERT_EQ(IOFileKind::kMap, IOFileKindOfTable(2, true));
+}
+
+TEST(IOAttributionTest, JobScope) {
+  ASSERT_EQ(IOJobKind::kUser, IOJobScope::Current());
+  {
+    IOJobScope compaction(IOJobKind::kCompaction);
+    ASSERT_EQ(IOJobKind::kCompaction, IOJobScope::Current());
+    {
+      IOJobScope flush(IOJobKind::kFlush);
+      ASSERT_EQ(IOJobKind::kFlush, IOJobScope::Current());
+    }
+    ASSERT_EQ(IOJobKind::kCompaction, IOJobScope::Current());
+    {
+      GCIOScope gc;
+      ASSERT_EQ(IOJobKind::kGC, IOJobScope::Current());
+    }
+    ASSERT_EQ(IOJobKind::kCompaction, IOJobScope::Current());
+  }
+  ASSERT_EQ(IOJobKind::kUser, IOJobScope::Current());
+}
+
+TEST(IOAttributionTest, Record) {
+  IOAttributionStats before;
+  GetIOAttributionStats(&before);
+  RecordIOAttribution(IOFileKind::kWAL, IOOpKind::kWrite, 100);
+  RecordIOAttribution(IOFileKind::kWAL, IOOpKind::kWrite, 28);
+  {
+    IOJobScope compaction(IOJobKind::kCompaction);
+    RecordIOAttribution(IOFileKind::kLn, IOOpKind::kRead, 4096);
+  }
+  IOAttributionStats after;
+  GetIOAttributionStats(&after);
+
+  size_t wal = IOAttributionStats::Index(IOFileKind::kWAL, IOJobKind::kUser,
+                                         IOOpKind::kWrite);
+  size_t ln = IOAttributionStats::Index(
+      IOFileKind::kLn, IOJobKind::kCompaction, IOOpKind::kRead);
+  ASSERT_EQ(2, after.ops[wal] - before.ops[wal]);
+  ASSERT_EQ(128, after.bytes[wal] - before.bytes[wal]);
+  ASSERT_EQ(1, after.ops[ln] - before.ops[ln]);
+  ASSERT_EQ(4096, after.bytes[ln] - before.bytes[ln]);
+  for (size_t i = 0; i < IOAttributionStats::kNumEntries; ++i) {
+    if (i != wal && i != ln) {
+      ASSERT_EQ(before.ops[i], after.ops[i]);
+    }
+  }
+
+  std::string summary = after.ToString(before, 1000000);
+  ASSERT_NE(std::string::npos, summary.find("wal"));
+  ASSERT_NE(std::string::npos, summary.find("compaction"));
+  ASSERT_EQ(std::string::npos, summary.find("flush"));
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -63,6 +63,17 @@ void PerfContext::Reset() {
   get_from_memtable_count = 0;
   get_post_process_time = 0;
   get_from_output_files_time = 0;
+  blob_lineage_resolve_count = 0;
+  blob_lineage_hop_count = 0;
+  blob_fetch_count = 0;
+  blob_fetch_nanos = 0;
+  map_sst_get_count = 0;
+  map_sst_hop_count = 0;
+  map_sst_seek_link_nanos = 0;
+  dependence_iter_create_count = 0;
+  dependence_iter_create_nanos = 0;
+  terark_zip_index_nanos = 0;
+  terark_zip_store_nanos = 0;
   seek_on_memtable_time = 0;
   seek_on_memtable_count = 0;
   next_on_memtable_count = 0;
@@ -169,6 +180,17 @@ std::string PerfContext::ToString(bool exclude_zero_counters) const {
   PERF_CONTEXT_OUTPUT(get_from_memtable_count);
   PERF_CONTEXT_OUTPUT(get_post_process_time);
   PERF_CONTEXT_OUTPUT(get_from_output_files_time);
+  PERF_CONTEXT_OUTPUT(blob_lineage_resolve_count);
+  PERF_CONTEXT_OUTPUT(blob_lineage_hop_count);
+  PERF_CONTEXT_OUTPUT(blob_fetch_count);
+  PERF_CONTEXT_OUTPUT(blob_fetch_nanos);
+  PERF_CONTEXT_OUTPUT(map_sst_get_count);
+  PERF_CONTEXT_OUTPUT(map_sst_hop_count);
+  PERF_CONTEXT_OUTPUT(map_sst_seek_link_nanos);
+  PERF_CONTEXT_OUTPUT(dependence_iter_create_count);
+  PERF_CONTEXT_OUTPUT(dependence_iter_create_nanos);
+  PERF_CONTEXT_OUTPUT(terark_zip_index_nanos);
+  PERF_CONTEXT_OUTPUT(terark_zip_store_nanos);
   PERF_CONTEXT_OUTPUT(seek_on_memtable_time);
   PERF_CONTEXT_OUTPUT(seek_on_memtable_count);
   PERF_CONTEXT_OUTPUT(next_on_memtable_count);
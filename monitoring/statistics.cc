@@ -141,6 +141,26 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
     {GC_SKIP_GET_BY_FILE, "rocksdb.num.gc.skip_by_file_meta"},
     {READ_BLOB_VALID, "rocksdb.num.read.blob_valid"},
     {READ_BLOB_INVALID, "rocksdb.num.read.blob_invalid"},
+    {BLOCK_CACHE_SECONDARY_HIT, "rocksdb.block.cache.secondary.hit"},
+    {BLOCK_CACHE_SECONDARY_MISS, "rocksdb.block.cache.secondary.miss"},
+    {ITER_SEPARATED_VALUE_NOT_FETCHED,
+     "rocksdb.iter.separated.value.not.fetched"},
+    {BLOB_CACHE_HIT, "rocksdb.blob.cache.hit"},
+    {BLOB_CACHE_MISS, "rocksdb.blob.cache.miss"},
+    {TABLE_MMAP_RESIDENT_BYTES_AT_OPEN,
+     "rocksdb.table.mmap.resident.bytes.at.open"},
+    {TABLE_MMAP_PRETOUCH_BYTES, "rocksdb.table.mmap.pretouch.bytes"},
+    {TABLE_MMAP_HUGE_PAGE_BYTES, "rocksdb.table.mmap.huge.page.bytes"},
+    {ASYNC_LISTENER_EVENTS_DROPPED, "rocksdb.async.listener.events.dropped"},
+    {ASYNC_LISTENER_EVENTS_BLOCKED, "rocksdb.async.listener.events.blocked"},
+    {VALUE_LOG_BYTES_WRITTEN, "rocksdb.value.log.bytes.written"},
+    {GC_PROBE_BY_ITERATOR, "rocksdb.num.gc.probe_by_iterator"},
+    {RESOURCE_GROUP_READ_WAIT_MICROS,
+     "rocksdb.resource.group.read.wait.micros"},
+    {RESOURCE_GROUP_WRITE_WAIT_MICROS,
+     "rocksdb.resource.group.write.wait.micros"},
+    {RESOURCE_GROUP_BACKGROUND_WAIT_MICROS,
+     "rocksdb.resource.group.background.wait.micros"},
 };
 
 const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
@@ -206,6 +226,8 @@ const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
 
     {ZNS_PICK_GARBAGE_COLLECTION_TIME, "rocksdb.db.zns.pick_gc.micros"},
     {BUILD_VERSION_TIME, "rocksdb.build.version.micros"},
+    {ASYNC_LISTENER_QUEUE_MICROS, "rocksdb.async.listener.queue.micros"},
+    {ASYNC_LISTENER_CALLBACK_MICROS, "rocksdb.async.listener.callback.micros"},
 };
 
 std::shared_ptr<Statistics> CreateDBStatistics() {
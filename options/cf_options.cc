@@ -11,6 +11,7 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 #include <string>
@@ -82,9 +83,19 @@ ImmutableCFOptions::ImmutableCFOptions(const ImmutableDBOptions& db_options,
       preserve_deletes(db_options.preserve_deletes),
       listeners(db_options.listeners),
       row_cache(db_options.row_cache),
+      blob_cache(cf_options.blob_cache),
+      blob_cache_admit_on_second_access(
+          cf_options.blob_cache_admit_on_second_access),
+      resource_group(cf_options.resource_group),
+      hot_block_sample_interval(db_options.hot_block_sample_interval),
+      table_cache_memory_budget(db_options.table_cache_memory_budget),
+      table_cache_numshardbits(db_options.table_cache_numshardbits),
+      pin_table_reader_on_first_access(
+          db_options.pin_table_reader_on_first_access),
       memtable_insert_with_hint_prefix_extractor(
           cf_options.memtable_insert_with_hint_prefix_extractor.get()),
-      cf_paths(cf_options.cf_paths) {
+      cf_paths(cf_options.cf_paths),
+      hot_data_ratio(cf_options.hot_data_ratio) {
   if (ttl_extractor_factory != nullptr) {
     int_tbl_prop_collector_factories_for_blob = std::make_shared<
         std::vector<std::unique_ptr<IntTblPropCollectorFactory>>>();
@@ -137,6 +148,21 @@ uint64_t MaxBlobSize(const MutableCFOptions& cf_options, int num_levels,
   return target_blob_file_size;
 }
 
+uint64_t BlobFragmentSize(const MutableCFOptions& cf_options, int num_levels,
+                          CompactionStyle compaction_style) {
+  if (cf_options.blob_file_defragment_size != 0) {
+    return cf_options.blob_file_defragment_size;
+  }
+  return MaxBlobSize(cf_options, num_levels, compaction_style) / 8;
+}
+
+uint64_t ZoneAlignedFileSize(uint64_t zone_capacity) {
+  // The blocks written once the target is reached take the rest
+  const uint64_t kAlign = 4096;
+  uint64_t size = zone_capacity - zone_capacity / 32;
+  return std::max(size / kAlign * kAlign, kAlign);
+}
+
 void MutableCFOptions::RefreshDerivedOptions(int num_levels) {
   max_file_size.resize(num_levels);
   max_file_size[0] = 0;  // unlimited
@@ -178,6 +204,8 @@ void MutableCFOptions::Dump(Logger* log) const {
                  arena_block_size);
   ROCKS_LOG_INFO(log, "              memtable_prefix_bloom_ratio: %f",
                  memtable_prefix_bloom_size_ratio);
+  ROCKS_LOG_INFO(log, "             memtable_whole_key_filtering: %d",
+                 memtable_whole_key_filtering);
   ROCKS_LOG_INFO(log,
                  "                  memtable_huge_page_size: %" ROCKSDB_PRIszt,
                  memtable_huge_page_size);
@@ -194,12 +222,21 @@ void MutableCFOptions::Dump(Logger* log) const {
                  disable_auto_compactions);
   ROCKS_LOG_INFO(log, "                       max_subcompactions: %u",
                  max_subcompactions);
+  ROCKS_LOG_INFO(log, "                     max_flush_partitions: %u",
+                 max_flush_partitions);
+  ROCKS_LOG_INFO(log,
+                 "           atomic_flush_inline_value_size: %" PRIu64,
+                 atomic_flush_inline_value_size);
   ROCKS_LOG_INFO(log, "                                blob_size: %zd",
                  blob_size);
   ROCKS_LOG_INFO(log, "                     blob_large_key_ratio: %f",
                  blob_large_key_ratio);
+  ROCKS_LOG_INFO(log, "                 adaptive_blob_separation: %d",
+                 adaptive_blob_separation);
   ROCKS_LOG_INFO(log, "                            blob_gc_ratio: %f",
                  blob_gc_ratio);
+  ROCKS_LOG_INFO(log, "                       blob_partition_num: %u",
+                 blob_partition_num);
   ROCKS_LOG_INFO(log, "                    target_blob_file_size: %" PRIu64,
                  target_blob_file_size);
   ROCKS_LOG_INFO(log, "                blob_file_defragment_size: %" PRIu64,
@@ -208,6 +245,12 @@ void MutableCFOptions::Dump(Logger* log) const {
                  max_dependence_blob_overlap);
   ROCKS_LOG_INFO(log, "                     maintainer_job_ratio: %f",
                  maintainer_job_ratio);
+  ROCKS_LOG_INFO(log, "         lazy_compaction_read_heat_weight: %f",
+                 lazy_compaction_read_heat_weight);
+  ROCKS_LOG_INFO(log, "         remote_compaction_min_input_size: %" PRIu64,
+                 remote_compaction_min_input_size);
+  ROCKS_LOG_INFO(log, "       remote_compaction_max_pending_jobs: %" PRIu64,
+                 remote_compaction_max_pending_jobs);
   ROCKS_LOG_INFO(log, "      soft_pending_compaction_bytes_limit: %" PRIu64,
                  soft_pending_compaction_bytes_limit);
   ROCKS_LOG_INFO(log, "      hard_pending_compaction_bytes_limit: %" PRIu64,
@@ -218,6 +261,12 @@ void MutableCFOptions::Dump(Logger* log) const {
                  level0_slowdown_writes_trigger);
   ROCKS_LOG_INFO(log, "               level0_stop_writes_trigger: %d",
                  level0_stop_writes_trigger);
+  ROCKS_LOG_INFO(log, "                level0_stall_by_sublevels: %d",
+                 level0_stall_by_sublevels);
+  ROCKS_LOG_INFO(log, "                flush_to_bottommost_level: %d",
+                 flush_to_bottommost_level);
+  ROCKS_LOG_INFO(log, "                compaction_filter_threads: %" PRIu32,
+                 compaction_filter_threads);
   ROCKS_LOG_INFO(log, "                     max_compaction_bytes: %" PRIu64,
                  max_compaction_bytes);
   ROCKS_LOG_INFO(log, "                    target_file_size_base: %" PRIu64,
@@ -232,6 +281,10 @@ void MutableCFOptions::Dump(Logger* log) const {
                  ttl_gc_ratio);
   ROCKS_LOG_INFO(log, "                         ttl_max_scan_gap: %zd",
                  ttl_max_scan_gap);
+  ROCKS_LOG_INFO(log, "                   ttl_drop_expired_files: %d",
+                 ttl_drop_expired_files);
+  ROCKS_LOG_INFO(log, "              blob_compression_per_record: %d",
+                 blob_compression_per_record);
   std::string result;
   char buf[10];
   for (const auto m : max_bytes_for_level_multiplier_additional) {
@@ -256,6 +309,8 @@ void MutableCFOptions::Dump(Logger* log) const {
                  optimize_filters_for_hits);
   ROCKS_LOG_INFO(log, "                  optimize_range_deletion: %d",
                  optimize_range_deletion);
+  ROCKS_LOG_INFO(log, " prefetch_index_and_filter_hot_file_ratio: %f",
+                 prefetch_index_and_filter_hot_file_ratio);
   ROCKS_LOG_INFO(log, "                              compression: %d",
                  static_cast<int>(compression));
 
@@ -277,6 +332,8 @@ void MutableCFOptions::Dump(Logger* log) const {
   ROCKS_LOG_INFO(
       log, "compaction_options_universal.allow_trivial_move : %d",
       static_cast<int>(compaction_options_universal.allow_trivial_move));
+  ROCKS_LOG_INFO(log, "compaction_options_universal.time_window : %" PRIu64,
+                 compaction_options_universal.time_window);
 }
 
 MutableCFOptions::MutableCFOptions(const ColumnFamilyOptions& options, Env* env)
@@ -286,19 +343,30 @@ MutableCFOptions::MutableCFOptions(const ColumnFamilyOptions& options, Env* env)
       memtable_factory(options.memtable_factory),
       memtable_prefix_bloom_size_ratio(
           options.memtable_prefix_bloom_size_ratio),
+      memtable_whole_key_filtering(options.memtable_whole_key_filtering),
       memtable_huge_page_size(options.memtable_huge_page_size),
       max_successive_merges(options.max_successive_merges),
       inplace_update_num_locks(options.inplace_update_num_locks),
       prefix_extractor(options.prefix_extractor),
       disable_auto_compactions(options.disable_auto_compactions),
       max_subcompactions(options.max_subcompactions),
+      max_flush_partitions(options.max_flush_partitions),
+      atomic_flush_inline_value_size(options.atomic_flush_inline_value_size),
       blob_size(options.blob_size),
       blob_large_key_ratio(options.blob_large_key_ratio),
+      adaptive_blob_separation(options.adaptive_blob_separation),
       blob_gc_ratio(options.blob_gc_ratio),
+      blob_partition_num(options.blob_partition_num),
       target_blob_file_size(options.target_blob_file_size),
       blob_file_defragment_size(options.blob_file_defragment_size),
       max_dependence_blob_overlap(options.max_dependence_blob_overlap),
       maintainer_job_ratio(options.maintainer_job_ratio),
+      lazy_compaction_read_heat_weight(
+          options.lazy_compaction_read_heat_weight),
+      remote_compaction_min_input_size(
+          options.remote_compaction_min_input_size),
+      remote_compaction_max_pending_jobs(
+          options.remote_compaction_max_pending_jobs),
       soft_pending_compaction_bytes_limit(
           options.soft_pending_compaction_bytes_limit),
       hard_pending_compaction_bytes_limit(
@@ -307,6 +375,9 @@ MutableCFOptions::MutableCFOptions(const ColumnFamilyOptions& options, Env* env)
           options.level0_file_num_compaction_trigger),
       level0_slowdown_writes_trigger(options.level0_slowdown_writes_trigger),
       level0_stop_writes_trigger(options.level0_stop_writes_trigger),
+      level0_stall_by_sublevels(options.level0_stall_by_sublevels),
+      flush_to_bottommost_level(options.flush_to_bottommost_level),
+      compaction_filter_threads(options.compaction_filter_threads),
       max_compaction_bytes(options.max_compaction_bytes),
       target_file_size_base(options.target_file_size_base),
       target_file_size_multiplier(options.target_file_size_multiplier),
@@ -321,9 +392,13 @@ MutableCFOptions::MutableCFOptions(const ColumnFamilyOptions& options, Env* env)
       report_bg_io_stats(options.report_bg_io_stats),
       optimize_filters_for_hits(options.optimize_filters_for_hits),
       optimize_range_deletion(options.optimize_range_deletion),
+      prefetch_index_and_filter_hot_file_ratio(
+          options.prefetch_index_and_filter_hot_file_ratio),
       compression(options.compression),
       ttl_gc_ratio(options.ttl_gc_ratio),
-      ttl_max_scan_gap(options.ttl_max_scan_gap) {
+      ttl_max_scan_gap(options.ttl_max_scan_gap),
+      ttl_drop_expired_files(options.ttl_drop_expired_files),
+      blob_compression_per_record(options.blob_compression_per_record) {
   RefreshDerivedOptions(options.num_levels);
 
   int_tbl_prop_collector_factories = std::make_shared<
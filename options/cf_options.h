@@ -129,10 +129,31 @@ struct ImmutableCFOptions {
 
   std::shared_ptr<Cache> row_cache;
 
+  std::shared_ptr<Cache> blob_cache;
+
+  bool blob_cache_admit_on_second_access;
+
+  std::shared_ptr<ResourceGroup> resource_group;
+
+  // Block based tables sample one out of hot_block_sample_interval foreground
+  // data block reads, 0 disables the sampling
+  uint32_t hot_block_sample_interval;
+
+  // Table readers are charged to the table cache by their memory usage if
+  // non-zero, see DBOptions::table_cache_memory_budget
+  uint64_t table_cache_memory_budget;
+
+  int table_cache_numshardbits;
+
+  // See DBOptions::pin_table_reader_on_first_access
+  bool pin_table_reader_on_first_access;
+
   const SliceTransform* memtable_insert_with_hint_prefix_extractor;
 
   std::vector<DbPath> cf_paths;
 
+  double hot_data_ratio;
+
   std::shared_ptr<std::vector<std::unique_ptr<IntTblPropCollectorFactory>>>
       int_tbl_prop_collector_factories_for_blob;
 };
@@ -150,24 +171,35 @@ struct MutableCFOptions {
         max_write_buffer_number(0),
         arena_block_size(0),
         memtable_prefix_bloom_size_ratio(0),
+        memtable_whole_key_filtering(false),
         memtable_huge_page_size(0),
         max_successive_merges(0),
         inplace_update_num_locks(0),
         prefix_extractor(nullptr),
         disable_auto_compactions(false),
         max_subcompactions(0),
+        max_flush_partitions(1),
+        atomic_flush_inline_value_size(0),
         blob_size(0),
         blob_large_key_ratio(0),
+        adaptive_blob_separation(false),
         blob_gc_ratio(0),
+        blob_partition_num(0),
         target_blob_file_size(0),
         blob_file_defragment_size(0),
         max_dependence_blob_overlap(0),
         maintainer_job_ratio(0),
+        lazy_compaction_read_heat_weight(0),
+        remote_compaction_min_input_size(0),
+        remote_compaction_max_pending_jobs(0),
         soft_pending_compaction_bytes_limit(0),
         hard_pending_compaction_bytes_limit(0),
         level0_file_num_compaction_trigger(0),
         level0_slowdown_writes_trigger(0),
         level0_stop_writes_trigger(0),
+        level0_stall_by_sublevels(false),
+        flush_to_bottommost_level(false),
+        compaction_filter_threads(0),
         max_compaction_bytes(0),
         target_file_size_base(0),
         target_file_size_multiplier(0),
@@ -178,9 +210,12 @@ struct MutableCFOptions {
         report_bg_io_stats(false),
         optimize_filters_for_hits(false),
         optimize_range_deletion(false),
+        prefetch_index_and_filter_hot_file_ratio(1.0),
         compression(Snappy_Supported() ? kSnappyCompression : kNoCompression),
         ttl_gc_ratio(1.000),
-        ttl_max_scan_gap(0) {}
+        ttl_max_scan_gap(0),
+        ttl_drop_expired_files(false),
+        blob_compression_per_record(false) {}
 
   explicit MutableCFOptions(const Options& options);
 
@@ -209,6 +244,7 @@ struct MutableCFOptions {
   size_t arena_block_size;
   std::shared_ptr<MemTableRepFactory> memtable_factory;
   double memtable_prefix_bloom_size_ratio;
+  bool memtable_whole_key_filtering;
   size_t memtable_huge_page_size;
   size_t max_successive_merges;
   size_t inplace_update_num_locks;
@@ -217,18 +253,28 @@ struct MutableCFOptions {
   // Compaction related options
   bool disable_auto_compactions;
   uint32_t max_subcompactions;
+  uint32_t max_flush_partitions;
+  uint64_t atomic_flush_inline_value_size;
   size_t blob_size;
   double blob_large_key_ratio;
+  bool adaptive_blob_separation;
   double blob_gc_ratio;
+  uint32_t blob_partition_num;
   uint64_t target_blob_file_size;
   uint64_t blob_file_defragment_size;
   size_t max_dependence_blob_overlap;
   double maintainer_job_ratio;
+  double lazy_compaction_read_heat_weight;
+  uint64_t remote_compaction_min_input_size;
+  uint64_t remote_compaction_max_pending_jobs;
   uint64_t soft_pending_compaction_bytes_limit;
   uint64_t hard_pending_compaction_bytes_limit;
   int level0_file_num_compaction_trigger;
   int level0_slowdown_writes_trigger;
   int level0_stop_writes_trigger;
+  bool level0_stall_by_sublevels;
+  bool flush_to_bottommost_level;
+  uint32_t compaction_filter_threads;
   uint64_t max_compaction_bytes;
   uint64_t target_file_size_base;
   int target_file_size_multiplier;
@@ -244,6 +290,7 @@ struct MutableCFOptions {
 
   bool optimize_filters_for_hits;
   bool optimize_range_deletion;
+  double prefetch_index_and_filter_hot_file_ratio;
   CompressionType compression;
 
   // Derived options
@@ -252,6 +299,8 @@ struct MutableCFOptions {
 
   double ttl_gc_ratio;
   size_t ttl_max_scan_gap;
+  bool ttl_drop_expired_files;
+  bool blob_compression_per_record;
 
   std::shared_ptr<std::vector<std::unique_ptr<IntTblPropCollectorFactory>>>
       int_tbl_prop_collector_factories;
@@ -268,4 +317,13 @@ uint64_t MaxFileSizeForLevel(const MutableCFOptions& cf_options, int level,
 uint64_t MaxBlobSize(const MutableCFOptions& cf_options, int num_levels,
                      CompactionStyle compaction_style);
 
+// Blob files holding less live data than this are merged by GC, see
+// ColumnFamilyOptions::blob_file_defragment_size
+uint64_t BlobFragmentSize(const MutableCFOptions& cf_options, int num_levels,
+                          CompactionStyle compaction_style);
+
+// The target size of the files filling a zone of `zone_capacity` bytes, see
+// DBOptions::zenfs_zone_aligned_file_size
+uint64_t ZoneAlignedFileSize(uint64_t zone_capacity);
+
 }  // namespace TERARKDB_NAMESPACE
@@ -18,6 +18,8 @@
 #include "rocksdb/sst_file_manager.h"
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/wal_filter.h"
+#include "rocksdb/zone_victim_policy.h"
+#include "util/compression.h"
 #include "util/logging.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -32,6 +34,7 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       env(options.env),
       rate_limiter(options.rate_limiter),
       sst_file_manager(options.sst_file_manager),
+      background_coordinator(options.background_coordinator),
       info_log(options.info_log),
       info_log_level(options.info_log_level),
       max_file_opening_threads(options.max_file_opening_threads),
@@ -57,6 +60,7 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       use_direct_reads(options.use_direct_reads),
       use_direct_io_for_flush_and_compaction(
           options.use_direct_io_for_flush_and_compaction),
+      use_direct_io_for_wal(options.use_direct_io_for_wal),
       use_aio_reads(options.use_aio_reads),
       allow_fallocate(options.allow_fallocate),
       is_fd_close_on_exec(options.is_fd_close_on_exec),
@@ -92,8 +96,33 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       preserve_deletes(options.preserve_deletes),
       two_write_queues(options.two_write_queues),
       manual_wal_flush(options.manual_wal_flush),
+      async_wal_sync(options.async_wal_sync),
+      async_wal_sync_max_delay_us(options.async_wal_sync_max_delay_us),
+      wal_streams(options.wal_streams),
+      wal_compression(options.wal_compression),
+      wal_recovery_threads(options.wal_recovery_threads),
+      isolate_cf_write_stalls(options.isolate_cf_write_stalls),
       avoid_unnecessary_blocking_io(options.avoid_unnecessary_blocking_io),
-      persist_stats_to_disk(options.persist_stats_to_disk) {
+      persist_stats_to_disk(options.persist_stats_to_disk),
+      zenfs_zone_victim_policy(options.zenfs_zone_victim_policy),
+      zenfs_zone_aligned_file_size(options.zenfs_zone_aligned_file_size),
+      zenfs_gc_relocate_extents(options.zenfs_gc_relocate_extents),
+      partition_num(options.partition_num),
+      enable_hot_separation(options.enable_hot_separation),
+      hotness_sample_interval(options.hotness_sample_interval),
+      hotness_sample_reads(options.hotness_sample_reads),
+      hot_block_sample_interval(options.hot_block_sample_interval),
+      hot_block_set_persist_period_sec(
+          options.hot_block_set_persist_period_sec),
+      warm_block_cache_after_compaction(
+          options.warm_block_cache_after_compaction),
+      lazy_open_deep_sst(options.lazy_open_deep_sst),
+      table_cache_memory_budget(options.table_cache_memory_budget),
+      pin_table_reader_on_first_access(
+          options.pin_table_reader_on_first_access),
+      change_feed_buffer_size(options.change_feed_buffer_size),
+      value_log_threshold(options.value_log_threshold),
+      write_behind_buffers(options.write_behind_buffers) {
 }
 
 void ImmutableDBOptions::Dump(Logger* log) const {
@@ -146,6 +175,8 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                    "                       "
                    "Options.use_direct_io_for_flush_and_compaction: %d",
                    use_direct_io_for_flush_and_compaction);
+  ROCKS_LOG_HEADER(log, "                  Options.use_direct_io_for_wal: %d",
+                   use_direct_io_for_wal);
   ROCKS_LOG_HEADER(log, "                          Options.use_aio_reads: %d",
                    use_aio_reads);
   ROCKS_LOG_HEADER(log, "         Options.create_missing_column_families: %d",
@@ -204,6 +235,8 @@ void ImmutableDBOptions::Dump(Logger* log) const {
   Header(
       log, "    Options.sst_file_manager.rate_bytes_per_sec: %" PRIi64,
       sst_file_manager ? sst_file_manager->GetDeleteRateBytesPerSecond() : 0);
+  ROCKS_LOG_HEADER(log, "                 Options.background_coordinator: %p",
+                   background_coordinator.get());
   ROCKS_LOG_HEADER(log, "                      Options.wal_recovery_mode: %d",
                    int(wal_recovery_mode));
   ROCKS_LOG_HEADER(log, "                 Options.enable_thread_tracking: %d",
@@ -243,10 +276,63 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                    two_write_queues);
   ROCKS_LOG_HEADER(log, "                       Options.manual_wal_flush: %d",
                    manual_wal_flush);
+  ROCKS_LOG_HEADER(log, "                         Options.async_wal_sync: %d",
+                   async_wal_sync);
+  ROCKS_LOG_HEADER(log,
+                   "            Options.async_wal_sync_max_delay_us: %" PRIu64,
+                   async_wal_sync_max_delay_us);
+  ROCKS_LOG_HEADER(
+      log, "                            Options.wal_streams: %" ROCKSDB_PRIszt,
+      wal_streams);
+  ROCKS_LOG_HEADER(log, "                        Options.wal_compression: %s",
+                   CompressionTypeToString(wal_compression).c_str());
+  ROCKS_LOG_HEADER(
+      log, "                   Options.wal_recovery_threads: %" ROCKSDB_PRIszt,
+      wal_recovery_threads);
+  ROCKS_LOG_HEADER(log, "                Options.isolate_cf_write_stalls: %d",
+                   isolate_cf_write_stalls);
   ROCKS_LOG_HEADER(log, "          Options.avoid_unnecessary_blocking_io: %d",
                    avoid_unnecessary_blocking_io);
   ROCKS_LOG_HEADER(log, "                  Options.persist_stats_to_disk: %u",
                    persist_stats_to_disk);
+  ROCKS_LOG_HEADER(log, "               Options.zenfs_zone_victim_policy: %s",
+                   zenfs_zone_victim_policy ? zenfs_zone_victim_policy->Name()
+                                            : "None");
+  ROCKS_LOG_HEADER(log, "           Options.zenfs_zone_aligned_file_size: %d",
+                   zenfs_zone_aligned_file_size);
+  ROCKS_LOG_HEADER(log, "              Options.zenfs_gc_relocate_extents: %d",
+                   zenfs_gc_relocate_extents);
+  ROCKS_LOG_HEADER(log,
+                   "                          Options.partition_num: %" PRIu64,
+                   partition_num);
+  ROCKS_LOG_HEADER(log, "                  Options.enable_hot_separation: %d",
+                   enable_hot_separation);
+  ROCKS_LOG_HEADER(log, "                Options.hotness_sample_interval: %u",
+                   hotness_sample_interval);
+  ROCKS_LOG_HEADER(log, "                   Options.hotness_sample_reads: %d",
+                   hotness_sample_reads);
+  ROCKS_LOG_HEADER(log, "              Options.hot_block_sample_interval: %u",
+                   hot_block_sample_interval);
+  ROCKS_LOG_HEADER(log, "       Options.hot_block_set_persist_period_sec: %u",
+                   hot_block_set_persist_period_sec);
+  ROCKS_LOG_HEADER(log, "      Options.warm_block_cache_after_compaction: %d",
+                   warm_block_cache_after_compaction);
+  ROCKS_LOG_HEADER(log, "                     Options.lazy_open_deep_sst: %d",
+                   lazy_open_deep_sst);
+  ROCKS_LOG_HEADER(log,
+                   "              Options.table_cache_memory_budget: %" PRIu64,
+                   table_cache_memory_budget);
+  ROCKS_LOG_HEADER(log, "       Options.pin_table_reader_on_first_access: %d",
+                   pin_table_reader_on_first_access);
+  ROCKS_LOG_HEADER(
+      log, "                Options.change_feed_buffer_size: %" ROCKSDB_PRIszt,
+      change_feed_buffer_size);
+  ROCKS_LOG_HEADER(
+      log, "                    Options.value_log_threshold: %" ROCKSDB_PRIszt,
+      value_log_threshold);
+  ROCKS_LOG_HEADER(
+      log, "                   Options.write_behind_buffers: %" ROCKSDB_PRIszt,
+      write_behind_buffers);
 }
 
 MutableDBOptions::MutableDBOptions()
@@ -269,7 +355,9 @@ MutableDBOptions::MutableDBOptions()
       compaction_readahead_size(0),
       zenfs_low_gc_ratio(0.25),
       zenfs_high_gc_ratio(0.6),
-      zenfs_force_gc_ratio(0.9) {}
+      zenfs_force_gc_ratio(0.9),
+      zenfs_gc_free_ratio_target(0.15),
+      zenfs_gc_max_zones_per_run(5) {}
 
 MutableDBOptions::MutableDBOptions(const DBOptions& options)
     : max_background_jobs(options.max_background_jobs),
@@ -293,7 +381,9 @@ MutableDBOptions::MutableDBOptions(const DBOptions& options)
       compaction_readahead_size(options.compaction_readahead_size),
       zenfs_low_gc_ratio(options.zenfs_low_gc_ratio),
       zenfs_high_gc_ratio(options.zenfs_high_gc_ratio),
-      zenfs_force_gc_ratio(options.zenfs_force_gc_ratio) {}
+      zenfs_force_gc_ratio(options.zenfs_force_gc_ratio),
+      zenfs_gc_free_ratio_target(options.zenfs_gc_free_ratio_target),
+      zenfs_gc_max_zones_per_run(options.zenfs_gc_max_zones_per_run) {}
 
 void MutableDBOptions::Dump(Logger* log) const {
   ROCKS_LOG_HEADER(log, "                   Options.max_background_jobs: %d",
@@ -342,6 +432,11 @@ void MutableDBOptions::Dump(Logger* log) const {
                    zenfs_high_gc_ratio);
   ROCKS_LOG_HEADER(log, "                      Options.zenfs_force_ratio: %lf",
                    zenfs_force_gc_ratio);
+  ROCKS_LOG_HEADER(log, "             Options.zenfs_gc_free_ratio_target: %lf",
+                   zenfs_gc_free_ratio_target);
+  ROCKS_LOG_HEADER(log,
+                   "             Options.zenfs_gc_max_zones_per_run: %" PRIu64,
+                   zenfs_gc_max_zones_per_run);
 }
 
 }  // namespace TERARKDB_NAMESPACE
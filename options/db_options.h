@@ -27,6 +27,7 @@ struct ImmutableDBOptions {
   Env* env;
   std::shared_ptr<RateLimiter> rate_limiter;
   std::shared_ptr<SstFileManager> sst_file_manager;
+  std::shared_ptr<BackgroundCoordinator> background_coordinator;
   std::shared_ptr<Logger> info_log;
   InfoLogLevel info_log_level;
   int max_file_opening_threads;
@@ -52,6 +53,7 @@ struct ImmutableDBOptions {
   bool allow_mmap_writes;
   bool use_direct_reads;
   bool use_direct_io_for_flush_and_compaction;
+  bool use_direct_io_for_wal;
   bool use_aio_reads;
   bool allow_fallocate;
   bool is_fd_close_on_exec;
@@ -85,8 +87,30 @@ struct ImmutableDBOptions {
   bool preserve_deletes;
   bool two_write_queues;
   bool manual_wal_flush;
+  bool async_wal_sync;
+  uint64_t async_wal_sync_max_delay_us;
+  size_t wal_streams;
+  CompressionType wal_compression;
+  size_t wal_recovery_threads;
+  bool isolate_cf_write_stalls;
   bool avoid_unnecessary_blocking_io;
   bool persist_stats_to_disk;
+  std::shared_ptr<ZoneVictimPolicy> zenfs_zone_victim_policy;
+  bool zenfs_zone_aligned_file_size;
+  bool zenfs_gc_relocate_extents;
+  uint64_t partition_num;
+  bool enable_hot_separation;
+  uint32_t hotness_sample_interval;
+  bool hotness_sample_reads;
+  uint32_t hot_block_sample_interval;
+  unsigned int hot_block_set_persist_period_sec;
+  bool warm_block_cache_after_compaction;
+  bool lazy_open_deep_sst;
+  uint64_t table_cache_memory_budget;
+  bool pin_table_reader_on_first_access;
+  size_t change_feed_buffer_size;
+  size_t value_log_threshold;
+  size_t write_behind_buffers;
 };
 
 struct MutableDBOptions {
@@ -116,6 +140,8 @@ struct MutableDBOptions {
   double zenfs_low_gc_ratio;
   double zenfs_high_gc_ratio;
   double zenfs_force_gc_ratio;
+  double zenfs_gc_free_ratio_target;
+  uint64_t zenfs_gc_max_zones_per_run;
 };
 
 }  // namespace TERARKDB_NAMESPACE
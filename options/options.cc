@@ -24,7 +24,9 @@
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/env.h"
+#include "rocksdb/memtablerep.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/resource_group.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/sst_file_manager.h"
@@ -68,6 +70,7 @@ AdvancedColumnFamilyOptions::AdvancedColumnFamilyOptions(const Options& options)
       inplace_callback(options.inplace_callback),
       memtable_prefix_bloom_size_ratio(
           options.memtable_prefix_bloom_size_ratio),
+      memtable_whole_key_filtering(options.memtable_whole_key_filtering),
       memtable_huge_page_size(options.memtable_huge_page_size),
       memtable_insert_with_hint_prefix_extractor(
           options.memtable_insert_with_hint_prefix_extractor),
@@ -77,6 +80,9 @@ AdvancedColumnFamilyOptions::AdvancedColumnFamilyOptions(const Options& options)
       num_levels(options.num_levels),
       level0_slowdown_writes_trigger(options.level0_slowdown_writes_trigger),
       level0_stop_writes_trigger(options.level0_stop_writes_trigger),
+      level0_stall_by_sublevels(options.level0_stall_by_sublevels),
+      flush_to_bottommost_level(options.flush_to_bottommost_level),
+      compaction_filter_threads(options.compaction_filter_threads),
       target_file_size_base(options.target_file_size_base),
       target_file_size_multiplier(options.target_file_size_multiplier),
       level_compaction_dynamic_level_bytes(
@@ -102,7 +108,9 @@ AdvancedColumnFamilyOptions::AdvancedColumnFamilyOptions(const Options& options)
       optimize_range_deletion(options.optimize_range_deletion),
       paranoid_file_checks(options.paranoid_file_checks),
       force_consistency_checks(options.force_consistency_checks),
-      report_bg_io_stats(options.report_bg_io_stats) {
+      report_bg_io_stats(options.report_bg_io_stats),
+      prefetch_index_and_filter_hot_file_ratio(
+          options.prefetch_index_and_filter_hot_file_ratio) {
   assert(memtable_factory.get() != nullptr);
   if (max_bytes_for_level_multiplier_additional.size() <
       static_cast<unsigned int>(num_levels)) {
@@ -223,6 +231,13 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
                    level0_slowdown_writes_trigger);
   ROCKS_LOG_HEADER(log, "             Options.level0_stop_writes_trigger: %d",
                    level0_stop_writes_trigger);
+  ROCKS_LOG_HEADER(log, "              Options.level0_stall_by_sublevels: %d",
+                   level0_stall_by_sublevels);
+  ROCKS_LOG_HEADER(log, "              Options.flush_to_bottommost_level: %d",
+                   flush_to_bottommost_level);
+  ROCKS_LOG_HEADER(log,
+                   "              Options.compaction_filter_threads: %" PRIu32,
+                   compaction_filter_threads);
   ROCKS_LOG_HEADER(log,
                    "                  Options.target_file_size_base: %" PRIu64,
                    target_file_size_base);
@@ -263,12 +278,21 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
                    disable_auto_compactions);
   ROCKS_LOG_HEADER(log, "                     Options.max_subcompactions: %u",
                    max_subcompactions);
+  ROCKS_LOG_HEADER(log, "                   Options.max_flush_partitions: %u",
+                   max_flush_partitions);
+  ROCKS_LOG_HEADER(log,
+                   "         Options.atomic_flush_inline_value_size: %" PRIu64,
+                   atomic_flush_inline_value_size);
   ROCKS_LOG_HEADER(log, "                              Options.blob_size: %zd",
                    blob_size);
   ROCKS_LOG_HEADER(log, "                   Options.blob_large_key_ratio: %f",
                    blob_large_key_ratio);
+  ROCKS_LOG_HEADER(log, "               Options.adaptive_blob_separation: %d",
+                   adaptive_blob_separation);
   ROCKS_LOG_HEADER(log, "                          Options.blob_gc_ratio: %f",
                    blob_gc_ratio);
+  ROCKS_LOG_HEADER(log, "                     Options.blob_partition_num: %u",
+                   blob_partition_num);
   ROCKS_LOG_HEADER(log,
                    "                  Options.target_blob_file_size: %" PRIu64,
                    target_blob_file_size);
@@ -279,10 +303,36 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
                    max_dependence_blob_overlap);
   ROCKS_LOG_HEADER(log, "                   Options.maintainer_job_ratio: %f",
                    maintainer_job_ratio);
+  ROCKS_LOG_HEADER(log, "       Options.lazy_compaction_read_heat_weight: %f",
+                   lazy_compaction_read_heat_weight);
+  ROCKS_LOG_HEADER(log,
+                   "       Options.remote_compaction_min_input_size: %" PRIu64,
+                   remote_compaction_min_input_size);
+  ROCKS_LOG_HEADER(log,
+                   "     Options.remote_compaction_max_pending_jobs: %" PRIu64,
+                   remote_compaction_max_pending_jobs);
+  if (blob_cache) {
+    ROCKS_LOG_HEADER(log,
+                     "                             Options.blob_cache: %zu",
+                     blob_cache->GetCapacity());
+  } else {
+    ROCKS_LOG_HEADER(log,
+                     "                             Options.blob_cache: None");
+  }
+  ROCKS_LOG_HEADER(log, "      Options.blob_cache_admit_on_second_access: %d",
+                   blob_cache_admit_on_second_access);
+  ROCKS_LOG_HEADER(log, "                         Options.resource_group: %s",
+                   resource_group ? resource_group->Name().c_str() : "None");
+  ROCKS_LOG_HEADER(log, "                         Options.hot_data_ratio: %f",
+                   hot_data_ratio);
   ROCKS_LOG_HEADER(log, "                           Options.ttl_gc_ratio: %f",
                    ttl_gc_ratio);
   ROCKS_LOG_HEADER(log, "                       Options.ttl_max_scan_gap: %zd",
                    ttl_max_scan_gap);
+  ROCKS_LOG_HEADER(log, "                 Options.ttl_drop_expired_files: %d",
+                   ttl_drop_expired_files);
+  ROCKS_LOG_HEADER(log, "            Options.blob_compression_per_record: %d",
+                   blob_compression_per_record);
 
   const auto& it_compaction_style =
       compaction_style_to_string.find(compaction_style);
@@ -333,6 +383,9 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
   }
   ROCKS_LOG_HEADER(log, " Options.compaction_options_universal.stop_style: %s",
                    str_compaction_stop_style.c_str());
+  ROCKS_LOG_HEADER(log,
+                   "Options.compaction_options_universal.time_window: %" PRIu64,
+                   compaction_options_universal.time_window);
   std::string collector_names;
   for (const auto& collector_factory : table_properties_collector_factories) {
     collector_names.append(collector_factory->Name());
@@ -352,6 +405,8 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
   // TODO: easier config for bloom (maybe based on avg key/value size)
   ROCKS_LOG_HEADER(log, "       Options.memtable_prefix_bloom_size_ratio: %f",
                    memtable_prefix_bloom_size_ratio);
+  ROCKS_LOG_HEADER(log, "           Options.memtable_whole_key_filtering: %d",
+                   memtable_whole_key_filtering);
 
   ROCKS_LOG_HEADER(
       log, "                Options.memtable_huge_page_size: %" ROCKSDB_PRIszt,
@@ -372,6 +427,9 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
                    force_consistency_checks);
   ROCKS_LOG_HEADER(log, "                     Options.report_bg_io_stats: %d",
                    report_bg_io_stats);
+  ROCKS_LOG_HEADER(log,
+                   "Options.prefetch_index_and_filter_hot_file_ratio: %f",
+                   prefetch_index_and_filter_hot_file_ratio);
 }  // ColumnFamilyOptions::Dump
 
 void Options::Dump(Logger* log) const {
@@ -424,6 +482,16 @@ Options* Options::PrepareForBulkLoad() {
 
   // The compaction would create large files in L1.
   target_file_size_base = 256 * 1024 * 1024;
+
+  // The flushes of the keys loaded in order overlap nothing and go straight
+  // to L1.
+  flush_to_bottommost_level = true;
+
+#ifndef ROCKSDB_LITE
+  // Appending to a vector is cheaper than a skip list insert, the flush
+  // sorts it on a few threads.
+  memtable_factory.reset(new VectorRepFactory(0 /* count */, 4));
+#endif  // ROCKSDB_LITE
   return this;
 }
 
@@ -573,6 +641,7 @@ ReadOptions::ReadOptions()
       iterate_lower_bound(nullptr),
       iterate_upper_bound(nullptr),
       readahead_size(0),
+      async_prefetch_size(0),
       max_skippable_internal_keys(0),
       read_tier(kReadAllTier),
       verify_checksums(true),
@@ -591,6 +660,7 @@ ReadOptions::ReadOptions(bool cksum, bool cache)
       iterate_lower_bound(nullptr),
       iterate_upper_bound(nullptr),
       readahead_size(0),
+      async_prefetch_size(0),
       max_skippable_internal_keys(0),
       read_tier(kReadAllTier),
       verify_checksums(cksum),
@@ -41,6 +41,7 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.env = immutable_db_options.env;
   options.rate_limiter = immutable_db_options.rate_limiter;
   options.sst_file_manager = immutable_db_options.sst_file_manager;
+  options.background_coordinator = immutable_db_options.background_coordinator;
   options.info_log = immutable_db_options.info_log;
   options.info_log_level = immutable_db_options.info_log_level;
   options.max_open_files = mutable_db_options.max_open_files;
@@ -84,6 +85,7 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.use_direct_reads = immutable_db_options.use_direct_reads;
   options.use_direct_io_for_flush_and_compaction =
       immutable_db_options.use_direct_io_for_flush_and_compaction;
+  options.use_direct_io_for_wal = immutable_db_options.use_direct_io_for_wal;
   options.use_aio_reads = immutable_db_options.use_aio_reads;
   options.allow_fallocate = immutable_db_options.allow_fallocate;
   options.is_fd_close_on_exec = immutable_db_options.is_fd_close_on_exec;
@@ -107,6 +109,36 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.zenfs_low_gc_ratio = mutable_db_options.zenfs_low_gc_ratio;
   options.zenfs_high_gc_ratio = mutable_db_options.zenfs_high_gc_ratio;
   options.zenfs_force_gc_ratio = mutable_db_options.zenfs_force_gc_ratio;
+  options.zenfs_gc_free_ratio_target =
+      mutable_db_options.zenfs_gc_free_ratio_target;
+  options.zenfs_gc_max_zones_per_run =
+      mutable_db_options.zenfs_gc_max_zones_per_run;
+  options.zenfs_zone_victim_policy =
+      immutable_db_options.zenfs_zone_victim_policy;
+  options.zenfs_zone_aligned_file_size =
+      immutable_db_options.zenfs_zone_aligned_file_size;
+  options.zenfs_gc_relocate_extents =
+      immutable_db_options.zenfs_gc_relocate_extents;
+  options.partition_num = immutable_db_options.partition_num;
+  options.enable_hot_separation = immutable_db_options.enable_hot_separation;
+  options.hotness_sample_interval =
+      immutable_db_options.hotness_sample_interval;
+  options.hotness_sample_reads = immutable_db_options.hotness_sample_reads;
+  options.hot_block_sample_interval =
+      immutable_db_options.hot_block_sample_interval;
+  options.hot_block_set_persist_period_sec =
+      immutable_db_options.hot_block_set_persist_period_sec;
+  options.warm_block_cache_after_compaction =
+      immutable_db_options.warm_block_cache_after_compaction;
+  options.lazy_open_deep_sst = immutable_db_options.lazy_open_deep_sst;
+  options.table_cache_memory_budget =
+      immutable_db_options.table_cache_memory_budget;
+  options.pin_table_reader_on_first_access =
+      immutable_db_options.pin_table_reader_on_first_access;
+  options.change_feed_buffer_size =
+      immutable_db_options.change_feed_buffer_size;
+  options.value_log_threshold = immutable_db_options.value_log_threshold;
+  options.write_behind_buffers = immutable_db_options.write_behind_buffers;
   options.random_access_max_buffer_size =
       immutable_db_options.random_access_max_buffer_size;
   options.writable_file_max_buffer_size =
@@ -143,6 +175,14 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.preserve_deletes = immutable_db_options.preserve_deletes;
   options.two_write_queues = immutable_db_options.two_write_queues;
   options.manual_wal_flush = immutable_db_options.manual_wal_flush;
+  options.async_wal_sync = immutable_db_options.async_wal_sync;
+  options.async_wal_sync_max_delay_us =
+      immutable_db_options.async_wal_sync_max_delay_us;
+  options.wal_streams = immutable_db_options.wal_streams;
+  options.wal_compression = immutable_db_options.wal_compression;
+  options.wal_recovery_threads = immutable_db_options.wal_recovery_threads;
+  options.isolate_cf_write_stalls =
+      immutable_db_options.isolate_cf_write_stalls;
   options.avoid_unnecessary_blocking_io =
       immutable_db_options.avoid_unnecessary_blocking_io;
   return options;
@@ -159,6 +199,8 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
   cf_opts.arena_block_size = mutable_cf_options.arena_block_size;
   cf_opts.memtable_prefix_bloom_size_ratio =
       mutable_cf_options.memtable_prefix_bloom_size_ratio;
+  cf_opts.memtable_whole_key_filtering =
+      mutable_cf_options.memtable_whole_key_filtering;
   cf_opts.memtable_huge_page_size = mutable_cf_options.memtable_huge_page_size;
   cf_opts.max_successive_merges = mutable_cf_options.max_successive_merges;
   cf_opts.inplace_update_num_locks =
@@ -170,13 +212,22 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
       mutable_cf_options.disable_auto_compactions;
   cf_opts.blob_size = mutable_cf_options.blob_size;
   cf_opts.blob_large_key_ratio = mutable_cf_options.blob_large_key_ratio;
+  cf_opts.adaptive_blob_separation =
+      mutable_cf_options.adaptive_blob_separation;
   cf_opts.blob_gc_ratio = mutable_cf_options.blob_gc_ratio;
+  cf_opts.blob_partition_num = mutable_cf_options.blob_partition_num;
   cf_opts.target_blob_file_size = mutable_cf_options.target_blob_file_size;
   cf_opts.blob_file_defragment_size =
       mutable_cf_options.blob_file_defragment_size;
   cf_opts.max_dependence_blob_overlap =
       mutable_cf_options.max_dependence_blob_overlap;
   cf_opts.maintainer_job_ratio = mutable_cf_options.maintainer_job_ratio;
+  cf_opts.lazy_compaction_read_heat_weight =
+      mutable_cf_options.lazy_compaction_read_heat_weight;
+  cf_opts.remote_compaction_min_input_size =
+      mutable_cf_options.remote_compaction_min_input_size;
+  cf_opts.remote_compaction_max_pending_jobs =
+      mutable_cf_options.remote_compaction_max_pending_jobs;
   cf_opts.optimize_filters_for_hits =
       mutable_cf_options.optimize_filters_for_hits;
   cf_opts.optimize_range_deletion = mutable_cf_options.optimize_range_deletion;
@@ -190,6 +241,12 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
       mutable_cf_options.level0_slowdown_writes_trigger;
   cf_opts.level0_stop_writes_trigger =
       mutable_cf_options.level0_stop_writes_trigger;
+  cf_opts.level0_stall_by_sublevels =
+      mutable_cf_options.level0_stall_by_sublevels;
+  cf_opts.flush_to_bottommost_level =
+      mutable_cf_options.flush_to_bottommost_level;
+  cf_opts.compaction_filter_threads =
+      mutable_cf_options.compaction_filter_threads;
   cf_opts.max_compaction_bytes = mutable_cf_options.max_compaction_bytes;
   cf_opts.target_file_size_base = mutable_cf_options.target_file_size_base;
   cf_opts.target_file_size_multiplier =
@@ -200,6 +257,9 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
       mutable_cf_options.max_bytes_for_level_multiplier;
   cf_opts.ttl_gc_ratio = mutable_cf_options.ttl_gc_ratio;
   cf_opts.ttl_max_scan_gap = mutable_cf_options.ttl_max_scan_gap;
+  cf_opts.ttl_drop_expired_files = mutable_cf_options.ttl_drop_expired_files;
+  cf_opts.blob_compression_per_record =
+      mutable_cf_options.blob_compression_per_record;
 
   cf_opts.max_bytes_for_level_multiplier_additional =
       mutable_cf_options.max_bytes_for_level_multiplier_additional;
@@ -212,8 +272,13 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
       mutable_cf_options.max_sequential_skip_in_iterations;
   cf_opts.paranoid_file_checks = mutable_cf_options.paranoid_file_checks;
   cf_opts.report_bg_io_stats = mutable_cf_options.report_bg_io_stats;
+  cf_opts.prefetch_index_and_filter_hot_file_ratio =
+      mutable_cf_options.prefetch_index_and_filter_hot_file_ratio;
   cf_opts.compression = mutable_cf_options.compression;
   cf_opts.max_subcompactions = mutable_cf_options.max_subcompactions;
+  cf_opts.max_flush_partitions = mutable_cf_options.max_flush_partitions;
+  cf_opts.atomic_flush_inline_value_size =
+      mutable_cf_options.atomic_flush_inline_value_size;
 
   cf_opts.table_factory = options.table_factory;
   // TODO(yhchiang): find some way to handle the following derived options
@@ -236,7 +301,9 @@ std::map<CompactionPri, std::string> OptionsHelper::compaction_pri_to_string = {
 
 std::map<WriteBufferFlushPri, std::string>
     OptionsHelper::write_buffer_flush_pri_to_string = {
-        {kFlushOldest, "kFlushOldest"}, {kFlushLargest, "kFlushLargest"}};
+        {kFlushOldest, "kFlushOldest"},
+        {kFlushLargest, "kFlushLargest"},
+        {kFlushArbitrated, "kFlushArbitrated"}};
 
 std::map<CompactionStopStyle, std::string>
     OptionsHelper::compaction_stop_style_to_string = {
@@ -247,7 +314,8 @@ std::unordered_map<std::string, ChecksumType>
     OptionsHelper::checksum_type_string_map = {{"kNoChecksum", kNoChecksum},
                                                {"kCRC32c", kCRC32c},
                                                {"kxxHash", kxxHash},
-                                               {"kxxHash64", kxxHash64}};
+                                               {"kxxHash64", kxxHash64},
+                                               {"kXXH3", kXXH3}};
 
 std::unordered_map<std::string, CompressionType>
     OptionsHelper::compression_type_string_map = {
@@ -1546,6 +1614,9 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"use_direct_io_for_flush_and_compaction",
          {offsetof(struct DBOptions, use_direct_io_for_flush_and_compaction),
           OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"use_direct_io_for_wal",
+         {offsetof(struct DBOptions, use_direct_io_for_wal),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
         {"use_aio_reads",
          {offsetof(struct DBOptions, use_aio_reads), OptionType::kBoolean,
           OptionVerificationType::kNormal, false, 0}},
@@ -1775,6 +1846,30 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct DBOptions, manual_wal_flush), OptionType::kBoolean,
           OptionVerificationType::kNormal, false,
           offsetof(struct ImmutableDBOptions, manual_wal_flush)}},
+        {"async_wal_sync",
+         {offsetof(struct DBOptions, async_wal_sync), OptionType::kBoolean,
+          OptionVerificationType::kNormal, false,
+          offsetof(struct ImmutableDBOptions, async_wal_sync)}},
+        {"async_wal_sync_max_delay_us",
+         {offsetof(struct DBOptions, async_wal_sync_max_delay_us),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, false,
+          offsetof(struct ImmutableDBOptions, async_wal_sync_max_delay_us)}},
+        {"wal_streams",
+         {offsetof(struct DBOptions, wal_streams), OptionType::kSizeT,
+          OptionVerificationType::kNormal, false,
+          offsetof(struct ImmutableDBOptions, wal_streams)}},
+        {"wal_recovery_threads",
+         {offsetof(struct DBOptions, wal_recovery_threads), OptionType::kSizeT,
+          OptionVerificationType::kNormal, false,
+          offsetof(struct ImmutableDBOptions, wal_recovery_threads)}},
+        {"wal_compression",
+         {offsetof(struct DBOptions, wal_compression),
+          OptionType::kCompressionType, OptionVerificationType::kNormal, false,
+          offsetof(struct ImmutableDBOptions, wal_compression)}},
+        {"isolate_cf_write_stalls",
+         {offsetof(struct DBOptions, isolate_cf_write_stalls),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false,
+          offsetof(struct ImmutableDBOptions, isolate_cf_write_stalls)}},
         {"seq_per_batch",
          {0, OptionType::kBoolean, OptionVerificationType::kDeprecated, false,
           0}},
@@ -1793,7 +1888,60 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"zenfs_force_gc_ratio",
          {offsetof(struct DBOptions, zenfs_force_gc_ratio), OptionType::kDouble,
           OptionVerificationType::kNormal, true,
-          offsetof(struct MutableDBOptions, zenfs_force_gc_ratio)}}};
+          offsetof(struct MutableDBOptions, zenfs_force_gc_ratio)}},
+        {"zenfs_gc_free_ratio_target",
+         {offsetof(struct DBOptions, zenfs_gc_free_ratio_target),
+          OptionType::kDouble, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableDBOptions, zenfs_gc_free_ratio_target)}},
+        {"zenfs_gc_max_zones_per_run",
+         {offsetof(struct DBOptions, zenfs_gc_max_zones_per_run),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableDBOptions, zenfs_gc_max_zones_per_run)}},
+        {"zenfs_zone_aligned_file_size",
+         {offsetof(struct DBOptions, zenfs_zone_aligned_file_size),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"zenfs_gc_relocate_extents",
+         {offsetof(struct DBOptions, zenfs_gc_relocate_extents),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"partition_num",
+         {offsetof(struct DBOptions, partition_num), OptionType::kUInt64T,
+          OptionVerificationType::kNormal, false, 0}},
+        {"enable_hot_separation",
+         {offsetof(struct DBOptions, enable_hot_separation),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"hotness_sample_interval",
+         {offsetof(struct DBOptions, hotness_sample_interval),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, false, 0}},
+        {"hotness_sample_reads",
+         {offsetof(struct DBOptions, hotness_sample_reads),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"hot_block_sample_interval",
+         {offsetof(struct DBOptions, hot_block_sample_interval),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, false, 0}},
+        {"hot_block_set_persist_period_sec",
+         {offsetof(struct DBOptions, hot_block_set_persist_period_sec),
+          OptionType::kUInt, OptionVerificationType::kNormal, false, 0}},
+        {"warm_block_cache_after_compaction",
+         {offsetof(struct DBOptions, warm_block_cache_after_compaction),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"lazy_open_deep_sst",
+         {offsetof(struct DBOptions, lazy_open_deep_sst), OptionType::kBoolean,
+          OptionVerificationType::kNormal, false, 0}},
+        {"table_cache_memory_budget",
+         {offsetof(struct DBOptions, table_cache_memory_budget),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, false, 0}},
+        {"pin_table_reader_on_first_access",
+         {offsetof(struct DBOptions, pin_table_reader_on_first_access),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"change_feed_buffer_size",
+         {offsetof(struct DBOptions, change_feed_buffer_size),
+          OptionType::kSizeT, OptionVerificationType::kNormal, false, 0}},
+        {"value_log_threshold",
+         {offsetof(struct DBOptions, value_log_threshold), OptionType::kSizeT,
+          OptionVerificationType::kNormal, false, 0}},
+        {"write_behind_buffers",
+         {offsetof(struct DBOptions, write_behind_buffers), OptionType::kSizeT,
+          OptionVerificationType::kNormal, false, 0}}};
 
 std::unordered_map<std::string, BlockBasedTableOptions::IndexType>
     OptionsHelper::block_base_table_index_type_string_map = {
@@ -1807,7 +1955,10 @@ std::unordered_map<std::string, BlockBasedTableOptions::DataBlockIndexType>
         {"kDataBlockBinarySearch",
          BlockBasedTableOptions::DataBlockIndexType::kDataBlockBinarySearch},
         {"kDataBlockBinaryAndHash",
-         BlockBasedTableOptions::DataBlockIndexType::kDataBlockBinaryAndHash}};
+         BlockBasedTableOptions::DataBlockIndexType::kDataBlockBinaryAndHash},
+        {"kDataBlockBinaryAndKeyPrefix",
+         BlockBasedTableOptions::DataBlockIndexType::
+             kDataBlockBinaryAndKeyPrefix}};
 
 std::unordered_map<std::string, EncodingType>
     OptionsHelper::encoding_type_string_map = {{"kPlain", kPlain},
@@ -1828,7 +1979,9 @@ std::unordered_map<std::string, CompactionPri>
 
 std::unordered_map<std::string, WriteBufferFlushPri>
     OptionsHelper::write_buffer_flush_pri_string_map = {
-        {"kFlushOldest", kFlushOldest}, {"kFlushLargest", kFlushLargest}};
+        {"kFlushOldest", kFlushOldest},
+        {"kFlushLargest", kFlushLargest},
+        {"kFlushArbitrated", kFlushArbitrated}};
 
 std::unordered_map<std::string, WALRecoveryMode>
     OptionsHelper::wal_recovery_mode_string_map = {
@@ -1912,6 +2065,12 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::report_bg_io_stats),
           OptionType::kBoolean, OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, report_bg_io_stats)}},
+        {"prefetch_index_and_filter_hot_file_ratio",
+         {offset_of(
+              &ColumnFamilyOptions::prefetch_index_and_filter_hot_file_ratio),
+          OptionType::kDouble, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions,
+                   prefetch_index_and_filter_hot_file_ratio)}},
         {"compaction_measure_io_stats",
          {0, OptionType::kBoolean, OptionVerificationType::kDeprecated, false,
           0}},
@@ -1923,6 +2082,14 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::max_subcompactions),
           OptionType::kUInt32T, OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, max_subcompactions)}},
+        {"max_flush_partitions",
+         {offset_of(&ColumnFamilyOptions::max_flush_partitions),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, max_flush_partitions)}},
+        {"atomic_flush_inline_value_size",
+         {offset_of(&ColumnFamilyOptions::atomic_flush_inline_value_size),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, atomic_flush_inline_value_size)}},
         {"blob_size",
          {offset_of(&ColumnFamilyOptions::blob_size), OptionType::kSizeT,
           OptionVerificationType::kNormal, true,
@@ -1931,10 +2098,18 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::blob_large_key_ratio),
           OptionType::kDouble, OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, blob_large_key_ratio)}},
+        {"adaptive_blob_separation",
+         {offset_of(&ColumnFamilyOptions::adaptive_blob_separation),
+          OptionType::kBoolean, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, adaptive_blob_separation)}},
         {"blob_gc_ratio",
          {offset_of(&ColumnFamilyOptions::blob_gc_ratio), OptionType::kDouble,
           OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, blob_gc_ratio)}},
+        {"blob_partition_num",
+         {offset_of(&ColumnFamilyOptions::blob_partition_num),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, blob_partition_num)}},
         {"target_blob_file_size",
          {offset_of(&ColumnFamilyOptions::target_blob_file_size),
           OptionType::kUInt64T, OptionVerificationType::kNormal, true,
@@ -1951,6 +2126,25 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::maintainer_job_ratio),
           OptionType::kDouble, OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, maintainer_job_ratio)}},
+        {"lazy_compaction_read_heat_weight",
+         {offset_of(&ColumnFamilyOptions::lazy_compaction_read_heat_weight),
+          OptionType::kDouble, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, lazy_compaction_read_heat_weight)}},
+        {"remote_compaction_min_input_size",
+         {offset_of(&ColumnFamilyOptions::remote_compaction_min_input_size),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, remote_compaction_min_input_size)}},
+        {"remote_compaction_max_pending_jobs",
+         {offset_of(&ColumnFamilyOptions::remote_compaction_max_pending_jobs),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions,
+                   remote_compaction_max_pending_jobs)}},
+        {"blob_cache_admit_on_second_access",
+         {offset_of(&ColumnFamilyOptions::blob_cache_admit_on_second_access),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"hot_data_ratio",
+         {offset_of(&ColumnFamilyOptions::hot_data_ratio), OptionType::kDouble,
+          OptionVerificationType::kNormal, false, 0}},
         {"filter_deletes",
          {0, OptionType::kBoolean, OptionVerificationType::kDeprecated, true,
           0}},
@@ -2022,6 +2216,18 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::level0_stop_writes_trigger),
           OptionType::kInt, OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, level0_stop_writes_trigger)}},
+        {"level0_stall_by_sublevels",
+         {offset_of(&ColumnFamilyOptions::level0_stall_by_sublevels),
+          OptionType::kBoolean, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, level0_stall_by_sublevels)}},
+        {"flush_to_bottommost_level",
+         {offset_of(&ColumnFamilyOptions::flush_to_bottommost_level),
+          OptionType::kBoolean, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, flush_to_bottommost_level)}},
+        {"compaction_filter_threads",
+         {offset_of(&ColumnFamilyOptions::compaction_filter_threads),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, compaction_filter_threads)}},
         {"max_grandparent_overlap_factor",
          {0, OptionType::kInt, OptionVerificationType::kDeprecated, true, 0}},
         {"max_mem_compaction_level",
@@ -2077,6 +2283,10 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offset_of(&ColumnFamilyOptions::memtable_prefix_bloom_size_ratio),
           OptionType::kDouble, OptionVerificationType::kNormal, true,
           offsetof(struct MutableCFOptions, memtable_prefix_bloom_size_ratio)}},
+        {"memtable_whole_key_filtering",
+         {offset_of(&ColumnFamilyOptions::memtable_whole_key_filtering),
+          OptionType::kBoolean, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, memtable_whole_key_filtering)}},
         {"memtable_prefix_bloom_probes",
          {0, OptionType::kUInt32T, OptionVerificationType::kDeprecated, true,
           0}},
@@ -2176,7 +2386,15 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"ttl_max_scan_gap",
          {offset_of(&ColumnFamilyOptions::ttl_max_scan_gap), OptionType::kSizeT,
           OptionVerificationType::kNormal, true,
-          offsetof(struct MutableCFOptions, ttl_max_scan_gap)}}};
+          offsetof(struct MutableCFOptions, ttl_max_scan_gap)}},
+        {"ttl_drop_expired_files",
+         {offset_of(&ColumnFamilyOptions::ttl_drop_expired_files),
+          OptionType::kBoolean, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, ttl_drop_expired_files)}},
+        {"blob_compression_per_record",
+         {offset_of(&ColumnFamilyOptions::blob_compression_per_record),
+          OptionType::kBoolean, OptionVerificationType::kNormal, true,
+          offsetof(struct MutableCFOptions, blob_compression_per_record)}}};
 
 std::unordered_map<std::string, OptionTypeInfo>
     OptionsHelper::universal_compaction_options_type_info = {
@@ -2210,7 +2428,11 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"allow_trivial_move",
          {offset_of(&CompactionOptionsUniversal::allow_trivial_move),
           OptionType::kBoolean, OptionVerificationType::kNormal, true,
-          offsetof(class CompactionOptionsUniversal, allow_trivial_move)}}};
+          offsetof(class CompactionOptionsUniversal, allow_trivial_move)}},
+        {"time_window",
+         {offset_of(&CompactionOptionsUniversal::time_window),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, true,
+          offsetof(class CompactionOptionsUniversal, time_window)}}};
 
 std::unordered_map<std::string, CompactionStopStyle>
     OptionsHelper::compaction_stop_style_string_map = {
@@ -577,7 +577,8 @@ bool AreEqualOptions(
               rhs.max_size_amplification_percent &&
           lhs.compression_size_percent == rhs.compression_size_percent &&
           lhs.stop_style == rhs.stop_style &&
-          lhs.allow_trivial_move == rhs.allow_trivial_move) {
+          lhs.allow_trivial_move == rhs.allow_trivial_move &&
+          lhs.time_window == rhs.time_window) {
         return true;
       }
       return false;
@@ -98,6 +98,8 @@ TEST_F(OptionsSettableTest, BlockBasedTableOptionsAllFieldsSettable) {
        sizeof(std::shared_ptr<Cache>)},
       {offsetof(struct BlockBasedTableOptions, filter_policy),
        sizeof(std::shared_ptr<const FilterPolicy>)},
+      {offsetof(struct BlockBasedTableOptions, value_col_declarations),
+       sizeof(std::vector<ColDeclaration>)},
   };
 
   // In this test, we catch a new option of BlockBasedTableOptions that is not
@@ -142,6 +144,8 @@ TEST_F(OptionsSettableTest, BlockBasedTableOptionsAllFieldsSettable) {
       "cache_index_and_filter_blocks_with_high_priority=true;"
       "pin_l0_filter_and_index_blocks_in_cache=1;"
       "pin_top_level_index_and_filter=1;"
+      "pin_top_level_index_and_filter_max_level=2;"
+      "pin_index_and_filter_partitions_max_level=1;"
       "index_type=kHashSearch;"
       "data_block_index_type=kDataBlockBinaryAndHash;"
       "data_block_hash_table_util_ratio=0.75;"
@@ -156,7 +160,8 @@ TEST_F(OptionsSettableTest, BlockBasedTableOptionsAllFieldsSettable) {
       "hash_index_allow_collision=false;"
       "verify_compression=true;read_amp_bytes_per_bit=0;"
       "enable_index_compression=false;"
-      "block_align=true",
+      "block_align=true;"
+      "parallel_compression_threads=4",
       new_bbto));
 
   ASSERT_EQ(unset_bytes_base,
@@ -189,6 +194,8 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
        sizeof(std::shared_ptr<RateLimiter>)},
       {offsetof(struct DBOptions, sst_file_manager),
        sizeof(std::shared_ptr<SstFileManager>)},
+      {offsetof(struct DBOptions, background_coordinator),
+       sizeof(std::shared_ptr<BackgroundCoordinator>)},
       {offsetof(struct DBOptions, info_log), sizeof(std::shared_ptr<Logger>)},
       {offsetof(struct DBOptions, statistics),
        sizeof(std::shared_ptr<Statistics>)},
@@ -203,6 +210,8 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
       {offsetof(struct DBOptions, metrics_reporter_factory),
        sizeof(std::shared_ptr<MetricsReporterFactory>)},
       {offsetof(struct DBOptions, wal_filter), sizeof(const WalFilter*)},
+      {offsetof(struct DBOptions, zenfs_zone_victim_policy),
+       sizeof(std::shared_ptr<ZoneVictimPolicy>)},
   };
 
   char* options_ptr = new char[sizeof(DBOptions)];
@@ -284,6 +293,7 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "allow_mmap_reads=false;"
                              "use_direct_reads=false;"
                              "use_direct_io_for_flush_and_compaction=false;"
+                             "use_direct_io_for_wal=false;"
                              "use_aio_reads=false;"
                              "max_log_file_size=4607;"
                              "random_access_max_buffer_size=1048576;"
@@ -307,11 +317,34 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "concurrent_prepare=false;"
                              "two_write_queues=false;"
                              "manual_wal_flush=false;"
+                             "async_wal_sync=false;"
+                             "async_wal_sync_max_delay_us=100;"
+                             "wal_streams=4;"
+                             "wal_compression=kZSTD;"
+                             "wal_recovery_threads=4;"
+                             "isolate_cf_write_stalls=false;"
                              "seq_per_batch=false;"
                              "avoid_unnecessary_blocking_io=false;"
                              "zenfs_low_gc_ratio=0.25;"
                              "zenfs_high_gc_ratio=0.6;"
-                             "zenfs_force_gc_ratio=0.9;",
+                             "zenfs_force_gc_ratio=0.9;"
+                             "zenfs_gc_free_ratio_target=0.15;"
+                             "zenfs_gc_max_zones_per_run=5;"
+                             "zenfs_zone_aligned_file_size=false;"
+                             "zenfs_gc_relocate_extents=true;"
+                             "partition_num=4;"
+                             "enable_hot_separation=true;"
+                             "hotness_sample_interval=16;"
+                             "hotness_sample_reads=false;"
+                             "hot_block_sample_interval=64;"
+                             "hot_block_set_persist_period_sec=300;"
+                             "warm_block_cache_after_compaction=true;"
+                             "lazy_open_deep_sst=true;"
+                             "table_cache_memory_budget=1048576;"
+                             "pin_table_reader_on_first_access=true;"
+                             "change_feed_buffer_size=1048576;"
+                             "value_log_threshold=65536;"
+                             "write_behind_buffers=2;",
                              new_options));
 
   ASSERT_EQ(unset_bytes_base, NumUnsetBytes(new_options_ptr, sizeof(DBOptions),
@@ -374,6 +407,10 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
        sizeof(std::shared_ptr<CompactionDispatcher>)},
       {offset_of(&ColumnFamilyOptions::prefix_extractor),
        sizeof(std::shared_ptr<const SliceTransform>)},
+      {offset_of(&ColumnFamilyOptions::blob_cache),
+       sizeof(std::shared_ptr<Cache>)},
+      {offset_of(&ColumnFamilyOptions::resource_group),
+       sizeof(std::shared_ptr<ResourceGroup>)},
       {offset_of(&ColumnFamilyOptions::table_factory),
        sizeof(std::shared_ptr<TableFactory>)},
       {offset_of(&ColumnFamilyOptions::cf_paths), sizeof(std::vector<DbPath>)},
@@ -426,6 +463,8 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
   ASSERT_OK(GetColumnFamilyOptionsFromString(
       *options,
       "max_subcompactions=1;"
+      "max_flush_partitions=4;"
+      "atomic_flush_inline_value_size=1048576;"
       "compaction_filter_factory=mpudlojcujCompactionFilterFactory;"
       "table_factory=PlainTable;"
       "prefix_extractor=rocksdb.CappedPrefix.13;"
@@ -450,6 +489,9 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
       "compression=kNoCompression;"
       "bottommost_compression=kDisableCompressionOption;"
       "level0_stop_writes_trigger=33;"
+      "level0_stall_by_sublevels=true;"
+      "flush_to_bottommost_level=true;"
+      "compaction_filter_threads=3;"
       "num_levels=99;"
       "level0_slowdown_writes_trigger=22;"
       "level0_file_num_compaction_trigger=14;"
@@ -459,6 +501,7 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
       "max_write_buffer_number_to_maintain=84;"
       "merge_operator=aabcxehazrMergeOperator;"
       "memtable_prefix_bloom_size_ratio=0.4642;"
+      "memtable_whole_key_filtering=true;"
       "memtable_insert_with_hint_prefix_extractor=rocksdb.CappedPrefix.13;"
       "paranoid_file_checks=true;"
       "force_consistency_checks=true;"
@@ -473,17 +516,27 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
       "disable_auto_compactions=false;"
       "blob_size=1028;"
       "blob_large_key_ratio=0.5;"
+      "adaptive_blob_separation=true;"
       "blob_size=1024;"
       "blob_gc_ratio=0.05;"
+      "blob_partition_num=8;"
       "target_blob_file_size=0;"
       "blob_file_defragment_size=0;"
       "max_dependence_blob_overlap=1024;"
       "maintainer_job_ratio=0.1;"
+      "lazy_compaction_read_heat_weight=1;"
+      "remote_compaction_min_input_size=1048576;"
+      "remote_compaction_max_pending_jobs=4;"
+      "blob_cache_admit_on_second_access=true;"
+      "hot_data_ratio=0.1;"
       "optimize_filters_for_hits=false;"
       "optimize_range_deletion=false;"
       "report_bg_io_stats=true;"
+      "prefetch_index_and_filter_hot_file_ratio=0.25;"
       "ttl_gc_ratio=3.000;"
-      "ttl_max_scan_gap=1;",
+      "ttl_max_scan_gap=1;"
+      "ttl_drop_expired_files=true;"
+      "blob_compression_per_record=true;",
       new_options));
 
   ASSERT_EQ(unset_bytes_base,
@@ -491,6 +544,8 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
                           kColumnFamilyOptionsBlacklist));
   EXPECT_EQ(new_options->ttl_gc_ratio, 3.000);
   EXPECT_EQ(new_options->ttl_max_scan_gap, 1);
+  EXPECT_TRUE(new_options->ttl_drop_expired_files);
+  EXPECT_TRUE(new_options->blob_compression_per_record);
   options->~ColumnFamilyOptions();
   new_options->~ColumnFamilyOptions();
 
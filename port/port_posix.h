@@ -183,6 +183,10 @@ static inline void AsmVolatilePause() {
 // Returns -1 if not available on this platform
 extern int PhysicalCoreID();
 
+// The NUMA node of the CPU running the calling thread. Returns -1 if not
+// available on this platform
+extern int NumaNodeID();
+
 typedef pthread_once_t OnceType;
 #define LEVELDB_ONCE_INIT PTHREAD_ONCE_INIT
 extern void InitOnce(OnceType* once, void (*initializer)());
@@ -121,6 +121,15 @@ void CondVar::SignalAll() { cv_.notify_all(); }
 
 int PhysicalCoreID() { return GetCurrentProcessorNumber(); }
 
+int NumaNodeID() {
+  UCHAR node;
+  if (!GetNumaProcessorNode(static_cast<UCHAR>(GetCurrentProcessorNumber()),
+                            &node)) {
+    return -1;
+  }
+  return node;
+}
+
 void InitOnce(OnceType* once, void (*initializer)()) {
   std::call_once(once->flag_, initializer);
 }
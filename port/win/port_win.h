@@ -275,6 +275,8 @@ static inline void AsmVolatilePause() {
 
 extern int PhysicalCoreID();
 
+extern int NumaNodeID();
+
 // For Thread Local Storage abstraction
 typedef DWORD pthread_key_t;
 
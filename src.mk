@@ -4,8 +4,10 @@ LIB_SOURCES =                                                   \
   cache/lirs_cache.cc                                           \
   cache/lru_cache.cc                                            \
   cache/sharded_cache.cc                                        \
+  db/async_event_listener.cc                                    \
   db/builder.cc                                                 \
   db/c.cc                                                       \
+  db/change_feed.cc                                             \
   db/column_family.cc                                           \
   db/compacted_db_impl.cc                                       \
   db/compaction.cc                                              \
@@ -14,6 +16,7 @@ LIB_SOURCES =                                                   \
   db/compaction_picker.cc                                       \
   db/compaction_picker_universal.cc                             \
   db/compaction_dispatcher.cc                                   \
+  db/compaction_worker_codec.cc                                 \
   db/convenience.cc                                             \
   db/db_filesnapshot.cc                                         \
   db/db_impl.cc                                                 \
@@ -23,6 +26,7 @@ LIB_SOURCES =                                                   \
   db/db_impl_files.cc                                           \
   db/db_impl_open.cc                                            \
   db/db_impl_readonly.cc                                        \
+  db/db_impl_secondary.cc                                       \
   db/db_impl_write.cc                                           \
   db/db_info_dumper.cc                                          \
   db/db_iter.cc                                                 \
@@ -35,7 +39,10 @@ LIB_SOURCES =                                                   \
   db/flush_job.cc                                               \
   db/flush_scheduler.cc                                         \
   db/forward_iterator.cc                                        \
+  db/hot_block_set.cc                                           \
   db/internal_stats.cc                                          \
+  db/key_hotness_sampler.cc                                     \
+  db/level_key_model.cc                                         \
   db/logs_with_prep_tracker.cc                                  \
   db/log_reader.cc                                              \
   db/log_writer.cc                                              \
@@ -46,22 +53,27 @@ LIB_SOURCES =                                                   \
   db/memtable_list.cc                                           \
   db/merge_helper.cc                                            \
   db/merge_operator.cc                                          \
+  db/parallel_filter_iterator.cc                                \
   db/periodic_work_scheduler.cc                                 \
   db/range_del_aggregator.cc                                    \
   db/range_tombstone_fragmenter.cc                              \
+  db/remote_compaction_scheduler.cc                             \
   db/repair.cc                                                  \
   db/snapshot_impl.cc                                           \
   db/table_cache.cc                                             \
   db/table_properties_collector.cc                              \
   db/transaction_log_impl.cc                                    \
+  db/value_log.cc                                               \
   db/version_builder.cc                                         \
   db/version_edit.cc                                            \
   db/version_set.cc                                             \
   db/wal_manager.cc                                             \
+  db/wal_syncer.cc                                              \
   db/write_batch.cc                                             \
   db/write_batch_base.cc                                        \
   db/write_controller.cc                                        \
   db/write_thread.cc                                            \
+  db/zone_gc_picker.cc                                          \
   env/env.cc                                                    \
   env/env_chroot.cc                                             \
   env/env_encryption.cc                                         \
@@ -75,15 +87,19 @@ LIB_SOURCES =                                                   \
   memtable/hash_cuckoo_rep.cc                                   \
   memtable/hash_linklist_rep.cc                                 \
   memtable/hash_skiplist_rep.cc                                 \
+  memtable/prefix_skiplist_rep.cc                               \
+  memtable/sharded_rep.cc                                       \
   memtable/skiplistrep.cc                                       \
   memtable/terark_zip_entry_index.cc                            \
   memtable/terark_zip_memtable.cc                               \
   memtable/vectorrep.cc                                         \
   memtable/write_buffer_manager.cc                              \
+  monitoring/cpu_attribution.cc                                 \
   monitoring/histogram.cc                                       \
   monitoring/histogram_windowing.cc                             \
   monitoring/in_memory_stats_history.cc                         \
   monitoring/instrumented_mutex.cc                              \
+  monitoring/io_attribution.cc                                  \
   monitoring/iostats_context.cc                                 \
   monitoring/perf_context.cc                                    \
   monitoring/perf_level.cc                                      \
@@ -116,19 +132,24 @@ LIB_SOURCES =                                                   \
   table/block_fetcher.cc                                        \
   table/block_prefix_index.cc                                   \
   table/bloom_block.cc                                          \
+  table/columnar_block.cc                                       \
+  table/compressed_secondary_cache.cc                           \
   table/cuckoo_table_builder.cc                                 \
   table/cuckoo_table_factory.cc                                 \
   table/cuckoo_table_reader.cc                                  \
   table/data_block_hash_index.cc                                \
   table/data_block_footer.cc                                    \
+  table/data_block_key_prefix.cc                                \
   table/flush_block_policy.cc                                   \
   table/format.cc                                               \
   table/full_filter_block.cc                                    \
   table/get_context.cc                                          \
+  table/hot_block_sampler.cc                                    \
   table/index_builder.cc                                        \
   table/iterator.cc                                             \
   table/merging_iterator.cc                                     \
   table/meta_blocks.cc                                          \
+  table/mmap_table_loader.cc                                    \
   table/partitioned_filter_block.cc                             \
   table/persistent_cache_helper.cc                              \
   table/plain_table_builder.cc                                  \
@@ -147,8 +168,10 @@ LIB_SOURCES =                                                   \
   table/terark_zip_table.cc                                     \
   table/two_level_iterator.cc                                   \
   tools/dump/db_dump_tool.cc                                    \
+  tools/dump/db_export_tool.cc                                  \
   util/arena.cc                                                 \
   util/auto_roll_logger.cc                                      \
+  util/background_coordinator_impl.cc                           \
   util/bloom.cc                                                 \
   util/build_version.cc                                         \
   util/coding.cc                                                \
@@ -170,8 +193,11 @@ LIB_SOURCES =                                                   \
   util/lazy_buffer.cc                                           \
   util/log_buffer.cc                                            \
   util/murmurhash.cc                                            \
+  util/pooling_memory_allocator.cc                              \
   util/random.cc                                                \
   util/rate_limiter.cc                                          \
+  util/resource_group.cc                                        \
+  util/sketch_oracle.cc                                         \
   util/slice.cc                                                 \
   util/sst_file_manager_impl.cc                                 \
   util/status.cc                                                \
@@ -182,12 +208,17 @@ LIB_SOURCES =                                                   \
   util/threadpool_imp.cc                                        \
   util/trace_replay.cc                                          \
   util/transaction_test_util.cc                                 \
+  util/xxh3.cc                                                  \
   util/xxhash.cc                                                \
+  util/zone_gc_rate_limiter.cc                                  \
+  util/zone_token_scheduler.cc                                  \
+  utilities/auto_tuner/auto_tuner.cc                            \
   utilities/backupable/backupable_db.cc                         \
   utilities/cassandra/cassandra_compaction_filter.cc            \
   utilities/cassandra/format.cc                                 \
   utilities/cassandra/merge_operator.cc                         \
   utilities/checkpoint/checkpoint_impl.cc                       \
+  utilities/chunked_value/chunked_value_store.cc                \
   utilities/compaction_filters/remove_emptyvalue_compactionfilter.cc    \
   utilities/console/anet.cc                                     \
   utilities/console/executor_mem_impl.cc                        \
@@ -270,6 +301,15 @@ MOCK_LIB_SOURCES = \
 BENCH_LIB_SOURCES =                                             \
   tools/db_bench_tool.cc                                        \
 
+MICROBENCH_SOURCES =                                            \
+  microbench/filemap_bench.cc                                   \
+  microbench/iterator_cache_bench.cc                            \
+  microbench/lazy_buffer_bench.cc                               \
+  microbench/lirs_cache_bench.cc                                \
+  microbench/map_sst_bench.cc                                   \
+  microbench/patricia_trie_rep_bench.cc                         \
+  microbench/terark_zip_table_bench.cc                          \
+
 ZENFS_LIB_SOURCES =                                             \
   tools/zenfs_tool.cc                                           \
 
@@ -287,12 +327,14 @@ TEST_LIB_SOURCES = \
 MAIN_SOURCES =                                                          \
   cache/cache_bench.cc                                                  \
   cache/cache_test.cc                                                   \
+  db/change_feed_test.cc                                                \
   db/column_family_test.cc                                              \
   db/compact_files_test.cc                                              \
   db/compaction_iterator_test.cc                                        \
   db/compaction_job_stats_test.cc                                       \
   db/compaction_job_test.cc                                             \
   db/compaction_picker_test.cc                                          \
+  db/compaction_worker_codec_test.cc                                    \
   db/comparator_db_test.cc                                              \
   db/corruption_test.cc                                                 \
   db/cuckoo_table_db_test.cc                                            \
@@ -315,6 +357,7 @@ MAIN_SOURCES =                                                          \
   db/db_options_test.cc                                                 \
   db/db_properties_test.cc                                              \
   db/db_range_del_test.cc                                               \
+  db/db_secondary_test.cc                                               \
   db/db_sst_test.cc                                                     \
   db/db_statistics_test.cc                                              \
   db/db_table_properties_test.cc                                        \
@@ -338,6 +381,9 @@ MAIN_SOURCES =                                                          \
   db/hash_table_test.cc                                                 \
   db/hash_test.cc                                                       \
   db/heap_test.cc                                                       \
+  db/hot_block_set_test.cc                                              \
+  db/key_hotness_sampler_test.cc                                        \
+  db/level_key_model_test.cc                                            \
   db/listener_test.cc                                                   \
   db/log_test.cc                                                        \
   db/lru_cache_test.cc                                                  \
@@ -355,6 +401,7 @@ MAIN_SOURCES =                                                          \
   db/plain_table_db_test.cc                                             \
   db/prefix_test.cc                                                     \
   db/redis_test.cc                                                      \
+  db/remote_compaction_scheduler_test.cc                                \
   db/repair_test.cc                                                     \
   db/range_del_aggregator_test.cc                                       \
   db/range_del_aggregator_bench.cc                                      \
@@ -365,9 +412,11 @@ MAIN_SOURCES =                                                          \
   db/version_edit_test.cc                                               \
   db/version_set_test.cc                                                \
   db/wal_manager_test.cc                                                \
+  db/wal_syncer_test.cc                                                 \
   db/write_batch_test.cc                                                \
   db/write_callback_test.cc                                             \
   db/write_controller_test.cc                                           \
+  db/zone_gc_picker_test.cc                                             \
   env/env_basic_test.cc                                                 \
   env/env_test.cc                                                       \
   env/mock_env_test.cc                                                  \
@@ -377,7 +426,9 @@ MAIN_SOURCES =                                                          \
   memtable/terark_zip_entry_index.cc                                    \
   memtable/terark_zip_memtable.cc                                       \
   memtable/write_buffer_manager_test.cc                                 \
+  monitoring/cpu_attribution_test.cc                                    \
   monitoring/histogram_test.cc                                          \
+  monitoring/io_attribution_test.cc                                     \
   monitoring/iostats_context_test.cc                                    \
   monitoring/statistics_test.cc                                         \
   options/options_settable_test.cc                                      \
@@ -385,10 +436,13 @@ MAIN_SOURCES =                                                          \
   table/block_based_filter_block_test.cc                                \
   table/block_test.cc                                                   \
   table/cleanable_test.cc                                               \
+  table/columnar_block_test.cc                                          \
   table/cuckoo_table_builder_test.cc                                    \
   table/cuckoo_table_reader_test.cc                                     \
   table/data_block_hash_index_test.cc                                   \
+  table/data_block_key_prefix_test.cc                                   \
   table/full_filter_block_test.cc                                       \
+  table/hot_block_sampler_test.cc                                       \
   table/merger_test.cc                                                  \
   table/sst_file_reader_test.cc                                         \
   table/table_reader_bench.cc                                           \
@@ -401,6 +455,7 @@ MAIN_SOURCES =                                                          \
   tools/db_bench.cc                                                     \
   tools/db_bench_tool_test.cc                                           \
   tools/db_sanity_test.cc                                               \
+  tools/dump/db_export_tool_test.cc                                     \
   tools/ldb_cmd_test.cc                                                 \
   tools/reduce_levels_test.cc                                           \
   tools/sst_dump_test.cc                                                \
@@ -414,20 +469,26 @@ MAIN_SOURCES =                                                          \
   util/dynamic_bloom_test.cc                                            \
   util/event_logger_test.cc                                             \
   util/filelock_test.cc                                                 \
+  util/pooling_memory_allocator_test.cc                                 \
   util/log_write_bench.cc                                               \
   util/rate_limiter_test.cc                                             \
   util/repeatable_thread_test.cc                                        \
+  util/sketch_oracle_test.cc                                            \
   util/slice_transform_test.cc                                          \
   util/timer_queue_test.cc                                              \
   util/timer_test.cc                                                    \
   util/thread_list_test.cc                                              \
   util/thread_local_test.cc                                             \
+  util/zone_gc_rate_limiter_test.cc                                     \
+  util/zone_token_scheduler_test.cc                                     \
+  utilities/auto_tuner/auto_tuner_test.cc                               \
   utilities/backupable/backupable_db_test.cc                            \
   utilities/cassandra/cassandra_format_test.cc                          \
   utilities/cassandra/cassandra_functional_test.cc                      \
   utilities/cassandra/cassandra_row_merge_test.cc                       \
   utilities/cassandra/cassandra_serialize_test.cc                       \
   utilities/checkpoint/checkpoint_test.cc                               \
+  utilities/chunked_value/chunked_value_store_test.cc                   \
   utilities/column_aware_encoding_exp.cc                                \
   utilities/column_aware_encoding_test.cc                               \
   utilities/date_tiered/date_tiered_test.cc                             \
@@ -449,6 +510,7 @@ MAIN_SOURCES =                                                          \
   utilities/transactions/transaction_test.cc                            \
   utilities/transactions/write_prepared_transaction_test.cc             \
   utilities/transactions/write_unprepared_transaction_test.cc           \
+  utilities/trace/stats_test.cc                                         \
   utilities/ttl/ttl_test.cc                                             \
   utilities/write_batch_with_index/write_batch_with_index_test.cc       \
 
@@ -22,7 +22,9 @@
 #include "rocksdb/comparator.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/block_prefix_index.h"
+#include "table/columnar_block.h"
 #include "table/data_block_footer.h"
+#include "table/data_block_key_prefix.h"
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/logging.h"
@@ -203,15 +205,38 @@ void DataBlockIter::Prev() {
   prev_entries_idx_ = static_cast<int32_t>(prev_entries_.size()) - 1;
 }
 
-void DataBlockIter::Seek(const Slice& target) {
+// Restarts whose key prefix is less than the one of the user key of `target`
+// have smaller keys, those whose prefix is greater have larger keys, so the
+// last restart with a key less than target, which BinarySeek() looks for, is
+// in [lower bound - 1, upper bound - 1] of the prefix.
+void DataBlockIter::NarrowRestartsByKeyPrefix(const Slice& target,
+                                              uint32_t* left,
+                                              uint32_t* right) const {
+  // A target shorter than the internal key footer has no user key to narrow by
+  if (key_prefixes_ == nullptr || target.size() < 8) {
+    return;
+  }
+  int64_t prefix = EncodeDataBlockKeyPrefix(ExtractUserKey(target));
+  uint32_t lower = DataBlockKeyPrefixBound(key_prefixes_, 0, num_restarts_,
+                                           prefix, false /* or_equal */);
+  uint32_t upper = DataBlockKeyPrefixBound(key_prefixes_, lower, num_restarts_,
+                                           prefix, true /* or_equal */);
+  *left = lower == 0 ? 0 : lower - 1;
+  *right = upper == 0 ? 0 : upper - 1;
+}
+
+template <class KeyCompare>
+void DataBlockIter::SeekImpl(const Slice& target, const KeyCompare& compare) {
   Slice seek_key = target;
   PERF_TIMER_GUARD(block_seek_nanos);
   if (data_ == nullptr) {  // Not init yet
     return;
   }
   uint32_t index = 0;
-  bool ok = BinarySeek<DecodeKey>(seek_key, 0, num_restarts_ - 1, &index,
-                                  comparator_);
+  uint32_t left = 0;
+  uint32_t right = num_restarts_ - 1;
+  NarrowRestartsByKeyPrefix(seek_key, &left, &right);
+  bool ok = BinarySeek<DecodeKey>(seek_key, left, right, &index, &compare);
 
   if (!ok) {
     return;
@@ -220,12 +245,27 @@ void DataBlockIter::Seek(const Slice& target) {
   // Linear search (within restart block) for first key >= target
 
   while (true) {
-    if (!ParseNextDataKey() || Compare(key_, seek_key) >= 0) {
+    if (!ParseNextDataKey() ||
+        compare.Compare(key_.GetInternalKey(), seek_key) >= 0) {
       return;
     }
   }
 }
 
+void DataBlockIter::Seek(const Slice& target) {
+  switch (bytewise_kind_) {
+    case BytewiseKind::kForward:
+      SeekImpl(target, BytewiseInternalKeyCompare<false>());
+      break;
+    case BytewiseKind::kReverse:
+      SeekImpl(target, BytewiseInternalKeyCompare<true>());
+      break;
+    default:
+      SeekImpl(target, *comparator_);
+      break;
+  }
+}
+
 // Optimized Seek for point lookup for an internal key `target`
 // target = "seek_user_key @ type | seqno".
 //
@@ -329,12 +369,12 @@ bool DataBlockIter::SeekForGetImpl(const Slice& target) {
     return false;
   }
 
-  // Here we are conservative and only support a limited set of cases
+  // All the entries of the user_key are in this restart interval, otherwise
+  // the hash index would have a collision. The iter is at the first of them
+  // not newer than the seek_key, which is where Get() starts from whatever
+  // the value type, a merge operand or a separated value index included.
   ValueType value_type = ExtractValueType(key_.GetKey());
-  if (value_type != ValueType::kTypeValue &&
-      value_type != ValueType::kTypeDeletion &&
-      value_type != ValueType::kTypeSingleDeletion &&
-      value_type != ValueType::kTypeValueIndex) {
+  if (!IsValueType(value_type)) {
     Seek(target);
     return true;
   }
@@ -384,8 +424,11 @@ void DataBlockIter::SeekForPrev(const Slice& target) {
     return;
   }
   uint32_t index = 0;
-  bool ok = BinarySeek<DecodeKey>(seek_key, 0, num_restarts_ - 1, &index,
-                                  comparator_);
+  uint32_t left = 0;
+  uint32_t right = num_restarts_ - 1;
+  NarrowRestartsByKeyPrefix(seek_key, &left, &right);
+  bool ok =
+      BinarySeek<DecodeKey>(seek_key, left, right, &index, comparator_);
 
   if (!ok) {
     return;
@@ -610,10 +653,10 @@ void IndexBlockIter::DecodeCurrentValue(uint32_t shared) {
 // which means the key of next restart point is larger than target, or
 // the first restart point with a key = target
 template <class TValue>
-template <typename DecodeKeyFunc>
+template <typename DecodeKeyFunc, typename KeyCompare>
 bool BlockIter<TValue>::BinarySeek(const Slice& target, uint32_t left,
                                    uint32_t right, uint32_t* index,
-                                   const Comparator* comp) {
+                                   const KeyCompare* comp) {
   assert(left <= right);
 
   while (left < right) {
@@ -775,14 +818,31 @@ Block::~Block() {
 }
 
 Block::Block(BlockContents&& contents, SequenceNumber _global_seqno,
-             size_t read_amp_bytes_per_bit, Statistics* statistics)
+             size_t read_amp_bytes_per_bit, Statistics* statistics,
+             const std::vector<uint32_t>* value_columns)
     : contents_(std::move(contents)),
       data_(contents_.data.data()),
       size_(contents_.data.size()),
       restart_offset_(0),
       num_restarts_(0),
-      global_seqno_(_global_seqno) {
+      global_seqno_(_global_seqno),
+      key_prefixes_(nullptr) {
   TEST_SYNC_POINT("Block::Block:0");
+  if (IsColumnarBlock(contents_.data)) {
+    // Decoded once here, the iterators and the block cache only see the row
+    // format
+    std::string row_block;
+    if (DecodeColumnarBlock(contents_.data, value_columns, &row_block).ok()) {
+      CacheAllocationPtr buf = AllocateBlock(
+          row_block.size(), contents_.allocation.get_deleter().allocator);
+      memcpy(buf.get(), row_block.data(), row_block.size());
+      contents_ = BlockContents(std::move(buf), row_block.size());
+      data_ = contents_.data.data();
+      size_ = contents_.data.size();
+    } else {
+      size_ = 0;  // Error marker
+    }
+  }
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
   } else {
@@ -822,6 +882,21 @@ Block::Block(BlockContents&& contents, SequenceNumber _global_seqno,
           break;
         }
         break;
+      case BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix: {
+        size_t key_prefixes_offset =
+            size_ - sizeof(uint32_t) -
+            static_cast<size_t>(num_restarts_) * kDataBlockKeyPrefixSize;
+        if (key_prefixes_offset > size_ - sizeof(uint32_t) ||
+            key_prefixes_offset < num_restarts_ * sizeof(uint32_t)) {
+          // The size is too small for NumRestarts()
+          size_ = 0;
+          break;
+        }
+        restart_offset_ = static_cast<uint32_t>(
+            key_prefixes_offset - num_restarts_ * sizeof(uint32_t));
+        key_prefixes_ = data_ + key_prefixes_offset;
+        break;
+      }
       default:
         size_ = 0;  // Error marker
     }
@@ -858,7 +933,8 @@ DataBlockIter* Block::NewIterator(const Comparator* cmp, const Comparator* ucmp,
     ret_iter->Initialize(
         cmp, ucmp, data_, restart_offset_, num_restarts_, global_seqno_,
         read_amp_bitmap_.get(), block_contents_pinned,
-        data_block_hash_index_.Valid() ? &data_block_hash_index_ : nullptr);
+        data_block_hash_index_.Valid() ? &data_block_hash_index_ : nullptr,
+        key_prefixes_);
     if (read_amp_bitmap_) {
       if (read_amp_bitmap_->GetStatistics() != stats) {
         // DB changed the Statistics pointer, we need to notify read_amp_bitmap_
@@ -146,10 +146,13 @@ class BlockReadAmpBitmap {
 
 class Block {
  public:
-  // Initialize the block with the specified contents.
+  // Initialize the block with the specified contents. Columnar data blocks
+  // are decoded to the row format, with only the `value_columns` if not
+  // nullptr, see table/columnar_block.h
   explicit Block(BlockContents&& contents, SequenceNumber _global_seqno,
                  size_t read_amp_bytes_per_bit = 0,
-                 Statistics* statistics = nullptr);
+                 Statistics* statistics = nullptr,
+                 const std::vector<uint32_t>* value_columns = nullptr);
 
   ~Block();
 
@@ -215,6 +218,8 @@ class Block {
   const SequenceNumber global_seqno_;
 
   DataBlockHashIndex data_block_hash_index_;
+  // Restart key prefixes of kDataBlockBinaryAndKeyPrefix blocks, or nullptr
+  const char* key_prefixes_;
 
   // No copying allowed
   Block(const Block&) = delete;
@@ -363,9 +368,10 @@ class BlockIter : public InternalIteratorBase<TValue> {
 
   void CorruptionError();
 
-  template <typename DecodeKeyFunc>
+  // KeyCompare is Comparator or a BytewiseInternalKeyCompare
+  template <typename DecodeKeyFunc, typename KeyCompare>
   inline bool BinarySeek(const Slice& target, uint32_t left, uint32_t right,
-                         uint32_t* index, const Comparator* comp);
+                         uint32_t* index, const KeyCompare* comp);
 };
 
 class DataBlockIter final : public BlockIter<Slice> {
@@ -376,11 +382,12 @@ class DataBlockIter final : public BlockIter<Slice> {
                 const char* data, uint32_t restarts, uint32_t num_restarts,
                 SequenceNumber global_seqno,
                 BlockReadAmpBitmap* read_amp_bitmap, bool block_contents_pinned,
-                DataBlockHashIndex* data_block_hash_index)
+                DataBlockHashIndex* data_block_hash_index,
+                const char* key_prefixes = nullptr)
       : DataBlockIter() {
     Initialize(comparator, user_comparator, data, restarts, num_restarts,
                global_seqno, read_amp_bitmap, block_contents_pinned,
-               data_block_hash_index);
+               data_block_hash_index, key_prefixes);
   }
   void Initialize(const Comparator* comparator,
                   const Comparator* user_comparator, const char* data,
@@ -388,7 +395,8 @@ class DataBlockIter final : public BlockIter<Slice> {
                   SequenceNumber global_seqno,
                   BlockReadAmpBitmap* read_amp_bitmap,
                   bool block_contents_pinned,
-                  DataBlockHashIndex* data_block_hash_index) {
+                  DataBlockHashIndex* data_block_hash_index,
+                  const char* key_prefixes = nullptr) {
     InitializeBase(comparator, data, restarts, num_restarts, global_seqno,
                    block_contents_pinned);
     user_comparator_ = user_comparator;
@@ -396,6 +404,13 @@ class DataBlockIter final : public BlockIter<Slice> {
     read_amp_bitmap_ = read_amp_bitmap;
     last_bitmap_offset_ = current_ + 1;
     data_block_hash_index_ = data_block_hash_index;
+    key_prefixes_ = key_prefixes;
+    // Tables give data blocks the InternalKeyComparator of user_comparator,
+    // meta blocks of user keys are given user_comparator alone
+    bytewise_kind_ = comparator != user_comparator &&
+                             comparator->GetRootComparator() == user_comparator
+                         ? GetBytewiseKind(user_comparator)
+                         : BytewiseKind::kNone;
   }
 
   virtual Slice value() const override {
@@ -468,15 +483,26 @@ class DataBlockIter final : public BlockIter<Slice> {
   int32_t prev_entries_idx_ = -1;
 
   DataBlockHashIndex* data_block_hash_index_;
+  // See Block::key_prefixes_
+  const char* key_prefixes_ = nullptr;
   const Comparator* user_comparator_;
+  // Seek() compares with the BytewiseInternalKeyCompare of this, if any
+  BytewiseKind bytewise_kind_ = BytewiseKind::kNone;
 
   inline bool ParseNextDataKey(const char* limit = nullptr);
 
+  // The restarts [*left, *right] BinarySeek() needs to look at for `target`
+  inline void NarrowRestartsByKeyPrefix(const Slice& target, uint32_t* left,
+                                        uint32_t* right) const;
+
   inline int Compare(const IterKey& ikey, const Slice& b) const {
     return comparator_->Compare(ikey.GetInternalKey(), b);
   }
 
   bool SeekForGetImpl(const Slice& target);
+
+  template <class KeyCompare>
+  inline void SeekImpl(const Slice& target, const KeyCompare& compare);
 };
 
 class IndexBlockIter final : public BlockIter<BlockHandle> {
@@ -12,13 +12,16 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <deque>
 #include <list>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "db/version_edit.h"
+#include "port/port.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/env.h"
@@ -32,6 +35,7 @@
 #include "table/block_based_table_factory.h"
 #include "table/block_based_table_reader.h"
 #include "table/block_builder.h"
+#include "table/columnar_block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "table/full_filter_block.h"
@@ -42,7 +46,9 @@
 #include "util/compression.h"
 #include "util/crc32c.h"
 #include "util/memory_allocator.h"
+#include "util/mutexlock.h"
 #include "util/stop_watch.h"
+#include "util/xxh3.h"
 #include "util/xxhash.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -98,6 +104,34 @@ bool GoodCompressionRatio(size_t compressed_size, size_t raw_size) {
   return compressed_size < raw_size - (raw_size / 8u);
 }
 
+// The data block index type the user comparator can support. Neither index
+// works if keys of different bytes can be equal, and the key prefixes follow
+// bytewise order only.
+BlockBasedTableOptions::DataBlockIndexType DataBlockIndexTypeFor(
+    const BlockBasedTableOptions& table_opt, const Comparator* user_cmp) {
+  if (user_cmp->CanKeysWithDifferentByteContentsBeEqual() ||
+      (table_opt.data_block_index_type ==
+           BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix &&
+       user_cmp != BytewiseComparator())) {
+    return BlockBasedTableOptions::kDataBlockBinarySearch;
+  }
+  return table_opt.data_block_index_type;
+}
+
+// A block per record for the blob SSTs with blob_compression_per_record
+FlushBlockPolicy* NewDataBlockFlushPolicy(
+    const TableBuilderOptions& builder_opt,
+    const BlockBasedTableOptions& table_opt, const BlockBuilder& data_block) {
+  if (builder_opt.for_blob &&
+      builder_opt.moptions.blob_compression_per_record) {
+    // Flushes as soon as the block isn't empty
+    return FlushBlockBySizePolicyFactory::NewFlushBlockPolicy(1, 0,
+                                                              data_block);
+  }
+  return table_opt.flush_block_policy_factory->NewFlushBlockPolicy(table_opt,
+                                                                   data_block);
+}
+
 }  // namespace
 
 // format_version is the block format as defined in include/rocksdb/table.h
@@ -241,6 +275,55 @@ class BlockBasedTableBuilder::BlockBasedTablePropertiesCollector
   bool prefix_filtering_;
 };
 
+// Data blocks handed to the compression threads. They are written back in
+// the order they were added, by the thread adding the keys, which also adds
+// their index entries then.
+struct BlockBasedTableBuilder::ParallelCompressionRep {
+  struct BlockRep {
+    std::string raw;
+    std::string compressed;
+    Slice contents;
+    CompressionType type = kNoCompression;
+    Status status;
+    // For the index entry of the block
+    std::string last_key;
+    std::string first_key_in_next_block;
+    bool has_next_block = false;
+    bool done = false;
+  };
+
+  port::Mutex mu;
+  port::CondVar work_cv;
+  port::CondVar done_cv;
+  // All blocks not yet written back, in order
+  std::deque<std::unique_ptr<BlockRep>> blocks;
+  std::deque<BlockRep*> to_compress;
+  size_t max_blocks_in_flight;
+  bool shutdown = false;
+  std::vector<port::Thread> threads;
+
+  explicit ParallelCompressionRep(size_t num_threads)
+      : work_cv(&mu), done_cv(&mu), max_blocks_in_flight(num_threads * 2) {}
+
+  ~ParallelCompressionRep() { Stop(); }
+
+  // Compress the blocks of `r` on `num_threads` threads
+  void Start(Rep* r, size_t num_threads);
+
+  // Compress what is queued, and join the threads
+  void Stop() {
+    {
+      MutexLock l(&mu);
+      shutdown = true;
+      work_cv.SignalAll();
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    threads.clear();
+  }
+};
+
 struct BlockBasedTableBuilder::Rep {
   const ImmutableCFOptions ioptions;
   const MutableCFOptions moptions;
@@ -251,6 +334,8 @@ struct BlockBasedTableBuilder::Rep {
   Status status;
   size_t alignment;
   BlockBuilder data_block;
+  // Set with value_col_declarations, holds the same entries as data_block
+  std::unique_ptr<ColumnarBlockBuilder> columnar_block;
   BlockBuilder range_del_block;
 
   InternalKeySliceTransform internal_prefix_transform;
@@ -286,6 +371,11 @@ struct BlockBasedTableBuilder::Rep {
 
   std::vector<std::unique_ptr<IntTblPropCollector>> table_properties_collectors;
 
+  // Set if the data blocks are compressed in the background
+  std::unique_ptr<ParallelCompressionRep> parallel;
+  // The raw size of the data blocks not yet written back
+  uint64_t raw_bytes_in_flight = 0;
+
   Rep(const TableBuilderOptions& builder_opt,
       const BlockBasedTableOptions& table_opt, uint32_t _column_family_id,
       WritableFileWriter* f)
@@ -300,10 +390,9 @@ struct BlockBasedTableBuilder::Rep {
         data_block(table_options.block_restart_interval,
                    table_options.use_delta_encoding,
                    false /* use_value_delta_encoding */,
-                   builder_opt.internal_comparator.user_comparator()
-                           ->CanKeysWithDifferentByteContentsBeEqual()
-                       ? BlockBasedTableOptions::kDataBlockBinarySearch
-                       : table_options.data_block_index_type,
+                   DataBlockIndexTypeFor(
+                       table_options,
+                       builder_opt.internal_comparator.user_comparator()),
                    table_options.data_block_hash_table_util_ratio),
         range_del_block(1 /* block_restart_interval */),
         internal_prefix_transform(builder_opt.moptions.prefix_extractor.get()),
@@ -314,8 +403,7 @@ struct BlockBasedTableBuilder::Rep {
                                             !table_opt.block_align),
         compressed_cache_key_prefix_size(0),
         flush_block_policy(
-            table_options.flush_block_policy_factory->NewFlushBlockPolicy(
-                table_options, data_block)),
+            NewDataBlockFlushPolicy(builder_opt, table_options, data_block)),
         column_family_id(_column_family_id),
         column_family_name(builder_opt.column_family_name),
         creation_time(builder_opt.creation_time),
@@ -333,6 +421,12 @@ struct BlockBasedTableBuilder::Rep {
           &this->internal_prefix_transform, use_delta_encoding_for_index_values,
           table_options));
     }
+    // BlockBasedTableFactory::SanitizeOptions() rejects invalid declarations
+    if (!table_options.value_col_declarations.empty() &&
+        ValidateColDeclarations(table_options.value_col_declarations).ok()) {
+      columnar_block.reset(
+          new ColumnarBlockBuilder(table_options.value_col_declarations));
+    }
     if (builder_opt.skip_filters) {
       filter_builder = nullptr;
     } else {
@@ -351,6 +445,18 @@ struct BlockBasedTableBuilder::Rep {
       verify_ctx.reset(new UncompressionContext(UncompressionContext::NoCache(),
                                                 compression_ctx.type()));
     }
+    // Index entries are added when the blocks are written back. That breaks
+    // the hash index, which tracks the prefixes per block as keys are added,
+    // the index partitions cut by the keys, and the block based filters cut
+    // by file offsets.
+    if (table_options.parallel_compression_threads > 1 &&
+        compression_ctx.type() != kNoCompression &&
+        table_options.index_type == BlockBasedTableOptions::kBinarySearch &&
+        (filter_builder == nullptr || !filter_builder->IsBlockBased())) {
+      parallel.reset(new ParallelCompressionRep(
+          table_options.parallel_compression_threads));
+      parallel->Start(this, table_options.parallel_compression_threads);
+    }
   }
 
   Rep(const Rep&) = delete;
@@ -411,7 +517,10 @@ Status BlockBasedTableBuilder::Add(const Slice& key,
   }
 
   auto should_flush = r->flush_block_policy->Update(key, value);
-  if (should_flush) {
+  if (should_flush && r->parallel != nullptr) {
+    assert(!r->data_block.empty());
+    SubmitDataBlock(&key);
+  } else if (should_flush) {
     assert(!r->data_block.empty());
     Flush();
 
@@ -435,6 +544,9 @@ Status BlockBasedTableBuilder::Add(const Slice& key,
 
   r->last_key.assign(key.data(), key.size());
   r->data_block.Add(key, value);
+  if (r->columnar_block != nullptr) {
+    r->columnar_block->Add(key, value);
+  }
   r->props.num_entries++;
   r->props.raw_key_size += key.size();
   r->props.raw_value_size += value.size();
@@ -478,7 +590,8 @@ void BlockBasedTableBuilder::Flush() {
   assert(!r->closed);
   if (!ok()) return;
   if (r->data_block.empty()) return;
-  WriteBlock(&r->data_block, &r->pending_handle, true /* is_data_block */);
+  WriteBlock(FinishDataBlock(), &r->pending_handle, true /* is_data_block */);
+  ResetDataBlock();
   if (r->filter_builder != nullptr) {
     r->filter_builder->StartBlock(r->offset);
   }
@@ -486,6 +599,90 @@ void BlockBasedTableBuilder::Flush() {
   ++r->props.num_data_blocks;
 }
 
+Slice BlockBasedTableBuilder::FinishDataBlock() {
+  Rep* r = rep_;
+  if (r->columnar_block != nullptr && r->columnar_block->Qualified()) {
+    return r->columnar_block->Finish();
+  }
+  return r->data_block.Finish();
+}
+
+void BlockBasedTableBuilder::ResetDataBlock() {
+  Rep* r = rep_;
+  r->data_block.Reset();
+  if (r->columnar_block != nullptr) {
+    r->columnar_block->Reset();
+  }
+}
+
+void BlockBasedTableBuilder::SubmitDataBlock(
+    const Slice* first_key_in_next_block) {
+  Rep* r = rep_;
+  auto* pc = r->parallel.get();
+  if (!ok() || r->data_block.empty()) {
+    return;
+  }
+  std::unique_ptr<ParallelCompressionRep::BlockRep> block(
+      new ParallelCompressionRep::BlockRep);
+  block->raw = FinishDataBlock().ToString();
+  ResetDataBlock();
+  block->last_key = r->last_key;
+  if (first_key_in_next_block != nullptr) {
+    block->first_key_in_next_block = first_key_in_next_block->ToString();
+    block->has_next_block = true;
+  }
+  r->raw_bytes_in_flight += block->raw.size();
+  {
+    MutexLock l(&pc->mu);
+    pc->to_compress.push_back(block.get());
+    pc->blocks.emplace_back(std::move(block));
+    pc->work_cv.Signal();
+  }
+  WriteBackDataBlocks(false /* wait_all */);
+}
+
+void BlockBasedTableBuilder::WriteBackDataBlocks(bool wait_all) {
+  Rep* r = rep_;
+  auto* pc = r->parallel.get();
+  while (true) {
+    std::unique_ptr<ParallelCompressionRep::BlockRep> block;
+    {
+      MutexLock l(&pc->mu);
+      while (!pc->blocks.empty() && !pc->blocks.front()->done &&
+             (wait_all || pc->blocks.size() > pc->max_blocks_in_flight)) {
+        pc->done_cv.Wait();
+      }
+      if (pc->blocks.empty() || !pc->blocks.front()->done) {
+        return;
+      }
+      block = std::move(pc->blocks.front());
+      pc->blocks.pop_front();
+    }
+    r->raw_bytes_in_flight -= block->raw.size();
+    if (!ok()) {
+      continue;
+    }
+    if (!block->status.ok()) {
+      r->status = block->status;
+      continue;
+    }
+    WriteRawBlock(block->contents, block->type, &r->pending_handle,
+                  true /* is_data_block */);
+    if (!ok()) {
+      continue;
+    }
+    if (r->filter_builder != nullptr) {
+      r->filter_builder->StartBlock(r->offset);
+    }
+    r->props.data_size = r->offset;
+    ++r->props.num_data_blocks;
+    Slice next_key(block->first_key_in_next_block);
+    r->index_builder->AddIndexEntry(&block->last_key,
+                                    block->has_next_block ? &next_key : nullptr,
+                                    r->pending_handle);
+  }
+}
+
 void BlockBasedTableBuilder::WriteBlock(BlockBuilder* block,
                                         BlockHandle* handle,
                                         bool is_data_block) {
@@ -493,68 +690,60 @@ void BlockBasedTableBuilder::WriteBlock(BlockBuilder* block,
   block->Reset();
 }
 
-void BlockBasedTableBuilder::WriteBlock(const Slice& raw_block_contents,
-                                        BlockHandle* handle,
-                                        bool is_data_block) {
-  // File format contains a sequence of blocks where each block has:
-  //    block_data: uint8[n]
-  //    type: uint8
-  //    crc: uint32
-  assert(ok());
-  Rep* r = rep_;
-
-  auto type = r->compression_ctx.type();
+namespace {
+// Compress `raw` with `ctx` primed with `dict`, and verify the result with
+// `verify_ctx` if not nullptr. Returns the contents to write with their type,
+// which point into `raw` or `*compressed_output`. A failed verification sets
+// `*status` and falls back to the raw contents. Called on the compression
+// threads as well.
+Slice CompressAndVerifyBlock(const Slice& raw, const Slice& dict,
+                             const ImmutableCFOptions& ioptions,
+                             uint32_t format_version, CompressionContext* ctx,
+                             UncompressionContext* verify_ctx,
+                             CompressionType* type,
+                             std::string* compressed_output, Status* status) {
+  *type = ctx->type();
   Slice block_contents;
   bool abort_compression = false;
 
-  StopWatchNano timer(
-      r->ioptions.env,
-      ShouldReportDetailedTime(r->ioptions.env, r->ioptions.statistics));
-
-  if (raw_block_contents.size() < kCompressionSizeLimit) {
-    Slice compression_dict;
-    if (is_data_block && r->compression_dict && r->compression_dict->size()) {
-      r->compression_ctx.dict() = *r->compression_dict;
-      if (r->table_options.verify_compression) {
-        assert(r->verify_ctx != nullptr);
-        r->verify_ctx->dict() = *r->compression_dict;
-      }
-    } else {
-      // Clear dictionary
-      r->compression_ctx.dict() = Slice();
-      if (r->table_options.verify_compression) {
-        assert(r->verify_ctx != nullptr);
-        r->verify_ctx->dict() = Slice();
-      }
+  StopWatchNano timer(ioptions.env,
+                      ShouldReportDetailedTime(ioptions.env,
+                                               ioptions.statistics));
+
+  // Same as kCompressionSizeLimit, some compression libraries fail on blocks
+  // larger than int
+  if (raw.size() < static_cast<size_t>(std::numeric_limits<int>::max())) {
+    ctx->dict() = dict;
+    if (verify_ctx != nullptr) {
+      verify_ctx->dict() = dict;
     }
 
     block_contents =
-        CompressBlock(raw_block_contents, r->compression_ctx, &type,
-                      r->table_options.format_version, &r->compressed_output);
+        CompressBlock(raw, *ctx, type, format_version, compressed_output);
 
     // Some of the compression algorithms are known to be unreliable. If
     // the verify_compression flag is set then try to de-compress the
     // compressed data and compare to the input.
-    if (type != kNoCompression && r->table_options.verify_compression) {
+    if (*type != kNoCompression && verify_ctx != nullptr) {
       // Retrieve the uncompressed contents into a new buffer
       BlockContents contents;
       Status stat = UncompressBlockContentsForCompressionType(
-          *r->verify_ctx, block_contents.data(), block_contents.size(),
-          &contents, r->table_options.format_version, r->ioptions);
+          *verify_ctx, block_contents.data(), block_contents.size(), &contents,
+          format_version, ioptions);
 
       if (stat.ok()) {
-        bool compressed_ok = contents.data.compare(raw_block_contents) == 0;
+        bool compressed_ok = contents.data.compare(raw) == 0;
         if (!compressed_ok) {
           // The result of the compression was invalid. abort.
           abort_compression = true;
-          ROCKS_LOG_ERROR(r->ioptions.info_log,
+          ROCKS_LOG_ERROR(ioptions.info_log,
                           "Decompressed block did not match raw block");
-          r->status =
+          *status =
               Status::Corruption("Decompressed block did not match raw block");
         }
       } else {
         // Decompression reported an error. abort.
-        r->status = Status::Corruption("Could not decompress");
+        *status = Status::Corruption("Could not decompress");
         abort_compression = true;
       }
     }
@@ -566,18 +755,77 @@ void BlockBasedTableBuilder::WriteBlock(const Slice& raw_block_contents,
   // Abort compression if the block is too big, or did not pass
   // verification.
   if (abort_compression) {
-    RecordTick(r->ioptions.statistics, NUMBER_BLOCK_NOT_COMPRESSED);
-    type = kNoCompression;
-    block_contents = raw_block_contents;
-  } else if (type != kNoCompression) {
-    if (ShouldReportDetailedTime(r->ioptions.env, r->ioptions.statistics)) {
-      MeasureTime(r->ioptions.statistics, COMPRESSION_TIMES_NANOS,
+    RecordTick(ioptions.statistics, NUMBER_BLOCK_NOT_COMPRESSED);
+    *type = kNoCompression;
+    block_contents = raw;
+  } else if (*type != kNoCompression) {
+    if (ShouldReportDetailedTime(ioptions.env, ioptions.statistics)) {
+      MeasureTime(ioptions.statistics, COMPRESSION_TIMES_NANOS,
                   timer.ElapsedNanos());
     }
-    MeasureTime(r->ioptions.statistics, BYTES_COMPRESSED,
-                raw_block_contents.size());
-    RecordTick(r->ioptions.statistics, NUMBER_BLOCK_COMPRESSED);
+    MeasureTime(ioptions.statistics, BYTES_COMPRESSED, raw.size());
+    RecordTick(ioptions.statistics, NUMBER_BLOCK_COMPRESSED);
+  }
+  return block_contents;
+}
+}  // namespace
+
+void BlockBasedTableBuilder::ParallelCompressionRep::Start(Rep* r,
+                                                           size_t num_threads) {
+  auto worker = [this, r]() {
+    CompressionContext ctx(r->compression_ctx.type(),
+                           r->compression_ctx.options());
+    std::unique_ptr<UncompressionContext> verify_ctx;
+    if (r->verify_ctx != nullptr) {
+      verify_ctx.reset(new UncompressionContext(
+          UncompressionContext::NoCache(), ctx.type()));
+    }
+    const Slice dict =
+        r->compression_dict ? Slice(*r->compression_dict) : Slice();
+    while (true) {
+      BlockRep* block;
+      {
+        MutexLock l(&mu);
+        while (to_compress.empty() && !shutdown) {
+          work_cv.Wait();
+        }
+        if (to_compress.empty()) {
+          return;
+        }
+        block = to_compress.front();
+        to_compress.pop_front();
+      }
+      block->contents = CompressAndVerifyBlock(
+          block->raw, dict, r->ioptions, r->table_options.format_version,
+          &ctx, verify_ctx.get(), &block->type, &block->compressed,
+          &block->status);
+      MutexLock l(&mu);
+      block->done = true;
+      done_cv.SignalAll();
+    }
+  };
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
   }
+}
+
+void BlockBasedTableBuilder::WriteBlock(const Slice& raw_block_contents,
+                                        BlockHandle* handle,
+                                        bool is_data_block) {
+  // File format contains a sequence of blocks where each block has:
+  //    block_data: uint8[n]
+  //    type: uint8
+  //    crc: uint32
+  assert(ok());
+  Rep* r = rep_;
+
+  CompressionType type;
+  Slice block_contents = CompressAndVerifyBlock(
+      raw_block_contents,
+      is_data_block && r->compression_dict ? Slice(*r->compression_dict)
+                                           : Slice(),
+      r->ioptions, r->table_options.format_version, &r->compression_ctx,
+      r->verify_ctx.get(), &type, &r->compressed_output, &r->status);
 
   WriteRawBlock(block_contents, type, handle, is_data_block);
   r->compressed_output.clear();
@@ -628,6 +876,12 @@ void BlockBasedTableBuilder::WriteRawBlock(const Slice& block_contents,
         XXH64_freeState(state);
         break;
       }
+      case kXXH3:
+        EncodeFixed32(trailer_without_type,
+                      XXH3ChecksumWithLastByte(block_contents.data(),
+                                               block_contents.size(),
+                                               trailer[0]));
+        break;
     }
 
     assert(r->status.ok());
@@ -887,7 +1141,15 @@ Status BlockBasedTableBuilder::Finish(
   Rep* r = rep_;
   assert(r->status.ok());
   bool empty_data_block = r->data_block.empty();
-  Flush();
+  if (r->parallel != nullptr) {
+    // The last index entry is added with the block, once all are written
+    SubmitDataBlock(nullptr);
+    WriteBackDataBlocks(true /* wait_all */);
+    r->parallel.reset();
+    empty_data_block = true;
+  } else {
+    Flush();
+  }
   assert(!r->closed);
   r->closed = true;
 
@@ -966,13 +1228,22 @@ void BlockBasedTableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  if (r->parallel != nullptr) {
+    {
+      MutexLock l(&r->parallel->mu);
+      r->parallel->to_compress.clear();
+    }
+    r->parallel.reset();
+  }
 }
 
 uint64_t BlockBasedTableBuilder::NumEntries() const {
   return rep_->props.num_entries;
 }
 
-uint64_t BlockBasedTableBuilder::FileSize() const { return rep_->offset; }
+uint64_t BlockBasedTableBuilder::FileSize() const {
+  return rep_->offset + rep_->raw_bytes_in_flight;
+}
 
 bool BlockBasedTableBuilder::NeedCompact() const {
   for (const auto& collector : rep_->table_properties_collectors) {
@@ -113,6 +113,7 @@ class BlockBasedTableBuilder : public TableBuilder {
   void WriteRangeDelBlock(MetaIndexBuilder* meta_index_builder);
 
   struct Rep;
+  struct ParallelCompressionRep;
   class BlockBasedTablePropertiesCollectorFactory;
   class BlockBasedTablePropertiesCollector;
   Rep* rep_;
@@ -123,6 +124,20 @@ class BlockBasedTableBuilder : public TableBuilder {
   // REQUIRES: Finish(), Abandon() have not been called
   void Flush();
 
+  // Finish the data block, in the columnar format if the table declares value
+  // columns and the block qualifies, see table/columnar_block.h. The result
+  // is valid until ResetDataBlock().
+  Slice FinishDataBlock();
+  void ResetDataBlock();
+
+  // Hand the data block to the compression threads, with the first key of
+  // the next block for its index entry, nullptr for the last block
+  void SubmitDataBlock(const Slice* first_key_in_next_block);
+
+  // Write back the compressed data blocks at the head of the queue, waiting
+  // for all of them if `wait_all`, or else only while too many are queued
+  void WriteBackDataBlocks(bool wait_all);
+
   // Some compression libraries fail when the raw size is bigger than int. If
   // uncompressed size is bigger than kCompressionSizeLimit, don't compress it
   const uint64_t kCompressionSizeLimit = std::numeric_limits<int>::max();
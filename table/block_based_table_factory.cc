@@ -22,11 +22,13 @@
 #include "options/options_helper.h"
 #include "port/port.h"
 #include "rocksdb/cache.h"
+#include "rocksdb/comparator.h"
 #include "rocksdb/convenience.h"
 #include "rocksdb/flush_block_policy.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/block_based_table_builder.h"
 #include "table/block_based_table_reader.h"
+#include "table/columnar_block.h"
 #include "table/format.h"
 #include "util/mutexlock.h"
 #include "util/string_util.h"
@@ -202,10 +204,11 @@ Status BlockBasedTableFactory::NewTableReader(
       table_reader_options.ioptions, table_reader_options.env_options,
       table_options_, table_reader_options.internal_comparator, std::move(file),
       table_reader_options.file_number, file_size, table_reader,
-      table_reader_options.prefix_extractor, prefetch_index_and_filter_in_cache,
+      table_reader_options.prefix_extractor,
+      prefetch_index_and_filter_in_cache && !table_reader_options.cold,
       table_reader_options.skip_filters, table_reader_options.level,
       table_reader_options.immortal, table_reader_options.largest_seqno,
-      &tail_prefetch_stats_);
+      &tail_prefetch_stats_, table_reader_options.tail_size_hint);
 }
 
 TableBuilder* BlockBasedTableFactory::NewTableBuilder(
@@ -237,6 +240,12 @@ Status BlockBasedTableFactory::SanitizeOptions(
         "Enable pin_l0_filter_and_index_blocks_in_cache, "
         ", but block cache is disabled");
   }
+  if (table_options_.pin_index_and_filter_partitions_max_level >= 0 &&
+      table_options_.no_block_cache) {
+    return Status::InvalidArgument(
+        "Enable pin_index_and_filter_partitions_max_level, "
+        ", but block cache is disabled");
+  }
   if (!BlockBasedTableSupportedVersion(table_options_.format_version)) {
     return Status::InvalidArgument(
         "Unsupported BlockBasedTable format_version. Please check "
@@ -259,6 +268,19 @@ Status BlockBasedTableFactory::SanitizeOptions(
         "data_block_hash_table_util_ratio should be greater than 0 when "
         "data_block_index_type is set to kDataBlockBinaryAndHash");
   }
+  if (table_options_.data_block_index_type ==
+          BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix &&
+      cf_opts.comparator != BytewiseComparator()) {
+    return Status::InvalidArgument(
+        "data_block_index_type kDataBlockBinaryAndKeyPrefix is only supported "
+        "with BytewiseComparator");
+  }
+  if (!table_options_.value_col_declarations.empty()) {
+    Status s = ValidateColDeclarations(table_options_.value_col_declarations);
+    if (!s.ok()) {
+      return s;
+    }
+  }
   return Status::OK();
 }
 
@@ -286,6 +308,14 @@ std::string BlockBasedTableFactory::GetPrintableTableOptions() const {
   snprintf(buffer, kBufferSize, "  pin_top_level_index_and_filter: %d\n",
            table_options_.pin_top_level_index_and_filter);
   ret.append(buffer);
+  snprintf(buffer, kBufferSize,
+           "  pin_top_level_index_and_filter_max_level: %d\n",
+           table_options_.pin_top_level_index_and_filter_max_level);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize,
+           "  pin_index_and_filter_partitions_max_level: %d\n",
+           table_options_.pin_index_and_filter_partitions_max_level);
+  ret.append(buffer);
   snprintf(buffer, kBufferSize, "  index_type: %d\n",
            table_options_.index_type);
   ret.append(buffer);
@@ -376,6 +406,13 @@ std::string BlockBasedTableFactory::GetPrintableTableOptions() const {
   snprintf(buffer, kBufferSize, "  block_align: %d\n",
            table_options_.block_align);
   ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  parallel_compression_threads: %u\n",
+           table_options_.parallel_compression_threads);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  value_col_declarations: %" ROCKSDB_PRIszt
+           " columns\n",
+           table_options_.value_col_declarations.size());
+  ret.append(buffer);
   return ret;
 }
 
@@ -185,9 +185,20 @@ static std::unordered_map<std::string, OptionTypeInfo>
         {"block_align",
          {offsetof(struct BlockBasedTableOptions, block_align),
           OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"parallel_compression_threads",
+         {offsetof(struct BlockBasedTableOptions, parallel_compression_threads),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, false, 0}},
         {"pin_top_level_index_and_filter",
          {offsetof(struct BlockBasedTableOptions,
                    pin_top_level_index_and_filter),
-          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}}};
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"pin_top_level_index_and_filter_max_level",
+         {offsetof(struct BlockBasedTableOptions,
+                   pin_top_level_index_and_filter_max_level),
+          OptionType::kInt, OptionVerificationType::kNormal, false, 0}},
+        {"pin_index_and_filter_partitions_max_level",
+         {offsetof(struct BlockBasedTableOptions,
+                   pin_index_and_filter_partitions_max_level),
+          OptionType::kInt, OptionVerificationType::kNormal, false, 0}}};
 #endif  // !ROCKSDB_LITE
 }  // namespace TERARKDB_NAMESPACE
@@ -67,6 +67,9 @@ BlockBasedTable::~BlockBasedTable() {
 std::atomic<uint64_t> BlockBasedTable::next_cache_key_id_(0);
 
 namespace {
+// Bounds the blocks the hot block sampler of a table remembers
+const size_t kMaxSampledHotBlocks = 1024;
+
 // Read the block identified by "handle" from "file".
 // The only relevant option is options.verify_checksums for now.
 // On failure return non-OK.
@@ -87,8 +90,12 @@ Status ReadBlockFromFile(
                              memory_allocator);
   Status s = block_fetcher.ReadBlockContents();
   if (s.ok()) {
-    result->reset(new Block(std::move(contents), global_seqno,
-                            read_amp_bytes_per_bit, ioptions.statistics));
+    // Data blocks only come here when they bypass the block cache, so they
+    // can leave out the columns the read does not need
+    result->reset(new Block(
+        std::move(contents), global_seqno, read_amp_bytes_per_bit,
+        ioptions.statistics,
+        options.value_columns.empty() ? nullptr : &options.value_columns));
   }
 
   return s;
@@ -207,6 +214,10 @@ bool PrefixExtractorChanged(const TablePropertiesBase* table_properties_base,
 
 }  // namespace
 
+void DeleteCachedBlockEntry(const Slice& key, void* value) {
+  DeleteCachedEntry<Block>(key, value);
+}
+
 // Index that allows binary search lookup in a two-level index structure.
 class PartitionIndexReader : public IndexReader, public Cleanable {
  public:
@@ -767,19 +778,35 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
                              const bool skip_filters, const int level,
                              const bool immortal_table,
                              const SequenceNumber largest_seqno,
-                             TailPrefetchStats* tail_prefetch_stats) {
+                             TailPrefetchStats* tail_prefetch_stats,
+                             size_t tail_size_hint) {
   table_reader->reset();
 
   Footer footer;
 
   std::unique_ptr<FilePrefetchBuffer> prefetch_buffer;
 
+  // pin both index and filters, down to all partitions
+  const bool pin_all =
+      (table_options.pin_l0_filter_and_index_blocks_in_cache && level == 0) ||
+      (level >= 0 &&
+       level <= table_options.pin_index_and_filter_partitions_max_level);
+  // pin the first level of partitioned index and filter
+  const int pin_top_level_max_level =
+      table_options.pin_top_level_index_and_filter_max_level;
+  const bool pin_top_level =
+      table_options.pin_top_level_index_and_filter &&
+      (level < 0 || pin_top_level_max_level < 0 ||
+       level <= pin_top_level_max_level);
   // prefetch both index and filters, down to all partitions
-  const bool prefetch_all = prefetch_index_and_filter_in_cache || level == 0;
+  const bool prefetch_all =
+      prefetch_index_and_filter_in_cache || level == 0 || pin_all;
   const bool preload_all = !table_options.cache_index_and_filter_blocks;
 
-  size_t tail_prefetch_size = 0;
-  if (tail_prefetch_stats != nullptr) {
+  // The caller knows the exact tail, e.g. a remote compaction worker told by
+  // the dispatcher which has the table open already
+  size_t tail_prefetch_size = tail_size_hint;
+  if (tail_prefetch_size == 0 && tail_prefetch_stats != nullptr) {
     // Multiple threads may get a 0 (no history) when running in parallel,
     // but it will get cleared after the first of them finishes.
     tail_prefetch_size = tail_prefetch_stats->GetSuggestedPrefetchSize();
@@ -985,6 +1012,10 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
   }
 
   rep->file_number = file_number;
+  if (rep->ioptions.hot_block_sample_interval > 0) {
+    rep->hot_block_sampler.reset(new HotBlockSampler(
+        rep->ioptions.hot_block_sample_interval, kMaxSampledHotBlocks));
+  }
 
   // Read the range del meta block
   bool found_range_del_block;
@@ -1023,24 +1054,22 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
   // prefetch the first level of index
   const bool prefetch_index =
       prefetch_all ||
-      (table_options.pin_top_level_index_and_filter &&
+      (pin_top_level &&
        index_type == BlockBasedTableOptions::kTwoLevelIndexSearch);
   // prefetch the first level of filter
   const bool prefetch_filter =
-      prefetch_all || (table_options.pin_top_level_index_and_filter &&
-                       rep->filter_type == Rep::FilterType::kPartitionedFilter);
+      prefetch_all ||
+      (pin_top_level &&
+       rep->filter_type == Rep::FilterType::kPartitionedFilter);
   // Partition fitlers cannot be enabled without partition indexes
   assert(!prefetch_filter || prefetch_index);
-  // pin both index and filters, down to all partitions
-  const bool pin_all =
-      rep->table_options.pin_l0_filter_and_index_blocks_in_cache && level == 0;
   // pin the first level of index
   const bool pin_index =
-      pin_all || (table_options.pin_top_level_index_and_filter &&
+      pin_all || (pin_top_level &&
                   index_type == BlockBasedTableOptions::kTwoLevelIndexSearch);
   // pin the first level of filter
   const bool pin_filter =
-      pin_all || (table_options.pin_top_level_index_and_filter &&
+      pin_all || (pin_top_level &&
                   rep->filter_type == Rep::FilterType::kPartitionedFilter);
   // pre-fetching of blocks is turned on
   // Will use block cache for index/filter blocks access
@@ -1103,7 +1132,7 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
       // The partitions of partitioned index are always stored in cache. They
       // are hence follow the configuration for pin and prefetch regardless of
       // the value of cache_index_and_filter_blocks
-      if (prefetch_index_and_filter_in_cache || level == 0) {
+      if (prefetch_all) {
         rep->index_reader->CacheDependencies(pin_all);
       }
 
@@ -1116,7 +1145,7 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
         rep->filter.reset(filter);
         // Refer to the comment above about paritioned indexes always being
         // cached
-        if (filter && (prefetch_index_and_filter_in_cache || level == 0)) {
+        if (filter && prefetch_all) {
           filter->CacheDependencies(pin_all, rep->table_prefix_extractor.get());
         }
       }
@@ -1262,37 +1291,61 @@ Status BlockBasedTable::GetDataBlockFromCache(
     }
   }
 
-  // If not found, search from the compressed block cache.
+  // If not found, search from the secondary cache of the block cache, then
+  // from the compressed block cache.
   assert(block->cache_handle == nullptr && block->value == nullptr);
 
-  if (block_cache_compressed == nullptr) {
-    return s;
+  BlockContents contents;
+  SecondaryCache* secondary_cache =
+      block_cache != nullptr ? block_cache->secondary_cache() : nullptr;
+  char* promoted = nullptr;
+  if (secondary_cache != nullptr) {
+    MemoryAllocator* allocator = GetMemoryAllocator(rep->table_options);
+    size_t size = 0;
+    promoted = secondary_cache->Promote(block_cache_key, allocator, &size);
+    if (promoted != nullptr) {
+      RecordTick(statistics, BLOCK_CACHE_SECONDARY_HIT);
+      contents = BlockContents(CacheAllocationPtr(promoted, allocator), size);
+    } else {
+      RecordTick(statistics, BLOCK_CACHE_SECONDARY_MISS);
+    }
   }
 
-  assert(!compressed_block_cache_key.empty());
-  block_cache_compressed_handle =
-      block_cache_compressed->Lookup(compressed_block_cache_key);
-  // if we found in the compressed cache, then uncompress and insert into
-  // uncompressed cache
-  if (block_cache_compressed_handle == nullptr) {
-    RecordTick(statistics, BLOCK_CACHE_COMPRESSED_MISS);
-    return s;
-  }
+  if (promoted == nullptr) {
+    if (block_cache_compressed == nullptr) {
+      return s;
+    }
 
-  // found compressed block
-  RecordTick(statistics, BLOCK_CACHE_COMPRESSED_HIT);
-  compressed_block = reinterpret_cast<BlockContents*>(
-      block_cache_compressed->Value(block_cache_compressed_handle));
-  CompressionType compression_type = compressed_block->get_compression_type();
-  assert(compression_type != kNoCompression);
+    assert(!compressed_block_cache_key.empty());
+    block_cache_compressed_handle =
+        block_cache_compressed->Lookup(compressed_block_cache_key);
+    // if we found in the compressed cache, then uncompress and insert into
+    // uncompressed cache
+    if (block_cache_compressed_handle == nullptr) {
+      RecordTick(statistics, BLOCK_CACHE_COMPRESSED_MISS);
+      return s;
+    }
 
-  // Retrieve the uncompressed contents into a new buffer
-  BlockContents contents;
-  UncompressionContext uncompresssion_ctx(compression_type, compression_dict);
-  s = UncompressBlockContents(uncompresssion_ctx, compressed_block->data.data(),
-                              compressed_block->data.size(), &contents,
-                              rep->table_options.format_version, rep->ioptions,
-                              GetMemoryAllocator(rep->table_options));
+    // found compressed block
+    RecordTick(statistics, BLOCK_CACHE_COMPRESSED_HIT);
+    compressed_block = reinterpret_cast<BlockContents*>(
+        block_cache_compressed->Value(block_cache_compressed_handle));
+    CompressionType compression_type =
+        compressed_block->get_compression_type();
+    assert(compression_type != kNoCompression);
+
+    // Retrieve the uncompressed contents into a new buffer
+    UncompressionContext uncompresssion_ctx(compression_type,
+                                            compression_dict);
+    s = UncompressBlockContents(
+        uncompresssion_ctx, compressed_block->data.data(),
+        compressed_block->data.size(), &contents,
+        rep->table_options.format_version, rep->ioptions,
+        GetMemoryAllocator(rep->table_options));
+
+    // Release hold on compressed cache entry
+    block_cache_compressed->Release(block_cache_compressed_handle);
+  }
 
   // Insert uncompressed block into block cache
   if (s.ok()) {
@@ -1304,7 +1357,7 @@ Status BlockBasedTable::GetDataBlockFromCache(
         read_options.fill_cache) {
       size_t charge = block->value->ApproximateMemoryUsage();
       s = block_cache->Insert(block_cache_key, block->value, charge,
-                              &DeleteCachedEntry<Block>,
+                              &DeleteCachedBlockEntry,
                               &(block->cache_handle));
 #ifndef NDEBUG
       block_cache->TEST_mark_as_data_block(block_cache_key, charge);
@@ -1343,9 +1396,6 @@ Status BlockBasedTable::GetDataBlockFromCache(
       }
     }
   }
-
-  // Release hold on compressed cache entry
-  block_cache_compressed->Release(block_cache_compressed_handle);
   return s;
 }
 
@@ -1417,7 +1467,7 @@ Status BlockBasedTable::PutDataBlockToCache(
   if (block_cache != nullptr && cached_block->value->own_bytes()) {
     size_t charge = cached_block->value->ApproximateMemoryUsage();
     s = block_cache->Insert(block_cache_key, cached_block->value, charge,
-                            &DeleteCachedEntry<Block>,
+                            &DeleteCachedBlockEntry,
                             &(cached_block->cache_handle), priority);
 #ifndef NDEBUG
     block_cache->TEST_mark_as_data_block(block_cache_key, charge);
@@ -2270,6 +2320,12 @@ void BlockBasedTableIteratorBase<TBlockIter, TValue>::InitDataBlock() {
       }
     }
 
+    if (!is_index_ && !for_compaction_) {
+      BlockBasedTable::MaybeSampleHotBlock(rep, read_options_,
+                                           data_block_handle,
+                                           index_iter_->key());
+    }
+
     Status s;
     BlockBasedTable::NewDataBlockIterator<TBlockIter>(
         rep, read_options_, data_block_handle, &block_iter_, is_index_,
@@ -2283,6 +2339,34 @@ void BlockBasedTableIteratorBase<TBlockIter, TValue>::InitDataBlock() {
   }
 }
 
+template <class TBlockIter, typename TValue>
+void BlockBasedTableIteratorBase<TBlockIter, TValue>::MaybePrefetchAsync() {
+  // Issue the next window once the scan is past half of the current one, so
+  // that a full window stays in flight while the blocks are consumed
+  const uint64_t window = read_options_.async_prefetch_size;
+  BlockHandle data_block_handle = index_iter_->value();
+  uint64_t block_end =
+      data_block_handle.offset() + data_block_handle.size() + kBlockTrailerSize;
+  if (block_end + window < async_prefetch_limit_) {
+    // Sought backward since the last window
+    async_prefetch_limit_ = 0;
+  }
+  if (block_end + window / 2 <= async_prefetch_limit_) {
+    return;
+  }
+  auto* rep = table_->get_rep();
+  uint64_t offset = std::max(block_end, async_prefetch_limit_);
+  uint64_t limit = offset + window;
+  if (rep->found_table_properties) {
+    limit = std::min(limit, rep->table_properties_base.data_size);
+  }
+  if (limit > offset) {
+    // Like Prefetch(), failures only make the reads synchronous
+    rep->file->PrefetchAsync(offset, static_cast<size_t>(limit - offset));
+  }
+  async_prefetch_limit_ = offset + window;
+}
+
 template <class TBlockIter, typename TValue>
 void BlockBasedTableIteratorBase<TBlockIter, TValue>::FindKeyForward() {
   assert(!is_out_of_bound_);
@@ -2302,6 +2386,10 @@ void BlockBasedTableIteratorBase<TBlockIter, TValue>::FindKeyForward() {
     if (index_iter_->Valid()) {
       InitDataBlock();
       block_iter_.SeekToFirst();
+      if (read_options_.async_prefetch_size > 0 && !for_compaction_ &&
+          !is_index_) {
+        MaybePrefetchAsync();
+      }
     } else {
       return;
     }
@@ -2422,20 +2510,85 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
                             GetContext* get_context,
                             const SliceTransform* prefix_extractor,
                             bool skip_filters) {
-  assert(key.size() >= 8);  // key must be internal key
-  Status s;
-  const bool no_io = read_options.read_tier == kBlockCacheTier;
   CachableEntry<FilterBlockReader> filter_entry;
   if (!skip_filters) {
     filter_entry =
         GetFilter(prefix_extractor, /*prefetch_buffer*/ nullptr,
                   read_options.read_tier == kBlockCacheTier, get_context);
   }
+  Status s = GetImpl(read_options, key, get_context, prefix_extractor,
+                     filter_entry.value, false /* full_filter_checked */);
+
+  // if rep_->filter_entry is not set, we should call Release(); otherwise
+  // don't call, in this case we have a local copy in rep_->filter_entry,
+  // it's pinned to the cache and will be released in the destructor
+  if (!rep_->filter_entry.IsSet()) {
+    filter_entry.Release(rep_->table_options.block_cache.get());
+  }
+  return s;
+}
+
+void BlockBasedTable::MultiGet(const ReadOptions& read_options, size_t num,
+                               const Slice* keys, GetContext** get_contexts,
+                               Status* statuses,
+                               const SliceTransform* prefix_extractor,
+                               bool skip_filters) {
+  CachableEntry<FilterBlockReader> filter_entry;
+  if (!skip_filters && num > 0) {
+    filter_entry =
+        GetFilter(prefix_extractor, /*prefetch_buffer*/ nullptr,
+                  read_options.read_tier == kBlockCacheTier, get_contexts[0]);
+  }
   FilterBlockReader* filter = filter_entry.value;
+  if (filter != nullptr && !filter->IsBlockBased() &&
+      filter->whole_key_filtering()) {
+    std::vector<Slice> user_keys(num);
+    for (size_t i = 0; i < num; ++i) {
+      assert(keys[i].size() >= 8);  // key must be internal key
+      user_keys[i] = ExtractUserKey(keys[i]);
+    }
+    std::unique_ptr<bool[]> may_match(new bool[num]);
+    filter->KeysMayMatch(num, user_keys.data(), may_match.get(),
+                         prefix_extractor,
+                         read_options.read_tier == kBlockCacheTier, keys);
+    for (size_t i = 0; i < num; ++i) {
+      if (!may_match[i]) {
+        RecordTick(rep_->ioptions.statistics, BLOOM_FILTER_USEFUL);
+        PERF_COUNTER_BY_LEVEL_ADD(bloom_filter_useful, 1, rep_->level);
+        statuses[i] = Status::OK();
+        continue;
+      }
+      RecordTick(rep_->ioptions.statistics, BLOOM_FILTER_FULL_POSITIVE);
+      PERF_COUNTER_BY_LEVEL_ADD(bloom_filter_full_positive, 1, rep_->level);
+      statuses[i] = GetImpl(read_options, keys[i], get_contexts[i],
+                            prefix_extractor, filter,
+                            true /* full_filter_checked */);
+    }
+  } else {
+    for (size_t i = 0; i < num; ++i) {
+      statuses[i] = GetImpl(read_options, keys[i], get_contexts[i],
+                            prefix_extractor, filter,
+                            false /* full_filter_checked */);
+    }
+  }
+  if (!rep_->filter_entry.IsSet()) {
+    filter_entry.Release(rep_->table_options.block_cache.get());
+  }
+}
+
+Status BlockBasedTable::GetImpl(const ReadOptions& read_options,
+                                const Slice& key, GetContext* get_context,
+                                const SliceTransform* prefix_extractor,
+                                FilterBlockReader* filter,
+                                bool full_filter_checked) {
+  assert(key.size() >= 8);  // key must be internal key
+  Status s;
+  const bool no_io = read_options.read_tier == kBlockCacheTier;
 
   // First check the full filter
   // If full filter not useful, Then go into each block
-  if (!FullFilterKeyMayMatch(read_options, filter, key, no_io,
+  if (!full_filter_checked &&
+      !FullFilterKeyMayMatch(read_options, filter, key, no_io,
                              prefix_extractor)) {
     RecordTick(rep_->ioptions.statistics, BLOOM_FILTER_USEFUL);
     PERF_COUNTER_BY_LEVEL_ADD(bloom_filter_useful, 1, rep_->level);
@@ -2476,6 +2629,7 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
         PERF_COUNTER_BY_LEVEL_ADD(bloom_filter_useful, 1, rep_->level);
         break;
       } else {
+        MaybeSampleHotBlock(rep_, read_options, handle, iiter->key());
         DataBlockIter biter;
         NewDataBlockIterator<DataBlockIter>(
             rep_, read_options, iiter->value(), &biter, false,
@@ -2564,13 +2718,6 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
       s = iiter->status();
     }
   }
-
-  // if rep_->filter_entry is not set, we should call Release(); otherwise
-  // don't call, in this case we have a local copy in rep_->filter_entry,
-  // it's pinned to the cache and will be released in the destructor
-  if (!rep_->filter_entry.IsSet()) {
-    filter_entry.Release(rep_->table_options.block_cache.get());
-  }
   // if (get_context->State() == GetContext::kNotFound) {
   //   ZnsLog(kYellow, "seems a missing key");
   // }
@@ -2635,6 +2782,114 @@ Status BlockBasedTable::Prefetch(const Slice* const begin,
   return Status::OK();
 }
 
+void BlockBasedTable::PrefetchAsync(size_t n) {
+  // Data blocks start at the beginning of the file
+  if (rep_->found_table_properties) {
+    n = static_cast<size_t>(
+        std::min<uint64_t>(n, rep_->table_properties_base.data_size));
+  }
+  if (n > 0) {
+    rep_->file->PrefetchAsync(0, n);
+  }
+}
+
+void BlockBasedTable::MaybeSampleHotBlock(Rep* rep, const ReadOptions& ro,
+                                          const BlockHandle& handle,
+                                          const Slice& index_key) {
+  // Reads which don't fill the block cache would not profit from warming it
+  if (rep->hot_block_sampler != nullptr && ro.fill_cache &&
+      rep->hot_block_sampler->ShouldSample()) {
+    rep->hot_block_sampler->Sample(handle.offset(), index_key);
+  }
+}
+
+void BlockBasedTable::GetHotBlockKeys(size_t limit,
+                                      std::vector<std::string>* keys) const {
+  if (rep_->hot_block_sampler == nullptr) {
+    return;
+  }
+  const size_t first = keys->size();
+  rep_->hot_block_sampler->GetHottest(limit, keys);
+  const bool is_user_key =
+      rep_->found_table_properties &&
+      rep_->table_properties_base.index_key_is_user_key > 0;
+  if (is_user_key) {
+    // Seeking the smallest internal key of the user key finds the same block
+    // in any index
+    for (size_t i = first; i < keys->size(); ++i) {
+      InternalKey ikey((*keys)[i], kMaxSequenceNumber, kValueTypeForSeek);
+      (*keys)[i] = ikey.Encode().ToString();
+    }
+  }
+}
+
+Status BlockBasedTable::WarmUpBlocks(const std::vector<std::string>& keys) {
+  IndexBlockIter iiter_on_stack;
+  auto iiter = NewIndexIterator(ReadOptions(), false, &iiter_on_stack);
+  std::unique_ptr<InternalIteratorBase<BlockHandle>> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr =
+        std::unique_ptr<InternalIteratorBase<BlockHandle>>(iiter);
+  }
+  if (!iiter->status().ok()) {
+    return iiter->status();
+  }
+
+  for (auto& key : keys) {
+    iiter->Seek(key);
+    if (!iiter->Valid()) {
+      if (!iiter->status().ok()) {
+        return iiter->status();
+      }
+      continue;
+    }
+    // Load the block into the block cache, like Prefetch() the read is not
+    // sampled itself
+    DataBlockIter biter;
+    NewDataBlockIterator<DataBlockIter>(rep_, ReadOptions(), iiter->value(),
+                                        &biter);
+    if (!biter.status().ok()) {
+      return biter.status();
+    }
+  }
+  return Status::OK();
+}
+
+void BlockBasedTable::GetSampleKeys(size_t limit,
+                                    std::vector<std::string>* keys) {
+  if (limit == 0 || !rep_->found_table_properties) {
+    return;
+  }
+  const uint64_t num_blocks = rep_->table_properties_base.num_data_blocks;
+  if (num_blocks <= 1) {
+    return;
+  }
+  const uint64_t stride = std::max<uint64_t>(1, num_blocks / (limit + 1));
+  IndexBlockIter iiter_on_stack;
+  auto iiter = NewIndexIterator(ReadOptions(), false, &iiter_on_stack);
+  std::unique_ptr<InternalIteratorBase<BlockHandle>> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr =
+        std::unique_ptr<InternalIteratorBase<BlockHandle>>(iiter);
+  }
+  const bool is_user_key =
+      rep_->table_properties_base.index_key_is_user_key > 0;
+  size_t added = 0;
+  uint64_t i = 0;
+  for (iiter->SeekToFirst(); iiter->Valid() && added < limit; iiter->Next()) {
+    if (++i % stride != 0 || i == num_blocks) {
+      continue;
+    }
+    if (is_user_key) {
+      InternalKey ikey(iiter->key(), kMaxSequenceNumber, kValueTypeForSeek);
+      keys->emplace_back(ikey.Encode().ToString());
+    } else {
+      keys->emplace_back(iiter->key().ToString());
+    }
+    ++added;
+  }
+}
+
 Status BlockBasedTable::VerifyChecksum() {
   Status s;
   // Check Meta blocks
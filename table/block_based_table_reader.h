@@ -29,6 +29,7 @@
 #include "table/block_based_table_factory.h"
 #include "table/filter_block.h"
 #include "table/format.h"
+#include "table/hot_block_sampler.h"
 #include "table/internal_iterator.h"
 #include "table/persistent_cache_helper.h"
 #include "table/table_properties_internal.h"
@@ -60,6 +61,10 @@ using std::unique_ptr;
 
 typedef std::vector<std::pair<std::string, std::string>> KVPairBlock;
 
+// The deleter of the data and index blocks a BlockBasedTable puts into the
+// block cache, which tells them apart from the other entries.
+extern void DeleteCachedBlockEntry(const Slice& key, void* value);
+
 // A Table is a sorted map from strings to strings.  Tables are
 // immutable and persistent.  A Table may be safely accessed from
 // multiple threads without external synchronization.
@@ -100,7 +105,8 @@ class BlockBasedTable : public TableReader {
                      bool skip_filters = false, int level = -1,
                      const bool immortal_table = false,
                      const SequenceNumber largest_seqno = 0,
-                     TailPrefetchStats* tail_prefetch_stats = nullptr);
+                     TailPrefetchStats* tail_prefetch_stats = nullptr,
+                     size_t tail_size_hint = 0);
 
   bool PrefixMayMatch(const Slice& internal_key,
                       const ReadOptions& read_options,
@@ -125,11 +131,29 @@ class BlockBasedTable : public TableReader {
              GetContext* get_context, const SliceTransform* prefix_extractor,
              bool skip_filters = false) override;
 
+  // Probes the full filter with the whole batch before looking up the keys
+  // which may match
+  void MultiGet(const ReadOptions& readOptions, size_t num, const Slice* keys,
+                GetContext** get_contexts, Status* statuses,
+                const SliceTransform* prefix_extractor,
+                bool skip_filters = false) override;
+
   // Pre-fetch the disk blocks that correspond to the key range specified by
   // (kbegin, kend). The call will return error status in the event of
   // IO or iteration error.
   Status Prefetch(const Slice* begin, const Slice* end) override;
 
+  void PrefetchAsync(size_t n) override;
+
+  void GetHotBlockKeys(size_t limit,
+                       std::vector<std::string>* keys) const override;
+
+  Status WarmUpBlocks(const std::vector<std::string>& keys) override;
+
+  // Every n-th key of the index, so the samples are about the same number of
+  // data blocks apart
+  void GetSampleKeys(size_t limit, std::vector<std::string>* keys) override;
+
   // Given a key, return an approximate byte offset in the file where
   // the data for that key begins (or would begin if the key were
   // present in the file).  The returned value is in terms of file
@@ -225,6 +249,12 @@ class BlockBasedTable : public TableReader {
 
   Rep* get_rep() { return rep_; }
 
+  // Count a foreground read of the data block `handle` located by
+  // `index_key` into the hot block sampler of the table, if it has one
+  static void MaybeSampleHotBlock(Rep* rep, const ReadOptions& ro,
+                                  const BlockHandle& handle,
+                                  const Slice& index_key);
+
   // input_iter: if it is not null, update this one and return it as Iterator
   template <typename TBlockIter>
   static TBlockIter* NewDataBlockIterator(
@@ -296,8 +326,8 @@ class BlockBasedTable : public TableReader {
       CachableEntry<IndexReader>* index_entry = nullptr,
       GetContext* get_context = nullptr);
 
-  // Read block cache from block caches (if set): block_cache and
-  // block_cache_compressed.
+  // Read block cache from block caches (if set): block_cache, its secondary
+  // cache and block_cache_compressed.
   // On success, Status::OK with be returned and @block will be populated with
   // pointer to the block as well as its block handle.
   // @param compression_dict Data for presetting the compression library's
@@ -357,6 +387,13 @@ class BlockBasedTable : public TableReader {
       const Slice& user_key, const bool no_io,
       const SliceTransform* prefix_extractor = nullptr) const;
 
+  // Get() with the filter already fetched, full_filter_checked tells that
+  // the full filter says the key may match
+  Status GetImpl(const ReadOptions& read_options, const Slice& key,
+                 GetContext* get_context,
+                 const SliceTransform* prefix_extractor,
+                 FilterBlockReader* filter, bool full_filter_checked);
+
   // Read the meta block from sst.
   static Status ReadMetaBlock(
       Rep* rep, FilePrefetchBuffer* prefetch_buffer,
@@ -511,8 +548,9 @@ struct BlockBasedTable::Rep {
   std::shared_ptr<const SliceTransform> table_prefix_extractor;
 
   // only used in level 0 files when pin_l0_filter_and_index_blocks_in_cache is
-  // true or in all levels when pin_top_level_index_and_filter is set in
-  // combination with partitioned index/filters: then we do use the LRU cache,
+  // true, in levels up to pin_index_and_filter_partitions_max_level, or in the
+  // levels pin_top_level_index_and_filter applies to in combination with
+  // partitioned index/filters: then we do use the LRU cache,
   // but we always keep the filter & index block's handle checked out here (=we
   // don't call Release()), plus the parsed out objects the LRU cache will never
   // push flush them out, hence they're pinned
@@ -539,6 +577,10 @@ struct BlockBasedTable::Rep {
   bool closed = false;
   const bool immortal_table;
 
+  // Samples the foreground data block reads, nullptr unless
+  // ImmutableCFOptions::hot_block_sample_interval is set
+  std::unique_ptr<HotBlockSampler> hot_block_sampler;
+
   SequenceNumber get_global_seqno(bool is_index) const {
     return is_index ? kDisableGlobalSequenceNumber : global_seqno;
   }
@@ -630,6 +672,7 @@ class BlockBasedTableIteratorBase : public InternalIteratorBase<TValue> {
   }
 
   void InitDataBlock();
+  void MaybePrefetchAsync();
   void FindKeyForward();
   void FindKeyBackward();
 
@@ -662,6 +705,8 @@ class BlockBasedTableIteratorBase : public InternalIteratorBase<TValue> {
   size_t readahead_limit_ = 0;
   int num_file_reads_ = 0;
   std::unique_ptr<FilePrefetchBuffer> prefetch_buffer_;
+  // End of the data issued by ReadOptions::async_prefetch_size so far
+  uint64_t async_prefetch_limit_ = 0;
 };
 
 template <class TBlockIter, typename TValue = Slice>
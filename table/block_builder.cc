@@ -55,9 +55,12 @@ BlockBuilder::BlockBuilder(
       use_value_delta_encoding_(use_value_delta_encoding),
       restarts_(),
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      use_key_prefixes_(index_type ==
+                        BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix) {
   switch (index_type) {
     case BlockBasedTableOptions::kDataBlockBinarySearch:
+    case BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix:
       break;
     case BlockBasedTableOptions::kDataBlockBinaryAndHash:
       data_block_hash_index_builder_.Initialize(
@@ -79,6 +82,7 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  key_prefixes_.clear();
   if (data_block_hash_index_builder_.Valid()) {
     data_block_hash_index_builder_.Reset();
   }
@@ -100,6 +104,9 @@ size_t BlockBuilder::EstimateSizeAfterKV(const Slice& key,
   if (counter_ >= block_restart_interval_) {
     estimate += sizeof(uint32_t);  // a new restart entry.
   }
+  if (use_key_prefixes_ && (counter_ >= block_restart_interval_ || empty())) {
+    estimate += kDataBlockKeyPrefixSize;  // key prefix of the restart.
+  }
 
   estimate += sizeof(int32_t);  // varint for shared prefix length.
   // Note: this is an imprecise estimate as we will have to encoded size, one
@@ -125,6 +132,14 @@ Slice BlockBuilder::Finish() {
       CurrentSizeEstimate() <= kMaxBlockSizeSupportedByHashIndex) {
     data_block_hash_index_builder_.Finish(buffer_);
     index_type = BlockBasedTableOptions::kDataBlockBinaryAndHash;
+  } else if (use_key_prefixes_ &&
+             CurrentSizeEstimate() <= kMaxBlockSizeSupportedByHashIndex) {
+    // The footer flag is not honored in larger blocks, see Block::IndexType()
+    assert(key_prefixes_.size() == restarts_.size());
+    for (int64_t prefix : key_prefixes_) {
+      PutFixed64(&buffer_, static_cast<uint64_t>(prefix));
+    }
+    index_type = BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix;
   }
 
   // footer is a packed format of data_block_index_type and num_restarts
@@ -191,6 +206,9 @@ void BlockBuilder::Add(const Slice& key, const Slice& value,
     data_block_hash_index_builder_.Add(ExtractUserKey(key),
                                        restarts_.size() - 1);
   }
+  if (use_key_prefixes_ && counter_ == 0) {
+    key_prefixes_.push_back(EncodeDataBlockKeyPrefix(ExtractUserKey(key)));
+  }
 
   counter_++;
   estimate_ += buffer_.size() - curr_size;
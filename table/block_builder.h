@@ -16,6 +16,7 @@
 #include "rocksdb/table.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/data_block_hash_index.h"
+#include "table/data_block_key_prefix.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -47,9 +48,10 @@ class BlockBuilder {
   // Returns an estimate of the current (uncompressed) size of the block
   // we are building.
   inline size_t CurrentSizeEstimate() const {
-    return estimate_ + (data_block_hash_index_builder_.Valid()
-                            ? data_block_hash_index_builder_.EstimateSize()
-                            : 0);
+    return estimate_ + key_prefixes_.size() * kDataBlockKeyPrefixSize +
+           (data_block_hash_index_builder_.Valid()
+                ? data_block_hash_index_builder_.EstimateSize()
+                : 0);
   }
 
   // Returns an estimated block size after appending key and value.
@@ -71,6 +73,10 @@ class BlockBuilder {
   int counter_;    // Number of entries emitted since restart
   bool finished_;  // Has Finish() been called?
   std::string last_key_;
+  // Encoded user key prefixes of the restart points, only with
+  // kDataBlockBinaryAndKeyPrefix
+  const bool use_key_prefixes_;
+  std::vector<int64_t> key_prefixes_;
   DataBlockHashIndexBuilder data_block_hash_index_builder_;
 };
 
@@ -29,6 +29,7 @@
 #include "util/memory_allocator.h"
 #include "util/stop_watch.h"
 #include "util/string_util.h"
+#include "util/xxh3.h"
 #include "util/xxhash.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -55,6 +56,9 @@ inline void BlockFetcher::CheckBlockChecksum() {
             XXH64(data, static_cast<int>(block_size_) + 1, 0) &
             uint64_t{0xffffffff});
         break;
+      case kXXH3:
+        actual = XXH3ChecksumWithLastByte(data, block_size_, data[block_size_]);
+        break;
       default:
         status_ = Status::Corruption(
             "unknown checksum type " + ToString(footer_.checksum()) + " in " +
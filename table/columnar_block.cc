@@ -0,0 +1,509 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/columnar_block.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "db/dbformat.h"
+#include "rocksdb/terark_namespace.h"
+#include "table/block_builder.h"
+#include "util/coding.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+// Column types in the layout
+enum : char {
+  kFixedLength = 0,
+  kLongFixedLength = 1,
+  kVariableLength = 2,
+};
+
+// The same as the default BlockBasedTableOptions::block_restart_interval
+const int kDecodedBlockRestartInterval = 16;
+
+char ColumnType(const ColDeclaration& declaration) {
+  if (declaration.col_type == "FixedLength") {
+    return kFixedLength;
+  } else if (declaration.col_type == "LongFixedLength") {
+    return kLongFixedLength;
+  }
+  assert(declaration.col_type == "VariableLength");
+  return kVariableLength;
+}
+
+uint64_t LoadValue(const char* p, size_t size, bool big_endian) {
+  uint64_t v = 0;
+  for (size_t i = 0; i < size; ++i) {
+    v = (v << 8) |
+        static_cast<unsigned char>(p[big_endian ? i : size - 1 - i]);
+  }
+  return v;
+}
+
+void StoreValue(uint64_t v, size_t size, bool big_endian, char* p) {
+  for (size_t i = 0; i < size; ++i) {
+    p[big_endian ? size - 1 - i : i] = static_cast<char>(v >> (8 * i));
+  }
+}
+
+uint64_t ZigZag(uint64_t delta) {
+  return (delta << 1) ^
+         static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+}
+
+uint64_t UnZigZag(uint64_t v) { return (v >> 1) ^ (~(v & 1) + 1); }
+
+bool IsRunLength(ColCompressionType type) {
+  return type == kColRle || type == kColRleVarint ||
+         type == kColRleDeltaVarint || type == kColRleDict;
+}
+
+bool IsDictionary(ColCompressionType type) {
+  return type == kColDict || type == kColRleDict;
+}
+
+}  // namespace
+
+bool IsColumnarBlock(const Slice& contents) {
+  return contents.size() >= 2 * sizeof(uint32_t) &&
+         (DecodeFixed32(contents.data() + contents.size() - sizeof(uint32_t)) &
+          kColumnarBlockFlags) == kColumnarBlockFlags;
+}
+
+Status ValidateColDeclarations(const std::vector<ColDeclaration>& columns) {
+  for (auto& column : columns) {
+    if (column.nullable) {
+      return Status::NotSupported(
+          "nullable columns are not supported in columnar blocks");
+    }
+    if (static_cast<unsigned>(column.col_compression_type) > kColRleDict) {
+      return Status::InvalidArgument("unknown column compression type");
+    }
+    if (column.col_type == "FixedLength") {
+      if (column.size == 0 || column.size > sizeof(uint64_t)) {
+        return Status::InvalidArgument(
+            "FixedLength columns must be 1 to 8 bytes");
+      }
+    } else if (column.col_type == "LongFixedLength" ||
+               column.col_type == "VariableLength") {
+      if (column.col_compression_type != kColNoCompression) {
+        return Status::NotSupported(
+            column.col_type + " columns only support kColNoCompression");
+      }
+      if (column.col_type == "LongFixedLength" &&
+          (column.size == 0 || column.size > UINT32_MAX)) {
+        return Status::InvalidArgument(
+            "LongFixedLength columns must be 1 to 2^32-1 bytes");
+      }
+    } else {
+      return Status::NotSupported("column type " + column.col_type +
+                                  " is not supported in columnar blocks");
+    }
+  }
+  return Status::OK();
+}
+
+void ColumnarBlockBuilder::Column::Reset() {
+  data.clear();
+  last_value = 0;
+  run_value = 0;
+  run_length = 0;
+  dictionary.clear();
+  dictionary_values.clear();
+}
+
+void ColumnarBlockBuilder::Column::Append(const char* p) {
+  const size_t size = declaration.size;
+  const ColCompressionType type = declaration.col_compression_type;
+  switch (ColumnType(declaration)) {
+    case kLongFixedLength:
+      data.append(p, size);
+      return;
+    case kVariableLength:
+      data.append(p, 1 + static_cast<unsigned char>(*p));
+      return;
+  }
+  if (type == kColNoCompression) {
+    data.append(p, size);
+    return;
+  }
+  uint64_t v = LoadValue(p, size, declaration.big_endian);
+  if (type == kColDeltaVarint || type == kColRleDeltaVarint) {
+    uint64_t delta = ZigZag(v - last_value);
+    last_value = v;
+    v = delta;
+  } else if (IsDictionary(type)) {
+    auto ib = dictionary.emplace(v, dictionary_values.size());
+    if (ib.second) {
+      dictionary_values.push_back(v);
+    }
+    v = ib.first->second;
+  }
+  if (IsRunLength(type)) {
+    AppendRun(v);
+  } else {
+    PutVarint64(&data, v);
+  }
+}
+
+void ColumnarBlockBuilder::Column::AppendRun(uint64_t v) {
+  if (run_length > 0 && v == run_value) {
+    ++run_length;
+    return;
+  }
+  FinishRun();
+  run_value = v;
+  run_length = 1;
+}
+
+void ColumnarBlockBuilder::Column::FinishRun() {
+  if (run_length == 0) {
+    return;
+  }
+  if (declaration.col_compression_type == kColRle) {
+    char buf[sizeof(uint64_t)];
+    StoreValue(run_value, declaration.size, declaration.big_endian, buf);
+    data.append(buf, declaration.size);
+  } else {
+    PutVarint64(&data, run_value);
+  }
+  PutVarint64(&data, run_length);
+  run_length = 0;
+}
+
+void ColumnarBlockBuilder::Column::Finish() {
+  FinishRun();
+  if (IsDictionary(declaration.col_compression_type)) {
+    std::string header;
+    PutVarint64(&header, dictionary_values.size());
+    for (auto v : dictionary_values) {
+      PutVarint64(&header, v);
+    }
+    data.insert(0, header);
+  }
+}
+
+ColumnarBlockBuilder::ColumnarBlockBuilder(
+    const std::vector<ColDeclaration>& columns)
+    : num_entries_(0), num_columnar_(0) {
+  assert(ValidateColDeclarations(columns).ok());
+  columns_.reserve(columns.size());
+  for (auto& column : columns) {
+    columns_.emplace_back(column);
+  }
+}
+
+void ColumnarBlockBuilder::Reset() {
+  for (auto& column : columns_) {
+    column.Reset();
+  }
+  keys_.clear();
+  raw_.clear();
+  last_key_.clear();
+  buffer_.clear();
+  num_entries_ = 0;
+  num_columnar_ = 0;
+}
+
+bool ColumnarBlockBuilder::InColumns(const Slice& key,
+                                     const Slice& value) const {
+  if (key.size() < 8 || ExtractValueType(key) != kTypeValue) {
+    return false;
+  }
+  size_t pos = 0;
+  for (auto& column : columns_) {
+    if (ColumnType(column.declaration) == kVariableLength) {
+      if (pos >= value.size()) {
+        return false;
+      }
+      pos += 1 + static_cast<unsigned char>(value[pos]);
+    } else {
+      pos += column.declaration.size;
+    }
+    if (pos > value.size()) {
+      return false;
+    }
+  }
+  return pos == value.size();
+}
+
+void ColumnarBlockBuilder::Add(const Slice& key, const Slice& value) {
+  size_t shared = 0;
+  const size_t min_length = std::min(last_key_.size(), key.size());
+  while (shared < min_length && last_key_[shared] == key[shared]) {
+    ++shared;
+  }
+  const size_t non_shared = key.size() - shared;
+  PutVarint32Varint32(&keys_, static_cast<uint32_t>(shared),
+                      static_cast<uint32_t>(non_shared));
+  keys_.append(key.data() + shared, non_shared);
+  last_key_.assign(key.data(), key.size());
+
+  if (InColumns(key, value)) {
+    PutVarint32(&raw_, 0);
+    const char* p = value.data();
+    for (auto& column : columns_) {
+      size_t size = ColumnType(column.declaration) == kVariableLength
+                        ? 1 + static_cast<unsigned char>(*p)
+                        : column.declaration.size;
+      column.Append(p);
+      p += size;
+    }
+    ++num_columnar_;
+  } else {
+    PutVarint32(&raw_, static_cast<uint32_t>(value.size() + 1));
+    raw_.append(value.data(), value.size());
+  }
+  ++num_entries_;
+}
+
+Slice ColumnarBlockBuilder::Finish() {
+  buffer_.clear();
+  buffer_.append(keys_);
+  buffer_.append(raw_);
+  for (auto& column : columns_) {
+    column.Finish();
+    buffer_.append(column.data);
+  }
+  const uint32_t layout_offset = static_cast<uint32_t>(buffer_.size());
+  PutVarint32Varint32Varint32(&buffer_, static_cast<uint32_t>(columns_.size()),
+                              static_cast<uint32_t>(keys_.size()),
+                              static_cast<uint32_t>(raw_.size()));
+  for (auto& column : columns_) {
+    buffer_.push_back(ColumnType(column.declaration));
+    buffer_.push_back(
+        static_cast<char>(column.declaration.col_compression_type));
+    buffer_.push_back(column.declaration.big_endian ? 1 : 0);
+    PutVarint32Varint32(&buffer_,
+                        static_cast<uint32_t>(column.declaration.size),
+                        static_cast<uint32_t>(column.data.size()));
+  }
+  PutFixed32(&buffer_, layout_offset);
+  assert(num_entries_ < (1u << 30));
+  PutFixed32(&buffer_, num_entries_ | kColumnarBlockFlags);
+  return buffer_;
+}
+
+namespace {
+
+class ColumnReader {
+ public:
+  // A column not `projected` reads back as zero bytes
+  Status Init(char type, ColCompressionType encoding, bool big_endian,
+              uint32_t size, const Slice& data, bool projected) {
+    type_ = type;
+    encoding_ = encoding;
+    big_endian_ = big_endian;
+    size_ = size;
+    input_ = data;
+    projected_ = projected;
+    switch (type) {
+      case kFixedLength:
+        if (size == 0 || size > sizeof(uint64_t) ||
+            static_cast<unsigned>(encoding) > kColRleDict) {
+          return Status::Corruption("bad columnar block fixed length column");
+        }
+        break;
+      case kLongFixedLength:
+      case kVariableLength:
+        if (encoding != kColNoCompression) {
+          return Status::Corruption("bad columnar block column encoding");
+        }
+        break;
+      default:
+        return Status::Corruption("bad columnar block column type");
+    }
+    if (projected && type == kFixedLength && IsDictionary(encoding)) {
+      uint64_t count = 0;
+      if (!GetVarint64(&input_, &count) || count > input_.size()) {
+        return Status::Corruption("bad columnar block dictionary");
+      }
+      dictionary_.resize(static_cast<size_t>(count));
+      for (auto& v : dictionary_) {
+        if (!GetVarint64(&input_, &v)) {
+          return Status::Corruption("bad columnar block dictionary");
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  // Append the column of the next value to `dst`, return false on corruption
+  bool Next(std::string* dst) {
+    if (!projected_) {
+      dst->append(type_ == kVariableLength ? 1 : size_, '\0');
+      return true;
+    }
+    if (type_ == kVariableLength) {
+      if (input_.empty()) {
+        return false;
+      }
+      size_t size = 1 + static_cast<unsigned char>(input_[0]);
+      if (input_.size() < size) {
+        return false;
+      }
+      dst->append(input_.data(), size);
+      input_.remove_prefix(size);
+      return true;
+    }
+    if (type_ == kLongFixedLength || encoding_ == kColNoCompression) {
+      if (input_.size() < size_) {
+        return false;
+      }
+      dst->append(input_.data(), size_);
+      input_.remove_prefix(size_);
+      return true;
+    }
+    uint64_t v = 0;
+    if (IsRunLength(encoding_)) {
+      if (remaining_run_ == 0) {
+        if (encoding_ == kColRle) {
+          if (input_.size() < size_) {
+            return false;
+          }
+          run_value_ = LoadValue(input_.data(), size_, big_endian_);
+          input_.remove_prefix(size_);
+        } else if (!GetVarint64(&input_, &run_value_)) {
+          return false;
+        }
+        if (!GetVarint64(&input_, &remaining_run_) || remaining_run_ == 0) {
+          return false;
+        }
+      }
+      --remaining_run_;
+      v = run_value_;
+    } else if (!GetVarint64(&input_, &v)) {
+      return false;
+    }
+    if (encoding_ == kColDeltaVarint || encoding_ == kColRleDeltaVarint) {
+      v = last_value_ + UnZigZag(v);
+      last_value_ = v;
+    } else if (IsDictionary(encoding_)) {
+      if (v >= dictionary_.size()) {
+        return false;
+      }
+      v = dictionary_[static_cast<size_t>(v)];
+    }
+    char buf[sizeof(uint64_t)];
+    StoreValue(v, size_, big_endian_, buf);
+    dst->append(buf, size_);
+    return true;
+  }
+
+ private:
+  char type_ = kFixedLength;
+  ColCompressionType encoding_ = kColNoCompression;
+  bool big_endian_ = false;
+  bool projected_ = true;
+  uint32_t size_ = 0;
+  Slice input_;
+  uint64_t last_value_ = 0;
+  uint64_t run_value_ = 0;
+  uint64_t remaining_run_ = 0;
+  std::vector<uint64_t> dictionary_;
+};
+
+}  // namespace
+
+Status DecodeColumnarBlock(const Slice& contents,
+                           const std::vector<uint32_t>* value_columns,
+                           std::string* row_block) {
+  if (!IsColumnarBlock(contents)) {
+    return Status::Corruption("not a columnar block");
+  }
+  const char* base = contents.data();
+  const size_t tail_offset = contents.size() - 2 * sizeof(uint32_t);
+  const uint32_t num_entries =
+      DecodeFixed32(base + tail_offset + sizeof(uint32_t)) &
+      ~kColumnarBlockFlags;
+  const uint32_t layout_offset = DecodeFixed32(base + tail_offset);
+  if (layout_offset > tail_offset) {
+    return Status::Corruption("bad columnar block layout offset");
+  }
+  Slice layout(base + layout_offset, tail_offset - layout_offset);
+  uint32_t num_columns = 0;
+  uint32_t keys_size = 0;
+  uint32_t raw_size = 0;
+  if (!GetVarint32(&layout, &num_columns) ||
+      !GetVarint32(&layout, &keys_size) || !GetVarint32(&layout, &raw_size) ||
+      uint64_t(keys_size) + raw_size > layout_offset ||
+      num_columns > layout.size()) {
+    return Status::Corruption("bad columnar block layout");
+  }
+  Slice keys(base, keys_size);
+  Slice raw(base + keys_size, raw_size);
+  uint64_t offset = uint64_t(keys_size) + raw_size;
+  std::vector<ColumnReader> readers(num_columns);
+  for (uint32_t i = 0; i < num_columns; ++i) {
+    uint32_t size = 0;
+    uint32_t data_size = 0;
+    if (layout.size() < 3) {
+      return Status::Corruption("bad columnar block layout");
+    }
+    char type = layout[0];
+    auto encoding =
+        static_cast<ColCompressionType>(static_cast<unsigned char>(layout[1]));
+    bool big_endian = layout[2] != 0;
+    layout.remove_prefix(3);
+    if (!GetVarint32(&layout, &size) || !GetVarint32(&layout, &data_size) ||
+        offset + data_size > layout_offset) {
+      return Status::Corruption("bad columnar block layout");
+    }
+    bool projected =
+        value_columns == nullptr ||
+        std::find(value_columns->begin(), value_columns->end(), i) !=
+            value_columns->end();
+    Status s = readers[i].Init(type, encoding, big_endian, size,
+                               Slice(base + offset, data_size), projected);
+    if (!s.ok()) {
+      return s;
+    }
+    offset += data_size;
+  }
+  if (offset != layout_offset || !layout.empty()) {
+    return Status::Corruption("bad columnar block layout");
+  }
+
+  BlockBuilder builder(kDecodedBlockRestartInterval);
+  std::string key;
+  std::string value;
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    uint32_t shared = 0;
+    uint32_t non_shared = 0;
+    uint32_t raw_flag = 0;
+    if (!GetVarint32(&keys, &shared) || !GetVarint32(&keys, &non_shared) ||
+        shared > key.size() || non_shared > keys.size() ||
+        !GetVarint32(&raw, &raw_flag) || raw_flag > raw.size() + 1) {
+      return Status::Corruption("bad columnar block entry");
+    }
+    key.resize(shared);
+    key.append(keys.data(), non_shared);
+    keys.remove_prefix(non_shared);
+    value.clear();
+    if (raw_flag > 0) {
+      value.assign(raw.data(), raw_flag - 1);
+      raw.remove_prefix(raw_flag - 1);
+    } else {
+      for (auto& reader : readers) {
+        if (!reader.Next(&value)) {
+          return Status::Corruption("bad columnar block column");
+        }
+      }
+    }
+    builder.Add(key, value);
+  }
+  if (!keys.empty() || !raw.empty()) {
+    return Status::Corruption("bad columnar block entries");
+  }
+  *row_block = builder.Finish().ToString();
+  return Status::OK();
+}
+
+}  // namespace TERARKDB_NAMESPACE
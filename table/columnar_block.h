@@ -0,0 +1,113 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocksdb/col_declaration.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+// The data blocks of tables with BlockBasedTableOptions::
+// value_col_declarations. The block data format is:
+//
+// COLUMNAR_BLOCK: [KEYS RAW COL COL ... COL LAYOUT LAYOUT_OFFSET FOOTER]
+//
+// KEYS:          Per entry varint32 shared, varint32 non_shared and the
+//                non_shared bytes of the internal key, delta encoded to the
+//                key of the previous entry
+// RAW:           Per entry varint32 0 if the value is in the columns, or its
+//                size + 1 followed by the value if it is stored as is
+// COL:           The encoded column of the values stored in the columns
+// LAYOUT:        varint32 number of columns, varint32 sizes of KEYS and RAW,
+//                then per column its type, encoding and big endian bytes,
+//                varint32 declared size and varint32 size of its COL
+// LAYOUT_OFFSET: fixed32
+// FOOTER:        fixed32 number of entries with both bit 31 and bit 30 set,
+//                which no row format footer has, see data_block_footer.cc
+//
+// Block decodes them to the default row format when it is constructed, see
+// DecodeColumnarBlock().
+
+const uint32_t kColumnarBlockFlags = 3u << 30;
+
+// Whether the block of `contents` is a columnar block
+extern bool IsColumnarBlock(const Slice& contents);
+
+// Return OK if a column family can write columnar blocks of `columns`
+extern Status ValidateColDeclarations(
+    const std::vector<ColDeclaration>& columns);
+
+class ColumnarBlockBuilder {
+ public:
+  // REQUIRES: ValidateColDeclarations(columns).ok()
+  explicit ColumnarBlockBuilder(const std::vector<ColDeclaration>& columns);
+
+  void Reset();
+
+  // REQUIRES: key is larger than any previously added key
+  void Add(const Slice& key, const Slice& value);
+
+  // Whether enough of the values added are in the columns to write the block
+  // in the columnar format
+  bool Qualified() const {
+    return num_entries_ > 0 && num_columnar_ * 2 >= num_entries_;
+  }
+
+  // The returned slice remains valid until Reset() is called
+  Slice Finish();
+
+  bool empty() const { return num_entries_ == 0; }
+
+ private:
+  struct Column {
+    ColDeclaration declaration;
+    std::string data;
+    // Previous value of the delta encodings
+    uint64_t last_value;
+    uint64_t run_value;
+    uint64_t run_length;
+    std::unordered_map<uint64_t, uint64_t> dictionary;
+    std::vector<uint64_t> dictionary_values;
+
+    explicit Column(const ColDeclaration& _declaration)
+        : declaration(_declaration) {
+      Reset();
+    }
+    void Reset();
+    void Append(const char* p);
+    void AppendRun(uint64_t v);
+    void FinishRun();
+    void Finish();
+  };
+
+  // Whether `value` is a kTypeValue of exactly the declared columns
+  bool InColumns(const Slice& key, const Slice& value) const;
+
+  std::vector<Column> columns_;
+  std::string keys_;
+  std::string raw_;
+  std::string last_key_;
+  std::string buffer_;
+  uint32_t num_entries_;
+  uint32_t num_columnar_;
+};
+
+// Decode the columnar block of `contents` into `row_block` in the default
+// row format, as written by BlockBuilder. If `value_columns` is not nullptr,
+// only the columns it lists are decoded, the others are filled with zero
+// bytes, or left empty for "VariableLength".
+extern Status DecodeColumnarBlock(const Slice& contents,
+                                  const std::vector<uint32_t>* value_columns,
+                                  std::string* row_block);
+
+}  // namespace TERARKDB_NAMESPACE
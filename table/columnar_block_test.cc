@@ -0,0 +1,274 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/columnar_block.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "rocksdb/terark_namespace.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "util/string_util.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+std::vector<ColDeclaration> AllColumnKinds() {
+  return {
+      ColDeclaration("FixedLength", kColNoCompression, 3),
+      ColDeclaration("FixedLength", kColRle, 1),
+      ColDeclaration("FixedLength", kColVarint, 5),
+      ColDeclaration("FixedLength", kColRleVarint, 4, false, true),
+      ColDeclaration("FixedLength", kColDeltaVarint, 8, false, true),
+      ColDeclaration("FixedLength", kColRleDeltaVarint, 8),
+      ColDeclaration("FixedLength", kColDict, 2),
+      ColDeclaration("FixedLength", kColRleDict, 4),
+      ColDeclaration("LongFixedLength", kColNoCompression, 12),
+      ColDeclaration("VariableLength"),
+  };
+}
+
+// A value of `columns`, with runs, small deltas and few distinct values
+std::string ColumnarValue(const std::vector<ColDeclaration>& columns, int i,
+                          Random* rnd) {
+  std::string value;
+  for (auto& column : columns) {
+    if (column.col_type == "VariableLength") {
+      std::string s = "v" + ToString(rnd->Uniform(1000));
+      value.push_back(static_cast<char>(s.size()));
+      value.append(s);
+      continue;
+    }
+    uint64_t v;
+    switch (column.col_compression_type) {
+      case kColRle:
+      case kColRleVarint:
+      case kColRleDict:
+        v = i / 7;
+        break;
+      case kColDeltaVarint:
+      case kColRleDeltaVarint:
+        // Decreasing, so the deltas are negative
+        v = uint64_t(1) << 63 | (100000 - i * 3);
+        break;
+      case kColDict:
+        v = rnd->Uniform(5) * 1000;
+        break;
+      default:
+        v = uint64_t(rnd->Next()) << 32 | rnd->Next();
+        break;
+    }
+    char buf[sizeof(uint64_t)];
+    EncodeFixed64(buf, v);
+    for (size_t b = 0; b < column.size; ++b) {
+      char byte = b < sizeof(buf) ? buf[b] : static_cast<char>(rnd->Next());
+      value.push_back(byte);
+    }
+  }
+  return value;
+}
+
+struct Entry {
+  std::string key;
+  std::string value;
+};
+
+std::vector<Entry> Entries(const std::vector<ColDeclaration>& columns,
+                           size_t num, Random* rnd) {
+  std::vector<Entry> entries;
+  for (size_t i = 0; i < num; ++i) {
+    char user_key[16];
+    snprintf(user_key, sizeof(user_key), "key%08d", static_cast<int>(i));
+    Entry entry;
+    if (i % 50 == 17) {
+      entry.key = InternalKey(user_key, 100, kTypeDeletion).Encode().ToString();
+    } else if (i % 50 == 29) {
+      entry.key = InternalKey(user_key, 100, kTypeValue).Encode().ToString();
+      entry.value = "does not match the columns";
+    } else {
+      entry.key = InternalKey(user_key, 100, kTypeValue).Encode().ToString();
+      entry.value = ColumnarValue(columns, static_cast<int>(i), rnd);
+    }
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+std::string BuildColumnar(const std::vector<ColDeclaration>& columns,
+                          const std::vector<Entry>& entries) {
+  ColumnarBlockBuilder builder(columns);
+  for (auto& entry : entries) {
+    builder.Add(entry.key, entry.value);
+  }
+  EXPECT_TRUE(builder.Qualified());
+  return builder.Finish().ToString();
+}
+
+std::string BuildRow(const std::vector<Entry>& entries) {
+  BlockBuilder builder(16);
+  for (auto& entry : entries) {
+    builder.Add(entry.key, entry.value);
+  }
+  return builder.Finish().ToString();
+}
+}  // namespace
+
+TEST(ColumnarBlockTest, Validate) {
+  ASSERT_OK(ValidateColDeclarations(AllColumnKinds()));
+  ASSERT_TRUE(ValidateColDeclarations({ColDeclaration("FixedLength", kColRle,
+                                                      0)})
+                  .IsInvalidArgument());
+  ASSERT_TRUE(
+      ValidateColDeclarations({ColDeclaration("FixedLength", kColRle, 9)})
+          .IsInvalidArgument());
+  ASSERT_TRUE(ValidateColDeclarations(
+                  {ColDeclaration("FixedLength", kColRle, 4, true)})
+                  .IsNotSupported());
+  ASSERT_TRUE(
+      ValidateColDeclarations({ColDeclaration("VariableLength", kColVarint)})
+          .IsNotSupported());
+  ASSERT_TRUE(ValidateColDeclarations({ColDeclaration("VariableChunk")})
+                  .IsNotSupported());
+}
+
+TEST(ColumnarBlockTest, DecodeToRowFormat) {
+  Random rnd(301);
+  auto columns = AllColumnKinds();
+  for (size_t num : {1, 2, 100, 5000}) {
+    auto entries = Entries(columns, num, &rnd);
+    std::string columnar = BuildColumnar(columns, entries);
+    ASSERT_TRUE(IsColumnarBlock(columnar));
+    std::string row_block;
+    ASSERT_OK(DecodeColumnarBlock(columnar, nullptr, &row_block));
+    ASSERT_FALSE(IsColumnarBlock(row_block));
+    ASSERT_EQ(BuildRow(entries), row_block);
+  }
+}
+
+TEST(ColumnarBlockTest, Qualified) {
+  auto columns = AllColumnKinds();
+  ColumnarBlockBuilder builder(columns);
+  ASSERT_TRUE(builder.empty());
+  ASSERT_FALSE(builder.Qualified());
+  builder.Add(InternalKey("a", 1, kTypeValue).Encode(), "too short");
+  builder.Add(InternalKey("b", 1, kTypeMerge).Encode(), "merge operand");
+  ASSERT_FALSE(builder.empty());
+  ASSERT_FALSE(builder.Qualified());
+
+  Random rnd(301);
+  builder.Add(InternalKey("c", 1, kTypeValue).Encode(),
+              ColumnarValue(columns, 0, &rnd));
+  ASSERT_FALSE(builder.Qualified());
+  builder.Add(InternalKey("d", 1, kTypeValue).Encode(),
+              ColumnarValue(columns, 1, &rnd));
+  ASSERT_TRUE(builder.Qualified());
+
+  builder.Reset();
+  ASSERT_TRUE(builder.empty());
+  ASSERT_FALSE(builder.Qualified());
+}
+
+TEST(ColumnarBlockTest, Projection) {
+  std::vector<ColDeclaration> columns = {
+      ColDeclaration("FixedLength", kColRleVarint, 4),
+      ColDeclaration("VariableLength"),
+      ColDeclaration("FixedLength", kColDict, 2),
+  };
+  Random rnd(301);
+  auto entries = Entries(columns, 300, &rnd);
+  std::string columnar = BuildColumnar(columns, entries);
+
+  std::vector<uint32_t> value_columns = {2};
+  std::string row_block;
+  ASSERT_OK(DecodeColumnarBlock(columnar, &value_columns, &row_block));
+
+  BlockContents contents;
+  contents.data = row_block;
+  Block block(std::move(contents), kDisableGlobalSequenceNumber);
+  InternalKeyComparator icmp(BytewiseComparator());
+  std::unique_ptr<DataBlockIter> iter(
+      block.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+  size_t i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+    ASSERT_LT(i, entries.size());
+    ASSERT_EQ(entries[i].key, iter->key().ToString());
+    const std::string& value = entries[i].value;
+    if (i % 50 == 17 || i % 50 == 29) {
+      // Stored as is
+      ASSERT_EQ(value, iter->value().ToString());
+      continue;
+    }
+    // Zero bytes of column 0, an empty column 1 and the column 2
+    std::string expected(4, '\0');
+    expected.push_back('\0');
+    expected.append(value, value.size() - 2, 2);
+    ASSERT_EQ(expected, iter->value().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(entries.size(), i);
+}
+
+TEST(ColumnarBlockTest, Block) {
+  Random rnd(301);
+  auto columns = AllColumnKinds();
+  auto entries = Entries(columns, 1000, &rnd);
+  std::string columnar = BuildColumnar(columns, entries);
+
+  std::unique_ptr<char[]> buf(new char[columnar.size()]);
+  memcpy(buf.get(), columnar.data(), columnar.size());
+  Block block(BlockContents(std::move(buf), columnar.size()),
+              kDisableGlobalSequenceNumber);
+  ASSERT_EQ(BuildRow(entries), Slice(block.data(), block.size()).ToString());
+
+  InternalKeyComparator icmp(BytewiseComparator());
+  std::unique_ptr<DataBlockIter> iter(
+      block.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+  for (size_t i = 0; i < entries.size(); i += 37) {
+    iter->Seek(entries[i].key);
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(entries[i].key, iter->key().ToString());
+    ASSERT_EQ(entries[i].value, iter->value().ToString());
+  }
+}
+
+TEST(ColumnarBlockTest, Corruption) {
+  Random rnd(301);
+  auto columns = AllColumnKinds();
+  auto entries = Entries(columns, 200, &rnd);
+  std::string columnar = BuildColumnar(columns, entries);
+  std::string row_block;
+
+  // Drop bytes of the columns, the layout offset then points past the data
+  std::string truncated = columnar.substr(0, 10) +
+                          columnar.substr(columnar.size() - 40);
+  ASSERT_TRUE(DecodeColumnarBlock(truncated, nullptr, &row_block)
+                  .IsCorruption());
+
+  // More entries than the columns hold
+  std::string more_entries = columnar;
+  uint32_t footer =
+      DecodeFixed32(more_entries.data() + more_entries.size() - 4);
+  EncodeFixed32(&more_entries[more_entries.size() - 4], footer + 1);
+  ASSERT_TRUE(DecodeColumnarBlock(more_entries, nullptr, &row_block)
+                  .IsCorruption());
+
+  BlockContents contents;
+  contents.data = more_entries;
+  Block block(std::move(contents), kDisableGlobalSequenceNumber);
+  ASSERT_EQ(0u, block.size());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/compressed_secondary_cache.h"
+
+#include <string.h>
+
+#include "cache/sharded_cache.h"
+#include "rocksdb/table.h"
+#include "rocksdb/terark_namespace.h"
+#include "table/block.h"
+#include "table/block_based_table_builder.h"
+#include "table/block_based_table_reader.h"
+#include "table/format.h"
+#include "util/compression.h"
+#include "util/memory_allocator.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// The kept blocks are only read back by this process, any format version
+// with the decompressed size in front of the data does
+const uint32_t kFormatVersion = 2;
+}  // namespace
+
+CompressedSecondaryCache::CompressedSecondaryCache(
+    size_t capacity, int num_shard_bits, CompressionType compression_type)
+    : cache_(NewLRUCache(capacity, num_shard_bits)),
+      compression_type_(compression_type) {}
+
+void CompressedSecondaryCache::DeleteEntry(const Slice& /*key*/,
+                                           void* value) {
+  delete reinterpret_cast<Entry*>(value);
+}
+
+void CompressedSecondaryCache::Demote(
+    const Slice& key, void* value, size_t /*charge*/,
+    void (*deleter)(const Slice& key, void* value)) {
+  if (deleter != &DeleteCachedBlockEntry) {
+    return;
+  }
+  const Block* block = reinterpret_cast<const Block*>(value);
+  if (block->size() == 0) {
+    // A corrupted block
+    return;
+  }
+  Slice raw(block->data(), block->size());
+  std::unique_ptr<Entry> entry(new Entry);
+  CompressionContext compression_ctx(compression_type_);
+  CompressBlock(raw, compression_ctx, &entry->type, kFormatVersion,
+                &entry->data);
+  if (entry->type == kNoCompression) {
+    entry->data.assign(raw.data(), raw.size());
+  }
+  size_t charge = sizeof(Entry) + entry->data.size();
+  Status s = cache_->Insert(key, entry.get(), charge, &DeleteEntry);
+  if (s.ok()) {
+    entry.release();
+  }
+}
+
+char* CompressedSecondaryCache::Promote(const Slice& key,
+                                        MemoryAllocator* allocator,
+                                        size_t* size) {
+  Cache::Handle* handle = cache_->Lookup(key);
+  if (handle == nullptr) {
+    return nullptr;
+  }
+  const Entry* entry = reinterpret_cast<const Entry*>(cache_->Value(handle));
+  BlockContents contents;
+  Status s;
+  if (entry->type == kNoCompression) {
+    CacheAllocationPtr buf = AllocateBlock(entry->data.size(), allocator);
+    memcpy(buf.get(), entry->data.data(), entry->data.size());
+    contents = BlockContents(std::move(buf), entry->data.size());
+  } else {
+    UncompressionContext uncompression_ctx(entry->type);
+    s = UncompressBlockContentsForCompressionType(
+        uncompression_ctx, entry->data.data(), entry->data.size(), &contents,
+        kFormatVersion, ioptions_, allocator);
+  }
+  // The block cache holds the block again
+  cache_->Release(handle, true /* force_erase */);
+  if (!s.ok()) {
+    return nullptr;
+  }
+  *size = contents.data.size();
+  return contents.allocation.release();
+}
+
+std::shared_ptr<SecondaryCache> NewCompressedSecondaryCache(
+    size_t capacity, CompressionType compression_type, int num_shard_bits) {
+  if (num_shard_bits >= 20) {
+    return nullptr;  // the cache cannot be sharded into too many fine pieces
+  }
+  if (num_shard_bits < 0) {
+    num_shard_bits = GetDefaultCacheShardBits(capacity);
+  }
+  return std::make_shared<CompressedSecondaryCache>(capacity, num_shard_bits,
+                                                    compression_type);
+}
+
+}  // namespace TERARKDB_NAMESPACE
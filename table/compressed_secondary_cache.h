@@ -0,0 +1,57 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "options/cf_options.h"
+#include "rocksdb/cache.h"
+#include "rocksdb/options.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// A secondary cache for the block cache of block based tables. It keeps the
+// data and index blocks the block cache evicts compressed in an LRU cache of
+// its own, so the two tiers together hold more blocks than the block cache
+// alone would in the same memory, at the cost of a decompression on a hit.
+// Other entries of the block cache are not kept.
+//
+// A promoted block is taken out, as the block cache holds it again.
+class CompressedSecondaryCache : public SecondaryCache {
+ public:
+  CompressedSecondaryCache(size_t capacity, int num_shard_bits,
+                           CompressionType compression_type);
+
+  const char* Name() const override { return "CompressedSecondaryCache"; }
+
+  void Demote(const Slice& key, void* value, size_t charge,
+              void (*deleter)(const Slice& key, void* value)) override;
+
+  char* Promote(const Slice& key, MemoryAllocator* allocator,
+                size_t* size) override;
+
+  size_t GetUsage() const override { return cache_->GetUsage(); }
+
+ private:
+  // A block as kept in cache_. Blocks which don't compress well are kept
+  // uncompressed
+  struct Entry {
+    CompressionType type;
+    std::string data;
+  };
+
+  static void DeleteEntry(const Slice& key, void* value);
+
+  std::shared_ptr<Cache> cache_;
+  const CompressionType compression_type_;
+  // Only for the environment UncompressBlockContentsForCompressionType()
+  // times the decompression with
+  const ImmutableCFOptions ioptions_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -10,6 +10,8 @@
 #include "rocksdb/terark_namespace.h"
 #include "table/cuckoo_table_builder.h"
 #include "table/cuckoo_table_reader.h"
+#include "table/mmap_table_loader.h"
+#include "util/string_util.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -21,7 +23,8 @@ Status CuckooTableFactory::NewTableReader(
   std::unique_ptr<CuckooTableReader> new_reader(new CuckooTableReader(
       table_reader_options.ioptions, std::move(file),
       table_reader_options.file_number, file_size,
-      table_reader_options.internal_comparator.user_comparator(), nullptr));
+      table_reader_options.internal_comparator.user_comparator(), nullptr,
+      table_options_.mmap_load));
   Status s = new_reader->status();
   if (s.ok()) {
     *table = std::move(new_reader);
@@ -63,6 +66,7 @@ std::string CuckooTableFactory::GetPrintableTableOptions() const {
   snprintf(buffer, kBufferSize, "  identity_as_first_hash: %d\n",
            table_options_.identity_as_first_hash);
   ret.append(buffer);
+  AppendMmapLoadOptions(table_options_.mmap_load, &ret);
   return ret;
 }
 
@@ -97,6 +101,19 @@ static TableFactory* CuckooCreator(const std::string& options, Status* s) {
   if (!(opt = get_option("identity_as_first_hash")).empty()) {
     cto.identity_as_first_hash = std::atoi(opt.c_str());
   }
+  if (!(opt = get_option("mmap_pretouch")).empty()) {
+    cto.mmap_load.pretouch = ParseBoolean("mmap_pretouch", opt);
+  }
+  if (!(opt = get_option("mmap_transparent_huge_pages")).empty()) {
+    cto.mmap_load.transparent_huge_pages =
+        ParseBoolean("mmap_transparent_huge_pages", opt);
+  }
+  if (!(opt = get_option("mmap_huge_page_size")).empty()) {
+    cto.mmap_load.huge_page_size = ParseSizeT(opt);
+  }
+  if (!(opt = get_option("mmap_numa_interleave")).empty()) {
+    cto.mmap_load.numa_interleave = ParseBoolean("mmap_numa_interleave", opt);
+  }
   return NewCuckooTableFactory(cto);
 }
 
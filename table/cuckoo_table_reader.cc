@@ -39,7 +39,8 @@ CuckooTableReader::CuckooTableReader(
     const ImmutableCFOptions& ioptions,
     std::unique_ptr<RandomAccessFileReader>&& file, uint64_t file_number,
     uint64_t file_size, const Comparator* comparator,
-    uint64_t (*get_slice_hash)(const Slice&, uint32_t, uint64_t))
+    uint64_t (*get_slice_hash)(const Slice&, uint32_t, uint64_t),
+    const MmapLoadOptions& mmap_load)
     : file_(std::move(file)),
       is_last_level_(false),
       identity_as_first_hash_(false),
@@ -146,6 +147,12 @@ CuckooTableReader::CuckooTableReader(
   cuckoo_block_bytes_minus_one_ = cuckoo_block_size_ * bucket_length_ - 1;
   status_ =
       file_->Read(0, static_cast<size_t>(file_size), &file_data_, nullptr);
+  if (status_.ok() && MmapTableLoader::IsNeeded(mmap_load)) {
+    mmap_loader_.reset(new MmapTableLoader(mmap_load, ioptions.env,
+                                           ioptions.statistics,
+                                           ioptions.info_log));
+    file_data_ = mmap_loader_->Load(file_data_);
+  }
 }
 
 std::shared_ptr<const TableProperties> CuckooTableReader::GetTableProperties()
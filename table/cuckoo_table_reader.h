@@ -19,6 +19,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/options.h"
 #include "rocksdb/terark_namespace.h"
+#include "table/mmap_table_loader.h"
 #include "table/table_reader.h"
 #include "util/file_reader_writer.h"
 
@@ -34,7 +35,8 @@ class CuckooTableReader : public TableReader {
                     uint64_t file_number_, uint64_t file_size,
                     const Comparator* user_comparator,
                     uint64_t (*get_slice_hash)(const Slice&, uint32_t,
-                                               uint64_t));
+                                               uint64_t),
+                    const MmapLoadOptions& mmap_load = MmapLoadOptions());
   ~CuckooTableReader() {}
 
   std::shared_ptr<const TableProperties> GetTableProperties() const override;
@@ -67,6 +69,8 @@ class CuckooTableReader : public TableReader {
   void LoadAllKeys(std::vector<std::pair<Slice, uint32_t>>* key_to_bucket_id);
   std::unique_ptr<RandomAccessFileReader> file_;
   Slice file_data_;
+  // Destroyed before the file it loads
+  std::unique_ptr<MmapTableLoader> mmap_loader_;
   bool is_last_level_;
   bool identity_as_first_hash_;
   bool use_module_hash_;
@@ -17,6 +17,7 @@
 #include "table/block_builder.h"
 #include "table/get_context.h"
 #include "table/table_builder.h"
+#include "util/string_util.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
 
@@ -534,6 +535,61 @@ TEST(DataBlockHashIndex, BlockTestLarge) {
   }
 }
 
+// The hash index is used for the merge operands and the separated value
+// indexes too, SeekForGet() positions the iter like Seek() for them
+TEST(DataBlockHashIndex, BlockTestSeparatedValues) {
+  const ValueType kTypes[] = {kTypeValueIndex, kTypeMergeIndex, kTypeMerge,
+                              kTypeValue, kTypeDeletion};
+  BlockBuilder builder(4 /* block_restart_interval */,
+                       true /* use_delta_encoding */,
+                       false /* use_value_delta_encoding */,
+                       BlockBasedTableOptions::kDataBlockBinaryAndHash);
+  std::vector<std::string> ukeys;
+  int num_entries = 0;
+  for (int i = 0; i < 100; i++) {
+    ukeys.push_back("key" + ToString(1000 + i));
+    // 1 to 3 versions of each user key
+    for (int j = i % 3; j >= 0; j--) {
+      InternalKey ikey(ukeys.back(), 10 * (j + 1), kTypes[num_entries % 5]);
+      builder.Add(ikey.Encode().ToString(), "value" + ToString(num_entries));
+      num_entries++;
+    }
+  }
+
+  Slice rawblock = builder.Finish();
+  BlockContents contents;
+  contents.data = rawblock;
+  Block reader(std::move(contents), kDisableGlobalSequenceNumber);
+  ASSERT_EQ(BlockBasedTableOptions::kDataBlockBinaryAndHash,
+            reader.IndexType());
+  const InternalKeyComparator icmp(BytewiseComparator());
+  std::unique_ptr<DataBlockIter> hash_iter(
+      reader.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+  std::unique_ptr<DataBlockIter> iter(
+      reader.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+
+  for (auto& ukey : ukeys) {
+    for (SequenceNumber seq : {5, 10, 15, 20, 25, 30, 35}) {
+      std::string seek_key =
+          InternalKey(ukey, seq, kValueTypeForSeek).Encode().ToString();
+      bool may_exist = hash_iter->SeekForGet(seek_key);
+      iter->Seek(seek_key);
+      if (hash_iter->Valid()) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(iter->key(), hash_iter->key());
+        ASSERT_EQ(iter->value(), hash_iter->value());
+        if (!may_exist) {
+          ASSERT_NE(ExtractUserKey(iter->key()), ukey);
+        }
+      } else {
+        // No version of ukey is old enough, the next block is searched
+        ASSERT_TRUE(may_exist);
+        ASSERT_TRUE(!iter->Valid() || ExtractUserKey(iter->key()) != ukey);
+      }
+    }
+  }
+}
+
 // helper routine for DataBlockHashIndex.BlockBoundary
 void TestBoundary(InternalKey& ik1, std::string& v1, InternalKey& ik2,
                   std::string& v2, InternalKey& seek_ikey,
@@ -0,0 +1,109 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/data_block_key_prefix.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include "port/port.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// Below this many restarts the bound is found by counting the prefixes less
+// than the target, which is branch free and vectorizable, instead of halving
+const uint32_t kKeyPrefixLinearSearchThreshold = 16;
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+// Number of set bits of the compare masks, which have at most four bits
+const uint8_t kMaskBitCount[16] = {0, 1, 1, 2, 1, 2, 2, 3,
+                                   1, 2, 2, 3, 2, 3, 3, 4};
+#endif
+
+inline int64_t KeyPrefixAt(const char* prefixes, uint32_t index) {
+  return static_cast<int64_t>(
+      DecodeFixed64(prefixes + index * kDataBlockKeyPrefixSize));
+}
+
+uint32_t CountKeyPrefixesLessThan(const char* prefixes, uint32_t left,
+                                  uint32_t right, int64_t target) {
+  uint32_t count = 0;
+  uint32_t i = left;
+  // The compares work on the raw array, which holds little endian fixed64
+#if defined(__AVX2__)
+  if (port::kLittleEndian) {
+    const __m256i target_vec = _mm256_set1_epi64x(target);
+    for (; i + 4 <= right; i += 4) {
+      __m256i prefix_vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+          prefixes + i * kDataBlockKeyPrefixSize));
+      int mask = _mm256_movemask_pd(
+          _mm256_castsi256_pd(_mm256_cmpgt_epi64(target_vec, prefix_vec)));
+      count += kMaskBitCount[mask];
+    }
+  }
+#elif defined(__SSE4_2__)
+  if (port::kLittleEndian) {
+    const __m128i target_vec = _mm_set1_epi64x(target);
+    for (; i + 2 <= right; i += 2) {
+      __m128i prefix_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+          prefixes + i * kDataBlockKeyPrefixSize));
+      int mask = _mm_movemask_pd(
+          _mm_castsi128_pd(_mm_cmpgt_epi64(target_vec, prefix_vec)));
+      count += kMaskBitCount[mask];
+    }
+  }
+#endif
+  for (; i < right; ++i) {
+    count += KeyPrefixAt(prefixes, i) < target;
+  }
+  return count;
+}
+}  // namespace
+
+int64_t EncodeDataBlockKeyPrefix(const Slice& user_key) {
+  uint64_t prefix = 0;
+  size_t size = std::min(user_key.size(), kDataBlockKeyPrefixSize);
+  for (size_t i = 0; i < size; ++i) {
+    prefix |= static_cast<uint64_t>(static_cast<uint8_t>(user_key[i]))
+              << (8 * (kDataBlockKeyPrefixSize - 1 - i));
+  }
+  return static_cast<int64_t>(prefix ^ (1ull << 63));
+}
+
+uint32_t DataBlockKeyPrefixBound(const char* prefixes, uint32_t left,
+                                 uint32_t right, int64_t target,
+                                 bool or_equal) {
+  assert(left <= right);
+  if (or_equal) {
+    // The first prefix greater than target is the first one not less than
+    // target + 1
+    if (target == std::numeric_limits<int64_t>::max()) {
+      return right;
+    }
+    ++target;
+  }
+  while (right - left > kKeyPrefixLinearSearchThreshold) {
+    uint32_t mid = left + (right - left) / 2;
+    if (KeyPrefixAt(prefixes, mid) < target) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left + CountKeyPrefixesLessThan(prefixes, left, right, target);
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,51 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+// A fixed width key prefix per restart point, used by data blocks built with
+// kDataBlockBinaryAndKeyPrefix to narrow the restart search in Seek() and
+// SeekForPrev() before comparing full keys. The new block data format is:
+//
+// DATA_BLOCK: [RI RI RI ... RI RI_IDX KEY_PREFIX FOOTER]
+//
+// RI:         Restart Interval (the same as the default data-block format)
+// RI_IDX:     Restart Interval index (the same as the default data-block
+//             format)
+// KEY_PREFIX: NUM_RESTARTS fixed64, the encoded prefix of the user key of
+//             every restart point, see EncodeDataBlockKeyPrefix()
+// FOOTER:     A 32bit block footer, which is the NUM_RESTARTS with bit 30 as
+//             the flag indicating if the key prefixes are present. Like the
+//             hash index flag it is only honored in blocks no more than
+//             kMaxBlockSizeSupportedByHashIndex.
+//
+// A prefix is the first kDataBlockKeyPrefixSize bytes of the user key,
+// zero padded, as a big endian integer with the sign bit flipped, so that
+// signed integer order is the bytewise order of the prefixes. Because a
+// bytewise smaller prefix means a smaller user key, restarts whose prefix is
+// below the one of the target are known to be smaller than the target, and
+// those above it larger, without looking at the keys. Therefore it is only
+// valid with BytewiseComparator().
+
+const size_t kDataBlockKeyPrefixSize = sizeof(uint64_t);
+
+extern int64_t EncodeDataBlockKeyPrefix(const Slice& user_key);
+
+// Return the first index in [left, right) of the sorted `prefixes` whose
+// prefix is not less than `target`, or greater than it if `or_equal`, and
+// `right` if there is none, i.e. the lower (upper) bound of `target`. The
+// last few restarts are counted with SSE4.2 / AVX2 compares if the build
+// enables them.
+extern uint32_t DataBlockKeyPrefixBound(const char* prefixes, uint32_t left,
+                                        uint32_t right, int64_t target,
+                                        bool or_equal);
+
+}  // namespace TERARKDB_NAMESPACE
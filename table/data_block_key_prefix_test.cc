@@ -0,0 +1,189 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/data_block_key_prefix.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "rocksdb/terark_namespace.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "util/string_util.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+std::string RandomUserKey(Random* rnd) {
+  // Short keys, keys sharing the first 8 bytes and 0x00 / 0xff bytes
+  static const char kAlphabet[] = {'\0', '\x01', 'a', 'b', '\xfe', '\xff'};
+  std::string key = rnd->OneIn(2) ? "samepref" : "";
+  size_t len = rnd->Uniform(12);
+  for (size_t i = 0; i < len; ++i) {
+    key.push_back(
+        kAlphabet[rnd->Uniform(static_cast<int>(sizeof(kAlphabet)))]);
+  }
+  return key;
+}
+
+std::vector<std::string> SortedUserKeys(Random* rnd, size_t num) {
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < num; ++i) {
+    keys.push_back(RandomUserKey(rnd));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+Slice BuildBlock(BlockBuilder* builder, const std::vector<std::string>& keys) {
+  for (size_t i = 0; i < keys.size(); ++i) {
+    InternalKey ikey(keys[i], 100, kTypeValue);
+    builder->Add(ikey.Encode(), "v" + ToString(i));
+  }
+  return builder->Finish();
+}
+}  // namespace
+
+TEST(DataBlockKeyPrefix, EncodeKeepsOrder) {
+  Random rnd(301);
+  for (int i = 0; i < 10000; ++i) {
+    std::string a = RandomUserKey(&rnd);
+    std::string b = RandomUserKey(&rnd);
+    if (a > b) {
+      std::swap(a, b);
+    }
+    ASSERT_LE(EncodeDataBlockKeyPrefix(a), EncodeDataBlockKeyPrefix(b));
+    if (a.compare(0, 8, b, 0, 8) == 0) {
+      ASSERT_EQ(EncodeDataBlockKeyPrefix(a), EncodeDataBlockKeyPrefix(b));
+    }
+  }
+  ASSERT_EQ(EncodeDataBlockKeyPrefix(""),
+            EncodeDataBlockKeyPrefix(std::string(1, '\0')));
+  ASSERT_LT(EncodeDataBlockKeyPrefix("\x7f"), EncodeDataBlockKeyPrefix("\x80"));
+}
+
+TEST(DataBlockKeyPrefix, Bound) {
+  Random rnd(301);
+  for (uint32_t n = 0; n < 100; ++n) {
+    std::vector<int64_t> prefixes;
+    for (uint32_t i = 0; i < n; ++i) {
+      // Few distinct values to get duplicates, around both signs
+      prefixes.push_back(static_cast<int64_t>(rnd.Uniform(20)) - 10);
+    }
+    std::sort(prefixes.begin(), prefixes.end());
+    std::string array;
+    for (int64_t prefix : prefixes) {
+      PutFixed64(&array, static_cast<uint64_t>(prefix));
+    }
+    for (int64_t target = -12; target <= 12; ++target) {
+      uint32_t left = n == 0 ? 0 : rnd.Uniform(n);
+      uint32_t lower = static_cast<uint32_t>(
+          std::lower_bound(prefixes.begin() + left, prefixes.end(), target) -
+          prefixes.begin());
+      uint32_t upper = static_cast<uint32_t>(
+          std::upper_bound(prefixes.begin() + left, prefixes.end(), target) -
+          prefixes.begin());
+      ASSERT_EQ(lower,
+                DataBlockKeyPrefixBound(array.data(), left, n, target, false));
+      ASSERT_EQ(upper,
+                DataBlockKeyPrefixBound(array.data(), left, n, target, true));
+    }
+  }
+  std::string array;
+  PutFixed64(&array, static_cast<uint64_t>(INT64_MAX));
+  ASSERT_EQ(1, DataBlockKeyPrefixBound(array.data(), 0, 1, INT64_MAX, true));
+  ASSERT_EQ(0, DataBlockKeyPrefixBound(array.data(), 0, 1, INT64_MAX, false));
+}
+
+TEST(DataBlockKeyPrefix, BlockSeek) {
+  Random rnd(301);
+  const InternalKeyComparator icmp(BytewiseComparator());
+  for (int restart_interval : {1, 4, 16}) {
+    std::vector<std::string> keys = SortedUserKeys(&rnd, 1000);
+    BlockBuilder builder(restart_interval, true /* use_delta_encoding */,
+                         false /* use_value_delta_encoding */,
+                         BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix);
+    BlockBuilder plain_builder(restart_interval);
+    BlockContents contents;
+    contents.data = BuildBlock(&builder, keys);
+    BlockContents plain_contents;
+    plain_contents.data = BuildBlock(&plain_builder, keys);
+    size_t num_restarts =
+        (keys.size() + restart_interval - 1) / restart_interval;
+    ASSERT_EQ(plain_contents.data.size() +
+                  num_restarts * kDataBlockKeyPrefixSize,
+              contents.data.size());
+    Block reader(std::move(contents), kDisableGlobalSequenceNumber);
+    Block plain_reader(std::move(plain_contents), kDisableGlobalSequenceNumber);
+    ASSERT_EQ(BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix,
+              reader.IndexType());
+
+    std::unique_ptr<DataBlockIter> iter(
+        reader.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+    std::unique_ptr<DataBlockIter> plain_iter(
+        plain_reader.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+    std::vector<std::string> targets = keys;
+    for (int i = 0; i < 2000; ++i) {
+      targets.push_back(RandomUserKey(&rnd));
+    }
+    for (auto& target : targets) {
+      for (SequenceNumber seq : {SequenceNumber(50), SequenceNumber(200)}) {
+        InternalKey ikey(target, seq, kValueTypeForSeek);
+        iter->Seek(ikey.Encode());
+        plain_iter->Seek(ikey.Encode());
+        ASSERT_EQ(plain_iter->Valid(), iter->Valid());
+        if (iter->Valid()) {
+          ASSERT_EQ(plain_iter->key(), iter->key());
+          ASSERT_EQ(plain_iter->value(), iter->value());
+        }
+        iter->SeekForPrev(ikey.Encode());
+        plain_iter->SeekForPrev(ikey.Encode());
+        ASSERT_EQ(plain_iter->Valid(), iter->Valid());
+        if (iter->Valid()) {
+          ASSERT_EQ(plain_iter->key(), iter->key());
+        }
+      }
+    }
+  }
+}
+
+TEST(DataBlockKeyPrefix, BlockSizeExceedMax) {
+  BlockBuilder builder(1 /* block_restart_interval */,
+                       false /* use_delta_encoding */,
+                       false /* use_value_delta_encoding */,
+                       BlockBasedTableOptions::kDataBlockBinaryAndKeyPrefix);
+  InternalKey ikey(std::string(10, 'k'), 0, kTypeValue);
+  // The block without key prefixes would just fit, they are left out
+  builder.Add(ikey.Encode(), std::string(65500, 'v'));
+  ASSERT_GT(builder.CurrentSizeEstimate(), kMaxBlockSizeSupportedByHashIndex);
+
+  BlockContents contents;
+  contents.data = builder.Finish();
+  ASSERT_LE(contents.data.size(), kMaxBlockSizeSupportedByHashIndex);
+  Block reader(std::move(contents), kDisableGlobalSequenceNumber);
+  ASSERT_EQ(BlockBasedTableOptions::kDataBlockBinarySearch, reader.IndexType());
+
+  const InternalKeyComparator icmp(BytewiseComparator());
+  std::unique_ptr<DataBlockIter> iter(
+      reader.NewIterator<DataBlockIter>(&icmp, icmp.user_comparator()));
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(ikey.Encode(), iter->key());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
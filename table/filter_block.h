@@ -102,6 +102,22 @@ class FilterBlockReader {
                            const bool no_io = false,
                            const Slice* const const_ikey_ptr = nullptr) = 0;
 
+  /**
+   * KeyMayMatch of keys[0, num), the result of keys[i] is stored in
+   * may_match[i]. const_ikeys, if not null, are the internal keys of keys.
+   * Filters which can overlap the probes of different keys override it.
+   */
+  virtual void KeysMayMatch(size_t num, const Slice* keys, bool* may_match,
+                            const SliceTransform* prefix_extractor,
+                            const bool no_io = false,
+                            const Slice* const const_ikeys = nullptr) {
+    for (size_t i = 0; i < num; ++i) {
+      may_match[i] =
+          KeyMayMatch(keys[i], prefix_extractor, kNotValid, no_io,
+                      const_ikeys == nullptr ? nullptr : &const_ikeys[i]);
+    }
+  }
+
   /**
    * no_io and const_ikey_ptr here means the same as in KeyMayMatch
    */
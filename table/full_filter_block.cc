@@ -13,6 +13,8 @@
 #endif
 #endif
 
+#include <algorithm>
+
 #include "monitoring/perf_context_imp.h"
 #include "port/port.h"
 #include "rocksdb/filter_policy.h"
@@ -136,6 +138,20 @@ bool FullFilterBlockReader::KeyMayMatch(
   return MayMatch(key);
 }
 
+void FullFilterBlockReader::KeysMayMatch(
+    size_t num, const Slice* keys, bool* may_match,
+    const SliceTransform* /*prefix_extractor*/, const bool /*no_io*/,
+    const Slice* const /*const_ikeys*/) {
+  if (!whole_key_filtering_ || contents_.size() == 0) {
+    std::fill(may_match, may_match + num, true);
+    return;
+  }
+  filter_bits_reader_->KeysMayMatch(num, keys, may_match);
+  size_t hits = std::count(may_match, may_match + num, true);
+  PERF_COUNTER_ADD(bloom_sst_hit_count, hits);
+  PERF_COUNTER_ADD(bloom_sst_miss_count, num - hits);
+}
+
 bool FullFilterBlockReader::PrefixMayMatch(
     const Slice& prefix, const SliceTransform* /* prefix_extractor */,
     uint64_t block_offset, const bool /*no_io*/,
@@ -137,6 +137,25 @@ TEST_F(PluginFullFilterBlockTest, PluginSingleChunk) {
   ASSERT_TRUE(!reader.KeyMayMatch("other", nullptr));
 }
 
+TEST_F(PluginFullFilterBlockTest, PluginKeysMayMatch) {
+  FullFilterBlockBuilder builder(
+      nullptr, true, table_options_.filter_policy->GetFilterBitsBuilder());
+  builder.Add("foo");
+  builder.Add("hello");
+  Slice block = builder.Finish();
+  FullFilterBlockReader reader(
+      nullptr, true, block,
+      table_options_.filter_policy->GetFilterBitsReader(block), nullptr);
+  // The plugin reader checks one key after another
+  const Slice keys[] = {"foo", "missing", "hello", "other"};
+  bool may_match[4];
+  reader.KeysMayMatch(4, keys, may_match, nullptr);
+  ASSERT_TRUE(may_match[0]);
+  ASSERT_TRUE(!may_match[1]);
+  ASSERT_TRUE(may_match[2]);
+  ASSERT_TRUE(!may_match[3]);
+}
+
 class FullFilterBlockTest : public testing::Test {
  public:
   BlockBasedTableOptions table_options_;
@@ -217,6 +236,30 @@ TEST_F(FullFilterBlockTest, SingleChunk) {
   ASSERT_TRUE(!reader.KeyMayMatch("other", nullptr));
 }
 
+TEST_F(FullFilterBlockTest, KeysMayMatch) {
+  const Slice keys[] = {"foo", "missing", "bar", "other", "box", "hello"};
+  const size_t kNumKeys = sizeof(keys) / sizeof(keys[0]);
+  bool may_match[kNumKeys];
+  for (bool whole_key_filtering : {true, false}) {
+    FullFilterBlockBuilder builder(
+        nullptr, true, table_options_.filter_policy->GetFilterBitsBuilder());
+    builder.Add("foo");
+    builder.Add("bar");
+    builder.Add("box");
+    builder.Add("hello");
+    Slice block = builder.Finish();
+    FullFilterBlockReader reader(
+        nullptr, whole_key_filtering, block,
+        table_options_.filter_policy->GetFilterBitsReader(block), nullptr);
+    reader.KeysMayMatch(kNumKeys, keys, may_match, nullptr);
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      ASSERT_EQ(reader.KeyMayMatch(keys[i], nullptr), may_match[i]) << i;
+    }
+    ASSERT_EQ(!whole_key_filtering, may_match[1]);
+    ASSERT_EQ(!whole_key_filtering, may_match[3]);
+  }
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -14,6 +14,7 @@
 #include "rocksdb/merge_operator.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/coding.h"
 #include "util/util.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -57,7 +58,10 @@ GetContext::GetContext(const Comparator* ucmp,
       min_seq_type_(0),
       callback_(callback),
       is_index_(false),
-      is_finished_(false) {
+      is_finished_(false),
+      defer_separated_value_(false),
+      is_blob_fetch_(false),
+      replay_log_(nullptr) {
   if (seq_) {
     *seq_ = kMaxSequenceNumber;
   }
@@ -145,6 +149,21 @@ void GetContext::ReportCounters() {
   }
 }
 
+// Each entry of the replay log is the type byte, varint64 sequence, varint64
+// file number and the length prefixed value
+void GetContext::AppendToReplayLog(const ParsedInternalKey& parsed_key,
+                                   const LazyBuffer& value) {
+  if (!value.fetch().ok()) {
+    replay_log_->clear();
+    replay_log_ = nullptr;
+    return;
+  }
+  replay_log_->push_back(static_cast<char>(parsed_key.type));
+  PutVarint64(replay_log_, parsed_key.sequence);
+  PutVarint64(replay_log_, value.file_number());
+  PutLengthPrefixedSlice(replay_log_, value.slice());
+}
+
 bool GetContext::SaveValue(const ParsedInternalKey& parsed_key,
                            LazyBuffer&& value, bool* matched) {
   assert(matched);
@@ -162,6 +181,9 @@ bool GetContext::SaveValue(const ParsedInternalKey& parsed_key,
     if (!CheckCallback(parsed_key.sequence)) {
       return true;  // to continue to the next seq
     }
+    if (replay_log_ != nullptr) {
+      AppendToReplayLog(parsed_key, value);
+    }
 
     if (seq_ != nullptr) {
       // Set the sequence number if it is uninitialized
@@ -205,6 +227,13 @@ bool GetContext::SaveValue(const ParsedInternalKey& parsed_key,
         }
         value = separate_helper_->TransToCombined(user_key_,
                                                   parsed_key.sequence, value);
+        if (defer_separated_value_ && kNotFound == state_) {
+          state_ = kFound;
+          if (LIKELY(lazy_val_ != nullptr)) {
+            *lazy_val_ = std::move(value);
+          }
+          return Finish();
+        }
         FALLTHROUGH_INTENDED;
       case kTypeValue:
         assert(state_ == kNotFound || state_ == kMerge);
@@ -308,4 +337,35 @@ bool GetContext::SaveValue(const ParsedInternalKey& parsed_key,
   return false;
 }
 
+void ReplayGetContextLog(const Slice& replay_log, const Slice& user_key,
+                         GetContext* get_context, Cache* cache,
+                         Cache::Handle* handle) {
+  Slice log = replay_log;
+  while (!log.empty()) {
+    auto type = static_cast<ValueType>(log[0]);
+    log.remove_prefix(1);
+    uint64_t sequence = 0, file_number = 0;
+    Slice value;
+    bool ok = GetVarint64(&log, &sequence) &&
+              GetVarint64(&log, &file_number) &&
+              GetLengthPrefixedSlice(&log, &value);
+    assert(ok);
+    (void)ok;
+    cache->Ref(handle);
+    Cleanable release_handle(
+        [](void* arg1, void* arg2) {
+          reinterpret_cast<Cache*>(arg1)->Release(
+              reinterpret_cast<Cache::Handle*>(arg2));
+        },
+        cache, handle);
+    bool matched = false;
+    if (!get_context->SaveValue(
+            ParsedInternalKey(user_key, sequence, type),
+            LazyBuffer(value, std::move(release_handle), file_number),
+            &matched)) {
+      break;
+    }
+  }
+}
+
 }  // namespace TERARKDB_NAMESPACE
@@ -8,6 +8,7 @@
 
 #include "db/merge_context.h"
 #include "db/read_callback.h"
+#include "rocksdb/cache.h"
 #include "rocksdb/env.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/terark_namespace.h"
@@ -81,16 +82,50 @@ class GetContext {
     return seq_ != nullptr || min_seq_type_ != 0;
   }
 
+  // Whether the lookup only asks if the key exists, so that a table may report
+  // an entry of the key it knows to be visible to the lookup without its value
+  // or its true sequence number
+  bool key_presence_only() const {
+    return lazy_val_ == nullptr && seq_ == nullptr && min_seq_type_ == 0 &&
+           callback_ == nullptr && replay_log_ == nullptr &&
+           (max_covering_tombstone_seq_ == nullptr ||
+            *max_covering_tombstone_seq_ == 0);
+  }
+
   bool sample() const { return sample_; }
   bool is_index() const { return is_index_; }
 
   bool is_finished() const { return is_finished_; }
 
+  // Leave a separated value unfetched in the output buffer, the caller is
+  // responsible for dumping it. Used by MultiGet to batch blob reads
+  void set_defer_separated_value(bool defer) { defer_separated_value_ = defer; }
+
   void SetMinSequenceAndType(uint64_t min_seq_type) {
     min_seq_type_ = min_seq_type;
   }
   uint64_t GetMinSequenceAndType() const { return min_seq_type_; }
 
+  // Record what SaveValue() is given into replay_log, to replay it with
+  // ReplayGetContextLog() on another lookup of the same key. The log is
+  // cleared and no longer set if a value fails to fetch.
+  void SetReplayLog(std::string* replay_log) { replay_log_ = replay_log; }
+  bool has_replay_log() const { return replay_log_ != nullptr; }
+
+  // Whether the lookups of this context can be served by the row cache. The
+  // replay log keeps the sequence numbers, but not what the callback and the
+  // map sst bounds would have made of them. A lookup without a value would
+  // leave the values out of the log
+  bool CanUseRowCache() const {
+    return replay_log_ == nullptr && min_seq_type_ == 0 &&
+           callback_ == nullptr && lazy_val_ != nullptr;
+  }
+
+  // Fetching a separated value from its blob sst, which the row cache leaves
+  // to the blob cache
+  void set_is_blob_fetch(bool is_blob_fetch) { is_blob_fetch_ = is_blob_fetch; }
+  bool is_blob_fetch() const { return is_blob_fetch_; }
+
   bool CheckCallback(SequenceNumber seq) {
     if (callback_) {
       return callback_->IsVisible(seq);
@@ -101,6 +136,9 @@ class GetContext {
   void ReportCounters();
 
  private:
+  void AppendToReplayLog(const ParsedInternalKey& parsed_key,
+                         const LazyBuffer& value);
+
   const Comparator* ucmp_;
   const MergeOperator* merge_operator_;
   // the merge operations encountered;
@@ -125,6 +163,15 @@ class GetContext {
   bool sample_;
   bool is_index_;
   bool is_finished_;
+  bool defer_separated_value_;
+  bool is_blob_fetch_;
+  std::string* replay_log_;
 };
 
+// Call SaveValue() of get_context with the entries of replay_log, the values
+// refer to it and hold a reference of handle, the row cache entry holding it
+extern void ReplayGetContextLog(const Slice& replay_log, const Slice& user_key,
+                                GetContext* get_context, Cache* cache,
+                                Cache::Handle* handle);
+
 }  // namespace TERARKDB_NAMESPACE
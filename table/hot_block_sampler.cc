@@ -0,0 +1,81 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/hot_block_sampler.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/random.h"
+
+namespace TERARKDB_NAMESPACE {
+
+HotBlockSampler::HotBlockSampler(uint32_t sample_interval, size_t max_blocks)
+    : sample_interval_(sample_interval == 0 ? 1 : sample_interval),
+      max_blocks_(max_blocks == 0 ? 1 : max_blocks) {}
+
+bool HotBlockSampler::ShouldSample() const {
+  return sample_interval_ == 1 ||
+         Random::GetTLSInstance()->OneIn(static_cast<int>(sample_interval_));
+}
+
+void HotBlockSampler::Decay() {
+  for (auto it = blocks_.begin(); it != blocks_.end();) {
+    it->second.count /= 2;
+    if (it->second.count == 0) {
+      it = blocks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void HotBlockSampler::Sample(uint64_t offset, const Slice& index_key) {
+  std::lock_guard<SpinMutex> lock(mutex_);
+  auto it = blocks_.find(offset);
+  if (it != blocks_.end()) {
+    ++it->second.count;
+    return;
+  }
+  if (blocks_.size() >= max_blocks_) {
+    Decay();
+    if (blocks_.size() >= max_blocks_) {
+      // Every block is still hotter than a single read
+      return;
+    }
+  }
+  blocks_.emplace(offset, Block{index_key.ToString(), 1});
+}
+
+void HotBlockSampler::GetHottest(size_t limit,
+                                 std::vector<std::string>* index_keys) const {
+  std::vector<std::pair<uint64_t, const Block*>> hottest;
+  std::lock_guard<SpinMutex> lock(mutex_);
+  hottest.reserve(blocks_.size());
+  for (auto& pair : blocks_) {
+    hottest.emplace_back(pair.first, &pair.second);
+  }
+  limit = std::min(limit, hottest.size());
+  // Ties are broken by offset so that the result does not depend on the
+  // iteration order of the map
+  std::partial_sort(hottest.begin(), hottest.begin() + limit, hottest.end(),
+                    [](const std::pair<uint64_t, const Block*>& a,
+                       const std::pair<uint64_t, const Block*>& b) {
+                      return a.second->count != b.second->count
+                                 ? a.second->count > b.second->count
+                                 : a.first < b.first;
+                    });
+  for (size_t i = 0; i < limit; ++i) {
+    index_keys->emplace_back(hottest[i].second->index_key);
+  }
+}
+
+size_t HotBlockSampler::size() const {
+  std::lock_guard<SpinMutex> lock(mutex_);
+  return blocks_.size();
+}
+
+}  // namespace TERARKDB_NAMESPACE
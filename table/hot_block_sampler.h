@@ -0,0 +1,60 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// HotBlockSampler counts sampled foreground reads of the data blocks of one
+// table. The blocks read most form the hot block set of the table, which the
+// DB persists and loads into the block cache again after a restart or a
+// compaction (see DBOptions::hot_block_sample_interval).
+//
+// A block is identified by its offset and remembered with the key of its
+// index entry, so the set can be located in this table as well as in tables
+// holding the same keys. At most `max_blocks` blocks are remembered, when a
+// new block does not fit all counts are halved and the blocks dropping to
+// zero are forgotten.
+class HotBlockSampler {
+ public:
+  // Sample one out of `sample_interval` reads
+  HotBlockSampler(uint32_t sample_interval, size_t max_blocks);
+
+  bool ShouldSample() const;
+
+  // Count a read of the block at `offset`, `index_key` is the key of its
+  // index entry
+  void Sample(uint64_t offset, const Slice& index_key);
+
+  // Append the index keys of at most `limit` blocks sampled most, hottest
+  // first
+  void GetHottest(size_t limit, std::vector<std::string>* index_keys) const;
+
+  size_t size() const;
+
+ private:
+  struct Block {
+    std::string index_key;
+    uint64_t count;
+  };
+
+  void Decay();
+
+  const uint32_t sample_interval_;
+  const size_t max_blocks_;
+  mutable SpinMutex mutex_;
+  std::unordered_map<uint64_t, Block> blocks_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,98 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/hot_block_sampler.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class HotBlockSamplerTest : public testing::Test {};
+
+TEST_F(HotBlockSamplerTest, Hottest) {
+  HotBlockSampler sampler(1, 1024);
+  ASSERT_TRUE(sampler.ShouldSample());
+  for (int i = 0; i < 3; ++i) {
+    sampler.Sample(4096, "b");
+  }
+  sampler.Sample(0, "a");
+  sampler.Sample(8192, "c");
+  sampler.Sample(8192, "c");
+  sampler.Sample(12288, "d");
+  ASSERT_EQ(4, sampler.size());
+
+  std::vector<std::string> keys;
+  sampler.GetHottest(3, &keys);
+  // Ties go to the lower offset
+  ASSERT_EQ((std::vector<std::string>{"b", "c", "a"}), keys);
+
+  keys.clear();
+  sampler.GetHottest(10, &keys);
+  ASSERT_EQ((std::vector<std::string>{"b", "c", "a", "d"}), keys);
+}
+
+TEST_F(HotBlockSamplerTest, Decay) {
+  const size_t kMaxBlocks = 4;
+  HotBlockSampler sampler(1, kMaxBlocks);
+  for (uint64_t offset = 0; offset < kMaxBlocks; ++offset) {
+    sampler.Sample(offset, std::to_string(offset));
+  }
+  sampler.Sample(0, "0");
+  for (int i = 0; i < 3; ++i) {
+    sampler.Sample(1, "1");
+  }
+  ASSERT_EQ(kMaxBlocks, sampler.size());
+
+  // Halving forgets the blocks read once
+  sampler.Sample(100, "100");
+  ASSERT_EQ(3, sampler.size());
+  std::vector<std::string> keys;
+  sampler.GetHottest(kMaxBlocks, &keys);
+  ASSERT_EQ((std::vector<std::string>{"1", "0", "100"}), keys);
+}
+
+TEST_F(HotBlockSamplerTest, Concurrent) {
+  const size_t kMaxBlocks = 16;
+  HotBlockSampler sampler(1, kMaxBlocks);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&sampler] {
+      for (uint64_t i = 0; i < 1000; ++i) {
+        sampler.Sample(i % 64, std::to_string(i % 64));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_LE(sampler.size(), kMaxBlocks);
+  std::vector<std::string> keys;
+  sampler.GetHottest(kMaxBlocks, &keys);
+  ASSERT_EQ(sampler.size(), keys.size());
+}
+
+TEST_F(HotBlockSamplerTest, SampleInterval) {
+  HotBlockSampler sampler(8, 1024);
+  size_t sampled = 0;
+  for (int i = 0; i < 8000; ++i) {
+    sampled += sampler.ShouldSample();
+  }
+  ASSERT_GT(sampled, 500);
+  ASSERT_LT(sampled, 1500);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
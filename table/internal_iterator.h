@@ -13,6 +13,7 @@
 #include "rocksdb/lazy_buffer.h"
 #include "rocksdb/status.h"
 #include "rocksdb/terark_namespace.h"
+#include "rocksdb/types.h"
 #include "table/format.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -58,6 +59,18 @@ class InternalIteratorCommon : public Cleanable {
   // REQUIRES: Valid()
   virtual void Prev() = 0;
 
+  // Moves to the next entry like Next(), where the current entry is known to
+  // be covered by a range tombstone of sequence number `tombstone_seq` that
+  // ends at the internal key `tombstone_end`. Iterators merging sources
+  // known to be older than the tombstone may seek them to `tombstone_end`
+  // instead of stepping through the covered entries, so the entries between
+  // the current one and `tombstone_end` may or may not be visited.
+  // REQUIRES: Valid()
+  virtual void NextSkipCovered(const Slice& /*tombstone_end*/,
+                               SequenceNumber /*tombstone_seq*/) {
+    Next();
+  }
+
   // Return the key for the current entry.  The underlying storage for
   // the returned slice is valid only until the next modification of
   // the iterator.
@@ -13,33 +13,36 @@
 namespace TERARKDB_NAMESPACE {
 
 // When used with std::priority_queue, this comparison functor puts the
-// iterator with the max/largest key on top.
+// iterator with the max/largest key on top. KeyCompare is InternalKeyCompare
+// or a BytewiseInternalKeyCompare.
+template <class KeyCompare = InternalKeyCompare>
 class MaxIteratorComparator {
  public:
   MaxIteratorComparator(const InternalKeyComparator* comparator)
-      : comparator_(comparator) {}
+      : compare_(comparator) {}
 
   bool operator()(IteratorWrapper* a, IteratorWrapper* b) const {
-    return comparator_->Compare(a->key(), b->key()) < 0;
+    return compare_.Compare(a->key(), b->key()) < 0;
   }
 
  private:
-  const InternalKeyComparator* comparator_;
+  KeyCompare compare_;
 };
 
 // When used with std::priority_queue, this comparison functor puts the
 // iterator with the min/smallest key on top.
+template <class KeyCompare = InternalKeyCompare>
 class MinIteratorComparator {
  public:
   MinIteratorComparator(const InternalKeyComparator* comparator)
-      : comparator_(comparator) {}
+      : compare_(comparator) {}
 
   bool operator()(IteratorWrapper* a, IteratorWrapper* b) const {
-    return comparator_->Compare(a->key(), b->key()) > 0;
+    return compare_.Compare(a->key(), b->key()) > 0;
   }
 
  private:
-  const InternalKeyComparator* comparator_;
+  KeyCompare compare_;
 };
 
 }  // namespace TERARKDB_NAMESPACE
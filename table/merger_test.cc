@@ -112,6 +112,23 @@ class MergerTest : public testing::Test {
     single_iterator_.reset(new test::VectorIterator(all_keys_));
   }
 
+  // Like Generate(), but merges with NewLoserTreeMergingIterator()
+  void GenerateLoserTree(size_t num_iterators, size_t strings_per_iterator,
+                         int letters_per_string,
+                         const InternalKeyComparator* icomp) {
+    std::vector<InternalIterator*> small_iterators;
+    for (size_t i = 0; i < num_iterators; ++i) {
+      auto strings = GenerateStrings(strings_per_iterator, letters_per_string);
+      small_iterators.push_back(new test::VectorIterator(strings));
+      all_keys_.insert(all_keys_.end(), strings.begin(), strings.end());
+    }
+
+    merging_iterator_.reset(
+        NewLoserTreeMergingIterator(icomp, &small_iterators[0],
+                                    static_cast<int>(small_iterators.size())));
+    single_iterator_.reset(new test::VectorIterator(all_keys_));
+  }
+
   InternalKeyComparator icomp_;
   Random rnd_;
   std::unique_ptr<InternalIterator> merging_iterator_;
@@ -173,6 +190,67 @@ TEST_F(MergerTest, SeekToLastTest) {
   }
 }
 
+namespace {
+// Orders like BytewiseComparator(), but takes the generic compare path
+class WrappedBytewiseComparator : public Comparator {
+ public:
+  const char* Name() const override { return "WrappedBytewiseComparator"; }
+  int Compare(const Slice& a, const Slice& b) const override {
+    return BytewiseComparator()->Compare(a, b);
+  }
+  void FindShortestSeparator(std::string* /*start*/,
+                             const Slice& /*limit*/) const override {}
+  void FindShortSuccessor(std::string* /*key*/) const override {}
+};
+}  // namespace
+
+TEST_F(MergerTest, LoserTreeSeekToFirstTest) {
+  for (size_t num_iterators : {2, 3, 7, 1000}) {
+    all_keys_.clear();
+    GenerateLoserTree(num_iterators, 50, 50, &icomp_);
+    SeekToFirst();
+    AssertEquivalence();
+    Next(50000);
+    ASSERT_OK(merging_iterator_->status());
+  }
+}
+
+TEST_F(MergerTest, LoserTreeSeekToRandomNextSmallStringsTest) {
+  GenerateLoserTree(1000, 50, 2, &icomp_);
+  for (int i = 0; i < 10; ++i) {
+    SeekToRandom();
+    AssertEquivalence();
+    Next(50000);
+  }
+  ASSERT_OK(merging_iterator_->status());
+}
+
+TEST_F(MergerTest, LoserTreeNonBytewiseTest) {
+  WrappedBytewiseComparator user_comparator;
+  InternalKeyComparator icomp(&user_comparator);
+  GenerateLoserTree(200, 50, 10, &icomp);
+  for (int i = 0; i < 10; ++i) {
+    SeekToRandom();
+    AssertEquivalence();
+    Next(50000);
+  }
+  SeekToFirst();
+  Next(50000);
+  ASSERT_OK(merging_iterator_->status());
+}
+
+TEST_F(MergerTest, LoserTreeForwardOnly) {
+  GenerateLoserTree(10, 10, 10, &icomp_);
+  merging_iterator_->SeekToFirst();
+  ASSERT_TRUE(merging_iterator_->Valid());
+  merging_iterator_->SeekToLast();
+  ASSERT_TRUE(merging_iterator_->status().IsNotSupported());
+  ASSERT_FALSE(merging_iterator_->Valid());
+  merging_iterator_->SeekToFirst();
+  ASSERT_OK(merging_iterator_->status());
+  ASSERT_TRUE(merging_iterator_->Valid());
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -18,6 +18,7 @@
 #include "rocksdb/iterator.h"
 #include "rocksdb/options.h"
 #include "rocksdb/terark_namespace.h"
+#include "table/data_block_key_prefix.h"
 #include "table/internal_iterator.h"
 #include "table/iter_heap.h"
 #include "table/iterator_wrapper.h"
@@ -28,21 +29,31 @@
 #include "util/sync_point.h"
 
 namespace TERARKDB_NAMESPACE {
-// Without anonymous namespace here, we fail the warning -Wmissing-prototypes
-namespace {
-typedef BinaryHeap<IteratorWrapper*, MaxIteratorComparator> MergerMaxIterHeap;
-typedef BinaryHeap<IteratorWrapper*, MinIteratorComparator> MergerMinIterHeap;
-}  // namespace
 
 const size_t kNumIterReserve = 4;
 
 class MergingIterator : public InternalIterator {
  public:
-  MergingIterator(const InternalKeyComparator* comparator,
-                  InternalIterator** children, int n, bool is_arena_mode,
-                  bool prefix_seek_mode)
+  virtual void AddIterator(InternalIterator* iter,
+                           SequenceNumber max_seqno) = 0;
+};
+
+// KeyCompare is InternalKeyCompare, or a BytewiseInternalKeyCompare for the
+// heap steps to compare keys without virtual calls, see NewMergingIteratorOf()
+template <class KeyCompare>
+class MergingIteratorImpl : public MergingIterator {
+  typedef BinaryHeap<IteratorWrapper*, MaxIteratorComparator<KeyCompare>>
+      MergerMaxIterHeap;
+  typedef BinaryHeap<IteratorWrapper*, MinIteratorComparator<KeyCompare>>
+      MergerMinIterHeap;
+
+ public:
+  MergingIteratorImpl(const InternalKeyComparator* comparator,
+                      InternalIterator** children, int n, bool is_arena_mode,
+                      bool prefix_seek_mode)
       : is_arena_mode_(is_arena_mode),
         comparator_(comparator),
+        compare_(comparator),
         current_(nullptr),
         direction_(kForward),
         minHeap_(comparator_),
@@ -50,6 +61,7 @@ class MergingIterator : public InternalIterator {
     children_.resize(n);
     for (int i = 0; i < n; i++) {
       children_[i].Set(children[i]);
+      children_max_seqno_.push_back(kMaxSequenceNumber);
     }
     for (auto& child : children_) {
       if (child.Valid()) {
@@ -68,9 +80,11 @@ class MergingIterator : public InternalIterator {
     }
   }
 
-  virtual void AddIterator(InternalIterator* iter) {
+  virtual void AddIterator(InternalIterator* iter,
+                           SequenceNumber max_seqno) override {
     assert(direction_ == kForward);
     children_.emplace_back(iter);
+    children_max_seqno_.emplace_back(max_seqno);
     auto new_wrapper = children_.back();
     if (new_wrapper.Valid()) {
       assert(new_wrapper.status().ok());
@@ -81,7 +95,7 @@ class MergingIterator : public InternalIterator {
     }
   }
 
-  virtual ~MergingIterator() {
+  virtual ~MergingIteratorImpl() {
     for (auto& child : children_) {
       child.DeleteIter(is_arena_mode_);
     }
@@ -212,6 +226,40 @@ class MergingIterator : public InternalIterator {
     current_ = CurrentForward();
   }
 
+  virtual void NextSkipCovered(const Slice& tombstone_end,
+                               SequenceNumber tombstone_seq) override {
+    assert(Valid());
+    if (direction_ != kForward ||
+        !CanSkipCovered(tombstone_end, tombstone_seq)) {
+      Next();
+      return;
+    }
+    // Every entry of the children older than the tombstone is covered up to
+    // its end, seek them there and step the others like Next()
+    minHeap_.clear();
+    for (size_t i = 0; i < children_.size(); ++i) {
+      auto& child = children_[i];
+      if (!child.Valid()) {
+        continue;
+      }
+      if (children_max_seqno_[i] < tombstone_seq &&
+          compare_.Compare(child.key(), tombstone_end) < 0) {
+        PERF_TIMER_GUARD(seek_child_seek_time);
+        child.Seek(tombstone_end);
+        PERF_COUNTER_ADD(seek_child_seek_count, 1);
+      } else if (&child == current_) {
+        child.Next();
+      }
+      if (child.Valid()) {
+        assert(child.status().ok());
+        minHeap_.push(&child);
+      } else {
+        considerStatus(child.status());
+      }
+    }
+    current_ = CurrentForward();
+  }
+
   virtual void Prev() override {
     assert(Valid());
     // Ensure that all children are positioned before key().
@@ -229,7 +277,7 @@ class MergingIterator : public InternalIterator {
           child.SeekForPrev(target);
           TEST_SYNC_POINT_CALLBACK("MergeIterator::Prev:BeforePrev", &child);
           considerStatus(child.status());
-          if (child.Valid() && comparator_->Equal(target, child.key())) {
+          if (child.Valid() && compare_.Equal(target, child.key())) {
             child.Prev();
             considerStatus(child.status());
           }
@@ -287,10 +335,16 @@ class MergingIterator : public InternalIterator {
   // Ensures that maxHeap_ is initialized when starting to go in the reverse
   // direction
   void InitMaxHeap();
+  // Whether a child older than the tombstone has covered entries to skip
+  bool CanSkipCovered(const Slice& tombstone_end,
+                      SequenceNumber tombstone_seq) const;
 
   bool is_arena_mode_;
   const InternalKeyComparator* comparator_;
+  KeyCompare compare_;
   autovector<IteratorWrapper, kNumIterReserve> children_;
+  // Upper bound of the sequence numbers of each child
+  autovector<SequenceNumber, kNumIterReserve> children_max_seqno_;
 
   // Cached pointer to child iterator with the current key, or nullptr if no
   // child iterators are valid.  This is the top of minHeap_ or maxHeap_
@@ -322,7 +376,8 @@ class MergingIterator : public InternalIterator {
   }
 };
 
-void MergingIterator::SwitchToForward() {
+template <class KeyCompare>
+void MergingIteratorImpl<KeyCompare>::SwitchToForward() {
   // Otherwise, advance the non-current children.  We advance current_
   // just after the if-block.
   ClearHeaps();
@@ -331,7 +386,7 @@ void MergingIterator::SwitchToForward() {
     if (&child != current_) {
       child.Seek(target);
       considerStatus(child.status());
-      if (child.Valid() && comparator_->Equal(target, child.key())) {
+      if (child.Valid() && compare_.Equal(target, child.key())) {
         child.Next();
         considerStatus(child.status());
       }
@@ -343,19 +398,232 @@ void MergingIterator::SwitchToForward() {
   direction_ = kForward;
 }
 
-void MergingIterator::ClearHeaps() {
+template <class KeyCompare>
+void MergingIteratorImpl<KeyCompare>::ClearHeaps() {
   minHeap_.clear();
   if (maxHeap_) {
     maxHeap_->clear();
   }
 }
 
-void MergingIterator::InitMaxHeap() {
+template <class KeyCompare>
+void MergingIteratorImpl<KeyCompare>::InitMaxHeap() {
   if (!maxHeap_) {
     maxHeap_.reset(new MergerMaxIterHeap(comparator_));
   }
 }
 
+template <class KeyCompare>
+bool MergingIteratorImpl<KeyCompare>::CanSkipCovered(
+    const Slice& tombstone_end, SequenceNumber tombstone_seq) const {
+  for (size_t i = 0; i < children_.size(); ++i) {
+    if (children_max_seqno_[i] < tombstone_seq && children_[i].Valid() &&
+        compare_.Compare(children_[i].key(), tombstone_end) < 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Forward only merging iterator for compaction inputs. The children are the
+// leaves of a tree of losers, where every internal node keeps the child that
+// lost the match played there and the root the overall winner. Next() only
+// replays the matches on the path from the winner's leaf to the root, one
+// comparison per level, while a binary heap takes up to two per level.
+//
+// With BytewiseComparator, every child caches the encoded 8 byte prefix of
+// its user key, so that most matches are decided by comparing two integers,
+// and full keys are compared without virtual calls.
+class LoserTreeMergingIterator : public InternalIterator {
+ public:
+  LoserTreeMergingIterator(const InternalKeyComparator* comparator,
+                           InternalIterator** children, int n,
+                           bool is_arena_mode)
+      : is_arena_mode_(is_arena_mode),
+        comparator_(comparator),
+        bytewise_(comparator->user_comparator() == BytewiseComparator()),
+        children_(n),
+        losers_(n),
+        winner_(0) {
+    assert(n > 0);
+    for (int i = 0; i < n; ++i) {
+      children_[i].iter.Set(children[i]);
+      UpdateChild(i);
+    }
+    Rebuild();
+  }
+
+  ~LoserTreeMergingIterator() override {
+    for (auto& child : children_) {
+      child.iter.DeleteIter(is_arena_mode_);
+    }
+  }
+
+  bool Valid() const override {
+    return children_[winner_].iter.Valid() && status_.ok();
+  }
+
+  Status status() const override { return status_; }
+
+  void SeekToFirst() override {
+    status_ = Status::OK();
+    for (size_t i = 0; i < children_.size(); ++i) {
+      children_[i].iter.SeekToFirst();
+      UpdateChild(i);
+    }
+    Rebuild();
+  }
+
+  void Seek(const Slice& target) override {
+    status_ = Status::OK();
+    for (size_t i = 0; i < children_.size(); ++i) {
+      {
+        PERF_TIMER_GUARD(seek_child_seek_time);
+        children_[i].iter.Seek(target);
+      }
+      PERF_COUNTER_ADD(seek_child_seek_count, 1);
+      UpdateChild(i);
+    }
+    Rebuild();
+  }
+
+  void Next() override {
+    assert(Valid());
+    children_[winner_].iter.Next();
+    UpdateChild(winner_);
+    Replay(winner_);
+  }
+
+  void SeekToLast() override { SetNotSupported(); }
+  void SeekForPrev(const Slice& /*target*/) override { SetNotSupported(); }
+  void Prev() override { SetNotSupported(); }
+
+  Slice key() const override {
+    assert(Valid());
+    return children_[winner_].iter.key();
+  }
+
+  LazyBuffer value() const override {
+    assert(Valid());
+    return children_[winner_].iter.value();
+  }
+
+ private:
+  struct Child {
+    IteratorWrapper iter;
+    // Encoded prefix of the user key if bytewise_ and iter is valid
+    int64_t prefix = 0;
+  };
+
+  void UpdateChild(size_t i) {
+    auto& child = children_[i];
+    if (child.iter.Valid()) {
+      if (bytewise_) {
+        child.prefix =
+            EncodeDataBlockKeyPrefix(ExtractUserKey(child.iter.key()));
+      }
+    } else if (!child.iter.status().ok() && status_.ok()) {
+      status_ = child.iter.status();
+    }
+  }
+
+  // Whether child a goes before child b, invalid children go last
+  bool Less(size_t a, size_t b) const {
+    auto& ca = children_[a];
+    auto& cb = children_[b];
+    if (!ca.iter.Valid() || !cb.iter.Valid()) {
+      return ca.iter.Valid() || (!cb.iter.Valid() && a < b);
+    }
+    int c;
+    if (bytewise_) {
+      if (ca.prefix != cb.prefix) {
+        return ca.prefix < cb.prefix;
+      }
+      c = BytewiseInternalKeyCompare<false>(comparator_)
+              .Compare(ca.iter.key(), cb.iter.key());
+    } else {
+      c = comparator_->Compare(ca.iter.key(), cb.iter.key());
+    }
+    return c < 0 || (c == 0 && a < b);
+  }
+
+  // Play all the matches, node p < n has the children 2p and 2p + 1, where
+  // nodes from n on are the leaves
+  void Rebuild() { winner_ = children_.size() > 1 ? Play(1) : 0; }
+
+  size_t Play(size_t node) {
+    size_t n = children_.size();
+    if (node >= n) {
+      return node - n;
+    }
+    size_t left = Play(2 * node);
+    size_t right = Play(2 * node + 1);
+    if (Less(left, right)) {
+      losers_[node] = right;
+      return left;
+    }
+    losers_[node] = left;
+    return right;
+  }
+
+  // Replay the matches of child i up to the root after its key changed
+  void Replay(size_t i) {
+    size_t winner = i;
+    for (size_t node = (i + children_.size()) / 2; node > 0; node /= 2) {
+      if (Less(losers_[node], winner)) {
+        std::swap(losers_[node], winner);
+      }
+    }
+    winner_ = winner;
+  }
+
+  void SetNotSupported() {
+    status_ = Status::NotSupported("LoserTreeMergingIterator is forward only");
+  }
+
+  bool is_arena_mode_;
+  const InternalKeyComparator* comparator_;
+  const bool bytewise_;
+  std::vector<Child> children_;
+  // losers_[p] is the loser at internal node p, losers_[0] is unused
+  std::vector<size_t> losers_;
+  size_t winner_;
+  Status status_;
+};
+
+namespace {
+
+template <class KeyCompare>
+MergingIterator* NewMergingIteratorImpl(const InternalKeyComparator* cmp,
+                                        InternalIterator** list, int n,
+                                        Arena* arena, bool prefix_seek_mode) {
+  typedef MergingIteratorImpl<KeyCompare> IterType;
+  if (arena == nullptr) {
+    return new IterType(cmp, list, n, false, prefix_seek_mode);
+  }
+  auto mem = arena->AllocateAligned(sizeof(IterType));
+  return new (mem) IterType(cmp, list, n, true, prefix_seek_mode);
+}
+
+// The instantiation for the user comparator of cmp
+MergingIterator* NewMergingIteratorOf(const InternalKeyComparator* cmp,
+                                      InternalIterator** list, int n,
+                                      Arena* arena, bool prefix_seek_mode) {
+  switch (GetBytewiseKind(cmp->user_comparator())) {
+    case BytewiseKind::kForward:
+      return NewMergingIteratorImpl<BytewiseInternalKeyCompare<false>>(
+          cmp, list, n, arena, prefix_seek_mode);
+    case BytewiseKind::kReverse:
+      return NewMergingIteratorImpl<BytewiseInternalKeyCompare<true>>(
+          cmp, list, n, arena, prefix_seek_mode);
+    default:
+      return NewMergingIteratorImpl<InternalKeyCompare>(cmp, list, n, arena,
+                                                        prefix_seek_mode);
+  }
+}
+
+}  // namespace
+
 InternalIterator* NewMergingIterator(const InternalKeyComparator* cmp,
                                      InternalIterator** list, int n,
                                      Arena* arena, bool prefix_seek_mode) {
@@ -365,21 +633,34 @@ InternalIterator* NewMergingIterator(const InternalKeyComparator* cmp,
   } else if (n == 1) {
     return list[0];
   } else {
-    if (arena == nullptr) {
-      return new MergingIterator(cmp, list, n, false, prefix_seek_mode);
-    } else {
-      auto mem = arena->AllocateAligned(sizeof(MergingIterator));
-      return new (mem) MergingIterator(cmp, list, n, true, prefix_seek_mode);
-    }
+    return NewMergingIteratorOf(cmp, list, n, arena, prefix_seek_mode);
+  }
+}
+
+InternalIterator* NewLoserTreeMergingIterator(const InternalKeyComparator* cmp,
+                                              InternalIterator** list, int n,
+                                              Arena* arena) {
+  assert(n >= 0);
+  if (n == 0) {
+    return NewEmptyInternalIterator<LazyBuffer>(arena);
+  } else if (n == 1) {
+    return list[0];
+  } else if (arena == nullptr) {
+    return new LoserTreeMergingIterator(cmp, list, n, false);
+  } else {
+    auto mem = arena->AllocateAligned(sizeof(LoserTreeMergingIterator));
+    return new (mem) LoserTreeMergingIterator(cmp, list, n, true);
   }
 }
 
 MergeIteratorBuilder::MergeIteratorBuilder(
     const InternalKeyComparator* comparator, Arena* a, bool prefix_seek_mode)
-    : first_iter(nullptr), use_merging_iter(false), arena(a) {
-  auto mem = arena->AllocateAligned(sizeof(MergingIterator));
+    : first_iter(nullptr),
+      first_iter_max_seqno(kMaxSequenceNumber),
+      use_merging_iter(false),
+      arena(a) {
   merge_iter =
-      new (mem) MergingIterator(comparator, nullptr, 0, true, prefix_seek_mode);
+      NewMergingIteratorOf(comparator, nullptr, 0, arena, prefix_seek_mode);
 }
 
 MergeIteratorBuilder::~MergeIteratorBuilder() {
@@ -391,16 +672,18 @@ MergeIteratorBuilder::~MergeIteratorBuilder() {
   }
 }
 
-void MergeIteratorBuilder::AddIterator(InternalIterator* iter) {
+void MergeIteratorBuilder::AddIterator(InternalIterator* iter,
+                                       SequenceNumber max_seqno) {
   if (!use_merging_iter && first_iter != nullptr) {
-    merge_iter->AddIterator(first_iter);
+    merge_iter->AddIterator(first_iter, first_iter_max_seqno);
     use_merging_iter = true;
     first_iter = nullptr;
   }
   if (use_merging_iter) {
-    merge_iter->AddIterator(iter);
+    merge_iter->AddIterator(iter, max_seqno);
   } else {
     first_iter = iter;
+    first_iter_max_seqno = max_seqno;
   }
 }
 
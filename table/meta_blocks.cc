@@ -340,6 +340,7 @@ Status ReadProperties(const Slice& handle_value, RandomAccessFileReader* file,
       if (key == TablePropertiesNames::kDeletedKeys ||
           key == TablePropertiesNames::kMergeOperands ||
           key == TablePropertiesNames::kLatestTimeEndCompact ||
+          key == TablePropertiesNames::kLatestTimeExpire ||
           key == TablePropertiesNames::kEarliestTimeBeginCompact) {
         // Insert in user-collected properties for API backwards compatibility
         new_table_properties->user_collected_properties.insert(
@@ -0,0 +1,258 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "table/mmap_table_loader.h"
+
+#ifndef OS_WIN
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef NUMA
+#include <numa.h>
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "monitoring/statistics.h"
+#include "rocksdb/env.h"
+#include "rocksdb/statistics.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/logging.h"
+#include "util/mutexlock.h"
+#include "util/sync_point.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+// The pre-touch checks for a stop after each chunk
+const size_t kPretouchChunkSize = 4 << 20;
+
+size_t PageSize() {
+#ifndef OS_WIN
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return page_size;
+#else
+  return 4096;
+#endif
+}
+
+// The pages spanning [data, data + size)
+void PageRange(const char* data, size_t size, char** begin, size_t* length) {
+  uintptr_t page_mask = ~static_cast<uintptr_t>(PageSize() - 1);
+  uintptr_t b = reinterpret_cast<uintptr_t>(data) & page_mask;
+  uintptr_t e = (reinterpret_cast<uintptr_t>(data) + size + PageSize() - 1) &
+                page_mask;
+  *begin = reinterpret_cast<char*>(b);
+  *length = e - b;
+}
+
+void InterleaveOverNumaNodes(char* data, size_t size) {
+#ifdef NUMA
+  if (numa_available() != -1) {
+    numa_interleave_memory(data, size, numa_all_nodes_ptr);
+  }
+#else
+  (void)data;
+  (void)size;
+#endif
+}
+
+// The bytes of [data, data + size) resident in memory
+uint64_t ResidentBytes(char* data, size_t size) {
+#ifdef OS_LINUX
+  size_t page_size = PageSize();
+  std::vector<unsigned char> pages((size + page_size - 1) / page_size);
+  if (mincore(data, size, pages.data()) != 0) {
+    return 0;
+  }
+  uint64_t resident = 0;
+  for (unsigned char page : pages) {
+    resident += page & 1;
+  }
+  return std::min<uint64_t>(resident * page_size, size);
+#else
+  (void)data;
+  (void)size;
+  return 0;
+#endif
+}
+
+}  // namespace
+
+void AppendMmapLoadOptions(const MmapLoadOptions& options, std::string* ret) {
+  const int kBufferSize = 200;
+  char buffer[kBufferSize];
+  snprintf(buffer, kBufferSize, "  mmap_load.pretouch: %d\n", options.pretouch);
+  ret->append(buffer);
+  snprintf(buffer, kBufferSize, "  mmap_load.transparent_huge_pages: %d\n",
+           options.transparent_huge_pages);
+  ret->append(buffer);
+  snprintf(buffer, kBufferSize,
+           "  mmap_load.huge_page_size: %" ROCKSDB_PRIszt "\n",
+           options.huge_page_size);
+  ret->append(buffer);
+  snprintf(buffer, kBufferSize, "  mmap_load.numa_interleave: %d\n",
+           options.numa_interleave);
+  ret->append(buffer);
+}
+
+bool MmapTableLoader::IsNeeded(const MmapLoadOptions& options) {
+  return options.pretouch || options.transparent_huge_pages ||
+         options.huge_page_size > 0 || options.numa_interleave;
+}
+
+MmapTableLoader::MmapTableLoader(const MmapLoadOptions& options, Env* env,
+                                 Statistics* statistics, Logger* info_log)
+    : options_(options),
+      env_(env),
+      statistics_(statistics),
+      info_log_(info_log),
+      cv_(&mutex_) {}
+
+MmapTableLoader::~MmapTableLoader() {
+  if (options_.pretouch) {
+    stop_pretouch_.store(true, std::memory_order_release);
+    // Not under mutex_, the thread pool calls UnschedulePretouchCallback
+    // while holding its own lock
+    env_->UnSchedule(this, Env::Priority::LOW);
+    MutexLock l(&mutex_);
+    while (pretouch_scheduled_) {
+      cv_.Wait();
+    }
+  }
+#ifdef MAP_HUGETLB
+  if (huge_page_copy_ != nullptr) {
+    munmap(huge_page_copy_, huge_page_copy_size_);
+  }
+#endif
+}
+
+Slice MmapTableLoader::Load(const Slice& file_data) {
+  data_ = file_data;
+  if (file_data.empty()) {
+    return data_;
+  }
+  if (options_.huge_page_size > 0 && CopyToHugePages(file_data)) {
+    data_ = Slice(huge_page_copy_, file_data.size());
+    RecordTick(statistics_, TABLE_MMAP_HUGE_PAGE_BYTES, file_data.size());
+    return data_;
+  }
+
+  char* pages;
+  size_t length;
+  PageRange(file_data.data(), file_data.size(), &pages, &length);
+#if defined(MADV_HUGEPAGE)
+  if (options_.transparent_huge_pages &&
+      madvise(pages, length, MADV_HUGEPAGE) != 0) {
+    ROCKS_LOG_WARN(info_log_, "madvise(MADV_HUGEPAGE) failed: %s",
+                   strerror(errno));
+  }
+#endif
+  if (options_.numa_interleave) {
+    InterleaveOverNumaNodes(pages, length);
+  }
+  if (options_.pretouch) {
+    RecordTick(statistics_, TABLE_MMAP_RESIDENT_BYTES_AT_OPEN,
+               ResidentBytes(pages, length));
+    {
+      MutexLock l(&mutex_);
+      pretouch_scheduled_ = true;
+    }
+    env_->Schedule(&MmapTableLoader::BGWorkPretouch, this, Env::Priority::LOW,
+                   this, &MmapTableLoader::UnschedulePretouchCallback);
+  }
+  return data_;
+}
+
+bool MmapTableLoader::CopyToHugePages(const Slice& file_data) {
+#ifdef MAP_HUGETLB
+  size_t huge_page_size = options_.huge_page_size;
+  size_t size =
+      (file_data.size() + huge_page_size - 1) / huge_page_size * huge_page_size;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_POPULATE
+  if (!options_.numa_interleave) {
+    flags |= MAP_POPULATE;
+  }
+#endif
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (addr == MAP_FAILED) {
+    ROCKS_LOG_WARN(info_log_,
+                   "Failed to allocate %" ROCKSDB_PRIszt
+                   " bytes of huge pages, reading the file mapping: %s",
+                   size, strerror(errno));
+    return false;
+  }
+  huge_page_copy_ = reinterpret_cast<char*>(addr);
+  huge_page_copy_size_ = size;
+  if (options_.numa_interleave) {
+    // Before the pages are faulted in by the copy
+    InterleaveOverNumaNodes(huge_page_copy_, size);
+  }
+  memcpy(huge_page_copy_, file_data.data(), file_data.size());
+  return true;
+#else
+  (void)file_data;
+  return false;
+#endif
+}
+
+void MmapTableLoader::BGWorkPretouch(void* arg) {
+  auto loader = reinterpret_cast<MmapTableLoader*>(arg);
+  TEST_SYNC_POINT("MmapTableLoader::BGWorkPretouch:start");
+  loader->Pretouch();
+  loader->PretouchDone();
+}
+
+void MmapTableLoader::UnschedulePretouchCallback(void* arg) {
+  reinterpret_cast<MmapTableLoader*>(arg)->PretouchDone();
+}
+
+void MmapTableLoader::Pretouch() {
+  char* pages;
+  size_t length;
+  PageRange(data_.data(), data_.size(), &pages, &length);
+  size_t page_size = PageSize();
+  uint64_t touched = 0;
+#ifdef MADV_POPULATE_READ
+  bool populate = true;
+#endif
+  for (size_t offset = 0; offset < length; offset += kPretouchChunkSize) {
+    if (stop_pretouch_.load(std::memory_order_acquire)) {
+      break;
+    }
+    size_t chunk = std::min(kPretouchChunkSize, length - offset);
+#ifdef MADV_POPULATE_READ
+    // Faults the pages in like MAP_POPULATE would have at mmap time. Kernels
+    // older than 5.14 don't know it.
+    if (populate && madvise(pages + offset, chunk, MADV_POPULATE_READ) == 0) {
+      touched += chunk;
+      continue;
+    }
+    populate = false;
+#endif
+    const volatile char* p = pages + offset;
+    for (size_t i = 0; i < chunk; i += page_size) {
+      (void)p[i];
+    }
+    touched += chunk;
+  }
+  RecordTick(statistics_, TABLE_MMAP_PRETOUCH_BYTES, touched);
+}
+
+void MmapTableLoader::PretouchDone() {
+  MutexLock l(&mutex_);
+  pretouch_scheduled_ = false;
+  cv_.SignalAll();
+}
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,69 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+#include <atomic>
+#include <string>
+
+#include "port/port.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/table.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class Env;
+class Logger;
+class Statistics;
+
+// Appends `options` to the printable options of a table factory
+extern void AppendMmapLoadOptions(const MmapLoadOptions& options,
+                                  std::string* ret);
+
+// Brings a table file read through mmap into memory as asked by
+// MmapLoadOptions. Owned by the table reader, and must be destroyed before
+// the file it loads.
+class MmapTableLoader {
+ public:
+  // Whether `options` ask for more than the default faulting in by reads
+  static bool IsNeeded(const MmapLoadOptions& options);
+
+  MmapTableLoader(const MmapLoadOptions& options, Env* env,
+                  Statistics* statistics, Logger* info_log);
+  // Stops the pre-touch of the file and waits for it
+  ~MmapTableLoader();
+
+  // `file_data` is the whole file, as read from its mapping. Returns where
+  // the file is to be read from afterwards, the mapping or its huge page copy.
+  Slice Load(const Slice& file_data);
+
+  MmapTableLoader(const MmapTableLoader&) = delete;
+  MmapTableLoader& operator=(const MmapTableLoader&) = delete;
+
+ private:
+  static void BGWorkPretouch(void* arg);
+  static void UnschedulePretouchCallback(void* arg);
+
+  bool CopyToHugePages(const Slice& file_data);
+  void Pretouch();
+  void PretouchDone();
+
+  const MmapLoadOptions options_;
+  Env* env_;
+  Statistics* statistics_;
+  Logger* info_log_;
+  Slice data_;
+  char* huge_page_copy_ = nullptr;
+  size_t huge_page_copy_size_ = 0;
+
+  std::atomic<bool> stop_pretouch_{false};
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  bool pretouch_scheduled_ = false;
+};
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -14,6 +14,7 @@
 #include "port/port.h"
 #include "rocksdb/convenience.h"
 #include "rocksdb/terark_namespace.h"
+#include "table/mmap_table_loader.h"
 #include "table/plain_table_builder.h"
 #include "table/plain_table_reader.h"
 #include "util/string_util.h"
@@ -31,7 +32,8 @@ Status PlainTableFactory::NewTableReader(
       table_reader_options.file_number, file_size, table,
       table_options_.bloom_bits_per_key, table_options_.hash_table_ratio,
       table_options_.index_sparseness, table_options_.huge_page_tlb_size,
-      table_options_.full_scan_mode, table_reader_options.prefix_extractor);
+      table_options_.full_scan_mode, table_reader_options.prefix_extractor,
+      table_options_.mmap_load);
 }
 
 TableBuilder* PlainTableFactory::NewTableBuilder(
@@ -79,6 +81,7 @@ std::string PlainTableFactory::GetPrintableTableOptions() const {
   snprintf(buffer, kBufferSize, "  store_index_in_file: %d\n",
            table_options_.store_index_in_file);
   ret.append(buffer);
+  AppendMmapLoadOptions(table_options_.mmap_load, &ret);
   return ret;
 }
 
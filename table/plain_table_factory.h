@@ -207,6 +207,18 @@ static std::unordered_map<std::string, OptionTypeInfo> plain_table_type_info = {
       OptionVerificationType::kNormal, false, 0}},
     {"store_index_in_file",
      {offsetof(struct PlainTableOptions, store_index_in_file),
+      OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+    {"mmap_pretouch",
+     {offsetof(struct PlainTableOptions, mmap_load.pretouch),
+      OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+    {"mmap_transparent_huge_pages",
+     {offsetof(struct PlainTableOptions, mmap_load.transparent_huge_pages),
+      OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+    {"mmap_huge_page_size",
+     {offsetof(struct PlainTableOptions, mmap_load.huge_page_size),
+      OptionType::kSizeT, OptionVerificationType::kNormal, false, 0}},
+    {"mmap_numa_interleave",
+     {offsetof(struct PlainTableOptions, mmap_load.numa_interleave),
       OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}}};
 
 }  // namespace TERARKDB_NAMESPACE
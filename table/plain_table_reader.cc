@@ -133,7 +133,8 @@ Status PlainTableReader::Open(const ImmutableCFOptions& ioptions,
                               const int bloom_bits_per_key,
                               double hash_table_ratio, size_t index_sparseness,
                               size_t huge_page_tlb_size, bool full_scan_mode,
-                              const SliceTransform* prefix_extractor) {
+                              const SliceTransform* prefix_extractor,
+                              const MmapLoadOptions& mmap_load) {
   if (file_size > PlainTableIndex::kMaxFileSize) {
     return Status::NotSupported("File is too large for PlainTableReader!");
   }
@@ -177,7 +178,7 @@ Status PlainTableReader::Open(const ImmutableCFOptions& ioptions,
       ioptions, std::move(file), env_options, internal_comparator,
       encoding_type, file_number, file_size, props, prefix_extractor));
 
-  s = new_reader->MmapDataIfNeeded();
+  s = new_reader->MmapDataIfNeeded(mmap_load);
   if (!s.ok()) {
     return s;
   }
@@ -285,11 +286,18 @@ void PlainTableReader::FillBloom(vector<uint32_t>* prefix_hashes) {
   }
 }
 
-Status PlainTableReader::MmapDataIfNeeded() {
+Status PlainTableReader::MmapDataIfNeeded(const MmapLoadOptions& mmap_load) {
   if (file_info_.is_mmap_mode) {
     // Get mmapped memory.
-    return file_info_.file->Read(0, static_cast<size_t>(file_size_),
-                                 &file_info_.file_data, nullptr);
+    Status s = file_info_.file->Read(0, static_cast<size_t>(file_size_),
+                                     &file_info_.file_data, nullptr);
+    if (s.ok() && MmapTableLoader::IsNeeded(mmap_load)) {
+      mmap_loader_.reset(new MmapTableLoader(mmap_load, ioptions_.env,
+                                             ioptions_.statistics,
+                                             ioptions_.info_log));
+      file_info_.file_data = mmap_loader_->Load(file_info_.file_data);
+    }
+    return s;
   }
   return Status::OK();
 }
@@ -19,6 +19,7 @@
 #include "rocksdb/table.h"
 #include "rocksdb/table_properties.h"
 #include "rocksdb/terark_namespace.h"
+#include "table/mmap_table_loader.h"
 #include "table/plain_table_factory.h"
 #include "table/plain_table_index.h"
 #include "table/table_reader.h"
@@ -79,7 +80,8 @@ class PlainTableReader : public TableReader {
                      const int bloom_bits_per_key, double hash_table_ratio,
                      size_t index_sparseness, size_t huge_page_tlb_size,
                      bool full_scan_mode,
-                     const SliceTransform* prefix_extractor = nullptr);
+                     const SliceTransform* prefix_extractor = nullptr,
+                     const MmapLoadOptions& mmap_load = MmapLoadOptions());
 
   InternalIterator* NewIterator(const ReadOptions&,
                                 const SliceTransform* prefix_extractor,
@@ -138,7 +140,7 @@ class PlainTableReader : public TableReader {
                        double hash_table_ratio, size_t index_sparseness,
                        size_t huge_page_tlb_size);
 
-  Status MmapDataIfNeeded();
+  Status MmapDataIfNeeded(const MmapLoadOptions& mmap_load = MmapLoadOptions());
 
  private:
   const InternalKeyComparator internal_comparator_;
@@ -161,6 +163,8 @@ class PlainTableReader : public TableReader {
   bool enable_bloom_;
   DynamicBloom bloom_;
   PlainTableReaderFileInfo file_info_;
+  // Destroyed before the file it loads
+  std::unique_ptr<MmapTableLoader> mmap_loader_;
   Arena arena_;
   CacheAllocationPtr index_block_alloc_;
   CacheAllocationPtr bloom_block_alloc_;
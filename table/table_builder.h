@@ -74,6 +74,13 @@ struct TableReaderOptions {
   uint64_t file_number;
   // largest seqno in the table
   SequenceNumber largest_seqno;
+  // Known size of the table tail holding footer, metaindex, properties,
+  // index and filter, 0 if unknown. Only used by BlockBasedTable (reader)
+  size_t tail_size_hint = 0;
+  // The file is not among the hottest files of its column family by sampled
+  // reads, see prefetch_index_and_filter_hot_file_ratio. Formats skip
+  // prefetching or warming up its index and filter at open beyond level 0
+  bool cold = false;
 };
 
 struct TableBuilderOptions {
@@ -127,6 +134,8 @@ struct TableBuilderOptions {
   // specifically, BlockBasedTableBuilder in our senario). The table builder
   // uses this field to update the zone occupacy status.
   Env* env;
+  // Set for the blob SSTs of KV separation
+  bool for_blob = false;
 
   void PushIntTblPropCollectors(
       std::vector<std::unique_ptr<IntTblPropCollector>>* collectors,
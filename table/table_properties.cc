@@ -235,6 +235,8 @@ const std::string TablePropertiesNames::kEarliestTimeBeginCompact =
     "rocksdb.compact.earliest-time-begin";
 const std::string TablePropertiesNames::kLatestTimeEndCompact =
     "rocksdb.compact.latest-time-end";
+const std::string TablePropertiesNames::kLatestTimeExpire =
+    "rocksdb.compact.latest-time-expire";
 
 extern const std::string kPropertiesBlock = "rocksdb.properties";
 // Old property block name for backward compatibility
@@ -9,6 +9,8 @@
 
 #pragma once
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "db/range_tombstone_fragmenter.h"
 #include "rocksdb/cache.h"
@@ -92,6 +94,16 @@ class TableReader {
                      const SliceTransform* prefix_extractor,
                      bool skip_filters = false) = 0;
 
+  // Get() for keys[0, num), key i feeds get_contexts[i] and its result is
+  // stored in statuses[i]. Formats that can share work between the lookups,
+  // such as walking one index for all keys before reading any record,
+  // override it, the default calls Get() once per key.
+  virtual void MultiGet(const ReadOptions& readOptions, size_t num,
+                        const Slice* keys, GetContext** get_contexts,
+                        Status* statuses,
+                        const SliceTransform* prefix_extractor,
+                        bool skip_filters = false);
+
   // Logic same as for(it->Seek(begin); it->Valid() && callback(*it); ++it) {}
   // Specialization for performance
   virtual void RangeScan(const Slice* begin,
@@ -111,6 +123,29 @@ class TableReader {
     return Status::OK();
   }
 
+  // Start reading the first `n` bytes of data of the table in background,
+  // ahead of a scan from its first key. Default implementation is NOOP.
+  virtual void PrefetchAsync(size_t /*n*/) {}
+
+  // Append the internal keys locating at most `limit` blocks which the
+  // sampled reads of this table touched most, hottest first. Formats without
+  // read sampling append nothing.
+  virtual void GetHotBlockKeys(size_t /*limit*/,
+                               std::vector<std::string>* /*keys*/) const {}
+
+  // Append at most `limit` internal keys of this table in key order, about
+  // the same number of records apart, for cutting its key range into pieces
+  // of alike work. Formats without a cheap index walk append nothing.
+  virtual void GetSampleKeys(size_t /*limit*/,
+                             std::vector<std::string>* /*keys*/) {}
+
+  // Load the blocks holding the given internal keys into the block cache, as
+  // reported by GetHotBlockKeys() of this or another table. Keys beyond the
+  // last block are skipped.
+  virtual Status WarmUpBlocks(const std::vector<std::string>& /*keys*/) {
+    return Status::NotSupported();
+  }
+
   // convert db file to a human readable form
   virtual Status DumpTable(WritableFile* /*out_file*/,
                            const SliceTransform* /*prefix_extractor*/) {
@@ -1811,6 +1811,46 @@ TEST_P(BlockBasedTableTest, NumBlockStat) {
   c.ResetTableReader();
 }
 
+TEST_P(BlockBasedTableTest, ParallelCompression) {
+  if (!Snappy_Supported()) {
+    return;
+  }
+  Random rnd(test::RandomSeed());
+  TableConstructor c(BytewiseComparator(), true /* convert_to_internal_key_ */);
+  Options options;
+  options.compression = kSnappyCompression;
+  BlockBasedTableOptions table_options = GetBlockBasedTableOptions();
+  table_options.block_size = 1000;
+  table_options.parallel_compression_threads = 4;
+  table_options.filter_policy.reset(NewBloomFilterPolicy(10, false));
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+
+  for (int i = 0; i < 1000; ++i) {
+    c.Add(RandomString(&rnd, 20), std::string(100, 'a' + i % 26));
+  }
+
+  std::vector<std::string> ks;
+  stl_wrappers::KVMap kvmap;
+  const ImmutableCFOptions ioptions(options);
+  const MutableCFOptions moptions(options);
+  c.Finish(options, ioptions, moptions, table_options,
+           GetPlainInternalComparator(options.comparator), &ks, &kvmap);
+  ASSERT_GT(c.GetTableReader()->GetTableProperties()->num_data_blocks, 1U);
+
+  std::unique_ptr<InternalIterator> iter(
+      c.NewIterator(moptions.prefix_extractor.get()));
+  iter->SeekToFirst();
+  for (auto& kv : kvmap) {
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(kv.first, iter->key().ToString());
+    ASSERT_EQ(kv.second, iter->value().ToString());
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->Valid());
+  ASSERT_OK(iter->status());
+  c.ResetTableReader();
+}
+
 // A simple tool that takes the snapshot of block cache statistics.
 class BlockCachePropertiesSnapshot {
  public:
@@ -2359,6 +2399,48 @@ TEST_P(BlockBasedTableTest, NoObjectInCacheAfterTableClose) {
   }  // level
 }
 
+TEST_P(BlockBasedTableTest, PinIndexAndFilterPerLevel) {
+  // <level, pinned usage after open>
+  std::map<int, size_t> pinned_usage;
+  for (int level : {1, 2, 3}) {
+    Options opt;
+    opt.compression = kNoCompression;
+    BlockBasedTableOptions table_options = GetBlockBasedTableOptions();
+    table_options.block_size = 256;
+    table_options.metadata_block_size = 128;
+    table_options.index_type =
+        BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
+    table_options.cache_index_and_filter_blocks = true;
+    table_options.pin_top_level_index_and_filter = true;
+    table_options.pin_top_level_index_and_filter_max_level = 2;
+    table_options.pin_index_and_filter_partitions_max_level = 1;
+    table_options.block_cache = NewLRUCache(16 * 1024 * 1024, 4);
+    opt.table_factory.reset(NewBlockBasedTableFactory(table_options));
+
+    TableConstructor c(BytewiseComparator(),
+                       true /* convert_to_internal_key_ */, level);
+    for (int i = 0; i < 1000; ++i) {
+      char key[16];
+      snprintf(key, sizeof(key), "k%08d", i);
+      c.Add(key, "val");
+    }
+    std::vector<std::string> keys;
+    stl_wrappers::KVMap kvmap;
+    const ImmutableCFOptions ioptions(opt);
+    const MutableCFOptions moptions(opt);
+    c.Finish(opt, ioptions, moptions, table_options,
+             GetPlainInternalComparator(opt.comparator), &keys, &kvmap);
+    pinned_usage[level] = table_options.block_cache->GetPinnedUsage();
+    c.ResetTableReader();
+    ASSERT_EQ(0, table_options.block_cache->GetPinnedUsage());
+  }
+  // Level 1 pins all partitions, level 2 the top-level index only and level 3
+  // nothing
+  ASSERT_GT(pinned_usage[1], pinned_usage[2]);
+  ASSERT_GT(pinned_usage[2], 0);
+  ASSERT_EQ(0, pinned_usage[3]);
+}
+
 TEST_P(BlockBasedTableTest, BlockCacheLeak) {
   // Check that when we reopen a table we don't lose access to blocks already
   // in the cache. This test checks whether the Table actually makes use of the
@@ -2655,6 +2737,42 @@ TEST_F(GeneralTableTest, ApproximateOffsetOfPlain) {
   c.ResetTableReader();
 }
 
+TEST_F(GeneralTableTest, SampleKeys) {
+  TableConstructor c(BytewiseComparator(), true /* convert_to_internal_key_ */);
+  char buf[16];
+  for (int i = 0; i < 1000; ++i) {
+    snprintf(buf, sizeof(buf), "k%04d", i);
+    c.Add(buf, std::string(100, 'x'));
+  }
+  std::vector<std::string> keys;
+  stl_wrappers::KVMap kvmap;
+  Options options;
+  test::PlainInternalKeyComparator internal_comparator(options.comparator);
+  options.compression = kNoCompression;
+  BlockBasedTableOptions table_options;
+  table_options.block_size = 1024;
+  const ImmutableCFOptions ioptions(options);
+  const MutableCFOptions moptions(options);
+  c.Finish(options, ioptions, moptions, table_options, internal_comparator,
+           &keys, &kvmap);
+
+  std::vector<std::string> samples;
+  c.GetTableReader()->GetSampleKeys(10, &samples);
+  ASSERT_EQ(10U, samples.size());
+  for (size_t i = 1; i < samples.size(); ++i) {
+    ASSERT_LT(internal_comparator.Compare(samples[i - 1], samples[i]), 0);
+  }
+  // About the same bytes apart
+  uint64_t table_size = c.ApproximateOffsetOf("xyz");
+  uint64_t prev = 0;
+  for (auto& sample : samples) {
+    uint64_t offset = c.GetTableReader()->ApproximateOffsetOf(sample);
+    ASSERT_TRUE(Between(offset - prev, table_size / 20, table_size / 5));
+    prev = offset;
+  }
+  c.ResetTableReader();
+}
+
 static void DoCompressionTest(CompressionType comp) {
   Random rnd(301);
   TableConstructor c(BytewiseComparator(), true /* convert_to_internal_key_ */);
@@ -297,6 +297,9 @@ bool TerarkZipCFOptionsFromEnv(ColumnFamilyOptions& cfo,
   if (const char* env = getenv("TerarkZipTable_indexType")) {
     tzo.indexType = env;
   }
+  if (const char* env = getenv("TerarkZipTable_upperLevelIndexType")) {
+    tzo.upperLevelIndexType = env;
+  }
 
   MyOverrideInt(tzo, checksumLevel);
   MyOverrideInt(tzo, checksumSmallValSize);
@@ -326,14 +329,20 @@ bool TerarkZipCFOptionsFromEnv(ColumnFamilyOptions& cfo,
   MyOverrideBool(tzo, useSuffixArrayLocalMatch);
   MyOverrideBool(tzo, warmUpIndexOnOpen);
   MyOverrideBool(tzo, warmUpValueOnOpen);
+  MyOverrideBool(tzo, warmUpIndexInBackground);
   MyOverrideBool(tzo, disableSecondPassIter);
   MyOverrideBool(tzo, enableCompressionProbe);
   MyOverrideBool(tzo, disableCompressDict);
   MyOverrideBool(tzo, optimizeCpuL3Cache);
   MyOverrideBool(tzo, forceMetaInMemory);
+  MyOverrideBool(tzo, memoryTempFiles);
   MyOverrideBool(tzo, enableEntropyStore);
 
   MyOverrideDouble(tzo, sampleRatio);
+  MyOverrideInt(tzo, upperLevelMax);
+  MyOverrideDouble(tzo, upperLevelSampleRatio);
+  MyOverrideXiB(tzo, dictReuseCacheBytes);
+  MyOverrideDouble(tzo, dictReuseMaxDistance);
   MyOverrideDouble(tzo, indexCacheRatio);
   MyOverrideDouble(tzo, cbtMinKeyRatio);
 
@@ -350,6 +359,9 @@ bool TerarkZipCFOptionsFromEnv(ColumnFamilyOptions& cfo,
   MyOverrideInt(tzo, cbtEntryPerTrie);
   MyOverrideInt(tzo, cbtMinKeySize);
   MyOverrideInt(tzo, cacheShards);
+  MyOverrideInt(tzo, maxParallelStoreBuild);
+  MyOverrideInt(tzo, minPinValueSize);
+  MyOverrideInt(tzo, warmUpIndexMaxLevel);
 
   tzo.singleIndexMinSize = std::max<size_t>(tzo.singleIndexMinSize, 1ull << 20);
   tzo.singleIndexMaxSize =
@@ -7,9 +7,13 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <boost/intrusive_ptr.hpp>
 #include <boost/noncopyable.hpp>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <terark/fstring.hpp>
 #include <terark/stdtypes.hpp>
@@ -18,6 +22,7 @@
 #include <terark/zbs/lru_page_cache.hpp>
 
 #include "options/options_helper.h"
+#include "rocksdb/cache.h"
 #include "rocksdb/convenience.h"
 #include "rocksdb/env.h"
 #include "rocksdb/slice.h"
@@ -47,6 +52,8 @@ extern const std::string kTerarkZipTableBuildTimestamp;
 extern const std::string kTerarkZipTableDictInfo;
 extern const std::string kTerarkZipTableDictSize;
 extern const std::string kTerarkZipTableEntropy;
+extern const std::string kTerarkZipTableIndexType;
+extern const std::string kTerarkZipTableSampleRatio;
 
 template <class ByteArray>
 inline Slice SliceOf(const ByteArray& ba) {
@@ -75,6 +82,9 @@ inline bool IsBackwardBytewiseComparator(const Comparator* cmp) {
 
 bool IsBytewiseComparator(const Comparator* cmp);
 
+// The dir the builders put their temp files in, see memoryTempFiles
+const std::string& TerarkZipTempDir(const TerarkZipTableOptions& tzto);
+
 struct CollectInfo {
   static const size_t queue_size;
 
@@ -95,6 +105,64 @@ struct CollectInfo {
   float estimate() const;
 };
 
+// The last dictionary built per column family and level, for the builders of
+// the next tables of alike values to reuse, see dictReuseCacheBytes
+struct DictReuseCache {
+  // byte histogram of the value samples
+  typedef std::array<uint64_t, 256> Hist;
+
+  struct Dict {
+    std::string memory;
+    Hist hist;
+  };
+  typedef std::pair<uint32_t, int> Key;  // column family id, level
+
+  std::map<Key, std::shared_ptr<const Dict>> dicts;
+  size_t sum_bytes = 0;
+  std::mutex mutex;
+
+  // The dict of `key` if the L1 distance of the normalized histograms,
+  // between 0 and 2, is at most `max_distance`
+  std::shared_ptr<const Dict> find(const Key& key, const Hist& hist,
+                                   double max_distance);
+  // Replace the dict of `key`, evicting the others beyond `capacity` bytes
+  void insert(const Key& key, fstring memory, const Hist& hist,
+              size_t capacity);
+};
+
+// The index warm-ups of the readers opened with warmUpIndexInBackground,
+// touched by one job at a time on the LOW pool of the Env, the files of the
+// lowest levels and the hot ones first
+class IndexWarmUpQueue : boost::noncopyable {
+ public:
+  struct Task {
+    int level;
+    bool cold;
+    uint64_t file_number;
+    valvec<fstring> ranges;
+    RateLimiter* rate_limiter;
+    Statistics* statistics;
+    // held while touching the file, so the reader can't unmap it meanwhile
+    std::mutex mutex;
+    bool cancelled = false;
+  };
+
+  ~IndexWarmUpQueue();
+
+  void Add(std::shared_ptr<Task> task, Env* env);
+  // No byte of the file is touched once this returns
+  static void Cancel(Task* task);
+
+ private:
+  static void BGWork(void* arg);
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<std::shared_ptr<Task>> heap_;
+  bool scheduled_ = false;
+};
+
 enum class ZipValueType : unsigned char {
   kZeroSeq = 0,
   kDelete = 1,
@@ -191,6 +259,13 @@ class TerarkZipTableFactory : public TableFactory, boost::noncopyable {
     return fallback_factory_->IsBuilderNeedSecondPass();
   }
 
+  // Admits the builds of the big compactions while the builds running and
+  // waiting leave room for them under softZipWorkingMemLimit
+  bool AdmitBuild(int level, uint64_t build_bytes) const override;
+
+  bool GetBuildMemoryUsage(uint64_t* working,
+                           uint64_t* waiting) const override;
+
   LruReadonlyCache* cache() const { return cache_.get(); }
 
   Status GetOptionString(std::string* opt_string,
@@ -202,14 +277,22 @@ class TerarkZipTableFactory : public TableFactory, boost::noncopyable {
   TableFactory* adaptive_factory_;  // just for open table
   mutable std::mutex cache_create_mutex_;
   mutable boost::intrusive_ptr<LruReadonlyCache> cache_;
+  // the dummy entries charging cache_ to cacheChargedTo
+  mutable std::vector<Cache::Handle*> cache_charge_handles_;
   mutable size_t nth_new_terark_table_ = 0;
   mutable size_t nth_new_fallback_table_ = 0;
 
  private:
   mutable CollectInfo collect_;
+  mutable DictReuseCache dict_reuse_cache_;
+  mutable IndexWarmUpQueue index_warm_up_queue_;
 
  public:
   CollectInfo& GetCollect() const { return collect_; }
+  DictReuseCache& GetDictReuseCache() const { return dict_reuse_cache_; }
+  IndexWarmUpQueue& GetIndexWarmUpQueue() const {
+    return index_warm_up_queue_;
+  }
   static std::unordered_map<std::string, OptionTypeInfo>
       terark_zip_table_type_info;
 };
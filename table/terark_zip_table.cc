@@ -18,6 +18,7 @@
 
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
@@ -34,6 +35,7 @@
 #include "table/terark_zip_internal.h"
 #include "table/terark_zip_table_reader.h"
 #include "util/arena.h"  // for #include <sys/mman.h>
+#include "util/coding.h"
 
 static std::once_flag PrintVersionHashInfoFlag;
 
@@ -74,6 +76,8 @@ const std::string kTerarkZipTableBuildTimestamp = "terark.build.timestamp";
 const std::string kTerarkZipTableDictInfo = "terark.build.dict_info";
 const std::string kTerarkZipTableDictSize = "terark.build.dict_size";
 const std::string kTerarkZipTableEntropy = "terark.build.entropy";
+const std::string kTerarkZipTableIndexType = "terark.build.index_type";
+const std::string kTerarkZipTableSampleRatio = "terark.build.sample_ratio";
 
 const size_t CollectInfo::queue_size = 1024;
 
@@ -101,6 +105,58 @@ float CollectInfo::estimate() const {
   return ret ? ret : 1.0f;
 }
 
+std::shared_ptr<const DictReuseCache::Dict> DictReuseCache::find(
+    const Key& key, const Hist& hist, double max_distance) {
+  std::shared_ptr<const Dict> dict;
+  {
+    std::unique_lock<std::mutex> l(mutex);
+    auto iter = dicts.find(key);
+    if (iter == dicts.end()) {
+      return nullptr;
+    }
+    dict = iter->second;
+  }
+  uint64_t sum = 0, dict_sum = 0;
+  for (size_t i = 0; i < hist.size(); ++i) {
+    sum += hist[i];
+    dict_sum += dict->hist[i];
+  }
+  if (sum == 0 || dict_sum == 0) {
+    return nullptr;
+  }
+  double distance = 0;
+  for (size_t i = 0; i < hist.size(); ++i) {
+    distance +=
+        std::abs(double(hist[i]) / sum - double(dict->hist[i]) / dict_sum);
+  }
+  return distance <= max_distance ? dict : nullptr;
+}
+
+void DictReuseCache::insert(const Key& key, fstring memory, const Hist& hist,
+                            size_t capacity) {
+  if (memory.size() > capacity) {
+    return;
+  }
+  auto dict = std::make_shared<Dict>();
+  dict->memory.assign(memory.data(), memory.size());
+  dict->hist = hist;
+  std::unique_lock<std::mutex> l(mutex);
+  auto& slot = dicts[key];
+  if (slot) {
+    sum_bytes -= slot->memory.size();
+  }
+  slot = std::move(dict);
+  sum_bytes += memory.size();
+  for (auto iter = dicts.begin(); sum_bytes > capacity;) {
+    if (iter->first == key) {
+      ++iter;
+      continue;
+    }
+    sum_bytes -= iter->second->memory.size();
+    iter = dicts.erase(iter);
+  }
+}
+
 size_t TerarkZipMultiOffsetInfo::calc_size(size_t partCount) {
   return 8 + partCount * sizeof(KeyValueOffset);
 }
@@ -227,7 +283,12 @@ TerarkZipTableFactory::TerarkZipTableFactory(
   }
 }
 
-TerarkZipTableFactory::~TerarkZipTableFactory() { delete adaptive_factory_; }
+TerarkZipTableFactory::~TerarkZipTableFactory() {
+  for (auto* handle : cache_charge_handles_) {
+    table_options_.cacheChargedTo->Release(handle, true);
+  }
+  delete adaptive_factory_;
+}
 
 Status TerarkZipTableFactory::NewTableReader(
     const TableReaderOptions& table_reader_options,
@@ -242,6 +303,22 @@ Status TerarkZipTableFactory::NewTableReader(
         cache_.reset(LruReadonlyCache::create(
             table_options_.cacheCapacityBytes, table_options_.cacheShards,
             initial_file_num, table_reader_options.env_options.use_aio_reads));
+        if (auto& charged = table_options_.cacheChargedTo) {
+          // Many small entries, like WriteBufferManager, so that every shard
+          // of the charged cache takes its part
+          const size_t kSizeDummyEntry = 1 << 20;
+          for (size_t size = 0; size < table_options_.cacheCapacityBytes;
+               size += kSizeDummyEntry) {
+            char key[8];
+            EncodeFixed64(key, charged->NewId());
+            Cache::Handle* handle = nullptr;
+            charged->Insert(Slice(key, sizeof key), nullptr, kSizeDummyEntry,
+                            nullptr, &handle);
+            if (handle != nullptr) {
+              cache_charge_handles_.push_back(handle);
+            }
+          }
+        }
       }
     }
   }
@@ -334,8 +411,27 @@ extern TableBuilder* createTerarkZipTableBuilder(
     const TerarkZipTableOptions& tzo, const TableBuilderOptions& tbo,
     uint32_t column_family_id, WritableFileWriter* file,
     uint32_t key_prefixLen);
+extern bool TerarkZipAdmitBuild(const TerarkZipTableOptions& tzo,
+                                uint64_t buildBytes);
+extern void TerarkZipGetBuildMemoryUsage(uint64_t* working, uint64_t* waiting);
 extern long long g_lastTime;
 
+bool TerarkZipTableFactory::AdmitBuild(int level, uint64_t build_bytes) const {
+  int minlevel = table_options_.terarkZipMinLevel;
+  if (minlevel == kTerarkZipMinLevelForDisabled ||
+      (fallback_factory_ && level >= 0 && level < minlevel)) {
+    return !fallback_factory_ ||
+           fallback_factory_->AdmitBuild(level, build_bytes);
+  }
+  return TerarkZipAdmitBuild(table_options_, build_bytes);
+}
+
+bool TerarkZipTableFactory::GetBuildMemoryUsage(uint64_t* working,
+                                                uint64_t* waiting) const {
+  TerarkZipGetBuildMemoryUsage(working, waiting);
+  return true;
+}
+
 TableBuilder* TerarkZipTableFactory::NewTableBuilder(
     const TableBuilderOptions& table_builder_options, uint32_t column_family_id,
     WritableFileWriter* file) const {
@@ -479,6 +575,11 @@ Status TerarkZipTableFactory::GetOptionString(
   return Status::OK();
 }
 
+const std::string& TerarkZipTempDir(const TerarkZipTableOptions& tzto) {
+  static const std::string kMemoryTempDir = "/dev/shm";
+  return tzto.memoryTempFiles ? kMemoryTempDir : tzto.localTempDir;
+}
+
 Status TerarkZipTableFactory::SanitizeOptions(
     const DBOptions& /*db_opts*/, const ColumnFamilyOptions& cf_opts) const {
   auto table_factory =
@@ -489,13 +590,13 @@ Status TerarkZipTableFactory::SanitizeOptions(
   try {
     if (tzto.terarkZipMinLevel != kTerarkZipMinLevelForDisabled) {
       terark::TempFileDeleteOnClose test;
-      test.path = tzto.localTempDir + "/Terark-XXXXXX";
+      test.path = TerarkZipTempDir(tzto) + "/Terark-XXXXXX";
       test.open_temp();
       test.writer << "Terark";
       test.complete_write();
     }
   } catch (...) {
-    std::string msg = "ERROR: bad localTempDir : " + tzto.localTempDir;
+    std::string msg = "ERROR: bad temp dir : " + TerarkZipTempDir(tzto);
     fprintf(stderr, "%s\n", msg.c_str());
     return Status::InvalidArgument("TerarkZipTableFactory::SanitizeOptions()",
                                    msg);
@@ -573,6 +674,12 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"indexCacheRatio",
          {offsetof(struct TerarkZipTableOptions, indexCacheRatio),
           OptionType::kDouble, OptionVerificationType::kNormal, false, 0}},
+        {"memoryTempFiles",
+         {offsetof(struct TerarkZipTableOptions, memoryTempFiles),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
+        {"warmUpIndexInBackground",
+         {offsetof(struct TerarkZipTableOptions, warmUpIndexInBackground),
+          OptionType::kBoolean, OptionVerificationType::kNormal, false, 0}},
         {"localTempDir",
          {offsetof(struct TerarkZipTableOptions, localTempDir),
           OptionType::kString, OptionVerificationType::kNormal, false, 0}},
@@ -618,6 +725,30 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"cbtMinKeyRatio",
          {offsetof(struct TerarkZipTableOptions, cbtMinKeyRatio),
           OptionType::kDouble, OptionVerificationType::kNormal, false, 0}},
+        {"maxParallelStoreBuild",
+         {offsetof(struct TerarkZipTableOptions, maxParallelStoreBuild),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, false, 0}},
+        {"minPinValueSize",
+         {offsetof(struct TerarkZipTableOptions, minPinValueSize),
+          OptionType::kUInt32T, OptionVerificationType::kNormal, false, 0}},
+        {"warmUpIndexMaxLevel",
+         {offsetof(struct TerarkZipTableOptions, warmUpIndexMaxLevel),
+          OptionType::kInt, OptionVerificationType::kNormal, false, 0}},
+        {"upperLevelMax",
+         {offsetof(struct TerarkZipTableOptions, upperLevelMax),
+          OptionType::kInt, OptionVerificationType::kNormal, false, 0}},
+        {"upperLevelIndexType",
+         {offsetof(struct TerarkZipTableOptions, upperLevelIndexType),
+          OptionType::kString, OptionVerificationType::kNormal, false, 0}},
+        {"upperLevelSampleRatio",
+         {offsetof(struct TerarkZipTableOptions, upperLevelSampleRatio),
+          OptionType::kDouble, OptionVerificationType::kNormal, false, 0}},
+        {"dictReuseCacheBytes",
+         {offsetof(struct TerarkZipTableOptions, dictReuseCacheBytes),
+          OptionType::kUInt64T, OptionVerificationType::kNormal, false, 0}},
+        {"dictReuseMaxDistance",
+         {offsetof(struct TerarkZipTableOptions, dictReuseMaxDistance),
+          OptionType::kDouble, OptionVerificationType::kNormal, false, 0}},
 };
 
 // delimiter must be "\n"
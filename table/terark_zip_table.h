@@ -16,6 +16,8 @@
 
 namespace TERARKDB_NAMESPACE {
 
+class Cache;
+
 static const int kTerarkZipMinLevelForDisabled = -2;
 
 struct TerarkZipTableOptions {
@@ -79,7 +81,18 @@ struct TerarkZipTableOptions {
   bool forceMetaInMemory = false;
   bool enableEntropyStore = true;
   uint8_t cbtHashBits = 0;
-  uint8_t reserveBytes0[5] = {};
+  /// keep the temp files of the builds on the memory filesystem at
+  /// /dev/shm instead of localTempDir, for hosts without a local disk for
+  /// them. The keys and values spilled there are charged to
+  /// softZipWorkingMemLimit and hardZipWorkingMemLimit until the build ends
+  bool memoryTempFiles = false;
+  /// open the readers without touching their index, and warm up the indexes
+  /// warmUpIndexOnOpen would touch from a background job instead, the lower
+  /// levels and the hot files first, rate limited by the rate_limiter of
+  /// the DB if it limits reads. The warm-up of a file is dropped once
+  /// compaction reads it
+  bool warmUpIndexInBackground = false;
+  uint8_t reserveBytes0[3] = {};
   uint16_t offsetArrayBlockUnits = 0;
 
   double sampleRatio = 0.03;
@@ -110,7 +123,37 @@ struct TerarkZipTableOptions {
   uint32_t cbtEntryPerTrie = 65536;
   uint32_t cbtMinKeySize = 16;
   double cbtMinKeyRatio = 0.5;
-  uint8_t reserveBytes1[8] = {};
+  /// max number of value stores of one SST built concurrently on the LOW
+  /// pool, each one is also charged to softZipWorkingMemLimit
+  ///  0 or 1: build value stores one by one
+  uint32_t maxParallelStoreBuild = 4;
+  /// Get() hands the decode buffer of values at least this long over to the
+  /// caller instead of copying them out of it, 0 hands over every value
+  uint32_t minPinValueSize = 2048;
+  /// warmUpIndexOnOpen only applies to the files on levels up to this one
+  /// and, beyond level 0, not to the files the DB reports cold by reads
+  /// (see prefetch_index_and_filter_hot_file_ratio), -1 for all levels
+  int32_t warmUpIndexMaxLevel = -1;
+  /// the tables on levels up to this one, the hot ones in the usual shape of
+  /// the levels, are built with upperLevelIndexType and upperLevelSampleRatio
+  /// instead of indexType and sampleRatio, and without the entropy store, to
+  /// trade size for faster lookups, -1 for no such levels
+  int32_t upperLevelMax = -1;
+  /// empty for indexType
+  std::string upperLevelIndexType = "";
+  /// 0 for sampleRatio
+  double upperLevelSampleRatio = 0;
+  /// up to this many bytes of the last dictionary built per column family
+  /// and level are kept, the next table of the same ones whose value sample
+  /// has a byte histogram within dictReuseMaxDistance (L1 distance of the
+  /// normalized histograms, 0 to 2) reuses it instead of sampling its own,
+  /// 0 to disable
+  uint64_t dictReuseCacheBytes = 0;
+  double dictReuseMaxDistance = 0.1;
+  /// charge the cacheCapacityBytes of the terark user space cache to this
+  /// cache, usually the block cache of the DB, so that one memory budget
+  /// covers both
+  std::shared_ptr<Cache> cacheChargedTo;
 
   class Status Parse(class Slice);
 };
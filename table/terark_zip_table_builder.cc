@@ -10,6 +10,7 @@
 #include <terark/io/MemStream.hpp>
 #include <terark/lcast.hpp>
 #include <terark/num_to_str.hpp>
+#include <terark/util/function.hpp>
 #include <terark/util/sortable_strvec.hpp>
 #include <terark/zbs/blob_store_file_header.hpp>
 #include <terark/zbs/entropy_zip_blob_store.hpp>
@@ -19,6 +20,7 @@
 #include <terark/zbs/zip_offset_blob_store.hpp>
 
 #include "db/version_edit.h"
+#include "monitoring/cpu_attribution.h"
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/merge_operator.h"
 #include "rocksdb/terark_namespace.h"
@@ -161,12 +163,21 @@ TerarkZipTableBuilder::TerarkZipTableBuilder(
       range_del_block_(1),
       prefixLen_(key_prefixLen),
       compaction_load_(0) {
+  if (tbo.level >= 0 && tbo.level <= table_options_.upperLevelMax) {
+    if (!table_options_.upperLevelIndexType.empty()) {
+      table_options_.indexType = table_options_.upperLevelIndexType;
+    }
+    if (table_options_.upperLevelSampleRatio > 0) {
+      table_options_.sampleRatio = table_options_.upperLevelSampleRatio;
+    }
+    table_options_.enableEntropyStore = false;
+  }
   tiopt_.debugLevel = table_options_.debugLevel;
   tiopt_.indexNestLevel = table_options_.indexNestLevel;
   tiopt_.indexNestScale = table_options_.indexNestScale;
   tiopt_.indexTempLevel = table_options_.indexTempLevel;
   tiopt_.indexType = table_options_.indexType;
-  tiopt_.localTempDir = table_options_.localTempDir;
+  tiopt_.localTempDir = TerarkZipTempDir(table_options_);
   tiopt_.smallTaskMemory = table_options_.smallTaskMemory;
   tiopt_.compressGlobalDict = !table_options_.disableCompressDict;
   tiopt_.cbtHashBits = tbo.skip_filters ? 0 : table_options_.cbtHashBits;
@@ -233,7 +244,7 @@ TerarkZipTableBuilder::TerarkZipTableBuilder(
     file_ = file;
     sampleUpperBound_ =
         uint64_t(randomGenerator_.max() * table_options_.sampleRatio);
-    tmpSentryFile_.path = table_options_.localTempDir + "/Terark-XXXXXX";
+    tmpSentryFile_.path = TerarkZipTempDir(table_options_) + "/Terark-XXXXXX";
     tmpSentryFile_.open_temp();
     tmpSampleFile_.path = tmpSentryFile_.path + ".sample";
     tmpSampleFile_.open();
@@ -512,6 +523,11 @@ Status TerarkZipTableBuilder::Add(const Slice& key,
   if (!value.empty() && randomGenerator_() < sampleUpperBound_) {
     tmpSampleFile_.writer << fstringOf(value);
     sampleLenSum_ += value.size();
+    if (table_options_.dictReuseCacheBytes > 0) {
+      for (size_t i = 0; i < value.size(); ++i) {
+        ++sampleHist_[byte_t(value[i])];
+      }
+    }
   }
   if (filePair_->isFullValue && second_pass_iter_ &&
       table_options_.debugLevel != 2 && valueDataSize_ > (1ull << 20) &&
@@ -571,6 +587,9 @@ Status TerarkZipTableBuilder::AddTombstone(const Slice& key,
         freq_hist_o1::estimate_size_unfinish(*kv_freq_copy) * estimateRatio_);
     next_freq_size_ = freq_size + (1ULL << 20);
   }
+  if (table_options_.memoryTempFiles) {
+    ChargeTempFileMemory(key.size() + value.size());
+  }
   NotifyCollectTableCollectorsOnAdd(key, value, estimateOffset_, collectors_,
                                     ioptions_.info_log);
   return Status::OK();
@@ -609,6 +628,20 @@ void TerarkZipTableBuilder::WaitHandle::Release(size_t size) {
 }
 TerarkZipTableBuilder::WaitHandle::~WaitHandle() { Release(myWorkMem); }
 
+// The temp files on the memory filesystem take memory as the index and store
+// builds do. They are charged in steps without waiting, Add() can't stall on
+// them, the builds of this and the other tables wait for memory instead.
+void TerarkZipTableBuilder::ChargeTempFileMemory(size_t size) {
+  const size_t kChargeStep = 4 << 20;
+  tmpFileUncharged_ += size;
+  if (tmpFileUncharged_ >= kChargeStep) {
+    std::unique_lock<std::mutex> zipLock(zipMutex);
+    sumWorkingMem += tmpFileUncharged_;
+    tmpFileMem_.myWorkMem += tmpFileUncharged_;
+    tmpFileUncharged_ = 0;
+  }
+}
+
 TerarkZipTableBuilder::WaitHandle TerarkZipTableBuilder::WaitForMemory(
     const char* who, size_t myWorkMem) {
   const size_t softMemLimit = table_options_.softZipWorkingMemLimit;
@@ -805,9 +838,12 @@ Status TerarkZipTableBuilder::Finish(
 
 std::unique_ptr<TERARKDB_NAMESPACE::AsyncTask<TERARKDB_NAMESPACE::Status>>
 TerarkZipTableBuilder::Async(std::function<Status()> func, void* tag) {
+  // The CPU of the task is the column family's, as that of the compaction
+  CpuAttributionCounters* cf = CpuJobScope::CurrentColumnFamily();
   auto task = std::unique_ptr<
       TERARKDB_NAMESPACE::AsyncTask<TERARKDB_NAMESPACE::Status>>(
-      new AsyncTask<Status>([func]() {
+      new AsyncTask<Status>([func, cf]() {
+        CpuJobScope cpu_job_scope(CpuJobKind::kTableBuild, cf);
         try {
           return func();
         } catch (const std::exception& ex) {
@@ -939,33 +975,51 @@ void TerarkZipTableBuilder::BuildIndex(KeyValueStatus& kvs, size_t entropyLen) {
       &indexTag);
 }
 
+void TerarkZipTableBuilder::AcquireStoreSlot() {
+  std::unique_lock<std::mutex> l(storeSlotMutex_);
+  storeSlotCond_.wait(l, [this] {
+    return storeBuildRunning_ < table_options_.maxParallelStoreBuild;
+  });
+  ++storeBuildRunning_;
+}
+
+void TerarkZipTableBuilder::ReleaseStoreSlot() {
+  std::unique_lock<std::mutex> l(storeSlotMutex_);
+  assert(storeBuildRunning_ > 0);
+  --storeBuildRunning_;
+  storeSlotCond_.notify_one();
+}
+
 Status TerarkZipTableBuilder::BuildStore(KeyValueStatus& kvs,
                                          DictZipBlobStore::ZipBuilder* zbuilder,
                                          uint64_t flag) {
-  auto buildUncompressedStore = [this, &kvs]() {
-    std::unique_lock<std::mutex> l(storeBuildMutex_);
-    assert(tmpStoreFileSize_ == 0 ||
-           tmpStoreFileSize_ == FileStream(tmpStoreFile_.fpath, "rb").fsize());
+  auto buildStoreToFile = [this, &kvs](fstring fpath, size_t offset) {
     auto& stat = kvs.status.stat;
     size_t fixedNum = kvs.status.valueHist.m_cnt_of_max_cnt_key;
     size_t variaNum = stat.keyCount - fixedNum;
-    BuildStoreParams params = {kvs, 0, tmpStoreFile_, tmpStoreFileSize_};
-    Status s;
-    try {
-      if (kvs.status.valueHist.m_total_key_len == 0) {
-        s = buildZeroLengthBlobStore(params);
-      } else if (stat.keyCount >= 4096 && table_options_.enableEntropyStore &&
-                 kvs.status.valueHist.m_total_key_len / stat.keyCount < 32) {
-        s = buildEntropyZipBlobStore(params);
-      } else if (table_options_.offsetArrayBlockUnits) {
-        if (variaNum * 64 < stat.keyCount) {
-          s = buildMixedLenBlobStore(params);
-        } else {
-          s = buildZipOffsetBlobStore(params);
-        }
+    BuildStoreParams params = {kvs, 0, fpath, offset};
+    if (kvs.status.valueHist.m_total_key_len == 0) {
+      return buildZeroLengthBlobStore(params);
+    } else if (stat.keyCount >= 4096 && table_options_.enableEntropyStore &&
+               kvs.status.valueHist.m_total_key_len / stat.keyCount < 32) {
+      return buildEntropyZipBlobStore(params);
+    } else if (table_options_.offsetArrayBlockUnits) {
+      if (variaNum * 64 < stat.keyCount) {
+        return buildMixedLenBlobStore(params);
       } else {
-        s = buildMixedLenBlobStore(params);
+        return buildZipOffsetBlobStore(params);
       }
+    } else {
+      return buildMixedLenBlobStore(params);
+    }
+  };
+  auto buildUncompressedStore = [this, &kvs, buildStoreToFile]() {
+    std::unique_lock<std::mutex> l(storeBuildMutex_);
+    assert(tmpStoreFileSize_ == 0 ||
+           tmpStoreFileSize_ == FileStream(tmpStoreFile_.fpath, "rb").fsize());
+    Status s;
+    try {
+      s = buildStoreToFile(tmpStoreFile_, tmpStoreFileSize_);
       size_t newTmpStoreFileSize =
           FileStream(tmpStoreFile_.fpath, "rb").fsize();
       if (s.ok()) {
@@ -980,6 +1034,52 @@ Status TerarkZipTableBuilder::BuildStore(KeyValueStatus& kvs,
     }
     return s;
   };
+  // Full values are read back from the per range temp files, so stores of
+  // different ranges do not share anything but tmpStoreFile_. Build each one
+  // into a part file on its own and only hold storeBuildMutex_ to splice the
+  // part into tmpStoreFile_, stores of small ranges then overlap with each
+  // other and with the index builds instead of queuing up on the mutex
+  auto buildUncompressedStoreParallel = [this, &kvs, buildStoreToFile,
+                                         buildUncompressedStore]() {
+    if (!kvs.isFullValue || table_options_.maxParallelStoreBuild <= 1) {
+      // second pass iter is shared by all ranges
+      return buildUncompressedStore();
+    }
+    // offset array of the store, the records are streamed to the file
+    size_t myWorkMem = UintVecMin0::compute_mem_size_by_max_val(
+        kvs.status.valueHist.m_total_key_len, kvs.status.stat.keyCount);
+    AcquireStoreSlot();
+    TERARK_SCOPE_EXIT(ReleaseStoreSlot());
+    auto waitHandle = WaitForMemory("store", myWorkMem);
+
+    AutoDeleteFile partFile{tmpStoreFile_.fpath + "." +
+                            std::to_string(storePartSeq_++)};
+    Status s = buildStoreToFile(partFile, 0);
+    if (!s.ok()) {
+      return s;
+    }
+    waitHandle.Release();
+    size_t partSize = FileStream(partFile.fpath, "rb").fsize();
+    assert(partSize % 8 == 0);
+    std::unique_lock<std::mutex> l(storeBuildMutex_);
+    assert(tmpStoreFileSize_ == 0 ||
+           tmpStoreFileSize_ == FileStream(tmpStoreFile_.fpath, "rb").fsize());
+    try {
+      if (partSize > 0) {
+        MmapWholeFile part(partFile.fpath);
+        FileStream writer(tmpStoreFile_, "ab+");
+        writer.ensureWrite(part.base, part.size);
+        writer.flush();
+      }
+      kvs.valueFileBegin = tmpStoreFileSize_;
+      kvs.valueFileEnd = tmpStoreFileSize_ + partSize;
+      tmpStoreFileSize_ += partSize;
+    } catch (...) {
+      tmpStoreFileSize_ = FileStream(tmpStoreFile_.fpath, "rb").fsize();
+      throw;
+    }
+    return s;
+  };
   auto buildCompressedStore = [this, &kvs, zbuilder]() {
     assert(zbuilder != nullptr);
     std::unique_lock<std::mutex> l(storeBuildMutex_);
@@ -1026,7 +1126,7 @@ Status TerarkZipTableBuilder::BuildStore(KeyValueStatus& kvs,
         if (flag & BuildStoreSync) {
           return buildUncompressedStore();
         } else {
-          kvs.storeWait = Async(buildUncompressedStore, &storeTag);
+          kvs.storeWait = Async(buildUncompressedStoreParallel, &storeTag);
         }
       }
     } else {
@@ -1044,7 +1144,7 @@ Status TerarkZipTableBuilder::BuildStore(KeyValueStatus& kvs,
     if (kvs.isUseDictZip) {
       kvs.storeWait = Async(buildCompressedStore, &storeTag);
     } else {
-      kvs.storeWait = Async(buildUncompressedStore, &storeTag);
+      kvs.storeWait = Async(buildUncompressedStoreParallel, &storeTag);
     }
   }
   return Status::OK();
@@ -1209,6 +1309,23 @@ TerarkZipTableBuilder::WaitHandle TerarkZipTableBuilder::LoadSample(
     zbuilder.reset();
     return WaitHandle();
   }
+  if (table_options_.dictReuseCacheBytes > 0) {
+    auto dict = table_factory_->GetDictReuseCache().find(
+        {properties_.column_family_id, level_}, sampleHist_,
+        table_options_.dictReuseMaxDistance);
+    if (dict) {
+      INFO(ioptions_.info_log,
+           "TerarkZipTableBuilder::LoadSample():this=%12p:\n"
+           "sample_len = %zd, reuse dict_len = %zd, level = %d\n",
+           this, sampleLenSum_, dict->memory.size(), level_);
+      auto waitHandle = WaitForMemory("dictZip", dict->memory.size() * 6);
+      tmpSampleFile_.close();
+      zbuilder->addSample(dict->memory);
+      zbuilder->finishSample();
+      isDictReused_ = true;
+      return waitHandle;
+    }
+  }
 
   size_t sampleMax =
       std::min<size_t>(INT32_MAX, table_options_.softZipWorkingMemLimit / 7);
@@ -1264,6 +1381,15 @@ TerarkZipTableBuilder::WaitHandle TerarkZipTableBuilder::LoadSample(
   return waitHandle;
 }
 
+void TerarkZipTableBuilder::CacheDict(fstring dict) {
+  if (table_options_.dictReuseCacheBytes > 0 && !isDictReused_ &&
+      sampleLenSum_ > 0) {
+    table_factory_->GetDictReuseCache().insert(
+        {properties_.column_family_id, level_}, dict, sampleHist_,
+        table_options_.dictReuseCacheBytes);
+  }
+}
+
 Status TerarkZipTableBuilder::buildEntropyZipBlobStore(
     BuildStoreParams& params) {
   auto& kvs = params.kvs;
@@ -1376,6 +1502,7 @@ Status TerarkZipTableBuilder::ZipValueToFinish() {
     if (zbuilder) {
       // prepareDict() will invalid zbuilder->getDictionary().memory
       zbuilder->prepareDict();
+      CacheDict(zbuilder->getDictionary().memory);
       dictWait = CompressDict(tmpDictFile, zbuilder->getDictionary().memory,
                               &dictInfo, &td);
       dictHash = zbuilder->getDictionary().xxhash;
@@ -1452,6 +1579,7 @@ Status TerarkZipTableBuilder::ZipValueToFinishMulti() {
       assert(tmpZipStoreFileSize_ == 0);
       // build dict in this thread
       zbuilder->prepareDict();
+      CacheDict(zbuilder->getDictionary().memory);
       dictWait = CompressDict(tmpDictFile, zbuilder->getDictionary().memory,
                               &dictInfo, &td);
       dictHash = zbuilder->getDictionary().xxhash;
@@ -2362,6 +2490,9 @@ Status TerarkZipTableBuilder::WriteMetaData(
     propBlockBuilder.Add(user_collected_properties);
   }
   propBlockBuilder.Add(kTerarkZipTableBuildTimestamp, GetTimestamp());
+  propBlockBuilder.Add(kTerarkZipTableIndexType, tiopt_.indexType);
+  propBlockBuilder.Add(kTerarkZipTableSampleRatio,
+                       ToString(table_options_.sampleRatio));
   if (entropy > 0) {
     propBlockBuilder.Add(kTerarkZipTableEntropy, terark::lcast(entropy));
   }
@@ -2434,6 +2565,7 @@ void TerarkZipTableBuilder::Abandon() {
   tmpStoreFile_.Delete();
   tmpZipDictFile_.Delete();
   tmpZipValueFile_.Delete();
+  tmpFileMem_.Release();
 }
 
 // based on Abandon
@@ -2546,6 +2678,27 @@ TableBuilder* createTerarkZipTableBuilder(
                                    file, key_prefixLen);
 }
 
+bool TerarkZipAdmitBuild(const TerarkZipTableOptions& tzo,
+                         uint64_t buildBytes) {
+  // small builds don't wait in WaitForMemory() below the hard limit, they go
+  // on when the memory is tight, it's the big ones that are deferred
+  if (buildBytes < tzo.smallTaskMemory) {
+    return true;
+  }
+  std::unique_lock<std::mutex> zipLock(zipMutex);
+  if (sumWorkingMem == 0 && sumWaitingMem == 0) {
+    return true;  // a build over softZipWorkingMemLimit must start some time
+  }
+  return sumWorkingMem + sumWaitingMem + buildBytes <
+         tzo.softZipWorkingMemLimit;
+}
+
+void TerarkZipGetBuildMemoryUsage(uint64_t* working, uint64_t* waiting) {
+  std::unique_lock<std::mutex> zipLock(zipMutex);
+  *working = sumWorkingMem;
+  *waiting = sumWaitingMem;
+}
+
 std::string ParseTerarkZipTableOption(const std::string& name,
                                       const std::string& org_value,
                                       TerarkZipTableOptions* new_options,
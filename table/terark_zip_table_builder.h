@@ -10,6 +10,7 @@
 #ifndef TERARK_ZIP_TABLE_BUILDER_H_
 #define TERARK_ZIP_TABLE_BUILDER_H_
 
+#include <condition_variable>
 #include <future>
 #include <random>
 #include <terark/bitfield_array.hpp>
@@ -144,6 +145,7 @@ class TerarkZipTableBuilder : public TableBuilder, boost::noncopyable {
     ~WaitHandle();
   };
   WaitHandle WaitForMemory(const char* who, size_t memorySize);
+  void ChargeTempFileMemory(size_t size);
   Status EmptyTableFinish();
   std::unique_ptr<AsyncTask<Status>> Async(std::function<Status()> func,
                                            void* tag);
@@ -154,6 +156,8 @@ class TerarkZipTableBuilder : public TableBuilder, boost::noncopyable {
   };
   Status BuildStore(KeyValueStatus& kvs, DictZipBlobStore::ZipBuilder* zbuilder,
                     uint64_t flag);
+  void AcquireStoreSlot();
+  void ReleaseStoreSlot();
   std::unique_ptr<AsyncTask<Status>> CompressDict(fstring tmpDictFile,
                                                   fstring dict,
                                                   std::string* type,
@@ -176,6 +180,7 @@ class TerarkZipTableBuilder : public TableBuilder, boost::noncopyable {
                        long long& t6);
   WaitHandle LoadSample(
       std::unique_ptr<DictZipBlobStore::ZipBuilder>& zbuilder);
+  void CacheDict(fstring dict);
   struct BuildStoreParams {
     KeyValueStatus& kvs;
     WaitHandle handle;
@@ -237,14 +242,25 @@ class TerarkZipTableBuilder : public TableBuilder, boost::noncopyable {
   AutoDeleteFile tmpZipStoreFile_;
   uint64_t tmpStoreFileSize_ = 0;
   uint64_t tmpZipStoreFileSize_ = 0;
+  // the temp files of memoryTempFiles charged to sumWorkingMem, and the
+  // bytes spilled since the last charge
+  WaitHandle tmpFileMem_;
+  size_t tmpFileUncharged_ = 0;
   std::mutex indexBuildMutex_;
   std::mutex storeBuildMutex_;
+  // bounds the value stores built concurrently by maxParallelStoreBuild
+  std::mutex storeSlotMutex_;
+  std::condition_variable storeSlotCond_;
+  size_t storeBuildRunning_ = 0;
+  std::atomic<size_t> storePartSeq_ = {0};
   FileStream tmpDumpFile_;
   AutoDeleteFile tmpZipDictFile_;
   AutoDeleteFile tmpZipValueFile_;
   std::mt19937_64 randomGenerator_;
   uint64_t sampleUpperBound_;
   size_t sampleLenSum_ = 0;
+  DictReuseCache::Hist sampleHist_ = {};
+  bool isDictReused_ = false;
   size_t singleIndexMaxSize_ = 0;
   WritableFileWriter* file_;
   uint64_t offset_ = 0;
@@ -2,6 +2,7 @@
 
   M_String(localTempDir);
   M_String(indexType);
+  M_String(upperLevelIndexType);
   M_NumFmt(checksumLevel            , "%d");
   M_NumFmt(checksumSmallValSize     , "%d");
   M_NumFmt(entropyAlgo              , "%d");
@@ -21,6 +22,8 @@
   M_Boolea(optimizeCpuL3Cache);
   M_Boolea(forceMetaInMemory);
   M_Boolea(enableEntropyStore);
+  M_Boolea(memoryTempFiles);
+  M_Boolea(warmUpIndexInBackground);
   M_NumFmt(cbtHashBits              , "%d");
   M_NumFmt(minPreadLen              , "%d");
   M_NumFmt(offsetArrayBlockUnits    , "%d");
@@ -36,6 +39,13 @@
   M_NumFmt(cbtEntryPerTrie          , "%u");
   M_NumFmt(cbtMinKeySize            , "%u");
   M_NumFmt(cbtMinKeyRatio           , "%lf");
+  M_NumFmt(maxParallelStoreBuild    , "%u");
+  M_NumFmt(minPinValueSize          , "%u");
+  M_NumFmt(warmUpIndexMaxLevel      , "%d");
+  M_NumFmt(upperLevelMax            , "%d");
+  M_NumFmt(upperLevelSampleRatio    , "%lf");
+  M_NumGiB(dictReuseCacheBytes);
+  M_NumFmt(dictReuseMaxDistance     , "%lf");
 
 #undef M_NumFmt
 #undef M_NumGiB
@@ -3,12 +3,16 @@
 
 #include <zstd/zstd.h>
 
+#include <algorithm>
 #include <terark/lcast.hpp>
 #include <terark/util/crc.hpp>
 #include <terark/util/function.hpp>
 #include <terark/util/hugepage.hpp>
 #include <terark/zbs/blob_store_file_header.hpp>  // for isChecksumVerifyEnabled()
+#include <tuple>
 
+#include "monitoring/perf_context_imp.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/get_context.h"
 #include "table/internal_iterator.h"
@@ -254,6 +258,11 @@ class TerarkZipTableIterator : public TerarkZipTableIndexIterator,
   TerarkContext ctx_;
   TerarkContext* ctx_ptr_;
   valvec<byte_t> iter_storage_;
+  uint64_t async_prefetch_size_;
+  // End of the store data issued by async_prefetch_size_ so far, in the file
+  // of prefetch_reader_
+  uint64_t async_prefetch_limit_ = 0;
+  const TerarkZipSubReader* prefetch_reader_ = nullptr;
 
   using TerarkZipTableIndexIterator::iter_;
   using TerarkZipTableIndexIterator::subReader_;
@@ -294,11 +303,12 @@ class TerarkZipTableIterator : public TerarkZipTableIndexIterator,
  public:
   TerarkZipTableIterator(const TableReaderOptions& tro,
                          const TerarkZipSubReader* subReader,
-                         const ReadOptions& /*ro*/, SequenceNumber global_seqno,
+                         const ReadOptions& ro, SequenceNumber global_seqno,
                          TerarkContext* ctx)
       : table_reader_options_(&tro),
         global_seqno_(global_seqno),
-        ctx_ptr_(ctx == nullptr ? &ctx_ : ctx) {
+        ctx_ptr_(ctx == nullptr ? &ctx_ : ctx),
+        async_prefetch_size_(ro.async_prefetch_size) {
     subReader_ = subReader;
     if (subReader_ != nullptr) {
       iter_storage_.swap(ctx_ptr_->alloc(subReader_->index_->IteratorSize()));
@@ -370,6 +380,9 @@ class TerarkZipTableIterator : public TerarkZipTableIndexIterator,
       } else {
         if (UnzipIterRecord(IndexIterNext())) {
           DecodeCurrKeyValue();
+          if (async_prefetch_size_ > 0) {
+            MaybePrefetchAsync();
+          }
         }
       }
     } while (key_tag_ == port::kMaxUint64);
@@ -522,6 +535,37 @@ class TerarkZipTableIterator : public TerarkZipTableIndexIterator,
     else
       return iter_->Next();
   }
+  // The records of a store read by pread are read one by one, the next
+  // async_prefetch_size_ bytes are kept in flight ahead of a forward scan in
+  // the store order. Not with the terark user space cache, whose O_DIRECT
+  // reads don't see the page cache.
+  void MaybePrefetchAsync() {
+    const TerarkZipSubReader* reader = subReader_;
+    if (reverse || !reader->storeUsePread_ || reader->cache_ != nullptr) {
+      return;
+    }
+    const uint64_t window = async_prefetch_size_;
+    uint64_t offset = reader->EstimateRecordOffset(iter_->id());
+    if (reader != prefetch_reader_ ||
+        offset + window < async_prefetch_limit_) {
+      // Another store, or sought backward since the last window
+      prefetch_reader_ = reader;
+      async_prefetch_limit_ = 0;
+    }
+    if (offset + window / 2 <= async_prefetch_limit_) {
+      return;
+    }
+    offset = std::max(offset, async_prefetch_limit_);
+    uint64_t limit = std::min<uint64_t>(
+        offset + window,
+        reader->storeOffset_ + reader->store_->get_mmap().size());
+    if (limit > offset) {
+      // Failures only make the reads synchronous
+      reader->storeFileObj_->PrefetchAsync(offset,
+                                           static_cast<size_t>(limit - offset));
+    }
+    async_prefetch_limit_ = offset + window;
+  }
   bool UnzipIterRecord(bool hasRecord) {
     if (hasRecord) {
       auto& value_buffer = ValueBuffer();
@@ -852,6 +896,105 @@ TerarkZipTableReaderBase::GetTableProperties() const {
   }
 }
 
+IndexWarmUpQueue::~IndexWarmUpQueue() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  heap_.clear();
+  cond_.wait(lock, [this] { return !scheduled_; });
+}
+
+// The heap pops the lowest level first, unknown levels last, then the hot
+// files before the cold ones, then the newest files
+static bool WarmUpLater(const std::shared_ptr<IndexWarmUpQueue::Task>& x,
+                        const std::shared_ptr<IndexWarmUpQueue::Task>& y) {
+  auto rank = [](const IndexWarmUpQueue::Task& t) {
+    return std::make_tuple(unsigned(t.level), t.cold, ~t.file_number);
+  };
+  return rank(*x) > rank(*y);
+}
+
+void IndexWarmUpQueue::Add(std::shared_ptr<Task> task, Env* env) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  heap_.push_back(std::move(task));
+  std::push_heap(heap_.begin(), heap_.end(), &WarmUpLater);
+  if (!scheduled_) {
+    scheduled_ = true;
+    env->Schedule(&IndexWarmUpQueue::BGWork, this, Env::Priority::LOW);
+  }
+}
+
+void IndexWarmUpQueue::Cancel(Task* task) {
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->cancelled = true;
+}
+
+void IndexWarmUpQueue::BGWork(void* arg) {
+  reinterpret_cast<IndexWarmUpQueue*>(arg)->Run();
+}
+
+void IndexWarmUpQueue::Run() {
+  // Small enough for the readers closing meanwhile not to wait long
+  const size_t kChunkSize = 1 << 20;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!heap_.empty()) {
+    std::pop_heap(heap_.begin(), heap_.end(), &WarmUpLater);
+    std::shared_ptr<Task> task = std::move(heap_.back());
+    heap_.pop_back();
+    lock.unlock();
+    bool cancelled = false;
+    for (size_t i = 0; i < task->ranges.size() && !cancelled; ++i) {
+      fstring range = task->ranges[i];
+      for (size_t pos = 0; pos < range.size();) {
+        size_t len = std::min(kChunkSize, range.size() - pos);
+        if (task->rate_limiter != nullptr) {
+          len = task->rate_limiter->RequestToken(len, 0, Env::IO_LOW,
+                                                 task->statistics,
+                                                 RateLimiter::OpType::kRead);
+        }
+        std::lock_guard<std::mutex> task_lock(task->mutex);
+        if (task->cancelled) {
+          cancelled = true;
+          break;
+        }
+        MmapWarmUpBytes(range.data() + pos, len);
+        pos += len;
+      }
+    }
+    lock.lock();
+  }
+  scheduled_ = false;
+  cond_.notify_all();
+}
+
+void TerarkZipTableReaderBase::ScheduleIndexWarmUp(
+    const TerarkZipTableFactory* table_factory, valvec<fstring>&& ranges) {
+  auto& tro = table_reader_options_;
+  auto task = std::make_shared<IndexWarmUpQueue::Task>();
+  task->level = tro.level;
+  task->cold = tro.cold;
+  task->file_number = tro.file_number;
+  task->ranges = std::move(ranges);
+  task->rate_limiter = tro.ioptions.rate_limiter;
+  task->statistics = tro.ioptions.statistics;
+  index_warm_up_task_ = task;
+  table_factory->GetIndexWarmUpQueue().Add(std::move(task), tro.ioptions.env);
+}
+
+void TerarkZipTableReaderBase::CancelIndexWarmUp() {
+  if (index_warm_up_task_) {
+    IndexWarmUpQueue::Cancel(index_warm_up_task_.get());
+  }
+}
+
+bool TerarkZipTableReaderBase::ShouldWarmUpIndex(
+    const TerarkZipTableOptions& tzto) const {
+  int level = table_reader_options_.level;
+  if (!tzto.warmUpIndexOnOpen || level <= 0) {
+    return tzto.warmUpIndexOnOpen;
+  }
+  return (tzto.warmUpIndexMaxLevel < 0 || level <= tzto.warmUpIndexMaxLevel) &&
+         !table_reader_options_.cold;
+}
+
 void TerarkZipTableReaderBase::MmapColdize(const void* addr, size_t len) {
   if (file_data_.size() > 0) {
     file_->file()->InvalidateCache((char*)addr - file_data_.data(), len);
@@ -873,8 +1016,18 @@ void TerarkZipSubReader::InitUsePread(int minPreadLen) {
   estimateUnzipCap_ = size_t(avgUnzipSize * 1.62);  // a bit larger than 1.618
 }
 
+uint64_t TerarkZipSubReader::EstimateRecordOffset(size_t recId) const {
+  size_t numRecords = store_->num_records();
+  size_t memSize = store_->get_mmap().size();
+  if (numRecords == 0) {
+    return storeOffset_;
+  }
+  return storeOffset_ + uint64_t(double(memSize) * recId / numRecords);
+}
+
 void TerarkZipSubReader::GetRecordAppend(size_t recId,
                                          valvec<byte_t>* tbuf) const {
+  PERF_TIMER_GUARD(terark_zip_store_nanos);
   if (storeUsePread_) {
     store_->pread_record_append(cache_, storeFD_, storeOffset_, recId, tbuf);
   } else {
@@ -884,6 +1037,7 @@ void TerarkZipSubReader::GetRecordAppend(size_t recId,
 
 void TerarkZipSubReader::GetRecordAppend(
     size_t recId, terark::BlobStore::CacheOffsets* co) const {
+  PERF_TIMER_GUARD(terark_zip_store_nanos);
   if (storeUsePread_) {
     store_->pread_record_append(cache_, storeFD_, storeOffset_, recId,
                                 &co->recData);
@@ -900,22 +1054,96 @@ Status TerarkZipSubReader::Get(SequenceNumber global_seqno,
         "TerarkZipTableReader::Get()",
         "bad internal key causing ParseInternalKey() failed");
   }
-  Slice user_key = ExtractUserKey(ikey);
-  uint64_t ikey_tag = ExtractInternalKeyFooter(ikey);
   auto g_tctx = terark::GetTlsTerarkContext();
-  size_t recId = index_->Find(fstringOf(user_key), g_tctx);
+  PERF_TIMER_GUARD(terark_zip_index_nanos);
+  size_t recId = index_->Find(fstringOf(ExtractUserKey(ikey)), g_tctx);
+  PERF_TIMER_STOP(terark_zip_index_nanos);
   if (size_t(-1) == recId) {
     return Status::OK();
   }
+  return GetRecord(global_seqno, recId, ikey, get_context, g_tctx);
+}
+
+void TerarkZipSubReader::MultiGet(SequenceNumber global_seqno,
+                                  const ReadOptions& /*ro*/,
+                                  const size_t* indices, size_t num,
+                                  const Slice* ikeys,
+                                  GetContext** get_contexts, Status* statuses,
+                                  int flag) const {
+  TERARK_UNUSED_VAR(flag);
+  auto g_tctx = terark::GetTlsTerarkContext();
+  // Walk the index for every key first, then read the records by ascending
+  // record id, which is the order they are laid out in the store, so that
+  // neighbouring records share pages (or pread blocks in the cache) and the
+  // index stays hot in cache while it is walked
+  std::vector<std::pair<size_t, size_t>> found;  // (record id, key index)
+  found.reserve(num);
+  for (size_t i = 0; i < num; ++i) {
+    size_t k = indices[i];
+    const Slice& ikey = ikeys[k];
+    if (ikey.size() < 8) {
+      statuses[k] = Status::InvalidArgument(
+          "TerarkZipTableReader::MultiGet()",
+          "bad internal key causing ParseInternalKey() failed");
+      continue;
+    }
+    PERF_TIMER_GUARD(terark_zip_index_nanos);
+    size_t recId = index_->Find(fstringOf(ExtractUserKey(ikey)), g_tctx);
+    PERF_TIMER_STOP(terark_zip_index_nanos);
+    if (size_t(-1) != recId) {
+      found.emplace_back(recId, k);
+    }
+  }
+  std::sort(found.begin(), found.end());
+  for (auto& rec_key : found) {
+    size_t k = rec_key.second;
+    statuses[k] =
+        GetRecord(global_seqno, rec_key.first, ikeys[k], get_contexts[k],
+                  g_tctx);
+  }
+}
+
+Status TerarkZipSubReader::GetRecord(SequenceNumber global_seqno,
+                                     size_t recId, const Slice& ikey,
+                                     GetContext* get_context,
+                                     TerarkContext* g_tctx) const {
+  Slice user_key = ExtractUserKey(ikey);
+  uint64_t ikey_tag = ExtractInternalKeyFooter(ikey);
   auto zvType =
       type_.size() ? ZipValueType(type_[recId]) : ZipValueType::kZeroSeq;
   bool matched;
+  if (get_context->key_presence_only()) {
+    // A record of one entry is a value or a deletion as its type tells, and
+    // a lookup seeing the whole file sees the entry whatever its sequence
+    // number, which then need not be read from the store
+    ValueType type = kMaxValue;
+    SequenceNumber seq = largest_seqno_;
+    if (zvType == ZipValueType::kZeroSeq) {
+      type = kTypeValue;
+      seq = global_seqno;
+    } else if (GetInternalKeySeqno(ikey) >= largest_seqno_) {
+      if (zvType == ZipValueType::kValue) {
+        type = kTypeValue;
+      } else if (zvType == ZipValueType::kDelete) {
+        type = kTypeDeletion;
+      }
+    }
+    if (type != kMaxValue) {
+      get_context->SaveValue(ParsedInternalKey(user_key, seq, type),
+                             LazyBuffer(), &matched);
+      return Status::OK();
+    }
+  }
   auto ctx_buffer = g_tctx->alloc();
   auto& buf = ctx_buffer.get();
+  // A pinned value takes the buffer away from the thread context, so the next
+  // Get() pays one allocation instead of a copy of the value
+  if (buf.capacity() == 0) {
+    buf.ensure_capacity(estimateUnzipCap_);
+  }
   auto set_value = [&](const ParsedInternalKey& k, Slice v) {
     assert(k.type != kTypeMerge);
-    static constexpr size_t pin_size = 8192;
-    bool pin_value = v.size() >= pin_size;
+    bool pin_value = v.size() >= minPinValueSize_;
     if (pin_value) {
       void* ptr = buf.data();
       buf.risk_release_ownership();
@@ -1009,6 +1237,11 @@ Status TerarkZipSubReader::Get(SequenceNumber global_seqno,
   return Status::OK();
 }
 
+bool TerarkZipSubReader::IndexHasKey(fstring user_key) const {
+  PERF_TIMER_GUARD(terark_zip_index_nanos);
+  return index_->Find(user_key, terark::GetTlsTerarkContext()) != size_t(-1);
+}
+
 size_t TerarkZipSubReader::DictRank(fstring key) const {
   return index_->DictRank(key, terark::GetTlsTerarkContext());
 }
@@ -1163,6 +1396,7 @@ Status TerarkZipTableReader::Open(RandomAccessFileReader* file,
   subReader_.storeFileObj_ = file_->file();
   subReader_.storeOffset_ = indexSize;
   subReader_.InitUsePread(tzto_.minPreadLen);
+  subReader_.minPinValueSize_ = tzto_.minPinValueSize;
   subReader_.rawReaderOffset_ = 0;
   subReader_.rawReaderSize_ = indexSize + storeSize + typeSize;
   if (subReader_.storeUsePread_) {
@@ -1227,12 +1461,21 @@ Status TerarkZipTableReader::Open(RandomAccessFileReader* file,
     subReader_.index_->DetachMetaData(index_meta_data);
     subReader_.store_->detach_meta_blocks(store_meta_data);
   }
+  const bool warmUpIndex = ShouldWarmUpIndex(tzto_);
   long long t0 = g_pf.now();
-  if (tzto_.warmUpIndexOnOpen) {
-    MmapWarmUp(fstring(file_data.data(), indexSize));
+  if (warmUpIndex) {
+    valvec<fstring> ranges;
+    ranges.emplace_back(file_data.data(), indexSize);
     if (!tzto_.warmUpValueOnOpen) {
       for (fstring block : subReader_.store_->get_meta_blocks()) {
-        MmapWarmUp(block);
+        ranges.push_back(block);
+      }
+    }
+    if (tzto_.warmUpIndexInBackground) {
+      ScheduleIndexWarmUp(table_factory_, std::move(ranges));
+    } else {
+      for (fstring range : ranges) {
+        MmapWarmUp(range);
       }
     }
   }
@@ -1249,6 +1492,7 @@ Status TerarkZipTableReader::Open(RandomAccessFileReader* file,
     }
   }
   subReader_.file_number_ = table_reader_options_.file_number;
+  subReader_.largest_seqno_ = table_reader_options_.largest_seqno;
   long long t1 = g_pf.now();
   subReader_.index_->BuildCache(tzto_.indexCacheRatio);
   long long t2 = g_pf.now();
@@ -1260,7 +1504,7 @@ Status TerarkZipTableReader::Open(RandomAccessFileReader* file,
        subReader_.index_->NumKeys(), size_t(props->index_size),
        size_t(props->data_size), g_pf.sf(t0, t1), g_pf.sf(t1, t2));
 
-  if (!tzto_.warmUpIndexOnOpen) {
+  if (!warmUpIndex) {
     MmapColdize(fstring(file_data.data(), file_data.size()));
   }
   for (fstring meta_item : meta_data_in_mmap) {
@@ -1348,6 +1592,27 @@ Status TerarkZipTableReader::Get(const ReadOptions& ro, const Slice& ikey,
   return subReader_.Get(global_seqno_, ro, ikey, get_context, flag);
 }
 
+bool TerarkZipTableReader::IndexHasKey(const Slice& user_key) const {
+  return subReader_.IndexHasKey(fstringOf(user_key));
+}
+
+void TerarkZipTableReader::MultiGet(const ReadOptions& ro, size_t num,
+                                    const Slice* ikeys,
+                                    GetContext** get_contexts,
+                                    Status* statuses,
+                                    const SliceTransform* /*prefix_extractor*/,
+                                    bool skip_filters) {
+  int flag = skip_filters ? TerarkZipSubReader::FlagSkipFilter
+                          : TerarkZipSubReader::FlagNone;
+  std::vector<size_t> indices(num);
+  for (size_t i = 0; i < num; ++i) {
+    indices[i] = i;
+    statuses[i] = Status::OK();
+  }
+  subReader_.MultiGet(global_seqno_, ro, indices.data(), num, ikeys,
+                      get_contexts, statuses, flag);
+}
+
 void TerarkZipTableReader::RangeScan(
     const Slice* begin, const SliceTransform* /*prefix_extractor*/, void* arg,
     bool (*callback_func)(void* arg, const Slice& key, LazyBuffer&& value)) {
@@ -1362,6 +1627,40 @@ void TerarkZipTableReader::RangeScan(
   }
 }
 
+namespace {
+// Walk the index of `subReader` and append every n-th key, at most `limit`
+void SampleSubReaderKeys(const TerarkZipSubReader& subReader, size_t limit,
+                         std::vector<std::string>* keys) {
+  const size_t numKeys = subReader.index_->NumKeys();
+  if (limit == 0 || numKeys <= 1) {
+    return;
+  }
+  const size_t stride = std::max<size_t>(1, numKeys / (limit + 1));
+  TerarkContext ctx;
+  valvec<byte_t> iterStorage;
+  iterStorage.swap(ctx.alloc(subReader.index_->IteratorSize()));
+  auto iter = subReader.index_->NewIterator(&iterStorage, &ctx);
+  size_t added = 0;
+  size_t i = 0;
+  for (bool ok = iter->SeekToFirst(); ok && added < limit; ok = iter->Next()) {
+    if (++i % stride != 0 || i == numKeys) {
+      continue;
+    }
+    InternalKey ikey(SliceOf(iter->key()), kMaxSequenceNumber,
+                     kValueTypeForSeek);
+    keys->emplace_back(ikey.Encode().ToString());
+    ++added;
+  }
+  call_destructor(iter);
+  ContextBuffer(std::move(iterStorage), &ctx);
+}
+}  // namespace
+
+void TerarkZipTableReader::GetSampleKeys(size_t limit,
+                                         std::vector<std::string>* keys) {
+  SampleSubReaderKeys(subReader_, limit, keys);
+}
+
 uint64_t TerarkZipTableReader::ApproximateOffsetOf(const Slice& ikey) {
   size_t numRecords = subReader_.index_->NumKeys();
   size_t rank = subReader_.DictRank(fstringOf(ExtractUserKey(ikey)));
@@ -1372,6 +1671,7 @@ uint64_t TerarkZipTableReader::ApproximateOffsetOf(const Slice& ikey) {
 }
 
 TerarkZipTableReader::~TerarkZipTableReader() {
+  CancelIndexWarmUp();
   if (subReader_.storeUsePread_) {
     if (subReader_.cache_) {
       subReader_.cache_->close(subReader_.storeFD_);
@@ -1425,8 +1725,9 @@ TerarkZipTableMultiReader::SubIndex::~SubIndex() {
 Status TerarkZipTableMultiReader::SubIndex::Init(
     fstring offsetMemory, const byte_t* baseAddress,
     AbstractBlobStore::Dictionary dict, int minPreadLen,
-    RandomAccessFile* fileObj, LruReadonlyCache* cache, uint64_t file_number,
-    bool warmUpIndexOnOpen, bool reverse) {
+    size_t minPinValueSize, RandomAccessFile* fileObj, LruReadonlyCache* cache,
+    uint64_t file_number, SequenceNumber largest_seqno, bool warmUpIndexOnOpen,
+    bool reverse) {
   TerarkZipMultiOffsetInfo offsetInfo;
   if (!offsetInfo.risk_set_memory(offsetMemory.data(), offsetMemory.size())) {
     return Status::Corruption("bad offset block");
@@ -1467,6 +1768,7 @@ Status TerarkZipTableMultiReader::SubIndex::Init(
         hasAnyZipOffset_ = true;
       }
       part.InitUsePread(minPreadLen);
+      part.minPinValueSize_ = minPinValueSize;
       assert(curr.type == 0 || bitfield_array<2>::compute_mem_size(
                                    part.index_->NumKeys()) == curr.type);
       offset += curr.value;
@@ -1476,6 +1778,7 @@ Status TerarkZipTableMultiReader::SubIndex::Init(
         offset += curr.type;
       }
       part.file_number_ = file_number;
+      part.largest_seqno_ = largest_seqno;
       if (part.storeUsePread_ && cache) {
         if (cache_fi_ < 0) {
           cache_fi_ = cache->open(fileFD);
@@ -1583,6 +1886,63 @@ Status TerarkZipTableMultiReader::Get(
   return subReader->Get(global_seqno_, ro, ikey, get_context, flag);
 }
 
+bool TerarkZipTableMultiReader::IndexHasKey(const Slice& user_key) const {
+  const TerarkZipSubReader* subReader =
+      isReverseBytewiseOrder_
+          ? subIndex_.LowerBoundSubReaderReverse(fstringOf(user_key))
+          : subIndex_.LowerBoundSubReader(fstringOf(user_key));
+  return subReader != nullptr && subReader->IndexHasKey(fstringOf(user_key));
+}
+
+void TerarkZipTableMultiReader::MultiGet(
+    const ReadOptions& ro, size_t num, const Slice* ikeys,
+    GetContext** get_contexts, Status* statuses,
+    const SliceTransform* /*prefix_extractor*/, bool skip_filters) {
+  int flag = skip_filters ? TerarkZipSubReader::FlagSkipFilter
+                          : TerarkZipSubReader::FlagNone;
+  // Route every key to its sub reader, then hand each sub reader all of its
+  // keys at once
+  std::vector<std::pair<size_t, size_t>> routed;  // (subIndex, key index)
+  std::vector<const TerarkZipSubReader*> subReaders(subIndex_.GetSubCount());
+  routed.reserve(num);
+  for (size_t i = 0; i < num; ++i) {
+    statuses[i] = Status::OK();
+    const Slice& ikey = ikeys[i];
+    if (ikey.size() < 8) {
+      statuses[i] =
+          Status::InvalidArgument("TerarkZipTableMultiReader::MultiGet()",
+                                  "param target.size() < 8 + PrefixLen");
+      continue;
+    }
+    const TerarkZipSubReader* subReader;
+    if (isReverseBytewiseOrder_) {
+      subReader = subIndex_.LowerBoundSubReaderReverse(
+          fstringOf(ikey).substr(0, ikey.size() - 8));
+    } else {
+      subReader = subIndex_.LowerBoundSubReader(
+          fstringOf(ikey).substr(0, ikey.size() - 8));
+    }
+    if (subReader == nullptr) {
+      continue;
+    }
+    subReaders[subReader->subIndex_] = subReader;
+    routed.emplace_back(subReader->subIndex_, i);
+  }
+  std::sort(routed.begin(), routed.end());
+  std::vector<size_t> indices(routed.size());
+  for (size_t i = 0; i < routed.size(); ++i) {
+    indices[i] = routed[i].second;
+  }
+  for (size_t beg = 0, end; beg < routed.size(); beg = end) {
+    size_t sub = routed[beg].first;
+    for (end = beg + 1; end < routed.size() && routed[end].first == sub;) {
+      ++end;
+    }
+    subReaders[sub]->MultiGet(global_seqno_, ro, indices.data() + beg,
+                              end - beg, ikeys, get_contexts, statuses, flag);
+  }
+}
+
 void TerarkZipTableMultiReader::RangeScan(
     const Slice* begin, const SliceTransform* /*prefix_extractor*/, void* arg,
     bool (*callback_func)(void* arg, const Slice& key, LazyBuffer&& value)) {
@@ -1597,6 +1957,32 @@ void TerarkZipTableMultiReader::RangeScan(
   }
 }
 
+void TerarkZipTableMultiReader::GetSampleKeys(
+    size_t limit, std::vector<std::string>* keys) {
+  size_t numKeys = 0;
+  for (size_t i = 0; i < subIndex_.GetSubCount(); ++i) {
+    numKeys += subIndex_.GetSubReader(i)->index_->NumKeys();
+  }
+  if (limit == 0 || numKeys == 0) {
+    return;
+  }
+  auto g_tctx = terark::GetTlsTerarkContext();
+  valvec<byte_t> buffer;
+  InternalKey ikey;
+  for (size_t i = 0; i < subIndex_.GetSubCount(); ++i) {
+    const TerarkZipSubReader* subReader = subIndex_.GetSubReader(i);
+    if (i > 0) {
+      // The first key of a part cuts the table between two parts
+      subReader->index_->MinKey(&buffer, g_tctx);
+      ikey.Set(SliceOf(fstring(buffer)), kMaxSequenceNumber,
+               kValueTypeForSeek);
+      keys->emplace_back(ikey.Encode().ToString());
+    }
+    SampleSubReaderKeys(*subReader,
+                        limit * subReader->index_->NumKeys() / numKeys, keys);
+  }
+}
+
 uint64_t TerarkZipTableMultiReader::ApproximateOffsetOf(const Slice& ikey) {
   fstring key = fstringOf(ExtractUserKey(ikey));
   const TerarkZipSubReader* subReader;
@@ -1631,7 +2017,9 @@ uint64_t TerarkZipTableMultiReader::ApproximateOffsetOf(const Slice& ikey) {
   return offset;
 }
 
-TerarkZipTableMultiReader::~TerarkZipTableMultiReader() {}
+TerarkZipTableMultiReader::~TerarkZipTableMultiReader() {
+  CancelIndexWarmUp();
+}
 
 TerarkZipTableMultiReader::TerarkZipTableMultiReader(
     const TerarkZipTableFactory* table_factory, const TableReaderOptions& tro,
@@ -1702,14 +2090,16 @@ Status TerarkZipTableMultiReader::Open(RandomAccessFileReader* file,
   if (global_seqno_ == kDisableGlobalSequenceNumber) {
     global_seqno_ = 0;
   }
+  const bool warmUpIndex = ShouldWarmUpIndex(tzto_);
   s = subIndex_.Init(
       fstringOf(offsetBlock.data), (const byte_t*)file_data.data(),
       tzto_.forceMetaInMemory
           ? AbstractBlobStore::Dictionary(fstringOf(dict), 0, false)
           : getVerifyDict(dict),
-      tzto_.minPreadLen, file_->file(), table_factory_->cache(),
-      table_reader_options_.file_number, tzto_.warmUpIndexOnOpen,
-      isReverseBytewiseOrder_);
+      tzto_.minPreadLen, tzto_.minPinValueSize, file_->file(),
+      table_factory_->cache(), table_reader_options_.file_number,
+      table_reader_options_.largest_seqno,
+      warmUpIndex && !tzto_.warmUpIndexInBackground, isReverseBytewiseOrder_);
   if (!s.ok()) {
     return s;
   }
@@ -1766,16 +2156,32 @@ Status TerarkZipTableMultiReader::Open(RandomAccessFileReader* file,
   }
   long long t0 = g_pf.now();
 
-  if (tzto_.warmUpIndexOnOpen) {
+  if (warmUpIndex) {
+    valvec<fstring> ranges;
+    if (tzto_.warmUpIndexInBackground) {
+      // The foreground warmed up the indexes in SubIndex::Init() otherwise
+      for (size_t i = 0; i < subIndex_.GetSubCount(); ++i) {
+        auto part = subIndex_.GetSubReader(i);
+        ranges.emplace_back(file_data.data() + part->rawReaderOffset_,
+                            part->storeOffset_ - part->rawReaderOffset_);
+      }
+    }
     if (!tzto_.warmUpValueOnOpen) {
-      MmapWarmUp(fstringOf(valueDictBlock.data));
+      ranges.push_back(fstringOf(valueDictBlock.data));
       for (size_t i = 0; i < subIndex_.GetSubCount(); ++i) {
         auto part = subIndex_.GetSubReader(i);
         for (fstring block : part->store_->get_meta_blocks()) {
-          MmapWarmUp(block);
+          ranges.push_back(block);
         }
       }
     }
+    if (tzto_.warmUpIndexInBackground) {
+      ScheduleIndexWarmUp(table_factory_, std::move(ranges));
+    } else {
+      for (fstring range : ranges) {
+        MmapWarmUp(range);
+      }
+    }
   }
   if (tzto_.warmUpValueOnOpen) {
     for (size_t i = 0; i < subIndex_.GetSubCount(); ++i) {
@@ -1812,7 +2218,7 @@ Status TerarkZipTableMultiReader::Open(RandomAccessFileReader* file,
        size_t(props->index_size), size_t(props->data_size), g_pf.sf(t0, t1),
        g_pf.sf(t1, t2));
 
-  if (!tzto_.warmUpIndexOnOpen) {
+  if (!warmUpIndex) {
     MmapColdize(fstring(file_data.data(), file_data.size()));
   }
   for (fstring meta_item : meta_data_in_mmap) {
@@ -61,12 +61,28 @@ class TerarkZipTableReaderBase : public TableReader, boost::noncopyable {
   TerarkZipTableReaderBase(const TableReaderOptions& tro)
       : table_reader_options_(tro) {}
 
+  // Whether to warm up the index of this file on open, see
+  // TerarkZipTableOptions::warmUpIndexMaxLevel
+  bool ShouldWarmUpIndex(const TerarkZipTableOptions& tzto) const;
+
+  // Queue the warm-up of `ranges` of the file, see warmUpIndexInBackground
+  void ScheduleIndexWarmUp(const TerarkZipTableFactory* table_factory,
+                           valvec<fstring>&& ranges);
+  // Drop the queued warm-up, before the file is unmapped or compacted
+  void CancelIndexWarmUp();
+
+  std::shared_ptr<IndexWarmUpQueue::Task> index_warm_up_task_;
+
  public:
   virtual FragmentedRangeTombstoneIterator* NewRangeTombstoneIterator(
       const ReadOptions& read_options) override;
 
   std::shared_ptr<const TableProperties> GetTableProperties() const override;
 
+  // Whether the index has `user_key`, found without reading the value store.
+  // The entries of the key in the file may end with a deletion
+  virtual bool IndexHasKey(const Slice& user_key) const = 0;
+
   void MmapColdize(const void* addr, size_t len);
   void MmapColdize(terark::fstring mem) { MmapColdize(mem.data(), mem.size()); }
   template <class Vec>
@@ -109,6 +125,7 @@ class TerarkEmptyTableReader : public TerarkZipTableReaderBase {
              bool /*skip_filters*/) override {
     return Status::OK();
   }
+  bool IndexHasKey(const Slice& /*user_key*/) const override { return false; }
   void RangeScan(const Slice* /*begin*/,
                  const SliceTransform* /*prefix_extractor*/, void* /*arg*/,
                  bool (*/*callback_func*/)(void* arg, const Slice& key,
@@ -135,6 +152,8 @@ struct TerarkZipSubReader {
   size_t rawReaderOffset_;
   size_t rawReaderSize_;
   size_t estimateUnzipCap_;
+  // Get() gives values at least this long the decode buffer
+  size_t minPinValueSize_ = 8192;
   bool storeUsePread_;
   intptr_t storeFD_;
   RandomAccessFile* storeFileObj_;
@@ -143,6 +162,8 @@ struct TerarkZipSubReader {
   unique_ptr<terark::AbstractBlobStore> store_;
   bitfield_array<2> type_;
   uint64_t file_number_;
+  // A lookup of a sequence number at least this sees every entry of the file
+  SequenceNumber largest_seqno_ = kMaxSequenceNumber;
 
   enum {
     FlagNone = 0,
@@ -150,12 +171,23 @@ struct TerarkZipSubReader {
   };
 
   void InitUsePread(int minPreadLen);
+  // The offset of record `recId` in the file, estimated as if all records of
+  // the store were of the same size
+  uint64_t EstimateRecordOffset(size_t recId) const;
 
   void GetRecordAppend(size_t recId, valvec<byte_t>* tbuf) const;
   void GetRecordAppend(size_t recId, terark::BlobStore::CacheOffsets*) const;
 
   Status Get(SequenceNumber, const ReadOptions&, const Slice& key, GetContext*,
              int flag) const;
+  // Get() for keys ikeys[indices[0, num)], results go to the same slots of
+  // get_contexts and statuses
+  void MultiGet(SequenceNumber, const ReadOptions&, const size_t* indices,
+                size_t num, const Slice* ikeys, GetContext** get_contexts,
+                Status* statuses, int flag) const;
+  Status GetRecord(SequenceNumber, size_t recId, const Slice& key,
+                   GetContext*, TerarkContext*) const;
+  bool IndexHasKey(fstring user_key) const;
   size_t DictRank(fstring key) const;
 
   ~TerarkZipSubReader();
@@ -183,13 +215,24 @@ class TerarkZipTableReader : public TerarkZipTableReaderBase {
              GetContext* get_context, const SliceTransform* prefix_extractor,
              bool skip_filters) override;
 
+  void MultiGet(const ReadOptions& readOptions, size_t num, const Slice* keys,
+                GetContext** get_contexts, Status* statuses,
+                const SliceTransform* prefix_extractor,
+                bool skip_filters) override;
+
+  bool IndexHasKey(const Slice& user_key) const override;
+
   void RangeScan(const Slice* begin, const SliceTransform* prefix_extractor,
                  void* arg,
                  bool (*callback_func)(void* arg, const Slice& key,
                                        LazyBuffer&& value)) override;
 
   uint64_t ApproximateOffsetOf(const Slice& key) override;
-  void SetupForCompaction() override {}
+  void SetupForCompaction() override { CancelIndexWarmUp(); }
+
+  // Every n-th key of the index, so the samples are about the same number of
+  // records apart
+  void GetSampleKeys(size_t limit, std::vector<std::string>* keys) override;
 
   size_t ApproximateMemoryUsage() const override { return file_data_.size(); }
 
@@ -231,13 +274,23 @@ class TerarkZipTableMultiReader : public TerarkZipTableReaderBase {
              GetContext* get_context, const SliceTransform* prefix_extractor,
              bool skip_filters) override;
 
+  void MultiGet(const ReadOptions& readOptions, size_t num, const Slice* keys,
+                GetContext** get_contexts, Status* statuses,
+                const SliceTransform* prefix_extractor,
+                bool skip_filters) override;
+
+  bool IndexHasKey(const Slice& user_key) const override;
+
   void RangeScan(const Slice* begin, const SliceTransform* prefix_extractor,
                  void* arg,
                  bool (*callback_func)(void* arg, const Slice& key,
                                        LazyBuffer&& value)) override;
 
   uint64_t ApproximateOffsetOf(const Slice& key) override;
-  void SetupForCompaction() override {}
+  void SetupForCompaction() override { CancelIndexWarmUp(); }
+
+  // Samples of every part, as many as its share of the records
+  void GetSampleKeys(size_t limit, std::vector<std::string>* keys) override;
 
   size_t ApproximateMemoryUsage() const override { return file_data_.size(); }
 
@@ -267,8 +320,10 @@ class TerarkZipTableMultiReader : public TerarkZipTableReaderBase {
 
     Status Init(fstring offsetMemory, const byte_t* baseAddress,
                 terark::AbstractBlobStore::Dictionary dict, int minPreadLen,
-                RandomAccessFile* fileObj, LruReadonlyCache* cache,
-                uint64_t file_number, bool warmUpIndexOnOpen, bool reverse);
+                size_t minPinValueSize, RandomAccessFile* fileObj,
+                LruReadonlyCache* cache, uint64_t file_number,
+                SequenceNumber largest_seqno, bool warmUpIndexOnOpen,
+                bool reverse);
 
     size_t GetSubCount() const;
     const TerarkZipSubReader* GetSubReader(size_t i) const;
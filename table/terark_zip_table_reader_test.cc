@@ -10,12 +10,16 @@
 #include <functional>
 
 #include "db/db_test_util.h"
+#include "db/table_cache.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
 #include "rocksdb/iostats_context.h"
 #include "rocksdb/perf_context.h"
 #include "rocksdb/terark_namespace.h"
+#include "table/get_context.h"
+#include "table/table_reader.h"
 #include "table/terark_zip_table.h"
+#include "table/terark_zip_table_reader.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -562,6 +566,140 @@ class TerarkZipReaderTest : public DBTestBase {
     db->ReleaseSnapshot(s2);
     db->ReleaseSnapshot(s3);
   }
+  void MultiGetTest(bool rev, size_t count, uint32_t prefix) {
+    Options options = CurrentOptions();
+    TerarkZipTableOptions tzto;
+    tzto.keyPrefixLen = prefix;
+    tzto.localTempDir = dbname_;
+    options.allow_mmap_reads = true;
+    if (rev) {
+      options.comparator = ReverseBytewiseComparator();
+    } else {
+      options.comparator = BytewiseComparator();
+    }
+    options.table_factory.reset(NewTerarkZipTableFactory(tzto, nullptr));
+    DestroyAndReopen(options);
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_OK(db_->Put(WriteOptions(), get_key(i), get_value(i)));
+    }
+    ASSERT_OK(db_->Flush(FlushOptions()));
+
+    auto cfd = reinterpret_cast<ColumnFamilyHandleImpl*>(
+                   db_->DefaultColumnFamily())
+                   ->cfd();
+    auto& files = cfd->current()->storage_info()->LevelFiles(0);
+    ASSERT_EQ(1, files.size());
+    Cache::Handle* handle = nullptr;
+    ASSERT_OK(cfd->table_cache()->FindTable(EnvOptions(options), files[0]->fd,
+                                            &handle));
+    TableReader* reader = cfd->table_cache()->GetTableReaderFromHandle(handle);
+
+    // Shuffled keys, some of them missing
+    const size_t num = count + count / 4;
+    std::vector<size_t> ids(num);
+    std::vector<std::unique_ptr<LookupKey>> lkeys;
+    std::vector<Slice> ikeys;
+    std::vector<LazyBuffer> values(num);
+    std::vector<std::unique_ptr<GetContext>> contexts;
+    std::vector<GetContext*> context_ptrs;
+    for (size_t j = 0; j < num; ++j) {
+      ids[j] = j * 7919 % num;
+      lkeys.emplace_back(new LookupKey(get_key(ids[j]), kMaxSequenceNumber));
+      ikeys.push_back(lkeys.back()->internal_key());
+      contexts.emplace_back(new GetContext(
+          options.comparator, nullptr, nullptr, nullptr, GetContext::kNotFound,
+          lkeys.back()->user_key(), &values[j], nullptr, nullptr, nullptr,
+          nullptr, env_));
+      context_ptrs.push_back(contexts.back().get());
+    }
+    std::vector<Status> statuses(num);
+    reader->MultiGet(ReadOptions(), num, ikeys.data(), context_ptrs.data(),
+                     statuses.data(), nullptr);
+    for (size_t j = 0; j < num; ++j) {
+      ASSERT_OK(statuses[j]);
+      if (ids[j] < count) {
+        ASSERT_EQ(GetContext::kFound, contexts[j]->State());
+        ASSERT_OK(values[j].fetch());
+        ASSERT_EQ(get_value(ids[j]), values[j].ToString());
+      } else {
+        ASSERT_EQ(GetContext::kNotFound, contexts[j]->State());
+      }
+    }
+    cfd->table_cache()->ReleaseHandle(handle);
+  }
+  void KeyPresenceTest(bool rev, size_t count, uint32_t prefix) {
+    Options options = CurrentOptions();
+    TerarkZipTableOptions tzto;
+    tzto.keyPrefixLen = prefix;
+    tzto.localTempDir = dbname_;
+    options.allow_mmap_reads = true;
+    if (rev) {
+      options.comparator = ReverseBytewiseComparator();
+    } else {
+      options.comparator = BytewiseComparator();
+    }
+    options.table_factory.reset(NewTerarkZipTableFactory(tzto, nullptr));
+    DestroyAndReopen(options);
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_OK(db_->Put(WriteOptions(), get_key(i), get_value(i)));
+    }
+    ASSERT_OK(db_->Flush(FlushOptions()));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    for (size_t i = count / 2; i < count; ++i) {
+      ASSERT_OK(db_->Delete(WriteOptions(), get_key(i)));
+    }
+    ASSERT_OK(db_->Flush(FlushOptions()));
+
+    // The index of the newer file has the deleted keys
+    auto cfd = reinterpret_cast<ColumnFamilyHandleImpl*>(
+                   db_->DefaultColumnFamily())
+                   ->cfd();
+    auto& files = cfd->current()->storage_info()->LevelFiles(0);
+    ASSERT_EQ(2, files.size());
+    Cache::Handle* handle = nullptr;
+    ASSERT_OK(cfd->table_cache()->FindTable(EnvOptions(options), files[0]->fd,
+                                            &handle));
+    auto reader = static_cast<TerarkZipTableReaderBase*>(
+        cfd->table_cache()->GetTableReaderFromHandle(handle));
+    for (size_t i = 0; i < count + count / 4; ++i) {
+      ASSERT_EQ(i >= count / 2 && i < count, reader->IndexHasKey(get_key(i)));
+    }
+    cfd->table_cache()->ReleaseHandle(handle);
+
+    // Records of one entry each, seen whole by a lookup of the latest data,
+    // are answered without reading the value stores
+    SetPerfLevel(PerfLevel::kEnableTime);
+    get_perf_context()->Reset();
+    std::string value;
+    for (size_t i = 0; i < count + count / 4; ++i) {
+      Status s = db_->KeyExists(ReadOptions(), get_key(i));
+      bool may_exist = db_->KeyMayExist(ReadOptions(), get_key(i), &value);
+      if (i < count / 2) {
+        ASSERT_OK(s);
+        ASSERT_TRUE(may_exist);
+      } else {
+        ASSERT_TRUE(s.IsNotFound());
+        ASSERT_FALSE(may_exist);
+      }
+    }
+    ASSERT_GT(get_perf_context()->terark_zip_index_nanos, 0);
+    ASSERT_EQ(0, get_perf_context()->terark_zip_store_nanos);
+
+    // The sequence numbers decide what an older snapshot sees
+    ReadOptions ro;
+    ro.snapshot = snapshot;
+    for (size_t i = 0; i < count + count / 4; ++i) {
+      Status s = db_->KeyExists(ro, get_key(i));
+      if (i < count) {
+        ASSERT_OK(s);
+      } else {
+        ASSERT_TRUE(s.IsNotFound());
+      }
+    }
+    ASSERT_GT(get_perf_context()->terark_zip_store_nanos, 0);
+    SetPerfLevel(PerfLevel::kDisable);
+    db_->ReleaseSnapshot(snapshot);
+  }
 };
 
 TEST_F(TerarkZipReaderTest, BasicTest) { BasicTest(false, 1000, 0, 0, 0); }
@@ -570,6 +708,26 @@ TEST_F(TerarkZipReaderTest, BasicTestMulti) { BasicTest(false, 1000, 1, 0, 0); }
 TEST_F(TerarkZipReaderTest, BasicTestMultiRev) {
   BasicTest(true, 1000, 1, 0, 0);
 }
+TEST_F(TerarkZipReaderTest, MultiGetTest) { MultiGetTest(false, 1000, 0); }
+TEST_F(TerarkZipReaderTest, MultiGetTestRev) { MultiGetTest(true, 1000, 0); }
+TEST_F(TerarkZipReaderTest, MultiGetTestMulti) {
+  MultiGetTest(false, 1000, 1);
+}
+TEST_F(TerarkZipReaderTest, MultiGetTestMultiRev) {
+  MultiGetTest(true, 1000, 1);
+}
+TEST_F(TerarkZipReaderTest, KeyPresenceTest) {
+  KeyPresenceTest(false, 1000, 0);
+}
+TEST_F(TerarkZipReaderTest, KeyPresenceTestRev) {
+  KeyPresenceTest(true, 1000, 0);
+}
+TEST_F(TerarkZipReaderTest, KeyPresenceTestMulti) {
+  KeyPresenceTest(false, 1000, 1);
+}
+TEST_F(TerarkZipReaderTest, KeyPresenceTestMultiRev) {
+  KeyPresenceTest(true, 1000, 1);
+}
 TEST_F(TerarkZipReaderTest, BasicTestMultiUint) {
   BasicTest(false, 1000, 2, 0, 0);
 }
@@ -10,6 +10,7 @@
 #include "table/two_level_iterator.h"
 
 #include "db/version_edit.h"
+#include "monitoring/perf_context_imp.h"
 #include "rocksdb/options.h"
 #include "rocksdb/terark_namespace.h"
 #include "table/block.h"
@@ -294,6 +295,7 @@ class MapSstIterator final : public InternalIterator {
 
   void InitSecondLevelMinHeapImpl(const Slice& target, bool include) {
     assert(min_heap_.empty());
+    PERF_TIMER_GUARD(map_sst_seek_link_nanos);
     auto& icomp = min_heap_.comparator().internal_comparator();
     for (auto file_number : link_) {
       auto it = iterator_cache_.GetIterator(file_number);
@@ -335,6 +337,7 @@ class MapSstIterator final : public InternalIterator {
 
   void InitSecondLevelMaxHeapImpl(const Slice& target, bool include) {
     assert(max_heap_.empty());
+    PERF_TIMER_GUARD(map_sst_seek_link_nanos);
     auto& icomp = min_heap_.comparator().internal_comparator();
     for (auto file_number : link_) {
       auto it = iterator_cache_.GetIterator(file_number);
@@ -1,180 +1,480 @@
-#include "bloat_test.h"
+// Copyright (c) 2020-present, Bytedance Inc.  All rights reserved.
+// This source code is licensed under Apache 2.0 License.
+//
+// A long-running bench of the space the DB takes over time for a workload
+// of overwrites, deletes or expiring keys, and of what the GC costs to keep
+// it down. Every report interval a CSV row of the space amp, blob garbage,
+// GC IO, write amp (device write amp with ZenFS) and foreground latency is
+// written, to compare the `blob_gc_ratio` and `zenfs_*_gc_ratio` settings.
+//
+//   bloat_test --db_path=/data00/bt --workload=update --skew=0.99
+//       --blob_gc_ratio=0.05 --duration=86400 --csv=update.csv
+//
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
 
+#include <algorithm>
 #include <atomic>
-#include <chrono>
-#include <random>
+#include <cmath>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
-#include "options/db_options.h"
-#include "rocksdb/table.h"
+#include "monitoring/histogram.h"
+#include "port/port.h"
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/listener.h"
+#include "rocksdb/options.h"
+#include "rocksdb/statistics.h"
 #include "rocksdb/terark_namespace.h"
+#include "rocksdb/utilities/db_ttl.h"
 #include "rocksdb/utilities/options_util.h"
-#include "rocksdb/utilities/write_batch_with_index.h"
-#include "util/hash.h"
+#include "util/gflags_compat.h"
+#include "util/random.h"
+
+DEFINE_string(db_path, "/tmp/bloat_test", "data dir, destroyed first");
+DEFINE_string(options_file, "",
+              "options file of the DB and its default cf, as db.ini, "
+              "the defaults with kv separation if empty");
+DEFINE_string(workload, "update",
+              "update: overwrites of the keys; "
+              "delete: overwrites and deletes in --delete_ratio; "
+              "ttl: overwrites of the keys expiring after --ttl");
+DEFINE_uint64(num_keys, 10000000, "keys of the DB, all written first");
+DEFINE_uint64(key_size, 24, "key size");
+DEFINE_uint64(value_size, 16384, "mean value size");
+DEFINE_uint64(value_size_spread, 8192,
+              "values are of value_size +/- value_size_spread bytes");
+DEFINE_double(skew, 0.99,
+              "zipfian constant of the keys written, 0 for uniform");
+DEFINE_double(delete_ratio, 0.5, "ratio of the writes deleting a key");
+DEFINE_int32(ttl, 3600, "ttl of the keys of the ttl workload, in seconds");
+DEFINE_uint64(threads, 2, "writing threads");
+DEFINE_uint64(write_rate, 0,
+              "writes per second of all threads, 0 for unlimited");
+DEFINE_uint64(duration, 3600, "seconds of the workload after the load");
+DEFINE_uint64(report_interval, 10, "seconds between two CSV rows");
+DEFINE_string(csv, "", "CSV output file, stdout if empty");
+DEFINE_int64(blob_size, -1, "blob_size, the options' own if < 0");
+DEFINE_double(blob_gc_ratio, -1, "blob_gc_ratio, the options' own if < 0");
+DEFINE_double(zenfs_low_gc_ratio, -1,
+              "zenfs_low_gc_ratio, the options' own if < 0");
+DEFINE_double(zenfs_high_gc_ratio, -1,
+              "zenfs_high_gc_ratio, the options' own if < 0");
+DEFINE_double(zenfs_force_gc_ratio, -1,
+              "zenfs_force_gc_ratio, the options' own if < 0");
 
 namespace TERARKDB_NAMESPACE {
 
-uint64_t gene_seed() {
-  std::random_device rd;
-  return rd();
+namespace {
+enum Workload { kUpdate, kDelete, kTtl };
+
+void Check(const Status& s, const char* what) {
+  if (!s.ok()) {
+    fprintf(stderr, "bloat_test: %s: %s\n", what, s.ToString().c_str());
+    exit(1);
+  }
 }
 
-class BloatTest {
+// The keys of [0, num), the zipfian sequence of YCSB scrambled over the
+// key space, so that the hot keys are not next to each other
+class KeyGenerator {
  public:
-  std::string config_file_ = "";
-
-  DB *db_;
-  std::string db_name_ = "";
-  std::vector<TERARKDB_NAMESPACE::ColumnFamilyHandle *>
-      cf_handles_;  // size = 1
-
-  DB *db_ss_;
-  std::string db_ss_name_ = "";
-  std::vector<TERARKDB_NAMESPACE::ColumnFamilyHandle *>
-      cf_ss_handles_;  // size = 1
-
-  DB *db_ms_;
-  std::string db_ms_name_ = "";
-  std::vector<TERARKDB_NAMESPACE::ColumnFamilyHandle *>
-      cf_ms_handles_;  // size = 64
-
-  DBOptions db_options_;
-  ColumnFamilyDescriptor cf_desc_;
-
-  BloatTest(const std::string &conf_path, const std::string &&name,
-            const std::string &&ss_name, const std::string &&ms_name)
-      : config_file_(conf_path),
-        db_name_(name),
-        db_ss_name_(ss_name),
-        db_ms_name_(ms_name) {
-    std::vector<TERARKDB_NAMESPACE::ColumnFamilyDescriptor> cf_descs;
-
-    TERARKDB_NAMESPACE::Status s = TERARKDB_NAMESPACE::LoadOptionsFromFile(
-        config_file_,
-        Env::Default(),  // ?
-        &db_options_, &cf_descs,
-        false);  // ignore_unknown_options
-    if (!s.ok()) {
-      fprintf(stderr, "Load Option Error! %s\n", s.getState());
-      assert(false);
-    }
-
-    // get options from file
-    assert(cf_descs.size() == 1);
-    cf_desc_ = cf_descs[0];
-    db_options_.create_if_missing = true;
-    db_options_.create_missing_column_families = true;
+  KeyGenerator(uint64_t num, double theta) : num_(num), theta_(theta) {
+    if (theta_ > 0) {
+      for (uint64_t i = 1; i <= num_; ++i) {
+        zeta_n_ += 1 / std::pow(static_cast<double>(i), theta_);
+      }
+      double zeta_2 = 1 + 1 / std::pow(2.0, theta_);
+      alpha_ = 1 / (1 - theta_);
+      eta_ = (1 - std::pow(2.0 / num_, 1 - theta_)) / (1 - zeta_2 / zeta_n_);
+    }
+  }
+
+  uint64_t Next(Random64* rnd) const {
+    if (theta_ <= 0) {
+      return rnd->Uniform(num_);
+    }
+    double u = static_cast<double>(rnd->Next() >> 11) / (1ull << 53);
+    double uz = u * zeta_n_;
+    uint64_t rank;
+    if (uz < 1) {
+      rank = 0;
+    } else if (uz < 1 + std::pow(0.5, theta_)) {
+      rank = 1;
+    } else {
+      rank = static_cast<uint64_t>(num_ *
+                                   std::pow(eta_ * u - eta_ + 1, alpha_));
+    }
+    return (rank * 0x9E3779B97F4A7C15ull) % num_;
+  }
+
+ private:
+  const uint64_t num_;
+  const double theta_;
+  double zeta_n_ = 0;
+  double alpha_ = 0;
+  double eta_ = 0;
+};
+
+// The GC jobs, their IO is what the GC costs
+class GCListener : public EventListener {
+ public:
+  void OnCompactionCompleted(DB* /*db*/, const CompactionJobInfo& ci) override {
+    switch (ci.compaction_reason) {
+      case CompactionReason::kGarbageCollection:
+      case CompactionReason::kGarbageCollectionMarkForHigh:
+      case CompactionReason::kZNSGarbageCollection:
+      case CompactionReason::kZNSPartitionGarbageCollection:
+      case CompactionReason::kZNSHotGarbageCollection:
+      case CompactionReason::kZNSWarmGarbageCollection:
+        read_bytes_ += ci.stats.total_input_bytes;
+        write_bytes_ += ci.stats.total_output_bytes;
+        ++num_jobs_;
+        break;
+      default:
+        break;
+    }
+  }
+
+  uint64_t read_bytes() const { return read_bytes_.load(); }
+  uint64_t write_bytes() const { return write_bytes_.load(); }
+  uint64_t num_jobs() const { return num_jobs_.load(); }
 
+ private:
+  std::atomic<uint64_t> read_bytes_{0};
+  std::atomic<uint64_t> write_bytes_{0};
+  std::atomic<uint64_t> num_jobs_{0};
+};
+
+// The `write_bytes` of /proc/self/io, what the process made the block layer
+// write, 0 if not available
+uint64_t ProcWriteBytes() {
+  uint64_t bytes = 0;
+  FILE* f = fopen("/proc/self/io", "r");
+  if (f != nullptr) {
+    char line[128];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+      if (sscanf(line, "write_bytes: %" SCNu64, &bytes) == 1) {
+        break;
+      }
+    }
+    fclose(f);
+  }
+  return bytes;
+}
+
+double Ratio(uint64_t a, uint64_t b) {
+  return b == 0 ? 0 : static_cast<double>(a) / b;
+}
+
+class BloatTest {
+ public:
+  BloatTest()
+      : env_(Env::Default()),
+        keys_(FLAGS_num_keys, FLAGS_skew),
+        value_sizes_(FLAGS_num_keys),
+        write_times_(FLAGS_num_keys),
+        gc_listener_(new GCListener) {
+    if (FLAGS_workload == "update") {
+      workload_ = kUpdate;
+    } else if (FLAGS_workload == "delete") {
+      workload_ = kDelete;
+    } else if (FLAGS_workload == "ttl") {
+      workload_ = kTtl;
+    } else {
+      fprintf(stderr, "bloat_test: unknown workload %s\n",
+              FLAGS_workload.c_str());
+      exit(1);
+    }
+    for (uint64_t i = 0; i < FLAGS_num_keys; ++i) {
+      value_sizes_[i].store(0, std::memory_order_relaxed);
+      write_times_[i].store(0, std::memory_order_relaxed);
+    }
+    if (FLAGS_csv.empty()) {
+      csv_ = stdout;
+    } else {
+      csv_ = fopen(FLAGS_csv.c_str(), "w");
+      if (csv_ == nullptr) {
+        fprintf(stderr, "bloat_test: can't open %s\n", FLAGS_csv.c_str());
+        exit(1);
+      }
+    }
     OpenDB();
-  };
+  }
+
+  ~BloatTest() {
+    delete db_;
+    if (csv_ != stdout) {
+      fclose(csv_);
+    }
+  }
 
-  ~BloatTest(){};
+  void Run() {
+    fprintf(csv_,
+            "phase,seconds,writes,user_bytes,logical_bytes,live_sst_bytes,"
+            "blob_bytes,space_amp,blob_garbage_ratio,gc_jobs,gc_read_bytes,"
+            "gc_write_bytes,host_write_bytes,write_amp,proc_write_bytes,"
+            "zenfs_migrated_bytes,zenfs_garbage_ratio,device_write_amp,"
+            "p50_us,p99_us,max_us\n");
+    start_micros_ = env_->NowMicros();
+    // Every key once before the workload, so the space of the workload is
+    // measured against a full DB
+    RunPhase("load", 0);
+    RunPhase(FLAGS_workload.c_str(), FLAGS_duration);
+  }
 
+ private:
   void OpenDB() {
-    TERARKDB_NAMESPACE::Status s;
-
-    std::vector<TERARKDB_NAMESPACE::ColumnFamilyDescriptor> cf_descs;
-
-    // create single cf non-kv-split DB
-    cf_descs.push_back(cf_desc_);
-    s = DB::Open(db_options_, db_name_, cf_descs, &cf_handles_, &db_);
-    if (!s.ok()) {
-      fprintf(stderr, "Open Error! %s\n", s.getState());
-      assert(false);
-    }
-    assert(cf_handles_.size() == 1);
-
-    // create single cf kv-split DB
-    cf_descs[0].options.blob_size = 2048;  // 2k to turn on kv split
-    s = DB::Open(db_options_, db_ss_name_, cf_descs, &cf_ss_handles_, &db_ss_);
-    if (!s.ok()) {
-      fprintf(stderr, "Open Error! %s\n", s.getState());
-      assert(false);
-    }
-    assert(cf_ss_handles_.size() == 1);
-
-    // create multi cf kv-split DB
-    auto cfo = cf_descs.back().options;
-    for (int i = 1; i < 64; ++i) {
-      cf_descs.push_back(
-          ColumnFamilyDescriptor("mycf" + std::to_string(i), cfo));
-    }
-    s = DB::Open(db_options_, db_ms_name_, cf_descs, &cf_ms_handles_, &db_ms_);
-    if (!s.ok()) {
-      fprintf(stderr, "Open Error! %s\n", s.getState());
-      assert(false);
-    }
-    assert(cf_ms_handles_.size() == 64);
-  }
-
-  void WriteFunc() {
-    auto fill_kv = [&](uint64_t seed, std::string &k, std::string &v) {
-      std::mt19937_64 mt(seed);
-      auto uid = std::uniform_int_distribution<char>(0, 255);
-      auto klen = std::uniform_int_distribution<size_t>(50 - 10, 50 + 10);
-      auto vlen =
-          std::uniform_int_distribution<size_t>(46000 - 20000, 46000 + 20000);
-      k.resize(klen(mt));
-      v.resize(vlen(mt));
-      std::generate_n(k.begin(), k.size(), std::bind(uid, std::ref(mt)));
-      std::generate_n(v.begin(), v.size(), std::bind(uid, std::ref(mt)));
-    };
-    auto key_seed =
-        std::bind(std::uniform_int_distribution<uint64_t>(0, 12000000),
-                  std::mt19937_64(gene_seed()));
-
-    std::string key, value;
+    Options options;
+    if (FLAGS_options_file.empty()) {
+      options.blob_size = 2048;
+      options.blob_gc_ratio = 0.05;
+    } else {
+      DBOptions db_options;
+      std::vector<ColumnFamilyDescriptor> cf_descs;
+      Check(LoadOptionsFromFile(FLAGS_options_file, env_, &db_options,
+                                &cf_descs),
+            "load options");
+      options = Options(db_options, cf_descs.empty()
+                                        ? ColumnFamilyOptions()
+                                        : cf_descs[0].options);
+    }
+    if (FLAGS_blob_size >= 0) {
+      options.blob_size = static_cast<size_t>(FLAGS_blob_size);
+    }
+    if (FLAGS_blob_gc_ratio >= 0) {
+      options.blob_gc_ratio = FLAGS_blob_gc_ratio;
+    }
+    if (FLAGS_zenfs_low_gc_ratio >= 0) {
+      options.zenfs_low_gc_ratio = FLAGS_zenfs_low_gc_ratio;
+    }
+    if (FLAGS_zenfs_high_gc_ratio >= 0) {
+      options.zenfs_high_gc_ratio = FLAGS_zenfs_high_gc_ratio;
+    }
+    if (FLAGS_zenfs_force_gc_ratio >= 0) {
+      options.zenfs_force_gc_ratio = FLAGS_zenfs_force_gc_ratio;
+    }
+    options.create_if_missing = true;
+    options.statistics = CreateDBStatistics();
+    options.listeners.push_back(gc_listener_);
+    statistics_ = options.statistics;
+
+    DestroyDB(FLAGS_db_path, options);
+    if (workload_ == kTtl) {
+      // The ttl is in the table properties, the SSTs and blobs of the
+      // expired keys are dropped whole
+      DBWithTTL* db = nullptr;
+      Check(DBWithTTL::Open(options, FLAGS_db_path, &db, FLAGS_ttl,
+                            false /* read_only */,
+                            true /* use_ttl_extractor */),
+            "open");
+      db_ = db;
+    } else {
+      Check(DB::Open(options, FLAGS_db_path, &db_), "open");
+    }
+  }
+
+  // Writes every key once if `seconds` is 0, else for `seconds`
+  void RunPhase(const char* phase, uint64_t seconds) {
+    const uint64_t phase_start = env_->NowMicros();
+    const uint64_t phase_end = phase_start + seconds * 1000000;
+    const uint64_t phase_writes = num_writes_.load();
+    std::atomic<uint64_t> next_load_key{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < FLAGS_threads; ++t) {
+      threads.emplace_back([&, t] {
+        Random64 rnd(301 + t);
+        std::string value;
+        while (!done.load(std::memory_order_relaxed)) {
+          uint64_t key;
+          bool del = false;
+          if (seconds == 0) {
+            key = next_load_key.fetch_add(1);
+            if (key >= FLAGS_num_keys) {
+              break;
+            }
+          } else {
+            key = keys_.Next(&rnd);
+            del = workload_ == kDelete && rnd.Uniform(1000000) <
+                                              FLAGS_delete_ratio * 1000000;
+          }
+          WriteKey(key, del, &rnd, &value);
+          Throttle(phase_start, phase_writes);
+        }
+      });
+    }
+    uint64_t next_report = phase_start + FLAGS_report_interval * 1000000;
     for (;;) {
-      fill_kv(key_seed(), key, value);
-      fprintf(stderr, "key size: %u, value size: %u \n", key.size(),
-              value.size());
-
-      TERARKDB_NAMESPACE::Status s;
-      // only put
-      s = db_->Put(WriteOptions(), cf_handles_[0], Slice(key), Slice(value));
-      if (!s.ok()) {
-        fprintf(stderr, "Open Error! %s\n", s.getState());
-        assert(false);
+      env_->SleepForMicroseconds(100000);
+      uint64_t now = env_->NowMicros();
+      bool finished = seconds == 0 ? next_load_key.load() >= FLAGS_num_keys
+                                   : now >= phase_end;
+      if (finished || now >= next_report) {
+        Report(phase, now);
+        next_report = now + FLAGS_report_interval * 1000000;
       }
+      if (finished) {
+        break;
+      }
+    }
+    done = true;
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
 
-      s = db_ss_->Put(WriteOptions(), cf_ss_handles_[0], Slice(key),
-                      Slice(value));
-      if (!s.ok()) {
-        fprintf(stderr, "Open Error! %s\n", s.getState());
-        assert(false);
+  void WriteKey(uint64_t key, bool del, Random64* rnd, std::string* value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%0*" PRIu64,
+             static_cast<int>(std::min<uint64_t>(FLAGS_key_size, 24)), key);
+    std::string user_key(buf);
+    user_key.resize(FLAGS_key_size, 'k');
+    uint64_t size = 0;
+    uint64_t start = env_->NowMicros();
+    if (del) {
+      Check(db_->Delete(WriteOptions(), user_key), "delete");
+    } else {
+      size = FLAGS_value_size - FLAGS_value_size_spread +
+             rnd->Uniform(2 * FLAGS_value_size_spread + 1);
+      value->resize(size);
+      for (size_t i = 0; i < size; i += 8) {
+        uint64_t r = rnd->Next();
+        memcpy(&(*value)[i], &r, std::min<size_t>(8, size - i));
       }
+      Check(db_->Put(WriteOptions(), user_key, *value), "put");
+    }
+    uint64_t micros = env_->NowMicros() - start;
+    {
+      std::lock_guard<std::mutex> lock(latency_mutex_);
+      latency_.Add(micros);
+    }
+    value_sizes_[key].store(static_cast<uint32_t>(size),
+                            std::memory_order_relaxed);
+    write_times_[key].store(
+        static_cast<uint32_t>((start - start_micros_) / 1000000),
+        std::memory_order_relaxed);
+    num_writes_.fetch_add(1, std::memory_order_relaxed);
+    user_bytes_.fetch_add(FLAGS_key_size + size, std::memory_order_relaxed);
+  }
 
-      Slice slice_key(key);
-      s = db_ms_->Put(WriteOptions(),
-                      cf_ms_handles_[GetSliceHash(slice_key) % 64], slice_key,
-                      Slice(value));
-      if (!s.ok()) {
-        fprintf(stderr, "Open Error! %s\n", s.getState());
-        assert(false);
+  void Throttle(uint64_t phase_start, uint64_t phase_writes) {
+    if (FLAGS_write_rate == 0) {
+      return;
+    }
+    uint64_t writes =
+        num_writes_.load(std::memory_order_relaxed) - phase_writes;
+    uint64_t due = phase_start + writes * 1000000 / FLAGS_write_rate;
+    uint64_t now = env_->NowMicros();
+    if (due > now) {
+      env_->SleepForMicroseconds(static_cast<int>(due - now));
+    }
+  }
+
+  // The bytes of the keys a read finds now, of the keys not deleted nor
+  // expired
+  uint64_t LogicalBytes(uint64_t now) const {
+    uint64_t bytes = 0;
+    uint64_t now_seconds = (now - start_micros_) / 1000000;
+    for (uint64_t i = 0; i < FLAGS_num_keys; ++i) {
+      uint32_t size = value_sizes_[i].load(std::memory_order_relaxed);
+      if (size == 0) {
+        continue;
       }
+      if (workload_ == kTtl &&
+          now_seconds - write_times_[i].load(std::memory_order_relaxed) >=
+              static_cast<uint64_t>(FLAGS_ttl)) {
+        continue;
+      }
+      bytes += FLAGS_key_size + size;
     }
+    return bytes;
   }
 
- private:
-  /* data */
+  uint64_t IntProperty(const std::string& name) const {
+    uint64_t value = 0;
+    if (!db_->GetIntProperty(name, &value)) {
+      value = 0;
+    }
+    return value;
+  }
+
+  void Report(const char* phase, uint64_t now) {
+    uint64_t logical = LogicalBytes(now);
+    uint64_t user_bytes = user_bytes_.load();
+    uint64_t live_sst = IntProperty(DB::Properties::kLiveSstFilesSize);
+    uint64_t blob = IntProperty(DB::Properties::kLiveBlobFilesSize);
+    uint64_t blob_garbage =
+        IntProperty(DB::Properties::kEstimateBlobGarbageBytes);
+    // What the host wrote the DB files, the WAL included
+    uint64_t host = statistics_->getTickerCount(WAL_FILE_BYTES) +
+                    statistics_->getTickerCount(FLUSH_WRITE_BYTES) +
+                    statistics_->getTickerCount(COMPACT_WRITE_BYTES);
+    // The zone GC rewrites the valid data of the zones it resets, the
+    // device writes it in addition to what the host wrote
+    uint64_t migrated = IntProperty(DB::Properties::kZenFSGCMigratedBytes);
+    uint64_t zenfs_garbage = IntProperty(DB::Properties::kZenFSGarbageBytes);
+    uint64_t zenfs_capacity =
+        IntProperty(DB::Properties::kZenFSCapacityBytes);
+    HistogramData latency;
+    {
+      std::lock_guard<std::mutex> lock(latency_mutex_);
+      latency_.Data(&latency);
+      latency_.Clear();
+    }
+    fprintf(csv_,
+            "%s,%.1f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+            ",%" PRIu64 ",%.3f,%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+            ",%" PRIu64 ",%.3f,%" PRIu64 ",%" PRIu64 ",%.3f,%.3f,%.0f,%.0f,"
+            "%.0f\n",
+            phase, (now - start_micros_) / 1e6, num_writes_.load(), user_bytes,
+            logical, live_sst, blob, Ratio(live_sst, logical),
+            Ratio(blob_garbage, blob), gc_listener_->num_jobs(),
+            gc_listener_->read_bytes(), gc_listener_->write_bytes(), host,
+            Ratio(host, user_bytes), ProcWriteBytes(), migrated,
+            Ratio(zenfs_garbage, zenfs_capacity),
+            Ratio(host + migrated, user_bytes), latency.median,
+            latency.percentile99, latency.max);
+    fflush(csv_);
+  }
+
+  Env* env_;
+  Workload workload_ = kUpdate;
+  const KeyGenerator keys_;
+  // The value sizes of the keys as last written, 0 if deleted, and the
+  // seconds since the start they were written at
+  std::vector<std::atomic<uint32_t>> value_sizes_;
+  std::vector<std::atomic<uint32_t>> write_times_;
+  std::shared_ptr<GCListener> gc_listener_;
+  std::shared_ptr<Statistics> statistics_;
+  DB* db_ = nullptr;
+  FILE* csv_ = nullptr;
+  uint64_t start_micros_ = 0;
+  std::atomic<uint64_t> num_writes_{0};
+  std::atomic<uint64_t> user_bytes_{0};
+  // The foreground write latency of the current report interval
+  std::mutex latency_mutex_;
+  HistogramImpl latency_;
 };
+}  // namespace
 
 }  // namespace TERARKDB_NAMESPACE
 
-int main(int argc, char *argv[]) {
-  TERARKDB_NAMESPACE::BloatTest t("./db.ini", "/data00/bt/sn-bloatdb",
-                                  "/data01/bt/ss-bloatdb",
-                                  "/data04/bt/ms-bloatdb");
-
-  uint32_t thread_num = 2;
-  std::vector<std::thread> thread_vec;
-  for (int j = 0; j < thread_num; ++j) {
-    thread_vec.emplace_back(&TERARKDB_NAMESPACE::BloatTest::WriteFunc,
-                            std::ref(t));
+int main(int argc, char* argv[]) {
+  GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_num_keys < 2 || FLAGS_threads == 0 ||
+      FLAGS_value_size_spread >= FLAGS_value_size) {
+    fprintf(stderr,
+            "bloat_test: needs num_keys >= 2, threads > 0 and "
+            "value_size_spread < value_size\n");
+    return 1;
   }
-  for (auto &t : thread_vec) {
-    t.join();
-  }
-
+  TERARKDB_NAMESPACE::BloatTest test;
+  test.Run();
   return 0;
 }
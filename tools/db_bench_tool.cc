@@ -53,6 +53,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/iostats_context.h"
+#include "rocksdb/memory_allocator.h"
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/options.h"
 #include "rocksdb/perf_context.h"
@@ -135,7 +136,9 @@ DEFINE_string(
     "randomtransaction,"
     "randomreplacekeys,"
     "timeseries,"
-    "ycsb_load, ycsb_a, ycsb_b, ycsb_c, ycsb_d, ycsb_e",
+    "ycsb_load, ycsb_a, ycsb_b, ycsb_c, ycsb_d, ycsb_e,"
+    "zns_overwrite_skewed,"
+    "zns_ttl_churn",
 
     "Comma-separated list of operations to run in the specified"
     " order. Available benchmarks:\n"
@@ -196,7 +199,11 @@ DEFINE_string(
     "\trandomreplacekeys     -- randomly replaces N keys by deleting "
     "the old version and putting the new version\n\n"
     "\ttimeseries            -- 1 writer generates time series data "
-    "and multiple readers doing random reads on id\n\n"
+    "and multiple readers doing random reads on id\n"
+    "\tzns_overwrite_skewed  -- overwrite N values, most of them into a "
+    "small hot share of the keys, reporting the zone statistics\n"
+    "\tzns_ttl_churn         -- write N values into a sliding window of "
+    "keys, deleting the keys leaving it, reporting the zone statistics\n\n"
     "Meta operations:\n"
     "\tcompact     -- Compact the entire DB; If multiple, randomly choose one\n"
     "\tcompactall  -- Compact the entire DB\n"
@@ -371,6 +378,12 @@ DEFINE_int32(num_high_pri_threads, 0,
              "The maximum number of concurrent background compactions"
              " that can occur in parallel.");
 
+DEFINE_int32(thread_pool_steal_reserve, -1,
+             "If not negative, idle compaction threads run the queued "
+             "flushes, and idle flush threads run the queued compactions "
+             "while this many flush threads stay idle for the flushes. "
+             "Negative disables the stealing.");
+
 DEFINE_int32(num_low_pri_threads, 0,
              "The maximum number of concurrent background compactions"
              " that can occur in parallel.");
@@ -441,6 +454,10 @@ DEFINE_double(cache_high_pri_pool_ratio, 0.0,
 DEFINE_bool(use_clock_cache, false,
             "Replace default LRU block cache with clock cache.");
 
+DEFINE_bool(use_cache_pooling_allocator, false,
+            "Allocate the blocks of the LRU block cache from a pooling "
+            "allocator, which recycles the memory of the evicted blocks.");
+
 DEFINE_int64(simcache_size, -1,
              "Number of bytes to use as a simcache of "
              "uncompressed data. Nagative value disables simcache.");
@@ -469,6 +486,18 @@ DEFINE_bool(
     pin_top_level_index_and_filter, false,
     "Pin top-level index of partitioned index/filter blocks in block cache.");
 
+DEFINE_int32(pin_top_level_index_and_filter_max_level, -1,
+             "Only pin top-level index/filter blocks of files on levels up to "
+             "this one, -1 for all levels.");
+
+DEFINE_int32(pin_index_and_filter_partitions_max_level, -1,
+             "Pin all index/filter partitions of files on levels up to this "
+             "one in block cache, -1 for none.");
+
+DEFINE_double(prefetch_index_and_filter_hot_file_ratio, 1.0,
+              "Only prefetch index/filter blocks at open for this share of "
+              "the files read most.");
+
 DEFINE_int32(block_size,
              static_cast<int32_t>(
                  TERARKDB_NAMESPACE::BlockBasedTableOptions().block_size),
@@ -510,6 +539,11 @@ DEFINE_bool(use_data_block_hash_index, false,
             "instead of kDataBlockBinarySearch. "
             "This is valid if only we use BlockTable");
 
+DEFINE_bool(use_data_block_key_prefix, false,
+            "if use kDataBlockBinaryAndKeyPrefix "
+            "instead of kDataBlockBinarySearch. "
+            "This is valid if only we use BlockTable");
+
 DEFINE_double(data_block_hash_table_util_ratio, 0.75,
               "util ratio for data block hash index table. "
               "This is only valid if use_data_block_hash_index is "
@@ -518,6 +552,10 @@ DEFINE_double(data_block_hash_table_util_ratio, 0.75,
 DEFINE_int64(compressed_cache_size, -1,
              "Number of bytes to use as a cache of compressed data.");
 
+DEFINE_int64(secondary_cache_size, 0,
+             "If positive, the LRU block cache demotes the blocks it evicts "
+             "into a compressed secondary cache of this many bytes.");
+
 DEFINE_int64(row_cache_size, 0,
              "Number of bytes to use as a cache of individual rows"
              " (0 = disabled).");
@@ -756,6 +794,12 @@ DEFINE_bool(use_stderr_info_logger, false,
             "Write info logs to stderr instead of to LOG file. ");
 
 DEFINE_string(trace_file, "", "Trace workload to a file. ");
+DEFINE_int32(trace_replay_threads, 1,
+             "Threads issuing the operations of replay. The operations of a "
+             "key go to the same thread and keep their order.");
+DEFINE_double(trace_replay_fast_forward, 1.0,
+              "Replay divides the recorded intervals between the operations "
+              "by this. 0 replays as fast as possible.");
 
 static enum TERARKDB_NAMESPACE::CompressionType StringToCompressionType(
     const char* ctype) {
@@ -846,6 +890,9 @@ DEFINE_string(hdfs, "",
 #ifdef WITH_ZENFS
 DEFINE_string(zbd_path, "", "Path of zone block device.");
 DEFINE_string(aux_path, "", "Aux path for zenfs.");
+DEFINE_int32(zenfs_max_active_zones, 0,
+             "Active zone tokens shared by the writers of ZenFS, 0 leaves "
+             "the zones to ZenFS. See ZoneTokenOptions.");
 #endif
 
 static std::shared_ptr<TERARKDB_NAMESPACE::Env> env_guard;
@@ -937,6 +984,18 @@ DEFINE_bool(rate_limiter_auto_tuned, false,
             "Enable dynamic adjustment of rate limit according to demand for "
             "background I/O");
 
+DEFINE_bool(rate_limiter_zone_gc, false,
+            "(ZNS) Budget zone and blob GC migration I/O separately from flush "
+            "and compaction, following the zone free ratio");
+
+DEFINE_double(rate_limiter_min_gc_share, 0.1,
+              "Share of rate_limiter_bytes_per_sec granted to GC I/O when "
+              "free space is comfortable");
+
+DEFINE_double(rate_limiter_max_gc_share, 0.6,
+              "Share of rate_limiter_bytes_per_sec granted to GC I/O when "
+              "zones are scarce");
+
 DEFINE_bool(sine_write_rate, false, "Use a sine wave write_rate_limit");
 
 DEFINE_uint64(
@@ -982,9 +1041,44 @@ DEFINE_bool(enable_lazy_compaction, true, "Enable map or link compaction");
 DEFINE_uint64(blob_size, size_t(-1), "Key Value Separate blob size");
 
 DEFINE_double(blob_large_key_ratio, 1, "Key Value Separate large key ratio");
+DEFINE_bool(adaptive_blob_separation, false,
+            "Adapt the Key Value Separate thresholds to the write heat");
 
 DEFINE_double(blob_gc_ratio, 0.2, "Blob SST gc ratio");
 
+DEFINE_uint64(partition_num, 4, "Number of hash partitions of flushed blobs");
+
+DEFINE_bool(enable_hot_separation, true,
+            "Write hot and warm values into individual blobs on flush");
+
+DEFINE_uint64(hotness_sample_interval, 0,
+              "Sample one out of this many write batches into the hotness "
+              "oracle, 0 disables sampling");
+
+DEFINE_bool(hotness_sample_reads, false, "Also sample Get() keys");
+
+DEFINE_uint64(hot_block_sample_interval, 0,
+              "Sample one out of this many data block reads into the hot "
+              "block set of the table, 0 disables sampling");
+
+DEFINE_uint64(hot_block_set_persist_period_sec, 0,
+              "Persist the hot block sets every this many seconds and warm "
+              "the block cache with them on open, 0 disables it");
+
+DEFINE_bool(warm_block_cache_after_compaction, false,
+            "Load the hot blocks of the compaction inputs from the outputs");
+
+DEFINE_bool(lazy_open_deep_sst, false,
+            "Only open L0, L1 and map SSTs eagerly with max_open_files = -1");
+
+DEFINE_uint64(table_cache_memory_budget, 0,
+              "If non-zero, bound the table cache by table reader memory "
+              "instead of max_open_files");
+
+DEFINE_bool(pin_table_reader_on_first_access, false,
+            "Keep the table reader of an SST in its file metadata once it is "
+            "found in the table cache");
+
 DEFINE_uint64(target_blob_file_size, 0, "Blob file size");
 
 DEFINE_uint64(blob_file_defragment_size, 0, "Blob file defragment threshold");
@@ -1081,7 +1175,7 @@ static bool ValidatePrefixSize(const char* flagname, int32_t value) {
   return true;
 }
 DEFINE_int32(prefix_size, 0,
-             "control the prefix size for HashSkipList and "
+             "control the prefix size for HashSkipList, PrefixSkipList and "
              "plain table");
 DEFINE_int64(keys_per_prefix, 0,
              "control average number of keys generated "
@@ -1121,7 +1215,8 @@ enum RepFactory {
   kHashLinkedList,
   kCuckoo,
   kPatriciaTrie,
-  kHashDuaLinkedList
+  kHashDuaLinkedList,
+  kPrefixSkipList
 };
 
 static enum RepFactory StringToRepFactory(const char* ctype) {
@@ -1141,6 +1236,8 @@ static enum RepFactory StringToRepFactory(const char* ctype) {
     return kPatriciaTrie;
   else if (!strcasecmp(ctype, "hash_dualinkedlist"))
     return kHashDuaLinkedList;
+  else if (!strcasecmp(ctype, "prefix_skip_list"))
+    return kPrefixSkipList;
 
   fprintf(stdout, "Cannot parse memreptable %s\n", ctype);
   return kSkipList;
@@ -1149,6 +1246,9 @@ static enum RepFactory StringToRepFactory(const char* ctype) {
 static enum RepFactory FLAGS_rep_factory;
 DEFINE_string(memtablerep, "skip_list", "");
 DEFINE_int64(hash_bucket_count, 1024 * 1024, "hash bucket count");
+DEFINE_int32(memtable_shards, 0,
+             "If > 1, each memtable is made of this many reps of the "
+             "memtablerep, sharded by the hash of the user key");
 DEFINE_bool(use_plain_table, false,
             "if use plain table "
             "instead of block-based table format");
@@ -1190,6 +1290,27 @@ DEFINE_double(zenfs_low_gc_ratio, 0.25,
 
 DEFINE_double(zenfs_high_gc_ratio, 0.6, "");
 DEFINE_double(zenfs_force_gc_ratio, 0.9, "");
+DEFINE_bool(zenfs_zone_aligned_file_size, false,
+            "Cut the SST and blob files to fill the zones of the device, "
+            "overriding --target_file_size_base and "
+            "--target_blob_file_size.");
+DEFINE_bool(zenfs_gc_relocate_extents, true,
+            "Zone GC relocates the valid extents of the victim zones inside "
+            "ZenFS instead of compacting the zones.");
+
+DEFINE_double(zns_hot_key_ratio, 0.2,
+              "Share of the keys that are hot in zns_overwrite_skewed. The "
+              "hot keys are spread evenly over the key space.");
+DEFINE_double(zns_hot_write_ratio, 0.8,
+              "Share of the writes of zns_overwrite_skewed that go to the hot "
+              "keys");
+DEFINE_double(zns_churn_window_ratio, 0.5,
+              "Share of the keys alive in zns_ttl_churn. Every write deletes "
+              "the key that left the window, as if its TTL expired.");
+DEFINE_int32(zns_stats_interval_seconds, 10,
+             "Report the write amplification of the device, the zone resets, "
+             "the bytes migrated by zone GC and the free zone ratio that "
+             "often during the zns_* benchmarks (ZenFS only)");
 
 static const bool FLAGS_soft_rate_limit_dummy __attribute__((__unused__)) =
     RegisterFlagValidator(&FLAGS_soft_rate_limit, &ValidateRateLimit);
@@ -2248,7 +2369,10 @@ struct SharedState {
   long num_done;
   bool start;
 
-  SharedState() : cv(&mu), perf_level(FLAGS_perf_level) {}
+  // User bytes written by all threads of the zns_* benchmarks
+  std::atomic<uint64_t> zns_user_bytes;
+
+  SharedState() : cv(&mu), perf_level(FLAGS_perf_level), zns_user_bytes(0) {}
 };
 
 // Per-thread state for concurrent executions of the same benchmark.
@@ -2304,6 +2428,72 @@ class Duration {
   uint64_t start_at_;
 };
 
+#ifdef WITH_ZENFS
+// Implemented inside `env/env_zenfs.cc`
+void GetZoneStat(Env* env, BDZenFSStat& stat);
+
+// The device side of the zns_* benchmarks, taken from zone snapshots. The
+// bytes written to the device are the advance of the write pointers, and a
+// write pointer moving back is a zone reset. A zone reset and refilled past
+// its old write pointer between two reports is missed.
+class ZNSStatsReporter {
+ public:
+  ZNSStatsReporter(Env* env, DBImpl* db)
+      : env_(env),
+        db_(db),
+        start_micros_(env->NowMicros()),
+        start_migrated_bytes_(db->GetZoneGCMigratedBytes()) {
+    BDZenFSStat stat;
+    GetZoneStat(env_, stat);
+    for (const auto& zone : stat.zone_stats_) {
+      zone_wp_[zone.start_position] = zone.wp;
+    }
+  }
+
+  void Report(uint64_t user_bytes) {
+    BDZenFSStat stat;
+    GetZoneStat(env_, stat);
+    for (const auto& zone : stat.zone_stats_) {
+      auto ib = zone_wp_.emplace(zone.start_position, zone.start_position);
+      uint64_t& wp = ib.first->second;
+      if (zone.wp >= wp) {
+        device_bytes_ += zone.wp - wp;
+      } else {
+        ++zone_resets_;
+        device_bytes_ += zone.wp - zone.start_position;
+      }
+      wp = zone.wp;
+    }
+    auto zenfs_stat = db_->GetZenFSStatistics(stat);
+    double free_zone_ratio =
+        static_cast<double>(zenfs_stat.empty_zone_cnt) /
+        std::max<size_t>(1, stat.zone_stats_.size());
+    fprintf(stdout,
+            "[ZNS] %.1fs user %.1f MB device %.1f MB write-amp %.2f "
+            "zone-resets %" PRIu64 " gc-migrated %.1f MB free-zones %.3f\n",
+            (env_->NowMicros() - start_micros_) / 1000000.0,
+            user_bytes / 1048576.0, device_bytes_ / 1048576.0,
+            static_cast<double>(device_bytes_) /
+                std::max<uint64_t>(1, user_bytes),
+            zone_resets_,
+            (db_->GetZoneGCMigratedBytes() - start_migrated_bytes_) /
+                1048576.0,
+            free_zone_ratio);
+    fflush(stdout);
+  }
+
+ private:
+  Env* env_;
+  DBImpl* db_;
+  uint64_t start_micros_;
+  uint64_t start_migrated_bytes_;
+  // Write pointer of each zone at the last report, by zone start
+  std::unordered_map<uint64_t, uint64_t> zone_wp_;
+  uint64_t device_bytes_ = 0;
+  uint64_t zone_resets_ = 0;
+};
+#endif  // WITH_ZENFS
+
 class Benchmark {
  private:
   std::shared_ptr<Cache> cache_;
@@ -2512,6 +2702,9 @@ class Benchmark {
       case kHashDuaLinkedList:
         fprintf(stdout, "Memtablerep: hash_dualinkedlist\n");
         break;
+      case kPrefixSkipList:
+        fprintf(stdout, "Memtablerep: prefix_skip_list\n");
+        break;
     }
     fprintf(stdout, "Perf Level: %d\n", FLAGS_perf_level);
 
@@ -2659,9 +2852,20 @@ class Benchmark {
       }
       return cache;
     } else {
-      return NewLRUCache((size_t)capacity, FLAGS_cache_numshardbits,
-                         false /*strict_capacity_limit*/,
-                         FLAGS_cache_high_pri_pool_ratio);
+      std::shared_ptr<MemoryAllocator> allocator;
+      if (FLAGS_use_cache_pooling_allocator) {
+        PoolingAllocatorOptions allocator_options;
+        allocator_options.max_pooled_size = 4 * FLAGS_block_size;
+        Status s = NewPoolingMemoryAllocator(allocator_options, &allocator);
+        if (!s.ok()) {
+          fprintf(stderr, "Pooling allocator: %s\n", s.ToString().c_str());
+          exit(1);
+        }
+      }
+      return NewLRUCache(LRUCacheOptions(
+          (size_t)capacity, FLAGS_cache_numshardbits,
+          false /*strict_capacity_limit*/, FLAGS_cache_high_pri_pool_ratio,
+          allocator));
     }
   }
 
@@ -2689,6 +2893,18 @@ class Benchmark {
                 : ((FLAGS_writes > FLAGS_reads) ? FLAGS_writes : FLAGS_reads)),
         merge_keys_(FLAGS_merge_keys < 0 ? FLAGS_num : FLAGS_merge_keys),
         report_file_operations_(FLAGS_report_file_operations) {
+    if (FLAGS_secondary_cache_size > 0 && cache_ != nullptr) {
+      if (FLAGS_use_clock_cache) {
+        fprintf(stderr, "Clock cache has no secondary cache.\n");
+        exit(1);
+      }
+      LRUCacheOptions cache_options(
+          static_cast<size_t>(FLAGS_cache_size), FLAGS_cache_numshardbits,
+          false /*strict_capacity_limit*/, FLAGS_cache_high_pri_pool_ratio);
+      cache_options.secondary_cache = NewCompressedSecondaryCache(
+          static_cast<size_t>(FLAGS_secondary_cache_size));
+      cache_ = NewLRUCache(cache_options);
+    }
     // use simcache instead of cache
     if (FLAGS_simcache_size >= 0) {
       if (FLAGS_cache_numshardbits >= 1) {
@@ -3003,6 +3219,11 @@ class Benchmark {
         ycsb_type_ = YCSB_D;
       } else if (name == "ycsb_e") {
         method = &Benchmark::YCSBBenchmarkE;
+      } else if (name == "zns_overwrite_skewed") {
+        method = &Benchmark::ZNSOverwriteSkewed;
+      } else if (name == "zns_ttl_churn") {
+        fresh_db = true;
+        method = &Benchmark::ZNSTtlChurn;
         ycsb_type_ = YCSB_E;
       } else if (name == "readreverse") {
         method = &Benchmark::ReadReverse;
@@ -3123,7 +3344,9 @@ class Benchmark {
         PrintStats("rocksdb.sstables");
       } else if (name == "replay") {
         if (num_threads > 1) {
-          fprintf(stderr, "Multi-threaded replay is not yet supported\n");
+          fprintf(stderr,
+                  "Multi-threaded replay takes --trace_replay_threads, not "
+                  "--threads\n");
           exit(1);
         }
         if (FLAGS_trace_file == "") {
@@ -3591,6 +3814,8 @@ class Benchmark {
     options.zenfs_low_gc_ratio = FLAGS_zenfs_low_gc_ratio;
     options.zenfs_high_gc_ratio = FLAGS_zenfs_high_gc_ratio;
     options.zenfs_force_gc_ratio = FLAGS_zenfs_force_gc_ratio;
+    options.zenfs_zone_aligned_file_size = FLAGS_zenfs_zone_aligned_file_size;
+    options.zenfs_gc_relocate_extents = FLAGS_zenfs_gc_relocate_extents;
     if (FLAGS_prefix_size != 0) {
       options.prefix_extractor.reset(
           NewFixedPrefixTransform(FLAGS_prefix_size));
@@ -3668,11 +3893,22 @@ class Benchmark {
       case kHashDuaLinkedList:
         options.memtable_factory.reset(NewConcurrentHashDualListReqFactory());
         break;
+      case kPrefixSkipList:
+        options.memtable_factory.reset(
+            NewPrefixSkipListRepFactory(FLAGS_prefix_size));
+        break;
       default:
         fprintf(stderr, "Only skip list is supported in lite mode\n");
         exit(1);
 #endif  // ROCKSDB_LITE
     }
+#ifndef ROCKSDB_LITE
+    if (FLAGS_memtable_shards > 1) {
+      options.memtable_factory.reset(NewShardedRepFactory(
+          options.memtable_factory,
+          static_cast<size_t>(FLAGS_memtable_shards)));
+    }
+#endif  // ROCKSDB_LITE
     if (FLAGS_use_plain_table) {
 #ifndef ROCKSDB_LITE
       if (FLAGS_rep_factory != kPrefixHash &&
@@ -3750,6 +3986,10 @@ class Benchmark {
           FLAGS_pin_l0_filter_and_index_blocks_in_cache;
       block_based_options.pin_top_level_index_and_filter =
           FLAGS_pin_top_level_index_and_filter;
+      block_based_options.pin_top_level_index_and_filter_max_level =
+          FLAGS_pin_top_level_index_and_filter_max_level;
+      block_based_options.pin_index_and_filter_partitions_max_level =
+          FLAGS_pin_index_and_filter_partitions_max_level;
       if (FLAGS_cache_high_pri_pool_ratio > 1e-6) {  // > 0.0 + eps
         block_based_options.cache_index_and_filter_blocks_with_high_priority =
             true;
@@ -3770,6 +4010,10 @@ class Benchmark {
       if (FLAGS_use_data_block_hash_index) {
         block_based_options.data_block_index_type =
             TERARKDB_NAMESPACE::BlockBasedTableOptions::kDataBlockBinaryAndHash;
+      } else if (FLAGS_use_data_block_key_prefix) {
+        block_based_options.data_block_index_type =
+            TERARKDB_NAMESPACE::BlockBasedTableOptions::
+                kDataBlockBinaryAndKeyPrefix;
       } else {
         block_based_options.data_block_index_type =
             TERARKDB_NAMESPACE::BlockBasedTableOptions::kDataBlockBinarySearch;
@@ -3888,7 +4132,23 @@ class Benchmark {
     options.enable_lazy_compaction = FLAGS_enable_lazy_compaction;
     options.blob_size = FLAGS_blob_size;
     options.blob_large_key_ratio = FLAGS_blob_large_key_ratio;
+    options.adaptive_blob_separation = FLAGS_adaptive_blob_separation;
     options.blob_gc_ratio = FLAGS_blob_gc_ratio;
+    options.partition_num = FLAGS_partition_num;
+    options.enable_hot_separation = FLAGS_enable_hot_separation;
+    options.hotness_sample_interval =
+        static_cast<uint32_t>(FLAGS_hotness_sample_interval);
+    options.hotness_sample_reads = FLAGS_hotness_sample_reads;
+    options.hot_block_sample_interval =
+        static_cast<uint32_t>(FLAGS_hot_block_sample_interval);
+    options.hot_block_set_persist_period_sec =
+        static_cast<unsigned int>(FLAGS_hot_block_set_persist_period_sec);
+    options.warm_block_cache_after_compaction =
+        FLAGS_warm_block_cache_after_compaction;
+    options.lazy_open_deep_sst = FLAGS_lazy_open_deep_sst;
+    options.table_cache_memory_budget = FLAGS_table_cache_memory_budget;
+    options.pin_table_reader_on_first_access =
+        FLAGS_pin_table_reader_on_first_access;
     options.target_blob_file_size = FLAGS_target_blob_file_size;
     options.blob_file_defragment_size = FLAGS_blob_file_defragment_size;
     options.max_dependence_blob_overlap = FLAGS_max_dependence_blob_overlap;
@@ -3913,6 +4173,8 @@ class Benchmark {
     }
     options.max_successive_merges = FLAGS_max_successive_merges;
     options.report_bg_io_stats = FLAGS_report_bg_io_stats;
+    options.prefetch_index_and_filter_hot_file_ratio =
+        FLAGS_prefetch_index_and_filter_hot_file_ratio;
 
     // set universal style compaction configurations, if applicable
     if (FLAGS_universal_size_ratio != 0) {
@@ -4012,12 +4274,21 @@ class Benchmark {
                 "new_table_reader_for_compaction_inputs set\n");
         exit(1);
       }
-      options.rate_limiter.reset(NewGenericRateLimiter(
-          FLAGS_rate_limiter_bytes_per_sec, 100 * 1000 /* refill_period_us */,
-          10 /* fairness */,
-          FLAGS_rate_limit_bg_reads ? RateLimiter::Mode::kReadsOnly
-                                    : RateLimiter::Mode::kWritesOnly,
-          FLAGS_rate_limiter_auto_tuned));
+      if (FLAGS_rate_limiter_zone_gc) {
+        options.rate_limiter.reset(NewZoneGCRateLimiter(
+            FLAGS_rate_limiter_bytes_per_sec, FLAGS_rate_limiter_min_gc_share,
+            FLAGS_rate_limiter_max_gc_share,
+            100 * 1000 /* refill_period_us */, 10 /* fairness */,
+            FLAGS_rate_limit_bg_reads ? RateLimiter::Mode::kReadsOnly
+                                      : RateLimiter::Mode::kWritesOnly));
+      } else {
+        options.rate_limiter.reset(NewGenericRateLimiter(
+            FLAGS_rate_limiter_bytes_per_sec,
+            100 * 1000 /* refill_period_us */, 10 /* fairness */,
+            FLAGS_rate_limit_bg_reads ? RateLimiter::Mode::kReadsOnly
+                                      : RateLimiter::Mode::kWritesOnly,
+            FLAGS_rate_limiter_auto_tuned));
+      }
     }
 
     options.listeners.emplace_back(listener_);
@@ -4389,6 +4660,114 @@ class Benchmark {
 
   void YCSBBenchmarkE(ThreadState* thread) { DoYCSBBenchmark(thread, YCSB_E); }
 
+  enum ZNSWorkload {
+    ZNS_OVERWRITE_SKEWED,
+    ZNS_TTL_CHURN,
+  };
+
+  void ZNSOverwriteSkewed(ThreadState* thread) {
+    DoZNSWorkload(thread, ZNS_OVERWRITE_SKEWED);
+  }
+
+  void ZNSTtlChurn(ThreadState* thread) {
+    DoZNSWorkload(thread, ZNS_TTL_CHURN);
+  }
+
+  // Writes whose placement on the zones depends on the hotness of the keys,
+  // so hot separation and the zone GC tuning can be compared run by run.
+  // Thread 0 reports the zone statistics every zns_stats_interval_seconds.
+  void DoZNSWorkload(ThreadState* thread, ZNSWorkload workload) {
+    if (db_.db == nullptr) {
+      fprintf(stderr, "zns_* benchmarks need a single DB\n");
+      exit(1);
+    }
+    const int64_t num_ops = writes_ == 0 ? num_ : writes_;
+    Duration duration(FLAGS_duration, num_ops);
+    const uint64_t num_keys = std::max<int64_t>(1, num_);
+    // Every stride-th key is hot
+    const uint64_t hot_stride = std::max<uint64_t>(
+        1, static_cast<uint64_t>(1 / std::max(FLAGS_zns_hot_key_ratio, 1e-9)));
+    const uint64_t num_hot_keys = std::max<uint64_t>(1, num_keys / hot_stride);
+    const uint64_t hot_threshold =
+        static_cast<uint64_t>(FLAGS_zns_hot_write_ratio * 1000000);
+    const int64_t window = std::max<int64_t>(
+        1, static_cast<int64_t>(FLAGS_zns_churn_window_ratio * num_keys));
+
+#ifdef WITH_ZENFS
+    std::unique_ptr<ZNSStatsReporter> reporter;
+    const uint64_t report_interval_micros =
+        static_cast<uint64_t>(FLAGS_zns_stats_interval_seconds) * 1000000;
+    uint64_t next_report_micros = 0;
+    if (thread->tid == 0) {
+      reporter.reset(new ZNSStatsReporter(
+          FLAGS_env, static_cast_with_check<DBImpl, DB>(db_.db->GetRootDB())));
+      next_report_micros =
+          FLAGS_env->NowMicros() + report_interval_micros;
+    }
+#endif  // WITH_ZENFS
+
+    RandomGenerator gen;
+    WriteBatch batch;
+    Status s;
+    int64_t bytes = 0;
+    std::unique_ptr<const char[]> key_guard;
+    Slice key = AllocateKey(&key_guard);
+    // The churn of the threads interleaves over one sequence of keys
+    int64_t seq = thread->tid;
+    while (!duration.Done(1)) {
+      batch.Clear();
+      if (thread->shared->write_rate_limiter.get() != nullptr) {
+        thread->shared->write_rate_limiter->Request(
+            value_size_ + key_size_, Env::IO_HIGH, nullptr /* stats */,
+            RateLimiter::OpType::kWrite);
+        thread->stats.ResetLastOpTime();
+      }
+      if (workload == ZNS_OVERWRITE_SKEWED) {
+        uint64_t k;
+        if (thread->rand.Uniform(1000000) < hot_threshold) {
+          k = thread->rand.Uniform(num_hot_keys) * hot_stride;
+        } else {
+          k = thread->rand.Uniform(num_keys);
+        }
+        GenerateKeyFromInt(k, FLAGS_num, &key, -1);
+        batch.Put(key, gen.Generate(value_size_));
+      } else {
+        GenerateKeyFromInt(seq % num_keys, FLAGS_num, &key, -1);
+        batch.Put(key, gen.Generate(value_size_));
+        if (seq >= window) {
+          GenerateKeyFromInt((seq - window) % num_keys, FLAGS_num, &key,
+                             -1);
+          batch.Delete(key);
+        }
+        seq += FLAGS_threads;
+      }
+      bytes += value_size_ + key_size_;
+      s = db_.db->Write(write_options_, &batch);
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+      thread->stats.FinishedOps(&db_, db_.db, 1, kWrite);
+      thread->shared->zns_user_bytes.fetch_add(value_size_ + key_size_,
+                                               std::memory_order_relaxed);
+#ifdef WITH_ZENFS
+      if (reporter && FLAGS_env->NowMicros() >= next_report_micros) {
+        reporter->Report(
+            thread->shared->zns_user_bytes.load(std::memory_order_relaxed));
+        next_report_micros =
+            FLAGS_env->NowMicros() + report_interval_micros;
+      }
+#endif  // WITH_ZENFS
+    }
+#ifdef WITH_ZENFS
+    if (reporter) {
+      reporter->Report(
+          thread->shared->zns_user_bytes.load(std::memory_order_relaxed));
+    }
+#endif  // WITH_ZENFS
+    thread->stats.AddBytes(bytes);
+  }
+
   void WriteUniqueRandom(ThreadState* thread) {
     DoWrite(thread, UNIQUE_RANDOM);
   }
@@ -6344,10 +6723,15 @@ class Benchmark {
     }
     Replayer replayer(db_with_cfh->db, db_with_cfh->cfh,
                       std::move(trace_reader));
-    s = replayer.Replay();
+    ReplayOptions replay_options;
+    replay_options.num_threads =
+        static_cast<uint32_t>(std::max(1, FLAGS_trace_replay_threads));
+    replay_options.fast_forward = FLAGS_trace_replay_fast_forward;
+    ReplayStats replay_stats;
+    s = replayer.Replay(replay_options, &replay_stats);
     if (s.ok()) {
-      fprintf(stdout, "Replay started from trace_file: %s\n",
-              FLAGS_trace_file.c_str());
+      fprintf(stdout, "Replay started from trace_file: %s\n%s",
+              FLAGS_trace_file.c_str(), replay_stats.ToString().c_str());
     } else {
       fprintf(stderr, "Starting replay failed. Error: %s\n",
               s.ToString().c_str());
@@ -6438,6 +6822,15 @@ int db_bench_tool(int argc, char** argv) {
               s.ToString().c_str());
       exit(1);
     }
+    if (FLAGS_zenfs_max_active_zones > 0) {
+      ZoneTokenOptions zone_token_options;
+      zone_token_options.max_active_zones = FLAGS_zenfs_max_active_zones;
+      s = SetZoneTokenOptions(FLAGS_env, zone_token_options);
+      if (!s.ok()) {
+        fprintf(stderr, "Error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+    }
   }
 
 #endif  // WITH_ZENFS
@@ -6469,6 +6862,13 @@ int db_bench_tool(int argc, char** argv) {
                                   TERARKDB_NAMESPACE::Env::Priority::BOTTOM);
   FLAGS_env->SetBackgroundThreads(FLAGS_num_low_pri_threads,
                                   TERARKDB_NAMESPACE::Env::Priority::LOW);
+  if (FLAGS_thread_pool_steal_reserve >= 0) {
+    FLAGS_env->SetThreadPoolStealing(TERARKDB_NAMESPACE::Env::Priority::HIGH,
+                                     TERARKDB_NAMESPACE::Env::Priority::LOW, 0);
+    FLAGS_env->SetThreadPoolStealing(TERARKDB_NAMESPACE::Env::Priority::LOW,
+                                     TERARKDB_NAMESPACE::Env::Priority::HIGH,
+                                     FLAGS_thread_pool_steal_reserve);
+  }
   // Choose a location for the test database if none given with --db=<path>
   if (FLAGS_db.empty()) {
     std::string default_db_path;
@@ -26,6 +26,7 @@ int main() {
 // options :
 // --num_inserts = the num of inserts the first thread should perform.
 // --wal_ttl = the wal ttl for the run.
+// --change_feed_buffer_size = read the updates from the change feed instead.
 
 using namespace TERARKDB_NAMESPACE;
 
@@ -69,6 +70,33 @@ static void ReplicationThreadBody(void* arg) {
   DB* db = t->db;
   std::unique_ptr<TransactionLogIterator> iter;
   SequenceNumber currentSeqNum = 1;
+  if (db->GetOptions().change_feed_buffer_size > 0) {
+    std::unique_ptr<ChangeFeedIterator> feed_iter;
+    if (!db->NewChangeFeedIterator(currentSeqNum, &feed_iter).ok()) {
+      fprintf(stderr, "Could not open the change feed\n");
+      exit(1);
+    }
+    while (!t->stop.load(std::memory_order_acquire)) {
+      if (!feed_iter->WaitForUpdates(100 * 1000)) {
+        if (!feed_iter->status().ok()) {
+          fprintf(stderr, "Error in the change feed: %s\n",
+                  feed_iter->status().ToString().c_str());
+          exit(1);
+        }
+        continue;
+      }
+      for (; feed_iter->Valid();
+           feed_iter->Next(), t->no_read++, currentSeqNum++) {
+        BatchResult res = feed_iter->GetBatch();
+        if (res.sequence != currentSeqNum) {
+          fprintf(stderr, "Missed a seq no. b/w %ld and %ld\n",
+                  (long)currentSeqNum, (long)res.sequence);
+          exit(1);
+        }
+      }
+    }
+    return;
+  }
   while (!t->stop.load(std::memory_order_acquire)) {
     iter.reset();
     Status s;
@@ -96,6 +124,8 @@ DEFINE_uint64(wal_ttl_seconds, 1000, "the wal ttl for the run(in seconds)");
 DEFINE_uint64(wal_size_limit_MB, 10,
               "the wal size limit for the run"
               "(in MB)");
+DEFINE_uint64(change_feed_buffer_size, 0,
+              "read the updates from a change feed of this size");
 
 int main(int argc, const char** argv) {
   SetUsageMessage(
@@ -112,6 +142,8 @@ int main(int argc, const char** argv) {
   options.create_if_missing = true;
   options.WAL_ttl_seconds = FLAGS_wal_ttl_seconds;
   options.WAL_size_limit_MB = FLAGS_wal_size_limit_MB;
+  options.change_feed_buffer_size =
+      static_cast<size_t>(FLAGS_change_feed_buffer_size);
   DB* db;
   DestroyDB(default_db_path, options);
 
@@ -0,0 +1,694 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/db.h"
+#include "rocksdb/db_dump_tool.h"
+#include "rocksdb/env.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/sst_file_writer.h"
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/write_batch.h"
+#include "util/coding.h"
+#include "util/string_util.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+const char* kExportManifestName = "EXPORT";
+const char* kImportProgressName = "IMPORT_PROGRESS";
+const char* kDumpMagic = "ROCKDUMP";
+const char kDumpVersion[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+// The size of the writes of a dump chunk, and of the batches importing it
+const size_t kDumpBufferSize = 1 << 20;
+
+std::string ChunkName(int partition, uint64_t chunk,
+                      ExportOptions::ChunkFormat format) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%06d-%06" PRIu64 "%s", partition, chunk,
+           format == ExportOptions::kSstChunk ? ".sst" : ".dump");
+  return buf;
+}
+
+std::string PartitionProgressName(int partition) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "partition-%06d.progress", partition);
+  return buf;
+}
+
+// The files of an export and of the progress of an import are lines of a
+// name and a value, the keys are hex encoded
+typedef std::vector<std::pair<std::string, std::string>> Fields;
+
+void AppendField(std::string* data, const std::string& name,
+                 const std::string& value) {
+  data->append(name);
+  data->push_back(' ');
+  data->append(value);
+  data->push_back('\n');
+}
+
+Status ReadFields(Env* env, const std::string& fname, Fields* fields) {
+  std::string data;
+  Status s = ReadFileToString(env, fname, &data);
+  if (!s.ok()) {
+    return s;
+  }
+  fields->clear();
+  size_t pos = 0;
+  while (pos < data.size()) {
+    size_t end = data.find('\n', pos);
+    if (end == std::string::npos) {
+      return Status::Corruption("Truncated line", fname);
+    }
+    size_t space = data.find(' ', pos);
+    if (space == std::string::npos || space > end) {
+      return Status::Corruption("Malformed line", fname);
+    }
+    fields->emplace_back(data.substr(pos, space - pos),
+                         data.substr(space + 1, end - space - 1));
+    pos = end + 1;
+  }
+  return Status::OK();
+}
+
+// Write `data` to `fname` through a temporary file, a crash leaves either
+// the previous or the new contents
+Status WriteFileAtomically(Env* env, Directory* dir, const std::string& data,
+                           const std::string& fname) {
+  std::string tmp = fname + ".tmp";
+  Status s = WriteStringToFile(env, data, tmp, true /* should_sync */);
+  if (s.ok()) {
+    s = env->RenameFile(tmp, fname);
+  }
+  if (s.ok()) {
+    s = dir->Fsync();
+  }
+  return s;
+}
+
+// The partitions of an export, decided on its first run
+struct ExportManifest {
+  ExportOptions::ChunkFormat chunk_format = ExportOptions::kSstChunk;
+  // The partition i holds the keys in [boundaries[i - 1], boundaries[i])
+  std::vector<std::string> boundaries;
+
+  int num_partitions() const { return static_cast<int>(boundaries.size()) + 1; }
+
+  std::string Encode() const {
+    std::string data;
+    AppendField(&data, "version", "1");
+    AppendField(&data, "format",
+                chunk_format == ExportOptions::kSstChunk ? "sst" : "dump");
+    for (auto& boundary : boundaries) {
+      AppendField(&data, "boundary", Slice(boundary).ToString(true));
+    }
+    return data;
+  }
+
+  Status Decode(const Fields& fields) {
+    boundaries.clear();
+    for (auto& field : fields) {
+      if (field.first == "version") {
+        if (field.second != "1") {
+          return Status::NotSupported("Export version", field.second);
+        }
+      } else if (field.first == "format") {
+        if (field.second == "sst") {
+          chunk_format = ExportOptions::kSstChunk;
+        } else if (field.second == "dump") {
+          chunk_format = ExportOptions::kDumpChunk;
+        } else {
+          return Status::NotSupported("Chunk format", field.second);
+        }
+      } else if (field.first == "boundary") {
+        boundaries.emplace_back();
+        if (!Slice(field.second).DecodeHex(&boundaries.back())) {
+          return Status::Corruption("Boundary", field.second);
+        }
+      }
+    }
+    return Status::OK();
+  }
+};
+
+// The checkpoint of a partition, rewritten after each of its chunks
+struct PartitionProgress {
+  uint64_t num_chunks = 0;
+  // The last key of the last chunk
+  std::string last_key;
+  bool done = false;
+
+  std::string Encode() const {
+    std::string data;
+    AppendField(&data, "chunks", ToString(num_chunks));
+    AppendField(&data, "last", Slice(last_key).ToString(true));
+    AppendField(&data, "done", done ? "1" : "0");
+    return data;
+  }
+
+  Status Decode(const Fields& fields) {
+    for (auto& field : fields) {
+      if (field.first == "chunks") {
+        num_chunks = std::stoull(field.second);
+      } else if (field.first == "last") {
+        if (!Slice(field.second).DecodeHex(&last_key)) {
+          return Status::Corruption("Last key", field.second);
+        }
+      } else if (field.first == "done") {
+        done = field.second == "1";
+      }
+    }
+    return Status::OK();
+  }
+};
+
+Status ReadPartitionProgress(Env* env, const std::string& export_dir,
+                             int partition, PartitionProgress* progress) {
+  std::string fname = export_dir + "/" + PartitionProgressName(partition);
+  *progress = PartitionProgress();
+  Status s = env->FileExists(fname);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  }
+  Fields fields;
+  if (s.ok()) {
+    s = ReadFields(env, fname, &fields);
+  }
+  if (s.ok()) {
+    s = progress->Decode(fields);
+  }
+  return s;
+}
+
+// Cut the key space at the smallest keys of the live files, into partitions
+// of about as many bytes. A partition ends before a file once it holds its
+// share with half of the file.
+std::vector<std::string> PartitionBoundaries(DB* db,
+                                             const Comparator* comparator,
+                                             int num_partitions) {
+  std::vector<LiveFileMetaData> all_files;
+  db->GetLiveFilesMetaData(&all_files);
+  std::vector<LiveFileMetaData> files;
+  uint64_t total_size = 0;
+  for (auto& file : all_files) {
+    // The blob files are keyed as the files depending on them
+    if (file.level >= 0 &&
+        file.column_family_name == kDefaultColumnFamilyName) {
+      total_size += file.size;
+      files.push_back(std::move(file));
+    }
+  }
+  std::sort(files.begin(), files.end(),
+            [comparator](const LiveFileMetaData& a, const LiveFileMetaData& b) {
+              return comparator->Compare(a.smallestkey, b.smallestkey) < 0;
+            });
+  std::vector<std::string> boundaries;
+  uint64_t size = 0;
+  for (auto& file : files) {
+    uint64_t next_boundary =
+        total_size * (boundaries.size() + 1) / std::max(num_partitions, 1);
+    if (size + file.size / 2 >= next_boundary && size > 0 &&
+        static_cast<int>(boundaries.size()) + 1 < num_partitions &&
+        (boundaries.empty() ||
+         comparator->Compare(file.smallestkey, boundaries.back()) > 0)) {
+      boundaries.push_back(file.smallestkey);
+    }
+    size += file.size;
+  }
+  return boundaries;
+}
+
+// Writes the keys, in order, into a chunk of an export
+class ChunkWriter {
+ public:
+  virtual ~ChunkWriter() {}
+  virtual Status Open(const std::string& fname) = 0;
+  virtual Status Add(const Slice& key, const Slice& value) = 0;
+  virtual uint64_t FileSize() = 0;
+  // Sync the chunk
+  virtual Status Finish() = 0;
+};
+
+class SstChunkWriter : public ChunkWriter {
+ public:
+  explicit SstChunkWriter(const Options& options)
+      : writer_(EnvOptions(options), options) {}
+
+  Status Open(const std::string& fname) override {
+    return writer_.Open(fname);
+  }
+  Status Add(const Slice& key, const Slice& value) override {
+    return writer_.Put(key, value);
+  }
+  uint64_t FileSize() override { return writer_.FileSize(); }
+  Status Finish() override { return writer_.Finish(); }
+
+ private:
+  SstFileWriter writer_;
+};
+
+// A chunk of the dump format, which DbUndumpTool also loads
+class DumpChunkWriter : public ChunkWriter {
+ public:
+  explicit DumpChunkWriter(Env* env) : env_(env) {}
+
+  Status Open(const std::string& fname) override {
+    Status s = env_->NewWritableFile(fname, &file_, EnvOptions());
+    if (!s.ok()) {
+      return s;
+    }
+    static const char* kInfo = "{}";
+    buffer_.assign(kDumpMagic, 8);
+    buffer_.append(kDumpVersion, 8);
+    PutFixed32(&buffer_, static_cast<uint32_t>(strlen(kInfo)));
+    buffer_.append(kInfo);
+    return Status::OK();
+  }
+
+  Status Add(const Slice& key, const Slice& value) override {
+    PutFixed32(&buffer_, static_cast<uint32_t>(key.size()));
+    buffer_.append(key.data(), key.size());
+    PutFixed32(&buffer_, static_cast<uint32_t>(value.size()));
+    buffer_.append(value.data(), value.size());
+    return buffer_.size() >= kDumpBufferSize ? Flush() : Status::OK();
+  }
+
+  uint64_t FileSize() override { return file_size_ + buffer_.size(); }
+
+  Status Finish() override {
+    Status s = Flush();
+    if (s.ok()) {
+      s = file_->Sync();
+    }
+    if (s.ok()) {
+      s = file_->Close();
+    }
+    return s;
+  }
+
+ private:
+  Status Flush() {
+    Status s = file_->Append(buffer_);
+    file_size_ += buffer_.size();
+    buffer_.clear();
+    return s;
+  }
+
+  Env* env_;
+  std::unique_ptr<WritableFile> file_;
+  std::string buffer_;
+  uint64_t file_size_ = 0;
+};
+
+// Export the partition from its checkpoint, if any
+Status ExportPartition(DB* db, const Options& options,
+                       const ExportOptions& export_options,
+                       const ExportManifest& manifest, int partition,
+                       Directory* dir) {
+  Env* env = options.env;
+  const std::string& export_dir = export_options.export_dir;
+  PartitionProgress progress;
+  Status s = ReadPartitionProgress(env, export_dir, partition, &progress);
+  if (!s.ok() || progress.done) {
+    return s;
+  }
+  ReadOptions read_options;
+  read_options.fill_cache = false;
+  Slice upper_bound;
+  if (partition < static_cast<int>(manifest.boundaries.size())) {
+    upper_bound = manifest.boundaries[partition];
+    read_options.iterate_upper_bound = &upper_bound;
+  }
+  std::unique_ptr<Iterator> iter(db->NewIterator(read_options));
+  if (progress.num_chunks > 0) {
+    iter->Seek(progress.last_key);
+    if (iter->Valid() && iter->key() == progress.last_key) {
+      iter->Next();
+    }
+  } else if (partition > 0) {
+    iter->Seek(manifest.boundaries[partition - 1]);
+  } else {
+    iter->SeekToFirst();
+  }
+  const std::string progress_fname =
+      export_dir + "/" + PartitionProgressName(partition);
+  while (s.ok() && iter->Valid()) {
+    std::string fname = export_dir + "/" +
+                        ChunkName(partition, progress.num_chunks,
+                                  manifest.chunk_format);
+    std::unique_ptr<ChunkWriter> writer;
+    if (manifest.chunk_format == ExportOptions::kSstChunk) {
+      writer.reset(new SstChunkWriter(options));
+    } else {
+      writer.reset(new DumpChunkWriter(env));
+    }
+    s = writer->Open(fname + ".tmp");
+    for (; s.ok() && iter->Valid() &&
+           writer->FileSize() < export_options.chunk_size;
+         iter->Next()) {
+      s = writer->Add(iter->key(), iter->value());
+      progress.last_key.assign(iter->key().data(), iter->key().size());
+    }
+    if (s.ok()) {
+      s = iter->status();
+    }
+    if (s.ok()) {
+      s = writer->Finish();
+    }
+    if (s.ok()) {
+      s = env->RenameFile(fname + ".tmp", fname);
+    }
+    if (s.ok()) {
+      ++progress.num_chunks;
+      progress.done = !iter->Valid();
+      s = WriteFileAtomically(env, dir, progress.Encode(), progress_fname);
+    }
+  }
+  if (s.ok()) {
+    s = iter->status();
+  }
+  if (s.ok() && !progress.done) {
+    // No key in the partition
+    progress.done = true;
+    s = WriteFileAtomically(env, dir, progress.Encode(), progress_fname);
+  }
+  return s;
+}
+
+// Run `work(i)` for i in [0, n) on `num_threads` threads, stopping at the
+// first error
+Status RunInParallel(size_t n, int num_threads,
+                     const std::function<Status(size_t)>& work) {
+  std::atomic<size_t> next(0);
+  std::mutex mutex;
+  Status result;
+  auto worker = [&] {
+    for (size_t i = next++; i < n; i = next++) {
+      Status s = work(i);
+      if (!s.ok()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result.ok()) {
+          result = s;
+        }
+        next = n;
+      }
+    }
+  };
+  std::vector<port::Thread> threads;
+  for (int t = 1; t < num_threads; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return result;
+}
+
+// Put the key and values of a dump chunk into the DB, syncing the WAL with
+// the last batch
+Status ImportDumpChunk(DB* db, Env* env, const std::string& fname) {
+  std::unique_ptr<SequentialFile> file;
+  Status s = env->NewSequentialFile(fname, &file, EnvOptions());
+  if (!s.ok()) {
+    return s;
+  }
+  char scratch8[8];
+  Slice slice;
+  s = file->Read(8, &slice, scratch8);
+  if (s.ok() && (slice.size() != 8 || memcmp(slice.data(), kDumpMagic, 8))) {
+    s = Status::Corruption("Not a dump file", fname);
+  }
+  if (s.ok()) {
+    s = file->Read(8, &slice, scratch8);
+  }
+  if (s.ok() && (slice.size() != 8 || memcmp(slice.data(), kDumpVersion, 8))) {
+    s = Status::NotSupported("Dump version", fname);
+  }
+  if (s.ok()) {
+    s = file->Read(4, &slice, scratch8);
+  }
+  if (s.ok() && slice.size() != 4) {
+    s = Status::Corruption("Truncated info blob", fname);
+  }
+  if (s.ok()) {
+    s = file->Skip(DecodeFixed32(slice.data()));
+  }
+  std::string key, value;
+  std::string scratch;
+  // Returns false at the end of the chunk or on an error
+  auto read_slice = [&](std::string* result) {
+    s = file->Read(4, &slice, scratch8);
+    if (!s.ok() || slice.size() != 4) {
+      return false;
+    }
+    uint32_t size = DecodeFixed32(slice.data());
+    scratch.resize(std::max<size_t>(size, 1));
+    s = file->Read(size, &slice, &scratch[0]);
+    if (s.ok() && slice.size() != size) {
+      s = Status::Corruption("Truncated entry", fname);
+    }
+    result->assign(slice.data(), slice.size());
+    return s.ok();
+  };
+  WriteBatch batch;
+  while (s.ok() && read_slice(&key)) {
+    if (!read_slice(&value)) {
+      if (s.ok()) {
+        s = Status::Corruption("Missing value", fname);
+      }
+      break;
+    }
+    batch.Put(key, value);
+    if (batch.GetDataSize() >= kDumpBufferSize) {
+      s = db->Write(WriteOptions(), &batch);
+      batch.Clear();
+    }
+  }
+  if (s.ok()) {
+    WriteOptions write_options;
+    write_options.sync = true;
+    s = db->Write(write_options, &batch);
+  }
+  return s;
+}
+}  // namespace
+
+bool DbExportTool::Run(const ExportOptions& export_options,
+                       TERARKDB_NAMESPACE::Options options) {
+  Env* env = options.env;
+  const std::string& export_dir = export_options.export_dir;
+  DB* dbptr;
+  options.create_if_missing = false;
+  Status s = DB::OpenForReadOnly(options, export_options.db_path, &dbptr);
+  if (!s.ok()) {
+    std::cerr << "Unable to open database '" << export_options.db_path
+              << "' for reading: " << s.ToString() << std::endl;
+    return false;
+  }
+  const std::unique_ptr<DB> db(dbptr);
+
+  std::unique_ptr<Directory> dir;
+  s = env->CreateDirIfMissing(export_dir);
+  if (s.ok()) {
+    s = env->NewDirectory(export_dir, &dir);
+  }
+  if (!s.ok()) {
+    std::cerr << "Unable to open export directory '" << export_dir
+              << "': " << s.ToString() << std::endl;
+    return false;
+  }
+
+  // A resumed export keeps the partitions and the format of its first run
+  ExportManifest manifest;
+  const std::string manifest_fname = export_dir + "/" + kExportManifestName;
+  if (env->FileExists(manifest_fname).ok()) {
+    Fields fields;
+    s = ReadFields(env, manifest_fname, &fields);
+    if (s.ok()) {
+      s = manifest.Decode(fields);
+    }
+  } else {
+    manifest.chunk_format = export_options.chunk_format;
+    manifest.boundaries = PartitionBoundaries(db.get(), options.comparator,
+                                              export_options.num_partitions);
+    s = WriteFileAtomically(env, dir.get(), manifest.Encode(), manifest_fname);
+  }
+  if (!s.ok()) {
+    std::cerr << "Unable to set up the export manifest: " << s.ToString()
+              << std::endl;
+    return false;
+  }
+
+  auto export_partition = [&](size_t partition) {
+    return ExportPartition(db.get(), options, export_options, manifest,
+                           static_cast<int>(partition), dir.get());
+  };
+  s = RunInParallel(manifest.num_partitions(), export_options.num_threads,
+                    export_partition);
+  if (!s.ok()) {
+    std::cerr << "Export failed, it resumes from its last chunks when run "
+              << "again: " << s.ToString() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool DbImportTool::Run(const ImportOptions& import_options,
+                       TERARKDB_NAMESPACE::Options options) {
+  Env* env = options.env;
+  const std::string& export_dir = import_options.export_dir;
+  ExportManifest manifest;
+  Fields fields;
+  Status s = ReadFields(env, export_dir + "/" + kExportManifestName, &fields);
+  if (s.ok()) {
+    s = manifest.Decode(fields);
+  }
+  if (!s.ok()) {
+    std::cerr << "Unable to read the export manifest of '" << export_dir
+              << "': " << s.ToString() << std::endl;
+    return false;
+  }
+
+  // The chunks in key order
+  std::vector<std::string> chunks;
+  for (int partition = 0; partition < manifest.num_partitions(); ++partition) {
+    PartitionProgress progress;
+    s = ReadPartitionProgress(env, export_dir, partition, &progress);
+    if (s.ok() && !progress.done) {
+      s = Status::Incomplete("Export not completed", export_dir);
+    }
+    if (!s.ok()) {
+      std::cerr << "Unable to import partition " << partition << ": "
+                << s.ToString() << std::endl;
+      return false;
+    }
+    for (uint64_t chunk = 0; chunk < progress.num_chunks; ++chunk) {
+      chunks.push_back(ChunkName(partition, chunk, manifest.chunk_format));
+    }
+  }
+
+  options.create_if_missing = true;
+  DB* dbptr;
+  s = DB::Open(options, import_options.db_path, &dbptr);
+  if (!s.ok()) {
+    std::cerr << "Unable to open database '" << import_options.db_path
+              << "' for writing: " << s.ToString() << std::endl;
+    return false;
+  }
+  const std::unique_ptr<DB> db(dbptr);
+
+  // The progress lists the imported chunks, one by line
+  std::string progress_fname = import_options.progress_path;
+  if (progress_fname.empty()) {
+    progress_fname = import_options.db_path + "/" + kImportProgressName;
+  }
+  std::set<std::string> imported;
+  if (env->FileExists(progress_fname).ok()) {
+    s = ReadFields(env, progress_fname, &fields);
+    for (auto& field : fields) {
+      imported.insert(field.second);
+    }
+  }
+  std::unique_ptr<WritableFile> progress_file;
+  if (s.ok()) {
+    s = env->ReopenWritableFile(progress_fname, &progress_file, EnvOptions());
+  }
+  if (!s.ok()) {
+    std::cerr << "Unable to open the import progress '" << progress_fname
+              << "': " << s.ToString() << std::endl;
+    return false;
+  }
+
+  // The chunks left, grouped by ingestion
+  std::vector<std::vector<std::string>> groups;
+  size_t group_size = manifest.chunk_format == ExportOptions::kSstChunk
+                          ? std::max(import_options.chunks_per_ingestion, 1)
+                          : 1;
+  for (auto& chunk : chunks) {
+    std::string fname = export_dir + "/" + chunk;
+    // A moved chunk missing from the progress was ingested before a crash
+    if (imported.count(chunk) > 0 ||
+        (import_options.move_files && env->FileExists(fname).IsNotFound())) {
+      continue;
+    }
+    if (groups.empty() || groups.back().size() >= group_size) {
+      groups.emplace_back();
+    }
+    groups.back().push_back(chunk);
+  }
+
+  std::mutex progress_mutex;
+  // The chunks are disjoint, they are ingested in any order
+  auto import_group = [&](size_t i) {
+    std::vector<std::string> fnames;
+    for (auto& chunk : groups[i]) {
+      fnames.push_back(export_dir + "/" + chunk);
+    }
+    Status st;
+    if (manifest.chunk_format == ExportOptions::kSstChunk) {
+      IngestExternalFileOptions ingest_options;
+      ingest_options.move_files = import_options.move_files;
+      st = db->IngestExternalFile(fnames, ingest_options);
+    } else {
+      st = ImportDumpChunk(db.get(), env, fnames.front());
+    }
+    if (!st.ok()) {
+      return st;
+    }
+    std::string data;
+    for (auto& chunk : groups[i]) {
+      AppendField(&data, "chunk", chunk);
+    }
+    std::lock_guard<std::mutex> lock(progress_mutex);
+    st = progress_file->Append(data);
+    if (st.ok()) {
+      st = progress_file->Sync();
+    }
+    return st;
+  };
+  s = RunInParallel(groups.size(), import_options.num_threads, import_group);
+  if (s.ok()) {
+    s = progress_file->Close();
+  }
+  if (!s.ok()) {
+    std::cerr << "Import failed, it resumes from the chunks not imported when "
+              << "run again: " << s.ToString() << std::endl;
+    return false;
+  }
+
+  if (import_options.compact_db) {
+    s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+    if (!s.ok()) {
+      std::cerr << "Unable to compact the database after the import: "
+                << s.ToString() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,224 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "db/db_test_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/db_dump_tool.h"
+#include "rocksdb/sst_file_reader.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class DbExportToolTest : public DBTestBase {
+ public:
+  DbExportToolTest() : DBTestBase("/db_export_tool_test") {
+    export_dir_ = dbname_ + "_export";
+    import_path_ = dbname_ + "_import";
+  }
+
+  ~DbExportToolTest() override {
+    DestroyDir(export_dir_);
+    DestroyDB(import_path_, Options());
+  }
+
+  // Four files of disjoint keys, the DB is closed for the export
+  void Fill() {
+    Options options = CurrentOptions();
+    options.disable_auto_compactions = true;
+    DestroyAndReopen(options);
+    Random rnd(301);
+    for (int file = 0; file < 4; ++file) {
+      for (int i = 0; i < 500; ++i) {
+        std::string key = Key(file * 500 + i);
+        expected_[key] = RandomString(&rnd, 100);
+        ASSERT_OK(Put(key, expected_[key]));
+      }
+      ASSERT_OK(Flush());
+    }
+    Close();
+  }
+
+  ExportOptions GetExportOptions(ExportOptions::ChunkFormat format) {
+    ExportOptions export_options;
+    export_options.db_path = dbname_;
+    export_options.export_dir = export_dir_;
+    export_options.chunk_format = format;
+    export_options.num_partitions = 4;
+    export_options.num_threads = 3;
+    export_options.chunk_size = 16 << 10;
+    return export_options;
+  }
+
+  ImportOptions GetImportOptions() {
+    ImportOptions import_options;
+    import_options.db_path = import_path_;
+    import_options.export_dir = export_dir_;
+    import_options.num_threads = 3;
+    import_options.chunks_per_ingestion = 2;
+    return import_options;
+  }
+
+  std::vector<std::string> Chunks() {
+    std::vector<std::string> children, chunks;
+    EXPECT_OK(env_->GetChildren(export_dir_, &children));
+    for (auto& child : children) {
+      if (child.find("-") == 6 && child.find(".tmp") == std::string::npos) {
+        chunks.push_back(child);
+      }
+    }
+    std::sort(chunks.begin(), chunks.end());
+    return chunks;
+  }
+
+  void VerifyImport() {
+    DB* db = nullptr;
+    ASSERT_OK(DB::OpenForReadOnly(Options(), import_path_, &db));
+    std::unique_ptr<DB> guard(db);
+    std::unique_ptr<Iterator> iter(db->NewIterator(ReadOptions()));
+    auto expected_iter = expected_.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++expected_iter) {
+      ASSERT_TRUE(expected_iter != expected_.end());
+      ASSERT_EQ(expected_iter->first, iter->key().ToString());
+      ASSERT_EQ(expected_iter->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(expected_iter == expected_.end());
+  }
+
+  void DestroyDir(const std::string& dir) {
+    std::vector<std::string> children;
+    if (env_->GetChildren(dir, &children).ok()) {
+      for (auto& child : children) {
+        env_->DeleteFile(dir + "/" + child);
+      }
+      env_->DeleteDir(dir);
+    }
+  }
+
+  std::string export_dir_;
+  std::string import_path_;
+  std::map<std::string, std::string> expected_;
+};
+
+TEST_F(DbExportToolTest, SstChunks) {
+  Fill();
+  DestroyDir(export_dir_);
+  ASSERT_TRUE(DbExportTool().Run(GetExportOptions(ExportOptions::kSstChunk),
+                                 CurrentOptions()));
+  std::vector<std::string> chunks = Chunks();
+  // The four partitions of several chunks
+  ASSERT_GT(chunks.size(), 4u);
+  ASSERT_EQ("000000-000000.sst", chunks.front());
+  ASSERT_EQ("000003-", chunks.back().substr(0, 7));
+
+  DestroyDB(import_path_, Options());
+  ASSERT_TRUE(DbImportTool().Run(GetImportOptions()));
+  VerifyImport();
+
+  // All the chunks are imported, running again ingests none of them
+  std::vector<LiveFileMetaData> files_before, files_after;
+  DB* db = nullptr;
+  ASSERT_OK(DB::Open(Options(), import_path_, &db));
+  db->GetLiveFilesMetaData(&files_before);
+  delete db;
+  ASSERT_TRUE(DbImportTool().Run(GetImportOptions()));
+  ASSERT_OK(DB::Open(Options(), import_path_, &db));
+  db->GetLiveFilesMetaData(&files_after);
+  delete db;
+  ASSERT_EQ(files_before.size(), files_after.size());
+  VerifyImport();
+}
+
+TEST_F(DbExportToolTest, Resume) {
+  Fill();
+  DestroyDir(export_dir_);
+  ExportOptions export_options = GetExportOptions(ExportOptions::kSstChunk);
+  ASSERT_TRUE(DbExportTool().Run(export_options, CurrentOptions()));
+  std::vector<std::string> chunks = Chunks();
+
+  // Interrupted after the first chunk of the partition 1
+  std::string progress;
+  ASSERT_OK(ReadFileToString(
+      env_, export_dir_ + "/partition-000001.progress", &progress));
+  ASSERT_NE(std::string::npos, progress.find("done 1\n"));
+  SstFileReader reader(CurrentOptions());
+  ASSERT_OK(reader.Open(export_dir_ + "/000001-000000.sst"));
+  std::unique_ptr<Iterator> iter(reader.NewIterator(ReadOptions()));
+  iter->SeekToLast();
+  ASSERT_TRUE(iter->Valid());
+  std::string last_key = iter->key().ToString(true /* hex */);
+  iter.reset();
+  ASSERT_OK(WriteStringToFile(env_,
+                              "chunks 1\nlast " + last_key + "\ndone 0\n",
+                              export_dir_ + "/partition-000001.progress"));
+  for (auto& chunk : chunks) {
+    if (chunk.compare(0, 7, "000001-") == 0 && chunk != "000001-000000.sst") {
+      ASSERT_OK(env_->DeleteFile(export_dir_ + "/" + chunk));
+    }
+  }
+  // The import asks for a completed export
+  DestroyDB(import_path_, Options());
+  ASSERT_FALSE(DbImportTool().Run(GetImportOptions()));
+
+  // The partition is exported from the key after the last one, the format
+  // and the partitions are kept
+  export_options.num_partitions = 2;
+  export_options.chunk_format = ExportOptions::kDumpChunk;
+  ASSERT_TRUE(DbExportTool().Run(export_options, CurrentOptions()));
+  ASSERT_EQ(chunks, Chunks());
+  ASSERT_TRUE(DbImportTool().Run(GetImportOptions()));
+  VerifyImport();
+}
+
+TEST_F(DbExportToolTest, DumpChunks) {
+  Fill();
+  DestroyDir(export_dir_);
+  ASSERT_TRUE(DbExportTool().Run(GetExportOptions(ExportOptions::kDumpChunk),
+                                 CurrentOptions()));
+  std::vector<std::string> chunks = Chunks();
+  ASSERT_GT(chunks.size(), 4u);
+  ASSERT_EQ(".dump", chunks.front().substr(chunks.front().size() - 5));
+
+  DestroyDB(import_path_, Options());
+  ASSERT_TRUE(DbImportTool().Run(GetImportOptions()));
+  VerifyImport();
+
+  // A chunk is a dump file
+  DestroyDB(import_path_, Options());
+  UndumpOptions undump_options;
+  undump_options.db_path = import_path_;
+  undump_options.dump_location = export_dir_ + "/" + chunks.front();
+  ASSERT_TRUE(DbUndumpTool().Run(undump_options));
+  DB* db = nullptr;
+  ASSERT_OK(DB::OpenForReadOnly(Options(), import_path_, &db));
+  std::string value;
+  ASSERT_OK(db->Get(ReadOptions(), Key(0), &value));
+  ASSERT_EQ(expected_[Key(0)], value);
+  delete db;
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+#else
+#include <stdio.h>
+
+int main(int /*argc*/, char** /*argv*/) {
+  fprintf(stderr, "SKIPPED as DbExportTool is not supported in ROCKSDB_LITE\n");
+  return 0;
+}
+
+#endif  // !ROCKSDB_LITE
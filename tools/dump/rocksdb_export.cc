@@ -0,0 +1,77 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#if !(defined GFLAGS) || defined(ROCKSDB_LITE)
+
+#include <cstdio>
+int main() {
+#ifndef GFLAGS
+  fprintf(stderr, "Please install gflags to run rocksdb tools\n");
+#endif
+#ifdef ROCKSDB_LITE
+  fprintf(stderr, "DbExportTool is not supported in ROCKSDB_LITE\n");
+#endif
+  return 1;
+}
+
+#else
+
+#include "rocksdb/convenience.h"
+#include "rocksdb/db_dump_tool.h"
+#include "util/gflags_compat.h"
+
+DEFINE_string(db_path, "", "Path to the db that will be exported");
+DEFINE_string(export_dir, "",
+              "Directory of the export, an interrupted export resumes in it");
+DEFINE_string(format, "sst", "Format of the chunks, sst or dump");
+DEFINE_int32(partitions, 64, "Number of key ranges the db is split into");
+DEFINE_int32(threads, 8, "Number of partitions exported at once");
+DEFINE_uint64(chunk_size, 256 << 20, "Size of the chunks in bytes");
+DEFINE_string(db_options, "",
+              "Options string used to open the database that will be exported");
+
+int main(int argc, char** argv) {
+  GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_db_path == "" || FLAGS_export_dir == "") {
+    fprintf(stderr, "Please set --db_path and --export_dir\n");
+    return 1;
+  }
+
+  TERARKDB_NAMESPACE::ExportOptions export_options;
+  export_options.db_path = FLAGS_db_path;
+  export_options.export_dir = FLAGS_export_dir;
+  if (FLAGS_format == "sst") {
+    export_options.chunk_format = TERARKDB_NAMESPACE::ExportOptions::kSstChunk;
+  } else if (FLAGS_format == "dump") {
+    export_options.chunk_format =
+        TERARKDB_NAMESPACE::ExportOptions::kDumpChunk;
+  } else {
+    fprintf(stderr, "Unknown --format %s\n", FLAGS_format.c_str());
+    return 1;
+  }
+  export_options.num_partitions = FLAGS_partitions;
+  export_options.num_threads = FLAGS_threads;
+  export_options.chunk_size = FLAGS_chunk_size;
+
+  TERARKDB_NAMESPACE::Options db_options;
+  if (FLAGS_db_options != "") {
+    TERARKDB_NAMESPACE::Options parsed_options;
+    TERARKDB_NAMESPACE::Status s = TERARKDB_NAMESPACE::GetOptionsFromString(
+        db_options, FLAGS_db_options, &parsed_options);
+    if (!s.ok()) {
+      fprintf(stderr, "Cannot parse provided db_options\n");
+      return 1;
+    }
+    db_options = parsed_options;
+  }
+
+  TERARKDB_NAMESPACE::DbExportTool tool;
+  if (!tool.Run(export_options, db_options)) {
+    return 1;
+  }
+  return 0;
+}
+#endif  // !(defined GFLAGS) || defined(ROCKSDB_LITE)
@@ -0,0 +1,73 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#if !(defined GFLAGS) || defined(ROCKSDB_LITE)
+
+#include <cstdio>
+int main() {
+#ifndef GFLAGS
+  fprintf(stderr, "Please install gflags to run rocksdb tools\n");
+#endif
+#ifdef ROCKSDB_LITE
+  fprintf(stderr, "DbImportTool is not supported in ROCKSDB_LITE\n");
+#endif
+  return 1;
+}
+
+#else
+
+#include "rocksdb/convenience.h"
+#include "rocksdb/db_dump_tool.h"
+#include "util/gflags_compat.h"
+
+DEFINE_string(export_dir, "", "Directory of the export that will be imported");
+DEFINE_string(db_path, "", "Path to the db the export will be imported into");
+DEFINE_string(progress_path, "",
+              "File of the chunks imported, IMPORT_PROGRESS in the db by "
+              "default");
+DEFINE_int32(threads, 8, "Number of chunks imported at once");
+DEFINE_int32(chunks_per_ingestion, 4,
+             "Number of SST chunks ingested together");
+DEFINE_bool(move_files, false, "Move the SST chunks into the db");
+DEFINE_bool(compact, false, "Compact the db after the import");
+DEFINE_string(db_options, "",
+              "Options string used to open the database that will be loaded");
+
+int main(int argc, char** argv) {
+  GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_db_path == "" || FLAGS_export_dir == "") {
+    fprintf(stderr, "Please set --db_path and --export_dir\n");
+    return 1;
+  }
+
+  TERARKDB_NAMESPACE::ImportOptions import_options;
+  import_options.db_path = FLAGS_db_path;
+  import_options.export_dir = FLAGS_export_dir;
+  import_options.progress_path = FLAGS_progress_path;
+  import_options.num_threads = FLAGS_threads;
+  import_options.chunks_per_ingestion = FLAGS_chunks_per_ingestion;
+  import_options.move_files = FLAGS_move_files;
+  import_options.compact_db = FLAGS_compact;
+
+  TERARKDB_NAMESPACE::Options db_options;
+  if (FLAGS_db_options != "") {
+    TERARKDB_NAMESPACE::Options parsed_options;
+    TERARKDB_NAMESPACE::Status s = TERARKDB_NAMESPACE::GetOptionsFromString(
+        db_options, FLAGS_db_options, &parsed_options);
+    if (!s.ok()) {
+      fprintf(stderr, "Cannot parse provided db_options\n");
+      return 1;
+    }
+    db_options = parsed_options;
+  }
+
+  TERARKDB_NAMESPACE::DbImportTool tool;
+  if (!tool.Run(import_options, db_options)) {
+    return 1;
+  }
+  return 0;
+}
+#endif  // !(defined GFLAGS) || defined(ROCKSDB_LITE)
@@ -15,6 +15,7 @@
 #ifdef WITH_BOOSTLIB
 #include <boost/range/algorithm.hpp>
 #endif
+#include <atomic>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
@@ -31,6 +32,7 @@
 #include "db/write_batch_internal.h"
 #include "port/dirent.h"
 #include "rocksdb/cache.h"
+#include "rocksdb/convenience.h"
 #include "rocksdb/table_properties.h"
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/utilities/backupable_db.h"
@@ -46,6 +48,7 @@
 #include "util/cast_util.h"
 #include "util/coding.h"
 #include "util/filename.h"
+#include "util/mutexlock.h"
 #include "util/stderr_logger.h"
 #include "util/string_util.h"
 #include "utilities/ttl/db_ttl_impl.h"
@@ -81,6 +84,7 @@ const std::string LDBCommand::ARG_WRITE_BUFFER_SIZE = "write_buffer_size";
 const std::string LDBCommand::ARG_FILE_SIZE = "file_size";
 const std::string LDBCommand::ARG_CREATE_IF_MISSING = "create_if_missing";
 const std::string LDBCommand::ARG_NO_VALUE = "no_value";
+const std::string LDBCommand::ARG_PARALLEL = "parallel";
 
 const char* LDBCommand::DELIM = " ==> ";
 
@@ -1897,6 +1901,13 @@ class InMemoryHandler : public WriteBatch::Handler {
     return Status::OK();
   }
 
+  virtual Status PutValueIndexCF(uint32_t cf, const Slice& key,
+                                 const Slice& /*index*/) override {
+    row_ << "PUT_VALUE_INDEX(" << cf << ") : ";
+    row_ << LDBCommand::StringToHex(key.ToString()) << " ";
+    return Status::OK();
+  }
+
   virtual Status MergeCF(uint32_t cf, const Slice& key,
                          const Slice& value) override {
     row_ << "MERGE(" << cf << ") : ";
@@ -2255,11 +2266,13 @@ ScanCommand::ScanCommand(const std::vector<std::string>& /*params*/,
           options, flags, true,
           BuildCmdLineOptions({ARG_TTL, ARG_NO_VALUE, ARG_HEX, ARG_KEY_HEX,
                                ARG_TO, ARG_VALUE_HEX, ARG_FROM, ARG_TIMESTAMP,
-                               ARG_MAX_KEYS, ARG_TTL_START, ARG_TTL_END})),
+                               ARG_MAX_KEYS, ARG_TTL_START, ARG_TTL_END,
+                               ARG_PARALLEL})),
       start_key_specified_(false),
       end_key_specified_(false),
       max_keys_scanned_(-1),
-      no_value_(false) {
+      no_value_(false),
+      parallel_(1) {
   std::map<std::string, std::string>::const_iterator itr =
       options.find(ARG_FROM);
   if (itr != options.end()) {
@@ -2300,6 +2313,12 @@ ScanCommand::ScanCommand(const std::vector<std::string>& /*params*/,
           ARG_MAX_KEYS + " has a value out-of-range");
     }
   }
+
+  if (ParseIntOption(options, ARG_PARALLEL, parallel_, exec_state_) &&
+      parallel_ < 1) {
+    exec_state_ =
+        LDBCommandExecuteResult::Failed(ARG_PARALLEL + " must be > 0.");
+  }
 }
 
 void ScanCommand::Help(std::string& ret) {
@@ -2312,22 +2331,201 @@ void ScanCommand::Help(std::string& ret) {
   ret.append(" [--" + ARG_TTL_START + "=<N>:- is inclusive]");
   ret.append(" [--" + ARG_TTL_END + "=<N>:- is exclusive]");
   ret.append(" [--" + ARG_NO_VALUE + "]");
+  ret.append(" [--" + ARG_PARALLEL + "=<num_threads>]");
   ret.append("\n");
 }
 
+bool ScanCommand::FormatEntry(Iterator* it, int ttl_start, int ttl_end,
+                              std::string* out) {
+  out->clear();
+  if (is_db_ttl_) {
+    TtlIterator* it_ttl = static_cast_with_check<TtlIterator, Iterator>(it);
+    int rawtime = it_ttl->timestamp();
+    if (rawtime < ttl_start || rawtime >= ttl_end) {
+      return false;
+    }
+    if (timestamp_) {
+      out->append(ReadableTime(rawtime));
+      out->push_back(' ');
+    }
+  }
+
+  Slice key_slice = it->key();
+
+  std::string formatted_key;
+  if (is_key_hex_) {
+    formatted_key = "0x" + key_slice.ToString(true /* hex */);
+    key_slice = formatted_key;
+  } else if (ldb_options_.key_formatter) {
+    formatted_key = ldb_options_.key_formatter->Format(key_slice);
+    key_slice = formatted_key;
+  }
+  out->append(key_slice.data(), key_slice.size());
+
+  if (!no_value_) {
+    Slice val_slice = it->value();
+    std::string formatted_value;
+    if (is_value_hex_) {
+      formatted_value = "0x" + val_slice.ToString(true /* hex */);
+      val_slice = formatted_value;
+    }
+    out->append(" : ");
+    out->append(val_slice.data(), val_slice.size());
+  }
+  out->push_back('\n');
+  return true;
+}
+
+void ScanCommand::DoParallelScan(int ttl_start, int ttl_end) {
+  ColumnFamilyHandle* cfh = GetCfHandle();
+  const Comparator* ucmp = cfh->GetComparator();
+  ColumnFamilyDescriptor cf_desc;
+  cfh->GetDescriptor(&cf_desc);
+  std::vector<LiveFileMetaData> metadata;
+  db_->GetLiveFilesMetaData(&metadata);
+  std::vector<std::string> cuts;
+  for (auto& file : metadata) {
+    if (file.column_family_name != cf_desc.name) {
+      continue;
+    }
+    if ((start_key_specified_ &&
+         ucmp->Compare(file.smallestkey, start_key_) <= 0) ||
+        (end_key_specified_ && file.smallestkey >= end_key_)) {
+      continue;
+    }
+    cuts.emplace_back(std::move(file.smallestkey));
+  }
+  std::sort(cuts.begin(), cuts.end(),
+            [ucmp](const std::string& a, const std::string& b) {
+              return ucmp->Compare(a, b) < 0;
+            });
+  cuts.erase(std::unique(cuts.begin(), cuts.end(),
+                         [ucmp](const std::string& a, const std::string& b) {
+                           return ucmp->Compare(a, b) == 0;
+                         }),
+             cuts.end());
+  // A few pieces per thread evens out the skew of the file sizes
+  size_t max_pieces = static_cast<size_t>(parallel_) * 4;
+  if (cuts.size() >= max_pieces) {
+    std::vector<std::string> picked;
+    for (size_t i = 1; i < max_pieces; ++i) {
+      picked.emplace_back(std::move(cuts[i * cuts.size() / max_pieces]));
+    }
+    cuts.swap(picked);
+  }
+
+  struct Piece {
+    std::string output;
+    // Where each entry of output ends, only kept with max_keys_scanned_
+    std::vector<size_t> entry_ends;
+    long long num_keys = 0;
+    Status status;
+    bool done = false;
+  };
+  std::vector<Piece> pieces(cuts.size() + 1);
+  port::Mutex mutex;
+  port::CondVar cv(&mutex);
+  size_t next_piece = 0;
+  size_t printed = 0;
+  bool stop = false;
+
+  auto scan = [&] {
+    MutexLock l(&mutex);
+    while (true) {
+      // Bounds the output held for printing
+      while (!stop && next_piece < pieces.size() &&
+             next_piece >= printed + 2 * static_cast<size_t>(parallel_)) {
+        cv.Wait();
+      }
+      if (stop || next_piece >= pieces.size()) {
+        break;
+      }
+      size_t i = next_piece++;
+      mutex.Unlock();
+      Piece& piece = pieces[i];
+      Slice upper;
+      ReadOptions ro;
+      if (i < cuts.size()) {
+        upper = cuts[i];
+        ro.iterate_upper_bound = &upper;
+      }
+      std::unique_ptr<Iterator> it(db_->NewIterator(ro, cfh));
+      if (i > 0) {
+        it->Seek(cuts[i - 1]);
+      } else if (start_key_specified_) {
+        it->Seek(start_key_);
+      } else {
+        it->SeekToFirst();
+      }
+      std::string entry;
+      for (; it->Valid() && (!end_key_specified_ ||
+                             it->key().ToString() < end_key_);
+           it->Next()) {
+        if (!FormatEntry(it.get(), ttl_start, ttl_end, &entry)) {
+          continue;
+        }
+        piece.output.append(entry);
+        if (max_keys_scanned_ >= 0) {
+          piece.entry_ends.push_back(piece.output.size());
+        }
+        piece.num_keys++;
+        if (max_keys_scanned_ >= 0 && piece.num_keys >= max_keys_scanned_) {
+          break;
+        }
+      }
+      piece.status = it->status();
+      mutex.Lock();
+      piece.done = true;
+      cv.SignalAll();
+    }
+  };
+  std::vector<port::Thread> threads;
+  for (int i = 0; i < parallel_; ++i) {
+    threads.emplace_back(scan);
+  }
+
+  long long num_keys_scanned = 0;
+  {
+    MutexLock l(&mutex);
+    for (; printed < pieces.size() && !stop; ++printed) {
+      Piece& piece = pieces[printed];
+      while (!piece.done) {
+        cv.Wait();
+      }
+      mutex.Unlock();
+      bool finished = false;
+      if (!piece.status.ok()) {
+        exec_state_ = LDBCommandExecuteResult::Failed(piece.status.ToString());
+        finished = true;
+      } else if (max_keys_scanned_ >= 0 &&
+                 num_keys_scanned + piece.num_keys >= max_keys_scanned_) {
+        size_t n = static_cast<size_t>(max_keys_scanned_ - num_keys_scanned);
+        size_t size = n == 0 ? 0 : piece.entry_ends[n - 1];
+        fwrite(piece.output.data(), 1, size, stdout);
+        num_keys_scanned = max_keys_scanned_;
+        finished = true;
+      } else {
+        fwrite(piece.output.data(), 1, piece.output.size(), stdout);
+        num_keys_scanned += piece.num_keys;
+      }
+      std::string().swap(piece.output);
+      std::vector<size_t>().swap(piece.entry_ends);
+      mutex.Lock();
+      stop = finished;
+      cv.SignalAll();
+    }
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
 void ScanCommand::DoCommand() {
   if (!db_) {
     assert(GetExecuteState().IsFailed());
     return;
   }
 
-  long long num_keys_scanned = 0;
-  Iterator* it = db_->NewIterator(ReadOptions(), GetCfHandle());
-  if (start_key_specified_) {
-    it->Seek(start_key_);
-  } else {
-    it->SeekToFirst();
-  }
   int ttl_start;
   if (!ParseIntOption(option_map_, ARG_TTL_START, ttl_start, exec_state_)) {
     ttl_start = DBWithTTLImpl::kMinTimestamp;  // TTL introduction time
@@ -2338,52 +2536,32 @@ void ScanCommand::DoCommand() {
   }
   if (ttl_end < ttl_start) {
     fprintf(stderr, "Error: End time can't be less than start time\n");
-    delete it;
     return;
   }
   if (is_db_ttl_ && timestamp_) {
     fprintf(stdout, "Scanning key-values from %s to %s\n",
             ReadableTime(ttl_start).c_str(), ReadableTime(ttl_end).c_str());
   }
+  if (parallel_ > 1) {
+    DoParallelScan(ttl_start, ttl_end);
+    return;
+  }
+
+  long long num_keys_scanned = 0;
+  Iterator* it = db_->NewIterator(ReadOptions(), GetCfHandle());
+  if (start_key_specified_) {
+    it->Seek(start_key_);
+  } else {
+    it->SeekToFirst();
+  }
+  std::string entry;
   for (;
        it->Valid() && (!end_key_specified_ || it->key().ToString() < end_key_);
        it->Next()) {
-    if (is_db_ttl_) {
-      TtlIterator* it_ttl = static_cast_with_check<TtlIterator, Iterator>(it);
-      int rawtime = it_ttl->timestamp();
-      if (rawtime < ttl_start || rawtime >= ttl_end) {
-        continue;
-      }
-      if (timestamp_) {
-        fprintf(stdout, "%s ", ReadableTime(rawtime).c_str());
-      }
-    }
-
-    Slice key_slice = it->key();
-
-    std::string formatted_key;
-    if (is_key_hex_) {
-      formatted_key = "0x" + key_slice.ToString(true /* hex */);
-      key_slice = formatted_key;
-    } else if (ldb_options_.key_formatter) {
-      formatted_key = ldb_options_.key_formatter->Format(key_slice);
-      key_slice = formatted_key;
-    }
-
-    if (no_value_) {
-      fprintf(stdout, "%.*s\n", static_cast<int>(key_slice.size()),
-              key_slice.data());
-    } else {
-      Slice val_slice = it->value();
-      std::string formatted_value;
-      if (is_value_hex_) {
-        formatted_value = "0x" + val_slice.ToString(true /* hex */);
-        val_slice = formatted_value;
-      }
-      fprintf(stdout, "%.*s : %.*s\n", static_cast<int>(key_slice.size()),
-              key_slice.data(), static_cast<int>(val_slice.size()),
-              val_slice.data());
+    if (!FormatEntry(it, ttl_start, ttl_end, &entry)) {
+      continue;
     }
+    fwrite(entry.data(), 1, entry.size(), stdout);
 
     num_keys_scanned++;
     if (max_keys_scanned_ >= 0 && num_keys_scanned >= max_keys_scanned_) {
@@ -2614,22 +2792,103 @@ CheckConsistencyCommand::CheckConsistencyCommand(
     const std::vector<std::string>& /*params*/,
     const std::map<std::string, std::string>& options,
     const std::vector<std::string>& flags)
-    : LDBCommand(options, flags, false, BuildCmdLineOptions({})) {}
+    : LDBCommand(options, flags, false, BuildCmdLineOptions({ARG_PARALLEL})),
+      parallel_(0) {
+  if (ParseIntOption(options, ARG_PARALLEL, parallel_, exec_state_) &&
+      parallel_ < 1) {
+    exec_state_ =
+        LDBCommandExecuteResult::Failed(ARG_PARALLEL + " must be > 0.");
+  }
+}
 
 void CheckConsistencyCommand::Help(std::string& ret) {
   ret.append("  ");
   ret.append(CheckConsistencyCommand::Name());
+  ret.append(" [--" + ARG_PARALLEL + "=<num_threads>]");
+  ret.append(" : with " + ARG_PARALLEL +
+             ", also verify the checksums of all table files");
   ret.append("\n");
 }
 
+Status CheckConsistencyCommand::VerifyTableFiles(
+    DB* db, const std::vector<ColumnFamilyHandle*>& handles) {
+  std::map<std::string, Options> cf_options;
+  for (auto handle : handles) {
+    cf_options[handle->GetName()] = db->GetOptions(handle);
+  }
+  std::vector<LiveFileMetaData> metadata;
+  db->GetLiveFilesMetaData(&metadata);
+
+  std::atomic<size_t> next_file{0};
+  port::Mutex mutex;
+  Status ret;
+  auto verify = [&] {
+    EnvOptions env_options;
+    for (size_t i = next_file++; i < metadata.size(); i = next_file++) {
+      const LiveFileMetaData& file = metadata[i];
+      std::string fname = file.db_path + file.name;
+      Status s = VerifySstFileChecksum(cf_options[file.column_family_name],
+                                       env_options, fname);
+      if (!s.ok()) {
+        MutexLock l(&mutex);
+        fprintf(stderr, "%s is corrupted: %s\n", fname.c_str(),
+                s.ToString().c_str());
+        if (ret.ok()) {
+          ret = s;
+        }
+      }
+    }
+  };
+  std::vector<port::Thread> threads;
+  for (int i = 0; i < parallel_; ++i) {
+    threads.emplace_back(verify);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  if (ret.ok()) {
+    fprintf(stdout, "Verified %" ROCKSDB_PRIszt " table files\n",
+            metadata.size());
+  }
+  return ret;
+}
+
 void CheckConsistencyCommand::DoCommand() {
   Options opt = PrepareOptionsForOpenDB();
   opt.paranoid_checks = true;
   if (!exec_state_.IsNotStarted()) {
     return;
   }
-  DB* db;
-  Status st = DB::OpenForReadOnly(opt, db_path_, &db, false);
+  DB* db = nullptr;
+  Status st;
+  if (parallel_ == 0) {
+    st = DB::OpenForReadOnly(opt, db_path_, &db, false);
+  } else {
+    // All column families are opened for their table options
+    std::vector<std::string> cf_names;
+    st = DB::ListColumnFamilies(opt, db_path_, &cf_names);
+    std::vector<ColumnFamilyDescriptor> cf_descs;
+    for (auto& name : cf_names) {
+      auto it = std::find_if(
+          column_families_.begin(), column_families_.end(),
+          [&name](const ColumnFamilyDescriptor& d) { return d.name == name; });
+      if (it != column_families_.end()) {
+        cf_descs.push_back(*it);
+      } else {
+        cf_descs.emplace_back(name, ColumnFamilyOptions(opt));
+      }
+    }
+    std::vector<ColumnFamilyHandle*> handles;
+    if (st.ok()) {
+      st = DB::OpenForReadOnly(opt, db_path_, cf_descs, &handles, &db, false);
+    }
+    if (st.ok()) {
+      st = VerifyTableFiles(db, handles);
+    }
+    for (auto handle : handles) {
+      db->DestroyColumnFamilyHandle(handle);
+    }
+  }
   delete db;
   if (st.ok()) {
     fprintf(stdout, "OK\n");
@@ -352,12 +352,22 @@ class ScanCommand : public LDBCommand {
   static void Help(std::string& ret);
 
  private:
+  // Formats the entry `it` is at into `out`, returns false if it's out of
+  // [ttl_start, ttl_end)
+  bool FormatEntry(Iterator* it, int ttl_start, int ttl_end,
+                   std::string* out);
+
+  // Cuts the key range at the smallest keys of the table files, scans the
+  // pieces on parallel_ threads and prints them in order
+  void DoParallelScan(int ttl_start, int ttl_end);
+
   std::string start_key_;
   std::string end_key_;
   bool start_key_specified_;
   bool end_key_specified_;
   long long max_keys_scanned_;
   bool no_value_;
+  int parallel_;
 };
 
 class DeleteCommand : public LDBCommand {
@@ -448,6 +458,13 @@ class CheckConsistencyCommand : public LDBCommand {
   virtual bool NoDBOpen() override { return true; }
 
   static void Help(std::string& ret);
+
+ private:
+  // Verifies the checksums of all table files of `db` on parallel_ threads
+  Status VerifyTableFiles(DB* db,
+                          const std::vector<ColumnFamilyHandle*>& handles);
+
+  int parallel_;
 };
 
 class CheckPointCommand : public LDBCommand {
@@ -4,6 +4,7 @@
 
 #include <rocksdb/db.h>
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <terark/util/linebuf.hpp>
@@ -21,7 +22,7 @@ class MyWorker : public TERARKDB_NAMESPACE::RemoteCompactionDispatcher::Worker {
   using TERARKDB_NAMESPACE::RemoteCompactionDispatcher::Worker::Worker;
 };
 
-int main() {
+int main(int argc, char** argv) {
   TERARKDB_NAMESPACE::EnvOptions env_options;
   MyWorker worker(env_options, TERARKDB_NAMESPACE::Env::Default());
 
@@ -35,6 +36,17 @@ int main() {
   // worker.RegistTablePropertiesCollectorFactory(
   //    std::shared_ptr<TablePropertiesCollectorFactory>);
 
+  // Launched by NewPersistentCompactionDispatcher, serve jobs until the
+  // dispatcher closes the connection
+  if (argc > 1 && strcmp(argv[1], "--serve") == 0) {
+    auto s = worker.Serve(0, 1);
+    if (!s.ok()) {
+      std::cerr << s.ToString() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   terark::LineBuf buf;
   buf.read_all(stdin);
   std::cout << worker.DoCompaction(TERARKDB_NAMESPACE::Slice(buf.p, buf.n));
@@ -45,3 +57,7 @@ int main() {
 // ----------------------------------------------
 // env TerarkZipTable_localTempDir=/tmp remote_compaction_worker_101
 // ----------------------------------------------
+// or as a persistent worker:
+// ----------------------------------------------
+// env TerarkZipTable_localTempDir=/tmp remote_compaction_worker_101 --serve
+// ----------------------------------------------
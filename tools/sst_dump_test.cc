@@ -16,6 +16,7 @@
 #include "rocksdb/terark_namespace.h"
 #include "table/block_based_table_factory.h"
 #include "table/table_builder.h"
+#include "tools/sst_dump_tool_imp.h"
 #include "util/file_reader_writer.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
@@ -206,6 +207,47 @@ TEST_F(SSTDumpToolTest, CompressedSizes) {
     delete[] usage[i];
   }
 }
+
+TEST_F(SSTDumpToolTest, ParallelCheck) {
+  table_options_.block_size = 256;
+  std::string file_path = MakeFilePath("rocksdb_sst_test.sst");
+  createSST(file_path, table_options_);
+
+  SstFileDumper dumper(file_path, true /* verify_checksum */,
+                       false /* output_hex */);
+  ASSERT_OK(dumper.getStatus());
+  std::vector<std::string> bounds;
+  dumper.GetSampleKeys(3, &bounds);
+  ASSERT_EQ(3, bounds.size());
+  // The pieces cover every entry once
+  uint64_t total_read = 0;
+  for (size_t i = 0; i <= bounds.size(); ++i) {
+    Slice lower = i > 0 ? Slice(bounds[i - 1]) : Slice();
+    Slice upper = i < bounds.size() ? Slice(bounds[i]) : Slice();
+    uint64_t num_read = 0;
+    ASSERT_OK(dumper.ReadRange(i > 0 ? &lower : nullptr,
+                               i < bounds.size() ? &upper : nullptr, false, 0,
+                               false, "", false, "", false, &num_read));
+    ASSERT_GT(num_read, 0);
+    total_read += num_read;
+  }
+  ASSERT_EQ(1024, total_read);
+  ASSERT_EQ(0, dumper.GetReadNumber());
+
+  for (const char* command : {"--command=check", "--command=verify"}) {
+    char* usage[4];
+    PopulateCommandArgs(file_path, command, usage);
+    snprintf(usage[3], optLength, "--parallel=4");
+
+    TERARKDB_NAMESPACE::SSTDumpTool tool;
+    ASSERT_TRUE(!tool.Run(4, usage));
+
+    for (int i = 0; i < 4; i++) {
+      delete[] usage[i];
+    }
+  }
+  cleanup(file_path);
+}
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -16,6 +16,8 @@
 #ifdef WITH_BOOSTLIB
 #include <boost/range/algorithm.hpp>
 #endif
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -43,6 +45,7 @@
 #include "table/plain_table_factory.h"
 #include "table/table_reader.h"
 #include "util/compression.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 
 #if !defined(_MSC_VER) && !defined(__APPLE__)
@@ -329,21 +332,43 @@ Status SstFileDumper::ReadSequential(bool print_kv, uint64_t read_num,
                                      bool has_from, const std::string& from_key,
                                      bool has_to, const std::string& to_key,
                                      bool use_from_as_prefix) {
+  uint64_t i = 0;
+  Status s = ReadRange(nullptr, nullptr, print_kv, read_num, has_from,
+                       from_key, has_to, to_key, use_from_as_prefix, &i);
+  read_num_ += i;
+  return s;
+}
+
+Status SstFileDumper::ReadRange(const Slice* lower, const Slice* upper,
+                                bool print_kv, uint64_t read_num,
+                                bool has_from, const std::string& from_key,
+                                bool has_to, const std::string& to_key,
+                                bool use_from_as_prefix, uint64_t* num_read) {
+  *num_read = 0;
   if (!table_reader_) {
     return init_result_;
   }
 
   InternalIterator* iter = table_reader_->NewIterator(
       ReadOptions(verify_checksum_, false), moptions_.prefix_extractor.get());
-  uint64_t i = 0;
+  uint64_t& i = *num_read;
+  InternalKey from_ikey;
   if (has_from) {
-    InternalKey ikey;
-    ikey.SetMinPossibleForUserKey(from_key);
-    iter->Seek(ikey.Encode());
+    from_ikey.SetMinPossibleForUserKey(from_key);
+  }
+  if (has_from && (lower == nullptr || internal_comparator_.Compare(
+                                           from_ikey.Encode(), *lower) > 0)) {
+    iter->Seek(from_ikey.Encode());
+  } else if (lower != nullptr) {
+    iter->Seek(*lower);
   } else {
     iter->SeekToFirst();
   }
   for (; iter->Valid(); iter->Next()) {
+    if (upper != nullptr &&
+        internal_comparator_.Compare(iter->key(), *upper) >= 0) {
+      break;
+    }
     ++i;
     if (read_num > 0 && i > read_num) break;
 
@@ -368,6 +393,7 @@ Status SstFileDumper::ReadSequential(bool print_kv, uint64_t read_num,
       LazyBuffer value = iter->value();
       auto s = value.fetch();
       if (!s.ok()) {
+        delete iter;
         return s;
       }
       fprintf(stdout, "%s => %s\n", ikey.DebugString(output_hex_).c_str(),
@@ -375,13 +401,18 @@ Status SstFileDumper::ReadSequential(bool print_kv, uint64_t read_num,
     }
   }
 
-  read_num_ += i;
-
   Status ret = iter->status();
   delete iter;
   return ret;
 }
 
+void SstFileDumper::GetSampleKeys(size_t limit,
+                                  std::vector<std::string>* keys) {
+  if (table_reader_) {
+    table_reader_->GetSampleKeys(limit, keys);
+  }
+}
+
 Status SstFileDumper::ReadTableProperties(
     std::shared_ptr<const TableProperties>* table_properties) {
   if (!table_reader_) {
@@ -446,14 +477,191 @@ void print_help() {
     --parse_internal_key=<0xKEY>
       Convenience option to parse an internal key on the command line. Dumps the
       internal key in hex format {'key' @ SN: type}
+
+    --parallel=<num_threads>
+      Run check|verify on this many threads. Files are processed concurrently,
+      and check also cuts the key range of each file into pieces, so a single
+      big file is read by all the threads. Cannot be used in conjunction with
+      --read_num, --show_properties or --show_summary
 )");
 }
 
+// Runs the check or verify command over a list of files on a number of
+// threads. The threads open the files as they go; the key range of a file to
+// check is cut at its sample keys, and the pieces are shared by all threads.
+class ParallelSstChecker {
+ public:
+  struct Args {
+    bool verify = false;
+    bool verify_checksum = false;
+    bool output_hex = false;
+    bool has_from = false;
+    bool has_to = false;
+    bool use_from_as_prefix = false;
+    std::string from_key;
+    std::string to_key;
+  };
+
+  ParallelSstChecker(const std::vector<std::string>& filenames,
+                     size_t parallel, const Args& args)
+      : files_(filenames.size()),
+        parallel_(parallel),
+        args_(args),
+        cv_(&mutex_) {
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      files_[i].filename = filenames[i];
+    }
+  }
+
+  // Returns the number of files failing the check
+  size_t Run() {
+    std::vector<port::Thread> threads;
+    for (size_t i = 0; i < parallel_; ++i) {
+      threads.emplace_back(&ParallelSstChecker::Work, this);
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    uint64_t total_read = 0;
+    for (auto& f : files_) {
+      total_read += f.num_read;
+    }
+    if (!args_.verify) {
+      fprintf(stdout,
+              "%" PRIu64 " entries checked in %" ROCKSDB_PRIszt
+              " files, %" ROCKSDB_PRIszt " failed\n",
+              total_read, files_.size(), failed_);
+    }
+    return failed_;
+  }
+
+ private:
+  struct File {
+    std::string filename;
+    std::unique_ptr<SstFileDumper> dumper;
+    // Piece i of the file is [bounds[i - 1], bounds[i])
+    std::vector<std::string> bounds;
+    size_t pending = 0;
+    uint64_t num_read = 0;
+    Status status;
+  };
+
+  struct Piece {
+    File* file;
+    size_t index;
+  };
+
+  void Work() {
+    MutexLock l(&mutex_);
+    while (true) {
+      if (!pieces_.empty()) {
+        Piece piece = pieces_.front();
+        pieces_.pop_front();
+        mutex_.Unlock();
+        uint64_t num_read = 0;
+        Status s = ReadPiece(piece, &num_read);
+        mutex_.Lock();
+        File* f = piece.file;
+        f->num_read += num_read;
+        if (!s.ok() && f->status.ok()) {
+          f->status = s;
+        }
+        if (--f->pending == 0) {
+          Report(f);
+        }
+      } else if (next_file_ < files_.size()) {
+        File* f = &files_[next_file_++];
+        ++opening_;
+        mutex_.Unlock();
+        Open(f);
+        mutex_.Lock();
+        --opening_;
+        for (size_t i = 0; i < f->pending; ++i) {
+          pieces_.push_back(Piece{f, i});
+        }
+        if (f->pending == 0) {
+          Report(f);
+        }
+        cv_.SignalAll();
+      } else if (opening_ > 0) {
+        // Its pieces may be yet to come
+        cv_.Wait();
+      } else {
+        break;
+      }
+    }
+  }
+
+  void Open(File* f) {
+    f->dumper.reset(new SstFileDumper(f->filename, args_.verify_checksum,
+                                      args_.output_hex));
+    f->status = f->dumper->getStatus();
+    if (!f->status.ok()) {
+      return;
+    }
+    if (args_.verify) {
+      f->status = f->dumper->VerifyChecksum();
+      return;
+    }
+    f->dumper->GetSampleKeys(parallel_ - 1, &f->bounds);
+    f->pending = f->bounds.size() + 1;
+  }
+
+  Status ReadPiece(const Piece& piece, uint64_t* num_read) {
+    File* f = piece.file;
+    Slice lower, upper;
+    if (piece.index > 0) {
+      lower = f->bounds[piece.index - 1];
+    }
+    if (piece.index < f->bounds.size()) {
+      upper = f->bounds[piece.index];
+    }
+    return f->dumper->ReadRange(
+        piece.index > 0 ? &lower : nullptr,
+        piece.index < f->bounds.size() ? &upper : nullptr, false /* print_kv */,
+        0 /* read_num */, args_.has_from || args_.use_from_as_prefix,
+        args_.from_key, args_.has_to, args_.to_key, args_.use_from_as_prefix,
+        num_read);
+  }
+
+  // REQUIRES: mutex_ held
+  void Report(File* f) {
+    if (!f->status.ok()) {
+      ++failed_;
+      if (args_.verify) {
+        fprintf(stderr, "%s is corrupted: %s\n", f->filename.c_str(),
+                f->status.ToString().c_str());
+      } else {
+        fprintf(stderr, "%s: %s\n", f->filename.c_str(),
+                f->status.ToString().c_str());
+      }
+    } else if (args_.verify) {
+      fprintf(stdout, "%s: The file is ok\n", f->filename.c_str());
+    }
+    // Closes the file before the others are done
+    f->dumper.reset();
+    f->bounds.clear();
+  }
+
+  std::vector<File> files_;
+  const size_t parallel_;
+  const Args args_;
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::deque<Piece> pieces_;
+  size_t next_file_ = 0;
+  size_t opening_ = 0;
+  size_t failed_ = 0;
+};
+
 }  // namespace
 
 int SSTDumpTool::Run(int argc, char** argv) {
   std::vector<const char*> dir_or_file_vec;
   uint64_t read_num = std::numeric_limits<uint64_t>::max();
+  bool has_read_num = false;
+  size_t parallel = 1;
   std::string command;
 
   char junk;
@@ -487,6 +695,10 @@ int SSTDumpTool::Run(int argc, char** argv) {
     } else if (sscanf(argv[i], "--read_num=%lu%c", (unsigned long*)&n, &junk) ==
                1) {
       read_num = n;
+      has_read_num = true;
+    } else if (sscanf(argv[i], "--parallel=%lu%c", (unsigned long*)&n,
+                      &junk) == 1) {
+      parallel = std::max<size_t>(static_cast<size_t>(n), 1);
     } else if (strcmp(argv[i], "--verify_checksum") == 0) {
       verify_checksum = true;
     } else if (strncmp(argv[i], "--command=", 10) == 0) {
@@ -607,6 +819,30 @@ int SSTDumpTool::Run(int argc, char** argv) {
           TERARKDB_NAMESPACE::Slice(from_key).ToString(true).c_str(),
           TERARKDB_NAMESPACE::Slice(to_key).ToString(true).c_str());
 
+  if (parallel > 1) {
+    if (command != "" && command != "check" && command != "verify") {
+      fprintf(stderr, "--parallel only applies to check|verify\n");
+      exit(1);
+    }
+    if (has_read_num || show_properties || show_summary) {
+      fprintf(stderr,
+              "Cannot specify --parallel and --read_num, --show_properties "
+              "or --show_summary\n");
+      exit(1);
+    }
+    ParallelSstChecker::Args args;
+    args.verify = command == "verify";
+    args.verify_checksum = verify_checksum;
+    args.output_hex = output_hex;
+    args.has_from = has_from;
+    args.has_to = has_to;
+    args.use_from_as_prefix = use_from_as_prefix;
+    args.from_key = from_key;
+    args.to_key = to_key;
+    ParallelSstChecker(filenames, parallel, args).Run();
+    return 0;
+  }
+
   uint64_t total_read = 0;
   for (auto filename : filenames) {
     TERARKDB_NAMESPACE::SstFileDumper dumper(filename, verify_checksum,
@@ -12,6 +12,7 @@
 #include "options/cf_options.h"
 #include "rocksdb/sst_dump_tool.h"
 #include "rocksdb/terark_namespace.h"
+#include "table/table_reader.h"
 #include "util/file_reader_writer.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -26,6 +27,19 @@ class SstFileDumper {
                         const std::string& to_key,
                         bool use_from_as_prefix = false);
 
+  // Like ReadSequential(), reading only the internal keys in [lower, upper)
+  // where a bound is given, and without counting into GetReadNumber(). May
+  // be called concurrently when print_kv is false.
+  Status ReadRange(const Slice* lower, const Slice* upper, bool print_kv,
+                   uint64_t read_num, bool has_from,
+                   const std::string& from_key, bool has_to,
+                   const std::string& to_key, bool use_from_as_prefix,
+                   uint64_t* num_read);
+
+  // Appends at most `limit` internal keys cutting the file into pieces of
+  // alike work, see TableReader::GetSampleKeys()
+  void GetSampleKeys(size_t limit, std::vector<std::string>* keys);
+
   Status ReadTableProperties(
       std::shared_ptr<const TableProperties>* table_properties);
   uint64_t GetReadNumber() { return read_num_; }
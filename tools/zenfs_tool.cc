@@ -7,7 +7,13 @@
 
 #if defined(GFLAGS) && !defined(ROCKSDB_LITE) && defined(LIBZBD)
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -17,7 +23,11 @@
 #include <streambuf>
 
 #include "env/env_zenfs.h"
+#include "rocksdb/convenience.h"
+#include "rocksdb/db.h"
+#include "rocksdb/metadata.h"
 #include "util/gflags_compat.h"
+#include "util/string_util.h"
 using GFLAGS_NAMESPACE::ParseCommandLineFlags;
 using GFLAGS_NAMESPACE::RegisterFlagValidator;
 using GFLAGS_NAMESPACE::SetUsageMessage;
@@ -30,6 +40,12 @@ DEFINE_string(path, "", "Path to directory to list files under");
 DEFINE_int32(finish_threshold, 0, "Finish used zones if less than x% left");
 DEFINE_int32(max_active_zones, 0, "Max active zone limit");
 DEFINE_int32(max_open_zones, 0, "Max active zone limit");
+DEFINE_int32(jobs, 0,
+             "Files copied or checked in parallel, 0 for one per core");
+DEFINE_int32(queue_depth, 8, "Chunks of a file read at once while copying");
+DEFINE_uint64(chunk_size, 1 << 20,
+              "Size of a read while copying, the writes append queue_depth "
+              "chunks at once");
 
 namespace TERARKDB_NAMESPACE {
 
@@ -221,90 +237,275 @@ void ReadWriteLifeTimeHints() {
   wlth_file.close();
 }
 
+// Copy `f` in batches of FLAGS_queue_depth chunks. A batch is read with one
+// MultiRead() while the previous one is appended, so the reads stay queued
+// on the device and the writes fill zones in large sequential appends.
 Status zenfs_tool_copy_file(Env *f_fs, std::string f, Env *t_fs, std::string t) {
   EnvOptions eopt;
   Status s;
-  std::unique_ptr<SequentialFile> f_file;
+  std::unique_ptr<RandomAccessFile> f_file;
   std::unique_ptr<WritableFile> t_file;
-  size_t buffer_sz = 1024 * 1024;
-  uint64_t to_copy;
-  char *buffer;
- 
-  fprintf(stdout, "%s\n", f.c_str());
- 
-  s = f_fs->GetFileSize(f, &to_copy);
+  const size_t chunk_sz = std::max<uint64_t>(FLAGS_chunk_size, 4096);
+  const size_t queue_depth = std::max(FLAGS_queue_depth, 1);
+  const size_t batch_sz = chunk_sz * queue_depth;
+  uint64_t file_size;
+
+  s = f_fs->GetFileSize(f, &file_size);
   if (!s.ok()) { return s; }
 
-  s = f_fs->NewSequentialFile(f, &f_file, eopt);
+  s = f_fs->NewRandomAccessFile(f, &f_file, eopt);
   if (!s.ok()) { return s; }
-  
+
   s = t_fs->NewWritableFile(t, &t_file, eopt);
   if (!s.ok()) { return s; }
 
   t_file->SetWriteLifeTimeHint(GetWriteLifeTimeHint(t));
 
-  buffer = (char *)malloc(buffer_sz);
-  if (buffer == nullptr) {
-    return Status::IOError("Failed to allocate copy buffer");
-  }
+  std::unique_ptr<char[]> buffers[2] = {
+      std::unique_ptr<char[]>(new char[batch_sz]),
+      std::unique_ptr<char[]>(new char[batch_sz])};
+  std::vector<FSReadRequest> reqs[2];
+
+  auto read_batch = [&](uint64_t offset, int b) -> Status {
+    reqs[b].clear();
+    for (size_t i = 0; i < queue_depth && offset < file_size; ++i) {
+      FSReadRequest req;
+      req.offset = offset;
+      req.len = static_cast<size_t>(std::min<uint64_t>(chunk_sz,
+                                                       file_size - offset));
+      req.scratch = buffers[b].get() + i * chunk_sz;
+      reqs[b].push_back(req);
+      offset += req.len;
+    }
+    Status rs = f_file->MultiRead(reqs[b].data(), reqs[b].size());
+    for (size_t i = 0; rs.ok() && i < reqs[b].size(); ++i) {
+      rs = reqs[b][i].status;
+      if (rs.ok() && reqs[b][i].result.size() != reqs[b][i].len) {
+        rs = Status::IOError("Short read", f);
+      }
+    }
+    return rs;
+  };
 
-  while (to_copy > 0) {
-    size_t chunk_sz = to_copy;
-    Slice chunk_slice;
-  
-    if (chunk_sz > buffer_sz)
-      chunk_sz = buffer_sz;
-  
-    s = f_file->Read(chunk_sz, &chunk_slice, buffer);
-    if (!s.ok()) { break; }
-    
-    s = t_file->Append(chunk_slice);
-    to_copy -= chunk_slice.size();
+  uint64_t offset = 0;
+  int b = 0;
+  if (file_size > 0) {
+    s = read_batch(offset, b);
+  }
+  while (s.ok() && offset < file_size) {
+    uint64_t batch_len = 0;
+    for (auto &req : reqs[b]) {
+      batch_len += req.len;
+    }
+    uint64_t next_offset = offset + batch_len;
+    std::future<Status> next;
+    if (next_offset < file_size) {
+      next = std::async(std::launch::async, read_batch, next_offset, b ^ 1);
+    }
+    // The chunks of a batch are adjacent in the buffer, unless a read
+    // returned its own buffer
+    for (auto &req : reqs[b]) {
+      if (req.result.data() != req.scratch) {
+        memcpy(req.scratch, req.result.data(), req.result.size());
+      }
+    }
+    s = t_file->Append(Slice(buffers[b].get(), batch_len));
+    if (next.valid()) {
+      Status rs = next.get();
+      if (s.ok()) { s = rs; }
+    }
+    offset = next_offset;
+    b ^= 1;
   }
-  
-  free(buffer);
   if (!s.ok()) { return s; }
-  
-  return t_file->Fsync();
+
+  s = t_file->Fsync();
+  if (s.ok()) {
+    s = t_file->Close();
+  }
+  return s;
 }
 
-Status zenfs_tool_copy_dir(Env *f_fs, std::string f_dir, Env *t_fs, std::string t_dir) {
+struct CopyJob {
+  std::string from;
+  std::string to;
+};
+
+// Create the directories of `f_dir` on `t_fs` and list its files
+Status zenfs_tool_list_copy_jobs(Env *f_fs, std::string f_dir, Env *t_fs,
+                                 std::string t_dir,
+                                 std::vector<CopyJob> *jobs) {
   Status s;
   std::vector<std::string> files;
 
   s = f_fs->GetChildren(f_dir, &files);
   if (!s.ok()) { return s; }
-  
-  for (const auto f : files) {
+
+  for (const auto &f : files) {
     std::string filename = f_dir + f;
-    bool is_dir;
+    bool is_dir = false;
 
     if (f == "." || f == ".." || f == "write_lifetime_hints.dat")
       continue;
 
-    // s = f_fs->IsDirectory(filename, &is_dir);
-    // if (!s.ok()) { return s; }
-    
+    s = f_fs->IsDirectory(filename, &is_dir);
+    if (s.IsNotSupported()) {
+      is_dir = false;
+    } else if (!s.ok()) {
+      return s;
+    }
+
     std::string dest_filename;
 
-    if (t_dir == "") {  
+    if (t_dir == "") {
        dest_filename = f;
     } else {
-       dest_filename = t_dir + "/" + f; 
+       dest_filename = t_dir + "/" + f;
     }
-   
+
     if (is_dir) {
-      s = t_fs->CreateDir(dest_filename);
+      s = t_fs->CreateDirIfMissing(dest_filename);
       if (!s.ok()) { return s; }
-      s =  zenfs_tool_copy_dir(f_fs, filename + "/", t_fs, dest_filename);
+      s = zenfs_tool_list_copy_jobs(f_fs, filename + "/", t_fs, dest_filename,
+                                    jobs);
       if (!s.ok()) { return s; }
     } else {
-      s = zenfs_tool_copy_file(f_fs, filename, t_fs, dest_filename);
-      if (!s.ok()) { return s; }
+      jobs->push_back({filename, dest_filename});
     }
   }
 
-  return s;
+  return Status::OK();
+}
+
+// Run `work` on FLAGS_jobs threads for items [0, n), stopping at the first
+// error
+Status zenfs_tool_parallel(size_t n, std::function<Status(size_t)> work) {
+  std::atomic<size_t> next(0);
+  std::mutex mutex;
+  Status result;
+  auto worker = [&] {
+    for (size_t i = next++; i < n; i = next++) {
+      Status s = work(i);
+      if (!s.ok()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result.ok()) {
+          result = s;
+        }
+        next = n;
+      }
+    }
+  };
+  size_t num_threads = FLAGS_jobs > 0 ? static_cast<size_t>(FLAGS_jobs)
+                                      : std::thread::hardware_concurrency();
+  num_threads = std::max<size_t>(1, std::min(num_threads, n));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return result;
+}
+
+Status zenfs_tool_copy_dir(Env *f_fs, std::string f_dir, Env *t_fs, std::string t_dir) {
+  std::vector<CopyJob> jobs;
+  Status s = zenfs_tool_list_copy_jobs(f_fs, f_dir, t_fs, t_dir, &jobs);
+  if (!s.ok()) { return s; }
+
+  // The largest files first, so they don't start last and stall the end
+  std::vector<uint64_t> sizes(jobs.size());
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    s = f_fs->GetFileSize(jobs[i].from, &sizes[i]);
+    if (!s.ok()) { return s; }
+  }
+  std::vector<size_t> order(jobs.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+  std::mutex out_mutex;
+  return zenfs_tool_parallel(order.size(), [&](size_t i) {
+    const CopyJob &job = jobs[order[i]];
+    {
+      std::lock_guard<std::mutex> lock(out_mutex);
+      fprintf(stdout, "%s\n", job.from.c_str());
+    }
+    return zenfs_tool_copy_file(f_fs, job.from, t_fs, job.to);
+  });
+}
+
+// Check that every file the MANIFEST of the DB in --path references exists
+// with its recorded size, and verify the block checksums of the SSTs
+int zenfs_tool_fsck() {
+  Status s;
+  ZonedBlockDevice *zbd = zbd_open(true);
+  if (zbd == nullptr) return 1;
+
+  ZenEnv *zenEnv;
+  s = zenfs_mount(zbd, &zenEnv, true);
+  if (!s.ok()) {
+    fprintf(stderr, "Failed to mount filesystem, error: %s\n",
+            s.ToString().c_str());
+    return 1;
+  }
+
+  Options options;
+  options.env = zenEnv;
+  options.max_open_files = -1;
+  std::vector<std::string> cf_names;
+  s = DB::ListColumnFamilies(options, FLAGS_path, &cf_names);
+  std::vector<ColumnFamilyDescriptor> cfs;
+  for (auto &name : cf_names) {
+    cfs.emplace_back(name, ColumnFamilyOptions(options));
+  }
+  std::vector<ColumnFamilyHandle *> handles;
+  DB *db = nullptr;
+  if (s.ok()) {
+    s = DB::OpenForReadOnly(options, FLAGS_path, cfs, &handles, &db);
+  }
+  if (!s.ok()) {
+    fprintf(stderr, "Failed to read the MANIFEST, error: %s\n",
+            s.ToString().c_str());
+    return 1;
+  }
+  std::vector<LiveFileMetaData> files;
+  db->GetLiveFilesMetaData(&files);
+  for (auto handle : handles) {
+    db->DestroyColumnFamilyHandle(handle);
+  }
+  delete db;
+
+  std::mutex out_mutex;
+  std::atomic<size_t> num_errors(0);
+  EnvOptions eopt;
+  zenfs_tool_parallel(files.size(), [&](size_t i) {
+    const LiveFileMetaData &f = files[i];
+    std::string path = f.db_path + f.name;
+    uint64_t size = 0;
+    Status fs = zenEnv->GetFileSize(path, &size);
+    if (fs.ok() && size != f.size) {
+      fs = Status::Corruption("File size " + ToString(size) +
+                              ", the MANIFEST has " + ToString(f.size));
+    }
+    if (fs.ok()) {
+      fs = VerifySstFileChecksum(options, eopt, path);
+    }
+    if (!fs.ok()) {
+      ++num_errors;
+      std::lock_guard<std::mutex> lock(out_mutex);
+      fprintf(stderr, "%s: %s\n", path.c_str(), fs.ToString().c_str());
+    }
+    // Check all files
+    return Status::OK();
+  });
+
+  fprintf(stdout, "Checked %zu files, %zu errors\n", files.size(),
+          num_errors.load());
+  return num_errors.load() == 0 ? 0 : 1;
 }
 
 int zenfs_tool_backup() {
@@ -361,7 +562,8 @@ int zenfs_tool_restore() {
 
 int zenfs_tool(int argc, char **argv) {
   SetUsageMessage(std::string("\nUSAGE:\n") + std::string(argv[0]) +
-                  +" <command> [OPTIONS]...\nCommands: mkfs, list, ls-uuid");
+                  +" <command> [OPTIONS]...\nCommands: mkfs, list, ls-uuid, "
+                    "df, backup, restore, fsck");
   if (argc < 2) {
     fprintf(stderr, "You need to specify a command.\n");
     return 1;
@@ -386,6 +588,8 @@ int zenfs_tool(int argc, char **argv) {
     return TERARKDB_NAMESPACE::zenfs_tool_backup();
   } else if (subcmd == "restore") {
     return TERARKDB_NAMESPACE::zenfs_tool_restore();
+  } else if (subcmd == "fsck") {
+    return TERARKDB_NAMESPACE::zenfs_tool_fsck();
   } else {
     fprintf(stderr, "Subcommand not recognized: %s\n", subcmd.c_str());
     return 1;
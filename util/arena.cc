@@ -22,7 +22,9 @@
 
 #include "rocksdb/env.h"
 #include "rocksdb/terark_namespace.h"
+#include "port/port.h"
 #include "util/logging.h"
+#include "util/mutexlock.h"
 #include "util/sync_point.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -49,6 +51,95 @@ size_t OptimizeBlockSize(size_t block_size) {
   return block_size;
 }
 
+namespace {
+// Freed huge page blocks, still mapped and faulted in. Memtables are switched
+// all the time with the same block size, so a new memtable mostly finds its
+// blocks here, without page faults and on the NUMA node it runs on.
+class HugePageBlockCache {
+ public:
+  struct Block {
+    void* addr;
+    size_t length;
+    int node;
+  };
+
+  void* Get(size_t length, int node) {
+    MutexLock l(&mutex_);
+    // The most recently freed blocks first, they are more likely to be warm
+    for (size_t i = blocks_.size(); i > 0; --i) {
+      Block& block = blocks_[i - 1];
+      if (block.length == length && block.node == node) {
+        void* addr = block.addr;
+        usage_ -= length;
+        blocks_.erase(blocks_.begin() + (i - 1));
+        return addr;
+      }
+    }
+    return nullptr;
+  }
+
+  // Return false if the block doesn't fit, then the caller unmaps it
+  bool Put(void* addr, size_t length, int node) {
+    MutexLock l(&mutex_);
+    if (usage_ + length > capacity_) {
+      return false;
+    }
+    blocks_.push_back(Block{addr, length, node});
+    usage_ += length;
+    return true;
+  }
+
+  size_t SetCapacity(size_t capacity) {
+    std::vector<Block> evicted;
+    size_t prev;
+    {
+      MutexLock l(&mutex_);
+      prev = capacity_;
+      capacity_ = capacity;
+      // Evict the oldest blocks
+      size_t n = 0;
+      while (usage_ > capacity_) {
+        usage_ -= blocks_[n].length;
+        ++n;
+      }
+      evicted.assign(blocks_.begin(), blocks_.begin() + n);
+      blocks_.erase(blocks_.begin(), blocks_.begin() + n);
+    }
+#ifdef MAP_HUGETLB
+    for (auto& block : evicted) {
+      munmap(block.addr, block.length);
+    }
+#endif
+    return prev;
+  }
+
+  size_t GetUsage() {
+    MutexLock l(&mutex_);
+    return usage_;
+  }
+
+ private:
+  port::Mutex mutex_;
+  std::vector<Block> blocks_;
+  size_t usage_ = 0;
+  size_t capacity_ = size_t(1) << 30;
+};
+
+// Leaked on purpose, arenas may be destroyed by static destructors
+HugePageBlockCache* GetHugePageBlockCache() {
+  static auto* cache = new HugePageBlockCache();
+  return cache;
+}
+}  // namespace
+
+size_t Arena::SetHugePageCacheCapacity(size_t capacity) {
+  return GetHugePageBlockCache()->SetCapacity(capacity);
+}
+
+size_t Arena::GetHugePageCacheUsage() {
+  return GetHugePageBlockCache()->GetUsage();
+}
+
 Arena::Arena(size_t block_size, AllocTracker* tracker, size_t huge_page_size)
     : kBlockSize(OptimizeBlockSize(block_size)), tracker_(tracker) {
   assert(kBlockSize >= kMinBlockSize && kBlockSize <= kMaxBlockSize &&
@@ -82,7 +173,9 @@ Arena::~Arena() {
 
 #ifdef MAP_HUGETLB
   for (const auto& mmap_info : huge_blocks_) {
-    if (mmap_info.addr_ == nullptr) {
+    if (mmap_info.addr_ == nullptr ||
+        GetHugePageBlockCache()->Put(mmap_info.addr_, mmap_info.length_,
+                                     mmap_info.node_)) {
       continue;
     }
     auto ret = munmap(mmap_info.addr_, mmap_info.length_);
@@ -140,15 +233,24 @@ char* Arena::AllocateFromHugePage(size_t bytes) {
   //   `mmap` yet.
   // - If `mmap` throws, no memory leaks because the vector will be cleaned up
   //   via RAII.
-  huge_blocks_.emplace_back(nullptr /* addr */, 0 /* length */);
+  huge_blocks_.emplace_back(nullptr /* addr */, 0 /* length */, -1 /* node */);
 
-  void* addr = mmap(nullptr, bytes, (PROT_READ | PROT_WRITE),
-                    (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), -1, 0);
+  int node = port::NumaNodeID();
+  void* addr = GetHugePageBlockCache()->Get(bytes, node);
+  if (addr == nullptr) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_POPULATE
+    // Fault the pages in now, from this thread, so they are taken from the
+    // local NUMA node and the inserts don't stall on page faults
+    flags |= MAP_POPULATE;
+#endif
+    addr = mmap(nullptr, bytes, (PROT_READ | PROT_WRITE), flags, -1, 0);
+  }
 
   if (addr == MAP_FAILED) {
     return nullptr;
   }
-  huge_blocks_.back() = MmapInfo(addr, bytes);
+  huge_blocks_.back() = MmapInfo(addr, bytes, node);
   blocks_memory_ += bytes;
   if (tracker_ != nullptr) {
     tracker_->Allocate(bytes);
@@ -41,6 +41,10 @@ class Arena : public Allocator {
   // huge_page_size: if 0, don't use huge page TLB. If > 0 (should set to the
   // supported hugepage size of the system), block allocation will try huge
   // page TLB first. If allocation fails, will fall back to normal case.
+  // Huge page blocks are faulted in by the allocating thread, so they live on
+  // its NUMA node. When the arena is destroyed they are kept in a process
+  // wide cache, and handed to the next arena that asks for a block of the
+  // same size on the same node, instead of being unmapped.
   explicit Arena(size_t block_size = kMinBlockSize,
                  AllocTracker* tracker = nullptr, size_t huge_page_size = 0);
   ~Arena();
@@ -82,6 +86,13 @@ class Arena : public Allocator {
 
   bool IsInInlineBlock() const { return blocks_.empty(); }
 
+  // Limit the bytes of the freed huge page blocks kept mapped for reuse,
+  // unmapping the ones over it. Returns the previous limit. Default: 1GB
+  static size_t SetHugePageCacheCapacity(size_t capacity);
+
+  // Bytes of the freed huge page blocks kept mapped for reuse
+  static size_t GetHugePageCacheUsage();
+
  private:
   char inline_block_[kInlineSize]
       __attribute__((__aligned__(alignof(max_align_t))));
@@ -94,8 +105,11 @@ class Arena : public Allocator {
   struct MmapInfo {
     void* addr_;
     size_t length_;
+    // NUMA node the block was faulted in on, -1 if unknown
+    int node_;
 
-    MmapInfo(void* addr, size_t length) : addr_(addr), length_(length) {}
+    MmapInfo(void* addr, size_t length, int node)
+        : addr_(addr), length_(length), node_(node) {}
   };
   std::vector<MmapInfo> huge_blocks_;
   size_t irregular_block_num = 0;
@@ -198,6 +198,32 @@ TEST_F(ArenaTest, Simple) {
   SimpleTest(0);
   SimpleTest(kHugePageSize);
 }
+
+TEST_F(ArenaTest, HugePageCache) {
+  const size_t kBlockSize = 4096;
+  Arena::SetHugePageCacheCapacity(0);
+  Arena::SetHugePageCacheCapacity(kHugePageSize);
+  {
+    Arena arena(kBlockSize, nullptr, kHugePageSize);
+    arena.Allocate(kBlockSize / 8);
+    if (arena.MemoryAllocatedBytes() < kHugePageSize) {
+      // No huge pages reserved on this host
+      return;
+    }
+  }
+  // The block is kept for the next arena
+  ASSERT_EQ(kHugePageSize, Arena::GetHugePageCacheUsage());
+  {
+    Arena arena(kBlockSize, nullptr, kHugePageSize);
+    arena.Allocate(kBlockSize / 8);
+    ASSERT_LE(kHugePageSize, arena.MemoryAllocatedBytes());
+  }
+  ASSERT_EQ(kHugePageSize, Arena::GetHugePageCacheUsage());
+
+  Arena::SetHugePageCacheCapacity(0);
+  ASSERT_EQ(0U, Arena::GetHugePageCacheUsage());
+  Arena::SetHugePageCacheCapacity(size_t(1) << 30);
+}
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
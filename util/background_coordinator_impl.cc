@@ -0,0 +1,105 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/background_coordinator_impl.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
+
+namespace TERARKDB_NAMESPACE {
+
+BackgroundCoordinatorImpl::BackgroundCoordinatorImpl(
+    const BackgroundCoordinatorOptions& options)
+    : options_(options),
+      rate_limiter_(options.rate_bytes_per_sec > 0
+                        ? NewGenericRateLimiter(options.rate_bytes_per_sec)
+                        : nullptr),
+      num_busy_(0) {}
+
+size_t BackgroundCoordinatorImpl::GetNumDBs() const {
+  MutexLock l(&mutex_);
+  return dbs_.size();
+}
+
+size_t BackgroundCoordinatorImpl::GetNumBusyDBs() const {
+  return num_busy_.load(std::memory_order_relaxed);
+}
+
+int BackgroundCoordinatorImpl::GetBackgroundJobsShare() const {
+  if (options_.max_background_jobs <= 0) {
+    return std::numeric_limits<int>::max();
+  }
+  size_t busy = std::max<size_t>(1, num_busy_.load(std::memory_order_relaxed));
+  return std::max(1, options_.max_background_jobs / static_cast<int>(busy));
+}
+
+void BackgroundCoordinatorImpl::Register(const void* db,
+                                         std::shared_ptr<Cache> table_cache) {
+  MutexLock l(&mutex_);
+  assert(dbs_.count(db) == 0);
+  dbs_[db].table_cache = std::move(table_cache);
+  ResizeTableCaches();
+}
+
+void BackgroundCoordinatorImpl::Unregister(const void* db) {
+  MutexLock l(&mutex_);
+  auto it = dbs_.find(db);
+  if (it == dbs_.end()) {
+    return;
+  }
+  if (it->second.busy) {
+    num_busy_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  dbs_.erase(it);
+  ResizeTableCaches();
+}
+
+void BackgroundCoordinatorImpl::SetBusy(const void* db, bool busy) {
+  MutexLock l(&mutex_);
+  auto it = dbs_.find(db);
+  if (it == dbs_.end() || it->second.busy == busy) {
+    return;
+  }
+  it->second.busy = busy;
+  if (busy) {
+    num_busy_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    num_busy_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void BackgroundCoordinatorImpl::ResizeTableCaches() {
+  mutex_.AssertHeld();
+  if (options_.table_cache_memory_budget == 0) {
+    return;
+  }
+  size_t num_caches = 0;
+  for (auto& pair : dbs_) {
+    if (pair.second.table_cache != nullptr) {
+      ++num_caches;
+    }
+  }
+  if (num_caches == 0) {
+    return;
+  }
+  // Shrinking a cache evicts its idle table readers right away
+  size_t share = static_cast<size_t>(
+      std::max<uint64_t>(1, options_.table_cache_memory_budget / num_caches));
+  for (auto& pair : dbs_) {
+    if (pair.second.table_cache != nullptr) {
+      pair.second.table_cache->SetCapacity(share);
+    }
+  }
+}
+
+BackgroundCoordinator* NewBackgroundCoordinator(
+    const BackgroundCoordinatorOptions& options) {
+  return new BackgroundCoordinatorImpl(options);
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,63 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+#include "port/port.h"
+#include "rocksdb/background_coordinator.h"
+#include "rocksdb/cache.h"
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// All BackgroundCoordinatorImpl functions are thread-safe. It never calls
+// into the DBs, so they may call it with their DB mutex held.
+class BackgroundCoordinatorImpl : public BackgroundCoordinator {
+ public:
+  explicit BackgroundCoordinatorImpl(
+      const BackgroundCoordinatorOptions& options);
+
+  size_t GetNumDBs() const override;
+  size_t GetNumBusyDBs() const override;
+  int GetBackgroundJobsShare() const override;
+
+  // Called by a DB on open and on close. `table_cache`, if not nullptr, gets
+  // an equal share of table_cache_memory_budget() with the other ones.
+  void Register(const void* db, std::shared_ptr<Cache> table_cache);
+  void Unregister(const void* db);
+
+  // Whether `db` has compactions or GCs pending or running
+  void SetBusy(const void* db, bool busy);
+
+  const std::shared_ptr<RateLimiter>& rate_limiter() const {
+    return rate_limiter_;
+  }
+  uint64_t table_cache_memory_budget() const {
+    return options_.table_cache_memory_budget;
+  }
+
+ private:
+  struct DBState {
+    std::shared_ptr<Cache> table_cache;
+    bool busy = false;
+  };
+
+  // REQUIRES: mutex_ held
+  void ResizeTableCaches();
+
+  const BackgroundCoordinatorOptions options_;
+  const std::shared_ptr<RateLimiter> rate_limiter_;
+
+  mutable port::Mutex mutex_;
+  std::unordered_map<const void*, DBState> dbs_;
+  std::atomic<size_t> num_busy_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -7,6 +7,13 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+
+#include "port/port.h"
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/terark_namespace.h"
@@ -185,6 +192,33 @@ class FullFilterBitsReader : public FilterBitsReader {
     return HashMayMatch(hash, Slice(data_, data_len_), num_probes_, num_lines_);
   }
 
+  // Hash and prefetch the cache lines of a batch of keys before probing any
+  // of them, so that the cache misses of the batch overlap
+  virtual void KeysMayMatch(size_t num_keys, const Slice* keys,
+                            bool* may_match) override {
+    if (data_len_ <= 5 || num_probes_ == 0 || num_lines_ == 0) {
+      std::fill(may_match, may_match + num_keys, data_len_ > 5);
+      return;
+    }
+    const size_t kBatchSize = 32;
+    uint32_t hashes[kBatchSize];
+    uint32_t line_bits[kBatchSize];
+    for (size_t begin = 0; begin < num_keys; begin += kBatchSize) {
+      size_t size = std::min(kBatchSize, num_keys - begin);
+      for (size_t i = 0; i < size; ++i) {
+        hashes[i] = BloomHash(keys[begin + i]);
+        line_bits[i] = (hashes[i] % num_lines_) << (log2_cache_line_size_ + 3);
+        const char* line = data_ + line_bits[i] / 8;
+        PREFETCH(line, 0 /* rw */, 1 /* locality */);
+        PREFETCH(line + (1 << log2_cache_line_size_) - 1, 0 /* rw */,
+                 1 /* locality */);
+      }
+      for (size_t i = 0; i < size; ++i) {
+        may_match[begin + i] = LineMayMatch(hashes[i], line_bits[i]);
+      }
+    }
+  }
+
  private:
   // Filter meta data
   char* data_;
@@ -213,6 +247,10 @@ class FullFilterBitsReader : public FilterBitsReader {
   bool HashMayMatch(const uint32_t& hash, const Slice& filter,
                     const size_t& num_probes, const uint32_t& num_lines);
 
+  // The probes of `hash` in the cache line starting at bit `b`, which is
+  // selected by the hash. With AVX2 eight probes are tested at once.
+  inline bool LineMayMatch(uint32_t hash, uint32_t b) const;
+
   // No Copy allowed
   FullFilterBitsReader(const FullFilterBitsReader&);
   void operator=(const FullFilterBitsReader&);
@@ -267,6 +305,55 @@ bool FullFilterBitsReader::HashMayMatch(const uint32_t& hash,
   return true;
 }
 
+inline bool FullFilterBitsReader::LineMayMatch(uint32_t hash,
+                                               uint32_t b) const {
+  const uint32_t delta = (hash >> 17) | (hash << 15);  // Rotate right 17 bits
+  const uint32_t line_mask = (1u << (log2_cache_line_size_ + 3)) - 1;
+#if defined(__AVX2__)
+  // The bits are tested in little endian words, gathered from the line
+  if (port::kLittleEndian) {
+    __m256i h = _mm256_add_epi32(
+        _mm256_set1_epi32(static_cast<int>(hash)),
+        _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(delta)),
+                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    const __m256i step = _mm256_set1_epi32(static_cast<int>(delta * 8));
+    const __m256i base = _mm256_set1_epi32(static_cast<int>(b));
+    const __m256i mask = _mm256_set1_epi32(static_cast<int>(line_mask));
+    const __m256i bit_mask = _mm256_set1_epi32(31);
+    const __m256i one = _mm256_set1_epi32(1);
+    for (size_t i = 0; i < num_probes_; i += 8) {
+      __m256i bitpos = _mm256_add_epi32(base, _mm256_and_si256(h, mask));
+      __m256i words =
+          _mm256_i32gather_epi32(reinterpret_cast<const int*>(data_),
+                                 _mm256_srli_epi32(bitpos, 5), 4);
+      __m256i bits =
+          _mm256_sllv_epi32(one, _mm256_and_si256(bitpos, bit_mask));
+      __m256i unset = _mm256_cmpeq_epi32(_mm256_and_si256(words, bits),
+                                         _mm256_setzero_si256());
+      int unset_mask = _mm256_movemask_ps(_mm256_castsi256_ps(unset));
+      if (num_probes_ - i < 8) {
+        // Lanes past the last probe
+        unset_mask &= (1 << (num_probes_ - i)) - 1;
+      }
+      if (unset_mask != 0) {
+        return false;
+      }
+      h = _mm256_add_epi32(h, step);
+    }
+    return true;
+  }
+#endif
+  uint32_t h = hash;
+  for (uint32_t i = 0; i < num_probes_; ++i) {
+    const uint32_t bitpos = b + (h & line_mask);
+    if (((data_[bitpos / 8]) & (1 << (bitpos % 8))) == 0) {
+      return false;
+    }
+    h += delta;
+  }
+  return true;
+}
+
 // An implementation of filter policy
 class BloomFilterPolicy : public FilterPolicy {
  public:
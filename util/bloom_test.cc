@@ -15,6 +15,9 @@ int main() {
 }
 #else
 
+#include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "rocksdb/filter_policy.h"
@@ -299,6 +302,41 @@ TEST_F(FullBloomTest, FullVaryingLengths) {
   ASSERT_LE(mediocre_filters, good_filters / 5);
 }
 
+TEST_F(FullBloomTest, FullKeysMayMatch) {
+  char buffer[sizeof(int)];
+  std::vector<std::string> keys;
+  for (int i = 0; i < 2000; i++) {
+    keys.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  std::unique_ptr<bool[]> may_match(new bool[keys.size()]);
+
+  // 1, 6 and 13 probes, to cover partial and multiple AVX2 probe rounds.
+  // The filter of 0 bits per key is empty.
+  for (int bits_per_key : {0, 1, 10, 20}) {
+    std::unique_ptr<const FilterPolicy> policy(
+        NewBloomFilterPolicy(std::max(bits_per_key, 1), false));
+    std::unique_ptr<FilterBitsBuilder> builder(policy->GetFilterBitsBuilder());
+    for (int i = 0; bits_per_key != 0 && i < 1000; i += 2) {
+      builder->AddKey(key_slices[i]);
+    }
+    std::unique_ptr<const char[]> buf;
+    std::unique_ptr<FilterBitsReader> reader(
+        policy->GetFilterBitsReader(builder->Finish(&buf)));
+
+    reader->KeysMayMatch(key_slices.size(), key_slices.data(),
+                         may_match.get());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ASSERT_EQ(reader->MayMatch(key_slices[i]), may_match[i]) << i;
+      if (bits_per_key == 0) {
+        ASSERT_FALSE(may_match[i]) << i;
+      } else if (i < 1000 && i % 2 == 0) {
+        ASSERT_TRUE(may_match[i]) << i;
+      }
+    }
+  }
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -4,6 +4,9 @@
 //  (found in the LICENSE.Apache file in the root directory).
 
 #include "rocksdb/compaction_job_stats.h"
+
+#include <algorithm>
+
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -42,6 +45,13 @@ void CompactionJobStats::Reset() {
 
   num_single_del_fallthru = 0;
   num_single_del_mismatch = 0;
+
+  num_subcompactions = 0;
+  min_subcompaction_write_rate = 0;
+  max_subcompaction_write_rate = 0;
+
+  num_filter_calls = 0;
+  total_filter_nanos = 0;
 }
 
 void CompactionJobStats::Add(const CompactionJobStats& stats) {
@@ -74,6 +84,21 @@ void CompactionJobStats::Add(const CompactionJobStats& stats) {
 
   num_single_del_fallthru += stats.num_single_del_fallthru;
   num_single_del_mismatch += stats.num_single_del_mismatch;
+
+  if (stats.num_subcompactions > 0) {
+    if (num_subcompactions == 0) {
+      min_subcompaction_write_rate = stats.min_subcompaction_write_rate;
+    } else {
+      min_subcompaction_write_rate = std::min(
+          min_subcompaction_write_rate, stats.min_subcompaction_write_rate);
+    }
+    max_subcompaction_write_rate = std::max(max_subcompaction_write_rate,
+                                            stats.max_subcompaction_write_rate);
+    num_subcompactions += stats.num_subcompactions;
+  }
+
+  num_filter_calls += stats.num_filter_calls;
+  total_filter_nanos += stats.total_filter_nanos;
 }
 
 #else
@@ -148,6 +148,13 @@ class CompressionContext {
   ZSTD_CCtx* zstd_ctx_ = nullptr;
   void CreateNativeContext() {
     if (type_ == kZSTD || type_ == kZSTDNotFinalCompression) {
+      // Every compression call sets all the parameters, so a pooled context
+      // needs no reset
+      zstd_ctx_ = static_cast<ZSTD_CCtx*>(
+          CompressionContextCache::Instance()->TakeZSTDCompressContext());
+      if (zstd_ctx_ != nullptr) {
+        return;
+      }
 #ifdef ROCKSDB_ZSTD_CUSTOM_MEM
       zstd_ctx_ =
           ZSTD_createCCtx_advanced(port::GetJeZstdAllocationOverrides());
@@ -158,7 +165,8 @@ class CompressionContext {
   }
   void DestroyNativeContext() {
     if (zstd_ctx_ != nullptr) {
-      ZSTD_freeCCtx(zstd_ctx_);
+      CompressionContextCache::Instance()->ReturnZSTDCompressContext(
+          zstd_ctx_);
     }
   }
 
@@ -775,7 +783,13 @@ inline bool LZ4_Compress(const CompressionContext& ctx,
 
   int outlen;
 #if LZ4_VERSION_NUMBER >= 10400  // r124+
-  LZ4_stream_t* stream = LZ4_createStream();
+  LZ4_stream_t* stream = static_cast<LZ4_stream_t*>(
+      CompressionContextCache::Instance()->TakeLZ4Stream());
+  if (stream == nullptr) {
+    stream = LZ4_createStream();
+  } else {
+    LZ4_resetStream(stream);
+  }
   if (ctx.dict().size()) {
     LZ4_loadDict(stream, ctx.dict().data(),
                  static_cast<int>(ctx.dict().size()));
@@ -789,7 +803,7 @@ inline bool LZ4_Compress(const CompressionContext& ctx,
       stream, input, &(*output)[output_header_len], static_cast<int>(length),
       compress_bound);
 #endif
-  LZ4_freeStream(stream);
+  CompressionContextCache::Instance()->ReturnLZ4Stream(stream);
 #else  // up to r123
   outlen = LZ4_compress_limitedOutput(input, &(*output)[output_header_len],
                                       static_cast<int>(length), compress_bound);
@@ -811,6 +825,41 @@ inline bool LZ4_Compress(const CompressionContext& ctx,
 #endif
 }
 
+// Decompress `input_data`, which follows the size header, into the
+// `output_len` bytes of `output`. Returns the decompressed size, negative on
+// corruption.
+inline int LZ4_UncompressInto(const UncompressionContext& ctx,
+                              const char* input_data, size_t input_length,
+                              char* output, uint32_t output_len) {
+#ifdef LZ4
+  int decompress_size;
+#if LZ4_VERSION_NUMBER >= 10400  // r124+
+  LZ4_streamDecode_t* stream = LZ4_createStreamDecode();
+  if (ctx.dict().size()) {
+    LZ4_setStreamDecode(stream, ctx.dict().data(),
+                        static_cast<int>(ctx.dict().size()));
+  }
+  decompress_size = LZ4_decompress_safe_continue(
+      stream, input_data, output, static_cast<int>(input_length),
+      static_cast<int>(output_len));
+  LZ4_freeStreamDecode(stream);
+#else  // up to r123
+  decompress_size =
+      LZ4_decompress_safe(input_data, output, static_cast<int>(input_length),
+                          static_cast<int>(output_len));
+  (void)ctx;
+#endif  // LZ4_VERSION_NUMBER >= 10400
+  return decompress_size;
+#else  // LZ4
+  (void)ctx;
+  (void)input_data;
+  (void)input_length;
+  (void)output;
+  (void)output_len;
+  return -1;
+#endif
+}
+
 // compress_format_version == 1 -- decompressed size is included in the
 // block header using memcpy, which makes database non-portable)
 // compress_format_version == 2 -- decompressed size is included in the block
@@ -843,23 +892,8 @@ inline CacheAllocationPtr LZ4_Uncompress(const UncompressionContext& ctx,
   }
 
   auto output = AllocateBlock(output_len, allocator);
-#if LZ4_VERSION_NUMBER >= 10400  // r124+
-  LZ4_streamDecode_t* stream = LZ4_createStreamDecode();
-  if (ctx.dict().size()) {
-    LZ4_setStreamDecode(stream, ctx.dict().data(),
-                        static_cast<int>(ctx.dict().size()));
-  }
-  *decompress_size = LZ4_decompress_safe_continue(
-      stream, input_data, output.get(), static_cast<int>(input_length),
-      static_cast<int>(output_len));
-  LZ4_freeStreamDecode(stream);
-#else  // up to r123
-  *decompress_size = LZ4_decompress_safe(input_data, output.get(),
-                                         static_cast<int>(input_length),
-                                         static_cast<int>(output_len));
-  (void)ctx;
-#endif  // LZ4_VERSION_NUMBER >= 10400
-
+  *decompress_size = LZ4_UncompressInto(ctx, input_data, input_length,
+                                        output.get(), output_len);
   if (*decompress_size < 0) {
     return nullptr;
   }
@@ -915,7 +949,11 @@ inline bool LZ4HC_Compress(const CompressionContext& ctx,
     level = ctx.options().level;
   }
 #if LZ4_VERSION_NUMBER >= 10400  // r124+
-  LZ4_streamHC_t* stream = LZ4_createStreamHC();
+  LZ4_streamHC_t* stream = static_cast<LZ4_streamHC_t*>(
+      CompressionContextCache::Instance()->TakeLZ4HCStream());
+  if (stream == nullptr) {
+    stream = LZ4_createStreamHC();
+  }
   LZ4_resetStreamHC(stream, level);
   const char* compression_dict_data =
       ctx.dict().size() > 0 ? ctx.dict().data() : nullptr;
@@ -932,7 +970,7 @@ inline bool LZ4HC_Compress(const CompressionContext& ctx,
       stream, input, &(*output)[output_header_len], static_cast<int>(length),
       compress_bound);
 #endif  // LZ4_VERSION_NUMBER >= 10700
-  LZ4_freeStreamHC(stream);
+  CompressionContextCache::Instance()->ReturnLZ4HCStream(stream);
 
 #elif LZ4_VERSION_MAJOR  // r113-r123
   outlen = LZ4_compressHC2_limitedOutput(input, &(*output)[output_header_len],
@@ -1032,6 +1070,32 @@ inline bool ZSTD_Compress(const CompressionContext& ctx, const char* input,
 #endif
 }
 
+// Decompress `input_data`, which follows the size header, into the
+// `output_len` bytes of `output`. Returns the decompressed size.
+inline size_t ZSTD_UncompressInto(const UncompressionContext& ctx,
+                                  const char* input_data, size_t input_length,
+                                  char* output, uint32_t output_len) {
+#ifdef ZSTD
+#if ZSTD_VERSION_NUMBER >= 500  // v0.5.0+
+  ZSTD_DCtx* context = ctx.GetZSTDContext();
+  assert(context != nullptr);
+  return ZSTD_decompress_usingDict(context, output, output_len, input_data,
+                                   input_length, ctx.dict().data(),
+                                   ctx.dict().size());
+#else  // up to v0.4.x
+  (void)ctx;
+  return ZSTD_decompress(output, output_len, input_data, input_length);
+#endif  // ZSTD_VERSION_NUMBER >= 500
+#else  // ZSTD
+  (void)ctx;
+  (void)input_data;
+  (void)input_length;
+  (void)output;
+  (void)output_len;
+  return 0;
+#endif
+}
+
 // @param compression_dict Data for presetting the compression library's
 //    dictionary.
 inline CacheAllocationPtr ZSTD_Uncompress(
@@ -1046,17 +1110,8 @@ inline CacheAllocationPtr ZSTD_Uncompress(
   }
 
   auto output = AllocateBlock(output_len, allocator);
-  size_t actual_output_length;
-#if ZSTD_VERSION_NUMBER >= 500  // v0.5.0+
-  ZSTD_DCtx* context = ctx.GetZSTDContext();
-  assert(context != nullptr);
-  actual_output_length = ZSTD_decompress_usingDict(
-      context, output.get(), output_len, input_data, input_length,
-      ctx.dict().data(), ctx.dict().size());
-#else  // up to v0.4.x
-  actual_output_length =
-      ZSTD_decompress(output.get(), output_len, input_data, input_length);
-#endif  // ZSTD_VERSION_NUMBER >= 500
+  size_t actual_output_length = ZSTD_UncompressInto(
+      ctx, input_data, input_length, output.get(), output_len);
   assert(actual_output_length == output_len);
   *decompress_size = static_cast<int>(actual_output_length);
   return output;
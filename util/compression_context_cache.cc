@@ -20,9 +20,6 @@ namespace compression_cache {
 
 void* const SentinelValue = nullptr;
 // Cache ZSTD uncompression contexts for reads
-// if needed we can add ZSTD compression context caching
-// which is currently is not done since BlockBasedTableBuilder
-// simply creates one compression context per new SST file.
 struct ZSTDCachedData {
   // We choose to cache the below structure instead of a ptr
   // because we want to avoid a) native types leak b) make
@@ -64,6 +61,61 @@ struct ZSTDCachedData {
 };
 static_assert(sizeof(ZSTDCachedData) % CACHE_LINE_SIZE == 0,
               "Expected CACHE_LINE_SIZE alignment");
+
+enum CompressContextKind {
+  kZSTDCompressContext,
+  kLZ4Stream,
+  kLZ4HCStream,
+  kNumCompressContextKinds,
+};
+
+void FreeCompressContext(CompressContextKind kind, void* ctx) {
+  switch (kind) {
+    case kZSTDCompressContext:
+#if defined(ZSTD) && (ZSTD_VERSION_NUMBER >= 500)
+      ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(ctx));
+#endif
+      break;
+    case kLZ4Stream:
+#if defined(LZ4) && LZ4_VERSION_NUMBER >= 10400  // r124+
+      LZ4_freeStream(static_cast<LZ4_stream_t*>(ctx));
+#endif
+      break;
+    case kLZ4HCStream:
+#if defined(LZ4) && LZ4_VERSION_NUMBER >= 10400  // r124+
+      LZ4_freeStreamHC(static_cast<LZ4_streamHC_t*>(ctx));
+#endif
+      break;
+    default:
+      assert(false);
+  }
+  (void)ctx;
+}
+
+// The idle compression contexts of a core, one per kind
+struct CompressCachedData {
+  std::atomic<void*> slots[kNumCompressContextKinds];
+  char padding[(CACHE_LINE_SIZE -
+                sizeof(slots) % CACHE_LINE_SIZE)];  // unused padding field
+
+  CompressCachedData() {
+    for (auto& slot : slots) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  ~CompressCachedData() {
+    for (int kind = 0; kind < kNumCompressContextKinds; ++kind) {
+      void* ctx = slots[kind].load(std::memory_order_relaxed);
+      if (ctx != nullptr) {
+        FreeCompressContext(static_cast<CompressContextKind>(kind), ctx);
+      }
+    }
+  }
+  CompressCachedData(const CompressCachedData&) = delete;
+  CompressCachedData& operator=(const CompressCachedData&) = delete;
+};
+static_assert(sizeof(CompressCachedData) % CACHE_LINE_SIZE == 0,
+              "Expected CACHE_LINE_SIZE alignment");
 }  // namespace compression_cache
 
 using namespace compression_cache;
@@ -81,9 +133,27 @@ class CompressionContextCache::Rep {
     auto* cn = per_core_uncompr_.AccessAtCore(static_cast<size_t>(idx));
     cn->ReturnUncompressData();
   }
+  void* TakeCompressContext(CompressContextKind kind) {
+    auto& slot = per_core_compr_.Access()->slots[kind];
+    // Skip the exchange, which dirties the cache line, when the slot is empty
+    if (slot.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;
+    }
+    return slot.exchange(nullptr, std::memory_order_acquire);
+  }
+  void ReturnCompressContext(CompressContextKind kind, void* ctx) {
+    assert(ctx != nullptr);
+    auto& slot = per_core_compr_.Access()->slots[kind];
+    void* expected = nullptr;
+    if (!slot.compare_exchange_strong(expected, ctx,
+                                      std::memory_order_release)) {
+      FreeCompressContext(kind, ctx);
+    }
+  }
 
  private:
   CoreLocalArray<ZSTDCachedData> per_core_uncompr_;
+  CoreLocalArray<CompressCachedData> per_core_compr_;
 };
 
 CompressionContextCache::CompressionContextCache() : rep_(new Rep()) {}
@@ -104,6 +174,30 @@ void CompressionContextCache::ReturnCachedZSTDUncompressData(int64_t idx) {
   rep_->ReturnZSTDUncompressData(idx);
 }
 
+void* CompressionContextCache::TakeZSTDCompressContext() {
+  return rep_->TakeCompressContext(kZSTDCompressContext);
+}
+
+void* CompressionContextCache::TakeLZ4Stream() {
+  return rep_->TakeCompressContext(kLZ4Stream);
+}
+
+void* CompressionContextCache::TakeLZ4HCStream() {
+  return rep_->TakeCompressContext(kLZ4HCStream);
+}
+
+void CompressionContextCache::ReturnZSTDCompressContext(void* ctx) {
+  rep_->ReturnCompressContext(kZSTDCompressContext, ctx);
+}
+
+void CompressionContextCache::ReturnLZ4Stream(void* stream) {
+  rep_->ReturnCompressContext(kLZ4Stream, stream);
+}
+
+void CompressionContextCache::ReturnLZ4HCStream(void* stream) {
+  rep_->ReturnCompressContext(kLZ4HCStream, stream);
+}
+
 CompressionContextCache::~CompressionContextCache() { delete rep_; }
 
 }  // namespace TERARKDB_NAMESPACE
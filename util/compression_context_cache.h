@@ -14,6 +14,13 @@
 // instance is atomically replaced with a sentinel value for the time of being
 // used. If it turns out that another thread is already makes use of the
 // instance we still create one on the heap which is later is destroyed.
+//
+// The compression contexts (ZSTD_CCtx, LZ4_stream_t, LZ4_streamHC_t) are
+// pooled per core the other way round: a slot of the current core holds an
+// idle context, taken by the next CompressionContext or LZ4 compression and
+// put back into the slot of the core it ends on, or freed if that slot is
+// taken. So the builders of flush, compaction and GC reuse them instead of
+// allocating one per file or per block.
 
 #pragma once
 
@@ -36,6 +43,15 @@ class CompressionContextCache {
   ZSTDUncompressCachedData GetCachedZSTDUncompressData();
   void ReturnCachedZSTDUncompressData(int64_t idx);
 
+  // An idle context of the pool of the current core, nullptr if none
+  void* TakeZSTDCompressContext();
+  void* TakeLZ4Stream();
+  void* TakeLZ4HCStream();
+  // Pool the context again, or free it if the pool already holds one
+  void ReturnZSTDCompressContext(void* ctx);
+  void ReturnLZ4Stream(void* stream);
+  void ReturnLZ4HCStream(void* stream);
+
  private:
   // Singleton
   CompressionContextCache();
@@ -87,11 +87,12 @@ Status DeleteScheduler::DeleteFile(const std::string& file_path,
                                    const std::string& dir_to_sync,
                                    const bool force_bg) {
   Status s;
-  if (rate_bytes_per_sec_.load() <= 0 ||
+  if (rate_bytes_per_sec_.load() <= 0 || sst_file_manager_->zoned() ||
       (!force_bg &&
        total_trash_size_.load() >
            sst_file_manager_->GetTotalSize() * max_trash_db_ratio_.load())) {
-    // Rate limiting is disabled or trash size makes up more than
+    // Rate limiting is disabled, the file is on zoned storage where deleting
+    // only invalidates extents, or trash size makes up more than
     // max_trash_db_ratio_ (default 25%) of the total DB size
     TEST_SYNC_POINT("DeleteScheduler::DeleteFile");
     s = env_->DeleteFile(file_path);
@@ -29,7 +29,8 @@ class SstFileManagerImpl;
 // if they are happening in a rate faster than rate_bytes_per_sec,
 //
 // Rate limiting can be turned off by setting rate_bytes_per_sec = 0, In this
-// case DeleteScheduler will delete files immediately.
+// case DeleteScheduler will delete files immediately. Files on zoned storage
+// are always deleted immediately, see SstFileManagerImpl::zoned().
 class DeleteScheduler {
  public:
   DeleteScheduler(Env* env, int64_t rate_bytes_per_sec, Logger* info_log,
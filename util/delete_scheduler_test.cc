@@ -334,6 +334,36 @@ TEST_F(DeleteSchedulerTest, DisableRateLimiting) {
   TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
 }
 
+TEST_F(DeleteSchedulerTest, ZonedStorageDeletesImmediately) {
+  int bg_delete_file = 0;
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "DeleteScheduler::DeleteTrashFile:DeleteFile",
+      [&](void* /*arg*/) { bg_delete_file++; });
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->SetCallBack(
+      "SstFileManagerImpl::IsZonedEnv",
+      [&](void* arg) { *static_cast<bool*>(arg) = true; });
+
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->EnableProcessing();
+
+  rate_bytes_per_sec_ = 1024;
+  NewDeleteScheduler();
+  ASSERT_TRUE(sst_file_mgr_->zoned());
+
+  for (int i = 0; i < 10; i++) {
+    std::string dummy_file = NewDummyFile("dummy.data");
+    ASSERT_OK(delete_scheduler_->DeleteFile(dummy_file, "", true));
+    ASSERT_TRUE(env_->FileExists(dummy_file).IsNotFound());
+    ASSERT_EQ(CountNormalFiles(), 0);
+    ASSERT_EQ(CountTrashFiles(), 0);
+  }
+
+  ASSERT_EQ(bg_delete_file, 0);
+  ASSERT_EQ(0U, delete_scheduler_->GetTotalTrashSize());
+  ASSERT_EQ(0U, sst_file_mgr_->GetTotalSize());
+
+  TERARKDB_NAMESPACE::SyncPoint::GetInstance()->DisableProcessing();
+}
+
 // Testing that moving files to trash with the same name is not a problem
 // 1- Create 10 files with the same name "conflict.data"
 // 2- Delete the 10 files using DeleteScheduler
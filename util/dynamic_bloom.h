@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
@@ -64,6 +65,12 @@ class DynamicBloom {
   // Multithreaded access to this function is OK
   bool MayContainHash(uint32_t hash) const;
 
+  // MayContain() of keys[0, num_keys), stored in may_contain. The cache
+  // lines of a batch of keys are prefetched before probing any of them.
+  // Multithreaded access to this function is OK
+  void MayContain(size_t num_keys, const Slice* keys,
+                  bool* may_contain) const;
+
   void Prefetch(uint32_t h);
 
   uint32_t GetNumBlocks() const { return kNumBlocks; }
@@ -138,6 +145,27 @@ inline void DynamicBloom::Prefetch(uint32_t h) {
 #pragma warning(pop)
 #endif
 
+inline void DynamicBloom::MayContain(size_t num_keys, const Slice* keys,
+                                     bool* may_contain) const {
+  const size_t kBatchSize = 32;
+  uint32_t hashes[kBatchSize];
+  for (size_t begin = 0; begin < num_keys; begin += kBatchSize) {
+    size_t size = std::min(kBatchSize, num_keys - begin);
+    for (size_t i = 0; i < size; ++i) {
+      hashes[i] = hash_func_(keys[begin + i]);
+      if (kNumBlocks != 0) {
+        uint32_t h = hashes[i];
+        uint32_t b =
+            ((h >> 11 | (h << 21)) % kNumBlocks) * (CACHE_LINE_SIZE * 8);
+        PREFETCH(&(data_[b / 8]), 0, 3);
+      }
+    }
+    for (size_t i = 0; i < size; ++i) {
+      may_contain[begin + i] = MayContainHash(hashes[i]);
+    }
+  }
+}
+
 inline bool DynamicBloom::MayContainHash(uint32_t h) const {
   assert(IsInitialized());
   const uint32_t delta = (h >> 17) | (h << 15);  // Rotate right 17 bits
@@ -21,6 +21,7 @@ int main() {
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -98,6 +99,30 @@ TEST_F(DynamicBloomTest, SmallConcurrentAdd) {
   ASSERT_TRUE(!bloom2.MayContain("foo"));
 }
 
+TEST_F(DynamicBloomTest, MayContainBatch) {
+  std::vector<std::string> keys;
+  char buffer[sizeof(uint64_t)];
+  for (uint64_t i = 0; i < 1000; ++i) {
+    keys.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  std::unique_ptr<bool[]> may_contain(new bool[keys.size()]);
+  for (uint32_t locality = 0; locality < 2; ++locality) {
+    Arena arena;
+    DynamicBloom bloom(&arena, 5000, locality, 6);
+    for (size_t i = 0; i < keys.size(); i += 2) {
+      bloom.Add(key_slices[i]);
+    }
+    bloom.MayContain(key_slices.size(), key_slices.data(), may_contain.get());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      ASSERT_EQ(bloom.MayContain(key_slices[i]), may_contain[i]) << i;
+      if (i % 2 == 0) {
+        ASSERT_TRUE(may_contain[i]) << i;
+      }
+    }
+  }
+}
+
 static uint32_t NextNum(uint32_t num) {
   if (num < 10) {
     num += 1;
@@ -10,13 +10,17 @@
 #include "util/file_reader_writer.h"
 
 #include <algorithm>
+#include <deque>
 #include <mutex>
 
 #include "fs/log.h"
 #include "monitoring/histogram.h"
 #include "monitoring/iostats_context_imp.h"
 #include "port/port.h"
+#include "rocksdb/resource_group.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/filename.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 #include "util/rate_limiter.h"
 #include "util/string_util.h"
@@ -61,6 +65,7 @@ Status SequentialFileReader::Read(size_t n, Slice* result, char* scratch) {
     s = file_->Read(n, result, scratch);
   }
   IOSTATS_ADD(bytes_read, result->size());
+  RecordIOAttribution(io_file_kind_, IOOpKind::kRead, result->size());
   return s;
 }
 
@@ -87,7 +92,9 @@ RandomAccessFileReader::RandomAccessFileReader(
       for_compaction_(for_compaction),
       file_read_hist_(file_read_hist),
       rate_limiter_(rate_limiter),
-      listeners_() {
+      listeners_(),
+      io_file_kind_(IOFileKindFromName(file_name_)),
+      resource_group_(nullptr) {
 #ifndef ROCKSDB_LITE
   std::for_each(listeners.begin(), listeners.end(),
                 [this](const std::shared_ptr<EventListener>& e) {
@@ -103,6 +110,11 @@ RandomAccessFileReader::RandomAccessFileReader(
 
 Status RandomAccessFileReader::Read(uint64_t offset, size_t n, Slice* result,
                                     char* scratch) const {
+  if (resource_group_ != nullptr) {
+    resource_group_->Request(for_compaction_ ? ResourceGroup::kBackground
+                                             : ResourceGroup::kRead,
+                             n, stats_);
+  }
   Status s;
   uint64_t elapsed = 0;
   {
@@ -213,6 +225,7 @@ Status RandomAccessFileReader::Read(uint64_t offset, size_t n, Slice* result,
     }
     IOSTATS_ADD_IF_POSITIVE(bytes_read, result->size());
   }
+  RecordIOAttribution(io_file_kind_, IOOpKind::kRead, result->size());
   if (stats_ != nullptr && file_read_hist_ != nullptr) {
     file_read_hist_->Add(elapsed);
   }
@@ -395,7 +408,10 @@ Status WritableFileWriter::Sync(bool use_fsync) {
     return s;
   }
   TEST_KILL_RANDOM("WritableFileWriter::Sync:0", rocksdb_kill_odds);
-  if (!use_direct_io() && pending_sync_) {
+  // Direct writes still leave the size of a WAL growing into its
+  // preallocated space to be synced
+  if ((!use_direct_io() || io_file_kind_ == IOFileKind::kWAL) &&
+      pending_sync_) {
     s = SyncInternal(use_fsync);
     if (!s.ok()) {
       return s;
@@ -477,6 +493,9 @@ Status WritableFileWriter::WriteBuffered(const char* data, size_t size,
   const char* src = data;
   size_t left = size;
   size_t filesize_for_sync = filesize_;
+  if (resource_group_ != nullptr) {
+    resource_group_->Request(ResourceGroup::kBackground, size, stats_);
+  }
 
   while (left > 0) {
     size_t allowed;
@@ -522,6 +541,7 @@ Status WritableFileWriter::WriteBuffered(const char* data, size_t size,
     }
 
     IOSTATS_ADD(bytes_written, allowed);
+    RecordIOAttribution(io_file_kind_, IOOpKind::kWrite, allowed);
     TEST_KILL_RANDOM("WritableFileWriter::WriteBuffered:0", rocksdb_kill_odds);
 
     left -= allowed;
@@ -545,6 +565,10 @@ Status WritableFileWriter::WriteDirect() {
   Status s;
   const size_t alignment = buf_.Alignment();
   assert((next_write_offset_ % alignment) == 0);
+  if (resource_group_ != nullptr) {
+    resource_group_->Request(ResourceGroup::kBackground, buf_.CurrentSize(),
+                             stats_);
+  }
 
   // Calculate whole page final file advance if all writes succeed
   size_t file_advance = TruncateToPageBoundary(alignment, buf_.CurrentSize());
@@ -593,6 +617,7 @@ Status WritableFileWriter::WriteDirect() {
     }
 
     IOSTATS_ADD(bytes_written, size);
+    RecordIOAttribution(io_file_kind_, IOOpKind::kWrite, size);
     left -= size;
     src += size;
     write_offset += size;
@@ -820,6 +845,257 @@ class MemoryRandomAccessFile : public RandomAccessFile {
   uint64_t size_;
   Status status_;
 };
+
+// Hands the writes to a thread of its own, so that the writer fills its next
+// buffer while the previous ones are written. The operations that must see
+// the writes done wait for the queued ones, the first failed write fails the
+// later operations.
+class WriteBehindWritableFile : public WritableFileWrapper {
+ public:
+  WriteBehindWritableFile(std::unique_ptr<WritableFile>&& file,
+                          size_t max_queued_writes)
+      : WritableFileWrapper(file.get()),
+        file_(std::move(file)),
+        max_queued_writes_(std::max<size_t>(max_queued_writes, 1)),
+        alignment_(file_->GetRequiredBufferAlignment()),
+        size_(file_->GetFileSize()),
+        cv_(&mutex_),
+        thread_(&WriteBehindWritableFile::Run, this) {}
+
+  ~WriteBehindWritableFile() override { Stop(); }
+
+  Status Append(const Slice& data) override {
+    size_ += data.size();
+    return Enqueue(Write::kAppend, data, 0);
+  }
+
+  Status PositionedAppend(const Slice& data, uint64_t offset) override {
+    size_ = std::max(size_, offset + data.size());
+    return Enqueue(Write::kPositionedAppend, data, offset);
+  }
+
+  void PrepareWrite(size_t offset, size_t len) override {
+    Enqueue(Write::kPrepareWrite, Slice(), offset, len);
+  }
+
+  Status Flush() override { return Enqueue(Write::kFlush, Slice(), 0); }
+
+  Status RangeSync(uint64_t offset, uint64_t nbytes) override {
+    return Enqueue(Write::kRangeSync, Slice(), offset, nbytes);
+  }
+
+  Status Truncate(uint64_t size) override {
+    Status s = Wait();
+    if (s.ok()) {
+      s = file_->Truncate(size);
+      size_ = size;
+    }
+    return s;
+  }
+
+  Status Frozen() override {
+    Status s = Wait();
+    return s.ok() ? file_->Frozen() : s;
+  }
+
+  Status Close() override {
+    Status s = Stop();
+    Status interim = file_->Close();
+    return s.ok() ? interim : s;
+  }
+
+  Status Sync() override {
+    Status s = Wait();
+    return s.ok() ? file_->Sync() : s;
+  }
+
+  Status Fsync() override {
+    Status s = Wait();
+    return s.ok() ? file_->Fsync() : s;
+  }
+
+  // Sync() waits for the writes of the same writer
+  bool IsSyncThreadSafe() const override { return false; }
+
+  uint64_t GetFileSize() override { return size_; }
+
+  void SetFileType(DBFileType type) override { file_->SetFileType(type); }
+  DBFileType GetFileType() const override { return file_->GetFileType(); }
+  void SetFileLevel(uint64_t level) override { file_->SetFileLevel(level); }
+  uint64_t GetFileLevel() const override { return file_->GetFileLevel(); }
+  void SetPlacementFileType(PlacementFileType ftype) override {
+    file_->SetPlacementFileType(ftype);
+  }
+  PlacementFileType GetPlacementFileType() const override {
+    return file_->GetPlacementFileType();
+  }
+
+  void SetPreallocationBlockSize(size_t size) override {
+    Wait();
+    file_->SetPreallocationBlockSize(size);
+  }
+
+  void GetPreallocationStatus(size_t* block_size,
+                              size_t* last_allocated_block) override {
+    Wait();
+    file_->GetPreallocationStatus(block_size, last_allocated_block);
+  }
+
+  Status InvalidateCache(size_t offset, size_t length) override {
+    Status s = Wait();
+    return s.ok() ? file_->InvalidateCache(offset, length) : s;
+  }
+
+  Status Allocate(uint64_t offset, uint64_t len) override {
+    Status s = Wait();
+    return s.ok() ? file_->Allocate(offset, len) : s;
+  }
+
+ private:
+  struct Write {
+    enum Kind {
+      kAppend,
+      kPositionedAppend,
+      kPrepareWrite,
+      kFlush,
+      kRangeSync,
+    } kind;
+    AlignedBuffer data;
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  Status Enqueue(Write::Kind kind, const Slice& data, uint64_t offset,
+                 uint64_t length = 0) {
+    Write write;
+    write.kind = kind;
+    write.offset = offset;
+    write.length = length;
+    if (!data.empty()) {
+      {
+        MutexLock l(&mutex_);
+        if (!free_buffers_.empty()) {
+          write.data = std::move(free_buffers_.back());
+          free_buffers_.pop_back();
+        }
+      }
+      // The copy is made without the lock
+      if (write.data.Capacity() < data.size()) {
+        write.data.Alignment(alignment_);
+        write.data.AllocateNewBuffer(data.size());
+      }
+      write.data.Size(0);
+      write.data.Append(data.data(), data.size());
+    }
+    MutexLock l(&mutex_);
+    while (!data.empty() && queued_buffers_ >= max_queued_writes_ &&
+           status_.ok()) {
+      cv_.Wait();
+    }
+    if (!status_.ok()) {
+      return status_;
+    }
+    if (!data.empty()) {
+      ++queued_buffers_;
+    }
+    queue_.push_back(std::move(write));
+    cv_.SignalAll();
+    return Status::OK();
+  }
+
+  // Wait for the queued writes
+  Status Wait() {
+    MutexLock l(&mutex_);
+    while (!queue_.empty() || writing_) {
+      cv_.Wait();
+    }
+    return status_;
+  }
+
+  // Wait for the queued writes and stop the thread
+  Status Stop() {
+    {
+      MutexLock l(&mutex_);
+      if (stop_) {
+        return status_;
+      }
+      stop_ = true;
+      cv_.SignalAll();
+    }
+    thread_.join();
+    return status_;
+  }
+
+  void Run() {
+    MutexLock l(&mutex_);
+    while (true) {
+      while (queue_.empty() && !stop_) {
+        cv_.Wait();
+      }
+      if (queue_.empty()) {
+        break;
+      }
+      Write write = std::move(queue_.front());
+      queue_.pop_front();
+      writing_ = true;
+      bool failed = !status_.ok();
+      mutex_.Unlock();
+      Status s;
+      if (!failed) {
+        s = Execute(&write);
+      }
+      mutex_.Lock();
+      if (!s.ok() && status_.ok()) {
+        status_ = s;
+      }
+      if (write.data.CurrentSize() > 0) {
+        --queued_buffers_;
+        if (free_buffers_.size() < max_queued_writes_) {
+          free_buffers_.emplace_back(std::move(write.data));
+        }
+      }
+      writing_ = false;
+      cv_.SignalAll();
+    }
+  }
+
+  Status Execute(Write* write) {
+    Slice data(write->data.BufferStart(), write->data.CurrentSize());
+    switch (write->kind) {
+      case Write::kAppend:
+        return file_->Append(data);
+      case Write::kPositionedAppend:
+        return file_->PositionedAppend(data, write->offset);
+      case Write::kPrepareWrite:
+        file_->PrepareWrite(static_cast<size_t>(write->offset),
+                            static_cast<size_t>(write->length));
+        return Status::OK();
+      case Write::kFlush:
+        return file_->Flush();
+      case Write::kRangeSync:
+        return file_->RangeSync(write->offset, write->length);
+    }
+    return Status::OK();
+  }
+
+  std::unique_ptr<WritableFile> file_;
+  const size_t max_queued_writes_;
+  const size_t alignment_;
+  // The size of the file once the queued writes are done
+  uint64_t size_;
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::deque<Write> queue_;
+  // The queued writes holding data, at most max_queued_writes_
+  size_t queued_buffers_ = 0;
+  std::vector<AlignedBuffer> free_buffers_;
+  Status status_;
+  bool writing_ = false;
+  bool stop_ = false;
+  // Last, it runs as soon as it's constructed
+  port::Thread thread_;
+};
 }  // namespace
 
 Status FilePrefetchBuffer::Prefetch(RandomAccessFileReader* reader,
@@ -940,6 +1216,27 @@ std::unique_ptr<RandomAccessFile> NewMemoryRandomAccessFile(
   return result;
 }
 
+std::unique_ptr<WritableFile> NewWriteBehindWritableFileIfNeeded(
+    std::unique_ptr<WritableFile>&& file, const std::string& fname,
+    const EnvOptions& options) {
+  if (options.write_behind_buffers < 2) {
+    return std::move(file);
+  }
+  size_t slash = fname.find_last_of('/');
+  uint64_t number;
+  FileType type;
+  if (!ParseFileName(slash == std::string::npos ? fname
+                                                : fname.substr(slash + 1),
+                     &number, &type) ||
+      type != kTableFile) {
+    return std::move(file);
+  }
+  // One buffer is being written, the others are queued
+  std::unique_ptr<WritableFile> result(new WriteBehindWritableFile(
+      std::move(file), options.write_behind_buffers - 1));
+  return result;
+}
+
 Status NewWritableFile(Env* env, const std::string& fname,
                        std::unique_ptr<WritableFile>* result,
                        const EnvOptions& options) {
@@ -11,6 +11,7 @@
 #include <sstream>
 #include <string>
 
+#include "monitoring/io_attribution.h"
 #include "port/port.h"
 #include "rocksdb/env.h"
 #include "rocksdb/listener.h"
@@ -23,6 +24,7 @@ namespace TERARKDB_NAMESPACE {
 
 class Statistics;
 class HistogramImpl;
+class ResourceGroup;
 
 std::unique_ptr<RandomAccessFile> NewReadaheadRandomAccessFile(
     std::unique_ptr<RandomAccessFile>&& file, size_t readahead_size);
@@ -30,16 +32,26 @@ std::unique_ptr<RandomAccessFile> NewReadaheadRandomAccessFile(
 std::unique_ptr<RandomAccessFile> NewMemoryRandomAccessFile(
     std::unique_ptr<RandomAccessFile>&& file, uint64_t file_size);
 
+// `file` written behind by a thread of its own if `fname` is a table file and
+// options.write_behind_buffers asks for it, see DBOptions::write_behind_buffers
+std::unique_ptr<WritableFile> NewWriteBehindWritableFileIfNeeded(
+    std::unique_ptr<WritableFile>&& file, const std::string& fname,
+    const EnvOptions& options);
+
 class SequentialFileReader {
  private:
   std::unique_ptr<SequentialFile> file_;
   std::string file_name_;
   std::atomic<size_t> offset_;  // read offset
+  IOFileKind io_file_kind_;
 
  public:
   explicit SequentialFileReader(std::unique_ptr<SequentialFile>&& _file,
                                 const std::string& _file_name)
-      : file_(std::move(_file)), file_name_(_file_name), offset_(0) {}
+      : file_(std::move(_file)),
+        file_name_(_file_name),
+        offset_(0),
+        io_file_kind_(IOFileKindFromName(_file_name)) {}
 
   SequentialFileReader(SequentialFileReader&& o) ROCKSDB_NOEXCEPT {
     *this = std::move(o);
@@ -47,6 +59,7 @@ class SequentialFileReader {
 
   SequentialFileReader& operator=(SequentialFileReader&& o) ROCKSDB_NOEXCEPT {
     file_ = std::move(o.file_);
+    io_file_kind_ = o.io_file_kind_;
     return *this;
   }
 
@@ -96,6 +109,8 @@ class RandomAccessFileReader {
   HistogramImpl* file_read_hist_;
   RateLimiter* rate_limiter_;
   std::vector<std::shared_ptr<EventListener>> listeners_;
+  IOFileKind io_file_kind_;
+  ResourceGroup* resource_group_;
 
  public:
   explicit RandomAccessFileReader(
@@ -125,6 +140,13 @@ class RandomAccessFileReader {
 
   const std::string& file_name() const { return file_name_; }
 
+  // The reads are attributed to `kind`, which is guessed from the file name
+  // by default, see IOFileKindFromName()
+  void set_io_file_kind(IOFileKind kind) { io_file_kind_ = kind; }
+
+  // The reads are charged to `group`, as background reads if for compaction
+  void set_resource_group(ResourceGroup* group) { resource_group_ = group; }
+
   void set_use_fsread(bool b) { use_fsread_ = b; }
   bool use_fsread() const { return use_fsread_; }
   bool use_direct_io() const { return file_->use_direct_io(); }
@@ -171,13 +193,16 @@ class WritableFileWriter {
   RateLimiter* rate_limiter_;
   Statistics* stats_;
   std::vector<std::shared_ptr<EventListener>> listeners_;
+  IOFileKind io_file_kind_;
+  ResourceGroup* resource_group_;
 
  public:
   WritableFileWriter(
       std::unique_ptr<WritableFile>&& file, const std::string& _file_name,
       const EnvOptions& options, Statistics* stats = nullptr,
       const std::vector<std::shared_ptr<EventListener>>& listeners = {})
-      : writable_file_(std::move(file)),
+      : writable_file_(NewWriteBehindWritableFileIfNeeded(
+            std::move(file), _file_name, options)),
         file_name_(_file_name),
         buf_(),
         max_buffer_size_(options.writable_file_max_buffer_size),
@@ -190,7 +215,9 @@ class WritableFileWriter {
         bytes_per_sync_(options.bytes_per_sync),
         rate_limiter_(options.rate_limiter),
         stats_(stats),
-        listeners_() {
+        listeners_(),
+        io_file_kind_(IOFileKindFromName(_file_name)),
+        resource_group_(nullptr) {
     TEST_SYNC_POINT_CALLBACK("WritableFileWriter::WritableFileWriter:0",
                              reinterpret_cast<void*>(max_buffer_size_));
     buf_.Alignment(writable_file_->GetRequiredBufferAlignment());
@@ -215,6 +242,13 @@ class WritableFileWriter {
 
   const std::string& file_name() const { return file_name_; }
 
+  // The writes are attributed to `kind`, which is guessed from the file name
+  // by default, see IOFileKindFromName()
+  void set_io_file_kind(IOFileKind kind) { io_file_kind_ = kind; }
+
+  // The writes are charged to `group` as background writes
+  void set_resource_group(ResourceGroup* group) { resource_group_ = group; }
+
   Status Append(const Slice& data);
 
   Status Pad(const size_t pad_bytes);
@@ -222,6 +222,69 @@ TEST_F(WritableFileWriterTest, AppendStatusReturn) {
 }
 #endif
 
+TEST_F(WritableFileWriterTest, WriteBehind) {
+  class FakeWF : public WritableFile {
+   public:
+    FakeWF(std::string* _file_data, bool _use_direct_io)
+        : file_data_(_file_data), use_direct_io_(_use_direct_io) {}
+
+    Status Append(const Slice& data) override {
+      file_data_->append(data.data(), data.size());
+      return Status::OK();
+    }
+    Status PositionedAppend(const Slice& data, uint64_t pos) override {
+      file_data_->resize(pos);
+      file_data_->append(data.data(), data.size());
+      return Status::OK();
+    }
+    Status Truncate(uint64_t size) override {
+      file_data_->resize(size);
+      return Status::OK();
+    }
+    Status Close() override { return Status::OK(); }
+    Status Flush() override { return Status::OK(); }
+    Status Sync() override { return Status::OK(); }
+    uint64_t GetFileSize() override { return file_data_->size(); }
+    bool use_direct_io() const override { return use_direct_io_; }
+
+    std::string* file_data_;
+    bool use_direct_io_;
+  };
+
+  Random r(301);
+  for (int attempt = 0; attempt < 4; attempt++) {
+    bool use_direct_io = attempt % 2 == 1;
+#ifdef ROCKSDB_LITE
+    use_direct_io = false;
+#endif
+    EnvOptions env_options;
+    env_options.writable_file_max_buffer_size = 64 * 1024;
+    env_options.write_behind_buffers = 3;
+    std::string actual;
+    std::unique_ptr<WritableFileWriter> writer(new WritableFileWriter(
+        std::unique_ptr<WritableFile>(new FakeWF(&actual, use_direct_io)),
+        attempt < 2 ? "/path/to/000123.sst" : "000123.log", env_options));
+    // Only table files are written behind
+    ASSERT_EQ(attempt < 2,
+              dynamic_cast<FakeWF*>(writer->writable_file()) == nullptr);
+
+    std::string target;
+    for (int i = 0; i < 100; i++) {
+      uint32_t num = r.Skewed(16) * 10 + r.Uniform(100);
+      std::string random_string;
+      test::RandomString(&r, num, &random_string);
+      ASSERT_OK(writer->Append(random_string));
+      target.append(random_string);
+      if (r.Uniform(10) == 0) {
+        ASSERT_OK(writer->Flush());
+      }
+    }
+    ASSERT_OK(writer->Sync(false));
+    ASSERT_OK(writer->Close());
+    ASSERT_EQ(target, actual);
+  }
+}
+
 class ReadaheadRandomAccessFileTest
     : public testing::Test,
       public testing::WithParamInterface<size_t> {
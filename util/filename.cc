@@ -74,6 +74,11 @@ std::string LogFileName(const std::string& name, uint64_t number) {
   return MakeFileName(name, number, "log");
 }
 
+std::string ValueLogFileName(const std::string& name, uint64_t number) {
+  assert(number > 0);
+  return MakeFileName(name, number, "vlog");
+}
+
 std::string ArchivalDirectory(const std::string& dir) {
   return dir + "/" + ARCHIVAL_DIR;
 }
@@ -214,6 +219,14 @@ std::string IdentityFileName(const std::string& dbname) {
   return dbname + "/IDENTITY";
 }
 
+std::string HotBlocksFileName(const std::string& dbname) {
+  return dbname + "/HOT_BLOCKS";
+}
+
+std::string TempHotBlocksFileName(const std::string& dbname) {
+  return dbname + "/HOT_BLOCKS." + kTempFileNameSuffix;
+}
+
 // Owned filenames have the form:
 //    dbname/IDENTITY
 //    dbname/CURRENT
@@ -221,10 +234,12 @@ std::string IdentityFileName(const std::string& dbname) {
 //    dbname/<info_log_name_prefix>
 //    dbname/<info_log_name_prefix>.old.[0-9]+
 //    dbname/MANIFEST-[0-9]+
-//    dbname/[0-9]+.(log|sst|blob)
+//    dbname/[0-9]+.(log|sst|blob|vlog)
 //    dbname/METADB-[0-9]+
 //    dbname/OPTIONS-[0-9]+
 //    dbname/OPTIONS-[0-9]+.dbtmp
+//    dbname/HOT_BLOCKS
+//    dbname/HOT_BLOCKS.dbtmp
 //    Disregards / at the beginning
 bool ParseFileName(const std::string& fname, uint64_t* number, FileType* type,
                    WalFileType* log_type) {
@@ -241,6 +256,9 @@ bool ParseFileName(const std::string& fname, uint64_t* number,
   if (rest == "IDENTITY") {
     *number = 0;
     *type = kIdentityFile;
+  } else if (rest == "HOT_BLOCKS" || rest == "HOT_BLOCKS.dbtmp") {
+    *number = 0;
+    *type = kHotBlocksFile;
   } else if (rest == "CURRENT") {
     *number = 0;
     *type = kCurrentFile;
@@ -339,6 +357,8 @@ bool ParseFileName(const std::string& fname, uint64_t* number,
       *type = kTableFile;
     } else if (suffix == Slice(kTempFileNameSuffix)) {
       *type = kTempFile;
+    } else if (suffix == Slice("vlog")) {
+      *type = kValueLogFile;
     } else {
       return false;
     }
@@ -41,7 +41,9 @@ enum FileType {
   kMetaDatabase,
   kIdentityFile,
   kOptionsFile,
-  kSocketFile
+  kSocketFile,
+  kHotBlocksFile,
+  kValueLogFile
 };
 
 // Return the name of the log file with the specified number
@@ -49,6 +51,10 @@ enum FileType {
 // "dbname".
 extern std::string LogFileName(const std::string& dbname, uint64_t number);
 
+// Return the name of the value log file of the log file with the specified
+// number, see DBOptions::value_log_threshold
+extern std::string ValueLogFileName(const std::string& dbname, uint64_t number);
+
 static const std::string ARCHIVAL_DIR = "archive";
 
 extern std::string ArchivalDirectory(const std::string& dbname);
@@ -141,6 +147,16 @@ extern std::string MetaDatabaseName(const std::string& dbname, uint64_t number);
 // either from a backup-image or empty
 extern std::string IdentityFileName(const std::string& dbname);
 
+// Return the name of the file holding the hot block sets of the live tables,
+// which are loaded into the block cache on DB open.
+// Format:  HOT_BLOCKS
+extern std::string HotBlocksFileName(const std::string& dbname);
+
+// Return the name of the temporary file HOT_BLOCKS is written to before it is
+// renamed.
+// Format:  HOT_BLOCKS.dbtmp
+extern std::string TempHotBlocksFileName(const std::string& dbname);
+
 // If filename is a rocksdb file, store the type of the file in *type.
 // The number encoded in the filename is stored in *number.  If the
 // filename was successfully parsed, returns true.  Else return false.
@@ -7,10 +7,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <string>
 #include <vector>
 
 #include "util/hash.h"
 #include "util/testharness.h"
+#include "util/xxh3.h"
 
 // The hash algorithm is part of the file format, for example for the Bloom
 // filters. Test that the hash values are stable for a set of random strings of
@@ -66,6 +68,26 @@ TEST(HashTest, Values) {
             3382479516);
 }
 
+// Every length class of XXH3 has its own code path, the values are those of
+// the reference xxHash, whatever vector instructions it is built with
+TEST(HashTest, XXH3) {
+  std::string data;
+  for (int i = 0; i < 2048; ++i) {
+    data.push_back(static_cast<char>(i * 31 + 7));
+  }
+  EXPECT_EQ(0x2d06800538d394c2u, XXH3Hash64(data.data(), 0));
+  EXPECT_EQ(0x15f7093b173d005cu, XXH3Hash64(data.data(), 3));
+  EXPECT_EQ(0xdec6a9a43575982eu, XXH3Hash64(data.data(), 8));
+  EXPECT_EQ(0x7e484c18d74895d0u, XXH3Hash64(data.data(), 16));
+  EXPECT_EQ(0x8c97158042fbf926u, XXH3Hash64(data.data(), 100));
+  EXPECT_EQ(0x12fdb864685f344du, XXH3Hash64(data.data(), 200));
+  EXPECT_EQ(0x19f6f9c987331373u, XXH3Hash64(data.data(), 2048));
+
+  // The last byte changes the checksum
+  EXPECT_NE(XXH3ChecksumWithLastByte(data.data(), 100, 0),
+            XXH3ChecksumWithLastByte(data.data(), 100, 1));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -5,22 +5,47 @@
 
 #include "util/iterator_cache.h"
 
+#include <atomic>
+
 #include "db/range_del_aggregator.h"
+#include "monitoring/perf_context_imp.h"
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
 
+namespace {
+std::atomic<size_t> total_arena_bytes(0);
+}  // namespace
+
 IteratorCache::IteratorCache(const DependenceMap& dependence_map,
                              void* callback_arg,
                              const CreateIterCallback& create_iter)
     : dependence_map_(dependence_map),
       callback_arg_(callback_arg),
-      create_iter_(create_iter) {}
+      create_iter_(create_iter),
+      charged_arena_bytes_(0) {
+  ChargeArena();
+}
 
 IteratorCache::~IteratorCache() {
   for (auto pair : iterator_map_) {
     pair.second.iter->~InternalIterator();
   }
+  total_arena_bytes.fetch_sub(charged_arena_bytes_, std::memory_order_relaxed);
+}
+
+size_t IteratorCache::TotalArenaMemoryUsage() {
+  return total_arena_bytes.load(std::memory_order_relaxed);
+}
+
+void IteratorCache::ChargeArena() {
+  // The arena only grows, which happens when an iterator is created
+  size_t usage = arena_.MemoryAllocatedBytes();
+  if (usage != charged_arena_bytes_) {
+    total_arena_bytes.fetch_add(usage - charged_arena_bytes_,
+                                std::memory_order_relaxed);
+    charged_arena_bytes_ = usage;
+  }
 }
 
 InternalIterator* IteratorCache::GetIterator(const FileMetaData* f,
@@ -32,11 +57,14 @@ InternalIterator* IteratorCache::GetIterator(const FileMetaData* f,
     }
     return find->second.iter;
   }
+  PERF_COUNTER_ADD(dependence_iter_create_count, 1);
+  PERF_TIMER_GUARD(dependence_iter_create_nanos);
   CacheItem item;
   item.iter =
       create_iter_(callback_arg_, f, dependence_map_, &arena_, &item.reader);
   item.meta = f;
   assert(item.iter != nullptr);
+  ChargeArena();
   iterator_map_.emplace(f->fd.GetNumber(), item);
   if (reader_ptr != nullptr) {
     *reader_ptr = item.reader;
@@ -54,6 +82,8 @@ InternalIterator* IteratorCache::GetIterator(
     }
     return find->second.iter;
   }
+  PERF_COUNTER_ADD(dependence_iter_create_count, 1);
+  PERF_TIMER_GUARD(dependence_iter_create_nanos);
   CacheItem item;
   item.meta = GetFileMetaData(file_number);
   if (item.meta == nullptr) {
@@ -65,6 +95,7 @@ InternalIterator* IteratorCache::GetIterator(
     item.iter = create_iter_(callback_arg_, item.meta, dependence_map_, &arena_,
                              &item.reader);
   }
+  ChargeArena();
   iterator_map_.emplace(file_number, item);
   if (reader_ptr != nullptr) {
     *reader_ptr = item.reader;
@@ -87,6 +118,8 @@ Status IteratorCache::GetReader(uint64_t file_number, TableReader** reader_ptr,
     }
     return find->second.iter->status();
   }
+  PERF_COUNTER_ADD(dependence_iter_create_count, 1);
+  PERF_TIMER_GUARD(dependence_iter_create_nanos);
   CacheItem item;
   item.meta = GetFileMetaData(file_number);
   if (item.meta == nullptr) {
@@ -97,6 +130,7 @@ Status IteratorCache::GetReader(uint64_t file_number, TableReader** reader_ptr,
                              &item.reader);
     assert(item.iter != nullptr);
   }
+  ChargeArena();
   iterator_map_.emplace(file_number, item);
   if (reader_ptr != nullptr) {
     *reader_ptr = item.reader;
@@ -46,12 +46,19 @@ class IteratorCache {
 
   Arena* GetArena() { return &arena_; }
 
+  // The memory of the arenas of all the live IteratorCaches of the process
+  static size_t TotalArenaMemoryUsage();
+
  private:
+  // Charge the growth of the arena since the last call to the total
+  void ChargeArena();
+
   const DependenceMap& dependence_map_;
   DependenceMap dependence_map_ext_;
   void* callback_arg_;
   CreateIterCallback create_iter_;
   Arena arena_;
+  size_t charged_arena_bytes_;
 
   struct CacheItem {
     InternalIterator* iter;
@@ -40,6 +40,8 @@ class LightLazyBufferState : public LazyBufferState {
     char data[sizeof(LazyBufferContext)];
   };
 
+  constexpr LightLazyBufferState() {}
+
   void destroy(LazyBuffer* /*buffer*/) const override {}
 
   void uninitialized_resize(LazyBuffer* buffer, size_t size) const override {
@@ -89,6 +91,15 @@ class LightLazyBufferState : public LazyBufferState {
   }
 };
 
+namespace {
+// Constant initialized, so static objects of other translation units may use
+// it before its initializer would have run
+const LightLazyBufferState light_lazy_buffer_state;
+}  // namespace
+
+const LazyBufferState* const LazyBufferState::light_state_ =
+    &light_lazy_buffer_state;
+
 class BufferLazyBufferState : public LazyBufferState {
  public:
   struct alignas(LazyBufferContext) Context {
@@ -369,11 +380,6 @@ Status LazyBufferState::dump_buffer(LazyBuffer* buffer,
   return Status::OK();
 }
 
-const LazyBufferState* LazyBufferState::light_state() {
-  static LightLazyBufferState static_state;
-  return &static_state;
-}
-
 const LazyBufferState* LazyBufferState::buffer_state() {
   static BufferLazyBufferState static_state;
   return &static_state;
@@ -420,16 +426,6 @@ bool LazyBufferState::reserve_buffer(LazyBuffer* buffer, size_t size) {
   }
 }
 
-void LazyBuffer::fix_light_state(const LazyBuffer& other) {
-  assert(state_ == LazyBufferState::light_state());
-  assert(other.size_ <= sizeof(LazyBufferContext));
-  data_ = union_cast<LightLazyBufferState::Context>(&context_)->data;
-  size_ = other.size_;
-  if (!other.empty()) {
-    ::memmove(data_, other.data_, size_);
-  }
-}
-
 #ifdef __GNUC__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
@@ -116,6 +116,36 @@ TEST_F(LazyBufferTest, LightState) {
   ASSERT_EQ(buffer.slice(), "aaa");
 }
 
+TEST_F(LazyBufferTest, LightStateCopy) {
+  std::string string(32, 'a');
+  LazyBuffer buffer(string, true);
+  ASSERT_EQ(buffer.TEST_state(), LazyBufferState::light_state());
+  ASSERT_EQ(buffer.data(),
+            reinterpret_cast<const char*>(buffer.TEST_context()->data));
+
+  // Self assign
+  buffer.reset(Slice(buffer.data() + 1, 3), true);
+  ASSERT_EQ(buffer.slice(), "aaa");
+
+  LazyBuffer moved(std::move(buffer));
+  string.assign(32, 'b');
+  ASSERT_EQ(moved.TEST_state(), LazyBufferState::light_state());
+  ASSERT_EQ(moved.data(),
+            reinterpret_cast<const char*>(moved.TEST_context()->data));
+  ASSERT_EQ(moved.slice(), "aaa");
+
+  moved.pin(LazyBufferPinLevel::Internal);
+  ASSERT_EQ(moved.TEST_state(), LazyBufferState::light_state());
+  ASSERT_EQ(moved.slice(), "aaa");
+
+  // Other states keep their own storage
+  std::string target;
+  moved.reset(&target);
+  moved.reset(string, true);
+  ASSERT_EQ(moved.TEST_state(), LazyBufferState::string_state());
+  ASSERT_EQ(target, string);
+}
+
 TEST_F(LazyBufferTest, BufferState) {
   auto test = [](LazyBuffer& b) {
     auto builder = b.get_builder();
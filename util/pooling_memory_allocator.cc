@@ -0,0 +1,155 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/pooling_memory_allocator.h"
+
+#include <assert.h>
+
+#include <mutex>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+const size_t PoolingMemoryAllocator::kMinClassSize;
+const size_t PoolingMemoryAllocator::kClassesPerDoubling;
+
+static_assert(PoolingMemoryAllocator::kMinClassSize == 64,
+              "ClassIndex() assumes the min class size is 2^6");
+
+// Class 0 holds up to kMinClassSize bytes, every doubling above is split into
+// kClassesPerDoubling classes
+size_t PoolingMemoryAllocator::ClassIndex(size_t size) {
+  if (size <= kMinClassSize) {
+    return 0;
+  }
+  size_t s = size - 1;
+  size_t msb = 63 - static_cast<size_t>(__builtin_clzll(s));
+  size_t base = size_t(1) << msb;
+  size_t doubling = msb - 6;
+  size_t sub = (s - base) / (base / kClassesPerDoubling);
+  return 1 + doubling * kClassesPerDoubling + sub;
+}
+
+size_t PoolingMemoryAllocator::ClassSize(size_t index) {
+  if (index == 0) {
+    return kMinClassSize;
+  }
+  size_t doubling = (index - 1) / kClassesPerDoubling;
+  size_t sub = (index - 1) % kClassesPerDoubling;
+  size_t step = (kMinClassSize << doubling) / kClassesPerDoubling;
+  return (kMinClassSize << doubling) + (sub + 1) * step;
+}
+
+PoolingMemoryAllocator::PoolingMemoryAllocator(
+    const PoolingAllocatorOptions& options)
+    : options_(options),
+      num_classes_(ClassIndex(options.max_pooled_size + sizeof(Header)) + 1) {
+  for (size_t core = 0; core < shards_.Size(); ++core) {
+    Shard* shard = shards_.AccessAtCore(core);
+    shard->free_lists.reset(new Header*[num_classes_]());
+  }
+}
+
+PoolingMemoryAllocator::~PoolingMemoryAllocator() {
+  for (size_t core = 0; core < shards_.Size(); ++core) {
+    Shard* shard = shards_.AccessAtCore(core);
+    for (size_t i = 0; i < num_classes_; ++i) {
+      for (Header* h = shard->free_lists[i]; h != nullptr;) {
+        Header* next = h->next;
+        DeallocateToBase(h);
+        h = next;
+      }
+    }
+  }
+}
+
+void* PoolingMemoryAllocator::AllocateFromBase(size_t size) {
+  if (options_.base_allocator) {
+    return options_.base_allocator->Allocate(size);
+  }
+  return new char[size];
+}
+
+void PoolingMemoryAllocator::DeallocateToBase(void* p) {
+  if (options_.base_allocator) {
+    options_.base_allocator->Deallocate(p);
+  } else {
+    delete[] reinterpret_cast<char*>(p);
+  }
+}
+
+void* PoolingMemoryAllocator::Allocate(size_t size) {
+  size_t total = size + sizeof(Header);
+  size_t klass = ClassIndex(total);
+  Header* h = nullptr;
+  if (klass >= num_classes_) {
+    h = reinterpret_cast<Header*>(AllocateFromBase(total));
+    h->klass = kNoClass;
+    return h + 1;
+  }
+  Shard* shard = shards_.Access();
+  {
+    std::lock_guard<SpinMutex> lock(shard->mutex);
+    h = shard->free_lists[klass];
+    if (h != nullptr) {
+      shard->free_lists[klass] = h->next;
+      shard->free_bytes -= ClassSize(klass);
+    }
+  }
+  if (h == nullptr) {
+    h = reinterpret_cast<Header*>(AllocateFromBase(ClassSize(klass)));
+  }
+  h->klass = static_cast<uint32_t>(klass);
+  return h + 1;
+}
+
+void PoolingMemoryAllocator::Deallocate(void* p) {
+  Header* h = reinterpret_cast<Header*>(p) - 1;
+  if (h->klass != kNoClass) {
+    assert(h->klass < num_classes_);
+    size_t class_size = ClassSize(h->klass);
+    Shard* shard = shards_.Access();
+    std::lock_guard<SpinMutex> lock(shard->mutex);
+    if (shard->free_bytes + class_size <= options_.max_free_bytes_per_core) {
+      h->next = shard->free_lists[h->klass];
+      shard->free_lists[h->klass] = h;
+      shard->free_bytes += class_size;
+      return;
+    }
+  }
+  DeallocateToBase(h);
+}
+
+size_t PoolingMemoryAllocator::UsableSize(void* p,
+                                          size_t allocation_size) const {
+  Header* h = reinterpret_cast<Header*>(p) - 1;
+  if (h->klass == kNoClass) {
+    return allocation_size;
+  }
+  return ClassSize(h->klass) - sizeof(Header);
+}
+
+size_t PoolingMemoryAllocator::GetFreeBytes() const {
+  size_t free_bytes = 0;
+  for (size_t core = 0; core < shards_.Size(); ++core) {
+    Shard* shard = shards_.AccessAtCore(core);
+    std::lock_guard<SpinMutex> lock(shard->mutex);
+    free_bytes += shard->free_bytes;
+  }
+  return free_bytes;
+}
+
+Status NewPoolingMemoryAllocator(
+    const PoolingAllocatorOptions& options,
+    std::shared_ptr<MemoryAllocator>* memory_allocator) {
+  if (memory_allocator == nullptr) {
+    return Status::InvalidArgument("memory_allocator must be non-null.");
+  }
+  memory_allocator->reset(new PoolingMemoryAllocator(options));
+  return Status::OK();
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,68 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "port/port.h"
+#include "rocksdb/memory_allocator.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/core_local.h"
+#include "util/mutexlock.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// Rounds the allocations up to size classes, four per power of two, and keeps
+// the freed ones in per-core free lists for the next allocation of the same
+// class. See NewPoolingMemoryAllocator().
+class PoolingMemoryAllocator : public MemoryAllocator {
+ public:
+  static const size_t kMinClassSize = 64;
+  static const size_t kClassesPerDoubling = 4;
+
+  explicit PoolingMemoryAllocator(const PoolingAllocatorOptions& options);
+  ~PoolingMemoryAllocator();
+
+  const char* Name() const override { return "PoolingMemoryAllocator"; }
+  void* Allocate(size_t size) override;
+  void Deallocate(void* p) override;
+  size_t UsableSize(void* p, size_t allocation_size) const override;
+
+  // Size class of the allocations of `size` bytes, header included
+  static size_t ClassIndex(size_t size);
+  static size_t ClassSize(size_t index);
+
+  // Free bytes kept in the per-core lists
+  size_t GetFreeBytes() const;
+
+ private:
+  // In front of every allocation, keeps the payload aligned to max_align_t
+  struct alignas(alignof(max_align_t)) Header {
+    // Index of the size class, kNoClass for the allocations too large to pool
+    uint32_t klass;
+    // Link of the free list while the allocation is free
+    Header* next;
+  };
+  static const uint32_t kNoClass = UINT32_MAX;
+
+  struct ALIGN_AS(CACHE_LINE_SIZE) Shard {
+    SpinMutex mutex;
+    std::unique_ptr<Header*[]> free_lists;
+    size_t free_bytes = 0;
+  };
+
+  void* AllocateFromBase(size_t size);
+  void DeallocateToBase(void* p);
+
+  const PoolingAllocatorOptions options_;
+  const size_t num_classes_;
+  CoreLocalArray<Shard> shards_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
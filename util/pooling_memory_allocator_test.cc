@@ -0,0 +1,101 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/pooling_memory_allocator.h"
+
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+TEST(PoolingMemoryAllocatorTest, SizeClasses) {
+  using A = PoolingMemoryAllocator;
+  ASSERT_EQ(0U, A::ClassIndex(1));
+  ASSERT_EQ(0U, A::ClassIndex(64));
+  ASSERT_EQ(1U, A::ClassIndex(65));
+  ASSERT_EQ(80U, A::ClassSize(1));
+  for (size_t size = 1; size < (size_t(1) << 20); ++size) {
+    size_t index = A::ClassIndex(size);
+    ASSERT_LE(size, A::ClassSize(index));
+    if (index > 0) {
+      ASSERT_LT(A::ClassSize(index - 1), size);
+    }
+    // Payloads stay aligned
+    ASSERT_EQ(0U, A::ClassSize(index) % alignof(max_align_t));
+  }
+}
+
+TEST(PoolingMemoryAllocatorTest, Recycle) {
+  PoolingAllocatorOptions options;
+  options.max_pooled_size = 16 * 1024;
+  options.max_free_bytes_per_core = 64 * 1024;
+  std::shared_ptr<MemoryAllocator> allocator;
+  ASSERT_OK(NewPoolingMemoryAllocator(options, &allocator));
+  auto* pool = static_cast<PoolingMemoryAllocator*>(allocator.get());
+
+  void* p = allocator->Allocate(4000);
+  ASSERT_LE(4000U, allocator->UsableSize(p, 4000));
+  memset(p, 'x', allocator->UsableSize(p, 4000));
+  allocator->Deallocate(p);
+  ASSERT_LT(0U, pool->GetFreeBytes());
+  // Any size of the same class gets a freed block back
+  allocator->Deallocate(allocator->Allocate(3990));
+
+  // Too large to pool
+  void* large = allocator->Allocate(100 * 1024);
+  ASSERT_EQ(100U * 1024, allocator->UsableSize(large, 100 * 1024));
+  allocator->Deallocate(large);
+
+  // The free lists are bounded
+  std::vector<void*> blocks;
+  for (int i = 0; i < 100; ++i) {
+    blocks.push_back(allocator->Allocate(8000));
+  }
+  for (void* b : blocks) {
+    allocator->Deallocate(b);
+  }
+  ASSERT_GT(100U * 8000, pool->GetFreeBytes());
+}
+
+TEST(PoolingMemoryAllocatorTest, MultiThread) {
+  PoolingAllocatorOptions options;
+  std::shared_ptr<MemoryAllocator> allocator;
+  ASSERT_OK(NewPoolingMemoryAllocator(options, &allocator));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&allocator, t] {
+      std::vector<char*> blocks;
+      for (size_t i = 0; i < 10000; ++i) {
+        size_t size = 1 + (i * 131 + t) % 20000;
+        char* p = static_cast<char*>(allocator->Allocate(size));
+        p[0] = p[size - 1] = static_cast<char>(t);
+        blocks.push_back(p);
+        if (blocks.size() > 32) {
+          allocator->Deallocate(blocks[i % blocks.size()]);
+          blocks[i % blocks.size()] = blocks.back();
+          blocks.pop_back();
+        }
+      }
+      for (char* p : blocks) {
+        allocator->Deallocate(p);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
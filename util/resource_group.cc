@@ -0,0 +1,138 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "rocksdb/resource_group.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "monitoring/statistics.h"
+#include "rocksdb/env.h"
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// A request that waited longer marks its type throttled for a while
+const uint64_t kThrottledWaitMicros = 1000;
+const uint64_t kThrottledPeriodMicros = 100 * 1000;
+
+class ResourceGroupImpl : public ResourceGroup {
+ public:
+  explicit ResourceGroupImpl(const ResourceGroupOptions& options)
+      : name_(options.name), env_(Env::Default()) {
+    // The operations are refilled once a second, the minimum refill of a
+    // rate limiter is 100 a period
+    read_ops_limiter_ = NewLimiter(options.read_ops_per_sec, 1000 * 1000);
+    limiters_[kRead] = NewLimiter(options.read_bytes_per_sec, 100 * 1000);
+    limiters_[kWrite] = NewLimiter(options.write_bytes_per_sec, 100 * 1000);
+    limiters_[kBackground] =
+        NewLimiter(options.background_bytes_per_sec, 100 * 1000);
+    for (auto& counter : counters_) {
+      counter.bytes.store(0, std::memory_order_relaxed);
+      counter.wait_micros.store(0, std::memory_order_relaxed);
+      counter.throttled_until.store(0, std::memory_order_relaxed);
+    }
+    read_ops_.store(0, std::memory_order_relaxed);
+  }
+
+  const std::string& Name() const override { return name_; }
+
+  void Request(IOType type, size_t bytes, Statistics* stats) override {
+    Counter& counter = counters_[type];
+    counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (type == kRead) {
+      read_ops_.fetch_add(1, std::memory_order_relaxed);
+    }
+    RateLimiter* limiter = limiters_[type].get();
+    if (limiter == nullptr &&
+        (type != kRead || read_ops_limiter_ == nullptr)) {
+      return;
+    }
+    uint64_t start = env_->NowMicros();
+    if (type == kRead && read_ops_limiter_ != nullptr) {
+      Take(read_ops_limiter_.get(), 1);
+    }
+    if (limiter != nullptr) {
+      Take(limiter, bytes);
+    }
+    uint64_t now = env_->NowMicros();
+    uint64_t wait = now > start ? now - start : 0;
+    counter.wait_micros.fetch_add(wait, std::memory_order_relaxed);
+    if (wait > kThrottledWaitMicros) {
+      counter.throttled_until.store(now + kThrottledPeriodMicros,
+                                    std::memory_order_relaxed);
+    }
+    static const Tickers kWaitTickers[] = {
+        RESOURCE_GROUP_READ_WAIT_MICROS, RESOURCE_GROUP_WRITE_WAIT_MICROS,
+        RESOURCE_GROUP_BACKGROUND_WAIT_MICROS};
+    RecordTick(stats, kWaitTickers[type], wait);
+  }
+
+  bool IsThrottled(IOType type) const override {
+    uint64_t until =
+        counters_[type].throttled_until.load(std::memory_order_relaxed);
+    return until != 0 && env_->NowMicros() < until;
+  }
+
+  ResourceGroupStats GetStats() const override {
+    ResourceGroupStats stats;
+    stats.read_ops = read_ops_.load(std::memory_order_relaxed);
+    stats.read_bytes = counters_[kRead].bytes.load(std::memory_order_relaxed);
+    stats.write_bytes =
+        counters_[kWrite].bytes.load(std::memory_order_relaxed);
+    stats.background_bytes =
+        counters_[kBackground].bytes.load(std::memory_order_relaxed);
+    stats.read_wait_micros =
+        counters_[kRead].wait_micros.load(std::memory_order_relaxed);
+    stats.write_wait_micros =
+        counters_[kWrite].wait_micros.load(std::memory_order_relaxed);
+    stats.background_wait_micros =
+        counters_[kBackground].wait_micros.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  struct Counter {
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> wait_micros;
+    std::atomic<uint64_t> throttled_until;
+  };
+
+  static std::unique_ptr<RateLimiter> NewLimiter(int64_t rate,
+                                                 int64_t refill_period_us) {
+    if (rate <= 0) {
+      return nullptr;
+    }
+    return std::unique_ptr<RateLimiter>(NewGenericRateLimiter(
+        rate, refill_period_us, 10 /* fairness */, RateLimiter::Mode::kAllIo));
+  }
+
+  // A request is at most a burst, a larger one is split
+  static void Take(RateLimiter* limiter, size_t bytes) {
+    while (bytes > 0) {
+      size_t allowed =
+          limiter->RequestToken(bytes, 0 /* alignment */, Env::IO_HIGH,
+                                nullptr, RateLimiter::OpType::kRead);
+      bytes -= std::min(allowed, bytes);
+    }
+  }
+
+  const std::string name_;
+  Env* env_;
+  std::unique_ptr<RateLimiter> read_ops_limiter_;
+  std::unique_ptr<RateLimiter> limiters_[3];
+  std::atomic<uint64_t> read_ops_;
+  Counter counters_[3];
+};
+}  // namespace
+
+ResourceGroup* NewResourceGroup(const ResourceGroupOptions& options) {
+  return new ResourceGroupImpl(options);
+}
+
+}  // namespace TERARKDB_NAMESPACE
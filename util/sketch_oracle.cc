@@ -0,0 +1,206 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "rocksdb/sketch_oracle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "fs/log.h"
+#include "port/port.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/xxhash.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+class SketchOracle : public Oracle {
+ public:
+  // 16 x 32 bit counters fill one cache line
+  static constexpr size_t kBlockCounters = 16;
+  // Keys are hashed and prefetched in batches of this size
+  static constexpr size_t kBatch = 16;
+
+  explicit SketchOracle(const SketchOracleOptions& options)
+      : options_(options), recorded_(0), decaying_(false) {
+    size_t num_blocks = 1;
+    while (num_blocks < options_.num_blocks) {
+      num_blocks <<= 1;
+    }
+    block_mask_ = num_blocks - 1;
+    options_.depth = std::min<size_t>(std::max<size_t>(options_.depth, 1), 8);
+    options_.hot_threshold =
+        std::max(options_.hot_threshold, options_.warm_threshold);
+    num_counters_ = num_blocks * kBlockCounters;
+    counters_.reset(new std::atomic<uint32_t>[num_counters_]);
+    for (size_t i = 0; i < num_counters_; ++i) {
+      counters_[i].store(0, std::memory_order_relaxed);
+    }
+    for (auto& c : probed_) {
+      c.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void MergeKeys(std::unordered_map<std::string, uint64_t>& update) override {
+    for (const auto& kv : update) {
+      Add(Hash(kv.first), kv.second);
+    }
+  }
+
+  KeyType ProbeKeyType(const std::string& key, uint64_t occurrence) override {
+    return Classify(Estimate(Hash(key)), occurrence);
+  }
+
+  OracleAddKeyStatus AddKey(const std::string& key,
+                            uint64_t occurrence) override {
+    uint64_t h = Hash(key);
+    bool existed = Estimate(h) > 0;
+    Add(h, occurrence);
+    return existed ? kUpdated : kNewlyAdded;
+  }
+
+  // Counters are aged as accesses are recorded, nothing to refresh here
+  void UpdateStats() override {}
+
+  void ReportProbeStats() override {
+    ZnsLog(kYellow,
+           "SketchOracle: recorded %lu, probed hot %lu, warm %lu, cold %lu",
+           recorded_.load(std::memory_order_relaxed),
+           probed_[0].load(std::memory_order_relaxed),
+           probed_[1].load(std::memory_order_relaxed),
+           probed_[2].load(std::memory_order_relaxed));
+  }
+
+  void ProbeKeyTypes(const Slice* keys, size_t n, uint64_t occurrence,
+                     KeyType* types) override {
+    uint64_t hashes[kBatch];
+    for (size_t base = 0; base < n; base += kBatch) {
+      size_t cnt = std::min(kBatch, n - base);
+      for (size_t i = 0; i < cnt; ++i) {
+        hashes[i] = Hash(keys[base + i]);
+        PREFETCH(Block(hashes[i]), 0 /* rw */, 1 /* locality */);
+      }
+      for (size_t i = 0; i < cnt; ++i) {
+        types[base + i] = Classify(Estimate(hashes[i]), occurrence);
+      }
+    }
+  }
+
+  void RecordKeys(const Slice* keys, size_t n) override {
+    uint64_t hashes[kBatch];
+    for (size_t base = 0; base < n; base += kBatch) {
+      size_t cnt = std::min(kBatch, n - base);
+      for (size_t i = 0; i < cnt; ++i) {
+        hashes[i] = Hash(keys[base + i]);
+        PREFETCH(Block(hashes[i]), 1 /* rw */, 1 /* locality */);
+      }
+      for (size_t i = 0; i < cnt; ++i) {
+        Increment(hashes[i], 1);
+      }
+      MaybeDecay(cnt);
+    }
+  }
+
+  size_t ApproximateMemoryUsage() const override {
+    return num_counters_ * sizeof(std::atomic<uint32_t>);
+  }
+
+ private:
+  static uint64_t Hash(const Slice& key) {
+    return XXH64(key.data(), key.size(), 0x9e3779b97f4a7c15ull);
+  }
+
+  std::atomic<uint32_t>* Block(uint64_t h) const {
+    return &counters_[(h & block_mask_) * kBlockCounters];
+  }
+
+  // The high 32 bits select the counters inside the block, 4 bits each
+  static size_t Slot(uint64_t h, size_t row) {
+    return (h >> (32 + row * 4)) & (kBlockCounters - 1);
+  }
+
+  uint32_t Estimate(uint64_t h) const {
+    auto* block = Block(h);
+    uint32_t est = UINT32_MAX;
+    for (size_t row = 0; row < options_.depth; ++row) {
+      est = std::min(est, block[Slot(h, row)].load(std::memory_order_relaxed));
+    }
+    return est;
+  }
+
+  void Increment(uint64_t h, uint64_t count) {
+    auto* block = Block(h);
+    uint32_t delta = static_cast<uint32_t>(std::min<uint64_t>(count, 1 << 16));
+    for (size_t row = 0; row < options_.depth; ++row) {
+      auto& c = block[Slot(h, row)];
+      // Saturate instead of wrapping around
+      if (c.load(std::memory_order_relaxed) < UINT32_MAX - delta) {
+        c.fetch_add(delta, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void Add(uint64_t h, uint64_t count) {
+    if (count == 0) {
+      return;
+    }
+    Increment(h, count);
+    MaybeDecay(count);
+  }
+
+  void MaybeDecay(uint64_t count) {
+    uint64_t interval = options_.decay_interval;
+    uint64_t prev = recorded_.fetch_add(count, std::memory_order_relaxed);
+    if (interval == 0 || prev / interval == (prev + count) / interval) {
+      return;
+    }
+    // Only one thread halves the counters, concurrent increments may be lost
+    // or halved twice which is fine for an estimation
+    bool expected = false;
+    if (!decaying_.compare_exchange_strong(expected, true)) {
+      return;
+    }
+    for (size_t i = 0; i < num_counters_; ++i) {
+      auto& c = counters_[i];
+      c.store(c.load(std::memory_order_relaxed) >> 1,
+              std::memory_order_relaxed);
+    }
+    decaying_.store(false, std::memory_order_release);
+  }
+
+  KeyType Classify(uint32_t estimate, uint64_t occurrence) {
+    uint64_t count = std::max<uint64_t>(estimate, occurrence);
+    if (count >= options_.hot_threshold) {
+      probed_[0].fetch_add(1, std::memory_order_relaxed);
+      return KeyType::Hot();
+    }
+    if (count >= options_.warm_threshold) {
+      probed_[1].fetch_add(1, std::memory_order_relaxed);
+      return KeyType::Warm();
+    }
+    probed_[2].fetch_add(1, std::memory_order_relaxed);
+    return KeyType::Cold();
+  }
+
+  SketchOracleOptions options_;
+  size_t block_mask_;
+  size_t num_counters_;
+  std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+  std::atomic<uint64_t> recorded_;
+  std::atomic<bool> decaying_;
+  // hot, warm, cold
+  std::atomic<uint64_t> probed_[3];
+};
+
+}  // namespace
+
+std::shared_ptr<Oracle> NewSketchOracle(const SketchOracleOptions& options) {
+  return std::make_shared<SketchOracle>(options);
+}
+
+}  // namespace TERARKDB_NAMESPACE
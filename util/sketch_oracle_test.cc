@@ -0,0 +1,121 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "rocksdb/sketch_oracle.h"
+
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class SketchOracleTest : public testing::Test {
+ public:
+  static std::string Key(int i) { return "key" + std::to_string(i); }
+};
+
+TEST_F(SketchOracleTest, ClassifyByFrequency) {
+  SketchOracleOptions options;
+  options.warm_threshold = 2;
+  options.hot_threshold = 8;
+  auto oracle = NewSketchOracle(options);
+
+  std::vector<std::string> keys = {Key(0), Key(1), Key(2)};
+  std::vector<Slice> slices(keys.begin(), keys.end());
+  for (int i = 0; i < 8; ++i) {
+    oracle->RecordKeys(&slices[0], 1);
+  }
+  oracle->RecordKeys(&slices[1], 1);
+  oracle->RecordKeys(&slices[1], 1);
+
+  ASSERT_TRUE(oracle->ProbeKeyType(keys[0], 0).IsHot());
+  ASSERT_TRUE(oracle->ProbeKeyType(keys[1], 0).IsWarm());
+  ASSERT_TRUE(oracle->ProbeKeyType(keys[2], 0).IsCold());
+  // Occurrence counted by the caller is taken into account
+  ASSERT_TRUE(oracle->ProbeKeyType(keys[2], 2).IsWarm());
+
+  std::vector<KeyType> types(slices.size());
+  oracle->ProbeKeyTypes(slices.data(), slices.size(), 0, types.data());
+  ASSERT_TRUE(types[0].IsHot());
+  ASSERT_TRUE(types[1].IsWarm());
+  ASSERT_TRUE(types[2].IsCold());
+}
+
+TEST_F(SketchOracleTest, BatchMatchesSingleProbe) {
+  auto oracle = NewSketchOracle();
+  std::unordered_map<std::string, uint64_t> update;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 100; ++i) {
+    keys.push_back(Key(i));
+    update[keys.back()] = i % 10;
+  }
+  oracle->MergeKeys(update);
+  ASSERT_EQ(kUpdated, oracle->AddKey(Key(9), 1));
+  ASSERT_EQ(kNewlyAdded, oracle->AddKey(Key(1000), 1));
+
+  std::vector<Slice> slices(keys.begin(), keys.end());
+  std::vector<KeyType> types(slices.size());
+  oracle->ProbeKeyTypes(slices.data(), slices.size(), 0, types.data());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(oracle->ProbeKeyType(keys[i], 0).code, types[i].code);
+  }
+}
+
+TEST_F(SketchOracleTest, Decay) {
+  SketchOracleOptions options;
+  options.warm_threshold = 4;
+  options.decay_interval = 64;
+  auto oracle = NewSketchOracle(options);
+  std::string hot = Key(0);
+  Slice s(hot);
+  for (int i = 0; i < 6; ++i) {
+    oracle->RecordKeys(&s, 1);
+  }
+  ASSERT_TRUE(oracle->ProbeKeyType(hot, 0).IsWarm());
+
+  // Unrelated traffic ages the key out
+  std::vector<std::string> keys;
+  for (int i = 1; i <= 128; ++i) {
+    keys.push_back(Key(i));
+  }
+  std::vector<Slice> slices(keys.begin(), keys.end());
+  oracle->RecordKeys(slices.data(), slices.size());
+  ASSERT_TRUE(oracle->ProbeKeyType(hot, 0).IsCold());
+}
+
+TEST_F(SketchOracleTest, ConcurrentRecord) {
+  SketchOracleOptions options;
+  options.hot_threshold = 1000;
+  options.decay_interval = 0;
+  auto oracle = NewSketchOracle(options);
+  std::string hot = Key(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      Slice s(hot);
+      for (int i = 0; i < 250; ++i) {
+        oracle->RecordKeys(&s, 1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_TRUE(oracle->ProbeKeyType(hot, 0).IsHot());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
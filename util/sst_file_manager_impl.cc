@@ -18,11 +18,24 @@
 namespace TERARKDB_NAMESPACE {
 
 #ifndef ROCKSDB_LITE
+static bool IsZonedEnv(Env* env) {
+  bool zoned = false;
+#ifdef WITH_ZENFS
+  uint64_t total_size, avail_size, used_size;
+  zoned = GetZbdDiskSpaceInfo(env, &total_size, &avail_size, &used_size).ok();
+#else
+  (void)env;
+#endif
+  TEST_SYNC_POINT_CALLBACK("SstFileManagerImpl::IsZonedEnv", &zoned);
+  return zoned;
+}
+
 SstFileManagerImpl::SstFileManagerImpl(Env* env, std::shared_ptr<Logger> logger,
                                        int64_t rate_bytes_per_sec,
                                        double max_trash_db_ratio,
                                        uint64_t bytes_max_delete_chunk)
     : env_(env),
+      zoned_(IsZonedEnv(env)),
       logger_(logger),
       total_files_size_(0),
       in_progress_files_size_(0),
@@ -174,7 +187,7 @@ bool SstFileManagerImpl::EnoughRoomForCompaction(
         TableFileName(cfd->ioptions()->cf_paths, inputs[0][0]->fd.GetNumber(),
                       inputs[0][0]->fd.GetPathId());
     uint64_t free_space = 0;
-    env_->GetFreeSpace(fn, &free_space);
+    GetFreeSpace(fn, &free_space);
     // needed_headroom is based on current size reserved by compactions,
     // minus any files created by running compactions as they would count
     // against the reserved size. If user didn't specify any compaction
@@ -264,7 +277,7 @@ void SstFileManagerImpl::ClearError() {
     }
 
     uint64_t free_space;
-    Status s = env_->GetFreeSpace(path_, &free_space);
+    Status s = GetFreeSpace(path_, &free_space);
     if (s.ok()) {
       // In case of multi-DB instances, some of them may have experienced a
       // soft error and some a hard error. In the SstFileManagerImpl, a hard
@@ -348,6 +361,21 @@ void SstFileManagerImpl::ClearError() {
   }
 }
 
+Status SstFileManagerImpl::GetFreeSpace(const std::string& path,
+                                        uint64_t* free_space) {
+#ifdef WITH_ZENFS
+  if (zoned_) {
+    uint64_t total_size, avail_size, used_size;
+    Status s = GetZbdDiskSpaceInfo(env_, &total_size, &avail_size, &used_size);
+    if (s.ok()) {
+      *free_space = total_size - used_size;
+    }
+    return s;
+  }
+#endif
+  return env_->GetFreeSpace(path, free_space);
+}
+
 void SstFileManagerImpl::StartErrorRecovery(ErrorHandler* handler,
                                             Status bg_error) {
   MutexLock l(&mu_);
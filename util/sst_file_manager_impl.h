@@ -131,6 +131,11 @@ class SstFileManagerImpl : public SstFileManager {
 
   DeleteScheduler* delete_scheduler() { return &delete_scheduler_; }
 
+  // True if the files live on zoned storage (ZenFS). Deleting a file there
+  // only invalidates its extents, the space comes back when zone GC resets
+  // the zones, so deletions are not worth throttling.
+  bool zoned() const { return zoned_; }
+
   // Stop the error recovery background thread. This should be called only
   // once in the object's lifetime, and before the destructor
   void Close();
@@ -143,11 +148,15 @@ class SstFileManagerImpl : public SstFileManager {
   void OnDeleteFileImpl(const std::string& file_path);
 
   void ClearError();
+  // Free space for the space checks, on zoned storage the garbage of the
+  // written zones counts as well, since zone GC reclaims it
+  Status GetFreeSpace(const std::string& path, uint64_t* free_space);
   bool CheckFreeSpace() {
     return bg_err_.severity() == Status::Severity::kSoftError;
   }
 
   Env* env_;
+  const bool zoned_;
   std::shared_ptr<Logger> logger_;
   // Mutex to protect tracked_files_, total_files_size_
   port::Mutex mu_;
@@ -198,6 +198,10 @@ BlockBasedTableOptions RandomBlockBasedTableOptions(Random* rnd) {
   opt.cache_index_and_filter_blocks = rnd->Uniform(2);
   opt.pin_l0_filter_and_index_blocks_in_cache = rnd->Uniform(2);
   opt.pin_top_level_index_and_filter = rnd->Uniform(2);
+  opt.pin_top_level_index_and_filter_max_level =
+      static_cast<int>(rnd->Uniform(8)) - 1;
+  opt.pin_index_and_filter_partitions_max_level =
+      static_cast<int>(rnd->Uniform(8)) - 1;
   opt.index_type = rnd->Uniform(2) ? BlockBasedTableOptions::kBinarySearch
                                    : BlockBasedTableOptions::kHashSearch;
   opt.hash_index_allow_collision = rnd->Uniform(2);
@@ -248,6 +252,7 @@ void RandomInitDBOptions(DBOptions* db_opt, Random* rnd) {
   db_opt->allow_mmap_writes = rnd->Uniform(2);
   db_opt->use_direct_reads = rnd->Uniform(2);
   db_opt->use_direct_io_for_flush_and_compaction = rnd->Uniform(2);
+  db_opt->use_direct_io_for_wal = rnd->Uniform(2);
   db_opt->create_if_missing = rnd->Uniform(2);
   db_opt->create_missing_column_families = rnd->Uniform(2);
   db_opt->enable_thread_tracking = rnd->Uniform(2);
@@ -260,6 +265,12 @@ void RandomInitDBOptions(DBOptions* db_opt, Random* rnd) {
   db_opt->use_fsync = rnd->Uniform(2);
   db_opt->recycle_log_file_num = rnd->Uniform(2);
   db_opt->prepare_log_writer_num = rnd->Uniform(2);
+  db_opt->isolate_cf_write_stalls = rnd->Uniform(2);
+  db_opt->async_wal_sync = rnd->Uniform(2);
+  db_opt->warm_block_cache_after_compaction = rnd->Uniform(2);
+  db_opt->lazy_open_deep_sst = rnd->Uniform(2);
+  db_opt->zenfs_zone_aligned_file_size = rnd->Uniform(2);
+  db_opt->zenfs_gc_relocate_extents = rnd->Uniform(2);
   db_opt->avoid_flush_during_recovery = rnd->Uniform(2);
   db_opt->avoid_flush_during_shutdown = rnd->Uniform(2);
 
@@ -276,6 +287,11 @@ void RandomInitDBOptions(DBOptions* db_opt, Random* rnd) {
   db_opt->log_file_time_to_roll = rnd->Uniform(10000);
   db_opt->manifest_preallocation_size = rnd->Uniform(10000);
   db_opt->max_log_file_size = rnd->Uniform(10000);
+  db_opt->wal_streams = rnd->Uniform(4) + 1;
+  db_opt->wal_recovery_threads = rnd->Uniform(4) + 1;
+  db_opt->change_feed_buffer_size = rnd->Uniform(10000);
+  db_opt->value_log_threshold = rnd->Uniform(10000);
+  db_opt->write_behind_buffers = rnd->Uniform(4);
 
   // std::string options
   db_opt->db_log_dir = "path/to/db_log_dir";
@@ -293,9 +309,12 @@ void RandomInitDBOptions(DBOptions* db_opt, Random* rnd) {
   db_opt->max_wal_size = uint_max + rnd->Uniform(100000);
   db_opt->max_total_wal_size = uint_max + rnd->Uniform(100000);
   db_opt->wal_bytes_per_sync = uint_max + rnd->Uniform(100000);
+  db_opt->table_cache_memory_budget = uint_max + rnd->Uniform(100000);
+  db_opt->pin_table_reader_on_first_access = rnd->Uniform(2);
 
   // unsigned int options
   db_opt->stats_dump_period_sec = rnd->Uniform(100000);
+  db_opt->hot_block_set_persist_period_sec = rnd->Uniform(100000);
 }
 
 void RandomInitCFOptions(ColumnFamilyOptions* cf_opt, Random* rnd) {
@@ -314,12 +333,17 @@ void RandomInitCFOptions(ColumnFamilyOptions* cf_opt, Random* rnd) {
   cf_opt->paranoid_file_checks = rnd->Uniform(2);
   cf_opt->purge_redundant_kvs_while_flush = rnd->Uniform(2);
   cf_opt->force_consistency_checks = rnd->Uniform(2);
+  cf_opt->memtable_whole_key_filtering = rnd->Uniform(2);
+  cf_opt->level0_stall_by_sublevels = rnd->Uniform(2);
+  cf_opt->flush_to_bottommost_level = rnd->Uniform(2);
 
   // double options
   cf_opt->hard_rate_limit = static_cast<double>(rnd->Uniform(10000)) / 13;
   cf_opt->soft_rate_limit = static_cast<double>(rnd->Uniform(10000)) / 13;
   cf_opt->memtable_prefix_bloom_size_ratio =
       static_cast<double>(rnd->Uniform(10000)) / 20000.0;
+  cf_opt->prefetch_index_and_filter_hot_file_ratio =
+      static_cast<double>(rnd->Uniform(10000)) / 10000.0;
 
   // int options
   cf_opt->level0_file_num_compaction_trigger = rnd->Uniform(100);
@@ -350,11 +374,14 @@ void RandomInitCFOptions(ColumnFamilyOptions* cf_opt, Random* rnd) {
   cf_opt->bloom_locality = rnd->Uniform(10000);
   cf_opt->max_bytes_for_level_base = rnd->Uniform(10000);
   cf_opt->max_subcompactions = rnd->Uniform(100000);
+  cf_opt->max_flush_partitions = rnd->Uniform(100);
+  cf_opt->compaction_filter_threads = rnd->Uniform(100);
 
   // uint64_t options
   static const uint64_t uint_max = static_cast<uint64_t>(UINT_MAX);
   cf_opt->max_sequential_skip_in_iterations = uint_max + rnd->Uniform(10000);
   cf_opt->target_file_size_base = uint_max + rnd->Uniform(10000);
+  cf_opt->atomic_flush_inline_value_size = uint_max + rnd->Uniform(10000);
   cf_opt->max_compaction_bytes =
       cf_opt->target_file_size_base * rnd->Uniform(100);
 
@@ -71,6 +71,31 @@ struct ThreadPoolImpl::Impl {
 
   int UnSchedule(void* arg);
 
+  void StealFrom(Impl* victim, int reserve);
+
+  // Pop the first queued job of this pool for a thread of another pool,
+  // return false if there is none
+  bool TakeQueuedJob(std::function<void()>* job);
+
+  // Whether the thread may run a job queued in a victim pool, requires mu_
+  bool CanSteal(size_t thread_id) const {
+    if (IsExcessiveThread(thread_id)) {
+      return false;
+    }
+    int idle = idle_threads_.load(std::memory_order_relaxed);
+    for (auto& victim : victims_) {
+      if (idle >= victim.second && victim.first->HasStealableJob()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool HasStealableJob() const {
+    return queue_len_.load(std::memory_order_relaxed) > 0 &&
+           !discarding_jobs_.load(std::memory_order_relaxed);
+  }
+
   void SetHostEnv(Env* env) { env_ = env; }
 
   Env* GetHostEnv() const { return env_; }
@@ -107,6 +132,10 @@ struct ThreadPoolImpl::Impl {
 
   int total_threads_limit_;
   std::atomic_uint queue_len_;  // Queue length. Used for stats reporting
+  // Threads waiting for jobs, read without the mutex by the thief pools
+  std::atomic_int idle_threads_;
+  // The queued jobs are dropped by JoinThreads(), don't let thieves run them
+  std::atomic_bool discarding_jobs_;
   bool exit_all_threads_;
   bool wait_for_jobs_to_complete_;
 
@@ -120,6 +149,11 @@ struct ThreadPoolImpl::Impl {
   using BGQueue = std::deque<BGItem>;
   BGQueue queue_;
 
+  // The pools this pool steals jobs from, and the pools stealing from this
+  // pool, each with the number of idle threads the thief keeps for itself
+  std::vector<std::pair<Impl*, int>> victims_;
+  std::vector<std::pair<Impl*, int>> thieves_;
+
   std::mutex mu_;
   std::condition_variable bgsignal_;
   std::vector<port::Thread> bgthreads_;
@@ -132,6 +166,8 @@ inline ThreadPoolImpl::Impl::Impl()
       env_(nullptr),
       total_threads_limit_(0),
       queue_len_(),
+      idle_threads_(0),
+      discarding_jobs_(false),
       exit_all_threads_(false),
       wait_for_jobs_to_complete_(false),
       queue_(),
@@ -147,6 +183,7 @@ void ThreadPoolImpl::Impl::JoinThreads(bool wait_for_jobs_to_complete) {
 
   wait_for_jobs_to_complete_ = wait_for_jobs_to_complete;
   exit_all_threads_ = true;
+  discarding_jobs_.store(!wait_for_jobs_to_complete, std::memory_order_relaxed);
   // prevent threads from being recreated right after they're joined, in case
   // the user is concurrently submitting jobs.
   total_threads_limit_ = 0;
@@ -163,6 +200,7 @@ void ThreadPoolImpl::Impl::JoinThreads(bool wait_for_jobs_to_complete) {
 
   exit_all_threads_ = false;
   wait_for_jobs_to_complete_ = false;
+  discarding_jobs_.store(false, std::memory_order_relaxed);
 }
 
 inline void ThreadPoolImpl::Impl::LowerIOPriority() {
@@ -184,8 +222,11 @@ void ThreadPoolImpl::Impl::BGThread(size_t thread_id) {
     std::unique_lock<std::mutex> lock(mu_);
     // Stop waiting if the thread needs to do work or needs to terminate.
     while (!exit_all_threads_ && !IsLastExcessiveThread(thread_id) &&
-           (queue_.empty() || IsExcessiveThread(thread_id))) {
+           (queue_.empty() || IsExcessiveThread(thread_id)) &&
+           !CanSteal(thread_id)) {
+      idle_threads_.fetch_add(1, std::memory_order_relaxed);
       bgsignal_.wait(lock);
+      idle_threads_.fetch_sub(1, std::memory_order_relaxed);
     }
 
     if (exit_all_threads_) {  // mechanism to let BG threads exit safely
@@ -210,6 +251,22 @@ void ThreadPoolImpl::Impl::BGThread(size_t thread_id) {
       break;
     }
 
+    if (queue_.empty()) {
+      // Woken up for the jobs queued in a victim pool
+      auto victims = victims_;
+      lock.unlock();
+      std::function<void()> stolen;
+      for (auto& victim : victims) {
+        if (victim.first->TakeQueuedJob(&stolen)) {
+          break;
+        }
+      }
+      if (stolen) {
+        stolen();
+      }
+      continue;
+    }
+
     auto func = std::move(queue_.front().function);
     queue_.pop_front();
 
@@ -350,7 +407,7 @@ void ThreadPoolImpl::Impl::StartBGThreads() {
 void ThreadPoolImpl::Impl::Submit(std::function<void()>&& schedule,
                                   std::function<void()>&& unschedule, void* tag,
                                   bool force) {
-  std::lock_guard<std::mutex> lock(mu_);
+  std::unique_lock<std::mutex> lock(mu_);
 
   if (exit_all_threads_) {
     return;
@@ -380,6 +437,71 @@ void ThreadPoolImpl::Impl::Submit(std::function<void()>&& schedule,
     // up is not the one to terminate.
     WakeUpAllThreads();
   }
+
+  if (thieves_.empty() || idle_threads_.load(std::memory_order_relaxed) > 0) {
+    return;
+  }
+  // All threads of this pool are busy, hand the job to an idle thread of a
+  // thief pool. The thief is called without the mutex, so that two pools
+  // stealing from each other don't deadlock.
+  Impl* thief = nullptr;
+  for (auto& t : thieves_) {
+    if (t.first->idle_threads_.load(std::memory_order_relaxed) > t.second) {
+      thief = t.first;
+      break;
+    }
+  }
+  lock.unlock();
+  if (thief != nullptr) {
+    // The job may have been taken by a thread of this pool by then
+    thief->Submit(
+        [this] {
+          std::function<void()> job;
+          if (TakeQueuedJob(&job)) {
+            job();
+          }
+        },
+        std::function<void()>(), nullptr);
+  }
+}
+
+void ThreadPoolImpl::Impl::StealFrom(Impl* victim, int reserve) {
+  assert(victim != this);
+  auto update = [](std::vector<std::pair<Impl*, int>>* pools, Impl* pool,
+                   int value) {
+    auto it = std::find_if(
+        pools->begin(), pools->end(),
+        [pool](const std::pair<Impl*, int>& p) { return p.first == pool; });
+    if (it != pools->end()) {
+      pools->erase(it);
+    }
+    if (value >= 0) {
+      pools->emplace_back(pool, value);
+    }
+  };
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    update(&victims_, victim, reserve);
+  }
+  {
+    std::lock_guard<std::mutex> lock(victim->mu_);
+    update(&victim->thieves_, this, reserve);
+  }
+  // Idle threads pick up the jobs already queued in the victim
+  std::lock_guard<std::mutex> lock(mu_);
+  WakeUpAllThreads();
+}
+
+bool ThreadPoolImpl::Impl::TakeQueuedJob(std::function<void()>* job) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (discarding_jobs_.load(std::memory_order_relaxed) || queue_.empty()) {
+    return false;
+  }
+  *job = std::move(queue_.front().function);
+  queue_.pop_front();
+  queue_len_.store(static_cast<unsigned int>(queue_.size()),
+                   std::memory_order_relaxed);
+  return true;
 }
 
 int ThreadPoolImpl::Impl::UnSchedule(void* arg) {
@@ -467,6 +589,10 @@ void ThreadPoolImpl::Schedule(void (*function)(void* arg1), void* arg,
 
 int ThreadPoolImpl::UnSchedule(void* arg) { return impl_->UnSchedule(arg); }
 
+void ThreadPoolImpl::StealFrom(ThreadPoolImpl* victim, int reserve) {
+  impl_->StealFrom(victim->impl_.get(), reserve);
+}
+
 void ThreadPoolImpl::SetHostEnv(Env* env) { impl_->SetHostEnv(env); }
 
 Env* ThreadPoolImpl::GetHostEnv() const { return impl_->GetHostEnv(); }
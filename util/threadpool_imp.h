@@ -78,6 +78,11 @@ class ThreadPoolImpl : public ThreadPool {
   // if such was given at scheduling time.
   int UnSchedule(void* tag);
 
+  // Let the idle threads of this pool run the jobs queued in `victim`, as
+  // long as `reserve` other threads of this pool stay idle for its own jobs.
+  // A negative `reserve` stops the stealing.
+  void StealFrom(ThreadPoolImpl* victim, int reserve);
+
   void SetHostEnv(Env* env);
 
   Env* GetHostEnv() const;
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <queue>
@@ -45,7 +47,8 @@ class Timer {
         mutex_(env),
         cond_var_(&mutex_),
         running_(false),
-        executing_task_(false) {}
+        executing_task_(false),
+        executing_fn_(nullptr) {}
   ~Timer() { Shutdown(); }
   // Add a new function to run.
   // fn_name has to be identical, otherwise, the new one overrides the existing
@@ -89,15 +92,10 @@ class Timer {
     }
 
     // If the currently running function is fn_name, then we need to wait
-    // until it finishes before returning to caller.
-    while (!heap_.empty() && executing_task_) {
-      FunctionInfo* func_info = heap_.top();
-      assert(func_info);
-      if (func_info->name == fn_name) {
-        WaitForTaskCompleteIfNecessary();
-      } else {
-        break;
-      }
+    // until it finishes before returning to caller. It is not always on the
+    // top of the heap, functions triggered meanwhile may be ahead of it.
+    if (executing_fn_ != nullptr && executing_fn_->name == fn_name) {
+      WaitForTaskCompleteIfNecessary();
     }
   }
 
@@ -106,6 +104,38 @@ class Timer {
     CancelAllWithLock();
   }
 
+  // Run the function `fn_name` early, for an event it reacts to. It runs as
+  // soon as `min_interval_us` passed since the end of its last run, or right
+  // after the running call if it is running now. The repeat interval it was
+  // added with keeps bounding the time between two runs when nothing
+  // happens. Returns false if there is no such repeating function.
+  bool Trigger(const std::string& fn_name, uint64_t min_interval_us) {
+    {
+      InstrumentedMutexLock l(&mutex_);
+      auto it = map_.find(fn_name);
+      if (it == map_.end() || !it->second->IsValid() ||
+          it->second->repeat_every_us == 0) {
+        return false;
+      }
+      FunctionInfo* fn_info = it->second.get();
+      if (fn_info == executing_fn_) {
+        fn_info->triggered = true;
+        fn_info->trigger_interval_us =
+            std::min(fn_info->trigger_interval_us, min_interval_us);
+        return true;
+      }
+      uint64_t run_time_us = std::max(
+          env_->NowMicros(), fn_info->last_run_time_us + min_interval_us);
+      if (run_time_us >= fn_info->next_run_time_us) {
+        return true;
+      }
+      fn_info->next_run_time_us = run_time_us;
+      RebuildHeap(nullptr);
+    }
+    cond_var_.SignalAll();
+    return true;
+  }
+
   // Start the Timer
   bool Start() {
     InstrumentedMutexLock l(&mutex_);
@@ -185,6 +215,8 @@ class Timer {
 #endif  // NDEBUG
 
  private:
+  struct FunctionInfo;
+
   void Run() {
     InstrumentedMutexLock l(&mutex_);
 
@@ -210,23 +242,37 @@ class Timer {
         // mutex_.unlock.
         std::function<void()> fn = current_fn->fn;
         executing_task_ = true;
+        executing_fn_ = current_fn;
         mutex_.Unlock();
         // Execute the work
         fn();
         mutex_.Lock();
         executing_task_ = false;
+        executing_fn_ = nullptr;
         cond_var_.SignalAll();
         // Remove the work from the heap once it is done executing.
         // Note that we are just removing the pointer from the heap. Its
         // memory is still managed in the map (as it holds a unique ptr).
         // So current_fn is still a valid ptr.
-        heap_.pop();
+        if (heap_.top() == current_fn) {
+          heap_.pop();
+        } else {
+          // Triggered functions got ahead of it
+          RebuildHeap(current_fn);
+        }
 
+        uint64_t now_us = env_->NowMicros();
+        current_fn->last_run_time_us = now_us;
         // current_fn may be cancelled already.
         if (current_fn->IsValid() && current_fn->repeat_every_us > 0) {
           assert(running_);
           current_fn->next_run_time_us =
-              env_->NowMicros() + current_fn->repeat_every_us;
+              now_us + (current_fn->triggered
+                            ? std::min(current_fn->trigger_interval_us,
+                                       current_fn->repeat_every_us)
+                            : current_fn->repeat_every_us);
+          current_fn->triggered = false;
+          current_fn->trigger_interval_us = UINT64_MAX;
 
           // Schedule new work into the heap with new time.
           heap_.push(current_fn);
@@ -237,6 +283,22 @@ class Timer {
     }
   }
 
+  // Reorder the heap after run times changed, leaving `removed` out
+  void RebuildHeap(FunctionInfo* removed) {
+    mutex_.AssertHeld();
+    std::vector<FunctionInfo*> fns;
+    fns.reserve(heap_.size());
+    while (!heap_.empty()) {
+      if (heap_.top() != removed) {
+        fns.push_back(heap_.top());
+      }
+      heap_.pop();
+    }
+    for (FunctionInfo* fn_info : fns) {
+      heap_.push(fn_info);
+    }
+  }
+
   void CancelAllWithLock() {
     mutex_.AssertHeld();
     if (map_.empty() && heap_.empty()) {
@@ -271,6 +333,11 @@ class Timer {
     uint64_t next_run_time_us;
     // repeat interval
     uint64_t repeat_every_us;
+    // when the last run ended, 0 before the first one
+    uint64_t last_run_time_us;
+    // triggered while running, to run again after trigger_interval_us
+    bool triggered;
+    uint64_t trigger_interval_us;
     // controls whether this function is valid.
     // A function is valid upon construction and until someone explicitly
     // calls `Cancel()`.
@@ -282,6 +349,9 @@ class Timer {
           name(_name),
           next_run_time_us(_next_run_time_us),
           repeat_every_us(_repeat_every_us),
+          last_run_time_us(0),
+          triggered(false),
+          trigger_interval_us(UINT64_MAX),
           valid(true) {}
 
     void Cancel() { valid = false; }
@@ -311,6 +381,8 @@ class Timer {
   std::unique_ptr<port::Thread> thread_;
   bool running_;
   bool executing_task_;
+  // the function executing_task_ runs
+  FunctionInfo* executing_fn_;
 
   std::priority_queue<FunctionInfo*, std::vector<FunctionInfo*>, RunTimeOrder>
       heap_;
@@ -343,6 +343,45 @@ TEST_F(TimerTest, RepeatIntervalWithFuncRunningTime) {
 
   ASSERT_TRUE(timer.Shutdown());
 }
+
+TEST_F(TimerTest, Trigger) {
+  const int kRepeatUs = 10 * kUsPerSec;
+  const int kMinIntervalUs = 1 * kUsPerSec;
+  Timer timer(mock_env_.get());
+
+  int count = 0;
+  timer.Add([&] { count++; }, "fn_sch_test", kRepeatUs, kRepeatUs);
+  timer.Add([&] {}, "fn_once_test", kRepeatUs, 0);
+  ASSERT_FALSE(timer.Trigger("fn_once_test", 0));
+  ASSERT_FALSE(timer.Trigger("fn_unknown_test", 0));
+
+  ASSERT_TRUE(timer.Start());
+
+  // Runs early, once the min interval passed
+  ASSERT_TRUE(timer.Trigger("fn_sch_test", kMinIntervalUs));
+  timer.TEST_WaitForRun(
+      [&] { mock_env_->MockSleepForMicroseconds(kMinIntervalUs / 2); });
+  ASSERT_EQ(0, count);
+  timer.TEST_WaitForRun(
+      [&] { mock_env_->MockSleepForMicroseconds(kMinIntervalUs / 2); });
+  ASSERT_EQ(1, count);
+
+  // The min interval counts from the last run
+  ASSERT_TRUE(timer.Trigger("fn_sch_test", kMinIntervalUs));
+  ASSERT_TRUE(timer.Trigger("fn_sch_test", kMinIntervalUs));
+  timer.TEST_WaitForRun(
+      [&] { mock_env_->MockSleepForMicroseconds(kMinIntervalUs); });
+  ASSERT_EQ(2, count);
+
+  // Without triggers it is back to the repeat interval
+  timer.TEST_WaitForRun(
+      [&] { mock_env_->MockSleepForMicroseconds(kRepeatUs - 1); });
+  ASSERT_EQ(2, count);
+  timer.TEST_WaitForRun([&] { mock_env_->MockSleepForMicroseconds(1); });
+  ASSERT_EQ(3, count);
+
+  ASSERT_TRUE(timer.Shutdown());
+}
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
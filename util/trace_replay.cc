@@ -5,7 +5,13 @@
 
 #include "util/trace_replay.h"
 
+#include <inttypes.h>
+
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <sstream>
 #include <thread>
 
@@ -14,6 +20,7 @@
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/write_batch.h"
 #include "util/coding.h"
+#include "util/hash.h"
 #include "util/string_util.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -26,7 +33,7 @@ void EncodeCFAndKey(std::string* dst, uint32_t cf_id, const Slice& key) {
   PutLengthPrefixedSlice(dst, key);
 }
 
-void DecodeCFAndKey(std::string& buffer, uint32_t* cf_id, Slice* key) {
+void DecodeCFAndKey(const std::string& buffer, uint32_t* cf_id, Slice* key) {
   Slice buf(buffer);
   GetFixed32(&buf, cf_id);
   GetLengthPrefixedSlice(&buf, key);
@@ -138,7 +145,106 @@ Replayer::Replayer(DB* db, const std::vector<ColumnFamilyHandle*>& handles,
 
 Replayer::~Replayer() { trace_reader_.reset(); }
 
-Status Replayer::Replay() {
+struct Replayer::Worker {
+  struct Task {
+    Trace trace;
+    std::chrono::steady_clock::time_point due;
+  };
+  // Bounds the traces read ahead of a slow worker
+  static const size_t kMaxQueuedTasks = 1024;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Task> tasks;
+  bool done = false;
+  // Set by any worker to stop the replay
+  std::atomic<bool>* failed = nullptr;
+  Status status;
+  ReplayStats stats;
+  std::thread thread;
+};
+
+namespace {
+const char* TraceTypeName(TraceType type) {
+  switch (type) {
+    case kTraceWrite:
+      return "write";
+    case kTraceGet:
+      return "get";
+    case kTraceIteratorSeek:
+      return "seek";
+    case kTraceIteratorSeekForPrev:
+      return "seek_for_prev";
+    default:
+      return nullptr;
+  }
+}
+
+void RecordLatency(ReplayStats* stats, TraceType type,
+                   std::chrono::steady_clock::time_point due) {
+  if (TraceTypeName(type) == nullptr) {
+    return;
+  }
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - due);
+  stats->latency[type].Add(static_cast<uint64_t>(micros.count()));
+}
+
+// Takes the first key of a write batch
+class FirstKeyHandler : public WriteBatch::Handler {
+ public:
+  Status PutCF(uint32_t, const Slice& key, const Slice&) override {
+    return Take(key);
+  }
+  Status DeleteCF(uint32_t, const Slice& key) override { return Take(key); }
+  Status SingleDeleteCF(uint32_t, const Slice& key) override {
+    return Take(key);
+  }
+  Status DeleteRangeCF(uint32_t, const Slice& begin_key,
+                       const Slice&) override {
+    return Take(begin_key);
+  }
+  Status MergeCF(uint32_t, const Slice& key, const Slice&) override {
+    return Take(key);
+  }
+  bool Continue() override { return !found_; }
+
+  Slice key;
+
+ private:
+  Status Take(const Slice& k) {
+    key = k;
+    found_ = true;
+    return Status::OK();
+  }
+
+  bool found_ = false;
+};
+}  // namespace
+
+std::string ReplayStats::ToString() const {
+  std::string out;
+  char buf[256];
+  for (int type = 0; type < kTraceMax; ++type) {
+    const char* name = TraceTypeName(static_cast<TraceType>(type));
+    const HistogramImpl& hist = latency[type];
+    if (name == nullptr || hist.num() == 0) {
+      continue;
+    }
+    snprintf(buf, sizeof(buf),
+             "%-14s count %" PRIu64 " avg %.1f P50 %.1f P99 %.1f P99.9 %.1f "
+             "P99.99 %.1f max %" PRIu64 " micros\n",
+             name, hist.num(), hist.Average(), hist.Median(),
+             hist.Percentile(99), hist.Percentile(99.9),
+             hist.Percentile(99.99), hist.max());
+    out.append(buf);
+  }
+  return out;
+}
+
+Status Replayer::Replay() { return Replay(ReplayOptions(), nullptr); }
+
+Status Replayer::Replay(const ReplayOptions& options, ReplayStats* stats) {
   Status s;
   Trace header;
   s = ReadHeader(&header);
@@ -146,79 +252,76 @@ Status Replayer::Replay() {
     return s;
   }
 
-  std::chrono::system_clock::time_point replay_epoch =
-      std::chrono::system_clock::now();
-  WriteOptions woptions;
-  ReadOptions roptions;
+  std::atomic<bool> failed(false);
+  std::vector<std::unique_ptr<Worker>> workers;
+  if (options.num_threads > 1) {
+    for (uint32_t i = 0; i < options.num_threads; ++i) {
+      workers.emplace_back(new Worker);
+      Worker* worker = workers.back().get();
+      worker->failed = &failed;
+      worker->thread = std::thread([this, worker] { RunWorker(worker); });
+    }
+  }
+
+  ReplayStats local_stats;
+  ReplayStats* inline_stats = stats != nullptr ? stats : &local_stats;
+  std::chrono::steady_clock::time_point replay_epoch =
+      std::chrono::steady_clock::now();
   Trace trace;
-  uint64_t ops = 0;
-  Iterator* single_iter = nullptr;
-  while (s.ok()) {
+  while (s.ok() && !failed.load(std::memory_order_relaxed)) {
     trace.reset();
     s = ReadTrace(&trace);
     if (!s.ok()) {
       break;
     }
-
-    std::this_thread::sleep_until(
-        replay_epoch + std::chrono::microseconds(trace.ts - header.ts));
-    if (trace.type == kTraceWrite) {
-      WriteBatch batch(trace.payload);
-      db_->Write(woptions, &batch);
-      ops++;
-    } else if (trace.type == kTraceGet) {
-      uint32_t cf_id = 0;
-      Slice key;
-      DecodeCFAndKey(trace.payload, &cf_id, &key);
-      if (cf_id > 0 && cf_map_.find(cf_id) == cf_map_.end()) {
-        return Status::Corruption("Invalid Column Family ID.");
-      }
-
-      std::string value;
-      if (cf_id == 0) {
-        db_->Get(roptions, key, &value);
-      } else {
-        db_->Get(roptions, cf_map_[cf_id], key, &value);
-      }
-      ops++;
-    } else if (trace.type == kTraceIteratorSeek) {
-      uint32_t cf_id = 0;
-      Slice key;
-      DecodeCFAndKey(trace.payload, &cf_id, &key);
-      if (cf_id > 0 && cf_map_.find(cf_id) == cf_map_.end()) {
-        return Status::Corruption("Invalid Column Family ID.");
-      }
-
-      if (cf_id == 0) {
-        single_iter = db_->NewIterator(roptions);
-      } else {
-        single_iter = db_->NewIterator(roptions, cf_map_[cf_id]);
-      }
-      single_iter->Seek(key);
-      ops++;
-      delete single_iter;
-    } else if (trace.type == kTraceIteratorSeekForPrev) {
-      // Currently, only support to call the Seek()
-      uint32_t cf_id = 0;
-      Slice key;
-      DecodeCFAndKey(trace.payload, &cf_id, &key);
-      if (cf_id > 0 && cf_map_.find(cf_id) == cf_map_.end()) {
-        return Status::Corruption("Invalid Column Family ID.");
-      }
-
-      if (cf_id == 0) {
-        single_iter = db_->NewIterator(roptions);
-      } else {
-        single_iter = db_->NewIterator(roptions, cf_map_[cf_id]);
-      }
-      single_iter->SeekForPrev(key);
-      ops++;
-      delete single_iter;
-    } else if (trace.type == kTraceEnd) {
+    if (trace.type == kTraceEnd) {
       // Do nothing for now.
       // TODO: Add some validations later.
       break;
     }
+
+    std::chrono::steady_clock::time_point due;
+    if (options.fast_forward > 0) {
+      due = replay_epoch +
+            std::chrono::microseconds(static_cast<uint64_t>(
+                (trace.ts - header.ts) / options.fast_forward));
+      std::this_thread::sleep_until(due);
+    } else {
+      due = std::chrono::steady_clock::now();
+    }
+    if (workers.empty()) {
+      s = Execute(trace);
+      RecordLatency(inline_stats, trace.type, due);
+      continue;
+    }
+    Worker* worker =
+        workers[DispatchHash(trace) % workers.size()].get();
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    worker->cv.wait(lock, [worker, &failed] {
+      return worker->tasks.size() < Worker::kMaxQueuedTasks ||
+             failed.load(std::memory_order_relaxed);
+    });
+    worker->tasks.emplace_back();
+    worker->tasks.back().trace = std::move(trace);
+    worker->tasks.back().due = due;
+    worker->cv.notify_all();
+  }
+
+  for (auto& worker : workers) {
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->done = true;
+      worker->cv.notify_all();
+    }
+    worker->thread.join();
+    if ((s.ok() || s.IsIncomplete()) && !worker->status.ok()) {
+      s = worker->status;
+    }
+    if (stats != nullptr) {
+      for (int type = 0; type < kTraceMax; ++type) {
+        stats->latency[type].Merge(worker->stats.latency[type]);
+      }
+    }
   }
 
   if (s.IsIncomplete()) {
@@ -230,6 +333,89 @@ Status Replayer::Replay() {
   return s;
 }
 
+void Replayer::RunWorker(Worker* worker) {
+  std::unique_lock<std::mutex> lock(worker->mutex);
+  while (true) {
+    worker->cv.wait(
+        lock, [worker] { return worker->done || !worker->tasks.empty(); });
+    if (worker->tasks.empty()) {
+      return;
+    }
+    Worker::Task task = std::move(worker->tasks.front());
+    worker->tasks.pop_front();
+    worker->cv.notify_all();
+    lock.unlock();
+    Status s;
+    if (!worker->failed->load(std::memory_order_relaxed)) {
+      s = Execute(task.trace);
+      RecordLatency(&worker->stats, task.trace.type, task.due);
+    }
+    lock.lock();
+    if (!s.ok() && worker->status.ok()) {
+      worker->status = s;
+      worker->failed->store(true, std::memory_order_relaxed);
+    }
+  }
+}
+
+uint32_t Replayer::DispatchHash(const Trace& trace) {
+  if (trace.type == kTraceWrite) {
+    WriteBatch batch(trace.payload);
+    FirstKeyHandler handler;
+    batch.Iterate(&handler);
+    return GetSliceHash(handler.key);
+  }
+  uint32_t cf_id = 0;
+  Slice key;
+  DecodeCFAndKey(trace.payload, &cf_id, &key);
+  return GetSliceHash(key);
+}
+
+Status Replayer::Execute(const Trace& trace) {
+  WriteOptions woptions;
+  ReadOptions roptions;
+  Iterator* single_iter = nullptr;
+  if (trace.type == kTraceWrite) {
+    WriteBatch batch(trace.payload);
+    db_->Write(woptions, &batch);
+  } else if (trace.type == kTraceGet) {
+    uint32_t cf_id = 0;
+    Slice key;
+    DecodeCFAndKey(trace.payload, &cf_id, &key);
+    if (cf_id > 0 && cf_map_.find(cf_id) == cf_map_.end()) {
+      return Status::Corruption("Invalid Column Family ID.");
+    }
+
+    std::string value;
+    if (cf_id == 0) {
+      db_->Get(roptions, key, &value);
+    } else {
+      db_->Get(roptions, cf_map_.at(cf_id), key, &value);
+    }
+  } else if (trace.type == kTraceIteratorSeek ||
+             trace.type == kTraceIteratorSeekForPrev) {
+    uint32_t cf_id = 0;
+    Slice key;
+    DecodeCFAndKey(trace.payload, &cf_id, &key);
+    if (cf_id > 0 && cf_map_.find(cf_id) == cf_map_.end()) {
+      return Status::Corruption("Invalid Column Family ID.");
+    }
+
+    if (cf_id == 0) {
+      single_iter = db_->NewIterator(roptions);
+    } else {
+      single_iter = db_->NewIterator(roptions, cf_map_.at(cf_id));
+    }
+    if (trace.type == kTraceIteratorSeek) {
+      single_iter->Seek(key);
+    } else {
+      single_iter->SeekForPrev(key);
+    }
+    delete single_iter;
+  }
+  return Status::OK();
+}
+
 Status Replayer::ReadHeader(Trace* header) {
   assert(header != nullptr);
   Status s = ReadTrace(header);
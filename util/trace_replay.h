@@ -6,9 +6,11 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
+#include "monitoring/histogram.h"
 #include "rocksdb/env.h"
 #include "rocksdb/options.h"
 #include "rocksdb/terark_namespace.h"
@@ -79,6 +81,25 @@ class Tracer {
   std::unique_ptr<TraceWriter> trace_writer_;
 };
 
+struct ReplayOptions {
+  // Threads issuing the operations. An operation goes to the thread picked by
+  // the hash of its key, the first key of a write batch, so the operations of
+  // a key keep their recorded order.
+  uint32_t num_threads = 1;
+  // The recorded intervals between the operations are divided by this, 2
+  // replays twice as fast. 0 issues the operations as fast as possible.
+  double fast_forward = 1.0;
+};
+
+// Latencies of the replayed operations in microseconds, by TraceType. They
+// count from the time an operation was due, so the time it waited behind the
+// operations of its thread is included, as it would be for a client.
+struct ReplayStats {
+  HistogramImpl latency[kTraceMax];
+
+  std::string ToString() const;
+};
+
 // Replay RocksDB operations from a trace.
 class Replayer {
  public:
@@ -86,12 +107,22 @@ class Replayer {
            std::unique_ptr<TraceReader>&& reader);
   ~Replayer();
 
+  // Issue the operations at their recorded times from the calling thread
   Status Replay();
+  // `stats` may be nullptr
+  Status Replay(const ReplayOptions& options, ReplayStats* stats);
 
  private:
+  struct Worker;
+
   Status ReadHeader(Trace* header);
   Status ReadFooter(Trace* footer);
   Status ReadTrace(Trace* trace);
+  void RunWorker(Worker* worker);
+  // Run one traced operation
+  Status Execute(const Trace& trace);
+  // Picks the worker of `trace`, by the hash of its key
+  static uint32_t DispatchHash(const Trace& trace);
 
   DBImpl* db_;
   std::unique_ptr<TraceReader> trace_reader_;
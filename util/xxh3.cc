@@ -0,0 +1,17 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/xxh3.h"
+
+#include "rocksdb/terark_namespace.h"
+#include "util/xxh3p.h"
+
+namespace TERARKDB_NAMESPACE {
+
+uint64_t XXH3Hash64(const char* data, size_t n) {
+  return XXH3_64bits(data, n);
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,29 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// XXH3 of xxHash 0.8, see util/xxh3p.h. It vectorizes with SSE2, AVX2 or
+// AVX-512 by the instruction sets the build enables.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// Return the 64 bits XXH3 of data[0,n-1], with seed 0
+extern uint64_t XXH3Hash64(const char* data, size_t n);
+
+// Return the kXXH3 checksum of data[0,n-1] followed by last_byte. last_byte
+// is mixed in rather than hashed, so the checksum needs no copy or streaming
+// state when it is the block type that follows the block contents.
+inline uint32_t XXH3ChecksumWithLastByte(const char* data, size_t n,
+                                         char last_byte) {
+  uint32_t v = static_cast<uint32_t>(XXH3Hash64(data, n));
+  return v ^ (static_cast<uint8_t>(last_byte) * 0x6b9083d9u);
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,145 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/zone_gc_rate_limiter.h"
+
+#include <algorithm>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/mutexlock.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+thread_local bool gc_io_scope_active = false;
+
+// Neither bucket may drop to zero, GenericRateLimiter requires a positive rate
+int64_t ShareOf(int64_t rate_bytes_per_sec, double share) {
+  return std::max<int64_t>(
+      1, static_cast<int64_t>(static_cast<double>(rate_bytes_per_sec) * share));
+}
+}  // namespace
+
+GCIOScope::GCIOScope() : prev_(gc_io_scope_active) {
+  gc_io_scope_active = true;
+}
+
+GCIOScope::~GCIOScope() { gc_io_scope_active = prev_; }
+
+bool GCIOScope::Active() { return gc_io_scope_active; }
+
+ZoneGCRateLimiter::ZoneGCRateLimiter(int64_t rate_bytes_per_sec,
+                                     double min_gc_share, double max_gc_share,
+                                     int64_t refill_period_us, int32_t fairness,
+                                     RateLimiter::Mode mode, Env* env)
+    : RateLimiter(mode),
+      min_gc_share_(std::min(std::max(min_gc_share, 0.0), 1.0)),
+      max_gc_share_(std::min(std::max(max_gc_share, min_gc_share_), 1.0)),
+      rate_bytes_per_sec_(rate_bytes_per_sec),
+      gc_share_(min_gc_share_) {
+  fg_.reset(new GenericRateLimiter(
+      ShareOf(rate_bytes_per_sec, 1.0 - min_gc_share_), refill_period_us,
+      fairness, mode, env, false /* auto_tuned */));
+  gc_.reset(new GenericRateLimiter(ShareOf(rate_bytes_per_sec, min_gc_share_),
+                                   refill_period_us, fairness, mode, env,
+                                   false /* auto_tuned */));
+}
+
+void ZoneGCRateLimiter::SetBytesPerSecond(int64_t bytes_per_second) {
+  assert(bytes_per_second > 0);
+  MutexLock l(&mutex_);
+  rate_bytes_per_sec_.store(bytes_per_second, std::memory_order_relaxed);
+  Rebalance();
+}
+
+void ZoneGCRateLimiter::Request(const int64_t bytes, const Env::IOPriority pri,
+                                Statistics* stats) {
+  // GC I/O is queued in its own bucket, all of it at the same priority
+  GenericRateLimiter* limiter = GCIOScope::Active() ? gc_.get() : fg_.get();
+  Env::IOPriority limiter_pri = GCIOScope::Active() ? Env::IO_LOW : pri;
+  // The burst of a bucket shrinks when the budget is rebalanced, a request
+  // sized against the previous burst is split instead of overdrawing
+  int64_t left = bytes;
+  do {
+    int64_t burst = std::max<int64_t>(1, limiter->GetSingleBurstBytes());
+    int64_t chunk = std::min(left, burst);
+    limiter->Request(chunk, limiter_pri, stats);
+    left -= chunk;
+  } while (left > 0);
+}
+
+int64_t ZoneGCRateLimiter::GetSingleBurstBytes() const {
+  return std::min(fg_->GetSingleBurstBytes(), gc_->GetSingleBurstBytes());
+}
+
+int64_t ZoneGCRateLimiter::GetTotalBytesThrough(
+    const Env::IOPriority pri) const {
+  if (pri == Env::IO_TOTAL) {
+    return fg_->GetTotalBytesThrough() + gc_->GetTotalBytesThrough();
+  }
+  return fg_->GetTotalBytesThrough(pri);
+}
+
+int64_t ZoneGCRateLimiter::GetTotalRequests(const Env::IOPriority pri) const {
+  if (pri == Env::IO_TOTAL) {
+    return fg_->GetTotalRequests() + gc_->GetTotalRequests();
+  }
+  return fg_->GetTotalRequests(pri);
+}
+
+double ZoneGCRateLimiter::CalculateGCShare(double free_ratio,
+                                           double free_ratio_target,
+                                           double min_gc_share,
+                                           double max_gc_share) {
+  if (free_ratio_target <= 0) {
+    return min_gc_share;
+  }
+  // The same 1.5x band the zone GC picker trickles in
+  double low = free_ratio_target * 0.5;
+  double high = free_ratio_target * 1.5;
+  if (free_ratio <= low) {
+    return max_gc_share;
+  }
+  if (free_ratio >= high) {
+    return min_gc_share;
+  }
+  double pressure = (high - free_ratio) / (high - low);
+  return min_gc_share + (max_gc_share - min_gc_share) * pressure;
+}
+
+void ZoneGCRateLimiter::UpdateZoneFreeRatio(double free_ratio,
+                                            double free_ratio_target) {
+  double share = CalculateGCShare(free_ratio, free_ratio_target, min_gc_share_,
+                                  max_gc_share_);
+  MutexLock l(&mutex_);
+  if (share == gc_share_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  gc_share_.store(share, std::memory_order_relaxed);
+  Rebalance();
+}
+
+void ZoneGCRateLimiter::Rebalance() {
+  mutex_.AssertHeld();
+  int64_t rate = rate_bytes_per_sec_.load(std::memory_order_relaxed);
+  double share = gc_share_.load(std::memory_order_relaxed);
+  fg_->SetBytesPerSecond(ShareOf(rate, 1.0 - share));
+  gc_->SetBytesPerSecond(ShareOf(rate, share));
+}
+
+RateLimiter* NewZoneGCRateLimiter(
+    int64_t rate_bytes_per_sec, double min_gc_share /* = 0.1 */,
+    double max_gc_share /* = 0.6 */,
+    int64_t refill_period_us /* = 100 * 1000 */, int32_t fairness /* = 10 */,
+    RateLimiter::Mode mode /* = RateLimiter::Mode::kWritesOnly */) {
+  assert(rate_bytes_per_sec > 0);
+  assert(refill_period_us > 0);
+  assert(fairness > 0);
+  return new ZoneGCRateLimiter(rate_bytes_per_sec, min_gc_share, max_gc_share,
+                               refill_period_us, fairness, mode,
+                               Env::Default());
+}
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,76 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/rate_limiter.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// ZoneGCRateLimiter keeps two token buckets: one for the regular flush and
+// compaction I/O which behaves as a GenericRateLimiter, and one for the GC
+// migration I/O issued inside a GCIOScope. The total budget is split between
+// them according to the zone free ratio last reported, so that GC is allowed
+// to steal bandwidth from the foreground when zones are scarce and is pushed
+// back to a trickle when there is comfortable headroom.
+class ZoneGCRateLimiter : public RateLimiter {
+ public:
+  ZoneGCRateLimiter(int64_t rate_bytes_per_sec, double min_gc_share,
+                    double max_gc_share, int64_t refill_period_us,
+                    int32_t fairness, RateLimiter::Mode mode, Env* env);
+
+  void SetBytesPerSecond(int64_t bytes_per_second) override;
+
+  using RateLimiter::Request;
+  void Request(const int64_t bytes, const Env::IOPriority pri,
+               Statistics* stats) override;
+
+  int64_t GetSingleBurstBytes() const override;
+
+  int64_t GetTotalBytesThrough(
+      const Env::IOPriority pri = Env::IO_TOTAL) const override;
+
+  int64_t GetTotalRequests(
+      const Env::IOPriority pri = Env::IO_TOTAL) const override;
+
+  int64_t GetBytesPerSecond() const override {
+    return rate_bytes_per_sec_.load(std::memory_order_relaxed);
+  }
+
+  void UpdateZoneFreeRatio(double free_ratio,
+                           double free_ratio_target) override;
+
+  // Share of the budget currently granted to the GC class
+  double GetGCShare() const {
+    return gc_share_.load(std::memory_order_relaxed);
+  }
+
+  int64_t GetGCBytesThrough() const { return gc_->GetTotalBytesThrough(); }
+
+  // Maps a free ratio to the GC share, exposed for tests
+  static double CalculateGCShare(double free_ratio, double free_ratio_target,
+                                 double min_gc_share, double max_gc_share);
+
+ private:
+  void Rebalance();
+
+  const double min_gc_share_;
+  const double max_gc_share_;
+  std::atomic<int64_t> rate_bytes_per_sec_;
+  std::atomic<double> gc_share_;
+  // Serializes budget updates
+  port::Mutex mutex_;
+  std::unique_ptr<GenericRateLimiter> fg_;
+  std::unique_ptr<GenericRateLimiter> gc_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
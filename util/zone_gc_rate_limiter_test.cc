@@ -0,0 +1,113 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/zone_gc_rate_limiter.h"
+
+#include <memory>
+
+#include "port/stack_trace.h"
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class ZoneGCRateLimiterTest : public testing::Test {
+ public:
+  static constexpr int64_t kRate = 100 << 20;
+};
+
+constexpr int64_t ZoneGCRateLimiterTest::kRate;
+
+TEST_F(ZoneGCRateLimiterTest, GCShare) {
+  const double kMin = 0.1, kMax = 0.5, kTarget = 0.2;
+  auto share = [&](double free_ratio) {
+    return ZoneGCRateLimiter::CalculateGCShare(free_ratio, kTarget, kMin, kMax);
+  };
+  ASSERT_DOUBLE_EQ(kMax, share(0.0));
+  ASSERT_DOUBLE_EQ(kMax, share(0.05));
+  ASSERT_DOUBLE_EQ((kMin + kMax) / 2, share(0.2));
+  ASSERT_DOUBLE_EQ(kMin, share(0.35));
+  ASSERT_DOUBLE_EQ(kMin, share(0.9));
+  ASSERT_GT(share(0.15), share(0.25));
+  // GC target disabled
+  ASSERT_DOUBLE_EQ(kMin, ZoneGCRateLimiter::CalculateGCShare(0, 0, kMin, kMax));
+}
+
+TEST_F(ZoneGCRateLimiterTest, RebalanceOnFreeRatio) {
+  ZoneGCRateLimiter limiter(kRate, 0.1, 0.5, 100 * 1000, 10,
+                            RateLimiter::Mode::kWritesOnly, Env::Default());
+  ASSERT_EQ(kRate, limiter.GetBytesPerSecond());
+  ASSERT_DOUBLE_EQ(0.1, limiter.GetGCShare());
+  int64_t relaxed_burst = limiter.GetSingleBurstBytes();
+
+  // Zones are scarce, GC takes half of the budget
+  limiter.UpdateZoneFreeRatio(0.01, 0.2);
+  ASSERT_DOUBLE_EQ(0.5, limiter.GetGCShare());
+  ASSERT_GT(limiter.GetSingleBurstBytes(), relaxed_burst);
+  ASSERT_EQ(kRate, limiter.GetBytesPerSecond());
+
+  limiter.UpdateZoneFreeRatio(0.8, 0.2);
+  ASSERT_DOUBLE_EQ(0.1, limiter.GetGCShare());
+  ASSERT_EQ(relaxed_burst, limiter.GetSingleBurstBytes());
+
+  limiter.SetBytesPerSecond(kRate * 2);
+  ASSERT_EQ(kRate * 2, limiter.GetBytesPerSecond());
+  ASSERT_GT(limiter.GetSingleBurstBytes(), relaxed_burst);
+}
+
+TEST_F(ZoneGCRateLimiterTest, Classify) {
+  std::unique_ptr<RateLimiter> limiter(NewZoneGCRateLimiter(kRate));
+  auto* zone_limiter = static_cast<ZoneGCRateLimiter*>(limiter.get());
+  int64_t burst = limiter->GetSingleBurstBytes();
+
+  limiter->Request(burst, Env::IO_HIGH, nullptr, RateLimiter::OpType::kWrite);
+  limiter->Request(burst, Env::IO_LOW, nullptr, RateLimiter::OpType::kWrite);
+  ASSERT_FALSE(GCIOScope::Active());
+  {
+    GCIOScope scope;
+    ASSERT_TRUE(GCIOScope::Active());
+    {
+      GCIOScope nested;
+      ASSERT_TRUE(GCIOScope::Active());
+    }
+    ASSERT_TRUE(GCIOScope::Active());
+    limiter->Request(burst, Env::IO_HIGH, nullptr,
+                     RateLimiter::OpType::kWrite);
+  }
+  ASSERT_FALSE(GCIOScope::Active());
+
+  ASSERT_EQ(burst, limiter->GetTotalBytesThrough(Env::IO_HIGH));
+  ASSERT_EQ(burst, limiter->GetTotalBytesThrough(Env::IO_LOW));
+  ASSERT_EQ(burst, zone_limiter->GetGCBytesThrough());
+  ASSERT_EQ(3 * burst, limiter->GetTotalBytesThrough());
+  ASSERT_EQ(3, limiter->GetTotalRequests());
+
+  // Reads are not limited in kWritesOnly mode
+  limiter->Request(burst, Env::IO_HIGH, nullptr, RateLimiter::OpType::kRead);
+  ASSERT_EQ(3 * burst, limiter->GetTotalBytesThrough());
+}
+
+TEST_F(ZoneGCRateLimiterTest, SplitOversizedRequest) {
+  ZoneGCRateLimiter limiter(kRate, 0.1, 0.5, 100 * 1000, 10,
+                            RateLimiter::Mode::kAllIo, Env::Default());
+  limiter.UpdateZoneFreeRatio(0.0, 0.2);
+  int64_t burst = limiter.GetSingleBurstBytes();
+  // Headroom recovered, the GC burst shrinks under a pending size
+  limiter.UpdateZoneFreeRatio(1.0, 0.2);
+  ASSERT_LT(limiter.GetSingleBurstBytes(), burst);
+  GCIOScope scope;
+  limiter.Request(burst, Env::IO_LOW, nullptr);
+  ASSERT_EQ(burst, limiter.GetGCBytesThrough());
+  ASSERT_GT(limiter.GetTotalRequests(), 1);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
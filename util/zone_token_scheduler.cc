@@ -0,0 +1,216 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/zone_token_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+ZoneTokenScheduler::Writer::Writer(ZoneTokenScheduler* scheduler,
+                                   WriterClass writer_class)
+    : scheduler_(scheduler), writer_class_(writer_class) {}
+
+ZoneTokenScheduler::Writer::~Writer() { Release(); }
+
+void ZoneTokenScheduler::Writer::BeginWrite() {
+  if (scheduler_ == nullptr) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(scheduler_->mutex_);
+  assert(!writing_);
+  if (holding_ && scheduler_->ShouldYield(writer_class_)) {
+    scheduler_->ReleaseLocked(this);
+    ++scheduler_->num_revoked_;
+    scheduler_->cv_.notify_all();
+  }
+  if (!holding_) {
+    scheduler_->Acquire(this, &lock);
+  }
+  writing_ = true;
+}
+
+void ZoneTokenScheduler::Writer::EndWrite() {
+  if (scheduler_ == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(scheduler_->mutex_);
+  assert(writing_);
+  writing_ = false;
+  last_write_micros_ = scheduler_->env_->NowMicros();
+  // A waiting writer may take the token back now
+  scheduler_->cv_.notify_all();
+}
+
+void ZoneTokenScheduler::Writer::Release() {
+  if (scheduler_ == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(scheduler_->mutex_);
+  if (holding_) {
+    scheduler_->ReleaseLocked(this);
+    scheduler_->cv_.notify_all();
+  }
+}
+
+bool ZoneTokenScheduler::Writer::holding() const {
+  if (scheduler_ == nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(scheduler_->mutex_);
+  return holding_;
+}
+
+ZoneTokenScheduler::ZoneTokenScheduler(const ZoneTokenOptions& options,
+                                       Env* env)
+    : max_active_zones_(std::max(options.max_active_zones, 1)),
+      idle_micros_(options.idle_micros),
+      env_(env) {
+  const int reserved[kNumWriterClasses] = {
+      options.reserved_wal, options.reserved_flush,
+      options.reserved_compaction, options.reserved_gc};
+  // The reservations of the higher priority classes are kept if they don't
+  // all fit
+  int left = max_active_zones_;
+  for (int c = 0; c < kNumWriterClasses; ++c) {
+    reserved_[c] = std::min(std::max(reserved[c], 0), left);
+    left -= reserved_[c];
+  }
+}
+
+ZoneTokenScheduler::WriterClass ZoneTokenScheduler::ClassOf(
+    DBFileType file_type, bool gc) {
+  if (gc) {
+    return kGC;
+  }
+  switch (file_type) {
+    case DBFileType::kFlushFile:
+      return kFlush;
+    case DBFileType::kCompactionOutputFile:
+      return kCompaction;
+    default:
+      return kWAL;
+  }
+}
+
+int ZoneTokenScheduler::held(WriterClass c) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return held_[c];
+}
+
+int ZoneTokenScheduler::waiting(WriterClass c) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return waiting_[c];
+}
+
+uint64_t ZoneTokenScheduler::num_revoked() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_revoked_;
+}
+
+void ZoneTokenScheduler::Acquire(Writer* w,
+                                 std::unique_lock<std::mutex>* lock) {
+  const WriterClass c = w->writer_class_;
+  ++waiting_[c];
+  while (!CanGrant(c)) {
+    bool higher_waiting = false;
+    for (int k = 0; k < c; ++k) {
+      higher_waiting |= waiting_[k] > 0;
+    }
+    // A higher priority writer takes back the next token itself
+    if (!higher_waiting && Revoke(c)) {
+      continue;
+    }
+    if (idle_micros_ > 0) {
+      // Until a holder becomes idle
+      cv_.wait_for(*lock, std::chrono::microseconds(idle_micros_));
+    } else {
+      cv_.wait(*lock);
+    }
+  }
+  --waiting_[c];
+  w->holding_ = true;
+  w->last_write_micros_ = env_->NowMicros();
+  ++held_[c];
+  ++num_held_;
+  holders_.insert(w);
+}
+
+void ZoneTokenScheduler::ReleaseLocked(Writer* w) {
+  assert(w->holding_ && !w->writing_);
+  w->holding_ = false;
+  --held_[w->writer_class_];
+  --num_held_;
+  holders_.erase(w);
+}
+
+bool ZoneTokenScheduler::CanGrant(WriterClass c) const {
+  int free_tokens = max_active_zones_ - num_held_;
+  if (free_tokens <= 0) {
+    return false;
+  }
+  if (held_[c] < reserved_[c]) {
+    return true;
+  }
+  int unmet_reservations = 0;
+  for (int k = 0; k < kNumWriterClasses; ++k) {
+    if (k != c) {
+      unmet_reservations += std::max(reserved_[k] - held_[k], 0);
+    }
+  }
+  if (free_tokens <= unmet_reservations) {
+    return false;
+  }
+  for (int k = 0; k < c; ++k) {
+    if (waiting_[k] > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ZoneTokenScheduler::Revoke(WriterClass c) {
+  const uint64_t now = env_->NowMicros();
+  Writer* victim = nullptr;
+  for (Writer* h : holders_) {
+    const WriterClass k = h->writer_class_;
+    if (h->writing_ || held_[k] <= reserved_[k]) {
+      continue;
+    }
+    bool idle = idle_micros_ > 0 && now - h->last_write_micros_ >= idle_micros_;
+    if (!idle && k <= c) {
+      continue;
+    }
+    // The lowest priority class first, then the writer idle the longest
+    if (victim == nullptr || k > victim->writer_class_ ||
+        (k == victim->writer_class_ &&
+         h->last_write_micros_ < victim->last_write_micros_)) {
+      victim = h;
+    }
+  }
+  if (victim == nullptr) {
+    return false;
+  }
+  ReleaseLocked(victim);
+  ++num_revoked_;
+  return true;
+}
+
+bool ZoneTokenScheduler::ShouldYield(WriterClass c) const {
+  if (held_[c] <= reserved_[c]) {
+    return false;
+  }
+  for (int k = 0; k < c; ++k) {
+    if (waiting_[k] > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace TERARKDB_NAMESPACE
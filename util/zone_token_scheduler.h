@@ -0,0 +1,125 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+// ZoneTokenScheduler hands out the active zone tokens of a ZNS device to the
+// writers of a ZenFS Env, see ZoneTokenOptions. A writer holds a token from
+// its first write until it is closed, or until its token is taken back while
+// it is between writes:
+//  - from any writer of a class holding more than its reservation once the
+//    writer has been idle for ZoneTokenOptions::idle_micros,
+//  - from a writer of a lower priority class holding more than its
+//    reservation as soon as a writer of a higher priority class waits.
+// The waiting writers are served in priority order, a writer still under the
+// reservation of its class is served first.
+class ZoneTokenScheduler {
+ public:
+  // In priority order
+  enum WriterClass : int {
+    kWAL = 0,  // WAL, MANIFEST and the other metadata files
+    kFlush,
+    kCompaction,
+    kGC,
+    kNumWriterClasses,
+  };
+
+  class Writer {
+   public:
+    // REQUIRES: `scheduler` outlives the writer. `scheduler` may be nullptr,
+    // the writer then never waits.
+    Writer(ZoneTokenScheduler* scheduler, WriterClass writer_class);
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // Bracket a write, BeginWrite() waits for a token if the writer does not
+    // hold one. The token can't be taken back until EndWrite().
+    void BeginWrite();
+    void EndWrite();
+
+    // Return the token once the writer won't write again
+    void Release();
+
+    WriterClass writer_class() const { return writer_class_; }
+    bool holding() const;
+
+   private:
+    friend class ZoneTokenScheduler;
+
+    ZoneTokenScheduler* scheduler_;
+    const WriterClass writer_class_;
+    // Protected by scheduler_->mutex_
+    bool holding_ = false;
+    bool writing_ = false;
+    uint64_t last_write_micros_ = 0;
+  };
+
+  // Brackets a write of `writer` for its scope
+  class WriteGuard {
+   public:
+    explicit WriteGuard(Writer* writer) : writer_(writer) {
+      writer_->BeginWrite();
+    }
+    ~WriteGuard() { writer_->EndWrite(); }
+
+    WriteGuard(const WriteGuard&) = delete;
+    WriteGuard& operator=(const WriteGuard&) = delete;
+
+   private:
+    Writer* writer_;
+  };
+
+  ZoneTokenScheduler(const ZoneTokenOptions& options, Env* env);
+
+  // Classify a new writable file, `gc` if it is created inside a GCIOScope
+  static WriterClass ClassOf(DBFileType file_type, bool gc);
+
+  int max_active_zones() const { return max_active_zones_; }
+  int reserved(WriterClass c) const { return reserved_[c]; }
+  int held(WriterClass c) const;
+  int waiting(WriterClass c) const;
+  // Tokens taken back from writers so far
+  uint64_t num_revoked() const;
+
+ private:
+  void Acquire(Writer* w, std::unique_lock<std::mutex>* lock);
+  void ReleaseLocked(Writer* w);
+  // Whether a token can be granted to a writer of class `c`
+  bool CanGrant(WriterClass c) const;
+  // Take back a token for a writer of class `c`, returns false if no writer
+  // can give it up
+  bool Revoke(WriterClass c);
+  // Whether a writer holding a token of class `c` between writes has to give
+  // it up to a waiting writer of a higher priority class
+  bool ShouldYield(WriterClass c) const;
+
+  const int max_active_zones_;
+  int reserved_[kNumWriterClasses];
+  const uint64_t idle_micros_;
+  Env* const env_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  int num_held_ = 0;
+  int held_[kNumWriterClasses] = {};
+  int waiting_[kNumWriterClasses] = {};
+  uint64_t num_revoked_ = 0;
+  // The writers holding a token
+  std::unordered_set<Writer*> holders_;
+};
+
+}  // namespace TERARKDB_NAMESPACE
@@ -0,0 +1,173 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/zone_token_scheduler.h"
+
+#include <thread>
+
+#include "port/stack_trace.h"
+#include "rocksdb/env.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/mock_time_env.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class ZoneTokenSchedulerTest : public testing::Test {
+ public:
+  typedef ZoneTokenScheduler S;
+
+  ZoneTokenSchedulerTest() : env_(Env::Default()) {}
+
+  static ZoneTokenOptions Options(int max_active_zones, int reserved_wal,
+                                  int reserved_flush, uint64_t idle_micros) {
+    ZoneTokenOptions options;
+    options.max_active_zones = max_active_zones;
+    options.reserved_wal = reserved_wal;
+    options.reserved_flush = reserved_flush;
+    options.idle_micros = idle_micros;
+    return options;
+  }
+
+  static void Write(S::Writer* writer) {
+    S::WriteGuard guard(writer);
+  }
+
+  // Wait for `n` writers of class `c` to wait for a token
+  static void WaitForWaiters(const S& scheduler, S::WriterClass c, int n) {
+    while (scheduler.waiting(c) < n) {
+      Env::Default()->SleepForMicroseconds(100);
+    }
+  }
+
+  MockTimeEnv env_;
+};
+
+TEST_F(ZoneTokenSchedulerTest, ClassOf) {
+  ASSERT_EQ(S::kWAL, S::ClassOf(DBFileType::kWAL, false));
+  ASSERT_EQ(S::kWAL, S::ClassOf(DBFileType::kManifest, false));
+  ASSERT_EQ(S::kWAL, S::ClassOf(DBFileType::kNoType, false));
+  ASSERT_EQ(S::kFlush, S::ClassOf(DBFileType::kFlushFile, false));
+  ASSERT_EQ(S::kCompaction,
+            S::ClassOf(DBFileType::kCompactionOutputFile, false));
+  ASSERT_EQ(S::kGC, S::ClassOf(DBFileType::kCompactionOutputFile, true));
+}
+
+TEST_F(ZoneTokenSchedulerTest, Reservations) {
+  S scheduler(Options(4, 1, 1, 0), &env_);
+  ASSERT_EQ(1, scheduler.reserved(S::kWAL));
+  ASSERT_EQ(1, scheduler.reserved(S::kFlush));
+
+  S::Writer c1(&scheduler, S::kCompaction);
+  S::Writer c2(&scheduler, S::kCompaction);
+  S::Writer c3(&scheduler, S::kCompaction);
+  Write(&c1);
+  Write(&c2);
+  ASSERT_EQ(2, scheduler.held(S::kCompaction));
+  // The other tokens are reserved
+  std::thread t([&] { Write(&c3); });
+  WaitForWaiters(scheduler, S::kCompaction, 1);
+
+  S::Writer wal(&scheduler, S::kWAL);
+  S::Writer flush(&scheduler, S::kFlush);
+  Write(&wal);
+  Write(&flush);
+  ASSERT_EQ(4, scheduler.held(S::kWAL) + scheduler.held(S::kFlush) +
+                   scheduler.held(S::kCompaction));
+  ASSERT_EQ(0u, scheduler.num_revoked());
+
+  c1.Release();
+  t.join();
+  ASSERT_FALSE(c1.holding());
+  ASSERT_TRUE(c3.holding());
+  ASSERT_EQ(2, scheduler.held(S::kCompaction));
+
+  // Too many reservations, the lower priority ones shrink
+  ZoneTokenOptions options = Options(2, 1, 2, 0);
+  options.reserved_gc = 1;
+  S small(options, &env_);
+  ASSERT_EQ(1, small.reserved(S::kWAL));
+  ASSERT_EQ(1, small.reserved(S::kFlush));
+  ASSERT_EQ(0, small.reserved(S::kGC));
+}
+
+TEST_F(ZoneTokenSchedulerTest, PreemptLowerPriority) {
+  S scheduler(Options(2, 0, 0, 0), &env_);
+  S::Writer gc1(&scheduler, S::kGC);
+  S::Writer gc2(&scheduler, S::kGC);
+  Write(&gc1);
+  Write(&gc2);
+
+  // A GC writer between writes gives its token to the flush writer
+  S::Writer flush(&scheduler, S::kFlush);
+  Write(&flush);
+  ASSERT_EQ(1u, scheduler.num_revoked());
+  ASSERT_EQ(1, scheduler.held(S::kGC));
+  ASSERT_TRUE(flush.holding());
+  S::Writer* gc = gc1.holding() ? &gc1 : &gc2;
+
+  // But not during a write
+  gc->BeginWrite();
+  flush.BeginWrite();
+  S::Writer wal(&scheduler, S::kWAL);
+  std::thread t([&] { Write(&wal); });
+  WaitForWaiters(scheduler, S::kWAL, 1);
+  ASSERT_TRUE(gc->holding());
+  ASSERT_FALSE(wal.holding());
+  gc->EndWrite();
+  t.join();
+  ASSERT_EQ(2u, scheduler.num_revoked());
+  ASSERT_FALSE(gc->holding());
+  flush.EndWrite();
+
+  // The flush writer keeps its token, the GC writer waits for it
+  std::thread t2([&] { Write(gc); });
+  WaitForWaiters(scheduler, S::kGC, 1);
+  ASSERT_TRUE(flush.holding());
+  flush.Release();
+  t2.join();
+  ASSERT_TRUE(gc->holding());
+  ASSERT_TRUE(wal.holding());
+  ASSERT_EQ(2u, scheduler.num_revoked());
+}
+
+TEST_F(ZoneTokenSchedulerTest, RevokeIdle) {
+  const uint64_t kIdle = 1000;
+  S scheduler(Options(1, 0, 0, kIdle), &env_);
+  S::Writer wal(&scheduler, S::kWAL);
+  Write(&wal);
+
+  // A lower priority writer only gets the token once the holder is idle
+  S::Writer compaction(&scheduler, S::kCompaction);
+  std::thread t([&] { Write(&compaction); });
+  WaitForWaiters(scheduler, S::kCompaction, 1);
+  ASSERT_TRUE(wal.holding());
+  env_.MockSleepForMicroseconds(static_cast<int>(kIdle));
+  t.join();
+  ASSERT_FALSE(wal.holding());
+  ASSERT_TRUE(compaction.holding());
+  ASSERT_EQ(1u, scheduler.num_revoked());
+
+  // The writer takes a token again on its next write
+  Write(&wal);
+  ASSERT_TRUE(wal.holding());
+  ASSERT_FALSE(compaction.holding());
+  ASSERT_EQ(2u, scheduler.num_revoked());
+}
+
+TEST_F(ZoneTokenSchedulerTest, NoScheduler) {
+  S::Writer writer(nullptr, S::kGC);
+  Write(&writer);
+  ASSERT_FALSE(writer.holding());
+  writer.Release();
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
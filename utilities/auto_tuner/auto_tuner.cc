@@ -0,0 +1,470 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "rocksdb/utilities/auto_tuner.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/convenience.h"
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/statistics.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/logging.h"
+#include "util/mutexlock.h"
+#include "util/string_util.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+
+// A reverted change is not made again for this many evaluations
+const uint64_t kRetryAfterEvaluations = 8;
+
+AutoTunerCondition Condition(const std::string& metric,
+                             AutoTunerCondition::Operator op, double threshold,
+                             const std::string& divisor = "") {
+  AutoTunerCondition condition;
+  condition.metric = metric;
+  condition.divisor = divisor;
+  condition.op = op;
+  condition.threshold = threshold;
+  return condition;
+}
+
+AutoTunerSuggestion Suggestion(const std::string& option,
+                               AutoTunerSuggestion::Action action) {
+  AutoTunerSuggestion suggestion;
+  suggestion.option = option;
+  suggestion.action = action;
+  return suggestion;
+}
+
+// False if `str` is not a number, the integer options print no fraction
+bool ParseNumber(const std::string& str, double* value, bool* integer) {
+  const char* begin = str.c_str();
+  char* end;
+  *value = strtod(begin, &end);
+  if (end == begin || *end != '\0') {
+    return false;
+  }
+  *integer = str.find_first_of(".eE") == std::string::npos;
+  return true;
+}
+
+class AutoTunerImpl : public AutoTuner {
+ public:
+  AutoTunerImpl(DB* db, const AutoTunerOptions& options)
+      : db_(db),
+        options_(options),
+        column_family_(options.column_family != nullptr
+                           ? options.column_family
+                           : db->DefaultColumnFamily()),
+        env_(db->GetEnv()),
+        cv_(&mutex_) {
+    DBOptions db_options = db->GetDBOptions();
+    info_log_ = db_options.info_log;
+    statistics_ = db_options.statistics;
+    for (const auto& ticker : TickersNameMap) {
+      tickers_.emplace(ticker.second, ticker.first);
+    }
+    if (options_.period_sec > 0) {
+      thread_ = port::Thread(&AutoTunerImpl::Run, this);
+    }
+  }
+
+  ~AutoTunerImpl() override {
+    {
+      MutexLock l(&mutex_);
+      stop_ = true;
+      cv_.SignalAll();
+    }
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  Status EvaluateOnce() override {
+    MutexLock l(&evaluate_mutex_);
+    ++evaluations_;
+    now_micros_ = env_->NowMicros();
+    ticker_values_.clear();
+    if (statistics_ != nullptr) {
+      for (const auto& ticker : tickers_) {
+        ticker_values_[ticker.second] =
+            statistics_->getTickerCount(ticker.second);
+      }
+    }
+
+    Status s;
+    if (!pending_.empty()) {
+      // Each change gets a period of its own to be measured
+      s = MeasurePendingChanges();
+    } else {
+      s = ApplyRules();
+    }
+
+    last_ticker_values_ = ticker_values_;
+    last_micros_ = now_micros_;
+    return s;
+  }
+
+  std::vector<AutoTunerChange> GetChanges() const override {
+    MutexLock l(&evaluate_mutex_);
+    return changes_;
+  }
+
+ private:
+  void Run() {
+    MutexLock l(&mutex_);
+    Env* clock = Env::Default();
+    while (true) {
+      uint64_t deadline =
+          clock->NowMicros() + uint64_t{options_.period_sec} * 1000000;
+      while (!stop_ && clock->NowMicros() < deadline) {
+        cv_.TimedWait(deadline);
+      }
+      if (stop_) {
+        break;
+      }
+      mutex_.Unlock();
+      EvaluateOnce();
+      mutex_.Lock();
+    }
+  }
+
+  // The per second rate of a ticker, or an integer property of the column
+  // family
+  bool GetMetric(const std::string& name, double* value) const {
+    auto ticker = tickers_.find(name);
+    if (ticker != tickers_.end()) {
+      if (statistics_ == nullptr || last_micros_ == 0 ||
+          now_micros_ <= last_micros_) {
+        return false;
+      }
+      auto last = last_ticker_values_.find(ticker->second);
+      uint64_t count = ticker_values_.at(ticker->second);
+      uint64_t last_count =
+          last != last_ticker_values_.end() ? last->second : 0;
+      *value = static_cast<double>(count - std::min(count, last_count)) *
+               1000000 / static_cast<double>(now_micros_ - last_micros_);
+      return true;
+    }
+    uint64_t property;
+    if (!db_->GetIntProperty(column_family_, name, &property)) {
+      return false;
+    }
+    *value = static_cast<double>(property);
+    return true;
+  }
+
+  bool Holds(const AutoTunerCondition& condition) const {
+    double value;
+    if (!GetMetric(condition.metric, &value)) {
+      return false;
+    }
+    if (!condition.divisor.empty()) {
+      double divisor;
+      if (!GetMetric(condition.divisor, &divisor) || divisor == 0) {
+        return false;
+      }
+      value /= divisor;
+    }
+    return condition.op == AutoTunerCondition::kGreater
+               ? value > condition.threshold
+               : value < condition.threshold;
+  }
+
+  // The current value of a mutable option, and whether it's a DB option
+  bool GetOption(const std::string& option, std::string* value,
+                 bool* db_option) const {
+    std::string opts_str;
+    std::unordered_map<std::string, std::string> opts_map;
+    if (GetStringFromDBOptions(&opts_str, db_->GetDBOptions()).ok() &&
+        StringToMap(opts_str, &opts_map).ok() && opts_map.count(option) > 0) {
+      *value = opts_map[option];
+      *db_option = true;
+      return true;
+    }
+    opts_map.clear();
+    if (GetStringFromColumnFamilyOptions(&opts_str,
+                                         db_->GetOptions(column_family_))
+            .ok() &&
+        StringToMap(opts_str, &opts_map).ok() && opts_map.count(option) > 0) {
+      *value = opts_map[option];
+      *db_option = false;
+      return true;
+    }
+    return false;
+  }
+
+  Status SetOption(const std::string& option, const std::string& value,
+                   bool db_option) {
+    if (db_option) {
+      return db_->SetDBOptions({{option, value}});
+    }
+    return db_->SetOptions(column_family_, {{option, value}});
+  }
+
+  // The value one step from `value` within the bounds, empty if there's none
+  std::string Step(const std::string& value, const AutoTunerBounds& bounds,
+                   AutoTunerSuggestion::Action action) const {
+    double current;
+    bool integer;
+    if (!ParseNumber(value, &current, &integer) || bounds.min > bounds.max) {
+      return "";
+    }
+    double factor = std::max(bounds.factor, 1.0);
+    double target = std::min(std::max(current, bounds.min), bounds.max);
+    if (action == AutoTunerSuggestion::kIncrease) {
+      target = integer ? std::max(std::ceil(target * factor), target + 1)
+                       : target * factor;
+    } else {
+      target = integer ? std::min(std::floor(target / factor), target - 1)
+                       : target / factor;
+    }
+    target = std::min(std::max(target, bounds.min), bounds.max);
+    if (integer) {
+      target = action == AutoTunerSuggestion::kIncrease ? std::floor(target)
+                                                        : std::ceil(target);
+    }
+    if (target == current) {
+      return "";
+    }
+    return integer ? ToString(static_cast<int64_t>(target)) : ToString(target);
+  }
+
+  bool Blocked(const std::string& option,
+               AutoTunerSuggestion::Action action) const {
+    auto find = reverted_.find(option);
+    return find != reverted_.end() && find->second.action == action &&
+           evaluations_ < find->second.evaluation + kRetryAfterEvaluations;
+  }
+
+  Status ApplyRules() {
+    Status result;
+    double objective = -1;
+    GetMetric(options_.objective, &objective);
+    for (const auto& rule : options_.rules) {
+      bool holds = !rule.conditions.empty();
+      for (const auto& condition : rule.conditions) {
+        holds = holds && Holds(condition);
+      }
+      if (!holds) {
+        continue;
+      }
+      for (const auto& suggestion : rule.suggestions) {
+        auto bounds = options_.bounds.find(suggestion.option);
+        if (bounds == options_.bounds.end() ||
+            Blocked(suggestion.option, suggestion.action) ||
+            std::find_if(pending_.begin(), pending_.end(), [&](size_t i) {
+              return changes_[i].option == suggestion.option;
+            }) != pending_.end()) {
+          continue;
+        }
+        AutoTunerChange change;
+        bool db_option;
+        if (!GetOption(suggestion.option, &change.old_value, &db_option)) {
+          ROCKS_LOG_WARN(info_log_, "[AutoTuner] rule %s: unknown option %s",
+                         rule.name.c_str(), suggestion.option.c_str());
+          continue;
+        }
+        change.new_value =
+            Step(change.old_value, bounds->second, suggestion.action);
+        if (change.new_value.empty()) {
+          continue;
+        }
+        Status s = SetOption(suggestion.option, change.new_value, db_option);
+        if (!s.ok()) {
+          ROCKS_LOG_WARN(info_log_, "[AutoTuner] rule %s: setting %s to %s: %s",
+                         rule.name.c_str(), suggestion.option.c_str(),
+                         change.new_value.c_str(), s.ToString().c_str());
+          if (result.ok()) {
+            result = s;
+          }
+          continue;
+        }
+        change.rule = rule.name;
+        change.option = suggestion.option;
+        change.objective_before = objective;
+        ROCKS_LOG_INFO(info_log_,
+                       "[AutoTuner] rule %s: %s %s -> %s, %s %.1f before",
+                       rule.name.c_str(), change.option.c_str(),
+                       change.old_value.c_str(), change.new_value.c_str(),
+                       options_.objective.c_str(), objective);
+        pending_.push_back(changes_.size());
+        changes_.push_back(std::move(change));
+      }
+    }
+    return result;
+  }
+
+  Status MeasurePendingChanges() {
+    Status result;
+    double objective = -1;
+    GetMetric(options_.objective, &objective);
+    for (size_t i : pending_) {
+      AutoTunerChange& change = changes_[i];
+      change.objective_after = objective;
+      ROCKS_LOG_INFO(info_log_,
+                     "[AutoTuner] rule %s: %s %s -> %s, %s %.1f -> %.1f",
+                     change.rule.c_str(), change.option.c_str(),
+                     change.old_value.c_str(), change.new_value.c_str(),
+                     options_.objective.c_str(), change.objective_before,
+                     objective);
+      if (options_.revert_threshold <= 0 || change.objective_before <= 0 ||
+          objective < 0 ||
+          objective >=
+              change.objective_before * (1 - options_.revert_threshold)) {
+        continue;
+      }
+      std::string value;
+      bool db_option;
+      Status s;
+      if (!GetOption(change.option, &value, &db_option)) {
+        s = Status::NotFound("option", change.option);
+      } else {
+        s = SetOption(change.option, change.old_value, db_option);
+      }
+      if (!s.ok()) {
+        ROCKS_LOG_WARN(info_log_, "[AutoTuner] reverting %s to %s: %s",
+                       change.option.c_str(), change.old_value.c_str(),
+                       s.ToString().c_str());
+        if (result.ok()) {
+          result = s;
+        }
+        continue;
+      }
+      change.reverted = true;
+      double old_number, new_number;
+      bool integer;
+      if (ParseNumber(change.old_value, &old_number, &integer) &&
+          ParseNumber(change.new_value, &new_number, &integer)) {
+        reverted_[change.option] = {new_number > old_number
+                                        ? AutoTunerSuggestion::kIncrease
+                                        : AutoTunerSuggestion::kDecrease,
+                                    evaluations_};
+      }
+      ROCKS_LOG_INFO(info_log_, "[AutoTuner] reverted %s to %s",
+                     change.option.c_str(), change.old_value.c_str());
+    }
+    pending_.clear();
+    return result;
+  }
+
+  struct Reverted {
+    AutoTunerSuggestion::Action action;
+    uint64_t evaluation;
+  };
+
+  DB* const db_;
+  const AutoTunerOptions options_;
+  ColumnFamilyHandle* const column_family_;
+  Env* const env_;
+  std::shared_ptr<Logger> info_log_;
+  std::shared_ptr<Statistics> statistics_;
+  std::unordered_map<std::string, uint32_t> tickers_;
+
+  // Held by an evaluation, guards the state below
+  mutable port::Mutex evaluate_mutex_;
+  uint64_t evaluations_ = 0;
+  uint64_t now_micros_ = 0;
+  uint64_t last_micros_ = 0;
+  std::unordered_map<uint32_t, uint64_t> ticker_values_;
+  std::unordered_map<uint32_t, uint64_t> last_ticker_values_;
+  std::vector<AutoTunerChange> changes_;
+  // The changes in changes_ whose effect is not measured yet
+  std::vector<size_t> pending_;
+  std::unordered_map<std::string, Reverted> reverted_;
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  bool stop_ = false;
+  port::Thread thread_;
+};
+
+}  // namespace
+
+std::vector<AutoTunerRule> DefaultAutoTunerRules() {
+  const auto kGreater = AutoTunerCondition::kGreater;
+  const auto kLess = AutoTunerCondition::kLess;
+  const auto kIncrease = AutoTunerSuggestion::kIncrease;
+  const auto kDecrease = AutoTunerSuggestion::kDecrease;
+  // Writes stalled for more than 1% of the time
+  const AutoTunerCondition stalled =
+      Condition("rocksdb.stall.micros", kGreater, 10000);
+
+  std::vector<AutoTunerRule> rules;
+  rules.push_back({"stall-too-many-memtables",
+                   {stalled, Condition(DB::Properties::kNumImmutableMemTable,
+                                       kGreater, 1)},
+                   {Suggestion("write_buffer_size", kIncrease),
+                    Suggestion("max_write_buffer_number", kIncrease)}});
+  rules.push_back(
+      {"stall-compaction-behind",
+       {stalled, Condition(DB::Properties::kCompactionPending, kGreater, 0)},
+       {Suggestion("max_subcompactions", kIncrease),
+        Suggestion("max_background_jobs", kIncrease)}});
+  rules.push_back({"too-many-pending-compaction-bytes",
+                   {Condition(DB::Properties::kEstimatePendingCompactionBytes,
+                              kGreater, 64.0 * (1ull << 30))},
+                   {Suggestion("max_subcompactions", kIncrease),
+                    Suggestion("max_background_jobs", kIncrease)}});
+  // The blob files hold more than twice the live data, or hardly any garbage
+  rules.push_back({"blob-space-amp-high",
+                   {Condition(DB::Properties::kTotalSstFilesSize, kGreater, 2,
+                              DB::Properties::kEstimateLiveDataSize)},
+                   {Suggestion("blob_gc_ratio", kDecrease),
+                    Suggestion("max_background_garbage_collections",
+                               kIncrease)}});
+  rules.push_back({"blob-space-amp-low",
+                   {Condition(DB::Properties::kTotalSstFilesSize, kLess, 1.2,
+                              DB::Properties::kEstimateLiveDataSize)},
+                   {Suggestion("blob_gc_ratio", kIncrease),
+                    Suggestion("max_background_garbage_collections",
+                               kDecrease)}});
+  // Zone GC reclaims zones with less garbage when free zones run short, and
+  // spares the migrations while they are plenty
+  rules.push_back({"zenfs-free-space-low",
+                   {Condition(DB::Properties::kZenFSFreeBytes, kLess, 0.2,
+                              DB::Properties::kZenFSCapacityBytes)},
+                   {Suggestion("zenfs_low_gc_ratio", kDecrease),
+                    Suggestion("zenfs_high_gc_ratio", kDecrease),
+                    Suggestion("max_background_garbage_collections",
+                               kIncrease)}});
+  rules.push_back({"zenfs-free-space-high",
+                   {Condition(DB::Properties::kZenFSFreeBytes, kGreater, 0.5,
+                              DB::Properties::kZenFSCapacityBytes)},
+                   {Suggestion("zenfs_low_gc_ratio", kIncrease),
+                    Suggestion("zenfs_high_gc_ratio", kIncrease)}});
+  return rules;
+}
+
+Status NewAutoTuner(DB* db, const AutoTunerOptions& options,
+                    std::unique_ptr<AutoTuner>* tuner) {
+  if (db == nullptr || tuner == nullptr) {
+    return Status::InvalidArgument("db and tuner are required");
+  }
+  for (const auto& bounds : options.bounds) {
+    if (bounds.second.min > bounds.second.max ||
+        bounds.second.factor <= 1) {
+      return Status::InvalidArgument("bad auto tuner bounds", bounds.first);
+    }
+  }
+  tuner->reset(new AutoTunerImpl(db, options));
+  return Status::OK();
+}
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // ROCKSDB_LITE
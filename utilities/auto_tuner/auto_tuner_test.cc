@@ -0,0 +1,106 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "rocksdb/utilities/auto_tuner.h"
+
+#include "db/db_test_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class AutoTunerTest : public DBTestBase {
+ public:
+  AutoTunerTest() : DBTestBase("/auto_tuner_test") {}
+};
+
+TEST_F(AutoTunerTest, ChangesWithinBounds) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 1 << 20;
+  options.max_background_jobs = 2;
+  Reopen(options);
+
+  AutoTunerOptions tuner_options;
+  tuner_options.period_sec = 0;
+  tuner_options.objective = DB::Properties::kNumEntriesActiveMemTable;
+  tuner_options.rules = {
+      {"always",
+       {{DB::Properties::kNumImmutableMemTable, "", AutoTunerCondition::kLess,
+         1}},
+       {{"write_buffer_size", AutoTunerSuggestion::kIncrease},
+        {"max_background_jobs", AutoTunerSuggestion::kIncrease},
+        {"level0_file_num_compaction_trigger",
+         AutoTunerSuggestion::kIncrease}}}};
+  tuner_options.bounds["write_buffer_size"] = {1 << 20, 2 << 20, 1.5};
+  tuner_options.bounds["max_background_jobs"] = {1, 4, 1.25};
+  std::unique_ptr<AutoTuner> tuner;
+  ASSERT_OK(NewAutoTuner(db_, tuner_options, &tuner));
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_OK(Put(Key(i), "value"));
+  }
+
+  // Only the options with bounds are changed
+  ASSERT_OK(tuner->EvaluateOnce());
+  auto changes = tuner->GetChanges();
+  ASSERT_EQ(2U, changes.size());
+  ASSERT_EQ("write_buffer_size", changes[0].option);
+  ASSERT_EQ("1572864", changes[0].new_value);
+  ASSERT_EQ("max_background_jobs", changes[1].option);
+  ASSERT_EQ("3", changes[1].new_value);
+  ASSERT_EQ(100, changes[0].objective_before);
+  ASSERT_EQ(1572864U, db_->GetOptions().write_buffer_size);
+  ASSERT_EQ(3, db_->GetDBOptions().max_background_jobs);
+
+  // The effect is measured before the next change
+  ASSERT_OK(tuner->EvaluateOnce());
+  changes = tuner->GetChanges();
+  ASSERT_EQ(2U, changes.size());
+  ASSERT_EQ(100, changes[0].objective_after);
+  ASSERT_FALSE(changes[0].reverted);
+
+  // Up to the bounds
+  ASSERT_OK(tuner->EvaluateOnce());
+  changes = tuner->GetChanges();
+  ASSERT_EQ(4U, changes.size());
+  ASSERT_EQ("2097152", changes[2].new_value);
+  ASSERT_EQ("4", changes[3].new_value);
+
+  // Undone when the objective drops
+  ASSERT_OK(Flush());
+  ASSERT_OK(tuner->EvaluateOnce());
+  changes = tuner->GetChanges();
+  ASSERT_EQ(0, changes[2].objective_after);
+  ASSERT_TRUE(changes[2].reverted);
+  ASSERT_TRUE(changes[3].reverted);
+  ASSERT_EQ(1572864U, db_->GetOptions().write_buffer_size);
+  ASSERT_EQ(3, db_->GetDBOptions().max_background_jobs);
+
+  // And not made again for a while
+  ASSERT_OK(tuner->EvaluateOnce());
+  ASSERT_EQ(4U, tuner->GetChanges().size());
+  tuner.reset();
+
+  tuner_options.bounds["max_background_jobs"] = {4, 1, 1.25};
+  ASSERT_TRUE(NewAutoTuner(db_, tuner_options, &tuner).IsInvalidArgument());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+#else
+#include <stdio.h>
+
+int main(int /*argc*/, char** /*argv*/) {
+  fprintf(stderr, "SKIPPED as AutoTuner is not supported in ROCKSDB_LITE\n");
+  return 0;
+}
+
+#endif  // !ROCKSDB_LITE
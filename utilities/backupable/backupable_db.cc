@@ -22,6 +22,7 @@
 #include "util/logging.h"
 #include "util/string_util.h"
 #include "util/sync_point.h"
+#include "util/xxhash.h"
 #include "utilities/checkpoint/checkpoint_impl.h"
 
 #ifndef __STDC_FORMAT_MACROS
@@ -33,6 +34,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <future>
 #include <limits>
@@ -86,8 +88,100 @@ void BackupableDBOptions::Dump(Logger* logger) const {
                  restore_rate_limit);
   ROCKS_LOG_INFO(logger, "Options.max_background_operations: %d",
                  max_background_operations);
+  ROCKS_LOG_INFO(logger, "Options.chunked_table_file_min_size: %" PRIu64,
+                 chunked_table_file_min_size);
+  ROCKS_LOG_INFO(logger, "  Options.table_file_chunk_avg_size: %" PRIu64,
+                 table_file_chunk_avg_size);
 }
 
+namespace {
+// The random values of the gear hash, generated by splitmix64
+const uint64_t* GearTable() {
+  static const auto* table = [] {
+    auto* t = new uint64_t[256];
+    uint64_t x = 0;
+    for (size_t i = 0; i < 256; ++i) {
+      uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      t[i] = z ^ (z >> 31);
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Cuts a stream into content defined chunks with a gear rolling hash, so an
+// insertion or a deletion only changes the chunks around it. A chunk ends
+// where the low bits of the hash are all zero, within the size bounds.
+class ChunkCutter {
+ public:
+  explicit ChunkCutter(uint64_t avg_size) {
+    size_t bits = 12;
+    while (bits < 30 && (uint64_t(1) << (bits + 1)) <= avg_size) {
+      ++bits;
+    }
+    mask_ = (uint64_t(1) << bits) - 1;
+    min_size_ = size_t(1) << (bits - 2);
+    max_size_ = size_t(1) << (bits + 2);
+  }
+
+  size_t max_size() const { return max_size_; }
+
+  // Consume the bytes of `data` into the current chunk. Returns the number
+  // consumed, and sets `*cut` if the chunk ends there.
+  size_t Feed(const char* data, size_t n, bool* cut) {
+    const uint64_t* gear = GearTable();
+    size_t i = 0;
+    // The hash only depends on the last 64 bytes, so skip the bytes before
+    // the window ending at the minimum size
+    if (size_ + 64 < min_size_) {
+      size_t skip = std::min(n, min_size_ - 64 - size_);
+      i += skip;
+      size_ += skip;
+    }
+    *cut = false;
+    while (i < n) {
+      hash_ = (hash_ << 1) + gear[static_cast<uint8_t>(data[i++])];
+      ++size_;
+      if (size_ >= min_size_ && ((hash_ & mask_) == 0 || size_ >= max_size_)) {
+        *cut = true;
+        hash_ = 0;
+        size_ = 0;
+        break;
+      }
+    }
+    return i;
+  }
+
+ private:
+  uint64_t mask_;
+  size_t min_size_;
+  size_t max_size_;
+  uint64_t hash_ = 0;
+  size_t size_ = 0;
+};
+
+// Rate limiters refuse requests over a burst, and created files and chunks
+// are written in a single append
+void RequestInBursts(RateLimiter* rate_limiter, size_t bytes) {
+  const size_t burst = static_cast<size_t>(rate_limiter->GetSingleBurstBytes());
+  while (bytes > 0) {
+    size_t n = std::min(bytes, burst);
+    rate_limiter->Request(n, Env::IO_LOW, nullptr /* stats */,
+                          RateLimiter::OpType::kWrite);
+    bytes -= n;
+  }
+}
+
+bool IsChunkedFileRecipe(const std::string& file) {
+  static const std::string kSuffix = ".chunks";
+  return file.size() > kSuffix.size() &&
+         file.compare(file.size() - kSuffix.size(), kSuffix.size(), kSuffix) ==
+             0;
+}
+}  // namespace
+
 // -------- BackupEngineImpl class ---------
 class BackupEngineImpl : public BackupEngine {
  public:
@@ -266,6 +360,24 @@ class BackupEngineImpl : public BackupEngine {
                             "_" + TERARKDB_NAMESPACE::ToString(checksum_value) +
                                 "_" + TERARKDB_NAMESPACE::ToString(file_size));
   }
+  inline std::string GetSharedChunkDirRel() const { return "shared_chunks"; }
+  inline std::string GetSharedChunkRel(const std::string& chunk = "",
+                                       bool tmp = false) const {
+    assert(chunk.size() == 0 || chunk[0] != '/');
+    return GetSharedChunkDirRel() + "/" + (tmp ? "." : "") + chunk +
+           (tmp ? ".tmp" : "");
+  }
+  // <xxh64>_<crc32>_<size>.chunk, named by the contents
+  inline std::string GetChunkName(const Slice& chunk,
+                                  uint32_t checksum_value) const {
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx",
+             static_cast<unsigned long long>(
+                 XXH64(chunk.data(), chunk.size(), 0)));
+    return std::string(hash) + "_" +
+           TERARKDB_NAMESPACE::ToString(checksum_value) + "_" +
+           TERARKDB_NAMESPACE::ToString(chunk.size()) + ".chunk";
+  }
   inline std::string GetFileFromChecksumFile(const std::string& file) const {
     assert(file.size() == 0 || file[0] != '/');
     std::string file_copy = file;
@@ -463,6 +575,26 @@ class BackupEngineImpl : public BackupEngine {
       std::function<void()> progress_callback = []() {},
       const std::string& contents = std::string());
 
+  // Adds the chunks of the table file fname in src_dir missing from the
+  // backups to the backup work queue, and the recipe listing all its chunks,
+  // which is stored as the private file <fname>.chunks
+  //
+  // Each line of a recipe is the relative path of a chunk, after a first line
+  // of "<file size> <crc32>" of the whole file.
+  Status AddChunkedBackupFileWorkItems(
+      std::unordered_set<std::string>& live_dst_paths,
+      std::vector<BackupAfterCopyOrCreateWorkItem>& backup_items_to_finish,
+      BackupID backup_id, const std::string& src_dir,
+      const std::string& fname,  // starts with "/"
+      const EnvOptions& src_env_options, RateLimiter* rate_limiter,
+      std::function<void()> progress_callback);
+
+  // Reassembles the file of the recipe in the backup dir into dst
+  Status RestoreChunkedFile(const std::string& recipe_path,
+                            const std::string& dst,
+                            uint32_t recipe_checksum_value,
+                            RateLimiter* rate_limiter);
+
   // backup state data
   BackupID latest_backup_id_;
   BackupID latest_valid_backup_id_;
@@ -481,6 +613,7 @@ class BackupEngineImpl : public BackupEngine {
   // directories
   std::unique_ptr<Directory> backup_directory_;
   std::unique_ptr<Directory> shared_directory_;
+  std::unique_ptr<Directory> shared_chunk_directory_;
   std::unique_ptr<Directory> meta_directory_;
   std::unique_ptr<Directory> private_directory_;
 
@@ -558,6 +691,10 @@ Status BackupEngineImpl::Initialize() {
         directories.emplace_back(GetAbsolutePath(GetSharedFileRel()),
                                  &shared_directory_);
       }
+      if (options_.chunked_table_file_min_size > 0) {
+        directories.emplace_back(GetAbsolutePath(GetSharedChunkRel()),
+                                 &shared_chunk_directory_);
+      }
     }
     directories.emplace_back(GetAbsolutePath(GetPrivateDirRel()),
                              &private_directory_);
@@ -626,8 +763,9 @@ Status BackupEngineImpl::Initialize() {
     }
   } else {  // Load data from storage
     std::unordered_map<std::string, uint64_t> abs_path_to_size;
-    for (const auto& rel_dir :
-         {GetSharedFileRel(), GetSharedFileWithChecksumRel()}) {
+    for (const auto& rel_dir : {GetSharedFileRel(),
+                                GetSharedFileWithChecksumRel(),
+                                GetSharedChunkRel()}) {
       const auto abs_dir = GetAbsolutePath(rel_dir);
       InsertPathnameToSizeBytes(abs_dir, backup_env_, &abs_path_to_size);
     }
@@ -826,7 +964,14 @@ Status BackupEngineImpl::CreateNewBackupWithMetadata(
               src_env_options = src_raw_env_options;
               break;
           }
-          if (st.ok()) {
+          if (st.ok() && type == kTableFile && options_.share_table_files &&
+              options_.chunked_table_file_min_size > 0 &&
+              size_bytes >= options_.chunked_table_file_min_size) {
+            st = AddChunkedBackupFileWorkItems(
+                live_dst_paths, backup_items_to_finish, new_backup_id,
+                src_dirname, fname, src_env_options, rate_limiter,
+                progress_callback);
+          } else if (st.ok()) {
             st = AddBackupFileWorkItem(
                 live_dst_paths, backup_items_to_finish, new_backup_id,
                 options_.share_table_files && type == kTableFile, src_dirname,
@@ -896,6 +1041,9 @@ Status BackupEngineImpl::CreateNewBackupWithMetadata(
     if (s.ok() && shared_directory_ != nullptr) {
       s = shared_directory_->Fsync();
     }
+    if (s.ok() && shared_chunk_directory_ != nullptr) {
+      s = shared_chunk_directory_->Fsync();
+    }
     if (s.ok() && backup_directory_ != nullptr) {
       s = backup_directory_->Fsync();
     }
@@ -1093,13 +1241,16 @@ Status BackupEngineImpl::RestoreDBFromBackup(
   }
   Status s;
   std::vector<RestoreAfterCopyOrCreateWorkItem> restore_items_to_finish;
+  // The recipes of the chunked files and their destinations
+  std::vector<std::pair<std::shared_ptr<FileInfo>, std::string>>
+      chunked_files;
   for (const auto& file_info : backup->GetFiles()) {
     const std::string& file = file_info->filename;
     std::string dst;
     // 1. extract the filename
     size_t slash = file.find_last_of('/');
-    // file will either be shared/<file>, shared_checksum/<file_crc32_size>
-    // or private/<number>/<file>
+    // file will either be shared/<file>, shared_checksum/<file_crc32_size>,
+    // shared_chunks/<chunk> or private/<number>/<file>
     assert(slash != std::string::npos);
     dst = file.substr(slash + 1);
 
@@ -1107,6 +1258,13 @@ Status BackupEngineImpl::RestoreDBFromBackup(
     // in this case the file is <number>_<checksum>_<size>.<type>
     if (file.substr(0, slash) == GetSharedChecksumDirRel()) {
       dst = GetFileFromChecksumFile(dst);
+    } else if (file.substr(0, slash) == GetSharedChunkDirRel()) {
+      // restored through the recipes
+      continue;
+    }
+    const bool chunked = IsChunkedFileRecipe(dst);
+    if (chunked) {
+      dst.resize(dst.size() - strlen(".chunks"));
     }
 
     // 2. find the filetype
@@ -1122,6 +1280,10 @@ Status BackupEngineImpl::RestoreDBFromBackup(
 
     ROCKS_LOG_INFO(options_.info_log, "Restoring %s to %s\n", file.c_str(),
                    dst.c_str());
+    if (chunked) {
+      chunked_files.emplace_back(file_info, dst);
+      continue;
+    }
     CopyOrCreateWorkItem copy_or_create_work_item(
         GetAbsolutePath(file), dst, "" /* contents */, backup_env_, db_env_,
         EnvOptions() /* src_env_options */, false, rate_limiter,
@@ -1133,6 +1295,15 @@ Status BackupEngineImpl::RestoreDBFromBackup(
     restore_items_to_finish.push_back(
         std::move(after_copy_or_create_work_item));
   }
+  // Reassemble the chunked files meanwhile
+  for (const auto& chunked_file : chunked_files) {
+    s = RestoreChunkedFile(GetAbsolutePath(chunked_file.first->filename),
+                           chunked_file.second,
+                           chunked_file.first->checksum_value, rate_limiter);
+    if (!s.ok()) {
+      break;
+    }
+  }
   Status item_status;
   for (auto& item : restore_items_to_finish) {
     item.result.wait();
@@ -1140,12 +1311,12 @@ Status BackupEngineImpl::RestoreDBFromBackup(
     item_status = result.status;
     // Note: It is possible that both of the following bad-status cases occur
     // during copying. But, we only return one status.
-    if (!item_status.ok()) {
+    if (!s.ok()) {
+      continue;
+    } else if (!item_status.ok()) {
       s = item_status;
-      break;
     } else if (item.checksum_value != result.checksum_value) {
       s = Status::Corruption("Checksum check failed");
-      break;
     }
   }
 
@@ -1174,8 +1345,9 @@ Status BackupEngineImpl::VerifyBackup(BackupID backup_id) {
   ROCKS_LOG_INFO(options_.info_log, "Verifying backup id %u\n", backup_id);
 
   std::unordered_map<std::string, uint64_t> curr_abs_path_to_size;
-  for (const auto& rel_dir : {GetPrivateFileRel(backup_id), GetSharedFileRel(),
-                              GetSharedFileWithChecksumRel()}) {
+  for (const auto& rel_dir :
+       {GetPrivateFileRel(backup_id), GetSharedFileRel(),
+        GetSharedFileWithChecksumRel(), GetSharedChunkRel()}) {
     const auto abs_dir = GetAbsolutePath(rel_dir);
     InsertPathnameToSizeBytes(abs_dir, backup_env_, &curr_abs_path_to_size);
   }
@@ -1263,8 +1435,7 @@ Status BackupEngineImpl::CopyOrCreateFile(
     }
     s = dest_writer->Append(data);
     if (rate_limiter != nullptr) {
-      rate_limiter->Request(data.size(), Env::IO_LOW, nullptr /* stats */,
-                            RateLimiter::OpType::kWrite);
+      RequestInBursts(rate_limiter, data.size());
     }
     if (processed_buffer_size > options_.callback_trigger_interval_size) {
       processed_buffer_size -= options_.callback_trigger_interval_size;
@@ -1411,6 +1582,197 @@ Status BackupEngineImpl::AddBackupFileWorkItem(
   return s;
 }
 
+// fname will always start with "/"
+Status BackupEngineImpl::AddChunkedBackupFileWorkItems(
+    std::unordered_set<std::string>& live_dst_paths,
+    std::vector<BackupAfterCopyOrCreateWorkItem>& backup_items_to_finish,
+    BackupID backup_id, const std::string& src_dir, const std::string& fname,
+    const EnvOptions& src_env_options, RateLimiter* rate_limiter,
+    std::function<void()> progress_callback) {
+  assert(!fname.empty() && fname[0] == '/');
+  std::unique_ptr<SequentialFile> src_file;
+  Status s =
+      db_env_->NewSequentialFile(src_dir + fname, &src_file, src_env_options);
+  if (!s.ok()) {
+    return s;
+  }
+  SequentialFileReader src_reader(std::move(src_file), src_dir + fname);
+  std::unique_ptr<char[]> buf(new char[copy_file_buffer_size_]);
+  ChunkCutter cutter(options_.table_file_chunk_avg_size);
+
+  // Bound the memory of the chunks queued for upload
+  const uint64_t max_bytes_in_flight =
+      static_cast<uint64_t>(std::max(options_.max_background_operations, 1)) *
+      2 * cutter.max_size();
+  std::deque<std::pair<size_t, size_t>> items_in_flight;
+  uint64_t bytes_in_flight = 0;
+
+  uint64_t file_size = 0;
+  uint32_t file_checksum_value = 0;
+  std::string chunk_paths;
+  size_t num_chunks = 0;
+  size_t num_new_chunks = 0;
+  std::string chunk;
+  auto add_chunk = [&]() -> Status {
+    uint32_t checksum_value = crc32c::Value(chunk.data(), chunk.size());
+    std::string name = GetChunkName(chunk, checksum_value);
+    std::string dst_relative = GetSharedChunkRel(name);
+    std::string final_dest_path = GetAbsolutePath(dst_relative);
+    chunk_paths.append(dst_relative).push_back('\n');
+    ++num_chunks;
+    if (live_dst_paths.find(final_dest_path) != live_dst_paths.end()) {
+      // repeated in this backup
+      chunk.clear();
+      return Status::OK();
+    }
+    live_dst_paths.insert(final_dest_path);
+
+    // chunks are named by their contents, so any complete one is good
+    bool need_to_copy =
+        backuped_file_infos_.find(dst_relative) == backuped_file_infos_.end();
+    if (need_to_copy) {
+      Status exist = backup_env_->FileExists(final_dest_path);
+      if (exist.ok()) {
+        need_to_copy = false;
+      } else if (!exist.IsNotFound()) {
+        return exist;
+      }
+    }
+    if (!need_to_copy) {
+      std::promise<CopyOrCreateResult> promise_result;
+      backup_items_to_finish.emplace_back(
+          promise_result.get_future(), true /* shared */, false, backup_env_,
+          "" /* dst_path_tmp */, final_dest_path, dst_relative);
+      CopyOrCreateResult result;
+      result.size = chunk.size();
+      result.checksum_value = checksum_value;
+      promise_result.set_value(std::move(result));
+      chunk.clear();
+      return Status::OK();
+    }
+
+    while (!items_in_flight.empty() &&
+           bytes_in_flight + chunk.size() > max_bytes_in_flight) {
+      backup_items_to_finish[items_in_flight.front().first].result.wait();
+      bytes_in_flight -= items_in_flight.front().second;
+      items_in_flight.pop_front();
+    }
+    items_in_flight.emplace_back(backup_items_to_finish.size(), chunk.size());
+    bytes_in_flight += chunk.size();
+    ++num_new_chunks;
+
+    std::string temp_dest_path = GetAbsolutePath(GetSharedChunkRel(name, true));
+    CopyOrCreateWorkItem copy_or_create_work_item(
+        "" /* src_path */, temp_dest_path, std::move(chunk), db_env_,
+        backup_env_, EnvOptions() /* src_env_options */, options_.sync,
+        rate_limiter, 0 /* size_limit */, progress_callback);
+    backup_items_to_finish.emplace_back(
+        copy_or_create_work_item.result.get_future(), true /* shared */,
+        true /* needed_to_copy */, backup_env_, temp_dest_path,
+        final_dest_path, dst_relative);
+    files_to_copy_or_create_.write(std::move(copy_or_create_work_item));
+    chunk.clear();
+    return Status::OK();
+  };
+
+  Slice data;
+  bool eof = false;
+  while (s.ok() && !eof) {
+    if (stop_backup_.load(std::memory_order_acquire)) {
+      return Status::Incomplete("Backup stopped");
+    }
+    s = src_reader.Read(copy_file_buffer_size_, &data, buf.get());
+    if (!s.ok()) {
+      break;
+    }
+    eof = data.empty();
+    file_size += data.size();
+    file_checksum_value =
+        crc32c::Extend(file_checksum_value, data.data(), data.size());
+    while (s.ok() && !data.empty()) {
+      bool cut;
+      size_t n = cutter.Feed(data.data(), data.size(), &cut);
+      chunk.append(data.data(), n);
+      data.remove_prefix(n);
+      if (cut) {
+        s = add_chunk();
+      }
+    }
+  }
+  if (s.ok() && !chunk.empty()) {
+    s = add_chunk();
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  ROCKS_LOG_INFO(options_.info_log,
+                 "%s cut into %" ROCKSDB_PRIszt " chunks, %" ROCKSDB_PRIszt
+                 " of them new",
+                 fname.c_str(), num_chunks, num_new_chunks);
+
+  std::string recipe = TERARKDB_NAMESPACE::ToString(file_size) + " " +
+                       TERARKDB_NAMESPACE::ToString(file_checksum_value) +
+                       "\n" + chunk_paths;
+  return AddBackupFileWorkItem(
+      live_dst_paths, backup_items_to_finish, backup_id, false /* shared */,
+      "" /* src_dir */, fname + ".chunks", EnvOptions() /* src_env_options */,
+      rate_limiter, recipe.size(), 0 /* size_limit */,
+      false /* shared_checksum */, progress_callback, recipe);
+}
+
+Status BackupEngineImpl::RestoreChunkedFile(const std::string& recipe_path,
+                                            const std::string& dst,
+                                            uint32_t recipe_checksum_value,
+                                            RateLimiter* rate_limiter) {
+  std::string recipe;
+  Status s = ReadFileToString(backup_env_, recipe_path, &recipe);
+  if (!s.ok()) {
+    return s;
+  }
+  if (crc32c::Value(recipe.data(), recipe.size()) != recipe_checksum_value) {
+    return Status::Corruption("Checksum check failed");
+  }
+  Slice input(recipe);
+  Slice header = GetSliceUntil(&input, '\n');
+  char* next;
+  uint64_t expected_size = strtoull(header.data(), &next, 10);
+  uint32_t expected_checksum_value =
+      static_cast<uint32_t>(strtoul(next, nullptr, 10));
+
+  EnvOptions dst_env_options;
+  dst_env_options.use_mmap_writes = false;
+  std::unique_ptr<WritableFile> dst_file;
+  s = db_env_->NewWritableFile(dst, &dst_file, dst_env_options);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFileWriter dest_writer(std::move(dst_file), dst, dst_env_options);
+  uint64_t size = 0;
+  uint32_t checksum_value = 0;
+  std::string chunk;
+  while (s.ok() && !input.empty()) {
+    std::string chunk_path = GetSliceUntil(&input, '\n').ToString();
+    s = ReadFileToString(backup_env_, GetAbsolutePath(chunk_path), &chunk);
+    if (s.ok()) {
+      size += chunk.size();
+      checksum_value =
+          crc32c::Extend(checksum_value, chunk.data(), chunk.size());
+      s = dest_writer.Append(chunk);
+    }
+    if (s.ok() && rate_limiter != nullptr) {
+      RequestInBursts(rate_limiter, chunk.size());
+    }
+  }
+  if (s.ok()) {
+    s = dest_writer.Close();
+  }
+  if (s.ok() &&
+      (size != expected_size || checksum_value != expected_checksum_value)) {
+    s = Status::Corruption("Checksum check failed");
+  }
+  return s;
+}
+
 Status BackupEngineImpl::CalculateChecksum(const std::string& src, Env* src_env,
                                            const EnvOptions& src_env_options,
                                            uint64_t size_limit,
@@ -1500,44 +1862,40 @@ Status BackupEngineImpl::GarbageCollect() {
 
   if (options_.share_table_files &&
       options_.max_valid_backups_to_open == port::kMaxInt32) {
-    // delete obsolete shared files
+    // delete obsolete shared files and chunks
     // we cannot do this when BackupEngine has `max_valid_backups_to_open` set
     // as those engines don't know about all shared files.
-    std::vector<std::string> shared_children;
-    {
-      std::string shared_path;
-      if (options_.share_files_with_checksum) {
-        shared_path = GetAbsolutePath(GetSharedFileWithChecksumRel());
-      } else {
-        shared_path = GetAbsolutePath(GetSharedFileRel());
-      }
-      auto s = backup_env_->FileExists(shared_path);
-      if (s.ok()) {
-        s = backup_env_->GetChildren(shared_path, &shared_children);
-      } else if (s.IsNotFound()) {
-        s = Status::OK();
-      }
-      if (!s.ok()) {
-        return s;
-      }
-    }
-    for (auto& child : shared_children) {
-      std::string rel_fname;
-      if (options_.share_files_with_checksum) {
-        rel_fname = GetSharedFileWithChecksumRel(child);
-      } else {
-        rel_fname = GetSharedFileRel(child);
+    const std::string shared_rel_dirs[] = {
+        options_.share_files_with_checksum ? GetSharedFileWithChecksumRel()
+                                           : GetSharedFileRel(),
+        GetSharedChunkRel()};
+    for (const auto& shared_rel_dir : shared_rel_dirs) {
+      std::vector<std::string> shared_children;
+      {
+        std::string shared_path = GetAbsolutePath(shared_rel_dir);
+        auto s = backup_env_->FileExists(shared_path);
+        if (s.ok()) {
+          s = backup_env_->GetChildren(shared_path, &shared_children);
+        } else if (s.IsNotFound()) {
+          s = Status::OK();
+        }
+        if (!s.ok()) {
+          return s;
+        }
       }
-      auto child_itr = backuped_file_infos_.find(rel_fname);
-      // if it's not refcounted, delete it
-      if (child_itr == backuped_file_infos_.end() ||
-          child_itr->second->refs == 0) {
-        // this might be a directory, but DeleteFile will just fail in that
-        // case, so we're good
-        Status s = backup_env_->DeleteFile(GetAbsolutePath(rel_fname));
-        ROCKS_LOG_INFO(options_.info_log, "Deleting %s -- %s",
-                       rel_fname.c_str(), s.ToString().c_str());
-        backuped_file_infos_.erase(rel_fname);
+      for (auto& child : shared_children) {
+        std::string rel_fname = shared_rel_dir + child;
+        auto child_itr = backuped_file_infos_.find(rel_fname);
+        // if it's not refcounted, delete it
+        if (child_itr == backuped_file_infos_.end() ||
+            child_itr->second->refs == 0) {
+          // this might be a directory, but DeleteFile will just fail in that
+          // case, so we're good
+          Status s = backup_env_->DeleteFile(GetAbsolutePath(rel_fname));
+          ROCKS_LOG_INFO(options_.info_log, "Deleting %s -- %s",
+                         rel_fname.c_str(), s.ToString().c_str());
+          backuped_file_infos_.erase(rel_fname);
+        }
       }
     }
   }
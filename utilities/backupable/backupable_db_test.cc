@@ -1235,6 +1235,41 @@ TEST_F(BackupableDBTest, ShareTableFilesWithChecksumsTransition) {
   }
 }
 
+// Verify that table files backed up as chunks restore, and that chunks are
+// shared between backups
+TEST_F(BackupableDBTest, ChunkedTableFiles) {
+  const int keys_iteration = 5000;
+  backupable_options_->chunked_table_file_min_size = 1;
+  backupable_options_->table_file_chunk_avg_size = 4096;
+  OpenDBAndBackupEngine(true);
+  std::vector<std::string> chunks;
+  for (int i = 0; i < 5; ++i) {
+    FillDB(db_.get(), keys_iteration * i, keys_iteration * (i + 1));
+    ASSERT_OK(backup_engine_->CreateNewBackup(db_.get(), true));
+  }
+  ASSERT_OK(file_manager_->GetChildren(backupdir_ + "/shared_chunks", &chunks));
+  ASSERT_GT(chunks.size(), 0U);
+  // Nothing changed, so no chunk is uploaded
+  ASSERT_OK(backup_engine_->CreateNewBackup(db_.get(), false));
+  std::vector<std::string> chunks_after;
+  ASSERT_OK(
+      file_manager_->GetChildren(backupdir_ + "/shared_chunks", &chunks_after));
+  ASSERT_EQ(chunks.size(), chunks_after.size());
+  ASSERT_OK(backup_engine_->VerifyBackup(6));
+  CloseDBAndBackupEngine();
+
+  for (int i = 0; i < 5; ++i) {
+    AssertBackupConsistency(i + 1, 0, keys_iteration * (i + 1),
+                            keys_iteration * 6);
+  }
+
+  OpenBackupEngine();
+  ASSERT_OK(backup_engine_->PurgeOldBackups(1));
+  ASSERT_OK(backup_engine_->GarbageCollect());
+  CloseBackupEngine();
+  AssertBackupConsistency(0, 0, keys_iteration * 5, keys_iteration * 6);
+}
+
 TEST_F(BackupableDBTest, DeleteTmpFiles) {
   for (bool shared_checksum : {false, true}) {
     if (shared_checksum) {
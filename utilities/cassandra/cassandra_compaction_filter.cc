@@ -28,15 +28,15 @@ CompactionFilter::Decision CassandraCompactionFilter::FilterV2(
     new_value->reset(std::move(s));
     return Decision::kChangeValue;
   }
-  RowValue row_value =
-      RowValue::Deserialize(existing_value.data(), existing_value.size());
-  RowValue compacted =
-      purge_ttl_on_expiration_
-          ? row_value.RemoveExpiredColumns(&value_changed)
-          : row_value.ConvertExpiredColumnsToTombstones(&value_changed);
+  FlatRowValue compacted(existing_value.data(), existing_value.size());
+  if (purge_ttl_on_expiration_) {
+    compacted.RemoveExpiredColumns(&value_changed);
+  } else {
+    compacted.ConvertExpiredColumnsToTombstones(&value_changed);
+  }
 
   if (value_type == ValueType::kValue) {
-    compacted = compacted.RemoveTombstones(gc_grace_period_in_seconds_);
+    compacted.RemoveTombstones(gc_grace_period_in_seconds_);
   }
 
   if (compacted.Empty()) {
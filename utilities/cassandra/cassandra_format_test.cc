@@ -362,6 +362,62 @@ TEST(RowValueTest, ExpireTtlShouldConvertExpiredColumnsToTombstones) {
   compacted.ConvertExpiredColumnsToTombstones(&changed);
   EXPECT_FALSE(changed);
 }
+
+TEST(RowValueTest, FlatRowValueShouldCollectAsRowValue) {
+  int64_t now = time(nullptr);
+
+  auto row_value = CreateTestRowValue(
+      {CreateTestColumnSpec(kColumn, 0, ToMicroSeconds(now)),
+       CreateTestColumnSpec(kExpiringColumn, 1,
+                            ToMicroSeconds(now - kTtl - 10)),  // expired
+       CreateTestColumnSpec(kExpiringColumn, 2,
+                            ToMicroSeconds(now)),  // not expired
+       CreateTestColumnSpec(kTombstone, 3, ToMicroSeconds(now)),
+       CreateTestColumnSpec(kTombstone, 4,
+                            ToMicroSeconds(now - 20))});  // collectable
+  std::string src;
+  row_value.Serialize(&src);
+
+  bool changed = false;
+  bool flat_changed = false;
+  std::string expected;
+  std::string actual;
+  FlatRowValue purged(src.data(), src.size());
+  EXPECT_EQ(row_value.Size(), purged.Size());
+  EXPECT_EQ(row_value.LastModifiedTime(), purged.LastModifiedTime());
+  purged.RemoveExpiredColumns(&flat_changed);
+  row_value.RemoveExpiredColumns(&changed).Serialize(&expected);
+  purged.Serialize(&actual);
+  EXPECT_TRUE(flat_changed);
+  EXPECT_EQ(changed, flat_changed);
+  EXPECT_EQ(expected, actual);
+  purged.RemoveExpiredColumns(&flat_changed);
+  EXPECT_FALSE(flat_changed);
+
+  FlatRowValue compacted(src.data(), src.size());
+  compacted.ConvertExpiredColumnsToTombstones(&flat_changed);
+  EXPECT_TRUE(flat_changed);
+  EXPECT_EQ(compacted.columns().size(), 5u);
+  EXPECT_EQ(compacted.columns()[1].mask, kTombstone);
+  EXPECT_EQ(compacted.columns()[1].timestamp, ToMicroSeconds(now - 10));
+  expected.clear();
+  actual.clear();
+  row_value.ConvertExpiredColumnsToTombstones(&changed).Serialize(&expected);
+  compacted.Serialize(&actual);
+  EXPECT_EQ(expected, actual);
+  compacted.ConvertExpiredColumnsToTombstones(&flat_changed);
+  EXPECT_FALSE(flat_changed);
+
+  compacted.RemoveTombstones(15);
+  EXPECT_EQ(compacted.columns().size(), 4u);
+  expected.clear();
+  actual.clear();
+  row_value.ConvertExpiredColumnsToTombstones(&changed)
+      .RemoveTombstones(15)
+      .Serialize(&expected);
+  compacted.Serialize(&actual);
+  EXPECT_EQ(expected, actual);
+}
 }  // namespace cassandra
 }  // namespace TERARKDB_NAMESPACE
 
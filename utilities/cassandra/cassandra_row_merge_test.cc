@@ -87,6 +87,68 @@ TEST(RowValueMergeTest, MergeWithRowTombstone) {
   EXPECT_EQ(merged.LastModifiedTime(), 17);
 }
 
+TEST(RowValueMergeTest, FlatMerge) {
+  auto serialize = [](const RowValue& row_value) {
+    std::string dest;
+    row_value.Serialize(&dest);
+    return dest;
+  };
+  std::vector<std::string> rows;
+  rows.push_back(serialize(CreateTestRowValue({
+      CreateTestColumnSpec(kTombstone, 0, 5),
+      CreateTestColumnSpec(kColumn, 1, 8),
+      CreateTestColumnSpec(kExpiringColumn, 2, 5),
+  })));
+  rows.push_back(serialize(CreateTestRowValue({
+      CreateTestColumnSpec(kColumn, 0, 2),
+      CreateTestColumnSpec(kExpiringColumn, 1, 5),
+      CreateTestColumnSpec(kTombstone, 2, 7),
+      CreateTestColumnSpec(kExpiringColumn, 7, 17),
+  })));
+  // Not sorted by index
+  rows.push_back(serialize(CreateTestRowValue({
+      CreateTestColumnSpec(kTombstone, 11, 11),
+      CreateTestColumnSpec(kColumn, 2, 4),
+      CreateTestColumnSpec(kExpiringColumn, 0, 6),
+      CreateTestColumnSpec(kTombstone, 1, 5),
+  })));
+  rows.push_back(serialize(CreateRowTombstone(3)));
+  rows.push_back(serialize(CreateTestRowValue({
+      CreateTestColumnSpec(kColumn, 12, 2),
+  })));
+
+  // The same as RowValue::Merge() of the first n rows
+  for (size_t n = 1; n <= rows.size(); ++n) {
+    std::vector<RowValue> row_values;
+    std::vector<FlatRowValue> flat_row_values;
+    for (size_t i = 0; i < n; ++i) {
+      row_values.push_back(
+          RowValue::Deserialize(rows[i].data(), rows[i].size()));
+      flat_row_values.emplace_back(rows[i].data(), rows[i].size());
+    }
+    RowValue merged = RowValue::Merge(std::move(row_values));
+    FlatRowValue flat_merged;
+    FlatRowValue::Merge(&flat_row_values, &flat_merged);
+    EXPECT_EQ(merged.IsTombstone(), flat_merged.IsTombstone());
+    EXPECT_EQ(merged.LastModifiedTime(), flat_merged.LastModifiedTime());
+    EXPECT_EQ(merged.Size(), flat_merged.Size());
+    std::string flat_dest;
+    flat_merged.Serialize(&flat_dest);
+    EXPECT_EQ(serialize(merged), flat_dest);
+  }
+
+  // If the tombstone's timestamp is the latest, then it returns a
+  // row tombstone.
+  std::string tombstone = serialize(CreateRowTombstone(20));
+  std::vector<FlatRowValue> flat_row_values;
+  flat_row_values.emplace_back(rows[0].data(), rows[0].size());
+  flat_row_values.emplace_back(tombstone.data(), tombstone.size());
+  FlatRowValue flat_merged;
+  FlatRowValue::Merge(&flat_row_values, &flat_merged);
+  EXPECT_TRUE(flat_merged.IsTombstone());
+  EXPECT_EQ(flat_merged.LastModifiedTime(), 20);
+}
+
 }  // namespace cassandra
 }  // namespace TERARKDB_NAMESPACE
 
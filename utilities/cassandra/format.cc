@@ -18,6 +18,19 @@ namespace cassandra {
 namespace {
 const int32_t kDefaultLocalDeletionTime = std::numeric_limits<int32_t>::max();
 const int64_t kDefaultMarkedForDeleteAt = std::numeric_limits<int64_t>::min();
+const std::size_t kTombstoneSize = sizeof(int8_t) * 2 + sizeof(int32_t) +
+                                   sizeof(int64_t);
+
+typedef std::chrono::time_point<std::chrono::system_clock> TimePoint;
+
+TimePoint ExpiredAt(const ColumnView& column) {
+  return TimePoint(std::chrono::microseconds(column.timestamp)) +
+         std::chrono::seconds(column.ttl_or_local_deletion_time);
+}
+
+bool IsExpiring(const ColumnView& column) {
+  return column.mask == ColumnTypeMask::EXPIRATION_MASK;
+}
 }  // namespace
 
 ColumnBase::ColumnBase(int8_t mask, int8_t index)
@@ -368,5 +381,230 @@ RowValue RowValue::Merge(std::vector<RowValue>&& values) {
   return RowValue(std::move(columns), last_modified_time);
 }
 
+FlatRowValue::FlatRowValue()
+    : local_deletion_time_(kDefaultLocalDeletionTime),
+      marked_for_delete_at_(kDefaultMarkedForDeleteAt),
+      last_modified_time_(0) {}
+
+FlatRowValue::FlatRowValue(const char* src, std::size_t size)
+    : last_modified_time_(0) {
+  std::size_t offset = 0;
+  assert(size >= sizeof(local_deletion_time_) + sizeof(marked_for_delete_at_));
+  local_deletion_time_ =
+      TERARKDB_NAMESPACE::cassandra::Deserialize<int32_t>(src, offset);
+  offset += sizeof(int32_t);
+  marked_for_delete_at_ =
+      TERARKDB_NAMESPACE::cassandra::Deserialize<int64_t>(src, offset);
+  offset += sizeof(int64_t);
+  if (offset == size) {
+    return;
+  }
+
+  assert(local_deletion_time_ == kDefaultLocalDeletionTime);
+  assert(marked_for_delete_at_ == kDefaultMarkedForDeleteAt);
+  bool sorted = true;
+  while (offset < size) {
+    ColumnView column;
+    column.data = src + offset;
+    column.mask =
+        TERARKDB_NAMESPACE::cassandra::Deserialize<int8_t>(src, offset);
+    offset += sizeof(int8_t);
+    column.index =
+        TERARKDB_NAMESPACE::cassandra::Deserialize<int8_t>(src, offset);
+    offset += sizeof(int8_t);
+    column.ttl_or_local_deletion_time = 0;
+    if ((column.mask & ColumnTypeMask::DELETION_MASK) != 0) {
+      column.ttl_or_local_deletion_time =
+          TERARKDB_NAMESPACE::cassandra::Deserialize<int32_t>(src, offset);
+      offset += sizeof(int32_t);
+      column.timestamp =
+          TERARKDB_NAMESPACE::cassandra::Deserialize<int64_t>(src, offset);
+      offset += sizeof(int64_t);
+    } else {
+      column.timestamp =
+          TERARKDB_NAMESPACE::cassandra::Deserialize<int64_t>(src, offset);
+      offset += sizeof(int64_t);
+      int32_t value_size =
+          TERARKDB_NAMESPACE::cassandra::Deserialize<int32_t>(src, offset);
+      offset += sizeof(int32_t) + value_size;
+      if ((column.mask & ColumnTypeMask::EXPIRATION_MASK) != 0) {
+        column.ttl_or_local_deletion_time =
+            TERARKDB_NAMESPACE::cassandra::Deserialize<int32_t>(src, offset);
+        offset += sizeof(int32_t);
+      }
+    }
+    column.size = static_cast<uint32_t>(src + offset - column.data);
+    assert(offset <= size);
+    last_modified_time_ = std::max(last_modified_time_, column.timestamp);
+    if (!columns_.empty() && columns_.back().index > column.index) {
+      sorted = false;
+    }
+    columns_.push_back(column);
+  }
+  if (!sorted) {
+    std::stable_sort(columns_.begin(), columns_.end(),
+                     [](const ColumnView& a, const ColumnView& b) {
+                       return a.index < b.index;
+                     });
+  }
+}
+
+std::size_t FlatRowValue::Size() const {
+  std::size_t size =
+      sizeof(local_deletion_time_) + sizeof(marked_for_delete_at_);
+  for (const auto& column : columns_) {
+    size += column.size;
+  }
+  return size;
+}
+
+bool FlatRowValue::IsTombstone() const {
+  return marked_for_delete_at_ > kDefaultMarkedForDeleteAt;
+}
+
+int64_t FlatRowValue::LastModifiedTime() const {
+  if (IsTombstone()) {
+    return marked_for_delete_at_;
+  } else {
+    return last_modified_time_;
+  }
+}
+
+void FlatRowValue::Serialize(std::string* dest) const {
+  TERARKDB_NAMESPACE::cassandra::Serialize<int32_t>(local_deletion_time_, dest);
+  TERARKDB_NAMESPACE::cassandra::Serialize<int64_t>(marked_for_delete_at_,
+                                                    dest);
+  for (const auto& column : columns_) {
+    if (column.data != nullptr) {
+      dest->append(column.data, column.size);
+      continue;
+    }
+    TERARKDB_NAMESPACE::cassandra::Serialize<int8_t>(column.mask, dest);
+    TERARKDB_NAMESPACE::cassandra::Serialize<int8_t>(column.index, dest);
+    TERARKDB_NAMESPACE::cassandra::Serialize<int32_t>(
+        column.ttl_or_local_deletion_time, dest);
+    TERARKDB_NAMESPACE::cassandra::Serialize<int64_t>(column.timestamp, dest);
+  }
+}
+
+void FlatRowValue::RemoveExpiredColumns(bool* changed) {
+  auto now = std::chrono::system_clock::now();
+  auto end = std::remove_if(columns_.begin(), columns_.end(),
+                            [now](const ColumnView& column) {
+                              return IsExpiring(column) &&
+                                     ExpiredAt(column) < now;
+                            });
+  *changed = end != columns_.end();
+  columns_.erase(end, columns_.end());
+}
+
+void FlatRowValue::ConvertExpiredColumnsToTombstones(bool* changed) {
+  *changed = false;
+  auto now = std::chrono::system_clock::now();
+  for (auto& column : columns_) {
+    if (!IsExpiring(column)) {
+      continue;
+    }
+    auto expired_at = ExpiredAt(column);
+    if (expired_at < now) {
+      auto since_epoch = expired_at.time_since_epoch();
+      column.mask = static_cast<int8_t>(ColumnTypeMask::DELETION_MASK);
+      column.ttl_or_local_deletion_time = static_cast<int32_t>(
+          std::chrono::duration_cast<std::chrono::seconds>(since_epoch)
+              .count());
+      column.timestamp =
+          std::chrono::duration_cast<std::chrono::microseconds>(since_epoch)
+              .count();
+      column.size = static_cast<uint32_t>(kTombstoneSize);
+      column.data = nullptr;
+      *changed = true;
+    }
+  }
+}
+
+void FlatRowValue::RemoveTombstones(int32_t gc_grace_period) {
+  auto now = std::chrono::system_clock::now();
+  auto grace = std::chrono::seconds(gc_grace_period);
+  auto end = std::remove_if(
+      columns_.begin(), columns_.end(), [now, grace](const ColumnView& column) {
+        return column.mask == ColumnTypeMask::DELETION_MASK &&
+               TimePoint(std::chrono::seconds(
+                   column.ttl_or_local_deletion_time)) +
+                       grace <
+                   now;
+      });
+  columns_.erase(end, columns_.end());
+}
+
+void FlatRowValue::Merge(std::vector<FlatRowValue>* values,
+                         FlatRowValue* merged) {
+  assert(values->size() > 0);
+  if (values->size() == 1) {
+    *merged = std::move(values->front());
+    return;
+  }
+
+  // Merge columns by their last modified time, and skip once we hit
+  // a row tombstone.
+  std::stable_sort(values->begin(), values->end(),
+                   [](const FlatRowValue& a, const FlatRowValue& b) {
+                     return a.LastModifiedTime() > b.LastModifiedTime();
+                   });
+  int64_t tombstone_timestamp = 0;
+  std::size_t num_values = 0;
+  std::size_t num_columns = 0;
+  for (auto& value : *values) {
+    if (value.IsTombstone()) {
+      if (num_columns == 0) {
+        *merged = std::move(value);
+        return;
+      }
+      tombstone_timestamp = value.LastModifiedTime();
+      break;
+    }
+    num_columns += value.columns_.size();
+    ++num_values;
+  }
+
+  *merged = FlatRowValue();
+  merged->columns_.reserve(num_columns);
+  // The next column of each value, all values are sorted by index so the
+  // lowest index of them goes first. Of the columns of an index, the one with
+  // the greatest timestamp wins, or that of the latest value if they tie.
+  std::vector<std::size_t> next(num_values, 0);
+  for (;;) {
+    const ColumnView* winner = nullptr;
+    for (std::size_t i = 0; i < num_values; ++i) {
+      auto& columns = (*values)[i].columns_;
+      if (next[i] < columns.size() &&
+          (winner == nullptr || columns[next[i]].index < winner->index)) {
+        winner = &columns[next[i]];
+      }
+    }
+    if (winner == nullptr) {
+      break;
+    }
+    int8_t index = winner->index;
+    for (std::size_t i = 0; i < num_values; ++i) {
+      auto& columns = (*values)[i].columns_;
+      for (; next[i] < columns.size() && columns[next[i]].index == index;
+           ++next[i]) {
+        if (columns[next[i]].timestamp > winner->timestamp) {
+          winner = &columns[next[i]];
+        }
+      }
+    }
+    // For some row, its last_modified_time > row tombstone_timestamp, but
+    // it might have rows whose timestamp is ealier than tombstone, so we
+    // ned to filter these rows.
+    if (winner->timestamp <= tombstone_timestamp) {
+      continue;
+    }
+    merged->last_modified_time_ =
+        std::max(merged->last_modified_time_, winner->timestamp);
+    merged->columns_.push_back(*winner);
+  }
+}
+
 }  // namespace cassandra
 }  // namespace TERARKDB_NAMESPACE
@@ -57,6 +57,7 @@
 #pragma once
 #include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "rocksdb/merge_operator.h"
@@ -194,5 +195,52 @@ class RowValue {
               CompactionShouldRemoveTombstoneExceedingGCGracePeriod);
 };
 
+// A column of a serialized row, decoded in place
+struct ColumnView {
+  int8_t mask;
+  int8_t index;
+  // marked_for_delete_at of a tombstone
+  int64_t timestamp;
+  // local_deletion_time of a tombstone, ttl of an expiring column
+  int32_t ttl_or_local_deletion_time;
+  uint32_t size;
+  // The serialized column, nullptr for the tombstones of expired columns
+  const char* data;
+};
+
+// The flat counterpart of RowValue used by CassandraValueMergeOperator and
+// CassandraCompactionFilter. Its columns are an array of ColumnViews sorted
+// by index, which point into the serialized rows, so a row is decoded,
+// merged and garbage collected without allocations per column. The
+// serialized rows must outlive the FlatRowValue.
+class FlatRowValue {
+ public:
+  FlatRowValue();
+  FlatRowValue(const char* src, std::size_t size);
+
+  std::size_t Size() const;
+  bool IsTombstone() const;
+  // For Tombstone this returns the marked_for_delete_at_,
+  // otherwise it returns the max timestamp of containing columns.
+  int64_t LastModifiedTime() const;
+  void Serialize(std::string* dest) const;
+  // The same as those of RowValue, but in place
+  void RemoveExpiredColumns(bool* changed);
+  void ConvertExpiredColumnsToTombstones(bool* changed);
+  void RemoveTombstones(int32_t gc_grace_period);
+  bool Empty() const { return columns_.empty(); }
+  const std::vector<ColumnView>& columns() const { return columns_; }
+
+  // Merge multiple rows according to their timestamp, as RowValue::Merge(),
+  // by a single pass over their sorted columns
+  static void Merge(std::vector<FlatRowValue>* values, FlatRowValue* merged);
+
+ private:
+  int32_t local_deletion_time_;
+  int64_t marked_for_delete_at_;
+  std::vector<ColumnView> columns_;
+  int64_t last_modified_time_;
+};
+
 }  // namespace cassandra
 }  // namespace TERARKDB_NAMESPACE
@@ -24,24 +24,26 @@ bool CassandraValueMergeOperator::FullMergeV2(
     MergeOperationOutput* merge_out) const {
   // Clear the *new_value for writing.
   merge_out->new_value.clear();
-  std::vector<RowValue> row_values;
+  std::vector<FlatRowValue> row_values;
+  row_values.reserve(merge_in.operand_list.size() + 1);
   if (merge_in.existing_value) {
     if (!Fetch(*merge_in.existing_value, &merge_out->new_value)) {
       return true;
     }
-    row_values.push_back(RowValue::Deserialize(
-        merge_in.existing_value->data(), merge_in.existing_value->size()));
+    row_values.emplace_back(merge_in.existing_value->data(),
+                            merge_in.existing_value->size());
   }
 
   for (auto& operand : merge_in.operand_list) {
     if (!Fetch(operand, &merge_out->new_value)) {
       return true;
     }
-    row_values.push_back(RowValue::Deserialize(operand.data(), operand.size()));
+    row_values.emplace_back(operand.data(), operand.size());
   }
 
-  RowValue merged = RowValue::Merge(std::move(row_values));
-  merged = merged.RemoveTombstones(gc_grace_period_in_seconds_);
+  FlatRowValue merged;
+  FlatRowValue::Merge(&row_values, &merged);
+  merged.RemoveTombstones(gc_grace_period_in_seconds_);
 
   std::string* buffer = merge_out->new_value.trans_to_string();
   buffer->reserve(merged.Size());
@@ -57,14 +59,16 @@ bool CassandraValueMergeOperator::PartialMergeMulti(
   assert(new_value);
   new_value->clear();
 
-  std::vector<RowValue> row_values;
+  std::vector<FlatRowValue> row_values;
+  row_values.reserve(operand_list.size());
   for (auto& operand : operand_list) {
     if (!Fetch(operand, new_value)) {
       return true;
     }
-    row_values.push_back(RowValue::Deserialize(operand.data(), operand.size()));
+    row_values.emplace_back(operand.data(), operand.size());
   }
-  RowValue merged = RowValue::Merge(std::move(row_values));
+  FlatRowValue merged;
+  FlatRowValue::Merge(&row_values, &merged);
 
   std::string* buffer = new_value->trans_to_string();
   buffer->reserve(merged.Size());
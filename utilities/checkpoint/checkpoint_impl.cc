@@ -30,6 +30,7 @@
 #include "rocksdb/utilities/checkpoint.h"
 #include "util/file_util.h"
 #include "util/filename.h"
+#include "util/string_util.h"
 #include "util/sync_point.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -44,6 +45,17 @@ Status Checkpoint::CreateCheckpoint(const std::string& /*checkpoint_dir*/,
   return Status::NotSupported("");
 }
 
+Status Checkpoint::CreateReferenceCheckpoint(
+    const std::string& /*checkpoint_dir*/,
+    std::vector<CheckpointFileRef>* /*referenced_files*/,
+    uint64_t /*log_size_for_flush*/) {
+  return Status::NotSupported("");
+}
+
+Status Checkpoint::ReleaseReferenceCheckpoint() {
+  return Status::NotSupported("");
+}
+
 void CheckpointImpl::CleanStagingDirectory(const std::string& full_private_path,
                                            Logger* info_log) {
   std::vector<std::string> subchildren;
@@ -69,6 +81,38 @@ void CheckpointImpl::CleanStagingDirectory(const std::string& full_private_path,
 // Builds an openable snapshot of RocksDB
 Status CheckpointImpl::CreateCheckpoint(const std::string& checkpoint_dir,
                                         uint64_t log_size_for_flush) {
+  return CreateCheckpointInternal(checkpoint_dir, log_size_for_flush,
+                                  nullptr /* referenced_files */);
+}
+
+Status CheckpointImpl::CreateReferenceCheckpoint(
+    const std::string& checkpoint_dir,
+    std::vector<CheckpointFileRef>* referenced_files,
+    uint64_t log_size_for_flush) {
+  assert(referenced_files != nullptr);
+  referenced_files->clear();
+  Status s = CreateCheckpointInternal(checkpoint_dir, log_size_for_flush,
+                                      referenced_files);
+  if (s.ok()) {
+    num_pinned_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return s;
+}
+
+Status CheckpointImpl::ReleaseReferenceCheckpoint() {
+  size_t pinned = num_pinned_.load(std::memory_order_relaxed);
+  do {
+    if (pinned == 0) {
+      return Status::InvalidArgument("No reference checkpoint to release");
+    }
+  } while (!num_pinned_.compare_exchange_weak(pinned, pinned - 1,
+                                              std::memory_order_relaxed));
+  return db_->EnableFileDeletions(false);
+}
+
+Status CheckpointImpl::CreateCheckpointInternal(
+    const std::string& checkpoint_dir, uint64_t log_size_for_flush,
+    std::vector<CheckpointFileRef>* referenced_files) {
   DBOptions db_options = db_->GetDBOptions();
 
   Status s = db_->GetEnv()->FileExists(checkpoint_dir);
@@ -102,15 +146,35 @@ Status CheckpointImpl::CreateCheckpoint(const std::string& checkpoint_dir,
   // create snapshot directory
   s = db_->GetEnv()->CreateDir(full_private_path);
   uint64_t sequence_number = 0;
+  bool pinned_files = false;
   if (s.ok()) {
     db_->DisableFileDeletions();
     s = CreateCustomCheckpoint(
         db_options,
         [&](const std::string& src_dirname, const std::string& fname,
-            FileType) {
-          ROCKS_LOG_INFO(db_options.info_log, "Hard Linking %s", fname.c_str());
-          return db_->GetEnv()->LinkFile(src_dirname + fname,
-                                         full_private_path + fname);
+            FileType type) {
+          if (referenced_files == nullptr) {
+            ROCKS_LOG_INFO(db_options.info_log, "Hard Linking %s",
+                           fname.c_str());
+            return db_->GetEnv()->LinkFile(src_dirname + fname,
+                                           full_private_path + fname);
+          }
+          if (type != kTableFile) {
+            ROCKS_LOG_INFO(db_options.info_log, "Copying %s", fname.c_str());
+            return CopyFile(db_->GetEnv(), src_dirname + fname,
+                            full_private_path + fname, 0,
+                            db_options.use_fsync);
+          }
+          ROCKS_LOG_INFO(db_options.info_log, "Referencing %s",
+                         fname.c_str());
+          CheckpointFileRef ref;
+          ref.name = fname;
+          Status st =
+              db_->GetEnv()->GetFileSize(src_dirname + fname, &ref.size);
+          if (st.ok()) {
+            referenced_files->emplace_back(std::move(ref));
+          }
+          return st;
         } /* link_file_cb */,
         [&](const std::string& src_dirname, const std::string& fname,
             uint64_t size_limit_bytes, FileType) {
@@ -125,8 +189,27 @@ Status CheckpointImpl::CreateCheckpoint(const std::string& checkpoint_dir,
                             db_options.use_fsync);
         } /* create_file_cb */,
         &sequence_number, log_size_for_flush);
-    // we copied all the files, enable file deletions
-    db_->EnableFileDeletions(false);
+    if (s.ok() && referenced_files != nullptr) {
+      std::string contents;
+      for (auto& ref : *referenced_files) {
+        contents.append(ref.name.substr(1));
+        contents.push_back(' ');
+        contents.append(ToString(ref.size));
+        contents.push_back('\n');
+      }
+      ROCKS_LOG_INFO(db_options.info_log,
+                     "Creating /REFERENCED_FILES of %" ROCKSDB_PRIszt " files",
+                     referenced_files->size());
+      s = CreateFile(db_->GetEnv(), full_private_path + "/REFERENCED_FILES",
+                     contents, db_options.use_fsync);
+    }
+    // we copied all the files, enable file deletions, unless the referenced
+    // files stay pinned until ReleaseReferenceCheckpoint()
+    if (!s.ok() || referenced_files == nullptr) {
+      db_->EnableFileDeletions(false);
+    } else {
+      pinned_files = true;
+    }
   }
 
   if (s.ok()) {
@@ -151,6 +234,9 @@ Status CheckpointImpl::CreateCheckpoint(const std::string& checkpoint_dir,
     ROCKS_LOG_INFO(db_options.info_log, "Snapshot failed -- %s",
                    s.ToString().c_str());
     CleanStagingDirectory(full_private_path, db_options.info_log.get());
+    if (pinned_files) {
+      db_->EnableFileDeletions(false);
+    }
   }
   return s;
 }
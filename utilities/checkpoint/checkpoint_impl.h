@@ -6,7 +6,9 @@
 #pragma once
 #ifndef ROCKSDB_LITE
 
+#include <atomic>
 #include <string>
+#include <vector>
 
 #include "rocksdb/db.h"
 #include "rocksdb/terark_namespace.h"
@@ -31,6 +33,14 @@ class CheckpointImpl : public Checkpoint {
   virtual Status CreateCheckpoint(const std::string& checkpoint_dir,
                                   uint64_t log_size_for_flush) override;
 
+  using Checkpoint::CreateReferenceCheckpoint;
+  virtual Status CreateReferenceCheckpoint(
+      const std::string& checkpoint_dir,
+      std::vector<CheckpointFileRef>* referenced_files,
+      uint64_t log_size_for_flush) override;
+
+  virtual Status ReleaseReferenceCheckpoint() override;
+
   // Checkpoint logic can be customized by providing callbacks for link, copy,
   // or create.
   Status CreateCustomCheckpoint(
@@ -49,7 +59,16 @@ class CheckpointImpl : public Checkpoint {
 
  private:
   void CleanStagingDirectory(const std::string& path, Logger* info_log);
+
+  // Hard link or copy the table files if `referenced_files` is nullptr, or
+  // else record them, and keep the file deletions disabled on success
+  Status CreateCheckpointInternal(
+      const std::string& checkpoint_dir, uint64_t log_size_for_flush,
+      std::vector<CheckpointFileRef>* referenced_files);
+
   DB* db_;
+  // The successful reference checkpoints not yet released
+  std::atomic<size_t> num_pinned_{0};
 };
 
 }  //  namespace TERARKDB_NAMESPACE
@@ -26,6 +26,7 @@
 #include "rocksdb/utilities/checkpoint.h"
 #include "rocksdb/utilities/transaction_db.h"
 #include "util/fault_injection_test_env.h"
+#include "util/file_util.h"
 #include "util/sync_point.h"
 #include "util/testharness.h"
 
@@ -286,6 +287,50 @@ TEST_F(CheckpointTest, GetSnapshotLink) {
   }
 }
 
+TEST_F(CheckpointTest, ReferenceCheckpoint) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  Reopen(options);
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(Put("bar", "v1"));
+
+  Checkpoint* checkpoint;
+  ASSERT_OK(Checkpoint::Create(db_, &checkpoint));
+  std::vector<CheckpointFileRef> refs;
+  ASSERT_OK(checkpoint->CreateReferenceCheckpoint(snapshot_name_, &refs));
+  ASSERT_EQ(2U, refs.size());
+  for (auto& ref : refs) {
+    // Only referenced, not linked or copied
+    ASSERT_TRUE(env_->FileExists(snapshot_name_ + ref.name).IsNotFound());
+  }
+  ASSERT_OK(env_->FileExists(snapshot_name_ + "/REFERENCED_FILES"));
+
+  // The referenced files outlive the compaction obsoleting them
+  ASSERT_OK(Put("foo", "v2"));
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  for (auto& ref : refs) {
+    uint64_t size;
+    ASSERT_OK(env_->GetFileSize(dbname_ + ref.name, &size));
+    ASSERT_EQ(ref.size, size);
+    ASSERT_OK(CopyFile(env_, dbname_ + ref.name, snapshot_name_ + ref.name, 0,
+                       false /* use_fsync */));
+  }
+  ASSERT_OK(checkpoint->ReleaseReferenceCheckpoint());
+  ASSERT_TRUE(checkpoint->ReleaseReferenceCheckpoint().IsInvalidArgument());
+  delete checkpoint;
+
+  DB* snapshot_db;
+  options.create_if_missing = false;
+  ASSERT_OK(DB::Open(options, snapshot_name_, &snapshot_db));
+  std::string result;
+  ASSERT_OK(snapshot_db->Get(ReadOptions(), "foo", &result));
+  ASSERT_EQ("v1", result);
+  ASSERT_OK(snapshot_db->Get(ReadOptions(), "bar", &result));
+  ASSERT_EQ("v1", result);
+  delete snapshot_db;
+}
+
 TEST_F(CheckpointTest, CheckpointCF) {
   Options options = CurrentOptions();
   CreateAndReopenWithCF({"one", "two", "three", "four", "five"}, options);
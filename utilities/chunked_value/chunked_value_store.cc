@@ -0,0 +1,361 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "rocksdb/utilities/chunked_value_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "rocksdb/comparator.h"
+#include "rocksdb/lazy_buffer.h"
+#include "rocksdb/terark_namespace.h"
+#include "rocksdb/write_batch.h"
+#include "util/coding.h"
+
+namespace TERARKDB_NAMESPACE {
+
+namespace {
+// An index starts with this, a value written by Put() rarely does
+const char kIndexMagic[] = "\0chunked";
+const size_t kIndexMagicSize = sizeof(kIndexMagic) - 1;
+// The chunks deleted by a write batch of DeleteOrphanChunks()
+const size_t kOrphanBatchSize = 256;
+
+struct ChunkIndex {
+  uint64_t generation = 0;
+  uint64_t size = 0;
+  uint64_t chunk_size = 0;
+
+  uint64_t num_chunks() const {
+    return chunk_size == 0 ? 0 : (size + chunk_size - 1) / chunk_size;
+  }
+
+  void EncodeTo(std::string* dst) const {
+    dst->assign(kIndexMagic, kIndexMagicSize);
+    PutVarint64(dst, generation);
+    PutVarint64(dst, size);
+    PutVarint64(dst, chunk_size);
+  }
+
+  // Returns false if `value` is not an index
+  bool DecodeFrom(Slice value) {
+    if (!value.starts_with(Slice(kIndexMagic, kIndexMagicSize))) {
+      return false;
+    }
+    value.remove_prefix(kIndexMagicSize);
+    return GetVarint64(&value, &generation) && GetVarint64(&value, &size) &&
+           GetVarint64(&value, &chunk_size) && value.empty() &&
+           (chunk_size > 0 || size == 0);
+  }
+};
+
+void PutBigEndian(std::string* dst, uint64_t value, int bytes) {
+  for (int i = bytes - 1; i >= 0; --i) {
+    dst->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+uint64_t DecodeBigEndian(const char* p, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; ++i) {
+    value = (value << 8) | static_cast<unsigned char>(p[i]);
+  }
+  return value;
+}
+
+// The chunks of a value sort together, by generation then by position:
+// length prefixed user key, big endian 64 bits generation, big endian 32
+// bits chunk number
+std::string ChunkKey(const Slice& key, uint64_t generation, uint64_t chunk) {
+  std::string chunk_key;
+  PutLengthPrefixedSlice(&chunk_key, key);
+  PutBigEndian(&chunk_key, generation, 8);
+  PutBigEndian(&chunk_key, chunk, 4);
+  return chunk_key;
+}
+
+bool ParseChunkKey(Slice chunk_key, Slice* key, uint64_t* generation) {
+  if (!GetLengthPrefixedSlice(&chunk_key, key) || chunk_key.size() != 12) {
+    return false;
+  }
+  *generation = DecodeBigEndian(chunk_key.data(), 8);
+  return true;
+}
+
+Status DeleteChunks(WriteBatch* batch, ColumnFamilyHandle* chunk_cf,
+                    const Slice& key, const ChunkIndex& index) {
+  for (uint64_t i = 0; i < index.num_chunks(); ++i) {
+    Status s = batch->Delete(chunk_cf, ChunkKey(key, index.generation, i));
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+// A value not written by PutStream(), in memory
+class PlainValueStream : public ValueStream {
+ public:
+  explicit PlainValueStream(std::string&& value) : value_(std::move(value)) {}
+
+  uint64_t size() const override { return value_.size(); }
+  uint64_t offset() const override { return offset_; }
+
+  Status Read(size_t n, Slice* result) override {
+    n = std::min<size_t>(n, value_.size() - offset_);
+    *result = Slice(value_.data() + offset_, n);
+    offset_ += n;
+    return Status::OK();
+  }
+
+  Status Skip(uint64_t n) override {
+    offset_ += std::min<uint64_t>(n, value_.size() - offset_);
+    return Status::OK();
+  }
+
+ private:
+  const std::string value_;
+  size_t offset_ = 0;
+};
+
+class ChunkedValueStream : public ValueStream {
+ public:
+  ChunkedValueStream(DB* db, ColumnFamilyHandle* chunk_cf,
+                     const ReadOptions& read_options, const Snapshot* snapshot,
+                     const Slice& key, const ChunkIndex& index)
+      : db_(db),
+        chunk_cf_(chunk_cf),
+        // On `snapshot` if set, which the stream releases
+        read_options_(read_options),
+        snapshot_(snapshot),
+        key_(key.ToString()),
+        index_(index) {}
+
+  ~ChunkedValueStream() override {
+    chunk_.reset();
+    if (snapshot_ != nullptr) {
+      db_->ReleaseSnapshot(snapshot_);
+    }
+  }
+
+  uint64_t size() const override { return index_.size; }
+  uint64_t offset() const override { return offset_; }
+
+  Status Read(size_t n, Slice* result) override {
+    *result = Slice();
+    if (offset_ >= index_.size || n == 0) {
+      return Status::OK();
+    }
+    uint64_t chunk = offset_ / index_.chunk_size;
+    if (chunk != loaded_chunk_) {
+      chunk_.reset();
+      loaded_chunk_ = uint64_t(-1);
+      Status s = db_->Get(read_options_, chunk_cf_,
+                          ChunkKey(key_, index_.generation, chunk), &chunk_);
+      if (s.ok()) {
+        s = chunk_.fetch();
+      }
+      if (s.IsNotFound()) {
+        return Status::Corruption("Missing chunk of ", key_);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      uint64_t expected =
+          std::min(index_.chunk_size, index_.size - chunk * index_.chunk_size);
+      if (chunk_.size() != expected) {
+        return Status::Corruption("Bad chunk size of ", key_);
+      }
+      loaded_chunk_ = chunk;
+    }
+    size_t pos = static_cast<size_t>(offset_ - chunk * index_.chunk_size);
+    n = std::min(n, chunk_.size() - pos);
+    *result = Slice(chunk_.slice().data() + pos, n);
+    offset_ += n;
+    return Status::OK();
+  }
+
+  Status Skip(uint64_t n) override {
+    offset_ += std::min(n, index_.size - offset_);
+    return Status::OK();
+  }
+
+ private:
+  DB* db_;
+  ColumnFamilyHandle* chunk_cf_;
+  ReadOptions read_options_;
+  const Snapshot* snapshot_;
+  const std::string key_;
+  const ChunkIndex index_;
+  uint64_t offset_ = 0;
+  LazyBuffer chunk_;
+  uint64_t loaded_chunk_ = uint64_t(-1);
+};
+}  // namespace
+
+ChunkedValueStore::ChunkedValueStore(DB* db, ColumnFamilyHandle* value_cf,
+                                     ColumnFamilyHandle* chunk_cf,
+                                     const ChunkedValueOptions& options)
+    : db_(db), value_cf_(value_cf), chunk_cf_(chunk_cf), options_(options) {
+  assert(options_.chunk_size > 0);
+  assert(chunk_cf_->GetComparator() == BytewiseComparator());
+}
+
+Status ChunkedValueStore::PutStream(const WriteOptions& options,
+                                    const Slice& key, SequentialFile* reader,
+                                    uint64_t size) {
+  ChunkIndex index;
+  // Unique enough for the values of a key never to mix their chunks
+  Env* env = Env::Default();
+  index.generation =
+      std::hash<std::string>()(env->GenerateUniqueId()) ^ env->NowNanos();
+  index.size = size;
+  index.chunk_size = options_.chunk_size;
+
+  std::string buffer(options_.chunk_size, '\0');
+  for (uint64_t i = 0; i < index.num_chunks(); ++i) {
+    size_t chunk_size = static_cast<size_t>(
+        std::min(index.chunk_size, size - i * index.chunk_size));
+    size_t read = 0;
+    while (read < chunk_size) {
+      Slice result;
+      Status s = reader->Read(chunk_size - read, &result, &buffer[read]);
+      if (!s.ok()) {
+        return s;
+      }
+      if (result.empty()) {
+        return Status::InvalidArgument("Value shorter than its size");
+      }
+      if (result.data() != buffer.data() + read) {
+        memcpy(&buffer[read], result.data(), result.size());
+      }
+      read += result.size();
+    }
+    Status s = db_->Put(options, chunk_cf_, ChunkKey(key, index.generation, i),
+                        Slice(buffer.data(), chunk_size));
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  // The new index and the deletion of the old chunks at once
+  WriteBatch batch;
+  std::string old_value;
+  Status s = db_->Get(ReadOptions(), value_cf_, key, &old_value);
+  ChunkIndex old_index;
+  if (s.ok() && old_index.DecodeFrom(old_value)) {
+    s = DeleteChunks(&batch, chunk_cf_, key, old_index);
+  } else if (s.IsNotFound()) {
+    s = Status::OK();
+  }
+  std::string index_value;
+  index.EncodeTo(&index_value);
+  if (s.ok()) {
+    s = batch.Put(value_cf_, key, index_value);
+  }
+  if (s.ok()) {
+    s = db_->Write(options, &batch);
+  }
+  return s;
+}
+
+Status ChunkedValueStore::GetStream(const ReadOptions& read_options,
+                                    const Slice& key,
+                                    std::unique_ptr<ValueStream>* stream) {
+  ReadOptions options = read_options;
+  const Snapshot* snapshot = nullptr;
+  if (options.snapshot == nullptr) {
+    snapshot = db_->GetSnapshot();
+    options.snapshot = snapshot;
+  }
+  std::string value;
+  Status s = db_->Get(options, value_cf_, key, &value);
+  ChunkIndex index;
+  if (s.ok() && index.DecodeFrom(value)) {
+    stream->reset(
+        new ChunkedValueStream(db_, chunk_cf_, options, snapshot, key, index));
+    return s;
+  }
+  if (snapshot != nullptr) {
+    db_->ReleaseSnapshot(snapshot);
+  }
+  if (s.ok()) {
+    stream->reset(new PlainValueStream(std::move(value)));
+  }
+  return s;
+}
+
+Status ChunkedValueStore::Delete(const WriteOptions& options,
+                                 const Slice& key) {
+  WriteBatch batch;
+  std::string value;
+  Status s = db_->Get(ReadOptions(), value_cf_, key, &value);
+  ChunkIndex index;
+  if (s.ok() && index.DecodeFrom(value)) {
+    s = DeleteChunks(&batch, chunk_cf_, key, index);
+  } else if (s.IsNotFound()) {
+    s = Status::OK();
+  }
+  if (s.ok()) {
+    s = batch.Delete(value_cf_, key);
+  }
+  if (s.ok()) {
+    s = db_->Write(options, &batch);
+  }
+  return s;
+}
+
+Status ChunkedValueStore::DeleteOrphanChunks(const WriteOptions& options) {
+  ReadOptions read_options;
+  read_options.snapshot = db_->GetSnapshot();
+  std::unique_ptr<Iterator> iter(db_->NewIterator(read_options, chunk_cf_));
+  WriteBatch batch;
+  Status s;
+  std::string last_key;
+  bool first = true;
+  bool has_index = false;
+  ChunkIndex index;
+  for (iter->SeekToFirst(); s.ok() && iter->Valid(); iter->Next()) {
+    Slice key;
+    uint64_t generation = 0;
+    if (!ParseChunkKey(iter->key(), &key, &generation)) {
+      s = Status::Corruption("Bad chunk key");
+      break;
+    }
+    // The chunks of a key are next to each other
+    if (first || key != Slice(last_key)) {
+      first = false;
+      last_key = key.ToString();
+      std::string value;
+      s = db_->Get(read_options, value_cf_, key, &value);
+      has_index = s.ok() && index.DecodeFrom(value);
+      if (s.IsNotFound()) {
+        s = Status::OK();
+      }
+    }
+    if (s.ok() && (!has_index || index.generation != generation)) {
+      s = batch.Delete(chunk_cf_, iter->key());
+      if (s.ok() && batch.Count() >= kOrphanBatchSize) {
+        s = db_->Write(options, &batch);
+        batch.Clear();
+      }
+    }
+  }
+  if (s.ok()) {
+    s = iter->status();
+  }
+  if (s.ok() && batch.Count() > 0) {
+    s = db_->Write(options, &batch);
+  }
+  iter.reset();
+  db_->ReleaseSnapshot(read_options.snapshot);
+  return s;
+}
+
+}  // namespace TERARKDB_NAMESPACE
+#endif  // !ROCKSDB_LITE
@@ -0,0 +1,147 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "rocksdb/utilities/chunked_value_store.h"
+
+#include "db/db_test_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/terark_namespace.h"
+#include "util/testutil.h"
+
+namespace TERARKDB_NAMESPACE {
+
+class ChunkedValueStoreTest : public DBTestBase {
+ public:
+  ChunkedValueStoreTest() : DBTestBase("/chunked_value_store_test") {}
+
+  void SetUp() override {
+    CreateAndReopenWithCF({"chunks"}, CurrentOptions());
+    ChunkedValueOptions options;
+    options.chunk_size = 1024;
+    store_.reset(new ChunkedValueStore(db_, handles_[0], handles_[1], options));
+  }
+
+  Status PutStream(const std::string& key, const std::string& value) {
+    test::StringEnv::SeqStringSource reader(value);
+    return store_->PutStream(WriteOptions(), key, &reader, value.size());
+  }
+
+  std::string GetStream(const std::string& key) {
+    std::unique_ptr<ValueStream> stream;
+    Status s = store_->GetStream(ReadOptions(), key, &stream);
+    if (!s.ok()) {
+      return s.ToString();
+    }
+    std::string value;
+    Slice result;
+    do {
+      s = stream->Read(300, &result);
+      if (!s.ok()) {
+        return s.ToString();
+      }
+      value.append(result.data(), result.size());
+    } while (!result.empty());
+    EXPECT_EQ(stream->size(), value.size());
+    return value;
+  }
+
+  size_t CountChunks() {
+    std::unique_ptr<Iterator> iter(
+        db_->NewIterator(ReadOptions(), handles_[1]));
+    size_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ++count;
+    }
+    return count;
+  }
+
+  std::unique_ptr<ChunkedValueStore> store_;
+};
+
+TEST_F(ChunkedValueStoreTest, PutGetDelete) {
+  Random rnd(301);
+  std::string value = RandomString(&rnd, 10000);
+  ASSERT_OK(PutStream("key", value));
+  ASSERT_EQ(10U, CountChunks());
+  ASSERT_EQ(value, GetStream("key"));
+
+  // A stream skips to the middle of a chunk
+  std::unique_ptr<ValueStream> stream;
+  ASSERT_OK(store_->GetStream(ReadOptions(), "key", &stream));
+  ASSERT_OK(stream->Skip(5000));
+  Slice result;
+  ASSERT_OK(stream->Read(100, &result));
+  ASSERT_EQ(value.substr(5000, 100), result.ToString());
+  ASSERT_EQ(5100U, stream->offset());
+
+  // The stream reads on its snapshot while the value is replaced
+  std::string new_value = RandomString(&rnd, 3000);
+  ASSERT_OK(PutStream("key", new_value));
+  ASSERT_EQ(3U, CountChunks());
+  ASSERT_OK(stream->Read(100, &result));
+  ASSERT_EQ(value.substr(5100, 100), result.ToString());
+  stream.reset();
+  ASSERT_OK(Flush(1));
+  ASSERT_EQ(new_value, GetStream("key"));
+
+  ASSERT_OK(PutStream("empty", ""));
+  ASSERT_EQ("", GetStream("empty"));
+
+  ASSERT_OK(store_->Delete(WriteOptions(), "key"));
+  ASSERT_EQ(0U, CountChunks());
+  ASSERT_TRUE(store_->GetStream(ReadOptions(), "key", &stream).IsNotFound());
+}
+
+TEST_F(ChunkedValueStoreTest, PlainValue) {
+  ASSERT_OK(Put("plain", "small value"));
+  ASSERT_EQ("small value", GetStream("plain"));
+}
+
+TEST_F(ChunkedValueStoreTest, DeleteOrphanChunks) {
+  Random rnd(301);
+  std::string value = RandomString(&rnd, 2500);
+  ASSERT_OK(PutStream("a", value));
+  ASSERT_OK(PutStream("b", value));
+
+  // An interrupted PutStream() leaves its chunks behind, whether the key
+  // has an index or not
+  for (const char* key : {"b", "c"}) {
+    test::StringEnv::SeqStringSource reader(value);
+    ASSERT_TRUE(store_->PutStream(WriteOptions(), key, &reader, 5000)
+                    .IsInvalidArgument());
+  }
+  ASSERT_EQ(10U, CountChunks());
+  ASSERT_EQ(value, GetStream("b"));
+  ASSERT_TRUE(GetStream("c").find("NotFound") == 0);
+
+  ASSERT_OK(store_->DeleteOrphanChunks(WriteOptions()));
+  ASSERT_EQ(6U, CountChunks());
+  ASSERT_EQ(value, GetStream("a"));
+  ASSERT_EQ(value, GetStream("b"));
+
+  // A chunk key not written by the store
+  ASSERT_OK(Put(1, "dangling", "value"));
+  ASSERT_TRUE(store_->DeleteOrphanChunks(WriteOptions()).IsCorruption());
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  TERARKDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+#else
+#include <stdio.h>
+
+int main(int /*argc*/, char** /*argv*/) {
+  fprintf(stderr,
+          "SKIPPED as ChunkedValueStore is not supported in ROCKSDB_LITE\n");
+  return 0;
+}
+
+#endif  // !ROCKSDB_LITE
@@ -11,24 +11,12 @@
 #include <unordered_map>
 #include <vector>
 
+#include "rocksdb/col_declaration.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/coding.h"
 
 namespace TERARKDB_NAMESPACE {
 
-enum ColCompressionType {
-  kColNoCompression,
-  kColRle,
-  kColVarint,
-  kColRleVarint,
-  kColDeltaVarint,
-  kColRleDeltaVarint,
-  kColDict,
-  kColRleDict
-};
-
-struct ColDeclaration;
-
 // ColBufEncoder is a class to encode column buffers. It can be populated from a
 // ColDeclaration. Each time it takes a column value into Append() method to
 // encode the column and store it into an internal buffer. After all rows for
@@ -154,25 +142,6 @@ class VariableChunkColBufEncoder : public VariableLengthColBufEncoder {
   std::vector<uint64_t> dict_vec_;
 };
 
-// ColDeclaration declares a column's type, algorithm of column-aware encoding,
-// and other column data like endian and nullability.
-struct ColDeclaration {
-  explicit ColDeclaration(
-      std::string _col_type,
-      ColCompressionType _col_compression_type = kColNoCompression,
-      size_t _size = 0, bool _nullable = false, bool _big_endian = false)
-      : col_type(_col_type),
-        col_compression_type(_col_compression_type),
-        size(_size),
-        nullable(_nullable),
-        big_endian(_big_endian) {}
-  std::string col_type;
-  ColCompressionType col_compression_type;
-  size_t size;
-  bool nullable;
-  bool big_endian;
-};
-
 // KVPairColDeclarations is a class to hold column declaration of columns in
 // key and value.
 struct KVPairColDeclarations {
@@ -429,6 +429,17 @@ static int anetListen(char *err, int s, struct sockaddr *sa, socklen_t len,
   return ANET_OK;
 }
 
+static int anetSetReusePort(char *err, int fd) {
+  int yes = 1;
+  /* Let every event loop listen on the port with its own socket, the kernel
+   * spreads the connections among them */
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1) {
+    anetSetError(err, "setsockopt SO_REUSEPORT: %s", strerror(errno));
+    return ANET_ERR;
+  }
+  return ANET_OK;
+}
+
 static int anetV6Only(char *err, int s) {
   int yes = 1;
   if (setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, &yes, sizeof(yes)) == -1) {
@@ -440,7 +451,7 @@ static int anetV6Only(char *err, int s) {
 }
 
 static int _anetTcpServer(char *err, int port, char *bindaddr, int af,
-                          int backlog) {
+                          int backlog, int reuse_port) {
   int s = -1, rv;
   char _port[6]; /* strlen("65535") */
   struct addrinfo hints, *servinfo, *p;
@@ -461,6 +472,7 @@ static int _anetTcpServer(char *err, int port, char *bindaddr, int af,
 
     if (af == AF_INET6 && anetV6Only(err, s) == ANET_ERR) goto error;
     if (anetSetReuseAddr(err, s) == ANET_ERR) goto error;
+    if (reuse_port && anetSetReusePort(err, s) == ANET_ERR) goto error;
     if (anetListen(err, s, p->ai_addr, p->ai_addrlen, backlog) == ANET_ERR)
       s = ANET_ERR;
     goto end;
@@ -479,11 +491,15 @@ end:
 }
 
 int anetTcpServer(char *err, int port, char *bindaddr, int backlog) {
-  return _anetTcpServer(err, port, bindaddr, AF_INET, backlog);
+  return _anetTcpServer(err, port, bindaddr, AF_INET, backlog, 0);
+}
+
+int anetTcpReusePortServer(char *err, int port, char *bindaddr, int backlog) {
+  return _anetTcpServer(err, port, bindaddr, AF_INET, backlog, 1);
 }
 
 int anetTcp6Server(char *err, int port, char *bindaddr, int backlog) {
-  return _anetTcpServer(err, port, bindaddr, AF_INET6, backlog);
+  return _anetTcpServer(err, port, bindaddr, AF_INET6, backlog, 0);
 }
 
 int anetUnixServer(char *err, char *path, mode_t perm, int backlog) {
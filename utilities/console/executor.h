@@ -25,7 +25,13 @@ class Executor {
   virtual size_t GetTaskCount() const = 0;
 };
 
-std::unique_ptr<Executor> OpenExecutorMem(TERARKDB_NAMESPACE::DBImpl* db);
+// The key values the in-memory executors of all the event loops share
+struct MemStore;
+
+std::shared_ptr<MemStore> NewMemStore();
+
+std::unique_ptr<Executor> OpenExecutorMem(
+    TERARKDB_NAMESPACE::DBImpl* db, const std::shared_ptr<MemStore>& store);
 }  // namespace cheapis
 
 #endif  // CHEAPIS_EXECUTOR_H
\ No newline at end of file
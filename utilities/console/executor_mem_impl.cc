@@ -1,12 +1,23 @@
+#include <string.h>
+
 #include <deque>
+#include <limits>
 #include <map>
+#include <mutex>
 
 #include "db/db_impl.h"
 #include "executor.h"
 #include "string_view.hpp"
+#include "util.h"
 #include "util/autovector.h"
+#include "utilities/redis/redis_lists.h"
 
 namespace cheapis {
+struct MemStore {
+  std::mutex mutex;
+  std::map<std::string, std::string> map;
+};
+
 class ExecutorMemImpl final : public Executor {
  private:
   struct Task {
@@ -16,7 +27,20 @@ class ExecutorMemImpl final : public Executor {
   };
 
  public:
-  explicit ExecutorMemImpl(TERARKDB_NAMESPACE::DBImpl* db) : db_(db) {}
+  ExecutorMemImpl(TERARKDB_NAMESPACE::DBImpl* db,
+                  const std::shared_ptr<MemStore>& store)
+      : db_(db), store_(store) {
+#ifndef ROCKSDB_LITE
+    // The lists are kept in the db itself, which must merge their pushes
+    auto merge_operator = db_->GetOptions().merge_operator;
+    if (merge_operator != nullptr &&
+        strcmp(merge_operator->Name(),
+               TERARKDB_NAMESPACE::RedisLists::CreateMergeOperator()
+                   ->Name()) == 0) {
+      lists_.reset(new TERARKDB_NAMESPACE::RedisLists(db_));
+    }
+#endif  // !ROCKSDB_LITE
+  }
 
   ~ExecutorMemImpl() override = default;
 
@@ -31,7 +55,11 @@ class ExecutorMemImpl final : public Executor {
     task.fd = fd;
   }
 
+  // The commands of all the clients in one tick are applied under a single
+  // lock of the store, and every client gets all of its replies in one write
   void Execute(size_t n, long /* curr_time */, EventLoop<Client>* el) override {
+    TERARKDB_NAMESPACE::autovector<std::pair<Client*, int>> to_flush;
+    std::unique_lock<std::mutex> lock(store_->mutex, std::defer_lock);
     for (size_t i = 0; i < n; tasks_.pop_front(), ++i) {
       Task& task = tasks_.front();
       Client* c = task.c;
@@ -45,60 +73,180 @@ class ExecutorMemImpl final : public Executor {
         continue;
       }
 
-      bool blocked = !c->output.empty();
-      auto& argv = task.argv;
-      if (argv[0] == "GET" && argv.size() == 2) {
-        auto it = map_.find(argv[1]);
-        if (it != map_.cend()) {
-          RespMachine::AppendBulkString(&c->output, it->second);
-        } else {
-          RespMachine::AppendNullArray(&c->output);
-        }
-      } else if (argv[0] == "SET" && argv.size() == 3) {
-        map_.emplace(std::move(argv[1]), std::move(argv[2]));
-        RespMachine::AppendSimpleString(&c->output, "OK");
-      } else if (argv[0] == "DEL" && argv.size() == 2) {
-        map_.erase(argv[1]);
-        RespMachine::AppendSimpleString(&c->output, "OK");
-      } else if (argv[0] == "TERARKDB_OPS_FULL_COMPACT" && argv.size() == 1) {
-        TERARKDB_NAMESPACE::CompactRangeOptions cro{};
-        cro.exclusive_manual_compaction = false;
-        auto s = db_->CompactRange(cro, nullptr, nullptr);
-        if (s.ok()) {
-          RespMachine::AppendSimpleString(&c->output, "OK");
+      // A client with pending output is already waiting to be writable
+      if (c->output.empty()) {
+        to_flush.emplace_back(c, fd);
+      }
+      Process(&task.argv, &c->output, &lock);
+    }
+    if (lock.owns_lock()) {
+      lock.unlock();
+    }
+
+    for (auto& client : to_flush) {
+      Client* c = client.first;
+      int fd = client.second;
+      ssize_t nwrite = write(fd, c->output.data(), c->output.size());
+      if (nwrite > 0) {
+        c->output.assign(c->output.data() + nwrite, c->output.size() - nwrite);
+      }
+      if (!c->output.empty()) {
+        el->AddEvent(fd, kWritable);
+      }
+    }
+  }
+
+  size_t GetTaskCount() const override { return tasks_.size(); }
+
+ private:
+  void Process(TERARKDB_NAMESPACE::autovector<std::string>* args,
+               std::string* output, std::unique_lock<std::mutex>* lock) {
+    auto& argv = *args;
+    if (argv[0] == "TERARKDB_OPS_FULL_COMPACT" && argv.size() == 1) {
+      // Don't hold the other event loops off the store while compacting
+      if (lock->owns_lock()) {
+        lock->unlock();
+      }
+      TERARKDB_NAMESPACE::CompactRangeOptions cro{};
+      cro.exclusive_manual_compaction = false;
+      auto s = db_->CompactRange(cro, nullptr, nullptr);
+      if (s.ok()) {
+        RespMachine::AppendSimpleString(output, "OK");
+      } else {
+        RespMachine::AppendError(output,
+                                 "Cannot do full compaction. Error message: " +
+                                     s.ToString());
+      }
+      return;
+    }
+    if (!lock->owns_lock()) {
+      lock->lock();
+    }
+    auto& map = store_->map;
+    if (argv[0] == "GET" && argv.size() == 2) {
+      auto it = map.find(argv[1]);
+      if (it != map.cend()) {
+        RespMachine::AppendBulkString(output, it->second);
+      } else {
+        RespMachine::AppendNullArray(output);
+      }
+    } else if (argv[0] == "MGET" && argv.size() >= 2) {
+      RespMachine::AppendArrayLength(output,
+                                     static_cast<long long>(argv.size() - 1));
+      for (size_t j = 1; j < argv.size(); ++j) {
+        auto it = map.find(argv[j]);
+        if (it != map.cend()) {
+          RespMachine::AppendBulkString(output, it->second);
         } else {
-          RespMachine::AppendError(
-              &c->output,
-              "Cannot do full compaction. Error message: " + s.ToString());
+          RespMachine::AppendNullBulkString(output);
         }
-      } else if (argv[0] == "PING" && argv.size() == 1) {
-        RespMachine::AppendSimpleString(&c->output, "PONG");
-      } else {
-        RespMachine::AppendError(&c->output, "Unsupported Command");
       }
+    } else if (argv[0] == "SET" && argv.size() == 3) {
+      map.emplace(std::move(argv[1]), std::move(argv[2]));
+      RespMachine::AppendSimpleString(output, "OK");
+    } else if (argv[0] == "DEL" && argv.size() == 2) {
+      map.erase(argv[1]);
+      RespMachine::AppendSimpleString(output, "OK");
+    } else if (argv[0] == "PING" && argv.size() == 1) {
+      RespMachine::AppendSimpleString(output, "PONG");
+    } else if (!ProcessList(argv, output)) {
+      RespMachine::AppendError(output, "Unsupported Command");
+    }
+  }
+
+  // The list commands, return false if argv is none of them. They are
+  // applied under the lock of the store too, since every one of them reads
+  // and then writes the meta of the list.
+  bool ProcessList(const TERARKDB_NAMESPACE::autovector<std::string>& argv,
+                   std::string* output) {
+#ifndef ROCKSDB_LITE
+    const std::string& cmd = argv[0];
+    bool push = (cmd == "LPUSH" || cmd == "RPUSH") && argv.size() >= 3;
+    bool pop = (cmd == "LPOP" || cmd == "RPOP") && argv.size() == 2;
+    bool len = cmd == "LLEN" && argv.size() == 2;
+    bool range = cmd == "LRANGE" && argv.size() == 4;
+    bool index = cmd == "LINDEX" && argv.size() == 3;
+    if (!push && !pop && !len && !range && !index) {
+      return false;
+    }
+    if (lists_ == nullptr) {
+      RespMachine::AppendError(output,
+                               "Lists need the RedisLists merge operator");
+      return true;
+    }
+    long long first = 0;
+    long long last = 0;
+    if ((range && (!ToInt32(argv[2], &first) || !ToInt32(argv[3], &last))) ||
+        (index && !ToInt32(argv[2], &first))) {
+      RespMachine::AppendError(output,
+                               "value is not an integer or out of range");
+      return true;
+    }
 
-      if (!blocked) {
-        ssize_t nwrite = write(fd, c->output.data(), c->output.size());
-        if (nwrite > 0) {
-          c->output.assign(c->output.data() + nwrite,
-                           c->output.size() - nwrite);
+    try {
+      const std::string& key = argv[1];
+      std::string value;
+      if (push) {
+        int length = 0;
+        for (size_t j = 2; j < argv.size(); ++j) {
+          length = cmd[0] == 'L' ? lists_->PushLeft(key, argv[j])
+                                 : lists_->PushRight(key, argv[j]);
         }
-        if (!c->output.empty()) {
-          el->AddEvent(fd, kWritable);
+        RespMachine::AppendInteger(output, length);
+      } else if (pop) {
+        bool found = cmd[0] == 'L' ? lists_->PopLeft(key, &value)
+                                   : lists_->PopRight(key, &value);
+        if (found) {
+          RespMachine::AppendBulkString(output, value);
+        } else {
+          RespMachine::AppendNullBulkString(output);
         }
+      } else if (len) {
+        RespMachine::AppendInteger(output, lists_->Length(key));
+      } else if (range) {
+        auto elements = lists_->Range(key, static_cast<int32_t>(first),
+                                      static_cast<int32_t>(last));
+        RespMachine::AppendArrayLength(
+            output, static_cast<long long>(elements.size()));
+        for (auto& element : elements) {
+          RespMachine::AppendBulkString(output, element);
+        }
+      } else if (lists_->Index(key, static_cast<int32_t>(first), &value)) {
+        RespMachine::AppendBulkString(output, value);
+      } else {
+        RespMachine::AppendNullBulkString(output);
       }
+    } catch (const TERARKDB_NAMESPACE::RedisListException& e) {
+      RespMachine::AppendError(output, std::string("List error: ") + e.what());
     }
+    return true;
+#else
+    (void)argv;
+    (void)output;
+    return false;
+#endif  // !ROCKSDB_LITE
   }
 
-  size_t GetTaskCount() const override { return tasks_.size(); }
+  static bool ToInt32(const std::string& s, long long* value) {
+    return string2ll(s.data(), s.size(), value) &&
+           *value >= std::numeric_limits<int32_t>::min() &&
+           *value <= std::numeric_limits<int32_t>::max();
+  }
 
- private:
   std::deque<Task> tasks_;
-  std::map<std::string, std::string> map_;
   TERARKDB_NAMESPACE::DBImpl* db_;
+  std::shared_ptr<MemStore> store_;
+#ifndef ROCKSDB_LITE
+  std::unique_ptr<TERARKDB_NAMESPACE::RedisLists> lists_;
+#endif  // !ROCKSDB_LITE
 };
 
-std::unique_ptr<Executor> OpenExecutorMem(TERARKDB_NAMESPACE::DBImpl* db) {
-  return std::make_unique<ExecutorMemImpl>(db);
+std::shared_ptr<MemStore> NewMemStore() {
+  return std::make_shared<MemStore>();
+}
+
+std::unique_ptr<Executor> OpenExecutorMem(
+    TERARKDB_NAMESPACE::DBImpl* db, const std::shared_ptr<MemStore>& store) {
+  return std::make_unique<ExecutorMemImpl>(db, store);
 }
 }  // namespace cheapis
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <cerrno>
 #include <cstring>
+#include <thread>
+#include <vector>
 
 #include "anet.h"
 #include "db/db_impl.h"
@@ -30,6 +32,7 @@ constexpr unsigned int kTimeout = 360;
 constexpr unsigned int kReadLength = 4096;
 constexpr unsigned int kMaxInputBuffer = 10485760;
 constexpr unsigned int kUnixSocketPerm = 700;
+constexpr unsigned int kNumEventLoops = 4;
 
 static void ReleaseOrMarkClient(int fd, Client *c, EventLoop<Client> *el) {
   if (c->ref_count == 0) {
@@ -67,10 +70,11 @@ static void ReadFromClient(int fd, Client *c, long curr_time,
   }
   c->last_mod_time = curr_time;
 
-  while (c->consume_len < in.size()) {
-    size_t consume_len =
-        c->resp.Input(in.data() + c->consume_len, in.size() - c->consume_len);
-    c->consume_len += consume_len;
+  // The arguments point into the input buffer, which is only compacted once
+  // all the pipelined commands of this read are submitted
+  size_t pos = 0;
+  while (pos < in.size()) {
+    size_t consume_len = c->resp.Input(in.data() + pos, in.size() - pos);
 
     auto state = c->resp.GetState();
     switch (state) {
@@ -80,12 +84,16 @@ static void ReadFromClient(int fd, Client *c, long curr_time,
         ++c->ref_count;
 
         c->resp.Reset();
-        in.assign(&in[c->consume_len], &in[in.size()]);
-        c->consume_len = 0;
+        pos += consume_len;
         break;
       }
 
       case RespMachine::kProcess: {
+        // Parse the incomplete command again from its start once the rest
+        // arrived, the arguments seen so far would not survive the buffer
+        // growing
+        c->resp.Reset();
+        in.erase(0, pos);
         return;
       }
 
@@ -97,6 +105,7 @@ static void ReadFromClient(int fd, Client *c, long curr_time,
       }
     }
   }
+  in.clear();
 }
 
 static void WriteToClient(int fd, Client *c, long curr_time,
@@ -145,9 +154,9 @@ static void ServerCron(long *last_cron_time, long curr_time,
   }
 }
 
-int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
-               const std::string &path, Env *env, Logger *log) {
 #ifdef TERARKDB_ENABLE_CONSOLE
+static int RunEventLoop(ServerRunner *runner, int ac_fd, Executor *executor,
+                        Env *env, Logger *log) {
   const int el_fd = EventLoop<Client>::Open();
   if (el_fd < 0) {
     ROCKS_LOG_ERROR(log, "Failed creating the event loop. Error message: '%s'",
@@ -156,42 +165,9 @@ int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
   }
   EventLoop<Client> el(el_fd);
 
-  auto executor = OpenExecutorMem(db);
-  if (executor == nullptr) {
-    ROCKS_LOG_ERROR(log, "Failed creating the executor");
-    return 1;
-  }
-
-  char err[ANET_ERR_LEN];
-  int ac_fd;
-  if (path.empty()) {  // currently, it's just for debug
-    ac_fd = anetTcpServer(err, kPort, const_cast<char *>(kBindAddr), kBacklog);
-    if (ac_fd < 0) {
-      ROCKS_LOG_ERROR(
-          log, "Failed creating the TCP server. Error message: '%s'", err);
-      return 1;
-    }
-  } else {
-    std::string sock_path = path + "/CONSOLE";
-    unlink(sock_path.c_str()); /* don't care if this fails */
-    ac_fd = anetUnixServer(err, (char *)sock_path.c_str(), kUnixSocketPerm,
-                           kBacklog);
-    if (ac_fd < 0) {
-      ROCKS_LOG_ERROR(
-          log, "Failed creating the Unix socket server. Error message: '%s'",
-          err);
-      return 1;
-    }
-  }
-  anetNonBlock(nullptr, ac_fd);
-
-  int r = el.Acquire(ac_fd, std::make_unique<Client>());
-  if (r != 0) {
-    ROCKS_LOG_ERROR(log, "Failed acquiring the acceptor's fd");
-    return 1;
-  }
-
-  r = el.AddEvent(ac_fd, kReadable);
+  // The acceptor is owned by ServerMain(), a Unix socket is shared by all the
+  // event loops
+  int r = el.AddEvent(ac_fd, kReadable);
   if (r != 0) {
     ROCKS_LOG_ERROR(
         log, "Failed adding the acceptor's readable event. Error message: '%s'",
@@ -199,6 +175,7 @@ int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
     return 1;
   }
 
+  char err[ANET_ERR_LEN];
   int64_t last_cron_time = 0;
   auto status = env->GetCurrentTime(&last_cron_time);
   if (!status.ok()) {
@@ -209,10 +186,8 @@ int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
   struct timeval tv = {0};
   while (true) {
     if (runner->closing_) {
-      runner->closed_ = true;
       return 0;
     }
-
     tv.tv_sec = 0;
     tv.tv_usec = 1000;
     r = el.Poll(&tv);
@@ -271,8 +246,7 @@ int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
       } else {  // processor
         auto &client = el.GetResource(efd);
         if (EventLoop<Client>::IsEventReadable(event)) {
-          ReadFromClient(efd, client.get(), curr_time, executor.get(), &el,
-                         log);
+          ReadFromClient(efd, client.get(), curr_time, executor, &el, log);
         }
         if (EventLoop<Client>::IsEventWritable(event) && client != nullptr) {
           WriteToClient(efd, client.get(), curr_time, &el, log);
@@ -280,9 +254,86 @@ int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
       }
     }
 
-    ExecuteTasks(executor.get(), curr_time, &el);
+    ExecuteTasks(executor, curr_time, &el);
     ServerCron(&last_cron_time, curr_time, &el, log);
   }
+}
+#endif
+
+int ServerMain(ServerRunner *runner, TERARKDB_NAMESPACE::DBImpl *db,
+               const std::string &path, Env *env, Logger *log) {
+#ifdef TERARKDB_ENABLE_CONSOLE
+  // Every event loop runs on a thread of its own with its own acceptor and
+  // executor. TCP loops listen with SO_REUSEPORT so the kernel balances the
+  // connections, the Unix socket can't be reused and is shared instead.
+  char err[ANET_ERR_LEN];
+  std::vector<int> ac_fds;
+  auto close_acceptors = [&ac_fds]() {
+    for (int ac_fd : ac_fds) {
+      close(ac_fd);
+    }
+  };
+  if (path.empty()) {  // currently, it's just for debug
+    for (unsigned int i = 0; i < kNumEventLoops; ++i) {
+      int ac_fd = anetTcpReusePortServer(
+          err, kPort, const_cast<char *>(kBindAddr), kBacklog);
+      if (ac_fd < 0) {
+        ROCKS_LOG_ERROR(
+            log, "Failed creating the TCP server. Error message: '%s'", err);
+        close_acceptors();
+        return 1;
+      }
+      ac_fds.push_back(ac_fd);
+    }
+  } else {
+    std::string sock_path = path + "/CONSOLE";
+    unlink(sock_path.c_str()); /* don't care if this fails */
+    int ac_fd = anetUnixServer(err, (char *)sock_path.c_str(), kUnixSocketPerm,
+                               kBacklog);
+    if (ac_fd < 0) {
+      ROCKS_LOG_ERROR(
+          log, "Failed creating the Unix socket server. Error message: '%s'",
+          err);
+      return 1;
+    }
+    ac_fds.push_back(ac_fd);
+  }
+  for (int ac_fd : ac_fds) {
+    anetNonBlock(nullptr, ac_fd);
+  }
+
+  auto store = NewMemStore();
+  std::vector<std::unique_ptr<Executor>> executors;
+  for (unsigned int i = 0; i < kNumEventLoops; ++i) {
+    auto executor = OpenExecutorMem(db, store);
+    if (executor == nullptr) {
+      ROCKS_LOG_ERROR(log, "Failed creating the executor");
+      close_acceptors();
+      return 1;
+    }
+    executors.push_back(std::move(executor));
+  }
+
+  std::vector<int> results(kNumEventLoops, 0);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < kNumEventLoops; ++i) {
+    threads.emplace_back([&, i]() {
+      results[i] = RunEventLoop(runner, ac_fds[i % ac_fds.size()],
+                                executors[i].get(), env, log);
+    });
+  }
+  results[0] = RunEventLoop(runner, ac_fds[0], executors[0].get(), env, log);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  close_acceptors();
+  runner->closed_ = true;
+  for (int result : results) {
+    if (result != 0) {
+      return result;
+    }
+  }
+  return 0;
 #else
   (void)runner;
   (void)db;
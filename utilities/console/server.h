@@ -31,7 +31,6 @@ struct Client {
   std::string output;
   long last_mod_time;
   unsigned int ref_count = 0;
-  unsigned int consume_len = 0;
   bool close = false;
 
   explicit Client(long last_mod_time = -1) : last_mod_time(last_mod_time) {}
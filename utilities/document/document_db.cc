@@ -7,17 +7,26 @@
 
 #include "rocksdb/utilities/document_db.h"
 
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+
 #include "port/port.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/db.h"
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/slice.h"
+#include "rocksdb/sst_file_reader.h"
+#include "rocksdb/sst_file_writer.h"
 #include "rocksdb/table.h"
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/utilities/json_document.h"
 #include "util/coding.h"
 #include "util/mutexlock.h"
+#include "util/string_util.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -287,6 +296,9 @@ std::string InternalSecondaryIndexName(const std::string& user_name) {
   return "index_" + user_name;
 }
 
+// The index entries a thread of CreateIndex() sorts in memory at a time
+const size_t kIndexBuildBufferSize = 64 << 20;
+
 // Don't change these, they are persisted in secondary indexes
 enum JSONPrimitivesEncoding : char {
   kNull = 0x1,
@@ -715,9 +727,12 @@ class DocumentDBImpl : public DocumentDB {
   DocumentDBImpl(
       DB* db, ColumnFamilyHandle* primary_key_column_family,
       const std::vector<std::pair<Index*, ColumnFamilyHandle*>>& indexes,
-      const Options& rocksdb_options)
+      const DocumentDBOptions& options, const Options& rocksdb_options)
       : DocumentDB(db),
+        writes_done_cv_(&write_mutex_),
+        num_writes_(0),
         primary_key_column_family_(primary_key_column_family),
+        index_build_threads_(std::max(1, options.index_build_threads)),
         rocksdb_options_(rocksdb_options) {
     for (const auto& index : indexes) {
       name_to_index_.insert(
@@ -733,7 +748,7 @@ class DocumentDBImpl : public DocumentDB {
     delete primary_key_column_family_;
   }
 
-  virtual Status CreateIndex(const WriteOptions& write_options,
+  virtual Status CreateIndex(const WriteOptions& /*write_options*/,
                              const IndexDescriptor& index) override {
     auto index_obj =
         Index::CreateIndexFromDescription(*index.description, index.name);
@@ -751,21 +766,14 @@ class DocumentDBImpl : public DocumentDB {
     }
 
     MutexLock l(&write_mutex_);
+    WaitForAllDocumentWrites();
 
-    std::unique_ptr<CursorFromIterator> cursor(new CursorFromIterator(
-        DocumentDB::NewIterator(ReadOptions(), primary_key_column_family_)));
-
-    WriteBatch batch;
-    for (; cursor->Valid(); cursor->Next()) {
-      std::string secondary_index_key;
-      index_obj->GetIndexKey(cursor->document(), &secondary_index_key);
-      IndexKey index_key(Slice(secondary_index_key), cursor->key());
-      batch.Put(cf_handle, index_key.GetSliceParts(), SliceParts());
-    }
-
-    if (!cursor->status().ok()) {
+    s = BuildIndex(index_obj, cf_handle);
+    if (!s.ok()) {
+      DropColumnFamily(cf_handle);
+      delete cf_handle;
       delete index_obj;
-      return cursor->status();
+      return s;
     }
 
     {
@@ -774,11 +782,12 @@ class DocumentDBImpl : public DocumentDB {
           {index.name, IndexColumnFamily(index_obj, cf_handle)});
     }
 
-    return DocumentDB::Write(write_options, &batch);
+    return Status::OK();
   }
 
   virtual Status DropIndex(const std::string& name) override {
     MutexLock l(&write_mutex_);
+    WaitForAllDocumentWrites();
 
     auto index_iter = name_to_index_.find(name);
     if (index_iter == name_to_index_.end()) {
@@ -829,6 +838,7 @@ class DocumentDBImpl : public DocumentDB {
 
     // Lock now, since we're starting DB operations
     MutexLock l(&write_mutex_);
+    WaitForDocumentWrites({primary_key_encoded});
     // check if there is already a document with the same primary key
     LazyBuffer value;
     Status s = DocumentDB::Get(ReadOptions(), primary_key_column_family_,
@@ -847,17 +857,379 @@ class DocumentDBImpl : public DocumentDB {
                 SliceParts());
     }
 
-    return DocumentDB::Write(options, &batch);
+    return WriteDocuments(options, &batch, {primary_key_encoded});
   }
 
   virtual Status Remove(const ReadOptions& read_options,
                         const WriteOptions& write_options,
                         const JSONDocument& query) override {
     MutexLock l(&write_mutex_);
+    WriteBatch batch;
+    std::vector<std::string> keys;
+    do {
+      Status s = BatchRemove(read_options, query, &batch, &keys);
+      if (!s.ok()) {
+        return s;
+      }
+    } while (WaitForDocumentWrites(keys));
+    return WriteDocuments(write_options, &batch, keys);
+  }
+
+  virtual Status Update(const ReadOptions& read_options,
+                        const WriteOptions& write_options,
+                        const JSONDocument& filter,
+                        const JSONDocument& updates) override {
+    MutexLock l(&write_mutex_);
+    WriteBatch batch;
+    std::vector<std::string> keys;
+    do {
+      Status s = BatchUpdate(read_options, filter, updates, &batch, &keys);
+      if (!s.ok()) {
+        return s;
+      }
+    } while (WaitForDocumentWrites(keys));
+    return WriteDocuments(write_options, &batch, keys);
+  }
+
+  virtual Cursor* Query(const ReadOptions& read_options,
+                        const JSONDocument& query) override {
+    Cursor* cursor = nullptr;
+
+    if (!query.IsArray()) {
+      return new CursorError(
+          Status::InvalidArgument("Query has to be an array"));
+    }
+
+    // TODO(icanadi) support index "_id"
+    for (size_t i = 0; i < query.Count(); ++i) {
+      const auto& command_doc = query[i];
+      if (command_doc.Count() != 1) {
+        // there can be only one key-value pair in each of array elements.
+        // key is the command and value are the params
+        delete cursor;
+        return new CursorError(Status::InvalidArgument("Invalid query"));
+      }
+      const auto& command = *command_doc.Items().begin();
+
+      if (command.first == "$filter") {
+        cursor = ConstructFilterCursor(read_options, cursor, command.second);
+      } else {
+        // only filter is supported for now
+        delete cursor;
+        return new CursorError(Status::InvalidArgument("Invalid query"));
+      }
+    }
+
+    if (cursor == nullptr) {
+      cursor = new CursorFromIterator(
+          DocumentDB::NewIterator(read_options, primary_key_column_family_));
+    }
+
+    return cursor;
+  }
+
+  // RocksDB functions
+  using DB::Get;
+  virtual Status Get(const ReadOptions& /*options*/,
+                     ColumnFamilyHandle* /*column_family*/,
+                     const Slice& /*key*/, LazyBuffer* /*value*/) override {
+    return Status::NotSupported("");
+  }
+  virtual Status Get(const ReadOptions& /*options*/, const Slice& /*key*/,
+                     std::string* /*value*/) override {
+    return Status::NotSupported("");
+  }
+  virtual Status Write(const WriteOptions& /*options*/,
+                       WriteBatch* /*updates*/) override {
+    return Status::NotSupported("");
+  }
+  virtual Iterator* NewIterator(
+      const ReadOptions& /*options*/,
+      ColumnFamilyHandle* /*column_family*/) override {
+    return nullptr;
+  }
+  virtual Iterator* NewIterator(const ReadOptions& /*options*/) override {
+    return nullptr;
+  }
+
+ private:
+  // The primary keys of a range of documents, empty for unbounded, and the
+  // sorted runs of its index entries
+  struct IndexBuildRange {
+    std::string lower;
+    std::string upper;
+    std::vector<std::string> runs;
+    Status status;
+  };
+
+  // Write `batch`, changing the documents of `keys`, with the batches of the
+  // other threads writing at once
+  // REQUIRES: write_mutex_ held, no document of `keys` being written
+  Status WriteDocuments(const WriteOptions& options, WriteBatch* batch,
+                        const std::vector<std::string>& keys) {
+    writing_keys_.insert(keys.begin(), keys.end());
+    ++num_writes_;
+    write_mutex_.Unlock();
+    Status s = DocumentDB::Write(options, batch);
+    write_mutex_.Lock();
+    for (const auto& key : keys) {
+      writing_keys_.erase(key);
+    }
+    --num_writes_;
+    writes_done_cv_.SignalAll();
+    return s;
+  }
+
+  // Wait for the writes of the documents of `keys`. Returns true if any was
+  // being written, the documents read before are then stale.
+  // REQUIRES: write_mutex_ held
+  bool WaitForDocumentWrites(const std::vector<std::string>& keys) {
+    bool waited = false;
+    for (const auto& key : keys) {
+      while (writing_keys_.count(key) > 0) {
+        writes_done_cv_.Wait();
+        waited = true;
+      }
+    }
+    return waited;
+  }
+
+  // REQUIRES: write_mutex_ held
+  void WaitForAllDocumentWrites() {
+    while (num_writes_ > 0) {
+      writes_done_cv_.Wait();
+    }
+  }
+
+  // Fill the empty `column_family` with the entries of `index` for all the
+  // documents. The documents are scanned in key ranges by
+  // index_build_threads_ threads, the sorted runs of entries they write are
+  // merged into SST files of disjoint ranges and ingested at once.
+  // REQUIRES: write_mutex_ held, no document being written
+  Status BuildIndex(const Index* index, ColumnFamilyHandle* column_family) {
+    Env* env = GetEnv();
+    const std::string build_dir =
+        GetName() + "/" + column_family->GetName() + ".build";
+    Status s = env->CreateDirIfMissing(build_dir);
+    if (!s.ok()) {
+      return s;
+    }
+
+    // The ranges start at SST files of the documents, for sizes alike
+    const Comparator* comparator = primary_key_column_family_->GetComparator();
+    ColumnFamilyMetaData metadata;
+    GetColumnFamilyMetaData(primary_key_column_family_, &metadata);
+    std::vector<std::string> file_keys;
+    for (const auto& level : metadata.levels) {
+      for (const auto& file : level.files) {
+        file_keys.push_back(file.smallestkey);
+      }
+    }
+    std::sort(file_keys.begin(), file_keys.end(),
+              [comparator](const std::string& a, const std::string& b) {
+                return comparator->Compare(a, b) < 0;
+              });
+    std::vector<IndexBuildRange> ranges(1);
+    size_t num_ranges =
+        std::min(file_keys.size(), static_cast<size_t>(index_build_threads_));
+    for (size_t i = 1; i < num_ranges; ++i) {
+      const std::string& key = file_keys[i * file_keys.size() / num_ranges];
+      if (comparator->Compare(key, ranges.back().lower) > 0) {
+        ranges.back().upper = key;
+        ranges.emplace_back();
+        ranges.back().lower = key;
+      }
+    }
+
+    ReadOptions read_options;
+    read_options.snapshot = GetSnapshot();
+    read_options.fill_cache = false;
+    std::atomic<uint64_t> next_run(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+      threads.emplace_back([&, i] {
+        BuildIndexRange(index, column_family, read_options, build_dir,
+                        &next_run, &ranges[i]);
+      });
+    }
+    BuildIndexRange(index, column_family, read_options, build_dir, &next_run,
+                    &ranges[0]);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    ReleaseSnapshot(read_options.snapshot);
+
+    std::vector<std::string> runs;
+    for (const auto& range : ranges) {
+      if (s.ok()) {
+        s = range.status;
+      }
+      runs.insert(runs.end(), range.runs.begin(), range.runs.end());
+    }
+    std::vector<std::string> files;
+    if (s.ok() && runs.size() > 1) {
+      s = MergeIndexRuns(column_family, runs, build_dir, &files);
+    } else {
+      files.swap(runs);
+    }
+    if (s.ok() && !files.empty()) {
+      IngestExternalFileOptions ingest_options;
+      ingest_options.move_files = true;
+      s = IngestExternalFile(column_family, files, ingest_options);
+    }
+
+    std::vector<std::string> children;
+    env->GetChildren(build_dir, &children);
+    for (const auto& child : children) {
+      if (child != "." && child != "..") {
+        env->DeleteFile(build_dir + "/" + child);
+      }
+    }
+    env->DeleteDir(build_dir);
+    return s;
+  }
+
+  // Thread safe
+  void BuildIndexRange(const Index* index, ColumnFamilyHandle* column_family,
+                       const ReadOptions& read_options,
+                       const std::string& build_dir,
+                       std::atomic<uint64_t>* next_run,
+                       IndexBuildRange* range) {
+    ReadOptions options = read_options;
+    Slice lower(range->lower);
+    Slice upper(range->upper);
+    if (!range->lower.empty()) {
+      options.iterate_lower_bound = &lower;
+    }
+    if (!range->upper.empty()) {
+      options.iterate_upper_bound = &upper;
+    }
+    CursorFromIterator cursor(
+        DocumentDB::NewIterator(options, primary_key_column_family_));
+    std::vector<std::string> entries;
+    size_t buffered = 0;
+    for (; range->status.ok() && cursor.Valid(); cursor.Next()) {
+      std::string secondary_index_key;
+      index->GetIndexKey(cursor.document(), &secondary_index_key);
+      IndexKey index_key(Slice(secondary_index_key), cursor.key());
+      SliceParts parts = index_key.GetSliceParts();
+      entries.emplace_back();
+      for (int i = 0; i < parts.num_parts; ++i) {
+        entries.back().append(parts.parts[i].data(), parts.parts[i].size());
+      }
+      buffered += entries.back().size();
+      if (buffered >= kIndexBuildBufferSize) {
+        range->status = WriteIndexRun(column_family, build_dir, next_run,
+                                      &entries, &range->runs);
+        buffered = 0;
+      }
+    }
+    if (range->status.ok()) {
+      range->status = cursor.status();
+    }
+    if (range->status.ok() && !entries.empty()) {
+      range->status = WriteIndexRun(column_family, build_dir, next_run,
+                                    &entries, &range->runs);
+    }
+  }
+
+  // Sort `entries` into a new run file, and clear them
+  Status WriteIndexRun(ColumnFamilyHandle* column_family,
+                       const std::string& build_dir,
+                       std::atomic<uint64_t>* next_run,
+                       std::vector<std::string>* entries,
+                       std::vector<std::string>* runs) {
+    const Comparator* comparator = column_family->GetComparator();
+    std::sort(entries->begin(), entries->end(),
+              [comparator](const std::string& a, const std::string& b) {
+                return comparator->Compare(a, b) < 0;
+              });
+    runs->push_back(build_dir + "/run" +
+                    ToString(next_run->fetch_add(1)) + ".sst");
+    SstFileWriter writer(EnvOptions(), rocksdb_options_, column_family);
+    Status s = writer.Open(runs->back());
+    for (size_t i = 0; s.ok() && i < entries->size(); ++i) {
+      s = writer.Put((*entries)[i], Slice());
+    }
+    if (s.ok()) {
+      s = writer.Finish();
+    }
+    entries->clear();
+    return s;
+  }
+
+  // Merge the sorted `runs`, their entries all distinct, into `files` of
+  // disjoint ranges
+  Status MergeIndexRuns(ColumnFamilyHandle* column_family,
+                        const std::vector<std::string>& runs,
+                        const std::string& build_dir,
+                        std::vector<std::string>* files) {
+    std::vector<std::unique_ptr<SstFileReader>> readers;
+    std::vector<std::unique_ptr<Iterator>> iters;
+    for (const auto& run : runs) {
+      readers.emplace_back(new SstFileReader(rocksdb_options_));
+      Status s = readers.back()->Open(run);
+      if (!s.ok()) {
+        return s;
+      }
+      iters.emplace_back(readers.back()->NewIterator(ReadOptions()));
+      iters.back()->SeekToFirst();
+    }
+    const Comparator* comparator = column_family->GetComparator();
+    auto greater = [&](size_t a, size_t b) {
+      return comparator->Compare(iters[a]->key(), iters[b]->key()) > 0;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(
+        greater);
+    for (size_t i = 0; i < iters.size(); ++i) {
+      if (iters[i]->Valid()) {
+        heap.push(i);
+      } else if (!iters[i]->status().ok()) {
+        return iters[i]->status();
+      }
+    }
+
+    std::unique_ptr<SstFileWriter> writer;
+    Status s;
+    while (s.ok() && !heap.empty()) {
+      size_t i = heap.top();
+      heap.pop();
+      if (writer == nullptr) {
+        files->push_back(build_dir + "/" + ToString(files->size()) + ".sst");
+        writer.reset(
+            new SstFileWriter(EnvOptions(), rocksdb_options_, column_family));
+        s = writer->Open(files->back());
+      }
+      if (s.ok()) {
+        s = writer->Put(iters[i]->key(), Slice());
+      }
+      if (s.ok() &&
+          writer->FileSize() >= rocksdb_options_.target_file_size_base) {
+        s = writer->Finish();
+        writer.reset();
+      }
+      iters[i]->Next();
+      if (iters[i]->Valid()) {
+        heap.push(i);
+      } else if (s.ok()) {
+        s = iters[i]->status();
+      }
+    }
+    if (s.ok() && writer != nullptr) {
+      s = writer->Finish();
+    }
+    return s;
+  }
+
+  // The deletions of Remove(), and the primary keys of the documents
+  // REQUIRES: write_mutex_ held
+  Status BatchRemove(const ReadOptions& read_options, const JSONDocument& query,
+                     WriteBatch* batch, std::vector<std::string>* keys) {
+    batch->Clear();
+    keys->clear();
     std::unique_ptr<Cursor> cursor(
         ConstructFilterCursor(read_options, nullptr, query));
 
-    WriteBatch batch;
     for (; cursor->status().ok() && cursor->Valid(); cursor->Next()) {
       const auto& document = cursor->document();
       if (!document.IsObject()) {
@@ -881,35 +1253,33 @@ class DocumentDBImpl : public DocumentDB {
         assert(false);
       }
       Slice primary_key_slice(primary_key_encoded);
-      batch.Delete(primary_key_column_family_, primary_key_slice);
+      keys->push_back(primary_key_encoded);
+      batch->Delete(primary_key_column_family_, primary_key_slice);
 
       for (const auto& iter : name_to_index_) {
         std::string secondary_index_key;
         iter.second.index->GetIndexKey(document, &secondary_index_key);
         IndexKey index_key(Slice(secondary_index_key), primary_key_slice);
-        batch.Delete(iter.second.column_family, index_key.GetSliceParts());
+        batch->Delete(iter.second.column_family, index_key.GetSliceParts());
       }
     }
 
-    if (!cursor->status().ok()) {
-      return cursor->status();
-    }
-
-    return DocumentDB::Write(write_options, &batch);
+    return cursor->status();
   }
 
-  virtual Status Update(const ReadOptions& read_options,
-                        const WriteOptions& write_options,
-                        const JSONDocument& filter,
-                        const JSONDocument& updates) override {
-    MutexLock l(&write_mutex_);
+  // The writes of Update(), and the primary keys of the documents
+  // REQUIRES: write_mutex_ held
+  Status BatchUpdate(const ReadOptions& read_options,
+                     const JSONDocument& filter, const JSONDocument& updates,
+                     WriteBatch* batch, std::vector<std::string>* keys) {
+    batch->Clear();
+    keys->clear();
     std::unique_ptr<Cursor> cursor(
         ConstructFilterCursor(read_options, nullptr, filter));
 
     if (!updates.IsObject()) {
       return Status::Corruption("Bad update document format");
     }
-    WriteBatch batch;
     for (; cursor->status().ok() && cursor->Valid(); cursor->Next()) {
       const auto& old_document = cursor->document();
       JSONDocument new_document(old_document);
@@ -975,8 +1345,9 @@ class DocumentDBImpl : public DocumentDB {
         assert(false);
       }
       Slice primary_key_slice(primary_key_encoded);
-      batch.Put(primary_key_column_family_, primary_key_slice,
-                encoded_document);
+      keys->push_back(primary_key_encoded);
+      batch->Put(primary_key_column_family_, primary_key_slice,
+                 encoded_document);
 
       for (const auto& iter : name_to_index_) {
         std::string old_key, new_key;
@@ -990,81 +1361,16 @@ class DocumentDBImpl : public DocumentDB {
         IndexKey old_index_key(Slice(old_key), primary_key_slice);
         IndexKey new_index_key(Slice(new_key), primary_key_slice);
 
-        batch.Delete(iter.second.column_family, old_index_key.GetSliceParts());
-        batch.Put(iter.second.column_family, new_index_key.GetSliceParts(),
-                  SliceParts());
+        batch->Delete(iter.second.column_family,
+                      old_index_key.GetSliceParts());
+        batch->Put(iter.second.column_family, new_index_key.GetSliceParts(),
+                   SliceParts());
       }
     }
 
-    if (!cursor->status().ok()) {
-      return cursor->status();
-    }
-
-    return DocumentDB::Write(write_options, &batch);
+    return cursor->status();
   }
 
-  virtual Cursor* Query(const ReadOptions& read_options,
-                        const JSONDocument& query) override {
-    Cursor* cursor = nullptr;
-
-    if (!query.IsArray()) {
-      return new CursorError(
-          Status::InvalidArgument("Query has to be an array"));
-    }
-
-    // TODO(icanadi) support index "_id"
-    for (size_t i = 0; i < query.Count(); ++i) {
-      const auto& command_doc = query[i];
-      if (command_doc.Count() != 1) {
-        // there can be only one key-value pair in each of array elements.
-        // key is the command and value are the params
-        delete cursor;
-        return new CursorError(Status::InvalidArgument("Invalid query"));
-      }
-      const auto& command = *command_doc.Items().begin();
-
-      if (command.first == "$filter") {
-        cursor = ConstructFilterCursor(read_options, cursor, command.second);
-      } else {
-        // only filter is supported for now
-        delete cursor;
-        return new CursorError(Status::InvalidArgument("Invalid query"));
-      }
-    }
-
-    if (cursor == nullptr) {
-      cursor = new CursorFromIterator(
-          DocumentDB::NewIterator(read_options, primary_key_column_family_));
-    }
-
-    return cursor;
-  }
-
-  // RocksDB functions
-  using DB::Get;
-  virtual Status Get(const ReadOptions& /*options*/,
-                     ColumnFamilyHandle* /*column_family*/,
-                     const Slice& /*key*/, LazyBuffer* /*value*/) override {
-    return Status::NotSupported("");
-  }
-  virtual Status Get(const ReadOptions& /*options*/, const Slice& /*key*/,
-                     std::string* /*value*/) override {
-    return Status::NotSupported("");
-  }
-  virtual Status Write(const WriteOptions& /*options*/,
-                       WriteBatch* /*updates*/) override {
-    return Status::NotSupported("");
-  }
-  virtual Iterator* NewIterator(
-      const ReadOptions& /*options*/,
-      ColumnFamilyHandle* /*column_family*/) override {
-    return nullptr;
-  }
-  virtual Iterator* NewIterator(const ReadOptions& /*options*/) override {
-    return nullptr;
-  }
-
- private:
 #if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning(disable : 4702)  // unreachable code
@@ -1126,10 +1432,15 @@ class DocumentDBImpl : public DocumentDB {
 #pragma warning(pop)
 #endif
 
-  // currently, we lock and serialize all writes to rocksdb. reads are not
-  // locked and always get consistent view of the database. we should optimize
-  // locking in the future
+  // currently, we lock and serialize the reads of the writes to rocksdb, the
+  // batches are then written unlocked so the DB groups the batches of
+  // concurrent writes into one. A write of a document being written waits.
+  // reads are not locked and always get consistent view of the database.
   port::Mutex write_mutex_;
+  // protected by write_mutex_
+  port::CondVar writes_done_cv_;
+  std::unordered_set<std::string> writing_keys_;
+  uint64_t num_writes_;
   port::Mutex name_to_index_mutex_;
   const char* kPrimaryKey = "_id";
   struct IndexColumnFamily {
@@ -1144,6 +1455,7 @@ class DocumentDBImpl : public DocumentDB {
   // 2) when reading -- lock name_to_index_mutex_ OR write_mutex_
   std::unordered_map<std::string, IndexColumnFamily> name_to_index_;
   ColumnFamilyHandle* primary_key_column_family_;
+  const int index_build_threads_;
   Options rocksdb_options_;
 };
 
@@ -1200,7 +1512,8 @@ Status DocumentDB::Open(const DocumentDBOptions& options,
                                                    indexes[i].name);
     index_cf[i] = {index, handles[i + 1]};
   }
-  *db = new DocumentDBImpl(base_db, handles[0], index_cf, rocksdb_options);
+  *db = new DocumentDBImpl(base_db, handles[0], index_cf, options,
+                           rocksdb_options);
   return Status::OK();
 }
 
@@ -8,9 +8,11 @@
 #include "rocksdb/utilities/document_db.h"
 
 #include <algorithm>
+#include <thread>
 
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/utilities/json_document.h"
+#include "util/string_util.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
 
@@ -323,6 +325,74 @@ TEST_F(DocumentDBTest, ComplexQueryTest) {
   ASSERT_OK(db_->DropIndex("priority"));
 }
 
+TEST_F(DocumentDBTest, CreateIndexOnDocumentsAndConcurrentWrites) {
+  DocumentDBOptions options;
+  options.index_build_threads = 3;
+  ASSERT_OK(DocumentDB::Open(options, dbname_, {}, &db_));
+
+  // Three SST files of documents, scanned in three ranges
+  for (int i = 0; i < 300; ++i) {
+    std::unique_ptr<JSONDocument> document(
+        Parse("{'_id': " + ToString(i) + ", 'n': " + ToString(i % 10) + "}"));
+    ASSERT_OK(db_->Insert(WriteOptions(), *document));
+    if (i % 100 == 99) {
+      ASSERT_OK(db_->Flush(FlushOptions()));
+    }
+  }
+  DocumentDB::IndexDescriptor index;
+  index.description = Parse("{'n': 1}");
+  index.name = "n_index";
+  CreateIndexes({index});
+
+  std::vector<int64_t> expected;
+  for (int i = 3; i < 300; i += 10) {
+    expected.push_back(i);
+  }
+  std::unique_ptr<JSONDocument> query(
+      Parse("[{'$filter': {'n': 3, '$index': 'n_index'}}]"));
+  std::unique_ptr<Cursor> cursor(db_->Query(ReadOptions(), *query));
+  AssertCursorIDs(cursor.get(), expected);
+
+  // The writers of different documents, and of the same ones
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 50; ++i) {
+        std::unique_ptr<JSONDocument> document(
+            Parse("{'_id': " + ToString(1000 + t * 50 + i) + ", 'n': 3}"));
+        ASSERT_OK(db_->Insert(WriteOptions(), *document));
+      }
+      std::unique_ptr<JSONDocument> filter(
+          Parse("{'n': 3, '$index': 'n_index'}"));
+      std::unique_ptr<JSONDocument> updates(Parse("{'$set': {'n': 4}}"));
+      ASSERT_OK(
+          db_->Update(ReadOptions(), WriteOptions(), *filter, *updates));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  cursor.reset(db_->Query(ReadOptions(), *query));
+  AssertCursorIDs(cursor.get(), {});
+  query.reset(Parse("[{'$filter': {'n': 4, '$index': 'n_index'}}]"));
+  cursor.reset(db_->Query(ReadOptions(), *query));
+  for (int i = 4; i < 300; i += 10) {
+    expected.push_back(i);
+  }
+  for (int i = 1000; i < 1200; ++i) {
+    expected.push_back(i);
+  }
+  AssertCursorIDs(cursor.get(), expected);
+  cursor.reset();
+
+  delete db_;
+  db_ = nullptr;
+  ASSERT_OK(DocumentDB::Open(options, dbname_, {index}, &db_));
+  delete index.description;
+  cursor.reset(db_->Query(ReadOptions(), *query));
+  AssertCursorIDs(cursor.get(), expected);
+}
+
 }  //  namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -10,6 +10,12 @@
 
 #include "rocksdb/utilities/env_mirror.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "port/port.h"
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -262,5 +268,454 @@ Status EnvMirror::ReuseWritableFile(const std::string& fname,
   return as;
 }
 
+// The operations queued for the secondary of an AsyncMirrorEnv, done in
+// order on a thread of its own
+class AsyncMirrorQueue {
+ public:
+  explicit AsyncMirrorQueue(size_t max_queued_bytes)
+      : max_queued_bytes_(max_queued_bytes),
+        queued_bytes_(0),
+        submitted_(0),
+        done_(0),
+        closing_(false),
+        thread_(&AsyncMirrorQueue::Run, this) {}
+
+  ~AsyncMirrorQueue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+    }
+    work_cv_.notify_one();
+    thread_.join();
+  }
+
+  // Queue op, of about `bytes` bytes of data, waiting while the queue is
+  // full, and return its sequence number for Wait()
+  uint64_t Submit(size_t bytes, std::function<Status()>&& op) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&] {
+      return queued_bytes_ == 0 || queued_bytes_ + bytes <= max_queued_bytes_;
+    });
+    queued_bytes_ += bytes;
+    ops_.emplace_back(bytes, std::move(op));
+    uint64_t seq = ++submitted_;
+    lock.unlock();
+    work_cv_.notify_one();
+    return seq;
+  }
+
+  // Wait until the ops up to seq are done, and return the first error of
+  // any op done so far
+  Status Wait(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&] { return done_ >= seq; });
+    return status_;
+  }
+
+  Status WaitAll() {
+    uint64_t seq;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      seq = submitted_;
+    }
+    return Wait(seq);
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_cv_.wait(lock, [&] { return closing_ || !ops_.empty(); });
+      if (ops_.empty()) {
+        break;
+      }
+      auto op = std::move(ops_.front());
+      ops_.pop_front();
+      lock.unlock();
+      Status s = op.second();
+      lock.lock();
+      if (!s.ok() && status_.ok()) {
+        status_ = s;
+      }
+      queued_bytes_ -= op.first;
+      ++done_;
+      done_cv_.notify_all();
+    }
+  }
+
+  const size_t max_queued_bytes_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::deque<std::pair<size_t, std::function<Status()>>> ops_;
+  size_t queued_bytes_;
+  uint64_t submitted_;
+  uint64_t done_;
+  bool closing_;
+  Status status_;
+  port::Thread thread_;
+};
+
+namespace {
+// The files of the secondary, opened and then only used by the queue
+struct AsyncMirrorSecondaryFile {
+  std::unique_ptr<WritableFile> writable;
+  std::unique_ptr<RandomRWFile> random_rw;
+  std::unique_ptr<Directory> directory;
+};
+
+// Forwards everything to the primary file, and queues the writes, syncs and
+// closes for the secondary
+class AsyncMirrorWritableFile : public WritableFileWrapper {
+ public:
+  AsyncMirrorWritableFile(std::unique_ptr<WritableFile>&& primary,
+                          std::shared_ptr<AsyncMirrorSecondaryFile> secondary,
+                          AsyncMirrorQueue* queue, bool ack_both)
+      : WritableFileWrapper(primary.get()),
+        primary_(std::move(primary)),
+        secondary_(std::move(secondary)),
+        queue_(queue),
+        ack_both_(ack_both),
+        closed_(false) {}
+
+  ~AsyncMirrorWritableFile() {
+    if (!closed_) {
+      Mirror(Status::OK(), 0, [](WritableFile* f) { return f->Close(); },
+             false);
+    }
+  }
+
+  Status Append(const Slice& data) override {
+    return Mirror(WritableFileWrapper::Append(data), data.size(),
+                  [d = data.ToString()](WritableFile* f) {
+                    return f->Append(d);
+                  },
+                  false);
+  }
+  Status PositionedAppend(const Slice& data, uint64_t offset) override {
+    return Mirror(WritableFileWrapper::PositionedAppend(data, offset),
+                  data.size(),
+                  [d = data.ToString(), offset](WritableFile* f) {
+                    return f->PositionedAppend(d, offset);
+                  },
+                  false);
+  }
+  Status Truncate(uint64_t size) override {
+    return Mirror(WritableFileWrapper::Truncate(size), 0,
+                  [size](WritableFile* f) { return f->Truncate(size); },
+                  false);
+  }
+  Status Close() override {
+    closed_ = true;
+    return Mirror(WritableFileWrapper::Close(), 0,
+                  [](WritableFile* f) { return f->Close(); }, true);
+  }
+  Status Flush() override {
+    return Mirror(WritableFileWrapper::Flush(), 0,
+                  [](WritableFile* f) { return f->Flush(); }, false);
+  }
+  Status Sync() override {
+    return Mirror(WritableFileWrapper::Sync(), 0,
+                  [](WritableFile* f) { return f->Sync(); }, true);
+  }
+  Status Fsync() override {
+    return Mirror(WritableFileWrapper::Fsync(), 0,
+                  [](WritableFile* f) { return f->Fsync(); }, true);
+  }
+  Status RangeSync(uint64_t offset, uint64_t nbytes) override {
+    return Mirror(WritableFileWrapper::RangeSync(offset, nbytes), 0,
+                  [offset, nbytes](WritableFile* f) {
+                    return f->RangeSync(offset, nbytes);
+                  },
+                  false);
+  }
+
+ private:
+  // Queue op for the secondary if the primary did it, and wait for it if it
+  // is a sync point of kAckBoth
+  Status Mirror(const Status& s, size_t bytes,
+                std::function<Status(WritableFile*)>&& op, bool sync_point) {
+    if (!s.ok()) {
+      return s;
+    }
+    auto secondary = secondary_;
+    uint64_t seq = queue_->Submit(bytes, [secondary, op]() {
+      // Not opened, the queue has the error of the open already
+      return secondary->writable ? op(secondary->writable.get())
+                                 : Status::OK();
+    });
+    if (sync_point && ack_both_) {
+      return queue_->Wait(seq);
+    }
+    return s;
+  }
+
+  std::unique_ptr<WritableFile> primary_;
+  std::shared_ptr<AsyncMirrorSecondaryFile> secondary_;
+  AsyncMirrorQueue* queue_;
+  bool ack_both_;
+  bool closed_;
+};
+
+class AsyncMirrorRandomRWFile : public RandomRWFileWrapper {
+ public:
+  AsyncMirrorRandomRWFile(std::unique_ptr<RandomRWFile>&& primary,
+                          std::shared_ptr<AsyncMirrorSecondaryFile> secondary,
+                          AsyncMirrorQueue* queue, bool ack_both)
+      : RandomRWFileWrapper(primary.get()),
+        primary_(std::move(primary)),
+        secondary_(std::move(secondary)),
+        queue_(queue),
+        ack_both_(ack_both) {}
+
+  Status Write(uint64_t offset, const Slice& data) override {
+    return Mirror(RandomRWFileWrapper::Write(offset, data), data.size(),
+                  [offset, d = data.ToString()](RandomRWFile* f) {
+                    return f->Write(offset, d);
+                  },
+                  false);
+  }
+  Status Flush() override {
+    return Mirror(RandomRWFileWrapper::Flush(), 0,
+                  [](RandomRWFile* f) { return f->Flush(); }, false);
+  }
+  Status Sync() override {
+    return Mirror(RandomRWFileWrapper::Sync(), 0,
+                  [](RandomRWFile* f) { return f->Sync(); }, true);
+  }
+  Status Fsync() override {
+    return Mirror(RandomRWFileWrapper::Fsync(), 0,
+                  [](RandomRWFile* f) { return f->Fsync(); }, true);
+  }
+  Status Close() override {
+    return Mirror(RandomRWFileWrapper::Close(), 0,
+                  [](RandomRWFile* f) { return f->Close(); }, true);
+  }
+
+ private:
+  Status Mirror(const Status& s, size_t bytes,
+                std::function<Status(RandomRWFile*)>&& op, bool sync_point) {
+    if (!s.ok()) {
+      return s;
+    }
+    auto secondary = secondary_;
+    uint64_t seq = queue_->Submit(bytes, [secondary, op]() {
+      return secondary->random_rw ? op(secondary->random_rw.get())
+                                  : Status::OK();
+    });
+    if (sync_point && ack_both_) {
+      return queue_->Wait(seq);
+    }
+    return s;
+  }
+
+  std::unique_ptr<RandomRWFile> primary_;
+  std::shared_ptr<AsyncMirrorSecondaryFile> secondary_;
+  AsyncMirrorQueue* queue_;
+  bool ack_both_;
+};
+
+class AsyncMirrorDirectory : public DirectoryWrapper {
+ public:
+  AsyncMirrorDirectory(std::unique_ptr<Directory>&& primary,
+                       std::shared_ptr<AsyncMirrorSecondaryFile> secondary,
+                       AsyncMirrorQueue* queue, bool ack_both)
+      : DirectoryWrapper(primary.get()),
+        primary_(std::move(primary)),
+        secondary_(std::move(secondary)),
+        queue_(queue),
+        ack_both_(ack_both) {}
+
+  Status Fsync() override {
+    Status s = DirectoryWrapper::Fsync();
+    if (!s.ok()) {
+      return s;
+    }
+    auto secondary = secondary_;
+    uint64_t seq = queue_->Submit(0, [secondary]() {
+      return secondary->directory ? secondary->directory->Fsync()
+                                  : Status::OK();
+    });
+    if (ack_both_) {
+      return queue_->Wait(seq);
+    }
+    return s;
+  }
+
+ private:
+  std::unique_ptr<Directory> primary_;
+  std::shared_ptr<AsyncMirrorSecondaryFile> secondary_;
+  AsyncMirrorQueue* queue_;
+  bool ack_both_;
+};
+}  // namespace
+
+AsyncMirrorEnv::AsyncMirrorEnv(Env* primary, Env* secondary,
+                               const AsyncMirrorEnvOptions& options)
+    : EnvWrapper(primary),
+      secondary_(secondary),
+      options_(options),
+      queue_(new AsyncMirrorQueue(options.max_queued_bytes)) {}
+
+AsyncMirrorEnv::~AsyncMirrorEnv() { queue_.reset(); }
+
+Status AsyncMirrorEnv::NewWritableFile(const std::string& f,
+                                       std::unique_ptr<WritableFile>* r,
+                                       const EnvOptions& options) {
+  std::unique_ptr<WritableFile> primary;
+  Status s = target()->NewWritableFile(f, &primary, options);
+  if (!s.ok()) {
+    return s;
+  }
+  auto secondary = std::make_shared<AsyncMirrorSecondaryFile>();
+  Env* secondary_env = secondary_;
+  queue_->Submit(0, [secondary, secondary_env, f, options]() {
+    return secondary_env->NewWritableFile(f, &secondary->writable, options);
+  });
+  r->reset(new AsyncMirrorWritableFile(
+      std::move(primary), std::move(secondary), queue_.get(),
+      options_.ack_mode == AsyncMirrorEnvOptions::kAckBoth));
+  return s;
+}
+
+Status AsyncMirrorEnv::ReuseWritableFile(const std::string& fname,
+                                         const std::string& old_fname,
+                                         std::unique_ptr<WritableFile>* r,
+                                         const EnvOptions& options) {
+  std::unique_ptr<WritableFile> primary;
+  Status s = target()->ReuseWritableFile(fname, old_fname, &primary, options);
+  if (!s.ok()) {
+    return s;
+  }
+  auto secondary = std::make_shared<AsyncMirrorSecondaryFile>();
+  Env* secondary_env = secondary_;
+  queue_->Submit(0, [secondary, secondary_env, fname, old_fname, options]() {
+    return secondary_env->ReuseWritableFile(fname, old_fname,
+                                            &secondary->writable, options);
+  });
+  r->reset(new AsyncMirrorWritableFile(
+      std::move(primary), std::move(secondary), queue_.get(),
+      options_.ack_mode == AsyncMirrorEnvOptions::kAckBoth));
+  return s;
+}
+
+Status AsyncMirrorEnv::NewRandomRWFile(const std::string& f,
+                                       std::unique_ptr<RandomRWFile>* r,
+                                       const EnvOptions& options) {
+  std::unique_ptr<RandomRWFile> primary;
+  Status s = target()->NewRandomRWFile(f, &primary, options);
+  if (!s.ok()) {
+    return s;
+  }
+  auto secondary = std::make_shared<AsyncMirrorSecondaryFile>();
+  Env* secondary_env = secondary_;
+  queue_->Submit(0, [secondary, secondary_env, f, options]() {
+    return secondary_env->NewRandomRWFile(f, &secondary->random_rw, options);
+  });
+  r->reset(new AsyncMirrorRandomRWFile(
+      std::move(primary), std::move(secondary), queue_.get(),
+      options_.ack_mode == AsyncMirrorEnvOptions::kAckBoth));
+  return s;
+}
+
+Status AsyncMirrorEnv::NewDirectory(const std::string& name,
+                                    std::unique_ptr<Directory>* result) {
+  std::unique_ptr<Directory> primary;
+  Status s = target()->NewDirectory(name, &primary);
+  if (!s.ok()) {
+    return s;
+  }
+  auto secondary = std::make_shared<AsyncMirrorSecondaryFile>();
+  Env* secondary_env = secondary_;
+  queue_->Submit(0, [secondary, secondary_env, name]() {
+    return secondary_env->NewDirectory(name, &secondary->directory);
+  });
+  result->reset(new AsyncMirrorDirectory(
+      std::move(primary), std::move(secondary), queue_.get(),
+      options_.ack_mode == AsyncMirrorEnvOptions::kAckBoth));
+  return s;
+}
+
+Status AsyncMirrorEnv::DeleteFile(const std::string& f) {
+  Status s = target()->DeleteFile(f);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, f]() {
+      return secondary_env->DeleteFile(f);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::CreateDir(const std::string& d) {
+  Status s = target()->CreateDir(d);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, d]() {
+      return secondary_env->CreateDir(d);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::CreateDirIfMissing(const std::string& d) {
+  Status s = target()->CreateDirIfMissing(d);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, d]() {
+      return secondary_env->CreateDirIfMissing(d);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::DeleteDir(const std::string& d) {
+  Status s = target()->DeleteDir(d);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, d]() {
+      return secondary_env->DeleteDir(d);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::Truncate(const std::string& f, size_t size) {
+  Status s = target()->Truncate(f, size);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, f, size]() {
+      return secondary_env->Truncate(f, size);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::RenameFile(const std::string& src,
+                                  const std::string& target_name) {
+  Status s = target()->RenameFile(src, target_name);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, src, target_name]() {
+      return secondary_env->RenameFile(src, target_name);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::LinkFile(const std::string& src,
+                                const std::string& target_name) {
+  Status s = target()->LinkFile(src, target_name);
+  if (s.ok()) {
+    Env* secondary_env = secondary_;
+    queue_->Submit(0, [secondary_env, src, target_name]() {
+      return secondary_env->LinkFile(src, target_name);
+    });
+  }
+  return s;
+}
+
+Status AsyncMirrorEnv::WaitForSecondary() { return queue_->WaitAll(); }
+
 }  // namespace TERARKDB_NAMESPACE
 #endif
@@ -207,6 +207,75 @@ TEST_F(EnvMirrorTest, LargeWrite) {
   delete[] scratch;
 }
 
+class AsyncMirrorEnvTest : public testing::Test {
+ public:
+  Env* base_;
+  MockEnv* a_;
+  MockEnv* b_;
+
+  AsyncMirrorEnvTest()
+      : base_(Env::Default()), a_(new MockEnv(base_)), b_(new MockEnv(base_)) {}
+  ~AsyncMirrorEnvTest() {
+    delete a_;
+    delete b_;
+  }
+
+  void Check(Env* env, const std::string& fname, const std::string& data) {
+    std::unique_ptr<SequentialFile> file;
+    ASSERT_OK(env->NewSequentialFile(fname, &file, EnvOptions()));
+    std::string scratch(data.size() + 1, '\0');
+    Slice result;
+    ASSERT_OK(file->Read(scratch.size(), &result, &scratch[0]));
+    ASSERT_EQ(data, result.ToString());
+  }
+};
+
+TEST_F(AsyncMirrorEnvTest, WriteAndRename) {
+  for (auto ack_mode : {AsyncMirrorEnvOptions::kAckPrimary,
+                        AsyncMirrorEnvOptions::kAckBoth}) {
+    AsyncMirrorEnvOptions options;
+    options.ack_mode = ack_mode;
+    // Small, so writes wait for the queue
+    options.max_queued_bytes = 16;
+    std::unique_ptr<AsyncMirrorEnv> env(
+        new AsyncMirrorEnv(a_, b_, options));
+
+    ASSERT_OK(env->CreateDirIfMissing("/dir"));
+    std::unique_ptr<WritableFile> file;
+    ASSERT_OK(env->NewWritableFile("/dir/f", &file, EnvOptions()));
+    std::string data;
+    for (int i = 0; i < 100; ++i) {
+      std::string s = "data" + std::to_string(i);
+      ASSERT_OK(file->Append(s));
+      data += s;
+    }
+    ASSERT_OK(file->Sync());
+    ASSERT_OK(file->Close());
+    file.reset();
+    ASSERT_OK(env->RenameFile("/dir/f", "/dir/g"));
+    ASSERT_OK(env->WaitForSecondary());
+
+    Check(a_, "/dir/g", data);
+    Check(b_, "/dir/g", data);
+    ASSERT_TRUE(b_->FileExists("/dir/f").IsNotFound());
+
+    ASSERT_OK(env->DeleteFile("/dir/g"));
+    env.reset();
+    ASSERT_TRUE(b_->FileExists("/dir/g").IsNotFound());
+  }
+}
+
+TEST_F(AsyncMirrorEnvTest, SecondaryError) {
+  AsyncMirrorEnv env(a_, b_);
+  std::unique_ptr<WritableFile> file;
+  // Only on the primary, so renaming it fails on the secondary
+  ASSERT_OK(a_->NewWritableFile("/f", &file, EnvOptions()));
+  ASSERT_OK(file->Close());
+  ASSERT_OK(env.RenameFile("/f", "/g"));
+  ASSERT_OK(a_->FileExists("/g"));
+  ASSERT_TRUE(env.WaitForSecondary().IsIOError());
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
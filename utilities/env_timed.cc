@@ -3,39 +3,80 @@
 //  COPYING file in the root directory) and Apache 2.0 License
 //  (found in the LICENSE.Apache file in the root directory).
 
+#include <algorithm>
+
 #include "monitoring/perf_context_imp.h"
 #include "rocksdb/env.h"
 #include "rocksdb/status.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/random.h"
 
 namespace TERARKDB_NAMESPACE {
 
 #ifndef ROCKSDB_LITE
 
+namespace {
+// Times a call with a probability of 1 / sample_every, and adds sample_every
+// times its duration to the metric, so that the metric estimates the time of
+// all the calls, only paying for the clock on a few of them
+class SampledPerfTimer {
+ public:
+  SampledPerfTimer(uint64_t* metric, uint32_t sample_every)
+      : metric_(metric), sample_every_(sample_every), start_(0) {
+    if (perf_level >= PerfLevel::kEnableTime &&
+        (sample_every_ <= 1 ||
+         Random::GetTLSInstance()->OneIn(static_cast<int>(sample_every_)))) {
+      start_ = Env::Default()->NowNanos();
+    }
+  }
+
+  ~SampledPerfTimer() {
+    if (start_) {
+      uint64_t duration = Env::Default()->NowNanos() - start_;
+      *metric_ += duration * std::max<uint32_t>(sample_every_, 1);
+    }
+  }
+
+ private:
+  uint64_t* metric_;
+  uint32_t sample_every_;
+  uint64_t start_;
+};
+}  // namespace
+
+#if defined(NPERF_CONTEXT)
+#define TIMED_ENV_GUARD(metric)
+#else
+#define TIMED_ENV_GUARD(metric) \
+  SampledPerfTimer sampled_timer_##metric(&(perf_context.metric), sample_every_)
+#endif
+
 // An environment that measures function call times for filesystem
-// operations, reporting results to variables in PerfContext.
+// operations, reporting results to variables in PerfContext. Only 1 in
+// sample_every calls are timed, see SampledPerfTimer.
 class TimedEnv : public EnvWrapper {
  public:
-  explicit TimedEnv(Env* base_env) : EnvWrapper(base_env) {}
+  explicit TimedEnv(Env* base_env, uint32_t sample_every = 1)
+      : EnvWrapper(base_env), sample_every_(sample_every) {}
 
   virtual Status NewSequentialFile(const std::string& fname,
                                    std::unique_ptr<SequentialFile>* result,
                                    const EnvOptions& options) override {
-    PERF_TIMER_GUARD(env_new_sequential_file_nanos);
+    TIMED_ENV_GUARD(env_new_sequential_file_nanos);
     return EnvWrapper::NewSequentialFile(fname, result, options);
   }
 
   virtual Status NewRandomAccessFile(const std::string& fname,
                                      std::unique_ptr<RandomAccessFile>* result,
                                      const EnvOptions& options) override {
-    PERF_TIMER_GUARD(env_new_random_access_file_nanos);
+    TIMED_ENV_GUARD(env_new_random_access_file_nanos);
     return EnvWrapper::NewRandomAccessFile(fname, result, options);
   }
 
   virtual Status NewWritableFile(const std::string& fname,
                                  std::unique_ptr<WritableFile>* result,
                                  const EnvOptions& options) override {
-    PERF_TIMER_GUARD(env_new_writable_file_nanos);
+    TIMED_ENV_GUARD(env_new_writable_file_nanos);
     return EnvWrapper::NewWritableFile(fname, result, options);
   }
 
@@ -43,107 +84,118 @@ class TimedEnv : public EnvWrapper {
                                    const std::string& old_fname,
                                    std::unique_ptr<WritableFile>* result,
                                    const EnvOptions& options) override {
-    PERF_TIMER_GUARD(env_reuse_writable_file_nanos);
+    TIMED_ENV_GUARD(env_reuse_writable_file_nanos);
     return EnvWrapper::ReuseWritableFile(fname, old_fname, result, options);
   }
 
   virtual Status NewRandomRWFile(const std::string& fname,
                                  std::unique_ptr<RandomRWFile>* result,
                                  const EnvOptions& options) override {
-    PERF_TIMER_GUARD(env_new_random_rw_file_nanos);
+    TIMED_ENV_GUARD(env_new_random_rw_file_nanos);
     return EnvWrapper::NewRandomRWFile(fname, result, options);
   }
 
   virtual Status NewDirectory(const std::string& name,
                               std::unique_ptr<Directory>* result) override {
-    PERF_TIMER_GUARD(env_new_directory_nanos);
+    TIMED_ENV_GUARD(env_new_directory_nanos);
     return EnvWrapper::NewDirectory(name, result);
   }
 
   virtual Status FileExists(const std::string& fname) override {
-    PERF_TIMER_GUARD(env_file_exists_nanos);
+    TIMED_ENV_GUARD(env_file_exists_nanos);
     return EnvWrapper::FileExists(fname);
   }
 
   virtual Status GetChildren(const std::string& dir,
                              std::vector<std::string>* result) override {
-    PERF_TIMER_GUARD(env_get_children_nanos);
+    TIMED_ENV_GUARD(env_get_children_nanos);
     return EnvWrapper::GetChildren(dir, result);
   }
 
   virtual Status GetChildrenFileAttributes(
       const std::string& dir, std::vector<FileAttributes>* result) override {
-    PERF_TIMER_GUARD(env_get_children_file_attributes_nanos);
+    TIMED_ENV_GUARD(env_get_children_file_attributes_nanos);
     return EnvWrapper::GetChildrenFileAttributes(dir, result);
   }
 
   virtual Status DeleteFile(const std::string& fname) override {
-    PERF_TIMER_GUARD(env_delete_file_nanos);
+    TIMED_ENV_GUARD(env_delete_file_nanos);
     return EnvWrapper::DeleteFile(fname);
   }
 
   virtual Status CreateDir(const std::string& dirname) override {
-    PERF_TIMER_GUARD(env_create_dir_nanos);
+    TIMED_ENV_GUARD(env_create_dir_nanos);
     return EnvWrapper::CreateDir(dirname);
   }
 
   virtual Status CreateDirIfMissing(const std::string& dirname) override {
-    PERF_TIMER_GUARD(env_create_dir_if_missing_nanos);
+    TIMED_ENV_GUARD(env_create_dir_if_missing_nanos);
     return EnvWrapper::CreateDirIfMissing(dirname);
   }
 
   virtual Status DeleteDir(const std::string& dirname) override {
-    PERF_TIMER_GUARD(env_delete_dir_nanos);
+    TIMED_ENV_GUARD(env_delete_dir_nanos);
     return EnvWrapper::DeleteDir(dirname);
   }
 
   virtual Status GetFileSize(const std::string& fname,
                              uint64_t* file_size) override {
-    PERF_TIMER_GUARD(env_get_file_size_nanos);
+    TIMED_ENV_GUARD(env_get_file_size_nanos);
     return EnvWrapper::GetFileSize(fname, file_size);
   }
 
   virtual Status GetFileModificationTime(const std::string& fname,
                                          uint64_t* file_mtime) override {
-    PERF_TIMER_GUARD(env_get_file_modification_time_nanos);
+    TIMED_ENV_GUARD(env_get_file_modification_time_nanos);
     return EnvWrapper::GetFileModificationTime(fname, file_mtime);
   }
 
   virtual Status RenameFile(const std::string& src,
                             const std::string& dst) override {
-    PERF_TIMER_GUARD(env_rename_file_nanos);
+    TIMED_ENV_GUARD(env_rename_file_nanos);
     return EnvWrapper::RenameFile(src, dst);
   }
 
   virtual Status LinkFile(const std::string& src,
                           const std::string& dst) override {
-    PERF_TIMER_GUARD(env_link_file_nanos);
+    TIMED_ENV_GUARD(env_link_file_nanos);
     return EnvWrapper::LinkFile(src, dst);
   }
 
   virtual Status LockFile(const std::string& fname, FileLock** lock) override {
-    PERF_TIMER_GUARD(env_lock_file_nanos);
+    TIMED_ENV_GUARD(env_lock_file_nanos);
     return EnvWrapper::LockFile(fname, lock);
   }
 
   virtual Status UnlockFile(FileLock* lock) override {
-    PERF_TIMER_GUARD(env_unlock_file_nanos);
+    TIMED_ENV_GUARD(env_unlock_file_nanos);
     return EnvWrapper::UnlockFile(lock);
   }
 
   virtual Status NewLogger(const std::string& fname,
                            std::shared_ptr<Logger>* result) override {
-    PERF_TIMER_GUARD(env_new_logger_nanos);
+    TIMED_ENV_GUARD(env_new_logger_nanos);
     return EnvWrapper::NewLogger(fname, result);
   }
+
+ private:
+  const uint32_t sample_every_;
 };
 
 Env* NewTimedEnv(Env* base_env) { return new TimedEnv(base_env); }
 
+Env* NewTimedEnv(Env* base_env, uint32_t sample_every) {
+  return new TimedEnv(base_env, sample_every);
+}
+
 #else  // ROCKSDB_LITE
 
 Env* NewTimedEnv(Env* /*base_env*/) { return nullptr; }
 
+Env* NewTimedEnv(Env* /*base_env*/, uint32_t /*sample_every*/) {
+  return nullptr;
+}
+
 #endif  // !ROCKSDB_LITE
 
 }  // namespace TERARKDB_NAMESPACE
@@ -26,6 +26,20 @@ TEST_F(TimedEnvTest, BasicTest) {
   ASSERT_GT(get_perf_context()->env_new_writable_file_nanos, 0);
 }
 
+TEST_F(TimedEnvTest, Sampled) {
+  SetPerfLevel(PerfLevel::kEnableTime);
+  get_perf_context()->Reset();
+
+  std::unique_ptr<Env> mem_env(NewMemEnv(Env::Default()));
+  std::unique_ptr<Env> timed_env(NewTimedEnv(mem_env.get(), 4));
+  std::unique_ptr<WritableFile> writable_file;
+  // Times about one in 4 of them, so surely some of 1000
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_OK(timed_env->NewWritableFile("f", &writable_file, EnvOptions()));
+  }
+  ASSERT_GT(get_perf_context()->env_new_writable_file_nanos, 0);
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -15,6 +15,20 @@
 namespace TERARKDB_NAMESPACE {
 namespace flink {
 
+namespace {
+bool DebugEnabled(const std::shared_ptr<Logger>& logger) {
+  return logger && logger->GetInfoLogLevel() <= InfoLogLevel::DEBUG_LEVEL;
+}
+
+// A timestamp near JAVA_MAX_LONG never expires instead of overflowing
+inline bool IsExpired(int64_t timestamp, int64_t ttl,
+                      int64_t current_timestamp) {
+  const int64_t ttlWithoutOverflow =
+      timestamp > 0 ? std::min(JAVA_MAX_LONG - timestamp, ttl) : ttl;
+  return timestamp + ttlWithoutOverflow <= current_timestamp;
+}
+}  // namespace
+
 int64_t DeserializeTimestamp(const char* src, std::size_t offset) {
   uint64_t result = 0;
   for (unsigned long i = 0; i < sizeof(uint64_t); i++) {
@@ -29,14 +43,12 @@ CompactionFilter::Decision Decide(const char* ts_bytes, const int64_t ttl,
                                   const int64_t current_timestamp,
                                   const std::shared_ptr<Logger>& logger) {
   int64_t timestamp = DeserializeTimestamp(ts_bytes, timestamp_offset);
-  const int64_t ttlWithoutOverflow =
-      timestamp > 0 ? std::min(JAVA_MAX_LONG - timestamp, ttl) : ttl;
   Debug(logger.get(),
-        "Last access timestamp: %" PRIi64 " ms, ttlWithoutOverflow: %" PRIi64
+        "Last access timestamp: %" PRIi64 " ms, ttl: %" PRIi64
         " ms, Current "
         "timestamp: %" PRIi64 " ms",
-        timestamp, ttlWithoutOverflow, current_timestamp);
-  return timestamp + ttlWithoutOverflow <= current_timestamp
+        timestamp, ttl, current_timestamp);
+  return IsExpired(timestamp, ttl, current_timestamp)
              ? CompactionFilter::Decision::kRemove
              : CompactionFilter::Decision::kKeep;
 }
@@ -72,20 +84,23 @@ FlinkCompactionFilter::ConfigHolder::GetConfig() {
 
 std::size_t FlinkCompactionFilter::FixedListElementFilter::NextUnexpiredOffset(
     const Slice& list, int64_t ttl, int64_t current_timestamp) const {
+  // Long lists are scanned element by element on every compaction, keep the
+  // loop free of logging and decide by the timestamps alone
+  const char* data = list.data();
+  const std::size_t size = list.size();
   std::size_t offset = 0;
-  while (offset < list.size()) {
-    Decision decision = Decide(list.data(), ttl, offset + timestamp_offset_,
-                               current_timestamp, logger_);
-    if (decision != Decision::kKeep) {
-      std::size_t new_offset = offset + fixed_size_;
-      if (new_offset >= JAVA_MAX_SIZE || new_offset < offset) {
-        return JAVA_MAX_SIZE;
-      }
-      offset = new_offset;
-    } else {
-      break;
+  while (offset < size &&
+         IsExpired(DeserializeTimestamp(data, offset + timestamp_offset_), ttl,
+                   current_timestamp)) {
+    std::size_t new_offset = offset + fixed_size_;
+    if (new_offset >= JAVA_MAX_SIZE || new_offset < offset) {
+      return JAVA_MAX_SIZE;
     }
+    offset = new_offset;
   }
+  Debug(logger_.get(),
+        "Fixed list: %zd bytes, element size: %zd, next unexpired offset: %zd",
+        size, fixed_size_, offset);
   return offset;
 }
 
@@ -117,43 +132,50 @@ CompactionFilter::Decision FlinkCompactionFilter::FilterV2(
     int /*level*/, const Slice& key, ValueType value_type,
     const Slice& /*existing_value_meta*/, const LazyBuffer& existing_lazy_value,
     LazyBuffer* new_value, std::string* /*skip_until*/) const {
+  InitConfigIfNotYet();
+  CreateListElementFilterIfNull();
+  UpdateCurrentTimestampIfStale();
+
+  const StateType state_type = config_cached_->state_type_;
+  const bool value_or_merge =
+      value_type == ValueType::kValue || value_type == ValueType::kMergeOperand;
+  const bool value_state =
+      state_type == StateType::Value && value_type == ValueType::kValue;
+  const bool list_entry = state_type == StateType::List && value_or_merge;
+  const bool toDecide = value_state || list_entry;
+  const bool list_filter = list_entry && list_element_filter_;
+  // Entries that are kept anyway don't need their values, which may be
+  // separated into blobs
+  if (!toDecide) {
+    return Decision::kKeep;
+  }
+
   auto s = existing_lazy_value.fetch();
   if (!s.ok()) {
     new_value->reset(std::move(s));
     return CompactionFilter::Decision::kKeep;
   }
   const Slice& existing_value = existing_lazy_value.slice();
-
-  InitConfigIfNotYet();
-  CreateListElementFilterIfNull();
-  UpdateCurrentTimestampIfStale();
-
   const char* data = existing_value.data();
 
-  Debug(logger_.get(),
-        "Call FlinkCompactionFilter::FilterV2 - Key: %s, Data: %s, Value type: "
-        "%d, "
-        "State type: %d, TTL: %" PRIi64 " ms, timestamp_offset: %zd",
-        key.ToString().c_str(), existing_value.ToString(true).c_str(),
-        value_type, config_cached_->state_type_, config_cached_->ttl_,
-        config_cached_->timestamp_offset_);
+  // Hex dumping every entry costs more than filtering it
+  if (DebugEnabled(logger_)) {
+    Debug(logger_.get(),
+          "Call FlinkCompactionFilter::FilterV2 - Key: %s, Data: %s, Value "
+          "type: %d, State type: %d, TTL: %" PRIi64
+          " ms, timestamp_offset: %zd",
+          key.ToString().c_str(), existing_value.ToString(true).c_str(),
+          value_type, state_type, config_cached_->ttl_,
+          config_cached_->timestamp_offset_);
+  }
 
   // too short value to have timestamp at all
   const bool tooShortValue =
       existing_value.size() <
       config_cached_->timestamp_offset_ + TIMESTAMP_BYTE_SIZE;
 
-  const StateType state_type = config_cached_->state_type_;
-  const bool value_or_merge =
-      value_type == ValueType::kValue || value_type == ValueType::kMergeOperand;
-  const bool value_state =
-      state_type == StateType::Value && value_type == ValueType::kValue;
-  const bool list_entry = state_type == StateType::List && value_or_merge;
-  const bool toDecide = value_state || list_entry;
-  const bool list_filter = list_entry && list_element_filter_;
-
   Decision decision = Decision::kKeep;
-  if (!tooShortValue && toDecide) {
+  if (!tooShortValue) {
     decision = list_filter ? ListDecide(existing_value, new_value)
                            : Decide(data, config_cached_->ttl_,
                                     config_cached_->timestamp_offset_,
@@ -213,10 +235,10 @@ void FlinkCompactionFilter::SetUnexpiredListValue(const Slice& existing_value,
   // new_value->assign(new_value_char, new_value_size);
   new_value->reset(Slice(new_value_char, new_value_size), true);
 
-  Logger* logger = logger_.get();
-  if (logger && logger->GetInfoLogLevel() <= InfoLogLevel::DEBUG_LEVEL) {
+  if (DebugEnabled(logger_)) {
     Slice new_value_slice = Slice(new_value_char, new_value_size);
-    Debug(logger, "New list value: %s", new_value_slice.ToString(true).c_str());
+    Debug(logger_.get(), "New list value: %s",
+          new_value_slice.ToString(true).c_str());
   }
 }
 }  // namespace flink
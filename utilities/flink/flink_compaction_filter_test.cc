@@ -214,6 +214,26 @@ TEST(FlinkListStateTtlTest, HalfExpired) {  // NOLINT
   Deinit();
 }
 
+TEST(FlinkListStateTtlTest, LongListPrefixExpired) {  // NOLINT
+  InitList(KMERGE);
+  const std::size_t kElements = 1000;
+  const std::size_t kExpired = 777;
+  std::string list(kElements * LIST_ELEM_FIXED_LEN, 'x');
+  for (std::size_t i = 0; i < kElements; i++) {
+    // A timestamp that would overflow with the ttl added never expires
+    int64_t timestamp = i < kExpired ? time - ttl - 20 - int64_t(i)
+                                     : JAVA_MAX_LONG - int64_t(i);
+    SetTimestamp(timestamp, i * LIST_ELEM_FIXED_LEN, &list[0]);
+  }
+  EXPECT_EQ(filter->FilterV2(0, key, KMERGE, nullptr, LazyBuffer(list),
+                             &new_list, &stub),
+            KCHANGE);
+  std::size_t offset = kExpired * LIST_ELEM_FIXED_LEN;
+  ASSERT_EQ(new_list.size(), list.size() - offset);
+  EXPECT_ARR_EQ(new_list.data(), list.data() + offset, new_list.size());
+  Deinit();
+}
+
 // TEST(FlinkListStateTtlTest, WrongFilterValueType) {  // NOLINT
 //   InitList(KBLOB, true);
 //   EXPECT_EQ(decide(), KKEEP);
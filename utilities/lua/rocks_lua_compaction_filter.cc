@@ -12,17 +12,71 @@ extern "C" {
 
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/thread_local.h"
 
 namespace TERARKDB_NAMESPACE {
 namespace lua {
 
 const std::string kFilterFunctionName = "Filter";
+const std::string kFilterBatchFunctionName = "FilterBatch";
 const std::string kNameFunctionName = "Name";
 
+namespace {
+void DeleteLuaState(void* ptr) { delete static_cast<LuaStateWrapper*>(ptr); }
+}  // namespace
+
+RocksLuaCompactionFilter::RocksLuaCompactionFilter(
+    const RocksLuaCompactionFilterOptions& opt)
+    : options_(opt),
+      lua_states_(new ThreadLocalPtr(&DeleteLuaState)),
+      error_count_(0) {
+  auto* lua_state = GetLuaState();
+  // push the right function into the lua stack
+  lua_getglobal(lua_state, kNameFunctionName.c_str());
+
+  // perform the call (0 arguments, 1 result)
+  int error_no;
+  if ((error_no = lua_pcall(lua_state, 0, 1, 0)) != 0) {
+    LogLuaError("[Lua] Error(%d) in Name function --- %s", error_no,
+                lua_tostring(lua_state, -1));
+    // pops out the lua error from stack
+    lua_pop(lua_state, 1);
+    return;
+  }
+
+  // check the return value
+  if (!lua_isstring(lua_state, -1)) {
+    LogLuaError(
+        "[Lua] Error in Name function -- "
+        "return value is not a string while string is expected");
+  } else {
+    const char* name_buf = lua_tostring(lua_state, -1);
+    const size_t name_size __attribute__((__unused__)) =
+        lua_strlen(lua_state, -1);
+    assert(name_buf[name_size] == '\0');
+    assert(strlen(name_buf) <= name_size);
+    name_ = name_buf;
+  }
+  lua_pop(lua_state, 1);
+}
+
+RocksLuaCompactionFilter::~RocksLuaCompactionFilter() {}
+
+lua_State* RocksLuaCompactionFilter::GetLuaState() const {
+  auto* wrapper = static_cast<LuaStateWrapper*>(lua_states_->Get());
+  if (wrapper == nullptr) {
+    wrapper = new LuaStateWrapper(options_.lua_script, options_.libraries);
+    lua_states_->Reset(wrapper);
+  }
+  return wrapper->GetLuaState();
+}
+
 void RocksLuaCompactionFilter::LogLuaError(const char* format, ...) const {
   if (options_.error_log.get() != nullptr &&
-      error_count_ < options_.error_limit_per_filter) {
-    error_count_++;
+      error_count_.load(std::memory_order_relaxed) <
+          options_.error_limit_per_filter &&
+      error_count_.fetch_add(1, std::memory_order_relaxed) <
+          options_.error_limit_per_filter) {
 
     va_list ap;
     va_start(ap, format);
@@ -35,14 +89,28 @@ bool RocksLuaCompactionFilter::Filter(int level, const Slice& key,
                                       const Slice& existing_value,
                                       std::string* new_value,
                                       bool* value_changed) const {
-  auto* lua_state = lua_state_wrapper_.GetLuaState();
+  auto* lua_state = GetLuaState();
   // push the right function into the lua stack
   lua_getglobal(lua_state, kFilterFunctionName.c_str());
 
   int error_no = 0;
   int num_input_values;
   int num_return_values;
-  if (options_.ignore_value == false) {
+  if (options_.use_ffi) {
+    // pass the memory of the key and of the value
+    lua_pushnumber(lua_state, level);
+    lua_pushlightuserdata(lua_state, const_cast<char*>(key.data()));
+    lua_pushnumber(lua_state, static_cast<lua_Number>(key.size()));
+    num_input_values = 3;
+    num_return_values = 1;
+    if (options_.ignore_value == false) {
+      lua_pushlightuserdata(lua_state,
+                            const_cast<char*>(existing_value.data()));
+      lua_pushnumber(lua_state, static_cast<lua_Number>(existing_value.size()));
+      num_input_values = 5;
+      num_return_values = 3;
+    }
+  } else if (options_.ignore_value == false) {
     // push input arguments into the lua stack
     lua_pushnumber(lua_state, level);
     lua_pushlstring(lua_state, key.data(), key.size());
@@ -134,41 +202,118 @@ bool RocksLuaCompactionFilter::Filter(int level, const Slice& key,
   return is_filtered;
 }
 
-const char* RocksLuaCompactionFilter::Name() const {
-  if (name_ != "") {
-    return name_.c_str();
+void RocksLuaCompactionFilter::FilterBatch(int level, BatchEntry* entries,
+                                           size_t n) const {
+  auto* lua_state = GetLuaState();
+  lua_getglobal(lua_state, kFilterBatchFunctionName.c_str());
+  if (!lua_isfunction(lua_state, -1)) {
+    lua_pop(lua_state, 1);
+    CompactionFilter::FilterBatch(level, entries, n);
+    return;
   }
-  auto* lua_state = lua_state_wrapper_.GetLuaState();
-  // push the right function into the lua stack
-  lua_getglobal(lua_state, kNameFunctionName.c_str());
 
-  // perform the call (0 arguments, 1 result)
+  // The entries whose value can't be fetched keep the error, as FilterV2()
+  std::vector<BatchEntry*> batch;
+  batch.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    entries[i].decision = Decision::kKeep;
+    auto s = entries[i].existing_value->fetch();
+    if (!s.ok()) {
+      entries[i].new_value->reset(std::move(s));
+      entries[i].decision = Decision::kChangeValue;
+      continue;
+    }
+    batch.push_back(&entries[i]);
+  }
+
+  // push input arguments into the lua stack
+  int num_input_values;
+  int num_return_values = options_.ignore_value ? 1 : 2;
+  std::vector<RocksLuaEntry> ffi_entries;
+  lua_pushnumber(lua_state, level);
+  if (options_.use_ffi) {
+    ffi_entries.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      ffi_entries[i].key = batch[i]->key.data();
+      ffi_entries[i].key_size = batch[i]->key.size();
+      ffi_entries[i].value = nullptr;
+      ffi_entries[i].value_size = 0;
+      if (!options_.ignore_value) {
+        ffi_entries[i].value = batch[i]->existing_value->data();
+        ffi_entries[i].value_size = batch[i]->existing_value->size();
+      }
+    }
+    lua_pushnumber(lua_state, static_cast<lua_Number>(batch.size()));
+    lua_pushlightuserdata(lua_state, ffi_entries.data());
+    num_input_values = 3;
+  } else {
+    lua_createtable(lua_state, static_cast<int>(batch.size()), 0);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      lua_pushlstring(lua_state, batch[i]->key.data(), batch[i]->key.size());
+      lua_rawseti(lua_state, -2, static_cast<int>(i + 1));
+    }
+    num_input_values = 2;
+    if (!options_.ignore_value) {
+      lua_createtable(lua_state, static_cast<int>(batch.size()), 0);
+      for (size_t i = 0; i < batch.size(); ++i) {
+        const LazyBuffer* value = batch[i]->existing_value;
+        lua_pushlstring(lua_state, value->data(), value->size());
+        lua_rawseti(lua_state, -2, static_cast<int>(i + 1));
+      }
+      num_input_values = 3;
+    }
+  }
+
+  // perform the lua call
   int error_no;
-  if ((error_no = lua_pcall(lua_state, 0, 1, 0)) != 0) {
-    LogLuaError("[Lua] Error(%d) in Name function --- %s", error_no,
+  if ((error_no = lua_pcall(lua_state, num_input_values, num_return_values,
+                            0)) != 0) {
+    LogLuaError("[Lua] Error(%d) in FilterBatch function --- %s", error_no,
                 lua_tostring(lua_state, -1));
     // pops out the lua error from stack
     lua_pop(lua_state, 1);
-    return name_.c_str();
+    return;
   }
 
-  // check the return value
-  if (!lua_isstring(lua_state, -1)) {
+  const int kIndexIsFiltered = -num_return_values;
+  const int kIndexNewValues = -num_return_values + 1;
+  if (!lua_istable(lua_state, kIndexIsFiltered) ||
+      (!options_.ignore_value && !lua_istable(lua_state, kIndexNewValues) &&
+       !lua_isnil(lua_state, kIndexNewValues))) {
     LogLuaError(
-        "[Lua] Error in Name function -- "
-        "return value is not a string while string is expected");
-  } else {
-    const char* name_buf = lua_tostring(lua_state, -1);
-    const size_t name_size __attribute__((__unused__)) =
-        lua_strlen(lua_state, -1);
-    assert(name_buf[name_size] == '\0');
-    assert(strlen(name_buf) <= name_size);
-    name_ = name_buf;
+        "[Lua] Error in FilterBatch function -- "
+        "return values are not an array of booleans and a table of strings");
+    lua_pop(lua_state, num_return_values);
+    return;
   }
-  lua_pop(lua_state, 1);
-  return name_.c_str();
+  bool has_new_values =
+      !options_.ignore_value && lua_istable(lua_state, kIndexNewValues);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    lua_rawgeti(lua_state, kIndexIsFiltered, static_cast<int>(i + 1));
+    bool is_filtered = lua_toboolean(lua_state, -1);
+    lua_pop(lua_state, 1);
+    if (is_filtered) {
+      batch[i]->decision = Decision::kRemove;
+      continue;
+    }
+    if (has_new_values) {
+      lua_rawgeti(lua_state, kIndexNewValues, static_cast<int>(i + 1));
+      if (lua_isstring(lua_state, -1)) {
+        const char* new_value_buf = lua_tostring(lua_state, -1);
+        const size_t new_value_size = lua_strlen(lua_state, -1);
+        batch[i]->new_value->trans_to_string()->assign(new_value_buf,
+                                                       new_value_size);
+        batch[i]->decision = Decision::kChangeValue;
+      }
+      lua_pop(lua_state, 1);
+    }
+  }
+  // pops the returned values.
+  lua_pop(lua_state, num_return_values);
 }
 
+const char* RocksLuaCompactionFilter::Name() const { return name_.c_str(); }
+
 /* Not yet supported
 bool RocksLuaCompactionFilter::FilterMergeOperand(
     int level, const Slice& key, const Slice& operand) const {
@@ -471,6 +471,67 @@ TEST_F(RocksLuaTest, LuaConditionalTypeError) {
   }
 }
 
+TEST_F(RocksLuaTest, FilterBatch) {
+  lua::RocksLuaCompactionFilterOptions lua_opt;
+  lua_opt.error_log = std::make_shared<StopOnErrorLogger>();
+  // Removes the keys starting with 'r', changes the values starting with 'c'
+  lua_opt.lua_script =
+      "function Filter(level, key, existing_value)\n"
+      "  return false, false, \"\"\n"
+      "end\n"
+      "\n"
+      "function FilterBatch(level, keys, existing_values)\n"
+      "  local is_filtered = {}\n"
+      "  local new_values = {}\n"
+      "  for i, key in ipairs(keys) do\n"
+      "    is_filtered[i] = key:sub(1,1) == 'r'\n"
+      "    if existing_values[i]:sub(1,1) == 'c' then\n"
+      "      new_values[i] = 'changed'\n"
+      "    end\n"
+      "  end\n"
+      "  return is_filtered, new_values\n"
+      "end\n"
+      "\n"
+      "function Name()\n"
+      "  return \"BatchFilter\"\n"
+      "end\n"
+      "\n";
+  lua::RocksLuaCompactionFilter filter(lua_opt);
+  ASSERT_STREQ("BatchFilter", filter.Name());
+
+  std::vector<std::string> keys = {"rkey", "akey", "bkey", "ckey"};
+  std::vector<std::string> values = {"cvalue", "avalue", "cvalue", "rvalue"};
+  std::vector<LazyBuffer> existing_values(keys.size());
+  std::vector<LazyBuffer> new_values(keys.size());
+  std::vector<std::string> skip_until(keys.size());
+  std::vector<CompactionFilter::BatchEntry> entries(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    existing_values[i].reset(values[i]);
+    entries[i] = {keys[i],
+                  Slice(),
+                  &existing_values[i],
+                  CompactionFilter::Decision::kKeep,
+                  &new_values[i],
+                  &skip_until[i]};
+  }
+  std::vector<CompactionFilter::Decision> expected = {
+      CompactionFilter::Decision::kRemove, CompactionFilter::Decision::kKeep,
+      CompactionFilter::Decision::kChangeValue,
+      CompactionFilter::Decision::kKeep};
+
+  // The state of each thread runs the script
+  for (int i = 0; i < 2; ++i) {
+    TERARKDB_NAMESPACE::port::Thread thread(
+        [&] { filter.FilterBatch(0, entries.data(), entries.size()); });
+    thread.join();
+    for (size_t j = 0; j < entries.size(); ++j) {
+      ASSERT_EQ(expected[j], entries[j].decision);
+    }
+    ASSERT_OK(new_values[2].fetch());
+    ASSERT_EQ("changed", new_values[2].ToString());
+  }
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -195,6 +195,8 @@ TEST_F(MemoryTest, MemTableAndTableReadersTotal) {
               usage_history_[MemoryUtil::kMemTableUnFlushed][i - 1]);
     ASSERT_EQ(usage_history_[MemoryUtil::kTableReadersTotal][i],
               usage_history_[MemoryUtil::kTableReadersTotal][i - 1]);
+    ASSERT_EQ(usage_history_[MemoryUtil::kTableMetadataTotal][i],
+              usage_history_[MemoryUtil::kTableMetadataTotal][i - 1]);
   }
 
   size_t usage_check_point = usage_history_[MemoryUtil::kMemTableTotal].size();
@@ -227,6 +229,9 @@ TEST_F(MemoryTest, MemTableAndTableReadersTotal) {
     // as we flush tables.
     ASSERT_GT(usage_history_[MemoryUtil::kTableReadersTotal][i],
               usage_history_[MemoryUtil::kTableReadersTotal][i - 1]);
+    // And so does the one of the metadata of the files
+    ASSERT_GT(usage_history_[MemoryUtil::kTableMetadataTotal][i],
+              usage_history_[MemoryUtil::kTableMetadataTotal][i - 1]);
     ASSERT_GT(usage_history_[MemoryUtil::kCacheTotal][i],
               usage_history_[MemoryUtil::kCacheTotal][i - 1]);
   }
@@ -8,7 +8,9 @@
 #include "rocksdb/utilities/memory_util.h"
 
 #include "db/db_impl.h"
+#include "rocksdb/table.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/iterator_cache.h"
 
 namespace TERARKDB_NAMESPACE {
 
@@ -40,6 +42,51 @@ Status MemoryUtil::GetApproximateMemoryUsageByType(
     }
   }
 
+  // File metadata and FileMaps
+  for (auto* db : dbs) {
+    uint64_t usage = 0;
+    if (db->GetAggregatedIntProperty(DB::Properties::kEstimateFileMetaDataMem,
+                                     &usage)) {
+      (*usage_by_type)[MemoryUtil::kTableMetadataTotal] += usage;
+    }
+    if (db->GetAggregatedIntProperty(DB::Properties::kEstimateFileMapMem,
+                                     &usage)) {
+      (*usage_by_type)[MemoryUtil::kTableMetadataTotal] += usage;
+    }
+  }
+
+  // Table Builders
+  std::unordered_set<const TableFactory*> table_factories;
+  for (auto* db : dbs) {
+    const TableFactory* factory =
+        db->GetOptions(db->DefaultColumnFamily()).table_factory.get();
+    uint64_t working = 0;
+    uint64_t waiting = 0;
+    if (factory != nullptr && table_factories.insert(factory).second &&
+        factory->GetBuildMemoryUsage(&working, &waiting)) {
+      (*usage_by_type)[MemoryUtil::kTableBuildersTotal] += working;
+    }
+  }
+
+  // Iterator Caches
+  if (!dbs.empty()) {
+    (*usage_by_type)[MemoryUtil::kIteratorCachesTotal] +=
+        IteratorCache::TotalArenaMemoryUsage();
+  }
+
+  // Key Hotness
+  std::unordered_set<const Oracle*> oracles;
+  for (auto* db : dbs) {
+    auto* db_impl = static_cast<DBImpl*>(db->GetRootDB());
+    (*usage_by_type)[MemoryUtil::kKeyHotnessTotal] +=
+        db_impl->ApproximateKeyHotnessMemoryUsage();
+    std::shared_ptr<Oracle> oracle = db->GetEnv()->GetOracle();
+    if (oracle != nullptr && oracles.insert(oracle.get()).second) {
+      (*usage_by_type)[MemoryUtil::kKeyHotnessTotal] +=
+          oracle->ApproximateMemoryUsage();
+    }
+  }
+
   // Cache
   for (const auto* cache : cache_set) {
     if (cache != nullptr) {
@@ -76,6 +76,80 @@ Status CompactToLevel(const Options& options, const std::string& dbname,
   return s;
 }
 
+// Move the data to `dest_level` without rewriting it. The levels holding
+// data are linked into one map SST by a lazy manual compaction, which only
+// writes the metadata, and the map SST is moved to `dest_level`. A single
+// level is moved as is. Lazy compaction under the new options reshapes the
+// data later. Return NotSupported if the data is in level 0 only, it can't
+// be moved to another level.
+Status LinkToLevel(const Options& options, const std::string& dbname,
+                   int dest_level, bool need_reopen) {
+  std::unique_ptr<DB> db;
+  Options no_compact_opts = GetNoCompactionOptions(options);
+  Status s = OpenDb(no_compact_opts, dbname, &db);
+  if (!s.ok()) {
+    return s;
+  }
+  ColumnFamilyMetaData metadata;
+  db->GetColumnFamilyMetaData(&metadata);
+  int levels_with_files = 0;
+  int last_level_with_files = -1;
+  for (auto& level : metadata.levels) {
+    if (!level.files.empty()) {
+      ++levels_with_files;
+      last_level_with_files = level.level;
+    }
+  }
+  if (last_level_with_files == 0) {
+    return Status::NotSupported("Data in level 0 only");
+  }
+
+  CompactRangeOptions cro;
+  cro.change_level = true;
+  cro.target_level = dest_level;
+  if (levels_with_files > 1) {
+    no_compact_opts.compaction_style = kCompactionStyleUniversal;
+    no_compact_opts.enable_lazy_compaction = true;
+  } else {
+    // A level style manual compaction skipping the bottommost level only
+    // moves it
+    no_compact_opts.compaction_style = kCompactionStyleLevel;
+    no_compact_opts.enable_lazy_compaction = false;
+    no_compact_opts.level_compaction_dynamic_level_bytes = false;
+    cro.bottommost_level_compaction = BottommostLevelCompaction::kSkip;
+  }
+  if (levels_with_files > 0) {
+    s = OpenDb(no_compact_opts, dbname, &db);
+    if (s.ok()) {
+      s = db->CompactRange(cro, nullptr, nullptr);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  if (need_reopen) {
+    // Rewrite the manifest file, as CompactToLevel()
+    db.reset();
+    s = OpenDb(no_compact_opts, dbname, &db);
+  }
+  return s;
+}
+
+// Link the data to `dest_level` when the new options compact lazily, or
+// else compact it there
+Status MoveToLevel(const Options& options, const Options& new_opts,
+                   const std::string& dbname, int dest_level,
+                   bool need_reopen) {
+  if (new_opts.enable_lazy_compaction) {
+    Status s = LinkToLevel(options, dbname, dest_level, need_reopen);
+    if (!s.IsNotSupported()) {
+      return s;
+    }
+  }
+  return CompactToLevel(options, dbname, dest_level, need_reopen);
+}
+
 Status MigrateToUniversal(std::string dbname, const Options& old_opts,
                           const Options& new_opts) {
   if (old_opts.num_levels <= new_opts.num_levels) {
@@ -97,7 +171,8 @@ Status MigrateToUniversal(std::string dbname, const Options& old_opts,
       }
     }
     if (need_compact) {
-      return CompactToLevel(old_opts, dbname, new_opts.num_levels - 1, true);
+      return MoveToLevel(old_opts, new_opts, dbname, new_opts.num_levels - 1,
+                         true);
     }
     return Status::OK();
   }
@@ -118,7 +193,7 @@ Status MigrateToLevelBase(std::string dbname, const Options& old_opts,
     // multiplier from 4 to 8, with the same data, we will have fewer
     // levels. Unless we issue a full comaction, the LSM tree may stuck
     // with more levels than needed and it won't recover automatically.
-    return CompactToLevel(opts, dbname, 1, true);
+    return MoveToLevel(opts, new_opts, dbname, 1, true);
   } else {
     // Compact everything to the last level to guarantee it can be safely
     // opened.
@@ -126,11 +201,13 @@ Status MigrateToLevelBase(std::string dbname, const Options& old_opts,
       return Status::OK();
     } else if (new_opts.num_levels > old_opts.num_levels) {
       // Dynamic level mode requires data to be put in the last level first.
-      return CompactToLevel(new_opts, dbname, new_opts.num_levels - 1, false);
+      return MoveToLevel(new_opts, new_opts, dbname, new_opts.num_levels - 1,
+                         false);
     } else {
       Options opts = old_opts;
       opts.target_file_size_base = new_opts.target_file_size_base;
-      return CompactToLevel(opts, dbname, new_opts.num_levels - 1, true);
+      return MoveToLevel(opts, new_opts, dbname, new_opts.num_levels - 1,
+                         true);
     }
   }
 }
@@ -419,6 +419,55 @@ TEST_F(DBOptionChangeMigrationTest, CompactedSrcToUniversal) {
   }
 }
 
+TEST_F(DBOptionChangeMigrationTest, LinkToLazyUniversal) {
+  Options old_options = CurrentOptions();
+  old_options.compaction_style = CompactionStyle::kCompactionStyleLevel;
+  old_options.level_compaction_dynamic_level_bytes = false;
+  old_options.write_buffer_size = 64 * 1024;
+  old_options.num_levels = 4;
+  old_options.disable_auto_compactions = true;
+  Reopen(old_options);
+
+  // Data in L1, L2 and L3
+  Random rnd(301);
+  for (int level = 3; level > 0; --level) {
+    for (int i = 0; i < 50; i++) {
+      ASSERT_OK(Put(Key(level * 100 + i), RandomString(&rnd, 900)));
+    }
+    ASSERT_OK(Flush());
+    MoveFilesToLevel(level);
+  }
+  ASSERT_EQ("0,1,1,1", FilesPerLevel());
+  std::set<std::string> keys;
+  {
+    std::unique_ptr<Iterator> it(db_->NewIterator(ReadOptions()));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      keys.insert(it->key().ToString());
+    }
+  }
+  Close();
+
+  Options new_options = old_options;
+  new_options.compaction_style = CompactionStyle::kCompactionStyleUniversal;
+  new_options.enable_lazy_compaction = true;
+  new_options.num_levels = 2;
+  ASSERT_OK(OptionChangeMigration(dbname_, old_options, new_options));
+  Reopen(new_options);
+
+  // Linked into a single map SST on the last level
+  ASSERT_EQ("0,1", FilesPerLevel());
+  {
+    std::unique_ptr<Iterator> it(db_->NewIterator(ReadOptions()));
+    it->SeekToFirst();
+    for (std::string key : keys) {
+      ASSERT_TRUE(it->Valid());
+      ASSERT_EQ(key, it->key().ToString());
+      it->Next();
+    }
+    ASSERT_TRUE(!it->Valid());
+  }
+}
+
 #endif  // ROCKSDB_LITE
 }  // namespace TERARKDB_NAMESPACE
 
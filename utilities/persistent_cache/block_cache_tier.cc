@@ -177,9 +177,9 @@ Status BlockCacheTier::Insert(const Slice& key, const char* data,
   stats_.bytes_pipelined_.Add(size);
 
   if (opt_.pipeline_writes) {
-    // off load the write to the write thread
-    insert_ops_.Push(
-        InsertOp(key.ToString(), std::move(std::string(data, size))));
+    // off load the write to the write thread, the op owns the only copy of
+    // the data until it is appended to the write buffers
+    insert_ops_.Push(InsertOp(key.ToString(), std::string(data, size)));
     return Status::OK();
   }
 
@@ -224,11 +224,16 @@ Status BlockCacheTier::InsertImpl(const Slice& key, const Slice& data) {
 
   StopWatchNano timer(opt_.env, /*auto_start=*/true);
 
+  LBA lba;
+  if (metadata_.Lookup(key, &lba)) {
+    // the key already exists, this is duplicate insert. The block index is
+    // lock striped, so duplicates are dropped without serializing on lock_
+    return Status::OK();
+  }
+
   WriteLock _(&lock_);
 
-  LBA lba;
   if (metadata_.Lookup(key, &lba)) {
-    // the key already exists, this is duplicate insert
     return Status::OK();
   }
 
@@ -302,9 +307,13 @@ Status BlockCacheTier::Lookup(const Slice& key, std::unique_ptr<char[]>* val,
 
   assert(blk_key == key);
 
-  val->reset(new char[blk_val.size()]);
-  memcpy(val->get(), blk_val.data(), blk_val.size());
+  // hand the read buffer over instead of copying the value into a buffer of
+  // its own, the value only needs to move to the front of the record
+  assert(blk_val.data() >= scratch.get() &&
+         blk_val.data() + blk_val.size() <= scratch.get() + lba.size_);
+  memmove(scratch.get(), blk_val.data(), blk_val.size());
   *size = blk_val.size();
+  *val = std::move(scratch);
 
   stats_.bytes_read_.Add(*size);
   stats_.cache_hits_++;
@@ -331,7 +340,8 @@ Status BlockCacheTier::NewCacheFile() {
       opt_.env, &buffer_allocator_, &writer_, GetCachePath(), writer_cache_id_,
       opt_.cache_file_size, opt_.log));
 
-  bool status = f->Create(opt_.enable_direct_writes, opt_.enable_direct_reads);
+  bool status = f->Create(opt_.enable_direct_writes, opt_.enable_direct_reads,
+                          opt_.enable_aio_reads);
   if (!status) {
     return Status::IOError("Error creating file");
   }
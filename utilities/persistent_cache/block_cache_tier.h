@@ -87,8 +87,8 @@ class BlockCacheTier : public PersistentCacheTier {
   // Pipelined operation
   struct InsertOp {
     explicit InsertOp(const bool signal) : signal_(signal) {}
-    explicit InsertOp(std::string&& key, const std::string& data)
-        : key_(std::move(key)), data_(data) {}
+    explicit InsertOp(std::string&& key, std::string&& data)
+        : key_(std::move(key)), data_(std::move(data)) {}
     ~InsertOp() {}
 
     InsertOp() = delete;
@@ -34,9 +34,11 @@ Status NewWritableCacheFile(Env* const env, const std::string& filepath,
 
 Status NewRandomAccessCacheFile(Env* const env, const std::string& filepath,
                                 std::unique_ptr<RandomAccessFile>* file,
-                                const bool use_direct_reads = true) {
+                                const bool use_direct_reads = true,
+                                const bool use_aio_reads = false) {
   EnvOptions opt;
   opt.use_direct_reads = use_direct_reads;
+  opt.use_aio_reads = use_aio_reads;
   Status s = env->NewRandomAccessFile(filepath, file, opt);
   return s;
 }
@@ -195,19 +197,22 @@ bool CacheRecord::Deserialize(const Slice& data) {
 // RandomAccessFile
 //
 
-bool RandomAccessCacheFile::Open(const bool enable_direct_reads) {
+bool RandomAccessCacheFile::Open(const bool enable_direct_reads,
+                                 const bool enable_aio_reads) {
   WriteLock _(&rwlock_);
-  return OpenImpl(enable_direct_reads);
+  return OpenImpl(enable_direct_reads, enable_aio_reads);
 }
 
-bool RandomAccessCacheFile::OpenImpl(const bool enable_direct_reads) {
+bool RandomAccessCacheFile::OpenImpl(const bool enable_direct_reads,
+                                     const bool enable_aio_reads) {
   rwlock_.AssertHeld();
 
   ROCKS_LOG_DEBUG(log_, "Opening cache file %s", Path().c_str());
 
   std::unique_ptr<RandomAccessFile> file;
-  Status status =
-      NewRandomAccessCacheFile(env_, Path(), &file, enable_direct_reads);
+  Status status = NewRandomAccessCacheFile(env_, Path(), &file,
+                                           enable_direct_reads,
+                                           enable_aio_reads);
   if (!status.ok()) {
     Error(log_, "Error opening random access file %s. %s", Path().c_str(),
           status.ToString().c_str());
@@ -279,10 +284,12 @@ WriteableCacheFile::~WriteableCacheFile() {
 }
 
 bool WriteableCacheFile::Create(const bool /*enable_direct_writes*/,
-                                const bool enable_direct_reads) {
+                                const bool enable_direct_reads,
+                                const bool enable_aio_reads) {
   WriteLock _(&rwlock_);
 
   enable_direct_reads_ = enable_direct_reads;
+  enable_aio_reads_ = enable_aio_reads;
 
   ROCKS_LOG_DEBUG(log_, "Creating new cache %s (max size is %d B)",
                   Path().c_str(), max_size_);
@@ -433,7 +440,7 @@ void WriteableCacheFile::CloseAndOpenForReading() {
   // Our env abstraction do not allow reading from a file opened for appending
   // We need close the file and re-open it for reading
   Close();
-  RandomAccessCacheFile::OpenImpl(enable_direct_reads_);
+  RandomAccessCacheFile::OpenImpl(enable_direct_reads_, enable_aio_reads_);
 }
 
 bool WriteableCacheFile::ReadBuffer(const LBA& lba, Slice* key, Slice* block,
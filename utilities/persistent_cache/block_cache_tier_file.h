@@ -155,7 +155,7 @@ class RandomAccessCacheFile : public BlockCacheFile {
   virtual ~RandomAccessCacheFile() {}
 
   // open file for reading
-  bool Open(const bool enable_direct_reads);
+  bool Open(const bool enable_direct_reads, const bool enable_aio_reads);
   // read data from the disk
   bool Read(const LBA& lba, Slice* key, Slice* block, char* scratch) override;
 
@@ -163,7 +163,7 @@ class RandomAccessCacheFile : public BlockCacheFile {
   std::unique_ptr<RandomAccessFileReader> freader_;
 
  protected:
-  bool OpenImpl(const bool enable_direct_reads);
+  bool OpenImpl(const bool enable_direct_reads, const bool enable_aio_reads);
   bool ParseRec(const LBA& lba, Slice* key, Slice* val, char* scratch);
 
   std::shared_ptr<Logger> log_;  // log file
@@ -188,7 +188,8 @@ class WriteableCacheFile : public RandomAccessCacheFile {
   virtual ~WriteableCacheFile();
 
   // create file on disk
-  bool Create(const bool enable_direct_writes, const bool enable_direct_reads);
+  bool Create(const bool enable_direct_writes, const bool enable_direct_reads,
+              const bool enable_aio_reads);
 
   // read data from logical file
   bool Read(const LBA& lba, Slice* key, Slice* block, char* scratch) override {
@@ -247,6 +248,7 @@ class WriteableCacheFile : public RandomAccessCacheFile {
   size_t pending_ios_ = 0;               // Number of ios to disk in-progress
   bool enable_direct_reads_ = false;     // Should we enable direct reads
                                          // when reading from disk
+  bool enable_aio_reads_ = false;        // Should we read through aio
 };
 
 //
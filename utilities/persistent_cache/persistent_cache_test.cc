@@ -104,7 +104,8 @@ std::unique_ptr<PersistentTieredCache> NewTieredCache(
 std::unique_ptr<PersistentCacheTier> NewBlockCache(
     Env* env, const std::string& path,
     const uint64_t max_size = std::numeric_limits<uint64_t>::max(),
-    const bool enable_direct_writes = false) {
+    const bool enable_direct_writes = false,
+    const bool enable_aio_reads = false) {
   const uint32_t max_file_size =
       static_cast<uint32_t>(12 * 1024 * 1024 * kStressFactor);
   auto log = std::make_shared<ConsoleLogger>();
@@ -112,6 +113,7 @@ std::unique_ptr<PersistentCacheTier> NewBlockCache(
   opt.cache_file_size = max_file_size;
   opt.max_write_pipeline_backlog_size = std::numeric_limits<uint64_t>::max();
   opt.enable_direct_writes = enable_direct_writes;
+  opt.enable_aio_reads = enable_aio_reads;
   std::unique_ptr<PersistentCacheTier> scache(new BlockCacheTier(opt));
   Status s = scache->Open();
   assert(s.ok());
@@ -215,6 +217,16 @@ TEST_F(PersistentCacheTierTest, BlockCacheInsert) {
   }
 }
 
+TEST_F(PersistentCacheTierTest, BlockCacheInsertWithAioReads) {
+  for (auto nthreads : {1, 5}) {
+    cache_ = NewBlockCache(Env::Default(), path_,
+                           /*size=*/std::numeric_limits<uint64_t>::max(),
+                           /*enable_direct_writes=*/false,
+                           /*enable_aio_reads=*/true);
+    RunInsertTest(nthreads, static_cast<size_t>(10 * 1024 * kStressFactor));
+  }
+}
+
 TEST_F(PersistentCacheTierTest, BlockCacheInsertWithEviction) {
   for (auto nthreads : {1, 5}) {
     for (auto max_keys : {1 * 1024 * 1024 * kStressFactor}) {
@@ -34,6 +34,9 @@ std::string PersistentCacheConfig::ToString() const {
   snprintf(buffer, kBufferSize, "    enable_direct_writes: %d\n",
            enable_direct_writes);
   ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    enable_aio_reads: %d\n",
+           enable_aio_reads);
+  ret.append(buffer);
   snprintf(buffer, kBufferSize, "    cache_size: %" PRIu64 "\n", cache_size);
   ret.append(buffer);
   snprintf(buffer, kBufferSize, "    cache_file_size: %" PRIu32 "\n",
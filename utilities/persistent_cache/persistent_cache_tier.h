@@ -150,6 +150,14 @@ struct PersistentCacheConfig {
   //
   bool enable_direct_writes = false;
 
+  //
+  // Read the cache files through the asynchronous read path of the env (see
+  // PosixRandomAccessFile), so a reader running in a fiber does not block
+  // its thread while the device serves the read. Has no effect when the env
+  // does not support it
+  //
+  bool enable_aio_reads = false;
+
   //
   // Logical cache size
   //
@@ -5,18 +5,20 @@
  *
  * @throws All functions may throw a RedisListException on error/corruption.
  *
- * @notes Internally, the set of lists is stored in a rocksdb database,
- *        mapping keys to values. Each "value" is the list itself, storing
- *        some kind of internal representation of the data. All the
- *        representation details are handled by the RedisListIterator class.
- *        The present file should be oblivious to the representation details,
- *        handling only the client (Redis) API, and the calls to rocksdb.
+ * @notes Internally, each list is stored as a sequence of chunks of at most
+ *        about kChunkSize elements, under the keys:
  *
- * @TODO  Presently, all operations take at least O(NV) time where
- *        N is the number of elements in the list, and V is the average
- *        number of bytes per value in the list. So maybe, with merge operator
- *        we can improve this to an optimal O(V) amortized time, since we
- *        wouldn't have to read and re-write the entire list.
+ *          'M' key                         --> meta
+ *          'C' fixed32_be(|key|) key fixed64_be(seq)  --> chunk
+ *
+ *        The chunks of a list are sorted by their seq, the first and the
+ *        last of them are recorded in the meta, along with the length of
+ *        the list. A chunk is in the representation of RedisListIterator.
+ *        Pushes are merges of one element into the first or the last chunk,
+ *        and pops rewrite only one chunk, so both take O(V) time with V the
+ *        size of a chunk, whatever the length of the list is. Range, Index
+ *        and the other operations scan the chunks in order. Empty chunks are
+ *        deleted, so a list with no elements has no keys at all.
  *
  * @author Deon Nicholas (dnicholas@fb.com)
  */
@@ -30,10 +32,206 @@
 
 #include "rocksdb/slice.h"
 #include "rocksdb/terark_namespace.h"
+#include "rocksdb/write_batch.h"
 #include "util/coding.h"
 
 namespace TERARKDB_NAMESPACE {
 
+namespace {
+const char kMetaPrefix = 'M';
+const char kChunkPrefix = 'C';
+// Merge operand tags, an operand is a tag followed by the element
+const char kPushLeft = 'L';
+const char kPushRight = 'R';
+// The number of elements a push fills a chunk with at most
+const uint32_t kChunkSize = 128;
+// The seq of the first chunk of a list, left pushes go below it
+const uint64_t kFirstChunkSeq = uint64_t(1) << 63;
+
+struct ListMeta {
+  uint64_t length = 0;
+  uint64_t head = kFirstChunkSeq;
+  uint64_t tail = kFirstChunkSeq;
+  // The number of elements in the head and the tail chunks. They do not need
+  // to be exact: a push only uses them to decide whether to open a new chunk
+  uint32_t head_fill = 0;
+  uint32_t tail_fill = 0;
+};
+
+void PutFixed32BigEndian(std::string* dst, uint32_t value) {
+  for (int i = 3; i >= 0; --i) {
+    dst->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+void PutFixed64BigEndian(std::string* dst, uint64_t value) {
+  for (int i = 7; i >= 0; --i) {
+    dst->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+uint64_t DecodeFixed64BigEndian(const char* ptr) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value = (value << 8) | static_cast<unsigned char>(ptr[i]);
+  }
+  return value;
+}
+
+std::string MetaKey(const std::string& key) {
+  std::string meta_key(1, kMetaPrefix);
+  meta_key.append(key);
+  return meta_key;
+}
+
+std::string ChunkPrefix(const std::string& key) {
+  std::string prefix(1, kChunkPrefix);
+  PutFixed32BigEndian(&prefix, static_cast<uint32_t>(key.size()));
+  prefix.append(key);
+  return prefix;
+}
+
+std::string ChunkKey(const std::string& key, uint64_t seq) {
+  std::string chunk_key = ChunkPrefix(key);
+  PutFixed64BigEndian(&chunk_key, seq);
+  return chunk_key;
+}
+
+uint64_t ChunkSeq(const Slice& chunk_key) {
+  assert(chunk_key.size() >= sizeof(uint64_t));
+  return DecodeFixed64BigEndian(chunk_key.data() + chunk_key.size() -
+                                sizeof(uint64_t));
+}
+
+// Return false if (list: key) is empty
+bool ReadMeta(DB* db, const ReadOptions& options, const std::string& key,
+              ListMeta* meta) {
+  std::string data;
+  Status s = db->Get(options, MetaKey(key), &data);
+  if (s.IsNotFound()) {
+    return false;
+  }
+  Slice input(data);
+  if (!s.ok() || !GetVarint64(&input, &meta->length) ||
+      !GetFixed64(&input, &meta->head) || !GetFixed64(&input, &meta->tail) ||
+      !GetVarint32(&input, &meta->head_fill) ||
+      !GetVarint32(&input, &meta->tail_fill) || meta->length == 0) {
+    throw RedisListException();
+  }
+  return true;
+}
+
+void WriteMeta(WriteBatch* batch, const std::string& key,
+               const ListMeta& meta) {
+  if (meta.length == 0) {
+    batch->Delete(MetaKey(key));
+    return;
+  }
+  std::string data;
+  PutVarint64(&data, meta.length);
+  PutFixed64(&data, meta.head);
+  PutFixed64(&data, meta.tail);
+  PutVarint32(&data, meta.head_fill);
+  PutVarint32(&data, meta.tail_fill);
+  batch->Put(MetaKey(key), data);
+}
+
+void Write(DB* db, const WriteOptions& options, WriteBatch* batch) {
+  if (!db->Write(options, batch).ok()) {
+    throw RedisListException();
+  }
+}
+
+// Call fn(chunk_key, chunk_data) for the chunks of (list: key) in order,
+// until it returns false
+template <class Fn>
+void ForEachChunk(DB* db, const ReadOptions& options, const std::string& key,
+                  Fn&& fn) {
+  std::string prefix = ChunkPrefix(key);
+  std::unique_ptr<Iterator> iter(db->NewIterator(options));
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix);
+       iter->Next()) {
+    if (!fn(iter->key(), iter->value().ToString())) {
+      break;
+    }
+  }
+  if (!iter->status().ok()) {
+    throw RedisListException();
+  }
+}
+
+// Append the chunk of `it`, or delete the chunk if it has become empty
+void WriteChunk(WriteBatch* batch, const Slice& chunk_key,
+                RedisListIterator* it) {
+  if (it->Length() == 0) {
+    batch->Delete(chunk_key);
+  } else {
+    batch->Put(chunk_key, it->WriteResult());
+  }
+}
+
+class RedisListsMergeOperator : public MergeOperator {
+ public:
+  // Prepend the left pushes, the latest first, and append the right ones
+  virtual bool FullMergeV2(const MergeOperationInput& merge_in,
+                           MergeOperationOutput* merge_out) const override {
+    merge_out->new_value.clear();
+    Slice existing;
+    if (merge_in.existing_value != nullptr) {
+      if (!Fetch(*merge_in.existing_value, &merge_out->new_value)) {
+        return true;
+      }
+      existing = merge_in.existing_value->slice();
+    }
+    uint32_t length = 0;
+    if (!existing.empty()) {
+      if (existing.size() < sizeof(uint32_t)) {
+        return false;
+      }
+      length = DecodeFixed32(existing.data());
+      existing.remove_prefix(sizeof(uint32_t));
+    }
+    size_t size = sizeof(uint32_t) + existing.size();
+    for (auto& operand : merge_in.operand_list) {
+      if (!Fetch(operand, &merge_out->new_value)) {
+        return true;
+      }
+      if (operand.size() == 0 ||
+          (operand.data()[0] != kPushLeft && operand.data()[0] != kPushRight)) {
+        return false;
+      }
+      size += sizeof(uint32_t) + operand.size() - 1;
+      ++length;
+    }
+
+    std::string* result = merge_out->new_value.trans_to_string();
+    result->reserve(size);
+    PutFixed32(result, length);
+    auto append_element = [result](const LazyBuffer& operand) {
+      PutFixed32(result, static_cast<uint32_t>(operand.size() - 1));
+      result->append(operand.data() + 1, operand.size() - 1);
+    };
+    auto& operands = merge_in.operand_list;
+    for (auto it = operands.rbegin(); it != operands.rend(); ++it) {
+      if (it->data()[0] == kPushLeft) {
+        append_element(*it);
+      }
+    }
+    result->append(existing.data(), existing.size());
+    for (auto& operand : operands) {
+      if (operand.data()[0] == kPushRight) {
+        append_element(operand);
+      }
+    }
+    return true;
+  }
+
+  virtual const char* Name() const override {
+    return "RedisListsMergeOperator";
+  }
+};
+}  // namespace
+
 /// Constructors
 
 RedisLists::RedisLists(const std::string& db_path, Options options,
@@ -48,6 +246,7 @@ RedisLists::RedisLists(const std::string& db_path, Options options,
   }
 
   // Now open and deal with the db
+  options.merge_operator = CreateMergeOperator();
   DB* db;
   Status s = DB::Open(options, db_name_, &db);
   if (!s.ok()) {
@@ -55,7 +254,15 @@ RedisLists::RedisLists(const std::string& db_path, Options options,
     assert(false);
   }
 
-  db_ = std::unique_ptr<DB>(db);
+  db_ = db;
+  owned_db_.reset(db);
+}
+
+RedisLists::RedisLists(DB* db)
+    : db_name_(db->GetName()), put_option_(), get_option_(), db_(db) {}
+
+std::shared_ptr<MergeOperator> RedisLists::CreateMergeOperator() {
+  return std::make_shared<RedisListsMergeOperator>();
 }
 
 /// Accessors
@@ -63,13 +270,11 @@ RedisLists::RedisLists(const std::string& db_path, Options options,
 // Number of elements in the list associated with key
 //   : throws RedisListException
 int RedisLists::Length(const std::string& key) {
-  // Extract the string data representing the list.
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
-  // Return the length
-  RedisListIterator it(data);
-  return it.Length();
+  ListMeta meta;
+  if (!ReadMeta(db_, get_option_, key, &meta)) {
+    return 0;
+  }
+  return static_cast<int>(meta.length);
 }
 
 // Get the element at the specified index in the (list: key)
@@ -77,35 +282,36 @@ int RedisLists::Length(const std::string& key) {
 //   : throws RedisListException
 bool RedisLists::Index(const std::string& key, int32_t index,
                        std::string* result) {
-  // Extract the string data representing the list.
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
   // Handle REDIS negative indices (from the end); fast iff Length() takes O(1)
   if (index < 0) {
     index = Length(key) - (-index);  // replace (-i) with (N-i).
   }
-
-  // Iterate through the list until the desired index is found.
-  int curIndex = 0;
-  RedisListIterator it(data);
-  while (curIndex < index && !it.Done()) {
-    ++curIndex;
-    it.Skip();
-  }
-
-  // If we actually found the index
-  if (curIndex == index && !it.Done()) {
-    Slice elem;
-    it.GetCurrent(&elem);
-    if (result != nullptr) {
-      *result = elem.ToString();
-    }
-
-    return true;
-  } else {
+  if (index < 0) {
     return false;
   }
+
+  // Skip the chunks before the index, then the elements of its chunk
+  bool found = false;
+  int curIndex = 0;
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& /*chunk_key*/, const std::string& data) {
+                 RedisListIterator it(data);
+                 if (curIndex + it.Length() <= index) {
+                   curIndex += it.Length();
+                   return true;
+                 }
+                 for (; curIndex < index; ++curIndex) {
+                   it.Skip();
+                 }
+                 Slice elem;
+                 it.GetCurrent(&elem);
+                 if (result != nullptr) {
+                   *result = elem.ToString();
+                 }
+                 found = true;
+                 return false;
+               });
+  return found;
 }
 
 // Return a truncated version of the list.
@@ -115,10 +321,6 @@ bool RedisLists::Index(const std::string& key, int32_t index,
 //   : throws RedisListException
 std::vector<std::string> RedisLists::Range(const std::string& key,
                                            int32_t first, int32_t last) {
-  // Extract the string data representing the list.
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
   // Handle negative bounds (-1 means last element, etc.)
   int listLen = Length(key);
   if (first < 0) {
@@ -135,18 +337,29 @@ std::vector<std::string> RedisLists::Range(const std::string& key,
 
   // Initialize the resulting list
   std::vector<std::string> result(len);
+  if (len == 0) {
+    return result;
+  }
 
-  // Traverse the list and update the vector
+  // Scan the chunks and update the vector
   int curIdx = 0;
-  Slice elem;
-  for (RedisListIterator it(data); !it.Done() && curIdx <= last; it.Skip()) {
-    if (first <= curIdx && curIdx <= last) {
-      it.GetCurrent(&elem);
-      result[curIdx - first].assign(elem.data(), elem.size());
-    }
-
-    ++curIdx;
-  }
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& /*chunk_key*/, const std::string& data) {
+                 RedisListIterator it(data);
+                 if (curIdx + it.Length() <= first) {
+                   curIdx += it.Length();
+                   return true;
+                 }
+                 Slice elem;
+                 for (; !it.Done() && curIdx <= last; it.Skip()) {
+                   if (first <= curIdx) {
+                     it.GetCurrent(&elem);
+                     result[curIdx - first].assign(elem.data(), elem.size());
+                   }
+                   ++curIdx;
+                 }
+                 return curIdx <= last;
+               });
 
   // Return the result. Might be empty
   return result;
@@ -154,33 +367,21 @@ std::vector<std::string> RedisLists::Range(const std::string& key,
 
 // Print the (list: key) out to stdout. For debugging mostly. Public for now.
 void RedisLists::Print(const std::string& key) {
-  // Extract the string data representing the list.
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
-  // Iterate through the list and print the items
-  Slice elem;
-  for (RedisListIterator it(data); !it.Done(); it.Skip()) {
-    it.GetCurrent(&elem);
-    std::cout << "ITEM " << elem.ToString() << std::endl;
-  }
-
-  // Now print the byte data
-  RedisListIterator it(data);
-  std::cout << "==Printing data==" << std::endl;
-  std::cout << data.size() << std::endl;
-  std::cout << it.Size() << " " << it.Length() << std::endl;
-  Slice result = it.WriteResult();
-  std::cout << result.data() << std::endl;
-  if (true) {
-    std::cout << "size: " << result.size() << std::endl;
-    const char* val = result.data();
-    for (int i = 0; i < (int)result.size(); ++i) {
-      std::cout << (int)val[i] << " " << (val[i] >= 32 ? val[i] : ' ')
-                << std::endl;
-    }
-    std::cout << std::endl;
-  }
+  // Iterate through the chunks and print the items
+  ForEachChunk(db_, get_option_, key,
+               [](const Slice& chunk_key, const std::string& data) {
+                 std::cout << "==Chunk "
+                           << static_cast<int64_t>(ChunkSeq(chunk_key) -
+                                                   kFirstChunkSeq)
+                           << "==" << std::endl;
+                 Slice elem;
+                 for (RedisListIterator it(data); !it.Done(); it.Skip()) {
+                   it.GetCurrent(&elem);
+                   std::cout << "ITEM " << elem.ToString() << std::endl;
+                 }
+                 std::cout << "size: " << data.size() << std::endl;
+                 return true;
+               });
 }
 
 /// Insert/Update Functions
@@ -200,80 +401,95 @@ int RedisLists::InsertAfter(const std::string& key, const std::string& pivot,
 // Prepend value onto beginning of (list: key)
 //   : throws RedisListException
 int RedisLists::PushLeft(const std::string& key, const std::string& value) {
-  // Get the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
-  // Construct the result
-  RedisListIterator it(data);
-  it.Reserve(it.Size() + it.SizeOf(value));
-  it.InsertElement(value);
+  ListMeta meta;
+  ReadMeta(db_, get_option_, key, &meta);
 
-  // Push the data back to the db and return the length
-  db_->Put(put_option_, key, it.WriteResult());
-  return it.Length();
+  // Open a new chunk before the first one if that is full
+  if (meta.head_fill >= kChunkSize) {
+    --meta.head;
+    meta.head_fill = 0;
+  }
+  ++meta.head_fill;
+  if (meta.head == meta.tail) {
+    meta.tail_fill = meta.head_fill;
+  }
+  ++meta.length;
+
+  // Merge the element into the chunk and return the length
+  std::string operand(1, kPushLeft);
+  operand.append(value);
+  WriteBatch batch;
+  batch.Merge(ChunkKey(key, meta.head), operand);
+  WriteMeta(&batch, key, meta);
+  Write(db_, put_option_, &batch);
+  return static_cast<int>(meta.length);
 }
 
 // Append value onto end of (list: key)
-// TODO: Make this O(1) time. Might require MergeOperator.
 //   : throws RedisListException
 int RedisLists::PushRight(const std::string& key, const std::string& value) {
-  // Get the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
+  ListMeta meta;
+  ReadMeta(db_, get_option_, key, &meta);
 
-  // Create an iterator to the data and seek to the end.
-  RedisListIterator it(data);
-  it.Reserve(it.Size() + it.SizeOf(value));
-  while (!it.Done()) {
-    it.Push();  // Write each element as we go
+  // Open a new chunk after the last one if that is full
+  if (meta.tail_fill >= kChunkSize) {
+    ++meta.tail;
+    meta.tail_fill = 0;
   }
-
-  // Insert the new element at the current position (the end)
-  it.InsertElement(value);
-
-  // Push it back to the db, and return length
-  db_->Put(put_option_, key, it.WriteResult());
-  return it.Length();
+  ++meta.tail_fill;
+  if (meta.head == meta.tail) {
+    meta.head_fill = meta.tail_fill;
+  }
+  ++meta.length;
+
+  // Merge the element into the chunk and return the length
+  std::string operand(1, kPushRight);
+  operand.append(value);
+  WriteBatch batch;
+  batch.Merge(ChunkKey(key, meta.tail), operand);
+  WriteMeta(&batch, key, meta);
+  Write(db_, put_option_, &batch);
+  return static_cast<int>(meta.length);
 }
 
 // Set (list: key)[idx] = val. Return true on success, false on fail.
 //   : throws RedisListException
 bool RedisLists::Set(const std::string& key, int32_t index,
                      const std::string& value) {
-  // Get the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
   // Handle negative index for REDIS (meaning -index from end of list)
   if (index < 0) {
     index = Length(key) - (-index);
   }
-
-  // Iterate through the list until we find the element we want
-  int curIndex = 0;
-  RedisListIterator it(data);
-  it.Reserve(it.Size() + it.SizeOf(value));  // Over-estimate is fine
-  while (curIndex < index && !it.Done()) {
-    it.Push();
-    ++curIndex;
-  }
-
-  // If not found, return false (this occurs when index was invalid)
-  if (it.Done() || curIndex != index) {
+  if (index < 0) {
     return false;
   }
 
-  // Write the new element value, and drop the previous element value
-  it.InsertElement(value);
-  it.Skip();
+  // Find the chunk of the element, and rewrite only that chunk
+  bool found = false;
+  Status s;
+  int curIndex = 0;
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& chunk_key, const std::string& data) {
+                 RedisListIterator it(data);
+                 if (curIndex + it.Length() <= index) {
+                   curIndex += it.Length();
+                   return true;
+                 }
+                 it.Reserve(it.Size() + it.SizeOf(value));
+                 for (; curIndex < index; ++curIndex) {
+                   it.Push();
+                 }
+
+                 // Write the new element value, and drop the previous one
+                 it.InsertElement(value);
+                 it.Skip();
+                 s = db_->Put(put_option_, chunk_key, it.WriteResult());
+                 found = true;
+                 return false;
+               });
 
-  // Write the data to the database
   // Check status, since it needs to return true/false guarantee
-  Status s = db_->Put(put_option_, key, it.WriteResult());
-
-  // Success
-  return s.ok();
+  return found && s.ok();
 }
 
 /// Delete / Remove / Pop functions
@@ -283,12 +499,13 @@ bool RedisLists::Set(const std::string& key, int32_t index,
 //  or the portion of the list that fits in this interval
 //   : throws RedisListException
 bool RedisLists::Trim(const std::string& key, int32_t start, int32_t stop) {
-  // Get the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
+  ListMeta meta;
+  if (!ReadMeta(db_, get_option_, key, &meta)) {
+    return true;
+  }
 
   // Handle negative indices in REDIS
-  int listLen = Length(key);
+  int listLen = static_cast<int>(meta.length);
   if (start < 0) {
     start = listLen - (-start);
   }
@@ -300,98 +517,150 @@ bool RedisLists::Trim(const std::string& key, int32_t start, int32_t stop) {
   start = std::max(start, 0);
   stop = std::min(stop, listLen - 1);
 
-  // Construct an iterator for the list. Drop all undesired elements.
+  // Delete the chunks out of the range, and rewrite the two chunks that are
+  // partially in it
+  WriteBatch batch;
+  bool first = true;
   int curIndex = 0;
-  RedisListIterator it(data);
-  it.Reserve(it.Size());  // Over-estimate
-  while (!it.Done()) {
-    // If not within the range, just skip the item (drop it).
-    // Otherwise, continue as usual.
-    if (start <= curIndex && curIndex <= stop) {
-      it.Push();
-    } else {
-      it.Skip();
-    }
-
-    // Increment the current index
-    ++curIndex;
-  }
-
-  // Write the (possibly empty) result to the database
-  Status s = db_->Put(put_option_, key, it.WriteResult());
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& chunk_key, const std::string& data) {
+                 RedisListIterator it(data);
+                 int chunkLen = it.Length();
+                 if (curIndex + chunkLen <= start || curIndex > stop) {
+                   batch.Delete(chunk_key);
+                   curIndex += chunkLen;
+                   return true;
+                 }
+                 if (start <= curIndex && curIndex + chunkLen - 1 <= stop) {
+                   curIndex += chunkLen;
+                 } else {
+                   it.Reserve(it.Size());  // Over-estimate
+                   while (!it.Done()) {
+                     if (start <= curIndex && curIndex <= stop) {
+                       it.Push();
+                     } else {
+                       it.Skip();
+                     }
+                     ++curIndex;
+                   }
+                   WriteChunk(&batch, chunk_key, &it);
+                   if (it.Length() == 0) {
+                     return true;
+                   }
+                 }
+                 uint64_t seq = ChunkSeq(chunk_key);
+                 if (first) {
+                   meta.head = seq;
+                   meta.head_fill = it.Length();
+                   first = false;
+                 }
+                 meta.tail = seq;
+                 meta.tail_fill = it.Length();
+                 return true;
+               });
+  meta.length = std::max(stop - start + 1, 0);
+  WriteMeta(&batch, key, meta);
 
   // Return true as long as the write succeeded
-  return s.ok();
+  return db_->Write(put_option_, &batch).ok();
 }
 
 // Return and remove the first element in the list (or "" if empty)
 //   : throws RedisListException
 bool RedisLists::PopLeft(const std::string& key, std::string* result) {
-  // Get the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
+  ListMeta meta;
+  if (!ReadMeta(db_, get_option_, key, &meta)) {
+    return false;
+  }
+
+  // The first chunk at or after the head, chunks may have been removed
+  std::string prefix = ChunkPrefix(key);
+  std::unique_ptr<Iterator> iter(db_->NewIterator(get_option_));
+  iter->Seek(ChunkKey(key, meta.head));
+  if (!iter->Valid() || !iter->key().starts_with(prefix)) {
+    throw RedisListException();
+  }
+  std::string chunk_key = iter->key().ToString();
+  std::string data = iter->value().ToString();
+  iter.reset();
 
-  // Point to first element in the list (if it exists), and get its value/size
+  // Drop the first element of the chunk
   RedisListIterator it(data);
-  if (it.Length() > 0) {  // Proceed only if list is non-empty
-    Slice elem;
-    it.GetCurrent(&elem);  // Store the value of the first element
-    it.Reserve(it.Size() - it.SizeOf(elem));
-    it.Skip();  // DROP the first item and move to next
-
-    // Update the db
-    db_->Put(put_option_, key, it.WriteResult());
-
-    // Return the value
-    if (result != nullptr) {
-      *result = elem.ToString();
-    }
-    return true;
-  } else {
-    return false;
+  Slice elem;
+  it.GetCurrent(&elem);  // Store the value of the first element
+  it.Reserve(it.Size() - it.SizeOf(elem));
+  if (result != nullptr) {
+    *result = elem.ToString();
   }
+  it.Skip();  // DROP the first item and move to next
+
+  // Update the db
+  WriteBatch batch;
+  WriteChunk(&batch, chunk_key, &it);
+  --meta.length;
+  meta.head = ChunkSeq(chunk_key);
+  meta.head_fill = it.Length();
+  if (it.Length() == 0) {
+    ++meta.head;
+    meta.head_fill = meta.head == meta.tail ? meta.tail_fill : kChunkSize;
+  } else if (meta.head == meta.tail) {
+    meta.tail_fill = meta.head_fill;
+  }
+  WriteMeta(&batch, key, meta);
+  Write(db_, put_option_, &batch);
+  return true;
 }
 
 // Remove and return the last element in the list (or "" if empty)
-// TODO: Make this O(1). Might require MergeOperator.
 //   : throws RedisListException
 bool RedisLists::PopRight(const std::string& key, std::string* result) {
-  // Extract the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
+  ListMeta meta;
+  if (!ReadMeta(db_, get_option_, key, &meta)) {
+    return false;
+  }
+
+  // The last chunk at or before the tail, chunks may have been removed
+  std::string prefix = ChunkPrefix(key);
+  std::unique_ptr<Iterator> iter(db_->NewIterator(get_option_));
+  iter->SeekForPrev(ChunkKey(key, meta.tail));
+  if (!iter->Valid() || !iter->key().starts_with(prefix)) {
+    throw RedisListException();
+  }
+  std::string chunk_key = iter->key().ToString();
+  std::string data = iter->value().ToString();
+  iter.reset();
 
   // Construct an iterator to the data and move to last element
   RedisListIterator it(data);
   it.Reserve(it.Size());
   int len = it.Length();
-  int curIndex = 0;
-  while (curIndex < (len - 1) && !it.Done()) {
+  for (int curIndex = 0; curIndex < len - 1; ++curIndex) {
     it.Push();
-    ++curIndex;
   }
 
   // Extract and drop/skip the last element
-  if (curIndex == len - 1) {
-    assert(!it.Done());  // Sanity check. Should not have ended here.
-
-    // Extract and pop the element
-    Slice elem;
-    it.GetCurrent(&elem);  // Save value of element.
-    it.Skip();             // Skip the element
-
-    // Write the result to the database
-    db_->Put(put_option_, key, it.WriteResult());
-
-    // Return the value
-    if (result != nullptr) {
-      *result = elem.ToString();
-    }
-    return true;
-  } else {
-    // Must have been an empty list
-    assert(it.Done() && len == 0 && curIndex == 0);
-    return false;
+  Slice elem;
+  it.GetCurrent(&elem);  // Save value of element.
+  if (result != nullptr) {
+    *result = elem.ToString();
   }
+  it.Skip();  // Skip the element
+
+  // Write the result to the database
+  WriteBatch batch;
+  WriteChunk(&batch, chunk_key, &it);
+  --meta.length;
+  meta.tail = ChunkSeq(chunk_key);
+  meta.tail_fill = it.Length();
+  if (it.Length() == 0) {
+    --meta.tail;
+    meta.tail_fill = meta.head == meta.tail ? meta.head_fill : kChunkSize;
+  } else if (meta.head == meta.tail) {
+    meta.head_fill = meta.tail_fill;
+  }
+  WriteMeta(&batch, key, meta);
+  Write(db_, put_option_, &batch);
+  return true;
 }
 
 // Remove the (first or last) "num" occurrences of value in (list: key)
@@ -414,134 +683,141 @@ int RedisLists::RemoveFirst(const std::string& key, int32_t num,
                             const std::string& value) {
   // Ensure that the number is positive
   assert(num >= 0);
-
-  // Extract the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
-  // Traverse the list, appending all but the desired occurrences of value
-  int numSkipped = 0;  // Keep track of the number of times value is seen
-  Slice elem;
-  RedisListIterator it(data);
-  it.Reserve(it.Size());
-  while (!it.Done()) {
-    it.GetCurrent(&elem);
-
-    if (elem == value && numSkipped < num) {
-      // Drop this item if desired
-      it.Skip();
-      ++numSkipped;
-    } else {
-      // Otherwise keep the item and proceed as normal
-      it.Push();
-    }
-  }
-
-  // Put the result back to the database
-  db_->Put(put_option_, key, it.WriteResult());
-
-  // Return the number of elements removed
-  return numSkipped;
+  return Remove(key, 0, num, value);
 }
 
 // Remove the last "num" occurrences of value in (list: key).
-// TODO: I traverse the list 2x. Make faster. Might require MergeOperator.
 //   : throws RedisListException
 int RedisLists::RemoveLast(const std::string& key, int32_t num,
                            const std::string& value) {
   // Ensure that the number is positive
   assert(num >= 0);
 
-  // Extract the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
-  // Temporary variable to hold the "current element" in the blocks below
-  Slice elem;
-
   // Count the total number of occurrences of value
   int totalOccs = 0;
-  for (RedisListIterator it(data); !it.Done(); it.Skip()) {
-    it.GetCurrent(&elem);
-    if (elem == value) {
-      ++totalOccs;
-    }
-  }
-
-  // Construct an iterator to the data. Reserve enough space for the result.
-  RedisListIterator it(data);
-  int bytesRemoved = std::min(num, totalOccs) * it.SizeOf(value);
-  it.Reserve(it.Size() - bytesRemoved);
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& /*chunk_key*/, const std::string& data) {
+                 Slice elem;
+                 for (RedisListIterator it(data); !it.Done(); it.Skip()) {
+                   it.GetCurrent(&elem);
+                   if (elem == value) {
+                     ++totalOccs;
+                   }
+                 }
+                 return true;
+               });
 
-  // Traverse the list, appending all but the desired occurrences of value.
   // Note: "Drop the last k occurrences" is equivalent to
   //  "keep only the first n-k occurrences", where n is total occurrences.
-  int numKept = 0;  // Keep track of the number of times value is kept
-  while (!it.Done()) {
-    it.GetCurrent(&elem);
-
-    // If we are within the deletion range and equal to value, drop it.
-    // Otherwise, append/keep/push it.
-    if (elem == value) {
-      if (numKept < totalOccs - num) {
-        it.Push();
-        ++numKept;
-      } else {
-        it.Skip();
-      }
-    } else {
-      // Always append the others
-      it.Push();
-    }
+  return Remove(key, std::max(totalOccs - num, 0), num, value);
+}
+
+/// Private functions
+
+// Remove the "num" occurrences of value in (list: key) that follow the first
+// "keep" ones. Only the chunks which have any of them are rewritten.
+//   : throws RedisListException
+int RedisLists::Remove(const std::string& key, int32_t keep, int32_t num,
+                       const std::string& value) {
+  ListMeta meta;
+  if (num == 0 || !ReadMeta(db_, get_option_, key, &meta)) {
+    return 0;
   }
 
-  // Put the result back to the database
-  db_->Put(put_option_, key, it.WriteResult());
+  WriteBatch batch;
+  int numSeen = 0;     // Keep track of the number of times value is seen
+  int numSkipped = 0;  // ...and the number of times it is dropped
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& chunk_key, const std::string& data) {
+                 Slice elem;
+                 RedisListIterator it(data);
+                 it.Reserve(it.Size());
+                 int chunkSkipped = 0;
+                 while (!it.Done()) {
+                   it.GetCurrent(&elem);
+                   if (elem == value && numSeen++ >= keep &&
+                       numSkipped < num) {
+                     // Drop this item if desired
+                     it.Skip();
+                     ++numSkipped;
+                     ++chunkSkipped;
+                   } else {
+                     // Otherwise keep the item and proceed as normal
+                     it.Push();
+                   }
+                 }
+                 if (chunkSkipped > 0) {
+                   WriteChunk(&batch, chunk_key, &it);
+                 }
+                 return numSkipped < num;
+               });
+  if (numSkipped > 0) {
+    meta.length -= numSkipped;
+    WriteMeta(&batch, key, meta);
+    Write(db_, put_option_, &batch);
+  }
 
   // Return the number of elements removed
-  return totalOccs - numKept;
+  return numSkipped;
 }
 
-/// Private functions
-
 // Insert element value into (list: key), right before/after
 //  the first occurrence of pivot
 //   : throws RedisListException
 int RedisLists::Insert(const std::string& key, const std::string& pivot,
                        const std::string& value, bool insert_after) {
-  // Get the original list data
-  std::string data;
-  db_->Get(get_option_, key, &data);
-
-  // Construct an iterator to the data and reserve enough space for result.
-  RedisListIterator it(data);
-  it.Reserve(it.Size() + it.SizeOf(value));
-
-  // Iterate through the list until we find the element we want
-  Slice elem;
-  bool found = false;
-  while (!it.Done() && !found) {
-    it.GetCurrent(&elem);
-
-    // When we find the element, insert the element and mark found
-    if (elem == pivot) {  // Found it!
-      found = true;
-      if (insert_after == true) {  // Skip one more, if inserting after it
-        it.Push();
-      }
-      it.InsertElement(value);
-    } else {
-      it.Push();
-    }
+  ListMeta meta;
+  if (!ReadMeta(db_, get_option_, key, &meta)) {
+    return 0;
   }
 
-  // Put the data (string) into the database
+  // Iterate through the chunks until we find the element we want
+  WriteBatch batch;
+  bool found = false;
+  ForEachChunk(db_, get_option_, key,
+               [&](const Slice& chunk_key, const std::string& data) {
+                 // Construct an iterator to the data and reserve enough space
+                 RedisListIterator it(data);
+                 it.Reserve(it.Size() + it.SizeOf(value));
+                 Slice elem;
+                 while (!it.Done() && !found) {
+                   it.GetCurrent(&elem);
+
+                   // When we find the element, insert the element and mark
+                   // found
+                   if (elem == pivot) {  // Found it!
+                     found = true;
+                     if (insert_after == true) {  // Skip one more
+                       it.Push();
+                     }
+                     it.InsertElement(value);
+                   } else {
+                     it.Push();
+                   }
+                 }
+                 if (!found) {
+                   return true;
+                 }
+                 batch.Put(chunk_key, it.WriteResult());
+                 uint64_t seq = ChunkSeq(chunk_key);
+                 if (seq == meta.head) {
+                   ++meta.head_fill;
+                 }
+                 if (seq == meta.tail) {
+                   ++meta.tail_fill;
+                 }
+                 return false;
+               });
+
+  // Put the chunk and the meta into the database
   if (found) {
-    db_->Put(put_option_, key, it.WriteResult());
+    ++meta.length;
+    WriteMeta(&batch, key, meta);
+    Write(db_, put_option_, &batch);
   }
 
   // Returns the new (possibly unchanged) length of the list
-  return it.Length();
+  return static_cast<int>(meta.length);
 }
 
 }  // namespace TERARKDB_NAMESPACE
@@ -11,12 +11,14 @@
 #ifndef ROCKSDB_LITE
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "redis_list_exception.h"
 #include "redis_list_iterator.h"
 #include "rocksdb/db.h"
+#include "rocksdb/merge_operator.h"
 #include "rocksdb/terark_namespace.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -32,6 +34,13 @@ class RedisLists {
   RedisLists(const std::string& db_path, Options options,
              bool destructive = false);
 
+  /// Keep the lists in (db), which must outlive this, and have been opened
+  /// with the merge operator of CreateMergeOperator().
+  explicit RedisLists(DB* db);
+
+  /// The merge operator which pushes the elements into the lists
+  static std::shared_ptr<MergeOperator> CreateMergeOperator();
+
  public:  // Accessors
   /// The number of items in (list: key)
   int Length(const std::string& key);
@@ -93,16 +102,19 @@ class RedisLists {
   int Insert(const std::string& key, const std::string& pivot,
              const std::string& value, bool insert_after);
 
+  /// Calls by RemoveFirst and RemoveLast
+  int Remove(const std::string& key, int32_t keep, int32_t num,
+             const std::string& value);
+
  private:
   std::string db_name_;  // The actual database name/path
   WriteOptions put_option_;
   ReadOptions get_option_;
 
-  /// The backend rocksdb database.
-  /// Map : key --> list
-  ///       where a list is a sequence of elements
-  ///       and an element is a 4-byte integer (n), followed by n bytes of data
-  std::unique_ptr<DB> db_;
+  /// The backend rocksdb database, see redis_lists.cc for the layout of the
+  /// lists in it.
+  DB* db_;
+  std::unique_ptr<DB> owned_db_;
 };
 
 }  // namespace TERARKDB_NAMESPACE
@@ -24,6 +24,7 @@
 
 #include "rocksdb/terark_namespace.h"
 #include "util/random.h"
+#include "util/string_util.h"
 #include "util/testharness.h"
 
 using namespace TERARKDB_NAMESPACE;
@@ -740,6 +741,67 @@ TEST_F(RedisListsTest, PersistenceMultiKeyTest) {
   }
 }
 
+// Test lists spanning many chunks
+TEST_F(RedisListsTest, ManyChunksTest) {
+  RedisLists redis(kDefaultDbName, options, true);  // Destructive
+  std::string tempv;
+
+  // [-1000, ..., -1, 0, ..., 999]
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(redis.PushRight("k1", ToString(i)), 2 * i + 1);
+    ASSERT_EQ(redis.PushLeft("k1", ToString(-i - 1)), 2 * i + 2);
+  }
+  ASSERT_EQ(redis.Length("k1"), 2000);
+  ASSERT_TRUE(redis.Index("k1", 0, &tempv));
+  ASSERT_EQ(tempv, "-1000");
+  ASSERT_TRUE(redis.Index("k1", 1500, &tempv));
+  ASSERT_EQ(tempv, "500");
+  ASSERT_TRUE(redis.Index("k1", -1, &tempv));
+  ASSERT_EQ(tempv, "999");
+  ASSERT_FALSE(redis.Index("k1", 2000, &tempv));
+
+  std::vector<std::string> result = redis.Range("k1", 990, 1009);
+  ASSERT_EQ(result.size(), 20u);
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_EQ(result[i], ToString(i - 10));
+  }
+
+  // Pop across the chunk boundaries from both ends
+  for (int i = 0; i < 300; ++i) {
+    ASSERT_TRUE(redis.PopLeft("k1", &tempv));
+    ASSERT_EQ(tempv, ToString(i - 1000));
+    ASSERT_TRUE(redis.PopRight("k1", &tempv));
+    ASSERT_EQ(tempv, ToString(999 - i));
+  }
+  ASSERT_EQ(redis.Length("k1"), 1400);
+
+  // Modify the middle chunks, then trim to them
+  ASSERT_TRUE(redis.Set("k1", 700, "mid"));
+  ASSERT_EQ(redis.InsertAfter("k1", "mid", "after"), 1401);
+  ASSERT_EQ(redis.Remove("k1", 1, "-1"), 1);
+  ASSERT_TRUE(redis.Trim("k1", 500, 899));
+  ASSERT_EQ(redis.Length("k1"), 400);
+  ASSERT_TRUE(redis.Index("k1", 0, &tempv));
+  ASSERT_EQ(tempv, "-200");
+  ASSERT_TRUE(redis.Index("k1", 199, &tempv));
+  ASSERT_EQ(tempv, "mid");
+  ASSERT_TRUE(redis.Index("k1", 200, &tempv));
+  ASSERT_EQ(tempv, "after");
+  ASSERT_TRUE(redis.Index("k1", -1, &tempv));
+  ASSERT_EQ(tempv, "199");
+
+  // Pop all, then push into the empty list again
+  for (int i = 0; i < 400; ++i) {
+    ASSERT_TRUE(redis.PopRight("k1", &tempv));
+  }
+  ASSERT_EQ(tempv, "-200");
+  ASSERT_EQ(redis.Length("k1"), 0);
+  ASSERT_FALSE(redis.PopLeft("k1", &tempv));
+  ASSERT_EQ(redis.PushLeft("k1", "a"), 1);
+  ASSERT_TRUE(redis.PopRight("k1", &tempv));
+  ASSERT_EQ(tempv, "a");
+}
+
 /// THE manual REDIS TEST begins here
 /// THIS WILL ONLY OCCUR IF YOU RUN: ./redis_test -m
 
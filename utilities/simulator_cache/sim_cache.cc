@@ -5,13 +5,17 @@
 
 #include "rocksdb/utilities/sim_cache.h"
 
+#include <algorithm>
 #include <atomic>
+#include <list>
+#include <unordered_map>
 
 #include "monitoring/statistics.h"
 #include "port/port.h"
 #include "rocksdb/env.h"
 #include "rocksdb/terark_namespace.h"
 #include "util/file_reader_writer.h"
+#include "util/hash.h"
 #include "util/mutexlock.h"
 #include "util/string_util.h"
 
@@ -150,18 +154,219 @@ class CacheActivityLogger {
   Status bg_status_;
 };
 
+// The Mattson stack distances of the lookups of a sample of the keys, as in
+// SHARDS: a key is sampled when its hash falls under the sample rate, and
+// the distances among the sampled keys scaled up by the rate estimate the
+// distances among all of them. The distance of a lookup is the charge of the
+// distinct keys referenced since the last reference to its key, its own
+// included, an LRU cache of at least that capacity hits.
+class StackDistanceSampler {
+ public:
+  explicit StackDistanceSampler(double sample_rate)
+      : threshold_(static_cast<uint32_t>(std::min(sample_rate, 1.0) *
+                                         kHashRange)),
+        lookups_(0),
+        total_charge_(0),
+        next_time_(0) {
+    scale_ = threshold_ == 0 ? 0 : static_cast<double>(kHashRange) / threshold_;
+    std::fill(histogram_, histogram_ + kNumBuckets, 0);
+  }
+
+  bool IsSampled(const Slice& key) const {
+    return (GetSliceHash(key) & (kHashRange - 1)) < threshold_;
+  }
+
+  // REQUIRES: IsSampled(key)
+  void Lookup(const Slice& key) {
+    MutexLock l(&mutex_);
+    ++lookups_;
+    auto find = entries_.find(key.ToString());
+    if (find == entries_.end()) {
+      // A miss at every capacity, inserted after it
+      return;
+    }
+    Entry& entry = find->second;
+    uint64_t distance = total_charge_ - Sum(entry.time) + entry.charge;
+    ++histogram_[Bucket(static_cast<uint64_t>(distance * scale_))];
+    Touch(&entry);
+  }
+
+  // REQUIRES: IsSampled(key)
+  void Insert(const Slice& key, size_t charge) {
+    MutexLock l(&mutex_);
+    auto ib = entries_.emplace(key.ToString(), Entry());
+    Entry& entry = ib.first->second;
+    if (!ib.second) {
+      Add(entry.time, charge - entry.charge);
+      total_charge_ += charge - entry.charge;
+      entry.charge = charge;
+      Touch(&entry);
+      return;
+    }
+    if (entries_.size() > kMaxSampledKeys) {
+      // The reuses past the oldest keys count as misses
+      auto oldest = entries_.find(*lru_.front());
+      Remove(oldest);
+    }
+    if (next_time_ == tree_.size()) {
+      Renumber();
+    }
+    entry.charge = charge;
+    entry.time = next_time_++;
+    entry.lru = lru_.insert(lru_.end(), &ib.first->first);
+    Add(entry.time, charge);
+    total_charge_ += charge;
+  }
+
+  // REQUIRES: IsSampled(key)
+  void Erase(const Slice& key) {
+    MutexLock l(&mutex_);
+    auto find = entries_.find(key.ToString());
+    if (find != entries_.end()) {
+      Remove(find);
+    }
+  }
+
+  void ResetCounters() {
+    MutexLock l(&mutex_);
+    lookups_ = 0;
+    std::fill(histogram_, histogram_ + kNumBuckets, 0);
+  }
+
+  void GetHitRatioCurve(std::vector<SimCacheHitRatio>* curve) const {
+    curve->clear();
+    MutexLock l(&mutex_);
+    if (lookups_ == 0) {
+      return;
+    }
+    size_t first = 0;
+    size_t last = kNumBuckets;
+    while (first < kNumBuckets && histogram_[first] == 0) {
+      ++first;
+    }
+    while (last > first && histogram_[last - 1] == 0) {
+      --last;
+    }
+    uint64_t hits = 0;
+    for (size_t i = 0; i < last; ++i) {
+      hits += histogram_[i];
+      if (i >= first) {
+        curve->push_back({BucketLimit(i),
+                          static_cast<double>(hits) / lookups_});
+      }
+    }
+  }
+
+ private:
+  // The sampling compares the low bits of the key hashes
+  static const uint32_t kHashRange = 1 << 24;
+  static const size_t kMaxSampledKeys = 1 << 20;
+  // Four buckets per power of two of the distance
+  static const size_t kNumBuckets = 64 * 4;
+
+  struct Entry {
+    // The position of the last reference in tree_
+    size_t time;
+    size_t charge;
+    std::list<const std::string*>::iterator lru;
+  };
+  typedef std::unordered_map<std::string, Entry> EntryMap;
+
+  static size_t Bucket(uint64_t distance) {
+    if (distance < 4) {
+      return static_cast<size_t>(distance);
+    }
+    int msb = 63 - __builtin_clzll(distance);
+    return static_cast<size_t>(msb) * 4 + ((distance >> (msb - 2)) & 3);
+  }
+
+  // The distances of bucket i are below it
+  static uint64_t BucketLimit(size_t i) {
+    if (i < 4) {
+      return i + 1;
+    }
+    size_t msb = i / 4;
+    uint64_t limit = (4 + i % 4 + 1) << (msb - 2);
+    return limit == 0 ? port::kMaxUint64 : limit;
+  }
+
+  // The charges of the keys last referenced at or before `time`, from the
+  // Fenwick tree of the charges by time of last reference
+  uint64_t Sum(size_t time) const {
+    uint64_t sum = 0;
+    for (size_t i = time + 1; i > 0; i -= i & (~i + 1)) {
+      sum += tree_[i - 1];
+    }
+    return sum;
+  }
+
+  // Adds `delta` to the charge at `time`, wrapping around to subtract
+  void Add(size_t time, uint64_t delta) {
+    for (size_t i = time + 1; i <= tree_.size(); i += i & (~i + 1)) {
+      tree_[i - 1] += delta;
+    }
+  }
+
+  // Moves the entry to the newest time
+  void Touch(Entry* entry) {
+    if (next_time_ == tree_.size()) {
+      Renumber();
+    }
+    Add(entry->time, 0 - static_cast<uint64_t>(entry->charge));
+    lru_.splice(lru_.end(), lru_, entry->lru);
+    entry->time = next_time_++;
+    Add(entry->time, entry->charge);
+  }
+
+  void Remove(EntryMap::iterator it) {
+    Add(it->second.time, 0 - static_cast<uint64_t>(it->second.charge));
+    total_charge_ -= it->second.charge;
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+  }
+
+  // Gives the keys the times 0 to n - 1 in the order of their last
+  // references, leaving room for as many references
+  void Renumber() {
+    tree_.assign(std::max<size_t>(2 * lru_.size(), 1024), 0);
+    next_time_ = 0;
+    for (auto key : lru_) {
+      Entry& entry = entries_.find(*key)->second;
+      entry.time = next_time_++;
+      Add(entry.time, entry.charge);
+    }
+  }
+
+  const uint32_t threshold_;
+  double scale_;
+
+  mutable port::Mutex mutex_;
+  uint64_t lookups_;
+  uint64_t histogram_[kNumBuckets];
+  EntryMap entries_;
+  // The keys of entries_, the least recently referenced first
+  std::list<const std::string*> lru_;
+  std::vector<uint64_t> tree_;
+  uint64_t total_charge_;
+  size_t next_time_;
+};
+
 // SimCacheImpl definition
 class SimCacheImpl : public SimCache {
  public:
   // capacity for real cache (ShardedLRUCache)
   // test_capacity for key only cache
   SimCacheImpl(std::shared_ptr<Cache> cache, size_t sim_capacity,
-               int num_shard_bits)
+               int num_shard_bits, double curve_sample_rate)
       : cache_(cache),
         key_only_cache_(NewLRUCache(sim_capacity, num_shard_bits)),
         miss_times_(0),
         hit_times_(0),
-        stats_(nullptr) {}
+        stats_(nullptr) {
+    if (curve_sample_rate > 0) {
+      sampler_.reset(new StackDistanceSampler(curve_sample_rate));
+    }
+  }
 
   virtual ~SimCacheImpl() {}
   virtual void SetCapacity(size_t capacity) override {
@@ -188,6 +393,9 @@ class SimCacheImpl : public SimCache {
     } else {
       key_only_cache_->Release(h);
     }
+    if (sampler_ != nullptr && sampler_->IsSampled(key)) {
+      sampler_->Insert(key, charge);
+    }
 
     cache_activity_logger_.ReportAdd(key, charge);
 
@@ -204,6 +412,9 @@ class SimCacheImpl : public SimCache {
       inc_miss_counter();
       RecordTick(stats, SIM_BLOCK_CACHE_MISS);
     }
+    if (sampler_ != nullptr && sampler_->IsSampled(key)) {
+      sampler_->Lookup(key);
+    }
 
     cache_activity_logger_.ReportLookup(key);
 
@@ -219,6 +430,9 @@ class SimCacheImpl : public SimCache {
   virtual void Erase(const Slice& key) override {
     cache_->Erase(key);
     key_only_cache_->Erase(key);
+    if (sampler_ != nullptr && sampler_->IsSampled(key)) {
+      sampler_->Erase(key);
+    }
   }
 
   virtual void* Value(Handle* handle) override { return cache_->Value(handle); }
@@ -280,6 +494,18 @@ class SimCacheImpl : public SimCache {
     hit_times_.store(0, std::memory_order_relaxed);
     SetTickerCount(stats_, SIM_BLOCK_CACHE_HIT, 0);
     SetTickerCount(stats_, SIM_BLOCK_CACHE_MISS, 0);
+    if (sampler_ != nullptr) {
+      sampler_->ResetCounters();
+    }
+  }
+
+  virtual void GetHitRatioCurve(
+      std::vector<SimCacheHitRatio>* curve) const override {
+    if (sampler_ != nullptr) {
+      sampler_->GetHitRatioCurve(curve);
+    } else {
+      curve->clear();
+    }
   }
 
   virtual std::string ToString() const override {
@@ -326,6 +552,7 @@ class SimCacheImpl : public SimCache {
   std::atomic<uint64_t> hit_times_;
   Statistics* stats_;
   CacheActivityLogger cache_activity_logger_;
+  std::unique_ptr<StackDistanceSampler> sampler_;
 
   void inc_miss_counter() {
     miss_times_.fetch_add(1, std::memory_order_relaxed);
@@ -337,11 +564,13 @@ class SimCacheImpl : public SimCache {
 
 // For instrumentation purpose, use NewSimCache instead
 std::shared_ptr<SimCache> NewSimCache(std::shared_ptr<Cache> cache,
-                                      size_t sim_capacity, int num_shard_bits) {
+                                      size_t sim_capacity, int num_shard_bits,
+                                      double curve_sample_rate) {
   if (num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
-  return std::make_shared<SimCacheImpl>(cache, sim_capacity, num_shard_bits);
+  return std::make_shared<SimCacheImpl>(cache, sim_capacity, num_shard_bits,
+                                        curve_sample_rate);
 }
 
 }  // end namespace TERARKDB_NAMESPACE
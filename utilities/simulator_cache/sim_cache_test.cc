@@ -213,6 +213,72 @@ TEST_F(SimCacheTest, SimCacheLogging) {
   ASSERT_GT(fsize, max_size - 100);
 }
 
+TEST_F(SimCacheTest, HitRatioCurve) {
+  std::shared_ptr<SimCache> sim_cache =
+      NewSimCache(NewLRUCache(1 << 20), 1 << 20, 0, 1.0 /* sample_rate */);
+  auto deleter = [](const Slice& /*key*/, void* /*value*/) {};
+  std::vector<SimCacheHitRatio> curve;
+  sim_cache->GetHitRatioCurve(&curve);
+  ASSERT_TRUE(curve.empty());
+
+  // Looked up in a cycle, an LRU cache smaller than the 64 keys always misses
+  const int kNumKeys = 64;
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(nullptr, sim_cache->Lookup(Key(i)));
+    ASSERT_OK(sim_cache->Insert(Key(i), nullptr, 100, deleter));
+  }
+  sim_cache->reset_counter();
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < kNumKeys; ++i) {
+      Cache::Handle* h = sim_cache->Lookup(Key(i));
+      ASSERT_NE(nullptr, h);
+      sim_cache->Release(h);
+    }
+  }
+  sim_cache->GetHitRatioCurve(&curve);
+  ASSERT_EQ(1U, curve.size());
+  ASSERT_GT(curve[0].capacity, 100U * kNumKeys);
+  ASSERT_LE(curve[0].capacity, 200U * kNumKeys);
+  ASSERT_EQ(1.0, curve[0].hit_ratio);
+
+  // Misses at every capacity
+  for (int i = kNumKeys; i < 2 * kNumKeys; ++i) {
+    ASSERT_EQ(nullptr, sim_cache->Lookup(Key(i)));
+  }
+  // A distance of 2 keys
+  sim_cache->Erase(Key(1));
+  ASSERT_OK(sim_cache->Insert(Key(1), nullptr, 100, deleter));
+  ASSERT_OK(sim_cache->Insert(Key(2), nullptr, 100, deleter));
+  sim_cache->Release(sim_cache->Lookup(Key(1)));
+  sim_cache->GetHitRatioCurve(&curve);
+  ASSERT_LE(curve.front().capacity, 256U);
+  ASSERT_EQ(1.0 / (4 * kNumKeys + 1), curve.front().hit_ratio);
+  ASSERT_EQ((3.0 * kNumKeys + 1) / (4 * kNumKeys + 1), curve.back().hit_ratio);
+
+  sim_cache->reset_counter();
+  sim_cache->GetHitRatioCurve(&curve);
+  ASSERT_TRUE(curve.empty());
+
+  // Through the block cache of a DB
+  auto table_options = GetTableOptions();
+  table_options.block_cache =
+      NewSimCache(NewLRUCache(1 << 20), 1 << 20, 0, 1.0 /* sample_rate */);
+  Options options = GetOptions(table_options);
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+  InitTable(options);
+  ASSERT_OK(Flush());
+  std::string value;
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < kNumBlocks * 2; ++i) {
+      ASSERT_EQ(std::string(kValueSize, 'a'), Get(ToString(i)));
+    }
+  }
+  ASSERT_TRUE(
+      db_->GetProperty(DB::Properties::kBlockCacheHitRatioCurve, &value));
+  ASSERT_NE(std::string::npos, value.find("HitRatio"));
+}
+
 }  // namespace TERARKDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -28,11 +28,13 @@
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/options.h"
 #include "rocksdb/slice_transform.h"
+#include "rocksdb/sst_file_writer.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/table.h"
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/utilities/stackable_db.h"
 #include "util/coding.h"
+#include "util/string_util.h"
 #include "utilities/spatialdb/utils.h"
 
 namespace TERARKDB_NAMESPACE {
@@ -354,32 +356,22 @@ class SpatialIndexCursor : public Cursor {
   SpatialIndexCursor(Iterator* spatial_iterator, ValueGetter* value_getter,
                      const BoundingBox<uint64_t>& tile_bbox, uint32_t tile_bits)
       : value_getter_(value_getter), valid_(true) {
-    // calculate quad keys we'll need to query
-    std::vector<uint64_t> quad_keys;
-    quad_keys.reserve(
-        static_cast<size_t>((tile_bbox.max_x - tile_bbox.min_x + 1) *
-                            (tile_bbox.max_y - tile_bbox.min_y + 1)));
-    for (uint64_t x = tile_bbox.min_x; x <= tile_bbox.max_x; ++x) {
-      for (uint64_t y = tile_bbox.min_y; y <= tile_bbox.max_y; ++y) {
-        quad_keys.push_back(GetQuadKeyFromTile(x, y, tile_bits));
-      }
-    }
-    std::sort(quad_keys.begin(), quad_keys.end());
-
-    // load primary key ids for all quad keys
-    for (auto quad_key : quad_keys) {
-      std::string encoded_quad_key;
-      PutFixed64BigEndian(&encoded_quad_key, quad_key);
-      Slice slice_quad_key(encoded_quad_key);
-
-      // If CheckQuadKey is true, there is no need to reseek, since
-      // spatial_iterator is already pointing at the correct quad key. This is
-      // an optimization.
-      if (!CheckQuadKey(spatial_iterator, slice_quad_key)) {
-        spatial_iterator->Seek(slice_quad_key);
+    // Load primary key ids of the quad key ranges, seeking once per range.
+    // The ranges are sorted, the iterator may already be in the next one.
+    for (const auto& range : GetQuadKeyRanges(tile_bbox, tile_bits)) {
+      std::string encoded_first;
+      PutFixed64BigEndian(&encoded_first, range.first);
+      uint64_t quad_key = 0;
+      if (!InQuadKeyRange(spatial_iterator, range, &quad_key)) {
+        if (!valid_) {
+          break;
+        }
+        if (!spatial_iterator->Valid() || quad_key < range.first) {
+          spatial_iterator->Seek(encoded_first);
+        }
       }
 
-      while (CheckQuadKey(spatial_iterator, slice_quad_key)) {
+      while (InQuadKeyRange(spatial_iterator, range, &quad_key)) {
         // extract ID from spatial_iterator
         uint64_t id;
         bool ok = GetFixed64BigEndian(
@@ -394,8 +386,10 @@ class SpatialIndexCursor : public Cursor {
         primary_key_ids_.insert(id);
         spatial_iterator->Next();
       }
+      if (!valid_) {
+        break;
+      }
     }
-
     if (!spatial_iterator->status().ok()) {
       status_ = spatial_iterator->status();
       valid_ = false;
@@ -437,11 +431,14 @@ class SpatialIndexCursor : public Cursor {
   }
 
  private:
-  // * returns true if spatial iterator is on the current quad key and all is
+  // * returns true if spatial iterator is on a quad key of range and all is
   // well
-  // * returns false if spatial iterator is not on current, or iterator is
+  // * returns false if spatial iterator is not in range, or iterator is
   // invalid or corruption
-  bool CheckQuadKey(Iterator* spatial_iterator, const Slice& quad_key) {
+  // quad_key is set to the quad key of a valid spatial iterator
+  bool InQuadKeyRange(Iterator* spatial_iterator,
+                      const std::pair<uint64_t, uint64_t>& range,
+                      uint64_t* quad_key) {
     if (!spatial_iterator->Valid()) {
       return false;
     }
@@ -450,14 +447,8 @@ class SpatialIndexCursor : public Cursor {
       valid_ = false;
       return false;
     }
-    Slice spatial_iterator_quad_key(spatial_iterator->key().data(),
-                                    sizeof(uint64_t));
-    if (spatial_iterator_quad_key != quad_key) {
-      // caller needs to reseek
-      return false;
-    }
-    // if we come to here, we have found the quad key
-    return true;
+    GetFixed64BigEndian(spatial_iterator->key(), quad_key);
+    return *quad_key >= range.first && *quad_key <= range.second;
   }
 
   void ExtractData() {
@@ -593,6 +584,104 @@ class SpatialDBImpl : public SpatialDB {
     return Write(write_options, &batch);
   }
 
+  virtual Status BulkInsert(
+      const std::vector<SpatialElement>& elements,
+      const std::vector<std::string>& spatial_indexes) override {
+    if (spatial_indexes.size() == 0) {
+      return Status::InvalidArgument("Spatial indexes can't be empty");
+    }
+    std::vector<const IndexColumnFamily*> indexes;
+    for (const auto& si : spatial_indexes) {
+      auto itr = name_to_index_.find(si);
+      if (itr == name_to_index_.end()) {
+        return Status::InvalidArgument("Can't find index " + si);
+      }
+      indexes.push_back(&itr->second);
+    }
+    if (elements.empty()) {
+      return Status::OK();
+    }
+
+    // Sort the elements by the quad key of their centers, and number them in
+    // that order
+    const auto& first_index = indexes[0]->index;
+    std::vector<std::pair<uint64_t, size_t>> order;
+    order.reserve(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+      const auto& bbox = elements[i].bbox;
+      BoundingBox<double> center((bbox.min_x + bbox.max_x) / 2,
+                                 (bbox.min_y + bbox.max_y) / 2,
+                                 (bbox.min_x + bbox.max_x) / 2,
+                                 (bbox.min_y + bbox.max_y) / 2);
+      BoundingBox<uint64_t> tile = GetTileBoundingBox(first_index, center);
+      order.emplace_back(
+          GetQuadKeyFromTile(tile.min_x, tile.min_y, first_index.tile_bits),
+          i);
+    }
+    std::sort(order.begin(), order.end());
+    uint64_t first_id = next_id_.fetch_add(elements.size());
+    std::string file_prefix =
+        GetName() + "/spatial_bulk_load_" + ToString(first_id);
+
+    // The ids are consecutive, so the data is sorted already. It is ingested
+    // first, so that no index entry points to missing data.
+    Status s = IngestSorted(
+        data_column_family_, file_prefix + "_data.sst",
+        [&](SstFileWriter* writer) {
+          Status t;
+          for (size_t i = 0; i < order.size() && t.ok(); ++i) {
+            const SpatialElement& element = elements[order[i].second];
+            // see above for format
+            std::string data_key;
+            PutFixed64BigEndian(&data_key, first_id + i);
+            std::string data_value;
+            PutLengthPrefixedSlice(&data_value, element.blob);
+            element.feature_set.Serialize(&data_value);
+            t = writer->Put(data_key, data_value);
+          }
+          return t;
+        });
+
+    for (size_t j = 0; j < indexes.size() && s.ok(); ++j) {
+      const auto& spatial_index = indexes[j]->index;
+      std::vector<std::pair<uint64_t, uint64_t>> entries;
+      for (size_t i = 0; i < order.size(); ++i) {
+        const auto& bbox = elements[order[i].second].bbox;
+        if (!spatial_index.bbox.Intersects(bbox)) {
+          continue;
+        }
+        BoundingBox<uint64_t> tile_bbox =
+            GetTileBoundingBox(spatial_index, bbox);
+        for (uint64_t x = tile_bbox.min_x; x <= tile_bbox.max_x; ++x) {
+          for (uint64_t y = tile_bbox.min_y; y <= tile_bbox.max_y; ++y) {
+            entries.emplace_back(
+                GetQuadKeyFromTile(x, y, spatial_index.tile_bits),
+                first_id + i);
+          }
+        }
+      }
+      if (entries.empty()) {
+        continue;
+      }
+      std::sort(entries.begin(), entries.end());
+      s = IngestSorted(indexes[j]->column_family,
+                       file_prefix + "_" + ToString(j) + ".sst",
+                       [&](SstFileWriter* writer) {
+                         Status t;
+                         for (size_t i = 0; i < entries.size() && t.ok();
+                              ++i) {
+                           // see above for format
+                           std::string key;
+                           PutFixed64BigEndian(&key, entries[i].first);
+                           PutFixed64BigEndian(&key, entries[i].second);
+                           t = writer->Put(key, Slice());
+                         }
+                         return t;
+                       });
+    }
+    return s;
+  }
+
   virtual Status Compact(int num_threads) override {
     std::vector<ColumnFamilyHandle*> column_families;
     column_families.push_back(data_column_family_);
@@ -671,6 +760,30 @@ class SpatialDBImpl : public SpatialDB {
   }
 
  private:
+  // Write the keys that add_sorted puts to a writer in order into the SST
+  // file at file_path, and ingest the file into column_family
+  template <typename AddSortedFn>
+  Status IngestSorted(ColumnFamilyHandle* column_family,
+                      const std::string& file_path, AddSortedFn&& add_sorted) {
+    SstFileWriter writer(EnvOptions(), GetOptions(column_family),
+                         column_family);
+    Status s = writer.Open(file_path);
+    if (s.ok()) {
+      s = add_sorted(&writer);
+    }
+    if (s.ok()) {
+      s = writer.Finish();
+    }
+    if (s.ok()) {
+      IngestExternalFileOptions ingest_options;
+      ingest_options.move_files = true;
+      s = IngestExternalFile(column_family, {file_path}, ingest_options);
+    }
+    // The file is linked into the DB, or failed to be
+    GetEnv()->DeleteFile(file_path);
+    return s;
+  }
+
   ColumnFamilyHandle* data_column_family_;
   struct IndexColumnFamily {
     SpatialIndexOptions index;
@@ -16,6 +16,7 @@
 #include "util/random.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
+#include "utilities/spatialdb/utils.h"
 
 namespace TERARKDB_NAMESPACE {
 namespace spatial {
@@ -290,6 +291,103 @@ TEST_F(SpatialDBTest, RandomizedTest) {
   delete db_;
 }
 
+TEST_F(SpatialDBTest, QuadKeyRangesTest) {
+  Random rnd(301);
+  const uint32_t tile_bits = 4;
+  for (int i = 0; i < 1000; ++i) {
+    BoundingBox<int> b = RandomBoundingBox(1 << tile_bits, &rnd, 8);
+    BoundingBox<uint64_t> tile_bbox(b.min_x, b.min_y, b.max_x, b.max_y);
+    std::set<uint64_t> quad_keys;
+    for (uint64_t x = tile_bbox.min_x; x <= tile_bbox.max_x; ++x) {
+      for (uint64_t y = tile_bbox.min_y; y <= tile_bbox.max_y; ++y) {
+        quad_keys.insert(GetQuadKeyFromTile(x, y, tile_bits));
+      }
+    }
+
+    // Exactly the quad keys of the tiles, in sorted ranges that aren't
+    // adjacent to each other
+    std::set<uint64_t> covered;
+    auto ranges = GetQuadKeyRanges(tile_bbox, tile_bits);
+    for (size_t j = 0; j < ranges.size(); ++j) {
+      ASSERT_LE(ranges[j].first, ranges[j].second);
+      if (j > 0) {
+        ASSERT_LT(ranges[j - 1].second + 1, ranges[j].first);
+      }
+      for (uint64_t q = ranges[j].first; q <= ranges[j].second; ++q) {
+        covered.insert(q);
+      }
+    }
+    ASSERT_TRUE(quad_keys == covered);
+  }
+
+  // A whole index is a single range
+  auto ranges = GetQuadKeyRanges(BoundingBox<uint64_t>(0, 0, 15, 15), 4);
+  ASSERT_EQ(ranges.size(), 1U);
+  ASSERT_EQ(ranges[0].first, 0U);
+  ASSERT_EQ(ranges[0].second, 255U);
+}
+
+TEST_F(SpatialDBTest, BulkInsertTest) {
+  if (!LZ4_Supported()) {
+    return;
+  }
+  Random rnd(301);
+  std::vector<std::pair<std::string, BoundingBox<int>>> elements;
+
+  BoundingBox<double> spatial_index_bounds(0, 0, (1LL << 32), (1LL << 32));
+  ASSERT_OK(SpatialDB::Create(
+      SpatialDBOptions(), dbname_,
+      {SpatialIndexOptions("index", spatial_index_bounds, 7),
+       SpatialIndexOptions("coarse", spatial_index_bounds, 3)}));
+  ASSERT_OK(SpatialDB::Open(SpatialDBOptions(), dbname_, &db_));
+  double step = (1LL << 32) / (1 << 7);
+
+  ASSERT_TRUE(db_->BulkInsert({}, {}).IsInvalidArgument());
+  ASSERT_TRUE(db_->BulkInsert({}, {"missing"}).IsInvalidArgument());
+
+  // Two bulk loads and some inserts in between
+  for (int round = 0; round < 2; ++round) {
+    std::vector<SpatialElement> bulk;
+    for (int i = 0; i < 500; ++i) {
+      std::string blob = RandomStr(&rnd);
+      BoundingBox<int> bbox = RandomBoundingBox(128, &rnd, 10);
+      bulk.emplace_back(ScaleBB(bbox, step), blob);
+      elements.push_back(make_pair(blob, bbox));
+    }
+    ASSERT_OK(db_->BulkInsert(bulk, {"index", "coarse"}));
+
+    std::string blob = RandomStr(&rnd);
+    BoundingBox<int> bbox = RandomBoundingBox(128, &rnd, 10);
+    ASSERT_OK(db_->Insert(WriteOptions(), ScaleBB(bbox, step), blob,
+                          FeatureSet(), {"index", "coarse"}));
+    elements.push_back(make_pair(blob, bbox));
+  }
+
+  for (int i = 0; i < 200; ++i) {
+    BoundingBox<int> int_bbox = RandomBoundingBox(128, &rnd, 10);
+    BoundingBox<double> double_bbox = ScaleBB(int_bbox, step);
+    std::vector<std::string> blobs;
+    for (auto e : elements) {
+      if (e.second.Intersects(int_bbox)) {
+        blobs.push_back(e.first);
+      }
+    }
+    AssertCursorResults(double_bbox, "index", blobs);
+  }
+
+  // Everything is still there after reopening
+  delete db_;
+  ASSERT_OK(SpatialDB::Open(SpatialDBOptions(), dbname_, &db_));
+  AssertCursorResults(spatial_index_bounds, "coarse", [&elements]() {
+    std::vector<std::string> blobs;
+    for (auto e : elements) {
+      blobs.push_back(e.first);
+    }
+    return blobs;
+  }());
+  delete db_;
+}
+
 }  // namespace spatial
 }  // namespace TERARKDB_NAMESPACE
 
@@ -6,6 +6,8 @@
 #pragma once
 #include <algorithm>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/utilities/spatial_db.h"
@@ -48,6 +50,48 @@ inline BoundingBox<uint64_t> GetTileBoundingBox(
                        spatial_index.bbox.max_y, spatial_index.tile_bits));
 }
 
+// Append to `ranges` the inclusive quad key ranges of the tiles of the
+// quadtree node of `size` x `size` tiles at (x, y) that are in tile_bbox
+inline void AppendQuadKeyRanges(
+    const BoundingBox<uint64_t>& tile_bbox, uint64_t x, uint64_t y,
+    uint64_t size, uint32_t tile_bits,
+    std::vector<std::pair<uint64_t, uint64_t>>* ranges) {
+  if (x > tile_bbox.max_x || y > tile_bbox.max_y ||
+      x + size - 1 < tile_bbox.min_x || y + size - 1 < tile_bbox.min_y) {
+    return;
+  }
+  if (size == 1 || (x >= tile_bbox.min_x && y >= tile_bbox.min_y &&
+                    x + size - 1 <= tile_bbox.max_x &&
+                    y + size - 1 <= tile_bbox.max_y)) {
+    // The node is a contiguous range of quad keys
+    uint64_t first = GetQuadKeyFromTile(x, y, tile_bits);
+    uint64_t last = first + (size * size - 1);
+    if (!ranges->empty() && ranges->back().second + 1 == first) {
+      ranges->back().second = last;
+    } else {
+      ranges->emplace_back(first, last);
+    }
+    return;
+  }
+  // Children in the order of their quad keys
+  uint64_t half = size / 2;
+  AppendQuadKeyRanges(tile_bbox, x, y, half, tile_bits, ranges);
+  AppendQuadKeyRanges(tile_bbox, x + half, y, half, tile_bits, ranges);
+  AppendQuadKeyRanges(tile_bbox, x, y + half, half, tile_bits, ranges);
+  AppendQuadKeyRanges(tile_bbox, x + half, y + half, half, tile_bits, ranges);
+}
+
+// The fewest sorted, disjoint and inclusive quad key ranges that together
+// hold exactly the tiles of tile_bbox. A query seeks once per range instead
+// of once per tile, and a range holds whole quadtree nodes, so a bbox of n x n
+// tiles only takes O(n) ranges.
+inline std::vector<std::pair<uint64_t, uint64_t>> GetQuadKeyRanges(
+    const BoundingBox<uint64_t>& tile_bbox, uint32_t tile_bits) {
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+  AppendQuadKeyRanges(tile_bbox, 0, 0, 1ull << tile_bits, tile_bits, &ranges);
+  return ranges;
+}
+
 // big endian can be compared using memcpy
 inline void PutFixed64BigEndian(std::string* dst, uint64_t value) {
   char buf[sizeof(value)];
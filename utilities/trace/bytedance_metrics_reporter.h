@@ -19,13 +19,9 @@ class ByteDanceHistReporterHandle : public HistReporterHandle {
         logger_(logger),
         env_(env),
         last_log_time_ns_(env_->NowNanos()),
-        stats_(last_log_time_ns_) {}
+        next_report_time_ns_(last_log_time_ns_ + kReportIntervalNanos) {}
 
-  ~ByteDanceHistReporterHandle() override {
-    for (auto* s : stats_arr_) {
-      delete s;
-    }
-  }
+  ~ByteDanceHistReporterHandle() override = default;
 
  public:
   void AddRecord(size_t val) override;
@@ -36,9 +32,8 @@ class ByteDanceHistReporterHandle : public HistReporterHandle {
   Env* GetEnv() override { return env_; }
 
  private:
-  enum {
-    kMaxThreadNum = 8192,
-  };
+  static const uint64_t kReportIntervalNanos = 30ull * 1000 * 1000 * 1000;
+
   const std::string& name_;
   const std::string& tags_;
 
@@ -46,12 +41,10 @@ class ByteDanceHistReporterHandle : public HistReporterHandle {
   Env* env_;
   uint64_t last_log_time_ns_;
 
-  std::array<HistStats<>*, kMaxThreadNum> stats_arr_{};
-
+  // Only the thread holding merge_lock_ reports
   std::atomic<bool> merge_lock_{false};
-  HistStats<> stats_;
-
-  HistStats<>* GetThreadLocalStats();
+  std::atomic<uint64_t> next_report_time_ns_;
+  CoreLocalHistStats stats_;
 };
 
 class ByteDanceCountReporterHandle : public CountReporterHandle {
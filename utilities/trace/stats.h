@@ -2,90 +2,136 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cassert>
 #include <cstddef>
-#include <numeric>
+#include <cstdint>
 #include <vector>
 
+#include "port/port.h"
 #include "rocksdb/terark_namespace.h"
+#include "util/core_local.h"
 
 namespace TERARKDB_NAMESPACE {
 
-template <size_t MAX_LATENCY_US_FAST = 10 * 1000>  // 10ms
-class HistStats {
+// A histogram recorded into per-core shards, so AddRecord() on hot paths is a
+// few relaxed atomic adds on the shard of the current core, without locks or
+// allocation. Values below kNumLinearBuckets get a bucket each, the range of
+// every power of two above is split into kSubBuckets buckets, which bounds
+// the error of the percentiles to 1 / kSubBuckets. GetResult() drains the
+// shards and must not run concurrently with itself.
+class CoreLocalHistStats {
  public:
-  explicit HistStats(uint64_t last_report_time_ns)
-      : last_report_time_ns_(last_report_time_ns) {}
+  static const size_t kSubBucketBits = 5;
+  static const size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  static const size_t kNumLinearBuckets = 2 * kSubBuckets;
+  // Values of more bits fall into the last bucket, only the max keeps them
+  static const size_t kMaxValueBits = 40;
+  static const size_t kNumBuckets =
+      kNumLinearBuckets + (kMaxValueBits - kSubBucketBits - 1) * kSubBuckets;
 
-  void AppendRecord(size_t us) {
-    if (us < buckets_.size()) {
-      ++buckets_[us];
-    } else {
-      large_nums_.emplace_back(us);
+  CoreLocalHistStats() : counts_(kNumBuckets) {}
+
+  static size_t BucketIndex(uint64_t val) {
+    if (val < kNumLinearBuckets) {
+      return static_cast<size_t>(val);
+    }
+    size_t msb = 63 - static_cast<size_t>(__builtin_clzll(val));
+    if (msb >= kMaxValueBits) {
+      return kNumBuckets - 1;
     }
+    size_t sub = (val >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+    return kNumLinearBuckets + (msb - kSubBucketBits - 1) * kSubBuckets + sub;
   }
 
+  // The smallest value counted in bucket `index`
+  static uint64_t BucketLowerBound(size_t index) {
+    if (index < kNumLinearBuckets) {
+      return index;
+    }
+    size_t msb = (index - kNumLinearBuckets) / kSubBuckets + kSubBucketBits + 1;
+    uint64_t sub = (index - kNumLinearBuckets) % kSubBuckets;
+    return (uint64_t(1) << msb) | (sub << (msb - kSubBucketBits));
+  }
+
+  static uint64_t BucketWidth(size_t index) {
+    if (index < kNumLinearBuckets) {
+      return 1;
+    }
+    size_t msb = (index - kNumLinearBuckets) / kSubBuckets + kSubBucketBits + 1;
+    return uint64_t(1) << (msb - kSubBucketBits);
+  }
+
+  // Wait-free, but for the rare compare-and-swap loop raising the max
+  void AddRecord(size_t val) {
+    Shard* shard = shards_.Access();
+    shard->buckets[BucketIndex(val)].fetch_add(1, std::memory_order_relaxed);
+    shard->sum.fetch_add(val, std::memory_order_relaxed);
+    uint64_t max = shard->max.load(std::memory_order_relaxed);
+    while (val > max && !shard->max.compare_exchange_weak(
+                            max, val, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Drain the records of all cores, and return the given `percentiles` of
+  // them, followed by the average and the max. A percentile is reported as
+  // the middle of its bucket, and never above the max.
   template <size_t N>
   auto GetResult(const double (&percentiles)[N]) -> std::array<size_t, N + 2> {
     assert(std::is_sorted(std::begin(percentiles), std::end(percentiles)));
-    double reciprocal_total =
-        1.0 / (std::accumulate(buckets_.cbegin(), buckets_.cend(), 0) +
-               large_nums_.size());
-
-    std::array<size_t, N + 2> result{};
-    size_t idx = 0;
-    size_t accum = 0;
-    size_t total_tm = 0;
-    size_t& avg = result[N];
-    size_t& max = result[N + 1];
-
-    for (size_t d = 0; d < buckets_.size(); ++d) {
-      size_t c = buckets_[d];
-      if (c) {
-        accum += c;
-        total_tm += d * c;
-        while (idx < N && accum * reciprocal_total >= percentiles[idx]) {
-          result[idx++] = d;
+    std::fill(counts_.begin(), counts_.end(), 0);
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    for (size_t core = 0; core < shards_.Size(); ++core) {
+      Shard* shard = shards_.AccessAtCore(core);
+      for (size_t i = 0; i < kNumBuckets; ++i) {
+        // Don't dirty the cache lines of idle cores
+        if (shard->buckets[i].load(std::memory_order_relaxed) != 0) {
+          uint32_t c = shard->buckets[i].exchange(0, std::memory_order_relaxed);
+          counts_[i] += c;
+          total += c;
         }
-        max = d;
       }
+      sum += shard->sum.exchange(0, std::memory_order_relaxed);
+      max = std::max(max, shard->max.exchange(0, std::memory_order_relaxed));
     }
 
-    if (!large_nums_.empty()) {
-      std::sort(large_nums_.begin(), large_nums_.end());
-      for (size_t i = 0; i < large_nums_.size(); ++i) {
-        ++accum;
-        total_tm += large_nums_[i];
-        while (idx < N && accum * reciprocal_total >= percentiles[idx]) {
-          result[idx++] = large_nums_[i];
-        }
+    std::array<size_t, N + 2> result{};
+    size_t idx = 0;
+    uint64_t accum = 0;
+    double reciprocal_total = 1.0 / std::max<uint64_t>(1, total);
+    for (size_t i = 0; i < kNumBuckets && idx < N; ++i) {
+      if (counts_[i] == 0) {
+        continue;
+      }
+      accum += counts_[i];
+      uint64_t val = BucketLowerBound(i) + (BucketWidth(i) - 1) / 2;
+      while (idx < N && accum * reciprocal_total >= percentiles[idx]) {
+        result[idx++] = static_cast<size_t>(std::min(val, max));
       }
-      max = large_nums_.back();
     }
-    avg = total_tm / std::max<size_t>(1, accum);
+    result[N] = static_cast<size_t>(sum / std::max<uint64_t>(1, total));
+    result[N + 1] = static_cast<size_t>(max);
     return result;
   }
 
-  void Merge(const HistStats& another) {
-    large_nums_.insert(large_nums_.end(), another.large_nums_.begin(),
-                       another.large_nums_.end());
-    for (size_t d = 0; d < another.buckets_.size(); ++d) {
-      size_t c = another.buckets_[d];
-      buckets_[d] += c;
-    }
-  }
+ private:
+  struct ALIGN_AS(CACHE_LINE_SIZE) Shard {
+    // Drained every report, so 32 bits don't overflow
+    std::atomic<uint32_t> buckets[kNumBuckets];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
 
-  void Reset() {
-    buckets_.fill(0);
-    large_nums_.resize(0);
-    if (large_nums_.capacity() > MAX_LATENCY_US_FAST) {
-      large_nums_.shrink_to_fit();
+    Shard() : sum(0), max(0) {
+      for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
     }
-  }
-
-  uint64_t last_report_time_ns_;
+  };
 
- private:
-  std::array<size_t, MAX_LATENCY_US_FAST> buckets_{};
-  std::vector<size_t> large_nums_;
+  CoreLocalArray<Shard> shards_;
+  // Scratch of GetResult()
+  std::vector<uint64_t> counts_;
 };
-}  // namespace TERARKDB_NAMESPACE
\ No newline at end of file
+}  // namespace TERARKDB_NAMESPACE
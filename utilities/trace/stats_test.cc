@@ -0,0 +1,71 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "utilities/trace/stats.h"
+
+#include <thread>
+#include <vector>
+
+#include "rocksdb/terark_namespace.h"
+#include "util/testharness.h"
+
+namespace TERARKDB_NAMESPACE {
+
+TEST(CoreLocalHistStatsTest, Buckets) {
+  using H = CoreLocalHistStats;
+  const size_t num_buckets = H::kNumBuckets;
+  for (uint64_t val = 0; val < (uint64_t(1) << 20); ++val) {
+    size_t index = H::BucketIndex(val);
+    ASSERT_LT(index, num_buckets);
+    ASSERT_LE(H::BucketLowerBound(index), val);
+    ASSERT_LT(val, H::BucketLowerBound(index) + H::BucketWidth(index));
+  }
+  for (size_t index = 1; index < num_buckets; ++index) {
+    ASSERT_EQ(H::BucketLowerBound(index - 1) + H::BucketWidth(index - 1),
+              H::BucketLowerBound(index));
+  }
+  ASSERT_EQ(num_buckets - 1, H::BucketIndex(uint64_t(1) << 50));
+}
+
+TEST(CoreLocalHistStatsTest, Result) {
+  CoreLocalHistStats stats;
+  auto empty = stats.GetResult({0.5, 0.99});
+  ASSERT_EQ(0, empty[0]);
+  ASSERT_EQ(0, empty[3]);
+
+  const size_t kThreads = 4;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&stats] {
+      for (size_t val = 1; val <= 1000; ++val) {
+        stats.AddRecord(val);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  stats.AddRecord(123456789);
+
+  auto result = stats.GetResult({0.5, 0.99});
+  // Within the bucket error of 1 / kSubBuckets
+  ASSERT_NEAR(500, result[0], 500 / CoreLocalHistStats::kSubBuckets + 1);
+  ASSERT_NEAR(990, result[1], 990 / CoreLocalHistStats::kSubBuckets + 1);
+  ASSERT_EQ((kThreads * 500500 + 123456789) / (kThreads * 1000 + 1),
+            result[2]);
+  ASSERT_EQ(123456789, result[3]);
+
+  // Reporting drains the records
+  result = stats.GetResult({0.5, 0.99});
+  ASSERT_EQ(0, result[0]);
+  ASSERT_EQ(0, result[3]);
+}
+
+}  // namespace TERARKDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -5,8 +5,13 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cassert>
+#include <map>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "fs/snapshot.h"
@@ -140,6 +145,150 @@ class BDZenFSStat {
   }
 };
 
+// Zone start -> extents view of ZenFS, kept up to date with file deletion and
+// rename events between two full snapshots.
+//
+// Zones are append only, so once a zone is sealed no extent can be added to
+// it until it is reset. The view therefore only records zones that were
+// sealed when it was rebuilt, and drops a zone as soon as its content may
+// change (all extents deleted, compacted or migrated). A GC round can then
+// fetch the extents of its victim zones in O(extents in victims) instead of
+// copying every extent of the device. A zone is trusted only if the live
+// bytes of the view match the valid capacity ZenFS reports for it, anything
+// else requires a rebuild.
+class ZenFSZoneExtentView {
+ public:
+  // Replace the view with a full snapshot, zones_ and zone_files_ must be
+  // filled.
+  void Rebuild(const ZenFSSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    zones_.clear();
+    file_zones_.clear();
+    for (const auto& zone : snapshot.zones_) {
+      if (zone.capacity == 0) {
+        zones_.emplace(zone.start, ZoneEntry());
+      }
+    }
+    for (const auto& file : snapshot.zone_files_) {
+      for (const auto& extent : file.extents) {
+        auto find = zones_.find(extent.zone_start);
+        if (find == zones_.end()) {
+          continue;
+        }
+        find->second.valid_bytes += extent.length;
+        find->second.extents.emplace_back(extent);
+        find->second.extents.back().filename = file.filename;
+        file_zones_[file.filename].insert(extent.zone_start);
+      }
+    }
+    ++rebuild_count_;
+  }
+
+  void RemoveFile(const std::string& fname) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto find = file_zones_.find(fname);
+    if (find == file_zones_.end()) {
+      return;
+    }
+    for (uint64_t zone_start : find->second) {
+      auto zone = zones_.find(zone_start);
+      if (zone == zones_.end()) {
+        continue;
+      }
+      auto& extents = zone->second.extents;
+      for (size_t i = 0; i < extents.size();) {
+        if (extents[i].filename == fname) {
+          zone->second.valid_bytes -= extents[i].length;
+          extents[i] = std::move(extents.back());
+          extents.pop_back();
+        } else {
+          ++i;
+        }
+      }
+      // ZenFS resets empty zones, new data may land here afterwards
+      if (extents.empty()) {
+        zones_.erase(zone);
+      }
+    }
+    file_zones_.erase(find);
+  }
+
+  void RenameFile(const std::string& src, const std::string& dst) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto find = file_zones_.find(src);
+    if (find == file_zones_.end()) {
+      return;
+    }
+    for (uint64_t zone_start : find->second) {
+      auto zone = zones_.find(zone_start);
+      if (zone == zones_.end()) {
+        continue;
+      }
+      for (auto& extent : zone->second.extents) {
+        if (extent.filename == src) {
+          extent.filename = dst;
+        }
+      }
+    }
+    auto zone_set = std::move(find->second);
+    file_zones_.erase(find);
+    file_zones_[dst] = std::move(zone_set);
+  }
+
+  // The content of the zone is going to change, e.g. it is compacted
+  void DropZone(uint64_t zone_start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    zones_.erase(zone_start);
+  }
+
+  // Returns true if the extents of every zone in `zones` is known. Zones not
+  // in the view or out of sync with ZenFS are returned through `missing`.
+  bool Covers(const std::vector<BDZoneStat>& zones,
+              std::vector<uint64_t>* missing = nullptr) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool covered = true;
+    for (const auto& zone : zones) {
+      auto find = zones_.find(zone.start_position);
+      if (zone.free_capacity != 0 || find == zones_.end() ||
+          find->second.valid_bytes != zone.used_capacity) {
+        covered = false;
+        if (missing != nullptr) {
+          missing->push_back(zone.start_position);
+        }
+      }
+    }
+    return covered;
+  }
+
+  // Append the extents of `zone_starts` to `extents`
+  void CollectExtents(const std::vector<uint64_t>& zone_starts,
+                      std::vector<ZoneExtentSnapshot>* extents) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint64_t zone_start : zone_starts) {
+      auto find = zones_.find(zone_start);
+      if (find != zones_.end()) {
+        extents->insert(extents->end(), find->second.extents.begin(),
+                        find->second.extents.end());
+      }
+    }
+  }
+
+  uint64_t rebuild_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rebuild_count_;
+  }
+
+ private:
+  struct ZoneEntry {
+    uint64_t valid_bytes = 0;
+    std::vector<ZoneExtentSnapshot> extents;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, ZoneEntry> zones_;
+  std::unordered_map<std::string, std::unordered_set<uint64_t>> file_zones_;
+  uint64_t rebuild_count_ = 0;
+};
 
 }  // namespace ROCKSDB_NAMESPACE
 
@@ -7,6 +7,7 @@
 
 #include "utilities/transactions/pessimistic_transaction.h"
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <string>
@@ -92,6 +93,7 @@ void PessimisticTransaction::Initialize(const TransactionOptions& txn_options) {
 
 PessimisticTransaction::~PessimisticTransaction() {
   txn_db_impl_->UnLock(this, &GetTrackedKeys());
+  UnLockRanges();
   if (expiration_time_ > 0) {
     txn_db_impl_->RemoveExpirableTransaction(txn_id_);
   }
@@ -102,9 +104,17 @@ PessimisticTransaction::~PessimisticTransaction() {
 
 void PessimisticTransaction::Clear() {
   txn_db_impl_->UnLock(this, &GetTrackedKeys());
+  UnLockRanges();
   TransactionBaseImpl::Clear();
 }
 
+void PessimisticTransaction::UnLockRanges() {
+  if (!range_locked_cfs_.empty()) {
+    txn_db_impl_->UnLockRanges(this, range_locked_cfs_);
+    range_locked_cfs_.clear();
+  }
+}
+
 void PessimisticTransaction::Reinitialize(
     TransactionDB* txn_db, const WriteOptions& write_options,
     const TransactionOptions& txn_options) {
@@ -649,6 +659,25 @@ bool PessimisticTransaction::TryStealingLocks() {
                                              LOCKS_STOLEN);
 }
 
+Status PessimisticTransaction::GetRangeLock(ColumnFamilyHandle* column_family,
+                                            const Slice& start,
+                                            const Slice& end, bool exclusive) {
+  if (UNLIKELY(skip_concurrency_control_)) {
+    return Status::OK();
+  }
+  ColumnFamilyHandle* cfh =
+      column_family ? column_family : db_impl_->DefaultColumnFamily();
+  uint32_t cfh_id = cfh->GetID();
+  Status s = txn_db_impl_->TryRangeLock(this, cfh_id, cfh->GetComparator(),
+                                        start.ToString(), end.ToString(),
+                                        exclusive);
+  if (s.ok() && std::find(range_locked_cfs_.begin(), range_locked_cfs_.end(),
+                          cfh_id) == range_locked_cfs_.end()) {
+    range_locked_cfs_.push_back(cfh_id);
+  }
+  return s;
+}
+
 void PessimisticTransaction::UnlockGetForUpdate(
     ColumnFamilyHandle* column_family, const Slice& key) {
   txn_db_impl_->UnLock(this, GetColumnFamilyID(column_family), key.ToString());
@@ -113,6 +113,13 @@ class PessimisticTransaction : public TransactionBaseImpl {
 
   int64_t GetDeadlockDetectDepth() const { return deadlock_detect_depth_; }
 
+  Status GetRangeLock(ColumnFamilyHandle* column_family, const Slice& start,
+                      const Slice& end, bool exclusive = true) override;
+
+  // Returns true if this transaction holds range locks, whose keys it does
+  // not take point locks for.
+  bool HasRangeLocks() const { return !range_locked_cfs_.empty(); }
+
  protected:
   // Refer to
   // TransactionOptions::use_only_the_last_commit_time_batch_for_recovery
@@ -187,6 +194,11 @@ class PessimisticTransaction : public TransactionBaseImpl {
   // Refer to TransactionOptions::skip_concurrency_control
   bool skip_concurrency_control_;
 
+  // Column families this transaction holds range locks in
+  std::vector<uint32_t> range_locked_cfs_;
+
+  void UnLockRanges();
+
   virtual Status ValidateSnapshot(ColumnFamilyHandle* column_family,
                                   const Slice& key,
                                   SequenceNumber* tracked_at_seq);
@@ -397,6 +397,21 @@ void PessimisticTransactionDB::UnLock(PessimisticTransaction* txn,
   lock_mgr_.UnLock(txn, cfh_id, key, GetEnv());
 }
 
+Status PessimisticTransactionDB::TryRangeLock(PessimisticTransaction* txn,
+                                              uint32_t cfh_id,
+                                              const Comparator* ucmp,
+                                              const std::string& start,
+                                              const std::string& end,
+                                              bool exclusive) {
+  return lock_mgr_.TryRangeLock(txn, cfh_id, ucmp, start, end, GetEnv(),
+                                exclusive);
+}
+
+void PessimisticTransactionDB::UnLockRanges(
+    PessimisticTransaction* txn, const std::vector<uint32_t>& cfh_ids) {
+  lock_mgr_.UnLockRanges(txn, cfh_ids);
+}
+
 // Used when wrapping DB write operations in a transaction
 Transaction* PessimisticTransactionDB::BeginInternalTransaction(
     const WriteOptions& options) {
@@ -84,6 +84,12 @@ class PessimisticTransactionDB : public TransactionDB {
   void UnLock(PessimisticTransaction* txn, uint32_t cfh_id,
               const std::string& key);
 
+  Status TryRangeLock(PessimisticTransaction* txn, uint32_t cfh_id,
+                      const Comparator* ucmp, const std::string& start,
+                      const std::string& end, bool exclusive);
+  void UnLockRanges(PessimisticTransaction* txn,
+                    const std::vector<uint32_t>& cfh_ids);
+
   void AddColumnFamily(const ColumnFamilyHandle* handle);
 
   static TransactionDBOptions ValidateTxnDBOptions(
@@ -32,6 +32,18 @@
 
 namespace TERARKDB_NAMESPACE {
 
+// The transactions waiting for a locked key. Created by the first waiter and
+// shared with it, so the waiters can still leave the queue after the key got
+// unlocked and its LockInfo erased.
+// REQUIRED: Stripe mutex must be held to access num_waiters.
+struct KeyWaitQueue {
+  explicit KeyWaitQueue(std::shared_ptr<TransactionDBCondVar> _cv)
+      : cv(std::move(_cv)), num_waiters(0) {}
+
+  std::shared_ptr<TransactionDBCondVar> cv;
+  int num_waiters;
+};
+
 struct LockInfo {
   bool exclusive;
   autovector<TransactionID> txn_ids;
@@ -39,6 +51,9 @@ struct LockInfo {
   // Transaction locks are not valid after this time in us
   uint64_t expiration_time;
 
+  // nullptr until a transaction waits for this lock
+  std::shared_ptr<KeyWaitQueue> wait_queue;
+
   LockInfo(TransactionID id, uint64_t time, bool ex)
       : exclusive(ex), expiration_time(time) {
     txn_ids.push_back(id);
@@ -46,7 +61,8 @@ struct LockInfo {
   LockInfo(const LockInfo& lock_info)
       : exclusive(lock_info.exclusive),
         txn_ids(lock_info.txn_ids),
-        expiration_time(lock_info.expiration_time) {}
+        expiration_time(lock_info.expiration_time),
+        wait_queue(lock_info.wait_queue) {}
 };
 
 struct LockMapStripe {
@@ -60,19 +76,62 @@ struct LockMapStripe {
   // Mutex must be held before modifying keys map
   std::shared_ptr<TransactionDBMutex> stripe_mutex;
 
-  // Condition Variable per stripe for waiting on a lock
+  // Condition Variable per stripe for waiting on the lock limit. Waiters for
+  // a locked key wait on the KeyWaitQueue of the key instead, so an unlock
+  // only wakes up the transactions waiting for the unlocked key.
   std::shared_ptr<TransactionDBCondVar> stripe_cv;
 
+  // Number of transactions waiting on stripe_cv
+  int num_waiters = 0;
+
   // Locked keys mapped to the info about the transactions that locked them.
   // TODO(agiardullo): Explore performance of other data structures.
   std::unordered_map<std::string, LockInfo> keys;
 };
 
+struct RangeLockInfo {
+  std::string start;
+  std::string end;
+  TransactionID txn_id;
+  bool exclusive;
+};
+
+// The range locks of a column family. Range locks are meant for bulk updates,
+// so there are few of them and a plain list does. Point locks only look at
+// the list while num_ranges is not zero.
+struct RangeLockTable {
+  explicit RangeLockTable(
+      const std::shared_ptr<TransactionDBMutexFactory>& factory)
+      : mutex(factory->AllocateMutex()), cv(factory->AllocateCondVar()) {
+    assert(mutex);
+    assert(cv);
+  }
+
+  // Mutex must be held before accessing ucmp and ranges
+  std::shared_ptr<TransactionDBMutex> mutex;
+
+  // Range lock waiters wait here for any lock of the column family to be
+  // released
+  std::shared_ptr<TransactionDBCondVar> cv;
+
+  // Comparator of the column family, set by the first range lock
+  const Comparator* ucmp = nullptr;
+
+  std::vector<RangeLockInfo> ranges;
+
+  std::atomic<size_t> num_ranges{0};
+
+  // Number of transactions trying to acquire a range lock. While non-zero,
+  // unlocks bump unlock_seq and notify cv.
+  std::atomic<int> num_waiters{0};
+  std::atomic<uint64_t> unlock_seq{0};
+};
+
 // Map of #num_stripes LockMapStripes
 struct LockMap {
   explicit LockMap(size_t num_stripes,
                    std::shared_ptr<TransactionDBMutexFactory> factory)
-      : num_stripes_(num_stripes) {
+      : num_stripes_(num_stripes), range_locks(factory) {
     lock_map_stripes_.reserve(num_stripes);
     for (size_t i = 0; i < num_stripes; i++) {
       LockMapStripe* stripe = new LockMapStripe(factory);
@@ -95,7 +154,13 @@ struct LockMap {
 
   std::vector<LockMapStripe*> lock_map_stripes_;
 
+  RangeLockTable range_locks;
+
   size_t GetStripe(const std::string& key) const;
+
+  // Wake up the transactions waiting on the stripe condition variables, which
+  // includes the point lock waiters blocked by a range lock.
+  void NotifyStripeWaiters();
 };
 
 void DeadlockInfoBuffer::AddNewPath(DeadlockPath path) {
@@ -189,6 +254,17 @@ size_t LockMap::GetStripe(const std::string& key) const {
   return stripe;
 }
 
+void LockMap::NotifyStripeWaiters() {
+  for (auto stripe : lock_map_stripes_) {
+    stripe->stripe_mutex->Lock();
+    bool notify = stripe->num_waiters > 0;
+    stripe->stripe_mutex->UnLock();
+    if (notify) {
+      stripe->stripe_cv->NotifyAll();
+    }
+  }
+}
+
 void TransactionLockMgr::AddColumnFamily(uint32_t column_family_id) {
   InstrumentedMutexLock l(&lock_map_mutex_);
 
@@ -382,17 +458,47 @@ Status TransactionLockMgr::AcquireWithTimeout(
         txn->SetWaitingTxn(wait_ids, column_family_id, &key);
       }
 
+      // Wait for the key to be unlocked, or for any unlock of this stripe
+      // if we are blocked by the lock limit
+      std::shared_ptr<KeyWaitQueue> wait_queue;
+      // A transaction blocked by a range lock waits on the stripe, which
+      // gets notified when range locks are released
+      if (wait_ids.size() != 0) {
+        auto stripe_iter = stripe->keys.find(key);
+        if (stripe_iter != stripe->keys.end() &&
+            std::find(stripe_iter->second.txn_ids.begin(),
+                      stripe_iter->second.txn_ids.end(),
+                      wait_ids[0]) != stripe_iter->second.txn_ids.end()) {
+          auto& queue = stripe_iter->second.wait_queue;
+          if (queue == nullptr) {
+            queue = std::make_shared<KeyWaitQueue>(
+                mutex_factory_->AllocateCondVar());
+          }
+          wait_queue = queue;
+        }
+      }
+      TransactionDBCondVar* cv;
+      int* num_waiters;
+      if (wait_queue != nullptr) {
+        cv = wait_queue->cv.get();
+        num_waiters = &wait_queue->num_waiters;
+      } else {
+        cv = stripe->stripe_cv.get();
+        num_waiters = &stripe->num_waiters;
+      }
+      ++*num_waiters;
+
       TEST_SYNC_POINT("TransactionLockMgr::AcquireWithTimeout:WaitingTxn");
       if (cv_end_time < 0) {
         // Wait indefinitely
-        result = stripe->stripe_cv->Wait(stripe->stripe_mutex);
+        result = cv->Wait(stripe->stripe_mutex);
       } else {
         uint64_t now = env->NowMicros();
         if (static_cast<uint64_t>(cv_end_time) > now) {
-          result = stripe->stripe_cv->WaitFor(stripe->stripe_mutex,
-                                              cv_end_time - now);
+          result = cv->WaitFor(stripe->stripe_mutex, cv_end_time - now);
         }
       }
+      --*num_waiters;
 
       if (wait_ids.size() != 0) {
         txn->ClearWaitingTxn();
@@ -536,6 +642,15 @@ Status TransactionLockMgr::AcquireLocked(LockMap* lock_map,
   assert(txn_lock_info.txn_ids.size() == 1);
 
   Status result;
+  bool covered = false;
+  if (CheckRangeLocked(lock_map, key, txn_lock_info, &covered, txn_ids)) {
+    return Status::TimedOut(Status::SubCode::kLockTimeout);
+  }
+  if (covered) {
+    // The range lock of this transaction already protects the key
+    return result;
+  }
+
   // Check if this key is already locked
   auto stripe_iter = stripe->keys.find(key);
   if (stripe_iter != stripe->keys.end()) {
@@ -594,10 +709,10 @@ Status TransactionLockMgr::AcquireLocked(LockMap* lock_map,
   return result;
 }
 
-void TransactionLockMgr::UnLockKey(const PessimisticTransaction* txn,
-                                   const std::string& key,
-                                   LockMapStripe* stripe, LockMap* lock_map,
-                                   Env* env) {
+void TransactionLockMgr::UnLockKey(
+    const PessimisticTransaction* txn, const std::string& key,
+    LockMapStripe* stripe, LockMap* lock_map, Env* env,
+    autovector<std::shared_ptr<KeyWaitQueue>>* to_notify) {
 #ifdef NDEBUG
   (void)env;
 #endif
@@ -609,6 +724,10 @@ void TransactionLockMgr::UnLockKey(const PessimisticTransaction* txn,
     auto txn_it = std::find(txns.begin(), txns.end(), txn_id);
     // Found the key we locked.  unlock it.
     if (txn_it != txns.end()) {
+      auto& wait_queue = stripe_iter->second.wait_queue;
+      if (wait_queue != nullptr && wait_queue->num_waiters > 0) {
+        to_notify->push_back(wait_queue);
+      }
       if (txns.size() == 1) {
         stripe->keys.erase(stripe_iter);
       } else {
@@ -627,9 +746,237 @@ void TransactionLockMgr::UnLockKey(const PessimisticTransaction* txn,
     }
   } else {
     // This key is either not locked or locked by someone else.  This should
-    // only happen if the unlocking transaction has expired.
-    assert(txn->GetExpirationTime() > 0 &&
-           txn->GetExpirationTime() < env->NowMicros());
+    // only happen if the unlocking transaction has expired, or if the key is
+    // covered by a range lock of it.
+    assert((txn->GetExpirationTime() > 0 &&
+            txn->GetExpirationTime() < env->NowMicros()) ||
+           txn->HasRangeLocks());
+  }
+}
+
+// REQUIRED:  Stripe mutex must be held.
+bool TransactionLockMgr::CheckRangeLocked(LockMap* lock_map,
+                                          const std::string& key,
+                                          const LockInfo& lock_info,
+                                          bool* covered,
+                                          autovector<TransactionID>* txn_ids) {
+  *covered = false;
+  RangeLockTable& table = lock_map->range_locks;
+  if (table.num_ranges.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  TransactionID txn_id = lock_info.txn_ids[0];
+  bool locked = false;
+  table.mutex->Lock();
+  for (const auto& range : table.ranges) {
+    if (table.ucmp->Compare(key, range.start) < 0 ||
+        table.ucmp->Compare(key, range.end) >= 0) {
+      continue;
+    }
+    if (range.txn_id == txn_id) {
+      if (range.exclusive || !lock_info.exclusive) {
+        *covered = true;
+      }
+    } else if (range.exclusive || lock_info.exclusive) {
+      if (!locked) {
+        txn_ids->clear();
+        locked = true;
+      }
+      if (std::find(txn_ids->begin(), txn_ids->end(), range.txn_id) ==
+          txn_ids->end()) {
+        txn_ids->push_back(range.txn_id);
+      }
+    }
+  }
+  table.mutex->UnLock();
+  return locked;
+}
+
+bool TransactionLockMgr::CheckPointLocked(LockMap* lock_map,
+                                          const Comparator* ucmp,
+                                          const std::string& start,
+                                          const std::string& end,
+                                          const LockInfo& lock_info,
+                                          autovector<TransactionID>* txn_ids) {
+  TransactionID txn_id = lock_info.txn_ids[0];
+  for (auto stripe : lock_map->lock_map_stripes_) {
+    stripe->stripe_mutex->Lock();
+    for (const auto& key_iter : stripe->keys) {
+      const LockInfo& info = key_iter.second;
+      if ((!info.exclusive && !lock_info.exclusive) ||
+          ucmp->Compare(key_iter.first, start) < 0 ||
+          ucmp->Compare(key_iter.first, end) >= 0) {
+        continue;
+      }
+      for (auto id : info.txn_ids) {
+        if (id != txn_id &&
+            std::find(txn_ids->begin(), txn_ids->end(), id) ==
+                txn_ids->end()) {
+          txn_ids->push_back(id);
+        }
+      }
+    }
+    stripe->stripe_mutex->UnLock();
+  }
+  return !txn_ids->empty();
+}
+
+void TransactionLockMgr::NotifyRangeWaiters(LockMap* lock_map) {
+  RangeLockTable& table = lock_map->range_locks;
+  if (table.num_waiters.load() > 0) {
+    // Taking the mutex orders the notification after a waiter that saw the
+    // old unlock_seq started to wait
+    table.unlock_seq.fetch_add(1);
+    table.mutex->Lock();
+    table.mutex->UnLock();
+    table.cv->NotifyAll();
+  }
+}
+
+// A range lock is published to the range lock table first, so point locks
+// taken from then on see it, and then checked against the point locks taken
+// before. On conflict it is withdrawn again, and the transaction waits for
+// any lock of the column family to be released before retrying. Neither
+// step holds the range lock mutex and a stripe mutex at the same time.
+Status TransactionLockMgr::TryRangeLock(PessimisticTransaction* txn,
+                                        uint32_t column_family_id,
+                                        const Comparator* ucmp,
+                                        const std::string& start,
+                                        const std::string& end, Env* env,
+                                        bool exclusive) {
+  std::shared_ptr<LockMap> lock_map_ptr = GetLockMap(column_family_id);
+  LockMap* lock_map = lock_map_ptr.get();
+  if (lock_map == nullptr) {
+    char msg[255];
+    snprintf(msg, sizeof(msg), "Column family id not found: %" PRIu32,
+             column_family_id);
+
+    return Status::InvalidArgument(msg);
+  }
+  if (ucmp->Compare(start, end) >= 0) {
+    return Status::InvalidArgument("Range lock end must be after start");
+  }
+
+  RangeLockTable& table = lock_map->range_locks;
+  TransactionID txn_id = txn->GetID();
+  LockInfo lock_info(txn_id, txn->GetExpirationTime(), exclusive);
+  int64_t timeout = txn->GetLockTimeout();
+  uint64_t end_time = 0;
+  if (timeout > 0) {
+    end_time = env->NowMicros() + timeout;
+  }
+
+  Status result;
+  // Registered before looking at the locks, so no unlock after the check
+  // goes unnoticed
+  table.num_waiters++;
+  while (true) {
+    uint64_t unlock_seq = table.unlock_seq.load();
+    autovector<TransactionID> wait_ids;
+
+    table.mutex->Lock();
+    assert(table.ucmp == nullptr || table.ucmp == ucmp);
+    table.ucmp = ucmp;
+    for (const auto& range : table.ranges) {
+      if (range.txn_id != txn_id && (range.exclusive || exclusive) &&
+          ucmp->Compare(start, range.end) < 0 &&
+          ucmp->Compare(range.start, end) < 0 &&
+          std::find(wait_ids.begin(), wait_ids.end(), range.txn_id) ==
+              wait_ids.end()) {
+        wait_ids.push_back(range.txn_id);
+      }
+    }
+    bool published = wait_ids.empty();
+    if (published) {
+      table.ranges.push_back({start, end, txn_id, exclusive});
+      table.num_ranges.fetch_add(1, std::memory_order_release);
+    }
+    table.mutex->UnLock();
+
+    if (published) {
+      if (!CheckPointLocked(lock_map, ucmp, start, end, lock_info,
+                            &wait_ids)) {
+        break;
+      }
+      table.mutex->Lock();
+      for (auto it = table.ranges.rbegin(); it != table.ranges.rend(); ++it) {
+        if (it->txn_id == txn_id && it->start == start && it->end == end &&
+            it->exclusive == exclusive) {
+          table.ranges.erase(std::next(it).base());
+          break;
+        }
+      }
+      table.num_ranges.fetch_sub(1, std::memory_order_release);
+      table.mutex->UnLock();
+      // Point lock waiters may have seen the withdrawn range. Range lock
+      // waiters are not notified, the point locks in the way will wake them
+      // when released.
+      lock_map->NotifyStripeWaiters();
+    }
+
+    if (timeout == 0 || (timeout > 0 && env->NowMicros() >= end_time)) {
+      result = Status::TimedOut(Status::SubCode::kLockTimeout);
+      break;
+    }
+    if (txn->IsDeadlockDetect() &&
+        IncrementWaiters(txn, wait_ids, start, column_family_id, exclusive,
+                         env)) {
+      result = Status::Busy(Status::SubCode::kDeadlock);
+      break;
+    }
+    txn->SetWaitingTxn(wait_ids, column_family_id, &start);
+
+    PERF_TIMER_GUARD(key_lock_wait_time);
+    PERF_COUNTER_ADD(key_lock_wait_count, 1);
+    table.mutex->Lock();
+    if (table.unlock_seq.load() == unlock_seq) {
+      if (timeout < 0) {
+        table.cv->Wait(table.mutex);
+      } else {
+        uint64_t now = env->NowMicros();
+        if (end_time > now) {
+          table.cv->WaitFor(table.mutex, end_time - now);
+        }
+      }
+    }
+    table.mutex->UnLock();
+
+    txn->ClearWaitingTxn();
+    if (txn->IsDeadlockDetect()) {
+      DecrementWaiters(txn, wait_ids);
+    }
+  }
+  table.num_waiters--;
+
+  return result;
+}
+
+void TransactionLockMgr::UnLockRanges(
+    const PessimisticTransaction* txn,
+    const std::vector<uint32_t>& column_family_ids) {
+  TransactionID txn_id = txn->GetID();
+  for (uint32_t column_family_id : column_family_ids) {
+    std::shared_ptr<LockMap> lock_map_ptr = GetLockMap(column_family_id);
+    LockMap* lock_map = lock_map_ptr.get();
+    if (lock_map == nullptr) {
+      // Column Family must have been dropped.
+      continue;
+    }
+
+    RangeLockTable& table = lock_map->range_locks;
+    table.mutex->Lock();
+    auto end = std::remove_if(
+        table.ranges.begin(), table.ranges.end(),
+        [txn_id](const RangeLockInfo& range) { return range.txn_id == txn_id; });
+    size_t num_unlocked = table.ranges.end() - end;
+    table.ranges.erase(end, table.ranges.end());
+    table.num_ranges.fetch_sub(num_unlocked, std::memory_order_release);
+    table.mutex->UnLock();
+
+    if (num_unlocked > 0) {
+      lock_map->NotifyStripeWaiters();
+      NotifyRangeWaiters(lock_map);
+    }
   }
 }
 
@@ -648,12 +995,20 @@ void TransactionLockMgr::UnLock(PessimisticTransaction* txn,
   assert(lock_map->lock_map_stripes_.size() > stripe_num);
   LockMapStripe* stripe = lock_map->lock_map_stripes_.at(stripe_num);
 
+  autovector<std::shared_ptr<KeyWaitQueue>> to_notify;
   stripe->stripe_mutex->Lock();
-  UnLockKey(txn, key, stripe, lock_map, env);
+  UnLockKey(txn, key, stripe, lock_map, env, &to_notify);
+  bool notify_stripe = stripe->num_waiters > 0;
   stripe->stripe_mutex->UnLock();
 
   // Signal waiting threads to retry locking
-  stripe->stripe_cv->NotifyAll();
+  for (auto& wait_queue : to_notify) {
+    wait_queue->cv->NotifyAll();
+  }
+  if (notify_stripe) {
+    stripe->stripe_cv->NotifyAll();
+  }
+  NotifyRangeWaiters(lock_map);
 }
 
 void TransactionLockMgr::UnLock(const PessimisticTransaction* txn,
@@ -689,17 +1044,25 @@ void TransactionLockMgr::UnLock(const PessimisticTransaction* txn,
       assert(lock_map->lock_map_stripes_.size() > stripe_num);
       LockMapStripe* stripe = lock_map->lock_map_stripes_.at(stripe_num);
 
+      autovector<std::shared_ptr<KeyWaitQueue>> to_notify;
       stripe->stripe_mutex->Lock();
 
       for (const std::string* key : stripe_keys) {
-        UnLockKey(txn, *key, stripe, lock_map, env);
+        UnLockKey(txn, *key, stripe, lock_map, env, &to_notify);
       }
+      bool notify_stripe = stripe->num_waiters > 0;
 
       stripe->stripe_mutex->UnLock();
 
       // Signal waiting threads to retry locking
-      stripe->stripe_cv->NotifyAll();
+      for (auto& wait_queue : to_notify) {
+        wait_queue->cv->NotifyAll();
+      }
+      if (notify_stripe) {
+        stripe->stripe_cv->NotifyAll();
+      }
     }
+    NotifyRangeWaiters(lock_map);
   }
 }
 
@@ -23,6 +23,8 @@
 namespace TERARKDB_NAMESPACE {
 
 class ColumnFamilyHandle;
+class Comparator;
+struct KeyWaitQueue;
 struct LockInfo;
 struct LockMap;
 struct LockMapStripe;
@@ -80,6 +82,19 @@ class TransactionLockMgr {
   void UnLock(PessimisticTransaction* txn, uint32_t column_family_id,
               const std::string& key, Env* env);
 
+  // Attempt to lock the keys in [start, end), ordered by `ucmp`, which must
+  // be the comparator of the column family.  Point locks of txn covered by
+  // the range are not taken any more, see TryLock().  If OK status is
+  // returned, the caller is responsible for calling UnLockRanges() for this
+  // column family.
+  Status TryRangeLock(PessimisticTransaction* txn, uint32_t column_family_id,
+                      const Comparator* ucmp, const std::string& start,
+                      const std::string& end, Env* env, bool exclusive);
+
+  // Release all the range locks txn holds in these column families.
+  void UnLockRanges(const PessimisticTransaction* txn,
+                    const std::vector<uint32_t>& column_family_ids);
+
   using LockStatusData = std::unordered_multimap<uint32_t, KeyLockInfo>;
   LockStatusData GetLockStatusData();
   std::vector<DeadlockPath> GetDeadlockInfoBuffer();
@@ -98,6 +113,7 @@ class TransactionLockMgr {
   // ourselves.
   //   - lock_map_mutex_
   //   - stripe mutexes in ascending cf id, ascending stripe order
+  //   - range lock mutex of the column family
   //   - wait_txn_map_mutex_
   //
   // Must be held when accessing/modifying lock_maps_.
@@ -138,8 +154,28 @@ class TransactionLockMgr {
                        const LockInfo& lock_info, uint64_t* wait_time,
                        autovector<TransactionID>* txn_ids);
 
+  // Returns true if another transaction holds a range lock on key that
+  // conflicts with lock_info, and sets *txn_ids to its holders.  Sets
+  // *covered if lock_info is implied by a range lock of its own transaction.
+  bool CheckRangeLocked(LockMap* lock_map, const std::string& key,
+                        const LockInfo& lock_info, bool* covered,
+                        autovector<TransactionID>* txn_ids);
+
+  // Scan the point locks of all stripes for the ones in [start, end) that
+  // conflict with lock_info, and set *txn_ids to their holders.
+  bool CheckPointLocked(LockMap* lock_map, const Comparator* ucmp,
+                        const std::string& start,
+                        const std::string& end, const LockInfo& lock_info,
+                        autovector<TransactionID>* txn_ids);
+
+  // Wake up the range lock waiters of lock_map, if any
+  void NotifyRangeWaiters(LockMap* lock_map);
+
+  // Wait queues of the unlocked key with waiters are added to `to_notify`,
+  // to be notified once the stripe mutex is released.
   void UnLockKey(const PessimisticTransaction* txn, const std::string& key,
-                 LockMapStripe* stripe, LockMap* lock_map, Env* env);
+                 LockMapStripe* stripe, LockMap* lock_map, Env* env,
+                 autovector<std::shared_ptr<KeyWaitQueue>>* to_notify);
 
   bool IncrementWaiters(const PessimisticTransaction* txn,
                         const autovector<TransactionID>& wait_ids,
@@ -395,6 +395,79 @@ TEST_P(TransactionTest, SharedLocks) {
   delete txn3;
 }
 
+TEST_P(TransactionTest, RangeLock) {
+  WriteOptions write_options;
+  ReadOptions read_options;
+  TransactionOptions txn_options;
+  Status s;
+
+  txn_options.lock_timeout = 1;
+  Transaction* txn1 = db->BeginTransaction(write_options, txn_options);
+  Transaction* txn2 = db->BeginTransaction(write_options, txn_options);
+  ASSERT_TRUE(txn1);
+  ASSERT_TRUE(txn2);
+
+  ASSERT_OK(txn1->GetRangeLock(nullptr, "b", "d"));
+  ASSERT_TRUE(txn1->GetRangeLock(nullptr, "d", "b").IsInvalidArgument());
+
+  // Keys in the range take no point locks of their own
+  ASSERT_OK(txn1->Put("b", "1"));
+  ASSERT_OK(txn1->GetForUpdate(read_options, "c", nullptr));
+  ASSERT_TRUE(db->GetLockStatusData().empty());
+
+  // The end of the range is not locked
+  s = txn2->GetForUpdate(read_options, "b", nullptr);
+  ASSERT_TRUE(s.IsTimedOut());
+  s = txn2->Put("c", "2");
+  ASSERT_TRUE(s.IsTimedOut());
+  ASSERT_OK(txn2->Put("d", "2"));
+  ASSERT_OK(txn2->Put("a", "2"));
+
+  // Overlapping ranges and ranges covering point locks conflict
+  s = txn2->GetRangeLock(nullptr, "c", "e");
+  ASSERT_TRUE(s.IsTimedOut());
+  s = txn1->GetRangeLock(nullptr, "0", "b");
+  ASSERT_TRUE(s.IsTimedOut());
+  s = txn1->GetRangeLock(nullptr, "d", "e");
+  ASSERT_TRUE(s.IsTimedOut());
+  ASSERT_OK(txn2->GetRangeLock(nullptr, "e", "f"));
+
+  // A waiter is woken up by the commit of the range lock holder
+  txn_options.lock_timeout = 10000;
+  Transaction* txn3 = db->BeginTransaction(write_options, txn_options);
+  ASSERT_TRUE(txn3);
+  port::Thread waiter([&]() { ASSERT_OK(txn3->Put("b", "3")); });
+  ASSERT_OK(txn1->Commit());
+  waiter.join();
+  ASSERT_OK(txn3->Commit());
+
+  std::string value;
+  ASSERT_OK(db->Get(read_options, "b", &value));
+  ASSERT_EQ("3", value);
+
+  // Shared range locks only conflict with exclusive locks
+  ASSERT_OK(txn2->Rollback());
+  txn_options.lock_timeout = 1;
+  Transaction* txn4 = db->BeginTransaction(write_options, txn_options);
+  Transaction* txn5 = db->BeginTransaction(write_options, txn_options);
+  ASSERT_TRUE(txn4);
+  ASSERT_TRUE(txn5);
+  ASSERT_OK(txn4->GetRangeLock(nullptr, "a", "z", false /* exclusive */));
+  ASSERT_OK(txn5->GetRangeLock(nullptr, "b", "c", false /* exclusive */));
+  ASSERT_OK(txn5->GetForUpdate(read_options, "x", nullptr, false));
+  s = txn5->Put("x", "5");
+  ASSERT_TRUE(s.IsTimedOut());
+  ASSERT_OK(txn4->Rollback());
+  ASSERT_OK(txn5->Put("x", "5"));
+  ASSERT_OK(txn5->Commit());
+
+  delete txn5;
+  delete txn4;
+  delete txn3;
+  delete txn2;
+  delete txn1;
+}
+
 TEST_P(TransactionTest, DeadlockCycleShared) {
   WriteOptions write_options;
   ReadOptions read_options;
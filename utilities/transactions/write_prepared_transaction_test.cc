@@ -145,6 +145,24 @@ TEST(PreparedHeap, EmptyAtTheEnd) {
   ASSERT_TRUE(heap.empty());
 }
 
+// Test that the lock-free top follows the top of the heap
+TEST(PreparedHeap, AtomicTop) {
+  WritePreparedTxnDB::PreparedHeap heap;
+  ASSERT_EQ(kMaxSequenceNumber, heap.AtomicTop());
+  heap.push(40l);
+  heap.push(50l);
+  ASSERT_EQ(40l, heap.AtomicTop());
+  heap.push(30l);
+  ASSERT_EQ(30l, heap.AtomicTop());
+  heap.erase(40l);
+  ASSERT_EQ(30l, heap.AtomicTop());
+  heap.erase(30l);
+  ASSERT_EQ(50l, heap.AtomicTop());
+  heap.pop();
+  ASSERT_TRUE(heap.empty());
+  ASSERT_EQ(kMaxSequenceNumber, heap.AtomicTop());
+}
+
 // Generate random order of PreparedHeap access and test that the heap will be
 // successfully emptied at the end.
 TEST(PreparedHeap, Concurrent) {
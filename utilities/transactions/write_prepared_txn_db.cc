@@ -386,7 +386,7 @@ void WritePreparedTxnDB::Init(const TransactionDBOptions& /* unused */) {
       new std::atomic<CommitEntry64b>[COMMIT_CACHE_SIZE] {});
 }
 
-void WritePreparedTxnDB::AddPrepared(uint64_t seq) {
+void WritePreparedTxnDB::AddPrepared(uint64_t seq, const size_t batch_cnt) {
   ROCKS_LOG_DETAILS(info_log_, "Txn %" PRIu64 " Prepareing", seq);
   assert(seq > max_evicted_seq_);
   if (seq <= max_evicted_seq_) {
@@ -394,8 +394,10 @@ void WritePreparedTxnDB::AddPrepared(uint64_t seq) {
         "Added prepare_seq is larger than max_evicted_seq_: " + ToString(seq) +
         " <= " + ToString(max_evicted_seq_.load()));
   }
-  WriteLock wl(&prepared_mutex_);
-  prepared_txns_.push(seq);
+  MutexLock l(&prepared_txns_mutex_);
+  for (size_t i = 0; i < batch_cnt; i++) {
+    prepared_txns_.push(seq + i);
+  }
 }
 
 void WritePreparedTxnDB::AddCommitted(uint64_t prepare_seq, uint64_t commit_seq,
@@ -444,16 +446,22 @@ void WritePreparedTxnDB::AddCommitted(uint64_t prepare_seq, uint64_t commit_seq,
 
 void WritePreparedTxnDB::RemovePrepared(const uint64_t prepare_seq,
                                         const size_t batch_cnt) {
-  WriteLock wl(&prepared_mutex_);
-  for (size_t i = 0; i < batch_cnt; i++) {
-    prepared_txns_.erase(prepare_seq + i);
-    bool was_empty = delayed_prepared_.empty();
-    if (!was_empty) {
+  {
+    MutexLock l(&prepared_txns_mutex_);
+    for (size_t i = 0; i < batch_cnt; i++) {
+      prepared_txns_.erase(prepare_seq + i);
+    }
+  }
+  // AdvanceMaxEvictedSeq moves entries to delayed_prepared_ before it pops
+  // them from prepared_txns_, so an entry we could not find there is seen
+  // here.
+  if (!delayed_prepared_empty_.load(std::memory_order_acquire)) {
+    WriteLock wl(&prepared_mutex_);
+    for (size_t i = 0; i < batch_cnt; i++) {
       delayed_prepared_.erase(prepare_seq + i);
-      bool is_empty = delayed_prepared_.empty();
-      if (was_empty != is_empty) {
-        delayed_prepared_empty_.store(is_empty, std::memory_order_release);
-      }
+    }
+    if (delayed_prepared_.empty()) {
+      delayed_prepared_empty_.store(true, std::memory_order_release);
     }
   }
 }
@@ -499,8 +507,9 @@ void WritePreparedTxnDB::AdvanceMaxEvictedSeq(const SequenceNumber& prev_max,
   // then it is not in prepared_txns_ ans save an expensive, synchronized
   // lookup from a shared set. delayed_prepared_ is expected to be empty in
   // normal cases.
-  {
+  if (prepared_txns_.AtomicTop() <= new_max) {
     WriteLock wl(&prepared_mutex_);
+    MutexLock l(&prepared_txns_mutex_);
     while (!prepared_txns_.empty() && prepared_txns_.top() <= new_max) {
       auto to_be_popped = prepared_txns_.top();
       delayed_prepared_.insert(to_be_popped);
@@ -244,8 +244,9 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
     return false;
   }
 
-  // Add the transaction with prepare sequence seq to the prepared list
-  void AddPrepared(uint64_t seq);
+  // Add the transaction with prepare sequence seq and its batch_cnt - 1
+  // following sub-batches to the prepared list
+  void AddPrepared(uint64_t seq, const size_t batch_cnt = 1);
   // Remove the transaction with prepare sequence seq from the prepared list
   void RemovePrepared(const uint64_t seq, const size_t batch_cnt = 1);
   // Add the transaction with prepare sequence prepare_seq and commit sequence
@@ -373,6 +374,7 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
   friend class PreparedHeap_BasicsTest_Test;
   friend class PreparedHeap_EmptyAtTheEnd_Test;
   friend class PreparedHeap_Concurrent_Test;
+  friend class PreparedHeap_AtomicTop_Test;
   friend class WritePreparedTxn;
   friend class WritePreparedTxnDBMock;
   friend class WritePreparedTransactionTest_AdvanceMaxEvictedSeqBasicTest_Test;
@@ -394,11 +396,15 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
 
   // A heap with the amortized O(1) complexity for erase. It uses one extra heap
   // to keep track of erased entries that are not yet on top of the main heap.
+  // The top is mirrored in an atomic so that it can be read without the lock
+  // that guards the rest.
   class PreparedHeap {
     std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>>
         heap_;
     std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>>
         erased_heap_;
+    // heap_.top(), or kMaxSequenceNumber if heap_ is empty
+    std::atomic<uint64_t> heap_top_ = {kMaxSequenceNumber};
     // True when testing crash recovery
     bool TEST_CRASH_ = false;
     friend class WritePreparedTxnDB;
@@ -412,8 +418,38 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
     }
     bool empty() { return heap_.empty(); }
     uint64_t top() { return heap_.top(); }
-    void push(uint64_t v) { heap_.push(v); }
+    // The top, or kMaxSequenceNumber if empty. Safe to call without the lock.
+    uint64_t AtomicTop() const {
+      return heap_top_.load(std::memory_order_acquire);
+    }
+    void push(uint64_t v) {
+      heap_.push(v);
+      UpdateTop();
+    }
     void pop() {
+      PopInternal();
+      UpdateTop();
+    }
+    void erase(uint64_t seq) {
+      if (!heap_.empty()) {
+        if (seq < heap_.top()) {
+          // Already popped, ignore it.
+        } else if (heap_.top() == seq) {
+          pop();
+          assert(heap_.empty() || heap_.top() != seq);
+        } else {  // (heap_.top() > seq)
+          // Down the heap, remember to pop it later
+          erased_heap_.push(seq);
+        }
+      }
+    }
+
+   private:
+    void UpdateTop() {
+      heap_top_.store(heap_.empty() ? kMaxSequenceNumber : heap_.top(),
+                      std::memory_order_release);
+    }
+    void PopInternal() {
       heap_.pop();
       while (!heap_.empty() && !erased_heap_.empty() &&
              // heap_.top() > erased_heap_.top() could happen if we have erased
@@ -433,19 +469,6 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
         erased_heap_.pop();
       }
     }
-    void erase(uint64_t seq) {
-      if (!heap_.empty()) {
-        if (seq < heap_.top()) {
-          // Already popped, ignore it.
-        } else if (heap_.top() == seq) {
-          pop();
-          assert(heap_.empty() || heap_.top() != seq);
-        } else {  // (heap_.top() > seq)
-          // Down the heap, remember to pop it later
-          erased_heap_.push(seq);
-        }
-      }
-    }
   };
 
   void TEST_Crash() override { prepared_txns_.TEST_CRASH_ = true; }
@@ -485,18 +508,16 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
     // written in two steps, we also update prepared_txns_ at the first step
     // (via the same mechanism) so that their uncommitted data is reflected in
     // SmallestUnCommittedSeq.
-    ReadLock rl(&prepared_mutex_);
-    // Since we are holding the mutex, and GetLatestSequenceNumber is updated
-    // after prepared_txns_ are, the value of GetLatestSequenceNumber would
-    // reflect any uncommitted data that is not added to prepared_txns_ yet.
+    //
+    // This is called for every snapshot, so it reads the top of the heap
+    // without locking. GetLatestSequenceNumber is updated after prepared_txns_
+    // are, so it must be read first: any uncommitted data that it reflects is
+    // then either in prepared_txns_ already or committed.
     // Otherwise, if there is no concurrent txn, this value simply reflects that
     // latest value in the memtable.
-    if (prepared_txns_.empty()) {
-      return db_impl_->GetLatestSequenceNumber() + 1;
-    } else {
-      return std::min(prepared_txns_.top(),
-                      db_impl_->GetLatestSequenceNumber() + 1);
-    }
+    auto next_prepare = db_impl_->GetLatestSequenceNumber() + 1;
+    auto min_prepare = prepared_txns_.AtomicTop();
+    return std::min(min_prepare, next_prepare);
   }
   // Enhance the snapshot object by recording in it the smallest uncommitted seq
   inline void EnhanceSnapshot(SnapshotImpl* snapshot,
@@ -567,7 +588,7 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
   SequenceNumber snapshots_version_ = 0;
 
   // A heap of prepared transactions. Thread-safety is provided with
-  // prepared_mutex_.
+  // prepared_txns_mutex_, but for PreparedHeap::AtomicTop().
   PreparedHeap prepared_txns_;
   // 8m entry, 64MB size
   static const size_t DEF_COMMIT_CACHE_BITS = static_cast<size_t>(23);
@@ -605,6 +626,10 @@ class WritePreparedTxnDB : public PessimisticTransactionDB {
   // Update when old_commit_map_.empty() changes. Expected to be true normally.
   std::atomic<bool> old_commit_map_empty_ = {true};
   mutable port::RWMutex prepared_mutex_;
+  // Guards prepared_txns_ only, so prepares and commits do not contend with
+  // the readers of delayed_prepared_. prepared_mutex_ must be acquired first
+  // if both are held.
+  port::Mutex prepared_txns_mutex_;
   mutable port::RWMutex old_commit_map_mutex_;
   mutable port::RWMutex commit_cache_mutex_;
   mutable port::RWMutex snapshots_mutex_;
@@ -650,9 +675,7 @@ class AddPreparedCallback : public PreReleaseCallback {
     (void)is_mem_disabled;
 #endif
     assert(!two_write_queues_ || !is_mem_disabled);  // implies the 1st queue
-    for (size_t i = 0; i < sub_batch_cnt_; i++) {
-      db_->AddPrepared(prepare_seq + i);
-    }
+    db_->AddPrepared(prepare_seq, sub_batch_cnt_);
     return Status::OK();
   }
 
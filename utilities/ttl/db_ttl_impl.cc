@@ -17,7 +17,15 @@
 namespace TERARKDB_NAMESPACE {
 
 void DBWithTTLImpl::SanitizeOptions(int32_t ttl, ColumnFamilyOptions* options,
-                                    Env* env) {
+                                    Env* env, bool use_ttl_extractor) {
+  if (use_ttl_extractor) {
+    options->ttl_extractor_factory =
+        std::make_shared<TtlExtractorFactoryForTtlDB>(ttl, env);
+    options->ttl_drop_expired_files = true;
+    // The entries of an SST expire together, rewriting them drops none
+    options->ttl_gc_ratio = 2.0;
+    return;
+  }
   if (options->compaction_filter) {
     options->compaction_filter =
         new TtlCompactionFilter(ttl, env, options->compaction_filter);
@@ -34,12 +42,15 @@ void DBWithTTLImpl::SanitizeOptions(int32_t ttl, ColumnFamilyOptions* options,
 }
 
 // Open the db inside DBWithTTLImpl because options needs pointer to its ttl
-DBWithTTLImpl::DBWithTTLImpl(DB* db) : DBWithTTL(db) {}
+DBWithTTLImpl::DBWithTTLImpl(DB* db, bool use_ttl_extractor)
+    : DBWithTTL(db), use_ttl_extractor_(use_ttl_extractor) {}
 
 DBWithTTLImpl::~DBWithTTLImpl() {
   // Need to stop background compaction before getting rid of the filter
   CancelAllBackgroundWork(db_, /* wait = */ true);
-  delete GetOptions().compaction_filter;
+  if (!use_ttl_extractor_) {
+    delete GetOptions().compaction_filter;
+  }
 }
 
 Status UtilityDB::OpenTtlDB(const Options& options, const std::string& dbname,
@@ -55,7 +66,8 @@ Status UtilityDB::OpenTtlDB(const Options& options, const std::string& dbname,
 }
 
 Status DBWithTTL::Open(const Options& options, const std::string& dbname,
-                       DBWithTTL** dbptr, int32_t ttl, bool read_only) {
+                       DBWithTTL** dbptr, int32_t ttl, bool read_only,
+                       bool use_ttl_extractor) {
   DBOptions db_options(options);
   ColumnFamilyOptions cf_options(options);
   std::vector<ColumnFamilyDescriptor> column_families;
@@ -63,7 +75,7 @@ Status DBWithTTL::Open(const Options& options, const std::string& dbname,
       ColumnFamilyDescriptor(kDefaultColumnFamilyName, cf_options));
   std::vector<ColumnFamilyHandle*> handles;
   Status s = DBWithTTL::Open(db_options, dbname, column_families, &handles,
-                             dbptr, {ttl}, read_only);
+                             dbptr, {ttl}, read_only, use_ttl_extractor);
   if (s.ok()) {
     assert(handles.size() == 1);
     // i can delete the handle since DBImpl is always holding a reference to
@@ -77,7 +89,7 @@ Status DBWithTTL::Open(
     const DBOptions& db_options, const std::string& dbname,
     const std::vector<ColumnFamilyDescriptor>& column_families,
     std::vector<ColumnFamilyHandle*>* handles, DBWithTTL** dbptr,
-    std::vector<int32_t> ttls, bool read_only) {
+    std::vector<int32_t> ttls, bool read_only, bool use_ttl_extractor) {
   if (ttls.size() != column_families.size()) {
     return Status::InvalidArgument(
         "ttls size has to be the same as number of column families");
@@ -88,7 +100,8 @@ Status DBWithTTL::Open(
   for (size_t i = 0; i < column_families_sanitized.size(); ++i) {
     DBWithTTLImpl::SanitizeOptions(
         ttls[i], &column_families_sanitized[i].options,
-        db_options.env == nullptr ? Env::Default() : db_options.env);
+        db_options.env == nullptr ? Env::Default() : db_options.env,
+        use_ttl_extractor);
   }
   DB* db;
 
@@ -100,7 +113,7 @@ Status DBWithTTL::Open(
     st = DB::Open(db_options, dbname, column_families_sanitized, handles, &db);
   }
   if (st.ok()) {
-    *dbptr = new DBWithTTLImpl(db);
+    *dbptr = new DBWithTTLImpl(db, use_ttl_extractor);
   } else {
     *dbptr = nullptr;
   }
@@ -111,7 +124,8 @@ Status DBWithTTLImpl::CreateColumnFamilyWithTtl(
     const ColumnFamilyOptions& options, const std::string& column_family_name,
     ColumnFamilyHandle** handle, int ttl) {
   ColumnFamilyOptions sanitized_options = options;
-  DBWithTTLImpl::SanitizeOptions(ttl, &sanitized_options, GetEnv());
+  DBWithTTLImpl::SanitizeOptions(ttl, &sanitized_options, GetEnv(),
+                                 use_ttl_extractor_);
 
   return DBWithTTL::CreateColumnFamily(sanitized_options, column_family_name,
                                        handle);
@@ -214,7 +228,7 @@ Status DBWithTTLImpl::Get(const ReadOptions& options,
     value = &buffer;
   }
   Status st = db_->Get(options, column_family, key, value);
-  if (!st.ok()) {
+  if (!st.ok() || use_ttl_extractor_) {
     return st;
   }
   st = SanityCheckTimestamp(value->slice());
@@ -229,6 +243,9 @@ std::vector<Status> DBWithTTLImpl::MultiGet(
     const std::vector<ColumnFamilyHandle*>& column_family,
     const std::vector<Slice>& keys, std::vector<std::string>* values) {
   auto statuses = db_->MultiGet(options, column_family, keys, values);
+  if (use_ttl_extractor_) {
+    return statuses;
+  }
   for (size_t i = 0; i < keys.size(); ++i) {
     if (!statuses[i].ok()) {
       continue;
@@ -247,7 +264,8 @@ bool DBWithTTLImpl::KeyMayExist(const ReadOptions& options,
                                 const Slice& key, std::string* value,
                                 bool* value_found) {
   bool ret = db_->KeyMayExist(options, column_family, key, value, value_found);
-  if (ret && value != nullptr && value_found != nullptr && *value_found) {
+  if (ret && !use_ttl_extractor_ && value != nullptr &&
+      value_found != nullptr && *value_found) {
     if (!SanityCheckTimestamp(*value).ok() || !StripTS(value).ok()) {
       return false;
     }
@@ -264,6 +282,9 @@ Status DBWithTTLImpl::Merge(const WriteOptions& options,
 }
 
 Status DBWithTTLImpl::Write(const WriteOptions& opts, WriteBatch* updates) {
+  if (use_ttl_extractor_) {
+    return db_->Write(opts, updates);
+  }
   class Handler : public WriteBatch::Handler {
    public:
     explicit Handler(Env* env) : env_(env) {}
@@ -316,6 +337,9 @@ Status DBWithTTLImpl::Write(const WriteOptions& opts, WriteBatch* updates) {
 
 Iterator* DBWithTTLImpl::NewIterator(const ReadOptions& opts,
                                      ColumnFamilyHandle* column_family) {
+  if (use_ttl_extractor_) {
+    return db_->NewIterator(opts, column_family);
+  }
   return new TtlIterator(db_->NewIterator(opts, column_family));
 }
 
@@ -323,6 +347,13 @@ void DBWithTTLImpl::SetTtl(ColumnFamilyHandle* h, int32_t ttl) {
   std::shared_ptr<TtlCompactionFilterFactory> filter;
   Options opts;
   opts = GetOptions(h);
+  if (use_ttl_extractor_) {
+    auto factory = std::static_pointer_cast<const TtlExtractorFactoryForTtlDB>(
+        opts.ttl_extractor_factory);
+    if (!factory) return;
+    std::const_pointer_cast<TtlExtractorFactoryForTtlDB>(factory)->SetTtl(ttl);
+    return;
+  }
   filter = std::static_pointer_cast<TtlCompactionFilterFactory>(
       opts.compaction_filter_factory);
   if (!filter) return;
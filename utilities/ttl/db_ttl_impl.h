@@ -5,6 +5,7 @@
 #pragma once
 
 #ifndef ROCKSDB_LITE
+#include <atomic>
 #include <deque>
 #include <string>
 #include <vector>
@@ -15,6 +16,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/merge_operator.h"
 #include "rocksdb/terark_namespace.h"
+#include "rocksdb/ttl_extractor.h"
 #include "rocksdb/utilities/db_ttl.h"
 #include "rocksdb/utilities/utility_db.h"
 
@@ -28,9 +30,9 @@ namespace TERARKDB_NAMESPACE {
 class DBWithTTLImpl : public DBWithTTL {
  public:
   static void SanitizeOptions(int32_t ttl, ColumnFamilyOptions* options,
-                              Env* env);
+                              Env* env, bool use_ttl_extractor = false);
 
-  explicit DBWithTTLImpl(DB* db);
+  explicit DBWithTTLImpl(DB* db, bool use_ttl_extractor = false);
 
   virtual ~DBWithTTLImpl();
 
@@ -98,6 +100,10 @@ class DBWithTTLImpl : public DBWithTTL {
   void SetTtl(int32_t ttl) override { SetTtl(DefaultColumnFamily(), ttl); }
 
   void SetTtl(ColumnFamilyHandle* h, int32_t ttl) override;
+
+ private:
+  // Values are stored without timestamps, see TtlExtractorFactoryForTtlDB
+  bool use_ttl_extractor_;
 };
 
 class TtlIterator : public Iterator {
@@ -224,6 +230,62 @@ class TtlCompactionFilterFactory : public CompactionFilterFactory {
   std::shared_ptr<CompactionFilterFactory> user_comp_filter_factory_;
 };
 
+// Every entry expires `ttl` seconds after it is written to an SST. A
+// compaction output expires no later than its inputs, so that is at most
+// `ttl` seconds after the flush that wrote the entry
+class TtlExtractorFactoryForTtlDB : public TtlExtractorFactory {
+ public:
+  TtlExtractorFactoryForTtlDB(int32_t ttl, Env* env) : ttl_(ttl), env_(env) {}
+
+  class Extractor : public TtlExtractor {
+   public:
+    explicit Extractor(const TtlExtractorFactoryForTtlDB* factory)
+        : ttl_(factory->ttl_.load(std::memory_order_relaxed)),
+          env_(factory->env_) {}
+
+    virtual Status Extract(EntryType /*entry_type*/, const Slice& /*user_key*/,
+                           const Slice& /*value_or_meta*/, bool* has_ttl,
+                           uint64_t* ttl_time_point) const override {
+      int64_t curtime;
+      // Data is fresh if TTL is non-positive or the time is unknown
+      *has_ttl = ttl_ > 0 && env_->GetCurrentTime(&curtime).ok();
+      if (*has_ttl) {
+        *ttl_time_point = static_cast<uint64_t>(curtime) + ttl_;
+      }
+      return Status::OK();
+    }
+
+   private:
+    int32_t ttl_;
+    Env* env_;
+  };
+
+  virtual std::unique_ptr<TtlExtractor> CreateTtlExtractor(
+      const TtlContext& /*context*/) const override {
+    return std::unique_ptr<TtlExtractor>(new Extractor(this));
+  }
+
+  virtual uint64_t Now() const override {
+    int64_t curtime;
+    if (!env_->GetCurrentTime(&curtime).ok()) {
+      return 0;  // Nothing expires if could not get current time
+    }
+    return static_cast<uint64_t>(curtime);
+  }
+
+  virtual bool BoundedByInputs() const override { return true; }
+
+  void SetTtl(int32_t ttl) { ttl_.store(ttl, std::memory_order_relaxed); }
+
+  virtual const char* Name() const override {
+    return "TtlExtractorFactoryForTtlDB";
+  }
+
+ private:
+  std::atomic<int32_t> ttl_;
+  Env* env_;
+};
+
 class TtlMergeOperator : public MergeOperator {
  public:
   explicit TtlMergeOperator(const std::shared_ptr<MergeOperator>& merge_op,
@@ -7,6 +7,7 @@
 #include <map>
 #include <memory>
 
+#include "db/db_impl.h"
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/terark_namespace.h"
 #include "rocksdb/utilities/db_ttl.h"
@@ -90,6 +91,12 @@ class TtlTest : public testing::Test {
     ASSERT_OK(DBWithTTL::Open(options_, dbname_, &db_ttl_, ttl, true));
   }
 
+  // Open database with TTL kept in the table properties
+  void OpenTtlWithTtlExtractor(int32_t ttl) {
+    ASSERT_TRUE(db_ttl_ == nullptr);
+    ASSERT_OK(DBWithTTL::Open(options_, dbname_, &db_ttl_, ttl, false, true));
+  }
+
   void CloseTtl() {
     delete db_ttl_;
     db_ttl_ = nullptr;
@@ -646,6 +653,25 @@ TEST_F(TtlTest, ChangeTtlOnOpenDb) {
   CloseTtl();
 }
 
+// With use_ttl_extractor the values are stored as is and expire with the SSTs
+// holding them, which compactions do not extend
+TEST_F(TtlTest, TtlExtractorBackend) {
+  MakeKVMap(kSampleSize_);
+
+  OpenTtlWithTtlExtractor(2);  // T=0:Open the db with ttl = 2
+  PutValues(0, kSampleSize_);  // T=0:Insert Set1. Delete at t=2
+  SimpleMultiGetTest();
+
+  auto db_impl = static_cast<DBImpl*>(db_ttl_->GetRootDB());
+  SleepCompactCheck(1, 0, kSampleSize_, true);  // T=1:Set1 should be there
+  db_impl->ScheduleTtlGC();
+  SleepCompactCheck(0, 0, kSampleSize_, true);
+  env_->Sleep(1);  // T=2
+  db_impl->ScheduleTtlGC();
+  SleepCompactCheck(0, 0, kSampleSize_, false);  // T=2:Set1 should not be there
+  CloseTtl();
+}
+
 }  //  namespace TERARKDB_NAMESPACE
 
 // A black-box test for the ttl wrapper around rocksdb
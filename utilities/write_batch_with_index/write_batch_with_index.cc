@@ -963,6 +963,97 @@ Status WriteBatchWithIndex::GetFromBatchAndDB(
   return s;
 }
 
+std::vector<Status> WriteBatchWithIndex::MultiGetFromBatchAndDB(
+    DB* db, const ReadOptions& read_options, ColumnFamilyHandle* column_family,
+    const std::vector<Slice>& keys, std::vector<std::string>* values) {
+  size_t num_keys = keys.size();
+  values->resize(num_keys);
+  std::vector<Status> statuses(num_keys);
+  const ImmutableDBOptions& immuable_db_options =
+      static_cast_with_check<DBImpl, DB>(db->GetRootDB())
+          ->immutable_db_options();
+  const Comparator* cmp = rep->GetComparator(column_family);
+
+  // Resolve what we can from the batch, and collect the rest for the DB
+  std::vector<MergeContext> merge_contexts(num_keys);
+  std::vector<size_t> db_indexes;
+  std::vector<Slice> db_keys;
+  for (size_t i = 0; i < num_keys; ++i) {
+    std::string* value = &(*values)[i];
+    LazyBuffer lazy_val(value);
+    Status s;
+    WriteBatchWithIndexInternal::Result result =
+        WriteBatchWithIndexInternal::GetFromBatch(
+            immuable_db_options, this, column_family, keys[i],
+            &merge_contexts[i], cmp, &lazy_val, rep->overwrite_key, &s);
+    switch (result) {
+      case WriteBatchWithIndexInternal::Result::kFound:
+        lazy_val.pin(LazyBufferPinLevel::DB);
+        s = lazy_val.fetch();
+        if (s.ok()) {
+          s = std::move(lazy_val).dump(value);
+        }
+        break;
+      case WriteBatchWithIndexInternal::Result::kDeleted:
+        s = Status::NotFound();
+        break;
+      case WriteBatchWithIndexInternal::Result::kError:
+        break;
+      default:
+        if (result == WriteBatchWithIndexInternal::Result::kMergeInProgress &&
+            rep->overwrite_key) {
+          // See GetFromBatchAndDB()
+          s = Status::MergeInProgress();
+        } else {
+          db_indexes.push_back(i);
+          db_keys.push_back(keys[i]);
+        }
+        break;
+    }
+    statuses[i] = std::move(s);
+  }
+  if (db_keys.empty()) {
+    return statuses;
+  }
+
+  std::vector<std::string> db_values;
+  std::vector<Status> db_statuses = db->GetRootDB()->MultiGet(
+      read_options,
+      std::vector<ColumnFamilyHandle*>(db_keys.size(), column_family), db_keys,
+      &db_values);
+
+  auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family);
+  const MergeOperator* merge_operator = cfh->cfd()->ioptions()->merge_operator;
+  for (size_t j = 0; j < db_keys.size(); ++j) {
+    size_t i = db_indexes[j];
+    Status& s = statuses[i];
+    s = std::move(db_statuses[j]);
+    std::string* value = &(*values)[i];
+    MergeContext& merge_context = merge_contexts[i];
+    if (merge_context.GetNumOperands() == 0 || (!s.ok() && !s.IsNotFound())) {
+      // Not in the batch, or the DB read failed
+      *value = std::move(db_values[j]);
+      continue;
+    }
+    // Merge result from DB with merges in Batch
+    if (merge_operator == nullptr) {
+      s = Status::InvalidArgument("Options::merge_operator must be set");
+      continue;
+    }
+    LazyBuffer db_value(db_values[j]);
+    LazyBuffer merge_result;
+    s = MergeHelper::TimedFullMerge(
+        merge_operator, db_keys[j], s.ok() ? &db_value : nullptr,
+        merge_context.GetOperands(), &merge_result,
+        immuable_db_options.info_log.get(),
+        immuable_db_options.statistics.get(), immuable_db_options.env);
+    if (s.ok()) {
+      s = std::move(merge_result).dump(value);
+    }
+  }
+  return statuses;
+}
+
 void WriteBatchWithIndex::SetSavePoint() { rep->write_batch.SetSavePoint(); }
 
 Status WriteBatchWithIndex::RollbackToSavePoint() {
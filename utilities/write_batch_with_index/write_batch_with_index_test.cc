@@ -1283,6 +1283,69 @@ TEST_F(WriteBatchWithIndexTest, TestGetFromBatchAndDBMerge) {
   }
 }
 
+TEST_F(WriteBatchWithIndexTest, TestMultiGetFromBatchAndDB) {
+  for (auto index_type : all_index_types) {
+    DB* db;
+    Options options;
+
+    options.create_if_missing = true;
+    std::string dbname = test::PerThreadDBPath("write_batch_with_index_test");
+
+    options.merge_operator = MergeOperators::CreateFromStringId("stringappend");
+
+    DestroyDB(dbname, options);
+    Status s = DB::Open(options, dbname, &db);
+    ASSERT_OK(s);
+
+    WriteBatchWithIndex batch(BytewiseComparator(), 0, false, 0, index_type);
+    WriteOptions write_options;
+
+    ASSERT_OK(db->Put(write_options, "a", "a0"));
+    ASSERT_OK(db->Put(write_options, "b", "b0"));
+    ASSERT_OK(db->Put(write_options, "c", "c0"));
+    ASSERT_OK(db->Merge(write_options, "d", "d0"));
+
+    batch.Put("b", "b1");
+    batch.Delete("c");
+    batch.Merge("d", "d1");
+    batch.Merge("e", "e0");
+    batch.Put("f", "f0");
+
+    std::vector<Slice> keys = {"a", "b", "c", "d", "e", "f", "g"};
+    std::vector<std::string> values;
+    std::vector<Status> statuses = batch.MultiGetFromBatchAndDB(
+        db, ReadOptions(), db->DefaultColumnFamily(), keys, &values);
+    ASSERT_EQ(keys.size(), statuses.size());
+    ASSERT_EQ(keys.size(), values.size());
+
+    ASSERT_OK(statuses[0]);
+    ASSERT_EQ("a0", values[0]);
+    ASSERT_OK(statuses[1]);
+    ASSERT_EQ("b1", values[1]);
+    ASSERT_TRUE(statuses[2].IsNotFound());
+    ASSERT_OK(statuses[3]);
+    ASSERT_EQ("d0,d1", values[3]);
+    ASSERT_OK(statuses[4]);
+    ASSERT_EQ("e0", values[4]);
+    ASSERT_OK(statuses[5]);
+    ASSERT_EQ("f0", values[5]);
+    ASSERT_TRUE(statuses[6].IsNotFound());
+
+    // Agrees with the single key reads
+    for (size_t i = 0; i < keys.size(); ++i) {
+      std::string value;
+      s = batch.GetFromBatchAndDB(db, ReadOptions(), keys[i], &value);
+      ASSERT_EQ(s.code(), statuses[i].code());
+      if (s.ok()) {
+        ASSERT_EQ(value, values[i]);
+      }
+    }
+
+    delete db;
+    DestroyDB(dbname, options);
+  }
+}
+
 TEST_F(WriteBatchWithIndexTest, TestGetFromBatchAndDBMerge2) {
   for (auto index_type : all_index_types) {
     DB* db;